@@ -15,7 +15,9 @@
 #include <cstring>
 #include <cstdio>
 
+#include <QtCore/QHash>
 #include <QtCore/QTimer>
+#include <QtCore/QUuid>
 
 #include <EnvironmentData.h>
 #include <NodeList.h>
@@ -37,13 +39,9 @@ bool includeDanceFloor = true;
 bool buildStreet = false;
 bool nonThreadedPacketSender = false;
 int packetsPerSecond = PacketSender::DEFAULT_PACKETS_PER_SECOND;
-bool waitForVoxelServer = true;
 
 
 const int ANIMATION_LISTEN_PORT = 40107;
-int ANIMATE_FPS = 60;
-double ANIMATE_FPS_IN_MILLISECONDS = 1000.0/ANIMATE_FPS; // determines FPS from our desired FPS
-quint64 ANIMATE_VOXELS_INTERVAL_USECS = (ANIMATE_FPS_IN_MILLISECONDS * 1000); // converts from milliseconds to usecs
 
 
 int PROCESSING_FPS = 60;
@@ -60,31 +58,38 @@ JurisdictionListener* jurisdictionListener = NULL;
 VoxelEditPacketSender* voxelEditPacketSender = NULL;
 pthread_t animateVoxelThread;
 
-glm::vec3 rotatePoint(glm::vec3 point, float angle) {
-    //  First, create the quaternion based on this angle of rotation
-    glm::quat q(glm::vec3(0, -angle, 0));
-    
-    //  Next, create a rotation matrix from that quaternion
-    glm::mat4 rotation = glm::mat4_cast(q);
-    
-    //  Transform the original vectors by the rotation matrix to get the new vectors
-    glm::vec4 quatPoint(point.x, point.y, point.z, 0);
-    glm::vec4 newPoint = quatPoint * rotation;
-    
-    return glm::vec3(newPoint.x, newPoint.y, newPoint.z);
+// the animations have the same ids each time the animation server runs, so that it updates those it sent the last time
+// rather than adding more
+const QUuid BILLBOARD_ANIMATION_ID("{5a8a2f0c-0d3e-4b7e-9a43-6b1f6b2c1e01}");
+const QUuid BORDER_TRACER_ANIMATION_ID("{5a8a2f0c-0d3e-4b7e-9a43-6b1f6b2c1e02}");
+const QUuid MOVING_BUG_ANIMATION_ID("{5a8a2f0c-0d3e-4b7e-9a43-6b1f6b2c1e03}");
+const QUuid BLINKING_VOXEL_ANIMATION_ID("{5a8a2f0c-0d3e-4b7e-9a43-6b1f6b2c1e04}");
+const QUuid DANCE_FLOOR_ANIMATION_ID("{5a8a2f0c-0d3e-4b7e-9a43-6b1f6b2c1e05}");
+
+// the voxel servers animate the animations themselves, so they're only sent again now and then, for a server that's
+// started since, which goes on with those it has from where they are
+const quint64 ANIMATION_RESEND_INTERVAL_USECS = 10 * 1000 * 1000;
+const quint64 ANIMATION_RETRY_INTERVAL_USECS = 1000 * 1000;
+
+QHash<QUuid, VoxelAnimation> animations;
+
+static VoxelAnimationPart makePart(int x, int y, int z, const unsigned char* colorA, const unsigned char* colorB,
+                                   float phase = 0.0f) {
+    VoxelAnimationPart part;
+    part.x = x;
+    part.y = y;
+    part.z = z;
+    memcpy(part.colorA, colorA, sizeof(rgbColor));
+    memcpy(part.colorB, colorB, sizeof(rgbColor));
+    part.phase = (quint16)(phase * 65535.0f + 0.5f);
+    return part;
 }
 
-
 const float BUG_VOXEL_SIZE = 0.0625f / TREE_SCALE;
-glm::vec3 bugPosition  = glm::vec3(BUG_VOXEL_SIZE * 20.0, BUG_VOXEL_SIZE * 30.0, BUG_VOXEL_SIZE * 20.0);
-glm::vec3 bugDirection = glm::vec3(0, 0, 1);
 const int VOXELS_PER_BUG = 18;
-glm::vec3 bugPathCenter = glm::vec3(0.25f,0.15f,0.25f); // glm::vec3(BUG_VOXEL_SIZE * 150.0, BUG_VOXEL_SIZE * 30.0, BUG_VOXEL_SIZE * 150.0);
-float bugPathRadius = 0.2f; //BUG_VOXEL_SIZE * 140.0;
-float bugPathTheta = 0.0f * RADIANS_PER_DEGREE;
-float bugRotation = 0.0f * RADIANS_PER_DEGREE;
-float bugAngleDelta = 0.2f * RADIANS_PER_DEGREE;
-bool moveBugInLine = false;
+glm::vec3 bugPathCenter = glm::vec3(0.25f,0.15f,0.25f);
+float bugPathRadius = 0.2f;
+const quint32 BUG_ORBIT_MSECS = 30 * 1000; // 0.2 degrees a frame at 60 frames a second
 
 class BugPart {
 public:
@@ -132,223 +137,81 @@ const BugPart bugParts[VOXELS_PER_BUG] = {
     BugPart(glm::vec3(-2, -1,  0), 153, 200, 0) ,
 };
 
-static void renderMovingBug() {
-    VoxelDetail details[VOXELS_PER_BUG];
-    
-    // Generate voxels for where bug used to be
+static void addMovingBug() {
+    VoxelAnimation bug;
+    bug.voxelSize = BUG_VOXEL_SIZE;
+    bug.origin = bugPathCenter;
+    bug.orbitPeriodMsecs = BUG_ORBIT_MSECS;
+    bug.orbitRadius = bugPathRadius;
     for (int i = 0; i < VOXELS_PER_BUG; i++) {
-        details[i].s = BUG_VOXEL_SIZE;
-        
-        glm::vec3 partAt = bugParts[i].partLocation * BUG_VOXEL_SIZE * (bugDirection.x < 0 ? -1.0f : 1.0f);
-        glm::vec3 rotatedPartAt = rotatePoint(partAt, bugRotation);
-        glm::vec3 offsetPartAt = rotatedPartAt + bugPosition;
-        
-        details[i].x = offsetPartAt.x;
-        details[i].y = offsetPartAt.y;
-        details[i].z = offsetPartAt.z;
-        
-        details[i].red   = bugParts[i].partColor[0];
-        details[i].green = bugParts[i].partColor[1];
-        details[i].blue  = bugParts[i].partColor[2];
-    }
-    
-    // send the "erase message" first...
-    PacketType message = PacketTypeVoxelErase;
-    ::voxelEditPacketSender->queueVoxelEditMessages(message, VOXELS_PER_BUG, (VoxelDetail*)&details);
-    
-    // Move the bug...
-    if (moveBugInLine) {
-        bugPosition.x += (bugDirection.x * BUG_VOXEL_SIZE);
-        bugPosition.y += (bugDirection.y * BUG_VOXEL_SIZE);
-        bugPosition.z += (bugDirection.z * BUG_VOXEL_SIZE);
-        
-        // Check boundaries
-        if (bugPosition.z > 1.0f) {
-            bugDirection.z = -1.f;
-        }
-        if (bugPosition.z < BUG_VOXEL_SIZE) {
-            bugDirection.z = 1.f;
-        }
-    } else {
-        
-        //qDebug("bugPathCenter=(%f,%f,%f)", bugPathCenter.x, bugPathCenter.y, bugPathCenter.z);
-        
-        bugPathTheta += bugAngleDelta; // move slightly
-        bugRotation  -= bugAngleDelta; // rotate slightly
-        
-        // If we loop past end of circle, just reset back into normal range
-        if (bugPathTheta > TWO_PI) {
-            bugPathTheta = 0.f;
-            bugRotation  = 0.f;
-        }
-        
-        float x = bugPathCenter.x + bugPathRadius * cos(bugPathTheta);
-        float z = bugPathCenter.z + bugPathRadius * sin(bugPathTheta);
-        float y = bugPathCenter.y;
-        
-        bugPosition = glm::vec3(x, y, z);
-        //qDebug("bugPathTheta=%f", bugPathTheta);
-        //qDebug("bugRotation=%f", bugRotation);
-    }
-    
-    //qDebug("bugPosition=(%f,%f,%f)", bugPosition.x, bugPosition.y, bugPosition.z);
-    //qDebug("bugDirection=(%f,%f,%f)", bugDirection.x, bugDirection.y, bugDirection.z);
-    // would be nice to add some randomness here...
-    
-    // Generate voxels for where bug is going to
-    for (int i = 0; i < VOXELS_PER_BUG; i++) {
-        details[i].s = BUG_VOXEL_SIZE;
-        
-        glm::vec3 partAt = bugParts[i].partLocation * BUG_VOXEL_SIZE * (bugDirection.x < 0 ? -1.0f : 1.0f);
-        glm::vec3 rotatedPartAt = rotatePoint(partAt, bugRotation);
-        glm::vec3 offsetPartAt = rotatedPartAt + bugPosition;
-        
-        details[i].x = offsetPartAt.x;
-        details[i].y = offsetPartAt.y;
-        details[i].z = offsetPartAt.z;
-        
-        details[i].red   = bugParts[i].partColor[0];
-        details[i].green = bugParts[i].partColor[1];
-        details[i].blue  = bugParts[i].partColor[2];
+        const BugPart& bugPart = bugParts[i];
+        bug.parts.append(makePart(bugPart.partLocation.x, bugPart.partLocation.y, bugPart.partLocation.z,
+            bugPart.partColor, bugPart.partColor));
     }
-    
-    // send the "create message" ...
-    message = PacketTypeVoxelSetDestructive;
-    ::voxelEditPacketSender->queueVoxelEditMessages(message, VOXELS_PER_BUG, (VoxelDetail*)&details);
+    animations.insert(MOVING_BUG_ANIMATION_ID, bug);
 }
 
 
-float intensity = 0.5f;
-float intensityIncrement = 0.1f;
-const float MAX_INTENSITY = 1.0f;
-const float MIN_INTENSITY = 0.5f;
+const unsigned char BEACON_DIM_COLOR[3] = { 127, 0, 0 };
+const unsigned char BEACON_BRIGHT_COLOR[3] = { 255, 0, 0 };
+const quint32 BEACON_BLINK_MSECS = 10 * 1000 / 60; // half to full intensity and back, a tenth a frame
 const float BEACON_SIZE = 0.25f / TREE_SCALE; // approximately 1/4th meter
 
-static void sendVoxelBlinkMessage() {
-    VoxelDetail detail;
-    detail.s = BEACON_SIZE;
-    
-    glm::vec3 position = glm::vec3(0.f, 0.f, detail.s);
-    
-    detail.x = detail.s * floor(position.x / detail.s);
-    detail.y = detail.s * floor(position.y / detail.s);
-    detail.z = detail.s * floor(position.z / detail.s);
-    
-    ::intensity += ::intensityIncrement;
-    if (::intensity >= MAX_INTENSITY) {
-        ::intensity = MAX_INTENSITY;
-        ::intensityIncrement = -::intensityIncrement;
-    }
-    if (::intensity <= MIN_INTENSITY) {
-        ::intensity = MIN_INTENSITY;
-        ::intensityIncrement = -::intensityIncrement;
-    }
-    
-    detail.red   = 255 * ::intensity;
-    detail.green = 0   * ::intensity;
-    detail.blue  = 0   * ::intensity;
-    
-    PacketType message = PacketTypeVoxelSetDestructive;
-    
-    ::voxelEditPacketSender->sendVoxelEditMessage(message, detail);
+static void addBlinkingVoxel() {
+    VoxelAnimation beacon;
+    beacon.voxelSize = BEACON_SIZE;
+    beacon.colorPeriodMsecs = BEACON_BLINK_MSECS;
+    beacon.parts.append(makePart(0, 0, 1, BEACON_DIM_COLOR, BEACON_BRIGHT_COLOR));
+    animations.insert(BLINKING_VOXEL_ANIMATION_ID, beacon);
 }
 
-bool stringOfLightsInitialized = false;
-int currentLight = 0;
-int lightMovementDirection = 1;
 const int SEGMENT_COUNT = 4;
 const int LIGHTS_PER_SEGMENT = 80;
 const int LIGHT_COUNT = LIGHTS_PER_SEGMENT * SEGMENT_COUNT;
-glm::vec3 stringOfLights[LIGHT_COUNT];
 unsigned char offColor[3] = { 240, 240, 240 };
 unsigned char onColor[3]  = {   0, 255, 255 };
 const float STRING_OF_LIGHTS_SIZE = 0.125f / TREE_SCALE; // approximately 1/8th meter
-
-static void sendBlinkingStringOfLights() {
-    PacketType message = PacketTypeVoxelSetDestructive; // we're a bully!
-    float lightScale = STRING_OF_LIGHTS_SIZE;
-    static VoxelDetail details[LIGHTS_PER_SEGMENT];
-    
-    // first initialized the string of lights if needed...
-    if (!stringOfLightsInitialized) {
-        for (int segment = 0; segment < SEGMENT_COUNT; segment++) {
-            for (int indexInSegment = 0; indexInSegment < LIGHTS_PER_SEGMENT; indexInSegment++) {
-                
-                int i = (segment * LIGHTS_PER_SEGMENT) + indexInSegment;
-                
-                // four different segments on sides of initial platform
-                switch (segment) {
-                    case 0:
-                        // along x axis
-                        stringOfLights[i] = glm::vec3(indexInSegment * lightScale, 0, 0);
-                        break;
-                    case 1:
-                        // parallel to Z axis at outer X edge
-                        stringOfLights[i] = glm::vec3(LIGHTS_PER_SEGMENT * lightScale, 0, indexInSegment * lightScale);
-                        break;
-                    case 2:
-                        // parallel to X axis at outer Z edge
-                        stringOfLights[i] = glm::vec3((LIGHTS_PER_SEGMENT-indexInSegment) * lightScale, 0,
-                                                      LIGHTS_PER_SEGMENT * lightScale);
-                        break;
-                    case 3:
-                        // on Z axis
-                        stringOfLights[i] = glm::vec3(0, 0, (LIGHTS_PER_SEGMENT-indexInSegment) * lightScale);
-                        break;
-                }
-                
-                details[indexInSegment].s = STRING_OF_LIGHTS_SIZE;
-                details[indexInSegment].x = stringOfLights[i].x;
-                details[indexInSegment].y = stringOfLights[i].y;
-                details[indexInSegment].z = stringOfLights[i].z;
-                
-                details[indexInSegment].red   = offColor[0];
-                details[indexInSegment].green = offColor[1];
-                details[indexInSegment].blue  = offColor[2];
-            }
+const quint32 STRING_OF_LIGHTS_MSECS = (LIGHT_COUNT - 1) * 2 * 1000 / 60; // a light a frame, there and back
+
+static void addBlinkingStringOfLights() {
+    VoxelAnimation lights;
+    lights.voxelSize = STRING_OF_LIGHTS_SIZE;
+    lights.colorPeriodMsecs = STRING_OF_LIGHTS_MSECS;
+    lights.chase = true;
+    for (int segment = 0; segment < SEGMENT_COUNT; segment++) {
+        for (int indexInSegment = 0; indexInSegment < LIGHTS_PER_SEGMENT; indexInSegment++) {
+            int i = (segment * LIGHTS_PER_SEGMENT) + indexInSegment;
+            float phase = (float)i / (LIGHT_COUNT - 1);
             
-            ::voxelEditPacketSender->queueVoxelEditMessages(message, LIGHTS_PER_SEGMENT, (VoxelDetail*)&details);
-        }
-        stringOfLightsInitialized = true;
-    } else {
-        // turn off current light
-        details[0].x = stringOfLights[currentLight].x;
-        details[0].y = stringOfLights[currentLight].y;
-        details[0].z = stringOfLights[currentLight].z;
-        details[0].red   = offColor[0];
-        details[0].green = offColor[1];
-        details[0].blue  = offColor[2];
-        
-        // move current light...
-        // if we're at the end of our string, then change direction
-        if (currentLight == LIGHT_COUNT-1) {
-            lightMovementDirection = -1;
-        }
-        if (currentLight == 0) {
-            lightMovementDirection = 1;
+            // four different segments on sides of initial platform
+            switch (segment) {
+                case 0:
+                    // along x axis
+                    lights.parts.append(makePart(indexInSegment, 0, 0, offColor, onColor, phase));
+                    break;
+                case 1:
+                    // parallel to Z axis at outer X edge
+                    lights.parts.append(makePart(LIGHTS_PER_SEGMENT, 0, indexInSegment, offColor, onColor, phase));
+                    break;
+                case 2:
+                    // parallel to X axis at outer Z edge
+                    lights.parts.append(makePart(LIGHTS_PER_SEGMENT - indexInSegment, 0, LIGHTS_PER_SEGMENT,
+                        offColor, onColor, phase));
+                    break;
+                case 3:
+                    // on Z axis
+                    lights.parts.append(makePart(0, 0, LIGHTS_PER_SEGMENT - indexInSegment, offColor, onColor, phase));
+                    break;
+            }
         }
-        currentLight += lightMovementDirection;
-        
-        // turn on new current light
-        details[1].x = stringOfLights[currentLight].x;
-        details[1].y = stringOfLights[currentLight].y;
-        details[1].z = stringOfLights[currentLight].z;
-        details[1].red   = onColor[0];
-        details[1].green = onColor[1];
-        details[1].blue  = onColor[2];
-        
-        // send both changes in same message
-        ::voxelEditPacketSender->queueVoxelEditMessages(message, 2, (VoxelDetail*)&details);
     }
+    animations.insert(BORDER_TRACER_ANIMATION_ID, lights);
 }
 
-bool danceFloorInitialized = false;
 const float DANCE_FLOOR_LIGHT_SIZE = 1.0f / TREE_SCALE; // approximately 1 meter
 const int DANCE_FLOOR_LENGTH = 10;
 const int DANCE_FLOOR_WIDTH  = 10;
 glm::vec3 danceFloorPosition(100.0f / TREE_SCALE, 30.0f / TREE_SCALE, 10.0f / TREE_SCALE);
-glm::vec3 danceFloorLights[DANCE_FLOOR_LENGTH][DANCE_FLOOR_WIDTH];
-unsigned char danceFloorOffColor[3] = { 240, 240, 240 };
 const int DANCE_FLOOR_COLORS = 6;
 
 unsigned char danceFloorOnColorA[DANCE_FLOOR_COLORS][3] = {
@@ -359,116 +222,39 @@ unsigned char danceFloorOnColorB[DANCE_FLOOR_COLORS][3] = {
     {   0,   0,   0 }, {    0,   0,   0 }, {    0,   0,   0 }  ,
     {   0,   0,   0 }, {    0,   0,   0 }, {    0,   0,   0 }
 };
-float danceFloorGradient = 0.5f;
 const float BEATS_PER_MINUTE = 118.0f;
 const float SECONDS_PER_MINUTE = 60.0f;
-const float FRAMES_PER_BEAT = (SECONDS_PER_MINUTE * ANIMATE_FPS) / BEATS_PER_MINUTE;
-float danceFloorGradientIncrement = 1.0f / FRAMES_PER_BEAT;
-const float DANCE_FLOOR_MAX_GRADIENT = 1.0f;
-const float DANCE_FLOOR_MIN_GRADIENT = 0.0f;
-const int DANCE_FLOOR_VOXELS_PER_PACKET = 100;
-int danceFloorColors[DANCE_FLOOR_WIDTH][DANCE_FLOOR_LENGTH];
-
-void sendDanceFloor() {
-    PacketType message = PacketTypeVoxelSetDestructive; // we're a bully!
-    float lightScale = DANCE_FLOOR_LIGHT_SIZE;
-    static VoxelDetail details[DANCE_FLOOR_VOXELS_PER_PACKET];
-    
-    // first initialized the billboard of lights if needed...
-    if (!::danceFloorInitialized) {
-        for (int i = 0; i < DANCE_FLOOR_WIDTH; i++) {
-            for (int j = 0; j < DANCE_FLOOR_LENGTH; j++) {
-                
-                int randomColorIndex = randIntInRange(-DANCE_FLOOR_COLORS, DANCE_FLOOR_COLORS);
-                ::danceFloorColors[i][j] = randomColorIndex;
-                ::danceFloorLights[i][j] = ::danceFloorPosition +
-                glm::vec3(i * DANCE_FLOOR_LIGHT_SIZE, 0, j * DANCE_FLOOR_LIGHT_SIZE);
-            }
-        }
-        ::danceFloorInitialized = true;
-    }
-    
-    ::danceFloorGradient += ::danceFloorGradientIncrement;
-    
-    if (::danceFloorGradient >= DANCE_FLOOR_MAX_GRADIENT) {
-        ::danceFloorGradient = DANCE_FLOOR_MAX_GRADIENT;
-        ::danceFloorGradientIncrement = -::danceFloorGradientIncrement;
-    }
-    if (::danceFloorGradient <= DANCE_FLOOR_MIN_GRADIENT) {
-        ::danceFloorGradient = DANCE_FLOOR_MIN_GRADIENT;
-        ::danceFloorGradientIncrement = -::danceFloorGradientIncrement;
-    }
-    
-    for (int i = 0; i < DANCE_FLOOR_LENGTH; i++) {
-        for (int j = 0; j < DANCE_FLOOR_WIDTH; j++) {
-            
-            int nthVoxel = ((i * DANCE_FLOOR_WIDTH) + j);
-            int item = nthVoxel % DANCE_FLOOR_VOXELS_PER_PACKET;
-            
-            ::danceFloorLights[i][j] = ::danceFloorPosition +
-            glm::vec3(i * DANCE_FLOOR_LIGHT_SIZE, 0, j * DANCE_FLOOR_LIGHT_SIZE);
-            
-            details[item].s = lightScale;
-            details[item].x = ::danceFloorLights[i][j].x;
-            details[item].y = ::danceFloorLights[i][j].y;
-            details[item].z = ::danceFloorLights[i][j].z;
-            
-            if (danceFloorColors[i][j] > 0) {
-                int color = danceFloorColors[i][j] - 1;
-                details[item].red   = (::danceFloorOnColorA[color][0] +
-                                       ((::danceFloorOnColorB[color][0] - ::danceFloorOnColorA[color][0])
-                                        * ::danceFloorGradient));
-                details[item].green = (::danceFloorOnColorA[color][1] +
-                                       ((::danceFloorOnColorB[color][1] - ::danceFloorOnColorA[color][1])
-                                        * ::danceFloorGradient));
-                details[item].blue  = (::danceFloorOnColorA[color][2] +
-                                       ((::danceFloorOnColorB[color][2] - ::danceFloorOnColorA[color][2])
-                                        * ::danceFloorGradient));
-            } else if (::danceFloorColors[i][j] < 0) {
-                int color = -(::danceFloorColors[i][j] + 1);
-                details[item].red   = (::danceFloorOnColorB[color][0] +
-                                       ((::danceFloorOnColorA[color][0] - ::danceFloorOnColorB[color][0])
-                                        * ::danceFloorGradient));
-                details[item].green = (::danceFloorOnColorB[color][1] +
-                                       ((::danceFloorOnColorA[color][1] - ::danceFloorOnColorB[color][1])
-                                        * ::danceFloorGradient));
-                details[item].blue  = (::danceFloorOnColorB[color][2] +
-                                       ((::danceFloorOnColorA[color][2] - ::danceFloorOnColorB[color][2])
-                                        * ::danceFloorGradient));
+const quint32 DANCE_FLOOR_MSECS = 2 * SECONDS_PER_MINUTE * 1000 / BEATS_PER_MINUTE; // one way a beat, back the next
+
+static void addDanceFloor() {
+    VoxelAnimation floor;
+    floor.voxelSize = DANCE_FLOOR_LIGHT_SIZE;
+    floor.origin = danceFloorPosition;
+    floor.colorPeriodMsecs = DANCE_FLOOR_MSECS;
+    for (int i = 0; i < DANCE_FLOOR_WIDTH; i++) {
+        for (int j = 0; j < DANCE_FLOOR_LENGTH; j++) {
+            // half the lights go from their color to black while the other half go back from black, half a period on
+            int randomColorIndex = randIntInRange(-DANCE_FLOOR_COLORS, DANCE_FLOOR_COLORS);
+            if (randomColorIndex > 0) {
+                int color = randomColorIndex - 1;
+                floor.parts.append(makePart(i, 0, j, danceFloorOnColorA[color], danceFloorOnColorB[color]));
             } else {
-                int color = 0;
-                details[item].red   = (::danceFloorOnColorB[color][0] +
-                                       ((::danceFloorOnColorA[color][0] - ::danceFloorOnColorB[color][0])
-                                        * ::danceFloorGradient));
-                details[item].green = (::danceFloorOnColorB[color][1] +
-                                       ((::danceFloorOnColorA[color][1] - ::danceFloorOnColorB[color][1])
-                                        * ::danceFloorGradient));
-                details[item].blue  = (::danceFloorOnColorB[color][2] +
-                                       ((::danceFloorOnColorA[color][2] - ::danceFloorOnColorB[color][2])
-                                        * ::danceFloorGradient));
-            }
-            
-            if (item == DANCE_FLOOR_VOXELS_PER_PACKET - 1) {
-                ::voxelEditPacketSender->queueVoxelEditMessages(message, DANCE_FLOOR_VOXELS_PER_PACKET, (VoxelDetail*)&details);
+                int color = (randomColorIndex < 0) ? -(randomColorIndex + 1) : 0;
+                floor.parts.append(makePart(i, 0, j, danceFloorOnColorA[color], danceFloorOnColorB[color], 0.5f));
             }
         }
     }
+    animations.insert(DANCE_FLOOR_ANIMATION_ID, floor);
 }
 
-bool billboardInitialized = false;
 const int BILLBOARD_HEIGHT = 9;
 const int BILLBOARD_WIDTH  = 45;
 glm::vec3 billboardPosition((0.125f / TREE_SCALE),(0.125f / TREE_SCALE),0);
-glm::vec3 billboardLights[BILLBOARD_HEIGHT][BILLBOARD_WIDTH];
 unsigned char billboardOffColor[3] = { 240, 240, 240 };
 unsigned char billboardOnColorA[3]  = {   0,   0, 255 };
 unsigned char billboardOnColorB[3]  = {   0, 255,   0 };
-float billboardGradient = 0.5f;
-float billboardGradientIncrement = 0.01f;
-const float BILLBOARD_MAX_GRADIENT = 1.0f;
-const float BILLBOARD_MIN_GRADIENT = 0.0f;
 const float BILLBOARD_LIGHT_SIZE   = 0.125f / TREE_SCALE; // approximately 1/8 meter per light
-const int VOXELS_PER_PACKET = 81;
+const quint32 BILLBOARD_MSECS = 2 * 100 * 1000 / 60; // a hundredth of the way a frame, there and back
 
 // top to bottom...
 bool billboardMessage[BILLBOARD_HEIGHT][BILLBOARD_WIDTH] = {
@@ -483,61 +269,22 @@ bool billboardMessage[BILLBOARD_HEIGHT][BILLBOARD_WIDTH] = {
     { 0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0 }
 };
 
-static void sendBillboard() {
-    PacketType message = PacketTypeVoxelSetDestructive; // we're a bully!
-    float lightScale = BILLBOARD_LIGHT_SIZE;
-    static VoxelDetail details[VOXELS_PER_PACKET];
-    
-    // first initialized the billboard of lights if needed...
-    if (!billboardInitialized) {
-        for (int i = 0; i < BILLBOARD_HEIGHT; i++) {
-            for (int j = 0; j < BILLBOARD_WIDTH; j++) {
-                
-                billboardLights[i][j] = billboardPosition + glm::vec3(j * lightScale, (float)((BILLBOARD_HEIGHT - i) * lightScale), 0);
-            }
-        }
-        billboardInitialized = true;
-    }
-    
-    ::billboardGradient += ::billboardGradientIncrement;
-    
-    if (::billboardGradient >= BILLBOARD_MAX_GRADIENT) {
-        ::billboardGradient = BILLBOARD_MAX_GRADIENT;
-        ::billboardGradientIncrement = -::billboardGradientIncrement;
-    }
-    if (::billboardGradient <= BILLBOARD_MIN_GRADIENT) {
-        ::billboardGradient = BILLBOARD_MIN_GRADIENT;
-        ::billboardGradientIncrement = -::billboardGradientIncrement;
-    }
-    
+static void addBillboard() {
+    VoxelAnimation billboard;
+    billboard.voxelSize = BILLBOARD_LIGHT_SIZE;
+    billboard.origin = billboardPosition;
+    billboard.colorPeriodMsecs = BILLBOARD_MSECS;
     for (int i = 0; i < BILLBOARD_HEIGHT; i++) {
         for (int j = 0; j < BILLBOARD_WIDTH; j++) {
-            
-            int nthVoxel = ((i * BILLBOARD_WIDTH) + j);
-            int item = nthVoxel % VOXELS_PER_PACKET;
-            
-            billboardLights[i][j] = billboardPosition + glm::vec3(j * lightScale, (float)((BILLBOARD_HEIGHT - i) * lightScale), 0);
-            
-            details[item].s = lightScale;
-            details[item].x = billboardLights[i][j].x;
-            details[item].y = billboardLights[i][j].y;
-            details[item].z = billboardLights[i][j].z;
-            
+            // the lit lights start halfway between their colors
             if (billboardMessage[i][j]) {
-                details[item].red   = (billboardOnColorA[0] + ((billboardOnColorB[0] - billboardOnColorA[0]) * ::billboardGradient));
-                details[item].green = (billboardOnColorA[1] + ((billboardOnColorB[1] - billboardOnColorA[1]) * ::billboardGradient));
-                details[item].blue  = (billboardOnColorA[2] + ((billboardOnColorB[2] - billboardOnColorA[2]) * ::billboardGradient));
+                billboard.parts.append(makePart(j, BILLBOARD_HEIGHT - i, 0, billboardOnColorA, billboardOnColorB, 0.25f));
             } else {
-                details[item].red   = billboardOffColor[0];
-                details[item].green = billboardOffColor[1];
-                details[item].blue  = billboardOffColor[2];
-            }
-            
-            if (item == VOXELS_PER_PACKET - 1) {
-                ::voxelEditPacketSender->queueVoxelEditMessages(message, VOXELS_PER_PACKET, (VoxelDetail*)&details);
+                billboard.parts.append(makePart(j, BILLBOARD_HEIGHT - i, 0, billboardOffColor, billboardOffColor));
             }
         }
     }
+    animations.insert(BILLBOARD_ANIMATION_ID, billboard);
 }
 
 bool roadInitialized = false;
@@ -585,14 +332,25 @@ void doBuildStreet() {
 
 double start = 0;
 
+/// queues the animations, returns false if a voxel server with the whole of one of them isn't known yet
+static bool sendAnimations() {
+    bool allSent = true;
+    for (QHash<QUuid, VoxelAnimation>::const_iterator it = animations.constBegin(); it != animations.constEnd(); it++) {
+        if (!::voxelEditPacketSender->queueVoxelAnimationMessages(it.key(), it.value())) {
+            allSent = false;
+        }
+    }
+    if (::buildStreet) {
+        doBuildStreet();
+    }
+    ::voxelEditPacketSender->releaseQueuedMessages();
+    return allSent;
+}
 
 void* animateVoxels(void* args) {
     
-    quint64 lastAnimateTime = 0;
-    quint64 lastProcessTime = 0;
-    int processesPerAnimate = 0;
-    
-    bool firstTime = true;
+    quint64 lastSendTime = 0;
+    quint64 sendInterval = 0;
     
     qDebug() << "Setting PPS to " << ::packetsPerSecond;
     ::voxelEditPacketSender->setPacketsPerSecond(::packetsPerSecond);
@@ -600,72 +358,21 @@ void* animateVoxels(void* args) {
     qDebug() << "PPS set to " << ::voxelEditPacketSender->getPacketsPerSecond();
     
     while (true) {
+        quint64 lastProcessTime = usecTimestampNow();
         
-        // If we're asked to wait for voxel servers, and there isn't one available yet, then
-        // let the voxelEditPacketSender process and move on.
-        if (::waitForVoxelServer && !::voxelEditPacketSender->voxelServersExist()) {
-            if (::nonThreadedPacketSender) {
-                ::voxelEditPacketSender->process();
-            }
-        } else {
-            if (firstTime) {
-                lastAnimateTime = usecTimestampNow();
-                firstTime = false;
-            }
-            lastProcessTime = usecTimestampNow();
-            
-            // The while loop will be running at PROCESSING_FPS, but we only want to call these animation functions at
-            // ANIMATE_FPS. So we check out last animate time and only call these if we've elapsed that time.
-            quint64 now = usecTimestampNow();
-            quint64 animationElapsed = now - lastAnimateTime;
-            int withinAnimationTarget = ANIMATE_VOXELS_INTERVAL_USECS - animationElapsed;
-            const int CLOSE_ENOUGH_TO_ANIMATE = 2000; // approximately 2 ms
-            
-            int animateLoopsPerAnimate = 0;
-            while (withinAnimationTarget < CLOSE_ENOUGH_TO_ANIMATE) {
-                processesPerAnimate = 0;
-                animateLoopsPerAnimate++;
-                
-                lastAnimateTime = now;
-                // some animations
-                //sendVoxelBlinkMessage();
-                
-                if (::includeBillboard) {
-                    sendBillboard();
-                }
-                if (::includeBorderTracer) {
-                    sendBlinkingStringOfLights();
-                }
-                if (::includeMovingBug) {
-                    renderMovingBug();
-                }
-                if (::includeBlinkingVoxel) {
-                    sendVoxelBlinkMessage();
-                }
-                if (::includeDanceFloor) {
-                    sendDanceFloor();
-                }
-                
-                if (::buildStreet) {
-                    doBuildStreet();
-                }
-                
-                if (animationElapsed > ANIMATE_VOXELS_INTERVAL_USECS) {
-                    animationElapsed -= ANIMATE_VOXELS_INTERVAL_USECS; // credit ourselves one animation frame
-                } else {
-                    animationElapsed = 0;
-                }
-                withinAnimationTarget = ANIMATE_VOXELS_INTERVAL_USECS - animationElapsed;
-                
-                ::voxelEditPacketSender->releaseQueuedMessages();
-            }
-            
-            if (::nonThreadedPacketSender) {
-                ::voxelEditPacketSender->process();
-            }
-            processesPerAnimate++;
+        // the animations are sent when there's a voxel server to animate them, and then again now and then, sooner
+        // if there were some no server's jurisdiction was known to hold
+        if (::voxelEditPacketSender->voxelServersExist() &&
+                (lastSendTime == 0 || lastProcessTime - lastSendTime > sendInterval)) {
+            sendInterval = sendAnimations() ? ANIMATION_RESEND_INTERVAL_USECS : ANIMATION_RETRY_INTERVAL_USECS;
+            lastSendTime = lastProcessTime;
+        }
+        
+        if (::nonThreadedPacketSender) {
+            ::voxelEditPacketSender->process();
         }
-        // dynamically sleep until we need to fire off the next set of voxels
+        
+        // dynamically sleep until we need to process again
         quint64 usecToSleep =  ::PROCESSING_INTERVAL_USECS - (usecTimestampNow() - lastProcessTime);
         if (usecToSleep > ::PROCESSING_INTERVAL_USECS) {
             usecToSleep = ::PROCESSING_INTERVAL_USECS;
@@ -740,22 +447,6 @@ AnimationServer::AnimationServer(int &argc, char **argv) :
     }
     qDebug("packetsPerSecond=%d",packetsPerSecond);
     
-    const char* animateFPSCommand = getCmdOption(argc, (const char**) argv, "--AnimateFPS");
-    const char* animateIntervalCommand = getCmdOption(argc, (const char**) argv, "--AnimateInterval");
-    if (animateFPSCommand || animateIntervalCommand) {
-        if (animateIntervalCommand) {
-            ::ANIMATE_FPS_IN_MILLISECONDS = atoi(animateIntervalCommand);
-            ::ANIMATE_VOXELS_INTERVAL_USECS = (ANIMATE_FPS_IN_MILLISECONDS * 1000.0); // converts from milliseconds to usecs
-            ::ANIMATE_FPS = PacketSender::USECS_PER_SECOND / ::ANIMATE_VOXELS_INTERVAL_USECS;
-        } else {
-            ::ANIMATE_FPS = atoi(animateFPSCommand);
-            ::ANIMATE_FPS_IN_MILLISECONDS = 1000.0/ANIMATE_FPS; // determines FPS from our desired FPS
-            ::ANIMATE_VOXELS_INTERVAL_USECS = (ANIMATE_FPS_IN_MILLISECONDS * 1000.0); // converts from milliseconds to usecs
-        }
-    }
-    qDebug("ANIMATE_FPS=%d",ANIMATE_FPS);
-    qDebug("ANIMATE_VOXELS_INTERVAL_USECS=%llu",ANIMATE_VOXELS_INTERVAL_USECS);
-    
     const char* processingFPSCommand = getCmdOption(argc, (const char**) argv, "--ProcessingFPS");
     const char* processingIntervalCommand = getCmdOption(argc, (const char**) argv, "--ProcessingInterval");
     if (processingFPSCommand || processingIntervalCommand) {
@@ -793,6 +484,21 @@ AnimationServer::AnimationServer(int &argc, char **argv) :
     
     srand((unsigned)time(0));
     
+    if (::includeBillboard) {
+        addBillboard();
+    }
+    if (::includeBorderTracer) {
+        addBlinkingStringOfLights();
+    }
+    if (::includeMovingBug) {
+        addMovingBug();
+    }
+    if (::includeBlinkingVoxel) {
+        addBlinkingVoxel();
+    }
+    if (::includeDanceFloor) {
+        addDanceFloor();
+    }
     
     pthread_create(&::animateVoxelThread, NULL, animateVoxels, NULL);
 
@@ -816,10 +522,7 @@ void AnimationServer::readPendingDatagrams() {
     static HifiSockAddr nodeSockAddr;
     
     // Nodes sending messages to us...
-    while (nodeList->getNodeSocket().hasPendingDatagrams()) {
-        receivedPacket.resize(nodeList->getNodeSocket().pendingDatagramSize());
-        nodeList->getNodeSocket().readDatagram(receivedPacket.data(), receivedPacket.size(),
-                                               nodeSockAddr.getAddressPointer(), nodeSockAddr.getPortPointer());
+    while (nodeList->readPendingDatagram(receivedPacket, nodeSockAddr)) {
         if (nodeList->packetVersionAndHashMatch(receivedPacket)) {
             if (packetTypeForPacket(receivedPacket) == PacketTypeJurisdiction) {
                 int headerBytes = numBytesForPacketHeader(receivedPacket);
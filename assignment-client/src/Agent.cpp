@@ -11,9 +11,9 @@
 
 #include <QtCore/QCoreApplication>
 #include <QtCore/QEventLoop>
-#include <QtCore/QStandardPaths>
+#include <QtCore/QRegExp>
+#include <QtCore/QThread>
 #include <QtCore/QTimer>
-#include <QtNetwork/QNetworkDiskCache>
 #include <QtNetwork/QNetworkRequest>
 #include <QtNetwork/QNetworkReply>
 
@@ -146,7 +146,7 @@ void Agent::readPendingDatagrams() {
                     _voxelViewer.processDatagram(mutablePacket, sourceNode);
                 }
 
-            } else if (datagramPacketType == PacketTypeMixedAudio) {
+            } else if (datagramPacketType == PacketTypeMixedAudio || datagramPacketType == PacketTypeSilentMixedAudio) {
 
                 QUuid senderUUID = uuidFromPacketHeader(receivedPacket);
 
@@ -169,6 +169,7 @@ void Agent::readPendingDatagrams() {
             } else if (datagramPacketType == PacketTypeBulkAvatarData
                        || datagramPacketType == PacketTypeAvatarIdentity
                        || datagramPacketType == PacketTypeAvatarBillboard
+                       || datagramPacketType == PacketTypeAvatarContentHashes
                        || datagramPacketType == PacketTypeKillAvatar) {
                 // let the avatar hash map process it
                 _avatarHashMap.processAvatarMixerDatagram(receivedPacket, nodeList->sendingNodeForPacket(receivedPacket));
@@ -197,24 +198,24 @@ void Agent::run() {
                                                  << NodeType::ModelServer
                                                 );
     
-    // figure out the URL for the script for this agent assignment
+    // figure out the URL for the script for this agent assignment, and those of any scripts to run alongside it
     QUrl scriptURL;
+    QStringList companionScriptURLs;
     if (_payload.isEmpty())  {
         scriptURL = QUrl(QString("http://%1:%2/assignment/%3")
             .arg(NodeList::getInstance()->getDomainHandler().getIP().toString())
             .arg(DOMAIN_SERVER_HTTP_PORT)
             .arg(uuidStringWithoutCurlyBraces(_uuid)));
     } else {
-        scriptURL = QUrl(_payload);
+        companionScriptURLs = QString(_payload).split(QRegExp("\\s+"), QString::SkipEmptyParts);
+        scriptURL = QUrl(companionScriptURLs.takeFirst());
     }
    
+    // the cache has to be there before the script is requested for the request to go through it
     NetworkAccessManager& networkAccessManager = NetworkAccessManager::getInstance();
-    QNetworkReply *reply = networkAccessManager.get(QNetworkRequest(scriptURL));
+    networkAccessManager.setupDiskCache("agentCache");
     
-    QNetworkDiskCache* cache = new QNetworkDiskCache();
-    QString cachePath = QStandardPaths::writableLocation(QStandardPaths::DataLocation);
-    cache->setCacheDirectory(!cachePath.isEmpty() ? cachePath : "agentCache");
-    networkAccessManager.setCache(cache);
+    QNetworkReply *reply = networkAccessManager.get(QNetworkRequest(scriptURL));
     
     qDebug() << "Downloading script at" << scriptURL.toString();
     
@@ -262,12 +263,49 @@ void Agent::run() {
     _modelViewer.init();
     _scriptEngine.getModelsScriptingInterface()->setModelTree(_modelViewer.getTree());
 
+    foreach (const QString& companionScriptURL, companionScriptURLs) {
+        startCompanionScript(QUrl(companionScriptURL));
+    }
+
     _scriptEngine.setScriptContents(scriptContents);
     _scriptEngine.run();
     setFinished(true);
 }
 
+void Agent::startCompanionScript(const QUrl& scriptURL) {
+    // the scripting interfaces of the voxels, particles and models are shared by all engines, so they already
+    // send through our packet senders and know our viewers' trees
+    ScriptEngine* scriptEngine = new ScriptEngine(scriptURL);
+    scriptEngine->setAvatarHashMap(&_avatarHashMap, "AvatarList");
+    scriptEngine->init();
+    scriptEngine->registerGlobalObject("VoxelViewer", &_voxelViewer);
+    scriptEngine->registerGlobalObject("ParticleViewer", &_particleViewer);
+    scriptEngine->registerGlobalObject("ModelViewer", &_modelViewer);
+    
+    QThread* workerThread = new QThread();
+    connect(workerThread, &QThread::started, scriptEngine, &ScriptEngine::run);
+    
+    NodeList* nodeList = NodeList::getInstance();
+    connect(nodeList, &NodeList::nodeKilled, scriptEngine, &ScriptEngine::nodeKilled);
+    
+    scriptEngine->moveToThread(workerThread);
+    workerThread->start();
+    
+    _companionScriptEngines.append(scriptEngine);
+}
+
 void Agent::aboutToFinish() {
     _scriptEngine.stop();
+    
+    // the companion scripts use our viewers, so they're done before we are
+    foreach (ScriptEngine* scriptEngine, _companionScriptEngines) {
+        QThread* workerThread = scriptEngine->thread();
+        scriptEngine->stop();
+        workerThread->wait();
+        delete scriptEngine;
+        delete workerThread;
+    }
+    _companionScriptEngines.clear();
+    
     NetworkAccessManager::getInstance().clearAccessCache();
 }
@@ -17,6 +17,7 @@
 #include <QtScript/QScriptEngine>
 #include <QtCore/QObject>
 #include <QtCore/QUrl>
+#include <QtCore/QVector>
 
 #include <AvatarHashMap.h>
 #include <MixedAudioRingBuffer.h>
@@ -32,6 +33,9 @@
 #include <VoxelTreeHeadlessViewer.h>
 
 
+/// Runs the script at the URL in its payload, or the one the domain server holds for it.  The payload may list further
+/// script URLs, separated by whitespace, which run alongside the first on threads of their own, sharing its node, its
+/// viewers and its packet senders; only the first script has the Agent and Avatar objects.
 class Agent : public ThreadedAssignment {
     Q_OBJECT
     
@@ -61,7 +65,11 @@ public slots:
     void playAvatarSound(Sound* avatarSound) { _scriptEngine.setAvatarSound(avatarSound); }
 
 private:
+    /// starts a script that runs alongside the first
+    void startCompanionScript(const QUrl& scriptURL);
+
     ScriptEngine _scriptEngine;
+    QVector<ScriptEngine*> _companionScriptEngines;
     VoxelEditPacketSender _voxelEditSender;
     ParticleEditPacketSender _particleEditSender;
     ModelEditPacketSender _modelEditSender;
@@ -0,0 +1,59 @@
+//
+//  AllocationCounter.cpp
+//  assignment-client/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#include <stdlib.h>
+
+#include "AllocationCounter.h"
+
+#ifdef __GLIBC__
+
+extern "C" {
+    void* __libc_malloc(size_t size);
+    void* __libc_calloc(size_t numElements, size_t size);
+    void* __libc_realloc(void* pointer, size_t size);
+}
+
+// thread local, so that counting costs no more than an increment and never contends
+static __thread quint64 threadAllocations = 0;
+
+extern "C" void* malloc(size_t size) {
+    ++threadAllocations;
+    return __libc_malloc(size);
+}
+
+extern "C" void* calloc(size_t numElements, size_t size) {
+    ++threadAllocations;
+    return __libc_calloc(numElements, size);
+}
+
+extern "C" void* realloc(void* pointer, size_t size) {
+    ++threadAllocations;
+    return __libc_realloc(pointer, size);
+}
+
+bool AllocationCounter::isAvailable() {
+    return true;
+}
+
+quint64 AllocationCounter::getThreadAllocations() {
+    return threadAllocations;
+}
+
+#else
+
+bool AllocationCounter::isAvailable() {
+    return false;
+}
+
+quint64 AllocationCounter::getThreadAllocations() {
+    return 0;
+}
+
+#endif
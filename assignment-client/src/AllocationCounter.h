@@ -0,0 +1,28 @@
+//
+//  AllocationCounter.h
+//  assignment-client/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#ifndef hifi_AllocationCounter_h
+#define hifi_AllocationCounter_h
+
+#include <QtCore/QtGlobal>
+
+/// Counts the heap allocations made by each thread of the assignment-client, so that the steady state of a hot path
+/// can be checked for allocations. The counting is done by standing in for malloc, calloc and realloc, which we can
+/// only do on top of glibc - anywhere else nothing is counted.
+namespace AllocationCounter {
+    
+    /// returns true if allocations are being counted on this platform
+    bool isAvailable();
+    
+    /// returns the number of allocations the calling thread has made so far
+    quint64 getThreadAllocations();
+}
+
+#endif // hifi_AllocationCounter_h
@@ -9,21 +9,27 @@
 //  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
 //
 
+#include <QtCore/QDataStream>
 #include <QtCore/QProcess>
 #include <QtCore/QThread>
 #include <QtCore/QTimer>
+#include <QtCore/QUrlQuery>
 
 #include <AccountManager.h>
 #include <Assignment.h>
 #include <HifiConfigVariantMap.h>
+#include <HTTPConnection.h>
 #include <Logging.h>
+#include <Metrics.h>
 #include <NodeList.h>
 #include <PacketHeaders.h>
 #include <SharedUtil.h>
 
 
+#include "AssignmentClientMonitor.h"
 #include "AssignmentFactory.h"
 #include "AssignmentThread.h"
+#include "SamplingProfiler.h"
 
 #include "AssignmentClient.h"
 
@@ -36,6 +42,8 @@ int hifiSockAddrMeta = qRegisterMetaType<HifiSockAddr>("HifiSockAddr");
 
 AssignmentClient::AssignmentClient(int &argc, char **argv) :
     QCoreApplication(argc, argv),
+    _monitorPort(0),
+    _profilingEnabled(false),
     _assignmentServerHostname(DEFAULT_ASSIGNMENT_SERVER_HOSTNAME)
 {
     setOrganizationName("High Fidelity");
@@ -52,6 +60,9 @@ AssignmentClient::AssignmentClient(int &argc, char **argv) :
     const QString ASSIGNMENT_POOL_OPTION = "pool";
     const QString ASSIGNMENT_WALLET_DESTINATION_ID_OPTION = "wallet";
     const QString CUSTOM_ASSIGNMENT_SERVER_HOSTNAME_OPTION = "a";
+    const QString METRICS_PORT_OPTION = "metrics-port";
+    const QString STATSD_SERVER_OPTION = "statsd";
+    const QString ENABLE_PROFILING_OPTION = "profiling";
 
     Assignment::Type requestAssignmentType = Assignment::AllTypes;
 
@@ -91,6 +102,24 @@ AssignmentClient::AssignmentClient(int &argc, char **argv) :
         nodeList->setAssignmentServerSocket(customAssignmentSocket);
     }
 
+    // serve the metrics for Prometheus to scrape, if asked to
+    if (argumentVariantMap.contains(METRICS_PORT_OPTION)) {
+        quint16 metricsPort = argumentVariantMap.value(METRICS_PORT_OPTION).toInt();
+        new HTTPManager(metricsPort, QString(), this, this);
+
+        // the stack sampler is opt in, since its signals cut short the sleeps of whichever threads they land on
+        _profilingEnabled = argumentVariantMap.contains(ENABLE_PROFILING_OPTION) && SamplingProfiler::isAvailable();
+    }
+
+    // send the metrics to a StatsD server along with the stats, if given one as host:port
+    if (argumentVariantMap.contains(STATSD_SERVER_OPTION)) {
+        QStringList hostAndPort = argumentVariantMap.value(STATSD_SERVER_OPTION).toString().split(':');
+        const quint16 DEFAULT_STATSD_PORT = 8125;
+        quint16 statsDPort = (hostAndPort.size() > 1) ? hostAndPort.at(1).toInt() : DEFAULT_STATSD_PORT;
+        HifiSockAddr statsDSocket(hostAndPort.at(0), statsDPort);
+        MetricsRegistry::getInstance().setStatsDServer(statsDSocket.getAddress(), statsDPort);
+    }
+
     // call a timer function every ASSIGNMENT_REQUEST_INTERVAL_MSECS to ask for assignment, if required
     qDebug() << "Waiting for assignment -" << _requestAssignment;
 
@@ -98,6 +127,13 @@ AssignmentClient::AssignmentClient(int &argc, char **argv) :
     connect(timer, SIGNAL(timeout()), SLOT(sendAssignmentRequest()));
     timer->start(ASSIGNMENT_REQUEST_INTERVAL_MSECS);
 
+    // if a monitor spawned us, tell it whether we're busy whenever that changes, and on the same timer in case it missed it
+    if (argumentVariantMap.contains(MONITOR_PORT_OPTION)) {
+        _monitorPort = argumentVariantMap.value(MONITOR_PORT_OPTION).toInt();
+        connect(timer, SIGNAL(timeout()), SLOT(sendStatusToMonitor()));
+        sendStatusToMonitor();
+    }
+
     // connect our readPendingDatagrams method to the readyRead() signal of the socket
     connect(&nodeList->getNodeSocket(), &QUdpSocket::readyRead, this, &AssignmentClient::readPendingDatagrams);
 
@@ -114,17 +150,23 @@ void AssignmentClient::sendAssignmentRequest() {
     }
 }
 
+void AssignmentClient::sendStatusToMonitor() {
+    if (_monitorPort == 0) {
+        return;
+    }
+    QByteArray status;
+    QDataStream out(&status, QIODevice::WriteOnly);
+    out << (qint64)applicationPid() << !_currentAssignment.isNull();
+    _monitorSocket.writeDatagram(status, QHostAddress::LocalHost, _monitorPort);
+}
+
 void AssignmentClient::readPendingDatagrams() {
     NodeList* nodeList = NodeList::getInstance();
 
     QByteArray receivedPacket;
     HifiSockAddr senderSockAddr;
 
-    while (nodeList->getNodeSocket().hasPendingDatagrams()) {
-        receivedPacket.resize(nodeList->getNodeSocket().pendingDatagramSize());
-        nodeList->getNodeSocket().readDatagram(receivedPacket.data(), receivedPacket.size(),
-                                               senderSockAddr.getAddressPointer(), senderSockAddr.getPortPointer());
-
+    while (nodeList->readPendingDatagram(receivedPacket, senderSockAddr)) {
         if (nodeList->packetVersionAndHashMatch(receivedPacket)) {
             if (packetTypeForPacket(receivedPacket) == PacketTypeCreateAssignment) {
                 // construct the deployed assignment from the packet data
@@ -161,6 +203,9 @@ void AssignmentClient::readPendingDatagrams() {
 
                     // Starts an event loop, and emits workerThread->started()
                     workerThread->start();
+
+                    // we're no longer a spare
+                    sendStatusToMonitor();
                 } else {
                     qDebug() << "Received an assignment that could not be unpacked. Re-requesting.";
                 }
@@ -216,4 +261,49 @@ void AssignmentClient::assignmentCompleted() {
     nodeList->setOwnerType(NodeType::Unassigned);
     nodeList->reset();
     nodeList->resetNodeInterestSet();
+    
+    sendStatusToMonitor();
+}
+
+bool AssignmentClient::handleHTTPRequest(HTTPConnection* connection, const QUrl& url) {
+    if (connection->requestOperation() == QNetworkAccessManager::GetOperation && url.path() == "/metrics") {
+        connection->respond(HTTPConnection::StatusCode200, MetricsRegistry::getInstance().getPrometheusText(),
+                            "text/plain; version=0.0.4");
+        return true;
+    }
+    if (connection->requestOperation() == QNetworkAccessManager::GetOperation && url.path() == "/profile") {
+        if (!_profilingEnabled) {
+            connection->respond(HTTPConnection::StatusCode404, "Profiling isn't enabled.");
+            return true;
+        }
+        const int DEFAULT_PROFILE_SECONDS = 10;
+        const int MAX_PROFILE_SECONDS = 60;
+        const int DEFAULT_SAMPLES_PER_SECOND = 100;
+        const int MAX_SAMPLES_PER_SECOND = 1000;
+        QUrlQuery query(url);
+        int seconds = query.hasQueryItem("seconds") ? query.queryItemValue("seconds").toInt() : DEFAULT_PROFILE_SECONDS;
+        int rate = query.hasQueryItem("rate") ? query.queryItemValue("rate").toInt() : DEFAULT_SAMPLES_PER_SECOND;
+        seconds = qBound(1, seconds, MAX_PROFILE_SECONDS);
+        rate = qBound(1, rate, MAX_SAMPLES_PER_SECOND);
+
+        // the timer counts the CPU time of every thread, so there may be a sample per core per interval
+        int maxSamples = seconds * rate * qMax(QThread::idealThreadCount(), 1);
+        if (!SamplingProfiler::start(rate, maxSamples)) {
+            connection->respond("503 Service Unavailable", "Already profiling.");
+            return true;
+        }
+        _profilingConnection = connection;
+        QTimer::singleShot(seconds * MSECS_PER_SECOND, this, SLOT(finishProfiling()));
+        return true;
+    }
+    // there are no files to serve, and the manager would look for them from the root
+    connection->respond(HTTPConnection::StatusCode404);
+    return true;
+}
+
+void AssignmentClient::finishProfiling() {
+    QByteArray foldedStacks = SamplingProfiler::stop();
+    if (_profilingConnection) {
+        _profilingConnection->respond(HTTPConnection::StatusCode200, foldedStacks, "text/plain");
+    }
 }
@@ -13,22 +13,36 @@
 #define hifi_AssignmentClient_h
 
 #include <QtCore/QCoreApplication>
+#include <QtCore/QPointer>
+#include <QtNetwork/QUdpSocket>
+
+#include <HTTPManager.h>
 
 #include "ThreadedAssignment.h"
 
-class AssignmentClient : public QCoreApplication {
+class AssignmentClient : public QCoreApplication, public HTTPRequestHandler {
     Q_OBJECT
 public:
     AssignmentClient(int &argc, char **argv);
     static const SharedAssignmentPointer& getCurrentAssignment() { return _currentAssignment; }
+    
+    /// serves the metrics of whichever assignment we're running for Prometheus, at /metrics, and if profiling was
+    /// enabled, the folded stacks sampled over a number of seconds at /profile?seconds=10&rate=100
+    bool handleHTTPRequest(HTTPConnection* connection, const QUrl& url);
 private slots:
     void sendAssignmentRequest();
     void readPendingDatagrams();
     void assignmentCompleted();
     void handleAuthenticationRequest();
+    void sendStatusToMonitor();
+    void finishProfiling();
 
 private:
     Assignment _requestAssignment;
+    quint16 _monitorPort; /// the port on which the monitor that spawned us listens for our status, or zero if none did
+    QUdpSocket _monitorSocket;
+    bool _profilingEnabled;
+    QPointer<HTTPConnection> _profilingConnection; /// waiting for the stacks being sampled
     static SharedAssignmentPointer _currentAssignment;
     QString _assignmentServerHostname;
 };
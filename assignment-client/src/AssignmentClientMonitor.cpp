@@ -9,16 +9,32 @@
 //  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
 //
 
+#ifdef Q_OS_LINUX
+#include <sched.h>
+#endif
+
+#include <QtCore/QDataStream>
+#include <QtCore/QThread>
+
 #include <Logging.h>
 
 #include "AssignmentClientMonitor.h"
 
 const char* NUM_FORKS_PARAMETER = "-n";
+const char* NUM_SPARES_PARAMETER = "--spares";
+const char* PIN_TO_CORES_PARAMETER = "--pin";
+
+const QString MONITOR_PORT_OPTION = "monitor-port";
 
 const QString ASSIGNMENT_CLIENT_MONITOR_TARGET_NAME = "assignment-client-monitor";
 
-AssignmentClientMonitor::AssignmentClientMonitor(int &argc, char **argv, int numAssignmentClientForks) :
-    QCoreApplication(argc, argv)
+AssignmentClientMonitor::AssignmentClientMonitor(int &argc, char **argv, int numAssignmentClientForks, int numSpares,
+                                                 bool pinToCores) :
+    QCoreApplication(argc, argv),
+    _numForks(numAssignmentClientForks),
+    _numSpares(numSpares),
+    _pinToCores(pinToCores),
+    _nextCore(0)
 {
     // start the Logging class with the parent's target name
     Logging::setTargetName(ASSIGNMENT_CLIENT_MONITOR_TARGET_NAME);
@@ -32,10 +48,24 @@ AssignmentClientMonitor::AssignmentClientMonitor(int &argc, char **argv, int num
     _childArguments.removeAt(forksParameterIndex);
     _childArguments.removeAt(forksParameterIndex);
     
+    // likewise the spares and the pinning, which are only for us
+    int sparesParameterIndex = _childArguments.indexOf(NUM_SPARES_PARAMETER);
+    if (sparesParameterIndex != -1) {
+        _childArguments.removeAt(sparesParameterIndex);
+        _childArguments.removeAt(sparesParameterIndex);
+    }
+    _childArguments.removeAll(PIN_TO_CORES_PARAMETER);
+    
+    // the children tell us on this socket when they take on or finish an assignment
+    _statusSocket.bind(QHostAddress::LocalHost, 0);
+    connect(&_statusSocket, SIGNAL(readyRead()), SLOT(readStatusDatagrams()));
+    _childArguments << "--" + MONITOR_PORT_OPTION << QString::number(_statusSocket.localPort());
+    
     // use QProcess to fork off a process for each of the child assignment clients
     for (int i = 0; i < numAssignmentClientForks; i++) {
         spawnChildClient();
     }
+    spawnSpares();
 }
 
 void AssignmentClientMonitor::spawnChildClient() {
@@ -50,10 +80,64 @@ void AssignmentClientMonitor::spawnChildClient() {
     connect(assignmentClient, SIGNAL(finished(int, QProcess::ExitStatus)), this,
             SLOT(childProcessFinished(int, QProcess::ExitStatus)));
     
+    assignmentClient->waitForStarted();
+    _childPIDs.insert(assignmentClient, assignmentClient->pid());
+    
+#ifdef Q_OS_LINUX
+    if (_pinToCores) {
+        // keep each child on its own core, so that the mixers don't contend for caches or get moved around
+        cpu_set_t cores;
+        CPU_ZERO(&cores);
+        CPU_SET(_nextCore, &cores);
+        if (sched_setaffinity(assignmentClient->pid(), sizeof(cores), &cores) == 0) {
+            qDebug() << "Pinned child client with PID" << assignmentClient->pid() << "to core" << _nextCore;
+        }
+        _nextCore = (_nextCore + 1) % QThread::idealThreadCount();
+    }
+#endif
+    
     qDebug() << "Spawned a child client with PID" << assignmentClient->pid();
 }
 
+void AssignmentClientMonitor::spawnSpares() {
+    // the children that haven't yet reported are starting up, and will be waiting for assignments once they have
+    int idleChildren = _childPIDs.size() - _busyChildren.size();
+    for (int i = idleChildren; i < _numSpares; i++) {
+        qDebug("Spawning a spare child assignment client");
+        spawnChildClient();
+    }
+}
+
 void AssignmentClientMonitor::childProcessFinished(int exitCode, QProcess::ExitStatus exitStatus) {
-    qDebug("Replacing dead child assignment client with a new one");
-    spawnChildClient();
+    QProcess* assignmentClient = static_cast<QProcess*>(sender());
+    _busyChildren.remove(_childPIDs.take(assignmentClient));
+    assignmentClient->deleteLater();
+    
+    if (_childPIDs.size() < _numForks) {
+        qDebug("Replacing dead child assignment client with a new one");
+        spawnChildClient();
+    }
+    spawnSpares();
+}
+
+void AssignmentClientMonitor::readStatusDatagrams() {
+    while (_statusSocket.hasPendingDatagrams()) {
+        QByteArray datagram(_statusSocket.pendingDatagramSize(), 0);
+        _statusSocket.readDatagram(datagram.data(), datagram.size());
+        
+        QDataStream in(datagram);
+        qint64 pid;
+        bool busy;
+        in >> pid >> busy;
+        if (in.status() != QDataStream::Ok || !_childPIDs.key(pid)) {
+            continue; // garbled, or from a child that's since finished
+        }
+        if (busy) {
+            _busyChildren.insert(pid);
+        } else {
+            _busyChildren.remove(pid);
+        }
+    }
+    // a child that's taken an assignment is no longer a spare, so replace it
+    spawnSpares();
 }
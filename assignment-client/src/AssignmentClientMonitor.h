@@ -13,22 +13,43 @@
 #define hifi_AssignmentClientMonitor_h
 
 #include <QtCore/QCoreApplication>
+#include <QtCore/QHash>
 #include <QtCore/QProcess>
+#include <QtCore/QSet>
+#include <QtNetwork/QUdpSocket>
 
 #include <Assignment.h>
 
 extern const char* NUM_FORKS_PARAMETER;
+extern const char* NUM_SPARES_PARAMETER;
+extern const char* PIN_TO_CORES_PARAMETER;
+
+/// the option through which children are told where to send their status
+extern const QString MONITOR_PORT_OPTION;
 
 class AssignmentClientMonitor : public QCoreApplication {
     Q_OBJECT
 public:
-    AssignmentClientMonitor(int &argc, char **argv, int numAssignmentClientForks);
+    /// \param numSpares the number of children to keep waiting for an assignment, on top of the busy ones, so that one
+    /// can take over straight away from a child that dies
+    /// \param pinToCores whether to give each child its own core, round robin
+    AssignmentClientMonitor(int &argc, char **argv, int numAssignmentClientForks, int numSpares, bool pinToCores);
 private slots:
     void childProcessFinished(int exitCode, QProcess::ExitStatus exitStatus);
+    void readStatusDatagrams();
 private:
     void spawnChildClient();
+    void spawnSpares();
     
     QStringList _childArguments;
+    int _numForks;
+    int _numSpares;
+    bool _pinToCores;
+    int _nextCore;
+    
+    QUdpSocket _statusSocket; /// receives the children's reports of whether they're busy
+    QHash<QProcess*, qint64> _childPIDs; /// kept here, since a process has no PID once it's finished
+    QSet<qint64> _busyChildren; /// the PIDs of the children running assignments
 };
 
 #endif // hifi_AssignmentClientMonitor_h
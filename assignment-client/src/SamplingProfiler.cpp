@@ -0,0 +1,194 @@
+//
+//  SamplingProfiler.cpp
+//  assignment-client/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#include <QtCore/QAtomicInt>
+#include <QtCore/QHash>
+#include <QtCore/QList>
+
+#include "SamplingProfiler.h"
+
+#if defined(__GLIBC__) || defined(__APPLE__)
+
+#include <cxxabi.h>
+#include <execinfo.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+
+const int MAX_SAMPLE_FRAMES = 64;
+
+// the frames of the signal handler itself and of the trampoline it's called through, at the top of every sample
+const int SIGNAL_HANDLER_FRAMES = 2;
+
+class StackSample {
+public:
+    int numFrames;
+    void* frames[MAX_SAMPLE_FRAMES];
+};
+
+// the buffer is only freed when sampling starts again, in case a handler is still running on another thread at stop
+static StackSample* sampleBuffer = NULL;
+static int sampleCapacity = 0;
+static QAtomicInt sampleCount;
+static bool sampling = false;
+
+static void sampleStack(int signalNumber) {
+    int index = sampleCount.fetchAndAddRelaxed(1);
+    if (index < sampleCapacity) {
+        StackSample& sample = sampleBuffer[index];
+        sample.numFrames = backtrace(sample.frames, MAX_SAMPLE_FRAMES);
+    }
+}
+
+static QByteArray getFrameName(void* address) {
+    char** symbols = backtrace_symbols(&address, 1);
+    QByteArray symbol = symbols ? symbols[0] : "";
+    free(symbols);
+
+    QByteArray mangledName;
+#ifdef __APPLE__
+    // index, binary, address, name + offset
+    QList<QByteArray> fields = symbol.simplified().split(' ');
+    if (fields.size() >= 4) {
+        mangledName = fields.at(3);
+    }
+#else
+    // binary(name+offset) [address]
+    int nameStart = symbol.indexOf('(') + 1;
+    int nameEnd = symbol.indexOf('+', nameStart);
+    if (nameStart > 0 && nameEnd > nameStart) {
+        mangledName = symbol.mid(nameStart, nameEnd - nameStart);
+
+    } else if (nameStart > 0 && nameEnd == nameStart) {
+        // a symbol that isn't exported: the binary and offset, for addr2line
+        int offsetEnd = symbol.indexOf(')', nameEnd);
+        QByteArray binary = symbol.left(nameStart - 1);
+        return binary.mid(binary.lastIndexOf('/') + 1) + symbol.mid(nameEnd, offsetEnd - nameEnd);
+    }
+#endif
+    if (mangledName.isEmpty()) {
+        return "0x" + QByteArray::number((quintptr)address, 16);
+    }
+    int status;
+    char* demangledName = abi::__cxa_demangle(mangledName.constData(), NULL, NULL, &status);
+    QByteArray name = (status == 0) ? QByteArray(demangledName) : mangledName;
+    free(demangledName);
+
+    // the folded stacks separate their frames with semicolons
+    return name.replace(';', ':');
+}
+
+bool SamplingProfiler::isAvailable() {
+    return true;
+}
+
+bool SamplingProfiler::isRunning() {
+    return sampling;
+}
+
+bool SamplingProfiler::start(int samplesPerSecond, int maxSamples) {
+    const int USECS_PER_SECOND = 1000 * 1000;
+    if (sampling || samplesPerSecond <= 0 || samplesPerSecond > USECS_PER_SECOND || maxSamples <= 0) {
+        return false;
+    }
+    // the first backtrace loads the unwinder, which mustn't happen in the signal handler
+    void* frame;
+    backtrace(&frame, 1);
+
+    delete[] sampleBuffer;
+    sampleBuffer = new StackSample[maxSamples];
+    for (int i = 0; i < maxSamples; i++) {
+        sampleBuffer[i].numFrames = 0;
+    }
+    sampleCapacity = maxSamples;
+    sampleCount.store(0);
+
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = sampleStack;
+    action.sa_flags = SA_RESTART;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGPROF, &action, NULL);
+
+    // the timer counts the CPU time of all of our threads, and the signal goes to one that's using it
+    itimerval timer;
+    timer.it_interval.tv_sec = 0;
+    timer.it_interval.tv_usec = USECS_PER_SECOND / samplesPerSecond;
+    timer.it_value = timer.it_interval;
+    setitimer(ITIMER_PROF, &timer, NULL);
+
+    sampling = true;
+    return true;
+}
+
+QByteArray SamplingProfiler::stop() {
+    if (!sampling) {
+        return QByteArray();
+    }
+    itimerval timer;
+    memset(&timer, 0, sizeof(timer));
+    setitimer(ITIMER_PROF, &timer, NULL);
+
+    // ignored rather than left to the default, which would end the process if one were still pending
+    signal(SIGPROF, SIG_IGN);
+    sampling = false;
+
+    int numSamples = qMin((int)sampleCount.load(), sampleCapacity);
+    QHash<void*, QByteArray> frameNames;
+    QHash<QByteArray, int> stackSamples;
+    for (int i = 0; i < numSamples; i++) {
+        const StackSample& sample = sampleBuffer[i];
+        QByteArray stack;
+        for (int j = sample.numFrames - 1; j >= SIGNAL_HANDLER_FRAMES; j--) {
+            void* address = sample.frames[j];
+            QHash<void*, QByteArray>::iterator frameName = frameNames.find(address);
+            if (frameName == frameNames.end()) {
+                frameName = frameNames.insert(address, getFrameName(address));
+            }
+            if (!stack.isEmpty()) {
+                stack.append(';');
+            }
+            stack.append(frameName.value());
+        }
+        if (!stack.isEmpty()) {
+            stackSamples[stack]++;
+        }
+    }
+
+    QByteArray foldedStacks;
+    for (QHash<QByteArray, int>::const_iterator it = stackSamples.constBegin(); it != stackSamples.constEnd(); it++) {
+        foldedStacks.append(it.key());
+        foldedStacks.append(' ');
+        foldedStacks.append(QByteArray::number(it.value()));
+        foldedStacks.append('\n');
+    }
+    return foldedStacks;
+}
+
+#else
+
+bool SamplingProfiler::isAvailable() {
+    return false;
+}
+
+bool SamplingProfiler::isRunning() {
+    return false;
+}
+
+bool SamplingProfiler::start(int samplesPerSecond, int maxSamples) {
+    return false;
+}
+
+QByteArray SamplingProfiler::stop() {
+    return QByteArray();
+}
+
+#endif
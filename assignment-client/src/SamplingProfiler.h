@@ -0,0 +1,36 @@
+//
+//  SamplingProfiler.h
+//  assignment-client/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#ifndef hifi_SamplingProfiler_h
+#define hifi_SamplingProfiler_h
+
+#include <QtCore/QByteArray>
+
+/// Samples the stacks of whichever threads of the assignment-client are using the CPU, so that the hot paths of a
+/// misbehaving assignment can be found on a live host. A CPU time interval timer raises SIGPROF at the sampling rate,
+/// and its handler only copies the return addresses into a buffer allocated up front; the addresses are symbolized
+/// once sampling stops. We can only do this where there's execinfo's backtrace - anywhere else nothing is sampled.
+namespace SamplingProfiler {
+
+    /// returns true if stacks can be sampled on this platform
+    bool isAvailable();
+
+    bool isRunning();
+
+    /// starts sampling at the given rate until stopped or until the given number of samples have been taken; returns
+    /// false if sampling isn't available or is already running
+    bool start(int samplesPerSecond, int maxSamples);
+
+    /// stops sampling and returns the stacks sampled, folded in the format the flame graph tools read: a line for each
+    /// distinct stack, with its frames from the outermost separated by semicolons, then a space and its samples
+    QByteArray stop();
+}
+
+#endif // hifi_SamplingProfiler_h
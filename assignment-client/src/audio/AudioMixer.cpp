@@ -9,9 +9,10 @@
 //  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
 //
 
-#include <mmintrin.h>
+#include <algorithm>
 #include <errno.h>
 #include <fcntl.h>
+#include <float.h>
 #include <fstream>
 #include <iostream>
 #include <math.h>
@@ -37,11 +38,16 @@
 #include <QtCore/QJsonDocument>
 #include <QtCore/QJsonObject>
 #include <QtCore/QJsonValue>
+#include <QtCore/QRunnable>
 #include <QtCore/QTimer>
 #include <QtNetwork/QNetworkRequest>
 #include <QtNetwork/QNetworkReply>
 
+#include <AudioCodec.h>
+#include <AudioHRTF.h>
+#include <AudioMixKernels.h>
 #include <Logging.h>
+#include <Metrics.h>
 #include <NetworkAccessManager.h>
 #include <NodeList.h>
 #include <Node.h>
@@ -59,6 +65,10 @@
 
 const float LOUDNESS_TO_DISTANCE_RATIO = 0.00001f;
 
+// how many sources a listener hears in full when the mixer is keeping up, and the least it is cut back to
+const int DEFAULT_FULL_QUALITY_SOURCES_PER_LISTENER = 32;
+const int MIN_FULL_QUALITY_SOURCES_PER_LISTENER = 4;
+
 const QString AUDIO_MIXER_LOGGING_TARGET_NAME = "audio-mixer";
 
 void attachNewBufferToNode(Node *newNode) {
@@ -69,6 +79,24 @@ void attachNewBufferToNode(Node *newNode) {
 
 bool AudioMixer::_useDynamicJitterBuffers = false;
 
+// the percentiles are taken over about ten seconds of frames
+const int MIX_STAGE_TIMING_WINDOW_FRAMES = 1000;
+
+MixStageTiming::MixStageTiming() :
+    _frameTimes(MIX_STAGE_TIMING_WINDOW_FRAMES)
+{
+    
+}
+
+void MixStageTiming::addFrameTime(quint64 usecs) {
+    _frameTimes.updatePercentile(usecs);
+}
+
+void MixStageTiming::addToStatsObject(QJsonObject& statsObject, const QString& name) const {
+    statsObject[name + "_p50_usecs"] = _frameTimes.getValueAtPercentile();
+    statsObject[name + "_p99_usecs"] = _frameTimes.getValueAtPercentile(0.99f);
+}
+
 AudioMixer::AudioMixer(const QByteArray& packet) :
     ThreadedAssignment(packet),
     _trailingSleepRatio(1.0f),
@@ -79,7 +107,17 @@ AudioMixer::AudioMixer(const QByteArray& packet) :
     _sumMixes(0),
     _sourceUnattenuatedZone(NULL),
     _listenerUnattenuatedZone(NULL),
-    _lastSendAudioStreamStatsTime(usecTimestampNow())
+    _lastSendAudioStreamStatsTime(usecTimestampNow()),
+    _numMixThreads(1),
+    _mixThreadPool(),
+    _listenerMixes(),
+    _listenerMixIsSilent(),
+    _zoneSubmixDistance(0.0f),
+    _clusterSubmixes(),
+    _listenerClusters(),
+    _hrtfSourcesPerListener(0),
+    _maxFullQualitySourcesPerListener(DEFAULT_FULL_QUALITY_SOURCES_PER_LISTENER),
+    _fullQualitySourcesPerListener(DEFAULT_FULL_QUALITY_SOURCES_PER_LISTENER)
 {
     
 }
@@ -89,312 +127,640 @@ AudioMixer::~AudioMixer() {
     delete _listenerUnattenuatedZone;
 }
 
+/// adds numFrames of a mono source to a stereo mix, with the weaker delayed channel on the side away from the source
+static void addSpatializedFrames(float* mixSamples, const int16_t* goodSamples, float goodCoefficient,
+                                 const int16_t* delayedSamples, float delayedCoefficient, bool isRightChannelDelayed,
+                                 int numFrames) {
+    if (isRightChannelDelayed) {
+        AudioMixKernels::addMonoToStereo(mixSamples, goodSamples, goodCoefficient,
+                                         delayedSamples, delayedCoefficient, numFrames);
+    } else {
+        AudioMixKernels::addMonoToStereo(mixSamples, delayedSamples, delayedCoefficient,
+                                         goodSamples, goodCoefficient, numFrames);
+    }
+}
+
 const float ATTENUATION_BEGINS_AT_DISTANCE = 1.0f;
 const float ATTENUATION_AMOUNT_PER_DOUBLING_IN_DISTANCE = 0.18f;
 const float ATTENUATION_EPSILON_DISTANCE = 0.1f;
+const float PHASE_AMPLITUDE_RATIO_AT_90 = 0.5f;
+
+/// returns the attenuation for a source at the given distance, before any off-axis or injector attenuation
+static float distanceCoefficient(float distance) {
+    if (distance < ATTENUATION_BEGINS_AT_DISTANCE) {
+        return 1.0f;
+    }
+    
+    // calculate the distance coefficient using the distance to this node
+    float coefficient = 1 - (logf(distance / ATTENUATION_BEGINS_AT_DISTANCE) / logf(2.0f)
+                             * ATTENUATION_AMOUNT_PER_DOUBLING_IN_DISTANCE);
+    return coefficient < 0 ? 0 : coefficient;
+}
 
-void AudioMixer::addBufferToMixForListeningNodeWithBuffer(PositionalAudioRingBuffer* bufferToAdd,
-                                                          AvatarAudioRingBuffer* listeningNodeBuffer) {
+/// returns the angle about the y-axis of a source position already rotated into the listener's frame
+static float bearingRelativeAngle(glm::vec3 rotatedSourcePosition) {
+    // project the rotated source position vector onto the XZ plane
+    rotatedSourcePosition.y = 0.0f;
+    
+    // produce an oriented angle about the y-axis
+    return glm::orientedAngle(glm::vec3(0.0f, 0.0f, -1.0f), glm::normalize(rotatedSourcePosition),
+                              glm::vec3(0.0f, 1.0f, 0.0f));
+}
+
+/// calculates the attenuation and phase delay of a source heard by a listener in a different position
+static void calculateSpatialization(PositionalAudioRingBuffer* bufferToAdd, AvatarAudioRingBuffer* listeningNodeBuffer,
+                                    SpatializationParameters& parameters) {
     float bearingRelativeAngleToSource = 0.0f;
     float attenuationCoefficient = 1.0f;
     int numSamplesDelay = 0;
     float weakChannelAmplitudeRatio = 1.0f;
+    bool shouldAttenuate = true;
     
-    bool shouldAttenuate = (bufferToAdd != listeningNodeBuffer);
+    glm::vec3 relativePosition = bufferToAdd->getPosition() - listeningNodeBuffer->getPosition();
+    
+    float distanceBetween = glm::length(relativePosition);
+    
+    if (distanceBetween < EPSILON) {
+        distanceBetween = EPSILON;
+    }
+    
+    if (bufferToAdd->getListenerUnattenuatedZone()) {
+        shouldAttenuate = !bufferToAdd->getListenerUnattenuatedZone()->contains(listeningNodeBuffer->getPosition());
+    }
+    
+    if (bufferToAdd->getType() == PositionalAudioRingBuffer::Injector) {
+        attenuationCoefficient *= reinterpret_cast<InjectedAudioRingBuffer*>(bufferToAdd)->getAttenuationRatio();
+    }
+    
+    shouldAttenuate = shouldAttenuate && distanceBetween > ATTENUATION_EPSILON_DISTANCE;
     
     if (shouldAttenuate) {
+        glm::quat inverseOrientation = glm::inverse(listeningNodeBuffer->getOrientation());
         
-        // if the two buffer pointers do not match then these are different buffers
-        glm::vec3 relativePosition = bufferToAdd->getPosition() - listeningNodeBuffer->getPosition();
-        
-        float distanceBetween = glm::length(relativePosition);
-        
-        if (distanceBetween < EPSILON) {
-            distanceBetween = EPSILON;
-        }
-        
-        if (bufferToAdd->getNextOutputTrailingLoudness() / distanceBetween <= _minAudibilityThreshold) {
-            // according to mixer performance we have decided this does not get to be mixed in
-            // bail out
-            return;
-        }
-        
-        ++_sumMixes;
-        
-        if (bufferToAdd->getListenerUnattenuatedZone()) {
-            shouldAttenuate = !bufferToAdd->getListenerUnattenuatedZone()->contains(listeningNodeBuffer->getPosition());
-        }
+        float distanceSquareToSource = glm::dot(relativePosition, relativePosition);
+        float radius = 0.0f;
         
         if (bufferToAdd->getType() == PositionalAudioRingBuffer::Injector) {
-            attenuationCoefficient *= reinterpret_cast<InjectedAudioRingBuffer*>(bufferToAdd)->getAttenuationRatio();
+            radius = reinterpret_cast<InjectedAudioRingBuffer*>(bufferToAdd)->getRadius();
         }
         
-        shouldAttenuate = shouldAttenuate && distanceBetween > ATTENUATION_EPSILON_DISTANCE;
-        
-        if (shouldAttenuate) {
-            glm::quat inverseOrientation = glm::inverse(listeningNodeBuffer->getOrientation());
-            
-            float distanceSquareToSource = glm::dot(relativePosition, relativePosition);
-            float radius = 0.0f;
+        if (radius == 0 || (distanceSquareToSource > radius * radius)) {
+            // this is either not a spherical source, or the listener is outside the sphere
             
-            if (bufferToAdd->getType() == PositionalAudioRingBuffer::Injector) {
-                radius = reinterpret_cast<InjectedAudioRingBuffer*>(bufferToAdd)->getRadius();
-            }
-            
-            if (radius == 0 || (distanceSquareToSource > radius * radius)) {
-                // this is either not a spherical source, or the listener is outside the sphere
+            if (radius > 0) {
+                // this is a spherical source - the distance used for the coefficient
+                // needs to be the closest point on the boundary to the source
                 
-                if (radius > 0) {
-                    // this is a spherical source - the distance used for the coefficient
-                    // needs to be the closest point on the boundary to the source
-                    
-                    // ovveride the distance to the node with the distance to the point on the
-                    // boundary of the sphere
-                    distanceSquareToSource -= (radius * radius);
-                    
-                } else {
-                    // calculate the angle delivery for off-axis attenuation
-                    glm::vec3 rotatedListenerPosition = glm::inverse(bufferToAdd->getOrientation()) * relativePosition;
-                    
-                    float angleOfDelivery = glm::angle(glm::vec3(0.0f, 0.0f, -1.0f),
-                                                       glm::normalize(rotatedListenerPosition));
-                    
-                    const float MAX_OFF_AXIS_ATTENUATION = 0.2f;
-                    const float OFF_AXIS_ATTENUATION_FORMULA_STEP = (1 - MAX_OFF_AXIS_ATTENUATION) / 2.0f;
-                    
-                    float offAxisCoefficient = MAX_OFF_AXIS_ATTENUATION +
-                        (OFF_AXIS_ATTENUATION_FORMULA_STEP * (angleOfDelivery / PI_OVER_TWO));
-                    
-                    // multiply the current attenuation coefficient by the calculated off axis coefficient
-                    attenuationCoefficient *= offAxisCoefficient;
-                }
+                // ovveride the distance to the node with the distance to the point on the
+                // boundary of the sphere
+                distanceSquareToSource -= (radius * radius);
                 
-                glm::vec3 rotatedSourcePosition = inverseOrientation * relativePosition;
-                
-                if (distanceBetween >= ATTENUATION_BEGINS_AT_DISTANCE) {
-                    // calculate the distance coefficient using the distance to this node
-                    float distanceCoefficient = 1 - (logf(distanceBetween / ATTENUATION_BEGINS_AT_DISTANCE) / logf(2.0f)
-                                                     * ATTENUATION_AMOUNT_PER_DOUBLING_IN_DISTANCE);
-                    
-                    if (distanceCoefficient < 0) {
-                        distanceCoefficient = 0;
-                    }
-                    
-                    // multiply the current attenuation coefficient by the distance coefficient
-                    attenuationCoefficient *= distanceCoefficient;
-                }
+            } else {
+                // calculate the angle delivery for off-axis attenuation
+                glm::vec3 rotatedListenerPosition = glm::inverse(bufferToAdd->getOrientation()) * relativePosition;
                 
-                // project the rotated source position vector onto the XZ plane
-                rotatedSourcePosition.y = 0.0f;
+                float angleOfDelivery = glm::angle(glm::vec3(0.0f, 0.0f, -1.0f),
+                                                   glm::normalize(rotatedListenerPosition));
                 
-                // produce an oriented angle about the y-axis
-                bearingRelativeAngleToSource = glm::orientedAngle(glm::vec3(0.0f, 0.0f, -1.0f),
-                                                                  glm::normalize(rotatedSourcePosition),
-                                                                  glm::vec3(0.0f, 1.0f, 0.0f));
+                const float MAX_OFF_AXIS_ATTENUATION = 0.2f;
+                const float OFF_AXIS_ATTENUATION_FORMULA_STEP = (1 - MAX_OFF_AXIS_ATTENUATION) / 2.0f;
                 
-                const float PHASE_AMPLITUDE_RATIO_AT_90 = 0.5;
+                float offAxisCoefficient = MAX_OFF_AXIS_ATTENUATION +
+                    (OFF_AXIS_ATTENUATION_FORMULA_STEP * (angleOfDelivery / PI_OVER_TWO));
                 
-                // figure out the number of samples of delay and the ratio of the amplitude
-                // in the weak channel for audio spatialization
-                float sinRatio = fabsf(sinf(bearingRelativeAngleToSource));
-                numSamplesDelay = SAMPLE_PHASE_DELAY_AT_90 * sinRatio;
-                weakChannelAmplitudeRatio = 1 - (PHASE_AMPLITUDE_RATIO_AT_90 * sinRatio);
+                // multiply the current attenuation coefficient by the calculated off axis coefficient
+                attenuationCoefficient *= offAxisCoefficient;
             }
+            
+            glm::vec3 rotatedSourcePosition = inverseOrientation * relativePosition;
+            
+            // multiply the current attenuation coefficient by the distance coefficient
+            attenuationCoefficient *= distanceCoefficient(distanceBetween);
+            
+            bearingRelativeAngleToSource = bearingRelativeAngle(rotatedSourcePosition);
+            
+            // figure out the number of samples of delay and the ratio of the amplitude
+            // in the weak channel for audio spatialization
+            float sinRatio = fabsf(sinf(bearingRelativeAngleToSource));
+            numSamplesDelay = SAMPLE_PHASE_DELAY_AT_90 * sinRatio;
+            weakChannelAmplitudeRatio = 1 - (PHASE_AMPLITUDE_RATIO_AT_90 * sinRatio);
+        }
+    }
+    
+    parameters.distance = distanceBetween;
+    parameters.shouldAttenuate = shouldAttenuate;
+    parameters.attenuationCoefficient = attenuationCoefficient;
+    parameters.bearingRelativeAngleToSource = bearingRelativeAngleToSource;
+    parameters.numSamplesDelay = numSamplesDelay;
+    parameters.weakChannelAmplitudeRatio = weakChannelAmplitudeRatio;
+    parameters.setCalculatedFor(bufferToAdd, listeningNodeBuffer);
+}
+
+// the HRTF filters reach back HRTF_NUM_TAPS - 1 samples, within the OUTPUT_FRAME_HISTORY_SAMPLES in front of the
+// output frame, and are eased from the last bearing of a pair to its new one over this many steps of the frame
+const int HRTF_INTERPOLATION_BLOCKS = 4;
+
+// sources heard quieter than this are not worth the filters, they get the phase delay whatever the budget
+const float HRTF_MIN_HEARD_LOUDNESS = 0.001f;
+
+/// adds a mono source to a stereo mix through the HRTF filters, moving the filters from one bearing to the other
+static void addHRTFFrames(float* mixSamples, const int16_t* samples, float fromBearing, float toBearing, float gain) {
+    float leftFilter[HRTF_NUM_TAPS];
+    float rightFilter[HRTF_NUM_TAPS];
+    
+    // take the short way around between the two bearings
+    float bearingChange = toBearing - fromBearing;
+    if (bearingChange > PI) {
+        bearingChange -= TWO_PI;
+    } else if (bearingChange < -PI) {
+        bearingChange += TWO_PI;
+    }
+    
+    if (bearingChange == 0.0f) {
+        AudioHRTF::getFilters(toBearing, gain, leftFilter, rightFilter);
+        AudioMixKernels::addConvolvedMonoToStereo(mixSamples, samples, leftFilter, rightFilter, HRTF_NUM_TAPS,
+                                                  NETWORK_BUFFER_LENGTH_SAMPLES_PER_CHANNEL);
+        return;
+    }
+    
+    const int FRAMES_PER_BLOCK = NETWORK_BUFFER_LENGTH_SAMPLES_PER_CHANNEL / HRTF_INTERPOLATION_BLOCKS;
+    for (int b = 0; b < HRTF_INTERPOLATION_BLOCKS; b++) {
+        float bearing = fromBearing + (bearingChange * (b + 1) / HRTF_INTERPOLATION_BLOCKS);
+        AudioHRTF::getFilters(bearing, gain, leftFilter, rightFilter);
+        AudioMixKernels::addConvolvedMonoToStereo(mixSamples + (b * FRAMES_PER_BLOCK * 2),
+                                                  samples + (b * FRAMES_PER_BLOCK), leftFilter, rightFilter,
+                                                  HRTF_NUM_TAPS, FRAMES_PER_BLOCK);
+    }
+}
+
+bool AudioMixer::addBufferToMixForListeningNodeWithBuffer(PositionalAudioRingBuffer* bufferToAdd,
+                                                          AvatarAudioRingBuffer* listeningNodeBuffer,
+                                                          AudioMixerClientData* listeningNodeData,
+                                                          float* mixSamples, int& hrtfSourcesLeft) {
+    float bearingRelativeAngleToSource = 0.0f;
+    float attenuationCoefficient = 1.0f;
+    int numSamplesDelay = 0;
+    float weakChannelAmplitudeRatio = 1.0f;
+    
+    bool shouldAttenuate = (bufferToAdd != listeningNodeBuffer);
+    SpatializationParameters* parameters = NULL;
+    
+    if (shouldAttenuate) {
+        // if the two buffer pointers do not match then these are different buffers
+        // re-use what we calculated for this pair last frame unless one of them has moved or turned since
+        parameters = &listeningNodeData->getSpatializationParameters(bufferToAdd);
+        if (!parameters->isCurrentFor(bufferToAdd, listeningNodeBuffer)) {
+            calculateSpatialization(bufferToAdd, listeningNodeBuffer, *parameters);
+        }
+        
+        if (bufferToAdd->getNextOutputTrailingLoudness() / parameters->distance <= _minAudibilityThreshold) {
+            // according to mixer performance we have decided this does not get to be mixed in
+            // bail out
+            return false;
         }
+        
+        shouldAttenuate = parameters->shouldAttenuate;
+        attenuationCoefficient = parameters->attenuationCoefficient;
+        bearingRelativeAngleToSource = parameters->bearingRelativeAngleToSource;
+        numSamplesDelay = parameters->numSamplesDelay;
+        weakChannelAmplitudeRatio = parameters->weakChannelAmplitudeRatio;
     }
     
-    const int16_t* nextOutputStart = bufferToAdd->getNextOutput();
+    const int16_t* nextOutputStart = bufferToAdd->getOutputFrame();
     
-    if (!bufferToAdd->isStereo() && shouldAttenuate) {
+    if (!bufferToAdd->isStereo() && shouldAttenuate && hrtfSourcesLeft > 0
+        && bufferToAdd->getNextOutputTrailingLoudness() * attenuationCoefficient >= HRTF_MIN_HEARD_LOUDNESS) {
+        // this mono buffer is within the HRTF budget of the listener, ease its filters over from the last frame
+        float fromBearing = parameters->hasHRTFBearing ? parameters->hrtfBearing : bearingRelativeAngleToSource;
+        addHRTFFrames(mixSamples, nextOutputStart, fromBearing, bearingRelativeAngleToSource, attenuationCoefficient);
+        
+        parameters->hasHRTFBearing = true;
+        parameters->hrtfBearing = bearingRelativeAngleToSource;
+        --hrtfSourcesLeft;
+    } else if (!bufferToAdd->isStereo() && shouldAttenuate) {
         // this is a mono buffer, which means it gets full attenuation and spatialization
         
+        // a pair that drops out of the HRTF budget starts its filters afresh when it gets back in
+        parameters->hasHRTFBearing = false;
+        
         // if the bearing relative angle to source is > 0 then the delayed channel is the right one
-        int delayedChannelOffset = (bearingRelativeAngleToSource > 0.0f) ? 1 : 0;
-        int goodChannelOffset = delayedChannelOffset == 0 ? 1 : 0;
+        bool isRightChannelDelayed = bearingRelativeAngleToSource > 0.0f;
+        float delayedChannelCoefficient = attenuationCoefficient * weakChannelAmplitudeRatio;
         
-        const int16_t* bufferStart = bufferToAdd->getBuffer();
-        int ringBufferSampleCapacity = bufferToAdd->getSampleCapacity();
+        if (numSamplesDelay > 0) {
+            // if there was a sample delay for this buffer, we need to pull samples prior to the output frame
+            // to stick at the beginning of the delayed channel - the buffer keeps them in front of the frame
+            const int16_t* delayNextOutputStart = nextOutputStart - numSamplesDelay;
+            
+            addSpatializedFrames(mixSamples, nextOutputStart, attenuationCoefficient,
+                                 delayNextOutputStart, delayedChannelCoefficient, isRightChannelDelayed, numSamplesDelay);
+        }
+        
+        // the rest of the delayed channel lags the good channel by numSamplesDelay, the delayed samples that
+        // would land past the end of this frame are picked up at the beginning of the next one
+        addSpatializedFrames(mixSamples + (numSamplesDelay * 2), nextOutputStart + numSamplesDelay,
+                             attenuationCoefficient, nextOutputStart, delayedChannelCoefficient, isRightChannelDelayed,
+                             NETWORK_BUFFER_LENGTH_SAMPLES_PER_CHANNEL - numSamplesDelay);
+    } else {
+        // this is a stereo buffer or an unattenuated buffer, don't perform spatialization
+        if (!shouldAttenuate) {
+            attenuationCoefficient = 1.0f;
+        }
         
-        int16_t correctBufferSample[2], delayBufferSample[2];
-        int delayedChannelIndex = 0;
+        if (bufferToAdd->isStereo()) {
+            AudioMixKernels::addInterleaved(mixSamples, nextOutputStart, attenuationCoefficient,
+                                            NETWORK_BUFFER_LENGTH_SAMPLES_STEREO);
+        } else {
+            // an unattenuated mono buffer goes into both channels as is
+            AudioMixKernels::addMonoToStereo(mixSamples, nextOutputStart, attenuationCoefficient,
+                                             nextOutputStart, attenuationCoefficient,
+                                             NETWORK_BUFFER_LENGTH_SAMPLES_PER_CHANNEL);
+        }
+    }
+    
+    return true;
+}
+
+/// a mono source beyond the submix distance from the center of a cluster is heard by its listeners through the
+/// cluster submix, the mixer and the listeners have to agree on this exactly so that no source is mixed twice
+static bool isInClusterSubmix(const PositionalAudioRingBuffer* buffer, const glm::vec3& clusterCenter,
+                              float zoneSubmixDistance) {
+    return !buffer->isStereo() && glm::distance(buffer->getPosition(), clusterCenter) > zoneSubmixDistance;
+}
+
+// cluster cells are a fraction of the submix distance so that every listener in a cluster is still well inside the
+// distance from its far-field sources
+const float ZONE_SUBMIX_DISTANCE_TO_CLUSTER_CELL_SIZE_RATIO = 0.25f;
+const int MIN_LISTENERS_PER_CLUSTER = 2;
+
+void AudioMixer::prepareClusterSubmixes(const QList<SharedNodePointer>& listeners) {
+    _listenerClusters.clear();
+    
+    // bucket the listeners with a grid of their own, each occupied cell is a candidate cluster
+    AudioSourceGrid listenerGrid(_zoneSubmixDistance * ZONE_SUBMIX_DISTANCE_TO_CLUSTER_CELL_SIZE_RATIO);
+    foreach (const SharedNodePointer& node, listeners) {
+        listenerGrid.addSource(node.data(), ((AudioMixerClientData*) node->getLinkedData())->getAvatarAudioRingBuffer());
+    }
+    
+    QList<QVector<AudioSource> > listenersByCell = listenerGrid.getSourcesByCell();
+    
+    int numClusters = 0;
+    foreach (const QVector<AudioSource>& cellListeners, listenersByCell) {
+        if (cellListeners.size() >= MIN_LISTENERS_PER_CLUSTER) {
+            numClusters++;
+        }
+    }
+    _clusterSubmixes.resize(numClusters);
+    
+    float submixSamples[NETWORK_BUFFER_LENGTH_SAMPLES_PER_CHANNEL];
+    QVector<AudioSource> audibleSources;
+    int clusterIndex = 0;
+    
+    foreach (const QVector<AudioSource>& cellListeners, listenersByCell) {
+        if (cellListeners.size() < MIN_LISTENERS_PER_CLUSTER) {
+            // a lone listener gets nothing out of a submix, it is mixed the usual way
+            continue;
+        }
         
-        const int SINGLE_STEREO_OFFSET = 2;
+        ListenerClusterSubmix& submix = _clusterSubmixes[clusterIndex];
         
-        for (int s = 0; s < NETWORK_BUFFER_LENGTH_SAMPLES_STEREO; s += 4) {
-            
-            // setup the int16_t variables for the two sample sets
-            correctBufferSample[0] = nextOutputStart[s / 2] * attenuationCoefficient;
-            correctBufferSample[1] = nextOutputStart[(s / 2) + 1] * attenuationCoefficient;
-            
-            delayedChannelIndex = s + (numSamplesDelay * 2) + delayedChannelOffset;
-            
-            delayBufferSample[0] = correctBufferSample[0] * weakChannelAmplitudeRatio;
-            delayBufferSample[1] = correctBufferSample[1] * weakChannelAmplitudeRatio;
-            
-            __m64 bufferSamples = _mm_set_pi16(_clientSamples[s + goodChannelOffset],
-                                               _clientSamples[s + goodChannelOffset + SINGLE_STEREO_OFFSET],
-                                               _clientSamples[delayedChannelIndex],
-                                               _clientSamples[delayedChannelIndex + SINGLE_STEREO_OFFSET]);
-            __m64 addedSamples = _mm_set_pi16(correctBufferSample[0], correctBufferSample[1],
-                                              delayBufferSample[0], delayBufferSample[1]);
-            
-            // perform the MMX add (with saturation) of two correct and delayed samples
-            __m64 mmxResult = _mm_adds_pi16(bufferSamples, addedSamples);
-            int16_t* shortResults = reinterpret_cast<int16_t*>(&mmxResult);
-            
-            // assign the results from the result of the mmx arithmetic
-            _clientSamples[s + goodChannelOffset] = shortResults[3];
-            _clientSamples[s + goodChannelOffset + SINGLE_STEREO_OFFSET] = shortResults[2];
-            _clientSamples[delayedChannelIndex] = shortResults[1];
-            _clientSamples[delayedChannelIndex + SINGLE_STEREO_OFFSET] = shortResults[0];
+        submix.center = glm::vec3(0.0f);
+        foreach (const AudioSource& listener, cellListeners) {
+            submix.center += listener.buffer->getPosition();
+            _listenerClusters.insert(listener.node, clusterIndex);
         }
+        submix.center /= (float) cellListeners.size();
         
-        // The following code is pretty gross and redundant, but AFAIK it's the best way to avoid
-        // too many conditionals in handling the delay samples at the beginning of _clientSamples.
-        // Basically we try to take the samples in batches of four, and then handle the remainder
-        // conditionally to get rid of the rest.
+        memset(submixSamples, 0, sizeof(submixSamples));
+        glm::vec3 weightedPositions(0.0f);
+        float sumOfWeights = 0.0f;
         
-        const int DOUBLE_STEREO_OFFSET = 4;
-        const int TRIPLE_STEREO_OFFSET = 6;
+        // the listeners in a cluster are not excluded from the submix - they are all nearer the center than the
+        // submix distance so none of their own mono streams can be in it
+        _sourceGrid.findAudibleSources(submix.center, _minAudibilityThreshold, audibleSources);
         
-        if (numSamplesDelay > 0) {
-            // if there was a sample delay for this buffer, we need to pull samples prior to the nextOutput
-            // to stick at the beginning
-            float attenuationAndWeakChannelRatio = attenuationCoefficient * weakChannelAmplitudeRatio;
-            const int16_t* delayNextOutputStart = nextOutputStart - numSamplesDelay;
-            if (delayNextOutputStart < bufferStart) {
-                delayNextOutputStart = bufferStart + ringBufferSampleCapacity - numSamplesDelay;
+        foreach (const AudioSource& source, audibleSources) {
+            if (!isInClusterSubmix(source.buffer, submix.center, _zoneSubmixDistance)) {
+                continue;
             }
             
-            int i = 0;
-            
-            while (i + 3 < numSamplesDelay) {
-                // handle the first cases where we can MMX add four samples at once
-                int parentIndex = i * 2;
-                __m64 bufferSamples = _mm_set_pi16(_clientSamples[parentIndex + delayedChannelOffset],
-                                                   _clientSamples[parentIndex + SINGLE_STEREO_OFFSET + delayedChannelOffset],
-                                                   _clientSamples[parentIndex + DOUBLE_STEREO_OFFSET + delayedChannelOffset],
-                                                   _clientSamples[parentIndex + TRIPLE_STEREO_OFFSET + delayedChannelOffset]);
-                __m64 addSamples = _mm_set_pi16(delayNextOutputStart[i] * attenuationAndWeakChannelRatio,
-                                                delayNextOutputStart[i + 1] * attenuationAndWeakChannelRatio,
-                                                delayNextOutputStart[i + 2] * attenuationAndWeakChannelRatio,
-                                                delayNextOutputStart[i + 3] * attenuationAndWeakChannelRatio);
-                __m64 mmxResult = _mm_adds_pi16(bufferSamples, addSamples);
-                int16_t* shortResults = reinterpret_cast<int16_t*>(&mmxResult);
-                
-                _clientSamples[parentIndex + delayedChannelOffset] = shortResults[3];
-                _clientSamples[parentIndex + SINGLE_STEREO_OFFSET + delayedChannelOffset] = shortResults[2];
-                _clientSamples[parentIndex + DOUBLE_STEREO_OFFSET + delayedChannelOffset] = shortResults[1];
-                _clientSamples[parentIndex + TRIPLE_STEREO_OFFSET + delayedChannelOffset] = shortResults[0];
-                
-                // push the index
-                i += 4;
+            float distance = glm::distance(source.buffer->getPosition(), submix.center);
+            float loudness = source.buffer->getNextOutputTrailingLoudness();
+            if (loudness / distance <= _minAudibilityThreshold) {
+                continue;
             }
             
-            int parentIndex = i * 2;
-            
-            if (i + 2 < numSamplesDelay) {
-                // MMX add only three delayed samples
-                
-                __m64 bufferSamples = _mm_set_pi16(_clientSamples[parentIndex + delayedChannelOffset],
-                                                   _clientSamples[parentIndex + SINGLE_STEREO_OFFSET + delayedChannelOffset],
-                                                   _clientSamples[parentIndex + DOUBLE_STEREO_OFFSET + delayedChannelOffset],
-                                                   0);
-                __m64 addSamples = _mm_set_pi16(delayNextOutputStart[i] * attenuationAndWeakChannelRatio,
-                                                delayNextOutputStart[i + 1] * attenuationAndWeakChannelRatio,
-                                                delayNextOutputStart[i + 2] * attenuationAndWeakChannelRatio,
-                                                0);
-                __m64 mmxResult = _mm_adds_pi16(bufferSamples, addSamples);
-                int16_t* shortResults = reinterpret_cast<int16_t*>(&mmxResult);
-                
-                _clientSamples[parentIndex + delayedChannelOffset] = shortResults[3];
-                _clientSamples[parentIndex + SINGLE_STEREO_OFFSET + delayedChannelOffset] = shortResults[2];
-                _clientSamples[parentIndex + DOUBLE_STEREO_OFFSET + delayedChannelOffset] = shortResults[1];
-                
-            } else if (i + 1 < numSamplesDelay) {
-                // MMX add two delayed samples
-                __m64 bufferSamples = _mm_set_pi16(_clientSamples[parentIndex + delayedChannelOffset],
-                                                   _clientSamples[parentIndex + SINGLE_STEREO_OFFSET + delayedChannelOffset],
-                                                   0, 0);
-                __m64 addSamples = _mm_set_pi16(delayNextOutputStart[i] * attenuationAndWeakChannelRatio,
-                                                delayNextOutputStart[i + 1] * attenuationAndWeakChannelRatio, 0, 0);
-                
-                __m64 mmxResult = _mm_adds_pi16(bufferSamples, addSamples);
-                int16_t* shortResults = reinterpret_cast<int16_t*>(&mmxResult);
-                
-                _clientSamples[parentIndex + delayedChannelOffset] = shortResults[3];
-                _clientSamples[parentIndex + SINGLE_STEREO_OFFSET + delayedChannelOffset] = shortResults[2];
-                
-            } else if (i < numSamplesDelay) {
-                // MMX add a single delayed sample
-                __m64 bufferSamples = _mm_set_pi16(_clientSamples[parentIndex + delayedChannelOffset], 0, 0, 0);
-                __m64 addSamples = _mm_set_pi16(delayNextOutputStart[i] * attenuationAndWeakChannelRatio, 0, 0, 0);
-                
-                __m64 mmxResult = _mm_adds_pi16(bufferSamples, addSamples);
-                int16_t* shortResults = reinterpret_cast<int16_t*>(&mmxResult);
-                
-                _clientSamples[parentIndex + delayedChannelOffset] = shortResults[3];
+            float attenuationCoefficient = distanceCoefficient(distance);
+            if (source.buffer->getType() == PositionalAudioRingBuffer::Injector) {
+                attenuationCoefficient *= reinterpret_cast<InjectedAudioRingBuffer*>(source.buffer)->getAttenuationRatio();
             }
-        }
-    } else {
-        // this is a stereo buffer or an unattenuated buffer, don't perform spatialization
-        for (int s = 0; s < NETWORK_BUFFER_LENGTH_SAMPLES_STEREO; s += 4) {
             
-            int stereoDivider = bufferToAdd->isStereo() ? 1 : 2;
+            AudioMixKernels::addInterleaved(submixSamples, source.buffer->getOutputFrame(), attenuationCoefficient,
+                                            NETWORK_BUFFER_LENGTH_SAMPLES_PER_CHANNEL);
             
-            if (!shouldAttenuate) {
-                attenuationCoefficient = 1.0f;
-            }
+            float weight = loudness * attenuationCoefficient;
+            weightedPositions += source.buffer->getPosition() * weight;
+            sumOfWeights += weight;
             
-            _clientSamples[s] = glm::clamp(_clientSamples[s]
-                                           + (int) (nextOutputStart[(s / stereoDivider)] * attenuationCoefficient),
-                                           MIN_SAMPLE_VALUE, MAX_SAMPLE_VALUE);
-            _clientSamples[s + 1] = glm::clamp(_clientSamples[s + 1]
-                                               + (int) (nextOutputStart[(s / stereoDivider) + (1 / stereoDivider)]
-                                                        * attenuationCoefficient),
-                                               MIN_SAMPLE_VALUE, MAX_SAMPLE_VALUE);
-            _clientSamples[s + 2] = glm::clamp(_clientSamples[s + 2]
-                                               + (int) (nextOutputStart[(s / stereoDivider) + (2 / stereoDivider)]
-                                                        * attenuationCoefficient),
-                                               MIN_SAMPLE_VALUE, MAX_SAMPLE_VALUE);
-            _clientSamples[s + 3] = glm::clamp(_clientSamples[s + 3]
-                                               + (int) (nextOutputStart[(s / stereoDivider) + (3 / stereoDivider)]
-                                                        * attenuationCoefficient),
-                                               MIN_SAMPLE_VALUE, MAX_SAMPLE_VALUE);
+            ++_sumMixes;
         }
+        
+        submix.hasSources = sumOfWeights > 0.0f;
+        if (submix.hasSources) {
+            submix.sourceCentroid = weightedPositions / sumOfWeights;
+            AudioMixKernels::saturateMix(submix.samples, submixSamples, NETWORK_BUFFER_LENGTH_SAMPLES_PER_CHANNEL);
+        }
+        
+        clusterIndex++;
     }
 }
 
-void AudioMixer::prepareMixForListeningNode(Node* node) {
-    AvatarAudioRingBuffer* nodeRingBuffer = ((AudioMixerClientData*) node->getLinkedData())->getAvatarAudioRingBuffer();
+/// adds an attenuated mono submix to a listener's mix, only panned towards the centroid of the sources in it
+static void addPannedSubmix(const int16_t* samples, const glm::vec3& sourceCentroid,
+                            AvatarAudioRingBuffer* listeningNodeBuffer, float* mixSamples) {
+    glm::vec3 rotatedCentroid = glm::inverse(listeningNodeBuffer->getOrientation())
+        * (sourceCentroid - listeningNodeBuffer->getPosition());
+    
+    float bearingRelativeAngleToSubmix = bearingRelativeAngle(rotatedCentroid);
+    float weakChannelCoefficient = 1 - (PHASE_AMPLITUDE_RATIO_AT_90 * fabsf(sinf(bearingRelativeAngleToSubmix)));
+    
+    if (bearingRelativeAngleToSubmix > 0.0f) {
+        AudioMixKernels::addMonoToStereo(mixSamples, samples, 1.0f, samples, weakChannelCoefficient,
+                                         NETWORK_BUFFER_LENGTH_SAMPLES_PER_CHANNEL);
+    } else {
+        AudioMixKernels::addMonoToStereo(mixSamples, samples, weakChannelCoefficient, samples, 1.0f,
+                                         NETWORK_BUFFER_LENGTH_SAMPLES_PER_CHANNEL);
+    }
+}
+
+void AudioMixer::addClusterSubmixForListeningNode(const ListenerClusterSubmix& submix,
+                                                  AvatarAudioRingBuffer* listeningNodeBuffer, float* mixSamples) {
+    // the submix is attenuated already, all that is left is to pan it towards where its sources are
+    addPannedSubmix(submix.samples, submix.sourceCentroid, listeningNodeBuffer, mixSamples);
+}
+
+/// the louder of two sources goes first, ties keep the order of the source grid so every run mixes alike
+static bool isPerceivedLouder(const RankedAudioSource& a, const RankedAudioSource& b) {
+    return a.perceivedLoudness > b.perceivedLoudness
+        || (a.perceivedLoudness == b.perceivedLoudness && a.buffer < b.buffer);
+}
+
+int AudioMixer::prepareMixForListeningNode(Node* node, float* mixSamples, QVector<AudioSource>& audibleSources,
+                                           QVector<RankedAudioSource>& rankedSources) {
+    AudioMixerClientData* nodeData = (AudioMixerClientData*) node->getLinkedData();
+    AvatarAudioRingBuffer* nodeRingBuffer = nodeData->getAvatarAudioRingBuffer();
+    int numMixes = 0;
 
     // zero out the client mix for this node
-    memset(_clientSamples, 0, NETWORK_BUFFER_LENGTH_BYTES_STEREO);
+    memset(mixSamples, 0, NETWORK_BUFFER_LENGTH_SAMPLES_STEREO * sizeof(float));
 
-    // loop through all other nodes that have sufficient audio to mix
-    foreach (const SharedNodePointer& otherNode, NodeList::getInstance()->getNodeHash()) {
-        if (otherNode->getLinkedData()) {
+    // if this node is part of a cluster then its far-field sources have already been mixed into the cluster submix
+    const ListenerClusterSubmix* clusterSubmix = NULL;
+    QHash<const Node*, int>::const_iterator cluster = _listenerClusters.constFind(node);
+    if (cluster != _listenerClusters.constEnd()) {
+        clusterSubmix = &_clusterSubmixes.at(cluster.value());
+    }
+    
+    // the first audible mono sources get the HRTF filters, the sources after them the phase delay
+    int hrtfSourcesLeft = _hrtfSourcesPerListener;
+    
+    // only visit the buffers that are loud enough and close enough to possibly be heard by this node
+    _sourceGrid.findAudibleSources(nodeRingBuffer->getPosition(), _minAudibilityThreshold, audibleSources);
+    
+    // rank the sources by how loud they are where this node is
+    rankedSources.clear();
+    foreach (const AudioSource& source, audibleSources) {
+        if (clusterSubmix && isInClusterSubmix(source.buffer, clusterSubmix->center, _zoneSubmixDistance)) {
+            continue;
+        }
+        
+        if (*source.node == *node && !source.buffer->shouldLoopbackForNode()) {
+            continue;
+        }
+        
+        if (source.buffer == nodeRingBuffer) {
+            // a node hearing itself always gets its own voice in full
+            rankedSources.append(RankedAudioSource(source.buffer, FLT_MAX));
+            continue;
+        }
+        
+        SpatializationParameters& parameters = nodeData->getSpatializationParameters(source.buffer);
+        if (!parameters.isCurrentFor(source.buffer, nodeRingBuffer)) {
+            calculateSpatialization(source.buffer, nodeRingBuffer, parameters);
+        }
+        
+        float perceivedLoudness = source.buffer->getNextOutputTrailingLoudness() / parameters.distance;
+        if (perceivedLoudness > _minAudibilityThreshold) {
+            rankedSources.append(RankedAudioSource(source.buffer, perceivedLoudness));
+        }
+    }
+    
+    // only the sources within the budget need to be in order, the HRTF budget then goes to the loudest of them
+    int numFullQualitySources = qMin(_fullQualitySourcesPerListener, rankedSources.size());
+    if (numFullQualitySources < rankedSources.size()) {
+        std::nth_element(rankedSources.begin(), rankedSources.begin() + numFullQualitySources, rankedSources.end(),
+                         isPerceivedLouder);
+    }
+    std::sort(rankedSources.begin(), rankedSources.begin() + numFullQualitySources, isPerceivedLouder);
+    
+    for (int i = 0; i < numFullQualitySources; i++) {
+        if (addBufferToMixForListeningNodeWithBuffer(rankedSources.at(i).buffer, nodeRingBuffer, nodeData, mixSamples,
+                                                     hrtfSourcesLeft)) {
+            ++numMixes;
+        }
+    }
+    
+    // the mono sources past the budget are only attenuated and summed into a bed panned towards where they are
+    float bedSamples[NETWORK_BUFFER_LENGTH_SAMPLES_PER_CHANNEL];
+    glm::vec3 weightedPositions(0.0f);
+    float sumOfWeights = 0.0f;
+    
+    for (int i = numFullQualitySources; i < rankedSources.size(); i++) {
+        PositionalAudioRingBuffer* buffer = rankedSources.at(i).buffer;
+        SpatializationParameters& parameters = nodeData->getSpatializationParameters(buffer);
+        
+        if (buffer->isStereo() || !parameters.shouldAttenuate) {
+            // these are not spatialized anyway, so they cost no less in the bed
+            if (addBufferToMixForListeningNodeWithBuffer(buffer, nodeRingBuffer, nodeData, mixSamples,
+                                                         hrtfSourcesLeft)) {
+                ++numMixes;
+            }
+            continue;
+        }
+        
+        if (sumOfWeights == 0.0f) {
+            memset(bedSamples, 0, sizeof(bedSamples));
+        }
+        
+        AudioMixKernels::addInterleaved(bedSamples, buffer->getOutputFrame(), parameters.attenuationCoefficient,
+                                        NETWORK_BUFFER_LENGTH_SAMPLES_PER_CHANNEL);
+        
+        // a pair that drops out of the budget starts its HRTF filters afresh when it gets back in
+        parameters.hasHRTFBearing = false;
+        
+        float weight = qMax(buffer->getNextOutputTrailingLoudness() * parameters.attenuationCoefficient, EPSILON);
+        weightedPositions += buffer->getPosition() * weight;
+        sumOfWeights += weight;
+    }
+    
+    if (sumOfWeights > 0.0f) {
+        int16_t bed[NETWORK_BUFFER_LENGTH_SAMPLES_PER_CHANNEL];
+        AudioMixKernels::saturateMix(bed, bedSamples, NETWORK_BUFFER_LENGTH_SAMPLES_PER_CHANNEL);
+        addPannedSubmix(bed, weightedPositions / sumOfWeights, nodeRingBuffer, mixSamples);
+        ++numMixes;
+    }
+    
+    if (clusterSubmix && clusterSubmix->hasSources) {
+        addClusterSubmixForListeningNode(*clusterSubmix, nodeRingBuffer, mixSamples);
+        ++numMixes;
+    }
+    
+    nodeData->pruneSpatializationParameters();
+    
+    return numMixes;
+}
 
-            AudioMixerClientData* otherNodeClientData = (AudioMixerClientData*) otherNode->getLinkedData();
+/// Mixes a contiguous range of the frame's listeners using its own mix scratch buffer, so that partitions can run
+/// on separate threads of the mix pool without sharing any mixer state.
+class AudioMixerPartition : public QRunnable {
+public:
+    
+    AudioMixerPartition(AudioMixer* mixer, const QList<SharedNodePointer>& listeners,
+                        int firstListener, int numListeners, int16_t* listenerMixes, bool* listenerMixIsSilent);
+    
+    virtual void run();
+    
+    int getNumMixes() const { return _numMixes; }
+    
+private:
+    
+    AudioMixer* _mixer;
+    const QList<SharedNodePointer>& _listeners;
+    int _firstListener;
+    int _numListeners;
+    int16_t* _listenerMixes;
+    bool* _listenerMixIsSilent;
+    int _numMixes;
+    float _mixSamples[NETWORK_BUFFER_LENGTH_SAMPLES_STEREO];
+    QVector<AudioSource> _audibleSources;
+    QVector<RankedAudioSource> _rankedSources;
+};
 
-            // enumerate the ARBs attached to the otherNode and add all that should be added to mix
-            for (int i = 0; i < otherNodeClientData->getRingBuffers().size(); i++) {
-                PositionalAudioRingBuffer* otherNodeBuffer = otherNodeClientData->getRingBuffers()[i];
+AudioMixerPartition::AudioMixerPartition(AudioMixer* mixer, const QList<SharedNodePointer>& listeners,
+                                         int firstListener, int numListeners, int16_t* listenerMixes,
+                                         bool* listenerMixIsSilent) :
+    _mixer(mixer),
+    _listeners(listeners),
+    _firstListener(firstListener),
+    _numListeners(numListeners),
+    _listenerMixes(listenerMixes),
+    _listenerMixIsSilent(listenerMixIsSilent),
+    _numMixes(0),
+    _audibleSources(),
+    _rankedSources()
+{
+    // the mixer waits on the partitions and reads back their mix counts, so it owns them
+    setAutoDelete(false);
+}
 
-                if ((*otherNode != *node
-                     || otherNodeBuffer->shouldLoopbackForNode())
-                    && otherNodeBuffer->willBeAddedToMix()
-                    && otherNodeBuffer->getNextOutputTrailingLoudness() > 0) {
-                    addBufferToMixForListeningNodeWithBuffer(otherNodeBuffer, nodeRingBuffer);
-                }
+void AudioMixerPartition::run() {
+    for (int i = _firstListener; i < _firstListener + _numListeners; i++) {
+        int numListenerMixes = _mixer->prepareMixForListeningNode(_listeners.at(i).data(), _mixSamples,
+                                                                  _audibleSources, _rankedSources);
+        _numMixes += numListenerMixes;
+        
+        if (numListenerMixes == 0) {
+            // nothing was mixed in, this listener only needs to be told how much silence to play
+            _listenerMixIsSilent[i] = true;
+            continue;
+        }
+        
+        // the sources are summed without any clipping, the whole mix is saturated once here
+        int16_t* listenerMix = _listenerMixes + (i * NETWORK_BUFFER_LENGTH_SAMPLES_STEREO);
+        AudioMixKernels::saturateMix(listenerMix, _mixSamples, NETWORK_BUFFER_LENGTH_SAMPLES_STEREO);
+        
+        // a mix of sources that are barely audible can still round to nothing
+        _listenerMixIsSilent[i] = true;
+        for (int s = 0; s < NETWORK_BUFFER_LENGTH_SAMPLES_STEREO; s++) {
+            if (listenerMix[s] != 0) {
+                _listenerMixIsSilent[i] = false;
+                break;
             }
         }
     }
 }
 
+void AudioMixer::mixListeners(const QList<SharedNodePointer>& listeners) {
+    if (_listenerMixes.size() < listeners.size() * NETWORK_BUFFER_LENGTH_SAMPLES_STEREO) {
+        _listenerMixes.resize(listeners.size() * NETWORK_BUFFER_LENGTH_SAMPLES_STEREO);
+    }
+    if (_listenerMixIsSilent.size() < listeners.size()) {
+        _listenerMixIsSilent.resize(listeners.size());
+    }
+    
+    // split the listeners into one contiguous range per thread, the assignment thread mixes the last range itself
+    int numPartitions = qMax(qMin(_numMixThreads, listeners.size()), 1);
+    int listenersPerPartition = listeners.size() / numPartitions;
+    int remainingListeners = listeners.size() % numPartitions;
+    
+    QList<AudioMixerPartition*> partitions;
+    int firstListener = 0;
+    
+    for (int i = 0; i < numPartitions; i++) {
+        int numListeners = listenersPerPartition + (i < remainingListeners ? 1 : 0);
+        partitions.append(new AudioMixerPartition(this, listeners, firstListener, numListeners,
+                                                  _listenerMixes.data(), _listenerMixIsSilent.data()));
+        firstListener += numListeners;
+        
+        if (i < numPartitions - 1) {
+            _mixThreadPool.start(partitions.last());
+        }
+    }
+    
+    partitions.last()->run();
+    _mixThreadPool.waitForDone();
+    
+    foreach (AudioMixerPartition* partition, partitions) {
+        _sumMixes += partition->getNumMixes();
+        delete partition;
+    }
+}
+
+QList<SharedNodePointer> AudioMixer::mixFrame(const NodeHash& nodeHash) {
+    QList<SharedNodePointer> listeners;
+    _sourceGrid.clear();
+    
+    foreach (const SharedNodePointer& node, nodeHash) {
+        AudioMixerClientData* nodeData = (AudioMixerClientData*) node->getLinkedData();
+        if (!nodeData) {
+            continue;
+        }
+        
+        if (node->getType() == NodeType::Agent && node->getActiveSocket() && nodeData->getAvatarAudioRingBuffer()) {
+            listeners.append(node);
+        }
+        
+        // index every buffer that has sufficient audio to mix this frame
+        foreach (PositionalAudioRingBuffer* ringBuffer, nodeData->getRingBuffers()) {
+            if (ringBuffer->willBeAddedToMix() && ringBuffer->getNextOutputTrailingLoudness() > 0) {
+                _sourceGrid.addSource(node.data(), ringBuffer);
+            }
+        }
+    }
+    
+    if (_zoneSubmixDistance > 0.0f) {
+        prepareClusterSubmixes(listeners);
+    }
+    
+    if (!listeners.isEmpty()) {
+        mixListeners(listeners);
+    }
+    
+    return listeners;
+}
 
 void AudioMixer::readPendingDatagrams() {
-    QByteArray receivedPacket;
+    QByteArray& receivedPacket = _datagramBuffer;
     HifiSockAddr senderSockAddr;
     NodeList* nodeList = NodeList::getInstance();
     
@@ -408,16 +774,9 @@ void AudioMixer::readPendingDatagrams() {
                 || mixerPacketType == PacketTypeSilentAudioFrame) {
                 
                 nodeList->findNodeAndUpdateWithDataFromPacket(receivedPacket);
-            } else if (mixerPacketType == PacketTypeMuteEnvironment) {
-                QByteArray packet = receivedPacket;
-                populatePacketHeader(packet, PacketTypeMuteEnvironment);
+            } else if (queuePacketIfDispatched(receivedPacket)) {
+                // the packet will be processed by processQueuedPacket, off of the thread that mixes
                 
-                foreach (const SharedNodePointer& node, nodeList->getNodeHash()) {
-                    if (node->getType() == NodeType::Agent && node->getActiveSocket() && node->getLinkedData() && node != nodeList->sendingNodeForPacket(receivedPacket)) {
-                        nodeList->writeDatagram(packet, packet.size(), node);
-                    }
-                }
-
             } else {
                 // let processNodeData handle it.
                 nodeList->processNodeData(senderSockAddr, receivedPacket);
@@ -426,10 +785,26 @@ void AudioMixer::readPendingDatagrams() {
     }
 }
 
+void AudioMixer::processQueuedPacket(const SharedNodePointer& sendingNode, const QByteArray& receivedPacket) {
+    if (packetTypeForPacket(receivedPacket) == PacketTypeMuteEnvironment) {
+        NodeList* nodeList = NodeList::getInstance();
+        
+        QByteArray packet = receivedPacket;
+        populatePacketHeader(packet, PacketTypeMuteEnvironment);
+        
+        foreach (const SharedNodePointer& node, nodeList->getNodeHash()) {
+            if (node->getType() == NodeType::Agent && node->getActiveSocket() && node->getLinkedData() && node != sendingNode) {
+                nodeList->writeDatagram(packet, packet.size(), node);
+            }
+        }
+    }
+}
+
 void AudioMixer::sendStatsPacket() {
     static QJsonObject statsObject;
     statsObject["trailing_sleep_percentage"] = _trailingSleepRatio * 100.0f;
     statsObject["performance_throttling_ratio"] = _performanceThrottlingRatio;
+    statsObject["full_quality_sources_per_listener"] = _fullQualitySourcesPerListener;
 
     statsObject["average_listeners_per_frame"] = (float) _sumListeners / (float) _numStatFrames;
     
@@ -439,6 +814,41 @@ void AudioMixer::sendStatsPacket() {
         statsObject["average_mixes_per_listener"] = 0.0;
     }
 
+    // where the frame time goes - reading datagrams, preparing the mixes, encoding them and sending them
+    _readTiming.addToStatsObject(statsObject, "timing_read");
+    _prepareTiming.addToStatsObject(statsObject, "timing_prepare");
+    _encodeTiming.addToStatsObject(statsObject, "timing_encode");
+    _sendTiming.addToStatsObject(statsObject, "timing_send");
+    _frameTiming.addToStatsObject(statsObject, "timing_frame");
+
+    // the streams of every listener are summed up here, and only those that look bad are detailed on their own
+    NodeList* nodeList = NodeList::getInstance();
+    AudioStreamStats windowTotals;
+    int numStreams = 0;
+    int numFlaggedStreams = 0;
+    QList<QPair<QString, QString> > jitterStats;
+    foreach (const SharedNodePointer& node, nodeList->getNodeHash()) {
+        AudioMixerClientData* clientData = static_cast<AudioMixerClientData*>(node->getLinkedData());
+        if (clientData) {
+            numStreams += clientData->getRingBuffers().size();
+            
+            // a listener that was flagged last time gets an empty entry, which clears what the domain-server shows
+            bool wasFlagged = clientData->hasFlaggedAudioStreams();
+            QString value = clientData->closeAudioStreamStatsWindows(windowTotals, numFlaggedStreams);
+            if (!value.isEmpty() || wasFlagged) {
+                jitterStats.append(QPair<QString, QString>("jitterStats." + node->getUUID().toString(), value));
+            }
+        }
+    }
+    quint32 packetsExpected = windowTotals._packetsReceived + windowTotals._packetsLost;
+    statsObject["audio_streams"] = numStreams;
+    statsObject["audio_streams_flagged"] = numFlaggedStreams;
+    statsObject["audio_packets_received"] = (double) windowTotals._packetsReceived;
+    statsObject["audio_packets_lost_percentage"] = packetsExpected > 0 ?
+        100.0 * windowTotals._packetsLost / packetsExpected : 0.0;
+    statsObject["audio_packets_late_percentage"] = packetsExpected > 0 ?
+        100.0 * windowTotals._packetsLate / packetsExpected : 0.0;
+
     ThreadedAssignment::addPacketStatsAndSendStatsPacket(statsObject);
     _sumListeners = 0;
     _sumMixes = 0;
@@ -448,23 +858,17 @@ void AudioMixer::sendStatsPacket() {
     // NOTE: These stats can be too large to fit in an MTU, so we break it up into multiple packts...
     QJsonObject statsObject2;
 
-    // add stats for each listerner
+    // add stats for each flagged listener
     bool somethingToSend = false;
     int sizeOfStats = 0;
     int TOO_BIG_FOR_MTU = 1200; // some extra space for JSONification
     
-    NodeList* nodeList = NodeList::getInstance();
-    int clientNumber = 0;
-    foreach (const SharedNodePointer& node, nodeList->getNodeHash()) {
-        clientNumber++;
-        AudioMixerClientData* clientData = static_cast<AudioMixerClientData*>(node->getLinkedData());
-        if (clientData) {
-            QString property = "jitterStats." + node->getUUID().toString();
-            QString value = clientData->getAudioStreamStatsString();
-            statsObject2[qPrintable(property)] = value;
-            somethingToSend = true;
-            sizeOfStats += property.size() + value.size();
-        }
+    for (int i = 0; i < jitterStats.size(); i++) {
+        const QString& property = jitterStats.at(i).first;
+        const QString& value = jitterStats.at(i).second;
+        statsObject2[qPrintable(property)] = value;
+        somethingToSend = true;
+        sizeOfStats += property.size() + value.size();
         
         // if we're too large, send the packet
         if (sizeOfStats > TOO_BIG_FOR_MTU) {
@@ -490,6 +894,10 @@ void AudioMixer::run() {
 
     nodeList->linkedDataCreateCallback = attachNewBufferToNode;
     
+    // muting the environment sends to every agent, which the audio frames shouldn't have to wait behind
+    int bulkPacketQueue = addPacketQueue(QThread::LowPriority);
+    dispatchPacketType(PacketTypeMuteEnvironment, bulkPacketQueue);
+    
     // setup a NetworkAccessManager to ask the domain-server for our settings
     NetworkAccessManager& networkManager = NetworkAccessManager::getInstance();
     
@@ -526,52 +934,23 @@ void AudioMixer::run() {
     
     QJsonObject settingsObject = QJsonDocument::fromJson(reply->readAll()).object();
     
-    // check the settings object to see if we have anything we can parse out
-    const QString AUDIO_GROUP_KEY = "audio";
+    parseSettingsObject(settingsObject);
     
-    if (settingsObject.contains(AUDIO_GROUP_KEY)) {
-        QJsonObject audioGroupObject = settingsObject[AUDIO_GROUP_KEY].toObject();
-        
-        const QString UNATTENUATED_ZONE_KEY = "unattenuated-zone";
-        
-        QString unattenuatedZoneString = audioGroupObject[UNATTENUATED_ZONE_KEY].toString();
-        if (!unattenuatedZoneString.isEmpty()) {
-            QStringList zoneStringList = unattenuatedZoneString.split(',');
-            
-            glm::vec3 sourceCorner(zoneStringList[0].toFloat(), zoneStringList[1].toFloat(), zoneStringList[2].toFloat());
-            glm::vec3 sourceDimensions(zoneStringList[3].toFloat(), zoneStringList[4].toFloat(), zoneStringList[5].toFloat());
-            
-            glm::vec3 listenerCorner(zoneStringList[6].toFloat(), zoneStringList[7].toFloat(), zoneStringList[8].toFloat());
-            glm::vec3 listenerDimensions(zoneStringList[9].toFloat(), zoneStringList[10].toFloat(), zoneStringList[11].toFloat());
-            
-            _sourceUnattenuatedZone = new AABox(sourceCorner, sourceDimensions);
-            _listenerUnattenuatedZone = new AABox(listenerCorner, listenerDimensions);
-            
-            glm::vec3 sourceCenter = _sourceUnattenuatedZone->calcCenter();
-            glm::vec3 destinationCenter = _listenerUnattenuatedZone->calcCenter();
-            
-            qDebug() << "There is an unattenuated zone with source center at"
-            << QString("%1, %2, %3").arg(sourceCenter.x).arg(sourceCenter.y).arg(sourceCenter.z);
-            qDebug() << "Buffers inside this zone will not be attenuated inside a box with center at"
-            << QString("%1, %2, %3").arg(destinationCenter.x).arg(destinationCenter.y).arg(destinationCenter.z);
-        }
-        
-        // check the payload to see if we have asked for dynamicJitterBuffer support
-        const QString DYNAMIC_JITTER_BUFFER_JSON_KEY = "dynamic-jitter-buffer";
-        bool shouldUseDynamicJitterBuffers = audioGroupObject[DYNAMIC_JITTER_BUFFER_JSON_KEY].toBool();
-        if (shouldUseDynamicJitterBuffers) {
-            qDebug() << "Enable dynamic jitter buffers.";
-            _useDynamicJitterBuffers = true;
-        } else {
-            qDebug() << "Dynamic jitter buffers disabled, using old behavior.";
-        }
-    }
+    qDebug() << "Mixing with" << AudioMixKernels::getImplementationName(AudioMixKernels::getImplementation())
+        << "kernels.";
+    
+    MetricHistogram& frameTimeHistogram = MetricsRegistry::getInstance().getHistogram("hifi_audio_mixer_frame_usecs",
+        "How long the audio mixer takes to mix, send and read a frame.");
+    MetricCounter& mixesSentCounter = MetricsRegistry::getInstance().getCounter("hifi_audio_mixer_mixes_sent_total",
+        "The mixes the audio mixer sent to its listeners.");
     
     int nextFrame = 0;
     QElapsedTimer timer;
     timer.start();
     
-    char* clientMixBuffer = new char[NETWORK_BUFFER_LENGTH_BYTES_STEREO + sizeof(quint16)
+    int maxEncodedMixBytes = qMax(NETWORK_BUFFER_LENGTH_BYTES_STEREO,
+                                  AudioCodec::getMaxEncodedSize(AudioCodec::ADPCM, NETWORK_BUFFER_LENGTH_SAMPLES_STEREO, 2));
+    char* clientMixBuffer = new char[maxEncodedMixBytes + sizeof(quint16) + sizeof(quint8)
                                      + numBytesForPacketHeaderGivenPacketType(PacketTypeMixedAudio)];
     
     int usecToSleep = BUFFER_SEND_INTERVAL_USECS;
@@ -579,7 +958,10 @@ void AudioMixer::run() {
     const int TRAILING_AVERAGE_FRAMES = 100;
     int framesSinceCutoffEvent = TRAILING_AVERAGE_FRAMES;
 
+    const int NSECS_PER_USEC = 1000;
+    
     while (!_isFinished) {
+        qint64 frameStart = timer.nsecsElapsed();
         
         foreach (const SharedNodePointer& node, nodeList->getNodeHash()) {
             if (node->getLinkedData()) {
@@ -608,14 +990,14 @@ void AudioMixer::run() {
         
         if (framesSinceCutoffEvent >= TRAILING_AVERAGE_FRAMES) {
             if (_trailingSleepRatio <= STRUGGLE_TRIGGER_SLEEP_PERCENTAGE_THRESHOLD) {
-                // we're struggling - change our min required loudness to reduce some load
+                // we're struggling - cut back how many sources each listener hears in full to reduce some load
                 _performanceThrottlingRatio = _performanceThrottlingRatio + (0.5f * (1.0f - _performanceThrottlingRatio));
                 
                 qDebug() << "Mixer is struggling, sleeping" << _trailingSleepRatio * 100 << "% of frame time. Old cutoff was"
                     << lastCutoffRatio << "and is now" << _performanceThrottlingRatio;
                 hasRatioChanged = true;
             } else if (_trailingSleepRatio >= BACK_OFF_TRIGGER_SLEEP_PERCENTAGE_THRESHOLD && _performanceThrottlingRatio != 0) {
-                // we've recovered and can back off the required loudness
+                // we've recovered and can give the listeners back some of their sources
                 _performanceThrottlingRatio = _performanceThrottlingRatio - RATIO_BACK_OFF;
                 
                 if (_performanceThrottlingRatio < 0) {
@@ -628,9 +1010,10 @@ void AudioMixer::run() {
             }
             
             if (hasRatioChanged) {
-                // set out min audability threshold from the new ratio
-                _minAudibilityThreshold = LOUDNESS_TO_DISTANCE_RATIO / (2.0f * (1.0f - _performanceThrottlingRatio));
-                qDebug() << "Minimum audability required to be mixed is now" << _minAudibilityThreshold;
+                // set the full quality budget from the new ratio, the quietest sources fall back to the bed first
+                _fullQualitySourcesPerListener = qMax(MIN_FULL_QUALITY_SOURCES_PER_LISTENER,
+                    (int) floorf((_maxFullQualitySourcesPerListener * (1.0f - _performanceThrottlingRatio)) + 0.5f));
+                qDebug() << "Each listener now hears" << _fullQualitySourcesPerListener << "sources in full.";
                 
                 framesSinceCutoffEvent = 0;
             }
@@ -650,40 +1033,78 @@ void AudioMixer::run() {
             sendAudioStreamStats = true;
         }
 
-        foreach (const SharedNodePointer& node, nodeList->getNodeHash()) {
-            if (node->getType() == NodeType::Agent && node->getActiveSocket() && node->getLinkedData()
-                && ((AudioMixerClientData*) node->getLinkedData())->getAvatarAudioRingBuffer()) {
-
-                AudioMixerClientData* nodeData = (AudioMixerClientData*)node->getLinkedData();
-
-                prepareMixForListeningNode(node.data());
+        // grab the nodes once for the frame, the listeners and the source grid both hold pointers from this copy
+        NodeHash nodeHash = nodeList->getNodeHash();
+        
+        QList<SharedNodePointer> listeners = mixFrame(nodeHash);
+        
+        qint64 prepareEnd = timer.nsecsElapsed();
+        _prepareTiming.addFrameTime((prepareEnd - frameStart) / NSECS_PER_USEC);
+        
+        qint64 encodeNsecs = 0;
+        qint64 sendNsecs = 0;
+        
+        // send the mixes from the assignment thread, in listener order
+        for (int i = 0; i < listeners.size(); i++) {
+            const SharedNodePointer& node = listeners.at(i);
+            AudioMixerClientData* nodeData = (AudioMixerClientData*)node->getLinkedData();
+            
+            bool isMixSilent = _listenerMixIsSilent.at(i);
+            
+            // pack header
+            int numBytesPacketHeader = populatePacketHeader(clientMixBuffer,
+                                                            isMixSilent ? PacketTypeSilentMixedAudio : PacketTypeMixedAudio);
+            char* dataAt = clientMixBuffer + numBytesPacketHeader;
+            
+            // pack sequence number
+            quint16 sequence = nodeData->getOutgoingSequenceNumber();
+            memcpy(dataAt, &sequence, sizeof(quint16));
+            dataAt += sizeof(quint16);
+            
+            if (isMixSilent) {
+                // pack the number of silent samples instead of the mix
+                int16_t numSilentSamples = NETWORK_BUFFER_LENGTH_SAMPLES_STEREO;
+                memcpy(dataAt, &numSilentSamples, sizeof(int16_t));
+                dataAt += sizeof(int16_t);
+            } else {
+                // encode the mix with the codec this listener sends its own audio with, falling back to PCM
+                quint8 codec = nodeData->getAvatarAudioRingBuffer()->getCodec();
+                if (!AudioCodec::isKnownType(codec)) {
+                    codec = AudioCodec::PCM;
+                }
                 
-                // pack header
-                int numBytesPacketHeader = populatePacketHeader(clientMixBuffer, PacketTypeMixedAudio);
-                char* dataAt = clientMixBuffer + numBytesPacketHeader;
-
-                // pack sequence number
-                quint16 sequence = nodeData->getOutgoingSequenceNumber();
-                memcpy(dataAt, &sequence, sizeof(quint16));
-                dataAt += sizeof(quint16);
-
-                // pack mixed audio samples
-                memcpy(dataAt, _clientSamples, NETWORK_BUFFER_LENGTH_BYTES_STEREO);
-                dataAt += NETWORK_BUFFER_LENGTH_BYTES_STEREO;
-
-                // send mixed audio packet
-                nodeList->writeDatagram(clientMixBuffer, dataAt - clientMixBuffer, node);
-                nodeData->incrementOutgoingMixedAudioSequenceNumber();
+                memcpy(dataAt, &codec, sizeof(quint8));
+                dataAt += sizeof(quint8);
                 
-                // send an audio stream stats packet if it's time
-                if (sendAudioStreamStats) {
-                    nodeData->sendAudioStreamStatsPackets(node);
-                }
-
-                ++_sumListeners;
+                // pack mixed audio samples
+                qint64 encodeStart = timer.nsecsElapsed();
+                dataAt += AudioCodec::encode((AudioCodec::Type) codec,
+                                             _listenerMixes.constData() + (i * NETWORK_BUFFER_LENGTH_SAMPLES_STEREO),
+                                             NETWORK_BUFFER_LENGTH_SAMPLES_STEREO, 2, dataAt);
+                encodeNsecs += timer.nsecsElapsed() - encodeStart;
             }
+            
+            qint64 sendStart = timer.nsecsElapsed();
+            
+            // queue the mixed audio packet, the mixes go out in batches rather than with a call each
+            nodeList->queueDatagram(QByteArray(clientMixBuffer, dataAt - clientMixBuffer), node);
+            nodeData->incrementOutgoingMixedAudioSequenceNumber();
+            
+            // send an audio stream stats packet if it's time
+            if (sendAudioStreamStats) {
+                nodeData->sendAudioStreamStatsPackets(node);
+            }
+            
+            sendNsecs += timer.nsecsElapsed() - sendStart;
+            
+            ++_sumListeners;
+            mixesSentCounter.increment();
         }
         
+        qint64 flushStart = timer.nsecsElapsed();
+        nodeList->flushQueuedDatagrams();
+        sendNsecs += timer.nsecsElapsed() - flushStart;
+        
         // push forward the next output pointers for any audio buffers we used
         foreach (const SharedNodePointer& node, nodeList->getNodeHash()) {
             if (node->getLinkedData()) {
@@ -691,10 +1112,20 @@ void AudioMixer::run() {
             }
         }
         
+        _encodeTiming.addFrameTime(encodeNsecs / NSECS_PER_USEC);
+        _sendTiming.addFrameTime(sendNsecs / NSECS_PER_USEC);
+        
         ++_numStatFrames;
         
+        // pending datagrams are read from the socket's readyRead while events are processed
+        qint64 readStart = timer.nsecsElapsed();
         QCoreApplication::processEvents();
         
+        qint64 frameEnd = timer.nsecsElapsed();
+        _readTiming.addFrameTime((frameEnd - readStart) / NSECS_PER_USEC);
+        _frameTiming.addFrameTime((frameEnd - frameStart) / NSECS_PER_USEC);
+        frameTimeHistogram.record((frameEnd - frameStart) / NSECS_PER_USEC);
+        
         if (_isFinished) {
             break;
         }
@@ -708,3 +1139,84 @@ void AudioMixer::run() {
     
     delete[] clientMixBuffer;
 }
+
+void AudioMixer::parseSettingsObject(const QJsonObject& settingsObject) {
+    // check the settings object to see if we have anything we can parse out
+    const QString AUDIO_GROUP_KEY = "audio";
+    
+    if (settingsObject.contains(AUDIO_GROUP_KEY)) {
+        QJsonObject audioGroupObject = settingsObject[AUDIO_GROUP_KEY].toObject();
+        
+        const QString UNATTENUATED_ZONE_KEY = "unattenuated-zone";
+        
+        QString unattenuatedZoneString = audioGroupObject[UNATTENUATED_ZONE_KEY].toString();
+        if (!unattenuatedZoneString.isEmpty()) {
+            QStringList zoneStringList = unattenuatedZoneString.split(',');
+            
+            glm::vec3 sourceCorner(zoneStringList[0].toFloat(), zoneStringList[1].toFloat(), zoneStringList[2].toFloat());
+            glm::vec3 sourceDimensions(zoneStringList[3].toFloat(), zoneStringList[4].toFloat(), zoneStringList[5].toFloat());
+            
+            glm::vec3 listenerCorner(zoneStringList[6].toFloat(), zoneStringList[7].toFloat(), zoneStringList[8].toFloat());
+            glm::vec3 listenerDimensions(zoneStringList[9].toFloat(), zoneStringList[10].toFloat(), zoneStringList[11].toFloat());
+            
+            _sourceUnattenuatedZone = new AABox(sourceCorner, sourceDimensions);
+            _listenerUnattenuatedZone = new AABox(listenerCorner, listenerDimensions);
+            
+            glm::vec3 sourceCenter = _sourceUnattenuatedZone->calcCenter();
+            glm::vec3 destinationCenter = _listenerUnattenuatedZone->calcCenter();
+            
+            qDebug() << "There is an unattenuated zone with source center at"
+            << QString("%1, %2, %3").arg(sourceCenter.x).arg(sourceCenter.y).arg(sourceCenter.z);
+            qDebug() << "Buffers inside this zone will not be attenuated inside a box with center at"
+            << QString("%1, %2, %3").arg(destinationCenter.x).arg(destinationCenter.y).arg(destinationCenter.z);
+        }
+        
+        // check the payload to see if we have asked for dynamicJitterBuffer support
+        const QString DYNAMIC_JITTER_BUFFER_JSON_KEY = "dynamic-jitter-buffer";
+        bool shouldUseDynamicJitterBuffers = audioGroupObject[DYNAMIC_JITTER_BUFFER_JSON_KEY].toBool();
+        if (shouldUseDynamicJitterBuffers) {
+            qDebug() << "Enable dynamic jitter buffers.";
+            _useDynamicJitterBuffers = true;
+        } else {
+            qDebug() << "Dynamic jitter buffers disabled, using old behavior.";
+        }
+        
+        // check the payload to see how many threads we should spread the listeners across each frame
+        const QString MIX_THREADS_JSON_KEY = "mix-threads";
+        int numMixThreads = audioGroupObject[MIX_THREADS_JSON_KEY].toVariant().toInt();
+        if (numMixThreads > 1) {
+            _numMixThreads = numMixThreads;
+            qDebug() << "Mixing listeners across" << _numMixThreads << "threads.";
+        }
+        
+        // check the payload to see if far-field sources should be shared between clusters of nearby listeners
+        const QString ZONE_SUBMIX_DISTANCE_JSON_KEY = "zone-submix-distance";
+        float zoneSubmixDistance = audioGroupObject[ZONE_SUBMIX_DISTANCE_JSON_KEY].toVariant().toFloat();
+        if (zoneSubmixDistance > 0.0f) {
+            _zoneSubmixDistance = zoneSubmixDistance;
+            qDebug() << "Sharing submixes of sources further than" << _zoneSubmixDistance
+                << "meters between clustered listeners.";
+        }
+        
+        // check the payload to see how many sources each listener may hear through the HRTF filters
+        const QString HRTF_SOURCES_PER_LISTENER_JSON_KEY = "hrtf-sources-per-listener";
+        int hrtfSourcesPerListener = audioGroupObject[HRTF_SOURCES_PER_LISTENER_JSON_KEY].toVariant().toInt();
+        if (hrtfSourcesPerListener > 0) {
+            _hrtfSourcesPerListener = hrtfSourcesPerListener;
+            qDebug() << "Spatializing up to" << _hrtfSourcesPerListener << "sources per listener with HRTF filters.";
+        }
+        
+        // check the payload to see how many sources each listener hears in full before the rest go to the bed
+        const QString FULL_QUALITY_SOURCES_PER_LISTENER_JSON_KEY = "full-quality-sources-per-listener";
+        int fullQualitySourcesPerListener =
+            audioGroupObject[FULL_QUALITY_SOURCES_PER_LISTENER_JSON_KEY].toVariant().toInt();
+        if (fullQualitySourcesPerListener > 0) {
+            _maxFullQualitySourcesPerListener = qMax(fullQualitySourcesPerListener, MIN_FULL_QUALITY_SOURCES_PER_LISTENER);
+            _fullQualitySourcesPerListener = _maxFullQualitySourcesPerListener;
+            qDebug() << "Mixing up to" << _maxFullQualitySourcesPerListener << "sources per listener in full.";
+        }
+    }
+    
+    // the assignment thread mixes one partition itself, the pool takes the others
+    _mixThreadPool.setMaxThreadCount(qMax(_numMixThreads - 1, 1));
+}
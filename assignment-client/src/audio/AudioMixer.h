@@ -12,21 +12,68 @@
 #ifndef hifi_AudioMixer_h
 #define hifi_AudioMixer_h
 
+#include <QtCore/QJsonObject>
+#include <QtCore/QThreadPool>
+#include <QtCore/QVector>
+
 #include <AABox.h>
 #include <AudioRingBuffer.h>
+#include <LimitedNodeList.h>
+#include <MovingPercentile.h>
 #include <ThreadedAssignment.h>
 
-class PositionalAudioRingBuffer;
+#include "AudioSourceGrid.h"
+
+class AudioMixerClientData;
 class AvatarAudioRingBuffer;
+class PositionalAudioRingBuffer;
 
+// must stay within the OUTPUT_FRAME_HISTORY_SAMPLES a PositionalAudioRingBuffer keeps in front of its output frame
 const int SAMPLE_PHASE_DELAY_AT_90 = 20;
 
+/// The far-field sources of a cluster of nearby listeners, mixed once to mono from the center of the cluster so
+/// that each listener in the cluster only has to pan the result.
+class ListenerClusterSubmix {
+public:
+    glm::vec3 center;
+    glm::vec3 sourceCentroid;
+    bool hasSources;
+    int16_t samples[NETWORK_BUFFER_LENGTH_SAMPLES_PER_CHANNEL];
+};
+
+/// A source a listener can hear, ranked by how loud it is where the listener is.
+class RankedAudioSource {
+public:
+    RankedAudioSource() : buffer(NULL), perceivedLoudness(0.0f) { }
+    RankedAudioSource(PositionalAudioRingBuffer* buffer, float perceivedLoudness) :
+        buffer(buffer), perceivedLoudness(perceivedLoudness) { }
+    
+    PositionalAudioRingBuffer* buffer;
+    float perceivedLoudness; ///< the trailing loudness of the source over its distance from the listener
+};
+
+/// The median and 99th percentile of how long one stage of the mix frame takes, over a moving window of frames.
+class MixStageTiming {
+public:
+    MixStageTiming();
+    
+    void addFrameTime(quint64 usecs);
+    
+    /// adds the percentiles to a stats object as <name>_p50_usecs and <name>_p99_usecs
+    void addToStatsObject(QJsonObject& statsObject, const QString& name) const;
+    
+private:
+    MovingPercentile _frameTimes;
+};
+
 /// Handles assignments of type AudioMixer - mixing streams of audio and re-distributing to various clients.
 class AudioMixer : public ThreadedAssignment {
     Q_OBJECT
 public:
     AudioMixer(const QByteArray& packet);
     ~AudioMixer();
+    
+    void processQueuedPacket(const SharedNodePointer& sendingNode, const QByteArray& receivedPacket);
 public slots:
     /// threaded run of assignment
     void run();
@@ -36,18 +83,43 @@ public slots:
     void sendStatsPacket();
 
     static bool getUseDynamicJitterBuffers() { return _useDynamicJitterBuffers; }
+    
+    /// reads the audio group of the domain-server settings, run calls this once it has fetched them
+    void parseSettingsObject(const QJsonObject& settingsObject);
+    
+    /// indexes the buffers of the nodes that will be mixed this frame and mixes every listener among the nodes
+    /// returns the listeners in the order of their mixes, the nodes must stay alive until the mixes are sent
+    QList<SharedNodePointer> mixFrame(const NodeHash& nodeHash);
+    
+    const int16_t* getListenerMix(int listenerIndex) const
+        { return _listenerMixes.constData() + (listenerIndex * NETWORK_BUFFER_LENGTH_SAMPLES_STEREO); }
+    bool isListenerMixSilent(int listenerIndex) const { return _listenerMixIsSilent.at(listenerIndex); }
 
 private:
-    /// adds one buffer to the mix for a listening node
-    void addBufferToMixForListeningNodeWithBuffer(PositionalAudioRingBuffer* bufferToAdd,
-                                                  AvatarAudioRingBuffer* listeningNodeBuffer);
+    friend class AudioMixerPartition;
+    
+    /// adds one buffer to the mix for a listening node, returns true if the buffer was audible and was mixed in
+    /// a mono buffer uses up one of hrtfSourcesLeft if it is loud enough to get the HRTF filters
+    bool addBufferToMixForListeningNodeWithBuffer(PositionalAudioRingBuffer* bufferToAdd,
+                                                  AvatarAudioRingBuffer* listeningNodeBuffer,
+                                                  AudioMixerClientData* listeningNodeData,
+                                                  float* mixSamples, int& hrtfSourcesLeft);
     
-    /// prepares and sends a mix to one Node
-    void prepareMixForListeningNode(Node* node);
+    /// prepares the unsaturated mix for one Node in mixSamples, returns the number of buffers and submixes mixed in
+    /// the loudest _fullQualitySourcesPerListener sources are mixed in full, the quieter mono ones share a panned bed
+    /// audibleSources and rankedSources are scratch space for the sources found in _sourceGrid
+    int prepareMixForListeningNode(Node* node, float* mixSamples, QVector<AudioSource>& audibleSources,
+                                   QVector<RankedAudioSource>& rankedSources);
     
-    // client samples capacity is larger than what will be sent to optimize mixing
-    // we are MMX adding 4 samples at a time so we need client samples to have an extra 4
-    int16_t _clientSamples[NETWORK_BUFFER_LENGTH_SAMPLES_STEREO + (SAMPLE_PHASE_DELAY_AT_90 * 2)];
+    /// groups the listeners that are close to each other and prepares one submix of far-field sources per group
+    void prepareClusterSubmixes(const QList<SharedNodePointer>& listeners);
+    
+    /// adds the cluster submix to a listener's mix, panned towards the loudness weighted center of its sources
+    void addClusterSubmixForListeningNode(const ListenerClusterSubmix& submix, AvatarAudioRingBuffer* listeningNodeBuffer,
+                                          float* mixSamples);
+    
+    /// mixes every listener for this frame into _listenerMixes, spreading the listeners across the mix threads
+    void mixListeners(const QList<SharedNodePointer>& listeners);
     
     float _trailingSleepRatio;
     float _minAudibilityThreshold;
@@ -58,6 +130,28 @@ private:
     AABox* _sourceUnattenuatedZone;
     AABox* _listenerUnattenuatedZone;
     static bool _useDynamicJitterBuffers;
+    
+    int _numMixThreads;
+    QThreadPool _mixThreadPool;
+    QVector<int16_t> _listenerMixes;
+    QVector<bool> _listenerMixIsSilent;
+    AudioSourceGrid _sourceGrid;
+    
+    MixStageTiming _readTiming;
+    MixStageTiming _prepareTiming;
+    MixStageTiming _encodeTiming;
+    MixStageTiming _sendTiming;
+    MixStageTiming _frameTiming;
+    
+    float _zoneSubmixDistance;
+    QVector<ListenerClusterSubmix> _clusterSubmixes;
+    QHash<const Node*, int> _listenerClusters;
+    
+    int _hrtfSourcesPerListener;
+    
+    /// the budget of sources each listener gets in full, shrunk from the maximum while the mixer is struggling
+    int _maxFullQualitySourcesPerListener;
+    int _fullQualitySourcesPerListener;
 
     quint64 _lastSendAudioStreamStatsTime;
 };
@@ -19,10 +19,75 @@
 #include "AudioMixer.h"
 #include "AudioMixerClientData.h"
 
+SpatializationParameters::SpatializationParameters() :
+    distance(0.0f),
+    shouldAttenuate(false),
+    attenuationCoefficient(1.0f),
+    bearingRelativeAngleToSource(0.0f),
+    numSamplesDelay(0),
+    weakChannelAmplitudeRatio(1.0f),
+    hasHRTFBearing(false),
+    hrtfBearing(0.0f),
+    _hasBeenCalculated(false),
+    _wasUsed(false),
+    _sourcePosition(),
+    _sourceOrientation(),
+    _sourceRadius(0.0f),
+    _sourceAttenuationRatio(1.0f),
+    _listenerUnattenuatedZone(NULL),
+    _listenerPosition(),
+    _listenerOrientation()
+{
+    
+}
+
+static void getInjectorProperties(const PositionalAudioRingBuffer* source, float& radius, float& attenuationRatio) {
+    if (source->getType() == PositionalAudioRingBuffer::Injector) {
+        const InjectedAudioRingBuffer* injectedSource = static_cast<const InjectedAudioRingBuffer*>(source);
+        radius = injectedSource->getRadius();
+        attenuationRatio = injectedSource->getAttenuationRatio();
+    } else {
+        radius = 0.0f;
+        attenuationRatio = 1.0f;
+    }
+}
+
+bool SpatializationParameters::isCurrentFor(const PositionalAudioRingBuffer* source,
+                                            const PositionalAudioRingBuffer* listener) const {
+    if (!_hasBeenCalculated) {
+        return false;
+    }
+    
+    float radius, attenuationRatio;
+    getInjectorProperties(source, radius, attenuationRatio);
+    
+    // the parameters only depend on these inputs, so matching them is enough even if the source pointer
+    // we're keyed by has been reused for a different buffer
+    return _sourcePosition == source->getPosition() && _listenerPosition == listener->getPosition()
+        && _sourceOrientation == source->getOrientation() && _listenerOrientation == listener->getOrientation()
+        && _sourceRadius == radius && _sourceAttenuationRatio == attenuationRatio
+        && _listenerUnattenuatedZone == source->getListenerUnattenuatedZone();
+}
+
+void SpatializationParameters::setCalculatedFor(const PositionalAudioRingBuffer* source,
+                                                const PositionalAudioRingBuffer* listener) {
+    _hasBeenCalculated = true;
+    _sourcePosition = source->getPosition();
+    _sourceOrientation = source->getOrientation();
+    getInjectorProperties(source, _sourceRadius, _sourceAttenuationRatio);
+    _listenerUnattenuatedZone = source->getListenerUnattenuatedZone();
+    _listenerPosition = listener->getPosition();
+    _listenerOrientation = listener->getOrientation();
+}
+
 AudioMixerClientData::AudioMixerClientData() :
     _ringBuffers(),
+    _spatializationParameters(),
+    _mixesSinceSpatializationPrune(0),
     _outgoingMixedAudioSequenceNumber(0),
-    _incomingAvatarAudioSequenceNumberStats()
+    _incomingAvatarAudioSequenceNumberStats(),
+    _audioStreamStatsWindows(),
+    _hasFlaggedAudioStreams(false)
 {
     
 }
@@ -45,6 +110,14 @@ AvatarAudioRingBuffer* AudioMixerClientData::getAvatarAudioRingBuffer() const {
     return NULL;
 }
 
+quint32 AudioMixerClientData::getNumPacketsLost() const {
+    quint32 numPacketsLost = _incomingAvatarAudioSequenceNumberStats.getNumLost();
+    foreach (const SequenceNumberStats& injectedStreamStats, _incomingInjectedAudioSequenceNumberStatsMap) {
+        numPacketsLost += injectedStreamStats.getNumLost();
+    }
+    return numPacketsLost;
+}
+
 int AudioMixerClientData::parseData(const QByteArray& packet) {
 
     // parse sequence number for this packet
@@ -113,11 +186,17 @@ int AudioMixerClientData::parseData(const QByteArray& packet) {
 
 void AudioMixerClientData::checkBuffersBeforeFrameSend(AABox* checkSourceZone, AABox* listenerZone) {
     for (int i = 0; i < _ringBuffers.size(); i++) {
+        int jitterBufferFrames = _ringBuffers[i]->getCurrentJitterBufferFrames();
+        _audioStreamStatsWindows[_ringBuffers[i]].sampleJitterBufferFrames(jitterBufferFrames);
+        
         if (_ringBuffers[i]->shouldBeAddedToMix()) {
             // this is a ring buffer that is ready to go
             // set its flag so we know to push its buffer when all is said and done
             _ringBuffers[i]->setWillBeAddedToMix(true);
             
+            // pull the frame that will be mixed out of the ring buffer
+            _ringBuffers[i]->prepareOutputFrame();
+            
             // calculate the average loudness for the next NETWORK_BUFFER_LENGTH_SAMPLES_PER_CHANNEL
             // that would be mixed in
             _ringBuffers[i]->updateNextOutputTrailingLoudness();
@@ -135,13 +214,12 @@ void AudioMixerClientData::pushBuffersAfterFrameSend() {
 
     QList<PositionalAudioRingBuffer*>::iterator i = _ringBuffers.begin();
     while (i != _ringBuffers.end()) {
-        // this was a used buffer, push the output pointer forwards
         PositionalAudioRingBuffer* audioBuffer = *i;
 
         const int INJECTOR_CONSECUTIVE_NOT_MIXED_THRESHOLD = 100;
 
         if (audioBuffer->willBeAddedToMix()) {
-            audioBuffer->shiftReadPosition(audioBuffer->getSamplesPerFrame());
+            // the frame was already taken out of the ring buffer in checkBuffersBeforeFrameSend
             audioBuffer->setWillBeAddedToMix(false);
         } else if (audioBuffer->getType() == PositionalAudioRingBuffer::Injector
                    && audioBuffer->hasStarted() && audioBuffer->isStarved()
@@ -150,6 +228,7 @@ void AudioMixerClientData::pushBuffersAfterFrameSend() {
             // also delete its sequence number stats
             QUuid streamIdentifier = ((InjectedAudioRingBuffer*)audioBuffer)->getStreamIdentifier();
             _incomingInjectedAudioSequenceNumberStatsMap.remove(streamIdentifier);
+            _audioStreamStatsWindows.remove(audioBuffer);
             delete audioBuffer;
             i = _ringBuffers.erase(i);
             continue;
@@ -158,17 +237,46 @@ void AudioMixerClientData::pushBuffersAfterFrameSend() {
     }
 }
 
+SpatializationParameters& AudioMixerClientData::getSpatializationParameters(const PositionalAudioRingBuffer* source) {
+    SpatializationParameters& parameters = _spatializationParameters[source];
+    parameters.setWasUsed(true);
+    return parameters;
+}
+
+void AudioMixerClientData::pruneSpatializationParameters() {
+    const int MIXES_PER_SPATIALIZATION_PRUNE = 100;
+    
+    if (++_mixesSinceSpatializationPrune < MIXES_PER_SPATIALIZATION_PRUNE) {
+        return;
+    }
+    _mixesSinceSpatializationPrune = 0;
+    
+    QHash<const PositionalAudioRingBuffer*, SpatializationParameters>::iterator it = _spatializationParameters.begin();
+    while (it != _spatializationParameters.end()) {
+        if (it.value().wasUsed()) {
+            it.value().setWasUsed(false);
+            ++it;
+        } else {
+            it = _spatializationParameters.erase(it);
+        }
+    }
+}
+
 AudioStreamStats AudioMixerClientData::getAudioStreamStatsOfStream(const PositionalAudioRingBuffer* ringBuffer) const {
+    static const SequenceNumberStats NO_SEQUENCE_NUMBER_STATS;
     AudioStreamStats streamStats;
-    SequenceNumberStats streamSequenceNumberStats;
+    const SequenceNumberStats* sequenceNumberStats = &_incomingAvatarAudioSequenceNumberStats;
 
     streamStats._streamType = ringBuffer->getType();
     if (streamStats._streamType == PositionalAudioRingBuffer::Injector) {
+        // looked up in place, rather than copied out of the map, as this is done for every stream on every stats pass
         streamStats._streamIdentifier = ((InjectedAudioRingBuffer*)ringBuffer)->getStreamIdentifier();
-        streamSequenceNumberStats = _incomingInjectedAudioSequenceNumberStatsMap.value(streamStats._streamIdentifier);
-    } else {
-        streamSequenceNumberStats = _incomingAvatarAudioSequenceNumberStats;
+        QHash<QUuid, SequenceNumberStats>::const_iterator it =
+            _incomingInjectedAudioSequenceNumberStatsMap.constFind(streamStats._streamIdentifier);
+        sequenceNumberStats = (it == _incomingInjectedAudioSequenceNumberStatsMap.constEnd()) ?
+            &NO_SEQUENCE_NUMBER_STATS : &it.value();
     }
+    const SequenceNumberStats& streamSequenceNumberStats = *sequenceNumberStats;
     streamStats._jitterBufferFrames = ringBuffer->getCurrentJitterBufferFrames();
     
     streamStats._packetsReceived = streamSequenceNumberStats.getNumReceived();
@@ -232,49 +340,54 @@ void AudioMixerClientData::sendAudioStreamStatsPackets(const SharedNodePointer&
     }
 }
 
-QString AudioMixerClientData::getAudioStreamStatsString() const {
+QString AudioMixerClientData::closeAudioStreamStatsWindows(AudioStreamStats& windowTotals, int& numFlaggedStreams) {
+    // a stream is only worth a closer look if it lost more than this share of its packets over the window...
+    const float FLAGGED_LOSS_RATIO = 0.01f;
+    // ...or its jitter buffer was at least this long in one mix in a hundred
+    const int FLAGGED_JITTER_BUFFER_FRAMES = 10;
+    const float JITTER_PERCENTILE = 0.99f;
+    const float MEDIAN_PERCENTILE = 0.5f;
+    
     QString result;
-    AvatarAudioRingBuffer* avatarRingBuffer = getAvatarAudioRingBuffer();
-    if (avatarRingBuffer) {
-        int desiredJitterBuffer = avatarRingBuffer->getDesiredJitterBufferFrames();
-        int calculatedJitterBuffer = avatarRingBuffer->getCalculatedDesiredJitterBufferFrames();
-        int currentJitterBuffer = avatarRingBuffer->getCurrentJitterBufferFrames();
-        int overflowCount = avatarRingBuffer->getOverflowCount();
-        int samplesAvailable = avatarRingBuffer->samplesAvailable();
-        int framesAvailable = (samplesAvailable / avatarRingBuffer->getSamplesPerFrame());
-        AudioStreamStats streamStats = getAudioStreamStatsOfStream(avatarRingBuffer);
-        result += "mic.desired:" + QString::number(desiredJitterBuffer)
-            + " calculated:" + QString::number(calculatedJitterBuffer)
-            + " current:" + QString::number(currentJitterBuffer)
-            + " available:" + QString::number(framesAvailable)
-            + " samples:" + QString::number(samplesAvailable)
-            + " overflows:" + QString::number(overflowCount)
+    QHash<const PositionalAudioRingBuffer*, AudioStreamStatsWindow> openWindows;
+    for (int i = 0; i < _ringBuffers.size(); i++) {
+        PositionalAudioRingBuffer* ringBuffer = _ringBuffers[i];
+        
+        // the windows are carried over stream by stream, which leaves out those of streams that have gone
+        AudioStreamStatsWindow& window = openWindows[ringBuffer] = _audioStreamStatsWindows.value(ringBuffer);
+        AudioStreamStats streamStats = window.close(getAudioStreamStatsOfStream(ringBuffer));
+        
+        windowTotals._packetsReceived += streamStats._packetsReceived;
+        windowTotals._packetsUnreasonable += streamStats._packetsUnreasonable;
+        windowTotals._packetsEarly += streamStats._packetsEarly;
+        windowTotals._packetsLate += streamStats._packetsLate;
+        windowTotals._packetsLost += streamStats._packetsLost;
+        windowTotals._packetsRecovered += streamStats._packetsRecovered;
+        windowTotals._packetsDuplicate += streamStats._packetsDuplicate;
+        
+        quint32 packetsExpected = streamStats._packetsReceived + streamStats._packetsLost;
+        bool isLossy = packetsExpected > 0 && streamStats._packetsLost > FLAGGED_LOSS_RATIO * packetsExpected;
+        int jitterBufferFrames = window.getJitterBufferFramesAtPercentile(JITTER_PERCENTILE);
+        if (!isLossy && jitterBufferFrames < FLAGGED_JITTER_BUFFER_FRAMES) {
+            continue;
+        }
+        numFlaggedStreams++;
+        if (!result.isEmpty()) {
+            result += "| ";
+        }
+        result += (ringBuffer->getType() == PositionalAudioRingBuffer::Injector ?
+                "injected[" + QString::number(i) + "]" : QString("mic"))
+            + ".desired:" + QString::number(ringBuffer->getDesiredJitterBufferFrames())
+            + " calculated:" + QString::number(ringBuffer->getCalculatedDesiredJitterBufferFrames())
+            + " p50:" + QString::number(window.getJitterBufferFramesAtPercentile(MEDIAN_PERCENTILE))
+            + " p99:" + QString::number(jitterBufferFrames)
+            + " overflows:" + QString::number(ringBuffer->getOverflowCount())
+            + " received:" + QString::number(streamStats._packetsReceived)
             + " early:" + QString::number(streamStats._packetsEarly)
             + " late:" + QString::number(streamStats._packetsLate)
             + " lost:" + QString::number(streamStats._packetsLost);
-    } else {
-        result = "mic unknown";
-    }
-    
-    for (int i = 0; i < _ringBuffers.size(); i++) {
-        if (_ringBuffers[i]->getType() == PositionalAudioRingBuffer::Injector) {
-            int desiredJitterBuffer = _ringBuffers[i]->getDesiredJitterBufferFrames();
-            int calculatedJitterBuffer = _ringBuffers[i]->getCalculatedDesiredJitterBufferFrames();
-            int currentJitterBuffer = _ringBuffers[i]->getCurrentJitterBufferFrames();
-            int overflowCount = _ringBuffers[i]->getOverflowCount();
-            int samplesAvailable = _ringBuffers[i]->samplesAvailable();
-            int framesAvailable = (samplesAvailable / _ringBuffers[i]->getSamplesPerFrame());
-            AudioStreamStats streamStats = getAudioStreamStatsOfStream(_ringBuffers[i]);
-            result += "| injected[" + QString::number(i) + "].desired:" + QString::number(desiredJitterBuffer)
-                + " calculated:" + QString::number(calculatedJitterBuffer)
-                + " current:" + QString::number(currentJitterBuffer)
-                + " available:" + QString::number(framesAvailable)
-                + " samples:" + QString::number(samplesAvailable)
-                + " overflows:" + QString::number(overflowCount)
-                + " early:" + QString::number(streamStats._packetsEarly)
-                + " late:" + QString::number(streamStats._packetsLate)
-                + " lost:" + QString::number(streamStats._packetsLost);
-        }
     }
+    _audioStreamStatsWindows.swap(openWindows);
+    _hasFlaggedAudioStreams = !result.isEmpty();
     return result;
 }
@@ -20,6 +20,43 @@
 #include "AudioStreamStats.h"
 #include "SequenceNumberStats.h"
 
+/// The spatialization the mixer calculated for one source heard by this listener. It is reused for as long as
+/// neither the source nor the listener moves or turns.
+class SpatializationParameters {
+public:
+    SpatializationParameters();
+    
+    /// returns true if the parameters were calculated for the current placement of this source and listener
+    bool isCurrentFor(const PositionalAudioRingBuffer* source, const PositionalAudioRingBuffer* listener) const;
+    void setCalculatedFor(const PositionalAudioRingBuffer* source, const PositionalAudioRingBuffer* listener);
+    
+    bool wasUsed() const { return _wasUsed; }
+    void setWasUsed(bool wasUsed) { _wasUsed = wasUsed; }
+    
+    float distance;
+    bool shouldAttenuate;
+    float attenuationCoefficient;
+    float bearingRelativeAngleToSource;
+    int numSamplesDelay;
+    float weakChannelAmplitudeRatio;
+    
+    /// the bearing the HRTF filters of this pair were last mixed at, the next frame interpolates away from it
+    bool hasHRTFBearing;
+    float hrtfBearing;
+    
+private:
+    bool _hasBeenCalculated;
+    bool _wasUsed;
+    
+    glm::vec3 _sourcePosition;
+    glm::quat _sourceOrientation;
+    float _sourceRadius;
+    float _sourceAttenuationRatio;
+    AABox* _listenerUnattenuatedZone;
+    glm::vec3 _listenerPosition;
+    glm::quat _listenerOrientation;
+};
+
 class AudioMixerClientData : public NodeData {
 public:
     AudioMixerClientData();
@@ -29,23 +66,42 @@ public:
     AvatarAudioRingBuffer* getAvatarAudioRingBuffer() const;
     
     int parseData(const QByteArray& packet);
+    quint32 getNumPacketsLost() const;
     void checkBuffersBeforeFrameSend(AABox* checkSourceZone = NULL, AABox* listenerZone = NULL);
     void pushBuffersAfterFrameSend();
 
     AudioStreamStats getAudioStreamStatsOfStream(const PositionalAudioRingBuffer* ringBuffer) const;
-    QString getAudioStreamStatsString() const;
+    
+    /// ends the stats window of each stream, adding its counts to the totals given. Returns the details of the streams
+    /// that lost or held back too much over the window, counted in numFlaggedStreams, or an empty string if none did
+    QString closeAudioStreamStatsWindows(AudioStreamStats& windowTotals, int& numFlaggedStreams);
+    
+    /// whether some stream was flagged when the windows were last closed
+    bool hasFlaggedAudioStreams() const { return _hasFlaggedAudioStreams; }
     
     void sendAudioStreamStatsPackets(const SharedNodePointer& destinationNode) const;
     
     void incrementOutgoingMixedAudioSequenceNumber() { _outgoingMixedAudioSequenceNumber++; }
     quint16 getOutgoingSequenceNumber() const { return _outgoingMixedAudioSequenceNumber; }
+    
+    /// returns the cached spatialization of a source heard by this listener and marks it as used
+    SpatializationParameters& getSpatializationParameters(const PositionalAudioRingBuffer* source);
+    
+    /// called once per mix for this listener, periodically drops the parameters of sources it no longer hears
+    void pruneSpatializationParameters();
 
 private:
     QList<PositionalAudioRingBuffer*> _ringBuffers;
+    
+    QHash<const PositionalAudioRingBuffer*, SpatializationParameters> _spatializationParameters;
+    int _mixesSinceSpatializationPrune;
 
     quint16 _outgoingMixedAudioSequenceNumber;
     SequenceNumberStats _incomingAvatarAudioSequenceNumberStats;
     QHash<QUuid, SequenceNumberStats> _incomingInjectedAudioSequenceNumberStatsMap;
+    
+    QHash<const PositionalAudioRingBuffer*, AudioStreamStatsWindow> _audioStreamStatsWindows;
+    bool _hasFlaggedAudioStreams;
 };
 
 #endif // hifi_AudioMixerClientData_h
@@ -0,0 +1,118 @@
+//
+//  AudioSourceGrid.cpp
+//  assignment-client/src/audio
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#include <QtCore/QtAlgorithms>
+
+#include <PositionalAudioRingBuffer.h>
+#include <SharedUtil.h>
+
+#include "AudioSourceGrid.h"
+
+static bool audioSourceIndexLessThan(const AudioSource& first, const AudioSource& second) {
+    return first.index < second.index;
+}
+
+AudioSourceGrid::AudioSourceGrid(float cellSize) :
+    _cellSize(cellSize),
+    _cells(),
+    _numSources(0),
+    _maxLoudness(0.0f)
+{
+    
+}
+
+void AudioSourceGrid::clear() {
+    _cells.clear();
+    _numSources = 0;
+    _maxLoudness = 0.0f;
+}
+
+void AudioSourceGrid::addSource(Node* node, PositionalAudioRingBuffer* buffer) {
+    glm::ivec3 coordinates = getCellCoordinates(buffer->getPosition());
+    Cell& cell = _cells[getCellKey(coordinates)];
+    
+    if (cell.sources.isEmpty()) {
+        cell.minimum = glm::vec3(coordinates) * _cellSize;
+    }
+    
+    float loudness = buffer->getNextOutputTrailingLoudness();
+    cell.maxLoudness = glm::max(cell.maxLoudness, loudness);
+    _maxLoudness = glm::max(_maxLoudness, loudness);
+    
+    cell.sources.append(AudioSource(node, buffer, _numSources++));
+}
+
+QList<QVector<AudioSource> > AudioSourceGrid::getSourcesByCell() const {
+    QList<QVector<AudioSource> > sourcesByCell;
+    for (QHash<quint64, Cell>::const_iterator it = _cells.constBegin(); it != _cells.constEnd(); it++) {
+        sourcesByCell.append(it.value().sources);
+    }
+    return sourcesByCell;
+}
+
+void AudioSourceGrid::findAudibleSources(const glm::vec3& listenerPosition, float minAudibilityThreshold,
+                                         QVector<AudioSource>& sources) const {
+    sources.clear();
+    
+    if (_numSources == 0) {
+        return;
+    }
+    
+    // nothing can be heard past the distance at which the loudest source in the frame drops below the threshold
+    float maxAudibleDistance = _maxLoudness / minAudibilityThreshold;
+    float cellsPerSide = (2.0f * ceilf(maxAudibleDistance / _cellSize)) + 1.0f;
+    
+    if (cellsPerSide * cellsPerSide * cellsPerSide >= _cells.size()) {
+        // the audible box covers more cells than we have, just check every occupied one
+        for (QHash<quint64, Cell>::const_iterator it = _cells.constBegin(); it != _cells.constEnd(); it++) {
+            appendAudibleSources(it.value(), listenerPosition, minAudibilityThreshold, sources);
+        }
+    } else {
+        glm::ivec3 minimum = getCellCoordinates(listenerPosition - glm::vec3(maxAudibleDistance));
+        glm::ivec3 maximum = getCellCoordinates(listenerPosition + glm::vec3(maxAudibleDistance));
+        
+        for (int x = minimum.x; x <= maximum.x; x++) {
+            for (int y = minimum.y; y <= maximum.y; y++) {
+                for (int z = minimum.z; z <= maximum.z; z++) {
+                    QHash<quint64, Cell>::const_iterator it = _cells.constFind(getCellKey(glm::ivec3(x, y, z)));
+                    if (it != _cells.constEnd()) {
+                        appendAudibleSources(it.value(), listenerPosition, minAudibilityThreshold, sources);
+                    }
+                }
+            }
+        }
+    }
+    
+    // hand the sources back in the order they were added so the mix is summed in the same order as before
+    qSort(sources.begin(), sources.end(), audioSourceIndexLessThan);
+}
+
+void AudioSourceGrid::appendAudibleSources(const Cell& cell, const glm::vec3& listenerPosition,
+                                           float minAudibilityThreshold, QVector<AudioSource>& sources) const {
+    // the closest any source in the cell can be to the listener
+    glm::vec3 closestPoint = glm::clamp(listenerPosition, cell.minimum, cell.minimum + glm::vec3(_cellSize));
+    float distance = glm::max(glm::distance(listenerPosition, closestPoint), EPSILON);
+    
+    if (cell.maxLoudness / distance > minAudibilityThreshold) {
+        sources += cell.sources;
+    }
+}
+
+glm::ivec3 AudioSourceGrid::getCellCoordinates(const glm::vec3& position) const {
+    return glm::ivec3(glm::floor(position / _cellSize));
+}
+
+quint64 AudioSourceGrid::getCellKey(const glm::ivec3& coordinates) {
+    // pack 21 bits of each coordinate into the key
+    const quint64 COORDINATE_MASK = 0x1FFFFF;
+    const int BITS_PER_COORDINATE = 21;
+    return ((coordinates.x & COORDINATE_MASK) << (BITS_PER_COORDINATE * 2))
+        | ((coordinates.y & COORDINATE_MASK) << BITS_PER_COORDINATE) | (coordinates.z & COORDINATE_MASK);
+}
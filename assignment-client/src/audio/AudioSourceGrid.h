@@ -0,0 +1,76 @@
+//
+//  AudioSourceGrid.h
+//  assignment-client/src/audio
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#ifndef hifi_AudioSourceGrid_h
+#define hifi_AudioSourceGrid_h
+
+#include <glm/glm.hpp>
+
+#include <QtCore/QHash>
+#include <QtCore/QVector>
+
+class Node;
+class PositionalAudioRingBuffer;
+
+const float DEFAULT_AUDIO_SOURCE_GRID_CELL_SIZE = 16.0f;
+
+/// One ring buffer that will be mixed this frame, along with the node that sent it.
+class AudioSource {
+public:
+    AudioSource() : node(NULL), buffer(NULL), index(0) { }
+    AudioSource(Node* node, PositionalAudioRingBuffer* buffer, int index) : node(node), buffer(buffer), index(index) { }
+    
+    Node* node;
+    PositionalAudioRingBuffer* buffer;
+    int index; ///< the order the source was added to the grid, used to keep the mix order stable
+};
+
+/// Hashed uniform grid of the frame's audio sources, rebuilt once per frame so that each listener only visits the
+/// cells holding sources loud enough to reach it.
+class AudioSourceGrid {
+public:
+    AudioSourceGrid(float cellSize = DEFAULT_AUDIO_SOURCE_GRID_CELL_SIZE);
+    
+    void clear();
+    void addSource(Node* node, PositionalAudioRingBuffer* buffer);
+    
+    int getNumSources() const { return _numSources; }
+    
+    /// returns the sources of every occupied cell, one list per cell
+    QList<QVector<AudioSource> > getSourcesByCell() const;
+    
+    /// fills sources with every source that could be above minAudibilityThreshold at the listener position,
+    /// in the order the sources were added
+    void findAudibleSources(const glm::vec3& listenerPosition, float minAudibilityThreshold,
+                            QVector<AudioSource>& sources) const;
+    
+private:
+    class Cell {
+    public:
+        Cell() : maxLoudness(0.0f) { }
+        
+        glm::vec3 minimum;
+        float maxLoudness;
+        QVector<AudioSource> sources;
+    };
+    
+    glm::ivec3 getCellCoordinates(const glm::vec3& position) const;
+    static quint64 getCellKey(const glm::ivec3& coordinates);
+    
+    void appendAudibleSources(const Cell& cell, const glm::vec3& listenerPosition, float minAudibilityThreshold,
+                              QVector<AudioSource>& sources) const;
+    
+    float _cellSize;
+    QHash<quint64, Cell> _cells;
+    int _numSources;
+    float _maxLoudness;
+};
+
+#endif // hifi_AudioSourceGrid_h
@@ -0,0 +1,95 @@
+//
+//  AvatarGrid.cpp
+//  assignment-client/src/avatars
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#include <QtCore/QtAlgorithms>
+
+#include "AvatarGrid.h"
+
+// an avatar within this many meters is sent every frame, one twice as far every other frame and so on
+const float FULL_RATE_DISTANCE = 2.0f;
+
+// an avatar behind a node is updated half as often as one the same distance in front of it
+const float BEHIND_INTERVAL_SCALE = 2.0f;
+
+AvatarGrid::AvatarGrid(float cellSize) :
+    _cellSize(cellSize),
+    _cells()
+{
+    
+}
+
+void AvatarGrid::clear() {
+    _cells.clear();
+}
+
+void AvatarGrid::addAvatar(int index, const glm::vec3& position) {
+    glm::ivec3 coordinates = getCellCoordinates(position);
+    quint64 key = getCellKey(coordinates);
+    Cell& cell = _cells[key];
+    
+    if (cell.avatars.isEmpty()) {
+        cell.minimum = glm::vec3(coordinates) * _cellSize;
+        
+        // the cells take turns, so that the far avatars of a node don't all come due on the same frame
+        cell.phase = qHash(key);
+    }
+    
+    cell.avatars.append(Entry(index, position));
+}
+
+int AvatarGrid::getUpdateInterval(float distance, float intervalScale) {
+    float frames = (distance / FULL_RATE_DISTANCE) * intervalScale;
+    int interval = 1;
+    while (interval < frames && interval < MAX_AVATAR_UPDATE_INTERVAL_FRAMES) {
+        interval <<= 1;
+    }
+    return interval;
+}
+
+void AvatarGrid::findAvatarsToSend(const glm::vec3& position, const glm::vec3& direction, quint64 frame,
+                                   float intervalScale, uint nodePhase, QVector<int>& indices) const {
+    indices.clear();
+    
+    for (QHash<quint64, Cell>::const_iterator it = _cells.constBegin(); it != _cells.constEnd(); it++) {
+        const Cell& cell = it.value();
+        quint64 cellFrame = frame + cell.phase + nodePhase;
+        
+        // no avatar in the cell is any closer than its closest point, or more often due than that distance makes it
+        glm::vec3 closestPoint = glm::clamp(position, cell.minimum, cell.minimum + glm::vec3(_cellSize));
+        if (cellFrame % getUpdateInterval(glm::distance(position, closestPoint), intervalScale) != 0) {
+            continue;
+        }
+        
+        foreach (const Entry& avatar, cell.avatars) {
+            glm::vec3 offset = avatar.position - position;
+            float avatarIntervalScale = (glm::dot(offset, direction) < 0.0f)
+                ? intervalScale * BEHIND_INTERVAL_SCALE : intervalScale;
+            
+            if (cellFrame % getUpdateInterval(glm::length(offset), avatarIntervalScale) == 0) {
+                indices.append(avatar.index);
+            }
+        }
+    }
+    
+    // the packets go out in the order the avatars were added, whatever order the cells were visited in
+    qSort(indices);
+}
+
+glm::ivec3 AvatarGrid::getCellCoordinates(const glm::vec3& position) const {
+    return glm::ivec3(glm::floor(position / _cellSize));
+}
+
+quint64 AvatarGrid::getCellKey(const glm::ivec3& coordinates) {
+    // pack 21 bits of each coordinate into the key
+    const quint64 COORDINATE_MASK = 0x1FFFFF;
+    const int BITS_PER_COORDINATE = 21;
+    return ((coordinates.x & COORDINATE_MASK) << (BITS_PER_COORDINATE * 2))
+        | ((coordinates.y & COORDINATE_MASK) << BITS_PER_COORDINATE) | (coordinates.z & COORDINATE_MASK);
+}
@@ -0,0 +1,67 @@
+//
+//  AvatarGrid.h
+//  assignment-client/src/avatars
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#ifndef hifi_AvatarGrid_h
+#define hifi_AvatarGrid_h
+
+#include <glm/glm.hpp>
+
+#include <QtCore/QHash>
+#include <QtCore/QVector>
+
+const float DEFAULT_AVATAR_GRID_CELL_SIZE = 8.0f;
+
+// the longest a node goes without an update of any avatar, however far away or behind it the avatar is
+const int MAX_AVATAR_UPDATE_INTERVAL_FRAMES = 64;
+
+/// Hashed uniform grid of the avatars broadcast this frame, rebuilt once per frame. Each node is sent an avatar every
+/// so many frames depending on how far away the avatar is, and whole cells whose avatars are all too far away to be
+/// due this frame are passed over without looking at any avatar in them.
+class AvatarGrid {
+public:
+    AvatarGrid(float cellSize = DEFAULT_AVATAR_GRID_CELL_SIZE);
+    
+    void clear();
+    void addAvatar(int index, const glm::vec3& position);
+    
+    /// fills indices with the avatars due to be sent this frame to a node at position looking along direction
+    /// intervalScale stretches every update interval, nodePhase staggers the updates of different nodes
+    void findAvatarsToSend(const glm::vec3& position, const glm::vec3& direction, quint64 frame, float intervalScale,
+                           uint nodePhase, QVector<int>& indices) const;
+    
+    /// returns the number of frames between the updates of an avatar at a distance, always a power of two so
+    /// that the frames an avatar is due on are also due for any nearer avatar with the same phase
+    static int getUpdateInterval(float distance, float intervalScale);
+    
+private:
+    class Entry {
+    public:
+        Entry() : index(0), position() { }
+        Entry(int index, const glm::vec3& position) : index(index), position(position) { }
+        
+        int index;
+        glm::vec3 position;
+    };
+    
+    class Cell {
+    public:
+        glm::vec3 minimum;
+        uint phase;
+        QVector<Entry> avatars;
+    };
+    
+    glm::ivec3 getCellCoordinates(const glm::vec3& position) const;
+    static quint64 getCellKey(const glm::ivec3& coordinates);
+    
+    float _cellSize;
+    QHash<quint64, Cell> _cells;
+};
+
+#endif // hifi_AvatarGrid_h
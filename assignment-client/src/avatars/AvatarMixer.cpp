@@ -9,18 +9,24 @@
 //  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
 //
 
+#include <glm/gtc/quaternion.hpp>
+
 #include <QtCore/QCoreApplication>
 #include <QtCore/QDateTime>
 #include <QtCore/QJsonObject>
+#include <QtCore/QPair>
+#include <QtCore/QRunnable>
 #include <QtCore/QTimer>
 #include <QtCore/QThread>
 
 #include <Logging.h>
+#include <Metrics.h>
 #include <NodeList.h>
 #include <PacketHeaders.h>
 #include <SharedUtil.h>
 #include <UUID.h>
 
+#include "AllocationCounter.h"
 #include "AvatarMixerClientData.h"
 
 #include "AvatarMixer.h"
@@ -32,13 +38,23 @@ const unsigned int AVATAR_DATA_SEND_INTERVAL_MSECS = (1.0f / 60.0f) * 1000;
 AvatarMixer::AvatarMixer(const QByteArray& packet) :
     ThreadedAssignment(packet),
     _broadcastThread(),
+    _broadcastAvatars(),
+    _numBroadcastAvatars(0),
+    _avatarGrid(),
+    _frameNumber(0),
+    _broadcastThreadPool(),
+    _numBroadcastThreads(qMax(QThread::idealThreadCount(), 1)),
     _lastFrameTimestamp(QDateTime::currentMSecsSinceEpoch()),
     _trailingSleepRatio(1.0f),
     _performanceThrottlingRatio(0.0f),
     _sumListeners(0),
+    _sumAvatarsSent(0),
     _numStatFrames(0),
     _sumBillboardPackets(0),
-    _sumIdentityPackets(0)
+    _sumIdentityPackets(0),
+    _sumContentHashesPackets(0),
+    _sumReceivedPackets(0),
+    _sumReceiveAllocations(0)
 {
     // make sure we hear about node kills so we can tell the other nodes
     connect(NodeList::getInstance(), &NodeList::nodeKilled, this, &AvatarMixer::nodeKilled);
@@ -55,11 +71,216 @@ void attachAvatarDataToNode(Node* newNode) {
     }
 }
 
-const float BILLBOARD_AND_IDENTITY_SEND_PROBABILITY = 1.0f / 300.0f;
+// the hashes of the billboard and identity of an avatar are small, so a node is reminded of them about once a second
+const float CONTENT_HASHES_SEND_PROBABILITY = 1.0f / 60.0f;
+
+// fewer listeners than this are not worth handing to another thread
+const int MIN_LISTENERS_PER_PARTITION = 16;
+
+/// Assembles the packets of a contiguous range of the frame's listeners, so that partitions can run on separate threads
+/// of the broadcast pool. The other avatars are only read from the snapshots of the frame, which nothing changes while
+/// the partitions run, and the packets are sent afterwards from the broadcast thread.
+class AvatarMixerPartition : public QRunnable {
+public:
+    
+    AvatarMixerPartition(AvatarMixer* mixer, const QList<SharedNodePointer>& listeners,
+                         int firstListener, int numListeners, float intervalScale);
+    
+    virtual void run();
+    
+    /// sends the packets assembled by run to their listeners
+    void sendPackets(const QList<SharedNodePointer>& listeners);
+    
+    int getNumListenersSent() const { return _numListenersSent; }
+    int getNumAvatarsSent() const { return _numAvatarsSent; }
+    int getNumBillboardPackets() const { return _numBillboardPackets; }
+    int getNumIdentityPackets() const { return _numIdentityPackets; }
+    int getNumContentHashesPackets() const { return _numContentHashesPackets; }
+    
+private:
+    
+    void addPacket(int listener, const QByteArray& packet) { _packets.append(qMakePair(listener, packet)); }
+    
+    AvatarMixer* _mixer;
+    const QList<SharedNodePointer>& _listeners;
+    int _firstListener;
+    int _numListeners;
+    float _intervalScale;
+    
+    QVector<int> _avatarsToSend;
+    QList<QPair<int, QByteArray> > _packets;
+    
+    int _numListenersSent;
+    int _numAvatarsSent;
+    int _numBillboardPackets;
+    int _numIdentityPackets;
+    int _numContentHashesPackets;
+};
+
+AvatarMixerPartition::AvatarMixerPartition(AvatarMixer* mixer, const QList<SharedNodePointer>& listeners,
+                                           int firstListener, int numListeners, float intervalScale) :
+    _mixer(mixer),
+    _listeners(listeners),
+    _firstListener(firstListener),
+    _numListeners(numListeners),
+    _intervalScale(intervalScale),
+    _avatarsToSend(),
+    _packets(),
+    _numListenersSent(0),
+    _numAvatarsSent(0),
+    _numBillboardPackets(0),
+    _numIdentityPackets(0),
+    _numContentHashesPackets(0)
+{
+    // the mixer waits on the partitions and sends their packets, so it owns them
+    setAutoDelete(false);
+}
+
+void AvatarMixerPartition::run() {
+    QByteArray mixedAvatarByteArray;
+    int numPacketHeaderBytes = populatePacketHeader(mixedAvatarByteArray, PacketTypeBulkAvatarData);
+    
+    QByteArray contentHashesByteArray;
+    int numContentHashesHeaderBytes = populatePacketHeader(contentHashesByteArray, PacketTypeAvatarContentHashes);
+    
+    for (int i = _firstListener; i < _firstListener + _numListeners; i++) {
+        const SharedNodePointer& node = _listeners.at(i);
+        AvatarMixerClientData* nodeData = reinterpret_cast<AvatarMixerClientData*>(node->getLinkedData());
+        
+        // only the lock of the listener itself is taken, so that two partitions can never wait on each other
+        if (!nodeData->getMutex().tryLock()) {
+            continue;
+        }
+        ++_numListenersSent;
+        
+        // reset packet pointers for this node
+        mixedAvatarByteArray.resize(numPacketHeaderBytes);
+        contentHashesByteArray.resize(numContentHashesHeaderBytes);
+        
+        AvatarData& avatar = nodeData->getAvatar();
+        glm::vec3 myPosition = avatar.getPosition();
+        glm::quat myOrientation = avatar.getHeadData() ? avatar.getHeadOrientation() : avatar.getOrientation();
+        
+        // this is an AGENT we have received head data from
+        // send back a packet with the other avatars that are due to be updated for this node
+        _mixer->_avatarGrid.findAvatarsToSend(myPosition, myOrientation * glm::vec3(0.0f, 0.0f, -1.0f),
+                                              _mixer->_frameNumber, _intervalScale, qHash(node->getUUID()),
+                                              _avatarsToSend);
+        
+        foreach (int avatarIndex, _avatarsToSend) {
+            const BroadcastAvatar& otherAvatar = _mixer->_broadcastAvatars.at(avatarIndex);
+            if (otherAvatar.nodeData == nodeData) {
+                continue;
+            }
+            ++_numAvatarsSent;
+            
+            // the key frame goes ahead of the delta if this node hasn't had it yet
+            bool needsKeyFrame = !otherAvatar.keyFrame.isEmpty()
+                && !nodeData->hasBeenSentKeyFrame(otherAvatar.node->getUUID(), otherAvatar.keyFrameSequence);
+            int avatarBytes = otherAvatar.data.size() + (needsKeyFrame ? otherAvatar.keyFrame.size() : 0);
+            
+            if (avatarBytes + mixedAvatarByteArray.size() > MAX_PACKET_SIZE) {
+                addPacket(i, mixedAvatarByteArray);
+                
+                // reset the packet
+                mixedAvatarByteArray.resize(numPacketHeaderBytes);
+            }
+            
+            // copy the avatar serialized for this frame into the mixedAvatarByteArray packet
+            if (needsKeyFrame) {
+                mixedAvatarByteArray.append(otherAvatar.keyFrame);
+            }
+            mixedAvatarByteArray.append(otherAvatar.data);
+            nodeData->setSentKeyFrame(otherAvatar.node->getUUID(), otherAvatar.keyFrameSequence);
+            
+            // if the receiving avatar has just connected make sure we send out the mesh and billboard
+            // for this avatar (assuming they exist)
+            bool forceSend = !nodeData->checkAndSetHasReceivedFirstPackets();
+            
+            // we will also send the billboard or identity if either has changed in the last frame, or if the node
+            // asked for it when it found that the hash of what it has doesn't match
+            unsigned char requestedContent = nodeData->takeRequestedContent(otherAvatar.node->getUUID());
+            
+            bool shouldSendBillboard = otherAvatar.billboardChangeTimestamp > 0
+                && (forceSend
+                    || otherAvatar.billboardChangeTimestamp > _mixer->_lastFrameTimestamp
+                    || (requestedContent & AVATAR_BILLBOARD_CONTENT));
+            if (shouldSendBillboard) {
+                QByteArray billboardPacket = byteArrayWithPopulatedHeader(PacketTypeAvatarBillboard);
+                billboardPacket.append(otherAvatar.node->getUUID().toRfc4122());
+                billboardPacket.append(otherAvatar.billboard);
+                addPacket(i, billboardPacket);
+                
+                ++_numBillboardPackets;
+            }
+            
+            bool shouldSendIdentity = otherAvatar.identityChangeTimestamp > 0
+                && (forceSend
+                    || otherAvatar.identityChangeTimestamp > _mixer->_lastFrameTimestamp
+                    || (requestedContent & AVATAR_IDENTITY_CONTENT));
+            if (shouldSendIdentity) {
+                QByteArray identityPacket = byteArrayWithPopulatedHeader(PacketTypeAvatarIdentity);
+                identityPacket.append(otherAvatar.identity);
+                addPacket(i, identityPacket);
+                
+                ++_numIdentityPackets;
+            }
+            
+            // every so often the node is sent only the hashes of what it wasn't just sent, rather than all of it
+            if (randFloat() < CONTENT_HASHES_SEND_PROBABILITY) {
+                unsigned char contentFlags = 0;
+                int contentHashesBytes = NUM_BYTES_RFC4122_UUID + sizeof(contentFlags);
+                if (!shouldSendIdentity && !otherAvatar.identityHash.isEmpty()) {
+                    contentFlags |= AVATAR_IDENTITY_CONTENT;
+                    contentHashesBytes += NUM_BYTES_MD5_HASH;
+                }
+                if (!shouldSendBillboard && !otherAvatar.billboardHash.isEmpty()) {
+                    contentFlags |= AVATAR_BILLBOARD_CONTENT;
+                    contentHashesBytes += NUM_BYTES_MD5_HASH;
+                }
+                
+                if (contentFlags != 0) {
+                    if (contentHashesBytes + contentHashesByteArray.size() > MAX_PACKET_SIZE) {
+                        addPacket(i, contentHashesByteArray);
+                        contentHashesByteArray.resize(numContentHashesHeaderBytes);
+                        
+                        ++_numContentHashesPackets;
+                    }
+                    
+                    // the serialized avatar starts with the UUID of its node
+                    contentHashesByteArray.append(otherAvatar.data.constData(), NUM_BYTES_RFC4122_UUID);
+                    contentHashesByteArray.append((char) contentFlags);
+                    if (contentFlags & AVATAR_IDENTITY_CONTENT) {
+                        contentHashesByteArray.append(otherAvatar.identityHash);
+                    }
+                    if (contentFlags & AVATAR_BILLBOARD_CONTENT) {
+                        contentHashesByteArray.append(otherAvatar.billboardHash);
+                    }
+                }
+            }
+        }
+        
+        if (contentHashesByteArray.size() > numContentHashesHeaderBytes) {
+            addPacket(i, contentHashesByteArray);
+            
+            ++_numContentHashesPackets;
+        }
+        
+        addPacket(i, mixedAvatarByteArray);
+        
+        nodeData->getMutex().unlock();
+    }
+}
+
+void AvatarMixerPartition::sendPackets(const QList<SharedNodePointer>& listeners) {
+    NodeList* nodeList = NodeList::getInstance();
+    for (int i = 0; i < _packets.size(); i++) {
+        nodeList->queueDatagram(_packets.at(i).second, listeners.at(_packets.at(i).first));
+    }
+}
 
-// NOTE: some additional optimizations to consider.
-//    1) use the view frustum to cull those avatars that are out of view. Since avatar data doesn't need to be present
-//       if the avatar is not in view or in the keyhole.
+// the mixer doesn't know the view frustum of a node, so the avatars behind where its head is facing stand in for the
+// ones out of its view and are updated less often
 void AvatarMixer::broadcastAvatarData() {
     
     int idleTime = QDateTime::currentMSecsSinceEpoch() - _lastFrameTimestamp;
@@ -113,107 +334,127 @@ void AvatarMixer::broadcastAvatarData() {
         ++framesSinceCutoffEvent;
     }
     
-    static QByteArray mixedAvatarByteArray;
+    prepareBroadcastAvatars();
+    ++_frameNumber;
     
-    int numPacketHeaderBytes = populatePacketHeader(mixedAvatarByteArray, PacketTypeBulkAvatarData);
+    // struggling stretches the time between the updates of every avatar, up until the longest interval
+    float intervalScale = 1.0f / qMax(1.0f - _performanceThrottlingRatio, 1.0f / MAX_AVATAR_UPDATE_INTERVAL_FRAMES);
     
     NodeList* nodeList = NodeList::getInstance();
     
-    AvatarMixerClientData* nodeData = NULL;
-    AvatarMixerClientData* otherNodeData = NULL;
-    
+    QList<SharedNodePointer> listeners;
     foreach (const SharedNodePointer& node, nodeList->getNodeHash()) {
-        if (node->getLinkedData() && node->getType() == NodeType::Agent && node->getActiveSocket()
-            && (nodeData = reinterpret_cast<AvatarMixerClientData*>(node->getLinkedData()))->getMutex().tryLock()) {
-            ++_sumListeners;
-            
-            // reset packet pointers for this node
-            mixedAvatarByteArray.resize(numPacketHeaderBytes);
-            
-            AvatarData& avatar = nodeData->getAvatar();
-            glm::vec3 myPosition = avatar.getPosition();
-            
-            // this is an AGENT we have received head data from
-            // send back a packet with other active node data to this node
-            foreach (const SharedNodePointer& otherNode, nodeList->getNodeHash()) {
-                if (otherNode->getLinkedData() && otherNode->getUUID() != node->getUUID()
-                    && (otherNodeData = reinterpret_cast<AvatarMixerClientData*>(otherNode->getLinkedData()))->getMutex().tryLock()) {
-                    
-                    AvatarMixerClientData* otherNodeData = reinterpret_cast<AvatarMixerClientData*>(otherNode->getLinkedData());
-                    AvatarData& otherAvatar = otherNodeData->getAvatar();
-                    glm::vec3 otherPosition = otherAvatar.getPosition();
-            
-                    float distanceToAvatar = glm::length(myPosition - otherPosition);
-                    //  The full rate distance is the distance at which EVERY update will be sent for this avatar
-                    //  at a distance of twice the full rate distance, there will be a 50% chance of sending this avatar's update
-                    const float FULL_RATE_DISTANCE = 2.f;
-                    
-                    //  Decide whether to send this avatar's data based on it's distance from us
-                    if ((_performanceThrottlingRatio == 0 || randFloat() < (1.0f - _performanceThrottlingRatio))
-                        && (distanceToAvatar == 0.f || randFloat() < FULL_RATE_DISTANCE / distanceToAvatar)) {
-                        QByteArray avatarByteArray;
-                        avatarByteArray.append(otherNode->getUUID().toRfc4122());
-                        avatarByteArray.append(otherAvatar.toByteArray());
-                        
-                        if (avatarByteArray.size() + mixedAvatarByteArray.size() > MAX_PACKET_SIZE) {
-                            nodeList->writeDatagram(mixedAvatarByteArray, node);
-                            
-                            // reset the packet
-                            mixedAvatarByteArray.resize(numPacketHeaderBytes);
-                        }
-                        
-                        // copy the avatar into the mixedAvatarByteArray packet
-                        mixedAvatarByteArray.append(avatarByteArray);
-                        
-                        // if the receiving avatar has just connected make sure we send out the mesh and billboard
-                        // for this avatar (assuming they exist)
-                        bool forceSend = !nodeData->checkAndSetHasReceivedFirstPackets();
-                        
-                        // we will also force a send of billboard or identity packet
-                        // if either has changed in the last frame
-                        
-                        if (otherNodeData->getBillboardChangeTimestamp() > 0
-                            && (forceSend
-                                || otherNodeData->getBillboardChangeTimestamp() > _lastFrameTimestamp
-                                || randFloat() < BILLBOARD_AND_IDENTITY_SEND_PROBABILITY)) {
-                            QByteArray billboardPacket = byteArrayWithPopulatedHeader(PacketTypeAvatarBillboard);
-                            billboardPacket.append(otherNode->getUUID().toRfc4122());
-                            billboardPacket.append(otherNodeData->getAvatar().getBillboard());
-                            nodeList->writeDatagram(billboardPacket, node);
-                            
-                            ++_sumBillboardPackets;
-                        }
-                        
-                        if (otherNodeData->getIdentityChangeTimestamp() > 0
-                            && (forceSend
-                                || otherNodeData->getIdentityChangeTimestamp() > _lastFrameTimestamp
-                                || randFloat() < BILLBOARD_AND_IDENTITY_SEND_PROBABILITY)) {
-                                
-                            QByteArray identityPacket = byteArrayWithPopulatedHeader(PacketTypeAvatarIdentity);
-                            
-                            QByteArray individualData = otherNodeData->getAvatar().identityByteArray();
-                            individualData.replace(0, NUM_BYTES_RFC4122_UUID, otherNode->getUUID().toRfc4122());
-                            identityPacket.append(individualData);
-                            
-                            nodeList->writeDatagram(identityPacket, node);
-                                
-                            ++_sumIdentityPackets;
-                        }
-                    }
-                
-                    otherNodeData->getMutex().unlock();
-                }
-            }
-            
-            nodeList->writeDatagram(mixedAvatarByteArray, node);
-            
-            nodeData->getMutex().unlock();
+        if (node->getLinkedData() && node->getType() == NodeType::Agent && node->getActiveSocket()) {
+            listeners.append(node);
         }
     }
     
+    // split the listeners into one contiguous range per thread, the broadcast thread assembles the last range itself
+    int numPartitions = qMax(qMin(_numBroadcastThreads,
+        (listeners.size() + MIN_LISTENERS_PER_PARTITION - 1) / MIN_LISTENERS_PER_PARTITION), 1);
+    int listenersPerPartition = listeners.size() / numPartitions;
+    int remainingListeners = listeners.size() % numPartitions;
+    
+    QList<AvatarMixerPartition*> partitions;
+    int firstListener = 0;
+    
+    for (int i = 0; i < numPartitions; i++) {
+        int numListeners = listenersPerPartition + (i < remainingListeners ? 1 : 0);
+        partitions.append(new AvatarMixerPartition(this, listeners, firstListener, numListeners, intervalScale));
+        firstListener += numListeners;
+        
+        if (i < numPartitions - 1) {
+            _broadcastThreadPool.start(partitions.last());
+        }
+    }
+    
+    partitions.last()->run();
+    _broadcastThreadPool.waitForDone();
+    
+    static MetricCounter& avatarsSentCounter = MetricsRegistry::getInstance().getCounter(
+        "hifi_avatar_mixer_avatars_sent_total", "The avatars the avatar mixer sent to its listeners.");
+    
+    // send the packets from the broadcast thread, in listener order
+    foreach (AvatarMixerPartition* partition, partitions) {
+        partition->sendPackets(listeners);
+        
+        _sumListeners += partition->getNumListenersSent();
+        _sumAvatarsSent += partition->getNumAvatarsSent();
+        avatarsSentCounter.increment(partition->getNumAvatarsSent());
+        _sumBillboardPackets += partition->getNumBillboardPackets();
+        _sumIdentityPackets += partition->getNumIdentityPackets();
+        _sumContentHashesPackets += partition->getNumContentHashesPackets();
+        delete partition;
+    }
+    
     _lastFrameTimestamp = QDateTime::currentMSecsSinceEpoch();
 }
 
+void AvatarMixer::prepareBroadcastAvatars() {
+    _numBroadcastAvatars = 0;
+    _avatarGrid.clear();
+    
+    foreach (const SharedNodePointer& node, NodeList::getInstance()->getNodeHash()) {
+        AvatarMixerClientData* nodeData = reinterpret_cast<AvatarMixerClientData*>(node->getLinkedData());
+        if (!nodeData || !nodeData->getMutex().tryLock()) {
+            // an avatar that is being updated right now goes out next frame
+            continue;
+        }
+        
+        if (_numBroadcastAvatars == _broadcastAvatars.size()) {
+            _broadcastAvatars.resize(_numBroadcastAvatars + 1);
+        }
+        BroadcastAvatar& broadcastAvatar = _broadcastAvatars[_numBroadcastAvatars++];
+        
+        AvatarData& avatar = nodeData->getAvatar();
+        QByteArray uuidByteArray = node->getUUID().toRfc4122();
+        QByteArray avatarByteArray = avatar.toByteArray();
+        
+        // a node that hasn't been sent the key frame of a delta gets the key frame first, which only changes every
+        // so many frames
+        if (avatar.wasLastUpdateKeyFrame()) {
+            broadcastAvatar.keyFrame.clear();
+        } else if (broadcastAvatar.node != node || broadcastAvatar.keyFrameSequence != avatar.getKeyFrameSequence()
+                   || broadcastAvatar.keyFrame.isEmpty()) {
+            broadcastAvatar.keyFrame = uuidByteArray + avatar.getLastKeyFrame();
+        }
+        broadcastAvatar.keyFrameSequence = avatar.getKeyFrameSequence();
+        
+        // the identity is only serialized and hashed again when it changes, the billboard is shared with the avatar
+        if (broadcastAvatar.node != node || broadcastAvatar.identityChangeTimestamp != nodeData->getIdentityChangeTimestamp()) {
+            broadcastAvatar.identity = avatar.identityByteArray();
+            broadcastAvatar.identity.replace(0, NUM_BYTES_RFC4122_UUID, uuidByteArray);
+            broadcastAvatar.identityHash = (nodeData->getIdentityChangeTimestamp() > 0) ?
+                hashForAvatarContent(broadcastAvatar.identity) : QByteArray();
+        }
+        if (broadcastAvatar.node != node || broadcastAvatar.billboardChangeTimestamp != nodeData->getBillboardChangeTimestamp()) {
+            broadcastAvatar.billboardHash = hashForAvatarContent(avatar.getBillboard());
+        }
+        broadcastAvatar.billboard = avatar.getBillboard();
+        
+        broadcastAvatar.node = node;
+        broadcastAvatar.nodeData = nodeData;
+        broadcastAvatar.position = avatar.getPosition();
+        broadcastAvatar.billboardChangeTimestamp = nodeData->getBillboardChangeTimestamp();
+        broadcastAvatar.identityChangeTimestamp = nodeData->getIdentityChangeTimestamp();
+        
+        // the buffer of the last frame is written over, so that it is only allocated again when an avatar grows
+        broadcastAvatar.data.resize(NUM_BYTES_RFC4122_UUID + avatarByteArray.size());
+        memcpy(broadcastAvatar.data.data(), uuidByteArray.constData(), NUM_BYTES_RFC4122_UUID);
+        memcpy(broadcastAvatar.data.data() + NUM_BYTES_RFC4122_UUID, avatarByteArray.constData(), avatarByteArray.size());
+        
+        _avatarGrid.addAvatar(_numBroadcastAvatars - 1, broadcastAvatar.position);
+        
+        nodeData->getMutex().unlock();
+    }
+    
+    // let go of the nodes that are no longer around, their data goes with them
+    for (int i = _numBroadcastAvatars; i < _broadcastAvatars.size(); i++) {
+        _broadcastAvatars[i].node.clear();
+        _broadcastAvatars[i].nodeData = NULL;
+    }
+}
+
 void AvatarMixer::nodeKilled(SharedNodePointer killedNode) {
     if (killedNode->getType() == NodeType::Agent
         && killedNode->getLinkedData()) {
@@ -228,12 +469,16 @@ void AvatarMixer::nodeKilled(SharedNodePointer killedNode) {
 }
 
 void AvatarMixer::readPendingDatagrams() {
-    QByteArray receivedPacket;
+    QByteArray& receivedPacket = _datagramBuffer;
     HifiSockAddr senderSockAddr;
     
     NodeList* nodeList = NodeList::getInstance();
     
+    // receiving is meant not to allocate once the buffers of every avatar have grown to fit, which this keeps an eye on
+    quint64 allocationsBefore = AllocationCounter::getThreadAllocations();
+    
     while (readAvailableDatagram(receivedPacket, senderSockAddr)) {
+        ++_sumReceivedPackets;
         if (nodeList->packetVersionAndHashMatch(receivedPacket)) {
             switch (packetTypeForPacket(receivedPacket)) {
                 case PacketTypeAvatarData: {
@@ -275,6 +520,26 @@ void AvatarMixer::readPendingDatagrams() {
                     }
                     break;
                 }
+                case PacketTypeAvatarContentRequest: {
+                    
+                    // check if we have a matching node in our list
+                    SharedNodePointer avatarNode = nodeList->sendingNodeForPacket(receivedPacket);
+                    
+                    if (avatarNode && avatarNode->getLinkedData()) {
+                        AvatarMixerClientData* nodeData = static_cast<AvatarMixerClientData*>(avatarNode->getLinkedData());
+                        
+                        // the contents asked for go out with the next frame that the other avatar is sent in
+                        QMutexLocker nodeDataLocker(&nodeData->getMutex());
+                        int requestBytes = NUM_BYTES_RFC4122_UUID + sizeof(unsigned char);
+                        for (int offset = numBytesForPacketHeader(receivedPacket);
+                                offset + requestBytes <= receivedPacket.size(); offset += requestBytes) {
+                            QUuid avatarUUID = QUuid::fromRfc4122(QByteArray::fromRawData(receivedPacket.constData() + offset,
+                                                                                          NUM_BYTES_RFC4122_UUID));
+                            nodeData->requestContent(avatarUUID, receivedPacket.at(offset + NUM_BYTES_RFC4122_UUID));
+                        }
+                    }
+                    break;
+                }
                 case PacketTypeKillAvatar: {
                     nodeList->processKillNode(receivedPacket);
                     break;
@@ -286,14 +551,32 @@ void AvatarMixer::readPendingDatagrams() {
             }
         }
     }
+    
+    _sumReceiveAllocations += AllocationCounter::getThreadAllocations() - allocationsBefore;
 }
 
 void AvatarMixer::sendStatsPacket() {
     QJsonObject statsObject;
     statsObject["average_listeners_last_second"] = (float) _sumListeners / (float) _numStatFrames;
     
+    if (_sumListeners > 0) {
+        statsObject["average_avatars_sent_per_listener"] = (float) _sumAvatarsSent / (float) _sumListeners;
+    } else {
+        statsObject["average_avatars_sent_per_listener"] = 0.0;
+    }
+    
     statsObject["average_billboard_packets_per_frame"] = (float) _sumBillboardPackets / (float) _numStatFrames;
     statsObject["average_identity_packets_per_frame"] = (float) _sumIdentityPackets / (float) _numStatFrames;
+    statsObject["average_content_hashes_packets_per_frame"] = (float) _sumContentHashesPackets / (float) _numStatFrames;
+    
+    if (AllocationCounter::isAvailable()) {
+        if (_sumReceivedPackets > 0) {
+            statsObject["average_allocations_per_received_packet"] =
+                (float) _sumReceiveAllocations / (float) _sumReceivedPackets;
+        } else {
+            statsObject["average_allocations_per_received_packet"] = 0.0;
+        }
+    }
     
     statsObject["trailing_sleep_percentage"] = _trailingSleepRatio * 100;
     statsObject["performance_throttling_ratio"] = _performanceThrottlingRatio;
@@ -301,9 +584,13 @@ void AvatarMixer::sendStatsPacket() {
     ThreadedAssignment::addPacketStatsAndSendStatsPacket(statsObject);
     
     _sumListeners = 0;
+    _sumAvatarsSent = 0;
     _sumBillboardPackets = 0;
     _sumIdentityPackets = 0;
+    _sumContentHashesPackets = 0;
     _numStatFrames = 0;
+    _sumReceivedPackets = 0;
+    _sumReceiveAllocations = 0;
 }
 
 void AvatarMixer::run() {
@@ -323,6 +610,10 @@ void AvatarMixer::run() {
     connect(broadcastTimer, &QTimer::timeout, this, &AvatarMixer::broadcastAvatarData, Qt::DirectConnection);
     connect(&_broadcastThread, SIGNAL(started()), broadcastTimer, SLOT(start()));
     
+    // the broadcast thread assembles one partition of the listeners itself, the pool takes the others
+    _broadcastThreadPool.setMaxThreadCount(qMax(_numBroadcastThreads - 1, 1));
+    qDebug() << "Broadcasting avatars across" << _numBroadcastThreads << "threads.";
+    
     // start the broadcastThread
     _broadcastThread.start();
 }
@@ -15,8 +15,35 @@
 #ifndef hifi_AvatarMixer_h
 #define hifi_AvatarMixer_h
 
+#include <glm/glm.hpp>
+
+#include <QtCore/QThreadPool>
+#include <QtCore/QVector>
+
+#include <Node.h>
 #include <ThreadedAssignment.h>
 
+#include "AvatarGrid.h"
+
+class AvatarMixerClientData;
+
+/// An avatar as it is broadcast this frame, serialized once and then copied into the packet of every node it is sent to.
+class BroadcastAvatar {
+public:
+    SharedNodePointer node;
+    AvatarMixerClientData* nodeData;
+    glm::vec3 position;
+    QByteArray data; ///< the UUID of the node followed by its serialized avatar
+    QByteArray keyFrame; ///< the UUID of the node followed by the key frame data is against, empty if data is one
+    quint16 keyFrameSequence;
+    QByteArray billboard;
+    QByteArray billboardHash; ///< the hash of the billboard, empty if there is none
+    QByteArray identity; ///< the identity with the UUID of the node, serialized again whenever it changes
+    QByteArray identityHash; ///< the hash of the identity, empty if the node hasn't sent one
+    quint64 billboardChangeTimestamp;
+    quint64 identityChangeTimestamp;
+};
+
 /// Handles assignments of type AvatarMixer - distribution of avatar data to various clients
 class AvatarMixer : public ThreadedAssignment {
 public:
@@ -34,9 +61,22 @@ public slots:
     void sendStatsPacket();
     
 private:
+    friend class AvatarMixerPartition;
+    
+    /// assembles the packets of every listener across the broadcast threads and sends them
     void broadcastAvatarData();
     
+    /// serializes every avatar we have data for into _broadcastAvatars, once for all of the nodes it goes to
+    void prepareBroadcastAvatars();
+    
     QThread _broadcastThread;
+    QVector<BroadcastAvatar> _broadcastAvatars;
+    int _numBroadcastAvatars;
+    AvatarGrid _avatarGrid;
+    quint64 _frameNumber;
+    
+    QThreadPool _broadcastThreadPool;
+    int _numBroadcastThreads;
     
     quint64 _lastFrameTimestamp;
     
@@ -44,9 +84,14 @@ private:
     float _performanceThrottlingRatio;
     
     int _sumListeners;
+    int _sumAvatarsSent;
     int _numStatFrames;
     int _sumBillboardPackets;
     int _sumIdentityPackets;
+    int _sumContentHashesPackets;
+    
+    int _sumReceivedPackets;
+    quint64 _sumReceiveAllocations;
 };
 
 #endif // hifi_AvatarMixer_h
@@ -17,7 +17,9 @@ AvatarMixerClientData::AvatarMixerClientData() :
     NodeData(),
     _hasReceivedFirstPackets(false),
     _billboardChangeTimestamp(0),
-    _identityChangeTimestamp(0)
+    _identityChangeTimestamp(0),
+    _sentKeyFrames(),
+    _requestedContent()
 {
     
 }
@@ -33,3 +35,16 @@ bool AvatarMixerClientData::checkAndSetHasReceivedFirstPackets() {
     _hasReceivedFirstPackets = true;
     return oldValue;
 }
+
+bool AvatarMixerClientData::hasBeenSentKeyFrame(const QUuid& avatarUUID, quint16 keyFrameSequence) const {
+    QHash<QUuid, quint16>::const_iterator sentKeyFrame = _sentKeyFrames.constFind(avatarUUID);
+    return sentKeyFrame != _sentKeyFrames.constEnd() && sentKeyFrame.value() == keyFrameSequence;
+}
+
+unsigned char AvatarMixerClientData::takeRequestedContent(const QUuid& avatarUUID) {
+    // this is asked for every other avatar sent to the node, and nearly always there is nothing to find
+    if (_requestedContent.isEmpty()) {
+        return 0;
+    }
+    return _requestedContent.take(avatarUUID);
+}
@@ -12,7 +12,9 @@
 #ifndef hifi_AvatarMixerClientData_h
 #define hifi_AvatarMixerClientData_h
 
+#include <QtCore/QHash>
 #include <QtCore/QUrl>
+#include <QtCore/QUuid>
 
 #include <AvatarData.h>
 #include <NodeData.h>
@@ -33,11 +35,23 @@ public:
     quint64 getIdentityChangeTimestamp() const { return _identityChangeTimestamp; }
     void setIdentityChangeTimestamp(quint64 identityChangeTimestamp) { _identityChangeTimestamp = identityChangeTimestamp; }
     
+    /// returns true if this node has been sent the key frame of another avatar that the deltas of it are against
+    bool hasBeenSentKeyFrame(const QUuid& avatarUUID, quint16 keyFrameSequence) const;
+    void setSentKeyFrame(const QUuid& avatarUUID, quint16 keyFrameSequence) { _sentKeyFrames.insert(avatarUUID, keyFrameSequence); }
+    
+    /// marks the identity and/or billboard of another avatar as asked for by this node
+    void requestContent(const QUuid& avatarUUID, unsigned char contentFlags) { _requestedContent[avatarUUID] |= contentFlags; }
+    
+    /// returns the contents of another avatar that this node has asked for and forgets that it asked
+    unsigned char takeRequestedContent(const QUuid& avatarUUID);
+    
 private:
     AvatarData _avatar;
     bool _hasReceivedFirstPackets;
     quint64 _billboardChangeTimestamp;
     quint64 _identityChangeTimestamp;
+    QHash<QUuid, quint16> _sentKeyFrames;
+    QHash<QUuid, unsigned char> _requestedContent;
 };
 
 #endif // hifi_AvatarMixerClientData_h
@@ -32,8 +32,13 @@ int main(int argc, char* argv[]) {
         numForks = atoi(numForksString);
     }
     
+    const char* numSparesString = getCmdOption(argc, (const char**)argv, NUM_SPARES_PARAMETER);
+    int numSpares = numSparesString ? atoi(numSparesString) : 0;
+    
+    bool pinToCores = cmdOptionExists(argc, (const char**)argv, PIN_TO_CORES_PARAMETER);
+    
     if (numForks) {
-        AssignmentClientMonitor monitor(argc, argv, numForks);
+        AssignmentClientMonitor monitor(argc, argv, numForks, numSpares, pinToCores);
         return monitor.exec();
     } else {
         AssignmentClient client(argc, argv);
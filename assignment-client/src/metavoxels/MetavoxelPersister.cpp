@@ -0,0 +1,139 @@
+//
+//  MetavoxelPersister.cpp
+//  assignment-client/src/metavoxels
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#include <QDataStream>
+#include <QDateTime>
+#include <QtDebug>
+
+#include <MetavoxelMessages.h>
+
+#include "MetavoxelPersister.h"
+
+MetavoxelPersister::MetavoxelPersister(const QString& filename) :
+    _filename(filename),
+    _journalFilename(filename + ".journal"),
+    _compactingFilename(filename + ".journal.compacting") {
+}
+
+QByteArray MetavoxelPersister::createJournalRecord(const MetavoxelEditMessage& edit) {
+    QByteArray record;
+    QDataStream stream(&record, QIODevice::WriteOnly);
+    Bitstream out(stream, Bitstream::FULL_METADATA);
+    out << edit;
+    out.flush();
+    return record;
+}
+
+void MetavoxelPersister::load() {
+    qint64 loadStarted = QDateTime::currentMSecsSinceEpoch();
+    MetavoxelData data;
+    QFile file(_filename);
+    if (file.open(QIODevice::ReadOnly)) {
+        qDebug() << "Loading metavoxels from" << _filename << "...";
+        QDataStream stream(&file);
+        Bitstream in(stream, Bitstream::FULL_METADATA);
+        in >> data;
+        file.close();
+    }
+    
+    // then the edits made since the snapshot was written, including those set aside by a save that didn't finish
+    int replayed = replayJournal(_compactingFilename, data) + replayJournal(_journalFilename, data);
+    if (replayed > 0) {
+        qDebug() << "Replayed" << replayed << "edits from the journal" << _journalFilename;
+    }
+    openJournal(QIODevice::WriteOnly | QIODevice::Append);
+    
+    qDebug() << "Loaded metavoxels in" << (QDateTime::currentMSecsSinceEpoch() - loadStarted) << "ms.";
+    emit loaded(data);
+}
+
+void MetavoxelPersister::recordEdit(const QByteArray& record) {
+    if (!_journal.isOpen()) {
+        return;
+    }
+    QDataStream out(&_journal);
+    out << record;
+    
+    // handed to the system straight away, so that the edit outlives a crash of the server
+    _journal.flush();
+}
+
+void MetavoxelPersister::save(const MetavoxelData& data) {
+    qDebug() << "Saving metavoxels to" << _filename << "...";
+    
+    // the edits in the snapshot are set aside until it's in place; if the last save didn't finish, they join those set
+    // aside then
+    _journal.close();
+    if (QFile::exists(_compactingFilename)) {
+        QFile compactingFile(_compactingFilename);
+        QFile journalFile(_journalFilename);
+        if (compactingFile.open(QIODevice::WriteOnly | QIODevice::Append) && journalFile.open(QIODevice::ReadOnly)) {
+            compactingFile.write(journalFile.readAll());
+        }
+        journalFile.close();
+        QFile::remove(_journalFilename);
+        
+    } else if (QFile::exists(_journalFilename)) {
+        QFile::rename(_journalFilename, _compactingFilename);
+    }
+    openJournal(QIODevice::WriteOnly | QIODevice::Truncate);
+    
+    // written beside the old snapshot, so that a crash while saving leaves the old one and the journal whole
+    QString savingFilename = _filename + ".saving";
+    QFile file(savingFilename);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        qWarning() << "Couldn't open" << savingFilename << "to save metavoxels.";
+        return;
+    }
+    QDataStream stream(&file);
+    Bitstream out(stream, Bitstream::FULL_METADATA);
+    out << data;
+    out.flush();
+    file.close();
+    
+    QFile::remove(_filename);
+    if (QFile::rename(savingFilename, _filename)) {
+        QFile::remove(_compactingFilename);
+        qDebug() << "Saved metavoxels.";
+    } else {
+        qWarning() << "Couldn't move" << savingFilename << "to" << _filename;
+    }
+}
+
+int MetavoxelPersister::replayJournal(const QString& filename, MetavoxelData& data) {
+    QFile file(filename);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return 0;
+    }
+    QDataStream stream(&file);
+    int replayed = 0;
+    while (!stream.atEnd()) {
+        QByteArray record;
+        stream >> record;
+        if (stream.status() != QDataStream::Ok) {
+            qWarning() << "Ignoring the end of the journal" << filename << ", which was cut short.";
+            break;
+        }
+        QDataStream recordStream(record);
+        Bitstream in(recordStream, Bitstream::FULL_METADATA);
+        MetavoxelEditMessage edit;
+        in >> edit;
+        edit.apply(data, SharedObject::getWeakHash());
+        replayed++;
+    }
+    return replayed;
+}
+
+void MetavoxelPersister::openJournal(QIODevice::OpenMode mode) {
+    _journal.setFileName(_journalFilename);
+    if (!_journal.open(mode)) {
+        qWarning() << "Couldn't open the metavoxel journal" << _journalFilename;
+    }
+}
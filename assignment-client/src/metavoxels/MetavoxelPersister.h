@@ -0,0 +1,67 @@
+//
+//  MetavoxelPersister.h
+//  assignment-client/src/metavoxels
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#ifndef hifi_MetavoxelPersister_h
+#define hifi_MetavoxelPersister_h
+
+#include <QFile>
+#include <QObject>
+#include <QString>
+
+#include <MetavoxelData.h>
+
+class MetavoxelEditMessage;
+
+/// Loads and saves the server's data on a thread of its own.  The data is saved as a snapshot now and then, and each edit
+/// applied since the last snapshot is appended to a journal beside it as the edit comes in, so that a crash only loses what
+/// the system hadn't written out.  Loading the snapshot and then replaying the journal brings the data back to where it was.
+/// Both are written with full metadata, so that they can be read by builds whose streamable types have since changed.
+class MetavoxelPersister : public QObject {
+    Q_OBJECT
+
+public:
+    
+    MetavoxelPersister(const QString& filename);
+    
+    /// Returns an edit serialized for the journal.  Edits are serialized on the thread that applies them, so that the
+    /// journal keeps them in the same order.
+    static QByteArray createJournalRecord(const MetavoxelEditMessage& edit);
+    
+signals:
+
+    /// Fired once the snapshot has been read and the journal replayed.
+    void loaded(const MetavoxelData& data);
+
+public slots:
+    
+    /// Reads the snapshot, replays the journal and starts appending to it.
+    void load();
+    
+    /// Appends a record created by createJournalRecord to the journal.
+    void recordEdit(const QByteArray& record);
+    
+    /// Writes a snapshot of the data, which should include every edit recorded so far.  The snapshot is a copy of the
+    /// server's data, which shares its nodes with the server's until the server's edits replace them.
+    void save(const MetavoxelData& data);
+
+private:
+    
+    /// Applies the edits in a journal file, stopping at a record cut short by a crash.
+    static int replayJournal(const QString& filename, MetavoxelData& data);
+    
+    void openJournal(QIODevice::OpenMode mode);
+    
+    QString _filename;
+    QString _journalFilename;
+    QString _compactingFilename;
+    QFile _journal;
+};
+
+#endif // hifi_MetavoxelPersister_h
@@ -10,26 +10,53 @@
 //
 
 #include <QDateTime>
+#include <QRunnable>
 
 #include <PacketHeaders.h>
 
 #include <MetavoxelMessages.h>
 #include <MetavoxelUtil.h>
 
+#include "MetavoxelPersister.h"
 #include "MetavoxelServer.h"
 
 const int SEND_INTERVAL = 50;
 
+const int PERSIST_INTERVAL = 1000 * 30; // every 30 seconds
+
+const QString LOCAL_METAVOXELS_PERSIST_FILE = "resources/metavoxels.dat";
+
+/// the most times a delta's LOD threshold is multiplied by the coarsening factor in trying to fit it in a packet
+const int MAX_LOD_COARSENINGS = 4;
+const float LOD_COARSENING_FACTOR = 2.0f;
+
 MetavoxelServer::MetavoxelServer(const QByteArray& packet) :
     ThreadedAssignment(packet),
-    _sendTimer(this) {
+    _sendTimer(this),
+    _persister(new MetavoxelPersister(LOCAL_METAVOXELS_PERSIST_FILE)),
+    _persistTimer(this),
+    _loaded(false),
+    _dirty(false) {
     
     _sendTimer.setSingleShot(true);
     connect(&_sendTimer, SIGNAL(timeout()), SLOT(sendDeltas()));
+    
+    _persister->moveToThread(&_persistThread);
+    connect(&_persistThread, SIGNAL(finished()), _persister, SLOT(deleteLater()));
+    connect(_persister, SIGNAL(loaded(const MetavoxelData&)), SLOT(finishLoad(const MetavoxelData&)));
+    connect(&_persistTimer, SIGNAL(timeout()), SLOT(persist()));
 }
 
 void MetavoxelServer::applyEdit(const MetavoxelEditMessage& edit) {
+    // the edits that come in while loading are applied to the loaded data
+    if (!_loaded) {
+        _editsWhileLoading.append(edit);
+        return;
+    }
     edit.apply(_data, SharedObject::getWeakHash());
+    QMetaObject::invokeMethod(_persister, "recordEdit", Q_ARG(QByteArray,
+        MetavoxelPersister::createJournalRecord(edit)));
+    _dirty = true;
 }
 
 const QString METAVOXEL_SERVER_LOGGING_NAME = "metavoxel-server";
@@ -44,6 +71,10 @@ void MetavoxelServer::run() {
     
     _lastSend = QDateTime::currentMSecsSinceEpoch();
     _sendTimer.start(SEND_INTERVAL);
+    
+    // load on the persist thread; we serve what we have meanwhile, and the sessions pick up the loaded data in their deltas
+    _persistThread.start();
+    QMetaObject::invokeMethod(_persister, "load");
 }
 
 void MetavoxelServer::readPendingDatagrams() {
@@ -67,6 +98,15 @@ void MetavoxelServer::readPendingDatagrams() {
     }
 }
 
+void MetavoxelServer::aboutToFinish() {
+    _persistTimer.stop();
+    if (_loaded && _dirty) {
+        QMetaObject::invokeMethod(_persister, "save", Qt::BlockingQueuedConnection, Q_ARG(MetavoxelData, _data));
+    }
+    _persistThread.quit();
+    _persistThread.wait();
+}
+
 void MetavoxelServer::maybeAttachSession(const SharedNodePointer& node) {
     if (node->getType() == NodeType::Agent) {
         QMutexLocker locker(&node->getMutex());
@@ -74,14 +114,54 @@ void MetavoxelServer::maybeAttachSession(const SharedNodePointer& node) {
     }
 }
 
+/// Records a delta on a thread of the encoder pool.  The encoder holds its own copy of the data: a snapshot that the server's
+/// edits leave as it is, with the nodes shared between them counted atomically.
+class DeltaEncoder : public QRunnable {
+public:
+    DeltaEncoder(const MetavoxelData& data, SharedDelta* delta) : _data(data), _delta(delta) { }
+
+    virtual void run() { encodeDelta(_data, *_delta); }
+
+    static void encodeDelta(const MetavoxelData& data, SharedDelta& delta);
+
+private:
+    MetavoxelData _data;
+    SharedDelta* _delta;
+};
+
+void DeltaEncoder::encodeDelta(const MetavoxelData& data, SharedDelta& delta) {
+    QDataStream stream(&delta.recording.getData(), QIODevice::WriteOnly);
+    Bitstream out(stream);
+    out.startRecording(&delta.recording);
+    data.writeDelta(delta.reference, delta.referenceLOD, out, delta.lod);
+    out.stopRecording();
+}
+
 void MetavoxelServer::sendDeltas() {
-    // send deltas for all sessions
+    QList<MetavoxelSession*> sessions;
     foreach (const SharedNodePointer& node, NodeList::getInstance()->getNodeHash()) {
         if (node->getType() == NodeType::Agent) {
-            static_cast<MetavoxelSession*>(node->getLinkedData())->update();
+            sessions.append(static_cast<MetavoxelSession*>(node->getLinkedData()));
         }
     }
     
+    // encode the distinct deltas that the sessions need in parallel
+    foreach (MetavoxelSession* session, sessions) {
+        session->requestDelta();
+    }
+    for (QList<SharedDelta>::iterator it = _sharedDeltas.begin(); it != _sharedDeltas.end(); it++) {
+        _deltaEncoderPool.start(new DeltaEncoder(_data, &*it));
+    }
+    _deltaEncoderPool.waitForDone();
+    
+    // send deltas for all sessions, here on the timer's thread, which is the only one to touch their sequencers
+    foreach (MetavoxelSession* session, sessions) {
+        session->update();
+    }
+    
+    // the deltas only hold for the data as it was during the pass
+    _sharedDeltas.clear();
+    
     // restart the send timer
     qint64 now = QDateTime::currentMSecsSinceEpoch();
     int elapsed = now - _lastSend;
@@ -90,6 +170,53 @@ void MetavoxelServer::sendDeltas() {
     _sendTimer.start(qMax(0, 2 * SEND_INTERVAL - qMax(elapsed, SEND_INTERVAL)));
 }
 
+void MetavoxelServer::finishLoad(const MetavoxelData& data) {
+    _data = data;
+    _loaded = true;
+    foreach (const MetavoxelEditMessage& edit, _editsWhileLoading) {
+        applyEdit(edit);
+    }
+    _editsWhileLoading.clear();
+    _persistTimer.start(PERSIST_INTERVAL);
+}
+
+void MetavoxelServer::persist() {
+    // the snapshot is a copy of the data, which the persist thread writes while we carry on editing ours
+    if (_dirty) {
+        QMetaObject::invokeMethod(_persister, "save", Q_ARG(MetavoxelData, _data));
+        _dirty = false;
+    }
+}
+
+void MetavoxelServer::requestDelta(const MetavoxelData& reference, const MetavoxelLOD& referenceLOD,
+        const MetavoxelLOD& lod) {
+    if (!findSharedDelta(reference, referenceLOD, lod)) {
+        SharedDelta delta = { reference, referenceLOD, lod };
+        _sharedDeltas.append(delta);
+    }
+}
+
+const BitstreamRecording& MetavoxelServer::getDelta(const MetavoxelData& reference, const MetavoxelLOD& referenceLOD,
+        const MetavoxelLOD& lod) {
+    SharedDelta* delta = findSharedDelta(reference, referenceLOD, lod);
+    if (!delta) {
+        SharedDelta newDelta = { reference, referenceLOD, lod };
+        _sharedDeltas.append(newDelta);
+        DeltaEncoder::encodeDelta(_data, *(delta = &_sharedDeltas.last()));
+    }
+    return delta->recording;
+}
+
+SharedDelta* MetavoxelServer::findSharedDelta(const MetavoxelData& reference, const MetavoxelLOD& referenceLOD,
+        const MetavoxelLOD& lod) {
+    for (QList<SharedDelta>::iterator it = _sharedDeltas.begin(); it != _sharedDeltas.end(); it++) {
+        if (it->reference == reference && it->referenceLOD == referenceLOD && it->lod == lod) {
+            return &*it;
+        }
+    }
+    return NULL;
+}
+
 MetavoxelSession::MetavoxelSession(const SharedNodePointer& node, MetavoxelServer* server) :
     Endpoint(node, new PacketRecord(), NULL),
     _server(server),
@@ -102,6 +229,13 @@ MetavoxelSession::MetavoxelSession(const SharedNodePointer& node, MetavoxelServe
         SLOT(handleMessage(const QVariant&, Bitstream&)));
 }
 
+void MetavoxelSession::requestDelta() {
+    if (_lod.isValid() && !_reliableDeltaChannel) {
+        PacketRecord* sendRecord = getLastAcknowledgedSendRecord();
+        _server->requestDelta(sendRecord->getData(), sendRecord->getLOD(), _lod);
+    }
+}
+
 void MetavoxelSession::update() {
     // wait until we have a valid lod before sending
     if (!_lod.isValid()) {
@@ -114,11 +248,25 @@ void MetavoxelSession::update() {
     }
     Bitstream& out = _sequencer.startPacket();
     int start = _sequencer.getOutputStream().getUnderlying().device()->pos(); 
-    out << QVariant::fromValue(MetavoxelDeltaMessage());
     PacketRecord* sendRecord = getLastAcknowledgedSendRecord();
-    _server->getData().writeDelta(sendRecord->getData(), sendRecord->getLOD(), out, _lod);
-    out.flush();
-    int end = _sequencer.getOutputStream().getUnderlying().device()->pos();
+    
+    // if the delta won't fit in a packet, coarsen it (which keeps the detail nearest the observer) rather than stall on
+    // the reliable channel; the updates that follow will refine it from whatever the client acknowledges
+    MetavoxelDeltaMessage delta = { _lod };
+    int end;
+    for (int coarsenings = 0;; coarsenings++) {
+        out.writeAsVariant(delta);
+        out << _server->getDelta(sendRecord->getData(), sendRecord->getLOD(), delta.lod);
+        out.flush();
+        end = _sequencer.getOutputStream().getUnderlying().device()->pos();
+        if (end <= _sequencer.getMaxPacketSize() || coarsenings == MAX_LOD_COARSENINGS) {
+            break;
+        }
+        out.getAndResetWriteMappings();
+        _sequencer.getOutputStream().getUnderlying().device()->seek(start);
+        delta.lod.threshold *= LOD_COARSENING_FACTOR;
+    }
+    _sendLOD = delta.lod;
     if (end > _sequencer.getMaxPacketSize()) {
         // we need to send the delta on the reliable channel
         _reliableDeltaChannel = _sequencer.getReliableOutputChannel(RELIABLE_DELTA_CHANNEL_INDEX);
@@ -129,12 +277,12 @@ void MetavoxelSession::update() {
         _reliableDeltaWriteMappings = out.getAndResetWriteMappings();
         _reliableDeltaReceivedOffset = _reliableDeltaChannel->getBytesWritten();
         _reliableDeltaData = _server->getData();
-        _reliableDeltaLOD = _lod;
+        _reliableDeltaLOD = _sendLOD;
         
         // go back to the beginning with the current packet and note that there's a delta pending
         _sequencer.getOutputStream().getUnderlying().device()->seek(start);
         MetavoxelDeltaPendingMessage msg = { ++_reliableDeltaID };
-        out << QVariant::fromValue(msg);
+        out.writeAsVariant(msg);
         _sequencer.endPacket();
         
     } else {
@@ -151,7 +299,7 @@ void MetavoxelSession::handleMessage(const QVariant& message, Bitstream& in) {
 
 PacketRecord* MetavoxelSession::maybeCreateSendRecord() const {
     return _reliableDeltaChannel ? new PacketRecord(_reliableDeltaLOD, _reliableDeltaData) :
-        new PacketRecord(_lod, _server->getData());
+        new PacketRecord(_sendLOD, _server->getData());
 }
 
 void MetavoxelSession::handleMessage(const QVariant& message) {
@@ -186,7 +334,7 @@ void MetavoxelSession::sendPacketGroup(int alreadySent) {
         Bitstream& out = _sequencer.startPacket();
         if (_reliableDeltaChannel) {
             MetavoxelDeltaPendingMessage msg = { _reliableDeltaID };
-            out << QVariant::fromValue(msg);
+            out.writeAsVariant(msg);
         } else {
             out << QVariant();
         }
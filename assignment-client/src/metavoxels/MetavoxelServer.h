@@ -13,15 +13,28 @@
 #define hifi_MetavoxelServer_h
 
 #include <QList>
+#include <QThread>
+#include <QThreadPool>
 #include <QTimer>
 
 #include <ThreadedAssignment.h>
 
 #include <Endpoint.h>
+#include <MetavoxelMessages.h>
 
-class MetavoxelEditMessage;
+class MetavoxelPersister;
 class MetavoxelSession;
 
+/// A delta from a reference to the server's data, recorded in one send pass so that the other sessions with the same
+/// reference and LOD can copy it rather than encode it again.
+class SharedDelta {
+public:
+    MetavoxelData reference;
+    MetavoxelLOD referenceLOD;
+    MetavoxelLOD lod;
+    BitstreamRecording recording;
+};
+
 /// Maintains a shared metavoxel system, accepting change requests and broadcasting updates.
 class MetavoxelServer : public ThreadedAssignment {
     Q_OBJECT
@@ -34,21 +47,46 @@ public:
 
     const MetavoxelData& getData() const { return _data; }
 
+    /// Notes that a session will need the delta from the reference to the current data this send pass, so that it can be
+    /// encoded ahead of time along with the others.
+    void requestDelta(const MetavoxelData& reference, const MetavoxelLOD& referenceLOD, const MetavoxelLOD& lod);
+
+    /// Returns the recorded delta from the reference to the current data, encoding it if no session has needed it yet this
+    /// send pass.
+    const BitstreamRecording& getDelta(const MetavoxelData& reference, const MetavoxelLOD& referenceLOD,
+        const MetavoxelLOD& lod);
+
     virtual void run();
     
     virtual void readPendingDatagrams();
     
+    virtual void aboutToFinish();
+    
 private slots:
 
     void maybeAttachSession(const SharedNodePointer& node);
     void sendDeltas();    
+    void finishLoad(const MetavoxelData& data);
+    void persist();
     
 private:
     
+    SharedDelta* findSharedDelta(const MetavoxelData& reference, const MetavoxelLOD& referenceLOD, const MetavoxelLOD& lod);
+    
     QTimer _sendTimer;
     qint64 _lastSend;
     
     MetavoxelData _data;
+    
+    QThread _persistThread;
+    MetavoxelPersister* _persister;
+    QTimer _persistTimer;
+    bool _loaded;
+    bool _dirty; ///< whether there are edits that the last snapshot lacks
+    QList<MetavoxelEditMessage> _editsWhileLoading;
+    
+    QList<SharedDelta> _sharedDeltas;
+    QThreadPool _deltaEncoderPool;
 };
 
 /// Contains the state of a single client session.
@@ -59,6 +97,9 @@ public:
     
     MetavoxelSession(const SharedNodePointer& node, MetavoxelServer* server);
 
+    /// Requests from the server the delta that the next update will send, if any.
+    void requestDelta();
+
     virtual void update();
 
 protected:
@@ -79,6 +120,7 @@ private:
     MetavoxelServer* _server;
     
     MetavoxelLOD _lod;
+    MetavoxelLOD _sendLOD; ///< the LOD of the last delta sent, which may be coarser than the client's
     
     ReliableChannel* _reliableDeltaChannel;
     int _reliableDeltaReceivedOffset;
@@ -20,15 +20,16 @@ class ModelNodeData : public OctreeQueryNode {
 public:
     ModelNodeData() :
         OctreeQueryNode(),
-        _lastDeletedModelsSentAt(0) {  };
+        _deletedModelsCursor(0) {  };
 
     virtual PacketType getMyPacketType() const { return PacketTypeModelData; }
 
-    quint64 getLastDeletedModelsSentAt() const { return _lastDeletedModelsSentAt; }
-    void setLastDeletedModelsSentAt(quint64 sentAt) { _lastDeletedModelsSentAt = sentAt; }
+    /// the cursor of the first deleted model the node hasn't been sent
+    quint64 getDeletedModelsCursor() const { return _deletedModelsCursor; }
+    void setDeletedModelsCursor(quint64 cursor) { _deletedModelsCursor = cursor; }
 
 private:
-    quint64 _lastDeletedModelsSentAt;
+    quint64 _deletedModelsCursor;
 };
 
 #endif // hifi_ModelNodeData_h
@@ -9,6 +9,8 @@
 //  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
 //
 
+#include <limits>
+
 #include <QTimer>
 #include <ModelTree.h>
 
@@ -77,10 +79,8 @@ bool ModelServer::hasSpecialPacketToSend(const SharedNodePointer& node) {
     // check to see if any new models have been added since we last sent to this node...
     ModelNodeData* nodeData = static_cast<ModelNodeData*>(node->getLinkedData());
     if (nodeData) {
-        quint64 deletedModelsSentAt = nodeData->getLastDeletedModelsSentAt();
-
         ModelTree* tree = static_cast<ModelTree*>(_tree);
-        shouldSendDeletedModels = tree->hasModelsDeletedSince(deletedModelsSentAt);
+        shouldSendDeletedModels = tree->hasModelsDeletedSince(nodeData->getDeletedModelsCursor());
     }
 
     return shouldSendDeletedModels;
@@ -92,8 +92,7 @@ int ModelServer::sendSpecialPacket(const SharedNodePointer& node, OctreeQueryNod
 
     ModelNodeData* nodeData = static_cast<ModelNodeData*>(node->getLinkedData());
     if (nodeData) {
-        quint64 deletedModelsSentAt = nodeData->getLastDeletedModelsSentAt();
-        quint64 deletePacketSentAt = usecTimestampNow();
+        quint64 deletedModelsCursor = nodeData->getDeletedModelsCursor();
 
         ModelTree* tree = static_cast<ModelTree*>(_tree);
         bool hasMoreToSend = true;
@@ -101,7 +100,7 @@ int ModelServer::sendSpecialPacket(const SharedNodePointer& node, OctreeQueryNod
         // TODO: is it possible to send too many of these packets? what if you deleted 1,000,000 models?
         packetsSent = 0;
         while (hasMoreToSend) {
-            hasMoreToSend = tree->encodeModelsDeletedSince(queryNode->getSequenceNumber(), deletedModelsSentAt,
+            hasMoreToSend = tree->encodeModelsDeletedSince(queryNode->getSequenceNumber(), deletedModelsCursor,
                                                 outputBuffer, MAX_PACKET_SIZE, packetLength);
 
             //qDebug() << "sending PacketType_MODEL_ERASE packetLength:" << packetLength;
@@ -111,7 +110,7 @@ int ModelServer::sendSpecialPacket(const SharedNodePointer& node, OctreeQueryNod
             packetsSent++;
         }
 
-        nodeData->setLastDeletedModelsSentAt(deletePacketSentAt);
+        nodeData->setDeletedModelsCursor(deletedModelsCursor);
     }
 
     // TODO: caller is expecting a packetLength, what if we send more than one packet??
@@ -123,18 +122,17 @@ void ModelServer::pruneDeletedModels() {
     if (tree->hasAnyDeletedModels()) {
 
         //qDebug() << "there are some deleted models to consider...";
-        quint64 earliestLastDeletedModelsSent = usecTimestampNow() + 1; // in the future
+        quint64 earliestDeletedModelsCursor = std::numeric_limits<quint64>::max(); // past every deletion
         foreach (const SharedNodePointer& otherNode, NodeList::getInstance()->getNodeHash()) {
             if (otherNode->getLinkedData()) {
                 ModelNodeData* nodeData = static_cast<ModelNodeData*>(otherNode->getLinkedData());
-                quint64 nodeLastDeletedModelsSentAt = nodeData->getLastDeletedModelsSentAt();
-                if (nodeLastDeletedModelsSentAt < earliestLastDeletedModelsSent) {
-                    earliestLastDeletedModelsSent = nodeLastDeletedModelsSentAt;
+                quint64 nodeDeletedModelsCursor = nodeData->getDeletedModelsCursor();
+                if (nodeDeletedModelsCursor < earliestDeletedModelsCursor) {
+                    earliestDeletedModelsCursor = nodeDeletedModelsCursor;
                 }
             }
         }
-        //qDebug() << "earliestLastDeletedModelsSent=" << earliestLastDeletedModelsSent;
-        tree->forgetModelsDeletedBefore(earliestLastDeletedModelsSent);
+        tree->forgetModelsDeletedBefore(earliestDeletedModelsCursor);
     }
 }
 
@@ -18,7 +18,11 @@
 #include "OctreeInboundPacketProcessor.h"
 
 static QUuid DEFAULT_NODE_ID_REF;
-const quint64 TOO_LONG_SINCE_LAST_NACK = 1 * USECS_PER_SECOND;
+const quint64 TOO_LONG_SINCE_LAST_NACK = 250 * USECS_PER_MSEC;
+
+// the edits waiting are made under one hold of the tree's lock, so that the send threads reading the tree are only
+// shut out once for them rather than for each, but no longer than this at a time
+const quint64 MAX_TREE_LOCK_HOLD_USECS = 2 * USECS_PER_MSEC;
 
 OctreeInboundPacketProcessor::OctreeInboundPacketProcessor(OctreeServer* myServer) :
     _myServer(myServer),
@@ -28,8 +32,10 @@ OctreeInboundPacketProcessor::OctreeInboundPacketProcessor(OctreeServer* myServe
     _totalLockWaitTime(0),
     _totalElementsInPacket(0),
     _totalPackets(0),
-    _lastNackTime(usecTimestampNow()),
-    _shuttingDown(false)
+    _lastNackTime(usecCoarseMonotonicNow()),
+    _shuttingDown(false),
+    _isHoldingTreeLock(false),
+    _treeLockStarted(0)
 {
 }
 
@@ -39,7 +45,7 @@ void OctreeInboundPacketProcessor::resetStats() {
     _totalLockWaitTime = 0;
     _totalElementsInPacket = 0;
     _totalPackets = 0;
-    _lastNackTime = usecTimestampNow();
+    _lastNackTime = usecCoarseMonotonicNow();
 
     _singleSenderStats.clear();
 }
@@ -47,7 +53,7 @@ void OctreeInboundPacketProcessor::resetStats() {
 unsigned long OctreeInboundPacketProcessor::getMaxWait() const {
     // calculate time until next sendNackPackets()
     quint64 nextNackTime = _lastNackTime + TOO_LONG_SINCE_LAST_NACK;
-    quint64 now = usecTimestampNow();
+    quint64 now = usecCoarseMonotonicNow();
     if (now >= nextNackTime) {
         return 0;
     }
@@ -56,7 +62,7 @@ unsigned long OctreeInboundPacketProcessor::getMaxWait() const {
 
 void OctreeInboundPacketProcessor::preProcess() {
     // check if it's time to send a nack. If yes, do so
-    quint64 now = usecTimestampNow();
+    quint64 now = usecCoarseMonotonicNow();
     if (now - _lastNackTime >= TOO_LONG_SINCE_LAST_NACK) {
         _lastNackTime = now;
         sendNackPackets();
@@ -64,14 +70,49 @@ void OctreeInboundPacketProcessor::preProcess() {
 }
 
 void OctreeInboundPacketProcessor::midProcess() {
+    // let the send threads at the tree once there are no more edits waiting, or they've waited long enough
+    if (_isHoldingTreeLock && (!hasPacketsToProcess() ||
+            usecMonotonicNow() - _treeLockStarted >= MAX_TREE_LOCK_HOLD_USECS)) {
+        unlockTreeForEdits();
+    }
+
     // check if it's time to send a nack. If yes, do so
-    quint64 now = usecTimestampNow();
+    quint64 now = usecCoarseMonotonicNow();
     if (now - _lastNackTime >= TOO_LONG_SINCE_LAST_NACK) {
         _lastNackTime = now;
         sendNackPackets();
     }
 }
 
+void OctreeInboundPacketProcessor::postProcess() {
+    unlockTreeForEdits();
+}
+
+quint64 OctreeInboundPacketProcessor::lockTreeForEdits() {
+    if (_isHoldingTreeLock) {
+        return 0;
+    }
+    quint64 startLock = usecMonotonicNow();
+    _myServer->getOctree()->lockForWrite();
+    _isHoldingTreeLock = true;
+    _treeLockStarted = usecMonotonicNow();
+
+    // the tree may hold back the edits made under this hold of the lock, and make them together when it's let go
+    _myServer->getOctree()->beginEditBatch();
+    return _treeLockStarted - startLock;
+}
+
+void OctreeInboundPacketProcessor::unlockTreeForEdits() {
+    if (_isHoldingTreeLock) {
+        quint64 startBatch = usecMonotonicNow();
+        _myServer->getOctree()->endEditBatch();
+        _totalProcessTime += usecMonotonicNow() - startBatch;
+
+        _myServer->getOctree()->unlock();
+        _isHoldingTreeLock = false;
+    }
+}
+
 void OctreeInboundPacketProcessor::processPacket(const SharedNodePointer& sendingNode, const QByteArray& packet) {
     if (_shuttingDown) {
         qDebug() << "OctreeInboundPacketProcessor::processPacket() while shutting down... ignoring incoming packet";
@@ -119,27 +160,26 @@ void OctreeInboundPacketProcessor::processPacket(const SharedNodePointer& sendin
                         packetType, packetData, packet.size(), editData, atByte, maxSize);
             }
 
-            quint64 startLock = usecTimestampNow();
-            _myServer->getOctree()->lockForWrite();
-            quint64 startProcess = usecTimestampNow();
+            lockWaitTime += lockTreeForEdits();
+            quint64 startProcess = usecMonotonicNow();
             int editDataBytesRead = _myServer->getOctree()->processEditPacketData(packetType,
                                                                                   reinterpret_cast<const unsigned char*>(packet.data()),
                                                                                   packet.size(),
                                                                                   editData, maxSize, sendingNode);
-            _myServer->getOctree()->unlock();
-            quint64 endProcess = usecTimestampNow();
+            quint64 endProcess = usecMonotonicNow();
 
             editsInPacket++;
             quint64 thisProcessTime = endProcess - startProcess;
-            quint64 thisLockWaitTime = startProcess - startLock;
             processTime += thisProcessTime;
-            lockWaitTime += thisLockWaitTime;
 
             // skip to next voxel edit record in the packet
             editData += editDataBytesRead;
             atByte += editDataBytesRead;
         }
 
+        // kept in the journal until the tree is next saved
+        _myServer->recordEditPacket(packet);
+
         if (debugProcessPacket) {
             qDebug("OctreeInboundPacketProcessor::processPacket() DONE LOOPING FOR %c "
                    "packetData=%p packetLength=%d voxelData=%p atByte=%d",
@@ -159,13 +199,18 @@ void OctreeInboundPacketProcessor::processPacket(const SharedNodePointer& sendin
                 qDebug() << "sender has no known nodeUUID.";
             }
         }
-        trackInboundPacket(nodeUUID, sequence, transitTime, editsInPacket, processTime, lockWaitTime);
+        int numPacketsLost = trackInboundPacket(nodeUUID, sequence, sentAt, transitTime, editsInPacket, processTime,
+                                                lockWaitTime);
+        if (sendingNode) {
+            sendingNode->getTelemetry().recordPacketsLost(numPacketsLost);
+        }
     } else {
         qDebug("unknown packet ignored... packetType=%d", packetType);
     }
 }
 
-void OctreeInboundPacketProcessor::trackInboundPacket(const QUuid& nodeUUID, unsigned short int sequence, quint64 transitTime,
+int OctreeInboundPacketProcessor::trackInboundPacket(const QUuid& nodeUUID, unsigned short int sequence, quint64 sentAt,
+            quint64 transitTime,
             int editsInPacket, quint64 processTime, quint64 lockWaitTime) {
 
     _totalTransitTime += transitTime;
@@ -178,11 +223,14 @@ void OctreeInboundPacketProcessor::trackInboundPacket(const QUuid& nodeUUID, uns
     // see if this is the first we've heard of this node...
     if (_singleSenderStats.find(nodeUUID) == _singleSenderStats.end()) {
         SingleSenderStats stats;
-        stats.trackInboundPacket(sequence, transitTime, editsInPacket, processTime, lockWaitTime);
+        stats.trackInboundPacket(sequence, sentAt, transitTime, editsInPacket, processTime, lockWaitTime);
         _singleSenderStats[nodeUUID] = stats;
+        return stats.getIncomingEditSequenceNumberStats().getNumLost();
     } else {
         SingleSenderStats& stats = _singleSenderStats[nodeUUID];
-        stats.trackInboundPacket(sequence, transitTime, editsInPacket, processTime, lockWaitTime);
+        quint32 numPacketsLost = stats.getIncomingEditSequenceNumberStats().getNumLost();
+        stats.trackInboundPacket(sequence, sentAt, transitTime, editsInPacket, processTime, lockWaitTime);
+        return stats.getIncomingEditSequenceNumberStats().getNumLost() - numPacketsLost;
     }
 }
 
@@ -200,7 +248,7 @@ int OctreeInboundPacketProcessor::sendNackPackets() {
     while (i != _singleSenderStats.end()) {
 
         QUuid nodeUUID = i.key();
-        SingleSenderStats nodeStats = i.value();
+        SingleSenderStats& nodeStats = i.value();
 
         // check if this node is still alive.  Remove its stats if it's dead.
         if (!isAlive(nodeUUID)) {
@@ -217,46 +265,12 @@ int OctreeInboundPacketProcessor::sendNackPackets() {
 
         const SharedNodePointer& destinationNode = NodeList::getInstance()->getNodeHash().value(nodeUUID);
 
-        // retrieve sequence number stats of node, prune its missing set
-        SequenceNumberStats& sequenceNumberStats = nodeStats.getIncomingEditSequenceNumberStats();
-        sequenceNumberStats.pruneMissingSet();
-        
-        // construct nack packet(s) for this node
-        const QSet<unsigned short int>& missingSequenceNumbers = sequenceNumberStats.getMissingSet();
-        int numSequenceNumbersAvailable = missingSequenceNumbers.size();
-        QSet<unsigned short int>::const_iterator missingSequenceNumberIterator = missingSequenceNumbers.constBegin();
-        while (numSequenceNumbersAvailable > 0) {
-
-            char* dataAt = packet;
-            int bytesRemaining = MAX_PACKET_SIZE;
-
-            // pack header
-            int numBytesPacketHeader = populatePacketHeader(packet, _myServer->getMyEditNackType());
-            dataAt += numBytesPacketHeader;
-            bytesRemaining -= numBytesPacketHeader;
-
-            // calculate and pack the number of sequence numbers to nack
-            int numSequenceNumbersRoomFor = (bytesRemaining - sizeof(uint16_t)) / sizeof(unsigned short int);
-            uint16_t numSequenceNumbers = std::min(numSequenceNumbersAvailable, numSequenceNumbersRoomFor);
-            uint16_t* numSequenceNumbersAt = (uint16_t*)dataAt;
-            *numSequenceNumbersAt = numSequenceNumbers;
-            dataAt += sizeof(uint16_t);
-
-            // pack sequence numbers to nack
-            for (uint16_t i = 0; i < numSequenceNumbers; i++) {
-                unsigned short int* sequenceNumberAt = (unsigned short int*)dataAt;
-                *sequenceNumberAt = *missingSequenceNumberIterator;
-                dataAt += sizeof(unsigned short int);
-
-                missingSequenceNumberIterator++;
-            }
-            numSequenceNumbersAvailable -= numSequenceNumbers;
-
-            // send it
-            NodeList::getInstance()->writeUnverifiedDatagram(packet, dataAt - packet, destinationNode);
+        // an ack goes back whenever edits have come in since the last, so the editor can time the round trip
+        SelectiveAck ack;
+        if (nodeStats.makeAck(ack)) {
+            int packetLength = ack.packIntoPacket(packet, MAX_PACKET_SIZE, _myServer->getMyEditNackType());
+            NodeList::getInstance()->writeUnverifiedDatagram(packet, packetLength, destinationNode);
             packetsSent++;
-            
-            qDebug() << "NACK Sent back to editor/client... destinationNode=" << nodeUUID;
         }
         i++;
     }
@@ -270,17 +284,26 @@ SingleSenderStats::SingleSenderStats()
     _totalLockWaitTime(0),
     _totalElementsInPacket(0),
     _totalPackets(0),
-    _incomingEditSequenceNumberStats()
+    _incomingEditSequenceNumberStats(),
+    _lastSentAt(0),
+    _lastArrivedAt(0),
+    _totalPacketsAtLastAck(0)
 {
 
 }
 
-void SingleSenderStats::trackInboundPacket(unsigned short int incomingSequence, quint64 transitTime,
+void SingleSenderStats::trackInboundPacket(unsigned short int incomingSequence, quint64 sentAt, quint64 transitTime,
     int editsInPacket, quint64 processTime, quint64 lockWaitTime) {
 
     // track sequence number
     _incomingEditSequenceNumberStats.sequenceNumberReceived(incomingSequence);
 
+    // a resend carries the time it was first sent, so only the newest edit packet is timed
+    if (incomingSequence == _incomingEditSequenceNumberStats.getLastReceived()) {
+        _lastSentAt = sentAt;
+        _lastArrivedAt = sentAt + transitTime; // the time it was taken off the queue, on our clock
+    }
+
     // update other stats
     _totalTransitTime += transitTime;
     _totalProcessTime += processTime;
@@ -288,3 +311,16 @@ void SingleSenderStats::trackInboundPacket(unsigned short int incomingSequence,
     _totalElementsInPacket += editsInPacket;
     _totalPackets++;
 }
+
+bool SingleSenderStats::makeAck(SelectiveAck& ack) {
+    if (_totalPackets == _totalPacketsAtLastAck) {
+        return false;
+    }
+    _totalPacketsAtLastAck = _totalPackets;
+
+    _incomingEditSequenceNumberStats.pruneMissingSet();
+    ack.setNewestSequenceNumber(_incomingEditSequenceNumberStats.getLastReceived());
+    ack.setEcho(_lastSentAt, usecTimestampNow() - _lastArrivedAt);
+    ack.setMissingSequenceNumbers(_incomingEditSequenceNumberStats.getMissingSet());
+    return true;
+}
@@ -16,6 +16,7 @@
 
 #include <ReceivedPacketProcessor.h>
 
+#include "SelectiveAck.h"
 #include "SequenceNumberStats.h"
 
 class OctreeServer;
@@ -37,15 +38,22 @@ public:
     const SequenceNumberStats& getIncomingEditSequenceNumberStats() const { return _incomingEditSequenceNumberStats; }
     SequenceNumberStats& getIncomingEditSequenceNumberStats() { return _incomingEditSequenceNumberStats; }
 
-    void trackInboundPacket(unsigned short int incomingSequence, quint64 transitTime,
+    void trackInboundPacket(unsigned short int incomingSequence, quint64 sentAt, quint64 transitTime,
         int editsInPacket, quint64 processTime, quint64 lockWaitTime);
 
+    /// fills in the ack of the edits received from the sender, pruning the missing set first, and returns false if no
+    /// edits have come in since the last ack was made
+    bool makeAck(SelectiveAck& ack);
+
     quint64 _totalTransitTime; 
     quint64 _totalProcessTime;
     quint64 _totalLockWaitTime;
     quint64 _totalElementsInPacket;
     quint64 _totalPackets;
     SequenceNumberStats _incomingEditSequenceNumberStats;
+    quint64 _lastSentAt; /// on the sender's clock, which acks echo back
+    quint64 _lastArrivedAt;
+    quint64 _totalPacketsAtLastAck;
 };
 
 typedef QHash<QUuid, SingleSenderStats> NodeToSenderStatsMap;
@@ -83,12 +91,21 @@ protected:
     virtual unsigned long getMaxWait() const;
     virtual void preProcess();
     virtual void midProcess();
+    virtual void postProcess();
 
 private:
     int sendNackPackets();
 
+    /// locks the tree for writing and starts a batch of edits unless the lock is still held from the edits before,
+    /// returns the usecs waited for it
+    quint64 lockTreeForEdits();
+
+    /// ends the batch of edits, so the tree makes any it held back, then lets go of the lock
+    void unlockTreeForEdits();
+
 private:
-    void trackInboundPacket(const QUuid& nodeUUID, unsigned short int sequence, quint64 transitTime, 
+    /// returns how many of the sender's edit packets the sequence number of this one shows were lost
+    int trackInboundPacket(const QUuid& nodeUUID, unsigned short int sequence, quint64 sentAt, quint64 transitTime,
             int voxelsInPacket, quint64 processTime, quint64 lockWaitTime);
 
     OctreeServer* _myServer;
@@ -104,5 +121,8 @@ private:
 
     quint64 _lastNackTime;
     bool _shuttingDown;
+
+    bool _isHoldingTreeLock;
+    quint64 _treeLockStarted;
 };
 #endif // hifi_OctreeInboundPacketProcessor_h
@@ -0,0 +1,410 @@
+//
+//  OctreeJurisdictionHandoff.cpp
+//  assignment-client/src/octree
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#include <QtCore/QDataStream>
+#include <QtCore/QDebug>
+
+#include <glm/glm.hpp>
+
+#include <NodeList.h>
+#include <OctalCode.h>
+#include <PacketHeaders.h>
+#include <SharedUtil.h>
+
+#include "OctreeJurisdictionHandoff.h"
+#include "OctreeServer.h"
+
+// the deepest subtree that's handed off, at which a voxel is 16 meters across
+const int MAX_HANDOFF_DEPTH = 10;
+
+// leaves room in the packet for our header, generation, chunk index and count, and the subtree's octal code
+const int HANDOFF_CHUNK_OVERHEAD = 64;
+const int MAX_HANDOFF_CHUNK_SIZE = MAX_OCTREE_PACKET_DATA_SIZE - HANDOFF_CHUNK_OVERHEAD;
+
+// the chunks that are sent before waiting for their acks
+const int HANDOFF_CHUNK_WINDOW = 32;
+
+const int HANDOFF_RESEND_INTERVAL_MSECS = 250;
+const quint64 HANDOFF_TIMEOUT_USECS = 10 * USECS_PER_SECOND;
+
+// a subtree that's edited faster than it can be sent isn't handed off
+const int MAX_HANDOFF_GENERATIONS = 5;
+
+static QByteArray byteArrayForCode(const unsigned char* code) {
+    return QByteArray(reinterpret_cast<const char*>(code),
+                      (int)bytesRequiredForCodeLength(numberOfThreeBitSectionsInCode(code)));
+}
+
+static const unsigned char* codeForByteArray(const QByteArray& code) {
+    return reinterpret_cast<const unsigned char*>(code.constData());
+}
+
+OctreeJurisdictionHandoff::OctreeJurisdictionHandoff(OctreeServer* server) :
+    _server(server),
+    _resendTimer(),
+    _receiverUUID(),
+    _givingCode(),
+    _generation(0),
+    _generationsSent(0),
+    _snapshotTime(0),
+    _snapshotHadSubtree(false),
+    _chunks(),
+    _nextChunk(0),
+    _unackedChunks(),
+    _committing(false),
+    _lastAckTime(0),
+    _giverUUID(),
+    _receivingGeneration(0),
+    _receivingChunkCount(0),
+    _receivingCode(),
+    _receivedChunks()
+{
+    connect(&_resendTimer, &QTimer::timeout, this, &OctreeJurisdictionHandoff::resendUnackedChunks);
+}
+
+bool OctreeJurisdictionHandoff::isSpare() const {
+    JurisdictionMap* jurisdiction = _server->getJurisdiction();
+    return !_server->isReplica() && jurisdiction && !jurisdiction->getRootOctalCode();
+}
+
+void OctreeJurisdictionHandoff::processPacket(const SharedNodePointer& sendingNode, const QByteArray& packet) {
+    PacketType packetType = packetTypeForPacket(packet);
+    QDataStream packetStream(packet);
+    packetStream.skipRawData(numBytesForPacketHeader(packet));
+
+    if (packetType == PacketTypeJurisdictionHandoffRequest) {
+        QUuid receiverUUID;
+        packetStream >> receiverUUID;
+        startGiving(receiverUUID);
+        return;
+    }
+
+    // the rest of the handoff is between servers of our own type
+    if (!sendingNode || sendingNode->getType() != _server->getMyNodeType()) {
+        return;
+    }
+
+    if (packetType == PacketTypeJurisdictionHandoffData) {
+        quint32 generation;
+        qint32 index, count;
+        QByteArray code, chunk;
+        packetStream >> generation >> index >> count >> code >> chunk;
+        if (packetStream.status() == QDataStream::Ok && index >= 0 && index <= count && !code.isEmpty()) {
+            handleData(sendingNode, generation, index, count, code, chunk);
+        }
+    } else if (packetType == PacketTypeJurisdictionHandoffAck) {
+        quint32 generation;
+        qint32 index;
+        packetStream >> generation >> index;
+        if (packetStream.status() == QDataStream::Ok) {
+            handleAck(sendingNode->getUUID(), generation, index);
+        }
+    }
+}
+
+void OctreeJurisdictionHandoff::startGiving(const QUuid& receiverUUID) {
+    if (isGiving() || isSpare() || _server->isReplica() || receiverUUID.isNull()) {
+        return;
+    }
+    SharedNodePointer receiver = NodeList::getInstance()->nodeWithUUID(receiverUUID);
+    if (!receiver || receiver->getType() != _server->getMyNodeType()) {
+        qDebug() << "Jurisdiction handoff requested to unknown server" << receiverUUID;
+        return;
+    }
+
+    _givingCode = chooseSubtree();
+    if (_givingCode.isEmpty()) {
+        qDebug() << "Jurisdiction handoff requested, but there's no subtree that would split our clients.";
+        return;
+    }
+
+    _receiverUUID = receiverUUID;
+    _generationsSent = 0;
+    _lastAckTime = usecTimestampNow();
+    qDebug() << "Handing off jurisdiction over" << octalCodeToHexString(codeForByteArray(_givingCode))
+        << "to" << receiverUUID;
+
+    if (!snapshotSubtree()) {
+        stopGiving();
+        return;
+    }
+    _resendTimer.start(HANDOFF_RESEND_INTERVAL_MSECS);
+}
+
+QByteArray OctreeJurisdictionHandoff::chooseSubtree() const {
+    // without a jurisdiction the whole tree is ours
+    JurisdictionMap* jurisdiction = _server->getJurisdiction();
+    QByteArray current(1, 0);
+    if (jurisdiction) {
+        current = byteArrayForCode(jurisdiction->getRootOctalCode());
+    }
+
+    // the codes of the deepest voxels the cameras of the clients in our jurisdiction are in
+    const float MAX_CAMERA_COORDINATE = 1.0f - 1.0f / (1 << (MAX_HANDOFF_DEPTH + 1));
+    QVector<QByteArray> cameraCodes;
+    foreach (const SharedNodePointer& node, NodeList::getInstance()->getNodeHash()) {
+        OctreeQueryNode* nodeData = static_cast<OctreeQueryNode*>(node->getLinkedData());
+        if (node->getType() != NodeType::Agent || !nodeData || !nodeData->isOctreeSendThreadInitalized()) {
+            continue;
+        }
+        glm::vec3 position = glm::clamp(nodeData->getCameraPosition() / (float)TREE_SCALE, 0.0f, MAX_CAMERA_COORDINATE);
+        unsigned char* cameraCode = pointToVoxel(position.x, position.y, position.z, 1.0f / (1 << MAX_HANDOFF_DEPTH));
+        if (!jurisdiction || jurisdiction->isMyJurisdiction(cameraCode, CHECK_NODE_ONLY) == JurisdictionMap::WITHIN) {
+            cameraCodes.append(byteArrayForCode(cameraCode));
+        }
+        delete[] cameraCode;
+    }
+    int totalCameras = cameraCodes.size();
+
+    // follow the cameras down until a child holds no more than half of them, then that child splits them the most evenly
+    while (numberOfThreeBitSectionsInCode(codeForByteArray(current)) < MAX_HANDOFF_DEPTH) {
+        QByteArray busiestChild;
+        int busiestChildCameras = 0;
+        for (int i = 0; i < NUMBER_OF_CHILDREN; i++) {
+            unsigned char* childCode = childOctalCode(codeForByteArray(current), i);
+            if (!jurisdiction || jurisdiction->isMyJurisdiction(childCode, CHECK_NODE_ONLY) == JurisdictionMap::WITHIN) {
+                int childCameras = 0;
+                foreach (const QByteArray& cameraCode, cameraCodes) {
+                    if (isAncestorOf(childCode, codeForByteArray(cameraCode))) {
+                        childCameras++;
+                    }
+                }
+                if (childCameras > busiestChildCameras) {
+                    busiestChildCameras = childCameras;
+                    busiestChild = byteArrayForCode(childCode);
+                }
+            }
+            delete[] childCode;
+        }
+        if (busiestChildCameras == 0) {
+            break;
+        }
+
+        // a child with some of our end nodes under it would hand off what isn't ours, so we look further down instead
+        bool hasEndNodes = false;
+        for (int i = 0; jurisdiction && i < jurisdiction->getEndNodeCount(); i++) {
+            if (isAncestorOf(codeForByteArray(busiestChild), jurisdiction->getEndNodeOctalCode(i))) {
+                hasEndNodes = true;
+                break;
+            }
+        }
+        if (busiestChildCameras <= totalCameras / 2 && !hasEndNodes) {
+            return busiestChild;
+        }
+        current = busiestChild;
+    }
+    return QByteArray();
+}
+
+bool OctreeJurisdictionHandoff::snapshotSubtree() {
+    Octree* tree = _server->getOctree();
+    VoxelPositionSize details;
+    voxelDetailsForCode(codeForByteArray(_givingCode), details);
+
+    _generation++;
+    _generationsSent++;
+    _chunks.clear();
+    _nextChunk = 0;
+    _unackedChunks.clear();
+    _committing = false;
+
+    // the lock is held across the whole snapshot, since the elements in the bag could be deleted between slices
+    tree->lockForRead();
+    _snapshotTime = usecTimestampNow();
+    OctreeElement* subtree = tree->getOctreeElementAt(details.x, details.y, details.z, details.s);
+    _snapshotHadSubtree = (subtree != NULL);
+    bool snapshotFit = !subtree || tree->encodeSubtreeToChunks(subtree, MAX_HANDOFF_CHUNK_SIZE, _chunks);
+    tree->unlock();
+
+    if (!snapshotFit) {
+        qDebug() << "Jurisdiction handoff stopped, an element didn't fit in a chunk.";
+        return false;
+    }
+
+    while (_nextChunk < _chunks.size() && _unackedChunks.size() < HANDOFF_CHUNK_WINDOW) {
+        sendChunk(_nextChunk++);
+    }
+    if (_chunks.isEmpty()) {
+        // there's nothing to send, so we can go straight to the commit
+        handleAck(_receiverUUID, _generation, -1);
+    }
+    return true;
+}
+
+bool OctreeJurisdictionHandoff::hasSubtreeChangedSinceSnapshot() {
+    Octree* tree = _server->getOctree();
+    VoxelPositionSize details;
+    voxelDetailsForCode(codeForByteArray(_givingCode), details);
+
+    tree->lockForRead();
+    OctreeElement* subtree = tree->getOctreeElementAt(details.x, details.y, details.z, details.s);
+    bool hasChanged = subtree ? subtree->hasChangedInSubtreeSince(_snapshotTime) : _snapshotHadSubtree;
+    tree->unlock();
+    return hasChanged;
+}
+
+void OctreeJurisdictionHandoff::sendChunk(int index) {
+    SharedNodePointer receiver = NodeList::getInstance()->nodeWithUUID(_receiverUUID);
+    if (!receiver) {
+        return;
+    }
+
+    // the chunk index that's one past the last chunk is the commit
+    QByteArray packet = byteArrayWithPopulatedHeader(PacketTypeJurisdictionHandoffData);
+    QDataStream packetStream(&packet, QIODevice::Append);
+    packetStream << _generation << (qint32)index << (qint32)_chunks.size() << _givingCode
+        << (index < _chunks.size() ? _chunks.at(index) : QByteArray());
+
+    NodeList::getInstance()->writeDatagram(packet, receiver);
+    _unackedChunks.insert(index);
+}
+
+void OctreeJurisdictionHandoff::handleAck(const QUuid& senderUUID, quint32 generation, int index) {
+    if (!isGiving() || senderUUID != _receiverUUID || generation != _generation) {
+        return;
+    }
+    _lastAckTime = usecTimestampNow();
+
+    if (_committing) {
+        if (index == _chunks.size()) {
+            finishGiving();
+        }
+        return;
+    }
+
+    _unackedChunks.remove(index);
+    while (_nextChunk < _chunks.size() && _unackedChunks.size() < HANDOFF_CHUNK_WINDOW) {
+        sendChunk(_nextChunk++);
+    }
+    if (_nextChunk < _chunks.size() || !_unackedChunks.isEmpty()) {
+        return;
+    }
+
+    // the receiver has the whole snapshot, but it's only any good if the subtree hasn't changed since we took it
+    if (hasSubtreeChangedSinceSnapshot()) {
+        if (_generationsSent >= MAX_HANDOFF_GENERATIONS) {
+            qDebug() << "Jurisdiction handoff stopped, the subtree kept changing while it was sent.";
+            stopGiving();
+        } else if (!snapshotSubtree()) {
+            stopGiving();
+        }
+        return;
+    }
+    _committing = true;
+    sendChunk(_chunks.size());
+}
+
+void OctreeJurisdictionHandoff::resendUnackedChunks() {
+    if (!isGiving()) {
+        return;
+    }
+    if (usecTimestampNow() - _lastAckTime > HANDOFF_TIMEOUT_USECS) {
+        qDebug() << "Jurisdiction handoff stopped, no acks from" << _receiverUUID;
+        stopGiving();
+        return;
+    }
+    foreach (int index, _unackedChunks) {
+        sendChunk(index);
+    }
+}
+
+void OctreeJurisdictionHandoff::finishGiving() {
+    Octree* tree = _server->getOctree();
+    tree->lockForWrite();
+    tree->deleteOctalCodeFromTree(codeForByteArray(_givingCode));
+    tree->unlock();
+
+    // the subtree becomes one of our end nodes, the map copies the codes it's given
+    JurisdictionMap* oldJurisdiction = _server->getJurisdiction();
+    std::vector<unsigned char*> endNodes;
+    for (int i = 0; oldJurisdiction && i < oldJurisdiction->getEndNodeCount(); i++) {
+        endNodes.push_back(oldJurisdiction->getEndNodeOctalCode(i));
+    }
+    endNodes.push_back(reinterpret_cast<unsigned char*>(_givingCode.data()));
+
+    JurisdictionMap* jurisdiction = new JurisdictionMap(_server->getMyNodeType());
+    jurisdiction->copyContents(oldJurisdiction ? oldJurisdiction->getRootOctalCode() : NULL, endNodes);
+    _server->setJurisdiction(jurisdiction);
+
+    qDebug() << "Handed off jurisdiction over" << octalCodeToHexString(codeForByteArray(_givingCode))
+        << "to" << _receiverUUID;
+    stopGiving();
+}
+
+void OctreeJurisdictionHandoff::stopGiving() {
+    _resendTimer.stop();
+    _receiverUUID = QUuid();
+    _chunks.clear();
+    _unackedChunks.clear();
+    _committing = false;
+}
+
+void OctreeJurisdictionHandoff::handleData(const SharedNodePointer& sendingNode, quint32 generation, int index, int count,
+                                           const QByteArray& code, const QByteArray& chunk) {
+    bool isFromGiver = (sendingNode->getUUID() == _giverUUID && generation == _receivingGeneration);
+
+    // the ack of a commit may have been lost after we took the subtree
+    JurisdictionMap* jurisdiction = _server->getJurisdiction();
+    if (isFromGiver && index == count && jurisdiction && jurisdiction->getRootOctalCode()
+            && byteArrayForCode(jurisdiction->getRootOctalCode()) == code) {
+        sendAck(sendingNode, generation, index);
+        return;
+    }
+
+    // we take a subtree only when we have none, since a jurisdiction has only one root
+    if (!isSpare()) {
+        return;
+    }
+
+    if (!isFromGiver) {
+        _giverUUID = sendingNode->getUUID();
+        _receivingGeneration = generation;
+        _receivingChunkCount = count;
+        _receivingCode = code;
+        _receivedChunks.clear();
+    }
+
+    if (index < _receivingChunkCount) {
+        _receivedChunks.insert(index, chunk);
+        sendAck(sendingNode, generation, index);
+    } else if (_receivedChunks.size() == _receivingChunkCount) {
+        adoptSubtree();
+        sendAck(sendingNode, generation, index);
+    }
+}
+
+void OctreeJurisdictionHandoff::adoptSubtree() {
+    Octree* tree = _server->getOctree();
+    PacketVersion version = tree->expectedVersion();
+
+    tree->lockForWrite();
+    tree->deleteOctalCodeFromTree(codeForByteArray(_receivingCode));
+    foreach (const QByteArray& chunk, _receivedChunks) {
+        ReadBitstreamToTreeParams args(WANT_COLOR, NO_EXISTS_BITS, NULL, 0, SharedNodePointer(), false, version);
+        tree->readBitstreamToTree(reinterpret_cast<const unsigned char*>(chunk.constData()), chunk.size(), args);
+    }
+    tree->unlock();
+    _receivedChunks.clear();
+
+    std::vector<unsigned char*> noEndNodes;
+    JurisdictionMap* jurisdiction = new JurisdictionMap(_server->getMyNodeType());
+    jurisdiction->copyContents(reinterpret_cast<unsigned char*>(_receivingCode.data()), noEndNodes);
+    _server->setJurisdiction(jurisdiction);
+
+    qDebug() << "Took jurisdiction over" << octalCodeToHexString(codeForByteArray(_receivingCode))
+        << "from" << _giverUUID;
+}
+
+void OctreeJurisdictionHandoff::sendAck(const SharedNodePointer& giver, quint32 generation, int index) {
+    QByteArray packet = byteArrayWithPopulatedHeader(PacketTypeJurisdictionHandoffAck);
+    QDataStream packetStream(&packet, QIODevice::Append);
+    packetStream << generation << (qint32)index;
+    NodeList::getInstance()->writeDatagram(packet, giver);
+}
@@ -0,0 +1,88 @@
+//
+//  OctreeJurisdictionHandoff.h
+//  assignment-client/src/octree
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#ifndef hifi_OctreeJurisdictionHandoff_h
+#define hifi_OctreeJurisdictionHandoff_h
+
+#include <QtCore/QByteArray>
+#include <QtCore/QMap>
+#include <QtCore/QObject>
+#include <QtCore/QSet>
+#include <QtCore/QTimer>
+#include <QtCore/QUuid>
+#include <QtCore/QVector>
+
+#include <Node.h>
+
+class OctreeServer;
+
+/// Moves a subtree of one octree server's jurisdiction to a spare server of the same type, while both keep serving.
+/// The domain server starts a handoff by sending the giving server a PacketTypeJurisdictionHandoffRequest naming the
+/// spare. The giver picks the subtree that holds about half of its clients' cameras, snapshots it into chunks and sends
+/// them to the spare until each is acked. If the subtree was edited while it was being sent, the giver sends it again
+/// as a new generation, otherwise it sends a commit. The spare loads the chunks and takes the subtree as its
+/// jurisdiction on the commit, and the giver drops the subtree and adds it to its end nodes on the commit's ack. Both
+/// then broadcast their new jurisdictions, so the clients' edits follow.
+class OctreeJurisdictionHandoff : public QObject {
+    Q_OBJECT
+public:
+    OctreeJurisdictionHandoff(OctreeServer* server);
+
+    /// handles the handoff packet types, the request only from the domain server and the rest from our own type
+    void processPacket(const SharedNodePointer& sendingNode, const QByteArray& packet);
+
+    /// a spare has no jurisdiction of its own, and waits to be handed one
+    bool isSpare() const;
+
+    bool isGiving() const { return !_receiverUUID.isNull(); }
+
+private slots:
+    void resendUnackedChunks();
+
+private:
+    void startGiving(const QUuid& receiverUUID);
+    QByteArray chooseSubtree() const;
+    bool snapshotSubtree();
+    bool hasSubtreeChangedSinceSnapshot();
+    void sendChunk(int index);
+    void handleAck(const QUuid& senderUUID, quint32 generation, int index);
+    void finishGiving();
+    void stopGiving();
+
+    void handleData(const SharedNodePointer& sendingNode, quint32 generation, int index, int count,
+                    const QByteArray& code, const QByteArray& chunk);
+    void adoptSubtree();
+    void sendAck(const SharedNodePointer& giver, quint32 generation, int index);
+
+    OctreeServer* _server;
+    QTimer _resendTimer;
+
+    // the handoff we're giving
+    QUuid _receiverUUID;
+    QByteArray _givingCode;
+    quint32 _generation;
+    int _generationsSent;
+    quint64 _snapshotTime;
+    bool _snapshotHadSubtree;
+    QVector<QByteArray> _chunks;
+    int _nextChunk;
+    QSet<int> _unackedChunks;
+    bool _committing;
+    quint64 _lastAckTime;
+
+    // the handoff we're being given
+    QUuid _giverUUID;
+    quint32 _receivingGeneration;
+    int _receivingChunkCount;
+    QByteArray _receivingCode;
+    QMap<int, QByteArray> _receivedChunks;
+};
+
+#endif // hifi_OctreeJurisdictionHandoff_h
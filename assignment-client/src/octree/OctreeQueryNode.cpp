@@ -15,11 +15,22 @@
 #include <cstring>
 #include <cstdio>
 #include "OctreeSendThread.h"
+#include "OctreeServer.h"
+
+// a view that last changed longer ago than this was still, rather than moving slowly
+const quint64 MAX_VIEW_MOTION_SAMPLE_USECS = 200 * USECS_PER_MSEC;
+const float VIEW_MOTION_SMOOTHING = 0.5f;
+
+// how far ahead the view is predicted, about as long as it takes the elements that are sent to reach the client
+const float VIEW_PREDICTION_SECONDS = 0.25f;
+const float MAX_PREDICTED_VIEW_ANGLE = PI_OVER_TWO;
+const float MIN_PREDICTED_VIEW_SPEED = 2.0f;
+const float MIN_PREDICTED_VIEW_ANGULAR_SPEED = 0.5f;
 
 OctreeQueryNode::OctreeQueryNode() :
     _viewSent(false),
-    _octreePacket(new unsigned char[MAX_PACKET_SIZE]),
-    _octreePacketAt(_octreePacket),
+    _octreePacket(NULL),
+    _octreePacketAt(NULL),
     _octreePacketAvailableBytes(MAX_PACKET_SIZE),
     _octreePacketWaiting(false),
     _lastOctreePacket(new unsigned char[MAX_PACKET_SIZE]), 
@@ -31,19 +42,37 @@ OctreeQueryNode::OctreeQueryNode() :
     _lastTimeBagEmpty(0),
     _viewFrustumChanging(false),
     _viewFrustumJustStoppedChanging(true),
+    _lastViewChange(0),
+    _viewVelocity(),
+    _viewAngularVelocity(),
+    _hasPredictedViewFrustum(false),
     _currentPacketIsColor(true),
     _currentPacketIsCompressed(false),
     _octreeSendThread(NULL),
     _lastClientBoundaryLevelAdjust(0),
     _lastClientOctreeSizeScale(DEFAULT_OCTREE_SIZE_SCALE),
+    _lastClientWantBulkSync(false),
+    _lastClientBulkSyncBounds(),
     _lodChanged(false),
     _lodInitialized(false),
     _sequenceNumber(0),
     _lastRootTimestamp(0),
     _myPacketType(PacketTypeUnknown),
     _isShuttingDown(false),
-    _sentPacketHistory()
+    _sentPacketHistory(),
+    _nackedSequenceNumbers(),
+    _congestionControl(),
+    _congestionBoundaryLevelAdjust(0),
+    _congestionLimitedSince(0),
+    _lastCongestionChange(0)
 {
+    // the packets are written straight into the history that they are resent from
+    _octreePacket = _sentPacketHistory.getSlot(_sequenceNumber);
+    _octreePacketAt = _octreePacket;
+
+    // what looks biggest to the viewer is sent first
+    nodeBag.setViewFrustum(&_currentViewFrustum);
+    prefetchBag.setViewFrustum(&_predictedViewFrustum);
 }
 
 OctreeQueryNode::~OctreeQueryNode() {
@@ -52,7 +81,6 @@ OctreeQueryNode::~OctreeQueryNode() {
         forceNodeShutdown();
     }
     
-    delete[] _octreePacket;
     delete[] _lastOctreePacket;
 }
 
@@ -70,12 +98,11 @@ void OctreeQueryNode::forceNodeShutdown() {
     _isShuttingDown = true;
     nodeBag.unhookNotifications(); // if our node is shutting down, then we no longer need octree element notifications
     if (_octreeSendThread) {
-        // we really need to force our thread to shutdown, this is synchronous, we will block while the thread actually 
-        // shuts down because we really need it to shutdown, and it's ok if we wait for it to complete
+        // we really need to force our thread to shutdown, this is synchronous, deleting it will block while the
+        // scheduler finishes any interval it's running for it, and it's ok if we wait for that to complete
         OctreeSendThread* sendThread = _octreeSendThread;
         _octreeSendThread = NULL;
         sendThread->setIsShuttingDown();
-        sendThread->terminate();
         delete sendThread;
     }
 }
@@ -96,7 +123,9 @@ void OctreeQueryNode::initializeOctreeSendThread(const SharedAssignmentPointer&
     
     // we want to be notified when the thread finishes
     connect(_octreeSendThread, &GenericThread::finished, this, &OctreeQueryNode::sendThreadFinished);
-    _octreeSendThread->initialize(true);
+
+    // rather than running on a thread of its own, it's run an interval at a time on those the server shares out
+    static_cast<OctreeServer*>(myAssignment.data())->getSendScheduler()->add(_octreeSendThread);
 }
 
 bool OctreeQueryNode::packetIsDuplicate() const {
@@ -176,6 +205,9 @@ void OctreeQueryNode::resetOctreePacket() {
     _lastOctreePacketLength = getPacketLength();
     memcpy(_lastOctreePacket, _octreePacket, _lastOctreePacketLength);
 
+    // the next packet is written into the slot it will be kept in for resending
+    _octreePacket = _sentPacketHistory.getSlot(_sequenceNumber);
+
     // If we're moving, and the client asked for low res, then we force monochrome, otherwise, use
     // the clients requested color state.
     _currentPacketIsColor = getWantColor();
@@ -260,9 +292,14 @@ bool OctreeQueryNode::updateCurrentViewFrustum() {
 
     // if there has been a change, then recalculate
     if (!newestViewFrustum.isVerySimilar(_currentViewFrustum)) {
+        updateViewMotion(newestViewFrustum);
         _currentViewFrustum = newestViewFrustum;
         _currentViewFrustum.calculate();
         currentViewFrustumChanged = true;
+
+    } else if (_hasPredictedViewFrustum && usecTimestampNow() - _lastViewChange > MAX_VIEW_MOTION_SAMPLE_USECS) {
+        // the view has stopped, so it isn't going anywhere
+        _hasPredictedViewFrustum = false;
     }
 
     // Also check for LOD changes from the client
@@ -282,6 +319,15 @@ bool OctreeQueryNode::updateCurrentViewFrustum() {
         _lodChanged = false;
     }
 
+    // a bulk sync that's started, stopped or moved is sent again in full, as a change of LOD would be
+    if (_lastClientWantBulkSync != getWantBulkSync() || (getWantBulkSync() &&
+            (_lastClientBulkSyncBounds.getCorner() != getBulkSyncBounds().getCorner() ||
+             _lastClientBulkSyncBounds.getScale() != getBulkSyncBounds().getScale()))) {
+        _lastClientWantBulkSync = getWantBulkSync();
+        _lastClientBulkSyncBounds = getBulkSyncBounds();
+        _lodChanged = true;
+    }
+
     // When we first detect that the view stopped changing, we record this.
     // but we don't change it back to false until we've completely sent this
     // scene.
@@ -292,6 +338,47 @@ bool OctreeQueryNode::updateCurrentViewFrustum() {
     return currentViewFrustumChanged;
 }
 
+void OctreeQueryNode::updateViewMotion(const ViewFrustum& newestViewFrustum) {
+    quint64 now = usecTimestampNow();
+    quint64 sinceLastChange = now - _lastViewChange;
+    _lastViewChange = now;
+    if (sinceLastChange > MAX_VIEW_MOTION_SAMPLE_USECS || sinceLastChange == 0) {
+        // the view was still until now, so it has no motion to go by yet
+        _viewVelocity = glm::vec3();
+        _viewAngularVelocity = glm::vec3();
+        _hasPredictedViewFrustum = false;
+        return;
+    }
+    float seconds = (float)sinceLastChange / USECS_PER_SECOND;
+
+    glm::vec3 velocity = (newestViewFrustum.getPosition() - _currentViewFrustum.getPosition()) / seconds;
+    glm::quat rotation = newestViewFrustum.getOrientation() * glm::inverse(_currentViewFrustum.getOrientation());
+    if (rotation.w < 0.0f) {
+        rotation = -rotation; // the short way around
+    }
+    float angle = glm::angle(rotation);
+    glm::vec3 angularVelocity = (angle > EPSILON) ? glm::axis(rotation) * (angle / seconds) : glm::vec3();
+
+    _viewVelocity = glm::mix(_viewVelocity, velocity, VIEW_MOTION_SMOOTHING);
+    _viewAngularVelocity = glm::mix(_viewAngularVelocity, angularVelocity, VIEW_MOTION_SMOOTHING);
+
+    float speed = glm::length(_viewVelocity);
+    float angularSpeed = glm::length(_viewAngularVelocity);
+    _hasPredictedViewFrustum = (speed > MIN_PREDICTED_VIEW_SPEED || angularSpeed > MIN_PREDICTED_VIEW_ANGULAR_SPEED);
+    if (!_hasPredictedViewFrustum) {
+        return;
+    }
+
+    _predictedViewFrustum = newestViewFrustum;
+    _predictedViewFrustum.setPosition(newestViewFrustum.getPosition() + _viewVelocity * VIEW_PREDICTION_SECONDS);
+    if (angularSpeed > EPSILON) {
+        float predictedAngle = glm::min(angularSpeed * VIEW_PREDICTION_SECONDS, MAX_PREDICTED_VIEW_ANGLE);
+        _predictedViewFrustum.setOrientation(glm::angleAxis(predictedAngle, _viewAngularVelocity / angularSpeed)
+                                             * newestViewFrustum.getOrientation());
+    }
+    _predictedViewFrustum.calculate();
+}
+
 void OctreeQueryNode::setViewSent(bool viewSent) {
     _viewSent = viewSent;
     if (viewSent) {
@@ -365,14 +452,22 @@ void OctreeQueryNode::dumpOutOfView() {
 }
 
 void OctreeQueryNode::octreePacketSent() {
-    packetSent(_octreePacket, getPacketLength());
+    // the packet was written in its slot of the history, so there's nothing to copy
+    _sentPacketHistory.packetSent(_sequenceNumber, getPacketLength());
+    _sequenceNumber++;
 }
 
 void OctreeQueryNode::packetSent(unsigned char* packet, int packetLength) {
-    packetSent(QByteArray((char*)packet, packetLength));
+    packetSent(QByteArray::fromRawData((char*)packet, packetLength));
 }
 
 void OctreeQueryNode::packetSent(const QByteArray& packet) {
+    // the packet being written is in the slot that this one takes, so it moves over to the next one
+    unsigned char* nextSlot = _sentPacketHistory.getSlot(_sequenceNumber + 1);
+    memcpy(nextSlot, _octreePacket, getPacketLength());
+    _octreePacketAt = nextSlot + (_octreePacketAt - _octreePacket);
+    _octreePacket = nextSlot;
+
     _sentPacketHistory.packetSent(_sequenceNumber, packet);
     _sequenceNumber++;
 }
@@ -381,27 +476,53 @@ bool OctreeQueryNode::hasNextNackedPacket() const {
     return !_nackedSequenceNumbers.isEmpty();
 }
 
-const QByteArray* OctreeQueryNode::getNextNackedPacket() {
+QByteArray OctreeQueryNode::getNextNackedPacket() {
     if (!_nackedSequenceNumbers.isEmpty()) {
         // could return null if packet is not in the history
         return _sentPacketHistory.getPacket(_nackedSequenceNumbers.dequeue());
     }
-    return NULL;
+    return QByteArray();
 }
 
-void OctreeQueryNode::parseNackPacket(QByteArray& packet) {
+// a scene held back by congestion for this long is sent a level of detail coarser
+const quint64 CONGESTION_COARSEN_USECS = 5 * USECS_PER_SECOND;
+
+// and a level is given back once nothing has been held back for this long
+const quint64 CONGESTION_RELAX_USECS = 15 * USECS_PER_SECOND;
 
-    int numBytesPacketHeader = numBytesForPacketHeader(packet);
-    const unsigned char* dataAt = reinterpret_cast<const unsigned char*>(packet.data()) + numBytesPacketHeader;
+const int MAX_CONGESTION_BOUNDARY_LEVEL_ADJUST = 3;
+
+void OctreeQueryNode::updateCongestionBoundaryLevelAdjust(bool wasCongestionLimited) {
+    quint64 now = usecTimestampNow();
+    if (wasCongestionLimited) {
+        _lastCongestionChange = now;
+        if (_congestionLimitedSince == 0) {
+            _congestionLimitedSince = now;
+
+        } else if (now - _congestionLimitedSince > CONGESTION_COARSEN_USECS &&
+                _congestionBoundaryLevelAdjust < MAX_CONGESTION_BOUNDARY_LEVEL_ADJUST) {
+            _congestionBoundaryLevelAdjust++;
+            _congestionLimitedSince = now;
+            _lodChanged = true;
+        }
+        return;
+    }
+    _congestionLimitedSince = 0;
+    if (_congestionBoundaryLevelAdjust > 0 && now - _lastCongestionChange > CONGESTION_RELAX_USECS) {
+        _congestionBoundaryLevelAdjust--;
+        _lastCongestionChange = now;
+        _lodChanged = true;
+    }
+}
 
-    // read number of sequence numbers
-    uint16_t numSequenceNumbers = (*(uint16_t*)dataAt);
-    dataAt += sizeof(uint16_t);
+void OctreeQueryNode::parseNackPacket(QByteArray& packet) {
+    SelectiveAck ack;
+    if (!ack.unpackFromPacket(packet)) {
+        return;
+    }
+    _congestionControl.ackReceived(ack, usecTimestampNow());
 
-    // read sequence numbers
-    for (int i = 0; i < numSequenceNumbers; i++) {
-        OCTREE_PACKET_SEQUENCE sequenceNumber = (*(OCTREE_PACKET_SEQUENCE*)dataAt);
+    foreach (OCTREE_PACKET_SEQUENCE sequenceNumber, ack.getMissingSequenceNumbers()) {
         _nackedSequenceNumbers.enqueue(sequenceNumber);
-        dataAt += sizeof(OCTREE_PACKET_SEQUENCE);
     }
 }
@@ -15,8 +15,10 @@
 #include <iostream>
 
 
+#include <CongestionControl.h>
 #include <CoverageMap.h>
 #include <NodeData.h>
+#include <OcclusionBuffer.h>
 #include <OctreeConstants.h>
 #include <OctreeElementBag.h>
 #include <OctreePacketData.h>
@@ -57,10 +59,17 @@ public:
     void setMaxLevelReached(int maxLevelReached) { _maxLevelReachedInLastSearch = maxLevelReached; }
 
     OctreeElementBag nodeBag;
+    OctreeElementBag prefetchBag; /// the elements of the predicted view, sent with what's left once the scene is sent
     CoverageMap map;
+    OcclusionBuffer occlusionBuffer;
 
     ViewFrustum& getCurrentViewFrustum() { return _currentViewFrustum; }
     ViewFrustum& getLastKnownViewFrustum() { return _lastKnownViewFrustum; }
+
+    /// the view the client is expected to have shortly if it keeps turning and moving as it has been, which is worth
+    /// prefetching only while it's turning or moving fast enough
+    bool hasPredictedViewFrustum() const { return _hasPredictedViewFrustum; }
+    ViewFrustum& getPredictedViewFrustum() { return _predictedViewFrustum; }
     
     // These are not classic setters because they are calculating and maintaining state
     // which is set asynchronously through the network receive
@@ -108,9 +117,22 @@ public:
 
     OCTREE_PACKET_SEQUENCE getSequenceNumber() const { return _sequenceNumber; }
 
+    /// reads an ack from the client, queueing the packets it is missing to be resent
     void parseNackPacket(QByteArray& packet);
     bool hasNextNackedPacket() const;
-    const QByteArray* getNextNackedPacket();
+
+    /// how fast the acks from the client say it can be sent to
+    const CongestionControl& getCongestionControl() const { return _congestionControl; }
+
+    /// the levels of detail held back because the path to the client can't keep up, on top of the client's own adjust
+    int getCongestionBoundaryLevelAdjust() const { return _congestionBoundaryLevelAdjust; }
+
+    /// called after each send interval, with whether the congestion control kept it from sending what was waiting. A
+    /// scene that's held up for long drops a level of detail, and one is given back once the path has kept up for long
+    void updateCongestionBoundaryLevelAdjust(bool wasCongestionLimited);
+    
+    /// returns the packet without copying it out of the history, so it has to be sent before any other packet is
+    QByteArray getNextNackedPacket();
 
 private slots:
     void sendThreadFinished();
@@ -118,6 +140,8 @@ private slots:
 private:
     OctreeQueryNode(const OctreeQueryNode &);
     OctreeQueryNode& operator= (const OctreeQueryNode&);
+
+    void updateViewMotion(const ViewFrustum& newestViewFrustum);
     
     bool _viewSent;
     unsigned char* _octreePacket;
@@ -137,6 +161,11 @@ private:
     quint64 _lastTimeBagEmpty;
     bool _viewFrustumChanging;
     bool _viewFrustumJustStoppedChanging;
+    quint64 _lastViewChange;
+    glm::vec3 _viewVelocity; /// smoothed, in meters per second
+    glm::vec3 _viewAngularVelocity; /// smoothed, its axis is that of the turn and its length the radians per second
+    bool _hasPredictedViewFrustum;
+    ViewFrustum _predictedViewFrustum;
     bool _currentPacketIsColor;
     bool _currentPacketIsCompressed;
 
@@ -145,6 +174,8 @@ private:
     // watch for LOD changes
     int _lastClientBoundaryLevelAdjust;
     float _lastClientOctreeSizeScale;
+    bool _lastClientWantBulkSync;
+    AACube _lastClientBulkSyncBounds;
     bool _lodChanged;
     bool _lodInitialized;
 
@@ -157,6 +188,10 @@ private:
 
     SentPacketHistory _sentPacketHistory;
     QQueue<OCTREE_PACKET_SEQUENCE> _nackedSequenceNumbers;
+    CongestionControl _congestionControl;
+    int _congestionBoundaryLevelAdjust;
+    quint64 _congestionLimitedSince; /// when the intervals started being held back by congestion, 0 if they aren't
+    quint64 _lastCongestionChange; /// when the congestion adjust last changed, or the path last held an interval back
 };
 
 #endif // hifi_OctreeQueryNode_h
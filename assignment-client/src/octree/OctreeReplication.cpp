@@ -0,0 +1,481 @@
+//
+//  OctreeReplication.cpp
+//  assignment-client/src/octree
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#include <QtCore/QDataStream>
+#include <QtCore/QDebug>
+
+#include <NodeList.h>
+#include <OctalCode.h>
+#include <OctreeEditJournal.h>
+#include <PacketHeaders.h>
+#include <SharedUtil.h>
+
+#include "OctreeReplication.h"
+#include "OctreeServer.h"
+
+// leaves room in the packet for our header, the snapshot's id and sequence, and the chunk's index and count
+const int REPLICA_CHUNK_OVERHEAD = 64;
+const int MAX_REPLICA_CHUNK_SIZE = MAX_OCTREE_PACKET_DATA_SIZE - REPLICA_CHUNK_OVERHEAD;
+
+// the chunks or edits sent for each subscribe
+const int REPLICA_WINDOW = 32;
+
+// the edits the primary keeps to resend, a replica that misses older ones fetches a new snapshot
+const int MAX_RECENT_EDITS = 4096;
+
+// the edits a replica holds while it waits for the ones before them
+const int MAX_PENDING_EDITS = 4096;
+
+// a snapshot is shared by the replicas that start syncing while it's this young
+const quint64 MAX_SNAPSHOT_AGE_USECS = 10 * USECS_PER_SECOND;
+
+const int SUBSCRIBE_INTERVAL_MSECS = 250;
+const quint64 SYNCED_SUBSCRIBE_INTERVAL_USECS = USECS_PER_SECOND;
+const quint64 REPLICA_TIMEOUT_USECS = 5 * USECS_PER_SECOND;
+
+OctreeReplication::OctreeReplication(OctreeServer* server, bool isReplica, const QByteArray& primaryRoot) :
+    _server(server),
+    _isReplica(isReplica),
+    _journalMutex(),
+    _lastSequence(0),
+    _recentEdits(),
+    _firstRecentSequence(1),
+    _replicas(),
+    _snapshot(),
+    _snapshotID(0),
+    _snapshotSequence(0),
+    _snapshotTime(0),
+    _primaryRoot(primaryRoot),
+    _primaryUUID(),
+    _jurisdictionRoot(),
+    _jurisdictionEndNodes(),
+    _isSynced(false),
+    _fetchingSnapshotID(0),
+    _fetchingSnapshotSequence(0),
+    _fetchingChunkCount(0),
+    _fetchedChunks(),
+    _nextSequence(0),
+    _pendingEdits(),
+    _lastHeardFromPrimary(0),
+    _lastSubscribe(0),
+    _subscribeTimer()
+{
+    connect(&_subscribeTimer, &QTimer::timeout, this, &OctreeReplication::sendSubscribe);
+}
+
+int OctreeReplication::getReplicaCount() {
+    QMutexLocker locker(&_journalMutex);
+    return _replicas.size();
+}
+
+void OctreeReplication::start() {
+    if (_isReplica) {
+        _subscribeTimer.start(SUBSCRIBE_INTERVAL_MSECS);
+    }
+}
+
+void OctreeReplication::processPacket(const SharedNodePointer& sendingNode, const QByteArray& packet) {
+    if (!sendingNode || sendingNode->getType() != _server->getMyNodeType()) {
+        return;
+    }
+    switch (packetTypeForPacket(packet)) {
+        case PacketTypeOctreeReplicaSubscribe:
+            if (!_isReplica) {
+                handleSubscribe(sendingNode, packet);
+            }
+            break;
+        case PacketTypeOctreeReplicaForwardedEdit:
+            if (!_isReplica) {
+                handleForwardedEdit(packet);
+            }
+            break;
+        case PacketTypeOctreeReplicaState:
+            if (_isReplica) {
+                handleState(sendingNode, packet);
+            }
+            break;
+        case PacketTypeOctreeReplicaSnapshot:
+            if (_isReplica) {
+                handleSnapshotChunk(sendingNode, packet);
+            }
+            break;
+        case PacketTypeOctreeReplicaEdit:
+            if (_isReplica) {
+                handleEdit(sendingNode, packet);
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+void OctreeReplication::handleSubscribe(const SharedNodePointer& replica, const QByteArray& packet) {
+    QDataStream packetStream(packet);
+    packetStream.skipRawData(numBytesForPacketHeader(packet));
+    bool isSynced;
+    quint32 snapshotID;
+    qint32 firstMissingChunk;
+    quint64 nextSequence;
+    packetStream >> isSynced >> snapshotID >> firstMissingChunk >> nextSequence;
+    if (packetStream.status() != QDataStream::Ok) {
+        return;
+    }
+
+    _journalMutex.lock();
+    if (!_replicas.contains(replica->getUUID())) {
+        qDebug() << "Replica" << replica->getUUID() << "subscribed.";
+    }
+    _replicas.insert(replica->getUUID(), usecTimestampNow());
+    _journalMutex.unlock();
+
+    sendState(replica);
+
+    if (isSynced) {
+        sendRecentEdits(replica, nextSequence);
+        return;
+    }
+
+    if (snapshotID == 0 || snapshotID != _snapshotID) {
+        if (_snapshotID == 0 || usecTimestampNow() - _snapshotTime > MAX_SNAPSHOT_AGE_USECS) {
+            Octree* tree = _server->getOctree();
+            tree->lockForRead();
+
+            // the edits are recorded with the tree locked, so the snapshot has all of them up to here and none after
+            _journalMutex.lock();
+            _snapshotSequence = _lastSequence;
+            _journalMutex.unlock();
+
+            _snapshot.clear();
+            if (!tree->encodeSubtreeToChunks(tree->getRoot(), MAX_REPLICA_CHUNK_SIZE, _snapshot)) {
+                qDebug() << "Couldn't snapshot the tree for a replica, an element didn't fit in a chunk.";
+                _snapshot.clear();
+            }
+            tree->unlock();
+
+            _snapshotID++;
+            _snapshotTime = usecTimestampNow();
+        }
+        firstMissingChunk = 0;
+    }
+    sendSnapshotChunks(replica, firstMissingChunk);
+}
+
+void OctreeReplication::sendState(const SharedNodePointer& replica) {
+    _journalMutex.lock();
+    quint64 lastSequence = _lastSequence;
+    quint64 firstRecentSequence = _firstRecentSequence;
+    _journalMutex.unlock();
+
+    QByteArray packet = byteArrayWithPopulatedHeader(PacketTypeOctreeReplicaState);
+    QDataStream packetStream(&packet, QIODevice::Append);
+    packetStream << lastSequence << firstRecentSequence;
+
+    // without a jurisdiction the whole tree is ours
+    JurisdictionMap* jurisdiction = _server->getJurisdiction();
+    QByteArray root;
+    QList<QByteArray> endNodes;
+    if (jurisdiction && jurisdiction->getRootOctalCode()) {
+        unsigned char* rootCode = jurisdiction->getRootOctalCode();
+        root = QByteArray(reinterpret_cast<const char*>(rootCode),
+                          (int)bytesRequiredForCodeLength(numberOfThreeBitSectionsInCode(rootCode)));
+        for (int i = 0; i < jurisdiction->getEndNodeCount(); i++) {
+            unsigned char* endNodeCode = jurisdiction->getEndNodeOctalCode(i);
+            endNodes.append(QByteArray(reinterpret_cast<const char*>(endNodeCode),
+                                       (int)bytesRequiredForCodeLength(numberOfThreeBitSectionsInCode(endNodeCode))));
+        }
+    }
+    packetStream << (jurisdiction != NULL) << root << endNodes;
+
+    NodeList::getInstance()->writeDatagram(packet, replica);
+}
+
+void OctreeReplication::sendSnapshotChunks(const SharedNodePointer& replica, int firstChunk) {
+    int lastChunk = qMin(firstChunk + REPLICA_WINDOW, _snapshot.size());
+
+    // an empty tree is sent as a single packet without a chunk
+    for (int index = firstChunk; index < lastChunk || (index == 0 && _snapshot.isEmpty()); index++) {
+        QByteArray packet = byteArrayWithPopulatedHeader(PacketTypeOctreeReplicaSnapshot);
+        QDataStream packetStream(&packet, QIODevice::Append);
+        packetStream << _snapshotID << _snapshotSequence << (qint32)index << (qint32)_snapshot.size()
+            << (index < _snapshot.size() ? _snapshot.at(index) : QByteArray());
+        NodeList::getInstance()->writeDatagram(packet, replica);
+    }
+}
+
+void OctreeReplication::sendRecentEdits(const SharedNodePointer& replica, quint64 firstSequence) {
+    QList<QByteArray> packets;
+
+    _journalMutex.lock();
+    if (firstSequence >= _firstRecentSequence) {
+        for (quint64 sequence = firstSequence; sequence <= _lastSequence && sequence < firstSequence + REPLICA_WINDOW;
+                sequence++) {
+            QByteArray packet = byteArrayWithPopulatedHeader(PacketTypeOctreeReplicaEdit);
+            QDataStream packetStream(&packet, QIODevice::Append);
+            packetStream << sequence << _recentEdits.at((int)(sequence - _firstRecentSequence));
+            packets.append(packet);
+        }
+    }
+    _journalMutex.unlock();
+
+    foreach (const QByteArray& packet, packets) {
+        NodeList::getInstance()->writeDatagram(packet, replica);
+    }
+}
+
+void OctreeReplication::recordEditPacket(const QByteArray& editPacket) {
+    if (_isReplica) {
+        return;
+    }
+    quint64 now = usecTimestampNow();
+    QList<QUuid> replicaUUIDs;
+
+    _journalMutex.lock();
+    quint64 sequence = ++_lastSequence;
+    _recentEdits.enqueue(editPacket);
+    while (_recentEdits.size() > MAX_RECENT_EDITS) {
+        _recentEdits.dequeue();
+        _firstRecentSequence++;
+    }
+    QHash<QUuid, quint64>::iterator replica = _replicas.begin();
+    while (replica != _replicas.end()) {
+        if (now - replica.value() > REPLICA_TIMEOUT_USECS) {
+            qDebug() << "Replica" << replica.key() << "stopped subscribing.";
+            replica = _replicas.erase(replica);
+        } else {
+            replicaUUIDs.append(replica.key());
+            ++replica;
+        }
+    }
+    _journalMutex.unlock();
+
+    if (replicaUUIDs.isEmpty()) {
+        return;
+    }
+    QByteArray packet = byteArrayWithPopulatedHeader(PacketTypeOctreeReplicaEdit);
+    QDataStream packetStream(&packet, QIODevice::Append);
+    packetStream << sequence << editPacket;
+
+    NodeList* nodeList = NodeList::getInstance();
+    foreach (const QUuid& replicaUUID, replicaUUIDs) {
+        SharedNodePointer replicaNode = nodeList->nodeWithUUID(replicaUUID);
+        if (replicaNode) {
+            nodeList->writeDatagram(packet, replicaNode);
+        }
+    }
+}
+
+void OctreeReplication::forwardEditPacket(const SharedNodePointer& sendingNode, const QByteArray& editPacket) {
+    SharedNodePointer primary = NodeList::getInstance()->nodeWithUUID(_primaryUUID);
+    if (!sendingNode || !primary) {
+        return;
+    }
+    QByteArray packet = byteArrayWithPopulatedHeader(PacketTypeOctreeReplicaForwardedEdit);
+    QDataStream packetStream(&packet, QIODevice::Append);
+    packetStream << sendingNode->getUUID() << editPacket;
+    NodeList::getInstance()->writeDatagram(packet, primary);
+}
+
+void OctreeReplication::handleForwardedEdit(const QByteArray& packet) {
+    QDataStream packetStream(packet);
+    packetStream.skipRawData(numBytesForPacketHeader(packet));
+    QUuid senderUUID;
+    QByteArray editPacket;
+    packetStream >> senderUUID >> editPacket;
+
+    // the replica checked the edit came from its sender, and we process it as though the sender sent it to us
+    SharedNodePointer sender = NodeList::getInstance()->nodeWithUUID(senderUUID);
+    if (packetStream.status() == QDataStream::Ok && sender
+            && _server->getOctree()->handlesEditPacketType(packetTypeForPacket(editPacket))) {
+        _server->queueEditPacket(sender, editPacket);
+    }
+}
+
+void OctreeReplication::sendSubscribe() {
+    quint64 now = usecTimestampNow();
+    if (!_primaryUUID.isNull() && now - _lastHeardFromPrimary > REPLICA_TIMEOUT_USECS) {
+        qDebug() << "Lost the primary" << _primaryUUID << ", looking for another.";
+        _primaryUUID = QUuid();
+        resync();
+    }
+
+    // once synced, the edits come as they're made, so we only need to keep subscribed and ask for what we missed
+    if (_isSynced && _pendingEdits.isEmpty() && now - _lastSubscribe < SYNCED_SUBSCRIBE_INTERVAL_USECS) {
+        return;
+    }
+    _lastSubscribe = now;
+
+    qint32 firstMissingChunk = 0;
+    while (firstMissingChunk < _fetchingChunkCount && _fetchedChunks.contains(firstMissingChunk)) {
+        firstMissingChunk++;
+    }
+    QByteArray packet = byteArrayWithPopulatedHeader(PacketTypeOctreeReplicaSubscribe);
+    QDataStream packetStream(&packet, QIODevice::Append);
+    packetStream << _isSynced << _fetchingSnapshotID << firstMissingChunk << _nextSequence;
+
+    // until we have a primary, every server of our type is asked, and those that aren't replicas answer
+    NodeList* nodeList = NodeList::getInstance();
+    foreach (const SharedNodePointer& node, nodeList->getNodeHash()) {
+        if (node->getType() == _server->getMyNodeType() && node->getActiveSocket()
+                && (_primaryUUID.isNull() || node->getUUID() == _primaryUUID)) {
+            nodeList->writeDatagram(packet, node);
+        }
+    }
+}
+
+void OctreeReplication::handleState(const SharedNodePointer& primary, const QByteArray& packet) {
+    QDataStream packetStream(packet);
+    packetStream.skipRawData(numBytesForPacketHeader(packet));
+    quint64 lastSequence, firstRecentSequence;
+    bool hasJurisdiction;
+    QByteArray root;
+    QList<QByteArray> endNodes;
+    packetStream >> lastSequence >> firstRecentSequence >> hasJurisdiction >> root >> endNodes;
+    if (packetStream.status() != QDataStream::Ok) {
+        return;
+    }
+
+    if (_primaryUUID.isNull()) {
+        if (!_primaryRoot.isEmpty() && root != _primaryRoot) {
+            return;
+        }
+        _primaryUUID = primary->getUUID();
+        qDebug() << "Replicating the primary" << _primaryUUID;
+    } else if (primary->getUUID() != _primaryUUID) {
+        return;
+    }
+    _lastHeardFromPrimary = usecTimestampNow();
+
+    if (hasJurisdiction && (root != _jurisdictionRoot || endNodes != _jurisdictionEndNodes
+            || !_server->getJurisdiction())) {
+        // a handoff of the primary's jurisdiction isn't in the journal, so a new snapshot brings our copy in line
+        if (_isSynced) {
+            resync();
+        }
+        _jurisdictionRoot = root;
+        _jurisdictionEndNodes = endNodes;
+
+        std::vector<unsigned char*> endNodeCodes;
+        for (int i = 0; i < _jurisdictionEndNodes.size(); i++) {
+            endNodeCodes.push_back(reinterpret_cast<unsigned char*>(_jurisdictionEndNodes[i].data()));
+        }
+        JurisdictionMap* jurisdiction = new JurisdictionMap(_server->getMyNodeType());
+        if (_jurisdictionRoot.isEmpty()) {
+            jurisdiction->clear();
+        } else {
+            jurisdiction->copyContents(reinterpret_cast<unsigned char*>(_jurisdictionRoot.data()), endNodeCodes);
+        }
+        _server->setJurisdiction(jurisdiction);
+    }
+
+    if (_isSynced && _nextSequence < firstRecentSequence) {
+        qDebug() << "Fell behind the primary's journal, fetching a new snapshot.";
+        resync();
+    } else if (_isSynced && lastSequence >= _nextSequence) {
+        // the newest edits went missing, so they're asked for on the next tick
+        _lastSubscribe = 0;
+    }
+}
+
+void OctreeReplication::handleSnapshotChunk(const SharedNodePointer& primary, const QByteArray& packet) {
+    if (_isSynced || primary->getUUID() != _primaryUUID) {
+        return;
+    }
+    QDataStream packetStream(packet);
+    packetStream.skipRawData(numBytesForPacketHeader(packet));
+    quint32 snapshotID;
+    quint64 snapshotSequence;
+    qint32 index, count;
+    QByteArray chunk;
+    packetStream >> snapshotID >> snapshotSequence >> index >> count >> chunk;
+    if (packetStream.status() != QDataStream::Ok || index < 0 || count < 0) {
+        return;
+    }
+
+    if (snapshotID != _fetchingSnapshotID) {
+        _fetchingSnapshotID = snapshotID;
+        _fetchingSnapshotSequence = snapshotSequence;
+        _fetchingChunkCount = count;
+        _fetchedChunks.clear();
+    }
+    if (index < _fetchingChunkCount) {
+        _fetchedChunks.insert(index, chunk);
+    }
+
+    if (_fetchedChunks.size() == _fetchingChunkCount) {
+        loadSnapshot();
+    } else if ((index + 1) % REPLICA_WINDOW == 0) {
+        // the end of the window, so we ask for the next one rather than waiting for the timer
+        sendSubscribe();
+    }
+}
+
+void OctreeReplication::loadSnapshot() {
+    Octree* tree = _server->getOctree();
+    PacketVersion version = tree->expectedVersion();
+
+    tree->lockForWrite();
+    tree->eraseAllOctreeElements();
+    foreach (const QByteArray& chunk, _fetchedChunks) {
+        ReadBitstreamToTreeParams args(WANT_COLOR, NO_EXISTS_BITS, NULL, 0, SharedNodePointer(), false, version);
+        tree->readBitstreamToTree(reinterpret_cast<const unsigned char*>(chunk.constData()), chunk.size(), args);
+    }
+    _nextSequence = _fetchingSnapshotSequence + 1;
+    applyPendingEdits();
+    tree->unlock();
+
+    qDebug() << "Loaded the primary's snapshot of" << _fetchingChunkCount << "chunks, following its journal from"
+        << _nextSequence;
+    _fetchedChunks.clear();
+    _isSynced = true;
+}
+
+void OctreeReplication::handleEdit(const SharedNodePointer& primary, const QByteArray& packet) {
+    if (primary->getUUID() != _primaryUUID) {
+        return;
+    }
+    QDataStream packetStream(packet);
+    packetStream.skipRawData(numBytesForPacketHeader(packet));
+    quint64 sequence;
+    QByteArray editPacket;
+    packetStream >> sequence >> editPacket;
+    if (packetStream.status() != QDataStream::Ok || (_isSynced && sequence < _nextSequence)
+            || _pendingEdits.size() >= MAX_PENDING_EDITS) {
+        return;
+    }
+
+    // until we're synced, the edits are held to be applied on top of the snapshot
+    _pendingEdits.insert(sequence, editPacket);
+    if (_isSynced) {
+        Octree* tree = _server->getOctree();
+        tree->lockForWrite();
+        applyPendingEdits();
+        tree->unlock();
+    }
+}
+
+void OctreeReplication::applyPendingEdits() {
+    Octree* tree = _server->getOctree();
+    QMap<quint64, QByteArray>::iterator edit = _pendingEdits.begin();
+    while (edit != _pendingEdits.end() && edit.key() <= _nextSequence) {
+        if (edit.key() == _nextSequence) {
+            OctreeEditJournal::applyEditPacket(edit.value(), tree);
+            _nextSequence++;
+        }
+        edit = _pendingEdits.erase(edit);
+    }
+}
+
+void OctreeReplication::resync() {
+    _isSynced = false;
+    _fetchingSnapshotID = 0;
+    _fetchingChunkCount = 0;
+    _fetchedChunks.clear();
+    _pendingEdits.clear();
+}
@@ -0,0 +1,112 @@
+//
+//  OctreeReplication.h
+//  assignment-client/src/octree
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#ifndef hifi_OctreeReplication_h
+#define hifi_OctreeReplication_h
+
+#include <QtCore/QByteArray>
+#include <QtCore/QHash>
+#include <QtCore/QList>
+#include <QtCore/QMap>
+#include <QtCore/QMutex>
+#include <QtCore/QObject>
+#include <QtCore/QQueue>
+#include <QtCore/QTimer>
+#include <QtCore/QUuid>
+#include <QtCore/QVector>
+
+#include <Node.h>
+
+class OctreeServer;
+
+/// Keeps read only copies of an octree server's tree on replica servers of the same type, which serve clients of their
+/// own so that more clients can see a part of the tree than one server can send to.
+///
+/// A replica subscribes to a primary, which is any server of its type that isn't a replica, or the one whose
+/// jurisdiction has the root given by --replicaRoot. It fetches a snapshot of the primary's tree a window of chunks at a
+/// time, then follows the primary's edit journal: the primary numbers the edit packets it records and sends each to
+/// its replicas, keeping the latest of them to resend to a replica that missed some. A replica that falls further
+/// behind than that fetches a new snapshot. The edits the replica's own clients send it are forwarded to the primary,
+/// and come back through the journal once they're applied.
+class OctreeReplication : public QObject {
+    Q_OBJECT
+public:
+    OctreeReplication(OctreeServer* server, bool isReplica, const QByteArray& primaryRoot = QByteArray());
+
+    bool isReplica() const { return _isReplica; }
+
+    /// a replica is synced once it has loaded a snapshot and is following the journal
+    bool isSynced() const { return _isSynced; }
+    const QUuid& getPrimaryUUID() const { return _primaryUUID; }
+    int getReplicaCount();
+
+    /// starts subscribing to a primary, if we're a replica
+    void start();
+
+    /// handles the replication packet types, which come only from servers of our own type
+    void processPacket(const SharedNodePointer& sendingNode, const QByteArray& packet);
+
+    /// numbers an edit packet that the primary applied and sends it to the replicas, safe to call from any thread
+    void recordEditPacket(const QByteArray& packet);
+
+    /// sends an edit packet a client sent a replica on to the primary
+    void forwardEditPacket(const SharedNodePointer& sendingNode, const QByteArray& packet);
+
+private slots:
+    void sendSubscribe();
+
+private:
+    // primary
+    void handleSubscribe(const SharedNodePointer& replica, const QByteArray& packet);
+    void sendState(const SharedNodePointer& replica);
+    void sendSnapshotChunks(const SharedNodePointer& replica, int firstChunk);
+    void sendRecentEdits(const SharedNodePointer& replica, quint64 firstSequence);
+    void handleForwardedEdit(const QByteArray& packet);
+
+    // replica
+    void handleState(const SharedNodePointer& primary, const QByteArray& packet);
+    void handleSnapshotChunk(const SharedNodePointer& primary, const QByteArray& packet);
+    void handleEdit(const SharedNodePointer& primary, const QByteArray& packet);
+    void loadSnapshot();
+    void applyPendingEdits();
+    void resync();
+
+    OctreeServer* _server;
+    bool _isReplica;
+
+    // primary, the journal is guarded by the mutex since edits are recorded on the inbound packet thread
+    QMutex _journalMutex;
+    quint64 _lastSequence;
+    QQueue<QByteArray> _recentEdits;
+    quint64 _firstRecentSequence;
+    QHash<QUuid, quint64> _replicas; /// when each replica last subscribed
+    QVector<QByteArray> _snapshot;
+    quint32 _snapshotID;
+    quint64 _snapshotSequence;
+    quint64 _snapshotTime;
+
+    // replica
+    QByteArray _primaryRoot;
+    QUuid _primaryUUID;
+    QByteArray _jurisdictionRoot;
+    QList<QByteArray> _jurisdictionEndNodes;
+    bool _isSynced;
+    quint32 _fetchingSnapshotID;
+    quint64 _fetchingSnapshotSequence;
+    int _fetchingChunkCount;
+    QMap<int, QByteArray> _fetchedChunks;
+    quint64 _nextSequence;
+    QMap<quint64, QByteArray> _pendingEdits;
+    quint64 _lastHeardFromPrimary;
+    quint64 _lastSubscribe;
+    QTimer _subscribeTimer;
+};
+
+#endif // hifi_OctreeReplication_h
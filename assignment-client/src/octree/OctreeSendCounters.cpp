@@ -0,0 +1,164 @@
+//
+//  OctreeSendCounters.cpp
+//  assignment-client/src/octree
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#include <QtCore/QDateTime>
+#include <QtCore/QJsonArray>
+#include <QtCore/QList>
+#include <QtCore/QMutexLocker>
+#include <QtCore/QThreadStorage>
+
+#include <cstring>
+
+#include <SharedUtil.h>
+
+#include "OctreeSendCounters.h"
+
+const int TIMELINE_SAMPLES = 10 * 60;
+
+OctreeSendCounters::OctreeSendCounters() :
+    encodeCycles(0),
+    encodes(0),
+    encodedElements(0),
+    bagSizes(0),
+    lockWaitCycles(0),
+    lockWaits(0),
+    packets(0),
+    bytes(0),
+    wastedBytes(0)
+{
+    memset(bytesAtLevel, 0, sizeof(bytesAtLevel));
+}
+
+void OctreeSendCounters::add(const OctreeSendCounters& other) {
+    encodeCycles += other.encodeCycles;
+    encodes += other.encodes;
+    encodedElements += other.encodedElements;
+    bagSizes += other.bagSizes;
+    for (int i = 0; i < MAX_LEVELS; i++) {
+        bytesAtLevel[i] += other.bytesAtLevel[i];
+    }
+    lockWaitCycles += other.lockWaitCycles;
+    lockWaits += other.lockWaits;
+    packets += other.packets;
+    bytes += other.bytes;
+    wastedBytes += other.wastedBytes;
+}
+
+void OctreeSendCounters::encoded(quint64 cycles, quint64 elements, int level, int bytes, int bagSize) {
+    encodeCycles += cycles;
+    encodes++;
+    encodedElements += elements;
+    bagSizes += bagSize;
+    bytesAtLevel[qMin(level, MAX_LEVELS - 1)] += bytes;
+}
+
+// the counters of the threads that are running, and the sum of those of the threads that have finished
+static QMutex countersMutex;
+static QList<OctreeSendCounters*> threadCounters;
+static OctreeSendCounters finishedThreadCounters;
+
+class ThreadCounters {
+public:
+    ThreadCounters() {
+        QMutexLocker locker(&countersMutex);
+        threadCounters.append(&_counters);
+    }
+    ~ThreadCounters() {
+        QMutexLocker locker(&countersMutex);
+        threadCounters.removeOne(&_counters);
+        finishedThreadCounters.add(_counters);
+    }
+
+    OctreeSendCounters _counters;
+};
+
+OctreeSendCounters& OctreeSendCounters::forThisThread() {
+    static QThreadStorage<ThreadCounters*> counters;
+    if (!counters.hasLocalData()) {
+        counters.setLocalData(new ThreadCounters());
+    }
+    return counters.localData()->_counters;
+}
+
+OctreeSendCounters OctreeSendCounters::sumOfAllThreads() {
+    QMutexLocker locker(&countersMutex);
+    OctreeSendCounters sum = finishedThreadCounters;
+    foreach (const OctreeSendCounters* counters, threadCounters) {
+        sum.add(*counters);
+    }
+    return sum;
+}
+
+OctreeSendTimeline::OctreeSendTimeline() :
+    _lastCounters(),
+    _lastSampleTime(usecTimestampNow()),
+    _samples(),
+    _nextSample(0)
+{
+}
+
+void OctreeSendTimeline::sample() {
+    OctreeSendCounters counters = OctreeSendCounters::sumOfAllThreads();
+    quint64 now = usecTimestampNow();
+    float elapsedSeconds = (float)(now - _lastSampleTime) / USECS_PER_SECOND;
+
+    quint64 encodes = counters.encodes - _lastCounters.encodes;
+    quint64 encodedElements = counters.encodedElements - _lastCounters.encodedElements;
+    quint64 lockWaits = counters.lockWaits - _lastCounters.lockWaits;
+    float encodeUsecs = cycleCountsToUsecs(counters.encodeCycles - _lastCounters.encodeCycles);
+    float lockWaitUsecs = cycleCountsToUsecs(counters.lockWaitCycles - _lastCounters.lockWaitCycles);
+
+    QJsonObject sample;
+    sample["time"] = (double)QDateTime::currentMSecsSinceEpoch();
+    sample["seconds"] = elapsedSeconds;
+    sample["encodes"] = (double)encodes;
+    sample["encodeUsecs"] = encodeUsecs;
+    sample["encodedElements"] = (double)encodedElements;
+    sample["encodeUsecsPerElement"] = encodedElements == 0 ? 0.0f : encodeUsecs / encodedElements;
+    sample["averageBagSize"] = encodes == 0 ? 0.0f : (float)(counters.bagSizes - _lastCounters.bagSizes) / encodes;
+
+    QJsonArray bytesPerLevel;
+    for (int i = 0; i < OctreeSendCounters::MAX_LEVELS; i++) {
+        bytesPerLevel.append((double)(counters.bytesAtLevel[i] - _lastCounters.bytesAtLevel[i]));
+    }
+    sample["bytesPerLevel"] = bytesPerLevel;
+
+    sample["lockWaits"] = (double)lockWaits;
+    sample["averageLockWaitUsecs"] = lockWaits == 0 ? 0.0f : lockWaitUsecs / lockWaits;
+    sample["packets"] = (double)(counters.packets - _lastCounters.packets);
+    sample["bytes"] = (double)(counters.bytes - _lastCounters.bytes);
+    sample["wastedBytes"] = (double)(counters.wastedBytes - _lastCounters.wastedBytes);
+
+    _lastCounters = counters;
+    _lastSampleTime = now;
+
+    QMutexLocker locker(&_mutex);
+    if (_samples.size() < TIMELINE_SAMPLES) {
+        _samples.append(sample);
+    } else {
+        _samples[_nextSample] = sample;
+    }
+    _nextSample = (_nextSample + 1) % TIMELINE_SAMPLES;
+}
+
+QJsonObject OctreeSendTimeline::toJSON() {
+    QMutexLocker locker(&_mutex);
+
+    // oldest first
+    QJsonArray samples;
+    int firstSample = (_samples.size() < TIMELINE_SAMPLES) ? 0 : _nextSample;
+    for (int i = 0; i < _samples.size(); i++) {
+        samples.append(_samples.at((firstSample + i) % _samples.size()));
+    }
+
+    QJsonObject timeline;
+    timeline["samples"] = samples;
+    return timeline;
+}
@@ -0,0 +1,71 @@
+//
+//  OctreeSendCounters.h
+//  assignment-client/src/octree
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#ifndef hifi_OctreeSendCounters_h
+#define hifi_OctreeSendCounters_h
+
+#include <QtCore/QJsonObject>
+#include <QtCore/QMutex>
+#include <QtCore/QVector>
+
+#include <CycleCounter.h>
+
+/// Counters of the work of sending octrees to clients, which are cheap enough to keep all the time. Each thread adds to
+/// its own counters, times are in cycleCounterNow() counts, and none are ever reset, so that the timeline can take the
+/// difference between two readings.
+class OctreeSendCounters {
+public:
+    static const int MAX_LEVELS = 16; /// the bytes of deeper subtrees count toward the deepest level
+
+    OctreeSendCounters();
+
+    /// the counters of the calling thread, which only it writes
+    static OctreeSendCounters& forThisThread();
+
+    /// the sum of the counters of all of the threads, which can be a little behind what the threads last added
+    static OctreeSendCounters sumOfAllThreads();
+
+    void add(const OctreeSendCounters& other);
+
+    void encoded(quint64 cycles, quint64 elements, int level, int bytes, int bagSize);
+    void lockWaited(quint64 cycles) { lockWaitCycles += cycles; lockWaits++; }
+    void packetSent(int bytes, int wastedBytes) { packets++; this->bytes += bytes; this->wastedBytes += wastedBytes; }
+
+    quint64 encodeCycles;
+    quint64 encodes;
+    quint64 encodedElements;
+    quint64 bagSizes; /// the sum of the bag's size after each encode
+    quint64 bytesAtLevel[MAX_LEVELS]; /// by the level of the subtree each encode started at
+    quint64 lockWaitCycles;
+    quint64 lockWaits;
+    quint64 packets;
+    quint64 bytes;
+    quint64 wastedBytes;
+};
+
+/// A rolling timeline of the send counters, one sample a second for the last ten minutes, for the status page
+class OctreeSendTimeline {
+public:
+    OctreeSendTimeline();
+
+    /// takes a sample of what the counters added since the last one, call about once a second
+    void sample();
+
+    QJsonObject toJSON();
+
+private:
+    QMutex _mutex; /// the HTTP requests read the samples from another thread than takes them
+    OctreeSendCounters _lastCounters;
+    quint64 _lastSampleTime;
+    QVector<QJsonObject> _samples;
+    int _nextSample;
+};
+
+#endif // hifi_OctreeSendCounters_h
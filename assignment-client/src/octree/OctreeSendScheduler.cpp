@@ -0,0 +1,128 @@
+//
+//  OctreeSendScheduler.cpp
+//  assignment-client/src/octree
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#include <QtCore/QMutexLocker>
+#include <QtCore/QThread>
+
+#include <PerfStat.h>
+#include <SharedUtil.h>
+
+#include "OctreeSendScheduler.h"
+#include "OctreeSendThread.h"
+#include "OctreeServerConsts.h"
+
+bool OctreeSendWorker::process() {
+    return isStillRunning() && _scheduler->runNextInterval();
+}
+
+OctreeSendScheduler::OctreeSendScheduler() :
+    _mutex(),
+    _hasChanged(),
+    _due(),
+    _running(),
+    _workers(),
+    _isStopping(false)
+{
+}
+
+void OctreeSendScheduler::start(int numWorkers) {
+    if (numWorkers <= 0) {
+        numWorkers = qMax(1, QThread::idealThreadCount());
+    }
+    _isStopping = false;
+    for (int i = 0; i < numWorkers; i++) {
+        OctreeSendWorker* worker = new OctreeSendWorker(this);
+        worker->initialize(true);
+        _workers.append(worker);
+    }
+}
+
+void OctreeSendScheduler::stop() {
+    {
+        QMutexLocker locker(&_mutex);
+        _isStopping = true;
+        _hasChanged.wakeAll();
+    }
+    foreach (OctreeSendWorker* worker, _workers) {
+        worker->terminate();
+        delete worker;
+    }
+    _workers.clear();
+}
+
+void OctreeSendScheduler::add(OctreeSendThread* sender) {
+    QMutexLocker locker(&_mutex);
+    _due.insert(usecTimestampNow(), sender);
+    _hasChanged.wakeOne();
+}
+
+void OctreeSendScheduler::remove(OctreeSendThread* sender) {
+    QMutexLocker locker(&_mutex);
+    while (_running.contains(sender)) {
+        _hasChanged.wait(&_mutex);
+    }
+    QMultiMap<quint64, OctreeSendThread*>::iterator i = _due.begin();
+    while (i != _due.end()) {
+        if (i.value() == sender) {
+            i = _due.erase(i);
+        } else {
+            ++i;
+        }
+    }
+}
+
+int OctreeSendScheduler::getNumSenders() {
+    QMutexLocker locker(&_mutex);
+    return _due.size() + _running.size();
+}
+
+bool OctreeSendScheduler::runNextInterval() {
+    QMutexLocker locker(&_mutex);
+    OctreeSendThread* sender = NULL;
+    quint64 start = 0;
+    {
+        PerformanceWarning warn(false, "OctreeSendScheduler... wait()", false,
+                                &OctreeSendThread::_usleepTime, &OctreeSendThread::_usleepCalls);
+        while (!_isStopping) {
+            if (_due.isEmpty()) {
+                _hasChanged.wait(&_mutex);
+                continue;
+            }
+            start = usecTimestampNow();
+            quint64 due = _due.begin().key();
+            if (due <= start) {
+                sender = _due.begin().value();
+                _due.erase(_due.begin());
+                break;
+            }
+            // a client added in the meantime may be due sooner, so this is woken for that too
+            _hasChanged.wait(&_mutex, (unsigned long) qMax((quint64) 1, (due - start) / USECS_PER_MSEC));
+        }
+    }
+    if (!sender) {
+        return false;
+    }
+    _running.insert(sender);
+    locker.unlock();
+
+    bool keepSending = sender->process();
+    if (!keepSending) {
+        // the client's node data deletes it once it's told, which waits for it to be out of the running
+        emit sender->finished();
+    }
+
+    locker.relock();
+    _running.remove(sender);
+    if (keepSending) {
+        _due.insert(start + OCTREE_SEND_INTERVAL_USECS, sender);
+    }
+    _hasChanged.wakeAll();
+    return true;
+}
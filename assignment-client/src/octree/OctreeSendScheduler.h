@@ -0,0 +1,76 @@
+//
+//  OctreeSendScheduler.h
+//  assignment-client/src/octree
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#ifndef hifi_OctreeSendScheduler_h
+#define hifi_OctreeSendScheduler_h
+
+#include <QtCore/QMultiMap>
+#include <QtCore/QMutex>
+#include <QtCore/QSet>
+#include <QtCore/QVector>
+#include <QtCore/QWaitCondition>
+
+#include <GenericThread.h>
+
+class OctreeSendScheduler;
+class OctreeSendThread;
+
+/// One of the threads that the scheduler runs send intervals on
+class OctreeSendWorker : public GenericThread {
+public:
+    OctreeSendWorker(OctreeSendScheduler* scheduler) : _scheduler(scheduler) { }
+
+protected:
+    virtual bool process();
+
+private:
+    OctreeSendScheduler* _scheduler;
+};
+
+/// Runs the send intervals of all of a server's clients on a fixed number of threads, rather than on a thread for each
+/// client. Each client's next interval is due a send interval after its last one started, and the worker threads
+/// always run the interval that's been due longest, so a client that falls behind is caught up first.
+class OctreeSendScheduler {
+public:
+    OctreeSendScheduler();
+    ~OctreeSendScheduler() { stop(); }
+
+    /// starts the worker threads, one for each core if numWorkers isn't given
+    void start(int numWorkers = 0);
+
+    /// stops the worker threads, once they're done with the intervals they're running
+    void stop();
+
+    /// schedules the client's first interval straight away
+    void add(OctreeSendThread* sender);
+
+    /// stops scheduling the client, waiting for the interval it's in if there is one
+    void remove(OctreeSendThread* sender);
+
+    int getNumWorkers() const { return _workers.size(); }
+    int getNumSenders();
+
+    /// waits for the next interval that's due and runs it, returns false once the scheduler's stopped
+    bool runNextInterval();
+
+private:
+    // disallow copying of OctreeSendScheduler objects
+    OctreeSendScheduler(const OctreeSendScheduler&);
+    OctreeSendScheduler& operator= (const OctreeSendScheduler&);
+
+    QMutex _mutex;
+    QWaitCondition _hasChanged; /// signalled when a client is added or an interval finishes
+    QMultiMap<quint64, OctreeSendThread*> _due; /// the clients that are waiting, by when their next interval is due
+    QSet<OctreeSendThread*> _running;
+    QVector<OctreeSendWorker*> _workers;
+    bool _isStopping;
+};
+
+#endif // hifi_OctreeSendScheduler_h
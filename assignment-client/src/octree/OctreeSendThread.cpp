@@ -14,6 +14,7 @@
 #include <PerfStat.h>
 #include <SharedUtil.h>
 
+#include "OctreeSendCounters.h"
 #include "OctreeSendThread.h"
 #include "OctreeServer.h"
 #include "OctreeServerConsts.h"
@@ -49,6 +50,11 @@ OctreeSendThread::~OctreeSendThread() {
     qDebug() << qPrintable(safeServerName)  << "server [" << _myServer << "]: client disconnected "
                                             "- ending sending thread [" << this << "]";
 
+    // we may be deleted while the scheduler is running one of our intervals, which we need to wait out
+    if (_myServer) {
+        _myServer->getSendScheduler()->remove(this);
+    }
+
     OctreeServer::clientDisconnected();
     OctreeServer::stopTrackingThread(this);
 
@@ -73,10 +79,8 @@ bool OctreeSendThread::process() {
 
     OctreeServer::didProcess(this);
 
-    quint64  start = usecTimestampNow();
-
-    // don't do any send processing until the initial load of the octree is complete...
-    if (_myServer->isInitialLoadComplete()) {
+    // don't do any send processing until the initial load of the octree is complete, or under way from an indexed file
+    if (_myServer->isReadyToServe()) {
         if (_node) {
             _nodeMissingCount = 0;
             OctreeQueryNode* nodeData = static_cast<OctreeQueryNode*>(_node->getLinkedData());
@@ -93,22 +97,8 @@ bool OctreeSendThread::process() {
         return false; // exit early if we're shutting down
     }
 
-    // Only sleep if we're still running and we got the lock last time we tried, otherwise try to get the lock asap
-    if (isStillRunning()) {
-        // dynamically sleep until we need to fire off the next set of octree elements
-        int elapsed = (usecTimestampNow() - start);
-        int usecToSleep =  OCTREE_SEND_INTERVAL_USECS - elapsed;
-
-        if (usecToSleep > 0) {
-            PerformanceWarning warn(false,"OctreeSendThread... usleep()",false,&_usleepTime,&_usleepCalls);
-            usleep(usecToSleep);
-        } else {
-            const int MIN_USEC_TO_SLEEP = 1;
-            usleep(MIN_USEC_TO_SLEEP);
-        }
-    }
-
-    return isStillRunning();  // keep running till they terminate us
+    // the scheduler runs our next interval once it's due, rather than us sleeping until then
+    return isStillRunning();
 }
 
 quint64 OctreeSendThread::_usleepTime = 0;
@@ -161,6 +151,7 @@ int OctreeSendThread::handlePacketSend(OctreeQueryNode* nodeData, int& trueBytes
             _totalWastedBytes += thisWastedBytes;
             _totalBytes += nodeData->getPacketLength();
             _totalPackets++;
+            OctreeSendCounters::forThisThread().packetSent(nodeData->getPacketLength(), thisWastedBytes);
             if (debug) {
                 const unsigned char* messageData = nodeData->getPacket();
                 int numBytesPacketHeader = numBytesForPacketHeader(reinterpret_cast<const char*>(messageData));
@@ -193,6 +184,7 @@ int OctreeSendThread::handlePacketSend(OctreeQueryNode* nodeData, int& trueBytes
             _totalWastedBytes += thisWastedBytes;
             _totalBytes += statsMessageLength;
             _totalPackets++;
+            OctreeSendCounters::forThisThread().packetSent(statsMessageLength, thisWastedBytes);
             if (debug) {
                 const unsigned char* messageData = nodeData->getPacket();
                 int numBytesPacketHeader = numBytesForPacketHeader(reinterpret_cast<const char*>(messageData));
@@ -221,6 +213,7 @@ int OctreeSendThread::handlePacketSend(OctreeQueryNode* nodeData, int& trueBytes
             _totalWastedBytes += thisWastedBytes;
             _totalBytes += nodeData->getPacketLength();
             _totalPackets++;
+            OctreeSendCounters::forThisThread().packetSent(nodeData->getPacketLength(), thisWastedBytes);
             if (debug) {
                 const unsigned char* messageData = nodeData->getPacket();
                 int numBytesPacketHeader = numBytesForPacketHeader(reinterpret_cast<const char*>(messageData));
@@ -250,6 +243,7 @@ int OctreeSendThread::handlePacketSend(OctreeQueryNode* nodeData, int& trueBytes
             _totalWastedBytes += thisWastedBytes;
             _totalBytes += nodeData->getPacketLength();
             _totalPackets++;
+            OctreeSendCounters::forThisThread().packetSent(nodeData->getPacketLength(), thisWastedBytes);
             if (debug) {
                 const unsigned char* messageData = nodeData->getPacket();
                 int numBytesPacketHeader = numBytesForPacketHeader(reinterpret_cast<const char*>(messageData));
@@ -289,16 +283,35 @@ int OctreeSendThread::packetDistributor(OctreeQueryNode* nodeData, bool viewFrus
     if (nodeData->isShuttingDown()) {
         return 0;
     }
+
+    // a bulk sync is sent the same whatever the view, so the view moving doesn't restart it
+    bool wantBulkSync = nodeData->getWantBulkSync();
+    if (wantBulkSync) {
+        viewFrustumChanged = false;
+    }
     
-    // calculate max number of packets that can be sent during this interval
+    // calculate max number of packets that can be sent during this interval, a bulk sync goes as fast as the server
+    // lets any client be sent to
     int clientMaxPacketsPerInterval = std::max(1, (nodeData->getMaxOctreePacketsPerSecond() / INTERVALS_PER_SECOND));
-    int maxPacketsPerInterval = std::min(clientMaxPacketsPerInterval, _myServer->getPacketsPerClientPerInterval());
+    int maxPacketsPerInterval = _myServer->getPacketsPerClientPerInterval();
+    if (!wantBulkSync) {
+        maxPacketsPerInterval = std::min(clientMaxPacketsPerInterval, maxPacketsPerInterval);
+    }
+
+    // and no more than the acks from the client say the path to it can take, once they have come in
+    int congestionPacketsPerSecond = nodeData->getCongestionControl().getPacketsPerSecond();
+    bool isCongestionLimited = false;
+    if (congestionPacketsPerSecond > 0) {
+        int congestionPacketsPerInterval = std::max(1, congestionPacketsPerSecond / INTERVALS_PER_SECOND);
+        isCongestionLimited = congestionPacketsPerInterval < maxPacketsPerInterval;
+        maxPacketsPerInterval = std::min(maxPacketsPerInterval, congestionPacketsPerInterval);
+    }
 
     int truePacketsSent = 0;
     int trueBytesSent = 0;
     int packetsSentThisInterval = 0;
-    bool isFullScene = ((!viewFrustumChanged || !nodeData->getWantDelta()) && nodeData->getViewFrustumJustStoppedChanging()) 
-                                || nodeData->hasLodChanged();
+    bool isFullScene = (!wantBulkSync && (!viewFrustumChanged || !nodeData->getWantDelta())
+                                && nodeData->getViewFrustumJustStoppedChanging()) || nodeData->hasLodChanged();
 
     bool somethingToSend = true; // assume we have something
 
@@ -339,6 +352,13 @@ int OctreeSendThread::packetDistributor(OctreeQueryNode* nodeData, bool viewFrus
                 nodeData->dumpOutOfView();
             }
             nodeData->map.erase();
+            nodeData->occlusionBuffer.erase();
+
+            // the elements of where the view is going are sent with whatever room the scene leaves
+            nodeData->prefetchBag.deleteAll();
+            if (nodeData->hasPredictedViewFrustum()) {
+                nodeData->prefetchBag.insert(_myServer->getOctree()->getRoot());
+            }
         }
 
         if (!viewFrustumChanged && !nodeData->getWantDelta()) {
@@ -349,7 +369,7 @@ int OctreeSendThread::packetDistributor(OctreeQueryNode* nodeData, bool viewFrus
 
         // track completed scenes and send out the stats packet accordingly
         nodeData->stats.sceneCompleted();
-        nodeData->setLastRootTimestamp(_myServer->getOctree()->getRoot()->getLastChanged());
+        nodeData->setLastRootTimestamp(_myServer->getOctree()->getRoot()->getLastChangedInSubtree());
 
         // TODO: add these to stats page
         //::endSceneSleepTime = _usleepTime;
@@ -402,8 +422,13 @@ int OctreeSendThread::packetDistributor(OctreeQueryNode* nodeData, bool viewFrus
             quint64 startInside = usecTimestampNow();            
 
             bool lastNodeDidntFit = false; // assume each node fits
-            if (!nodeData->nodeBag.isEmpty()) {
-                OctreeElement* subTree = nodeData->nodeBag.extract();
+
+            // once the scene is sent, the room that's left goes to the predicted view, at a lower level of detail and
+            // without what's in the current view
+            bool isPrefetching = nodeData->nodeBag.isEmpty() && !nodeData->prefetchBag.isEmpty() && !wantBulkSync;
+            OctreeElementBag& bag = isPrefetching ? nodeData->prefetchBag : nodeData->nodeBag;
+            if (!bag.isEmpty()) {
+                OctreeElement* subTree = bag.extract();
                 
                 /* TODO: Looking for a way to prevent locking and encoding a tree that is not
                 // going to result in any packets being sent...
@@ -416,7 +441,7 @@ int OctreeSendThread::packetDistributor(OctreeQueryNode* nodeData, bool viewFrus
                 bool skipEncode = false;
                 if (
                         (subTree == root)
-                        && (nodeData->getLastRootTimestamp() == root->getLastChanged())
+                        && (nodeData->getLastRootTimestamp() == root->getLastChangedInSubtree())
                         && !viewFrustumChanged 
                         && (nodeData->getDuplicatePacketCount() > 0)
                 ) {
@@ -430,7 +455,8 @@ int OctreeSendThread::packetDistributor(OctreeQueryNode* nodeData, bool viewFrus
                 CoverageMap* coverageMap = wantOcclusionCulling ? &nodeData->map : IGNORE_COVERAGE_MAP;
                 
                 float voxelSizeScale = nodeData->getOctreeSizeScale();
-                int boundaryLevelAdjustClient = nodeData->getBoundaryLevelAdjust();
+                int boundaryLevelAdjustClient = nodeData->getBoundaryLevelAdjust() +
+                                                nodeData->getCongestionBoundaryLevelAdjust();
                 
                 int boundaryLevelAdjust = boundaryLevelAdjustClient + (viewFrustumChanged && nodeData->getWantLowResMoving()
                                                                        ? LOW_RES_MOVING_ADJUST : NO_BOUNDARY_ADJUST);
@@ -440,26 +466,57 @@ int OctreeSendThread::packetDistributor(OctreeQueryNode* nodeData, bool viewFrus
                                              wantOcclusionCulling, coverageMap, boundaryLevelAdjust, voxelSizeScale,
                                              nodeData->getLastTimeBagEmpty(),
                                              isFullScene, &nodeData->stats, _myServer->getJurisdiction());
+                if (wantOcclusionCulling) {
+                    params.occlusionBuffer = &nodeData->occlusionBuffer;
+                }
+                if (isPrefetching) {
+                    params.viewFrustum = &nodeData->getPredictedViewFrustum();
+                    params.deltaViewFrustum = true;
+                    params.lastViewFrustum = &nodeData->getCurrentViewFrustum();
+                    params.wantOcclusionCulling = false;
+                    params.map = IGNORE_COVERAGE_MAP;
+                    params.occlusionBuffer = NULL;
+                    params.boundaryLevelAdjust += PREFETCH_BOUNDARY_LEVEL_ADJUST;
+                    params.forceSendScene = false;
+                    params.stats = IGNORE_SCENE_STATS; // the prefetch isn't part of the scene
+                }
+                AACube bulkSyncBounds = nodeData->getBulkSyncBounds();
+                if (wantBulkSync) {
+                    // everything in the bounds at full detail, and once it's all sent, only what's changed
+                    bulkSyncBounds.scale(1.0f / TREE_SCALE);
+                    params.viewFrustum = IGNORE_VIEW_FRUSTUM;
+                    params.bounds = &bulkSyncBounds;
+                    params.wantOcclusionCulling = false;
+                    params.map = IGNORE_COVERAGE_MAP;
+                    params.occlusionBuffer = NULL;
+                }
+                params.encodeCache = _myServer->getEncodeCache();
 
                 // TODO: should this include the lock time or not? This stat is sent down to the client,
                 // it seems like it may be a good idea to include the lock time as part of the encode time
                 // are reported to client. Since you can encode without the lock
                 nodeData->stats.encodeStarted();
                 
-                quint64 lockWaitStart = usecTimestampNow();
+                OctreeSendCounters& counters = OctreeSendCounters::forThisThread();
+                quint64 lockWaitStart = cycleCounterNow();
                 _myServer->getOctree()->lockForRead();
-                quint64 lockWaitEnd = usecTimestampNow();
-                lockWaitElapsedUsec = (float)(lockWaitEnd - lockWaitStart);
-
-                quint64 encodeStart = usecTimestampNow();
-                bytesWritten = _myServer->getOctree()->encodeTreeBitstream(subTree, &_packetData, nodeData->nodeBag, params);
-                quint64 encodeEnd = usecTimestampNow();
-                encodeElapsedUsec = (float)(encodeEnd - encodeStart);
+                quint64 lockWaitCycles = cycleCounterNow() - lockWaitStart;
+                lockWaitElapsedUsec = cycleCountsToUsecs(lockWaitCycles);
+                counters.lockWaited(lockWaitCycles);
+
+                int subTreeLevel = subTree->getLevel();
+                quint64 traversedBeforeEncode = nodeData->stats.getTraversed();
+                quint64 encodeStart = cycleCounterNow();
+                bytesWritten = _myServer->getOctree()->encodeTreeBitstream(subTree, &_packetData, bag, params);
+                quint64 encodeCycles = cycleCounterNow() - encodeStart;
+                encodeElapsedUsec = cycleCountsToUsecs(encodeCycles);
+                counters.encoded(encodeCycles, nodeData->stats.getTraversed() - traversedBeforeEncode, subTreeLevel,
+                                 bytesWritten, bag.count());
                 
                 // If after calling encodeTreeBitstream() there are no nodes left to send, then we know we've
                 // sent the entire scene. We want to know this below so we'll actually write this content into
                 // the packet and send it
-                completedScene = nodeData->nodeBag.isEmpty();
+                completedScene = bag.isEmpty();
 
                 // if we're trying to fill a full size packet, then we use this logic to determine if we have a DIDNT_FIT case.
                 if (_packetData.getTargetSize() == MAX_OCTREE_PACKET_DATA_SIZE) {
@@ -543,6 +600,12 @@ int OctreeSendThread::packetDistributor(OctreeQueryNode* nodeData, bool viewFrus
                     // a larger compressed size then uncompressed size
                     targetSize = nodeData->getAvailable() - sizeof(OCTREE_PACKET_INTERNAL_SECTION_SIZE) - COMPRESS_PADDING;
                 }
+                if (wantCompression) {
+                    // size the section for what's expected to fit once it's compressed, rather than for what fits
+                    // uncompressed and then packing more sections after it. If it turns out too big, it's written
+                    // to the next packet above.
+                    targetSize = (int)(targetSize * _packetData.getExpectedCompressionRatio());
+                }
                 _packetData.changeSettings(nodeData->getWantCompression(), targetSize); // will do reset
 
             }
@@ -570,15 +633,16 @@ int OctreeSendThread::packetDistributor(OctreeQueryNode* nodeData, bool viewFrus
 
         // Re-send packets that were nacked by the client
         while (nodeData->hasNextNackedPacket() && packetsSentThisInterval < maxPacketsPerInterval) {
-            const QByteArray* packet = nodeData->getNextNackedPacket();
-            if (packet) {
-                NodeList::getInstance()->writeDatagram(*packet, _node);
+            QByteArray packet = nodeData->getNextNackedPacket();
+            if (!packet.isNull()) {
+                NodeList::getInstance()->writeDatagram(packet, _node);
                 truePacketsSent++;
                 packetsSentThisInterval++;
 
-                _totalBytes += packet->size();
+                _totalBytes += packet.size();
                 _totalPackets++;
-                _totalWastedBytes += MAX_PACKET_SIZE - packet->size();
+                _totalWastedBytes += MAX_PACKET_SIZE - packet.size();
+                OctreeSendCounters::forThisThread().packetSent(packet.size(), MAX_PACKET_SIZE - packet.size());
             }
         }
 
@@ -598,9 +662,14 @@ int OctreeSendThread::packetDistributor(OctreeQueryNode* nodeData, bool viewFrus
             nodeData->updateLastKnownViewFrustum();
             nodeData->setViewSent(true);
             nodeData->map.erase(); // It would be nice if we could save this, and only reset it when the view frustum changes
+            nodeData->occlusionBuffer.erase();
         }
 
     } // end if bag wasn't empty, and so we sent stuff...
 
+    // if the path to the client took all it could and there's still more waiting, then it isn't keeping up
+    nodeData->updateCongestionBoundaryLevelAdjust(isCongestionLimited && packetsSentThisInterval >= maxPacketsPerInterval
+                                                  && !nodeData->nodeBag.isEmpty());
+
     return truePacketsSent;
 }
@@ -22,7 +22,7 @@
 
 class OctreeServer;
 
-/// Threaded processor for sending voxel packets to a single client
+/// Processor for sending voxel packets to a single client, run an interval at a time by the server's OctreeSendScheduler
 class OctreeSendThread : public GenericThread {
     Q_OBJECT
 public:
@@ -39,7 +39,7 @@ public:
     static quint64 _usleepCalls;
 
 protected:
-    /// Implements generic processing behavior for this thread.
+    /// Sends this client's packets for one send interval, returns false once the client's shutting down.
     virtual bool process();
 
 private:
@@ -55,6 +55,8 @@ private:
     
     int _nodeMissingCount;
     bool _isShuttingDown;
+
+    friend class OctreeSendScheduler;
 };
 
 #endif // hifi_OctreeSendThread_h
@@ -9,6 +9,7 @@
 //  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
 //
 
+#include <QJsonDocument>
 #include <QJsonObject>
 #include <QTimer>
 #include <QUuid>
@@ -16,6 +17,8 @@
 #include <time.h>
 #include <HTTPConnection.h>
 #include <Logging.h>
+#include <Metrics.h>
+#include <OctalCode.h>
 #include <UUID.h>
 
 #include "../AssignmentClient.h"
@@ -229,9 +232,16 @@ OctreeServer::OctreeServer(const QByteArray& packet) :
     _debugReceiving(false),
     _verboseDebug(false),
     _jurisdiction(NULL),
+    _retiredJurisdictions(),
+    _jurisdictionFile(),
     _jurisdictionSender(NULL),
+    _jurisdictionHandoff(NULL),
+    _replication(NULL),
     _octreeInboundPacketProcessor(NULL),
     _persistThread(NULL),
+    _encodeCache(),
+    _sendScheduler(),
+    _sendTimeline(),
     _started(time(0)),
     _startedUSecs(usecTimestampNow())
 {
@@ -270,8 +280,15 @@ OctreeServer::~OctreeServer() {
         _persistThread->deleteLater();
     }
 
+    delete _jurisdictionHandoff;
+    _jurisdictionHandoff = NULL;
+
+    delete _replication;
+    _replication = NULL;
+
     delete _jurisdiction;
     _jurisdiction = NULL;
+    qDeleteAll(_retiredJurisdictions);
     
     // cleanup our tree here...
     qDebug() << qPrintable(_safeServerName) << "server START cleaning up octree... [" << this << "]";
@@ -323,6 +340,19 @@ bool OctreeServer::handleHTTPRequest(HTTPConnection* connection, const QUrl& url
             _octreeInboundPacketProcessor->resetStats();
             resetSendingStats();
             showStats = true;
+        } else if (url.path() == "/telemetry.json") {
+            QJsonDocument telemetryDocument(NodeList::getInstance()->getTelemetryJSON());
+            connection->respond(HTTPConnection::StatusCode200, telemetryDocument.toJson(), "application/json");
+            return true;
+        } else if (url.path() == "/timeline.json") {
+            QJsonDocument timelineDocument(_sendTimeline.toJSON());
+            connection->respond(HTTPConnection::StatusCode200, timelineDocument.toJson(), "application/json");
+            return true;
+        } else if (url.path() == "/metrics") {
+            connection->respond(HTTPConnection::StatusCode200, NodeList::getInstance()->getTelemetryPrometheusText() +
+                                MetricsRegistry::getInstance().getPrometheusText(),
+                                "text/plain; version=0.0.4");
+            return true;
         }
     }
 
@@ -403,7 +433,8 @@ bool OctreeServer::handleHTTPRequest(HTTPConnection* connection, const QUrl& url
 
         // display outbound packet stats
         statsString += QString("<b>%1 Outbound Packet Statistics... "
-                                "<a href='/resetStats'>[RESET]</a></b>\r\n").arg(getMyServerName());
+                                "<a href='/resetStats'>[RESET]</a> <a href='/timeline.json'>[TIMELINE]</a></b>\r\n")
+                                .arg(getMyServerName());
 
         quint64 totalOutboundPackets = OctreeSendThread::_totalPackets;
         quint64 totalOutboundBytes = OctreeSendThread::_totalBytes;
@@ -643,6 +674,17 @@ bool OctreeServer::handleHTTPRequest(HTTPConnection* connection, const QUrl& url
             .arg(locale.toString((uint)averageProcessTimePerElement).rightJustified(COLUMN_WIDTH, ' '));
         statsString += QString("  Average Wait Lock Time/Element: %1 usecs\r\n")
             .arg(locale.toString((uint)averageLockWaitTimePerElement).rightJustified(COLUMN_WIDTH, ' '));
+        statsString += QString("         Max Inbound Queue Depth: %1 packets\r\n")
+            .arg(locale.toString(_octreeInboundPacketProcessor->getMaxPacketsToProcessCount())
+                 .rightJustified(COLUMN_WIDTH, ' '));
+        statsString += QString("      Average Inbound Queue Wait: %1 usecs\r\n")
+            .arg(locale.toString((uint)_octreeInboundPacketProcessor->getAverageQueueWaitUsecs())
+                 .rightJustified(COLUMN_WIDTH, ' '));
+        statsString += QString("         Dropped Inbound Packets: %1 packets\r\n")
+            .arg(locale.toString(_octreeInboundPacketProcessor->getDroppedPacketCount()).rightJustified(COLUMN_WIDTH, ' '));
+        statsString += QString("        Inbound Thread Idle Time: %1 %\r\n")
+            .arg(locale.toString((uint)(100 * _octreeInboundPacketProcessor->getIdleUsecs() /
+                qMax(_octreeInboundPacketProcessor->getRunningUsecs(), (quint64)1))).rightJustified(COLUMN_WIDTH, ' '));
 
 
         int senderNumber = 0;
@@ -836,6 +878,15 @@ void OctreeServer::readPendingDatagrams() {
                 if (matchingNode) {
                     nodeList->updateNodeWithDataFromPacket(matchingNode, receivedPacket);
                     OctreeQueryNode* nodeData = (OctreeQueryNode*)matchingNode->getLinkedData();
+                    
+                    // the client sends its queries as changes to the last keyframe we've acknowledged
+                    quint16 keyframeSequenceNumber;
+                    if (nodeData && nodeData->takeKeyframeToAcknowledge(keyframeSequenceNumber)) {
+                        QByteArray ackPacket = byteArrayWithPopulatedHeader(PacketTypeOctreeQueryAck);
+                        ackPacket.append(reinterpret_cast<const char*>(&keyframeSequenceNumber),
+                            sizeof(keyframeSequenceNumber));
+                        nodeList->writeDatagram(ackPacket, matchingNode);
+                    }
                     if (nodeData && !nodeData->isOctreeSendThreadInitalized()) {
                         
                         // NOTE: this is an important aspect of the proper ref counting. The send threads/node data need to 
@@ -857,8 +908,24 @@ void OctreeServer::readPendingDatagrams() {
                 }
             } else if (packetType == PacketTypeJurisdictionRequest) {
                 _jurisdictionSender->queueReceivedPacket(matchingNode, receivedPacket);
+            } else if (packetType == PacketTypeJurisdictionHandoffRequest) {
+                // only the domain server can ask us to hand off part of our jurisdiction
+                if (senderSockAddr == nodeList->getDomainHandler().getSockAddr()) {
+                    _jurisdictionHandoff->processPacket(SharedNodePointer(), receivedPacket);
+                }
+            } else if (packetType == PacketTypeJurisdictionHandoffData || packetType == PacketTypeJurisdictionHandoffAck) {
+                _jurisdictionHandoff->processPacket(matchingNode, receivedPacket);
+            } else if (packetType == PacketTypeOctreeReplicaSubscribe || packetType == PacketTypeOctreeReplicaState
+                       || packetType == PacketTypeOctreeReplicaSnapshot || packetType == PacketTypeOctreeReplicaEdit
+                       || packetType == PacketTypeOctreeReplicaForwardedEdit) {
+                _replication->processPacket(matchingNode, receivedPacket);
             } else if (_octreeInboundPacketProcessor && getOctree()->handlesEditPacketType(packetType)) {
-                _octreeInboundPacketProcessor->queueReceivedPacket(matchingNode, receivedPacket);
+                if (isReplica()) {
+                    // our tree only changes through the primary's journal
+                    _replication->forwardEditPacket(matchingNode, receivedPacket);
+                } else {
+                    _octreeInboundPacketProcessor->queueReceivedPacket(matchingNode, receivedPacket);
+                }
             } else {
                 // let processNodeData handle it.
                 NodeList::getInstance()->processNodeData(senderSockAddr, receivedPacket);
@@ -905,6 +972,7 @@ void OctreeServer::run() {
 
 
     const char* JURISDICTION_FILE = "--jurisdictionFile";
+    const char* JURISDICTION_SPARE = "--jurisdictionSpare";
     const char* jurisdictionFile = getCmdOption(_argc, _argv, JURISDICTION_FILE);
     if (jurisdictionFile) {
         qDebug("jurisdictionFile=%s", jurisdictionFile);
@@ -912,6 +980,14 @@ void OctreeServer::run() {
         qDebug("about to readFromFile().... jurisdictionFile=%s", jurisdictionFile);
         _jurisdiction = new JurisdictionMap(jurisdictionFile);
         qDebug("after readFromFile().... jurisdictionFile=%s", jurisdictionFile);
+
+        // a jurisdiction that's changed by a handoff is written back, so that it's kept when we restart
+        _jurisdictionFile = jurisdictionFile;
+    } else if (cmdOptionExists(_argc, _argv, JURISDICTION_SPARE)) {
+        // a spare has no jurisdiction until another server hands it part of theirs
+        qDebug("jurisdictionSpare=true");
+        _jurisdiction = new JurisdictionMap(getMyNodeType());
+        _jurisdiction->clear();
     } else {
         const char* JURISDICTION_ROOT = "--jurisdictionRoot";
         const char* jurisdictionRoot = getCmdOption(_argc, _argv, JURISDICTION_ROOT);
@@ -930,6 +1006,21 @@ void OctreeServer::run() {
         }
     }
 
+    const char* REPLICA = "--replica";
+    const char* REPLICA_ROOT = "--replicaRoot";
+    const char* replicaRoot = getCmdOption(_argc, _argv, REPLICA_ROOT);
+    bool isReplica = cmdOptionExists(_argc, _argv, REPLICA) || replicaRoot;
+    QByteArray primaryRoot;
+    if (replicaRoot) {
+        // only the primary whose jurisdiction has this root is replicated
+        unsigned char* primaryRootCode = hexStringToOctalCode(QString(replicaRoot));
+        primaryRoot = QByteArray(reinterpret_cast<const char*>(primaryRootCode),
+                                 (int)bytesRequiredForCodeLength(numberOfThreeBitSectionsInCode(primaryRootCode)));
+        delete[] primaryRootCode;
+    }
+    qDebug("replica=%s replicaRoot=%s", debug::valueOf(isReplica), replicaRoot);
+    _replication = new OctreeReplication(this, isReplica, primaryRoot);
+
     NodeList* nodeList = NodeList::getInstance();
     nodeList->setOwnerType(getMyNodeType());
 
@@ -940,6 +1031,9 @@ void OctreeServer::run() {
     // we need to ask the DS about agents so we can ping/reply with them
     nodeList->addNodeTypeToInterestSet(NodeType::Agent);
 
+    // and about the other servers of our type, which we can hand parts of our jurisdiction to
+    nodeList->addNodeTypeToInterestSet(getMyNodeType());
+
 #ifndef WIN32
     setvbuf(stdout, NULL, _IOLBF, 0);
 #endif
@@ -965,6 +1059,11 @@ void OctreeServer::run() {
     if (cmdOptionExists(_argc, _argv, NO_PERSIST)) {
         _wantPersist = false;
     }
+
+    // a replica's tree is the primary's, which the primary persists
+    if (isReplica) {
+        _wantPersist = false;
+    }
     qDebug("wantPersist=%s", debug::valueOf(_wantPersist));
 
     // if we want Persistence, set up the local file and persist thread
@@ -981,6 +1080,12 @@ void OctreeServer::run() {
 
         qDebug("persistFilename=%s", _persistFilename);
 
+        // the persist file can be saved with a palette of its colors, which is read back either way
+        const char* COLOR_PALETTE = "--colorPalette";
+        bool wantColorPalette = cmdOptionExists(_argc, _argv, COLOR_PALETTE);
+        _tree->setWantColorPalette(wantColorPalette);
+        qDebug("colorPalette=%s", debug::valueOf(wantColorPalette));
+
         // now set up PersistThread
         _persistThread = new OctreePersistThread(_tree, _persistFilename);
         if (_persistThread) {
@@ -1023,6 +1128,17 @@ void OctreeServer::run() {
     qDebug("packetsPerSecondTotalMax=%s _packetsTotalPerInterval=%d", 
                     packetsPerSecondTotalMax, _packetsTotalPerInterval);
 
+    // Check to see if the user passed in a command line option for the number of threads to send to clients on
+    const char* SEND_THREADS = "--sendThreads";
+    const char* sendThreadsOption = getCmdOption(_argc, _argv, SEND_THREADS);
+    _sendScheduler.start(sendThreadsOption ? atoi(sendThreadsOption) : 0);
+    qDebug("sendThreads=%s sending on %d threads", sendThreadsOption, _sendScheduler.getNumWorkers());
+
+    const int SEND_TIMELINE_SAMPLE_MSECS = 1000;
+    QTimer* sendTimelineTimer = new QTimer(this);
+    connect(sendTimelineTimer, SIGNAL(timeout()), SLOT(sampleSendTimeline()));
+    sendTimelineTimer->start(SEND_TIMELINE_SAMPLE_MSECS);
+
     HifiSockAddr senderSockAddr;
 
     // set up our jurisdiction broadcaster...
@@ -1032,6 +1148,9 @@ void OctreeServer::run() {
     _jurisdictionSender = new JurisdictionSender(_jurisdiction, getMyNodeType());
     _jurisdictionSender->initialize(true);
 
+    _jurisdictionHandoff = new OctreeJurisdictionHandoff(this);
+    _replication->start();
+
     // set up our OctreeServerPacketProcessor
     _octreeInboundPacketProcessor = new OctreeInboundPacketProcessor(this);
     _octreeInboundPacketProcessor->initialize(true);
@@ -1050,6 +1169,33 @@ void OctreeServer::run() {
     qDebug() << "Now running... started at: " << localBuffer << utcBuffer;
 }
 
+void OctreeServer::recordEditPacket(const QByteArray& packet) {
+    if (_persistThread) {
+        _persistThread->recordEditPacket(packet);
+    }
+    _replication->recordEditPacket(packet);
+}
+
+void OctreeServer::queueEditPacket(const SharedNodePointer& sendingNode, const QByteArray& packet) {
+    if (_octreeInboundPacketProcessor) {
+        _octreeInboundPacketProcessor->queueReceivedPacket(sendingNode, packet);
+    }
+}
+
+void OctreeServer::setJurisdiction(JurisdictionMap* jurisdiction) {
+    jurisdiction->setNodeType(getMyNodeType());
+    if (_jurisdiction) {
+        _retiredJurisdictions.append(_jurisdiction);
+    }
+    _jurisdiction = jurisdiction;
+    _jurisdictionSender->setJurisdiction(jurisdiction);
+    _jurisdictionSender->broadcastJurisdiction();
+
+    if (!_jurisdictionFile.isEmpty()) {
+        _jurisdiction->writeToFile(_jurisdictionFile.toLocal8Bit().constData());
+    }
+}
+
 void OctreeServer::nodeAdded(SharedNodePointer node) {
     // we might choose to use this notifier to track clients in a pending state
     qDebug() << qPrintable(_safeServerName) << "server added node:" << *node;
@@ -1102,6 +1248,7 @@ void OctreeServer::aboutToFinish() {
         qDebug() << qPrintable(_safeServerName) << "server about to finish while node still connected node:" << *node;
         forceNodeShutdown(node);
     }
+    _sendScheduler.stop();
     qDebug() << qPrintable(_safeServerName) << "server ENDING about to finish...";
 }
 
@@ -1222,6 +1369,16 @@ void OctreeServer::sendStatsPacket() {
     statsObject1[baseName + QString(".0.3.uptime")] = getUptime();
     statsObject1[baseName + QString(".0.4.persistFileLoadTime")] = getFileLoadTime();
     statsObject1[baseName + QString(".0.5.clients")] = getCurrentClientCount();
+    statsObject1[baseName + QString(".0.7.jurisdiction")] = (_jurisdictionHandoff && _jurisdictionHandoff->isSpare())
+        ? QString("spare") : QString("owner");
+    if (isReplica()) {
+        statsObject1[baseName + QString(".0.8.replication")] = _replication->isSynced()
+            ? QString("replica") : QString("syncing");
+        statsObject1[baseName + QString(".0.9.replicaOf")] = uuidStringWithoutCurlyBraces(_replication->getPrimaryUUID());
+    } else {
+        statsObject1[baseName + QString(".0.8.replication")] = QString("primary");
+        statsObject1[baseName + QString(".0.9.replicas")] = _replication ? _replication->getReplicaCount() : 0;
+    }
     
     quint64 oneSecondAgo = usecTimestampNow() - USECS_PER_SECOND;
     
@@ -1276,6 +1433,15 @@ void OctreeServer::sendStatsPacket() {
         (double)_octreeInboundPacketProcessor->getAverageProcessTimePerElement();
     statsObject3[baseName + QString(".3.inbound.timing.5.avgLockWaitTimePerElement")] = 
         (double)_octreeInboundPacketProcessor->getAverageLockWaitTimePerElement();
+    statsObject3[baseName + QString(".3.inbound.queue.1.maxDepth")] = 
+        _octreeInboundPacketProcessor->getMaxPacketsToProcessCount();
+    statsObject3[baseName + QString(".3.inbound.queue.2.avgWaitTime")] = 
+        (double)_octreeInboundPacketProcessor->getAverageQueueWaitUsecs();
+    statsObject3[baseName + QString(".3.inbound.queue.3.droppedPackets")] = 
+        _octreeInboundPacketProcessor->getDroppedPacketCount();
+    statsObject3[baseName + QString(".3.inbound.queue.4.idleRatio")] = 
+        (double)_octreeInboundPacketProcessor->getIdleUsecs() /
+            qMax(_octreeInboundPacketProcessor->getRunningUsecs(), (quint64)1);
 
     NodeList::getInstance()->sendStatsToDomainServer(statsObject3);
 }
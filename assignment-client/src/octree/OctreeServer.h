@@ -20,11 +20,16 @@
 
 #include <ThreadedAssignment.h>
 #include <EnvironmentData.h>
+#include <OctreeEncodeCache.h>
 
 #include "OctreePersistThread.h"
+#include "OctreeSendScheduler.h"
 #include "OctreeSendThread.h"
 #include "OctreeServerConsts.h"
 #include "OctreeInboundPacketProcessor.h"
+#include "OctreeJurisdictionHandoff.h"
+#include "OctreeReplication.h"
+#include "OctreeSendCounters.h"
 
 const int DEFAULT_PACKETS_PER_INTERVAL = 2000; // some 120,000 packets per second total
 
@@ -45,6 +50,11 @@ public:
     Octree* getOctree() { return _tree; }
     JurisdictionMap* getJurisdiction() { return _jurisdiction; }
 
+    /// takes a new jurisdiction, such as after a handoff, and tells the clients about it
+    void setJurisdiction(JurisdictionMap* jurisdiction);
+    OctreeEncodeCache* getEncodeCache() { return &_encodeCache; }
+    OctreeSendScheduler* getSendScheduler() { return &_sendScheduler; }
+
     int getPacketsPerClientPerInterval() const { return std::min(_packetsPerClientPerInterval, 
                                 std::max(1, getPacketsTotalPerInterval() / std::max(1, getCurrentClientCount()))); }
 
@@ -57,7 +67,17 @@ public:
     static void clientDisconnected() { _clientCount--; }
 
     bool isInitialLoadComplete() const { return (_persistThread) ? _persistThread->isInitialLoadComplete() : true; }
+    bool isReadyToServe() const { return (_persistThread) ? _persistThread->isReadyToServe() : true; }
     bool isPersistEnabled() const { return (_persistThread) ? true : false; }
+
+    /// keeps an applied edit packet in the journal and sends it to our replicas
+    void recordEditPacket(const QByteArray& packet);
+
+    /// processes an edit packet as though the sender had sent it to us, such as one a replica forwarded
+    void queueEditPacket(const SharedNodePointer& sendingNode, const QByteArray& packet);
+
+    /// a replica serves a read only copy of another server's tree, and forwards the edits it's sent to that server
+    bool isReplica() const { return _replication && _replication->isReplica(); }
     quint64 getLoadElapsedTime() const { return (_persistThread) ? _persistThread->getLoadElapsedTime() : 0; }
 
     // Subclasses must implement these methods
@@ -127,6 +147,7 @@ public slots:
     void nodeAdded(SharedNodePointer node);
     void nodeKilled(SharedNodePointer node);
     void sendStatsPacket();
+    void sampleSendTimeline() { _sendTimeline.sample(); }
 
 protected:
     void parsePayload();
@@ -154,9 +175,16 @@ protected:
     bool _debugReceiving;
     bool _verboseDebug;
     JurisdictionMap* _jurisdiction;
+    QList<JurisdictionMap*> _retiredJurisdictions; // the send threads may still be reading them
+    QString _jurisdictionFile;
     JurisdictionSender* _jurisdictionSender;
+    OctreeJurisdictionHandoff* _jurisdictionHandoff;
+    OctreeReplication* _replication;
     OctreeInboundPacketProcessor* _octreeInboundPacketProcessor;
     OctreePersistThread* _persistThread;
+    OctreeEncodeCache _encodeCache; // shared by the send threads of all of our clients
+    OctreeSendScheduler _sendScheduler; // runs the send threads of all of our clients
+    OctreeSendTimeline _sendTimeline; // served as /timeline.json
 
     static OctreeServer* _instance;
 
@@ -20,15 +20,16 @@ class ParticleNodeData : public OctreeQueryNode {
 public:
     ParticleNodeData() :
         OctreeQueryNode(),
-        _lastDeletedParticlesSentAt(0) {  };
+        _deletedParticlesCursor(0) {  };
 
     virtual PacketType getMyPacketType() const { return PacketTypeParticleData; }
 
-    quint64 getLastDeletedParticlesSentAt() const { return _lastDeletedParticlesSentAt; }
-    void setLastDeletedParticlesSentAt(quint64 sentAt) { _lastDeletedParticlesSentAt = sentAt; }
+    /// the cursor of the first deleted particle the node hasn't been sent
+    quint64 getDeletedParticlesCursor() const { return _deletedParticlesCursor; }
+    void setDeletedParticlesCursor(quint64 cursor) { _deletedParticlesCursor = cursor; }
 
 private:
-    quint64 _lastDeletedParticlesSentAt;
+    quint64 _deletedParticlesCursor;
 };
 
 #endif // hifi_ParticleNodeData_h
@@ -9,6 +9,8 @@
 //  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
 //
 
+#include <limits>
+
 #include <QTimer>
 #include <ParticleTree.h>
 
@@ -77,10 +79,8 @@ bool ParticleServer::hasSpecialPacketToSend(const SharedNodePointer& node) {
     // check to see if any new particles have been added since we last sent to this node...
     ParticleNodeData* nodeData = static_cast<ParticleNodeData*>(node->getLinkedData());
     if (nodeData) {
-        quint64 deletedParticlesSentAt = nodeData->getLastDeletedParticlesSentAt();
-
         ParticleTree* tree = static_cast<ParticleTree*>(_tree);
-        shouldSendDeletedParticles = tree->hasParticlesDeletedSince(deletedParticlesSentAt);
+        shouldSendDeletedParticles = tree->hasParticlesDeletedSince(nodeData->getDeletedParticlesCursor());
     }
 
     return shouldSendDeletedParticles;
@@ -92,8 +92,7 @@ int ParticleServer::sendSpecialPacket(const SharedNodePointer& node, OctreeQuery
 
     ParticleNodeData* nodeData = static_cast<ParticleNodeData*>(node->getLinkedData());
     if (nodeData) {
-        quint64 deletedParticlesSentAt = nodeData->getLastDeletedParticlesSentAt();
-        quint64 deletePacketSentAt = usecTimestampNow();
+        quint64 deletedParticlesCursor = nodeData->getDeletedParticlesCursor();
 
         ParticleTree* tree = static_cast<ParticleTree*>(_tree);
         bool hasMoreToSend = true;
@@ -101,7 +100,7 @@ int ParticleServer::sendSpecialPacket(const SharedNodePointer& node, OctreeQuery
         // TODO: is it possible to send too many of these packets? what if you deleted 1,000,000 particles?
         packetsSent = 0;
         while (hasMoreToSend) {
-            hasMoreToSend = tree->encodeParticlesDeletedSince(queryNode->getSequenceNumber(), deletedParticlesSentAt,
+            hasMoreToSend = tree->encodeParticlesDeletedSince(queryNode->getSequenceNumber(), deletedParticlesCursor,
                                                 outputBuffer, MAX_PACKET_SIZE, packetLength);
 
             //qDebug() << "sending PacketType_PARTICLE_ERASE packetLength:" << packetLength;
@@ -111,7 +110,7 @@ int ParticleServer::sendSpecialPacket(const SharedNodePointer& node, OctreeQuery
             packetsSent++;
         }
 
-        nodeData->setLastDeletedParticlesSentAt(deletePacketSentAt);
+        nodeData->setDeletedParticlesCursor(deletedParticlesCursor);
     }
 
     // TODO: caller is expecting a packetLength, what if we send more than one packet??
@@ -123,18 +122,17 @@ void ParticleServer::pruneDeletedParticles() {
     if (tree->hasAnyDeletedParticles()) {
 
         //qDebug() << "there are some deleted particles to consider...";
-        quint64 earliestLastDeletedParticlesSent = usecTimestampNow() + 1; // in the future
+        quint64 earliestDeletedParticlesCursor = std::numeric_limits<quint64>::max(); // past every deletion
         foreach (const SharedNodePointer& otherNode, NodeList::getInstance()->getNodeHash()) {
             if (otherNode->getLinkedData()) {
                 ParticleNodeData* nodeData = static_cast<ParticleNodeData*>(otherNode->getLinkedData());
-                quint64 nodeLastDeletedParticlesSentAt = nodeData->getLastDeletedParticlesSentAt();
-                if (nodeLastDeletedParticlesSentAt < earliestLastDeletedParticlesSent) {
-                    earliestLastDeletedParticlesSent = nodeLastDeletedParticlesSentAt;
+                quint64 nodeDeletedParticlesCursor = nodeData->getDeletedParticlesCursor();
+                if (nodeDeletedParticlesCursor < earliestDeletedParticlesCursor) {
+                    earliestDeletedParticlesCursor = nodeDeletedParticlesCursor;
                 }
             }
         }
-        //qDebug() << "earliestLastDeletedParticlesSent=" << earliestLastDeletedParticlesSent;
-        tree->forgetParticlesDeletedBefore(earliestLastDeletedParticlesSent);
+        tree->forgetParticlesDeletedBefore(earliestDeletedParticlesCursor);
     }
 }
 
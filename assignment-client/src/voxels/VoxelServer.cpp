@@ -32,7 +32,11 @@ OctreeQueryNode* VoxelServer::createOctreeQueryNode() {
 }
 
 Octree* VoxelServer::createTree() {
-    return new VoxelTree(true);
+    VoxelTree* tree = new VoxelTree(true);
+    
+    // once loaded the tree is mostly read, by the element counts for the stats, between bursts of edits
+    tree->setWantLinearizedReads(true);
+    return tree;
 }
 
 bool VoxelServer::hasSpecialPacketToSend(const SharedNodePointer& node) {
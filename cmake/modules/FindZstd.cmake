@@ -0,0 +1,32 @@
+#
+#  FindZstd.cmake
+# 
+#  Try to find the zstd compression library
+#
+#  You can provide a ZSTD_ROOT_DIR which contains lib and include directories
+#
+#  Once done this will define
+#
+#  ZSTD_FOUND - system found zstd
+#  ZSTD_INCLUDE_DIRS - the zstd include directory
+#  ZSTD_LIBRARIES - Link this to use zstd
+#
+#  Copyright 2014 High Fidelity, Inc.
+#
+#  Distributed under the Apache License, Version 2.0.
+#  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+# 
+
+if (ZSTD_LIBRARIES AND ZSTD_INCLUDE_DIRS)
+  # in cache already
+  set(ZSTD_FOUND TRUE)
+else ()
+  
+  set(ZSTD_SEARCH_DIRS "${ZSTD_ROOT_DIR}" "$ENV{HIFI_LIB_DIR}/zstd")
+  
+  find_path(ZSTD_INCLUDE_DIRS zstd.h PATH_SUFFIXES include HINTS ${ZSTD_SEARCH_DIRS})
+  find_library(ZSTD_LIBRARIES NAMES zstd zstd_static PATH_SUFFIXES lib HINTS ${ZSTD_SEARCH_DIRS})
+  
+  include(FindPackageHandleStandardArgs)
+  find_package_handle_standard_args(ZSTD DEFAULT_MSG ZSTD_INCLUDE_DIRS ZSTD_LIBRARIES)
+endif ()
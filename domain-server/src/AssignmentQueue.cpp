@@ -0,0 +1,94 @@
+//
+//  AssignmentQueue.cpp
+//  domain-server/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#include "AssignmentQueue.h"
+
+AssignmentQueue::AssignmentQueue() :
+    _nextSequenceNumber(0) {
+}
+
+void AssignmentQueue::enqueue(const SharedAssignmentPointer& assignment) {
+    // an assignment already queued under this UUID is replaced, rather than left unreachable
+    take(assignment->getUUID());
+
+    QueuedAssignment queuedAssignment;
+    queuedAssignment.assignment = assignment;
+    queuedAssignment.sequenceNumber = _nextSequenceNumber++;
+
+    TypeQueue& queue = _queuesByPool[assignment->getPool()][assignment->getType()];
+    _queuedAssignments.insert(assignment->getUUID(), queue.insert(queue.end(), queuedAssignment));
+}
+
+SharedAssignmentPointer AssignmentQueue::rotateNextForRequest(Assignment::Type type, const QString& pool) {
+    QHash<QString, PoolQueues>::iterator poolQueues = _queuesByPool.find(pool);
+    if (poolQueues == _queuesByPool.end()) {
+        return SharedAssignmentPointer();
+    }
+    TypeQueue* nextQueue = NULL;
+    if (type == Assignment::AllTypes) {
+        // the front of each type's queue is the longest waiting of that type
+        for (PoolQueues::iterator queue = poolQueues->begin(); queue != poolQueues->end(); queue++) {
+            if (!nextQueue || queue->first().sequenceNumber < nextQueue->first().sequenceNumber) {
+                nextQueue = &queue.value();
+            }
+        }
+    } else {
+        PoolQueues::iterator queue = poolQueues->find(type);
+        if (queue != poolQueues->end()) {
+            nextQueue = &queue.value();
+        }
+    }
+    if (!nextQueue) {
+        return SharedAssignmentPointer();
+    }
+
+    // until we get a connection for this assignment, it goes to the back of its queue
+    QueuedAssignment queuedAssignment = nextQueue->takeFirst();
+    queuedAssignment.sequenceNumber = _nextSequenceNumber++;
+    _queuedAssignments[queuedAssignment.assignment->getUUID()] = nextQueue->insert(nextQueue->end(), queuedAssignment);
+
+    return queuedAssignment.assignment;
+}
+
+SharedAssignmentPointer AssignmentQueue::take(const QUuid& uuid) {
+    QHash<QUuid, TypeQueue::iterator>::iterator queuedAssignment = _queuedAssignments.find(uuid);
+    if (queuedAssignment == _queuedAssignments.end()) {
+        return SharedAssignmentPointer();
+    }
+    TypeQueue::iterator queuePosition = queuedAssignment.value();
+    SharedAssignmentPointer assignment = queuePosition->assignment;
+    _queuedAssignments.erase(queuedAssignment);
+
+    // the empty queues are removed, so that those of pools that are done with don't pile up
+    QHash<QString, PoolQueues>::iterator poolQueues = _queuesByPool.find(assignment->getPool());
+    PoolQueues::iterator queue = poolQueues->find(assignment->getType());
+    queue->erase(queuePosition);
+    if (queue->isEmpty()) {
+        poolQueues->erase(queue);
+        if (poolQueues->isEmpty()) {
+            _queuesByPool.erase(poolQueues);
+        }
+    }
+    return assignment;
+}
+
+SharedAssignmentPointer AssignmentQueue::value(const QUuid& uuid) const {
+    QHash<QUuid, TypeQueue::iterator>::const_iterator queuedAssignment = _queuedAssignments.constFind(uuid);
+    return (queuedAssignment == _queuedAssignments.constEnd()) ? SharedAssignmentPointer() :
+        queuedAssignment.value()->assignment;
+}
+
+QList<SharedAssignmentPointer> AssignmentQueue::getAssignments() const {
+    QList<SharedAssignmentPointer> assignments;
+    foreach (const TypeQueue::iterator& queuedAssignment, _queuedAssignments) {
+        assignments.append(queuedAssignment->assignment);
+    }
+    return assignments;
+}
@@ -0,0 +1,64 @@
+//
+//  AssignmentQueue.h
+//  domain-server/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#ifndef hifi_AssignmentQueue_h
+#define hifi_AssignmentQueue_h
+
+#include <QtCore/QHash>
+#include <QtCore/QLinkedList>
+#include <QtCore/QList>
+#include <QtCore/QMap>
+#include <QtCore/QSharedPointer>
+#include <QtCore/QUuid>
+
+#include <Assignment.h>
+
+typedef QSharedPointer<Assignment> SharedAssignmentPointer;
+
+/// The unfulfilled assignments of the domain, waiting for assignment-clients to take them. They're kept in a queue for
+/// each pool and type, in the order they were added or last handed out, and indexed by UUID, so that finding one for a
+/// request or a check-in and removing it don't depend on how many others are waiting.
+class AssignmentQueue {
+public:
+    AssignmentQueue();
+
+    /// adds the assignment to the back of the queue for its pool and type
+    void enqueue(const SharedAssignmentPointer& assignment);
+
+    /// returns the assignment that has waited longest in the given pool with the given type, or with any type for
+    /// Assignment::AllTypes, having moved it to the back so that the others get a chance to go out before it again
+    SharedAssignmentPointer rotateNextForRequest(Assignment::Type type, const QString& pool);
+
+    /// removes the assignment with the given UUID and returns it, or returns null if there isn't one
+    SharedAssignmentPointer take(const QUuid& uuid);
+
+    /// returns the assignment with the given UUID without removing it, or null if there isn't one
+    SharedAssignmentPointer value(const QUuid& uuid) const;
+
+    QList<SharedAssignmentPointer> getAssignments() const;
+
+    int size() const { return _queuedAssignments.size(); }
+
+private:
+    class QueuedAssignment {
+    public:
+        SharedAssignmentPointer assignment;
+        quint64 sequenceNumber; /// when it was added to the queue, to order the queues of different types
+    };
+    typedef QLinkedList<QueuedAssignment> TypeQueue;
+    typedef QMap<int, TypeQueue> PoolQueues;
+
+    /// the lists are never copied, so that the iterators into them stay valid as others are removed
+    QHash<QString, PoolQueues> _queuesByPool;
+    QHash<QUuid, TypeQueue::iterator> _queuedAssignments;
+    quint64 _nextSequenceNumber;
+};
+
+#endif // hifi_AssignmentQueue_h
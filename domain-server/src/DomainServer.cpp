@@ -15,17 +15,20 @@
 #include <QtCore/QJsonArray>
 #include <QtCore/QProcess>
 #include <QtCore/QStandardPaths>
+#include <QtCore/QThread>
 #include <QtCore/QTimer>
 #include <QtCore/QUrlQuery>
 
 #include <AccountManager.h>
 #include <HifiConfigVariantMap.h>
 #include <HTTPConnection.h>
+#include <Metrics.h>
 #include <PacketHeaders.h>
 #include <SharedUtil.h>
 #include <UUID.h>
 
 #include "DomainServerNodeData.h"
+#include "DomainServerPacketShard.h"
 
 #include "DomainServer.h"
 
@@ -42,7 +45,14 @@ DomainServer::DomainServer(int argc, char* argv[]) :
     _hostname(),
     _networkReplyUUIDMap(),
     _sessionAuthenticationHash(),
-    _settingsManager()
+    _settingsManager(),
+    _packetShards(),
+    _nodeListChangesMutex(),
+    _nodeListVersion(0),
+    _nodeListChanges(),
+    _sessionSecretsMutex(),
+    _jurisdictionHandoffClients(0),
+    _lastJurisdictionHandoff(0)
 {
     setOrganizationName("High Fidelity");
     setOrganizationDomain("highfidelity.io");
@@ -60,6 +70,13 @@ DomainServer::DomainServer(int argc, char* argv[]) :
     }
 }
 
+DomainServer::~DomainServer() {
+    foreach (DomainServerPacketShard* packetShard, _packetShards) {
+        packetShard->terminate();
+        delete packetShard;
+    }
+}
+
 bool DomainServer::optionallyReadX509KeyAndCertificate() {
     const QString X509_CERTIFICATE_OPTION = "cert";
     const QString X509_PRIVATE_KEY_OPTION = "key";
@@ -147,6 +164,16 @@ bool DomainServer::optionallySetupOAuth() {
     return true;
 }
 
+const int DEFAULT_JURISDICTION_HANDOFF_CLIENTS = 40;
+const int JURISDICTION_HANDOFF_CHECK_INTERVAL_MSECS = 10 * 1000;
+
+// the clients of a server take a while to move over after a handoff, and to show up in the stats that we go by
+const quint64 JURISDICTION_HANDOFF_COOLDOWN_USECS = 60 * USECS_PER_SECOND;
+
+static bool isOctreeServerType(NodeType_t nodeType) {
+    return nodeType == NodeType::VoxelServer || nodeType == NodeType::ParticleServer || nodeType == NodeType::ModelServer;
+}
+
 void DomainServer::setupNodeListAndAssignments(const QUuid& sessionUUID) {
 
     const QString CUSTOM_PORT_OPTION = "port";
@@ -182,12 +209,119 @@ void DomainServer::setupNodeListAndAssignments(const QUuid& sessionUUID) {
     connect(silentNodeTimer, SIGNAL(timeout()), nodeList, SLOT(removeSilentNodes()));
     silentNodeTimer->start(NODE_SILENCE_THRESHOLD_MSECS);
 
+    const QString JURISDICTION_HANDOFF_CLIENTS_OPTION = "jurisdiction-handoff-clients";
+    _jurisdictionHandoffClients = _argumentVariantMap.value(JURISDICTION_HANDOFF_CLIENTS_OPTION,
+                                                            DEFAULT_JURISDICTION_HANDOFF_CLIENTS).toInt();
+
+    QTimer* jurisdictionHandoffTimer = new QTimer(this);
+    connect(jurisdictionHandoffTimer, &QTimer::timeout, this, &DomainServer::checkJurisdictionHandoffs);
+    jurisdictionHandoffTimer->start(JURISDICTION_HANDOFF_CHECK_INTERVAL_MSECS);
+
+    setupPacketShards();
+
     connect(&nodeList->getNodeSocket(), SIGNAL(readyRead()), SLOT(readAvailableDatagrams()));
 
     // add whatever static assignments that have been parsed to the queue
     addStaticAssignmentsToQueue();
 }
 
+void DomainServer::checkJurisdictionHandoffs() {
+    if (_jurisdictionHandoffClients <= 0
+        || usecTimestampNow() - _lastJurisdictionHandoff < JURISDICTION_HANDOFF_COOLDOWN_USECS) {
+        return;
+    }
+
+    // for each type of octree server, the one with the most clients past the threshold and a spare to take some of them
+    QHash<NodeType_t, SharedNodePointer> busiestServers;
+    QHash<NodeType_t, int> busiestServerClients;
+    QHash<NodeType_t, SharedNodePointer> spareServers;
+
+    LimitedNodeList* nodeList = LimitedNodeList::getInstance();
+    foreach (const SharedNodePointer& node, nodeList->getNodeHash()) {
+        NodeType_t nodeType = node->getType();
+        if (!isOctreeServerType(nodeType)) {
+            continue;
+        }
+
+        // the stats are written by the node's shard
+        QJsonObject statsJSON;
+        node->getMutex().lock();
+        DomainServerNodeData* nodeData = reinterpret_cast<DomainServerNodeData*>(node->getLinkedData());
+        statsJSON = nodeData->getStatsJSONObject();
+        bool isPrimary = (nodeData->getOctreeReplication() == "primary");
+        node->getMutex().unlock();
+
+        // replicas follow the jurisdiction of their primary
+        if (!isPrimary) {
+            continue;
+        }
+
+        int clients = 0;
+        bool isSpare = false;
+        for (QJsonObject::const_iterator stat = statsJSON.constBegin(); stat != statsJSON.constEnd(); stat++) {
+            if (stat.key().endsWith(".0.5.clients")) {
+                clients = (int)stat.value().toDouble();
+            } else if (stat.key().endsWith(".0.7.jurisdiction")) {
+                isSpare = (stat.value().toString() == "spare");
+            }
+        }
+
+        if (isSpare) {
+            spareServers.insert(nodeType, node);
+        } else if (clients > _jurisdictionHandoffClients && clients > busiestServerClients.value(nodeType)) {
+            busiestServers.insert(nodeType, node);
+            busiestServerClients.insert(nodeType, clients);
+        }
+    }
+
+    foreach (NodeType_t nodeType, busiestServers.keys()) {
+        SharedNodePointer spareServer = spareServers.value(nodeType);
+        if (!spareServer) {
+            continue;
+        }
+        SharedNodePointer busiestServer = busiestServers.value(nodeType);
+        qDebug() << "Asking" << busiestServer->getUUID() << "with" << busiestServerClients.value(nodeType)
+            << "clients to hand off part of its jurisdiction to" << spareServer->getUUID();
+
+        QByteArray handoffRequest = byteArrayWithPopulatedHeader(PacketTypeJurisdictionHandoffRequest);
+        QDataStream handoffStream(&handoffRequest, QIODevice::Append);
+        handoffStream << spareServer->getUUID();
+
+        DomainServerNodeData* nodeData = reinterpret_cast<DomainServerNodeData*>(busiestServer->getLinkedData());
+        nodeList->writeUnverifiedDatagram(handoffRequest, nodeData->getSendingSockAddr());
+        _lastJurisdictionHandoff = usecTimestampNow();
+    }
+}
+
+// the most threads the packets of the nodes are spread across
+const int MAX_PACKET_SHARDS = 4;
+
+void DomainServer::setupPacketShards() {
+    // the event loop keeps the connect and assignment requests, so that the assignment queue has one writer
+    int numPacketShards = qBound(1, QThread::idealThreadCount() - 1, MAX_PACKET_SHARDS);
+    for (int i = 0; i < numPacketShards; i++) {
+        DomainServerPacketShard* packetShard = new DomainServerPacketShard(*this);
+        packetShard->initialize(true);
+        _packetShards.append(packetShard);
+    }
+}
+
+void DomainServer::queueNodePacket(const SharedNodePointer& node, const QByteArray& packet,
+                                   const HifiSockAddr& senderSockAddr) {
+    // a node always goes to the same shard, so its packets are processed in order and its data has one writer
+    DomainServerPacketShard* packetShard = _packetShards.at(qHash(node->getUUID()) % _packetShards.size());
+    if (!packetShard->queuePacket(node, packet, senderSockAddr)) {
+        static QElapsedTimer droppedMessageTimer;
+        const qint64 DROPPED_MESSAGE_INTERVAL_MSECS = 5 * 1000;
+
+        if (!droppedMessageTimer.isValid() || droppedMessageTimer.elapsed() > DROPPED_MESSAGE_INTERVAL_MSECS) {
+            qDebug() << "Dropped a packet from" << uuidStringWithoutCurlyBraces(node->getUUID())
+                << "- its shard has" << packetShard->getDroppedPacketCount() << "dropped in all.";
+            droppedMessageTimer.start();
+        }
+    }
+}
+
 bool DomainServer::optionallySetupAssignmentPayment() {
     // check if we have a username and password set via env
     const QString PAY_FOR_ASSIGNMENTS_OPTION = "pay-for-assignments";
@@ -394,7 +528,7 @@ void DomainServer::handleConnectRequest(const QByteArray& packet, const HifiSock
     NodeType_t nodeType;
     HifiSockAddr publicSockAddr, localSockAddr;
 
-    int numPreInterestBytes = parseNodeDataFromByteArray(nodeType, publicSockAddr, localSockAddr, packet, senderSockAddr);
+    parseNodeDataFromByteArray(nodeType, publicSockAddr, localSockAddr, packet, senderSockAddr);
 
     QUuid packetUUID = uuidFromPacketHeader(packet);
 
@@ -476,8 +610,8 @@ void DomainServer::handleConnectRequest(const QByteArray& packet, const HifiSock
 
         nodeData->setSendingSockAddr(senderSockAddr);
 
-        // reply back to the user with a PacketTypeDomainList
-        sendDomainListToNode(newNode, senderSockAddr, nodeInterestListFromPacket(packet, numPreInterestBytes));
+        // the node's shard replies with a PacketTypeDomainList, which for a new node is the whole list
+        queueNodePacket(newNode, packet, senderSockAddr);
     }
 }
 
@@ -540,7 +674,8 @@ int DomainServer::parseNodeDataFromByteArray(NodeType_t& nodeType, HifiSockAddr&
     return packetStream.device()->pos();
 }
 
-NodeSet DomainServer::nodeInterestListFromPacket(const QByteArray& packet, int numPreceedingBytes) {
+NodeSet DomainServer::nodeInterestListFromPacket(const QByteArray& packet, int numPreceedingBytes,
+                                                 quint32& knownListVersion) {
     QDataStream packetStream(packet);
     packetStream.skipRawData(numPreceedingBytes);
 
@@ -555,79 +690,228 @@ NodeSet DomainServer::nodeInterestListFromPacket(const QByteArray& packet, int n
         nodeInterestSet.insert((NodeType_t) nodeType);
     }
 
+    // the version of the list the node has follows its interests
+    knownListVersion = 0;
+    if (!packetStream.atEnd()) {
+        packetStream >> knownListVersion;
+    }
+
     return nodeInterestSet;
 }
 
-void DomainServer::sendDomainListToNode(const SharedNodePointer& node, const HifiSockAddr &senderSockAddr,
-                                        const NodeSet& nodeInterestList) {
+// the most changes kept, a node that is further behind than this is sent the whole list
+const int MAX_NODE_LIST_CHANGES = 1000;
 
-    QByteArray broadcastPacket = byteArrayWithPopulatedHeader(PacketTypeDomainList);
+void DomainServer::nodeListChanged(const SharedNodePointer& node, bool isRemoval) {
+    QMutexLocker locker(&_nodeListChangesMutex);
+    _nodeListChanges.append(NodeListChange(++_nodeListVersion, node->getUUID(), node->getType(), isRemoval));
+    while (_nodeListChanges.size() > MAX_NODE_LIST_CHANGES) {
+        _nodeListChanges.removeFirst();
+    }
+}
 
-    // always send the node their own UUID back
-    QDataStream broadcastDataStream(&broadcastPacket, QIODevice::Append);
-    broadcastDataStream << node->getUUID();
+void DomainServer::packNodeForNode(const SharedNodePointer& node, const SharedNodePointer& otherNode,
+                                   QDataStream& nodeDataStream) {
+    DomainServerNodeData* nodeData = reinterpret_cast<DomainServerNodeData*>(node->getLinkedData());
 
-    int numBroadcastPacketLeadBytes = broadcastDataStream.device()->pos();
+    {
+        // the other node's sockets can be changed by its own shard
+        QMutexLocker locker(&otherNode->getMutex());
+        nodeDataStream << *otherNode.data();
+    }
 
-    DomainServerNodeData* nodeData = reinterpret_cast<DomainServerNodeData*>(node->getLinkedData());
+    // pack the secret that these two nodes will use to communicate with each other
+    QMutexLocker locker(&_sessionSecretsMutex);
+    QUuid secretUUID = nodeData->getSessionSecretHash().value(otherNode->getUUID());
+    if (secretUUID.isNull()) {
+        // generate a new secret UUID these two nodes can use
+        secretUUID = QUuid::createUuid();
 
-    LimitedNodeList* nodeList = LimitedNodeList::getInstance();
+        // set that on the current Node's sessionSecretHash
+        nodeData->getSessionSecretHash().insert(otherNode->getUUID(), secretUUID);
 
-    if (nodeInterestList.size() > 0) {
+        // set it on the other Node's sessionSecretHash
+        reinterpret_cast<DomainServerNodeData*>(otherNode->getLinkedData())
+        ->getSessionSecretHash().insert(node->getUUID(), secretUUID);
 
-//        DTLSServerSession* dtlsSession = _isUsingDTLS ? _dtlsSessions[senderSockAddr] : NULL;
-        int dataMTU = MAX_PACKET_SIZE;
+    }
 
-        if (nodeData->isAuthenticated()) {
-            // if this authenticated node has any interest types, send back those nodes as well
-            foreach (const SharedNodePointer& otherNode, nodeList->getNodeHash()) {
+    nodeDataStream << secretUUID;
+}
 
-                // reset our nodeByteArray and nodeDataStream
-                QByteArray nodeByteArray;
-                QDataStream nodeDataStream(&nodeByteArray, QIODevice::Append);
+bool DomainServer::isServingOctreeGroup(const QUuid& serverUUID, const QUuid& primaryUUID) {
+    SharedNodePointer server = LimitedNodeList::getInstance()->nodeWithUUID(serverUUID);
+    if (!server) {
+        return false;
+    }
+    QMutexLocker locker(&server->getMutex());
+    DomainServerNodeData* serverData = reinterpret_cast<DomainServerNodeData*>(server->getLinkedData());
+    const QString& replication = serverData->getOctreeReplication();
+    return (replication == "primary" && serverUUID == primaryUUID)
+        || (replication == "replica" && serverData->getReplicaOf() == primaryUUID);
+}
 
-                if (otherNode->getUUID() != node->getUUID() && nodeInterestList.contains(otherNode->getType())) {
+bool DomainServer::shouldSendNodeToNode(const SharedNodePointer& node, const SharedNodePointer& otherNode) {
+    if (node->getType() != NodeType::Agent || !isOctreeServerType(otherNode->getType())) {
+        return true;
+    }
 
-                    // don't send avatar nodes to other avatars, that will come from avatar mixer
-                    nodeDataStream << *otherNode.data();
+    otherNode->getMutex().lock();
+    DomainServerNodeData* otherNodeData = reinterpret_cast<DomainServerNodeData*>(otherNode->getLinkedData());
+    QString replication = otherNodeData->getOctreeReplication();
+    QUuid primaryUUID = (replication == "replica") ? otherNodeData->getReplicaOf() : otherNode->getUUID();
+    otherNode->getMutex().unlock();
 
-                    // pack the secret that these two nodes will use to communicate with each other
-                    QUuid secretUUID = nodeData->getSessionSecretHash().value(otherNode->getUUID());
-                    if (secretUUID.isNull()) {
-                        // generate a new secret UUID these two nodes can use
-                        secretUUID = QUuid::createUuid();
+    // a server that hasn't said whether it's a replica, or a replica that hasn't caught up, isn't sent
+    if (replication != "primary" && replication != "replica") {
+        return false;
+    }
 
-                        // set that on the current Node's sessionSecretHash
-                        nodeData->getSessionSecretHash().insert(otherNode->getUUID(), secretUUID);
+    // of a primary and its replicas an agent is sent one, the one with the fewest clients when it first sees them
+    DomainServerNodeData* nodeData = reinterpret_cast<DomainServerNodeData*>(node->getLinkedData());
+    QHash<QUuid, QUuid>& octreeServerChoices = nodeData->getOctreeServerChoices();
+    if (!octreeServerChoices.contains(primaryUUID)) {
+        SharedNodePointer chosenServer;
+        int chosenServerClients = 0;
+        uint chosenServerHash = 0;
+        foreach (const SharedNodePointer& server, LimitedNodeList::getInstance()->getNodeHash()) {
+            if (server->getType() != otherNode->getType() || !isServingOctreeGroup(server->getUUID(), primaryUUID)) {
+                continue;
+            }
+            server->getMutex().lock();
+            int clients = reinterpret_cast<DomainServerNodeData*>(server->getLinkedData())->getOctreeClients();
+            server->getMutex().unlock();
+
+            // the ties are broken differently for each agent, so that they spread out
+            uint hash = qHash(server->getUUID()) ^ qHash(node->getUUID());
+            if (!chosenServer || clients < chosenServerClients
+                || (clients == chosenServerClients && hash < chosenServerHash)) {
+                chosenServer = server;
+                chosenServerClients = clients;
+                chosenServerHash = hash;
+            }
+        }
+        if (!chosenServer) {
+            return false;
+        }
+        chosenServer->getMutex().lock();
+        reinterpret_cast<DomainServerNodeData*>(chosenServer->getLinkedData())->agentRouted();
+        chosenServer->getMutex().unlock();
+        octreeServerChoices.insert(primaryUUID, chosenServer->getUUID());
+    }
+    return octreeServerChoices.value(primaryUUID) == otherNode->getUUID();
+}
 
-                        // set it on the other Node's sessionSecretHash
-                        reinterpret_cast<DomainServerNodeData*>(otherNode->getLinkedData())
-                        ->getSessionSecretHash().insert(node->getUUID(), secretUUID);
+void DomainServer::sendDomainListToNode(const SharedNodePointer& node, const HifiSockAddr &senderSockAddr,
+                                        const NodeSet& nodeInterestList, quint32 knownListVersion) {
 
-                    }
+    DomainServerNodeData* nodeData = reinterpret_cast<DomainServerNodeData*>(node->getLinkedData());
 
-                    nodeDataStream << secretUUID;
+    LimitedNodeList* nodeList = LimitedNodeList::getInstance();
 
-                    if (broadcastPacket.size() +  nodeByteArray.size() > dataMTU) {
-                        // we need to break here and start a new packet
-                        // so send the current one
+    // the nodes this node is interested in that left, and those that joined or moved, since the version it has
+    QList<QUuid> removedNodeUUIDs;
+    QList<SharedNodePointer> changedNodes;
+
+    // the changes are taken as of now, a change made while the list is packed is sent the next time
+    _nodeListChangesMutex.lock();
+    quint32 nodeListVersion = _nodeListVersion;
+    QList<NodeListChange> nodeListChanges = _nodeListChanges;
+    _nodeListChangesMutex.unlock();
+
+    if (nodeInterestList.size() > 0 && nodeData->isAuthenticated()) {
+        // only the changes since its version are sent if they are all still kept, and it wants the same types as before
+        quint32 oldestDeltaVersion = nodeListChanges.isEmpty() ? nodeListVersion : nodeListChanges.first().version - 1;
+        bool canSendDelta = knownListVersion != 0 && knownListVersion <= nodeListVersion
+            && knownListVersion >= oldestDeltaVersion && nodeInterestList == nodeData->getNodeInterestSet();
+
+        // an agent whose octree server left or stopped serving is routed again, and sent the whole list with the new one
+        QHash<QUuid, QUuid>& octreeServerChoices = nodeData->getOctreeServerChoices();
+        for (QHash<QUuid, QUuid>::iterator choice = octreeServerChoices.begin(); choice != octreeServerChoices.end(); ) {
+            if (isServingOctreeGroup(choice.value(), choice.key())) {
+                choice++;
+            } else {
+                removedNodeUUIDs.append(choice.value());
+                choice = octreeServerChoices.erase(choice);
+                canSendDelta = false;
+            }
+        }
 
-                        nodeList->writeDatagram(broadcastPacket, node, senderSockAddr);
+        if (canSendDelta) {
+            // the newest change to each node is the one that counts
+            QSet<QUuid> changedNodeUUIDs;
+            for (int i = nodeListChanges.size() - 1; i >= 0 && nodeListChanges.at(i).version > knownListVersion; i--) {
+                const NodeListChange& change = nodeListChanges.at(i);
+                if (change.nodeUUID == node->getUUID() || !nodeInterestList.contains(change.nodeType)
+                    || changedNodeUUIDs.contains(change.nodeUUID)) {
+                    continue;
+                }
+                changedNodeUUIDs.insert(change.nodeUUID);
 
-                        // reset the broadcastPacket structure
-                        broadcastPacket.resize(numBroadcastPacketLeadBytes);
-                        broadcastDataStream.device()->seek(numBroadcastPacketLeadBytes);
+                SharedNodePointer changedNode = change.isRemoval ? SharedNodePointer() : nodeList->nodeWithUUID(change.nodeUUID);
+                if (changedNode) {
+                    if (shouldSendNodeToNode(node, changedNode)) {
+                        changedNodes.append(changedNode);
                     }
-
-                    // append the nodeByteArray to the current state of broadcastDataStream
-                    broadcastPacket.append(nodeByteArray);
+                } else {
+                    removedNodeUUIDs.append(change.nodeUUID);
+                }
+            }
+        } else {
+            foreach (const SharedNodePointer& otherNode, nodeList->getNodeHash()) {
+                if (otherNode->getUUID() != node->getUUID() && nodeInterestList.contains(otherNode->getType())
+                    && shouldSendNodeToNode(node, otherNode)) {
+                    changedNodes.append(otherNode);
                 }
             }
         }
+    }
+    nodeData->setNodeInterestSet(nodeInterestList);
+
+    // an unauthenticated node isn't given a version, so that it is sent the whole list once it is authenticated
+    quint32 listVersion = nodeData->isAuthenticated() ? nodeListVersion : 0;
+    quint16 numEntries = (quint16) (removedNodeUUIDs.size() + changedNodes.size());
+
+    QByteArray broadcastPacket = byteArrayWithPopulatedHeader(PacketTypeDomainList);
 
-        // always write the last broadcastPacket
-        nodeList->writeDatagram(broadcastPacket, node, senderSockAddr);
+    // always send the node their own UUID back, and the version of the list that this brings it up to
+    QDataStream broadcastDataStream(&broadcastPacket, QIODevice::Append);
+    broadcastDataStream << node->getUUID() << listVersion << numEntries;
+
+    int numBroadcastPacketLeadBytes = broadcastDataStream.device()->pos();
+
+//    DTLSServerSession* dtlsSession = _isUsingDTLS ? _dtlsSessions[senderSockAddr] : NULL;
+    int dataMTU = MAX_PACKET_SIZE;
+
+    for (int i = 0; i < numEntries; i++) {
+        // reset our nodeByteArray and nodeDataStream
+        QByteArray nodeByteArray;
+        QDataStream nodeDataStream(&nodeByteArray, QIODevice::Append);
+
+        if (i < removedNodeUUIDs.size()) {
+            nodeDataStream << (quint8) true << removedNodeUUIDs.at(i);
+        } else {
+            nodeDataStream << (quint8) false;
+            packNodeForNode(node, changedNodes.at(i - removedNodeUUIDs.size()), nodeDataStream);
+        }
+
+        if (broadcastPacket.size() +  nodeByteArray.size() > dataMTU) {
+            // we need to break here and start a new packet
+            // so send the current one
+
+            nodeList->writeDatagram(broadcastPacket, node, senderSockAddr);
+
+            // reset the broadcastPacket structure
+            broadcastPacket.resize(numBroadcastPacketLeadBytes);
+            broadcastDataStream.device()->seek(numBroadcastPacketLeadBytes);
+        }
+
+        // append the nodeByteArray to the current state of broadcastDataStream
+        broadcastPacket.append(nodeByteArray);
     }
+
+    // always write the last broadcastPacket
+    nodeList->writeDatagram(broadcastPacket, node, senderSockAddr);
 }
 
 void DomainServer::readAvailableDatagrams() {
@@ -639,10 +923,7 @@ void DomainServer::readAvailableDatagrams() {
     static QByteArray assignmentPacket = byteArrayWithPopulatedHeader(PacketTypeCreateAssignment);
     static int numAssignmentPacketHeaderBytes = assignmentPacket.size();
 
-    while (nodeList->getNodeSocket().hasPendingDatagrams()) {
-        receivedPacket.resize(nodeList->getNodeSocket().pendingDatagramSize());
-        nodeList->getNodeSocket().readDatagram(receivedPacket.data(), receivedPacket.size(),
-                                               senderSockAddr.getAddressPointer(), senderSockAddr.getPortPointer());
+    while (nodeList->readPendingDatagram(receivedPacket, senderSockAddr)) {
         if (packetTypeForPacket(receivedPacket) == PacketTypeRequestAssignment
             && nodeList->packetVersionAndHashMatch(receivedPacket)) {
 
@@ -817,29 +1098,65 @@ void DomainServer::processDatagram(const QByteArray& receivedPacket, const HifiS
 
         if (requestType == PacketTypeDomainConnectRequest) {
             handleConnectRequest(receivedPacket, senderSockAddr);
-        } else if (requestType == PacketTypeDomainListRequest) {
-            QUuid nodeUUID = uuidFromPacketHeader(receivedPacket);
+        } else if (requestType == PacketTypeDomainListRequest || requestType == PacketTypeNodeJsonStats) {
+            // the rest of the work for a node's check-ins and stats is done on its shard
+            SharedNodePointer sendingNode = nodeList->sendingNodeForPacket(receivedPacket);
+            if (sendingNode) {
+                queueNodePacket(sendingNode, receivedPacket, senderSockAddr);
+            }
+        }
+    }
+}
 
-            if (!nodeUUID.isNull() && nodeList->nodeWithUUID(nodeUUID)) {
-                NodeType_t throwawayNodeType;
-                HifiSockAddr nodePublicAddress, nodeLocalAddress;
+void DomainServer::processNodePacket(const SharedNodePointer& node, const QByteArray& packet,
+                                     const HifiSockAddr& senderSockAddr) {
+    PacketType requestType = packetTypeForPacket(packet);
 
-                int numNodeInfoBytes = parseNodeDataFromByteArray(throwawayNodeType, nodePublicAddress, nodeLocalAddress,
-                                                                  receivedPacket, senderSockAddr);
+    if (requestType == PacketTypeDomainConnectRequest) {
+        NodeType_t throwawayNodeType;
+        HifiSockAddr nodePublicAddress, nodeLocalAddress;
 
-                SharedNodePointer checkInNode = nodeList->updateSocketsForNode(nodeUUID, nodePublicAddress, nodeLocalAddress);
+        int numPreInterestBytes = parseNodeDataFromByteArray(throwawayNodeType, nodePublicAddress, nodeLocalAddress,
+                                                             packet, senderSockAddr);
 
-                // update last receive to now
-                quint64 timeNow = usecTimestampNow();
-                checkInNode->setLastHeardMicrostamp(timeNow);
+        // the node just connected, so it is sent the whole list
+        quint32 knownListVersion = 0;
+        NodeSet nodeInterestList = nodeInterestListFromPacket(packet, numPreInterestBytes, knownListVersion);
+        sendDomainListToNode(node, senderSockAddr, nodeInterestList);
 
-                sendDomainListToNode(checkInNode, senderSockAddr, nodeInterestListFromPacket(receivedPacket, numNodeInfoBytes));
-            }
-        } else if (requestType == PacketTypeNodeJsonStats) {
-            SharedNodePointer matchingNode = nodeList->sendingNodeForPacket(receivedPacket);
-            if (matchingNode) {
-                reinterpret_cast<DomainServerNodeData*>(matchingNode->getLinkedData())->parseJSONStatsPacket(receivedPacket);
-            }
+    } else if (requestType == PacketTypeDomainListRequest) {
+        NodeType_t throwawayNodeType;
+        HifiSockAddr nodePublicAddress, nodeLocalAddress;
+
+        int numNodeInfoBytes = parseNodeDataFromByteArray(throwawayNodeType, nodePublicAddress, nodeLocalAddress,
+                                                          packet, senderSockAddr);
+
+        node->getMutex().lock();
+        bool haveSocketsChanged = node->getPublicSocket() != nodePublicAddress
+            || node->getLocalSocket() != nodeLocalAddress;
+        node->getMutex().unlock();
+
+        if (haveSocketsChanged) {
+            // the nodes that know this one need its new sockets
+            LimitedNodeList::getInstance()->updateSocketsForNode(node->getUUID(), nodePublicAddress, nodeLocalAddress);
+            nodeListChanged(node, false);
+        }
+
+        quint32 knownListVersion = 0;
+        NodeSet nodeInterestList = nodeInterestListFromPacket(packet, numNodeInfoBytes, knownListVersion);
+        sendDomainListToNode(node, senderSockAddr, nodeInterestList, knownListVersion);
+
+    } else if (requestType == PacketTypeNodeJsonStats) {
+        // the stats are read for the HTTP requests on the event loop
+        node->getMutex().lock();
+        DomainServerNodeData* nodeData = reinterpret_cast<DomainServerNodeData*>(node->getLinkedData());
+        nodeData->parseJSONStatsPacket(packet);
+        bool hasOctreeServerChanged = isOctreeServerType(node->getType()) && nodeData->updateOctreeServerFromStats();
+        node->getMutex().unlock();
+
+        if (hasOctreeServerChanged) {
+            // the agents are sent an octree server once it says whether it's a replica that can serve them
+            nodeListChanged(node, false);
         }
     }
 }
@@ -946,7 +1263,7 @@ bool DomainServer::handleHTTPRequest(HTTPConnection* connection, const QUrl& url
             QJsonObject queuedAssignmentsJSON;
 
             // add the queued but unfilled assignments to the json
-            foreach(const SharedAssignmentPointer& assignment, _unfulfilledAssignments) {
+            foreach(const SharedAssignmentPointer& assignment, _unfulfilledAssignments.getAssignments()) {
                 QJsonObject queuedAssignmentJSON;
 
                 QString uuidString = uuidStringWithoutCurlyBraces(assignment->getUUID());
@@ -968,6 +1285,19 @@ bool DomainServer::handleHTTPRequest(HTTPConnection* connection, const QUrl& url
             connection->respond(HTTPConnection::StatusCode200, assignmentDocument.toJson(), qPrintable(JSON_MIME_TYPE));
 
             // we've processed this request
+            return true;
+        } else if (url.path() == "/telemetry.json") {
+            // the time series of the packets each node sends and is sent
+            QJsonDocument telemetryDocument(LimitedNodeList::getInstance()->getTelemetryJSON());
+            connection->respond(HTTPConnection::StatusCode200, telemetryDocument.toJson(), qPrintable(JSON_MIME_TYPE));
+
+            return true;
+        } else if (url.path() == "/metrics") {
+            // the same totals in the text format that Prometheus scrapes
+            connection->respond(HTTPConnection::StatusCode200, LimitedNodeList::getInstance()->getTelemetryPrometheusText() +
+                                MetricsRegistry::getInstance().getPrometheusText(),
+                                "text/plain; version=0.0.4");
+
             return true;
         } else if (url.path() == "/transactions.json") {
             // enumerate our pending transactions and display them in an array
@@ -1020,9 +1350,11 @@ bool DomainServer::handleHTTPRequest(HTTPConnection* connection, const QUrl& url
                 // see if we have a node that matches this ID
                 SharedNodePointer matchingNode = LimitedNodeList::getInstance()->nodeWithUUID(matchingUUID);
                 if (matchingNode) {
-                    // create a QJsonDocument with the stats QJsonObject
+                    // create a QJsonDocument with the stats QJsonObject, which the node's shard may be changing
+                    matchingNode->getMutex().lock();
                     QJsonObject statsObject =
                         reinterpret_cast<DomainServerNodeData*>(matchingNode->getLinkedData())->getStatsJSONObject();
+                    matchingNode->getMutex().unlock();
 
                     // add the node type to the JSON data for output purposes
                     statsObject["node_type"] = NodeType::getNodeTypeName(matchingNode->getType()).toLower().replace(' ', '-');
@@ -1294,10 +1626,14 @@ void DomainServer::refreshStaticAssignmentAndAddToQueue(SharedAssignmentPointer&
 void DomainServer::nodeAdded(SharedNodePointer node) {
     // we don't use updateNodeWithData, so add the DomainServerNodeData to the node here
     node->setLinkedData(new DomainServerNodeData());
+
+    nodeListChanged(node, false);
 }
 
 void DomainServer::nodeKilled(SharedNodePointer node) {
 
+    nodeListChanged(node, true);
+
     DomainServerNodeData* nodeData = reinterpret_cast<DomainServerNodeData*>(node->getLinkedData());
 
     if (nodeData) {
@@ -1311,6 +1647,7 @@ void DomainServer::nodeKilled(SharedNodePointer node) {
         }
 
         // cleanup the connection secrets that we set up for this node (on the other nodes)
+        QMutexLocker locker(&_sessionSecretsMutex);
         foreach (const QUuid& otherNodeSessionUUID, nodeData->getSessionSecretHash().keys()) {
             SharedNodePointer otherNode = LimitedNodeList::getInstance()->nodeWithUUID(otherNodeSessionUUID);
             if (otherNode) {
@@ -1321,18 +1658,11 @@ void DomainServer::nodeKilled(SharedNodePointer node) {
 }
 
 SharedAssignmentPointer DomainServer::matchingQueuedAssignmentForCheckIn(const QUuid& assignmentUUID, NodeType_t nodeType) {
-    QQueue<SharedAssignmentPointer>::iterator i = _unfulfilledAssignments.begin();
-
-    while (i != _unfulfilledAssignments.end()) {
-        if (i->data()->getType() == Assignment::typeForNodeType(nodeType)
-            && i->data()->getUUID() == assignmentUUID) {
-            // we have an unfulfilled assignment to return
+    SharedAssignmentPointer matchingAssignment = _unfulfilledAssignments.value(assignmentUUID);
 
-            // return the matching assignment
-            return _unfulfilledAssignments.takeAt(i - _unfulfilledAssignments.begin());
-        } else {
-            ++i;
-        }
+    if (matchingAssignment && matchingAssignment->getType() == Assignment::typeForNodeType(nodeType)) {
+        // we have an unfulfilled assignment to return, so it comes out of the queue
+        return _unfulfilledAssignments.take(assignmentUUID);
     }
 
     return SharedAssignmentPointer();
@@ -1340,49 +1670,12 @@ SharedAssignmentPointer DomainServer::matchingQueuedAssignmentForCheckIn(const Q
 
 SharedAssignmentPointer DomainServer::deployableAssignmentForRequest(const Assignment& requestAssignment) {
     // this is an unassigned client talking to us directly for an assignment
-    // go through our queue and see if there are any assignments to give out
-    QQueue<SharedAssignmentPointer>::iterator sharedAssignment = _unfulfilledAssignments.begin();
-
-    while (sharedAssignment != _unfulfilledAssignments.end()) {
-        Assignment* assignment = sharedAssignment->data();
-        bool requestIsAllTypes = requestAssignment.getType() == Assignment::AllTypes;
-        bool assignmentTypesMatch = assignment->getType() == requestAssignment.getType();
-        bool nietherHasPool = assignment->getPool().isEmpty() && requestAssignment.getPool().isEmpty();
-        bool assignmentPoolsMatch = assignment->getPool() == requestAssignment.getPool();
-
-        if ((requestIsAllTypes || assignmentTypesMatch) && (nietherHasPool || assignmentPoolsMatch)) {
-
-            // remove the assignment from the queue
-            SharedAssignmentPointer deployableAssignment = _unfulfilledAssignments.takeAt(sharedAssignment
-                                                                                          - _unfulfilledAssignments.begin());
-
-            // until we get a connection for this assignment
-            // put assignment back in queue but stick it at the back so the others have a chance to go out
-            _unfulfilledAssignments.enqueue(deployableAssignment);
-
-            // stop looping, we've handed out an assignment
-            return deployableAssignment;
-        } else {
-            // push forward the iterator to check the next assignment
-            ++sharedAssignment;
-        }
-    }
-
-    return SharedAssignmentPointer();
+    // see if there are any assignments of the type it wants, or of any type if it will take any, in its pool
+    return _unfulfilledAssignments.rotateNextForRequest(requestAssignment.getType(), requestAssignment.getPool());
 }
 
 void DomainServer::removeMatchingAssignmentFromQueue(const SharedAssignmentPointer& removableAssignment) {
-    QQueue<SharedAssignmentPointer>::iterator potentialMatchingAssignment = _unfulfilledAssignments.begin();
-    while (potentialMatchingAssignment != _unfulfilledAssignments.end()) {
-        if (potentialMatchingAssignment->data()->getUUID() == removableAssignment->getUUID()) {
-            _unfulfilledAssignments.erase(potentialMatchingAssignment);
-
-            // we matched and removed an assignment, bail out
-            break;
-        } else {
-            ++potentialMatchingAssignment;
-        }
-    }
+    _unfulfilledAssignments.take(removableAssignment->getUUID());
 }
 
 void DomainServer::addStaticAssignmentsToQueue() {
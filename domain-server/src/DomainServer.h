@@ -13,35 +13,57 @@
 #define hifi_DomainServer_h
 
 #include <QtCore/QCoreApplication>
+#include <QtCore/QDataStream>
 #include <QtCore/QHash>
 #include <QtCore/QJsonObject>
-#include <QtCore/QQueue>
+#include <QtCore/QMutex>
 #include <QtCore/QSharedPointer>
 #include <QtCore/QStringList>
 #include <QtCore/QUrl>
+#include <QtCore/QVector>
 
 #include <Assignment.h>
 #include <HTTPSConnection.h>
 #include <LimitedNodeList.h>
 
+#include "AssignmentQueue.h"
 #include "DomainServerSettingsManager.h"
 #include "WalletTransaction.h"
 
 #include "PendingAssignedNodeData.h"
 
-typedef QSharedPointer<Assignment> SharedAssignmentPointer;
+class DomainServerPacketShard;
+
 typedef QMultiHash<QUuid, WalletTransaction*> TransactionHash;
 
+/// A change to the list of nodes in the domain. The domain server keeps the latest of them so that a node that has the
+/// list as of an earlier version is only sent what changed since.
+class NodeListChange {
+public:
+    NodeListChange() : version(0), nodeUUID(), nodeType(NodeType::Unassigned), isRemoval(false) { }
+    NodeListChange(quint32 version, const QUuid& nodeUUID, NodeType_t nodeType, bool isRemoval) :
+        version(version), nodeUUID(nodeUUID), nodeType(nodeType), isRemoval(isRemoval) { }
+    
+    quint32 version; /// the version of the list the change made
+    QUuid nodeUUID;
+    NodeType_t nodeType;
+    bool isRemoval; /// the node left, otherwise it was added or its sockets changed
+};
+
 class DomainServer : public QCoreApplication, public HTTPSRequestHandler {
     Q_OBJECT
 public:
     DomainServer(int argc, char* argv[]);
+    ~DomainServer();
     
     bool handleHTTPRequest(HTTPConnection* connection, const QUrl& url);
     bool handleHTTPSRequest(HTTPSConnection* connection, const QUrl& url);
     
     void exit(int retCode = 0);
     
+    /// processes a check-in, a stats packet or the first list for a node that connected, on the shard of that node
+    void processNodePacket(const SharedNodePointer& node, const QByteArray& packet, const HifiSockAddr& senderSockAddr);
+    
 public slots:
     /// Called by NodeList to inform us a node has been added
     void nodeAdded(SharedNodePointer node);
@@ -55,6 +77,7 @@ private slots:
     void readAvailableDatagrams();
     void setupPendingAssignmentCredits();
     void sendPendingTransactionsToServer();
+    void checkJurisdictionHandoffs();
 private:
     void setupNodeListAndAssignments(const QUuid& sessionUUID = QUuid::createUuid());
     bool optionallySetupOAuth();
@@ -63,12 +86,19 @@ private:
     
     void processDatagram(const QByteArray& receivedPacket, const HifiSockAddr& senderSockAddr);
     
+    void setupPacketShards();
+    void queueNodePacket(const SharedNodePointer& node, const QByteArray& packet, const HifiSockAddr& senderSockAddr);
+    
     void handleConnectRequest(const QByteArray& packet, const HifiSockAddr& senderSockAddr);
     int parseNodeDataFromByteArray(NodeType_t& nodeType, HifiSockAddr& publicSockAddr,
                                     HifiSockAddr& localSockAddr, const QByteArray& packet, const HifiSockAddr& senderSockAddr);
-    NodeSet nodeInterestListFromPacket(const QByteArray& packet, int numPreceedingBytes);
+    NodeSet nodeInterestListFromPacket(const QByteArray& packet, int numPreceedingBytes, quint32& knownListVersion);
     void sendDomainListToNode(const SharedNodePointer& node, const HifiSockAddr& senderSockAddr,
-                              const NodeSet& nodeInterestList);
+                              const NodeSet& nodeInterestList, quint32 knownListVersion = 0);
+    void packNodeForNode(const SharedNodePointer& node, const SharedNodePointer& otherNode, QDataStream& nodeDataStream);
+    bool shouldSendNodeToNode(const SharedNodePointer& node, const SharedNodePointer& otherNode);
+    bool isServingOctreeGroup(const QUuid& serverUUID, const QUuid& primaryUUID);
+    void nodeListChanged(const SharedNodePointer& node, bool isRemoval);
     
     void parseAssignmentConfigs(QSet<Assignment::Type>& excludedTypes);
     void addStaticAssignmentToAssignmentHash(Assignment* newAssignment);
@@ -95,7 +125,7 @@ private:
     HTTPSManager* _httpsManager;
     
     QHash<QUuid, SharedAssignmentPointer> _allAssignments;
-    QQueue<SharedAssignmentPointer> _unfulfilledAssignments;
+    AssignmentQueue _unfulfilledAssignments;
     QHash<QUuid, PendingAssignedNodeData*> _pendingAssignedNodes;
     TransactionHash _pendingAssignmentCredits;
     
@@ -111,6 +141,17 @@ private:
     QHash<QUuid, bool> _sessionAuthenticationHash;
     
     DomainServerSettingsManager _settingsManager;
+    
+    QVector<DomainServerPacketShard*> _packetShards;
+    
+    QMutex _nodeListChangesMutex; /// guards the version and changes, which the shards read as they send lists
+    quint32 _nodeListVersion;
+    QList<NodeListChange> _nodeListChanges; /// the changes since the oldest version a delta can be sent from
+    
+    QMutex _sessionSecretsMutex; /// guards the session secret hashes of the nodes, which pair nodes across shards
+    
+    int _jurisdictionHandoffClients; /// an octree server with more clients hands off part of its jurisdiction, 0 never
+    quint64 _lastJurisdictionHandoff;
 };
 
 #endif // hifi_DomainServer_h
@@ -24,7 +24,13 @@ DomainServerNodeData::DomainServerNodeData() :
     _paymentIntervalTimer(),
     _statsJSONObject(),
     _sendingSockAddr(),
-    _isAuthenticated(true)
+    _isAuthenticated(true),
+    _nodeInterestSet(),
+    _octreeReplication(),
+    _replicaOf(),
+    _octreeClients(0),
+    _agentsRoutedSinceStats(0),
+    _octreeServerChoices()
 {
     _paymentIntervalTimer.start();
 }
@@ -42,6 +48,28 @@ void DomainServerNodeData::parseJSONStatsPacket(const QByteArray& statsPacket) {
     _statsJSONObject = mergeJSONStatsFromNewObject(unpackedStatsJSON, _statsJSONObject);
 }
 
+bool DomainServerNodeData::updateOctreeServerFromStats() {
+    QString replication;
+    QUuid replicaOf;
+    for (QJsonObject::const_iterator stat = _statsJSONObject.constBegin(); stat != _statsJSONObject.constEnd(); stat++) {
+        if (stat.key().endsWith(".0.5.clients")) {
+            _octreeClients = (int)stat.value().toDouble();
+        } else if (stat.key().endsWith(".0.8.replication")) {
+            replication = stat.value().toString();
+        } else if (stat.key().endsWith(".0.9.replicaOf")) {
+            replicaOf = QUuid(stat.value().toString());
+        }
+    }
+    _agentsRoutedSinceStats = 0;
+    
+    if (replication == _octreeReplication && replicaOf == _replicaOf) {
+        return false;
+    }
+    _octreeReplication = replication;
+    _replicaOf = replicaOf;
+    return true;
+}
+
 QJsonObject DomainServerNodeData::mergeJSONStatsFromNewObject(const QJsonObject& newObject, QJsonObject destinationObject) {
     foreach(const QString& key, newObject.keys()) {
         if (newObject[key].isObject() && destinationObject.contains(key)) {
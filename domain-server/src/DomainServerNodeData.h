@@ -18,6 +18,7 @@
 #include <QtCore/QUuid>
 
 #include <HifiSockAddr.h>
+#include <LimitedNodeList.h>
 #include <NodeData.h>
 
 class DomainServerNodeData : public NodeData {
@@ -44,6 +45,24 @@ public:
     bool isAuthenticated() const { return _isAuthenticated; }
     
     QHash<QUuid, QUuid>& getSessionSecretHash() { return _sessionSecretHash; }
+    
+    /// the types of node this node was last sent the list of, a change in them needs a full list
+    void setNodeInterestSet(const NodeSet& nodeInterestSet) { _nodeInterestSet = nodeInterestSet; }
+    const NodeSet& getNodeInterestSet() const { return _nodeInterestSet; }
+    
+    /// reads an octree server's replication role and clients from its stats, returns whether its role changed
+    bool updateOctreeServerFromStats();
+    
+    /// "primary", "syncing" or "replica", empty until the octree server's stats have said
+    const QString& getOctreeReplication() const { return _octreeReplication; }
+    const QUuid& getReplicaOf() const { return _replicaOf; }
+    
+    /// the clients an octree server reported, plus the agents routed to it since
+    int getOctreeClients() const { return _octreeClients + _agentsRoutedSinceStats; }
+    void agentRouted() { _agentsRoutedSinceStats++; }
+    
+    /// for an agent, the octree server it was routed to of each primary and its replicas, by the primary's UUID
+    QHash<QUuid, QUuid>& getOctreeServerChoices() { return _octreeServerChoices; }
 private:
     QJsonObject mergeJSONStatsFromNewObject(const QJsonObject& newObject, QJsonObject destinationObject);
     
@@ -54,6 +73,12 @@ private:
     QJsonObject _statsJSONObject;
     HifiSockAddr _sendingSockAddr;
     bool _isAuthenticated;
+    NodeSet _nodeInterestSet;
+    QString _octreeReplication;
+    QUuid _replicaOf;
+    int _octreeClients;
+    int _agentsRoutedSinceStats;
+    QHash<QUuid, QUuid> _octreeServerChoices;
 };
 
 #endif // hifi_DomainServerNodeData_h
@@ -0,0 +1,46 @@
+//
+//  DomainServerPacketShard.cpp
+//  domain-server/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#include "DomainServer.h"
+
+#include "DomainServerPacketShard.h"
+
+// the wait is bounded so that a shard being terminated never sleeps through the wake
+const unsigned long SHARD_MAX_WAIT_MSECS = 100;
+
+DomainServerPacketShard::DomainServerPacketShard(DomainServer& domainServer) :
+    _domainServer(domainServer),
+    _packets(DOMAIN_SERVER_SHARD_QUEUE_CAPACITY)
+{
+}
+
+bool DomainServerPacketShard::queuePacket(const SharedNodePointer& node, const QByteArray& packet,
+                                          const HifiSockAddr& senderSockAddr) {
+    // the node is heard from as the packet arrives, so that a full queue doesn't have it taken for silent
+    node->setLastHeardMicrostamp(usecTimestampNow());
+
+    return _packets.push(QueuedNodePacket(node, packet, senderSockAddr));
+}
+
+bool DomainServerPacketShard::process() {
+    _packets.waitForItems(SHARD_MAX_WAIT_MSECS);
+
+    QueuedNodePacket queuedPacket;
+    quint64 waitUsecs;
+    while (_packets.pop(queuedPacket, waitUsecs)) {
+        queuedPacket.node->getTelemetry().recordQueueDelay(waitUsecs);
+        _domainServer.processNodePacket(queuedPacket.node, queuedPacket.packet, queuedPacket.senderSockAddr);
+    }
+    return isStillRunning();
+}
+
+void DomainServerPacketShard::terminating() {
+    _packets.wakeAll();
+}
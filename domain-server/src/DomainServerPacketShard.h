@@ -0,0 +1,59 @@
+//
+//  DomainServerPacketShard.h
+//  domain-server/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#ifndef hifi_DomainServerPacketShard_h
+#define hifi_DomainServerPacketShard_h
+
+#include <BoundedMPSCQueue.h>
+#include <GenericThread.h>
+#include <HifiSockAddr.h>
+#include <LimitedNodeList.h>
+
+class DomainServer;
+
+/// the packets a DomainServerPacketShard can have waiting, past which the packets received for it are dropped
+const int DOMAIN_SERVER_SHARD_QUEUE_CAPACITY = 2048;
+
+/// A packet from a node for a DomainServerPacketShard to process, with the address it came from
+class QueuedNodePacket {
+public:
+    QueuedNodePacket() : node(), packet(), senderSockAddr() { }
+    QueuedNodePacket(const SharedNodePointer& node, const QByteArray& packet, const HifiSockAddr& senderSockAddr) :
+        node(node), packet(packet), senderSockAddr(senderSockAddr) { }
+
+    SharedNodePointer node;
+    QByteArray packet;
+    HifiSockAddr senderSockAddr;
+};
+
+/// One of the threads the domain server processes the packets of the nodes in its domain on. Each node is given to one
+/// shard by its UUID, so the packets of a node are processed in order and its data is only changed by that shard.
+class DomainServerPacketShard : public GenericThread {
+    Q_OBJECT
+public:
+    DomainServerPacketShard(DomainServer& domainServer);
+
+    /// queues a packet from the thread reading the socket, returns false if the queue was full and it was dropped
+    bool queuePacket(const SharedNodePointer& node, const QByteArray& packet, const HifiSockAddr& senderSockAddr);
+
+    int getDepth() const { return _packets.getDepth(); }
+    int getMaxDepth() const { return _packets.getMaxDepth(); }
+    int getDroppedPacketCount() const { return _packets.getNumFullPushes(); }
+
+protected:
+    virtual bool process();
+    virtual void terminating();
+
+private:
+    DomainServer& _domainServer;
+    BoundedMPSCQueue<QueuedNodePacket> _packets;
+};
+
+#endif // hifi_DomainServerPacketShard_h
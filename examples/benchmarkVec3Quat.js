@@ -0,0 +1,39 @@
+//
+//  benchmarkVec3Quat.js
+//  examples
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Times the Vec3 and Quat helpers, whose arguments and results are converted between script objects and vectors on
+//  every call, as math-heavy scripts use them.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+var ITERATIONS = 100000;
+
+function benchmark(name, operation) {
+    var start = new Date().getTime();
+    for (var i = 0; i < ITERATIONS; i++) {
+        operation(i);
+    }
+    var elapsed = new Date().getTime() - start;
+    print(name + ": " + (elapsed * 1000000 / ITERATIONS).toFixed(0) + " ns per call");
+}
+
+var a = { x: 1.0, y: 2.0, z: 3.0 };
+var b = { x: -3.0, y: 0.5, z: 2.0 };
+var rotation = Quat.fromPitchYawRollDegrees(10.0, 20.0, 30.0);
+var sum = { x: 0.0, y: 0.0, z: 0.0 };
+
+benchmark("Vec3.sum", function(i) { sum = Vec3.sum(sum, a); });
+benchmark("Vec3.multiply", function(i) { sum = Vec3.multiply(b, 0.5); });
+benchmark("Vec3.cross", function(i) { sum = Vec3.cross(a, b); });
+benchmark("Vec3.length", function(i) { Vec3.length(a); });
+benchmark("Vec3.normalize", function(i) { sum = Vec3.normalize(b); });
+benchmark("Quat.multiply", function(i) { rotation = Quat.multiply(rotation, rotation); });
+benchmark("Vec3.multiplyQbyV", function(i) { sum = Vec3.multiplyQbyV(rotation, a); });
+benchmark("Quat.getFront", function(i) { sum = Quat.getFront(rotation); });
+
+Script.stop();
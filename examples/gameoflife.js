@@ -103,6 +103,8 @@ function updateCells() {
 }
 
 function sendNextCells() {
+  // the changed cells are collected and sent in one call
+  var voxels = [];
   for (var i = 0; i < NUMBER_OF_CELLS_EACH_DIMENSION; i++) {
     for (var j = 0; j < NUMBER_OF_CELLS_EACH_DIMENSION; j++) {
       if (nextCells[i][j] != -1) {
@@ -112,12 +114,13 @@ function sendNextCells() {
         var x = j * cellScale;
         var y = i * cellScale;
 
-        // queue a packet to add a voxel for the new cell
+        // add a voxel for the new cell
         var color = (nextCells[i][j] == 1) ? 255 : 1;
-        Voxels.setVoxel(x, y, 0, cellScale, color, color, color);
+        voxels.push(x, y, 0, cellScale, color, color, color);
       }
     }
   } 
+  Voxels.setVoxels(voxels);
 }
 
 var sentFirstBoard = false;
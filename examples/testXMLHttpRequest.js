@@ -145,3 +145,45 @@ test("Test timeout", function() {
     this.assertEquals(0, req.status, "status should be `0`");
     this.assertEquals(4, req.errorCode, "4 is the timeout error code for QNetworkReply::NetworkError");
 });
+
+test("Test progress", function() {
+    var req = new XMLHttpRequest();
+    var lastLoaded = 0;
+    var progressed = true;
+    var loadingTextSeen = false;
+
+    req.onprogress = function(event) {
+        if (event.loaded < lastLoaded || (event.lengthComputable && event.loaded > event.total)) {
+            progressed = false;
+        }
+        lastLoaded = event.loaded;
+        loadingTextSeen = loadingTextSeen || req.responseText.length > 0;
+    };
+
+    req.open("GET", "https://gist.githubusercontent.com/huffman/33cc618fec183d1bccd0/raw/test.json", false);
+    req.send();
+
+    this.assertEquals(req.DONE, req.readyState, "readyState should be DONE");
+    this.assertEquals(true, progressed, "progress should only go forward");
+    this.assertEquals(req.responseText.length, lastLoaded, "the last progress should cover the whole response");
+    this.assertEquals(true, loadingTextSeen, "responseText should fill in while loading");
+});
+
+test("Test ARRAYBUFFER request", function() {
+    var req = new XMLHttpRequest();
+
+    req.responseType = "arraybuffer";
+    req.open("GET", "https://gist.githubusercontent.com/huffman/33cc618fec183d1bccd0/raw/test.json", false);
+    req.send();
+
+    this.assertEquals(req.DONE, req.readyState, "readyState should be DONE");
+    this.assertEquals(200, req.status, "status should be `200`");
+    var buffer = req.response;
+    this.assertEquals(9, buffer.byteLength, "the buffer should hold the bytes of the response");
+    this.assertEquals("{".charCodeAt(0), buffer.getUint8(0), "the first byte should be `{`");
+    this.assertEquals(0, buffer.getUint8(buffer.byteLength), "reads past the end should be 0");
+    this.assertEquals(('"'.charCodeAt(0) << 8) | "i".charCodeAt(0), buffer.getUint16(1), "reads should be big endian");
+    this.assertEquals('"id"', buffer.slice(1, 5).toString(), "a slice should hold its bytes");
+    this.assertEquals('{"id": 1}', buffer.toString());
+    this.assertEquals('{"id": 1}', req.responseText);
+});
@@ -0,0 +1,29 @@
+#version 120
+
+//
+//  instanced_primitive.vert
+//  vertex shader
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+// the transform from the primitive's space to the model's
+attribute mat4 instanceTransform;
+
+// the primitive's color from 0 to 1
+attribute vec4 instanceColor;
+
+void main(void) {
+    // the transforms are rotations and uniform scales, so the normals can go through them as they are
+    vec4 normal = normalize(gl_ModelViewMatrix * (instanceTransform * vec4(gl_Normal, 0.0)));
+    
+    // light as the fixed function pipeline does, with ambient and diffuse terms
+    vec4 light = gl_LightModel.ambient + gl_LightSource[0].ambient +
+        gl_LightSource[0].diffuse * max(0.0, dot(normal, gl_LightSource[0].position));
+    gl_FrontColor = vec4(instanceColor.rgb * light.rgb, instanceColor.a);
+    
+    gl_Position = gl_ModelViewProjectionMatrix * (instanceTransform * gl_Vertex);
+}
@@ -0,0 +1,30 @@
+#version 120
+
+//
+//  instanced_sphere.vert
+//  vertex shader
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+// the sphere's center and radius, in meters
+attribute vec4 instancePositionRadius;
+
+// the sphere's color from 0 to 255
+attribute vec4 instanceColor;
+
+void main(void) {
+    // the vertex is on the unit sphere, so it's also the normal
+    vec4 position = vec4(instancePositionRadius.xyz + gl_Vertex.xyz * instancePositionRadius.w, 1.0);
+    
+    // light as the fixed function pipeline does the glut spheres, with ambient and diffuse terms
+    vec4 color = vec4(instanceColor.rgb / 255.0, 1.0);
+    vec4 normal = normalize(gl_ModelViewMatrix * vec4(gl_Vertex.xyz, 0.0));
+    gl_FrontColor = color * (gl_LightModel.ambient + gl_LightSource[0].ambient +
+        gl_LightSource[0].diffuse * max(0.0, dot(normal, gl_LightSource[0].position)));
+    
+    gl_Position = gl_ModelViewProjectionMatrix * position;
+}
@@ -0,0 +1,31 @@
+#version 120
+
+//
+//  instanced_voxel.vert
+//  vertex shader
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+// the voxel's minimum corner, in tree units
+attribute vec3 instancePosition;
+
+// the voxel's color from 0 to 255, and its level in the tree
+attribute vec4 instanceColorLevel;
+
+void main(void) {
+    // the vertex is a corner of the unit cube, scaled to the voxel's size
+    float size = exp2(-instanceColorLevel.w);
+    vec4 position = vec4(instancePosition + gl_Vertex.xyz * size, 1.0);
+    
+    // light as the voxel shadow program does, with ambient and diffuse terms
+    vec4 color = vec4(instanceColorLevel.rgb / 255.0, 1.0);
+    vec4 normal = normalize(gl_ModelViewMatrix * vec4(gl_Normal, 0.0));
+    gl_FrontColor = color * (gl_LightModel.ambient + gl_LightSource[0].ambient +
+        gl_LightSource[0].diffuse * max(0.0, dot(normal, gl_LightSource[0].position)));
+    
+    gl_Position = gl_ModelViewProjectionMatrix * position;
+}
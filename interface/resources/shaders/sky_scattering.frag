@@ -0,0 +1,48 @@
+#version 120
+
+//
+//  sky_scattering.frag
+//  fragment shader
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+// the light scattered along the rays from the camera, by the cosines of their angles from up and from the sun
+uniform sampler2D scatteringTable;
+
+// the scale of the values in the table
+uniform float scatteringScale;
+
+// the camera's position relative to the atmosphere's center
+uniform vec3 cameraPosition;
+
+// the direction towards the sun
+uniform vec3 lightDirection;
+
+// the color of the Rayleigh scattering, and the brightness of the Mie
+uniform vec3 rayleighColor;
+uniform float mieBrightness;
+
+// the asymmetry of the Mie phase function and its square
+uniform float g;
+uniform float g2;
+
+// the position on the atmosphere's sphere, relative to its center
+varying vec3 position;
+
+void main(void) {
+    vec3 ray = normalize(position - cameraPosition);
+    float raySunCosine = dot(ray, lightDirection);
+    vec3 scattering = scatteringScale * texture2D(scatteringTable,
+        vec2(dot(ray, normalize(cameraPosition)), raySunCosine) * 0.5 + vec2(0.5, 0.5)).rgb;
+    
+    // the Mie phase peaks too sharply around the sun to be tabulated, so it's evaluated here (after Sean O'Neil's
+    // GPU Gems 2 chapter)
+    float cosine = -raySunCosine;
+    float miePhase = 1.5 * ((1.0 - g2) / (2.0 + g2)) * (1.0 + cosine * cosine) / pow(1.0 + g2 - 2.0 * g * cosine, 1.5);
+    vec3 color = scattering * rayleighColor + miePhase * mieBrightness * scattering;
+    gl_FragColor = vec4(pow(color, vec3(1.0 / 2.2)), color.b);
+}
@@ -0,0 +1,19 @@
+#version 120
+
+//
+//  sky_scattering.vert
+//  vertex shader
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+// the position on the atmosphere's sphere, relative to its center
+varying vec3 position;
+
+void main(void) {
+    position = gl_Vertex.xyz;
+    gl_Position = gl_ModelViewProjectionMatrix * gl_Vertex;
+}
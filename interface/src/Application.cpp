@@ -33,7 +33,6 @@
 #include <QMenuBar>
 #include <QMouseEvent>
 #include <QNetworkReply>
-#include <QNetworkDiskCache>
 #include <QOpenGLFramebufferObject>
 #include <QObject>
 #include <QWheelEvent>
@@ -73,6 +72,7 @@
 #include "devices/MIDIManager.h"
 #include "devices/OculusManager.h"
 #include "devices/TV3DManager.h"
+#include "renderer/GpuTimer.h"
 #include "renderer/ProgramObject.h"
 
 #include "scripting/AccountScriptingInterface.h"
@@ -110,6 +110,18 @@ const QString SKIP_FILENAME = QStandardPaths::writableLocation(QStandardPaths::D
 
 const QString DEFAULT_SCRIPTS_JS_URL = "http://public.highfidelity.io/scripts/defaultScripts.js";
 
+#if QT_VERSION >= QT_VERSION_CHECK(5, 8, 0)
+// over HTTP/2 the downloads from a host share one connection, so more of them can be in flight
+const int INTERFACE_REQUEST_LIMIT = 10;
+#else
+const int INTERFACE_REQUEST_LIMIT = 3;
+#endif
+
+// what the caches keep loaded of the models, textures and animations that nothing is using any more
+const qint64 UNUSED_GEOMETRY_MAX_BYTES = 256 * 1024 * 1024;
+const qint64 UNUSED_TEXTURES_MAX_BYTES = 256 * 1024 * 1024;
+const qint64 UNUSED_ANIMATIONS_MAX_BYTES = 64 * 1024 * 1024;
+
 void messageHandler(QtMsgType type, const QMessageLogContext& context, const QString& message) {
     if (message.size() > 0) {
         QString dateString = QDateTime::currentDateTime().toTimeSpec(Qt::LocalTime).toString(Qt::ISODate);
@@ -138,9 +150,13 @@ Application::Application(int& argc, char** argv, QElapsedTimer &startup_time) :
         _frameCount(0),
         _fps(60.0f),
         _justStarted(true),
+        _startupScriptsPending(true),
         _voxelImporter(NULL),
+        _voxelExporter(NULL),
         _importSucceded(false),
+        _clipboardCopiedAt(0),
         _sharedVoxelSystem(TREE_SCALE, DEFAULT_MAX_VOXELS_PER_SYSTEM, &_clipboard),
+        _updateJobs("idle/update"),
         _wantToKillLocalVoxels(false),
         _viewFrustum(),
         _lastQueriedViewFrustum(),
@@ -150,6 +166,8 @@ Application::Application(int& argc, char** argv, QElapsedTimer &startup_time) :
         _scaleMirror(1.0f),
         _rotateMirror(0.0f),
         _raiseMirror(0.0f),
+        _shadowFrame(0),
+        _shadowCascadeCount(0),
         _mouseX(0),
         _mouseY(0),
         _lastMouseMove(usecTimestampNow()),
@@ -162,8 +180,11 @@ Application::Application(int& argc, char** argv, QElapsedTimer &startup_time) :
         _mousePressed(false),
         _audio(STARTUP_JITTER_SAMPLES),
         _enableProcessVoxelsThread(true),
-        _octreeProcessor(),
+        _voxelPacketProcessor(NodeType::VoxelServer),
+        _particlePacketProcessor(NodeType::ParticleServer),
+        _modelPacketProcessor(NodeType::ModelServer),
         _voxelHideShowThread(&_voxels),
+        _voxelPaster(_voxelEditSender),
         _packetsPerSecond(0),
         _bytesPerSecond(0),
         _nodeBoundsDisplay(this),
@@ -313,14 +334,12 @@ Application::Application(int& argc, char** argv, QElapsedTimer &startup_time) :
     connect(billboardPacketTimer, &QTimer::timeout, _myAvatar, &MyAvatar::sendBillboardPacket);
     billboardPacketTimer->start(AVATAR_BILLBOARD_PACKET_SEND_INTERVAL_MSECS);
 
-    QString cachePath = QStandardPaths::writableLocation(QStandardPaths::DataLocation);
-
-    NetworkAccessManager& networkAccessManager = NetworkAccessManager::getInstance();
-    QNetworkDiskCache* cache = new QNetworkDiskCache();
-    cache->setCacheDirectory(!cachePath.isEmpty() ? cachePath : "interfaceCache");
-    networkAccessManager.setCache(cache);
+    NetworkAccessManager::getInstance().setupDiskCache("interfaceCache");
 
-    ResourceCache::setRequestLimit(3);
+    ResourceCache::setRequestLimit(INTERFACE_REQUEST_LIMIT);
+    _geometryCache.setUnusedResourcesMaxBytes(UNUSED_GEOMETRY_MAX_BYTES);
+    _textureCache.setUnusedResourcesMaxBytes(UNUSED_TEXTURES_MAX_BYTES);
+    _animationCache.setUnusedResourcesMaxBytes(UNUSED_ANIMATIONS_MAX_BYTES);
 
     _window->setCentralWidget(_glWidget);
 
@@ -368,24 +387,6 @@ Application::Application(int& argc, char** argv, QElapsedTimer &startup_time) :
     _runningScriptsWidget->setRunningScripts(getRunningScripts());
     connect(_runningScriptsWidget, &RunningScriptsWidget::stopScriptName, this, &Application::stopScript);
 
-    // check first run...
-    QVariant firstRunValue = _settings->value("firstRun",QVariant(true));
-    if (firstRunValue.isValid() && firstRunValue.toBool()) {
-        qDebug() << "This is a first run...";
-        // clear the scripts, and set out script to our default scripts
-        clearScriptsBeforeRunning();
-        loadScript(DEFAULT_SCRIPTS_JS_URL);
-
-        QMutexLocker locker(&_settingsMutex);
-        _settings->setValue("firstRun",QVariant(false));
-    } else {
-        // do this as late as possible so that all required subsystems are inialized
-        loadScripts();
-
-        QMutexLocker locker(&_settingsMutex);
-        _previousScriptLocation = _settings->value("LastScriptLocation", QVariant("")).toString();
-    }
-
     connect(_window, &MainWindow::windowGeometryChanged,
             _runningScriptsWidget, &RunningScriptsWidget::setBoundary);
 
@@ -421,6 +422,7 @@ Application::~Application() {
     
     _sharedVoxelSystem.changeTree(new VoxelTree);
     delete _voxelImporter;
+    delete _voxelExporter;
 
     // let the avatar mixer know we're out
     MyAvatar::sendKillAvatar();
@@ -436,7 +438,9 @@ Application::~Application() {
     _audio.thread()->quit();
     _audio.thread()->wait();
 
-    _octreeProcessor.terminate();
+    _voxelPacketProcessor.terminate();
+    _particlePacketProcessor.terminate();
+    _modelPacketProcessor.terminate();
     _voxelHideShowThread.terminate();
     _voxelEditSender.terminate();
     _particleEditSender.terminate();
@@ -530,8 +534,11 @@ void Application::initializeGL() {
     init();
     qDebug( "init() complete.");
 
-    // create thread for parsing of voxel data independent of the main network and rendering threads
-    _octreeProcessor.initialize(_enableProcessVoxelsThread);
+    // create threads for parsing of voxel, particle and model data independent of the main network and rendering
+    // threads, and of each other
+    _voxelPacketProcessor.initialize(_enableProcessVoxelsThread);
+    _particlePacketProcessor.initialize(_enableProcessVoxelsThread);
+    _modelPacketProcessor.initialize(_enableProcessVoxelsThread);
     _voxelEditSender.initialize(_enableProcessVoxelsThread);
     _voxelHideShowThread.initialize(_enableProcessVoxelsThread);
     _particleEditSender.initialize(_enableProcessVoxelsThread);
@@ -569,7 +576,11 @@ void Application::initializeGL() {
 }
 
 void Application::paintGL() {
-    PerformanceTimer perfTimer("paintGL");
+    // record the GPU times of the frames that have finished since the last, before timing this one
+    GpuTimer::resolveQueries(Menu::getInstance()->isOptionChecked(MenuOption::GpuTiming));
+
+    PERFORMANCE_TIMER("paintGL");
+    GpuTimer gpuTimer("paintGL");
 
     PerformanceWarning::setSuppressShortTimings(Menu::getInstance()->isOptionChecked(MenuOption::SuppressShortTimings));
     bool showWarnings = Menu::getInstance()->isOptionChecked(MenuOption::PipelineWarnings);
@@ -577,6 +588,9 @@ void Application::paintGL() {
 
     const bool glowEnabled = Menu::getInstance()->isOptionChecked(MenuOption::EnableGlowEffect);
 
+    // spread the uploads of newly loaded textures over frames
+    _textureCache.uploadPendingTextures();
+
     // Set the desired FBO texture size. If it hasn't changed, this does nothing.
     // Otherwise, it must rebuild the FBOs
     if (OculusManager::isConnected()) {
@@ -695,7 +709,8 @@ void Application::paintGL() {
         }
 
         {
-            PerformanceTimer perfTimer("paintGL/renderOverlay");
+            PERFORMANCE_TIMER("paintGL/renderOverlay");
+            GpuTimer gpuTimer("paintGL/renderOverlay");
             // PrioVR will only work if renderOverlay is called, calibration is connected to Application::renderingOverlay() 
             _applicationOverlay.renderOverlay(true);
             if (Menu::getInstance()->isOptionChecked(MenuOption::UserInterface)) {
@@ -704,9 +719,38 @@ void Application::paintGL() {
         }
     }
 
+    // read back for snapshots and captures once the frame is complete
+    _frameCapture.frameFinished(_glWidget->width(), _glWidget->height());
+
+    // the scripts start once the first frame is up, rather than holding it up
+    if (_startupScriptsPending) {
+        _startupScriptsPending = false;
+        QMetaObject::invokeMethod(this, "loadStartupScripts", Qt::QueuedConnection);
+    }
+
     _frameCount++;
 }
 
+void Application::loadStartupScripts() {
+    // check first run...
+    QVariant firstRunValue = _settings->value("firstRun",QVariant(true));
+    if (firstRunValue.isValid() && firstRunValue.toBool()) {
+        qDebug() << "This is a first run...";
+        // clear the scripts, and set out script to our default scripts
+        clearScriptsBeforeRunning();
+        loadScript(DEFAULT_SCRIPTS_JS_URL);
+
+        QMutexLocker locker(&_settingsMutex);
+        _settings->setValue("firstRun",QVariant(false));
+    } else {
+        // do this as late as possible so that all required subsystems are inialized
+        loadScripts();
+
+        QMutexLocker locker(&_settingsMutex);
+        _previousScriptLocation = _settings->value("LastScriptLocation", QVariant("")).toString();
+    }
+}
+
 void Application::resetCamerasOnResizeGL(Camera& camera, int width, int height) {
     if (OculusManager::isConnected()) {
         OculusManager::configureCamera(camera, width, height);
@@ -1355,7 +1399,7 @@ void Application::timer() {
 }
 
 void Application::idle() {
-    PerformanceTimer perfTimer("idle");
+    PERFORMANCE_TIMER("idle");
 
     // Normally we check PipelineWarnings, but since idle will often take more than 10ms we only show these idle timing
     // details if we're in ExtraDebugging mode. However, the ::update() and it's subcomponents will show their timing
@@ -1369,18 +1413,18 @@ void Application::idle() {
     if (timeSinceLastUpdate > IDLE_SIMULATE_MSECS) {
         _lastTimeUpdated.start();
         {
-            PerformanceTimer perfTimer("idle/update");
+            PERFORMANCE_TIMER("idle/update");
             PerformanceWarning warn(showWarnings, "Application::idle()... update()");
             const float BIGGEST_DELTA_TIME_SECS = 0.25f;
             update(glm::clamp((float)timeSinceLastUpdate / 1000.f, 0.f, BIGGEST_DELTA_TIME_SECS));
         }
         {
-            PerformanceTimer perfTimer("idle/updateGL");
+            PERFORMANCE_TIMER("idle/updateGL");
             PerformanceWarning warn(showWarnings, "Application::idle()... updateGL()");
             _glWidget->updateGL();
         }
         {
-            PerformanceTimer perfTimer("idle/rest");
+            PERFORMANCE_TIMER("idle/rest");
             PerformanceWarning warn(showWarnings, "Application::idle()... rest of it");
             _idleLoopStdev.addValue(timeSinceLastUpdate);
 
@@ -1392,7 +1436,7 @@ void Application::idle() {
             }
 
             if (Menu::getInstance()->isOptionChecked(MenuOption::BuckyBalls)) {
-                PerformanceTimer perfTimer("idle/rest/_buckyBalls");
+                PERFORMANCE_TIMER("idle/rest/_buckyBalls");
                 _buckyBalls.simulate(timeSinceLastUpdate / 1000.f, Application::getInstance()->getAvatar()->getHandData());
             }
 
@@ -1496,60 +1540,18 @@ FaceTracker* Application::getActiveFaceTracker() {
             (_visage.isActive() ? static_cast<FaceTracker*>(&_visage) : NULL));
 }
 
-struct SendVoxelsOperationArgs {
-    const unsigned char*  newBaseOctCode;
-};
-
-bool Application::sendVoxelsOperation(OctreeElement* element, void* extraData) {
-    VoxelTreeElement* voxel = (VoxelTreeElement*)element;
-    SendVoxelsOperationArgs* args = (SendVoxelsOperationArgs*)extraData;
-    if (voxel->isColored()) {
-        const unsigned char* nodeOctalCode = voxel->getOctalCode();
-        unsigned char* codeColorBuffer = NULL;
-        int codeLength  = 0;
-        int bytesInCode = 0;
-        int codeAndColorLength;
-
-        // If the newBase is NULL, then don't rebase
-        if (args->newBaseOctCode) {
-            codeColorBuffer = rebaseOctalCode(nodeOctalCode, args->newBaseOctCode, true);
-            codeLength  = numberOfThreeBitSectionsInCode(codeColorBuffer);
-            bytesInCode = bytesRequiredForCodeLength(codeLength);
-            codeAndColorLength = bytesInCode + SIZE_OF_COLOR_DATA;
-        } else {
-            codeLength  = numberOfThreeBitSectionsInCode(nodeOctalCode);
-            bytesInCode = bytesRequiredForCodeLength(codeLength);
-            codeAndColorLength = bytesInCode + SIZE_OF_COLOR_DATA;
-            codeColorBuffer = new unsigned char[codeAndColorLength];
-            memcpy(codeColorBuffer, nodeOctalCode, bytesInCode);
-        }
-
-        // copy the colors over
-        codeColorBuffer[bytesInCode + RED_INDEX] = voxel->getColor()[RED_INDEX];
-        codeColorBuffer[bytesInCode + GREEN_INDEX] = voxel->getColor()[GREEN_INDEX];
-        codeColorBuffer[bytesInCode + BLUE_INDEX] = voxel->getColor()[BLUE_INDEX];
-        getInstance()->_voxelEditSender.queueVoxelEditMessage(PacketTypeVoxelSetDestructive,
-                codeColorBuffer, codeAndColorLength);
-
-        delete[] codeColorBuffer;
-    }
-    return true; // keep going
-}
-
 void Application::exportVoxels(const VoxelDetail& sourceVoxel) {
     QString desktopLocation = QStandardPaths::writableLocation(QStandardPaths::DesktopLocation);
     QString suggestedName = desktopLocation.append("/voxels.svo");
 
     QString fileNameString = QFileDialog::getSaveFileName(_glWidget, tr("Export Voxels"), suggestedName,
                                                           tr("Sparse Voxel Octree Files (*.svo)"));
-    QByteArray fileNameAscii = fileNameString.toLocal8Bit();
-    const char* fileName = fileNameAscii.data();
-
-    VoxelTreeElement* selectedNode = _voxels.getTree()->getVoxelAt(sourceVoxel.x, sourceVoxel.y, sourceVoxel.z, sourceVoxel.s);
-    if (selectedNode) {
-        VoxelTree exportTree;
-        getVoxelTree()->copySubTreeIntoNewTree(selectedNode, &exportTree, true);
-        exportTree.writeToSVOFile(fileName);
+    if (!fileNameString.isEmpty()) {
+        if (!_voxelExporter) {
+            _voxelExporter = new VoxelExporter(_window);
+        }
+        // only the snapshot is taken here; the file is written on the thread pool
+        _voxelExporter->exportVoxels(_voxels.getTree(), sourceVoxel, fileNameString);
     }
 
     // restore the main window's active state
@@ -1559,6 +1561,9 @@ void Application::exportVoxels(const VoxelDetail& sourceVoxel) {
 void Application::importVoxels() {
     _importSucceded = false;
 
+    // the import replaces the tree a paste may still be sending from
+    updatePaste(true);
+
     if (!_voxelImporter) {
         _voxelImporter = new VoxelImporter(_window);
         _voxelImporter->loadSettings(_settings);
@@ -1587,6 +1592,9 @@ void Application::cutVoxels(const VoxelDetail& sourceVoxel) {
 }
 
 void Application::copyVoxels(const VoxelDetail& sourceVoxel) {
+    // the clipboard may still be being pasted
+    updatePaste(true);
+
     // switch to and clear the clipboard first...
     _sharedVoxelSystem.killLocalVoxels();
     if (_sharedVoxelSystem.getTree() != &_clipboard) {
@@ -1596,26 +1604,55 @@ void Application::copyVoxels(const VoxelDetail& sourceVoxel) {
 
     // then copy onto it if there is something to copy
     VoxelTreeElement* selectedNode = _voxels.getTree()->getVoxelAt(sourceVoxel.x, sourceVoxel.y, sourceVoxel.z, sourceVoxel.s);
+    _clipboardSourceOctalCode.clear();
     if (selectedNode) {
         getVoxelTree()->copySubTreeIntoNewTree(selectedNode, _sharedVoxelSystem.getTree(), true);
         _sharedVoxelSystem.forceRedrawEntireTree();
+
+        // remembered so that a paste of voxels that are still the same can be copied by the server itself
+        const unsigned char* octalCode = selectedNode->getOctalCode();
+        _clipboardSourceOctalCode = QByteArray(reinterpret_cast<const char*>(octalCode),
+            bytesRequiredForCodeLength(numberOfThreeBitSectionsInCode(octalCode)));
+        _clipboardCopiedAt = usecTimestampNow();
     }
 }
 
 void Application::pasteVoxelsToOctalCode(const unsigned char* octalCodeDestination) {
-    // Recurse the clipboard tree, where everything is root relative, and send all the colored voxels to
-    // the server as an set voxel message, this will also rebase the voxels to the new location
-    SendVoxelsOperationArgs args;
-    args.newBaseOctCode = octalCodeDestination;
-    _sharedVoxelSystem.getTree()->recurseTreeWithOperation(sendVoxelsOperation, &args);
+    // Send the colored leaves of the clipboard tree, where everything is root relative, to the server as set voxel
+    // messages rebased to the new location. The paster sends them over the next frames as the sender has room.
+    updatePaste(true);
 
-    // Switch back to clipboard if it was an import
-    if (_sharedVoxelSystem.getTree() != &_clipboard) {
+    // a clipboard copied from voxels that haven't changed since is copied by the server, in one message
+    if (octalCodeDestination && _sharedVoxelSystem.getTree() == &_clipboard && !_clipboardSourceOctalCode.isEmpty()) {
+        const unsigned char* sourceOctalCode = reinterpret_cast<const unsigned char*>(_clipboardSourceOctalCode.constData());
+        VoxelPositionSize source;
+        voxelDetailsForCode(sourceOctalCode, source);
+        VoxelTreeElement* sourceNode = _voxels.getTree()->getVoxelAt(source.x, source.y, source.z, source.s);
+        if (sourceNode && !sourceNode->hasChangedInSubtreeSince(_clipboardCopiedAt)
+                && _voxelEditSender.queueSubtreeCopyMessage(sourceOctalCode, octalCodeDestination, false)) {
+            _voxelEditSender.releaseQueuedMessages();
+            return;
+        }
+    }
+    _voxelPaster.start(_sharedVoxelSystem.getTree(), octalCodeDestination);
+    updatePaste();
+}
+
+void Application::updatePaste(bool finish) {
+    if (!_voxelPaster.isPasting()) {
+        return;
+    }
+    if (finish) {
+        _voxelPaster.finish();
+    } else {
+        _voxelPaster.update();
+    }
+
+    // Switch back to clipboard if it was an import, once its voxels are all sent
+    if (!_voxelPaster.isPasting() && _sharedVoxelSystem.getTree() != &_clipboard) {
         _sharedVoxelSystem.killLocalVoxels();
         _sharedVoxelSystem.changeTree(&_clipboard);
     }
-
-    _voxelEditSender.releaseQueuedMessages();
 }
 
 void Application::pasteVoxels(const VoxelDetail& sourceVoxel) {
@@ -1641,9 +1678,28 @@ void Application::pasteVoxels(const VoxelDetail& sourceVoxel) {
 
 void Application::nudgeVoxelsByVector(const VoxelDetail& sourceVoxel, const glm::vec3& nudgeVec) {
     VoxelTreeElement* nodeToNudge = _voxels.getTree()->getVoxelAt(sourceVoxel.x, sourceVoxel.y, sourceVoxel.z, sourceVoxel.s);
-    if (nodeToNudge) {
-        _voxels.getTree()->nudgeSubTree(nodeToNudge, nudgeVec, _voxelEditSender);
+    if (!nodeToNudge) {
+        return;
     }
+
+    // a nudge by whole voxels moves the subtree to another voxel, which the server can do in one message
+    const float WHOLE_VOXEL_EPSILON = 0.001f;
+    VoxelPositionSize source;
+    voxelDetailsForCode(nodeToNudge->getOctalCode(), source);
+    glm::vec3 voxelsNudged = nudgeVec / source.s;
+    glm::vec3 destination = glm::vec3(source.x, source.y, source.z) + glm::round(voxelsNudged) * source.s;
+    if (glm::all(glm::lessThan(glm::abs(voxelsNudged - glm::round(voxelsNudged)), glm::vec3(WHOLE_VOXEL_EPSILON))) &&
+            glm::all(glm::greaterThanEqual(destination, glm::vec3(0.0f))) &&
+            glm::all(glm::lessThanEqual(destination + source.s, glm::vec3(1.0f)))) {
+        unsigned char* destinationOctalCode = pointToVoxel(destination.x, destination.y, destination.z, source.s);
+        bool sent = _voxelEditSender.queueSubtreeCopyMessage(nodeToNudge->getOctalCode(), destinationOctalCode, true);
+        delete[] destinationOctalCode;
+        if (sent) {
+            _voxelEditSender.releaseQueuedMessages();
+            return;
+        }
+    }
+    _voxels.getTree()->nudgeSubTree(nodeToNudge, nudgeVec, _voxelEditSender);
 }
 
 void Application::initDisplay() {
@@ -1726,6 +1782,8 @@ void Application::init() {
     // Set up VoxelSystem after loading preferences so we can get the desired max voxel count
     _voxels.setMaxVoxels(Menu::getInstance()->getMaxVoxels());
     _voxels.setUseVoxelShader(false);
+    _voxels.setUseChunkedMeshes(Menu::getInstance()->isOptionChecked(MenuOption::ChunkedVoxelMeshes));
+    _voxels.setUseInstancedVoxels(Menu::getInstance()->isOptionChecked(MenuOption::InstancedVoxels));
     _voxels.setVoxelsAsPoints(false);
     _voxels.setDisableFastVoxelPipeline(false);
     _voxels.init();
@@ -1747,6 +1805,16 @@ void Application::init() {
     connect(&_particleCollisionSystem, &ParticleCollisionSystem::particleCollisionWithParticle,
             ScriptEngine::getParticlesScriptingInterface(), &ParticlesScriptingInterface::particleCollisionWithParticle);
 
+    // the models are updated alongside the particles, which stay on this thread: their collisions are signaled to the
+    // scripting interface, and their scripts send edits through the senders that the user's edits go through
+    int particlesJob = _updateJobs.addJob("_particles", this, &Application::updateParticles);
+    int particleCollisionsJob = _updateJobs.addJob("_particleCollisionSystem", this,
+        &Application::updateParticleCollisions);
+    _updateJobs.addJob("_models", this, &Application::updateModels);
+    _updateJobs.setRunsOnCallingThread(particlesJob);
+    _updateJobs.setRunsOnCallingThread(particleCollisionsJob);
+    _updateJobs.addPrerequisite(particleCollisionsJob, particlesJob);
+
     _audio.init(_glWidget);
 
     _rearMirrorTools = new RearMirrorTools(_glWidget, _mirrorViewRect, _settings);
@@ -1810,7 +1878,7 @@ bool Application::isLookingAtMyAvatar(Avatar* avatar) {
 }
 
 void Application::updateLOD() {
-    PerformanceTimer perfTimer("idle/update/updateLOD");
+    PERFORMANCE_TIMER("idle/update/updateLOD");
     // adjust it unless we were asked to disable this feature, or if we're currently in throttleRendering mode
     if (!Menu::getInstance()->isOptionChecked(MenuOption::DisableAutoAdjustLOD) && !isThrottleRendering()) {
         Menu::getInstance()->autoAdjustLOD(_fps);
@@ -1820,7 +1888,7 @@ void Application::updateLOD() {
 }
 
 void Application::updateMouseRay() {
-    PerformanceTimer perfTimer("idle/update/updateMouseRay");
+    PERFORMANCE_TIMER("idle/update/updateMouseRay");
 
     bool showWarnings = Menu::getInstance()->isOptionChecked(MenuOption::PipelineWarnings);
     PerformanceWarning warn(showWarnings, "Application::updateMouseRay()");
@@ -1853,7 +1921,7 @@ void Application::updateMouseRay() {
 }
 
 void Application::updateFaceshift() {
-    PerformanceTimer perfTimer("idle/update/updateFaceshift");
+    PERFORMANCE_TIMER("idle/update/updateFaceshift");
 
     bool showWarnings = Menu::getInstance()->isOptionChecked(MenuOption::PipelineWarnings);
     PerformanceWarning warn(showWarnings, "Application::updateFaceshift()");
@@ -1868,7 +1936,7 @@ void Application::updateFaceshift() {
 }
 
 void Application::updateVisage() {
-    PerformanceTimer perfTimer("idle/update/updateVisage");
+    PERFORMANCE_TIMER("idle/update/updateVisage");
 
     bool showWarnings = Menu::getInstance()->isOptionChecked(MenuOption::PipelineWarnings);
     PerformanceWarning warn(showWarnings, "Application::updateVisage()");
@@ -1878,7 +1946,7 @@ void Application::updateVisage() {
 }
 
 void Application::updateMyAvatarLookAtPosition() {
-    PerformanceTimer perfTimer("idle/update/updateMyAvatarLookAtPosition");
+    PERFORMANCE_TIMER("idle/update/updateMyAvatarLookAtPosition");
 
     bool showWarnings = Menu::getInstance()->isOptionChecked(MenuOption::PipelineWarnings);
     PerformanceWarning warn(showWarnings, "Application::updateMyAvatarLookAtPosition()");
@@ -1945,13 +2013,15 @@ void Application::updateMyAvatarLookAtPosition() {
 }
 
 void Application::updateThreads(float deltaTime) {
-    PerformanceTimer perfTimer("idle/update/updateThreads");
+    PERFORMANCE_TIMER("idle/update/updateThreads");
     bool showWarnings = Menu::getInstance()->isOptionChecked(MenuOption::PipelineWarnings);
     PerformanceWarning warn(showWarnings, "Application::updateThreads()");
 
     // parse voxel packets
     if (!_enableProcessVoxelsThread) {
-        _octreeProcessor.threadRoutine();
+        _voxelPacketProcessor.threadRoutine();
+        _particlePacketProcessor.threadRoutine();
+        _modelPacketProcessor.threadRoutine();
         _voxelHideShowThread.threadRoutine();
         _voxelEditSender.threadRoutine();
         _particleEditSender.threadRoutine();
@@ -1960,7 +2030,7 @@ void Application::updateThreads(float deltaTime) {
 }
 
 void Application::updateMetavoxels(float deltaTime) {
-    PerformanceTimer perfTimer("idle/update/updateMetavoxels");
+    PERFORMANCE_TIMER("idle/update/updateMetavoxels");
     bool showWarnings = Menu::getInstance()->isOptionChecked(MenuOption::PipelineWarnings);
     PerformanceWarning warn(showWarnings, "Application::updateMetavoxels()");
 
@@ -1990,7 +2060,7 @@ void Application::cameraMenuChanged() {
 }
 
 void Application::updateCamera(float deltaTime) {
-    PerformanceTimer perfTimer("idle/update/updateCamera");
+    PERFORMANCE_TIMER("idle/update/updateCamera");
     bool showWarnings = Menu::getInstance()->isOptionChecked(MenuOption::PipelineWarnings);
     PerformanceWarning warn(showWarnings, "Application::updateCamera()");
 
@@ -2008,7 +2078,7 @@ void Application::updateCamera(float deltaTime) {
 }
 
 void Application::updateDialogs(float deltaTime) {
-    PerformanceTimer perfTimer("idle/update/updateDialogs");
+    PERFORMANCE_TIMER("idle/update/updateDialogs");
     bool showWarnings = Menu::getInstance()->isOptionChecked(MenuOption::PipelineWarnings);
     PerformanceWarning warn(showWarnings, "Application::updateDialogs()");
 
@@ -2025,7 +2095,7 @@ void Application::updateDialogs(float deltaTime) {
 }
 
 void Application::updateCursor(float deltaTime) {
-    PerformanceTimer perfTimer("idle/update/updateCursor");
+    PERFORMANCE_TIMER("idle/update/updateCursor");
     bool showWarnings = Menu::getInstance()->isOptionChecked(MenuOption::PipelineWarnings);
     PerformanceWarning warn(showWarnings, "Application::updateCursor()");
 
@@ -2061,26 +2131,27 @@ void Application::update(float deltaTime) {
     updateVisage();
 
     {
-        PerformanceTimer perfTimer("idle/update/updateLookAtTargetAvatar");
+        PERFORMANCE_TIMER("idle/update/updateLookAtTargetAvatar");
         _myAvatar->updateLookAtTargetAvatar();
     }
     updateMyAvatarLookAtPosition();
     {
-        PerformanceTimer perfTimer("idle/update/sixense,joystick,prioVR");
+        PERFORMANCE_TIMER("idle/update/sixense,joystick,prioVR");
         _sixenseManager.update(deltaTime);
         _joystickManager.update();
         _prioVR.update(deltaTime);
     }
     
     {
-        PerformanceTimer perfTimer("idle/update/updateMyAvatar");
+        PERFORMANCE_TIMER("idle/update/updateMyAvatar");
         updateMyAvatar(deltaTime); // Sample hardware, update view frustum if needed, and send avatar data to mixer/nodes
     }
     
     updateThreads(deltaTime); // If running non-threaded, then give the threads some time to process...
+    updatePaste(); // send the next voxels of a paste in progress
     
     {
-        PerformanceTimer perfTimer("idle/update/_avatarManager");
+        PERFORMANCE_TIMER("idle/update/_avatarManager");
         _avatarManager.updateOtherAvatars(deltaTime); //loop through all the other avatars and simulate them...
     }
     updateMetavoxels(deltaTime); // update metavoxels
@@ -2088,45 +2159,46 @@ void Application::update(float deltaTime) {
     updateDialogs(deltaTime); // update various stats dialogs if present
     updateCursor(deltaTime); // Handle cursor updates
 
-    {
-        PerformanceTimer perfTimer("idle/update/_particles");
-        _particles.update(); // update the particles...
-    }
-    {
-        PerformanceTimer perfTimer("idle/update/_particleCollisionSystem");
-        _particleCollisionSystem.update(); // collide the particles...
-    }
-
-    {
-        PerformanceTimer perfTimer("idle/update/_models");
-        _models.update(); // update the models...
-    }
+    // update and collide the particles, and update the models
+    _updateJobs.run();
 
     {
-        PerformanceTimer perfTimer("idle/update/_overlays");
+        PERFORMANCE_TIMER("idle/update/_overlays");
         _overlays.update(deltaTime);
     }
 
     {
-        PerformanceTimer perfTimer("idle/update/emit simulating");
+        PERFORMANCE_TIMER("idle/update/emit simulating");
         // let external parties know we're updating
         emit simulating(deltaTime);
     }
 }
 
+void Application::updateParticles() {
+    _particles.update();
+}
+
+void Application::updateParticleCollisions() {
+    _particleCollisionSystem.update();
+}
+
+void Application::updateModels() {
+    _models.update();
+}
+
 void Application::updateMyAvatar(float deltaTime) {
-    PerformanceTimer perfTimer("updateMyAvatar");
+    PERFORMANCE_TIMER("updateMyAvatar");
     bool showWarnings = Menu::getInstance()->isOptionChecked(MenuOption::PipelineWarnings);
     PerformanceWarning warn(showWarnings, "Application::updateMyAvatar()");
 
     {
-        PerformanceTimer perfTimer("updateMyAvatar/_myAvatar->update()");
+        PERFORMANCE_TIMER("updateMyAvatar/_myAvatar->update()");
         _myAvatar->update(deltaTime);
     }
 
     {
         // send head/hand data to the avatar mixer and voxel server
-        PerformanceTimer perfTimer("updateMyAvatar/sendToAvatarMixer");
+        PERFORMANCE_TIMER("updateMyAvatar/sendToAvatarMixer");
         QByteArray packet = byteArrayWithPopulatedHeader(PacketTypeAvatarData);
         packet.append(_myAvatar->toByteArray());
         controlledBroadcastToNodes(packet, NodeSet() << NodeType::AvatarMixer);
@@ -2139,13 +2211,13 @@ void Application::updateMyAvatar(float deltaTime) {
     // actually need to calculate the view frustum planes to send these details
     // to the server.
     {
-        PerformanceTimer perfTimer("updateMyAvatar/loadViewFrustum");
+        PERFORMANCE_TIMER("updateMyAvatar/loadViewFrustum");
         loadViewFrustum(_myCamera, _viewFrustum);
     }
 
     // Update my voxel servers with my current voxel query...
     {
-        PerformanceTimer perfTimer("updateMyAvatar/queryOctree");
+        PERFORMANCE_TIMER("updateMyAvatar/queryOctree");
         quint64 now = usecTimestampNow();
         quint64 sinceLastQuery = now - _lastQueriedTime;
         const quint64 TOO_LONG_SINCE_LAST_QUERY = 3 * USECS_PER_SECOND;
@@ -2153,20 +2225,24 @@ void Application::updateMyAvatar(float deltaTime) {
         bool viewIsDifferentEnough = !_lastQueriedViewFrustum.isVerySimilar(_viewFrustum);
 
         // if it's been a while since our last query or the view has significantly changed then send a query, otherwise suppress it
+        // (the periodic queries are sent as keyframes, in case a server has lost the one it acknowledged)
         if (queryIsDue || viewIsDifferentEnough) {
             _lastQueriedTime = now;
-            queryOctree(NodeType::VoxelServer, PacketTypeVoxelQuery, _voxelServerJurisdictions);
-            queryOctree(NodeType::ParticleServer, PacketTypeParticleQuery, _particleServerJurisdictions);
-            queryOctree(NodeType::ModelServer, PacketTypeModelQuery, _modelServerJurisdictions);
+            queryOctree(NodeType::VoxelServer, PacketTypeVoxelQuery, _voxelServerJurisdictions,
+                viewIsDifferentEnough, queryIsDue);
+            queryOctree(NodeType::ParticleServer, PacketTypeParticleQuery, _particleServerJurisdictions,
+                viewIsDifferentEnough, queryIsDue);
+            queryOctree(NodeType::ModelServer, PacketTypeModelQuery, _modelServerJurisdictions,
+                viewIsDifferentEnough, queryIsDue);
             _lastQueriedViewFrustum = _viewFrustum;
         }
     }
 
-    // sent nack packets containing missing sequence numbers of received packets from nodes
+    // send ack packets to the octree servers with the missing sequence numbers of the packets received from them
     {
         quint64 now = usecTimestampNow();
         quint64 sinceLastNack = now - _lastNackTime;
-        const quint64 TOO_LONG_SINCE_LAST_NACK = 1 * USECS_PER_SECOND;
+        const quint64 TOO_LONG_SINCE_LAST_NACK = 250 * USECS_PER_MSEC;
         if (sinceLastNack > TOO_LONG_SINCE_LAST_NACK) {
             _lastNackTime = now;
             sendNackPackets();
@@ -2196,11 +2272,11 @@ int Application::sendNackPackets() {
 
             // if there are octree packets from this node that are waiting to be processed,
             // don't send a NACK since the missing packets may be among those waiting packets.
-            if (_octreeProcessor.hasPacketsToProcessFrom(nodeUUID)) {
+            if (getOctreePacketProcessor(node->getType()).hasPacketsToProcessFrom(nodeUUID)) {
                 continue;
             }
             
-            _octreeSceneStatsLock.lockForRead();
+            _octreeSceneStatsLock.lockForWrite();
 
             // retreive octree scene stats of this node
             if (_octreeServerSceneStats.find(nodeUUID) == _octreeServerSceneStats.end()) {
@@ -2208,45 +2284,15 @@ int Application::sendNackPackets() {
                 continue;
             }
 
-            // get sequence number stats of node, prune its missing set, and make a copy of the missing set
-            SequenceNumberStats& sequenceNumberStats = _octreeServerSceneStats[nodeUUID].getIncomingOctreeSequenceNumberStats();
-            sequenceNumberStats.pruneMissingSet();
-            const QSet<OCTREE_PACKET_SEQUENCE> missingSequenceNumbers = sequenceNumberStats.getMissingSet();
+            // an ack goes back whenever packets have come in since the last, so the server can time the round trip
+            SelectiveAck ack;
+            bool hasAck = _octreeServerSceneStats[nodeUUID].makeIncomingOctreeAck(ack);
 
             _octreeSceneStatsLock.unlock();
 
-            // construct nack packet(s) for this node
-            int numSequenceNumbersAvailable = missingSequenceNumbers.size();
-            QSet<OCTREE_PACKET_SEQUENCE>::const_iterator missingSequenceNumbersIterator = missingSequenceNumbers.constBegin();
-            while (numSequenceNumbersAvailable > 0) {
-
-                char* dataAt = packet;
-                int bytesRemaining = MAX_PACKET_SIZE;
-
-                // pack header
-                int numBytesPacketHeader = populatePacketHeader(packet, PacketTypeOctreeDataNack);
-                dataAt += numBytesPacketHeader;
-                bytesRemaining -= numBytesPacketHeader;
-
-                // calculate and pack the number of sequence numbers
-                int numSequenceNumbersRoomFor = (bytesRemaining - sizeof(uint16_t)) / sizeof(OCTREE_PACKET_SEQUENCE);
-                uint16_t numSequenceNumbers = min(numSequenceNumbersAvailable, numSequenceNumbersRoomFor);
-                uint16_t* numSequenceNumbersAt = (uint16_t*)dataAt;
-                *numSequenceNumbersAt = numSequenceNumbers;
-                dataAt += sizeof(uint16_t);
-
-                // pack sequence numbers
-                for (int i = 0; i < numSequenceNumbers; i++) {
-                    OCTREE_PACKET_SEQUENCE* sequenceNumberAt = (OCTREE_PACKET_SEQUENCE*)dataAt;
-                    *sequenceNumberAt = *missingSequenceNumbersIterator;
-                    dataAt += sizeof(OCTREE_PACKET_SEQUENCE);
-
-                    missingSequenceNumbersIterator++;
-                }
-                numSequenceNumbersAvailable -= numSequenceNumbers;
-
-                // send it
-                NodeList::getInstance()->writeUnverifiedDatagram(packet, dataAt - packet, node);
+            if (hasAck) {
+                int packetLength = ack.packIntoPacket(packet, MAX_PACKET_SIZE, PacketTypeOctreeDataNack);
+                NodeList::getInstance()->writeUnverifiedDatagram(packet, packetLength, node);
                 packetsSent++;
             }
         }
@@ -2254,7 +2300,8 @@ int Application::sendNackPackets() {
     return packetsSent;
 }
 
-void Application::queryOctree(NodeType_t serverType, PacketType packetType, NodeToJurisdictionMap& jurisdictions) {
+void Application::queryOctree(NodeType_t serverType, PacketType packetType, NodeToJurisdictionMap& jurisdictions,
+        bool viewChanged, bool forceKeyframes) {
 
     // if voxels are disabled, then don't send this at all...
     if (!Menu::getInstance()->isOptionChecked(MenuOption::Voxels)) {
@@ -2272,12 +2319,8 @@ void Application::queryOctree(NodeType_t serverType, PacketType packetType, Node
     _octreeQuery.setWantOcclusionCulling(false);
     _octreeQuery.setWantCompression(true);
 
-    _octreeQuery.setCameraPosition(_viewFrustum.getPosition());
-    _octreeQuery.setCameraOrientation(_viewFrustum.getOrientation());
     _octreeQuery.setCameraFov(_viewFrustum.getFieldOfView());
     _octreeQuery.setCameraAspectRatio(_viewFrustum.getAspectRatio());
-    _octreeQuery.setCameraNearClip(_viewFrustum.getNearClip());
-    _octreeQuery.setCameraFarClip(_viewFrustum.getFarClip());
     _octreeQuery.setCameraEyeOffsetPosition(_viewFrustum.getEyeOffsetPosition());
     _octreeQuery.setOctreeSizeScale(Menu::getInstance()->getVoxelSizeScale());
     _octreeQuery.setBoundaryLevelAdjust(Menu::getInstance()->getBoundaryLevelAdjust());
@@ -2302,21 +2345,10 @@ void Application::queryOctree(NodeType_t serverType, PacketType packetType, Node
             if (jurisdictions.find(nodeUUID) == jurisdictions.end()) {
                 unknownJurisdictionServers++;
             } else {
-                const JurisdictionMap& map = (jurisdictions)[nodeUUID];
-
-                unsigned char* rootCode = map.getRootOctalCode();
-
-                if (rootCode) {
-                    VoxelPositionSize rootDetails;
-                    voxelDetailsForCode(rootCode, rootDetails);
-                    AACube serverBounds(glm::vec3(rootDetails.x, rootDetails.y, rootDetails.z), rootDetails.s);
-                    serverBounds.scale(TREE_SCALE);
-
-                    ViewFrustum::location serverFrustumLocation = _viewFrustum.cubeInFrustum(serverBounds);
-
-                    if (serverFrustumLocation != ViewFrustum::OUTSIDE) {
-                        inViewServers++;
-                    }
+                OctreeServerQueryState& state = _octreeServerQueryStates[nodeUUID];
+                updateOctreeServerInView(state, jurisdictions[nodeUUID], viewChanged);
+                if (state.inView) {
+                    inViewServers++;
                 }
             }
         }
@@ -2353,47 +2385,19 @@ void Application::queryOctree(NodeType_t serverType, PacketType packetType, Node
         // only send to the NodeTypes that are serverType
         if (node->getActiveSocket() && node->getType() == serverType) {
 
+            // the camera is set up again for each server, since those we don't know the jurisdiction of get another
+            _octreeQuery.setCameraPosition(_viewFrustum.getPosition());
+            _octreeQuery.setCameraOrientation(_viewFrustum.getOrientation());
+            _octreeQuery.setCameraNearClip(_viewFrustum.getNearClip());
+            _octreeQuery.setCameraFarClip(_viewFrustum.getFarClip());
 
             // get the server bounds for this server
             QUuid nodeUUID = node->getUUID();
-
-            bool inView = false;
-            bool unknownView = false;
+            OctreeServerQueryState& state = _octreeServerQueryStates[nodeUUID];
 
             // if we haven't heard from this voxel server, go ahead and send it a query, so we
             // can get the jurisdiction...
             if (jurisdictions.find(nodeUUID) == jurisdictions.end()) {
-                unknownView = true; // assume it's in view
-                if (wantExtraDebugging) {
-                    qDebug() << "no known jurisdiction for node " << *node << ", assume it's visible.";
-                }
-            } else {
-                const JurisdictionMap& map = (jurisdictions)[nodeUUID];
-
-                unsigned char* rootCode = map.getRootOctalCode();
-
-                if (rootCode) {
-                    VoxelPositionSize rootDetails;
-                    voxelDetailsForCode(rootCode, rootDetails);
-                    AACube serverBounds(glm::vec3(rootDetails.x, rootDetails.y, rootDetails.z), rootDetails.s);
-                    serverBounds.scale(TREE_SCALE);
-
-                    ViewFrustum::location serverFrustumLocation = _viewFrustum.cubeInFrustum(serverBounds);
-                    if (serverFrustumLocation != ViewFrustum::OUTSIDE) {
-                        inView = true;
-                    } else {
-                        inView = false;
-                    }
-                } else {
-                    if (wantExtraDebugging) {
-                        qDebug() << "Jurisdiction without RootCode for node " << *node << ". That's unusual!";
-                    }
-                }
-            }
-
-            if (inView) {
-                _octreeQuery.setMaxOctreePacketsPerSecond(perServerPPS);
-            } else if (unknownView) {
                 if (wantExtraDebugging) {
                     qDebug() << "no known jurisdiction for node " << *node << ", give it budget of "
                             << perUnknownServer << " to send us jurisdiction.";
@@ -2417,7 +2421,14 @@ void Application::queryOctree(NodeType_t serverType, PacketType packetType, Node
                     }
                 }
                 _octreeQuery.setMaxOctreePacketsPerSecond(perUnknownServer);
+
+            } else if (state.inView) {
+                _octreeQuery.setMaxOctreePacketsPerSecond(perServerPPS);
+
             } else {
+                if (state.rootCode.isEmpty() && wantExtraDebugging) {
+                    qDebug() << "Jurisdiction without RootCode for node " << *node << ". That's unusual!";
+                }
                 _octreeQuery.setMaxOctreePacketsPerSecond(0);
             }
             // set up the packet for sending...
@@ -2426,8 +2437,8 @@ void Application::queryOctree(NodeType_t serverType, PacketType packetType, Node
             // insert packet type/version and node UUID
             endOfQueryPacket += populatePacketHeader(reinterpret_cast<char*>(endOfQueryPacket), packetType);
 
-            // encode the query data...
-            endOfQueryPacket += _octreeQuery.getBroadcastData(endOfQueryPacket);
+            // encode the query data, as the changes since the keyframe the server has if it has one
+            endOfQueryPacket += state.channel.writeQuery(_octreeQuery, endOfQueryPacket, forceKeyframes);
 
             int packetLength = endOfQueryPacket - queryPacket;
 
@@ -2440,6 +2451,40 @@ void Application::queryOctree(NodeType_t serverType, PacketType packetType, Node
     }
 }
 
+void Application::updateOctreeServerInView(OctreeServerQueryState& state, const JurisdictionMap& jurisdiction,
+        bool viewChanged) {
+    unsigned char* rootCode = jurisdiction.getRootOctalCode();
+    if (!rootCode) {
+        state.rootCode.clear();
+        state.inView = false;
+        return;
+    }
+    // the bounds are only worked out again when the jurisdiction changes, and whether they're in view when either does
+    QByteArray rootCodeBytes(reinterpret_cast<const char*>(rootCode),
+        bytesRequiredForCodeLength(numberOfThreeBitSectionsInCode(rootCode)));
+    if (rootCodeBytes != state.rootCode) {
+        state.rootCode = rootCodeBytes;
+        VoxelPositionSize rootDetails;
+        voxelDetailsForCode(rootCode, rootDetails);
+        state.bounds = AACube(glm::vec3(rootDetails.x, rootDetails.y, rootDetails.z), rootDetails.s);
+        state.bounds.scale(TREE_SCALE);
+        viewChanged = true;
+    }
+    if (viewChanged) {
+        state.inView = (_viewFrustum.cubeInFrustum(state.bounds) != ViewFrustum::OUTSIDE);
+    }
+}
+
+void Application::octreeQueryAcknowledged(const QByteArray& packet) {
+    QHash<QUuid, OctreeServerQueryState>::iterator it = _octreeServerQueryStates.find(uuidFromPacketHeader(packet));
+    int numBytesPacketHeader = numBytesForPacketHeader(packet);
+    quint16 sequenceNumber;
+    if (it != _octreeServerQueryStates.end() && packet.size() >= numBytesPacketHeader + (int)sizeof(sequenceNumber)) {
+        memcpy(&sequenceNumber, packet.constData() + numBytesPacketHeader, sizeof(sequenceNumber));
+        it.value().channel.keyframeAcknowledged(sequenceNumber);
+    }
+}
+
 /////////////////////////////////////////////////////////////////////////////////////
 // loadViewFrustum()
 //
@@ -2478,11 +2523,11 @@ glm::vec3 Application::getSunDirection() {
 }
 
 void Application::updateShadowMap() {
-    PerformanceTimer perfTimer("paintGL/updateShadowMap");
+    PERFORMANCE_TIMER("paintGL/updateShadowMap");
+    GpuTimer gpuTimer("paintGL/updateShadowMap");
     QOpenGLFramebufferObject* fbo = _textureCache.getShadowFramebufferObject();
     fbo->bind();
     glEnable(GL_DEPTH_TEST);
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
     glm::vec3 lightDirection = -getSunDirection();
     glm::quat rotation = rotationBetween(IDENTITY_FRONT, lightDirection);
@@ -2492,6 +2537,16 @@ void Application::updateShadowMap() {
     const glm::vec2 MAP_COORDS[] = { glm::vec2(0.0f, 0.0f), glm::vec2(0.5f, 0.0f),
         glm::vec2(0.0f, 0.5f), glm::vec2(0.5f, 0.5f) };
     
+    // the distant cascades cover more space per texel, so they can be rendered less often; the frames on which they're
+    // rendered are staggered so that no frame renders them all
+    const int SHADOW_CASCADE_UPDATE_INTERVALS[] = { 1, 1, 2, 4 };
+    const int SHADOW_CASCADE_UPDATE_OFFSETS[] = { 0, 0, 1, 2 };
+    
+    // a skipped cascade still has to cover its slice of the view frustum
+    const float MAX_SHADOW_CASCADE_DRIFT = 0.1f;
+    
+    _shadowFrame++;
+    
     float frustumScale = 1.0f / (_viewFrustum.getFarClip() - _viewFrustum.getNearClip());
     loadViewFrustum(_myCamera, _viewFrustum);
     
@@ -2503,9 +2558,16 @@ void Application::updateShadowMap() {
         targetSize = fbo->width() / 2;
         targetScale = 0.5f;
     }
+    
+    // a change in the light or the layout of the map invalidates all of the cascades
+    bool updateAll = (matrixCount != _shadowCascadeCount || rotation != _shadowRotation);
+    _shadowCascadeCount = matrixCount;
+    _shadowRotation = rotation;
+    if (updateAll) {
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    }
     for (int i = 0; i < matrixCount; i++) {
         const glm::vec2& coord = MAP_COORDS[i];
-        glViewport(coord.s * fbo->width(), coord.t * fbo->height(), targetSize, targetSize);
 
         float nearScale = SHADOW_MATRIX_DISTANCES[i] * frustumScale;
         float farScale = SHADOW_MATRIX_DISTANCES[i + 1] * frustumScale;
@@ -2538,6 +2600,24 @@ void Application::updateShadowMap() {
         center = glm::vec3(roundf(center.x / texelSize) * texelSize, roundf(center.y / texelSize) * texelSize,
             roundf(center.z / texelSize) * texelSize);
         
+        if (!updateAll && (_shadowFrame + SHADOW_CASCADE_UPDATE_OFFSETS[i]) % SHADOW_CASCADE_UPDATE_INTERVALS[i] != 0 &&
+                glm::distance(center, _shadowCenters[i]) <= radius * MAX_SHADOW_CASCADE_DRIFT &&
+                fabsf(radius - _shadowRadii[i]) <= radius * MAX_SHADOW_CASCADE_DRIFT) {
+            continue; // keep the cascade, and the matrix it was rendered with, from an earlier frame
+        }
+        _shadowCenters[i] = center;
+        _shadowRadii[i] = radius;
+        
+        int targetX = coord.s * fbo->width();
+        int targetY = coord.t * fbo->height();
+        glViewport(targetX, targetY, targetSize, targetSize);
+        if (!updateAll) {
+            glEnable(GL_SCISSOR_TEST);
+            glScissor(targetX, targetY, targetSize, targetSize);
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            glDisable(GL_SCISSOR_TEST);
+        }
+        
         glm::vec3 minima(center.x - radius, center.y - radius, center.z - radius);
         glm::vec3 maxima(center.x + radius, center.y + radius, center.z + radius);
 
@@ -2639,8 +2719,8 @@ QImage Application::renderAvatarBillboard() {
     return image;
 }
 
-void Application::displaySide(Camera& whichCamera, bool selfAvatarOnly) {
-    PerformanceTimer perfTimer("paintGL/displaySide");
+void Application::displaySide(Camera& whichCamera, bool selfAvatarOnly, bool secondEye) {
+    PERFORMANCE_TIMER("paintGL/displaySide");
     PerformanceWarning warn(Menu::getInstance()->isOptionChecked(MenuOption::PipelineWarnings), "Application::displaySide()");
     // transform by eye offset
 
@@ -2674,7 +2754,7 @@ void Application::displaySide(Camera& whichCamera, bool selfAvatarOnly) {
 
     //  Setup 3D lights (after the camera transform, so that they are positioned in world space)
     {
-        PerformanceTimer perfTimer("paintGL/displaySide/setupWorldLight");
+        PERFORMANCE_TIMER("paintGL/displaySide/setupWorldLight");
         setupWorldLight();
     }
 
@@ -2693,11 +2773,12 @@ void Application::displaySide(Camera& whichCamera, bool selfAvatarOnly) {
     }
 
     if (!selfAvatarOnly && Menu::getInstance()->isOptionChecked(MenuOption::Stars)) {
-        PerformanceTimer perfTimer("paintGL/displaySide/stars");
+        PERFORMANCE_TIMER("paintGL/displaySide/stars");
         PerformanceWarning warn(Menu::getInstance()->isOptionChecked(MenuOption::PipelineWarnings),
             "Application::displaySide() ... stars...");
         if (!_stars.isStarsLoaded()) {
-            _stars.generate(STARFIELD_NUM_STARS, STARFIELD_SEED);
+            // generated on the pool rather than holding up the first frames, and drawn from when they're ready
+            _stars.generateAsync(STARFIELD_NUM_STARS, STARFIELD_SEED);
         }
         // should be the first rendering pass - w/o depth buffer / lighting
 
@@ -2722,7 +2803,7 @@ void Application::displaySide(Camera& whichCamera, bool selfAvatarOnly) {
 
     // draw the sky dome
     if (!selfAvatarOnly && Menu::getInstance()->isOptionChecked(MenuOption::Atmosphere)) {
-        PerformanceTimer perfTimer("paintGL/displaySide/atmosphere");
+        PERFORMANCE_TIMER("paintGL/displaySide/atmosphere");
         PerformanceWarning warn(Menu::getInstance()->isOptionChecked(MenuOption::PipelineWarnings),
             "Application::displaySide() ... atmosphere...");
         _environment.renderAtmospheres(whichCamera);
@@ -2743,13 +2824,14 @@ void Application::displaySide(Camera& whichCamera, bool selfAvatarOnly) {
 
         // draw the audio reflector overlay
         {
-            PerformanceTimer perfTimer("paintGL/displaySide/audioReflector");
+            PERFORMANCE_TIMER("paintGL/displaySide/audioReflector");
             _audioReflector.render();
         }
         
         //  Draw voxels
         if (Menu::getInstance()->isOptionChecked(MenuOption::Voxels)) {
-            PerformanceTimer perfTimer("paintGL/displaySide/voxels");
+            PERFORMANCE_TIMER("paintGL/displaySide/voxels");
+            GpuTimer gpuTimer("paintGL/displaySide/voxels");
             PerformanceWarning warn(Menu::getInstance()->isOptionChecked(MenuOption::PipelineWarnings),
                 "Application::displaySide() ... voxels...");
             _voxels.render();
@@ -2757,14 +2839,15 @@ void Application::displaySide(Camera& whichCamera, bool selfAvatarOnly) {
 
         // also, metavoxels
         if (Menu::getInstance()->isOptionChecked(MenuOption::Metavoxels)) {
-            PerformanceTimer perfTimer("paintGL/displaySide/metavoxels");
+            PERFORMANCE_TIMER("paintGL/displaySide/metavoxels");
+            GpuTimer gpuTimer("paintGL/displaySide/metavoxels");
             PerformanceWarning warn(Menu::getInstance()->isOptionChecked(MenuOption::PipelineWarnings),
                 "Application::displaySide() ... metavoxels...");
             _metavoxels.render();
         }
 
         if (Menu::getInstance()->isOptionChecked(MenuOption::BuckyBalls)) {
-            PerformanceTimer perfTimer("paintGL/displaySide/buckyBalls");
+            PERFORMANCE_TIMER("paintGL/displaySide/buckyBalls");
             PerformanceWarning warn(Menu::getInstance()->isOptionChecked(MenuOption::PipelineWarnings),
                 "Application::displaySide() ... bucky balls...");
             _buckyBalls.render();
@@ -2772,7 +2855,8 @@ void Application::displaySide(Camera& whichCamera, bool selfAvatarOnly) {
 
         // render particles...
         if (Menu::getInstance()->isOptionChecked(MenuOption::Particles)) {
-            PerformanceTimer perfTimer("paintGL/displaySide/particles");
+            PERFORMANCE_TIMER("paintGL/displaySide/particles");
+            GpuTimer gpuTimer("paintGL/displaySide/particles");
             PerformanceWarning warn(Menu::getInstance()->isOptionChecked(MenuOption::PipelineWarnings),
                 "Application::displaySide() ... particles...");
             _particles.render();
@@ -2780,15 +2864,21 @@ void Application::displaySide(Camera& whichCamera, bool selfAvatarOnly) {
 
         // render models...
         if (Menu::getInstance()->isOptionChecked(MenuOption::Models)) {
-            PerformanceTimer perfTimer("paintGL/displaySide/models");
+            PERFORMANCE_TIMER("paintGL/displaySide/models");
+            GpuTimer gpuTimer("paintGL/displaySide/models");
             PerformanceWarning warn(Menu::getInstance()->isOptionChecked(MenuOption::PipelineWarnings),
                 "Application::displaySide() ... models...");
-            _models.render();
+            if (secondEye) {
+                _models.renderAgain();
+            } else {
+                _models.render();
+            }
         }
 
         // render the ambient occlusion effect if enabled
         if (Menu::getInstance()->isOptionChecked(MenuOption::AmbientOcclusion)) {
-            PerformanceTimer perfTimer("paintGL/displaySide/AmbientOcclusion");
+            PERFORMANCE_TIMER("paintGL/displaySide/AmbientOcclusion");
+            GpuTimer gpuTimer("paintGL/displaySide/AmbientOcclusion");
             PerformanceWarning warn(Menu::getInstance()->isOptionChecked(MenuOption::PipelineWarnings),
                 "Application::displaySide() ... AmbientOcclusion...");
             _ambientOcclusionEffect.render();
@@ -2803,20 +2893,21 @@ void Application::displaySide(Camera& whichCamera, bool selfAvatarOnly) {
 
     bool mirrorMode = (whichCamera.getInterpolatedMode() == CAMERA_MODE_MIRROR);
     {
-        PerformanceTimer perfTimer("paintGL/displaySide/renderAvatars");
+        PERFORMANCE_TIMER("paintGL/displaySide/renderAvatars");
+        GpuTimer gpuTimer("paintGL/displaySide/renderAvatars");
         _avatarManager.renderAvatars(mirrorMode ? Avatar::MIRROR_RENDER_MODE : Avatar::NORMAL_RENDER_MODE, selfAvatarOnly);
     }
 
     if (!selfAvatarOnly) {
         //  Render the world box
         if (whichCamera.getMode() != CAMERA_MODE_MIRROR && Menu::getInstance()->isOptionChecked(MenuOption::Stats) && Menu::getInstance()->isOptionChecked(MenuOption::UserInterface)) {
-            PerformanceTimer perfTimer("paintGL/displaySide/renderWorldBox");
+            PERFORMANCE_TIMER("paintGL/displaySide/renderWorldBox");
             renderWorldBox();
         }
 
         // view frustum for debugging
         if (Menu::getInstance()->isOptionChecked(MenuOption::DisplayFrustum) && whichCamera.getMode() != CAMERA_MODE_MIRROR) {
-            PerformanceTimer perfTimer("paintGL/displaySide/ViewFrustum");
+            PERFORMANCE_TIMER("paintGL/displaySide/ViewFrustum");
             PerformanceWarning warn(Menu::getInstance()->isOptionChecked(MenuOption::PipelineWarnings),
                 "Application::displaySide() ... renderViewFrustum...");
             renderViewFrustum(_viewFrustum);
@@ -2824,7 +2915,7 @@ void Application::displaySide(Camera& whichCamera, bool selfAvatarOnly) {
 
         // render voxel fades if they exist
         if (_voxelFades.size() > 0) {
-            PerformanceTimer perfTimer("paintGL/displaySide/voxel fades");
+            PERFORMANCE_TIMER("paintGL/displaySide/voxel fades");
             PerformanceWarning warn(Menu::getInstance()->isOptionChecked(MenuOption::PipelineWarnings),
                 "Application::displaySide() ... voxel fades...");
             _voxelFadesLock.lockForWrite();
@@ -2838,16 +2929,17 @@ void Application::displaySide(Camera& whichCamera, bool selfAvatarOnly) {
             }
             _voxelFadesLock.unlock();
         }
+        _voxels.renderLevelFades();
 
         // give external parties a change to hook in
         {
-            PerformanceTimer perfTimer("paintGL/displaySide/inWorldInterface");
+            PERFORMANCE_TIMER("paintGL/displaySide/inWorldInterface");
             emit renderingInWorldInterface();
         }
 
         // render JS/scriptable overlays
         {
-            PerformanceTimer perfTimer("paintGL/displaySide/3dOverlays");
+            PERFORMANCE_TIMER("paintGL/displaySide/3dOverlays");
             _overlays.render3D();
         }
     }
@@ -3283,6 +3375,7 @@ void Application::domainChanged(const QString& domainHostname) {
     _voxelServerJurisdictions.unlock();
 
     _octreeServerSceneStats.clear();
+    _octreeServerQueryStates.clear();
 
     _particleServerJurisdictions.lockForWrite();
     _particleServerJurisdictions.clear();
@@ -3327,7 +3420,9 @@ void Application::nodeKilled(SharedNodePointer node) {
     // OctreePacketProcessor::nodeKilled is not being called when NodeList::nodeKilled is emitted.
     // This may have to do with GenericThread::threadRoutine() blocking the QThread event loop
 
-    _octreeProcessor.nodeKilled(node);
+    _voxelPacketProcessor.nodeKilled(node);
+    _particlePacketProcessor.nodeKilled(node);
+    _modelPacketProcessor.nodeKilled(node);
 
     _voxelEditSender.nodeKilled(node);
     _particleEditSender.nodeKilled(node);
@@ -3337,6 +3432,9 @@ void Application::nodeKilled(SharedNodePointer node) {
         QMetaObject::invokeMethod(&_audio, "resetIncomingMixedAudioSequenceNumberStats");
     }
 
+    // a server that comes back will need a new keyframe
+    _octreeServerQueryStates.remove(node->getUUID());
+
     if (node->getType() == NodeType::VoxelServer) {
         QUuid nodeUUID = node->getUUID();
         // see if this is the first we've heard of this node...
@@ -3455,6 +3553,22 @@ void Application::nodeKilled(SharedNodePointer node) {
     }
 }
 
+OctreePacketProcessor& Application::getOctreePacketProcessor(NodeType_t serverType) {
+    switch (serverType) {
+        case NodeType::ParticleServer:
+            return _particlePacketProcessor;
+        case NodeType::ModelServer:
+            return _modelPacketProcessor;
+        default:
+            return _voxelPacketProcessor;
+    }
+}
+
+int Application::getOctreePacketsToProcessCount() const {
+    return _voxelPacketProcessor.packetsToProcessCount() + _particlePacketProcessor.packetsToProcessCount() +
+        _modelPacketProcessor.packetsToProcessCount();
+}
+
 void Application::trackIncomingVoxelPacket(const QByteArray& packet, const SharedNodePointer& sendingNode, bool wasStatsPacket) {
 
     // Attempt to identify the sender from it's address.
@@ -3898,8 +4012,11 @@ void Application::takeSnapshot() {
     player->setMedia(QUrl::fromLocalFile(inf.absoluteFilePath()));
     player->play();
 
-    QString fileName = Snapshot::saveSnapshot(_glWidget, _myAvatar);
+    // the share dialog waits until the snapshot has been saved
+    Snapshot::saveSnapshot(_frameCapture, _myAvatar, this, "snapshotSaved");
+}
 
+void Application::snapshotSaved(const QString& fileName) {
     AccountManager& accountManager = AccountManager::getInstance();
     if (!accountManager.isLoggedIn()) {
         return;
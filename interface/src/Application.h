@@ -30,6 +30,7 @@
 #include <QUndoStack>
 #include <QSystemTrayIcon>
 
+#include <JobGraph.h>
 #include <ModelEditPacketSender.h>
 #include <NetworkPacket.h>
 #include <NodeList.h>
@@ -66,6 +67,7 @@
 #include "models/ModelTreeRenderer.h"
 #include "particles/ParticleTreeRenderer.h"
 #include "renderer/AmbientOcclusionEffect.h"
+#include "renderer/FrameCapture.h"
 #include "renderer/GeometryCache.h"
 #include "renderer/GlowEffect.h"
 #include "renderer/PointShader.h"
@@ -85,9 +87,11 @@
 #include "ui/overlays/Overlays.h"
 #include "ui/ApplicationOverlay.h"
 #include "ui/RunningScriptsWidget.h"
+#include "voxels/VoxelExporter.h"
 #include "voxels/VoxelFade.h"
 #include "voxels/VoxelHideShowThread.h"
 #include "voxels/VoxelImporter.h"
+#include "voxels/VoxelPaster.h"
 #include "voxels/OctreePacketProcessor.h"
 #include "voxels/VoxelSystem.h"
 
@@ -191,7 +195,12 @@ public:
     ViewFrustum* getShadowViewFrustum() { return &_shadowViewFrustum; }
     VoxelSystem* getVoxels() { return &_voxels; }
     VoxelTree* getVoxelTree() { return _voxels.getTree(); }
-    const OctreePacketProcessor& getOctreePacketProcessor() const { return _octreeProcessor; }
+    
+    /// returns the processor for the packets of the given type of octree server
+    OctreePacketProcessor& getOctreePacketProcessor(NodeType_t serverType);
+    
+    /// the octree packets waiting to be processed, from all of the types of server
+    int getOctreePacketsToProcessCount() const;
     ParticleTreeRenderer* getParticles() { return &_particles; }
     MetavoxelSystem* getMetavoxels() { return &_metavoxels; }
     ModelTreeRenderer* getModels() { return &_models; }
@@ -239,6 +248,7 @@ public:
     AnimationCache* getAnimationCache() { return &_animationCache; }
     TextureCache* getTextureCache() { return &_textureCache; }
     GlowEffect* getGlowEffect() { return &_glowEffect; }
+    FrameCapture* getFrameCapture() { return &_frameCapture; }
     ControllerScriptingInterface* getControllerScriptingInterface() { return &_controllerScriptingInterface; }
 
     AvatarManager& getAvatarManager() { return _avatarManager; }
@@ -250,7 +260,8 @@ public:
 
     QImage renderAvatarBillboard();
 
-    void displaySide(Camera& whichCamera, bool selfAvatarOnly = false);
+    /// renders the scene from a camera; the second eye of a stereo pair draws the models the first found in view
+    void displaySide(Camera& whichCamera, bool selfAvatarOnly = false, bool secondEye = false);
 
     /// Stores the current modelview matrix as the untranslated view matrix to use for transforms and the supplied vector as
     /// the view matrix translation.
@@ -359,12 +370,28 @@ private slots:
 
     void manageRunningScriptsWidgetVisibility(bool shown);
 
+    void snapshotSaved(const QString& fileName);
+
+    void octreeQueryAcknowledged(const QByteArray& packet);
+
+    /// loads the scripts that run at startup, which waits for the first frame to be up
+    void loadStartupScripts();
+
 private:
+    /// what's kept between the queries sent to an octree server
+    class OctreeServerQueryState {
+    public:
+        OctreeServerQueryState() : inView(false) { }
+        OctreeQueryChannel channel;
+        QByteArray rootCode; /// the jurisdiction root that the bounds were worked out from
+        AACube bounds; /// in meters
+        bool inView;
+    };
+
     void resetCamerasOnResizeGL(Camera& camera, int width, int height);
     void updateProjectionMatrix();
     void updateProjectionMatrix(Camera& camera, bool updateViewFrustum = true);
 
-    static bool sendVoxelsOperation(OctreeElement* node, void* extraData);
     void sendPingPackets();
 
     void initDisplay();
@@ -380,10 +407,14 @@ private:
     void updateVisage();
     void updateMyAvatarLookAtPosition();
     void updateThreads(float deltaTime);
+    void updatePaste(bool finish = false);
     void updateMetavoxels(float deltaTime);
     void updateCamera(float deltaTime);
     void updateDialogs(float deltaTime);
     void updateCursor(float deltaTime);
+    void updateParticles();
+    void updateParticleCollisions();
+    void updateModels();
 
     Avatar* findLookatTargetAvatar(glm::vec3& eyePosition, QUuid &nodeUUID);
     bool isLookingAtMyAvatar(Avatar* avatar);
@@ -391,7 +422,9 @@ private:
     void renderLookatIndicator(glm::vec3 pointOfInterest);
 
     void updateMyAvatar(float deltaTime);
-    void queryOctree(NodeType_t serverType, PacketType packetType, NodeToJurisdictionMap& jurisdictions);
+    void queryOctree(NodeType_t serverType, PacketType packetType, NodeToJurisdictionMap& jurisdictions,
+        bool viewChanged, bool forceKeyframes);
+    void updateOctreeServerInView(OctreeServerQueryState& state, const JurisdictionMap& jurisdiction, bool viewChanged);
     void loadViewFrustum(Camera& camera, ViewFrustum& viewFrustum);
 
     glm::vec3 getSunDirection();
@@ -438,6 +471,7 @@ private:
     QElapsedTimer _timerStart;
     QElapsedTimer _lastTimeUpdated;
     bool _justStarted;
+    bool _startupScriptsPending;
     Stars _stars;
 
     BuckyBalls _buckyBalls;
@@ -445,7 +479,10 @@ private:
     VoxelSystem _voxels;
     VoxelTree _clipboard; // if I copy/paste
     VoxelImporter* _voxelImporter;
+    VoxelExporter* _voxelExporter;
     bool _importSucceded;
+    QByteArray _clipboardSourceOctalCode; // where in the voxel tree the clipboard was copied from, if it was
+    quint64 _clipboardCopiedAt;
     VoxelSystem _sharedVoxelSystem;
     ViewFrustum _sharedVoxelSystemViewFrustum;
 
@@ -454,6 +491,8 @@ private:
 
     ModelTreeRenderer _models;
 
+    JobGraph _updateJobs; ///< the stages of update that can go on at the same time as others
+
     QByteArray _voxelsFilename;
     bool _wantToKillLocalVoxels;
 
@@ -467,6 +506,7 @@ private:
     float _trailingAudioLoudness;
 
     OctreeQuery _octreeQuery; // NodeData derived class for querying voxels from voxel server
+    QHash<QUuid, OctreeServerQueryState> _octreeServerQueryStates;
 
     AvatarManager _avatarManager;
     MyAvatar* _myAvatar;            // TODO: move this and relevant code to AvatarManager (or MyAvatar as the case may be)
@@ -497,6 +537,11 @@ private:
     static const int CASCADED_SHADOW_MATRIX_COUNT = 4;
     glm::mat4 _shadowMatrices[CASCADED_SHADOW_MATRIX_COUNT];
     glm::vec3 _shadowDistances;
+    int _shadowFrame;
+    int _shadowCascadeCount; /// the number of cascades the map was last laid out for
+    glm::quat _shadowRotation; /// the light rotation the cascades were rendered with
+    glm::vec3 _shadowCenters[CASCADED_SHADOW_MATRIX_COUNT]; /// each cascade's center in light space when last rendered
+    float _shadowRadii[CASCADED_SHADOW_MATRIX_COUNT];
 
     Environment _environment;
 
@@ -532,12 +577,17 @@ private:
     VoxelShader _voxelShader;
     PointShader _pointShader;
 
+    FrameCapture _frameCapture;
+
     Audio _audio;
 
     bool _enableProcessVoxelsThread;
-    OctreePacketProcessor _octreeProcessor;
+    OctreePacketProcessor _voxelPacketProcessor;
+    OctreePacketProcessor _particlePacketProcessor;
+    OctreePacketProcessor _modelPacketProcessor;
     VoxelHideShowThread _voxelHideShowThread;
     VoxelEditPacketSender _voxelEditSender;
+    VoxelPaster _voxelPaster;
     ParticleEditPacketSender _particleEditSender;
     ModelEditPacketSender _modelEditSender;
 
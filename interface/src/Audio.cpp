@@ -32,6 +32,7 @@
 #include <QtMultimedia/QAudioOutput>
 #include <QSvgRenderer>
 
+#include <AudioCodec.h>
 #include <NodeList.h>
 #include <PacketHeaders.h>
 #include <SharedUtil.h>
@@ -48,6 +49,9 @@ static const float AUDIO_CALLBACK_MSECS = (float) NETWORK_BUFFER_LENGTH_SAMPLES_
 
 static const int NUMBER_OF_NOISE_SAMPLE_FRAMES = 300;
 
+// input is resampled this many device frames at a time, which is what the resampled buffers are sized for
+static const int MAX_INPUT_FRAMES_PER_SLICE = 1024;
+
 // Mute icon configration
 static const int MUTE_ICON_SIZE = 24;
 
@@ -56,7 +60,12 @@ Audio::Audio(int16_t initialJitterBufferSamples, QObject* parent) :
     _audioInput(NULL),
     _desiredInputFormat(),
     _inputFormat(),
+    _inputSink(this),
     _numInputCallbackBytes(0),
+    _inputResampler(NULL),
+    _resampledInputSamples(),
+    _loopbackResampler(NULL),
+    _loopbackSamples(),
     _audioOutput(NULL),
     _desiredOutputFormat(),
     _outputFormat(),
@@ -110,6 +119,19 @@ Audio::Audio(int16_t initialJitterBufferSamples, QObject* parent) :
     memset(_localProceduralSamples, 0, NETWORK_BUFFER_LENGTH_BYTES_PER_CHANNEL);
     // Create the noise sample array
     _noiseSampleFrames = new float[NUMBER_OF_NOISE_SAMPLE_FRAMES];
+
+    // the input is pushed in rather than read out, so the sink only ever needs to be writable
+    _inputSink.open(QIODevice::WriteOnly);
+}
+
+AudioInputSink::AudioInputSink(Audio* audio) :
+    QIODevice(audio), // so that it moves to the audio thread along with its audio
+    _audio(audio) {
+}
+
+qint64 AudioInputSink::writeData(const char* data, qint64 maxSize) {
+    _audio->handleAudioInput(data, maxSize);
+    return maxSize;
 }
 
 void Audio::init(QGLWidget *parent) {
@@ -422,67 +444,57 @@ bool Audio::switchOutputToAudioDevice(const QString& outputDeviceName) {
     return switchOutputToAudioDevice(getNamedAudioDeviceForMode(QAudio::AudioOutput, outputDeviceName));
 }
 
-void Audio::handleAudioInput() {
+void Audio::handleAudioInput(const char* inputData, int numInputBytes) {
     static char audioDataPacket[MAX_PACKET_SIZE];
 
     static int numBytesPacketHeader = numBytesForPacketHeaderGivenPacketType(PacketTypeMicrophoneAudioNoEcho);
-    static int leadingBytes = numBytesPacketHeader + sizeof(quint16) + sizeof(glm::vec3) + sizeof(glm::quat) + sizeof(quint8);
+    static int leadingBytes = numBytesPacketHeader + sizeof(quint16) + sizeof(glm::vec3) + sizeof(glm::quat)
+        + sizeof(quint8) + sizeof(quint8);
 
     static int16_t* networkAudioSamples = (int16_t*) (audioDataPacket + leadingBytes);
 
-    float inputToNetworkInputRatio = calculateDeviceToNetworkInputRatio(_numInputCallbackBytes);
-
-    int inputSamplesRequired = (int)((float)NETWORK_BUFFER_LENGTH_SAMPLES_PER_CHANNEL * inputToNetworkInputRatio);
+    if (!_inputResampler) {
+        return;
+    }
 
-    QByteArray inputByteArray = _inputDevice->readAll();
-    
-    if (Menu::getInstance()->isOptionChecked(MenuOption::EchoLocalAudio) && !_muted && _audioOutput) {
-        // if this person wants local loopback add that to the locally injected audio
+    bool wantLoopback = Menu::getInstance()->isOptionChecked(MenuOption::EchoLocalAudio) && !_muted && _audioOutput;
+    if (wantLoopback && !_loopbackOutputDevice && _loopbackAudioOutput) {
+        // we didn't have the loopback output device going so set that up now
+        _loopbackOutputDevice = _loopbackAudioOutput->start();
+    }
 
-        if (!_loopbackOutputDevice && _loopbackAudioOutput) {
-            // we didn't have the loopback output device going so set that up now
-            _loopbackOutputDevice = _loopbackAudioOutput->start();
+    // the device hands over however much it has, which goes to the network rate a slice at a time so that nothing
+    // has to be allocated on the way
+    const int16_t* inputSamples = (const int16_t*) inputData;
+    int numInputFrames = numInputBytes / (sizeof(int16_t) * _inputResampler->getSourceChannels());
+    while (numInputFrames > 0) {
+        int numSliceFrames = qMin(numInputFrames, MAX_INPUT_FRAMES_PER_SLICE);
+
+        if (wantLoopback && _loopbackOutputDevice && _loopbackResampler) {
+            // if this person wants local loopback add that to the locally injected audio
+            int numLoopbackFrames = _loopbackResampler->resample(inputSamples, numSliceFrames, _loopbackSamples.data());
+            _loopbackOutputDevice->write((const char*) _loopbackSamples.constData(),
+                                         numLoopbackFrames * _loopbackResampler->getDestinationChannels() * sizeof(int16_t));
         }
-        
-        if (_inputFormat == _outputFormat) {
-            if (_loopbackOutputDevice) {
-                _loopbackOutputDevice->write(inputByteArray);
-            }
-        } else {
-            float loopbackOutputToInputRatio = (_outputFormat.sampleRate() / (float) _inputFormat.sampleRate())
-                * (_outputFormat.channelCount() / _inputFormat.channelCount());
 
-            QByteArray loopBackByteArray(inputByteArray.size() * loopbackOutputToInputRatio, 0);
+        int numResampledFrames = _inputResampler->resample(inputSamples, numSliceFrames, _resampledInputSamples.data());
+        _inputRingBuffer.writeSamples(_resampledInputSamples.constData(),
+                                      numResampledFrames * _inputResampler->getDestinationChannels());
 
-            linearResampling((int16_t*) inputByteArray.data(), (int16_t*) loopBackByteArray.data(),
-                             inputByteArray.size() / sizeof(int16_t),
-                             loopBackByteArray.size() / sizeof(int16_t), _inputFormat, _outputFormat);
-
-            if (_loopbackOutputDevice) {
-                _loopbackOutputDevice->write(loopBackByteArray);
-            }
-        }
+        inputSamples += numSliceFrames * _inputResampler->getSourceChannels();
+        numInputFrames -= numSliceFrames;
     }
 
-    _inputRingBuffer.writeData(inputByteArray.data(), inputByteArray.size());
+    const int numNetworkBytes = _isStereoInput ? NETWORK_BUFFER_LENGTH_BYTES_STEREO : NETWORK_BUFFER_LENGTH_BYTES_PER_CHANNEL;
+    const int numNetworkSamples = _isStereoInput ? NETWORK_BUFFER_LENGTH_SAMPLES_STEREO : NETWORK_BUFFER_LENGTH_SAMPLES_PER_CHANNEL;
 
-    while (_inputRingBuffer.samplesAvailable() > inputSamplesRequired) {
+    // every whole network frame goes out as soon as it is in, rather than waiting for more input behind it
+    while (_inputRingBuffer.samplesAvailable() >= numNetworkSamples) {
 
-        int16_t* inputAudioSamples = new int16_t[inputSamplesRequired];
-        _inputRingBuffer.readSamples(inputAudioSamples, inputSamplesRequired);
-        
-        const int numNetworkBytes = _isStereoInput ? NETWORK_BUFFER_LENGTH_BYTES_STEREO : NETWORK_BUFFER_LENGTH_BYTES_PER_CHANNEL;
-        const int numNetworkSamples = _isStereoInput ? NETWORK_BUFFER_LENGTH_SAMPLES_STEREO : NETWORK_BUFFER_LENGTH_SAMPLES_PER_CHANNEL;
-
-        // zero out the monoAudioSamples array and the locally injected audio
-        memset(networkAudioSamples, 0, numNetworkBytes);
+        // the frame is read straight into the packet
+        _inputRingBuffer.readSamples(networkAudioSamples, numNetworkSamples);
 
         if (!_muted) {
-            // we aren't muted, downsample the input audio
-            linearResampling((int16_t*) inputAudioSamples, networkAudioSamples,
-                             inputSamplesRequired,  numNetworkSamples,
-                             _inputFormat, _desiredInputFormat);
-            
             // only impose the noise gate and perform tone injection if we sending mono audio
             if (!_isStereoInput) {
                 
@@ -605,7 +617,8 @@ void Audio::handleAudioInput() {
                 _lastInputLoudness = fabs(loudness / NETWORK_BUFFER_LENGTH_SAMPLES_PER_CHANNEL);
             }
         } else {
-            // our input loudness is 0, since we're muted
+            // zero out the samples, and our input loudness is 0, since we're muted
+            memset(networkAudioSamples, 0, numNetworkBytes);
             _lastInputLoudness = 0;
         }
         
@@ -637,6 +650,10 @@ void Audio::handleAudioInput() {
             glm::quat headOrientation = interfaceAvatar->getHead()->getFinalOrientationInWorldFrame();
             quint8 isStereo = _isStereoInput ? 1 : 0;
             
+            // the audio-mixer sends our mix back with the same codec we send our audio with
+            quint8 codec = Menu::getInstance()->isOptionChecked(MenuOption::CompressAudio)
+                ? AudioCodec::ADPCM : AudioCodec::PCM;
+            
             int numAudioBytes = 0;
             
             PacketType packetType;
@@ -647,7 +664,15 @@ void Audio::handleAudioInput() {
                 networkAudioSamples[0] = numNetworkSamples;
                 numAudioBytes = sizeof(int16_t);
             } else {
-                numAudioBytes = numNetworkBytes;
+                if (codec == AudioCodec::PCM) {
+                    numAudioBytes = numNetworkBytes;
+                } else {
+                    // the samples are encoded in place of themselves, so encode to the side first
+                    static char encodedAudio[NETWORK_BUFFER_LENGTH_BYTES_STEREO];
+                    numAudioBytes = AudioCodec::encode((AudioCodec::Type) codec, networkAudioSamples, numNetworkSamples,
+                                                       _isStereoInput ? 2 : 1, encodedAudio);
+                    memcpy(networkAudioSamples, encodedAudio, numAudioBytes);
+                }
                 
                 if (Menu::getInstance()->isOptionChecked(MenuOption::EchoServerAudio)) {
                     packetType = PacketTypeMicrophoneAudioWithEcho;
@@ -673,13 +698,15 @@ void Audio::handleAudioInput() {
             memcpy(currentPacketPtr, &headOrientation, sizeof(headOrientation));
             currentPacketPtr += sizeof(headOrientation);
             
+            // set the codec byte
+            *currentPacketPtr++ = codec;
+            
             nodeList->writeDatagram(audioDataPacket, numAudioBytes + leadingBytes, audioMixer);
             _outgoingAvatarAudioSequenceNumber++;
 
             Application::getInstance()->getBandwidthMeter()->outputStream(BandwidthMeter::AUDIO)
                 .updateValue(numAudioBytes + leadingBytes);
         }
-        delete[] inputAudioSamples;
     }
 }
 
@@ -856,7 +883,12 @@ void Audio::processReceivedAudio(const QByteArray& audioByteArray) {
     _incomingMixedAudioSequenceNumberStats.sequenceNumberReceived(sequence, senderUUID);
 
     // parse audio data
-    _ringBuffer.parseData(audioByteArray);
+    if (packetTypeForPacket(audioByteArray) == PacketTypeSilentMixedAudio
+        && Menu::getInstance()->isOptionChecked(MenuOption::ComfortNoise)) {
+        addComfortNoiseToBuffer(audioByteArray);
+    } else {
+        _ringBuffer.parseData(audioByteArray);
+    }
     
     float networkOutputToOutputRatio = (_desiredOutputFormat.sampleRate() / (float) _outputFormat.sampleRate())
         * (_desiredOutputFormat.channelCount() / (float) _outputFormat.channelCount());
@@ -964,6 +996,24 @@ void Audio::processReceivedAudio(const QByteArray& audioByteArray) {
     }
 }
 
+void Audio::addComfortNoiseToBuffer(const QByteArray& silentAudioByteArray) {
+    // the number of silent samples follows the header and sequence number
+    int16_t numSilentSamples;
+    memcpy(&numSilentSamples, silentAudioByteArray.data() + numBytesForPacketHeader(silentAudioByteArray) + sizeof(quint16),
+           sizeof(int16_t));
+    numSilentSamples = glm::clamp((int) numSilentSamples, 0, NETWORK_BUFFER_LENGTH_SAMPLES_STEREO);
+    
+    // roughly -70 dB, enough to hear that the connection is alive without it being noticeable as hiss
+    const float COMFORT_NOISE_AMPLITUDE = 10.0f;
+    
+    int16_t comfortNoise[NETWORK_BUFFER_LENGTH_SAMPLES_STEREO];
+    for (int i = 0; i < numSilentSamples; i++) {
+        comfortNoise[i] = randFloatInRange(-COMFORT_NOISE_AMPLITUDE, COMFORT_NOISE_AMPLITUDE);
+    }
+    
+    _ringBuffer.writeSamples(comfortNoise, numSilentSamples);
+}
+
 void Audio::processProceduralAudio(int16_t* monoInput, int numSamples) {
 
     // zero out the locally injected audio in preparation for audio procedural sounds
@@ -1328,15 +1378,13 @@ void Audio::renderGrid(const float* color, int x, int y, int width, int height,
 
 void Audio::renderLineStrip(const float* color, int x, int y, int n, int offset, const QByteArray* byteArray) {
 
-    glColor4fv(color);
-    glBegin(GL_LINE_STRIP);
-
     int16_t sample;
     int16_t* samples = ((int16_t*) byteArray->data()) + offset;
     int numSamplesToAverage = _framesPerScope / DEFAULT_FRAMES_PER_SCOPE;
     int count = (n - offset) / numSamplesToAverage;
     int remainder = (n - offset) % numSamplesToAverage;
     y += SCOPE_HEIGHT / 2;
+    _scopeVertices.resize(0);
 
     // Compute and draw the sample averages from the offset position
     for (int i = count; --i >= 0; ) {
@@ -1345,7 +1393,7 @@ void Audio::renderLineStrip(const float* color, int x, int y, int n, int offset,
             sample += *samples++;
         }
         sample /= numSamplesToAverage;
-        glVertex2i(x++, y - sample);
+        _scopeVertices << x++ << y - sample;
     }
 
     // Compute and draw the sample average across the wrap boundary
@@ -1361,7 +1409,7 @@ void Audio::renderLineStrip(const float* color, int x, int y, int n, int offset,
             sample += *samples++;
         }
         sample /= numSamplesToAverage;
-        glVertex2i(x++, y - sample);
+        _scopeVertices << x++ << y - sample;
     } else {
         samples = (int16_t*) byteArray->data();
     }
@@ -1374,9 +1422,14 @@ void Audio::renderLineStrip(const float* color, int x, int y, int n, int offset,
             sample += *samples++;
         }
         sample /= numSamplesToAverage;
-        glVertex2i(x++, y - sample);
+        _scopeVertices << x++ << y - sample;
     }
-    glEnd();
+
+    glColor4fv(color);
+    glEnableClientState(GL_VERTEX_ARRAY);
+    glVertexPointer(2, GL_INT, 0, _scopeVertices.constData());
+    glDrawArrays(GL_LINE_STRIP, 0, _scopeVertices.size() / 2);
+    glDisableClientState(GL_VERTEX_ARRAY);
     glColor4f(1, 1, 1, 1); 
 }
 
@@ -1386,16 +1439,16 @@ bool Audio::switchInputToAudioDevice(const QAudioDeviceInfo& inputDeviceInfo) {
     
     // cleanup any previously initialized device
     if (_audioInput) {
-        // The call to stop() causes _inputDevice to be destructed.
-        // That in turn causes it to be disconnected (see for example
-        // http://stackoverflow.com/questions/9264750/qt-signals-and-slots-object-disconnect).
+        // once stopped, nothing more is pushed into the sink
         _audioInput->stop();
-        _inputDevice = NULL;
 
         delete _audioInput;
         _audioInput = NULL;
         _numInputCallbackBytes = 0;
 
+        delete _inputResampler;
+        _inputResampler = NULL;
+
         _inputAudioDeviceName = "";
     }
 
@@ -1411,12 +1464,19 @@ bool Audio::switchInputToAudioDevice(const QAudioDeviceInfo& inputDeviceInfo) {
                 _audioInput = new QAudioInput(inputDeviceInfo, _inputFormat, this);
                 _numInputCallbackBytes = calculateNumberOfInputCallbackBytes(_inputFormat);
                 _audioInput->setBufferSize(_numInputCallbackBytes);
-                
+
+                // the input goes to the network rate as it comes in, so the ring buffer only holds whole network frames
+                _inputResampler = new AudioResampler(_inputFormat.sampleRate(), _inputFormat.channelCount(),
+                                                     _desiredInputFormat.sampleRate(), _desiredInputFormat.channelCount(),
+                                                     MAX_INPUT_FRAMES_PER_SLICE);
+                _resampledInputSamples.resize(_inputResampler->getMaxDestinationFrames(MAX_INPUT_FRAMES_PER_SLICE)
+                                              * _desiredInputFormat.channelCount());
+                _inputRingBuffer.resizeForFrameSize(_isStereoInput ? NETWORK_BUFFER_LENGTH_SAMPLES_STEREO
+                                                    : NETWORK_BUFFER_LENGTH_SAMPLES_PER_CHANNEL);
+                resetLoopbackResampler();
+
                 // how do we want to handle input working, but output not working?
-                int numFrameSamples = calculateNumberOfFrameSamples(_numInputCallbackBytes);
-                _inputRingBuffer.resizeForFrameSize(numFrameSamples);
-                _inputDevice = _audioInput->start();
-                connect(_inputDevice, SIGNAL(readyRead()), this, SLOT(handleAudioInput()));
+                _audioInput->start(&_inputSink);
                 
                 supportedFormat = true;
             }
@@ -1461,6 +1521,7 @@ bool Audio::switchOutputToAudioDevice(const QAudioDeviceInfo& outputDeviceInfo)
 
             // setup a loopback audio output device
             _loopbackAudioOutput = new QAudioOutput(outputDeviceInfo, _outputFormat, this);
+            resetLoopbackResampler();
         
             // setup a procedural audio output device
             _proceduralAudioOutput = new QAudioOutput(outputDeviceInfo, _outputFormat, this);
@@ -1503,15 +1564,15 @@ int Audio::calculateNumberOfInputCallbackBytes(const QAudioFormat& format) {
     return numInputCallbackBytes;
 }
 
-float Audio::calculateDeviceToNetworkInputRatio(int numBytes) {
-    float inputToNetworkInputRatio = (int)((_numInputCallbackBytes 
-        * CALLBACK_ACCELERATOR_RATIO
-        / NETWORK_BUFFER_LENGTH_BYTES_PER_CHANNEL) + 0.5f);
+void Audio::resetLoopbackResampler() {
+    delete _loopbackResampler;
+    _loopbackResampler = NULL;
 
-    return inputToNetworkInputRatio;
-}
-
-int Audio::calculateNumberOfFrameSamples(int numBytes) {
-    int frameSamples = (int)(numBytes * CALLBACK_ACCELERATOR_RATIO + 0.5f) / sizeof(int16_t);
-    return frameSamples;
+    if (_audioInput && _loopbackAudioOutput) {
+        _loopbackResampler = new AudioResampler(_inputFormat.sampleRate(), _inputFormat.channelCount(),
+                                                _outputFormat.sampleRate(), _outputFormat.channelCount(),
+                                                MAX_INPUT_FRAMES_PER_SLICE);
+        _loopbackSamples.resize(_loopbackResampler->getMaxDestinationFrames(MAX_INPUT_FRAMES_PER_SLICE)
+                                * _outputFormat.channelCount());
+    }
 }
@@ -22,6 +22,7 @@
 #include <QAudioInput>
 #include <QElapsedTimer>
 #include <QGLWidget>
+#include <QtCore/QIODevice>
 #include <QtCore/QObject>
 #include <QtCore/QVector>
 #include <QtMultimedia/QAudioFormat>
@@ -29,6 +30,7 @@
 #include <QByteArray>
 
 #include <AbstractAudioInterface.h>
+#include <AudioResampler.h>
 #include <AudioRingBuffer.h>
 #include <StdDev.h>
 
@@ -38,6 +40,22 @@ class QAudioInput;
 class QAudioOutput;
 class QIODevice;
 
+class Audio;
+
+/// The device the audio input pushes each buffer into as it is captured, which hands it straight on to Audio rather
+/// than waiting for a readyRead and a readAll of whatever has piled up by then.
+class AudioInputSink : public QIODevice {
+public:
+    AudioInputSink(Audio* audio);
+
+protected:
+    virtual qint64 readData(char* data, qint64 maxSize) { return 0; }
+    virtual qint64 writeData(const char* data, qint64 maxSize);
+
+private:
+    Audio* _audio;
+};
+
 class Audio : public AbstractAudioInterface {
     Q_OBJECT
 public:
@@ -81,7 +99,6 @@ public slots:
     void addReceivedAudioToBuffer(const QByteArray& audioByteArray);
     void parseAudioStreamStatsPacket(const QByteArray& packet);
     void addSpatialAudioToBuffer(unsigned int sampleTime, const QByteArray& spatialAudio, unsigned int numSamples);
-    void handleAudioInput();
     void reset();
     void resetIncomingMixedAudioSequenceNumberStats() { _incomingMixedAudioSequenceNumberStats.reset(); }
     void toggleMute();
@@ -117,13 +134,24 @@ signals:
     void processLocalAudio(unsigned int sampleTime, const QByteArray& samples, const QAudioFormat& format);
     
 private:
+    friend class AudioInputSink;
+
+    /// resamples, gates, encodes and sends the input as it is captured, all in buffers set up with the device
+    void handleAudioInput(const char* inputData, int numInputBytes);
+
+    /// the loopback resampler depends on the formats of both devices, so either of them changing sets it up again
+    void resetLoopbackResampler();
 
     QByteArray firstInputFrame;
     QAudioInput* _audioInput;
     QAudioFormat _desiredInputFormat;
     QAudioFormat _inputFormat;
-    QIODevice* _inputDevice;
+    AudioInputSink _inputSink;
     int _numInputCallbackBytes;
+    AudioResampler* _inputResampler;
+    QVector<int16_t> _resampledInputSamples;
+    AudioResampler* _loopbackResampler;
+    QVector<int16_t> _loopbackSamples;
     int16_t _localProceduralSamples[NETWORK_BUFFER_LENGTH_SAMPLES_PER_CHANNEL];
     QAudioOutput* _audioOutput;
     QAudioFormat _desiredOutputFormat;
@@ -200,6 +228,9 @@ private:
     
     // Process received audio
     void processReceivedAudio(const QByteArray& audioByteArray);
+    
+    // Fill in a silent frame from the mixer with a low level of noise, so silence doesn't sound like a dropout
+    void addComfortNoiseToBuffer(const QByteArray& silentAudioByteArray);
 
     bool switchInputToAudioDevice(const QAudioDeviceInfo& inputDeviceInfo);
     bool switchOutputToAudioDevice(const QAudioDeviceInfo& outputDeviceInfo);
@@ -207,8 +238,6 @@ private:
     // Callback acceleration dependent calculations
     static const float CALLBACK_ACCELERATOR_RATIO;
     int calculateNumberOfInputCallbackBytes(const QAudioFormat& format);
-    int calculateNumberOfFrameSamples(int numBytes);
-    float calculateDeviceToNetworkInputRatio(int numBytes);
 
     // Audio scope methods for allocation/deallocation
     void allocateScope();
@@ -240,6 +269,7 @@ private:
     QByteArray* _scopeInput;
     QByteArray* _scopeOutputLeft;
     QByteArray* _scopeOutputRight;
+    QVector<GLint> _scopeVertices; /// the x and y of each point of a strip, drawn in a single call
 
     AudioStreamStats _audioMixerAvatarStreamStats;
     QHash<QUuid, AudioStreamStats> _audioMixerInjectedStreamStatsMap;
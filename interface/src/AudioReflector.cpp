@@ -7,6 +7,9 @@
 //
 
 #include <QMutexLocker>
+#include <QRunnable>
+
+#include <AudioRingBuffer.h>
 
 #include "AudioReflector.h"
 #include "Menu.h"
@@ -28,6 +31,43 @@ const float DEFAULT_DIFFUSION_RATIO = 0.125; // 12.5% is diffused
 const float DEFAULT_ORIGINAL_ATTENUATION = 1.0f;
 const float DEFAULT_ECHO_ATTENUATION = 1.0f;
 
+// echoes are added to an impulse response rather than to the output one by one, and the spatial audio buffer they end
+// up in holds ten seconds, so nothing after that could be heard anyway
+const float MAXIMUM_RESPONSE_MS = 1000.0f * 10.0f;
+const int MAXIMUM_RESPONSE_FRAMES = MAXIMUM_RESPONSE_MS * SAMPLE_RATE / MSECS_PER_SECOND;
+
+// set up our buffers for our attenuated and delayed samples
+const int NUMBER_OF_CHANNELS = 2;
+
+AudioReflections::AudioReflections() {
+}
+
+AudioReflections::~AudioReflections() {
+    foreach(AudioPath* const& path, inboundAudioPaths) {
+        delete path;
+    }
+    foreach(AudioPath* const& path, localAudioPaths) {
+        delete path;
+    }
+}
+
+/// traces the paths for one set of parameters and hands them to the reflector once it is done
+class AudioReflectionAnalyzer : public QRunnable {
+public:
+    AudioReflectionAnalyzer(AudioReflector* reflector, const AudioReflectorParameters& parameters) :
+        _reflector(reflector),
+        _parameters(parameters) {
+    }
+
+    virtual void run() {
+        _reflector->analyzePaths(_parameters);
+    }
+
+private:
+    AudioReflector* _reflector;
+    AudioReflectorParameters _parameters;
+};
+
 AudioReflector::AudioReflector(QObject* parent) : 
     QObject(parent),
     _preDelay(DEFAULT_PRE_DELAY),
@@ -49,20 +89,42 @@ AudioReflector::AudioReflector(QObject* parent) :
     _lastAbsorptionRatio(DEFAULT_ABSORPTION_RATIO),
     _lastDiffusionRatio(DEFAULT_DIFFUSION_RATIO),
     _lastDontDistanceAttenuate(false),
-    _lastAlternateDistanceAttenuate(false)
+    _lastAlternateDistanceAttenuate(false),
+    _lastWithPreDelay(false),
+    _lastSeparateEars(false),
+    _lastSlightlyRandomSurfaces(false),
+    _lastCombFilterWindow(DEFAULT_COMB_FILTER_WINDOW)
 {
     _reflections = 0;
     _diffusionPathCount = 0;
-    _officialAverageAttenuation = _averageAttenuation = 0.0f;
-    _officialMaxAttenuation = _maxAttenuation = 0.0f;
-    _officialMinAttenuation = _minAttenuation = 0.0f;
-    _officialAverageDelay = _averageDelay = 0;
-    _officialMaxDelay = _maxDelay = 0;
-    _officialMinDelay = _minDelay = 0;
+    _officialAverageAttenuation = 0.0f;
+    _officialMaxAttenuation = 0.0f;
+    _officialMinAttenuation = 0.0f;
+    _officialAverageDelay = 0;
+    _officialMaxDelay = 0;
+    _officialMinDelay = 0;
     _inboundEchoesCount = 0;
     _inboundEchoesSuppressedCount = 0;
     _localEchoesCount = 0;
     _localEchoesSuppressedCount = 0;
+
+    _isAnalyzing = false;
+    _analysisThreadPool.setMaxThreadCount(1);
+
+    for (int i = 0; i < NUMBER_OF_CHANNELS; i++) {
+        _inboundConvolvers[i] = new AudioConvolver(MAXIMUM_RESPONSE_FRAMES);
+        _localConvolvers[i] = new AudioConvolver(MAXIMUM_RESPONSE_FRAMES);
+    }
+}
+
+AudioReflector::~AudioReflector() {
+    // the analysis in flight still needs us
+    _analysisThreadPool.waitForDone();
+
+    for (int i = 0; i < NUMBER_OF_CHANNELS; i++) {
+        delete _inboundConvolvers[i];
+        delete _localConvolvers[i];
+    }
 }
 
 bool AudioReflector::haveAttributesChanged() {
@@ -70,6 +132,10 @@ bool AudioReflector::haveAttributesChanged() {
     bool dontDistanceAttenuate = Menu::getInstance()->isOptionChecked(MenuOption::AudioSpatialProcessingDontDistanceAttenuate);
     bool alternateDistanceAttenuate = Menu::getInstance()->isOptionChecked(
                                                 MenuOption::AudioSpatialProcessingAlternateDistanceAttenuate);
+    bool withPreDelay = Menu::getInstance()->isOptionChecked(MenuOption::AudioSpatialProcessingPreDelay);
+    bool separateEars = Menu::getInstance()->isOptionChecked(MenuOption::AudioSpatialProcessingSeparateEars);
+    bool slightlyRandomSurfaces = Menu::getInstance()->isOptionChecked(
+                                                MenuOption::AudioSpatialProcessingSlightlyRandomSurfaces);
     
     bool attributesChange = (_withDiffusion != withDiffusion
         || _lastPreDelay != _preDelay
@@ -79,7 +145,11 @@ bool AudioReflector::haveAttributesChanged() {
         || _lastAbsorptionRatio != _absorptionRatio
         || _lastDiffusionRatio != _diffusionRatio
         || _lastDontDistanceAttenuate != dontDistanceAttenuate
-        || _lastAlternateDistanceAttenuate != alternateDistanceAttenuate);
+        || _lastAlternateDistanceAttenuate != alternateDistanceAttenuate
+        || _lastWithPreDelay != withPreDelay
+        || _lastSeparateEars != separateEars
+        || _lastSlightlyRandomSurfaces != slightlyRandomSurfaces
+        || _lastCombFilterWindow != _combFilterWindow);
 
     if (attributesChange) {
         _withDiffusion = withDiffusion;
@@ -91,6 +161,10 @@ bool AudioReflector::haveAttributesChanged() {
         _lastDiffusionRatio = _diffusionRatio;
         _lastDontDistanceAttenuate = dontDistanceAttenuate;
         _lastAlternateDistanceAttenuate = alternateDistanceAttenuate;
+        _lastWithPreDelay = withPreDelay;
+        _lastSeparateEars = separateEars;
+        _lastSlightlyRandomSurfaces = slightlyRandomSurfaces;
+        _lastCombFilterWindow = _combFilterWindow;
     }
     
     return attributesChange;
@@ -122,16 +196,15 @@ float AudioReflector::getDelayFromDistance(float distance) {
     return delay;
 }
 
-// attenuation = from the Audio Mixer
-float AudioReflector::getDistanceAttenuationCoefficient(float distance) {
-
+float AudioReflector::getDelayFromDistance(const AudioReflectorParameters& parameters, float distance) {
+    return (parameters.soundMsPerMeter * distance) + parameters.preDelay;
+}
 
-    bool doDistanceAttenuation = !Menu::getInstance()->isOptionChecked(
-                                            MenuOption::AudioSpatialProcessingDontDistanceAttenuate);
+// attenuation = from the Audio Mixer
+float AudioReflector::getDistanceAttenuationCoefficient(const AudioReflectorParameters& parameters, float distance) {
 
-    bool originalFormula = !Menu::getInstance()->isOptionChecked(
-                                            MenuOption::AudioSpatialProcessingAlternateDistanceAttenuate);
-    
+    bool doDistanceAttenuation = parameters.withDistanceAttenuation;
+    bool originalFormula = !parameters.withAlternateDistanceAttenuation;
     
     float distanceCoefficient = 1.0f;
     
@@ -149,7 +222,7 @@ float AudioReflector::getDistanceAttenuationCoefficient(float distance) {
             distanceCoefficient = powf(GEOMETRIC_AMPLITUDE_SCALAR,
                                              DISTANCE_SCALE_LOG +
                                              (0.5f * logf(distanceSquareToSource) / logf(DISTANCE_LOG_BASE)) - 1);
-            distanceCoefficient = std::min(1.0f, distanceCoefficient * getDistanceAttenuationScalingFactor());
+            distanceCoefficient = std::min(1.0f, distanceCoefficient * parameters.distanceAttenuationScalingFactor);
         } else {
         
             // From Fred: If we wanted something that would produce a tail that could go up to 5 seconds in a 
@@ -162,15 +235,15 @@ float AudioReflector::getDistanceAttenuationCoefficient(float distance) {
             const float DISTANCE_DENOMINATOR = 300.0f;
             const float DISTANCE_NUMERATOR = 300.0f;
             distanceCoefficient = DISTANCE_NUMERATOR / powf(DISTANCE_BASE, (distance / DISTANCE_DENOMINATOR ));
-            distanceCoefficient = std::min(1.0f, distanceCoefficient * getDistanceAttenuationScalingFactor());
+            distanceCoefficient = std::min(1.0f, distanceCoefficient * parameters.distanceAttenuationScalingFactor);
         }
     }
     
     return distanceCoefficient;
 }
 
-glm::vec3 AudioReflector::getFaceNormal(BoxFace face) {
-    bool wantSlightRandomness = Menu::getInstance()->isOptionChecked(MenuOption::AudioSpatialProcessingSlightlyRandomSurfaces);
+glm::vec3 AudioReflector::getFaceNormal(const AudioReflectorParameters& parameters, BoxFace face) {
+    bool wantSlightRandomness = parameters.withSlightlyRandomSurfaces;
     glm::vec3 faceNormal;
     const float MIN_RANDOM_LENGTH = 0.99f;
     const float MAX_RANDOM_LENGTH = 1.0f;
@@ -196,111 +269,97 @@ glm::vec3 AudioReflector::getFaceNormal(BoxFace face) {
     return faceNormal;
 }
 
-// set up our buffers for our attenuated and delayed samples
-const int NUMBER_OF_CHANNELS = 2;
-
-void AudioReflector::injectAudiblePoint(AudioSource source, const AudiblePoint& audiblePoint,
-                        const QByteArray& samples, unsigned int sampleTime, int sampleRate) {
+AudioReflector::EchoStatistics::EchoStatistics() :
+    delayCount(0),
+    totalDelay(0.0f),
+    maxDelay(0.0f),
+    minDelay(std::numeric_limits<int>::max()),
+    attenuationCount(0),
+    totalAttenuation(0.0f),
+    maxAttenuation(0.0f),
+    minAttenuation(std::numeric_limits<float>::max()) {
+}
 
-    bool wantEarSeparation = Menu::getInstance()->isOptionChecked(MenuOption::AudioSpatialProcessingSeparateEars);
-    bool wantStereo = Menu::getInstance()->isOptionChecked(MenuOption::AudioSpatialProcessingStereoSource);
-    glm::vec3 rightEarPosition = wantEarSeparation ? _myAvatar->getHead()->getRightEarPosition() : 
-                                    _myAvatar->getHead()->getPosition();
-    glm::vec3 leftEarPosition = wantEarSeparation ? _myAvatar->getHead()->getLeftEarPosition() :
-                                    _myAvatar->getHead()->getPosition();
+int AudioReflector::calculateImpulseResponses(const AudioReflectorParameters& parameters,
+                                              const QVector<AudiblePoint>& audiblePoints,
+                                              AudioImpulseResponsePointer* responses, int& echoesSuppressed,
+                                              EchoStatistics& statistics) {
+    QVector<float> earResponses[NUMBER_OF_CHANNELS];
+    QMap<float, float> knownDelays;
+    echoesSuppressed = 0;
 
-    int totalNumberOfSamples = samples.size() / sizeof(int16_t);
-    int totalNumberOfStereoSamples = samples.size() / (sizeof(int16_t) * NUMBER_OF_CHANNELS);
+    // the convolution puts out each block a block late, so every echo is moved that much earlier to make up for it
+    const float CONVOLUTION_LATENCY_MSECS = AUDIO_CONVOLVER_BLOCK_FRAMES * (float) MSECS_PER_SECOND / SAMPLE_RATE;
 
-    const int16_t* originalSamplesData = (const int16_t*)samples.constData();
-    QByteArray attenuatedLeftSamples;
-    QByteArray attenuatedRightSamples;
-    attenuatedLeftSamples.resize(samples.size());
-    attenuatedRightSamples.resize(samples.size());
-
-    int16_t* attenuatedLeftSamplesData = (int16_t*)attenuatedLeftSamples.data();
-    int16_t* attenuatedRightSamplesData = (int16_t*)attenuatedRightSamples.data();
-    
-    // calculate the distance to the ears
-    float rightEarDistance = glm::distance(audiblePoint.location, rightEarPosition);
-    float leftEarDistance = glm::distance(audiblePoint.location, leftEarPosition);
+    foreach(const AudiblePoint& audiblePoint, audiblePoints) {
+        // calculate the distance to the ears
+        float rightEarDistance = glm::distance(audiblePoint.location, parameters.rightEarPosition);
+        float leftEarDistance = glm::distance(audiblePoint.location, parameters.leftEarPosition);
+
+        float rightEarDelayMsecs = getDelayFromDistance(parameters, rightEarDistance) + audiblePoint.delay;
+        float leftEarDelayMsecs = getDelayFromDistance(parameters, leftEarDistance) + audiblePoint.delay;
+        float averageEarDelayMsecs = (leftEarDelayMsecs + rightEarDelayMsecs) / 2.0f;
+
+        bool safeToInject = true; // assume the best
+
+        // check to see if this new injection point would be within the comb filter
+        // suppression window for any of the existing known delays
+        QMap<float, float>::const_iterator lowerBound = knownDelays.lowerBound(averageEarDelayMsecs
+                                                                                - parameters.combFilterWindow);
+        if (lowerBound != knownDelays.end()) {
+            float closestFound = lowerBound.value();
+            float deltaToClosest = (averageEarDelayMsecs - closestFound);
+            if (deltaToClosest > -parameters.combFilterWindow && deltaToClosest < parameters.combFilterWindow) {
+                safeToInject = false;
+            }
+        }
 
-    float rightEarDelayMsecs = getDelayFromDistance(rightEarDistance) + audiblePoint.delay;
-    float leftEarDelayMsecs = getDelayFromDistance(leftEarDistance) + audiblePoint.delay;
-    float averageEarDelayMsecs = (leftEarDelayMsecs + rightEarDelayMsecs) / 2.0f;
-    
-    bool safeToInject = true; // assume the best
-    
-    // check to see if this new injection point would be within the comb filter 
-    // suppression window for any of the existing known delays
-    QMap<float, float>& knownDelays = (source == INBOUND_AUDIO) ? _inboundAudioDelays : _localAudioDelays;
-    QMap<float, float>::const_iterator lowerBound = knownDelays.lowerBound(averageEarDelayMsecs - _combFilterWindow);
-    if (lowerBound != knownDelays.end()) {
-        float closestFound = lowerBound.value();
-        float deltaToClosest = (averageEarDelayMsecs - closestFound);
-        if (deltaToClosest > -_combFilterWindow && deltaToClosest < _combFilterWindow) {
-            safeToInject = false;
+        // keep track of any of our suppressed echoes so we can report them in our statistics
+        if (!safeToInject) {
+            echoesSuppressed++;
+            continue;
         }
-    }
-    
-    // keep track of any of our suppressed echoes so we can report them in our statistics
-    if (!safeToInject) {
-        QVector<float>& suppressedEchoes = (source == INBOUND_AUDIO) ? _inboundEchoesSuppressed : _localEchoesSuppressed;
-        suppressedEchoes << averageEarDelayMsecs;
-    } else {
         knownDelays[averageEarDelayMsecs] = averageEarDelayMsecs;
 
-        _totalDelay += rightEarDelayMsecs + leftEarDelayMsecs;
-        _delayCount += 2;
-        _maxDelay = std::max(_maxDelay,rightEarDelayMsecs);
-        _maxDelay = std::max(_maxDelay,leftEarDelayMsecs);
-        _minDelay = std::min(_minDelay,rightEarDelayMsecs);
-        _minDelay = std::min(_minDelay,leftEarDelayMsecs);
-        
-        int rightEarDelay = rightEarDelayMsecs * sampleRate / MSECS_PER_SECOND;
-        int leftEarDelay = leftEarDelayMsecs * sampleRate / MSECS_PER_SECOND;
-
-        float rightEarAttenuation = audiblePoint.attenuation * 
-                                        getDistanceAttenuationCoefficient(rightEarDistance + audiblePoint.distance);
-
-        float leftEarAttenuation = audiblePoint.attenuation * 
-                                        getDistanceAttenuationCoefficient(leftEarDistance + audiblePoint.distance);
-
-        _totalAttenuation += rightEarAttenuation + leftEarAttenuation;
-        _attenuationCount += 2;
-        _maxAttenuation = std::max(_maxAttenuation,rightEarAttenuation);
-        _maxAttenuation = std::max(_maxAttenuation,leftEarAttenuation);
-        _minAttenuation = std::min(_minAttenuation,rightEarAttenuation);
-        _minAttenuation = std::min(_minAttenuation,leftEarAttenuation);
-    
-        // run through the samples, and attenuate them                                                            
-        for (int sample = 0; sample < totalNumberOfStereoSamples; sample++) {
-            int16_t leftSample = originalSamplesData[sample * NUMBER_OF_CHANNELS];
-            int16_t rightSample = leftSample;
-            if (wantStereo) {
-                rightSample = originalSamplesData[(sample * NUMBER_OF_CHANNELS) + 1];
+        statistics.totalDelay += rightEarDelayMsecs + leftEarDelayMsecs;
+        statistics.delayCount += 2;
+        statistics.maxDelay = std::max(statistics.maxDelay, std::max(rightEarDelayMsecs, leftEarDelayMsecs));
+        statistics.minDelay = std::min(statistics.minDelay, std::min(rightEarDelayMsecs, leftEarDelayMsecs));
+
+        float rightEarAttenuation = audiblePoint.attenuation *
+                                        getDistanceAttenuationCoefficient(parameters, rightEarDistance + audiblePoint.distance);
+
+        float leftEarAttenuation = audiblePoint.attenuation *
+                                        getDistanceAttenuationCoefficient(parameters, leftEarDistance + audiblePoint.distance);
+
+        statistics.totalAttenuation += rightEarAttenuation + leftEarAttenuation;
+        statistics.attenuationCount += 2;
+        statistics.maxAttenuation = std::max(statistics.maxAttenuation,
+                                             std::max(rightEarAttenuation, leftEarAttenuation));
+        statistics.minAttenuation = std::min(statistics.minAttenuation,
+                                             std::min(rightEarAttenuation, leftEarAttenuation));
+
+        // each echo is a single tap of the response of each ear
+        float earDelaysMsecs[NUMBER_OF_CHANNELS] = { leftEarDelayMsecs, rightEarDelayMsecs };
+        float earAttenuations[NUMBER_OF_CHANNELS] = { leftEarAttenuation, rightEarAttenuation };
+        for (int ear = 0; ear < NUMBER_OF_CHANNELS; ear++) {
+            int delay = std::max(earDelaysMsecs[ear] - CONVOLUTION_LATENCY_MSECS, 0.0f) * SAMPLE_RATE / MSECS_PER_SECOND;
+            if (delay >= MAXIMUM_RESPONSE_FRAMES) {
+                continue;
             }
-
-            attenuatedLeftSamplesData[sample * NUMBER_OF_CHANNELS] = 
-                        leftSample * leftEarAttenuation * _allEchoesAttenuation;
-            attenuatedLeftSamplesData[sample * NUMBER_OF_CHANNELS + 1] = 0;
-
-            attenuatedRightSamplesData[sample * NUMBER_OF_CHANNELS] = 0;
-            attenuatedRightSamplesData[sample * NUMBER_OF_CHANNELS + 1] = 
-                        rightSample * rightEarAttenuation * _allEchoesAttenuation;
+            if (delay >= earResponses[ear].size()) {
+                earResponses[ear].resize(delay + 1);
+            }
+            earResponses[ear][delay] += earAttenuations[ear];
         }
-        
-        // now inject the attenuated array with the appropriate delay
-        unsigned int sampleTimeLeft = sampleTime + leftEarDelay;
-        unsigned int sampleTimeRight = sampleTime + rightEarDelay;
-    
-        _audio->addSpatialAudioToBuffer(sampleTimeLeft, attenuatedLeftSamples, totalNumberOfSamples);
-        _audio->addSpatialAudioToBuffer(sampleTimeRight, attenuatedRightSamples, totalNumberOfSamples);
-        
-        _injectedEchoes++;
     }
-}
 
+    for (int ear = 0; ear < NUMBER_OF_CHANNELS; ear++) {
+        responses[ear] = earResponses[ear].isEmpty()
+            ? AudioImpulseResponsePointer() : AudioImpulseResponsePointer(new AudioImpulseResponse(earResponses[ear]));
+    }
+    return knownDelays.size();
+}
 
 void AudioReflector::preProcessOriginalInboundAudio(unsigned int sampleTime, 
                                 QByteArray& samples, const QAudioFormat& format) {
@@ -332,65 +391,62 @@ void AudioReflector::processLocalAudio(unsigned int sampleTime, const QByteArray
                 stereoSamples[i* NUM_CHANNELS_OUTPUT] = monoSamples[i] * _localAudioAttenuationFactor;
                 stereoSamples[(i * NUM_CHANNELS_OUTPUT) + 1] = monoSamples[i] * _localAudioAttenuationFactor;
             }
-            _localAudioDelays.clear();
-            _localEchoesSuppressed.clear();
             echoAudio(LOCAL_AUDIO, sampleTime, stereoInputData, outputFormat);
-            _localEchoesCount = _localAudioDelays.size();
-            _localEchoesSuppressedCount = _localEchoesSuppressed.size();
         }
     }
 }
 
 void AudioReflector::processInboundAudio(unsigned int sampleTime, const QByteArray& samples, const QAudioFormat& format) {
-    _inboundAudioDelays.clear();
-    _inboundEchoesSuppressed.clear();
     echoAudio(INBOUND_AUDIO, sampleTime, samples, format);
-    _inboundEchoesCount = _inboundAudioDelays.size();
-    _inboundEchoesSuppressedCount = _inboundEchoesSuppressed.size();
 }
 
 void AudioReflector::echoAudio(AudioSource source, unsigned int sampleTime, const QByteArray& samples, const QAudioFormat& format) {
-    QMutexLocker locker(&_mutex);
+    AudioConvolver** convolvers = (source == INBOUND_AUDIO) ? _inboundConvolvers : _localConvolvers;
+    bool hasResponse = false;
+    {
+        // pick up the responses of the last analysis to finish, the convolvers themselves are only used from here
+        QMutexLocker locker(&_mutex);
+        AudioImpulseResponsePointer* responses = (source == INBOUND_AUDIO)
+            ? _reflectionsFound.inboundResponses : _reflectionsFound.localResponses;
+        for (int ear = 0; ear < NUMBER_OF_CHANNELS; ear++) {
+            if (convolvers[ear]->getImpulseResponse() != responses[ear]) {
+                if (!convolvers[ear]->getImpulseResponse()) {
+                    // whatever input it held onto from before it went quiet is long gone from the real world
+                    convolvers[ear]->reset();
+                }
+                convolvers[ear]->setImpulseResponse(responses[ear]);
+            }
+            hasResponse = hasResponse || !responses[ear].isNull();
+        }
+    }
 
-    _maxDelay = 0;
-    _maxAttenuation = 0.0f;
-    _minDelay = std::numeric_limits<int>::max();
-    _minAttenuation = std::numeric_limits<float>::max();
-    _totalDelay = 0.0f;
-    _delayCount = 0;
-    _totalAttenuation = 0.0f;
-    _attenuationCount = 0;
+    if (!hasResponse) {
+        return;
+    }
 
-    // depending on if we're processing local or external audio, pick the correct points vector
-    QVector<AudiblePoint>& audiblePoints = source == INBOUND_AUDIO ? _inboundAudiblePoints : _localAudiblePoints;
+    bool wantStereo = Menu::getInstance()->isOptionChecked(MenuOption::AudioSpatialProcessingStereoSource);
 
-    int injectCalls = 0;
-    _injectedEchoes = 0;
-    foreach(const AudiblePoint& audiblePoint, audiblePoints) {
-        injectCalls++;
-        injectAudiblePoint(source, audiblePoint, samples, sampleTime, format.sampleRate());
+    int totalNumberOfSamples = samples.size() / sizeof(int16_t);
+    int totalNumberOfStereoSamples = samples.size() / (sizeof(int16_t) * NUMBER_OF_CHANNELS);
+    const int16_t* originalSamplesData = (const int16_t*)samples.constData();
+
+    // every echo of both ears in a single convolution each, however many of them there are
+    for (int ear = 0; ear < NUMBER_OF_CHANNELS; ear++) {
+        _echoSamples[ear].resize(totalNumberOfStereoSamples);
+        const int16_t* earInput = (wantStereo && ear == 1) ? originalSamplesData + 1 : originalSamplesData;
+        convolvers[ear]->process(earInput, NUMBER_OF_CHANNELS, _echoSamples[ear].data(), totalNumberOfStereoSamples);
     }
-    
-    /*
-    qDebug() << "injectCalls=" << injectCalls;
-    qDebug() << "_injectedEchoes=" << _injectedEchoes;
-    */
 
-    _averageDelay = _delayCount == 0 ? 0 : _totalDelay / _delayCount;
-    _averageAttenuation = _attenuationCount == 0 ? 0 : _totalAttenuation / _attenuationCount;
-    
-    if (_reflections == 0) {
-        _minDelay = 0.0f;
-        _minAttenuation = 0.0f;
+    QByteArray echoedSamples(samples.size(), 0);
+    int16_t* echoedSamplesData = (int16_t*)echoedSamples.data();
+    for (int sample = 0; sample < totalNumberOfStereoSamples; sample++) {
+        for (int ear = 0; ear < NUMBER_OF_CHANNELS; ear++) {
+            echoedSamplesData[(sample * NUMBER_OF_CHANNELS) + ear] = glm::clamp((int) (_echoSamples[ear][sample]
+                * _allEchoesAttenuation), MIN_SAMPLE_VALUE, MAX_SAMPLE_VALUE);
+        }
     }
-    
-    _officialMaxDelay = _maxDelay;
-    _officialMinDelay = _minDelay;
-    _officialMaxAttenuation = _maxAttenuation;
-    _officialMinAttenuation = _minAttenuation;
-    _officialAverageDelay = _averageDelay;
-    _officialAverageAttenuation = _averageAttenuation;
 
+    _audio->addSpatialAudioToBuffer(sampleTime, echoedSamples, totalNumberOfSamples);
 }
 
 void AudioReflector::drawVector(const glm::vec3& start, const glm::vec3& end, const glm::vec3& color) {
@@ -431,13 +487,14 @@ AudioPath::AudioPath(AudioSource source, const glm::vec3& origin, const glm::vec
 {
 }
 
-void AudioReflector::addAudioPath(AudioSource source, const glm::vec3& origin, const glm::vec3& initialDirection, 
-                                        float initialAttenuation, float initialDelay, float initialDistance, bool isDiffusion) {
+void AudioReflector::addAudioPath(AudioReflections& reflections, AudioSource source, const glm::vec3& origin,
+                                  const glm::vec3& initialDirection, float initialAttenuation, float initialDelay,
+                                  float initialDistance, bool isDiffusion) {
                                         
     AudioPath* path = new AudioPath(source, origin, initialDirection, initialAttenuation, initialDelay,
                                         initialDistance, isDiffusion, 0);
 
-    QVector<AudioPath*>& audioPaths = source == INBOUND_AUDIO ? _inboundAudioPaths : _localAudioPaths;
+    QVector<AudioPath*>& audioPaths = source == INBOUND_AUDIO ? reflections.inboundAudioPaths : reflections.localAudioPaths;
 
     audioPaths.push_back(path);
 }
@@ -456,6 +513,14 @@ void AudioReflector::identifyAudioSources() {
 }
 
 void AudioReflector::calculateAllReflections() {
+    {
+        // only one analysis at a time, the positions it was started with are compared against once it is done
+        QMutexLocker locker(&_mutex);
+        if (_isAnalyzing) {
+            return;
+        }
+    }
+
     // only recalculate when we've moved, or if the attributes have changed
     // TODO: what about case where new voxels are added in front of us???
     bool wantHeadOrientation = Menu::getInstance()->isOptionChecked(MenuOption::AudioSpatialProcessingHeadOriented);
@@ -470,17 +535,42 @@ void AudioReflector::calculateAllReflections() {
                             || haveAttributesChanged();
 
     if (shouldRecalc) {
-        QMutexLocker locker(&_mutex);
-        quint64 start = usecTimestampNow();        
+        // the menu and the avatar belong to this thread, so everything the analysis needs from them is copied here
+        AudioReflectorParameters parameters;
+        parameters.origin = origin;
+        parameters.orientation = orientation;
+        parameters.listenerPosition = listenerPosition;
+
+        bool wantEarSeparation = Menu::getInstance()->isOptionChecked(MenuOption::AudioSpatialProcessingSeparateEars);
+        parameters.rightEarPosition = wantEarSeparation ? _myAvatar->getHead()->getRightEarPosition() :
+                                        _myAvatar->getHead()->getPosition();
+        parameters.leftEarPosition = wantEarSeparation ? _myAvatar->getHead()->getLeftEarPosition() :
+                                        _myAvatar->getHead()->getPosition();
+
+        parameters.preDelay = Menu::getInstance()->isOptionChecked(MenuOption::AudioSpatialProcessingPreDelay)
+                                ? _preDelay : 0.0f;
+        parameters.soundMsPerMeter = _soundMsPerMeter;
+        parameters.withDistanceAttenuation = !Menu::getInstance()->isOptionChecked(
+                                                MenuOption::AudioSpatialProcessingDontDistanceAttenuate);
+        parameters.withAlternateDistanceAttenuation = Menu::getInstance()->isOptionChecked(
+                                                MenuOption::AudioSpatialProcessingAlternateDistanceAttenuate);
+        parameters.distanceAttenuationScalingFactor = _distanceAttenuationScalingFactor;
+        parameters.withSlightlyRandomSurfaces = Menu::getInstance()->isOptionChecked(
+                                                MenuOption::AudioSpatialProcessingSlightlyRandomSurfaces);
+        parameters.diffusionFanout = Menu::getInstance()->isOptionChecked(MenuOption::AudioSpatialProcessingWithDiffusions)
+                                        ? _diffusionFanout : 0;
+        SurfaceCharacteristics surface = { getReflectiveRatio(), _absorptionRatio, _diffusionRatio };
+        parameters.surface = surface;
+        parameters.combFilterWindow = _combFilterWindow;
+
         _origin = origin;
         _orientation = orientation;
         _listenerPosition = listenerPosition;
-        analyzePaths(); // actually does the work
-        quint64 end = usecTimestampNow();
-        const bool wantDebugging = false;
-        if (wantDebugging) {
-            qDebug() << "newCalculateAllReflections() elapsed=" << (end - start);
+        {
+            QMutexLocker locker(&_mutex);
+            _isAnalyzing = true;
         }
+        _analysisThreadPool.start(new AudioReflectionAnalyzer(this, parameters));
     }
 }    
 
@@ -495,7 +585,7 @@ void AudioReflector::drawRays() {
     QMutexLocker locker(&_mutex);
 
     // draw the paths for inbound audio
-    foreach(AudioPath* const& path, _inboundAudioPaths) {
+    foreach(AudioPath* const& path, _reflectionsFound.inboundAudioPaths) {
         // if this is an original reflection, draw it in RED
         if (path->isDiffusion) {
             diffusionNumber++;
@@ -507,7 +597,7 @@ void AudioReflector::drawRays() {
 
     if (Menu::getInstance()->isOptionChecked(MenuOption::AudioSpatialProcessingProcessLocalAudio)) {
         // draw the paths for local audio
-        foreach(AudioPath* const& path, _localAudioPaths) {
+        foreach(AudioPath* const& path, _reflectionsFound.localAudioPaths) {
             // if this is an original reflection, draw it in RED
             if (path->isDiffusion) {
                 diffusionNumber++;
@@ -531,22 +621,6 @@ void AudioReflector::drawPath(AudioPath* path, const glm::vec3& originalColor) {
     }
 }
 
-void AudioReflector::clearPaths() {
-    // clear our inbound audio paths
-    foreach(AudioPath* const& path, _inboundAudioPaths) {
-        delete path;
-    }
-    _inboundAudioPaths.clear();
-    _inboundAudiblePoints.clear(); // clear our inbound audible points
-
-    // clear our local audio paths
-    foreach(AudioPath* const& path, _localAudioPaths) {
-        delete path;
-    }
-    _localAudioPaths.clear();
-    _localAudiblePoints.clear(); // clear our local audible points
-}
-
 // Here's how this works: we have an array of AudioPaths, we loop on all of our currently calculating audio 
 // paths, and calculate one ray per path. If that ray doesn't reflect, or reaches a max distance/attenuation, then it
 // is considered finalized.
@@ -554,13 +628,18 @@ void AudioReflector::clearPaths() {
 // attenuation, path length, and delay for the primary path. For surfaces that have diffusion, it will also create
 // fanout number of new paths, those new paths will have an origin of the reflection point, and an initial attenuation
 // of their diffusion ratio. Those new paths will be added to the active audio paths, and be analyzed for the next loop.
-void AudioReflector::analyzePaths() {
-    clearPaths();
+// Once all of the paths are finished, the audible points are turned into an impulse response for each ear, still on
+// the worker thread, so that all the audio thread has left to do is a convolution per ear.
+void AudioReflector::analyzePaths(const AudioReflectorParameters& parameters) {
+    quint64 start = usecTimestampNow();
+    AudioReflections reflections;
     
     // add our initial paths
-    glm::vec3 right = glm::normalize(_orientation * IDENTITY_RIGHT);
-    glm::vec3 up = glm::normalize(_orientation * IDENTITY_UP);
-    glm::vec3 front = glm::normalize(_orientation * IDENTITY_FRONT);
+    glm::quat orientation = parameters.orientation;
+    glm::vec3 origin = parameters.origin;
+    glm::vec3 right = glm::normalize(orientation * IDENTITY_RIGHT);
+    glm::vec3 up = glm::normalize(orientation * IDENTITY_UP);
+    glm::vec3 front = glm::normalize(orientation * IDENTITY_FRONT);
     glm::vec3 left = -right;
     glm::vec3 down = -up;
     glm::vec3 back = -front;
@@ -575,54 +654,97 @@ void AudioReflector::analyzePaths() {
 
     float initialAttenuation = 1.0f;    
 
-    float preDelay = Menu::getInstance()->isOptionChecked(MenuOption::AudioSpatialProcessingPreDelay) ? _preDelay : 0.0f;
+    float preDelay = parameters.preDelay;
 
     // NOTE: we're still calculating our initial paths based on the listeners position. But the analysis code has been
     // updated to support individual sound sources (which is how we support diffusion), we can use this new paradigm to
     // add support for individual sound sources, and more directional sound sources    
 
-    addAudioPath(INBOUND_AUDIO, _origin, front, initialAttenuation, preDelay);
-    addAudioPath(INBOUND_AUDIO, _origin, right, initialAttenuation, preDelay);
-    addAudioPath(INBOUND_AUDIO, _origin, up, initialAttenuation, preDelay);
-    addAudioPath(INBOUND_AUDIO, _origin, down, initialAttenuation, preDelay);
-    addAudioPath(INBOUND_AUDIO, _origin, back, initialAttenuation, preDelay);
-    addAudioPath(INBOUND_AUDIO, _origin, left, initialAttenuation, preDelay);
-    addAudioPath(INBOUND_AUDIO, _origin, frontRightUp, initialAttenuation, preDelay);
-    addAudioPath(INBOUND_AUDIO, _origin, frontLeftUp, initialAttenuation, preDelay);
-    addAudioPath(INBOUND_AUDIO, _origin, backRightUp, initialAttenuation, preDelay);
-    addAudioPath(INBOUND_AUDIO, _origin, backLeftUp, initialAttenuation, preDelay);
-    addAudioPath(INBOUND_AUDIO, _origin, frontRightDown, initialAttenuation, preDelay);
-    addAudioPath(INBOUND_AUDIO, _origin, frontLeftDown, initialAttenuation, preDelay);
-    addAudioPath(INBOUND_AUDIO, _origin, backRightDown, initialAttenuation, preDelay);
-    addAudioPath(INBOUND_AUDIO, _origin, backLeftDown, initialAttenuation, preDelay);
+    addAudioPath(reflections, INBOUND_AUDIO, origin, front, initialAttenuation, preDelay);
+    addAudioPath(reflections, INBOUND_AUDIO, origin, right, initialAttenuation, preDelay);
+    addAudioPath(reflections, INBOUND_AUDIO, origin, up, initialAttenuation, preDelay);
+    addAudioPath(reflections, INBOUND_AUDIO, origin, down, initialAttenuation, preDelay);
+    addAudioPath(reflections, INBOUND_AUDIO, origin, back, initialAttenuation, preDelay);
+    addAudioPath(reflections, INBOUND_AUDIO, origin, left, initialAttenuation, preDelay);
+    addAudioPath(reflections, INBOUND_AUDIO, origin, frontRightUp, initialAttenuation, preDelay);
+    addAudioPath(reflections, INBOUND_AUDIO, origin, frontLeftUp, initialAttenuation, preDelay);
+    addAudioPath(reflections, INBOUND_AUDIO, origin, backRightUp, initialAttenuation, preDelay);
+    addAudioPath(reflections, INBOUND_AUDIO, origin, backLeftUp, initialAttenuation, preDelay);
+    addAudioPath(reflections, INBOUND_AUDIO, origin, frontRightDown, initialAttenuation, preDelay);
+    addAudioPath(reflections, INBOUND_AUDIO, origin, frontLeftDown, initialAttenuation, preDelay);
+    addAudioPath(reflections, INBOUND_AUDIO, origin, backRightDown, initialAttenuation, preDelay);
+    addAudioPath(reflections, INBOUND_AUDIO, origin, backLeftDown, initialAttenuation, preDelay);
     
     // the original paths for the local audio are directional to the front of the origin
-    addAudioPath(LOCAL_AUDIO, _origin, front, initialAttenuation, preDelay);
-    addAudioPath(LOCAL_AUDIO, _origin, frontRightUp, initialAttenuation, preDelay);
-    addAudioPath(LOCAL_AUDIO, _origin, frontLeftUp, initialAttenuation, preDelay);
-    addAudioPath(LOCAL_AUDIO, _origin, frontRightDown, initialAttenuation, preDelay);
-    addAudioPath(LOCAL_AUDIO, _origin, frontLeftDown, initialAttenuation, preDelay);
+    addAudioPath(reflections, LOCAL_AUDIO, origin, front, initialAttenuation, preDelay);
+    addAudioPath(reflections, LOCAL_AUDIO, origin, frontRightUp, initialAttenuation, preDelay);
+    addAudioPath(reflections, LOCAL_AUDIO, origin, frontLeftUp, initialAttenuation, preDelay);
+    addAudioPath(reflections, LOCAL_AUDIO, origin, frontRightDown, initialAttenuation, preDelay);
+    addAudioPath(reflections, LOCAL_AUDIO, origin, frontLeftDown, initialAttenuation, preDelay);
 
     // loop through all our audio paths and keep analyzing them until they complete
     int steps = 0;
-    int acitvePaths = _inboundAudioPaths.size() + _localAudioPaths.size(); // when we start, all paths are active
+    int acitvePaths = reflections.inboundAudioPaths.size() + reflections.localAudioPaths.size(); // when we start, all paths are active
     while(acitvePaths > 0) {
-        acitvePaths = analyzePathsSingleStep();
+        acitvePaths = analyzePathsSingleStep(reflections, parameters);
         steps++;
     }
-    _reflections = _inboundAudiblePoints.size() + _localAudiblePoints.size();
-    _diffusionPathCount = countDiffusionPaths();
+
+    EchoStatistics statistics;
+    int inboundEchoesSuppressed;
+    int localEchoesSuppressed;
+    int inboundEchoes = calculateImpulseResponses(parameters, reflections.inboundAudiblePoints,
+                                                  reflections.inboundResponses, inboundEchoesSuppressed, statistics);
+    int localEchoes = calculateImpulseResponses(parameters, reflections.localAudiblePoints,
+                                                reflections.localResponses, localEchoesSuppressed, statistics);
+
+    {
+        QMutexLocker locker(&_mutex);
+        qSwap(_reflectionsFound.inboundAudioPaths, reflections.inboundAudioPaths);
+        qSwap(_reflectionsFound.inboundAudiblePoints, reflections.inboundAudiblePoints);
+        qSwap(_reflectionsFound.localAudioPaths, reflections.localAudioPaths);
+        qSwap(_reflectionsFound.localAudiblePoints, reflections.localAudiblePoints);
+        for (int ear = 0; ear < NUMBER_OF_CHANNELS; ear++) {
+            _reflectionsFound.inboundResponses[ear] = reflections.inboundResponses[ear];
+            _reflectionsFound.localResponses[ear] = reflections.localResponses[ear];
+        }
+
+        _reflections = _reflectionsFound.inboundAudiblePoints.size() + _reflectionsFound.localAudiblePoints.size();
+        _diffusionPathCount = countDiffusionPaths(_reflectionsFound);
+
+        _inboundEchoesCount = inboundEchoes;
+        _inboundEchoesSuppressedCount = inboundEchoesSuppressed;
+        _localEchoesCount = localEchoes;
+        _localEchoesSuppressedCount = localEchoesSuppressed;
+
+        _officialAverageDelay = statistics.delayCount == 0 ? 0.0f : statistics.totalDelay / statistics.delayCount;
+        _officialAverageAttenuation = statistics.attenuationCount == 0
+            ? 0.0f : statistics.totalAttenuation / statistics.attenuationCount;
+        _officialMaxDelay = statistics.maxDelay;
+        _officialMaxAttenuation = statistics.maxAttenuation;
+        _officialMinDelay = statistics.delayCount == 0 ? 0.0f : statistics.minDelay;
+        _officialMinAttenuation = statistics.attenuationCount == 0 ? 0.0f : statistics.minAttenuation;
+
+        _isAnalyzing = false;
+    }
+    // the paths of the analysis before this one were swapped into reflections, and go with it
+
+    quint64 end = usecTimestampNow();
+    const bool wantDebugging = false;
+    if (wantDebugging) {
+        qDebug() << "analyzePaths() steps=" << steps << "elapsed=" << (end - start);
+    }
 }
 
-int AudioReflector::countDiffusionPaths() {
+int AudioReflector::countDiffusionPaths(const AudioReflections& reflections) {
     int diffusionCount = 0;
     
-    foreach(AudioPath* const& path, _inboundAudioPaths) {
+    foreach(AudioPath* const& path, reflections.inboundAudioPaths) {
         if (path->isDiffusion) {
             diffusionCount++;
         }
     }
-    foreach(AudioPath* const& path, _localAudioPaths) {
+    foreach(AudioPath* const& path, reflections.localAudioPaths) {
         if (path->isDiffusion) {
             diffusionCount++;
         }
@@ -630,47 +752,58 @@ int AudioReflector::countDiffusionPaths() {
     return diffusionCount;
 }
 
-int AudioReflector::analyzePathsSingleStep() {
+int AudioReflector::analyzePathsSingleStep(AudioReflections& reflections, const AudioReflectorParameters& parameters) {
     // iterate all the active sound paths, calculate one step per active path
     int activePaths = 0;
 
-    QVector<AudioPath*>* pathsLists[] = { &_inboundAudioPaths, &_localAudioPaths };
+    QVector<AudioPath*>* pathsLists[] = { &reflections.inboundAudioPaths, &reflections.localAudioPaths };
 
     for(unsigned int i = 0; i < sizeof(pathsLists) / sizeof(pathsLists[0]); i++) {
 
         QVector<AudioPath*>& pathList = *pathsLists[i];
 
-        foreach(AudioPath* const& path, pathList) {
-    
-            glm::vec3 start = path->lastPoint;
-            glm::vec3 direction = path->lastDirection;
-            OctreeElement* elementHit; // output from findRayIntersection
-            float distance; // output from findRayIntersection
-            BoxFace face; // output from findRayIntersection
+        // diffusions add paths to the list as it goes, they start on the next step
+        int numberOfPaths = pathList.size();
 
+        // the paths still bouncing are picked against the voxels together, under one lock
+        QVector<AudioPath*> pickedPaths;
+        QVector<OctreeRayPick> picks;
+        for (int j = 0; j < numberOfPaths; j++) {
+            AudioPath* path = pathList[j];
             if (!path->finalized) {
                 activePaths++;
-            
+
                 if (path->bounceCount > ABSOLUTE_MAXIMUM_BOUNCE_COUNT) {
                     path->finalized = true;
-                } else if (_voxels->findRayIntersection(start, direction, elementHit, distance, face)) {
-                    // TODO: we need to decide how we want to handle locking on the ray intersection, if we force lock,
-                    // we get an accurate picture, but it could prevent rendering of the voxels. If we trylock (default), 
-                    // we might not get ray intersections where they may exist, but we can't really detect that case...
-                    // add last parameter of Octree::Lock to force locking
-                    handlePathPoint(path, distance, elementHit, face);
+                } else {
+                    pickedPaths.append(path);
+                    picks.append(OctreeRayPick(path->lastPoint, path->lastDirection));
+                }
+            }
+        }
 
+        // TODO: we need to decide how we want to handle locking on the ray intersection, if we force lock,
+        // we get an accurate picture, but it could prevent rendering of the voxels. If we trylock (default), 
+        // we might not get ray intersections where they may exist, but we can't really detect that case...
+        // add last parameter of Octree::Lock to force locking
+        _voxels->findRayIntersections(picks);
+
+        for (int j = 0; j < pickedPaths.size(); j++) {
+            AudioPath* path = pickedPaths[j];
+            const OctreeRayPick& pick = picks.at(j);
+            if (pick.intersects) {
+                handlePathPoint(reflections, parameters, path, pick.distance, pick.element, pick.face);
+
+            } else {
+                // If we didn't intersect, but this was a diffusion ray, then we will go ahead and cast a short ray out
+                // from our last known point, in the last known direction, and leave that sound source hanging there
+                if (path->isDiffusion) {
+                    const float MINIMUM_RANDOM_DISTANCE = 0.25f;
+                    const float MAXIMUM_RANDOM_DISTANCE = 0.5f;
+                    float distance = randFloatInRange(MINIMUM_RANDOM_DISTANCE, MAXIMUM_RANDOM_DISTANCE);
+                    handlePathPoint(reflections, parameters, path, distance, NULL, UNKNOWN_FACE);
                 } else {
-                    // If we didn't intersect, but this was a diffusion ray, then we will go ahead and cast a short ray out
-                    // from our last known point, in the last known direction, and leave that sound source hanging there
-                    if (path->isDiffusion) {
-                        const float MINIMUM_RANDOM_DISTANCE = 0.25f;
-                        const float MAXIMUM_RANDOM_DISTANCE = 0.5f;
-                        float distance = randFloatInRange(MINIMUM_RANDOM_DISTANCE, MAXIMUM_RANDOM_DISTANCE);
-                        handlePathPoint(path, distance, NULL, UNKNOWN_FACE);
-                    } else {
-                        path->finalized = true; // if it doesn't intersect, then it is finished
-                    }
+                    path->finalized = true; // if it doesn't intersect, then it is finished
                 }
             }
         }
@@ -678,7 +811,8 @@ int AudioReflector::analyzePathsSingleStep() {
     return activePaths;
 }
 
-void AudioReflector::handlePathPoint(AudioPath* path, float distance, OctreeElement* elementHit, BoxFace face) {
+void AudioReflector::handlePathPoint(AudioReflections& reflections, const AudioReflectorParameters& parameters,
+                                     AudioPath* path, float distance, OctreeElement* elementHit, BoxFace face) {
     glm::vec3 start = path->lastPoint;
     glm::vec3 direction = path->lastDirection;
     glm::vec3 end = start + (direction * (distance * SLIGHTLY_SHORT));
@@ -689,26 +823,25 @@ void AudioReflector::handlePathPoint(AudioPath* path, float distance, OctreeElem
 
     pathDistance += glm::distance(start, end);
 
-    float toListenerDistance = glm::distance(end, _listenerPosition);
+    float toListenerDistance = glm::distance(end, parameters.listenerPosition);
 
     // adjust our current delay by just the delay from the most recent ray
-    currentDelay += getDelayFromDistance(distance);
+    currentDelay += getDelayFromDistance(parameters, distance);
 
     // now we know the current attenuation for the "perfect" reflection case, but we now incorporate
     // our surface materials to determine how much of this ray is absorbed, reflected, and diffused
-    SurfaceCharacteristics material = getSurfaceCharacteristics(elementHit);
+    SurfaceCharacteristics material = getSurfaceCharacteristics(parameters, elementHit);
 
     float reflectiveAttenuation = currentReflectiveAttenuation * material.reflectiveRatio;
     float totalDiffusionAttenuation = currentReflectiveAttenuation * material.diffusionRatio;
     
-    bool wantDiffusions = Menu::getInstance()->isOptionChecked(MenuOption::AudioSpatialProcessingWithDiffusions);
-    int fanout = wantDiffusions ? _diffusionFanout : 0;
+    int fanout = parameters.diffusionFanout;
 
     float partialDiffusionAttenuation = fanout < 1 ? 0.0f : totalDiffusionAttenuation / (float)fanout;
 
     // total delay includes the bounce back to listener
-    float totalDelay = currentDelay + getDelayFromDistance(toListenerDistance);
-    float toListenerAttenuation = getDistanceAttenuationCoefficient(toListenerDistance + pathDistance);
+    float totalDelay = currentDelay + getDelayFromDistance(parameters, toListenerDistance);
+    float toListenerAttenuation = getDistanceAttenuationCoefficient(parameters, toListenerDistance + pathDistance);
 
     // if our resulting partial diffusion attenuation, is still above our minimum attenuation
     // then we add new paths for each diffusion point
@@ -750,7 +883,7 @@ void AudioReflector::handlePathPoint(AudioPath* path, float distance, OctreeElem
             diffusion = glm::normalize(diffusion);
 
             // add new audio path for these diffusions, the new path's source is the same as the original source
-            addAudioPath(path->source, end, diffusion, partialDiffusionAttenuation, currentDelay, pathDistance, true);
+            addAudioPath(reflections, path->source, end, diffusion, partialDiffusionAttenuation, currentDelay, pathDistance, true);
         }
     } else {
         const bool wantDebugging = false;
@@ -781,7 +914,8 @@ void AudioReflector::handlePathPoint(AudioPath* path, float distance, OctreeElem
         // audio so that it can be adjusted to ear position
         AudiblePoint point = {end, currentDelay, (reflectiveAttenuation + totalDiffusionAttenuation), pathDistance};
 
-        QVector<AudiblePoint>& audiblePoints = path->source == INBOUND_AUDIO ? _inboundAudiblePoints : _localAudiblePoints;
+        QVector<AudiblePoint>& audiblePoints = path->source == INBOUND_AUDIO
+            ? reflections.inboundAudiblePoints : reflections.localAudiblePoints;
 
         audiblePoints.push_back(point);
     
@@ -790,7 +924,7 @@ void AudioReflector::handlePathPoint(AudioPath* path, float distance, OctreeElem
     
         // now, if our reflective attenuation is over our minimum then keep going...
         if (reflectiveAttenuation * toListenerAttenuation > MINIMUM_ATTENUATION_TO_REFLECT) {
-            glm::vec3 faceNormal = getFaceNormal(face);
+            glm::vec3 faceNormal = getFaceNormal(parameters, face);
             path->lastDirection = glm::normalize(glm::reflect(direction,faceNormal));
             path->lastPoint = end;
             path->lastAttenuation = reflectiveAttenuation;
@@ -823,9 +957,9 @@ void AudioReflector::handlePathPoint(AudioPath* path, float distance, OctreeElem
 // TODO: eventually we will add support for different surface characteristics based on the element
 // that is hit, which is why we pass in the elementHit to this helper function. But for now, all
 // surfaces have the same characteristics
-SurfaceCharacteristics AudioReflector::getSurfaceCharacteristics(OctreeElement* elementHit) {
-    SurfaceCharacteristics result = { getReflectiveRatio(), _absorptionRatio, _diffusionRatio };
-    return result;
+SurfaceCharacteristics AudioReflector::getSurfaceCharacteristics(const AudioReflectorParameters& parameters,
+                                                                 OctreeElement* elementHit) {
+    return parameters.surface;
 }
 
 void AudioReflector::setReflectiveRatio(float ratio) { 
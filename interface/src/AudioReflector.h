@@ -13,7 +13,9 @@
 #define interface_AudioReflector_h
 
 #include <QMutex>
+#include <QThreadPool>
 
+#include <AudioConvolver.h>
 #include <VoxelTree.h>
 
 #include "Audio.h"
@@ -64,10 +66,47 @@ public:
     float diffusionRatio;
 };
 
+/// everything the analysis of the reflections depends on, taken from the menu and the avatar on the main thread so
+/// that the analysis can run on a worker thread
+class AudioReflectorParameters {
+public:
+    glm::vec3 origin;
+    glm::quat orientation;
+    glm::vec3 listenerPosition;
+    glm::vec3 leftEarPosition;
+    glm::vec3 rightEarPosition;
+
+    float preDelay; // zero unless pre-delay is on
+    float soundMsPerMeter;
+    bool withDistanceAttenuation;
+    bool withAlternateDistanceAttenuation;
+    float distanceAttenuationScalingFactor;
+    bool withSlightlyRandomSurfaces;
+    int diffusionFanout; // zero unless diffusions are on
+    SurfaceCharacteristics surface;
+    float combFilterWindow;
+};
+
+/// the paths and audible points found by one analysis, and the impulse responses to each ear they add up to
+class AudioReflections {
+public:
+    AudioReflections();
+    ~AudioReflections();
+
+    QVector<AudioPath*> inboundAudioPaths;
+    QVector<AudiblePoint> inboundAudiblePoints;
+    QVector<AudioPath*> localAudioPaths;
+    QVector<AudiblePoint> localAudiblePoints;
+
+    AudioImpulseResponsePointer inboundResponses[2]; // left ear then right ear
+    AudioImpulseResponsePointer localResponses[2];
+};
+
 class AudioReflector : public QObject {
     Q_OBJECT
 public:
     AudioReflector(QObject* parent = NULL);
+    ~AudioReflector();
 
     // setup functions to configure the resources used by the AudioReflector
     void setVoxels(VoxelTree* voxels) { _voxels = voxels; }
@@ -75,7 +114,7 @@ public:
     void setAudio(Audio* audio) { _audio = audio; }
     void setAvatarManager(AvatarManager* avatarManager) { _avatarManager = avatarManager; }
 
-    void render(); /// must be called in the application render loop
+    void render(); /// must be called in the application render loop, starts a new analysis when one is needed
     
     void preProcessOriginalInboundAudio(unsigned int sampleTime, QByteArray& samples, const QAudioFormat& format);
     void processInboundAudio(unsigned int sampleTime, const QByteArray& samples, const QAudioFormat& format);
@@ -149,70 +188,82 @@ private:
     // Helpers for drawing
     void drawVector(const glm::vec3& start, const glm::vec3& end, const glm::vec3& color);
 
-    // helper for generically calculating attenuation based on distance
-    float getDistanceAttenuationCoefficient(float distance);
+    // helpers for generically calculating delay and attenuation based on distance, with the parameters of an analysis
+    float getDelayFromDistance(const AudioReflectorParameters& parameters, float distance);
+    float getDistanceAttenuationCoefficient(const AudioReflectorParameters& parameters, float distance);
 
     // statistics
     int _reflections;
     int _diffusionPathCount;
-    int _delayCount;
-    float _totalDelay;
-    float _averageDelay;
-    float _maxDelay;
-    float _minDelay;
     float _officialAverageDelay;
     float _officialMaxDelay;
     float _officialMinDelay;
-    int _attenuationCount;
-    float _totalAttenuation;
-    float _averageAttenuation;
-    float _maxAttenuation;
-    float _minAttenuation;
     float _officialAverageAttenuation;
     float _officialMaxAttenuation;
     float _officialMinAttenuation;
-
+    int _inboundEchoesCount;
+    int _inboundEchoesSuppressedCount;
+    int _localEchoesCount;
+    int _localEchoesSuppressedCount;
 
     glm::vec3 _listenerPosition;
     glm::vec3 _origin;
     glm::quat _orientation;
-    
-    QVector<AudioPath*> _inboundAudioPaths; /// audio paths we're processing for inbound audio
-    QVector<AudiblePoint> _inboundAudiblePoints; /// the audible points that have been calculated from the inbound audio paths
-    QMap<float, float> _inboundAudioDelays; /// delay times for currently injected audio points
-    QVector<float> _inboundEchoesSuppressed; /// delay times for currently injected audio points
-    int _inboundEchoesCount;
-    int _inboundEchoesSuppressedCount;
 
-    QVector<AudioPath*> _localAudioPaths; /// audio paths we're processing for local audio
-    QVector<AudiblePoint> _localAudiblePoints; /// the audible points that have been calculated from the local audio paths
-    QMap<float, float> _localAudioDelays; /// delay times for currently injected audio points
-    QVector<float> _localEchoesSuppressed; /// delay times for currently injected audio points
-    int _localEchoesCount;
-    int _localEchoesSuppressedCount;
+    AudioReflections _reflectionsFound; /// the results of the last analysis to finish, for rendering and echoing
+
+    // the paths are traced on a worker thread, one analysis at a time
+    friend class AudioReflectionAnalyzer;
+    QThreadPool _analysisThreadPool;
+    bool _isAnalyzing;
+
+    // the echoes of each source, left ear then right ear - only used from the audio thread
+    AudioConvolver* _inboundConvolvers[2];
+    AudioConvolver* _localConvolvers[2];
+    QVector<float> _echoSamples[2];
 
     // adds a sound source to begin an audio path trace, these can be the initial sound sources with their directional properties,
     // as well as diffusion sound sources
-    void addAudioPath(AudioSource source, const glm::vec3& origin, const glm::vec3& initialDirection, float initialAttenuation, 
-                            float initialDelay, float initialDistance = 0.0f, bool isDiffusion = false);
+    void addAudioPath(AudioReflections& reflections, AudioSource source, const glm::vec3& origin,
+                      const glm::vec3& initialDirection, float initialAttenuation, float initialDelay,
+                      float initialDistance = 0.0f, bool isDiffusion = false);
     
     // helper that handles audioPath analysis
-    int analyzePathsSingleStep();
-    void handlePathPoint(AudioPath* path, float distance, OctreeElement* elementHit, BoxFace face);
-    void clearPaths();
-    void analyzePaths();
+    int analyzePathsSingleStep(AudioReflections& reflections, const AudioReflectorParameters& parameters);
+    void handlePathPoint(AudioReflections& reflections, const AudioReflectorParameters& parameters, AudioPath* path,
+                         float distance, OctreeElement* elementHit, BoxFace face);
+    void analyzePaths(const AudioReflectorParameters& parameters); /// runs on the worker thread
     void drawRays();
     void drawPath(AudioPath* path, const glm::vec3& originalColor);
     void calculateAllReflections();
-    int countDiffusionPaths();
-    glm::vec3 getFaceNormal(BoxFace face);
+    int countDiffusionPaths(const AudioReflections& reflections);
+    glm::vec3 getFaceNormal(const AudioReflectorParameters& parameters, BoxFace face);
     void identifyAudioSources();
 
-    void injectAudiblePoint(AudioSource source, const AudiblePoint& audiblePoint, const QByteArray& samples, unsigned int sampleTime, int sampleRate);
+    /// the statistics of the echoes an impulse response is made of, gathered over both sources
+    class EchoStatistics {
+    public:
+        EchoStatistics();
+        int delayCount;
+        float totalDelay;
+        float maxDelay;
+        float minDelay;
+        int attenuationCount;
+        float totalAttenuation;
+        float maxAttenuation;
+        float minAttenuation;
+    };
+
+    /// adds every audible point to the responses to each ear, leaving out those that would comb filter with another,
+    /// and returns the number of echoes that were left in
+    int calculateImpulseResponses(const AudioReflectorParameters& parameters, const QVector<AudiblePoint>& audiblePoints,
+                                  AudioImpulseResponsePointer* responses, int& echoesSuppressed,
+                                  EchoStatistics& statistics);
     void echoAudio(AudioSource source, unsigned int sampleTime, const QByteArray& samples, const QAudioFormat& format);
     
     // return the surface characteristics of the element we hit
-    SurfaceCharacteristics getSurfaceCharacteristics(OctreeElement* elementHit = NULL);
+    SurfaceCharacteristics getSurfaceCharacteristics(const AudioReflectorParameters& parameters,
+                                                     OctreeElement* elementHit = NULL);
     
     
     QMutex _mutex;
@@ -246,8 +297,10 @@ private:
     float _lastDiffusionRatio;
     bool _lastDontDistanceAttenuate;
     bool _lastAlternateDistanceAttenuate;
-    
-    int _injectedEchoes;
+    bool _lastWithPreDelay;
+    bool _lastSeparateEars;
+    bool _lastSlightlyRandomSurfaces;
+    float _lastCombFilterWindow;
 };
 
 
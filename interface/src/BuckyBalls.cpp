@@ -24,10 +24,14 @@ const float BBALLS_ATTRACTION_DISTANCE = SIZE_BBALLS / 2.f;
 const float COLLISION_RADIUS = 0.01f;
 const float INITIAL_VELOCITY = 0.3f;
 
+// the balls step at a fixed rate whatever the frame rate, catching up on no more than a tenth of a second at a time
+const float BBALLS_STEP_TIME = 1.0f / 120.0f;
+const int MAX_BBALLS_STEPS_PER_SIMULATE = 12;
+
 glm::vec3 colors[NUM_ELEMENTS];
 
 // Make some bucky balls for the avatar
-BuckyBalls::BuckyBalls() {
+BuckyBalls::BuckyBalls() : _timestep(BBALLS_STEP_TIME, MAX_BBALLS_STEPS_PER_SIMULATE) {
     _bballIsGrabbed[0] = 0;
     _bballIsGrabbed[1] = 0;
     colors[0] = glm::vec3(0.13f, 0.55f, 0.13f);
@@ -37,6 +41,7 @@ BuckyBalls::BuckyBalls() {
     qDebug("Creating buckyballs...");
     for (int i = 0; i < NUM_BBALLS; i++) {
         _bballPosition[i] = CORNER_BBALLS + randVector() * RANGE_BBALLS;
+        _bballLastPosition[i] = _bballPosition[i];
         int element = (rand() % NUM_ELEMENTS);
         if (element == 0) {
             _bballRadius[i] = SIZE_BBALLS;
@@ -95,6 +100,15 @@ const float ATTRACTION_BLEND_RATE = 0.9f;
 const float ATTRACTION_VELOCITY_BLEND_RATE = 0.10f;
 
 void BuckyBalls::simulate(float deltaTime, const HandData* handData) {
+    for (int steps = _timestep.update(deltaTime); steps > 0; steps--) {
+        for (int i = 0; i < NUM_BBALLS; i++) {
+            _bballLastPosition[i] = _bballPosition[i];
+        }
+        step(_timestep.getStepTime(), handData);
+    }
+}
+
+void BuckyBalls::step(float deltaTime, const HandData* handData) {
     //  First, update the grab behavior from the hand controllers
     for (size_t i = 0; i < handData->getNumPalms(); ++i) {
         PalmData palm = handData->getPalms()[i];
@@ -161,6 +175,7 @@ void BuckyBalls::simulate(float deltaTime, const HandData* handData) {
 }
 
 void BuckyBalls::render() {
+    // draw the balls between their last two steps, as far along as the time since the last step
     glEnable(GL_LIGHTING);
     for (int i = 0; i < NUM_BBALLS; i++) {
         if (_bballColliding[i] > 0.f) {
@@ -170,7 +185,8 @@ void BuckyBalls::render() {
             glColor3f(_bballColor[i].x, _bballColor[i].y, _bballColor[i].z);
         }
         glPushMatrix();
-        glTranslatef(_bballPosition[i].x, _bballPosition[i].y, _bballPosition[i].z);
+        glm::vec3 position = glm::mix(_bballLastPosition[i], _bballPosition[i], _timestep.getInterpolation());
+        glTranslatef(position.x, position.y, position.z);
         glutSolidSphere(_bballRadius[i], 15, 15);
         glPopMatrix();
     }
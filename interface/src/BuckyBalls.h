@@ -17,6 +17,7 @@
 #include <glm/glm.hpp>
 
 #include <HandData.h>
+#include <FixedTimestep.h>
 #include <SharedUtil.h>
 
 #include "GeometryUtil.h"
@@ -34,8 +35,11 @@ public:
 
     
 private:
- 
+    void step(float deltaTime, const HandData* handData);
+
+    FixedTimestep _timestep;
     glm::vec3 _bballPosition[NUM_BBALLS];
+    glm::vec3 _bballLastPosition[NUM_BBALLS]; /// before the last step, for interpolating
     glm::vec3 _bballVelocity[NUM_BBALLS];
     glm::vec3 _bballColor[NUM_BBALLS];
     float _bballRadius[NUM_BBALLS];
@@ -36,11 +36,7 @@ void DatagramProcessor::processDatagrams() {
     Application* application = Application::getInstance();
     NodeList* nodeList = NodeList::getInstance();
     
-    while (NodeList::getInstance()->getNodeSocket().hasPendingDatagrams()) {
-        incomingPacket.resize(nodeList->getNodeSocket().pendingDatagramSize());
-        nodeList->getNodeSocket().readDatagram(incomingPacket.data(), incomingPacket.size(),
-                                               senderSockAddr.getAddressPointer(), senderSockAddr.getPortPointer());
-        
+    while (nodeList->readPendingDatagram(incomingPacket, senderSockAddr)) {
         _packetCount++;
         _byteCount += incomingPacket.size();
         
@@ -48,6 +44,7 @@ void DatagramProcessor::processDatagrams() {
             // only process this packet if we have a match on the packet version
             switch (packetTypeForPacket(incomingPacket)) {
                 case PacketTypeMixedAudio:
+                case PacketTypeSilentMixedAudio:
                     QMetaObject::invokeMethod(&application->_audio, "addReceivedAudioToBuffer", Qt::QueuedConnection,
                                               Q_ARG(QByteArray, incomingPacket));
                     break;
@@ -74,7 +71,7 @@ void DatagramProcessor::processDatagrams() {
                 case PacketTypeOctreeStats:
                 case PacketTypeEnvironmentData: {
                     PerformanceWarning warn(Menu::getInstance()->isOptionChecked(MenuOption::PipelineWarnings),
-                                            "Application::networkReceive()... _octreeProcessor.queueReceivedPacket()");
+                                            "Application::networkReceive()... queueReceivedPacket()");
                     
                     bool wantExtraDebugging = application->getLogger()->extraDebugging();
                     if (wantExtraDebugging && packetTypeForPacket(incomingPacket) == PacketTypeVoxelData) {
@@ -94,8 +91,9 @@ void DatagramProcessor::processDatagrams() {
                     SharedNodePointer matchedNode = NodeList::getInstance()->sendingNodeForPacket(incomingPacket);
                     
                     if (matchedNode) {
-                        // add this packet to our list of voxel packets and process them on the voxel processing
-                        application->_octreeProcessor.queueReceivedPacket(matchedNode, incomingPacket);
+                        // add this packet to the packets of its server's type, to be processed on their own thread
+                        application->getOctreePacketProcessor(matchedNode->getType()).queueReceivedPacket(matchedNode,
+                                                                                                          incomingPacket);
                     }
                     
                     break;
@@ -106,7 +104,8 @@ void DatagramProcessor::processDatagrams() {
                 case PacketTypeBulkAvatarData:
                 case PacketTypeKillAvatar:
                 case PacketTypeAvatarIdentity:
-                case PacketTypeAvatarBillboard: {
+                case PacketTypeAvatarBillboard:
+                case PacketTypeAvatarContentHashes: {
                     // update having heard from the avatar-mixer and record the bytes received
                     SharedNodePointer avatarMixer = nodeList->sendingNodeForPacket(incomingPacket);
                     
@@ -114,9 +113,8 @@ void DatagramProcessor::processDatagrams() {
                         avatarMixer->setLastHeardMicrostamp(usecTimestampNow());
                         avatarMixer->recordBytesReceived(incomingPacket.size());
                         
-                        QMetaObject::invokeMethod(&application->getAvatarManager(), "processAvatarMixerDatagram",
-                                                  Q_ARG(const QByteArray&, incomingPacket),
-                                                  Q_ARG(const QWeakPointer<Node>&, avatarMixer));
+                        // the avatar manager takes all that arrived during a frame at the start of the next
+                        application->getAvatarManager().queueAvatarMixerDatagram(incomingPacket, avatarMixer);
                     }
                     
                     application->_bandwidthMeter.inputStream(BandwidthMeter::AVATARS).updateValue(incomingPacket.size());
@@ -148,6 +146,10 @@ void DatagramProcessor::processDatagrams() {
                     }
                     break;
                 }
+                case PacketTypeOctreeQueryAck:
+                    QMetaObject::invokeMethod(application, "octreeQueryAcknowledged", Qt::QueuedConnection,
+                        Q_ARG(QByteArray, incomingPacket));
+                    break;
                 case PacketTypeVoxelEditNack:
                     if (!Menu::getInstance()->isOptionChecked(MenuOption::DisableNackPackets)) {
                         application->_voxelEditSender.processNackPacket(incomingPacket);
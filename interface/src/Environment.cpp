@@ -13,6 +13,7 @@
 
 #include <QByteArray>
 #include <QMutexLocker>
+#include <QVector>
 #include <QtDebug>
 
 #include <GeometryUtil.h>
@@ -41,8 +42,12 @@ Environment::Environment()
 
 Environment::~Environment() {
     if (_initialized) {
-        delete _skyFromAtmosphereProgram;
-        delete _skyFromSpaceProgram;
+        delete _skyProgram;
+    }
+    foreach (const ServerScatteringTables& tables, _scatteringTables) {
+        foreach (const ScatteringTable& table, tables) {
+            glDeleteTextures(1, &table.texture);
+        }
     }
 }
 
@@ -52,8 +57,21 @@ void Environment::init() {
         return;
     }
 
-    _skyFromAtmosphereProgram = createSkyProgram("Atmosphere", _skyFromAtmosphereUniformLocations);
-    _skyFromSpaceProgram = createSkyProgram("Space", _skyFromSpaceUniformLocations);
+    _skyProgram = new ProgramObject();
+    _skyProgram->addShaderFromSourceFile(QGLShader::Vertex,
+        Application::resourcesPath() + "shaders/sky_scattering.vert");
+    _skyProgram->addShaderFromSourceFile(QGLShader::Fragment,
+        Application::resourcesPath() + "shaders/sky_scattering.frag");
+    _skyProgram->link();
+    
+    _skyUniformLocations[SCATTERING_TABLE_LOCATION] = _skyProgram->uniformLocation("scatteringTable");
+    _skyUniformLocations[SCATTERING_SCALE_LOCATION] = _skyProgram->uniformLocation("scatteringScale");
+    _skyUniformLocations[CAMERA_POSITION_LOCATION] = _skyProgram->uniformLocation("cameraPosition");
+    _skyUniformLocations[LIGHT_DIRECTION_LOCATION] = _skyProgram->uniformLocation("lightDirection");
+    _skyUniformLocations[RAYLEIGH_COLOR_LOCATION] = _skyProgram->uniformLocation("rayleighColor");
+    _skyUniformLocations[MIE_BRIGHTNESS_LOCATION] = _skyProgram->uniformLocation("mieBrightness");
+    _skyUniformLocations[G_LOCATION] = _skyProgram->uniformLocation("g");
+    _skyUniformLocations[G2_LOCATION] = _skyProgram->uniformLocation("g2");
     
     // start off with a default-constructed environment data
     _data[HifiSockAddr()][0];
@@ -70,9 +88,29 @@ void Environment::renderAtmospheres(Camera& camera) {
     // get the lock for the duration of the call
     QMutexLocker locker(&_mutex);
     
-    foreach (const ServerData& serverData, _data) {
-        foreach (const EnvironmentData& environmentData, serverData) {
-            renderAtmosphere(camera, environmentData);
+    for (QHash<HifiSockAddr, ServerData>::const_iterator it = _data.constBegin(); it != _data.constEnd(); it++) {
+        ServerScatteringTables& tables = _scatteringTables[it.key()];
+        for (ServerData::const_iterator dataIt = it.value().constBegin(); dataIt != it.value().constEnd(); dataIt++) {
+            renderAtmosphere(camera, dataIt.value(), tables[dataIt.key()]);
+        }
+    }
+    
+    // release the tables of the environments that have gone
+    for (QHash<HifiSockAddr, ServerScatteringTables>::iterator it = _scatteringTables.begin();
+            it != _scatteringTables.end(); ) {
+        QHash<HifiSockAddr, ServerData>::const_iterator serverData = _data.constFind(it.key());
+        for (ServerScatteringTables::iterator tableIt = it.value().begin(); tableIt != it.value().end(); ) {
+            if (serverData == _data.constEnd() || !serverData.value().contains(tableIt.key())) {
+                glDeleteTextures(1, &tableIt.value().texture);
+                tableIt = it.value().erase(tableIt);
+            } else {
+                tableIt++;
+            }
+        }
+        if (it.value().isEmpty()) {
+            it = _scatteringTables.erase(it);
+        } else {
+            it++;
         }
     }
 }
@@ -186,85 +224,174 @@ int Environment::parseData(const HifiSockAddr& senderAddress, const QByteArray&
     return bytesRead;
 }
 
-ProgramObject* Environment::createSkyProgram(const char* from, int* locations) {
-    ProgramObject* program = new ProgramObject();
-    QByteArray prefix = QString(Application::resourcesPath() + "/shaders/SkyFrom" + from).toUtf8();
-    program->addShaderFromSourceFile(QGLShader::Vertex, prefix + ".vert");
-    program->addShaderFromSourceFile(QGLShader::Fragment, prefix + ".frag");
-    program->link();
+// the constants here are from Sean O'Neil's GPU Gems entry
+// (http://http.developer.nvidia.com/GPUGems2/gpugems2_chapter16.html), GameEngine.cpp
+const float SCALE_DEPTH = 0.25f;
+const float MIE_G = -0.990f;
+const int SCATTERING_SAMPLES = 2;
+
+// the table is indexed by the cosines of the rays' angles from up across, and from the sun down
+const int SCATTERING_TABLE_WIDTH = 128;
+const int SCATTERING_TABLE_HEIGHT = 32;
+
+// how far the camera may move up or down, in proportion to the thickness of the atmosphere, and the sun around its up
+// before the table is integrated again
+const float SCATTERING_TABLE_HEIGHT_TOLERANCE = 0.01f;
+const float SCATTERING_TABLE_SUN_COSINE_TOLERANCE = 0.001f;
+
+static float getScatteringScale(float cosine) {
+    float x = 1.0f - cosine;
+    return SCALE_DEPTH * expf(-0.00287f + x * (0.459f + x * (3.83f + x * (-6.80f + x * 5.25f))));
+}
+
+static glm::vec3 getInverseWavelengths(const EnvironmentData& data) {
+    const glm::vec3& wavelengths = data.getScatteringWavelengths();
+    return glm::vec3(1.0f / powf(wavelengths.r, 4.0f), 1.0f / powf(wavelengths.g, 4.0f),
+        1.0f / powf(wavelengths.b, 4.0f));
+}
+
+static bool haveSameScattering(const EnvironmentData& first, const EnvironmentData& second) {
+    return first.getAtmosphereInnerRadius() == second.getAtmosphereInnerRadius() &&
+        first.getAtmosphereOuterRadius() == second.getAtmosphereOuterRadius() &&
+        first.getRayleighScattering() == second.getRayleighScattering() &&
+        first.getMieScattering() == second.getMieScattering() &&
+        first.getScatteringWavelengths() == second.getScatteringWavelengths();
+}
+
+void Environment::updateScatteringTable(ScatteringTable& table, const EnvironmentData& data,
+        float cameraHeight, float sunCosine) {
+    float innerRadius = data.getAtmosphereInnerRadius();
+    float outerRadius = data.getAtmosphereOuterRadius();
+    float scale = 1.0f / (outerRadius - innerRadius);
+    float scaleOverScaleDepth = scale / SCALE_DEPTH;
+    glm::vec3 extinction = getInverseWavelengths(data) * (data.getRayleighScattering() * 4.0f * PI) +
+        glm::vec3(data.getMieScattering() * 4.0f * PI);
+    
+    // the camera is straight up, and the sun is tilted towards x
+    glm::vec3 cameraPosition(0.0f, cameraHeight, 0.0f);
+    float sunSine = sqrtf(qMax(1.0f - sunCosine * sunCosine, 0.0f));
+    glm::vec3 lightDirection(sunSine, sunCosine, 0.0f);
+    
+    QVector<glm::vec3> values(SCATTERING_TABLE_WIDTH * SCATTERING_TABLE_HEIGHT);
+    float maxValue = 0.0f;
+    glm::vec3* entry = values.data();
+    for (int y = 0; y < SCATTERING_TABLE_HEIGHT; y++) {
+        float raySunCosine = (y + 0.5f) * 2.0f / SCATTERING_TABLE_HEIGHT - 1.0f;
+        for (int x = 0; x < SCATTERING_TABLE_WIDTH; x++, entry++) {
+            // the ray with the angles from up and from the sun, or the closest to it if none has both
+            float rayUpCosine = (x + 0.5f) * 2.0f / SCATTERING_TABLE_WIDTH - 1.0f;
+            glm::vec3 ray(0.0f, rayUpCosine, 0.0f);
+            if (sunSine > EPSILON) {
+                ray.x = glm::clamp((raySunCosine - rayUpCosine * sunCosine) / sunSine, -1.0f, 1.0f);
+            }
+            ray.z = sqrtf(qMax(1.0f - ray.x * ray.x - ray.y * ray.y, 0.0f));
+            ray = glm::normalize(ray);
+            
+            // find where the ray enters and leaves the atmosphere
+            float halfB = glm::dot(cameraPosition, ray);
+            float determinant = halfB * halfB - (cameraHeight * cameraHeight - outerRadius * outerRadius);
+            if (determinant < 0.0f) {
+                continue;
+            }
+            float far = -halfB + sqrtf(determinant);
+            float near = qMax(-halfB - sqrtf(determinant), 0.0f);
+            if (far <= near) {
+                continue;
+            }
+            glm::vec3 start = cameraPosition + ray * near;
+            float startHeight = glm::length(start);
+            float startOffset = expf(scaleOverScaleDepth * (innerRadius - startHeight)) *
+                getScatteringScale(glm::dot(ray, start) / startHeight);
+            
+            float sampleLength = (far - near) / SCATTERING_SAMPLES;
+            float scaledLength = sampleLength * scale;
+            glm::vec3 sampleRay = ray * sampleLength;
+            glm::vec3 samplePoint = start + sampleRay * 0.5f;
+            for (int i = 0; i < SCATTERING_SAMPLES; i++) {
+                float height = glm::length(samplePoint);
+                float depth = expf(scaleOverScaleDepth * (innerRadius - height));
+                float lightAngle = glm::dot(lightDirection, samplePoint) / height;
+                float cameraAngle = glm::dot(ray, samplePoint) / height * 0.99f;
+                float scatter = startOffset + depth *
+                    (getScatteringScale(lightAngle) - getScatteringScale(cameraAngle));
+                *entry += glm::exp(-scatter * extinction) * (depth * scaledLength);
+                samplePoint += sampleRay;
+            }
+            maxValue = qMax(maxValue, qMax(entry->x, qMax(entry->y, entry->z)));
+        }
+    }
     
-    locations[CAMERA_POS_LOCATION] = program->uniformLocation("v3CameraPos");
-    locations[LIGHT_POS_LOCATION] = program->uniformLocation("v3LightPos");
-    locations[INV_WAVELENGTH_LOCATION] = program->uniformLocation("v3InvWavelength");
-    locations[CAMERA_HEIGHT2_LOCATION] = program->uniformLocation("fCameraHeight2");
-    locations[OUTER_RADIUS_LOCATION] = program->uniformLocation("fOuterRadius");
-    locations[OUTER_RADIUS2_LOCATION] = program->uniformLocation("fOuterRadius2");
-    locations[INNER_RADIUS_LOCATION] = program->uniformLocation("fInnerRadius");
-    locations[KR_ESUN_LOCATION] = program->uniformLocation("fKrESun");
-    locations[KM_ESUN_LOCATION] = program->uniformLocation("fKmESun");
-    locations[KR_4PI_LOCATION] = program->uniformLocation("fKr4PI");
-    locations[KM_4PI_LOCATION] = program->uniformLocation("fKm4PI");
-    locations[SCALE_LOCATION] = program->uniformLocation("fScale");
-    locations[SCALE_DEPTH_LOCATION] = program->uniformLocation("fScaleDepth");
-    locations[SCALE_OVER_SCALE_DEPTH_LOCATION] = program->uniformLocation("fScaleOverScaleDepth");
-    locations[G_LOCATION] = program->uniformLocation("g");
-    locations[G2_LOCATION] = program->uniformLocation("g2");
+    // sixteen bits a channel, scaled to the largest value, keeps the gradients of a dim sky smooth
+    table.scale = (maxValue > 0.0f) ? maxValue : 1.0f;
+    QVector<quint16> texels(values.size() * 3);
+    quint16* texel = texels.data();
+    const float MAX_TEXEL_VALUE = 65535.0f;
+    foreach (const glm::vec3& value, values) {
+        *texel++ = (quint16)(value.x * MAX_TEXEL_VALUE / table.scale + 0.5f);
+        *texel++ = (quint16)(value.y * MAX_TEXEL_VALUE / table.scale + 0.5f);
+        *texel++ = (quint16)(value.z * MAX_TEXEL_VALUE / table.scale + 0.5f);
+    }
+    if (table.texture == 0) {
+        glGenTextures(1, &table.texture);
+        glBindTexture(GL_TEXTURE_2D, table.texture);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    } else {
+        glBindTexture(GL_TEXTURE_2D, table.texture);
+    }
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB16, SCATTERING_TABLE_WIDTH, SCATTERING_TABLE_HEIGHT, 0,
+        GL_RGB, GL_UNSIGNED_SHORT, texels.constData());
+    glBindTexture(GL_TEXTURE_2D, 0);
     
-    return program;
+    table.cameraHeight = cameraHeight;
+    table.sunCosine = sunCosine;
+    table.data = data;
 }
 
-void Environment::renderAtmosphere(Camera& camera, const EnvironmentData& data) {
+void Environment::renderAtmosphere(Camera& camera, const EnvironmentData& data, ScatteringTable& table) {
     glm::vec3 center = data.getAtmosphereCenter(camera.getPosition());
-    
-    glPushMatrix();
-    glTranslatef(center.x, center.y, center.z);
-    
     glm::vec3 relativeCameraPos = camera.getPosition() - center;
     float height = glm::length(relativeCameraPos);
+    glm::vec3 lightDirection = glm::normalize(data.getSunLocation());
+    float sunCosine = glm::dot(lightDirection, relativeCameraPos) / height;
     
-    // use the appropriate shader depending on whether we're inside or outside
-    ProgramObject* program;
-    int* locations;
-    if (height < data.getAtmosphereOuterRadius()) {
-        program = _skyFromAtmosphereProgram;
-        locations = _skyFromAtmosphereUniformLocations;
-        
-    } else {
-        program = _skyFromSpaceProgram;
-        locations = _skyFromSpaceUniformLocations;
+    // the scattering only has to be integrated again when the atmosphere changes, or the camera moves far enough up or
+    // down or around the planet
+    float heightTolerance = SCATTERING_TABLE_HEIGHT_TOLERANCE *
+        (data.getAtmosphereOuterRadius() - data.getAtmosphereInnerRadius());
+    if (table.texture == 0 || !haveSameScattering(table.data, data) ||
+            fabsf(height - table.cameraHeight) > heightTolerance ||
+            fabsf(sunCosine - table.sunCosine) > SCATTERING_TABLE_SUN_COSINE_TOLERANCE) {
+        updateScatteringTable(table, data, height, sunCosine);
     }
     
-    // the constants here are from Sean O'Neil's GPU Gems entry
-    // (http://http.developer.nvidia.com/GPUGems2/gpugems2_chapter16.html), GameEngine.cpp
-    program->bind();
-    program->setUniform(locations[CAMERA_POS_LOCATION], relativeCameraPos);
-    glm::vec3 lightDirection = glm::normalize(data.getSunLocation());
-    program->setUniform(locations[LIGHT_POS_LOCATION], lightDirection);
-    program->setUniformValue(locations[INV_WAVELENGTH_LOCATION],
-        1 / powf(data.getScatteringWavelengths().r, 4.0f),
-        1 / powf(data.getScatteringWavelengths().g, 4.0f),
-        1 / powf(data.getScatteringWavelengths().b, 4.0f));
-    program->setUniformValue(locations[CAMERA_HEIGHT2_LOCATION], height * height);
-    program->setUniformValue(locations[OUTER_RADIUS_LOCATION], data.getAtmosphereOuterRadius());
-    program->setUniformValue(locations[OUTER_RADIUS2_LOCATION], data.getAtmosphereOuterRadius() * data.getAtmosphereOuterRadius());
-    program->setUniformValue(locations[INNER_RADIUS_LOCATION], data.getAtmosphereInnerRadius());
-    program->setUniformValue(locations[KR_ESUN_LOCATION], data.getRayleighScattering() * data.getSunBrightness());
-    program->setUniformValue(locations[KM_ESUN_LOCATION], data.getMieScattering() * data.getSunBrightness());
-    program->setUniformValue(locations[KR_4PI_LOCATION], data.getRayleighScattering() * 4.0f * PI);
-    program->setUniformValue(locations[KM_4PI_LOCATION], data.getMieScattering() * 4.0f * PI);
-    program->setUniformValue(locations[SCALE_LOCATION], 1.0f / (data.getAtmosphereOuterRadius() - data.getAtmosphereInnerRadius()));
-    program->setUniformValue(locations[SCALE_DEPTH_LOCATION], 0.25f);
-    program->setUniformValue(locations[SCALE_OVER_SCALE_DEPTH_LOCATION],
-        (1.0f / (data.getAtmosphereOuterRadius() - data.getAtmosphereInnerRadius())) / 0.25f);
-    program->setUniformValue(locations[G_LOCATION], -0.990f);
-    program->setUniformValue(locations[G2_LOCATION], -0.990f * -0.990f);
+    glPushMatrix();
+    glTranslatef(center.x, center.y, center.z);
+    
+    _skyProgram->bind();
+    _skyProgram->setUniformValue(_skyUniformLocations[SCATTERING_TABLE_LOCATION], 0);
+    _skyProgram->setUniformValue(_skyUniformLocations[SCATTERING_SCALE_LOCATION], table.scale);
+    _skyProgram->setUniform(_skyUniformLocations[CAMERA_POSITION_LOCATION], relativeCameraPos);
+    _skyProgram->setUniform(_skyUniformLocations[LIGHT_DIRECTION_LOCATION], lightDirection);
+    _skyProgram->setUniform(_skyUniformLocations[RAYLEIGH_COLOR_LOCATION],
+        getInverseWavelengths(data) * (data.getRayleighScattering() * data.getSunBrightness()));
+    _skyProgram->setUniformValue(_skyUniformLocations[MIE_BRIGHTNESS_LOCATION],
+        data.getMieScattering() * data.getSunBrightness());
+    _skyProgram->setUniformValue(_skyUniformLocations[G_LOCATION], MIE_G);
+    _skyProgram->setUniformValue(_skyUniformLocations[G2_LOCATION], MIE_G * MIE_G);
+    
+    glBindTexture(GL_TEXTURE_2D, table.texture);
     
     glDepthMask(GL_FALSE);
     glDisable(GL_DEPTH_TEST);
     glutSolidSphere(data.getAtmosphereOuterRadius(), 100, 50);
     glDepthMask(GL_TRUE);
     
-    program->release();
+    glBindTexture(GL_TEXTURE_2D, 0);
+    
+    _skyProgram->release();
     
     glPopMatrix();  
 }
@@ -18,6 +18,7 @@
 #include <HifiSockAddr.h>
 
 #include "EnvironmentData.h"
+#include "InterfaceConfig.h"
 
 class Camera;
 class ProgramObject;
@@ -40,41 +41,49 @@ public:
     
 private:
 
-    ProgramObject* createSkyProgram(const char* from, int* locations);
+    /// The light scattered along the rays from a viewpoint, integrated through the atmosphere once for the viewpoint's
+    /// height and the sun's angle from its up and kept in a texture, so that the sky is one lookup a fragment.
+    class ScatteringTable {
+    public:
+        ScatteringTable() : texture(0) { }
+        
+        GLuint texture;
+        float scale;
+        float cameraHeight;
+        float sunCosine;
+        EnvironmentData data;
+    };
+
+    typedef QHash<int, ScatteringTable> ServerScatteringTables;
 
-    void renderAtmosphere(Camera& camera, const EnvironmentData& data);
+    void updateScatteringTable(ScatteringTable& table, const EnvironmentData& data,
+        float cameraHeight, float sunCosine);
+
+    void renderAtmosphere(Camera& camera, const EnvironmentData& data, ScatteringTable& table);
 
     bool _initialized;
-    ProgramObject* _skyFromAtmosphereProgram;
-    ProgramObject* _skyFromSpaceProgram;
+    ProgramObject* _skyProgram;
     
     enum {
-        CAMERA_POS_LOCATION,
-        LIGHT_POS_LOCATION,
-        INV_WAVELENGTH_LOCATION,
-        CAMERA_HEIGHT2_LOCATION,
-        OUTER_RADIUS_LOCATION,
-        OUTER_RADIUS2_LOCATION,
-        INNER_RADIUS_LOCATION,
-        KR_ESUN_LOCATION,
-        KM_ESUN_LOCATION,
-        KR_4PI_LOCATION,
-        KM_4PI_LOCATION,
-        SCALE_LOCATION,
-        SCALE_DEPTH_LOCATION,
-        SCALE_OVER_SCALE_DEPTH_LOCATION,
+        SCATTERING_TABLE_LOCATION,
+        SCATTERING_SCALE_LOCATION,
+        CAMERA_POSITION_LOCATION,
+        LIGHT_DIRECTION_LOCATION,
+        RAYLEIGH_COLOR_LOCATION,
+        MIE_BRIGHTNESS_LOCATION,
         G_LOCATION,
         G2_LOCATION,
         LOCATION_COUNT
     };
     
-    int _skyFromAtmosphereUniformLocations[LOCATION_COUNT];
-    int _skyFromSpaceUniformLocations[LOCATION_COUNT];
+    int _skyUniformLocations[LOCATION_COUNT];
     
     typedef QHash<int, EnvironmentData> ServerData;
     
     QHash<HifiSockAddr, ServerData> _data;
     
+    QHash<HifiSockAddr, ServerScatteringTables> _scatteringTables;
+    
     QMutex _mutex;
 };
 
@@ -14,6 +14,8 @@
 
 #include <QBoxLayout>
 #include <QColorDialog>
+#include <QDateTime>
+#include <QDir>
 #include <QDialogButtonBox>
 #include <QDoubleSpinBox>
 #include <QFileDialog>
@@ -25,11 +27,13 @@
 #include <QMessageBox>
 #include <QShortcut>
 #include <QSlider>
+#include <QStandardPaths>
 #include <QUuid>
 #include <QHBoxLayout>
 #include <QDesktopServices>
 
 #include <AccountManager.h>
+#include <PerfStat.h>
 #include <XmppClient.h>
 #include <UUID.h>
 
@@ -103,7 +107,7 @@ Menu::Menu() :
     _avatarLODDistanceMultiplier(DEFAULT_AVATAR_LOD_DISTANCE_MULTIPLIER),
     _boundaryLevelAdjust(0),
     _maxVoxelPacketsPerSecond(DEFAULT_MAX_VOXEL_PPS),
-    _lastAdjust(usecTimestampNow()),
+    _lodSelectorSynced(false),
     _lastAvatarDetailDrop(usecTimestampNow()),
     _fpsAverage(FIVE_SECONDS_OF_FRAMES),
     _fastFPSAverage(ONE_SECOND_OF_FRAMES),
@@ -357,6 +361,7 @@ Menu::Menu() :
     addCheckableActionToQMenuAndActionHash(renderOptionsMenu, MenuOption::BuckyBalls, 0, false);
     addCheckableActionToQMenuAndActionHash(renderOptionsMenu, MenuOption::StringHair, 0, false);
     addCheckableActionToQMenuAndActionHash(renderOptionsMenu, MenuOption::Particles, 0, true);
+    addCheckableActionToQMenuAndActionHash(renderOptionsMenu, MenuOption::OcclusionCulling, 0, true);
     addActionToQMenuAndActionHash(renderOptionsMenu, MenuOption::LodTools, Qt::SHIFT | Qt::Key_L, this, SLOT(lodTools()));
 
     QMenu* voxelOptionsMenu = developerMenu->addMenu("Voxel Options");
@@ -369,7 +374,12 @@ Menu::Menu() :
                                            SLOT(setRenderVoxels(bool)));
 
     addCheckableActionToQMenuAndActionHash(voxelOptionsMenu, MenuOption::VoxelTextures);
+    addCheckableActionToQMenuAndActionHash(voxelOptionsMenu, MenuOption::ChunkedVoxelMeshes, 0, true,
+                                           appInstance->getVoxels(), SLOT(setUseChunkedMeshes(bool)));
+    addCheckableActionToQMenuAndActionHash(voxelOptionsMenu, MenuOption::InstancedVoxels, 0, false,
+                                           appInstance->getVoxels(), SLOT(setUseInstancedVoxels(bool)));
     addCheckableActionToQMenuAndActionHash(voxelOptionsMenu, MenuOption::AmbientOcclusion);
+    addCheckableActionToQMenuAndActionHash(voxelOptionsMenu, MenuOption::HalfResolutionAmbientOcclusion, 0, true);
     addCheckableActionToQMenuAndActionHash(voxelOptionsMenu, MenuOption::DontFadeOnVoxelServerChanges);
     addCheckableActionToQMenuAndActionHash(voxelOptionsMenu, MenuOption::DisableAutoAdjustLOD);
 
@@ -447,6 +457,11 @@ Menu::Menu() :
     addCheckableActionToQMenuAndActionHash(perfTimerMenu, MenuOption::ExpandIdleTiming, 0, false);
     addCheckableActionToQMenuAndActionHash(perfTimerMenu, MenuOption::ExpandPaintGLTiming, 0, false);
     addCheckableActionToQMenuAndActionHash(perfTimerMenu, MenuOption::ExpandUpdateTiming, 0, false);
+    addCheckableActionToQMenuAndActionHash(perfTimerMenu, MenuOption::GpuTiming, 0, false);
+    addCheckableActionToQMenuAndActionHash(perfTimerMenu, MenuOption::CaptureTimingTrace, 0, false,
+                                           this, SLOT(captureTimingTrace(bool)));
+    addCheckableActionToQMenuAndActionHash(perfTimerMenu, MenuOption::CaptureFrames, 0, false,
+                                           this, SLOT(captureFrames(bool)));
 
     addCheckableActionToQMenuAndActionHash(timingMenu, MenuOption::TestPing, 0, true);
     addCheckableActionToQMenuAndActionHash(timingMenu, MenuOption::FrameTimer);
@@ -472,6 +487,8 @@ Menu::Menu() :
                                            true,
                                            appInstance->getAudio(),
                                            SLOT(toggleAudioNoiseReduction()));
+    addCheckableActionToQMenuAndActionHash(audioDebugMenu, MenuOption::CompressAudio, 0, true);
+    addCheckableActionToQMenuAndActionHash(audioDebugMenu, MenuOption::ComfortNoise, 0, false);
     addCheckableActionToQMenuAndActionHash(audioDebugMenu, MenuOption::EchoServerAudio);
     addCheckableActionToQMenuAndActionHash(audioDebugMenu, MenuOption::EchoLocalAudio);
     addCheckableActionToQMenuAndActionHash(audioDebugMenu, MenuOption::StereoAudio, 0, false,
@@ -615,6 +632,7 @@ void Menu::loadSettings(QSettings* settings) {
     _maxVoxels = loadSetting(settings, "maxVoxels", DEFAULT_MAX_VOXELS_PER_SYSTEM);
     _maxVoxelPacketsPerSecond = loadSetting(settings, "maxVoxelsPPS", DEFAULT_MAX_VOXEL_PPS);
     _voxelSizeScale = loadSetting(settings, "voxelSizeScale", DEFAULT_OCTREE_SIZE_SCALE);
+    _lodSelectorSynced = false;
     _automaticAvatarLOD = settings->value("automaticAvatarLOD", true).toBool();
     _avatarLODDecreaseFPS = loadSetting(settings, "avatarLODDecreaseFPS", DEFAULT_ADJUST_AVATAR_LOD_DOWN_FPS);
     _avatarLODIncreaseFPS = loadSetting(settings, "avatarLODIncreaseFPS", ADJUST_LOD_UP_FPS);
@@ -1155,6 +1173,30 @@ void Menu::muteEnvironment() {
     free(packet);
 }
 
+void Menu::captureTimingTrace(bool capture) {
+    if (capture) {
+        PerformanceTimer::setCapturingTrace(true);
+        return;
+    }
+    PerformanceTimer::setCapturingTrace(false);
+    QString desktopLocation = QStandardPaths::writableLocation(QStandardPaths::DesktopLocation);
+    QString fileName = QFileDialog::getSaveFileName(Application::getInstance()->getWindow(), tr("Save Timing Trace"),
+                                                    desktopLocation.append("/timing.json"),
+                                                    tr("Trace files (*.json)"));
+    if (!fileName.isEmpty()) {
+        PerformanceTimer::writeTrace(fileName);
+    }
+}
+
+void Menu::captureFrames(bool capture) {
+    QString directory;
+    if (capture) {
+        directory = QDir(getSnapshotsLocation()).filePath("frames-" +
+            QDateTime::currentDateTime().toString("yyyy-MM-dd_hh-mm-ss"));
+    }
+    Application::getInstance()->getFrameCapture()->setCaptureDirectory(directory);
+}
+
 void Menu::goToLocation() {
     MyAvatar* myAvatar = Application::getInstance()->getAvatar();
     glm::vec3 avatarPos = myAvatar->getPosition();
@@ -1463,32 +1505,33 @@ void Menu::autoAdjustLOD(float currentFPS) {
         }
     }
 
-    bool changed = false;
-    quint64 elapsed = now - _lastAdjust;
-
-    if (elapsed > ADJUST_LOD_DOWN_DELAY && _fpsAverage.getAverage() < ADJUST_LOD_DOWN_FPS
-            && _voxelSizeScale > ADJUST_LOD_MIN_SIZE_SCALE) {
+    // the voxel detail follows the screen space error the selector settles on for our frame time budget, so it also
+    // follows the field of view and the size of the window
+    float fieldOfView = Application::getInstance()->getViewFrustum()->getFieldOfView();
+    float viewportHeight = Application::getInstance()->getGLWidget()->height();
+    if (!_lodSelectorSynced) {
+        _lodSelector.setSizeScale(_voxelSizeScale, fieldOfView, viewportHeight);
+        _lodSelectorSynced = true;
+    }
+    _lodSelector.setFrameTimeBudget(OculusManager::isConnected() ? OCULUS_LOD_FRAME_TIME_BUDGET : LOD_FRAME_TIME_BUDGET);
+    if (currentFPS > EPSILON) {
+        _lodSelector.update(USECS_PER_SECOND / currentFPS, now);
+    }
 
-        _voxelSizeScale *= ADJUST_LOD_DOWN_BY;
-        if (_voxelSizeScale < ADJUST_LOD_MIN_SIZE_SCALE) {
-            _voxelSizeScale = ADJUST_LOD_MIN_SIZE_SCALE;
-        }
-        changed = true;
-        _lastAdjust = now;
-        qDebug() << "adjusting LOD down... average fps for last approximately 5 seconds=" << _fpsAverage.getAverage()
-                     << "_voxelSizeScale=" << _voxelSizeScale;
+    // the servers don't send more detail than the default, and we don't ask for much less
+    float sizeScale = glm::clamp(_lodSelector.getSizeScale(fieldOfView, viewportHeight),
+        ADJUST_LOD_MIN_SIZE_SCALE, ADJUST_LOD_MAX_SIZE_SCALE);
+    if (sizeScale != _lodSelector.getSizeScale(fieldOfView, viewportHeight)) {
+        _lodSelector.setSizeScale(sizeScale, fieldOfView, viewportHeight);
     }
 
-    if (elapsed > ADJUST_LOD_UP_DELAY && _fpsAverage.getAverage() > ADJUST_LOD_UP_FPS
-            && _voxelSizeScale < ADJUST_LOD_MAX_SIZE_SCALE) {
-        _voxelSizeScale *= ADJUST_LOD_UP_BY;
-        if (_voxelSizeScale > ADJUST_LOD_MAX_SIZE_SCALE) {
-            _voxelSizeScale = ADJUST_LOD_MAX_SIZE_SCALE;
-        }
-        changed = true;
-        _lastAdjust = now;
-        qDebug() << "adjusting LOD up... average fps for last approximately 5 seconds=" << _fpsAverage.getAverage()
-                     << "_voxelSizeScale=" << _voxelSizeScale;
+    // small changes, as from resizing the window a pixel at a time, aren't worth redrawing the voxels for
+    const float MIN_SIZE_SCALE_CHANGE = 0.02f;
+    bool changed = fabsf(sizeScale - _voxelSizeScale) > _voxelSizeScale * MIN_SIZE_SCALE_CHANGE;
+    if (changed) {
+        qDebug() << "adjusting LOD... average frame time=" << _lodSelector.getAverageFrameTime() << "pixel error="
+            << _lodSelector.getPixelError() << "_voxelSizeScale=" << sizeScale;
+        _voxelSizeScale = sizeScale;
     }
 
     if (changed) {
@@ -1501,11 +1544,13 @@ void Menu::autoAdjustLOD(float currentFPS) {
 void Menu::resetLODAdjust() {
     _fpsAverage.reset();
     _fastFPSAverage.reset();
-    _lastAvatarDetailDrop = _lastAdjust = usecTimestampNow();
+    _lastAvatarDetailDrop = usecTimestampNow();
+    _lodSelector.reset(_lastAvatarDetailDrop);
 }
 
 void Menu::setVoxelSizeScale(float sizeScale) {
     _voxelSizeScale = sizeScale;
+    _lodSelectorSynced = false;
 }
 
 void Menu::setBoundaryLevelAdjust(int boundaryLevelAdjust) {
@@ -22,6 +22,7 @@
 #include <EventTypes.h>
 #include <MenuItemProperties.h>
 #include <OctreeConstants.h>
+#include <OctreeLODSelector.h>
 
 #include "location/LocationManager.h"
 #include "ui/PreferencesDialog.h"
@@ -31,15 +32,12 @@
 #include "ui/ScriptEditorWindow.h"
 #include "ui/UserLocationsDialog.h"
 
-const float ADJUST_LOD_DOWN_FPS = 40.0;
 const float ADJUST_LOD_UP_FPS = 55.0;
 const float DEFAULT_ADJUST_AVATAR_LOD_DOWN_FPS = 30.0f;
 
-const quint64 ADJUST_LOD_DOWN_DELAY = 1000 * 1000 * 5;
-const quint64 ADJUST_LOD_UP_DELAY = ADJUST_LOD_DOWN_DELAY * 2;
-
-const float ADJUST_LOD_DOWN_BY = 0.9f;
-const float ADJUST_LOD_UP_BY = 1.1f;
+// the frame times the automatic LOD aims for, the Rift wants frames at its refresh rate
+const float LOD_FRAME_TIME_BUDGET = 1000000.0f / 60.0f;
+const float OCULUS_LOD_FRAME_TIME_BUDGET = 1000000.0f / 75.0f;
 
 const float ADJUST_LOD_MIN_SIZE_SCALE = DEFAULT_OCTREE_SIZE_SCALE * 0.25f;
 const float ADJUST_LOD_MAX_SIZE_SCALE = DEFAULT_OCTREE_SIZE_SCALE;
@@ -215,6 +213,8 @@ private slots:
     void namedLocationCreated(LocationManager::NamedLocationCreateResponse response);
     void multipleDestinationsDecision(const QJsonObject& userData, const QJsonObject& placeData);
     void muteEnvironment();
+    void captureTimingTrace(bool capture);
+    void captureFrames(bool capture);
 
 private:
     static Menu* _instance;
@@ -281,7 +281,8 @@ private:
     QAction* _useVoxelShader;
     int _maxVoxelPacketsPerSecond;
     QString replaceLastOccurrence(QChar search, QChar replace, QString string);
-    quint64 _lastAdjust;
+    OctreeLODSelector _lodSelector;
+    bool _lodSelectorSynced; // whether the selector's pixel error has been set from _voxelSizeScale in our view
     quint64 _lastAvatarDetailDrop;
     SimpleMovingAverage _fpsAverage;
     SimpleMovingAverage _fastFPSAverage;
@@ -329,15 +330,20 @@ namespace MenuOption {
     const QString BandwidthDetails = "Bandwidth Details";
     const QString BuckyBalls = "Bucky Balls";
     const QString StringHair = "String Hair";
+    const QString CaptureFrames = "Capture Frames";
+    const QString CaptureTimingTrace = "Capture Timing Trace";
     const QString CascadedShadows = "Cascaded";
     const QString Chat = "Chat...";
     const QString ChatCircling = "Chat Circling";
+    const QString ChunkedVoxelMeshes = "Chunked Voxel Meshes";
     const QString CollideAsRagdoll = "Collide As Ragdoll";
     const QString CollideWithAvatars = "Collide With Avatars";
     const QString CollideWithEnvironment = "Collide With World Boundaries";
     const QString CollideWithParticles = "Collide With Particles";
     const QString CollideWithVoxels = "Collide With Voxels";
     const QString Collisions = "Collisions";
+    const QString ComfortNoise = "Comfort Noise";
+    const QString CompressAudio = "Compress Audio";
     const QString Console = "Console...";
     const QString DecreaseAvatarSize = "Decrease Avatar Size";
     const QString DecreaseVoxelSize = "Decrease Voxel Size";
@@ -379,11 +385,15 @@ namespace MenuOption {
     const QString GoTo = "Go To...";
     const QString GoToDomain = "Go To Domain...";
     const QString GoToLocation = "Go To Location...";
+    const QString GpuTiming = "Measure GPU Timing";
+    const QString HalfResolutionAmbientOcclusion = "Half Resolution Ambient Occlusion";
     const QString ObeyEnvironmentalGravity = "Obey Environmental Gravity";
+    const QString OcclusionCulling = "Occlusion Culling";
     const QString HandsCollideWithSelf = "Collide With Self";
     const QString HeadMouse = "Head Mouse";
     const QString IncreaseAvatarSize = "Increase Avatar Size";
     const QString IncreaseVoxelSize = "Increase Voxel Size";
+    const QString InstancedVoxels = "Instanced Voxels";
     const QString LoadScript = "Open and Run Script File...";
     const QString LoadScriptURL = "Open and Run Script from URL...";
     const QString LodTools = "LOD Tools";
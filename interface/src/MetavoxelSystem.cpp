@@ -10,6 +10,7 @@
 //
 
 #include <QMutexLocker>
+#include <QThreadPool>
 #include <QtDebug>
 
 #include <glm/gtx/transform.hpp>
@@ -30,7 +31,7 @@ ProgramObject MetavoxelSystem::_program;
 int MetavoxelSystem::_pointScaleLocation;
 
 MetavoxelSystem::MetavoxelSystem() :
-    _simulateVisitor(_points),
+    _pointVisitor(_points),
     _buffer(QOpenGLBuffer::VertexBuffer) {
 }
 
@@ -49,14 +50,20 @@ void MetavoxelSystem::init() {
 
 MetavoxelLOD MetavoxelSystem::getLOD() const {
     const float FIXED_LOD_THRESHOLD = 0.01f;
-    return MetavoxelLOD(Application::getInstance()->getCamera()->getPosition(), FIXED_LOD_THRESHOLD);
+    
+    // snapping the position to a grid lets the server share the deltas it encodes among clients viewing from nearby, at the
+    // cost of moving the distance at which each voxel subdivides by less than the spacing
+    const float LOD_POSITION_SPACING = 0.5f;
+    glm::vec3 position = glm::round(Application::getInstance()->getCamera()->getPosition() / LOD_POSITION_SPACING) *
+        LOD_POSITION_SPACING;
+    return MetavoxelLOD(position, FIXED_LOD_THRESHOLD);
 }
 
 void MetavoxelSystem::simulate(float deltaTime) {
     // update the clients
     _points.clear();
     _simulateVisitor.setDeltaTime(deltaTime);
-    _simulateVisitor.setOrder(-Application::getInstance()->getViewFrustum()->getDirection());
+    _pointVisitor.setOrder(-Application::getInstance()->getViewFrustum()->getDirection());
     update();
     
     _buffer.bind();
@@ -127,15 +134,11 @@ MetavoxelClient* MetavoxelSystem::createClient(const SharedNodePointer& node) {
 void MetavoxelSystem::updateClient(MetavoxelClient* client) {
     MetavoxelClientManager::updateClient(client);
     client->guide(_simulateVisitor);
+    client->guide(_pointVisitor, QThreadPool::globalInstance());
 }
 
-MetavoxelSystem::SimulateVisitor::SimulateVisitor(QVector<Point>& points) :
-    SpannerVisitor(QVector<AttributePointer>() << AttributeRegistry::getInstance()->getSpannersAttribute(),
-        QVector<AttributePointer>(), QVector<AttributePointer>() << AttributeRegistry::getInstance()->getColorAttribute() <<
-            AttributeRegistry::getInstance()->getNormalAttribute() <<
-            AttributeRegistry::getInstance()->getSpannerColorAttribute() <<
-            AttributeRegistry::getInstance()->getSpannerNormalAttribute()),
-    _points(points) {
+MetavoxelSystem::SimulateVisitor::SimulateVisitor() :
+    SpannerVisitor(QVector<AttributePointer>() << AttributeRegistry::getInstance()->getSpannersAttribute()) {
 }
 
 bool MetavoxelSystem::SimulateVisitor::visit(Spanner* spanner, const glm::vec3& clipMinimum, float clipSize) {
@@ -143,9 +146,37 @@ bool MetavoxelSystem::SimulateVisitor::visit(Spanner* spanner, const glm::vec3&
     return true;
 }
 
-int MetavoxelSystem::SimulateVisitor::visit(MetavoxelInfo& info) {
-    SpannerVisitor::visit(info);
+static QVector<AttributePointer> getPointInputs() {
+    // the spanners are among the inputs only so that the points fall on the same leaves as the spanners' voxels
+    return QVector<AttributePointer>() << AttributeRegistry::getInstance()->getColorAttribute() <<
+        AttributeRegistry::getInstance()->getNormalAttribute() <<
+        AttributeRegistry::getInstance()->getSpannerColorAttribute() <<
+        AttributeRegistry::getInstance()->getSpannerNormalAttribute() <<
+        AttributeRegistry::getInstance()->getSpannersAttribute();
+}
+
+MetavoxelSystem::PointVisitor::PointVisitor(QVector<Point>& points) :
+    MetavoxelVisitor(getPointInputs()),
+    _points(points) {
+}
+
+MetavoxelSystem::PointVisitor::PointVisitor() :
+    MetavoxelVisitor(getPointInputs()),
+    _points(_forkPoints) {
+}
+
+MetavoxelVisitor* MetavoxelSystem::PointVisitor::fork() const {
+    PointVisitor* fork = new PointVisitor();
+    fork->setLOD(_lod);
+    fork->_order = _order;
+    return fork;
+}
+
+void MetavoxelSystem::PointVisitor::join(MetavoxelVisitor* fork) {
+    _points += static_cast<PointVisitor*>(fork)->_points;
+}
 
+int MetavoxelSystem::PointVisitor::visit(MetavoxelInfo& info) {
     if (!info.isLeaf) {
         return _order;
     }
@@ -55,15 +55,28 @@ private:
     
     class SimulateVisitor : public SpannerVisitor {
     public:
-        SimulateVisitor(QVector<Point>& points);
+        SimulateVisitor();
         void setDeltaTime(float deltaTime) { _deltaTime = deltaTime; }
-        void setOrder(const glm::vec3& direction) { _order = encodeOrder(direction); }
         virtual bool visit(Spanner* spanner, const glm::vec3& clipMinimum, float clipSize);
+    
+    private:
+        float _deltaTime;
+    };
+    
+    /// Gathers the points to render, touring the octants in parallel.
+    class PointVisitor : public MetavoxelVisitor {
+    public:
+        PointVisitor(QVector<Point>& points);
+        void setOrder(const glm::vec3& direction) { _order = encodeOrder(direction); }
         virtual int visit(MetavoxelInfo& info);
+        virtual MetavoxelVisitor* fork() const;
+        virtual void join(MetavoxelVisitor* fork);
     
     private:
+        PointVisitor();
+        
         QVector<Point>& _points;
-        float _deltaTime;
+        QVector<Point> _forkPoints; ///< where a fork gathers its points until joined
         int _order;
     };
     
@@ -78,6 +91,7 @@ private:
     
     QVector<Point> _points;
     SimulateVisitor _simulateVisitor;
+    PointVisitor _pointVisitor;
     RenderVisitor _renderVisitor;
     QOpenGLBuffer _buffer;
 };
@@ -32,6 +32,7 @@
 #include <QVariant>
 
 #include <AccountManager.h>
+#include <GeometryOptimizer.h>
 
 #include "Application.h"
 #include "ModelUploader.h"
@@ -48,6 +49,7 @@ static const QString TRANSLATION_Y_FIELD = "ty";
 static const QString TRANSLATION_Z_FIELD = "tz";
 static const QString JOINT_FIELD = "joint";
 static const QString FREE_JOINT_FIELD = "freeJoint";
+static const QString GEOMETRY_FIELD = "geometry";
 
 static const QString S3_URL = "http://public.highfidelity.io";
 static const QString MODEL_URL = "/api/v1/models";
@@ -59,6 +61,13 @@ static const int MAX_TEXTURE_SIZE = 1024;
 static const int TIMEOUT = 1000;
 static const int MAX_CHECK = 30;
 
+static const int MIN_LOD_TRIANGLES = 2000;
+static const int MAX_GENERATED_LODS = 3;
+static const float LOD_TRIANGLE_PROPORTION = 0.5f;
+static const float MAX_LOD_TRIANGLE_PROPORTION = 0.75f;
+static const float FIRST_LOD_DISTANCE_PER_SIZE = 8.0f;
+static const QString GENERATED_LOD_SUFFIX = "-lod%1";
+
 static const int QCOMPRESS_HEADER_POSITION = 0;
 static const int QCOMPRESS_HEADER_SIZE = 4;
 
@@ -250,8 +259,49 @@ bool ModelUploader::zip() {
         }
     }
     
+    // name the precompiled geometry in the mapping, so that clients can load it in place of the fbx
+    QString precompiledPath = QFileInfo(fbxFile).path() + "/" + QFileInfo(fbxFile).completeBaseName();
+    QFile precompiledFile(precompiledPath + PRECOMPILED_GEOMETRY_EXTENSION);
+    mapping.insert(GEOMETRY_FIELD, QFileInfo(precompiledFile).fileName());
+    
+    // read the fbx with the mapping as clients will
+    FBXGeometry clientGeometry;
+    try {
+        clientGeometry = readFBX(fbxContents, readMapping(writeMapping(mapping)));
+    } catch (const QString& error) {
+        qDebug() << "[Warning] " << QString("Could not precompile %1: %2").arg(fbx.fileName(), error);
+        return false;
+    }
+    
+    // unless the user made their own, generate LODs at distances proportional to the model's size, each with half the
+    // triangles of the one before, for as long as they're worth having
+    QList<FBXGeometry> generatedLODs;
+    if (lodField.isEmpty()) {
+        float size = glm::distance(clientGeometry.meshExtents.minimum, clientGeometry.meshExtents.maximum);
+        int triangleCount = getTriangleCount(clientGeometry);
+        float distance = size * FIRST_LOD_DISTANCE_PER_SIZE;
+        while (triangleCount >= MIN_LOD_TRIANGLES && generatedLODs.size() < MAX_GENERATED_LODS) {
+            FBXGeometry lod = simplifyGeometry(generatedLODs.isEmpty() ? clientGeometry : generatedLODs.last(),
+                LOD_TRIANGLE_PROPORTION);
+            int lodTriangleCount = getTriangleCount(lod);
+            if (lodTriangleCount > triangleCount * MAX_LOD_TRIANGLE_PROPORTION) {
+                break; // the simplification has stalled on the borders and seams it can't touch
+            }
+            generatedLODs.append(lod);
+            lodField.insert(QFileInfo(precompiledPath + GENERATED_LOD_SUFFIX.arg(generatedLODs.size()) +
+                PRECOMPILED_GEOMETRY_EXTENSION).fileName(), distance);
+            qDebug() << "Generated LOD with" << lodTriangleCount << "triangles for" << distance << "meters.";
+            triangleCount = lodTriangleCount;
+            distance *= 2.0f;
+        }
+        if (!generatedLODs.isEmpty()) {
+            mapping.insert(LOD_FIELD, lodField);
+        }
+    }
+    
     // Write out, compress and copy the fst
-    if (!addPart(*fst, writeMapping(mapping), QString("fst"))) {
+    QByteArray mappingContents = writeMapping(mapping);
+    if (!addPart(*fst, mappingContents, QString("fst"))) {
         return false;
     }
     
@@ -259,6 +309,21 @@ bool ModelUploader::zip() {
     if (!addPart(fbx, fbxContents, "fbx")) {
         return false;
     }
+    
+    // write the geometry out precompiled, its triangles and vertices ordered for the GPU's caches
+    QVariantHash clientMapping = readMapping(mappingContents);
+    optimizeGeometry(clientGeometry);
+    if (!addPart(precompiledFile, writePrecompiledGeometry(clientGeometry, clientMapping), "geometry")) {
+        return false;
+    }
+    for (int i = 0; i < generatedLODs.size(); i++) {
+        QFile lodFile(precompiledPath + GENERATED_LOD_SUFFIX.arg(i + 1) + PRECOMPILED_GEOMETRY_EXTENSION);
+        FBXGeometry& lod = generatedLODs[i];
+        optimizeGeometry(lod);
+        if (!addPart(lodFile, writePrecompiledGeometry(lod, clientMapping), QString("lod%1").arg(++_lodCount))) {
+            return false;
+        }
+    }
                 
     if (!addTextures(texDir, geometry)) {
         return false;
@@ -10,16 +10,45 @@
 //
 
 #include "InterfaceConfig.h"
+
+#include <QRunnable>
+#include <QThread>
+#include <QThreadPool>
+
 #include "Stars.h" 
 
 #include "starfield/Controller.h"
 
+const int STARS_NOT_GENERATING = 0;
+const int STARS_GENERATING = 1;
+const int STARS_GENERATED = 2;
+
+// Generates the stars of a starfield on a thread of the pool.
+class StarGenerator : public QRunnable {
+public:
+    StarGenerator(Stars* stars, unsigned numStars, unsigned seed) : _stars(stars), _numStars(numStars), _seed(seed) { }
+
+    virtual void run() {
+        _stars->_controller->computeStarPositions(_numStars, _seed);
+        _stars->_generationState.storeRelease(STARS_GENERATED);
+    }
+
+private:
+    Stars* _stars;
+    unsigned _numStars;
+    unsigned _seed;
+};
+
 Stars::Stars() : 
-    _controller(0l), _starsLoaded(false) {
+    _controller(0l), _starsLoaded(false), _generationState(STARS_NOT_GENERATING) {
     _controller = new starfield::Controller;
 }
 
 Stars::~Stars() { 
+    // the generator writes to the controller, so it has to be done first
+    while (_generationState.loadAcquire() == STARS_GENERATING) {
+        QThread::yieldCurrentThread();
+    }
     delete _controller; 
 }
 
@@ -28,11 +57,25 @@ bool Stars::generate(unsigned numStars, unsigned seed) {
     return _starsLoaded;
 }
 
+void Stars::generateAsync(unsigned numStars, unsigned seed) {
+    if (_generationState.testAndSetOrdered(STARS_NOT_GENERATING, STARS_GENERATING)) {
+        QThreadPool::globalInstance()->start(new StarGenerator(this, numStars, seed));
+    }
+}
+
 bool Stars::setResolution(unsigned k) { 
     return _controller->setResolution(k); 
 }
 
 void Stars::render(float fovY, float aspect, float nearZ, float alpha) {
+    if (_generationState.loadAcquire() == STARS_GENERATED) {
+        _controller->uploadStars();
+        _starsLoaded = true;
+        _generationState.storeRelease(STARS_NOT_GENERATING);
+    }
+    if (!_starsLoaded) {
+        return;
+    }
     // determine length of screen diagonal from quadrant height and aspect ratio
     float quadrantHeight = nearZ * tan(RADIANS_PER_DEGREE * fovY * 0.5f);
     float halfDiagonal = sqrt(quadrantHeight * quadrantHeight * (1.0f + aspect * aspect));
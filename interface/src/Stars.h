@@ -12,6 +12,8 @@
 #ifndef hifi_Stars_h
 #define hifi_Stars_h
 
+#include <QAtomicInt>
+
 #include <glm/glm.hpp>
 
 namespace starfield { class Controller; }
@@ -26,7 +28,12 @@ public:
     // The numStars parameter sets the number of stars to generate.
     bool generate(unsigned numStars, unsigned seed);
 
-    // Renders the starfield from a local viewer's perspective.
+    // Generates the stars on a thread of the global pool, unless they are being
+    // already, so that the frame isn't held up. The render after they're done
+    // uploads and draws them.
+    void generateAsync(unsigned numStars, unsigned seed);
+
+    // Renders the starfield from a local viewer's perspective, once it's loaded.
     // The parameters specifiy the field of view.
     void render(float fovY, float aspect, float nearZ, float alpha);
 
@@ -46,9 +53,12 @@ private:
     Stars(Stars const&); // = delete;
     Stars& operator=(Stars const&); // delete;
 
+    friend class StarGenerator;
+
     starfield::Controller* _controller;
     
     bool _starsLoaded;
+    QAtomicInt _generationState; // whether stars are being generated on the pool, or are waiting to be uploaded
 };
 
 
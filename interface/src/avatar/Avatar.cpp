@@ -60,7 +60,12 @@ Avatar::Avatar() :
     _moving(false),
     _collisionGroups(0),
     _initialized(false),
-    _shouldRenderBillboard(true)
+    _shouldRenderBillboard(true),
+    _simulatingInView(false),
+    _simulatingSkeleton(false),
+    _skeletonSimulationDelay(0.0f),
+    _skeletonDeltaTime(0.0f),
+    _occludedFrames(0)
 {
     // we may have been created in the network thread, but we live in the main thread
     moveToThread(Application::getInstance()->thread());
@@ -98,7 +103,23 @@ float Avatar::getLODDistance() const {
         glm::distance(Application::getInstance()->getCamera()->getPosition(), _position) / _scale;
 }
 
+// skeletons nearer than this are simulated every frame, and beyond it less and less often up to the billboard distance
+const float REDUCED_RATE_LOD_DISTANCE = BILLBOARD_LOD_DISTANCE * 0.25f;
+const float MAX_SKELETON_SIMULATION_INTERVAL = 0.1f;
+
+float Avatar::getSkeletonSimulationInterval() const {
+    float proportion = (getLODDistance() - REDUCED_RATE_LOD_DISTANCE) / (BILLBOARD_LOD_DISTANCE - REDUCED_RATE_LOD_DISTANCE);
+    return glm::clamp(proportion, 0.0f, 1.0f) * MAX_SKELETON_SIMULATION_INTERVAL;
+}
+
 void Avatar::simulate(float deltaTime) {
+    if (beginSimulate(deltaTime)) {
+        simulateSkeleton();
+    }
+    finishSimulate(deltaTime);
+}
+
+bool Avatar::beginSimulate(float deltaTime) {
     if (_scale != _targetScale) {
         setScale(_targetScale);
     }
@@ -121,17 +142,43 @@ void Avatar::simulate(float deltaTime) {
     getHand()->simulate(deltaTime, false);
     _skeletonModel.setLODDistance(getLODDistance());
     
-    if (!_shouldRenderBillboard && inViewFrustum) {
-        if (_hasNewJointRotations) {
-            for (int i = 0; i < _jointData.size(); i++) {
-                const JointData& data = _jointData.at(i);
-                _skeletonModel.setJointState(i, data.valid, data.rotation);
-            }
-            _skeletonModel.simulate(deltaTime);
+    // an avatar that has been hidden behind the scene for a while isn't simulated until it shows again
+    const int MAX_OCCLUDED_FRAMES_TO_SIMULATE = 3;
+    _simulatingInView = !_shouldRenderBillboard && inViewFrustum && _occludedFrames <= MAX_OCCLUDED_FRAMES_TO_SIMULATE;
+    _simulatingSkeleton = false;
+    _skeletonSimulationDelay += deltaTime;
+    if (!_simulatingInView) {
+        return false;
+    }
+    // the model's placement is applied when it's rendered, so it follows the avatar every frame even when the joints
+    // are simulated less often
+    _skeletonModel.updateTransformFromAvatar();
+    if (_skeletonSimulationDelay < getSkeletonSimulationInterval()) {
+        return false;
+    }
+    _simulatingSkeleton = true;
+    _skeletonDeltaTime = _skeletonSimulationDelay;
+    _skeletonSimulationDelay = 0.0f;
+    if (_hasNewJointRotations) {
+        for (int i = 0; i < _jointData.size(); i++) {
+            const JointData& data = _jointData.at(i);
+            _skeletonModel.setJointState(i, data.valid, data.rotation);
         }
-        _skeletonModel.simulate(deltaTime, _hasNewJointRotations);
+    }
+    return _skeletonModel.beginSimulate(_hasNewJointRotations);
+}
+
+void Avatar::simulateSkeleton() {
+    _skeletonModel.simulateJoints(_skeletonDeltaTime);
+}
+
+void Avatar::finishSimulate(float deltaTime) {
+    if (_simulatingInView) {
         simulateAttachments(deltaTime);
-        _hasNewJointRotations = false;
+        if (_simulatingSkeleton) {
+            // joint rotations that arrive between simulations wait for the next one
+            _hasNewJointRotations = false;
+        }
 
         glm::vec3 headPosition = _position;
         _skeletonModel.getHeadPosition(headPosition);
@@ -413,6 +460,17 @@ const float MAX_WIND_STRENGTH = 0.02f;
 const float FINGER_LENGTH = 0.25f;
 const float FINGER_RADIUS = 0.10f;
 
+/// a corner of a quad of hair, interleaved for a vertex array
+class HairVertex {
+public:
+    glm::vec3 position;
+    glm::vec3 normal;
+    glm::vec3 color;
+};
+
+/// the vertices of the hair being drawn, shared by the avatars, which draw their hair one at a time
+static QVector<HairVertex> hairVertices;
+
 void Avatar::renderHair() {
     //
     //  Render the avatar's moveable hair
@@ -425,33 +483,51 @@ void Avatar::renderHair() {
     glm::vec3 axis = glm::axis(rotation);
     glRotatef(glm::degrees(glm::angle(rotation)), axis.x, axis.y, axis.z);
 
-    glBegin(GL_QUADS);
+    // the quads are collected into an array and drawn in one call
+    const int VERTICES_PER_QUAD = 4;
+    hairVertices.resize(HAIR_STRANDS * (HAIR_LINKS - 1) * VERTICES_PER_QUAD);
+    HairVertex* vertex = hairVertices.data();
     for (int strand = 0; strand < HAIR_STRANDS; strand++) {
         for (int link = 0; link < HAIR_LINKS - 1; link++) {
             int vertexIndex = strand * HAIR_LINKS + link;
-            glColor3fv(&_hairColors[vertexIndex].x);
-            glNormal3fv(&_hairNormals[vertexIndex].x);
-            glVertex3f(_hairPosition[vertexIndex].x - _hairQuadDelta[vertexIndex].x,
-                       _hairPosition[vertexIndex].y - _hairQuadDelta[vertexIndex].y,
-                       _hairPosition[vertexIndex].z - _hairQuadDelta[vertexIndex].z);
-            glVertex3f(_hairPosition[vertexIndex].x + _hairQuadDelta[vertexIndex].x,
-                       _hairPosition[vertexIndex].y + _hairQuadDelta[vertexIndex].y,
-                       _hairPosition[vertexIndex].z + _hairQuadDelta[vertexIndex].z);
-            
-            glVertex3f(_hairPosition[vertexIndex + 1].x + _hairQuadDelta[vertexIndex].x,
-                       _hairPosition[vertexIndex + 1].y + _hairQuadDelta[vertexIndex].y,
-                       _hairPosition[vertexIndex + 1].z + _hairQuadDelta[vertexIndex].z);
-            glVertex3f(_hairPosition[vertexIndex + 1].x - _hairQuadDelta[vertexIndex].x,
-                       _hairPosition[vertexIndex + 1].y - _hairQuadDelta[vertexIndex].y,
-                       _hairPosition[vertexIndex + 1].z - _hairQuadDelta[vertexIndex].z);
+            const glm::vec3& delta = _hairQuadDelta[vertexIndex];
+            const glm::vec3 corners[] = { _hairPosition[vertexIndex] - delta, _hairPosition[vertexIndex] + delta,
+                _hairPosition[vertexIndex + 1] + delta, _hairPosition[vertexIndex + 1] - delta };
+            for (int i = 0; i < VERTICES_PER_QUAD; i++) {
+                vertex->position = corners[i];
+                vertex->normal = _hairNormals[vertexIndex];
+                vertex->color = _hairColors[vertexIndex];
+                vertex++;
+            }
         }
     }
-    glEnd();
+    glEnableClientState(GL_VERTEX_ARRAY);
+    glEnableClientState(GL_NORMAL_ARRAY);
+    glEnableClientState(GL_COLOR_ARRAY);
+    glVertexPointer(3, GL_FLOAT, sizeof(HairVertex), &hairVertices.constData()->position);
+    glNormalPointer(GL_FLOAT, sizeof(HairVertex), &hairVertices.constData()->normal);
+    glColorPointer(3, GL_FLOAT, sizeof(HairVertex), &hairVertices.constData()->color);
+    
+    glDrawArrays(GL_QUADS, 0, hairVertices.size());
+    
+    glDisableClientState(GL_COLOR_ARRAY);
+    glDisableClientState(GL_NORMAL_ARRAY);
+    glDisableClientState(GL_VERTEX_ARRAY);
     
     glPopMatrix();
 
 }
 
+/// pushes a point out of a sphere that it's inside
+static void pushOutOfSphere(glm::vec3& point, const glm::vec3& center, float radius) {
+    glm::vec3 offset = point - center;
+    float distanceSquared = glm::dot(offset, offset);
+    if (distanceSquared < radius * radius && distanceSquared > 0.0f) {
+        float distance = sqrtf(distanceSquared);
+        point += offset * ((radius - distance) / distance);
+    }
+}
+
 void Avatar::simulateHair(float deltaTime) {
 
     deltaTime = glm::clamp(deltaTime, 0.0f, 1.0f / 30.0f);
@@ -479,92 +555,85 @@ void Avatar::simulateHair(float deltaTime) {
     
     float windIntensity = randFloat() * MAX_WIND_STRENGTH;
     
+    //  The forces that are the same for every link are summed once for the frame: a little gravity, the linear
+    //  acceleration of the avatar body and some wind
+    glm::vec3 constantStep = HAIR_GRAVITY * rotation * deltaTime - acceleration * HAIR_ACCELERATION_COUPLING * deltaTime +
+        WIND_DIRECTION * windIntensity * deltaTime;
+    
+    //  Stiffness (like hair care products do) by link
+    float linkStiffness[HAIR_LINKS];
+    for (int link = 0; link < HAIR_LINKS; link++) {
+        linkStiffness[link] = powf(1.f - link / HAIR_LINKS, 2.f) * HAIR_STIFFNESS;
+    }
+    
+    const float ANGULAR_VELOCITY_MIN = 0.001f;
+    bool rotating = glm::length(angularVelocity) > ANGULAR_VELOCITY_MIN;
+    
     for (int strand = 0; strand < HAIR_STRANDS; strand++) {
-        for (int link = 0; link < HAIR_LINKS; link++) {
+        //  The base joint of each strand isn't integrated
+        for (int link = 1; link < HAIR_LINKS; link++) {
             int vertexIndex = strand * HAIR_LINKS + link;
-            if (vertexIndex % HAIR_LINKS == 0) {
-                //  Base Joint - no integration
-             } else {
-                //
-                //  Vertlet Integration
-                //
-                //  Add velocity from last position, with damping
-                glm::vec3 thisPosition = _hairPosition[vertexIndex];
-                glm::vec3 diff = thisPosition - _hairLastPosition[vertexIndex];
-                _hairPosition[vertexIndex] += diff * HAIR_DAMPING;
-                //  Resolve collision with head sphere
-                if (glm::length(_hairPosition[vertexIndex]) < HEAD_RADIUS) {
-                    _hairPosition[vertexIndex] += glm::normalize(_hairPosition[vertexIndex]) *
-                    (HEAD_RADIUS - glm::length(_hairPosition[vertexIndex]));
+            glm::vec3& position = _hairPosition[vertexIndex];
+            
+            //
+            //  Vertlet Integration
+            //
+            //  Add velocity from last position, with damping
+            glm::vec3 thisPosition = position;
+            position += (thisPosition - _hairLastPosition[vertexIndex]) * HAIR_DAMPING;
+            
+            //  Resolve collisions with head sphere and hands
+            pushOutOfSphere(position, glm::vec3(), HEAD_RADIUS);
+            pushOutOfSphere(position, leftHandPosition, FINGER_RADIUS);
+            pushOutOfSphere(position, rightHandPosition, FINGER_RADIUS);
+            
+            position += constantStep;
+            if (linkStiffness[link] != 0.0f) {
+                position += (_hairOriginalPosition[vertexIndex] - position) * linkStiffness[link];
+            }
+            
+            //  Add angular acceleration of the avatar body
+            if (rotating) {
+                glm::vec3 yawVector = position;
+                yawVector.y = 0.f;
+                if (glm::length(yawVector) > EPSILON) {
+                    float radius = glm::length(yawVector);
+                    yawVector = glm::normalize(yawVector);
+                    float angle = atan2f(yawVector.x, -yawVector.z) + PI;
+                    glm::vec3 delta = glm::vec3(-1.f, 0.f, 0.f) * glm::angleAxis(angle, glm::vec3(0, 1, 0));
+                    position -= delta * radius * angularVelocity.y * HAIR_ANGULAR_VELOCITY_COUPLING * deltaTime;
                 }
-                //  Resolve collision with hands
-                if (glm::length(_hairPosition[vertexIndex] - leftHandPosition) < FINGER_RADIUS) {
-                     _hairPosition[vertexIndex] += glm::normalize(_hairPosition[vertexIndex] - leftHandPosition) *
-                     (FINGER_RADIUS - glm::length(_hairPosition[vertexIndex] - leftHandPosition));
+                glm::vec3 pitchVector = position;
+                pitchVector.x = 0.f;
+                if (glm::length(pitchVector) > EPSILON) {
+                    float radius = glm::length(pitchVector);
+                    pitchVector = glm::normalize(pitchVector);
+                    float angle = atan2f(pitchVector.y, -pitchVector.z) + PI;
+                    glm::vec3 delta = glm::vec3(0.0f, 1.0f, 0.f) * glm::angleAxis(angle, glm::vec3(1, 0, 0));
+                    position -= delta * radius * angularVelocity.x * HAIR_ANGULAR_VELOCITY_COUPLING * deltaTime;
                 }
-                 if (glm::length(_hairPosition[vertexIndex] - rightHandPosition) < FINGER_RADIUS) {
-                     _hairPosition[vertexIndex] += glm::normalize(_hairPosition[vertexIndex] - rightHandPosition) *
-                     (FINGER_RADIUS - glm::length(_hairPosition[vertexIndex] - rightHandPosition));
-                 }
-
-                 
-                //  Add a little gravity
-                _hairPosition[vertexIndex] += HAIR_GRAVITY * rotation * deltaTime;
-                
-                //  Add linear acceleration of the avatar body
-                _hairPosition[vertexIndex] -= acceleration * HAIR_ACCELERATION_COUPLING * deltaTime;
-                
-                //  Add stiffness (like hair care products do)
-                _hairPosition[vertexIndex] += (_hairOriginalPosition[vertexIndex] - _hairPosition[vertexIndex])
-                                                * powf(1.f - link / HAIR_LINKS, 2.f) * HAIR_STIFFNESS;
-                
-                //  Add some wind
-                glm::vec3 wind = WIND_DIRECTION * windIntensity;
-                _hairPosition[vertexIndex] += wind * deltaTime;
-                
-                const float ANGULAR_VELOCITY_MIN = 0.001f;
-                //  Add angular acceleration of the avatar body
-                if (glm::length(angularVelocity) > ANGULAR_VELOCITY_MIN) {
-                    glm::vec3 yawVector = _hairPosition[vertexIndex];
-                    yawVector.y = 0.f;
-                    if (glm::length(yawVector) > EPSILON) {
-                        float radius = glm::length(yawVector);
-                        yawVector = glm::normalize(yawVector);
-                        float angle = atan2f(yawVector.x, -yawVector.z) + PI;
-                        glm::vec3 delta = glm::vec3(-1.f, 0.f, 0.f) * glm::angleAxis(angle, glm::vec3(0, 1, 0));
-                        _hairPosition[vertexIndex] -= delta * radius * angularVelocity.y * HAIR_ANGULAR_VELOCITY_COUPLING * deltaTime;
-                    }
-                    glm::vec3 pitchVector = _hairPosition[vertexIndex];
-                    pitchVector.x = 0.f;
-                    if (glm::length(pitchVector) > EPSILON) {
-                        float radius = glm::length(pitchVector);
-                        pitchVector = glm::normalize(pitchVector);
-                        float angle = atan2f(pitchVector.y, -pitchVector.z) + PI;
-                        glm::vec3 delta = glm::vec3(0.0f, 1.0f, 0.f) * glm::angleAxis(angle, glm::vec3(1, 0, 0));
-                        _hairPosition[vertexIndex] -= delta * radius * angularVelocity.x * HAIR_ANGULAR_VELOCITY_COUPLING * deltaTime;
-                    }
-                    glm::vec3 rollVector = _hairPosition[vertexIndex];
-                    rollVector.z = 0.f;
-                    if (glm::length(rollVector) > EPSILON) {
-                        float radius = glm::length(rollVector);
-                        pitchVector = glm::normalize(rollVector);
-                        float angle = atan2f(rollVector.x, rollVector.y) + PI;
-                        glm::vec3 delta = glm::vec3(-1.0f, 0.0f, 0.f) * glm::angleAxis(angle, glm::vec3(0, 0, 1));
-                        _hairPosition[vertexIndex] -= delta * radius * angularVelocity.z * HAIR_ANGULAR_VELOCITY_COUPLING * deltaTime;
-                    }
+                glm::vec3 rollVector = position;
+                rollVector.z = 0.f;
+                if (glm::length(rollVector) > EPSILON) {
+                    float radius = glm::length(rollVector);
+                    float angle = atan2f(rollVector.x, rollVector.y) + PI;
+                    glm::vec3 delta = glm::vec3(-1.0f, 0.0f, 0.f) * glm::angleAxis(angle, glm::vec3(0, 0, 1));
+                    position -= delta * radius * angularVelocity.z * HAIR_ANGULAR_VELOCITY_COUPLING * deltaTime;
                 }
-                
-                //  Iterate length constraints to other links
-                for (int link = 0; link < HAIR_MAX_CONSTRAINTS; link++) {
-                    if (_hairConstraints[vertexIndex * HAIR_MAX_CONSTRAINTS + link] > -1) {
-                        //  If there is a constraint, try to enforce it
-                        glm::vec3 vectorBetween = _hairPosition[_hairConstraints[vertexIndex * HAIR_MAX_CONSTRAINTS + link]] - _hairPosition[vertexIndex];
-                        _hairPosition[vertexIndex] += glm::normalize(vectorBetween) * (glm::length(vectorBetween) - HAIR_LINK_LENGTH) * CONSTRAINT_RELAXATION * deltaTime;
-                    }
+            }
+            
+            //  Iterate length constraints to other links
+            for (int constraint = 0; constraint < HAIR_MAX_CONSTRAINTS; constraint++) {
+                int otherIndex = _hairConstraints[vertexIndex * HAIR_MAX_CONSTRAINTS + constraint];
+                if (otherIndex > -1) {
+                    //  If there is a constraint, try to enforce it
+                    glm::vec3 vectorBetween = _hairPosition[otherIndex] - position;
+                    float length = glm::length(vectorBetween);
+                    position += vectorBetween * ((length - HAIR_LINK_LENGTH) * CONSTRAINT_RELAXATION * deltaTime / length);
                 }
-                //  Store start position for next vertlet pass
-                _hairLastPosition[vertexIndex] = thisPosition;
             }
+            //  Store start position for next vertlet pass
+            _hairLastPosition[vertexIndex] = thisPosition;
         }
     }
 }
@@ -75,6 +75,16 @@ public:
 
     void init();
     void simulate(float deltaTime);
+
+    /// The parts of simulate.  The first and last have to happen on the main thread, but the skeleton's joints in
+    /// between only touch the avatar's own model, so different avatars' can be simulated at once.
+    /// \return whether simulateSkeleton needs to be called before finishSimulate
+    bool beginSimulate(float deltaTime);
+    void simulateSkeleton();
+    void finishSimulate(float deltaTime);
+
+    /// \return the time between simulations of the skeleton's joints, which grows as the avatar gets farther away
+    float getSkeletonSimulationInterval() const;
     
     enum RenderMode { NORMAL_RENDER_MODE, SHADOW_RENDER_MODE, MIRROR_RENDER_MODE };
     
@@ -84,6 +94,9 @@ public:
     void setDisplayingLookatVectors(bool displayingLookatVectors) { getHead()->setRenderLookatVectors(displayingLookatVectors); }
     void setMouseRay(const glm::vec3 &origin, const glm::vec3 &direction);
     void setIsLookAtTarget(const bool isLookAtTarget) { _isLookAtTarget = isLookAtTarget; }
+    
+    /// sets the number of occlusion results in a row that have found the avatar hidden behind the rest of the scene
+    void setOccludedFrames(int occludedFrames) { _occludedFrames = occludedFrames; }
     //getters
     bool isInitialized() const { return _initialized; }
     SkeletonModel& getSkeletonModel() { return _skeletonModel; }
@@ -98,6 +111,9 @@ public:
 
     /// Returns the distance to use as a LOD parameter.
     float getLODDistance() const;
+    
+    /// Returns the radius of the sphere the avatar is culled with, which is half the size of its billboard.
+    float getBillboardSize() const;
 
     bool findRayIntersection(const glm::vec3& origin, const glm::vec3& direction, float& distance) const;
 
@@ -220,11 +236,13 @@ private:
     QScopedPointer<Texture> _billboardTexture;
     bool _shouldRenderBillboard;
     bool _isLookAtTarget;
+    bool _simulatingInView; ///< set by beginSimulate when the avatar is close enough and in view to simulate fully
+    bool _simulatingSkeleton; ///< set by beginSimulate when the skeleton's joints are due to be simulated
+    float _skeletonSimulationDelay; ///< the time since the skeleton's joints were last simulated
+    float _skeletonDeltaTime; ///< the time the skeleton is being simulated over
+    int _occludedFrames;
 
     void renderBillboard();
-    
-    float getBillboardSize() const;
-    
 };
 
 #endif // hifi_Avatar_h
@@ -11,6 +11,8 @@
 
 #include <string>
 
+#include <QRunnable>
+
 #include <glm/gtx/string_cast.hpp>
 
 #include <PerfStat.h>
@@ -27,7 +29,11 @@
 const QUuid MY_AVATAR_KEY;  // NULL key
 
 AvatarManager::AvatarManager(QObject* parent) :
-    _avatarFades() {
+    _avatarFades(),
+    _cullAvatars(),
+    _cullPositions(),
+    _cullRadii(),
+    _isCullTableStale(true) {
     // register a meta type for the weak pointer we'll use for the owning avatar mixer for each avatar
     qRegisterMetaType<QWeakPointer<Node> >("NodeWeakPointer");
     _myAvatar = QSharedPointer<MyAvatar>(new MyAvatar());
@@ -40,15 +46,34 @@ void AvatarManager::init() {
     _avatarHash.insert(MY_AVATAR_KEY, _myAvatar);
 }
 
+/// Simulates the joints of an avatar's skeleton on a thread of the pool.
+class AvatarSkeletonSimulator : public QRunnable {
+public:
+    AvatarSkeletonSimulator(Avatar* avatar) : _avatar(avatar) { }
+    
+    virtual void run() { _avatar->simulateSkeleton(); }
+    
+private:
+    Avatar* _avatar;
+};
+
 void AvatarManager::updateOtherAvatars(float deltaTime) {
     bool showWarnings = Menu::getInstance()->isOptionChecked(MenuOption::PipelineWarnings);
     PerformanceWarning warn(showWarnings, "Application::updateAvatars()");
 
+    // bring the avatars up to date with the datagrams that the node thread received since the last frame
+    processQueuedDatagrams();
+
     Application* applicationInstance = Application::getInstance();
     glm::vec3 mouseOrigin = applicationInstance->getMouseRayOrigin();
     glm::vec3 mouseDirection = applicationInstance->getMouseRayDirection();
 
-    // simulate avatars
+    // the cull table is refilled as the avatars are simulated, while each one is at hand anyway
+    _cullAvatars.clear();
+    _cullPositions.clear();
+    _cullRadii.clear();
+    
+    // simulate avatars: each one's skeleton is simulated on the pool, between the parts that use the main thread
     AvatarHash::iterator avatarIterator = _avatarHash.begin();
     while (avatarIterator != _avatarHash.end()) {
         AvatarSharedPointer sharedAvatar = avatarIterator.value();
@@ -57,13 +82,17 @@ void AvatarManager::updateOtherAvatars(float deltaTime) {
         if (sharedAvatar == _myAvatar || !avatar->isInitialized()) {
             // DO NOT update _myAvatar!  Its update has already been done earlier in the main loop.
             // DO NOT update uninitialized Avatars
+            if (avatar->isInitialized()) {
+                addToCullTable(sharedAvatar);
+            }
             ++avatarIterator;
             continue;
         }
         if (!shouldKillAvatar(sharedAvatar)) {
             // this avatar's mixer is still around, go ahead and simulate it
-            avatar->simulate(deltaTime);
-            avatar->setMouseRay(mouseOrigin, mouseDirection);
+            if (avatar->beginSimulate(deltaTime)) {
+                _simulationPool.start(new AvatarSkeletonSimulator(avatar));
+            }
             ++avatarIterator;
         } else {
             // the mixer that owned this avatar is gone, give it to the vector of fades and kill it
@@ -71,10 +100,32 @@ void AvatarManager::updateOtherAvatars(float deltaTime) {
         }
     }
     
+    _simulationPool.waitForDone();
+    
+    // finish the avatars in the same order, now that their skeletons are done
+    for (avatarIterator = _avatarHash.begin(); avatarIterator != _avatarHash.end(); ++avatarIterator) {
+        AvatarSharedPointer sharedAvatar = avatarIterator.value();
+        Avatar* avatar = reinterpret_cast<Avatar*>(sharedAvatar.data());
+        if (sharedAvatar != _myAvatar && avatar->isInitialized()) {
+            avatar->finishSimulate(deltaTime);
+            avatar->setMouseRay(mouseOrigin, mouseDirection);
+            addToCullTable(sharedAvatar);
+        }
+    }
+    
+    _isCullTableStale = false;
+    
     // simulate avatar fades
     simulateAvatarFades(deltaTime);
 }
 
+void AvatarManager::addToCullTable(const AvatarSharedPointer& sharedAvatar) {
+    Avatar* avatar = static_cast<Avatar*>(sharedAvatar.data());
+    _cullAvatars.append(sharedAvatar);
+    _cullPositions.append(avatar->getPosition());
+    _cullRadii.append(avatar->getBillboardSize());
+}
+
 void AvatarManager::renderAvatars(Avatar::RenderMode renderMode, bool selfAvatarOnly) {
     PerformanceWarning warn(Menu::getInstance()->isOptionChecked(MenuOption::PipelineWarnings),
                             "Application::renderAvatars()");
@@ -83,14 +134,52 @@ void AvatarManager::renderAvatars(Avatar::RenderMode renderMode, bool selfAvatar
     glm::vec3 cameraPosition = Application::getInstance()->getCamera()->getPosition();
 
     if (!selfAvatarOnly) {
-        foreach (const AvatarSharedPointer& avatarPointer, _avatarHash) {
-            Avatar* avatar = static_cast<Avatar*>(avatarPointer.data());
-            if (!avatar->isInitialized()) {
+        if (_isCullTableStale) {
+            // an avatar has been removed since the last update, so the table has to be refilled without it
+            _cullAvatars.clear();
+            _cullPositions.clear();
+            _cullRadii.clear();
+            foreach (const AvatarSharedPointer& avatarPointer, _avatarHash) {
+                if (static_cast<Avatar*>(avatarPointer.data())->isInitialized()) {
+                    addToCullTable(avatarPointer);
+                }
+            }
+            _isCullTableStale = false;
+        }
+        
+        // the shadows of hidden avatars may still show, so only the views of the camera are culled by occlusion
+        bool testOcclusion = (renderMode != Avatar::SHADOW_RENDER_MODE);
+        if (testOcclusion) {
+            _occlusionQueries.beginFrame(Menu::getInstance()->isOptionChecked(MenuOption::OcclusionCulling));
+            _occlusionBoxes.resize(0);
+        }
+        
+        // only the avatars whose spheres reach into the frustum are touched
+        ViewFrustum* frustum = (renderMode == Avatar::SHADOW_RENDER_MODE) ?
+            Application::getInstance()->getShadowViewFrustum() : Application::getInstance()->getViewFrustum();
+        const glm::vec3* positions = _cullPositions.constData();
+        const float* radii = _cullRadii.constData();
+        for (int i = 0; i < _cullAvatars.size(); i++) {
+            if (frustum->sphereInFrustum(positions[i], radii[i]) == ViewFrustum::OUTSIDE) {
                 continue;
             }
+            Avatar* avatar = static_cast<Avatar*>(_cullAvatars.at(i).data());
+            if (testOcclusion && avatar != _myAvatar.data()) {
+                quint64 key = reinterpret_cast<quintptr>(avatar);
+                OcclusionBox box = { key, positions[i] - glm::vec3(radii[i]), positions[i] + glm::vec3(radii[i]) };
+                _occlusionBoxes.append(box);
+                int occludedFrames = _occlusionQueries.getOccludedFrames(key);
+                avatar->setOccludedFrames(occludedFrames);
+                if (occludedFrames > 0) {
+                    continue;
+                }
+            }
             avatar->render(cameraPosition, renderMode);
             avatar->setDisplayingLookatVectors(renderLookAtVectors);
         }
+        if (testOcclusion) {
+            _occlusionQueries.test(_occlusionBoxes, frustum->getPosition(), frustum->getNearClip());
+        }
         renderAvatarFades(cameraPosition, renderMode);
     } else {
         // just render myAvatar
@@ -138,6 +227,7 @@ AvatarHash::iterator AvatarManager::erase(const AvatarHash::iterator& iterator)
         if (reinterpret_cast<Avatar*>(iterator.value().data())->isInitialized()) {
             _avatarFades.push_back(iterator.value());
         }
+        _isCullTableStale = true;
         return AvatarHashMap::erase(iterator);
     } else {
         // never remove _myAvatar from the list
@@ -15,10 +15,12 @@
 #include <QtCore/QHash>
 #include <QtCore/QObject>
 #include <QtCore/QSharedPointer>
+#include <QtCore/QThreadPool>
 
 #include <AvatarHashMap.h>
 
 #include "Avatar.h"
+#include "renderer/OcclusionQueries.h"
 
 class MyAvatar;
 
@@ -40,6 +42,7 @@ private:
     AvatarManager(const AvatarManager& other);
 
     void simulateAvatarFades(float deltaTime);
+    void addToCullTable(const AvatarSharedPointer& sharedAvatar);
     void renderAvatarFades(const glm::vec3& cameraPosition, Avatar::RenderMode renderMode);
     
     AvatarSharedPointer newSharedAvatar();
@@ -49,6 +52,20 @@ private:
     
     QVector<AvatarSharedPointer> _avatarFades;
     QSharedPointer<MyAvatar> _myAvatar;
+    
+    // the avatars to render and, side by side, the spheres they are culled with, refreshed as each is simulated so
+    // that culling runs through contiguous arrays and only the avatars in view are touched when rendering
+    QVector<AvatarSharedPointer> _cullAvatars;
+    QVector<glm::vec3> _cullPositions;
+    QVector<float> _cullRadii;
+    bool _isCullTableStale;
+    
+    // the boxes of the other avatars in view, tested once they've been drawn; the avatars that the last results
+    // found hidden are left out until they're found visible again
+    OcclusionQueries _occlusionQueries;
+    QVector<OcclusionBox> _occlusionBoxes;
+    
+    QThreadPool _simulationPool; ///< for the avatars' skeletons, which we wait for every frame
 };
 
 #endif // hifi_AvatarManager_h
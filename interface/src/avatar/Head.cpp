@@ -61,6 +61,9 @@ void Head::reset() {
     _faceModel.reset();
 }
 
+// beyond this, others' faces hold their expressions rather than blinking and moving with their voices
+const float FROZEN_FACE_LOD_DISTANCE = 20.0f;
+
 void Head::simulate(float deltaTime, bool isMine, bool billboard) {
     //  Update audio trailing average for rendering facial animations
     if (isMine) {
@@ -71,7 +74,8 @@ void Head::simulate(float deltaTime, bool isMine, bool billboard) {
         }
     }
     
-    if (!(_isFaceshiftConnected || billboard)) {
+    bool frozen = !isMine && static_cast<Avatar*>(_owningAvatar)->getLODDistance() > FROZEN_FACE_LOD_DISTANCE;
+    if (!(_isFaceshiftConnected || billboard || frozen)) {
         // Update eye saccades
         const float AVERAGE_MICROSACCADE_INTERVAL = 0.50f;
         const float AVERAGE_SACCADE_INTERVAL = 4.0f;
@@ -14,6 +14,7 @@
 
 #include <QSettings>
 
+#include <FixedTimestep.h>
 #include <PhysicsSimulation.h>
 
 #include "Avatar.h"
@@ -182,6 +183,7 @@ private:
 
     QList<AnimationHandlePointer> _animationHandles;
     PhysicsSimulation _physicsSimulation;
+    FixedTimestep _physicsTimestep;
 
 	// private methods
     float computeDistanceToFloor(const glm::vec3& startPoint);
@@ -46,11 +46,15 @@ void SkeletonModel::setJointStates(QVector<JointState> states) {
 
 const float PALM_PRIORITY = 3.0f;
 
-void SkeletonModel::simulate(float deltaTime, bool fullUpdate) {
+void SkeletonModel::updateTransformFromAvatar() {
     setTranslation(_owningAvatar->getPosition());
     setRotation(_owningAvatar->getOrientation() * glm::angleAxis(PI, glm::vec3(0.0f, 1.0f, 0.0f)));
     const float MODEL_SCALE = 0.0006f;
     setScale(glm::vec3(1.0f, 1.0f, 1.0f) * _owningAvatar->getScale() * MODEL_SCALE);
+}
+
+void SkeletonModel::simulate(float deltaTime, bool fullUpdate) {
+    updateTransformFromAvatar();
     
     Model::simulate(deltaTime, fullUpdate);
     
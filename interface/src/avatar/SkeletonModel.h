@@ -31,6 +31,9 @@ public:
 
     void simulate(float deltaTime, bool fullUpdate = true);
 
+    /// Places the model where its avatar is, which simulate does first.
+    void updateTransformFromAvatar();
+
     /// \param jointIndex index of hand joint
     /// \param shapes[out] list in which is stored pointers to hand shapes
     void getHandShapes(int jointIndex, QVector<const Shape*>& shapes) const;
@@ -9,6 +9,7 @@
 //  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
 //
 
+#include <QThread>
 #include <QTimer>
 
 #include <SharedUtil.h>
@@ -23,61 +24,81 @@ using namespace std;
 
 const quint16 FACESHIFT_PORT = 33433;
 
+FaceshiftState::FaceshiftState() :
+    timestamp(0),
+    headAngularVelocity(0.0f, 0.0f, 0.0f),
+    eyeGazeLeftPitch(0.0f),
+    eyeGazeLeftYaw(0.0f),
+    eyeGazeRightPitch(0.0f),
+    eyeGazeRightYaw(0.0f),
+    leftBlinkIndex(0), // see http://support.faceshift.com/support/articles/35129-export-of-blendshapes
+    rightBlinkIndex(1),
+    leftEyeOpenIndex(8),
+    rightEyeOpenIndex(9),
+    browDownLeftIndex(14),
+    browDownRightIndex(15),
+    browUpCenterIndex(16),
+    browUpLeftIndex(17),
+    browUpRightIndex(18),
+    mouthSmileLeftIndex(28),
+    mouthSmileRightIndex(29),
+    jawOpenIndex(21) {
+}
+
 Faceshift::Faceshift() :
-    _tcpEnabled(true),
-    _tcpRetryCount(0),
-    _lastTrackingStateReceived(0),
-    _eyeGazeLeftPitch(0.0f),
-    _eyeGazeLeftYaw(0.0f),
-    _eyeGazeRightPitch(0.0f),
-    _eyeGazeRightYaw(0.0f),
-    _leftBlinkIndex(0), // see http://support.faceshift.com/support/articles/35129-export-of-blendshapes
-    _rightBlinkIndex(1),
-    _leftEyeOpenIndex(8),
-    _rightEyeOpenIndex(9),
-    _browDownLeftIndex(14),
-    _browDownRightIndex(15),
-    _browUpCenterIndex(16),
-    _browUpLeftIndex(17),
-    _browUpRightIndex(18),
-    _mouthSmileLeftIndex(28),
-    _mouthSmileRightIndex(29),
-    _jawOpenIndex(21),
+    _states(),
+    _reader(new FaceshiftReader(_states)),
     _longTermAverageEyePitch(0.0f),
     _longTermAverageEyeYaw(0.0f),
     _longTermAverageInitialized(false)
 {
-    connect(&_tcpSocket, SIGNAL(connected()), SLOT(noteConnected()));
-    connect(&_tcpSocket, SIGNAL(error(QAbstractSocket::SocketError)), SLOT(noteError(QAbstractSocket::SocketError)));
-    connect(&_tcpSocket, SIGNAL(readyRead()), SLOT(readFromSocket()));
-    connect(&_tcpSocket, SIGNAL(stateChanged(QAbstractSocket::SocketState)), SIGNAL(connectionStateChanged()));
+    connect(_reader, SIGNAL(connectionStateChanged()), SIGNAL(connectionStateChanged()));
 
-    connect(&_udpSocket, SIGNAL(readyRead()), SLOT(readPendingDatagrams()));
+    QThread* readerThread = new QThread(this);
+    _reader->moveToThread(readerThread);
+    readerThread->start();
+}
 
-    _udpSocket.bind(FACESHIFT_PORT);
+Faceshift::~Faceshift() {
+    QThread* readerThread = _reader->thread();
+    QMetaObject::invokeMethod(_reader, "shutdown");
+    readerThread->wait();
 }
 
 void Faceshift::init() {
-    setTCPEnabled(Menu::getInstance()->isOptionChecked(MenuOption::Faceshift));
+    QMetaObject::invokeMethod(_reader, "init",
+        Q_ARG(bool, Menu::getInstance()->isOptionChecked(MenuOption::Faceshift)));
 }
 
 bool Faceshift::isConnectedOrConnecting() const {
-    return _tcpSocket.state() == QAbstractSocket::ConnectedState ||
-        (_tcpRetryCount == 0 && _tcpSocket.state() != QAbstractSocket::UnconnectedState);
+    return _reader->isConnectedOrConnecting();
 }
 
 bool Faceshift::isActive() const {
     const quint64 ACTIVE_TIMEOUT_USECS = 1000000;
-    return (usecTimestampNow() - _lastTrackingStateReceived) < ACTIVE_TIMEOUT_USECS;
+    return (usecTimestampNow() - _state.timestamp) < ACTIVE_TIMEOUT_USECS;
 }
 
 void Faceshift::update() {
+    if (_states.update()) {
+        _state = _states.getReadBuffer();
+        _headTranslation = _state.headTranslation;
+        _blendshapeCoefficients = _state.blendshapeCoefficients;
+    }
     if (!isActive()) {
         return;
     }
+    // the state was received some time before the frame, so the head is turned on by as far as it would have since
+    const quint64 MAX_PREDICTION_USECS = 100000;
+    float predictionTime = qMin(usecTimestampNow() - _state.timestamp, MAX_PREDICTION_USECS) / (float)USECS_PER_SECOND;
+    float angularSpeed = glm::length(_state.headAngularVelocity);
+    _headRotation = (angularSpeed > EPSILON) ? glm::angleAxis(angularSpeed * predictionTime,
+        _state.headAngularVelocity / angularSpeed) * _state.headRotation : _state.headRotation;
+
     // get the euler angles relative to the window
     glm::vec3 eulers = glm::degrees(safeEulerAngles(_headRotation * glm::quat(glm::radians(glm::vec3(
-        (_eyeGazeLeftPitch + _eyeGazeRightPitch) / 2.0f, (_eyeGazeLeftYaw + _eyeGazeRightYaw) / 2.0f, 0.0f)))));
+        (_state.eyeGazeLeftPitch + _state.eyeGazeRightPitch) / 2.0f,
+        (_state.eyeGazeLeftYaw + _state.eyeGazeRightYaw) / 2.0f, 0.0f)))));
 
     // compute and subtract the long term average
     const float LONG_TERM_AVERAGE_SMOOTHING = 0.999f;
@@ -95,47 +116,92 @@ void Faceshift::update() {
 }
 
 void Faceshift::reset() {
-    if (_tcpSocket.state() == QAbstractSocket::ConnectedState) {
-        string message;
-        fsBinaryStream::encode_message(message, fsMsgCalibrateNeutral());
-        send(message);
-    }
+    QMetaObject::invokeMethod(_reader, "reset");
     _longTermAverageInitialized = false;
 }
 
 void Faceshift::updateFakeCoefficients(float leftBlink, float rightBlink, float browUp,
         float jawOpen, QVector<float>& coefficients) const {
-    coefficients.resize(max((int)coefficients.size(), _jawOpenIndex + 1));
+    coefficients.resize(max((int)coefficients.size(), _state.jawOpenIndex + 1));
     qFill(coefficients.begin(), coefficients.end(), 0.0f);
-    coefficients[_leftBlinkIndex] = leftBlink;
-    coefficients[_rightBlinkIndex] = rightBlink;
-    coefficients[_browUpCenterIndex] = browUp;
-    coefficients[_browUpLeftIndex] = browUp;
-    coefficients[_browUpRightIndex] = browUp;
-    coefficients[_jawOpenIndex] = jawOpen;
+    coefficients[_state.leftBlinkIndex] = leftBlink;
+    coefficients[_state.rightBlinkIndex] = rightBlink;
+    coefficients[_state.browUpCenterIndex] = browUp;
+    coefficients[_state.browUpLeftIndex] = browUp;
+    coefficients[_state.browUpRightIndex] = browUp;
+    coefficients[_state.jawOpenIndex] = jawOpen;
 }
 
 void Faceshift::setTCPEnabled(bool enabled) {
+    QMetaObject::invokeMethod(_reader, "setTCPEnabled", Q_ARG(bool, enabled));
+}
+
+float Faceshift::getBlendshapeCoefficient(int index) const {
+    return (index >= 0 && index < (int)_blendshapeCoefficients.size()) ? _blendshapeCoefficients[index] : 0.0f;
+}
+
+FaceshiftReader::FaceshiftReader(TripleBuffer<FaceshiftState>& states) :
+    _states(states),
+    _tcpSocket(NULL),
+    _udpSocket(NULL),
+    _tcpEnabled(false),
+    _tcpRetryCount(0),
+    _tracking(false),
+    _connectedOrConnecting(0) {
+}
+
+void FaceshiftReader::init(bool tcpEnabled) {
+    // the sockets are created here so that their notifiers belong to the reader's thread
+    _tcpSocket = new QTcpSocket(this);
+    connect(_tcpSocket, SIGNAL(connected()), SLOT(noteConnected()));
+    connect(_tcpSocket, SIGNAL(error(QAbstractSocket::SocketError)), SLOT(noteError(QAbstractSocket::SocketError)));
+    connect(_tcpSocket, SIGNAL(readyRead()), SLOT(readFromSocket()));
+    connect(_tcpSocket, SIGNAL(stateChanged(QAbstractSocket::SocketState)), SLOT(noteStateChanged()));
+
+    _udpSocket = new QUdpSocket(this);
+    connect(_udpSocket, SIGNAL(readyRead()), SLOT(readPendingDatagrams()));
+    _udpSocket->bind(FACESHIFT_PORT);
+
+    setTCPEnabled(tcpEnabled);
+}
+
+void FaceshiftReader::shutdown() {
+    deleteLater();
+    thread()->quit();
+}
+
+void FaceshiftReader::setTCPEnabled(bool enabled) {
+    if (!_tcpSocket) {
+        return;
+    }
     if ((_tcpEnabled = enabled)) {
         connectSocket();
 
     } else {
-        _tcpSocket.disconnectFromHost();
+        _tcpSocket->disconnectFromHost();
+    }
+}
+
+void FaceshiftReader::reset() {
+    if (_tcpSocket && _tcpSocket->state() == QAbstractSocket::ConnectedState) {
+        string message;
+        fsBinaryStream::encode_message(message, fsMsgCalibrateNeutral());
+        send(message);
     }
 }
 
-void Faceshift::connectSocket() {
+void FaceshiftReader::connectSocket() {
     if (_tcpEnabled) {
         if (!_tcpRetryCount) {
             qDebug("Faceshift: Connecting...");
         }
 
-        _tcpSocket.connectToHost("localhost", FACESHIFT_PORT);
+        _tcpSocket->connectToHost("localhost", FACESHIFT_PORT);
         _tracking = false;
     }
 }
 
-void Faceshift::noteConnected() {
+void FaceshiftReader::noteConnected() {
     qDebug("Faceshift: Connected.");
     // request the list of blendshape names
     string message;
@@ -143,42 +209,46 @@ void Faceshift::noteConnected() {
     send(message);
 }
 
-void Faceshift::noteError(QAbstractSocket::SocketError error) {
+void FaceshiftReader::noteError(QAbstractSocket::SocketError error) {
     if (!_tcpRetryCount) {
        // Only spam log with fail to connect the first time, so that we can keep waiting for server
-       qDebug() << "Faceshift: " << _tcpSocket.errorString();
+       qDebug() << "Faceshift: " << _tcpSocket->errorString();
     }
     // retry connection after a 2 second delay
     if (_tcpEnabled) {
         _tcpRetryCount++;
         QTimer::singleShot(2000, this, SLOT(connectSocket()));
     }
+    noteStateChanged();
 }
 
-void Faceshift::readPendingDatagrams() {
+void FaceshiftReader::noteStateChanged() {
+    // stored before the signal goes out, so that whoever it reaches on the main thread sees the new state
+    _connectedOrConnecting.store(_tcpSocket->state() == QAbstractSocket::ConnectedState ||
+        (_tcpRetryCount == 0 && _tcpSocket->state() != QAbstractSocket::UnconnectedState));
+    emit connectionStateChanged();
+}
+
+void FaceshiftReader::readPendingDatagrams() {
     QByteArray buffer;
-    while (_udpSocket.hasPendingDatagrams()) {
-        buffer.resize(_udpSocket.pendingDatagramSize());
-        _udpSocket.readDatagram(buffer.data(), buffer.size());
+    while (_udpSocket->hasPendingDatagrams()) {
+        buffer.resize(_udpSocket->pendingDatagramSize());
+        _udpSocket->readDatagram(buffer.data(), buffer.size());
         receive(buffer);
     }
 }
 
-void Faceshift::readFromSocket() {
-    receive(_tcpSocket.readAll());
-}
-
-float Faceshift::getBlendshapeCoefficient(int index) const {
-    return (index >= 0 && index < (int)_blendshapeCoefficients.size()) ? _blendshapeCoefficients[index] : 0.0f;
+void FaceshiftReader::readFromSocket() {
+    receive(_tcpSocket->readAll());
 }
 
-void Faceshift::send(const std::string& message) {
-    _tcpSocket.write(message.data(), message.size());
+void FaceshiftReader::send(const std::string& message) {
+    _tcpSocket->write(message.data(), message.size());
 }
 
-void Faceshift::receive(const QByteArray& buffer) {
+void FaceshiftReader::receive(const QByteArray& buffer) {
     _stream.received(buffer.size(), buffer.constData());
-    fsMsgPtr msg;
+    bool changed = false;
     for (fsMsgPtr msg; (msg = _stream.get_message()); ) {
         switch (msg->id()) {
             case fsMsg::MSG_OUT_TRACKING_STATE: {
@@ -187,27 +257,29 @@ void Faceshift::receive(const QByteArray& buffer) {
                     glm::quat newRotation = glm::quat(data.m_headRotation.w, -data.m_headRotation.x,
                                                       data.m_headRotation.y, -data.m_headRotation.z);
                     // Compute angular velocity of the head
-                    glm::quat r = newRotation * glm::inverse(_headRotation);
+                    glm::quat r = newRotation * glm::inverse(_state.headRotation);
                     float theta = 2 * acos(r.w);
                     if (theta > EPSILON) {
                         float rMag = glm::length(glm::vec3(r.x, r.y, r.z));
                         float AVERAGE_FACESHIFT_FRAME_TIME = 0.033f;
-                        _headAngularVelocity = theta / AVERAGE_FACESHIFT_FRAME_TIME * glm::vec3(r.x, r.y, r.z) / rMag;
+                        _state.headAngularVelocity = theta / AVERAGE_FACESHIFT_FRAME_TIME *
+                            glm::vec3(r.x, r.y, r.z) / rMag;
                     } else {
-                        _headAngularVelocity = glm::vec3(0,0,0);
+                        _state.headAngularVelocity = glm::vec3(0,0,0);
                     }
-                    _headRotation = newRotation;
+                    _state.headRotation = newRotation;
 
                     const float TRANSLATION_SCALE = 0.02f;
-                    _headTranslation = glm::vec3(data.m_headTranslation.x, data.m_headTranslation.y,
+                    _state.headTranslation = glm::vec3(data.m_headTranslation.x, data.m_headTranslation.y,
                         -data.m_headTranslation.z) * TRANSLATION_SCALE;
-                    _eyeGazeLeftPitch = -data.m_eyeGazeLeftPitch;
-                    _eyeGazeLeftYaw = data.m_eyeGazeLeftYaw;
-                    _eyeGazeRightPitch = -data.m_eyeGazeRightPitch;
-                    _eyeGazeRightYaw = data.m_eyeGazeRightYaw;
-                    _blendshapeCoefficients = QVector<float>::fromStdVector(data.m_coeffs);
-
-                    _lastTrackingStateReceived = usecTimestampNow();
+                    _state.eyeGazeLeftPitch = -data.m_eyeGazeLeftPitch;
+                    _state.eyeGazeLeftYaw = data.m_eyeGazeLeftYaw;
+                    _state.eyeGazeRightPitch = -data.m_eyeGazeRightPitch;
+                    _state.eyeGazeRightYaw = data.m_eyeGazeRightYaw;
+                    _state.blendshapeCoefficients = QVector<float>::fromStdVector(data.m_coeffs);
+
+                    _state.timestamp = usecTimestampNow();
+                    changed = true;
                 }
                 break;
             }
@@ -215,46 +287,51 @@ void Faceshift::receive(const QByteArray& buffer) {
                 const vector<string>& names = static_cast<fsMsgBlendshapeNames*>(msg.get())->blendshape_names();
                 for (size_t i = 0; i < names.size(); i++) {
                     if (names[i] == "EyeBlink_L") {
-                        _leftBlinkIndex = i;
+                        _state.leftBlinkIndex = i;
 
                     } else if (names[i] == "EyeBlink_R") {
-                        _rightBlinkIndex = i;
+                        _state.rightBlinkIndex = i;
 
                     } else if (names[i] == "EyeOpen_L") {
-                        _leftEyeOpenIndex = i;
+                        _state.leftEyeOpenIndex = i;
 
                     } else if (names[i] == "EyeOpen_R") {
-                        _rightEyeOpenIndex = i;
+                        _state.rightEyeOpenIndex = i;
 
                     } else if (names[i] == "BrowsD_L") {
-                        _browDownLeftIndex = i;
+                        _state.browDownLeftIndex = i;
 
                     } else if (names[i] == "BrowsD_R") {
-                        _browDownRightIndex = i;
+                        _state.browDownRightIndex = i;
 
                     } else if (names[i] == "BrowsU_C") {
-                        _browUpCenterIndex = i;
+                        _state.browUpCenterIndex = i;
 
                     } else if (names[i] == "BrowsU_L") {
-                        _browUpLeftIndex = i;
+                        _state.browUpLeftIndex = i;
 
                     } else if (names[i] == "BrowsU_R") {
-                        _browUpRightIndex = i;
+                        _state.browUpRightIndex = i;
 
                     } else if (names[i] == "JawOpen") {
-                        _jawOpenIndex = i;
+                        _state.jawOpenIndex = i;
 
                     } else if (names[i] == "MouthSmile_L") {
-                        _mouthSmileLeftIndex = i;
+                        _state.mouthSmileLeftIndex = i;
 
                     } else if (names[i] == "MouthSmile_R") {
-                        _mouthSmileRightIndex = i;
+                        _state.mouthSmileRightIndex = i;
                     }
                 }
+                changed = true;
                 break;
             }
             default:
                 break;
         }
     }
+    // only the last of a burst of messages is handed on; the frame only ever wants the latest
+    if (changed) {
+        _states.publish(_state);
+    }
 }
@@ -12,20 +12,66 @@
 #ifndef hifi_Faceshift_h
 #define hifi_Faceshift_h
 
+#include <QAtomicInt>
 #include <QTcpSocket>
 #include <QUdpSocket>
 
 #include <fsbinarystream.h>
 
+#include <TripleBuffer.h>
+
 #include "FaceTracker.h"
 
+class FaceshiftReader;
+
+/// The latest state received from Faceshift, handed from the reader's thread to the main one.
+class FaceshiftState {
+public:
+    FaceshiftState();
+
+    quint64 timestamp; /// when the tracking state was received, or zero if none has been
+
+    glm::quat headRotation;
+    glm::vec3 headTranslation;
+    glm::vec3 headAngularVelocity;
+
+    // degrees
+    float eyeGazeLeftPitch;
+    float eyeGazeLeftYaw;
+    float eyeGazeRightPitch;
+    float eyeGazeRightYaw;
+
+    QVector<float> blendshapeCoefficients;
+
+    int leftBlinkIndex;
+    int rightBlinkIndex;
+    int leftEyeOpenIndex;
+    int rightEyeOpenIndex;
+
+    // Brows
+    int browDownLeftIndex;
+    int browDownRightIndex;
+    int browUpCenterIndex;
+    int browUpLeftIndex;
+    int browUpRightIndex;
+
+    int mouthSmileLeftIndex;
+    int mouthSmileRightIndex;
+
+    int jawOpenIndex;
+};
+
 /// Handles interaction with the Faceshift software, which provides head position/orientation and facial features.
+/// The sockets are read and the stream parsed on a thread of their own, so that a burst of messages doesn't hold up a
+/// frame; each frame takes the latest state the reader published and predicts the head rotation forward from when it
+/// was received.
 class Faceshift : public FaceTracker {
     Q_OBJECT
 
 public:
 
     Faceshift();
+    virtual ~Faceshift();
 
     void init();
 
@@ -33,29 +79,29 @@ public:
 
     bool isActive() const;
 
-    const glm::vec3& getHeadAngularVelocity() const { return _headAngularVelocity; }
+    const glm::vec3& getHeadAngularVelocity() const { return _state.headAngularVelocity; }
 
     // these pitch/yaw angles are in degrees
-    float getEyeGazeLeftPitch() const { return _eyeGazeLeftPitch; }
-    float getEyeGazeLeftYaw() const { return _eyeGazeLeftYaw; }
+    float getEyeGazeLeftPitch() const { return _state.eyeGazeLeftPitch; }
+    float getEyeGazeLeftYaw() const { return _state.eyeGazeLeftYaw; }
     
-    float getEyeGazeRightPitch() const { return _eyeGazeRightPitch; }
-    float getEyeGazeRightYaw() const { return _eyeGazeRightYaw; }
+    float getEyeGazeRightPitch() const { return _state.eyeGazeRightPitch; }
+    float getEyeGazeRightYaw() const { return _state.eyeGazeRightYaw; }
 
-    float getLeftBlink() const { return getBlendshapeCoefficient(_leftBlinkIndex); }
-    float getRightBlink() const { return getBlendshapeCoefficient(_rightBlinkIndex); }
-    float getLeftEyeOpen() const { return getBlendshapeCoefficient(_leftEyeOpenIndex); }
-    float getRightEyeOpen() const { return getBlendshapeCoefficient(_rightEyeOpenIndex); }
+    float getLeftBlink() const { return getBlendshapeCoefficient(_state.leftBlinkIndex); }
+    float getRightBlink() const { return getBlendshapeCoefficient(_state.rightBlinkIndex); }
+    float getLeftEyeOpen() const { return getBlendshapeCoefficient(_state.leftEyeOpenIndex); }
+    float getRightEyeOpen() const { return getBlendshapeCoefficient(_state.rightEyeOpenIndex); }
 
-    float getBrowDownLeft() const { return getBlendshapeCoefficient(_browDownLeftIndex); }
-    float getBrowDownRight() const { return getBlendshapeCoefficient(_browDownRightIndex); }
-    float getBrowUpCenter() const { return getBlendshapeCoefficient(_browUpCenterIndex); }
-    float getBrowUpLeft() const { return getBlendshapeCoefficient(_browUpLeftIndex); }
-    float getBrowUpRight() const { return getBlendshapeCoefficient(_browUpRightIndex); }
+    float getBrowDownLeft() const { return getBlendshapeCoefficient(_state.browDownLeftIndex); }
+    float getBrowDownRight() const { return getBlendshapeCoefficient(_state.browDownRightIndex); }
+    float getBrowUpCenter() const { return getBlendshapeCoefficient(_state.browUpCenterIndex); }
+    float getBrowUpLeft() const { return getBlendshapeCoefficient(_state.browUpLeftIndex); }
+    float getBrowUpRight() const { return getBlendshapeCoefficient(_state.browUpRightIndex); }
 
-    float getMouthSize() const { return getBlendshapeCoefficient(_jawOpenIndex); }
-    float getMouthSmileLeft() const { return getBlendshapeCoefficient(_mouthSmileLeftIndex); }
-    float getMouthSmileRight() const { return getBlendshapeCoefficient(_mouthSmileRightIndex); }
+    float getMouthSize() const { return getBlendshapeCoefficient(_state.jawOpenIndex); }
+    float getMouthSmileLeft() const { return getBlendshapeCoefficient(_state.mouthSmileLeftIndex); }
+    float getMouthSmileRight() const { return getBlendshapeCoefficient(_state.mouthSmileRightIndex); }
 
     void update();
     void reset();
@@ -71,58 +117,64 @@ public slots:
     
     void setTCPEnabled(bool enabled);
     
+private:
+    
+    float getBlendshapeCoefficient(int index) const;
+    
+    TripleBuffer<FaceshiftState> _states;
+    FaceshiftReader* _reader;
+    FaceshiftState _state;
+    
+    // degrees
+    float _longTermAverageEyePitch;
+    float _longTermAverageEyeYaw;
+    bool _longTermAverageInitialized;
+};
+
+/// The reader object that lives in its own thread, publishing each tracking state it parses.
+class FaceshiftReader : public QObject {
+    Q_OBJECT
+
+public:
+
+    FaceshiftReader(TripleBuffer<FaceshiftState>& states);
+
+    /// whether the TCP socket is connected or trying to be. Safe to call from any thread
+    bool isConnectedOrConnecting() const { return _connectedOrConnecting.load(); }
+
+    Q_INVOKABLE void init(bool tcpEnabled);
+    Q_INVOKABLE void shutdown();
+    Q_INVOKABLE void setTCPEnabled(bool enabled);
+    Q_INVOKABLE void reset();
+
+signals:
+
+    void connectionStateChanged();
+
 private slots:
 
     void connectSocket();
     void noteConnected();
     void noteError(QAbstractSocket::SocketError error);
+    void noteStateChanged();
     void readPendingDatagrams();
     void readFromSocket();        
     
 private:
     
-    float getBlendshapeCoefficient(int index) const;
-    
     void send(const std::string& message);
     void receive(const QByteArray& buffer);
     
-    QTcpSocket _tcpSocket;
-    QUdpSocket _udpSocket;
+    TripleBuffer<FaceshiftState>& _states;
+    FaceshiftState _state;
+    
+    QTcpSocket* _tcpSocket;
+    QUdpSocket* _udpSocket;
     fs::fsBinaryStream _stream;
     bool _tcpEnabled;
     int _tcpRetryCount;
     bool _tracking;
-    quint64 _lastTrackingStateReceived;
-    
-    glm::vec3 _headAngularVelocity;
-    
-    // degrees
-    float _eyeGazeLeftPitch;
-    float _eyeGazeLeftYaw;
-    float _eyeGazeRightPitch;
-    float _eyeGazeRightYaw;
-    
-    int _leftBlinkIndex;
-    int _rightBlinkIndex;
-    int _leftEyeOpenIndex;
-    int _rightEyeOpenIndex;
-
-    // Brows
-    int _browDownLeftIndex;
-    int _browDownRightIndex;
-    int _browUpCenterIndex;
-    int _browUpLeftIndex;
-    int _browUpRightIndex;
-    
-    int _mouthSmileLeftIndex;
-    int _mouthSmileRightIndex;
-    
-    int _jawOpenIndex;
-    
-    // degrees
-    float _longTermAverageEyePitch;
-    float _longTermAverageEyeYaw;
-    bool _longTermAverageInitialized;
+    QAtomicInt _connectedOrConnecting;
 };
 
 #endif // hifi_Faceshift_h
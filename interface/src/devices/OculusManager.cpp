@@ -323,7 +323,8 @@ void OculusManager::display(const glm::quat &bodyOrientation, const glm::vec3 &p
         glLoadIdentity();
         glTranslatef(_eyeRenderDesc[eye].ViewAdjust.x, _eyeRenderDesc[eye].ViewAdjust.y, _eyeRenderDesc[eye].ViewAdjust.z);
 
-        Application::getInstance()->displaySide(*_camera);
+        // both eyes are culled against the application's view frustum, so the second reuses what the first found
+        Application::getInstance()->displaySide(*_camera, false, eyeIndex > 0);
 
         if (displayOverlays) {
             applicationOverlay.displayOverlayTextureOculus(*_camera);
@@ -43,6 +43,14 @@ void ModelTreeRenderer::clearModelsCache() {
         delete model;
     }
     _unknownModelsItemModels.clear();
+
+    foreach(Model* model, _staticModels) {
+        delete model;
+    }
+    _staticModels.clear();
+    _staticModelInstances.clear();
+    _animatedModelInstances.clear();
+    _spheres.clear();
 }
 
 void ModelTreeRenderer::init() {
@@ -63,13 +71,60 @@ void ModelTreeRenderer::update() {
 }
 
 void ModelTreeRenderer::render(RenderMode renderMode) {
+    // keep the capacity for this frame's models and spheres
+    for (QHash<QString, QVector<StaticModelInstance> >::iterator url = _staticModelInstances.begin();
+            url != _staticModelInstances.end(); url++) {
+        url.value().resize(0);
+    }
+    _animatedModelInstances.resize(0);
+    _spheres.clear();
+
+    bool testOcclusion = (renderMode == DEFAULT_RENDER_MODE);
+    if (testOcclusion) {
+        _occlusionQueries.beginFrame(Menu::getInstance()->isOptionChecked(MenuOption::OcclusionCulling));
+        _occlusionBoxes.resize(0);
+    }
+
     OctreeRenderer::render(renderMode);
+
+    // the models and the spheres were collected as the elements were rendered, to be drawn together
+    renderCollected(renderMode);
+
+    if (testOcclusion && _viewFrustum) {
+        _occlusionQueries.test(_occlusionBoxes, _viewFrustum->getPosition(), _viewFrustum->getNearClip());
+    }
+}
+
+void ModelTreeRenderer::renderAgain(RenderMode renderMode) {
+    // the bounds and proxies are drawn as the elements are visited, so showing them takes a visit for each eye
+    if (Menu::getInstance()->isOptionChecked(MenuOption::DisplayModelBounds) ||
+            Menu::getInstance()->isOptionChecked(MenuOption::DisplayModelElementProxy)) {
+        render(renderMode);
+        return;
+    }
+    renderCollected(renderMode);
+}
+
+void ModelTreeRenderer::renderCollected(RenderMode renderMode) {
+    const float alpha = 1.0f;
+    Model::RenderMode modelRenderMode = renderMode == OctreeRenderer::SHADOW_RENDER_MODE
+                                            ? Model::SHADOW_RENDER_MODE : Model::DEFAULT_RENDER_MODE;
+    foreach (const AnimatedModelInstance& instance, _animatedModelInstances) {
+        if (instance.glowLevel > 0.0f) {
+            Glower glower(instance.glowLevel);
+            instance.model->render(alpha, modelRenderMode);
+        } else {
+            instance.model->render(alpha, modelRenderMode);
+        }
+    }
+    renderStaticModels(renderMode);
+    _spheres.render(false);
 }
 
 const FBXGeometry* ModelTreeRenderer::getGeometryForModel(const ModelItem& modelItem) {
     const FBXGeometry* result = NULL;
     
-    Model* model = getModel(modelItem);
+    Model* model = modelItem.hasAnimation() ? getModel(modelItem) : getStaticModel(modelItem.getModelURL());
     if (model) {
         result = &model->getGeometry()->getFBXGeometry();
     }
@@ -131,6 +186,82 @@ Model* ModelTreeRenderer::getModel(const ModelItem& modelItem) {
     return model;
 }
 
+Model* ModelTreeRenderer::getStaticModel(const QString& url) {
+    Model* model = _staticModels.value(url);
+    if (!model) {
+        // Make sure we only create new models on the thread that owns the ModelTreeRenderer
+        if (QThread::currentThread() != thread()) {
+            QMetaObject::invokeMethod(this, "getStaticModel", Qt::BlockingQueuedConnection,
+                Q_RETURN_ARG(Model*, model), Q_ARG(const QString&, url));
+            return model;
+        }
+
+        model = new Model();
+        model->init();
+        model->setURL(QUrl(url));
+        model->setSnapModelToCenter(true);
+        _staticModels.insert(url, model);
+    }
+    return model;
+}
+
+/// orders the instances of a model by their pose, so that the ones that share it are drawn one after the other
+static bool staticModelPoseLessThan(const StaticModelInstance& first, const StaticModelInstance& second) {
+    if (first.radius != second.radius) {
+        return first.radius < second.radius;
+    }
+    for (int i = 0; i < 4; i++) {
+        if (first.rotation[i] != second.rotation[i]) {
+            return first.rotation[i] < second.rotation[i];
+        }
+    }
+    return false;
+}
+
+void ModelTreeRenderer::renderStaticModels(RenderMode renderMode) {
+    const float alpha = 1.0f;
+    Model::RenderMode modelRenderMode = renderMode == OctreeRenderer::SHADOW_RENDER_MODE
+                                            ? Model::SHADOW_RENDER_MODE : Model::DEFAULT_RENDER_MODE;
+
+    for (QHash<QString, QVector<StaticModelInstance> >::iterator url = _staticModelInstances.begin();
+            url != _staticModelInstances.end(); url++) {
+        QVector<StaticModelInstance>& instances = url.value();
+        if (instances.isEmpty()) {
+            continue;
+        }
+        Model* model = getStaticModel(url.key());
+        if (!model->isActive()) {
+            // if we couldn't get a model, then just draw spheres
+            // if we couldn't get a model, then just draw spheres, which are kept in case the models are drawn again
+            foreach (const StaticModelInstance& instance, instances) {
+                _spheres.add(instance.position, instance.radius, instance.color);
+            }
+            instances.resize(0);
+            continue;
+        }
+
+        // the rotation and scale go into the model's joints when it's simulated, but it's moved into place as it's
+        // drawn, so the instances that share a pose share a simulation; the attachments are moved when it's simulated
+        qSort(instances.begin(), instances.end(), staticModelPoseLessThan);
+        bool hasAttachments = !model->getGeometry()->getFBXGeometry().attachments.isEmpty();
+        for (int i = 0; i < instances.size(); i++) {
+            const StaticModelInstance& instance = instances.at(i);
+            model->setTranslation(instance.position);
+            if (i == 0 || hasAttachments || staticModelPoseLessThan(instances.at(i - 1), instance)) {
+                model->setScaleToFit(true, instance.radius * 2.0f);
+                model->setRotation(instance.rotation);
+                model->simulate(0.0f);
+            }
+            if (instance.glowLevel > 0.0f) {
+                Glower glower(instance.glowLevel);
+                model->render(alpha, modelRenderMode);
+            } else {
+                model->render(alpha, modelRenderMode);
+            }
+        }
+    }
+}
+
 void ModelTreeRenderer::renderElement(OctreeElement* element, RenderArgs* args) {
     args->_elementsTouched++;
     // actually render it here...
@@ -224,13 +355,31 @@ void ModelTreeRenderer::renderElement(OctreeElement* element, RenderArgs* args)
 
             bool drawAsModel = modelItem.hasModel();
 
+            // the models found hidden aren't drawn or simulated, but their boxes are tested to find when they show
+            if (args->_renderMode == DEFAULT_RENDER_MODE && modelItem.isKnownID()) {
+                OcclusionBox box = { modelItem.getID(), modelCube.getCorner(),
+                    modelCube.getCorner() + modelCube.getDimensions() };
+                _occlusionBoxes.append(box);
+                if (_occlusionQueries.getOccludedFrames(modelItem.getID()) > 0) {
+                    continue;
+                }
+            }
+
             args->_itemsRendered++;
 
-            if (drawAsModel) {
+            // the models that don't animate are drawn with the others of their URL, unless their bounds are shown
+            if (drawAsModel && !modelItem.hasAnimation() && (isShadowMode || !displayModelBounds)) {
+                StaticModelInstance instance;
+                instance.position = position;
+                instance.rotation = modelItem.getModelRotation();
+                instance.radius = radius;
+                instance.glowLevel = modelItem.getGlowLevel();
+                memcpy(instance.color, modelItem.getColor(), sizeof(instance.color));
+                _staticModelInstances[modelItem.getModelURL()].append(instance);
+
+            } else if (drawAsModel) {
                 glPushMatrix();
                 {
-                    const float alpha = 1.0f;
-                
                     Model* model = getModel(modelItem);
                     
                     if (model) {
@@ -261,33 +410,12 @@ void ModelTreeRenderer::renderElement(OctreeElement* element, RenderArgs* args)
                         model->simulate(0.0f);
 
                         // TODO: should we allow modelItems to have alpha on their models?
-                        Model::RenderMode modelRenderMode = args->_renderMode == OctreeRenderer::SHADOW_RENDER_MODE 
-                                                                ? Model::SHADOW_RENDER_MODE : Model::DEFAULT_RENDER_MODE;
-                
-                        if (modelItem.getGlowLevel() > 0.0f) {
-                            Glower glower(modelItem.getGlowLevel());
-                            
-                            if (model->isActive()) {
-                                model->render(alpha, modelRenderMode);
-                            } else {
-                                // if we couldn't get a model, then just draw a sphere
-                                glColor3ub(modelItem.getColor()[RED_INDEX],modelItem.getColor()[GREEN_INDEX],modelItem.getColor()[BLUE_INDEX]);
-                                glPushMatrix();
-                                    glTranslatef(position.x, position.y, position.z);
-                                    glutSolidSphere(radius, 15, 15);
-                                glPopMatrix();
-                            }
+                        if (model->isActive()) {
+                            AnimatedModelInstance instance = { model, modelItem.getGlowLevel() };
+                            _animatedModelInstances.append(instance);
                         } else {
-                            if (model->isActive()) {
-                                model->render(alpha, modelRenderMode);
-                            } else {
-                                // if we couldn't get a model, then just draw a sphere
-                                glColor3ub(modelItem.getColor()[RED_INDEX],modelItem.getColor()[GREEN_INDEX],modelItem.getColor()[BLUE_INDEX]);
-                                glPushMatrix();
-                                    glTranslatef(position.x, position.y, position.z);
-                                    glutSolidSphere(radius, 15, 15);
-                                glPopMatrix();
-                            }
+                            // if we couldn't get a model, then just draw a sphere
+                            _spheres.add(position, radius, modelItem.getColor());
                         }
 
                         if (!isShadowMode && displayModelBounds) {
@@ -333,21 +461,13 @@ void ModelTreeRenderer::renderElement(OctreeElement* element, RenderArgs* args)
                         }
                     } else {
                         // if we couldn't get a model, then just draw a sphere
-                        glColor3ub(modelItem.getColor()[RED_INDEX],modelItem.getColor()[GREEN_INDEX],modelItem.getColor()[BLUE_INDEX]);
-                        glPushMatrix();
-                            glTranslatef(position.x, position.y, position.z);
-                            glutSolidSphere(radius, 15, 15);
-                        glPopMatrix();
+                        _spheres.add(position, radius, modelItem.getColor());
                     }
                 }
                 glPopMatrix();
             } else {
-                //glColor3ub(modelItem.getColor()[RED_INDEX],modelItem.getColor()[GREEN_INDEX],modelItem.getColor()[BLUE_INDEX]);
-                glColor3f(1.0f, 0.0f, 0.0f);
-                glPushMatrix();
-                    glTranslatef(position.x, position.y, position.z);
-                    glutSolidSphere(radius, 15, 15);
-                glPopMatrix();
+                const rgbColor NO_MODEL_COLOR = { 255, 0, 0 };
+                _spheres.add(position, radius, NO_MODEL_COLOR);
             }
         } else {
             args->_itemsOutOfView++;
@@ -23,7 +23,24 @@
 #include <SharedUtil.h>
 #include <ViewFrustum.h>
 
+#include "renderer/InstancedSpheres.h"
 #include "renderer/Model.h"
+#include "renderer/OcclusionQueries.h"
+
+/// a model without an animation, to be drawn with the others of its URL once the tree has been visited
+struct StaticModelInstance {
+    glm::vec3 position;
+    glm::quat rotation;
+    float radius;
+    float glowLevel;
+    rgbColor color;
+};
+
+/// a model with an animation, simulated as its element was visited, to be drawn once the tree has been
+struct AnimatedModelInstance {
+    Model* model;
+    float glowLevel;
+};
 
 // Generic client side Octree renderer class.
 class ModelTreeRenderer : public OctreeRenderer, public ModelItemFBXService {
@@ -49,6 +66,10 @@ public:
     virtual void init();
     virtual void render(RenderMode renderMode = DEFAULT_RENDER_MODE);
 
+    /// draws the models found by the last render again without visiting the tree, for the second eye of a stereo
+    /// pair, which is culled against the same view frustum as the first
+    void renderAgain(RenderMode renderMode = DEFAULT_RENDER_MODE);
+
     virtual const FBXGeometry* getGeometryForModel(const ModelItem& modelItem);
 
     /// clears the tree
@@ -57,8 +78,27 @@ public:
 protected:
     void clearModelsCache();
     Model* getModel(const ModelItem& modelItem);
+
+    /// the model shared by the models of a URL that don't animate
+    Model* getStaticModel(const QString& url);
+
+    /// draws the models that don't animate a URL at a time, through one Model simulated once for each pose
+    void renderStaticModels(RenderMode renderMode);
+
+    /// draws the models and spheres collected as the tree was visited
+    void renderCollected(RenderMode renderMode);
+
     QMap<uint32_t, Model*> _knownModelsItemModels;
     QMap<uint32_t, Model*> _unknownModelsItemModels;
+    QHash<QString, Model*> _staticModels;
+    QHash<QString, QVector<StaticModelInstance> > _staticModelInstances;
+    QVector<AnimatedModelInstance> _animatedModelInstances;
+    InstancedSpheres _spheres;
+
+    /// the boxes of the models in view, tested once the models have been drawn; the models that the last results
+    /// found hidden are left out until they're found visible again
+    OcclusionQueries _occlusionQueries;
+    QVector<OcclusionBox> _occlusionBoxes;
 };
 
 #endif // hifi_ModelTreeRenderer_h
@@ -13,6 +13,7 @@
 
 #include "InterfaceConfig.h"
 
+#include "Menu.h"
 #include "ParticleTreeRenderer.h"
 
 ParticleTreeRenderer::ParticleTreeRenderer() :
@@ -41,6 +42,9 @@ void ParticleTreeRenderer::update() {
 
 void ParticleTreeRenderer::render(RenderMode renderMode) {
     OctreeRenderer::render(renderMode);
+
+    // the particles that aren't models were collected as the elements were rendered, to be drawn together
+    _spheres.render();
 }
 
 Model* ParticleTreeRenderer::getModel(const QString& url) {
@@ -118,10 +122,7 @@ void ParticleTreeRenderer::renderElement(OctreeElement* element, RenderArgs* arg
 
             glPopMatrix();
         } else {
-            glPushMatrix();
-                glTranslatef(position.x, position.y, position.z);
-                glutSolidSphere(radius, 15, 15);
-            glPopMatrix();
+            _spheres.add(position, radius, particle.getColor());
         }
     }
 }
@@ -133,3 +134,11 @@ void ParticleTreeRenderer::processEraseMessage(const QByteArray& dataByteArray,
         _tree->unlock();
     }
 }
+
+float ParticleTreeRenderer::getSizeScale() const {
+    return Menu::getInstance()->getVoxelSizeScale();
+}
+
+int ParticleTreeRenderer::getBoundaryLevelAdjust() const {
+    return Menu::getInstance()->getBoundaryLevelAdjust();
+}
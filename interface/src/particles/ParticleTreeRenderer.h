@@ -22,6 +22,7 @@
 #include <OctreeRenderer.h>
 #include <ParticleTree.h>
 #include <ViewFrustum.h>
+#include "renderer/InstancedSpheres.h"
 #include "renderer/Model.h"
 
 // Generic client side Octree renderer class.
@@ -35,6 +36,8 @@ public:
     virtual PacketType getMyQueryMessageType() const { return PacketTypeParticleQuery; }
     virtual PacketType getExpectedPacketType() const { return PacketTypeParticleData; }
     virtual void renderElement(OctreeElement* element, RenderArgs* args);
+    virtual float getSizeScale() const;
+    virtual int getBoundaryLevelAdjust() const;
 
     void update();
 
@@ -49,6 +52,7 @@ protected:
     Model* getModel(const QString& url);
 
     QMap<QString, Model*> _particleModels;
+    InstancedSpheres _spheres;
 };
 
 #endif // hifi_ParticleTreeRenderer_h
@@ -115,18 +115,30 @@ void AmbientOcclusionEffect::render() {
     int viewport[4];
     glGetIntegerv(GL_VIEWPORT, viewport);
     const int VIEWPORT_X_INDEX = 0;
+    const int VIEWPORT_Y_INDEX = 1;
     const int VIEWPORT_WIDTH_INDEX = 2;
+    const int VIEWPORT_HEIGHT_INDEX = 3;
     QSize widgetSize = Application::getInstance()->getGLWidget()->size();
     float sMin = viewport[VIEWPORT_X_INDEX] / (float)widgetSize.width();
     float sWidth = viewport[VIEWPORT_WIDTH_INDEX] / (float)widgetSize.width();
     
+    // at half resolution, the occlusion is rendered to the corresponding quarter of the buffer, which the blur samples
+    // bilinearly, scaling it back up as it blurs it
+    bool halfResolution = Menu::getInstance()->isOptionChecked(MenuOption::HalfResolutionAmbientOcclusion);
+    float resolutionScale = halfResolution ? 0.5f : 1.0f;
+    if (halfResolution) {
+        glViewport(viewport[VIEWPORT_X_INDEX] / 2, viewport[VIEWPORT_Y_INDEX] / 2,
+            viewport[VIEWPORT_WIDTH_INDEX] / 2, viewport[VIEWPORT_HEIGHT_INDEX] / 2);
+    }
+    
     _occlusionProgram->bind();
     _occlusionProgram->setUniformValue(_nearLocation, nearVal);
     _occlusionProgram->setUniformValue(_farLocation, farVal);
     _occlusionProgram->setUniformValue(_leftBottomLocation, left, bottom);
     _occlusionProgram->setUniformValue(_rightTopLocation, right, top);
-    _occlusionProgram->setUniformValue(_noiseScaleLocation, viewport[VIEWPORT_WIDTH_INDEX] / (float)ROTATION_WIDTH,
-        widgetSize.height() / (float)ROTATION_HEIGHT);
+    _occlusionProgram->setUniformValue(_noiseScaleLocation,
+        viewport[VIEWPORT_WIDTH_INDEX] * resolutionScale / ROTATION_WIDTH,
+        widgetSize.height() * resolutionScale / ROTATION_HEIGHT);
     _occlusionProgram->setUniformValue(_texCoordOffsetLocation, sMin, 0.0f);
     _occlusionProgram->setUniformValue(_texCoordScaleLocation, sWidth, 1.0f);
     
@@ -134,6 +146,11 @@ void AmbientOcclusionEffect::render() {
     
     _occlusionProgram->release();
     
+    if (halfResolution) {
+        glViewport(viewport[VIEWPORT_X_INDEX], viewport[VIEWPORT_Y_INDEX],
+            viewport[VIEWPORT_WIDTH_INDEX], viewport[VIEWPORT_HEIGHT_INDEX]);
+    }
+    
     freeFBO->release();
     
     glBindTexture(GL_TEXTURE_2D, 0);
@@ -150,7 +167,7 @@ void AmbientOcclusionEffect::render() {
     _blurProgram->bind();
     _blurProgram->setUniformValue(_blurScaleLocation, 1.0f / widgetSize.width(), 1.0f / widgetSize.height());
     
-    renderFullscreenQuad(sMin, sMin + sWidth);
+    renderFullscreenQuad(sMin * resolutionScale, (sMin + sWidth) * resolutionScale, 0.0f, resolutionScale);
     
     _blurProgram->release();
     
@@ -0,0 +1,180 @@
+//
+//  FrameCapture.cpp
+//  interface/src/renderer
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#include <cstring>
+
+#include <QAtomicInt>
+#include <QDebug>
+#include <QDir>
+#include <QThreadPool>
+
+#include "FrameCapture.h"
+
+// buffers enough for a read a frame, each given the frames after it to finish before it's mapped
+const int READ_BUFFER_COUNT = 3;
+const int FRAMES_BEFORE_MAP = 2;
+
+const int BYTES_PER_PIXEL = 4;
+
+// the captured frames waiting to be written, each thread of the pool having at most this many before frames are dropped
+const int PENDING_FRAME_WRITES_PER_THREAD = 2;
+static QAtomicInt pendingFrameWrites;
+
+/// Writes a frame of a capture to a file.
+class CapturedFrameWriter : public FrameEncoder {
+public:
+
+    CapturedFrameWriter(const QString& fileName) : _fileName(fileName) { pendingFrameWrites.ref(); }
+    virtual ~CapturedFrameWriter() { pendingFrameWrites.deref(); }
+
+protected:
+
+    // with the least compression, since the frames come faster than they could be squeezed
+    virtual void encode(const QImage& image) { image.save(_fileName, "PNG", 100); }
+
+private:
+
+    QString _fileName;
+};
+
+FrameEncoder::FrameEncoder() {
+}
+
+void FrameEncoder::run() {
+    encode(_image.mirrored());
+}
+
+FrameCapture::FrameCapture() :
+    _frameCount(0),
+    _capturedFrames(0),
+    _droppedFrames(0) {
+}
+
+FrameCapture::~FrameCapture() {
+    foreach (const PendingRead& read, _reads) {
+        qDeleteAll(read.encoders);
+#ifdef GL_PIXEL_PACK_BUFFER
+        glDeleteBuffers(1, &read.buffer);
+#endif
+    }
+    qDeleteAll(_requested);
+}
+
+void FrameCapture::requestFrame(FrameEncoder* encoder) {
+    _requested.append(encoder);
+}
+
+void FrameCapture::setCaptureDirectory(const QString& directory) {
+    if (!_captureDirectory.isEmpty()) {
+        qDebug() << "Captured" << _capturedFrames << "frames to" << _captureDirectory << "and dropped" << _droppedFrames;
+    }
+    _captureDirectory = directory;
+    _capturedFrames = 0;
+    _droppedFrames = 0;
+    if (!_captureDirectory.isEmpty()) {
+        QDir().mkpath(_captureDirectory);
+        qDebug() << "Capturing frames to" << _captureDirectory;
+    }
+}
+
+void FrameCapture::frameFinished(int width, int height) {
+    // the reads the GPU has had the time to finish are mapped without waiting for it
+    for (int i = 0; i < _reads.size(); i++) {
+        if (_reads.at(i).frame != -1 && _frameCount - _reads.at(i).frame >= FRAMES_BEFORE_MAP) {
+            finishRead(_reads[i]);
+        }
+    }
+
+    if (!_captureDirectory.isEmpty()) {
+        int maxPendingFrameWrites = QThreadPool::globalInstance()->maxThreadCount() * PENDING_FRAME_WRITES_PER_THREAD;
+        if (pendingFrameWrites.load() >= maxPendingFrameWrites) {
+            _droppedFrames++;
+        } else {
+            _requested.append(new CapturedFrameWriter(QDir(_captureDirectory).filePath(
+                QString("frame-%1.png").arg(_capturedFrames++, 6, 10, QChar('0')))));
+        }
+    }
+    if (_requested.isEmpty()) {
+        _frameCount++;
+        return;
+    }
+
+#ifdef GL_PIXEL_PACK_BUFFER
+    // a free buffer if there is one, else the oldest read, which then has to be waited for
+    int readIndex = -1;
+    for (int i = 0; i < _reads.size() && readIndex == -1; i++) {
+        if (_reads.at(i).frame == -1) {
+            readIndex = i;
+        }
+    }
+    if (readIndex == -1 && _reads.size() < READ_BUFFER_COUNT) {
+        PendingRead read = { 0, 0, 0, -1 };
+        glGenBuffers(1, &read.buffer);
+        readIndex = _reads.size();
+        _reads.append(read);
+    }
+    if (readIndex == -1) {
+        readIndex = 0;
+        for (int i = 1; i < _reads.size(); i++) {
+            if (_reads.at(i).frame < _reads.at(readIndex).frame) {
+                readIndex = i;
+            }
+        }
+        finishRead(_reads[readIndex]);
+    }
+    PendingRead& read = _reads[readIndex];
+
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, read.buffer);
+    if (read.width != width || read.height != height) {
+        glBufferData(GL_PIXEL_PACK_BUFFER, width * height * BYTES_PER_PIXEL, NULL, GL_STREAM_READ);
+        read.width = width;
+        read.height = height;
+    }
+    glReadPixels(0, 0, width, height, GL_BGRA, GL_UNSIGNED_BYTE, 0);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    read.frame = _frameCount;
+    read.encoders = _requested;
+#else
+    // without pixel buffer objects, the read waits for the frame to be drawn
+    QImage image(width, height, QImage::Format_RGB32);
+    glReadPixels(0, 0, width, height, GL_BGRA, GL_UNSIGNED_BYTE, image.bits());
+    startEncoders(image, _requested);
+#endif
+    _requested.clear();
+    _frameCount++;
+}
+
+void FrameCapture::finishRead(PendingRead& read) {
+#ifdef GL_PIXEL_PACK_BUFFER
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, read.buffer);
+    const uchar* pixels = static_cast<const uchar*>(glMapBuffer(GL_PIXEL_PACK_BUFFER, GL_READ_ONLY));
+    if (pixels) {
+        // copied out so that the buffer can be used again, and flipped on the encoders' thread
+        QImage image(read.width, read.height, QImage::Format_RGB32);
+        memcpy(image.bits(), pixels, read.width * read.height * BYTES_PER_PIXEL);
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+        startEncoders(image, read.encoders);
+    } else {
+        qDebug() << "Couldn't map a captured frame.";
+        qDeleteAll(read.encoders);
+        read.encoders.clear();
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    read.frame = -1;
+#endif
+}
+
+void FrameCapture::startEncoders(const QImage& image, QList<FrameEncoder*>& encoders) {
+    foreach (FrameEncoder* encoder, encoders) {
+        encoder->setImage(image);
+        QThreadPool::globalInstance()->start(encoder);
+    }
+    encoders.clear();
+}
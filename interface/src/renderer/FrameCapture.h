@@ -0,0 +1,90 @@
+//
+//  FrameCapture.h
+//  interface/src/renderer
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#ifndef hifi_FrameCapture_h
+#define hifi_FrameCapture_h
+
+#include <QImage>
+#include <QList>
+#include <QRunnable>
+#include <QString>
+#include <QVector>
+
+#include "InterfaceConfig.h"
+
+/// Does something with the image of a captured frame, such as encoding it to a file, on a thread of the global pool.
+class FrameEncoder : public QRunnable {
+public:
+
+    FrameEncoder();
+
+    /// the frame as it was read from the frame buffer, bottom row first
+    void setImage(const QImage& image) { _image = image; }
+
+    virtual void run();
+
+protected:
+
+    /// called on the pool's thread with the frame the right way up
+    virtual void encode(const QImage& image) = 0;
+
+private:
+
+    QImage _image;
+};
+
+/// Reads frames back from the frame buffer into pixel buffer objects, so that a read finishes while the frames after it
+/// are drawn rather than stalling the one it's in. Each buffer is mapped a couple of frames later, once the GPU has
+/// caught up, and its image handed on to the encoders waiting for it. Every frame can be captured to a directory as well,
+/// for recording benchmarks; frames are dropped rather than let the encoders fall behind.
+class FrameCapture {
+public:
+
+    FrameCapture();
+    ~FrameCapture();
+
+    /// the encoder gets the next frame finished, and is deleted once it's run
+    void requestFrame(FrameEncoder* encoder);
+
+    /// captures every frame as a numbered image in the directory until called with an empty one
+    void setCaptureDirectory(const QString& directory);
+
+    /// reads the frame in the back buffer for the encoders waiting for it, and maps the reads old enough to be done;
+    /// called at the end of each frame, with the context current
+    void frameFinished(int width, int height);
+
+private:
+
+    // disallow copying of FrameCapture objects
+    FrameCapture(const FrameCapture&);
+    FrameCapture& operator= (const FrameCapture&);
+
+    class PendingRead {
+    public:
+        GLuint buffer;
+        int width;
+        int height;
+        int frame; /// the frame it was read in, or -1 if the buffer is free
+        QList<FrameEncoder*> encoders;
+    };
+
+    void finishRead(PendingRead& read);
+    void startEncoders(const QImage& image, QList<FrameEncoder*>& encoders);
+
+    QVector<PendingRead> _reads;
+    QList<FrameEncoder*> _requested;
+    int _frameCount;
+
+    QString _captureDirectory;
+    int _capturedFrames;
+    int _droppedFrames;
+};
+
+#endif // hifi_FrameCapture_h
@@ -15,232 +15,267 @@
 #include <QRunnable>
 #include <QThreadPool>
 
+#include <glm/gtc/type_ptr.hpp>
+
 #include "Application.h"
 #include "GeometryCache.h"
 #include "Model.h"
+#include "ProgramObject.h"
 #include "world.h"
+#include "voxels/VoxelChunkMesher.h"
+
+GeometryCache::GeometryCache() :
+    _primitiveVertexBuffer(0),
+    _primitiveIndexBuffer(0),
+    _instanceBuffer(0),
+    _instanceBufferCapacity(0),
+    _instancingSupported(false),
+    _instanceProgram(NULL) {
+}
 
 GeometryCache::~GeometryCache() {
-    foreach (const VerticesIndices& vbo, _hemisphereVBOs) {
-        glDeleteBuffers(1, &vbo.first);
-        glDeleteBuffers(1, &vbo.second);
+    if (_primitiveVertexBuffer) {
+        glDeleteBuffers(1, &_primitiveVertexBuffer);
+        glDeleteBuffers(1, &_primitiveIndexBuffer);
+    }
+    if (_instanceBuffer) {
+        glDeleteBuffers(1, &_instanceBuffer);
     }
+    delete _instanceProgram;
+}
+
+void GeometryCache::renderSphere(int slices, int stacks) {
+    renderPrimitive(SPHERE_PRIMITIVE, slices, stacks);
 }
 
 void GeometryCache::renderHemisphere(int slices, int stacks) {
-    VerticesIndices& vbo = _hemisphereVBOs[IntPair(slices, stacks)];
-    int vertices = slices * (stacks - 1) + 1;
-    int indices = slices * 2 * 3 * (stacks - 2) + slices * 3;
-    if (vbo.first == 0) {    
-        GLfloat* vertexData = new GLfloat[vertices * 3];
-        GLfloat* vertex = vertexData;
-        for (int i = 0; i < stacks - 1; i++) {
-            float phi = PI_OVER_TWO * (float)i / (float)(stacks - 1);
-            float z = sinf(phi), radius = cosf(phi);
-            
-            for (int j = 0; j < slices; j++) {
-                float theta = TWO_PI * (float)j / (float)slices;
+    renderPrimitive(HEMISPHERE_PRIMITIVE, slices, stacks);
+}
 
-                *(vertex++) = sinf(theta) * radius;
-                *(vertex++) = cosf(theta) * radius;
-                *(vertex++) = z;
-            }
+void GeometryCache::renderSquare(int xDivisions, int yDivisions) {
+    renderPrimitive(SQUARE_PRIMITIVE, xDivisions, yDivisions);
+}
+
+void GeometryCache::renderHalfCylinder(int slices, int stacks) {
+    renderPrimitive(HALF_CYLINDER_PRIMITIVE, slices, stacks);
+}
+
+void GeometryCache::renderGrid(int xDivisions, int yDivisions) {
+    renderPrimitive(GRID_PRIMITIVE, xDivisions, yDivisions);
+}
+
+void GeometryCache::renderInstances(PrimitiveType type, int xDivisions, int yDivisions,
+        const QVector<glm::mat4>& transforms, const QVector<glm::vec4>& colors) {
+    if (transforms.isEmpty()) {
+        return;
+    }
+    Primitive primitive = getPrimitive(type, xDivisions, yDivisions);
+    if (!_instanceProgram) {
+        _instancingSupported = VoxelChunkMesher::isInstancingSupported();
+        _instanceProgram = new ProgramObject();
+        _instanceProgram->addShaderFromSourceFile(QGLShader::Vertex,
+            Application::resourcesPath() + "shaders/instanced_primitive.vert");
+        _instanceProgram->link();
+        _instanceTransformLocation = _instanceProgram->attributeLocation("instanceTransform");
+        _instanceColorLocation = _instanceProgram->attributeLocation("instanceColor");
+    }
+    bindPrimitives();
+
+    if (_instancingSupported) {
+        _instances.resize(transforms.size());
+        for (int i = 0; i < transforms.size(); i++) {
+            PrimitiveInstance& instance = _instances[i];
+            instance.transform = transforms.at(i);
+            instance.color = colors.at(i);
         }
-        *(vertex++) = 0.0f;
-        *(vertex++) = 0.0f;
-        *(vertex++) = 1.0f;
-        
-        glGenBuffers(1, &vbo.first);
-        glBindBuffer(GL_ARRAY_BUFFER, vbo.first);
-        const int BYTES_PER_VERTEX = 3 * sizeof(GLfloat);
-        glBufferData(GL_ARRAY_BUFFER, vertices * BYTES_PER_VERTEX, vertexData, GL_STATIC_DRAW);
-        delete[] vertexData;
-        
-        GLushort* indexData = new GLushort[indices];
-        GLushort* index = indexData;
-        for (int i = 0; i < stacks - 2; i++) {
-            GLushort bottom = i * slices;
-            GLushort top = bottom + slices;
-            for (int j = 0; j < slices; j++) {
-                int next = (j + 1) % slices;
-                
-                *(index++) = bottom + j;
-                *(index++) = top + next;
-                *(index++) = top + j;
-                
-                *(index++) = bottom + j;
-                *(index++) = bottom + next;
-                *(index++) = top + next;
-            }
+        if (!_instanceBuffer) {
+            glGenBuffers(1, &_instanceBuffer);
         }
-        GLushort bottom = (stacks - 2) * slices;
-        GLushort top = bottom + slices;
-        for (int i = 0; i < slices; i++) {    
-            *(index++) = bottom + i;
-            *(index++) = bottom + (i + 1) % slices;
-            *(index++) = top;
+        glBindBuffer(GL_ARRAY_BUFFER, _instanceBuffer);
+        if (_instances.size() > _instanceBufferCapacity) {
+            _instanceBufferCapacity = _instances.size() * 2;
+            glBufferData(GL_ARRAY_BUFFER, _instanceBufferCapacity * sizeof(PrimitiveInstance), NULL, GL_STREAM_DRAW);
         }
-        
-        glGenBuffers(1, &vbo.second);
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, vbo.second);
-        const int BYTES_PER_INDEX = sizeof(GLushort);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices * BYTES_PER_INDEX, indexData, GL_STATIC_DRAW);
-        delete[] indexData;
-    
+        glBufferSubData(GL_ARRAY_BUFFER, 0, _instances.size() * sizeof(PrimitiveInstance), _instances.constData());
+
+        // the transform takes up an attribute slot for each of its columns
+        const int TRANSFORM_COLUMNS = 4;
+        _instanceProgram->bind();
+        for (int i = 0; i < TRANSFORM_COLUMNS; i++) {
+            glEnableVertexAttribArray(_instanceTransformLocation + i);
+            glVertexAttribDivisorARB(_instanceTransformLocation + i, 1);
+            glVertexAttribPointer(_instanceTransformLocation + i, 4, GL_FLOAT, GL_FALSE, sizeof(PrimitiveInstance),
+                (void*)(i * sizeof(glm::vec4)));
+        }
+        glEnableVertexAttribArray(_instanceColorLocation);
+        glVertexAttribDivisorARB(_instanceColorLocation, 1);
+        glVertexAttribPointer(_instanceColorLocation, 4, GL_FLOAT, GL_FALSE, sizeof(PrimitiveInstance),
+            (void*)sizeof(glm::mat4));
+
+        drawPrimitive(primitive, _instances.size());
+
+        // the divisors stick to the attribute slots, so put them back for the other programs that use them
+        for (int i = 0; i < TRANSFORM_COLUMNS; i++) {
+            glVertexAttribDivisorARB(_instanceTransformLocation + i, 0);
+            glDisableVertexAttribArray(_instanceTransformLocation + i);
+        }
+        glVertexAttribDivisorARB(_instanceColorLocation, 0);
+        glDisableVertexAttribArray(_instanceColorLocation);
+        _instanceProgram->release();
+
+        // keep the capacity for the next batch
+        _instances.resize(0);
+
     } else {
-        glBindBuffer(GL_ARRAY_BUFFER, vbo.first);
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, vbo.second);
+        // the normals are scaled along with the primitives
+        glEnable(GL_NORMALIZE);
+        for (int i = 0; i < transforms.size(); i++) {
+            const glm::vec4& color = colors.at(i);
+            glColor4f(color.r, color.g, color.b, color.a);
+            glPushMatrix();
+                glMultMatrixf(glm::value_ptr(transforms.at(i)));
+                drawPrimitive(primitive);
+            glPopMatrix();
+        }
+        glDisable(GL_NORMALIZE);
     }
-    glEnableClientState(GL_VERTEX_ARRAY);
-    glEnableClientState(GL_NORMAL_ARRAY);
- 
-    glVertexPointer(3, GL_FLOAT, 0, 0);
-    glNormalPointer(GL_FLOAT, 0, 0);
-        
-    glDrawRangeElementsEXT(GL_TRIANGLES, 0, vertices - 1, indices, GL_UNSIGNED_SHORT, 0);
-        
-    glDisableClientState(GL_VERTEX_ARRAY);
-    glDisableClientState(GL_NORMAL_ARRAY);
-    
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+
+    releasePrimitives();
 }
 
-void GeometryCache::renderSquare(int xDivisions, int yDivisions) {
-    VerticesIndices& vbo = _squareVBOs[IntPair(xDivisions, yDivisions)];
-    int xVertices = xDivisions + 1;
-    int yVertices = yDivisions + 1;
-    int vertices = xVertices * yVertices;
-    int indices = 2 * 3 * xDivisions * yDivisions;
-    if (vbo.first == 0) {
-        GLfloat* vertexData = new GLfloat[vertices * 3];
-        GLfloat* vertex = vertexData;
-        for (int i = 0; i <= yDivisions; i++) {
-            float y = (float)i / yDivisions;
+GeometryCache::Primitive GeometryCache::getPrimitive(PrimitiveType type, int xDivisions, int yDivisions) {
+    PrimitiveKey key(type, IntPair(xDivisions, yDivisions));
+    QHash<PrimitiveKey, Primitive>::const_iterator it = _primitives.constFind(key);
+    if (it != _primitives.constEnd()) {
+        return it.value();
+    }
+    Primitive primitive = { GL_TRIANGLES, _primitiveVertices.size(), 0, _primitiveIndices.size(), 0 };
+    switch (type) {
+        case SPHERE_PRIMITIVE: {
+            int slices = xDivisions, stacks = yDivisions;
+            for (int i = 0; i <= stacks; i++) {
+                float phi = PI * (float)i / stacks - PI_OVER_TWO;
+                float z = sinf(phi), radius = cosf(phi);
+                
+                for (int j = 0; j <= slices; j++) {
+                    float theta = TWO_PI * (float)j / slices;
+                    glm::vec3 vertex(cosf(theta) * radius, sinf(theta) * radius, z);
+                    addVertex(vertex, vertex);
+                }
+            }
+            addTriangleStrips(primitive.firstVertex, slices + 1, stacks + 1, false);
+            break;
+        }
+        case HEMISPHERE_PRIMITIVE: {
+            int slices = xDivisions, stacks = yDivisions;
+            for (int i = 0; i < stacks - 1; i++) {
+                float phi = PI_OVER_TWO * (float)i / (float)(stacks - 1);
+                float z = sinf(phi), radius = cosf(phi);
+                
+                for (int j = 0; j < slices; j++) {
+                    float theta = TWO_PI * (float)j / (float)slices;
+                    glm::vec3 vertex(sinf(theta) * radius, cosf(theta) * radius, z);
+                    addVertex(vertex, vertex);
+                }
+            }
+            addVertex(glm::vec3(0.0f, 0.0f, 1.0f), glm::vec3(0.0f, 0.0f, 1.0f));
             
-            for (int j = 0; j <= xDivisions; j++) {
-                *(vertex++) = (float)j / xDivisions;
-                *(vertex++) = y;
-                *(vertex++) = 0.0f;
+            addTriangleStrips(primitive.firstVertex, slices, stacks - 1, true);
+            GLuint bottom = primitive.firstVertex + (stacks - 2) * slices;
+            GLuint top = bottom + slices;
+            for (int i = 0; i < slices; i++) {
+                _primitiveIndices << bottom + i << bottom + (i + 1) % slices << top;
             }
+            break;
         }
-        
-        glGenBuffers(1, &vbo.first);
-        glBindBuffer(GL_ARRAY_BUFFER, vbo.first);
-        const int BYTES_PER_VERTEX = 3 * sizeof(GLfloat);
-        glBufferData(GL_ARRAY_BUFFER, vertices * BYTES_PER_VERTEX, vertexData, GL_STATIC_DRAW);
-        delete[] vertexData;
-        
-        GLushort* indexData = new GLushort[indices];
-        GLushort* index = indexData;
-        for (int i = 0; i < yDivisions; i++) {
-            GLushort bottom = i * xVertices;
-            GLushort top = bottom + xVertices;
-            for (int j = 0; j < xDivisions; j++) {
-                int next = j + 1;
+        case SQUARE_PRIMITIVE: {
+            // all vertices have the same normal
+            for (int i = 0; i <= yDivisions; i++) {
+                float y = (float)i / yDivisions;
                 
-                *(index++) = bottom + j;
-                *(index++) = top + next;
-                *(index++) = top + j;
+                for (int j = 0; j <= xDivisions; j++) {
+                    addVertex(glm::vec3((float)j / xDivisions, y, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f));
+                }
+            }
+            addTriangleStrips(primitive.firstVertex, xDivisions + 1, yDivisions + 1, false);
+            break;
+        }
+        case HALF_CYLINDER_PRIMITIVE: {
+            int slices = xDivisions, stacks = yDivisions;
+            for (int i = 0; i <= (stacks - 1); i++) {
+                float y = (float)i / (stacks - 1);
                 
-                *(index++) = bottom + j;
-                *(index++) = bottom + next;
-                *(index++) = top + next;
+                for (int j = 0; j <= slices; j++) {
+                    float theta = 3.0f * PI_OVER_TWO + PI * (float)j / (float)slices;
+                    addVertex(glm::vec3(sinf(theta), y, cosf(theta)), glm::vec3(sinf(theta), 0.0f, cosf(theta)));
+                }
             }
+            addTriangleStrips(primitive.firstVertex, slices + 1, stacks, false);
+            break;
+        }
+        case GRID_PRIMITIVE: {
+            primitive.mode = GL_LINES;
+            const glm::vec3 normal(0.0f, 0.0f, 1.0f);
+            for (int i = 0; i <= xDivisions; i++) {
+                float x = (float)i / xDivisions;
+                addVertex(glm::vec3(x, 0.0f, 0.0f), normal);
+                addVertex(glm::vec3(x, 1.0f, 0.0f), normal);
+            }
+            for (int i = 0; i <= yDivisions; i++) {
+                float y = (float)i / yDivisions;
+                addVertex(glm::vec3(0.0f, y, 0.0f), normal);
+                addVertex(glm::vec3(1.0f, y, 0.0f), normal);
+            }
+            for (int i = primitive.firstVertex; i < _primitiveVertices.size(); i++) {
+                _primitiveIndices.append(i);
+            }
+            break;
         }
-        
-        glGenBuffers(1, &vbo.second);
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, vbo.second);
-        const int BYTES_PER_INDEX = sizeof(GLushort);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices * BYTES_PER_INDEX, indexData, GL_STATIC_DRAW);
-        delete[] indexData;
-        
-    } else {
-        glBindBuffer(GL_ARRAY_BUFFER, vbo.first);
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, vbo.second);
     }
-    glEnableClientState(GL_VERTEX_ARRAY);
- 
-    // all vertices have the same normal
-    glNormal3f(0.0f, 0.0f, 1.0f);
-    
-    glVertexPointer(3, GL_FLOAT, 0, 0);
-        
-    glDrawRangeElementsEXT(GL_TRIANGLES, 0, vertices - 1, indices, GL_UNSIGNED_SHORT, 0);
-        
-    glDisableClientState(GL_VERTEX_ARRAY);
+    primitive.vertexCount = _primitiveVertices.size() - primitive.firstVertex;
+    primitive.indexCount = _primitiveIndices.size() - primitive.firstIndex;
+    _primitives.insert(key, primitive);
     
+    // there are few enough primitives, added rarely enough, that the buffers can be uploaded whole each time
+    if (!_primitiveVertexBuffer) {
+        glGenBuffers(1, &_primitiveVertexBuffer);
+        glGenBuffers(1, &_primitiveIndexBuffer);
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, _primitiveVertexBuffer);
+    glBufferData(GL_ARRAY_BUFFER, _primitiveVertices.size() * sizeof(PrimitiveVertex),
+        _primitiveVertices.constData(), GL_STATIC_DRAW);
     glBindBuffer(GL_ARRAY_BUFFER, 0);
+    
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, _primitiveIndexBuffer);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, _primitiveIndices.size() * sizeof(GLuint),
+        _primitiveIndices.constData(), GL_STATIC_DRAW);
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+    
+    return primitive;
 }
 
-void GeometryCache::renderHalfCylinder(int slices, int stacks) {
-    VerticesIndices& vbo = _halfCylinderVBOs[IntPair(slices, stacks)];
-    int vertices = (slices + 1) * stacks;
-    int indices = 2 * 3 * slices * (stacks - 1);
-    if (vbo.first == 0) {    
-        GLfloat* vertexData = new GLfloat[vertices * 2 * 3];
-        GLfloat* vertex = vertexData;
-        for (int i = 0; i <= (stacks - 1); i++) {
-            float y = (float)i / (stacks - 1);
-            
-            for (int j = 0; j <= slices; j++) {
-                float theta = 3.f * PI_OVER_TWO + PI * (float)j / (float)slices;
-
-                //normals
-                *(vertex++) = sinf(theta);
-                *(vertex++) = 0;
-                *(vertex++) = cosf(theta);
-
-                // vertices
-                *(vertex++) = sinf(theta);
-                *(vertex++) = y;
-                *(vertex++) = cosf(theta);
-            }
-        }
-        
-        glGenBuffers(1, &vbo.first);
-        glBindBuffer(GL_ARRAY_BUFFER, vbo.first);
-        const int BYTES_PER_VERTEX = 3 * sizeof(GLfloat);
-        glBufferData(GL_ARRAY_BUFFER, 2 * vertices * BYTES_PER_VERTEX, vertexData, GL_STATIC_DRAW);
-        delete[] vertexData;
-        
-        GLushort* indexData = new GLushort[indices];
-        GLushort* index = indexData;
-        for (int i = 0; i < stacks - 1; i++) {
-            GLushort bottom = i * (slices + 1);
-            GLushort top = bottom + slices + 1;
-            for (int j = 0; j < slices; j++) {
-                int next = j + 1;
-                
-                *(index++) = bottom + j;
-                *(index++) = top + next;
-                *(index++) = top + j;
-                
-                *(index++) = bottom + j;
-                *(index++) = bottom + next;
-                *(index++) = top + next;
-            }
-        }
-        
-        glGenBuffers(1, &vbo.second);
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, vbo.second);
-        const int BYTES_PER_INDEX = sizeof(GLushort);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices * BYTES_PER_INDEX, indexData, GL_STATIC_DRAW);
-        delete[] indexData;
+void GeometryCache::bindPrimitives() {
+    glBindBuffer(GL_ARRAY_BUFFER, _primitiveVertexBuffer);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, _primitiveIndexBuffer);
     
-    } else {
-        glBindBuffer(GL_ARRAY_BUFFER, vbo.first);
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, vbo.second);
-    }
     glEnableClientState(GL_VERTEX_ARRAY);
     glEnableClientState(GL_NORMAL_ARRAY);
+    
+    glVertexPointer(3, GL_FLOAT, sizeof(PrimitiveVertex), 0);
+    glNormalPointer(GL_FLOAT, sizeof(PrimitiveVertex), (const void*)sizeof(glm::vec3));
+}
 
-    glNormalPointer(GL_FLOAT, 6 * sizeof(float), 0);
-    glVertexPointer(3, GL_FLOAT, (6 * sizeof(float)), (const void *)(3 * sizeof(float)));
-        
-    glDrawRangeElementsEXT(GL_TRIANGLES, 0, vertices - 1, indices, GL_UNSIGNED_SHORT, 0);
-        
+void GeometryCache::drawPrimitive(const Primitive& primitive, int instances) {
+    const void* offset = (const void*)(primitive.firstIndex * sizeof(GLuint));
+    if (instances == 1) {
+        glDrawRangeElementsEXT(primitive.mode, primitive.firstVertex, primitive.firstVertex + primitive.vertexCount - 1,
+            primitive.indexCount, GL_UNSIGNED_INT, offset);
+    } else {
+        glDrawElementsInstancedARB(primitive.mode, primitive.indexCount, GL_UNSIGNED_INT, offset, instances);
+    }
+}
+
+void GeometryCache::releasePrimitives() {
     glDisableClientState(GL_VERTEX_ARRAY);
     glDisableClientState(GL_NORMAL_ARRAY);
     
@@ -248,48 +283,29 @@ void GeometryCache::renderHalfCylinder(int slices, int stacks) {
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
 }
 
-void GeometryCache::renderGrid(int xDivisions, int yDivisions) {
-    QOpenGLBuffer& buffer = _gridBuffers[IntPair(xDivisions, yDivisions)];
-    int vertices = (xDivisions + 1 + yDivisions + 1) * 2;
-    if (!buffer.isCreated()) {
-        GLfloat* vertexData = new GLfloat[vertices * 2];
-        GLfloat* vertex = vertexData;
-        for (int i = 0; i <= xDivisions; i++) {
-            float x = (float)i / xDivisions;
-        
-            *(vertex++) = x;
-            *(vertex++) = 0.0f;
-            
-            *(vertex++) = x;
-            *(vertex++) = 1.0f;
-        }
-        for (int i = 0; i <= yDivisions; i++) {
-            float y = (float)i / yDivisions;
-            
-            *(vertex++) = 0.0f;
-            *(vertex++) = y;
-            
-            *(vertex++) = 1.0f;
-            *(vertex++) = y;
+void GeometryCache::renderPrimitive(PrimitiveType type, int xDivisions, int yDivisions) {
+    Primitive primitive = getPrimitive(type, xDivisions, yDivisions);
+    bindPrimitives();
+    drawPrimitive(primitive);
+    releasePrimitives();
+}
+
+void GeometryCache::addVertex(const glm::vec3& position, const glm::vec3& normal) {
+    PrimitiveVertex vertex = { position, normal };
+    _primitiveVertices.append(vertex);
+}
+
+void GeometryCache::addTriangleStrips(int firstVertex, int rowVertices, int rows, bool wrap) {
+    int columns = wrap ? rowVertices : rowVertices - 1;
+    for (int i = 0; i < rows - 1; i++) {
+        GLuint bottom = firstVertex + i * rowVertices;
+        GLuint top = bottom + rowVertices;
+        for (int j = 0; j < columns; j++) {
+            int next = (j + 1) % rowVertices;
+            _primitiveIndices << bottom + j << top + next << top + j;
+            _primitiveIndices << bottom + j << bottom + next << top + next;
         }
-        buffer.create();
-        buffer.setUsagePattern(QOpenGLBuffer::StaticDraw);
-        buffer.bind();
-        buffer.allocate(vertexData, vertices * 2 * sizeof(GLfloat));
-        delete[] vertexData;
-        
-    } else {
-        buffer.bind();
     }
-    glEnableClientState(GL_VERTEX_ARRAY);
-    
-    glVertexPointer(2, GL_FLOAT, 0, 0);
-    
-    glDrawArrays(GL_LINES, 0, vertices);
-    
-    glDisableClientState(GL_VERTEX_ARRAY);
-    
-    buffer.release();
 }
 
 QSharedPointer<NetworkGeometry> GeometryCache::getGeometry(const QUrl& url, const QUrl& fallback, bool delayLoad) {
@@ -438,6 +454,16 @@ void NetworkGeometry::setLoadPriority(const QPointer<QObject>& owner, float prio
             }
         }
     }
+    
+    NetworkGeometry* lodParent = _lodParent.data();
+    if (lodParent == this) {
+        // the LODs stream in by how near their owners are, whichever LOD the owners are showing
+        foreach (const QSharedPointer<NetworkGeometry>& lod, _lods) {
+            lod->Resource::setLoadPriority(owner, priority);
+        }
+    } else if (lodParent) {
+        lodParent->setLoadPriority(owner, priority);
+    }
 }
 
 void NetworkGeometry::setLoadPriorities(const QHash<QPointer<QObject>, float>& priorities) {
@@ -458,6 +484,16 @@ void NetworkGeometry::setLoadPriorities(const QHash<QPointer<QObject>, float>& p
             }
         }
     }
+    
+    NetworkGeometry* lodParent = _lodParent.data();
+    if (lodParent == this) {
+        // the LODs stream in by how near their owners are, whichever LOD the owners are showing
+        foreach (const QSharedPointer<NetworkGeometry>& lod, _lods) {
+            lod->Resource::setLoadPriorities(priorities);
+        }
+    } else if (lodParent) {
+        lodParent->setLoadPriorities(priorities);
+    }
 }
 
 void NetworkGeometry::clearLoadPriority(const QPointer<QObject>& owner) {
@@ -478,6 +514,16 @@ void NetworkGeometry::clearLoadPriority(const QPointer<QObject>& owner) {
             }
         }
     }
+    
+    NetworkGeometry* lodParent = _lodParent.data();
+    if (lodParent == this) {
+        // the LODs stream in by how near their owners are, whichever LOD the owners are showing
+        foreach (const QSharedPointer<NetworkGeometry>& lod, _lods) {
+            lod->Resource::clearLoadPriority(owner);
+        }
+    } else if (lodParent) {
+        lodParent->clearLoadPriority(owner);
+    }
 }
 
 /// Reads geometry in a worker thread.
@@ -512,18 +558,21 @@ void GeometryReader::run() {
         return;
     }
     try {
+        QString path = _url.path().toLower();
         QMetaObject::invokeMethod(geometry.data(), "setGeometry", Q_ARG(const FBXGeometry&,
-            _url.path().toLower().endsWith(".svo") ? readSVO(_reply->readAll()) : readFBX(_reply->readAll(), _mapping)));
+            path.endsWith(".svo") ? readSVO(_reply->readAll()) : path.endsWith(PRECOMPILED_GEOMETRY_EXTENSION) ?
+                readPrecompiledGeometry(_reply->readAll(), _mapping) : readFBX(_reply->readAll(), _mapping)));
         
     } catch (const QString& error) {
         qDebug() << "Error reading " << _url << ": " << error;
-        QMetaObject::invokeMethod(geometry.data(), "finishedLoading", Q_ARG(bool, false));
+        QMetaObject::invokeMethod(geometry.data(), "handleReadFailure");
     }
     _reply->deleteLater();
 }
 
 void NetworkGeometry::init() {
     _mapping = QVariantHash();
+    _modelURL = QUrl();
     _geometry = FBXGeometry();
     _meshes.clear();
     _lods.clear();
@@ -558,12 +607,26 @@ void NetworkGeometry::downloadFinished(QNetworkReply* reply) {
                 geometry->setLODParent(_lodParent);
                 _lods.insert(it.value().toFloat(), geometry);
             }     
-            _request.setUrl(url.resolved(filename));
+            // prefer the precompiled geometry, if the uploader wrote one, to parsing the FBX
+            QString geometryFilename = _mapping.value("geometry").toString();
+            if (geometryFilename.isNull()) {
+                _request.setUrl(url.resolved(filename));
+            } else {
+                _modelURL = url.resolved(filename);
+                _request.setUrl(url.resolved(geometryFilename));
+            }
             
             // make the request immediately only if we have no LODs to switch between
             _startedLoading = false;
             if (_lods.isEmpty()) {
                 attemptRequest();
+                
+            } else {
+                // the coarsest LOD is the quickest to fetch and parse, so it's loaded straight away to have something
+                // to show while the one for the distance streams in
+                QSharedPointer<NetworkGeometry> coarsest = _lods.last();
+                coarsest->setLoadPriorities(_loadPriorities);
+                coarsest->ensureLoading();
             }
         }
         return;
@@ -573,6 +636,23 @@ void NetworkGeometry::downloadFinished(QNetworkReply* reply) {
     QThreadPool::globalInstance()->start(new GeometryReader(_self, url, reply, _mapping));
 }
 
+bool NetworkGeometry::requestAlternative() {
+    if (_modelURL.isEmpty()) {
+        return false;
+    }
+    qDebug() << "Falling back to " << _modelURL;
+    _request.setUrl(_modelURL);
+    _modelURL = QUrl();
+    attemptRequest();
+    return true;
+}
+
+void NetworkGeometry::handleReadFailure() {
+    if (!requestAlternative()) {
+        finishedLoading(false);
+    }
+}
+
 void NetworkGeometry::reinsert() {
     Resource::reinsert();
     
@@ -585,6 +665,7 @@ void NetworkGeometry::reinsert() {
 void NetworkGeometry::setGeometry(const FBXGeometry& geometry) {
     _geometry = geometry;
     
+    qint64 gpuBytes = 0;
     foreach (const FBXMesh& mesh, _geometry.meshes) {
         NetworkMesh networkMesh = { QOpenGLBuffer(QOpenGLBuffer::IndexBuffer), QOpenGLBuffer(QOpenGLBuffer::VertexBuffer) };
         
@@ -615,6 +696,7 @@ void NetworkGeometry::setGeometry(const FBXGeometry& geometry) {
         networkMesh.indexBuffer.bind();
         networkMesh.indexBuffer.setUsagePattern(QOpenGLBuffer::StaticDraw);
         networkMesh.indexBuffer.allocate(totalIndices * sizeof(int));
+        gpuBytes += totalIndices * sizeof(int);
         int offset = 0;
         foreach (const FBXMeshPart& part, mesh.parts) {
             glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, offset, part.quadIndices.size() * sizeof(int),
@@ -640,6 +722,7 @@ void NetworkGeometry::setGeometry(const FBXGeometry& geometry) {
             int clusterWeightsOffset = clusterIndicesOffset + mesh.clusterIndices.size() * sizeof(glm::vec4);
             
             networkMesh.vertexBuffer.allocate(clusterWeightsOffset + mesh.clusterWeights.size() * sizeof(glm::vec4));
+            gpuBytes += clusterWeightsOffset + mesh.clusterWeights.size() * sizeof(glm::vec4);
             networkMesh.vertexBuffer.write(0, mesh.vertices.constData(), mesh.vertices.size() * sizeof(glm::vec3));
             networkMesh.vertexBuffer.write(normalsOffset, mesh.normals.constData(), mesh.normals.size() * sizeof(glm::vec3));
             networkMesh.vertexBuffer.write(tangentsOffset, mesh.tangents.constData(),
@@ -659,6 +742,7 @@ void NetworkGeometry::setGeometry(const FBXGeometry& geometry) {
             int clusterIndicesOffset = texCoordsOffset + mesh.texCoords.size() * sizeof(glm::vec2);
             int clusterWeightsOffset = clusterIndicesOffset + mesh.clusterIndices.size() * sizeof(glm::vec4);
             networkMesh.vertexBuffer.allocate(clusterWeightsOffset + mesh.clusterWeights.size() * sizeof(glm::vec4));
+            gpuBytes += clusterWeightsOffset + mesh.clusterWeights.size() * sizeof(glm::vec4);
             networkMesh.vertexBuffer.write(0, mesh.tangents.constData(), mesh.tangents.size() * sizeof(glm::vec3));        
             networkMesh.vertexBuffer.write(colorsOffset, mesh.colors.constData(), mesh.colors.size() * sizeof(glm::vec3));    
             networkMesh.vertexBuffer.write(texCoordsOffset, mesh.texCoords.constData(),
@@ -674,6 +758,8 @@ void NetworkGeometry::setGeometry(const FBXGeometry& geometry) {
         _meshes.append(networkMesh);
     }
     
+    // the textures are budgeted for by the texture cache
+    setBytes(_geometry.getMemoryBytes(), gpuBytes);
     finishedLoading(true);
 }
 
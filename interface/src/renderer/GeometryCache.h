@@ -17,6 +17,7 @@
 
 #include <QMap>
 #include <QOpenGLBuffer>
+#include <QVector>
 
 #include <ResourceCache.h>
 
@@ -28,6 +29,7 @@ class Model;
 class NetworkGeometry;
 class NetworkMesh;
 class NetworkTexture;
+class ProgramObject;
 
 /// Stores cached geometry.
 class GeometryCache : public ResourceCache {
@@ -35,12 +37,47 @@ class GeometryCache : public ResourceCache {
 
 public:
     
+    /// The unit sized shapes kept in the shared primitive buffers, each tessellated as many ways as it's asked for.
+    enum PrimitiveType { SPHERE_PRIMITIVE, HEMISPHERE_PRIMITIVE, SQUARE_PRIMITIVE, HALF_CYLINDER_PRIMITIVE,
+        GRID_PRIMITIVE };
+    
+    /// Where a primitive lies in the shared buffers. The indices are absolute, so that any primitive can be drawn
+    /// without rebinding the buffers or repointing the arrays.
+    class Primitive {
+    public:
+        GLenum mode;
+        int firstVertex;
+        int vertexCount;
+        int firstIndex;
+        int indexCount;
+    };
+    
+    GeometryCache();
     virtual ~GeometryCache();
     
+    void renderSphere(int slices, int stacks);
     void renderHemisphere(int slices, int stacks);
     void renderSquare(int xDivisions, int yDivisions);
     void renderHalfCylinder(int slices, int stacks);
     void renderGrid(int xDivisions, int yDivisions);
+    
+    /// Draws a copy of the primitive for each transform, with the matching color and lit by the first light, in one
+    /// instanced draw when the GL has instanced arrays or else in a draw apiece from the buffers bound once. The
+    /// transforms may rotate, translate and scale uniformly.
+    void renderInstances(PrimitiveType type, int xDivisions, int yDivisions,
+        const QVector<glm::mat4>& transforms, const QVector<glm::vec4>& colors);
+    
+    /// Returns the place of the primitive in the shared buffers, adding it to them if it's new; called before they're
+    /// bound, since adding one uploads them again.
+    Primitive getPrimitive(PrimitiveType type, int xDivisions, int yDivisions);
+    
+    /// Binds the shared buffers and points the vertex and normal arrays into them.
+    void bindPrimitives();
+    
+    /// Draws a primitive from the bound buffers; more than one instance requires instanced arrays.
+    void drawPrimitive(const Primitive& primitive, int instances = 1);
+    
+    void releasePrimitives();
 
     /// Loads geometry from the specified URL.
     /// \param fallback a fallback URL to load if the desired one is unavailable
@@ -60,12 +97,38 @@ protected:
 private:
     
     typedef QPair<int, int> IntPair;
-    typedef QPair<GLuint, GLuint> VerticesIndices;
-    
-    QHash<IntPair, VerticesIndices> _hemisphereVBOs;
-    QHash<IntPair, VerticesIndices> _squareVBOs;
-    QHash<IntPair, VerticesIndices> _halfCylinderVBOs;
-    QHash<IntPair, QOpenGLBuffer> _gridBuffers;
+    typedef QPair<int, IntPair> PrimitiveKey;
+    
+    class PrimitiveVertex {
+    public:
+        glm::vec3 position;
+        glm::vec3 normal;
+    };
+    
+    class PrimitiveInstance {
+    public:
+        glm::mat4 transform;
+        glm::vec4 color;
+    };
+    
+    void renderPrimitive(PrimitiveType type, int xDivisions, int yDivisions);
+    void addVertex(const glm::vec3& position, const glm::vec3& normal);
+    void addTriangleStrips(int firstVertex, int rowVertices, int rows, bool wrap);
+    
+    QHash<PrimitiveKey, Primitive> _primitives;
+    QVector<PrimitiveVertex> _primitiveVertices;
+    QVector<GLuint> _primitiveIndices;
+    GLuint _primitiveVertexBuffer;
+    GLuint _primitiveIndexBuffer;
+    
+    QVector<PrimitiveInstance> _instances;
+    GLuint _instanceBuffer;
+    int _instanceBufferCapacity; /// instances
+    
+    bool _instancingSupported;
+    ProgramObject* _instanceProgram;
+    int _instanceTransformLocation;
+    int _instanceColorLocation;
     
     QHash<QUrl, QWeakPointer<NetworkGeometry> > _networkGeometry;
 };
@@ -103,8 +166,10 @@ protected:
     virtual void init();
     virtual void downloadFinished(QNetworkReply* reply);
     virtual void reinsert();
+    virtual bool requestAlternative();
     
     Q_INVOKABLE void setGeometry(const FBXGeometry& geometry);
+    Q_INVOKABLE void handleReadFailure();
     
 private:
     
@@ -113,6 +178,7 @@ private:
     void setLODParent(const QWeakPointer<NetworkGeometry>& lodParent) { _lodParent = lodParent; }
     
     QVariantHash _mapping;
+    QUrl _modelURL; /// the FBX to fall back to if the precompiled geometry can't be loaded
     QUrl _textureBase;
     QSharedPointer<NetworkGeometry> _fallback;
     
@@ -18,6 +18,7 @@
 
 #include "Application.h"
 #include "GlowEffect.h"
+#include "GpuTimer.h"
 #include "ProgramObject.h"
 #include "RenderUtil.h"
 
@@ -121,7 +122,8 @@ static void maybeRelease(QOpenGLFramebufferObject* fbo) {
 }
 
 QOpenGLFramebufferObject* GlowEffect::render(bool toTexture) {
-    PerformanceTimer perfTimer("paintGL/glowEffect");
+    PERFORMANCE_TIMER("paintGL/glowEffect");
+    GpuTimer gpuTimer("paintGL/glowEffect");
 
     QOpenGLFramebufferObject* primaryFBO = Application::getInstance()->getTextureCache()->getPrimaryFramebufferObject();
     primaryFBO->release();
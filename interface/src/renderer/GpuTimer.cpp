@@ -0,0 +1,89 @@
+//
+//  GpuTimer.cpp
+//  interface/src/renderer
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#include <cstring>
+
+#include <PerfStat.h>
+#include <SharedUtil.h>
+
+#include "GpuTimer.h"
+
+const quint64 NSECS_PER_USEC = 1000;
+
+bool GpuTimer::_enabled = false;
+QVector<GpuTimer::PendingScope> GpuTimer::_pendingScopes;
+QVector<GLuint> GpuTimer::_freeQueries;
+
+GpuTimer::GpuTimer(const QString& name) :
+    _name(name),
+    _start(0),
+    _beginQuery(0) {
+
+#ifdef GL_TIMESTAMP
+    if (_enabled) {
+        _start = usecMonotonicNow();
+        _beginQuery = getQuery();
+        glQueryCounter(_beginQuery, GL_TIMESTAMP);
+    }
+#endif
+}
+
+GpuTimer::~GpuTimer() {
+#ifdef GL_TIMESTAMP
+    if (_beginQuery) {
+        PendingScope scope = { _name, _start, _beginQuery, getQuery() };
+        glQueryCounter(scope.endQuery, GL_TIMESTAMP);
+        _pendingScopes.append(scope);
+    }
+#endif
+}
+
+void GpuTimer::resolveQueries(bool enabled) {
+#ifdef GL_TIMESTAMP
+    // the GPU writes the timestamps in the order they were issued, so once one isn't ready, the rest aren't either
+    int resolved = 0;
+    for (; resolved < _pendingScopes.size(); resolved++) {
+        const PendingScope& scope = _pendingScopes.at(resolved);
+        GLint available = 0;
+        glGetQueryObjectiv(scope.endQuery, GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available) {
+            break;
+        }
+        GLuint64 begin = 0, end = 0;
+        glGetQueryObjectui64v(scope.beginQuery, GL_QUERY_RESULT, &begin);
+        glGetQueryObjectui64v(scope.endQuery, GL_QUERY_RESULT, &end);
+        PerformanceTimer::addTimerRecord(scope.name + "/gpu", scope.start, (end - begin) / NSECS_PER_USEC,
+            PerformanceTimer::GPU_TRACK);
+        _freeQueries << scope.beginQuery << scope.endQuery;
+    }
+    _pendingScopes.remove(0, resolved);
+
+    // the timestamps are in GL 3.3, and in earlier versions through the extension
+    static bool supported = false;
+    static bool checkedSupport = false;
+    if (!checkedSupport) {
+        const char* extensions = (const char*)glGetString(GL_EXTENSIONS);
+        supported = extensions && strstr(extensions, "GL_ARB_timer_query");
+        checkedSupport = true;
+    }
+    _enabled = enabled && supported;
+#endif
+}
+
+GLuint GpuTimer::getQuery() {
+    if (!_freeQueries.isEmpty()) {
+        GLuint query = _freeQueries.last();
+        _freeQueries.removeLast();
+        return query;
+    }
+    GLuint query;
+    glGenQueries(1, &query);
+    return query;
+}
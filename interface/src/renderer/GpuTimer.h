@@ -0,0 +1,57 @@
+//
+//  GpuTimer.h
+//  interface/src/renderer
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#ifndef hifi_GpuTimer_h
+#define hifi_GpuTimer_h
+
+#include <QString>
+#include <QVector>
+
+#include "InterfaceConfig.h"
+
+/// Measures the GPU time of the commands issued in its scope, as a PerformanceTimer does the CPU time, by the GL
+/// timestamps written before and after them. The timestamps are read a few frames later, once the GPU has caught up,
+/// and recorded with the performance timers under the scope's name followed by "/gpu". Scopes may be nested.
+class GpuTimer {
+public:
+
+    GpuTimer(const QString& name);
+    ~GpuTimer();
+
+    /// records the scopes whose timestamps have been written, then enables or disables the scopes of the next frame;
+    /// called once a frame
+    static void resolveQueries(bool enabled);
+
+private:
+
+    // disallow copying of GpuTimer objects
+    GpuTimer(const GpuTimer&);
+    GpuTimer& operator= (const GpuTimer&);
+
+    static GLuint getQuery();
+
+    class PendingScope {
+    public:
+        QString name;
+        quint64 start; /// the CPU time the scope began, usecs
+        GLuint beginQuery;
+        GLuint endQuery;
+    };
+
+    QString _name;
+    quint64 _start;
+    GLuint _beginQuery;
+
+    static bool _enabled;
+    static QVector<PendingScope> _pendingScopes; /// in the order they ended
+    static QVector<GLuint> _freeQueries;
+};
+
+#endif // hifi_GpuTimer_h
@@ -0,0 +1,129 @@
+//
+//  InstancedSpheres.cpp
+//  interface/src/renderer
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#include <cstddef>
+
+#include "Application.h"
+#include "InstancedSpheres.h"
+#include "ProgramObject.h"
+#include "voxels/VoxelChunkMesher.h"
+
+/// the slices and stacks of the unit sphere, as many as the glut spheres the instances replace
+const int UNIT_SPHERE_SLICES = 15;
+const int UNIT_SPHERE_STACKS = 15;
+
+ProgramObject* InstancedSpheres::_program = NULL;
+int InstancedSpheres::_positionRadiusLocation;
+int InstancedSpheres::_colorLocation;
+bool InstancedSpheres::_instancingSupported = false;
+bool InstancedSpheres::_initialized = false;
+
+InstancedSpheres::InstancedSpheres() :
+    _instanceVBO(0),
+    _instanceVBOCapacity(0) {
+}
+
+InstancedSpheres::~InstancedSpheres() {
+    if (_instanceVBO) {
+        glDeleteBuffers(1, &_instanceVBO);
+    }
+}
+
+void InstancedSpheres::add(const glm::vec3& position, float radius, const unsigned char* color) {
+    SphereInstance instance;
+    instance.positionRadius[0] = position.x;
+    instance.positionRadius[1] = position.y;
+    instance.positionRadius[2] = position.z;
+    instance.positionRadius[3] = radius;
+    instance.color[0] = color[RED_INDEX];
+    instance.color[1] = color[GREEN_INDEX];
+    instance.color[2] = color[BLUE_INDEX];
+    instance.color[3] = 255;
+    _instances.append(instance);
+}
+
+void InstancedSpheres::render(bool forget) {
+    if (_instances.isEmpty()) {
+        return;
+    }
+    if (!_initialized) {
+        init();
+    }
+
+    // the unit sphere is the one in the geometry cache's shared buffers, whose vertices are their own normals
+    GeometryCache* geometryCache = Application::getInstance()->getGeometryCache();
+    GeometryCache::Primitive sphere = geometryCache->getPrimitive(GeometryCache::SPHERE_PRIMITIVE,
+        UNIT_SPHERE_SLICES, UNIT_SPHERE_STACKS);
+    geometryCache->bindPrimitives();
+
+    if (_instancingSupported) {
+        if (!_instanceVBO) {
+            glGenBuffers(1, &_instanceVBO);
+        }
+        glBindBuffer(GL_ARRAY_BUFFER, _instanceVBO);
+        if (_instances.size() > _instanceVBOCapacity) {
+            _instanceVBOCapacity = _instances.size() * 2;
+            glBufferData(GL_ARRAY_BUFFER, _instanceVBOCapacity * sizeof(SphereInstance), NULL, GL_STREAM_DRAW);
+        }
+        glBufferSubData(GL_ARRAY_BUFFER, 0, _instances.size() * sizeof(SphereInstance), _instances.constData());
+
+        _program->bind();
+        glEnableVertexAttribArray(_positionRadiusLocation);
+        glEnableVertexAttribArray(_colorLocation);
+        glVertexAttribDivisorARB(_positionRadiusLocation, 1);
+        glVertexAttribDivisorARB(_colorLocation, 1);
+        glVertexAttribPointer(_positionRadiusLocation, 4, GL_FLOAT, GL_FALSE, sizeof(SphereInstance),
+            (void*)offsetof(SphereInstance, positionRadius));
+        glVertexAttribPointer(_colorLocation, 4, GL_UNSIGNED_BYTE, GL_FALSE, sizeof(SphereInstance),
+            (void*)offsetof(SphereInstance, color));
+
+        geometryCache->drawPrimitive(sphere, _instances.size());
+
+        // the divisors stick to the attribute slots, so put them back for the other programs that use them
+        glVertexAttribDivisorARB(_positionRadiusLocation, 0);
+        glVertexAttribDivisorARB(_colorLocation, 0);
+        glDisableVertexAttribArray(_positionRadiusLocation);
+        glDisableVertexAttribArray(_colorLocation);
+        _program->release();
+
+    } else {
+        // the normals are scaled along with the sphere
+        glEnable(GL_NORMALIZE);
+        foreach (const SphereInstance& instance, _instances) {
+            glColor4ubv(instance.color);
+            glPushMatrix();
+                glTranslatef(instance.positionRadius[0], instance.positionRadius[1], instance.positionRadius[2]);
+                glScalef(instance.positionRadius[3], instance.positionRadius[3], instance.positionRadius[3]);
+                geometryCache->drawPrimitive(sphere);
+            glPopMatrix();
+        }
+        glDisable(GL_NORMALIZE);
+    }
+
+    geometryCache->releasePrimitives();
+
+    if (forget) {
+        // keep the capacity for the next frame's spheres
+        _instances.resize(0);
+    }
+}
+
+void InstancedSpheres::init() {
+    _instancingSupported = VoxelChunkMesher::isInstancingSupported();
+    if (_instancingSupported) {
+        _program = new ProgramObject();
+        _program->addShaderFromSourceFile(QGLShader::Vertex,
+            Application::resourcesPath() + "shaders/instanced_sphere.vert");
+        _program->link();
+        _positionRadiusLocation = _program->attributeLocation("instancePositionRadius");
+        _colorLocation = _program->attributeLocation("instanceColor");
+    }
+    _initialized = true;
+}
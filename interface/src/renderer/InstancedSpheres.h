@@ -0,0 +1,67 @@
+//
+//  InstancedSpheres.h
+//  interface/src/renderer
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#ifndef hifi_InstancedSpheres_h
+#define hifi_InstancedSpheres_h
+
+#include "InterfaceConfig.h"
+
+#include <glm/glm.hpp>
+
+#include <QVector>
+
+#include <SharedUtil.h>
+
+class ProgramObject;
+
+/// A sphere drawn as an instance of the unit sphere, in 20 bytes.
+struct SphereInstance {
+    GLfloat positionRadius[4];
+    GLubyte color[4];
+};
+
+/// Collects colored spheres as they're visited and draws them all at once, in a single instanced draw of a shared unit
+/// sphere when the GL has instanced arrays, or else as a draw of the shared sphere apiece, which still spares the
+/// sphere being tessellated for each of them.
+class InstancedSpheres {
+public:
+    InstancedSpheres();
+    ~InstancedSpheres();
+
+    /// adds a sphere to draw at the next render(), with its position and radius in meters
+    void add(const glm::vec3& position, float radius, const unsigned char* color);
+
+    int getCount() const { return _instances.size(); }
+
+    /// draws the spheres added since they were last forgotten, then forgets them unless they're to be drawn again
+    void render(bool forget = true);
+
+    /// forgets the spheres added without drawing them
+    void clear() { _instances.resize(0); }
+
+private:
+    // disallow copying of InstancedSpheres objects
+    InstancedSpheres(const InstancedSpheres&);
+    InstancedSpheres& operator= (const InstancedSpheres&);
+
+    static void init();
+
+    QVector<SphereInstance> _instances;
+    GLuint _instanceVBO;
+    int _instanceVBOCapacity; /// instances
+
+    static ProgramObject* _program;
+    static int _positionRadiusLocation;
+    static int _colorLocation;
+    static bool _instancingSupported;
+    static bool _initialized;
+};
+
+#endif // hifi_InstancedSpheres_h
@@ -42,13 +42,20 @@ Model::Model(QObject* parent) :
     _showTrueJointTransforms(false),
     _rootIndex(-1),
     _lodDistance(0.0f),
+    _fadeInStarted(0),
     _pupilDilation(0.0f),
-    _url("http://invalid.com") {
+    _blendInFlight(false),
+    _url("http://invalid.com"),
+    _animationsStarted(false),
+    _evaluatingPose(false) {
     // we may have been created in the network thread, but we live in the main thread
     moveToThread(Application::getInstance()->thread());
 }
 
 Model::~Model() {
+    if (_evaluatingPose) {
+        _poseEvaluated.acquire();
+    }
     deleteGeometry();
 }
 
@@ -474,6 +481,7 @@ bool Model::updateGeometry() {
         }
     }
 
+    bool hadMeshes = !_meshStates.isEmpty();
     bool needToRebuild = false;
     if (_nextGeometry) {
         _nextGeometry = _nextGeometry->getLODOrFallback(_lodDistance, _nextLODHysteresis);
@@ -527,14 +535,31 @@ bool Model::updateGeometry() {
     _geometry->ensureLoading();
    
     if (needToRebuild) {
+        if (!hadMeshes) {
+            // fade in whatever shows up first, rather than popping in
+            _fadeInStarted = usecTimestampNow();
+        }
         const FBXGeometry& fbxGeometry = geometry->getFBXGeometry();
         foreach (const FBXMesh& mesh, fbxGeometry.meshes) {
             MeshState state;
             state.clusterMatrices.resize(mesh.clusters.size());
-            _meshStates.append(state);    
+            state.firstBlendedVertex = 0;
+            state.blendedVertexCount = 0;
             
             QOpenGLBuffer buffer;
             if (!mesh.blendshapes.isEmpty()) {
+                int firstIndex = mesh.vertices.size();
+                int lastIndex = -1;
+                foreach (const FBXBlendshape& blendshape, mesh.blendshapes) {
+                    foreach (int index, blendshape.indices) {
+                        firstIndex = qMin(firstIndex, index);
+                        lastIndex = qMax(lastIndex, index);
+                    }
+                }
+                if (lastIndex >= firstIndex) {
+                    state.firstBlendedVertex = firstIndex;
+                    state.blendedVertexCount = lastIndex - firstIndex + 1;
+                }
                 buffer.setUsagePattern(QOpenGLBuffer::DynamicDraw);
                 buffer.create();
                 buffer.bind();
@@ -545,6 +570,7 @@ bool Model::updateGeometry() {
                 buffer.release();
             }
             _blendedVertexBuffers.append(buffer);
+            _meshStates.append(state);
         }
         foreach (const FBXAttachment& attachment, fbxGeometry.attachments) {
             Model* model = new Model(this);
@@ -585,6 +611,12 @@ bool Model::render(float alpha, RenderMode mode, bool receiveShadows) {
         return false;
     }
     
+    const quint64 FADE_IN_USECS = USECS_PER_SECOND / 2;
+    quint64 sinceFadeInStarted = usecTimestampNow() - _fadeInStarted;
+    if (sinceFadeInStarted < FADE_IN_USECS) {
+        alpha *= (float)sinceFadeInStarted / FADE_IN_USECS;
+    }
+    
     // set up dilated textures on first render after load/simulate
     const FBXGeometry& geometry = _geometry->getFBXGeometry();
     if (_dilatedTextures.isEmpty()) {
@@ -814,11 +846,14 @@ void Model::updateShapePositions() {
     // TODO: implement this when we know how to build shapes for regular Models
 }
 
+/// Blends the vertices of a model's meshes on a thread of the global pool.  It reads the meshes through the geometry
+/// rather than holding copies of them, and writes into vectors that it takes from the model and hands back with the
+/// results, so that a model blending every frame doesn't allocate every frame.
 class Blender : public QRunnable {
 public:
 
-    Blender(Model* model, const QWeakPointer<NetworkGeometry>& geometry,
-        const QVector<FBXMesh>& meshes, const QVector<float>& blendshapeCoefficients);
+    Blender(Model* model, const QWeakPointer<NetworkGeometry>& geometry, const QVector<float>& blendshapeCoefficients,
+        QVector<glm::vec3>& vertices, QVector<glm::vec3>& normals);
     
     virtual void run();
 
@@ -826,33 +861,46 @@ private:
     
     QPointer<Model> _model;
     QWeakPointer<NetworkGeometry> _geometry;
-    QVector<FBXMesh> _meshes;
     QVector<float> _blendshapeCoefficients;
+    QVector<glm::vec3> _vertices;
+    QVector<glm::vec3> _normals;
 };
 
-Blender::Blender(Model* model, const QWeakPointer<NetworkGeometry>& geometry,
-        const QVector<FBXMesh>& meshes, const QVector<float>& blendshapeCoefficients) :
+Blender::Blender(Model* model, const QWeakPointer<NetworkGeometry>& geometry, const QVector<float>& blendshapeCoefficients,
+        QVector<glm::vec3>& vertices, QVector<glm::vec3>& normals) :
     _model(model),
     _geometry(geometry),
-    _meshes(meshes),
     _blendshapeCoefficients(blendshapeCoefficients) {
+    
+    // take the vectors, rather than sharing them, so that writing to them doesn't detach
+    _vertices.swap(vertices);
+    _normals.swap(normals);
 }
 
 void Blender::run() {
     // make sure the model/geometry still exists
-    if (_model.isNull() || _geometry.isNull()) {
+    QSharedPointer<NetworkGeometry> geometry = _geometry.toStrongRef();
+    if (_model.isNull() || geometry.isNull()) {
         return;
     }
-    QVector<glm::vec3> vertices, normals;
+    const QVector<FBXMesh>& meshes = geometry->getFBXGeometry().meshes;
+    int vertexCount = 0;
+    foreach (const FBXMesh& mesh, meshes) {
+        if (!mesh.blendshapes.isEmpty()) {
+            vertexCount += mesh.vertices.size();
+        }
+    }
+    _vertices.resize(vertexCount);
+    _normals.resize(vertexCount);
     int offset = 0;
-    foreach (const FBXMesh& mesh, _meshes) {
+    foreach (const FBXMesh& mesh, meshes) {
         if (mesh.blendshapes.isEmpty()) {
             continue;
         }
-        vertices += mesh.vertices;
-        normals += mesh.normals;
-        glm::vec3* meshVertices = vertices.data() + offset;
-        glm::vec3* meshNormals = normals.data() + offset;
+        glm::vec3* meshVertices = _vertices.data() + offset;
+        glm::vec3* meshNormals = _normals.data() + offset;
+        qCopy(mesh.vertices.constBegin(), mesh.vertices.constEnd(), meshVertices);
+        qCopy(mesh.normals.constBegin(), mesh.normals.constEnd(), meshNormals);
         offset += mesh.vertices.size();
         const float NORMAL_COEFFICIENT_SCALE = 0.01f;
         for (int i = 0, n = qMin(_blendshapeCoefficients.size(), mesh.blendshapes.size()); i < n; i++) {
@@ -873,7 +921,7 @@ void Blender::run() {
     // post the result to the geometry cache, which will dispatch to the model if still alive
     QMetaObject::invokeMethod(Application::getInstance()->getGeometryCache(), "setBlendedVertices",
         Q_ARG(const QPointer<Model>&, _model), Q_ARG(const QWeakPointer<NetworkGeometry>&, _geometry),
-        Q_ARG(const QVector<glm::vec3>&, vertices), Q_ARG(const QVector<glm::vec3>&, normals));
+        Q_ARG(const QVector<glm::vec3>&, _vertices), Q_ARG(const QVector<glm::vec3>&, _normals));
 }
 
 void Model::setScaleToFit(bool scaleToFit, float largestDimension) {
@@ -912,27 +960,124 @@ void Model::snapToCenter() {
 }
 
 void Model::simulate(float deltaTime, bool fullUpdate) {
+    if (beginSimulate(fullUpdate)) {
+        simulateInternal(deltaTime);
+    }
+}
+
+bool Model::beginSimulate(bool fullUpdate) {
     fullUpdate = updateGeometry() || fullUpdate || (_scaleToFit && !_scaledToFit) || (_snapModelToCenter && !_snappedToCenter);
-    if (isActive() && fullUpdate) {
-        // check for scale to fit
-        if (_scaleToFit && !_scaledToFit) {
-            scaleToFit();
+    if (!(isActive() && fullUpdate)) {
+        return false;
+    }
+    // check for scale to fit
+    if (_scaleToFit && !_scaledToFit) {
+        scaleToFit();
+    }
+    if (_snapModelToCenter && !_snappedToCenter) {
+        snapToCenter();
+    }
+    return true;
+}
+
+/// Blends a model's animation pose on a thread of the pool.
+class PoseEvaluator : public QRunnable {
+public:
+    PoseEvaluator(Model* model) : _model(model) { }
+    
+    virtual void run() {
+        _model->evaluatePose();
+        _model->_poseEvaluated.release();
+    }
+    
+private:
+    Model* _model;
+};
+
+void Model::startAnimations(float deltaTime) {
+    if (_animationsStarted) {
+        // the last pose was never applied; apply it now, so that the animations that ended still get stopped
+        finishAnimations();
+    }
+    if (!isActive()) {
+        return;
+    }
+    advanceAnimations(deltaTime);
+    _animationsStarted = true;
+    if (!_animationSamples.isEmpty()) {
+        _evaluatingPose = true;
+        QThreadPool::globalInstance()->start(new PoseEvaluator(this));
+    }
+}
+
+/// the priority of the joints to which no animation applies
+const float NO_POSE_PRIORITY = -FLT_MAX;
+
+void Model::advanceAnimations(float deltaTime) {
+    foreach (const AnimationHandlePointer& handle, _runningAnimations) {
+        handle->simulate(deltaTime);
+    }
+    if (!_animationSamples.isEmpty()) {
+        _poseRotations.resize(_jointStates.size());
+        _posePriorities.fill(NO_POSE_PRIORITY, _jointStates.size());
+    }
+}
+
+void Model::evaluatePose() {
+    // the samples are in decreasing priority, so each joint goes to the last of those with the highest priority that
+    // map it, just as if they were applied to the joint states one after another
+    foreach (const AnimationSample& sample, _animationSamples) {
+        int frameCount = sample.animation->getFrameCount();
+        int floorFrame = (int)glm::floor(sample.frameIndex) % frameCount;
+        int ceilFrame = (int)glm::ceil(sample.frameIndex) % frameCount;
+        float frameFraction = glm::fract(sample.frameIndex);
+        for (int i = 0; i < sample.jointMappings.size(); i++) {
+            int mapping = sample.jointMappings.at(i);
+            if (mapping != -1 && mapping < _posePriorities.size() && sample.priority >= _posePriorities.at(mapping)) {
+                _poseRotations[mapping] = safeMix(sample.animation->getRotation(i, floorFrame),
+                    sample.animation->getRotation(i, ceilFrame), frameFraction);
+                _posePriorities[mapping] = sample.priority;
+            }
         }
-        if (_snapModelToCenter && !_snappedToCenter) {
-            snapToCenter();
+    }
+}
+
+void Model::finishAnimations() {
+    if (_evaluatingPose) {
+        _poseEvaluated.acquire();
+        _evaluatingPose = false;
+    }
+    _animationsStarted = false;
+    
+    // the joint states may have been replaced by new geometry since the animations were advanced
+    if (!_animationSamples.isEmpty() && _posePriorities.size() == _jointStates.size()) {
+        for (int i = 0; i < _jointStates.size(); i++) {
+            float priority = _posePriorities.at(i);
+            JointState& state = _jointStates[i];
+            if (priority != NO_POSE_PRIORITY && priority >= state._animationPriority) {
+                state.setRotationInParentFrame(_poseRotations.at(i));
+                state._animationPriority = priority;
+            }
         }
-        simulateInternal(deltaTime);
     }
+    _animationSamples.clear();
+    
+    foreach (const AnimationHandlePointer& handle, _endedAnimations) {
+        handle->stop();
+    }
+    _endedAnimations.clear();
 }
 
 void Model::simulateInternal(float deltaTime) {
     // NOTE: this is a recursive call that walks all attachments, and their attachments
     // update the world space transforms for all joints
 
-    // update animations
-    foreach (const AnimationHandlePointer& handle, _runningAnimations) {
-        handle->simulate(deltaTime);
+    // update animations, unless startAnimations has already set them going
+    if (!_animationsStarted) {
+        advanceAnimations(deltaTime);
+        evaluatePose();
     }
+    finishAnimations();
 
     for (int i = 0; i < _jointStates.size(); i++) {
         updateJointState(i);
@@ -983,9 +1128,13 @@ void Model::simulateInternal(float deltaTime) {
         }
     }
     
-    // post the blender
-    if (geometry.hasBlendedMeshes()) {
-        QThreadPool::globalInstance()->start(new Blender(this, _geometry, geometry.meshes, _blendshapeCoefficients));
+    // post the blender if the coefficients have changed since the last one and it's done; if it isn't, we'll post
+    // the latest coefficients after it is
+    if (geometry.hasBlendedMeshes() && !_blendInFlight && _blendshapeCoefficients != _blendedBlendshapeCoefficients) {
+        _blendedBlendshapeCoefficients = _blendshapeCoefficients;
+        _blendInFlight = true;
+        QThreadPool::globalInstance()->start(new Blender(this, _geometry, _blendshapeCoefficients,
+            _blendedVertices, _blendedNormals));
     }
 }
 
@@ -1247,56 +1396,63 @@ const int BALL_SUBDIVISIONS = 10;
 void Model::renderJointCollisionShapes(float alpha) {
     glPushMatrix();
     Application::getInstance()->loadTranslatedViewMatrix(_translation);
+    
+    // the spheres are gathered up and drawn together from the geometry cache
+    QVector<glm::mat4> sphereTransforms;
+    QVector<glm::vec4> sphereColors;
     for (int i = 0; i < _shapes.size(); i++) {
         Shape* shape = _shapes[i];
         if (!shape) {
             continue;
         }
 
-        glPushMatrix();
         // NOTE: the shapes are in the avatar local-frame
         if (shape->getType() == Shape::SPHERE_SHAPE) {
             // shapes are stored in world-frame, so we have to transform into model frame
             glm::vec3 position = _rotation * shape->getTranslation();
-            glTranslatef(position.x, position.y, position.z);
-            const glm::quat& rotation = shape->getRotation();
-            glm::vec3 axis = glm::axis(rotation);
-            glRotatef(glm::degrees(glm::angle(rotation)), axis.x, axis.y, axis.z);
 
             // draw a grey sphere at shape position
-            glColor4f(0.75f, 0.75f, 0.75f, alpha);
-            glutSolidSphere(shape->getBoundingRadius(), BALL_SUBDIVISIONS, BALL_SUBDIVISIONS);
+            sphereTransforms.append(glm::translate(position) * glm::mat4_cast(shape->getRotation()) *
+                glm::scale(glm::vec3(shape->getBoundingRadius())));
+            sphereColors.append(glm::vec4(0.75f, 0.75f, 0.75f, alpha));
+            
         } else if (shape->getType() == Shape::CAPSULE_SHAPE) {
             CapsuleShape* capsule = static_cast<CapsuleShape*>(shape);
+            glm::mat4 scale = glm::scale(glm::vec3(capsule->getRadius()));
 
             // draw a blue sphere at the capsule endpoint
             glm::vec3 endPoint;
             capsule->getEndPoint(endPoint);
             endPoint = _rotation * endPoint;
-            glTranslatef(endPoint.x, endPoint.y, endPoint.z);
-            glColor4f(0.6f, 0.6f, 0.8f, alpha);
-            glutSolidSphere(capsule->getRadius(), BALL_SUBDIVISIONS, BALL_SUBDIVISIONS);
+            sphereTransforms.append(glm::translate(endPoint) * scale);
+            sphereColors.append(glm::vec4(0.6f, 0.6f, 0.8f, alpha));
 
             // draw a yellow sphere at the capsule startpoint
             glm::vec3 startPoint;
             capsule->getStartPoint(startPoint);
             startPoint = _rotation * startPoint;
-            glm::vec3 axis = endPoint - startPoint;
-            glTranslatef(-axis.x, -axis.y, -axis.z);
-            glColor4f(0.8f, 0.8f, 0.6f, alpha);
-            glutSolidSphere(capsule->getRadius(), BALL_SUBDIVISIONS, BALL_SUBDIVISIONS);
+            sphereTransforms.append(glm::translate(startPoint) * scale);
+            sphereColors.append(glm::vec4(0.8f, 0.8f, 0.6f, alpha));
             
             // draw a green cylinder between the two points
+            glPushMatrix();
+            glTranslatef(startPoint.x, startPoint.y, startPoint.z);
             glm::vec3 origin(0.0f);
             glColor4f(0.6f, 0.8f, 0.6f, alpha);
-            Avatar::renderJointConnectingCone( origin, axis, capsule->getRadius(), capsule->getRadius());
+            Avatar::renderJointConnectingCone(origin, endPoint - startPoint,
+                capsule->getRadius(), capsule->getRadius());
+            glPopMatrix();
         }
-        glPopMatrix();
     }
+    Application::getInstance()->getGeometryCache()->renderInstances(GeometryCache::SPHERE_PRIMITIVE,
+        BALL_SUBDIVISIONS, BALL_SUBDIVISIONS, sphereTransforms, sphereColors);
     glPopMatrix();
 }
 
 void Model::setBlendedVertices(const QVector<glm::vec3>& vertices, const QVector<glm::vec3>& normals) {
+    _blendInFlight = false;
+    _blendedVertices = vertices;
+    _blendedNormals = normals;
     if (_blendedVertexBuffers.isEmpty()) {
         return;
     }
@@ -1307,12 +1463,17 @@ void Model::setBlendedVertices(const QVector<glm::vec3>& vertices, const QVector
         if (mesh.blendshapes.isEmpty()) {
             continue;
         }
-        QOpenGLBuffer& buffer = _blendedVertexBuffers[i];
-        buffer.bind();
-        buffer.write(0, vertices.constData() + index, mesh.vertices.size() * sizeof(glm::vec3));
-        buffer.write(mesh.vertices.size() * sizeof(glm::vec3), normals.constData() + index,
-            mesh.normals.size() * sizeof(glm::vec3));
-        buffer.release();
+        // the vertices no blendshape moves are the same as they were when the buffer was allocated
+        const MeshState& state = _meshStates.at(i);
+        if (state.blendedVertexCount > 0) {
+            QOpenGLBuffer& buffer = _blendedVertexBuffers[i];
+            buffer.bind();
+            buffer.write(state.firstBlendedVertex * sizeof(glm::vec3), vertices.constData() + index +
+                state.firstBlendedVertex, state.blendedVertexCount * sizeof(glm::vec3));
+            buffer.write((mesh.vertices.size() + state.firstBlendedVertex) * sizeof(glm::vec3), normals.constData() +
+                index + state.firstBlendedVertex, state.blendedVertexCount * sizeof(glm::vec3));
+            buffer.release();
+        }
         index += mesh.vertices.size();
     }
 }
@@ -1336,6 +1497,8 @@ void Model::deleteGeometry() {
     }
     _attachments.clear();
     _blendedVertexBuffers.clear();
+    _blendedBlendshapeCoefficients.clear();
+    _blendInFlight = false;
     _jointStates.clear();
     _meshStates.clear();
     clearShapes();
@@ -1360,6 +1523,12 @@ void Model::renderMeshes(float alpha, RenderMode mode, bool translucent, bool re
     const QVector<NetworkMesh>& networkMeshes = _geometry->getMeshes();
     
     bool cascadedShadows = Menu::getInstance()->isOptionChecked(MenuOption::CascadedShadows);
+    
+    // consecutive meshes often use the same program, and the parts of a mesh the same material and textures, so we
+    // remember what's bound and only change what differs
+    ProgramObject* boundProgram = NULL;
+    GLuint whiteTextureID = Application::getInstance()->getTextureCache()->getWhiteTextureID();
+    GLuint blueTextureID = Application::getInstance()->getTextureCache()->getBlueTextureID();
     for (int i = 0; i < networkMeshes.size(); i++) {
         // exit early if the translucency doesn't match what we're drawing
         const NetworkMesh& networkMesh = networkMeshes.at(i);
@@ -1472,7 +1641,10 @@ void Model::renderMeshes(float alpha, RenderMode mode, bool translucent, bool re
         Application::getInstance()->loadTranslatedViewMatrix(_translation);
         
         if (state.clusterMatrices.size() > 1) {
-            skinProgram->bind();
+            if (boundProgram != skinProgram) {
+                skinProgram->bind();
+                boundProgram = skinProgram;
+            }
             glUniformMatrix4fvARB(skinLocations->clusterMatrices, state.clusterMatrices.size(), false,
                 (const float*)state.clusterMatrices.constData());
             int offset = (mesh.tangents.size() + mesh.colors.size()) * sizeof(glm::vec3) +
@@ -1490,7 +1662,10 @@ void Model::renderMeshes(float alpha, RenderMode mode, bool translucent, bool re
             }
         } else {    
             glMultMatrixf((const GLfloat*)&state.clusterMatrices[0]);
-            program->bind();
+            if (boundProgram != program) {
+                program->bind();
+                boundProgram = program;
+            }
             if (cascadedShadows) {
                 program->setUniform(shadowDistancesLocation, Application::getInstance()->getShadowDistances());
             }
@@ -1527,6 +1702,20 @@ void Model::renderMeshes(float alpha, RenderMode mode, bool translucent, bool re
             glEnableClientState(GL_TEXTURE_COORD_ARRAY);
         }
         
+        // the shadow map is the same for every part
+        if (shadowTextureUnit && mode != SHADOW_RENDER_MODE) {
+            glActiveTexture(shadowTextureUnit);
+            glBindTexture(GL_TEXTURE_2D, Application::getInstance()->getTextureCache()->getShadowDepthTextureID());
+            glActiveTexture(GL_TEXTURE0);
+        }
+        GLuint boundDiffuseID = 0;
+        GLuint boundNormalID = 0;
+        GLuint boundSpecularID = 0;
+        const FBXMeshPart* materialPart = NULL;
+        if (mode == SHADOW_RENDER_MODE) {
+            glBindTexture(GL_TEXTURE_2D, 0);
+        }
+        
         qint64 offset = 0;
         for (int j = 0; j < networkMesh.parts.size(); j++) {
             const NetworkMeshPart& networkPart = networkMesh.parts.at(j);
@@ -1536,46 +1725,49 @@ void Model::renderMeshes(float alpha, RenderMode mode, bool translucent, bool re
                 continue;
             }
             // apply material properties
-            if (mode == SHADOW_RENDER_MODE) {
-                glBindTexture(GL_TEXTURE_2D, 0);
-                
-            } else {
-                glm::vec4 diffuse = glm::vec4(part.diffuseColor, alpha);
-                glm::vec4 specular = glm::vec4(part.specularColor, alpha);
-                glMaterialfv(GL_FRONT, GL_AMBIENT, (const float*)&diffuse);
-                glMaterialfv(GL_FRONT, GL_DIFFUSE, (const float*)&diffuse);
-                glMaterialfv(GL_FRONT, GL_SPECULAR, (const float*)&specular);
-                glMaterialf(GL_FRONT, GL_SHININESS, part.shininess);
+            if (mode != SHADOW_RENDER_MODE) {
+                if (!(materialPart && materialPart->diffuseColor == part.diffuseColor &&
+                        materialPart->specularColor == part.specularColor && materialPart->shininess == part.shininess)) {
+                    glm::vec4 diffuse = glm::vec4(part.diffuseColor, alpha);
+                    glm::vec4 specular = glm::vec4(part.specularColor, alpha);
+                    glMaterialfv(GL_FRONT, GL_AMBIENT, (const float*)&diffuse);
+                    glMaterialfv(GL_FRONT, GL_DIFFUSE, (const float*)&diffuse);
+                    glMaterialfv(GL_FRONT, GL_SPECULAR, (const float*)&specular);
+                    glMaterialf(GL_FRONT, GL_SHININESS, part.shininess);
+                    materialPart = &part;
+                }
             
                 Texture* diffuseMap = networkPart.diffuseTexture.data();
                 if (mesh.isEye && diffuseMap) {
                     diffuseMap = (_dilatedTextures[i][j] =
                         static_cast<DilatableNetworkTexture*>(diffuseMap)->getDilatedTexture(_pupilDilation)).data();
                 }
-                glBindTexture(GL_TEXTURE_2D, !diffuseMap ?
-                    Application::getInstance()->getTextureCache()->getWhiteTextureID() : diffuseMap->getID());
-                
+                GLuint diffuseID = !diffuseMap ? whiteTextureID : diffuseMap->getID();
+                if (diffuseID != boundDiffuseID) {
+                    glBindTexture(GL_TEXTURE_2D, diffuseID);
+                    boundDiffuseID = diffuseID;
+                }
                 
-                if (!mesh.tangents.isEmpty()) {                 
-                    glActiveTexture(GL_TEXTURE1);                
+                if (!mesh.tangents.isEmpty()) {
                     Texture* normalMap = networkPart.normalTexture.data();
-                    glBindTexture(GL_TEXTURE_2D, !normalMap ?
-                        Application::getInstance()->getTextureCache()->getBlueTextureID() : normalMap->getID());
-                    glActiveTexture(GL_TEXTURE0);
+                    GLuint normalID = !normalMap ? blueTextureID : normalMap->getID();
+                    if (normalID != boundNormalID) {
+                        glActiveTexture(GL_TEXTURE1);
+                        glBindTexture(GL_TEXTURE_2D, normalID);
+                        glActiveTexture(GL_TEXTURE0);
+                        boundNormalID = normalID;
+                    }
                 }
                 
                 if (specularTextureUnit) {
-                    glActiveTexture(specularTextureUnit);
                     Texture* specularMap = networkPart.specularTexture.data();
-                    glBindTexture(GL_TEXTURE_2D, !specularMap ?
-                        Application::getInstance()->getTextureCache()->getWhiteTextureID() : specularMap->getID());
-                    glActiveTexture(GL_TEXTURE0);
-                }
-                
-                if (shadowTextureUnit) {
-                    glActiveTexture(shadowTextureUnit);
-                    glBindTexture(GL_TEXTURE_2D, Application::getInstance()->getTextureCache()->getShadowDepthTextureID());
-                    glActiveTexture(GL_TEXTURE0);
+                    GLuint specularID = !specularMap ? whiteTextureID : specularMap->getID();
+                    if (specularID != boundSpecularID) {
+                        glActiveTexture(specularTextureUnit);
+                        glBindTexture(GL_TEXTURE_2D, specularID);
+                        glActiveTexture(GL_TEXTURE0);
+                        boundSpecularID = specularID;
+                    }
                 }
             }
             glDrawRangeElementsEXT(GL_QUADS, 0, vertexCount - 1, part.quadIndices.size(), GL_UNSIGNED_INT, (void*)offset);
@@ -1617,8 +1809,9 @@ void Model::renderMeshes(float alpha, RenderMode mode, bool translucent, bool re
             skinProgram->disableAttributeArray(skinLocations->clusterWeights);  
         } 
         glPopMatrix();
-
-        activeProgram->release();
+    }
+    if (boundProgram) {
+        boundProgram->release();
     }
 }
 
@@ -1730,18 +1923,18 @@ void AnimationHandle::simulate(float deltaTime) {
         }
     }
     
-    const FBXGeometry& animationGeometry = _animation->getGeometry();
-    if (animationGeometry.animationFrames.isEmpty()) {
+    int frameCount = _animation->getFrameCount();
+    if (frameCount == 0) {
         stop();
         return;
     }
-    float endFrameIndex = qMin(_lastFrame, animationGeometry.animationFrames.size() - (_loop ? 0.0f : 1.0f));
+    float endFrameIndex = qMin(_lastFrame, frameCount - (_loop ? 0.0f : 1.0f));
     float startFrameIndex = qMin(_firstFrame, endFrameIndex);
     if ((!_loop && (_frameIndex < startFrameIndex || _frameIndex > endFrameIndex)) || startFrameIndex == endFrameIndex) {
         // passed the end; apply the last frame
-        applyFrame(glm::clamp(_frameIndex, startFrameIndex, endFrameIndex));
+        sampleFrame(glm::clamp(_frameIndex, startFrameIndex, endFrameIndex));
         if (!_hold) {
-            stop();
+            _model->_endedAnimations.append(_self.toStrongRef());
         }
         return;
     }
@@ -1754,25 +1947,12 @@ void AnimationHandle::simulate(float deltaTime) {
     }
     
     // blend between the closest two frames
-    applyFrame(_frameIndex);
+    sampleFrame(_frameIndex);
 }
 
-void AnimationHandle::applyFrame(float frameIndex) {
-    const FBXGeometry& animationGeometry = _animation->getGeometry();
-    int frameCount = animationGeometry.animationFrames.size();
-    const FBXAnimationFrame& floorFrame = animationGeometry.animationFrames.at((int)glm::floor(frameIndex) % frameCount);
-    const FBXAnimationFrame& ceilFrame = animationGeometry.animationFrames.at((int)glm::ceil(frameIndex) % frameCount);
-    float frameFraction = glm::fract(frameIndex);
-    for (int i = 0; i < _jointMappings.size(); i++) {
-        int mapping = _jointMappings.at(i);
-        if (mapping != -1) {
-            JointState& state = _model->_jointStates[mapping];
-            if (_priority >= state._animationPriority) {
-                state.setRotationInParentFrame(safeMix(floorFrame.rotations.at(i), ceilFrame.rotations.at(i), frameFraction));
-                state._animationPriority = _priority;
-            }
-        }
-    }
+void AnimationHandle::sampleFrame(float frameIndex) {
+    Model::AnimationSample sample = { _animation, _jointMappings, frameIndex, _priority };
+    _model->_animationSamples.append(sample);
 }
 
 void AnimationHandle::replaceMatchingPriorities(float newPriority) {
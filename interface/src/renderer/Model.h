@@ -14,6 +14,7 @@
 
 #include <QBitArray>
 #include <QObject>
+#include <QSemaphore>
 #include <QUrl>
 
 #include <PhysicsEntity.h>
@@ -71,6 +72,19 @@ public:
     void init();
     void reset();
     virtual void simulate(float deltaTime, bool fullUpdate = true);
+
+    /// Does the part of simulate that has to happen on the main thread: loading geometry and making its buffers, and
+    /// fitting the model to its scale and center.
+    /// \return whether the joints need to be simulated with simulateJoints
+    bool beginSimulate(bool fullUpdate);
+
+    /// Advances the running animations and starts blending their pose on the thread pool, so that it can be done while
+    /// the caller does other work before simulate, which applies it.  Must be called from the main thread.
+    void startAnimations(float deltaTime);
+
+    /// Does the rest of simulate, which only touches the model's own joint and mesh states, so that different models'
+    /// joints can be simulated at once on different threads.
+    void simulateJoints(float deltaTime) { simulateInternal(deltaTime); }
     
     enum RenderMode { DEFAULT_RENDER_MODE, SHADOW_RENDER_MODE, DIFFUSE_RENDER_MODE, NORMAL_RENDER_MODE };
     
@@ -140,7 +154,7 @@ public:
 
     void renderJointCollisionShapes(float alpha);
     
-    /// Sets blended vertices computed in a separate thread.
+    /// Sets blended vertices computed in a separate thread.  The vectors are kept for the next blend to write into.
     void setBlendedVertices(const QVector<glm::vec3>& vertices, const QVector<glm::vec3>& normals);
 
 protected:
@@ -163,6 +177,8 @@ protected:
     class MeshState {
     public:
         QVector<glm::mat4> clusterMatrices;
+        int firstBlendedVertex; ///< the span of the vertices the blendshapes move, which is all that needs uploading
+        int blendedVertexCount;
     };
     
     QVector<MeshState> _meshStates;
@@ -210,6 +226,16 @@ protected:
 private:
     
     friend class AnimationHandle;
+    friend class PoseEvaluator;
+    
+    /// advances the running animations, collecting the frames they want to apply
+    void advanceAnimations(float deltaTime);
+    
+    /// blends the collected frames into the pose; touches nothing else, so it can run on another thread
+    void evaluatePose();
+    
+    /// waits for the pose if it's being evaluated, applies it to the joint states, and stops the animations that ended
+    void finishAnimations();
     
     void applyNextGeometry();
     void deleteGeometry();
@@ -222,9 +248,14 @@ private:
     float _lodDistance;
     float _lodHysteresis;
     float _nextLODHysteresis;
+    quint64 _fadeInStarted; ///< when the model first had geometry to show, which it fades in from
     
     float _pupilDilation;
     QVector<float> _blendshapeCoefficients;
+    QVector<float> _blendedBlendshapeCoefficients; ///< those of the last blend posted, so we only blend on changes
+    bool _blendInFlight; ///< whether a blender is running, in which case we wait for it before posting another
+    QVector<glm::vec3> _blendedVertices; ///< the last blend's results, which the next blender reuses
+    QVector<glm::vec3> _blendedNormals;
     
     QUrl _url;
         
@@ -238,6 +269,23 @@ private:
 
     QList<AnimationHandlePointer> _runningAnimations;
 
+    /// A frame of a running animation to blend into the pose, copied so that the handle may change while it's blended.
+    class AnimationSample {
+    public:
+        AnimationPointer animation;
+        QVector<int> jointMappings;
+        float frameIndex;
+        float priority;
+    };
+    
+    QVector<AnimationSample> _animationSamples; ///< in order of decreasing priority, like the running animations
+    QList<AnimationHandlePointer> _endedAnimations; ///< to be stopped once their last frames have been applied
+    QVector<glm::quat> _poseRotations; ///< by joint index, where the pose's priority isn't NO_POSE_PRIORITY
+    QVector<float> _posePriorities; ///< the priority of the animation that set each joint's rotation
+    bool _animationsStarted; ///< whether startAnimations has been called since the pose was last applied
+    bool _evaluatingPose; ///< whether an evaluator is running, in which case we wait on the semaphore for it
+    QSemaphore _poseEvaluated;
+
     static ProgramObject _program;
     static ProgramObject _normalMapProgram;
     static ProgramObject _specularMapProgram;
@@ -375,7 +423,7 @@ private:
     AnimationHandle(Model* model);
         
     void simulate(float deltaTime);
-    void applyFrame(float frameIndex);
+    void sampleFrame(float frameIndex);
     void replaceMatchingPriorities(float newPriority);
     
     Model* _model;
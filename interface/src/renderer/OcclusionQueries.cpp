@@ -0,0 +1,110 @@
+//
+//  OcclusionQueries.cpp
+//  interface/src/renderer
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#include "OcclusionQueries.h"
+
+// the frames an object may go untested before its state and query are let go
+const int MAX_UNTESTED_FRAMES = 2;
+
+OcclusionQueries::OcclusionQueries() :
+    _enabled(false),
+    _frame(0) {
+}
+
+OcclusionQueries::~OcclusionQueries() {
+    clear();
+}
+
+void OcclusionQueries::beginFrame(bool enabled) {
+    _frame++;
+    if (!enabled) {
+        clear();
+        _enabled = false;
+        return;
+    }
+    _enabled = true;
+    QHash<quint64, ObjectState>::iterator object = _objects.begin();
+    while (object != _objects.end()) {
+        ObjectState& state = object.value();
+        if (_frame - state.testedFrame > MAX_UNTESTED_FRAMES) {
+            glDeleteQueries(1, &state.query);
+            object = _objects.erase(object);
+            continue;
+        }
+        if (state.pending) {
+            GLint available = 0;
+            glGetQueryObjectiv(state.query, GL_QUERY_RESULT_AVAILABLE, &available);
+            if (available) {
+                GLuint samples = 0;
+                glGetQueryObjectuiv(state.query, GL_QUERY_RESULT, &samples);
+                state.occludedFrames = (samples == 0) ? state.occludedFrames + 1 : 0;
+                state.pending = false;
+            }
+        }
+        object++;
+    }
+}
+
+int OcclusionQueries::getOccludedFrames(quint64 key) const {
+    if (!_enabled) {
+        return 0;
+    }
+    QHash<quint64, ObjectState>::const_iterator object = _objects.constFind(key);
+    return (object == _objects.constEnd()) ? 0 : object.value().occludedFrames;
+}
+
+void OcclusionQueries::test(const QVector<OcclusionBox>& boxes, const glm::vec3& eyePosition, float margin) {
+    if (!_enabled || boxes.isEmpty()) {
+        return;
+    }
+    // the boxes are tested against the depth buffer without touching it or the color buffer
+    glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+    glDepthMask(GL_FALSE);
+
+    foreach (const OcclusionBox& box, boxes) {
+        ObjectState& state = _objects[box.key];
+        if (state.query == 0) {
+            glGenQueries(1, &state.query);
+        
+        } else if (state.testedFrame == _frame) {
+            continue;
+        }
+        state.testedFrame = _frame;
+        if (glm::all(glm::greaterThan(eyePosition, box.minimum - margin)) &&
+                glm::all(glm::lessThan(eyePosition, box.maximum + margin))) {
+            state.occludedFrames = 0;
+            continue;
+        }
+        if (state.pending) {
+            // the last result hasn't arrived; it will be read before this object is tested again
+            continue;
+        }
+        glBeginQuery(GL_SAMPLES_PASSED, state.query);
+        glm::vec3 center = (box.minimum + box.maximum) * 0.5f;
+        glm::vec3 dimensions = box.maximum - box.minimum;
+        glPushMatrix();
+        glTranslatef(center.x, center.y, center.z);
+        glScalef(dimensions.x, dimensions.y, dimensions.z);
+        glutSolidCube(1.0f);
+        glPopMatrix();
+        glEndQuery(GL_SAMPLES_PASSED);
+        state.pending = true;
+    }
+
+    glDepthMask(GL_TRUE);
+    glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+}
+
+void OcclusionQueries::clear() {
+    foreach (const ObjectState& state, _objects) {
+        glDeleteQueries(1, &state.query);
+    }
+    _objects.clear();
+}
@@ -0,0 +1,71 @@
+//
+//  OcclusionQueries.h
+//  interface/src/renderer
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#ifndef hifi_OcclusionQueries_h
+#define hifi_OcclusionQueries_h
+
+#include "InterfaceConfig.h"
+
+#include <glm/glm.hpp>
+
+#include <QHash>
+#include <QVector>
+
+/// The bounding box of an object to test for occlusion, with the key that identifies the object from frame to frame.
+struct OcclusionBox {
+    quint64 key;
+    glm::vec3 minimum;
+    glm::vec3 maximum;
+};
+
+/// Finds the objects hidden behind what has already been drawn by testing their bounding boxes against the depth buffer
+/// with hardware occlusion queries. The results are read a frame or more after the tests, once the GPU has caught up,
+/// so that the tests never stall rendering; an object is drawn again the frame after its box is found visible.
+class OcclusionQueries {
+public:
+
+    OcclusionQueries();
+    ~OcclusionQueries();
+
+    /// reads the results that have arrived and forgets the objects that are no longer tested; when disabled, every
+    /// object is taken to be visible.  Called once a frame, before the results are used
+    void beginFrame(bool enabled);
+
+    /// returns the number of results in a row that have found the object's box hidden
+    int getOccludedFrames(quint64 key) const;
+
+    /// tests the boxes against the depth buffer, each object at most once a frame.  A box that the eye is within the
+    /// margin of is taken to be visible, as its faces may be clipped by the near plane
+    void test(const QVector<OcclusionBox>& boxes, const glm::vec3& eyePosition, float margin);
+
+private:
+
+    // disallow copying of OcclusionQueries objects
+    OcclusionQueries(const OcclusionQueries&);
+    OcclusionQueries& operator= (const OcclusionQueries&);
+
+    void clear();
+
+    class ObjectState {
+    public:
+        ObjectState() : query(0), pending(false), occludedFrames(0), testedFrame(0) { }
+        
+        GLuint query;
+        bool pending; /// whether the query's result has yet to be read
+        int occludedFrames;
+        int testedFrame;
+    };
+
+    bool _enabled;
+    int _frame;
+    QHash<quint64, ObjectState> _objects;
+};
+
+#endif // hifi_OcclusionQueries_h
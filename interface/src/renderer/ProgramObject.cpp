@@ -9,11 +9,117 @@
 //  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
 //
 
+// include this before QGLShaderProgram, which includes an earlier version of OpenGL
+#include "InterfaceConfig.h"
+
+#include <cstring>
+
+#include <QCoreApplication>
+#include <QCryptographicHash>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QPair>
+#include <QSaveFile>
+#include <QStandardPaths>
+
 #include "ProgramObject.h"
 
 ProgramObject::ProgramObject(QObject* parent) : QGLShaderProgram(parent) {
 }
 
+#ifdef GL_PROGRAM_BINARY_RETRIEVABLE_HINT
+static bool isProgramBinarySupported() {
+    static int supported = -1;
+    if (supported == -1) {
+        const char* extensions = (const char*)glGetString(GL_EXTENSIONS);
+        GLint numFormats = 0;
+        if (extensions && strstr(extensions, "GL_ARB_get_program_binary")) {
+            glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &numFormats);
+        }
+        supported = (numFormats > 0) ? 1 : 0;
+    }
+    return supported == 1;
+}
+
+static QString getProgramBinaryDirectory() {
+    static QString directory;
+    if (directory.isEmpty()) {
+        directory = QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/programs";
+        QDir().mkpath(directory);
+    }
+    return directory;
+}
+#endif
+
+bool ProgramObject::link() {
+#ifdef GL_PROGRAM_BINARY_RETRIEVABLE_HINT
+    if (shaders().isEmpty() || !isProgramBinarySupported()) {
+        return QGLShaderProgram::link();
+    }
+    // the binary depends on the driver as well as the sources, and on the build for the attribute locations bound
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    hash.addData((const char*)glGetString(GL_VENDOR));
+    hash.addData((const char*)glGetString(GL_RENDERER));
+    hash.addData((const char*)glGetString(GL_VERSION));
+    hash.addData(QCoreApplication::applicationVersion().toUtf8());
+    QList<QPair<QGLShader::ShaderType, QByteArray> > sources;
+    foreach (QGLShader* shader, shaders()) {
+        sources.append(QPair<QGLShader::ShaderType, QByteArray>(shader->shaderType(), shader->sourceCode()));
+        hash.addData(QByteArray::number((int)shader->shaderType()));
+        hash.addData(shader->sourceCode());
+    }
+    QString fileName = getProgramBinaryDirectory() + "/" + hash.result().toHex() + ".bin";
+
+    // each file is the binary's format followed by the binary
+    QFile file(fileName);
+    if (file.open(QIODevice::ReadOnly)) {
+        QByteArray contents = file.readAll();
+        file.close();
+        if (contents.size() > (int)sizeof(GLenum)) {
+            GLenum format;
+            memcpy(&format, contents.constData(), sizeof(GLenum));
+
+            // Qt takes a program without shaders to be linked if it was given a binary that the driver accepted
+            removeAllShaders();
+            glProgramBinary(programId(), format, contents.constData() + sizeof(GLenum),
+                contents.size() - sizeof(GLenum));
+            if (QGLShaderProgram::link()) {
+                return true;
+            }
+            // a driver update can turn down the binaries of the one before
+            qDebug() << "Program binary was rejected, linking the shaders instead:" << fileName;
+            for (int i = 0; i < sources.size(); i++) {
+                addShaderFromSourceCode(sources.at(i).first, sources.at(i).second);
+            }
+        }
+    }
+
+    glProgramParameteri(programId(), GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    if (!QGLShaderProgram::link()) {
+        return false;
+    }
+    GLint length = 0;
+    glGetProgramiv(programId(), GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length > 0) {
+        QByteArray contents(sizeof(GLenum) + length, 0);
+        GLenum format;
+        glGetProgramBinary(programId(), length, NULL, &format, contents.data() + sizeof(GLenum));
+        memcpy(contents.data(), &format, sizeof(GLenum));
+
+        // saved whole or not at all, so that a program started at the same time doesn't read half a binary
+        QSaveFile saveFile(fileName);
+        if (saveFile.open(QIODevice::WriteOnly)) {
+            saveFile.write(contents);
+            saveFile.commit();
+        }
+    }
+    return true;
+#else
+    return QGLShaderProgram::link();
+#endif
+}
+
 void ProgramObject::setUniform(int location, const glm::vec3& value) {
     setUniformValue(location, value.x, value.y, value.z);
 }
@@ -16,11 +16,17 @@
 
 #include <glm/glm.hpp>
 
+/// A shader program that keeps the binary of each program it links on disk, keyed by the driver and the shaders'
+/// sources, and loads it in place of compiling and linking the shaders when the driver supports program binaries.
 class ProgramObject : public QGLShaderProgram {
 public:
     
     ProgramObject(QObject* parent = 0);
     
+    /// loads the program's binary from the cache if it's there and the driver takes it, otherwise links the shaders and
+    /// saves the binary for next time
+    virtual bool link();
+    
     void setUniform(int location, const glm::vec3& value);
     void setUniform(const char* name, const glm::vec3& value);
 };
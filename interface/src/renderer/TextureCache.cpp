@@ -61,6 +61,24 @@ TextureCache::~TextureCache() {
     }
 }
 
+// enough for a 1024 square RGB texture over three frames
+const int MAX_TEXTURE_UPLOAD_BYTES_PER_FRAME = 1024 * 1024;
+
+void TextureCache::uploadPendingTextures() {
+    int budget = MAX_TEXTURE_UPLOAD_BYTES_PER_FRAME;
+    while (budget > 0 && !_pendingUploads.isEmpty()) {
+        QSharedPointer<NetworkTexture> texture = _pendingUploads.first().toStrongRef().staticCast<NetworkTexture>();
+        if (texture.isNull() || texture->isUploaded()) {
+            _pendingUploads.removeFirst();
+            continue;
+        }
+        budget -= texture->uploadRows(budget);
+        if (texture->isUploaded()) {
+            _pendingUploads.removeFirst();
+        }
+    }
+}
+
 void TextureCache::setFrameBufferSize(QSize frameBufferSize) {
     //If the size changed, we need to delete our FBOs
     if (_frameBufferSize != frameBufferSize) {
@@ -192,7 +210,7 @@ QSharedPointer<NetworkTexture> TextureCache::getTexture(const QUrl& url, bool no
         texture->setCache(this);
         _dilatableNetworkTextures.insert(url, texture);
     } else {
-        _unusedResources.remove(texture->getLRUKey());
+        removeUnusedResource(texture);
     }
     return texture;
 }
@@ -317,9 +335,17 @@ Texture::~Texture() {
     glDeleteTextures(1, &_id);
 }
 
+void Texture::replaceID(GLuint id) {
+    glDeleteTextures(1, &_id);
+    _id = id;
+}
+
 NetworkTexture::NetworkTexture(const QUrl& url, bool normalMap, const QByteArray& content) :
     Resource(url, !content.isEmpty()),
-    _translucent(false) {
+    _translucent(false),
+    _pendingTranslucent(false),
+    _uploadedRows(0),
+    _uploadID(0) {
     
     if (!url.isValid()) {
         _loaded = true;
@@ -427,21 +453,66 @@ void NetworkTexture::loadContent(const QByteArray& content) {
     QThreadPool::globalInstance()->start(new ImageReader(_self, NULL, _url, content));
 }
 
+NetworkTexture::~NetworkTexture() {
+    if (_uploadID != 0) {
+        glDeleteTextures(1, &_uploadID);
+    }
+}
+
 void NetworkTexture::setImage(const QImage& image, bool translucent) {
-    _translucent = translucent;
-    
-    finishedLoading(true);
-    imageLoaded(image);
-    glBindTexture(GL_TEXTURE_2D, getID());
+    // keep showing the placeholder while the image goes up to a texture of its own, a few rows a frame
+    if (_uploadID == 0) {
+        glGenTextures(1, &_uploadID);
+    }
+    _pendingImage = image;
+    _pendingTranslucent = translucent;
+    _uploadedRows = 0;
+    glBindTexture(GL_TEXTURE_2D, _uploadID);
     if (image.hasAlphaChannel()) {
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, image.width(), image.height(), 0,
-            GL_BGRA, GL_UNSIGNED_BYTE, image.constBits());
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, image.width(), image.height(), 0, GL_BGRA, GL_UNSIGNED_BYTE, 0);
     } else {
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, image.width(), image.height(), 0,
-            GL_RGB, GL_UNSIGNED_BYTE, image.constBits());
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, image.width(), image.height(), 0, GL_RGB, GL_UNSIGNED_BYTE, 0);
     }
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
     glBindTexture(GL_TEXTURE_2D, 0);
+    
+    static_cast<TextureCache*>(_cache.data())->queueUpload(_self);
+}
+
+int NetworkTexture::uploadRows(int maxBytes) {
+    if (_pendingImage.isNull()) {
+        return 0;
+    }
+    // the image's rows are padded to four bytes, as GL expects them by default
+    int height = _pendingImage.height();
+    int rowBytes = _pendingImage.bytesPerLine();
+    int rows = qMin(qMax(maxBytes / rowBytes, 1), height - _uploadedRows);
+    glBindTexture(GL_TEXTURE_2D, _uploadID);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, _uploadedRows, _pendingImage.width(), rows,
+        _pendingImage.hasAlphaChannel() ? GL_BGRA : GL_RGB, GL_UNSIGNED_BYTE, _pendingImage.constScanLine(_uploadedRows));
+    glBindTexture(GL_TEXTURE_2D, 0);
+    _uploadedRows += rows;
+    if (_uploadedRows < height) {
+        return rows * rowBytes;
+    }
+    
+    // the image is all there, so it takes the placeholder's place
+    QImage image = _pendingImage;
+    _pendingImage = QImage();
+    replaceID(_uploadID);
+    _uploadID = 0;
+    _translucent = _pendingTranslucent;
+    
+    finishedLoading(true);
+    
+    // the RGB textures are uploaded unpadded, so they take three bytes a pixel
+    const int RGB_BYTES_PER_PIXEL = 3;
+    const int RGBA_BYTES_PER_PIXEL = 4;
+    setBytes(0, (qint64)image.width() * image.height() *
+        (image.hasAlphaChannel() ? RGBA_BYTES_PER_PIXEL : RGB_BYTES_PER_PIXEL));
+    
+    imageLoaded(image);
+    return rows * rowBytes;
 }
 
 void NetworkTexture::imageLoaded(const QImage& image) {
@@ -490,6 +561,9 @@ QSharedPointer<Texture> DilatableNetworkTexture::getDilatedTexture(float dilatio
 void DilatableNetworkTexture::imageLoaded(const QImage& image) {
     _image = image;
     
+    // we hold on to the image to paint the dilated versions from
+    setBytes(_image.byteCount(), getGPUBytes());
+    
     // scan out from the center to find inner and outer radii
     int halfWidth = image.width() / 2;
     int halfHeight = image.height() / 2;
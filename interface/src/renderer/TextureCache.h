@@ -71,6 +71,13 @@ public:
     /// Returns the ID of the shadow framebuffer object's depth texture.
     GLuint getShadowDepthTextureID();
     
+    /// Adds a texture to those whose images are uploaded a few rows at a time by uploadPendingTextures.
+    void queueUpload(const QWeakPointer<Resource>& texture) { _pendingUploads.append(texture); }
+    
+    /// Uploads the rows of the queued textures' images up to the budget for a frame, so that a burst of textures
+    /// arriving at once is spread over several frames rather than stalling one.
+    void uploadPendingTextures();
+    
     virtual bool eventFilter(QObject* watched, QEvent* event);
 
 protected:
@@ -99,6 +106,8 @@ private:
     GLuint _shadowDepthTextureID;
 
     QSize _frameBufferSize;
+    
+    QList<QWeakPointer<Resource> > _pendingUploads;
 };
 
 /// A simple object wrapper for an OpenGL texture.
@@ -110,6 +119,11 @@ public:
 
     GLuint getID() const { return _id; }
 
+protected:
+    
+    /// Replaces the texture with another, which the object then owns, deleting the old one.
+    void replaceID(GLuint id);
+
 private:
     
     GLuint _id;
@@ -122,11 +136,19 @@ class NetworkTexture : public Resource, public Texture {
 public:
     
     NetworkTexture(const QUrl& url, bool normalMap, const QByteArray& content);
+    virtual ~NetworkTexture();
 
     /// Checks whether it "looks like" this texture is translucent
     /// (majority of pixels neither fully opaque or fully transparent).
     bool isTranslucent() const { return _translucent; }
 
+    /// Uploads rows of the image set by setImage up to the given bytes (but always at least one row).
+    /// \return the bytes uploaded
+    int uploadRows(int maxBytes);
+    
+    /// Returns whether all the rows of the image have been uploaded.
+    bool isUploaded() const { return _pendingImage.isNull(); }
+
 protected:
 
     virtual void downloadFinished(QNetworkReply* reply);
@@ -139,6 +161,11 @@ protected:
 private:
 
     bool _translucent;
+    
+    QImage _pendingImage; ///< the image being uploaded, until all of it is
+    bool _pendingTranslucent;
+    int _uploadedRows;
+    GLuint _uploadID; ///< the texture the image is uploaded to, which replaces ours when it's complete
 };
 
 /// Caches derived, dilated textures.
@@ -16,18 +16,29 @@
 using namespace starfield;
 
 bool Controller::computeStars(unsigned numStars, unsigned seed) {
+    computeStarPositions(numStars, seed);
+    uploadStars();
+    return true;
+}
+
+void Controller::computeStarPositions(unsigned numStars, unsigned seed) {
     QElapsedTimer startTime;
     startTime.start();
     
     Generator::computeStarPositions(_inputSequence, numStars, seed);
     
-    this->retile(numStars, _tileResolution);
+    Tiling tiling(_tileResolution);
+    VertexOrder scanner(tiling);
+    radix2InplaceSort(_inputSequence.begin(), _inputSequence.end(), scanner);
+    _numStars = numStars;
     
     double NSEC_TO_MSEC = 1.0 / 1000000.0;
     double timeDiff = (double)startTime.nsecsElapsed() * NSEC_TO_MSEC;
     qDebug() << "Total time to retile and generate stars: " << timeDiff << "msec";
-    
-    return true;
+}
+
+void Controller::uploadStars() {
+    recreateRenderer(_numStars, _tileResolution);
 }
 
 bool Controller::setResolution(unsigned tileResolution) {
@@ -28,6 +28,14 @@ namespace starfield {
         ~Controller() { delete _renderer; }
         
         bool computeStars(unsigned numStars, unsigned seed);
+        
+        // Generates the stars and sorts them into tiles without touching GL, so that
+        // it can be done on another thread. uploadStars makes them ready to render.
+        void computeStarPositions(unsigned numStars, unsigned seed);
+        
+        // Creates the renderer for the stars computed, which uploads them. Needs the
+        // GL context, so is called on the main thread.
+        void uploadStars();
         bool setResolution(unsigned tileResolution);
         void render(float perspective, float angle, mat4 const& orientation, float alpha);
     private:
@@ -10,12 +10,31 @@
 //  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
 //
 
+#include <functional>
+
 #include "starfield/renderer/Renderer.h"
 
 using namespace starfield;
 
+// the dimmest a star can be drawn, on the scale of its color channels, before it's left out
+const float MIN_VISIBLE_STAR_BRIGHTNESS = 2.0f;
+
+// the factor by which the shader scales the star colors
+const float STAR_BRIGHTNESS_SCALE = 1.5f;
+
+static unsigned char getBrightness(unsigned color) {
+    return std::max(color & 0xFF, std::max((color >> 8) & 0xFF, (color >> 16) & 0xFF));
+}
+
+class BrighterThan {
+public:
+    bool operator()(GpuVertex const& first, GpuVertex const& second) const {
+        return getBrightness(first.getColor()) > getBrightness(second.getColor());
+    }
+};
+
 Renderer::Renderer(InputVertices const& stars, unsigned numStars, unsigned tileResolution) : _dataArray(0l),
-_tileArray(0l), _tiling(tileResolution) {
+_tileArray(0l), _brightnessArray(0l), _minBrightness(0), _tiling(tileResolution) {
     this->glAlloc();
 
     Tiling tiling(tileResolution);
@@ -26,6 +45,7 @@ _tileArray(0l), _tiling(tileResolution) {
     // off safe than sorry
     _dataArray = new GpuVertex[numStars];
     _tileArray = new Tile[numTiles + 1];
+    _brightnessArray = new unsigned char[numStars];
     _batchOffs = new GLint[numTiles * 2];
     _batchCountArray = new GLsizei[numTiles * 2];
 
@@ -37,6 +57,7 @@ _tileArray(0l), _tiling(tileResolution) {
 Renderer::~Renderer() {
     delete[] _dataArray;
     delete[] _tileArray;
+    delete[] _brightnessArray;
     delete[] _batchCountArray;
     delete[] _batchOffs;
 
@@ -44,6 +65,16 @@ Renderer::~Renderer() {
 }
 
 void Renderer::render(float perspective, float aspect, mat4 const& orientation, float alpha) {
+    // the stars too dim to see at this alpha are at the ends of their tiles' ranges, which are left out of the batch
+    if (alpha <= 0.0f) {
+        return;
+    }
+    float minBrightness = ceilf(MIN_VISIBLE_STAR_BRIGHTNESS / (alpha * STAR_BRIGHTNESS_SCALE));
+    if (minBrightness > 255.0f) {
+        return;
+    }
+    _minBrightness = (unsigned char)minBrightness;
+
     float halfPersp = perspective * 0.5f;
 
     // cancel all translation
@@ -124,6 +155,15 @@ void Renderer::prepareVertexData(InputVertices const& vertices, unsigned numStar
     for (Tile* e = _tileArray + nTiles + 1; ++tile != e;) {
         tile->offset = vertexIndex, tile->count = 0u, tile->flags = 0;
     }
+
+    // order each tile's stars from the brightest to the dimmest, so that those bright enough to see start its range
+    for (size_t i = 0; i < nTiles; i++) {
+        GpuVertex* first = _dataArray + _tileArray[i].offset;
+        std::stable_sort(first, first + _tileArray[i].count, BrighterThan());
+    }
+    for (size_t i = 0; i < numStars; i++) {
+        _brightnessArray[i] = getBrightness(_dataArray[i].getColor());
+    }
 }
 
 bool Renderer::visitTile(Tile* tile) {
@@ -161,9 +201,14 @@ unsigned Renderer::prepareBatch(unsigned const* indices, unsigned const* indices
     for (unsigned* i = (unsigned*) _batchOffs; i != indicesEnd; ++i) {
         Tile* t = _tileArray + *i;
         if ((t->flags & Tile::render) > 0u && t->count > 0u) {
-            *offs++ = t->offset;
-            *count++ = t->count;
-            ++nRanges;
+            unsigned char const* brightness = _brightnessArray + t->offset;
+            GLsizei visibleCount = std::upper_bound(brightness, brightness + t->count, _minBrightness,
+                std::greater<unsigned char>()) - brightness;
+            if (visibleCount > 0) {
+                *offs++ = t->offset;
+                *count++ = visibleCount;
+                ++nRanges;
+            }
         }
         t->flags = 0;
     }
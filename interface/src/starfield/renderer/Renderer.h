@@ -123,6 +123,8 @@ namespace starfield {
 
         GpuVertex* _dataArray;
         Tile* _tileArray;
+        unsigned char* _brightnessArray; // of each vertex, from the brightest to the dimmest within a tile
+        unsigned char _minBrightness;
         GLint* _batchOffs;
         GLsizei* _batchCountArray;
         GLuint _vertexArrayHandle;
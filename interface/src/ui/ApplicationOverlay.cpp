@@ -40,7 +40,8 @@ ApplicationOverlay::ApplicationOverlay() :
     _framebufferObject(NULL),
     _textureFov(DEFAULT_OCULUS_UI_ANGULAR_SIZE * RADIANS_PER_DEGREE),
     _alpha(1.0f),
-    _crosshairTexture(0) {
+    _crosshairTexture(0),
+    _lastTextureRenderTime(0) {
 
     memset(_reticleActive, 0, sizeof(_reticleActive));
     memset(_magActive, 0, sizeof(_reticleActive));
@@ -54,6 +55,9 @@ ApplicationOverlay::~ApplicationOverlay() {
 }
 
 const float WHITE_TEXT[] = { 0.93f, 0.93f, 0.93f };
+
+// how often the texture is redrawn in the Rift, where it's displayed at a much higher rate than the HUD changes
+const quint64 OCULUS_OVERLAY_TEXTURE_INTERVAL_USECS = USECS_PER_SECOND / 30;
 const float RETICLE_COLOR[] = { 0.0f, 198.0f / 255.0f, 244.0f / 255.0f };
 
 // Renders the overlays either to a texture or to the screen
@@ -83,6 +87,15 @@ void ApplicationOverlay::renderOverlay(bool renderToTexture) {
     }
 
     if (renderToTexture) {
+        quint64 now = usecTimestampNow();
+        if (OculusManager::isConnected() && _framebufferObject &&
+                now - _lastTextureRenderTime < OCULUS_OVERLAY_TEXTURE_INTERVAL_USECS) {
+            // the reticles are drawn over the texture when it's displayed, so we keep the texture from the last
+            // redraw and only update their state
+            renderPointers();
+            return;
+        }
+        _lastTextureRenderTime = now;
         getFramebufferObject()->bind();
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
     }
@@ -866,7 +879,6 @@ void ApplicationOverlay::renderStatsAndLogs() {
     Application* application = Application::getInstance();
 
     QGLWidget* glWidget = application->getGLWidget();
-    const OctreePacketProcessor& octreePacketProcessor = application->getOctreePacketProcessor();
     BandwidthMeter* bandwidthMeter = application->getBandwidthMeter();
     NodeBounds& nodeBoundsDisplay = application->getNodeBoundsDisplay();
 
@@ -877,7 +889,7 @@ void ApplicationOverlay::renderStatsAndLogs() {
     if (Menu::getInstance()->isOptionChecked(MenuOption::Stats)) {
         // let's set horizontal offset to give stats some margin to mirror
         int horizontalOffset = MIRROR_VIEW_WIDTH + MIRROR_VIEW_LEFT_PADDING * 2;
-        int voxelPacketsToProcess = octreePacketProcessor.packetsToProcessCount();
+        int voxelPacketsToProcess = application->getOctreePacketsToProcessCount();
         //  Onscreen text about position, servers, etc
         Stats::getInstance()->display(WHITE_TEXT, horizontalOffset, application->getFps(), application->getPacketsPerSecond(), application->getBytesPerSecond(), voxelPacketsToProcess);
         //  Bandwidth meter
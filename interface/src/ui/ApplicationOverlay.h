@@ -71,6 +71,8 @@ private:
     float _alpha;
 
     GLuint _crosshairTexture;
+    
+    quint64 _lastTextureRenderTime;
 };
 
 #endif // hifi_ApplicationOverlay_h
\ No newline at end of file
@@ -10,7 +10,9 @@
 //
 
 #include <QDateTime>
+#include <QDebug>
 #include <QFileInfo>
+#include <QHash>
 
 #include <AccountManager.h>
 #include <FileUtils.h>
@@ -64,23 +66,61 @@ SnapshotMetaData* Snapshot::parseSnapshotData(QString snapshotPath) {
     return data;
 }
 
-QString Snapshot::saveSnapshot(QGLWidget* widget, Avatar* avatar) {
-    QImage shot = widget->grabFrameBuffer();
+/// Tags a captured frame with the metadata and saves it, then lets the receiver know.
+class SnapshotEncoder : public FrameEncoder {
+public:
     
+    SnapshotEncoder(const QString& fileName, const QHash<QString, QString>& metaData,
+            QObject* receiver, const char* method);
+    
+protected:
+    
+    virtual void encode(const QImage& image);
+    
+private:
+    
+    QString _fileName;
+    QHash<QString, QString> _metaData;
+    QObject* _receiver;
+    const char* _method;
+};
+
+SnapshotEncoder::SnapshotEncoder(const QString& fileName, const QHash<QString, QString>& metaData,
+        QObject* receiver, const char* method) :
+    _fileName(fileName),
+    _metaData(metaData),
+    _receiver(receiver),
+    _method(method) {
+}
+
+void SnapshotEncoder::encode(const QImage& image) {
+    QImage shot = image;
+    for (QHash<QString, QString>::const_iterator it = _metaData.constBegin(); it != _metaData.constEnd(); it++) {
+        shot.setText(it.key(), it.value());
+    }
+    if (!shot.save(_fileName, 0, 100)) {
+        qDebug() << "Failed to save snapshot to" << _fileName;
+        return;
+    }
+    QMetaObject::invokeMethod(_receiver, _method, Qt::QueuedConnection, Q_ARG(QString, _fileName));
+}
+
+QString Snapshot::saveSnapshot(FrameCapture& frameCapture, Avatar* avatar, QObject* receiver, const char* method) {
     glm::vec3 location = avatar->getPosition();
     glm::quat orientation = avatar->getHead()->getOrientation();
     
     // add metadata
-    shot.setText(LOCATION_X, QString::number(location.x));
-    shot.setText(LOCATION_Y, QString::number(location.y));
-    shot.setText(LOCATION_Z, QString::number(location.z));
+    QHash<QString, QString> metaData;
+    metaData.insert(LOCATION_X, QString::number(location.x));
+    metaData.insert(LOCATION_Y, QString::number(location.y));
+    metaData.insert(LOCATION_Z, QString::number(location.z));
     
-    shot.setText(ORIENTATION_X, QString::number(orientation.x));
-    shot.setText(ORIENTATION_Y, QString::number(orientation.y));
-    shot.setText(ORIENTATION_Z, QString::number(orientation.z));
-    shot.setText(ORIENTATION_W, QString::number(orientation.w));
+    metaData.insert(ORIENTATION_X, QString::number(orientation.x));
+    metaData.insert(ORIENTATION_Y, QString::number(orientation.y));
+    metaData.insert(ORIENTATION_Z, QString::number(orientation.z));
+    metaData.insert(ORIENTATION_W, QString::number(orientation.w));
     
-    shot.setText(DOMAIN_KEY, NodeList::getInstance()->getDomainHandler().getHostname());
+    metaData.insert(DOMAIN_KEY, NodeList::getInstance()->getDomainHandler().getHostname());
 
     QString formattedLocation = QString("%1_%2_%3").arg(location.x).arg(location.y).arg(location.z);
     // replace decimal . with '-'
@@ -98,9 +138,8 @@ QString Snapshot::saveSnapshot(QGLWidget* widget, Avatar* avatar) {
     }
 
     fileName.append(QString(FILENAME_PATH_FORMAT.arg(username, now.toString(DATETIME_FORMAT), formattedLocation)));
-    shot.save(fileName, 0, 100);
+    frameCapture.requestFrame(new SnapshotEncoder(fileName, metaData, receiver, method));
     
     return fileName;
 }
 
-
@@ -19,6 +19,7 @@
 #include <QString>
 
 #include "avatar/Avatar.h"
+#include "renderer/FrameCapture.h"
 
 class SnapshotMetaData {
 public:
@@ -41,7 +42,9 @@ private:
 class Snapshot {
 
 public:
-    static QString saveSnapshot(QGLWidget* widget, Avatar* avatar);
+    /// Requests the next frame from the capture, to be tagged with the avatar's location and saved on a thread of the pool.
+    /// Returns the name of the file it will be saved to; once it has been, the receiver's method is invoked with that name.
+    static QString saveSnapshot(FrameCapture& frameCapture, Avatar* avatar, QObject* receiver, const char* method);
     static SnapshotMetaData* parseSnapshotData(QString snapshotPath);
 };
 
@@ -114,11 +114,8 @@ void SnapshotShareDialog::uploadSnapshot() {
     QNetworkRequest request(url);
 
     QNetworkReply* reply = NetworkAccessManager::getInstance().post(request, multiPart);
+    multiPart->setParent(reply); // delete the multiPart, and the file with it, along with the reply
     connect(reply, &QNetworkReply::finished, this, &SnapshotShareDialog::uploadRequestFinished);
-
-    QEventLoop loop;
-    connect(reply, &QNetworkReply::finished, &loop, &QEventLoop::quit);
-    loop.exec();
 }
 
 void SnapshotShareDialog::sendForumPost(QString snapshotPath) {
@@ -138,15 +135,12 @@ void SnapshotShareDialog::sendForumPost(QString snapshotPath) {
 
     QNetworkReply* requestReply = NetworkAccessManager::getInstance().post(request, postData);
     connect(requestReply, &QNetworkReply::finished, this, &SnapshotShareDialog::postRequestFinished);
-
-    QEventLoop loop;
-    connect(requestReply, &QNetworkReply::finished, &loop, &QEventLoop::quit);
-    loop.exec();
 }
 
 void SnapshotShareDialog::postRequestFinished() {
 
     QNetworkReply* requestReply = reinterpret_cast<QNetworkReply*>(sender());
+    requestReply->deleteLater();
     QJsonDocument jsonResponse = QJsonDocument::fromJson(requestReply->readAll());
     const QJsonObject& responseObject = jsonResponse.object();
 
@@ -183,6 +177,7 @@ void SnapshotShareDialog::postRequestFinished() {
 void SnapshotShareDialog::uploadRequestFinished() {
 
     QNetworkReply* requestReply = reinterpret_cast<QNetworkReply*>(sender());
+    requestReply->deleteLater();
     QJsonDocument jsonResponse = QJsonDocument::fromJson(requestReply->readAll());
     const QJsonObject& responseObject = jsonResponse.object();
 
@@ -193,6 +188,4 @@ void SnapshotShareDialog::uploadRequestFinished() {
         _ui.shareButton->setEnabled(true);
         _ui.shareButton->setStyleSheet(SHARE_BUTTON_STYLE + SHARE_BUTTON_ENABLED_STYLE);
     }
-
-    delete requestReply;
 }
@@ -96,7 +96,7 @@ void Stats::checkClick(int mouseX, int mouseY, int mouseDragStartedX, int mouseD
     }
 
     // geo stats panel click
-    lines = _expanded ? 4 : 3;
+    lines = _expanded ? 7 : 3;
     statsHeight = lines * STATS_PELS_PER_LINE + 10;
     if (mouseX > statsX && mouseX < statsX + _geoStatsWidth  && mouseY > statsY && mouseY < statsY + statsHeight) {
         toggleExpanded();
@@ -377,7 +377,7 @@ void Stats::display(
     MyAvatar* myAvatar = Application::getInstance()->getAvatar();
     glm::vec3 avatarPos = myAvatar->getPosition();
 
-    lines = _expanded ? 5 : 3;
+    lines = _expanded ? 8 : 3;
 
     drawBackground(backgroundColor, horizontalOffset, 0, _geoStatsWidth, lines * STATS_PELS_PER_LINE + 10);
     horizontalOffset += 5;
@@ -419,6 +419,23 @@ void Stats::display(
         
         verticalOffset += STATS_PELS_PER_LINE;
         drawText(horizontalOffset, verticalOffset, scale, rotation, font, downloads.str().c_str(), color);
+        
+        // what the caches hold on to, of which how much is for resources nothing is using
+        Application* application = Application::getInstance();
+        const int CACHE_COUNT = 3;
+        ResourceCache* caches[CACHE_COUNT] = { application->getGeometryCache(), application->getTextureCache(),
+            application->getAnimationCache() };
+        const char* cacheNames[CACHE_COUNT] = { "Models", "Textures", "Animations" };
+        const float BYTES_PER_MEGABYTE = 1024.0f * 1024.0f;
+        for (int i = 0; i < CACHE_COUNT; i++) {
+            char cacheStats[200];
+            sprintf(cacheStats, "%s: %.1f MB (%.1f MB unused)", cacheNames[i],
+                (caches[i]->getCPUBytes() + caches[i]->getGPUBytes()) / BYTES_PER_MEGABYTE,
+                caches[i]->getUnusedResourcesBytes() / BYTES_PER_MEGABYTE);
+            
+            verticalOffset += STATS_PELS_PER_LINE;
+            drawText(horizontalOffset, verticalOffset, scale, rotation, font, cacheStats, color);
+        }
     }
 
     verticalOffset = 0;
@@ -21,6 +21,12 @@
 // the width/height of the cached glyph textures
 const int IMAGE_SIZE = 256;
 
+// the number of string layouts each renderer caches
+const int MAX_CACHED_LAYOUTS = 256;
+
+// the position and texture coordinates of a glyph quad vertex
+const int FLOATS_PER_VERTEX = 4;
+
 Glyph::Glyph(int textureID, const QPoint& location, const QRect& bounds, int width) :
     _textureID(textureID), _location(location), _bounds(bounds), _width(width) {
 }
@@ -28,7 +34,8 @@ Glyph::Glyph(int textureID, const QPoint& location, const QRect& bounds, int wid
 TextRenderer::TextRenderer(const char* family, int pointSize, int weight,
                            bool italic, EffectType effectType, int effectThickness, QColor color)
         : _font(family, pointSize, weight, italic), _metrics(_font), _effectType(effectType),
-          _effectThickness(effectThickness), _x(IMAGE_SIZE), _y(IMAGE_SIZE), _rowHeight(0), _color(color) {
+          _effectThickness(effectThickness), _x(IMAGE_SIZE), _y(IMAGE_SIZE), _rowHeight(0), _color(color),
+          _layouts(MAX_CACHED_LAYOUTS) {
     _font.setKerning(false);
 }
 
@@ -52,9 +59,64 @@ int TextRenderer::calculateHeight(const char* str) {
 }
 
 int TextRenderer::draw(int x, int y, const char* str) {
-    glEnable(GL_TEXTURE_2D);    
+    TextLayout* layout = getLayout(str);
+    if (layout->runs.isEmpty()) {
+        return layout->maxHeight;
+    }
     
-    int maxHeight = 0;
+    // layouts drawn more than once keep their vertices in a buffer
+    if (++layout->drawCount > 1 && !layout->buffer.isCreated()) {
+        layout->buffer.create();
+        layout->buffer.setUsagePattern(QOpenGLBuffer::StaticDraw);
+        layout->buffer.bind();
+        layout->buffer.allocate(layout->vertices.constData(), layout->vertices.size() * sizeof(float));
+        layout->vertices.clear();
+    
+    } else if (layout->buffer.isCreated()) {
+        layout->buffer.bind();
+    }
+    const char* vertices = layout->buffer.isCreated() ? 0 : (const char*)layout->vertices.constData();
+    
+    glPushMatrix();
+    glTranslatef(x, y, 0.0f);
+    
+    glEnable(GL_TEXTURE_2D);
+    glEnableClientState(GL_VERTEX_ARRAY);
+    glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+    
+    glVertexPointer(2, GL_FLOAT, FLOATS_PER_VERTEX * sizeof(float), vertices);
+    glTexCoordPointer(2, GL_FLOAT, FLOATS_PER_VERTEX * sizeof(float), vertices + 2 * sizeof(float));
+    foreach (const TextLayout::Run& run, layout->runs) {
+        glBindTexture(GL_TEXTURE_2D, run.textureID);
+        glDrawArrays(GL_QUADS, run.firstVertex, run.vertexCount);
+    }
+    
+    glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+    glDisableClientState(GL_VERTEX_ARRAY);
+    
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glDisable(GL_TEXTURE_2D);
+    
+    glPopMatrix();
+    
+    if (layout->buffer.isCreated()) {
+        layout->buffer.release();
+    }
+    return layout->maxHeight;
+}
+
+TextLayout* TextRenderer::getLayout(const char* str) {
+    QByteArray key(str);
+    TextLayout* layout = _layouts.object(key);
+    if (layout) {
+        return layout;
+    }
+    layout = new TextLayout();
+    layout->maxHeight = 0;
+    layout->drawCount = 0;
+    
+    // the glyphs are collected into quads, with a run for each change of glyph texture
+    int x = 0;
     for (const char* ch = str; *ch != 0; ch++) {
         const Glyph& glyph = getGlyph(*ch);
         if (glyph.textureID() == 0) {
@@ -62,16 +124,22 @@ int TextRenderer::draw(int x, int y, const char* str) {
             continue;
         }
         
-        if (glyph.bounds().height() > maxHeight) {
-            maxHeight = glyph.bounds().height();
+        if (glyph.bounds().height() > layout->maxHeight) {
+            layout->maxHeight = glyph.bounds().height();
         }
     
-        glBindTexture(GL_TEXTURE_2D, glyph.textureID());
+        int vertexCount = layout->vertices.size() / FLOATS_PER_VERTEX;
+        if (layout->runs.isEmpty() || layout->runs.last().textureID != glyph.textureID()) {
+            TextLayout::Run run = { glyph.textureID(), vertexCount, 0 };
+            layout->runs.append(run);
+        }
+        const int VERTICES_PER_QUAD = 4;
+        layout->runs.last().vertexCount += VERTICES_PER_QUAD;
     
-        int left = x + glyph.bounds().x();
-        int right = x + glyph.bounds().x() + glyph.bounds().width();
-        int bottom = y + glyph.bounds().y();
-        int top = y + glyph.bounds().y() + glyph.bounds().height();
+        float left = x + glyph.bounds().x();
+        float right = x + glyph.bounds().x() + glyph.bounds().width();
+        float bottom = glyph.bounds().y();
+        float top = glyph.bounds().y() + glyph.bounds().height();
     
         float scale = 1.0 / IMAGE_SIZE;
         float ls = glyph.location().x() * scale;
@@ -79,23 +147,15 @@ int TextRenderer::draw(int x, int y, const char* str) {
         float bt = glyph.location().y() * scale;
         float tt = (glyph.location().y() + glyph.bounds().height()) * scale;
     
-        glBegin(GL_QUADS);
-        glTexCoord2f(ls, bt);
-        glVertex2f(left, bottom);
-        glTexCoord2f(rs, bt);
-        glVertex2f(right, bottom);
-        glTexCoord2f(rs, tt);
-        glVertex2f(right, top);
-        glTexCoord2f(ls, tt);
-        glVertex2f(left, top);
-        glEnd();
+        layout->vertices << left << bottom << ls << bt;
+        layout->vertices << right << bottom << rs << bt;
+        layout->vertices << right << top << rs << tt;
+        layout->vertices << left << top << ls << tt;
     
         x += glyph.width();
     }
-    glBindTexture(GL_TEXTURE_2D, 0);
-    glDisable(GL_TEXTURE_2D);
-    
-    return maxHeight;
+    _layouts.insert(key, layout);
+    return layout;
 }
 
 int TextRenderer::computeWidth(char ch)
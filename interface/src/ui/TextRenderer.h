@@ -12,15 +12,18 @@
 #ifndef hifi_TextRenderer_h
 #define hifi_TextRenderer_h
 
+// include this before QOpenGLBuffer, which includes an earlier version of OpenGL
+#include "InterfaceConfig.h"
+
+#include <QCache>
 #include <QColor>
 #include <QFont>
 #include <QFontMetrics>
 #include <QHash>
 #include <QImage>
+#include <QOpenGLBuffer>
 #include <QVector>
 
-#include "InterfaceConfig.h"
-
 // a special "character" that renders as a solid block
 const char SOLID_BLOCK_CHAR = 127;
 
@@ -35,6 +38,7 @@ const char SOLID_BLOCK_CHAR = 127;
 
 
 class Glyph;
+class TextLayout;
 
 class TextRenderer {
 public:
@@ -60,6 +64,9 @@ public:
 private:
 
     const Glyph& getGlyph (char c);
+    
+    // returns the cached layout of the string, laying it out if it isn't cached
+    TextLayout* getLayout(const char* str);
 
     // the font to render
     QFont _font;
@@ -90,6 +97,36 @@ private:
     
     // text color
     QColor _color;
+    
+    // the layouts of the strings most recently drawn, keyed by their text
+    QCache<QByteArray, TextLayout> _layouts;
+};
+
+// the glyph quads of a string laid out from the origin, grouped into runs that use the same glyph texture
+class TextLayout {
+public:
+
+    class Run {
+    public:
+        GLuint textureID;
+        int firstVertex;
+        int vertexCount;
+    };
+
+    // the position and texture coordinates of each vertex of the glyph quads, until they're moved to the buffer
+    QVector<float> vertices;
+    
+    QVector<Run> runs;
+    
+    // the height of the tallest character
+    int maxHeight;
+    
+    // the number of times the layout has been drawn
+    int drawCount;
+    
+    // holds the vertices once the layout is drawn a second time, so that strings that change every frame
+    // don't each create a buffer
+    QOpenGLBuffer buffer;
 };
 
 class Glyph {
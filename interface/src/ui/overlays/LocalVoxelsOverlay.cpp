@@ -18,45 +18,75 @@
 #include <Application.h>
 
 #include "LocalVoxelsOverlay.h"
-#include "voxels/VoxelSystem.h"
 
-QMap<QString, WeakVoxelSystemPointer> LocalVoxelsOverlay::_voxelSystemMap;
+QMap<QString, WeakLocalVoxelsMeshPointer> LocalVoxelsOverlay::_meshMap;
+
+static bool addColoredLeavesOperation(OctreeElement* element, void* extraData) {
+    VoxelTreeElement* voxel = static_cast<VoxelTreeElement*>(element);
+    if (voxel->isLeaf() && voxel->isColored()) {
+        static_cast<VoxelChunkMesher*>(extraData)->addVoxel(voxel);
+    }
+    return true;
+}
+
+LocalVoxelsMesh::LocalVoxelsMesh(const StrongVoxelTreePointer& tree) :
+    _tree(tree),
+    _meshedRoot(NULL),
+    _lastMeshed(0)
+{
+    _mesher.initialize(false);
+}
+
+LocalVoxelsMesh::~LocalVoxelsMesh() {
+    _mesher.releaseBuffers();
+}
+
+void LocalVoxelsMesh::update() {
+    _tree->lockForRead();
+    if (_tree->getRoot() != _meshedRoot || _tree->getRoot()->hasChangedInSubtreeSince(_lastMeshed)) {
+        _meshedRoot = _tree->getRoot();
+        _lastMeshed = usecTimestampNow();
+        _mesher.beginUpdates();
+        _mesher.clear();
+        _tree->recurseTreeWithOperation(addColoredLeavesOperation, &_mesher);
+        _mesher.endUpdates();
+    }
+    _tree->unlock();
+
+    // meshes a few of the chunks that changed
+    _mesher.threadRoutine();
+}
+
+void LocalVoxelsMesh::render(const glm::vec3& position, float size) {
+    _mesher.render(*Application::getInstance()->getViewFrustum(), position, size);
+}
 
 LocalVoxelsOverlay::LocalVoxelsOverlay() :
-    Volume3DOverlay(),
-    _voxelCount(0)
+    Volume3DOverlay()
 {
 }
 
 LocalVoxelsOverlay::~LocalVoxelsOverlay() {
-    _voxelSystem->changeTree(new VoxelTree());
-    _voxelSystem.clear();
-    if (_voxelSystemMap.value(_treeName).isNull()) {
-        _voxelSystemMap.remove(_treeName);
+    _mesh.clear();
+    if (_meshMap.value(_treeName).isNull()) {
+        _meshMap.remove(_treeName);
     }
     _tree.clear();
     LocalVoxelsList::getInstance()->remove(_treeName);
 }
 
 void LocalVoxelsOverlay::update(float deltatime) {
-    if (!_voxelSystem->isInitialized()) {
-        _voxelSystem->init();
+    if (_visible && _mesh) {
+        _mesh->update();
     }
-    
-    _tree->lockForRead();
-    if (_visible && _voxelCount != _tree->getOctreeElementsCount()) {
-        _voxelCount = _tree->getOctreeElementsCount();
-        _voxelSystem->forceRedrawEntireTree();
-    }
-    _tree->unlock();
 }
 
 void LocalVoxelsOverlay::render() {
-    if (_visible && _size > 0 && _voxelSystem && _voxelSystem->isInitialized()) {
+    if (_visible && _size > 0 && _mesh) {
         glPushMatrix(); {
             glTranslatef(_position.x, _position.y, _position.z);
             glScalef(_size, _size, _size);
-            _voxelSystem->render();
+            _mesh->render(_position, _size);
         } glPopMatrix();
     }
 }
@@ -80,13 +110,10 @@ void LocalVoxelsOverlay::setProperties(const QScriptValue &properties) {
             return;
         }
     
-        _voxelSystem = _voxelSystemMap[_treeName];
-        if (_voxelSystem.isNull()) {
-            _voxelSystem = StrongVoxelSystemPointer(new VoxelSystem(1,
-                                                                    DEFAULT_MAX_VOXELS_PER_SYSTEM,
-                                                                    _tree.data()));
-            _voxelSystemMap.insert(_treeName, _voxelSystem);
+        _mesh = _meshMap[_treeName];
+        if (_mesh.isNull()) {
+            _mesh = StrongLocalVoxelsMeshPointer(new LocalVoxelsMesh(_tree));
+            _meshMap.insert(_treeName, _mesh);
         }
     }
 }
-
@@ -24,9 +24,30 @@
 #include <LocalVoxelsList.h>
 
 #include "Volume3DOverlay.h"
+#include "voxels/VoxelChunkMesher.h"
 
-typedef QSharedPointer<VoxelSystem> StrongVoxelSystemPointer;
-typedef QWeakPointer<VoxelSystem> WeakVoxelSystemPointer;
+/// A local tree's voxels meshed into chunk VBOs, which hold only the tree's visible faces. The overlays that show the same
+/// tree share one, and it's meshed on the main thread a few chunks a frame, so it needs no thread of its own.
+class LocalVoxelsMesh {
+public:
+    LocalVoxelsMesh(const StrongVoxelTreePointer& tree);
+    ~LocalVoxelsMesh();
+
+    /// remeshes the tree if it's changed since the last update
+    void update();
+
+    /// draws the tree with its corner at the position and the given size across, with that transform applied
+    void render(const glm::vec3& position, float size);
+
+private:
+    StrongVoxelTreePointer _tree;
+    VoxelChunkMesher _mesher;
+    OctreeElement* _meshedRoot; /// erasing the tree replaces its root
+    quint64 _lastMeshed;
+};
+
+typedef QSharedPointer<LocalVoxelsMesh> StrongLocalVoxelsMeshPointer;
+typedef QWeakPointer<LocalVoxelsMesh> WeakLocalVoxelsMeshPointer;
 
 class LocalVoxelsOverlay : public Volume3DOverlay {
     Q_OBJECT
@@ -40,12 +61,11 @@ public:
     virtual void setProperties(const QScriptValue& properties);
     
 private:
-    static QMap<QString, WeakVoxelSystemPointer> _voxelSystemMap; // treeName/voxelSystem
+    static QMap<QString, WeakLocalVoxelsMeshPointer> _meshMap; // treeName/mesh
     
     QString _treeName;
     StrongVoxelTreePointer _tree; // so that the tree doesn't get freed
-    unsigned long _voxelCount;
-    StrongVoxelSystemPointer _voxelSystem;
+    StrongLocalVoxelsMeshPointer _mesh;
 };
 
 #endif // hifi_LocalVoxelsOverlay_h
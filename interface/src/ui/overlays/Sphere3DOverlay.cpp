@@ -14,6 +14,8 @@
 #include <QGLWidget>
 #include <SharedUtil.h>
 
+#include "Application.h"
+
 #include "Sphere3DOverlay.h"
 
 Sphere3DOverlay::Sphere3DOverlay() {
@@ -39,7 +41,8 @@ void Sphere3DOverlay::render() {
     glLineWidth(_lineWidth);
     const int slices = 15;
     if (_isSolid) {
-        glutSolidSphere(_size, slices, slices);
+        glScalef(_size, _size, _size);
+        Application::getInstance()->getGeometryCache()->renderSphere(slices, slices);
     } else {
         glutWireSphere(_size, slices, slices);
     }
@@ -15,6 +15,10 @@
 #include "Menu.h"
 #include "OctreePacketProcessor.h"
 
+OctreePacketProcessor::OctreePacketProcessor(NodeType_t serverType) :
+    _serverType(serverType) {
+}
+
 void OctreePacketProcessor::processPacket(const SharedNodePointer& sendingNode, const QByteArray& packet) {
     PerformanceWarning warn(Menu::getInstance()->isOptionChecked(MenuOption::PipelineWarnings),
                             "OctreePacketProcessor::processPacket()");
@@ -33,7 +37,7 @@ void OctreePacketProcessor::processPacket(const SharedNodePointer& sendingNode,
 
 
     // check to see if the UI thread asked us to kill the voxel tree. since we're the only thread allowed to do that
-    if (app->_wantToKillLocalVoxels) {
+    if (_serverType == NodeType::VoxelServer && app->_wantToKillLocalVoxels) {
         app->_voxels.killLocalVoxels();
         app->_wantToKillLocalVoxels = false;
     }
@@ -12,13 +12,25 @@
 #ifndef hifi_OctreePacketProcessor_h
 #define hifi_OctreePacketProcessor_h
 
+#include <Node.h>
 #include <ReceivedPacketProcessor.h>
 
 /// Handles processing of incoming voxel packets for the interface application. As with other ReceivedPacketProcessor classes 
 /// the user is responsible for reading inbound packets and adding them to the processing queue by calling queueReceivedPacket()
+/// There's one for each type of octree server, so that the packets of each tree are decoded on their own thread and
+/// only ever wait on the lock of their own tree.
 class OctreePacketProcessor : public ReceivedPacketProcessor {
     Q_OBJECT
+public:
+    OctreePacketProcessor(NodeType_t serverType);
+
+    /// the type of the servers whose packets this processes
+    NodeType_t getServerType() const { return _serverType; }
+
 protected:
     virtual void processPacket(const SharedNodePointer& sendingNode, const QByteArray& packet);
+
+private:
+    NodeType_t _serverType;
 };
 #endif // hifi_OctreePacketProcessor_h
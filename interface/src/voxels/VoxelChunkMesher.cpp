@@ -0,0 +1,518 @@
+//
+//  VoxelChunkMesher.cpp
+//  interface/src/voxels
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+
+#include <QtCore/QMap>
+#include <QtCore/QMutexLocker>
+
+#include <OctalCode.h>
+#include <SharedUtil.h>
+#include <VoxelTreeElement.h>
+
+#include "Application.h"
+#include "VoxelChunkMesher.h"
+#include "renderer/ProgramObject.h"
+
+const int FACE_DIRECTIONS = 6; // down then up each of x, y and z
+const GLbyte NORMAL_LENGTH = 127;
+
+const int CHUNK_KEY_BITS = 20;
+const quint64 CHUNK_KEY_MASK = (1ULL << CHUNK_KEY_BITS) - 1;
+const quint64 CHUNK_KEY_AT_CHUNK_LEVEL = 1ULL << 63; // tells the chunk at the origin apart from the root's chunk
+
+const int MAX_CHUNKS_PER_PASS = 16;
+const quint64 IDLE_USECS = 5000;
+
+static bool cellForVoxel(const VoxelTreeElement* voxel, VoxelCell& cell) {
+    OctalKey key;
+    if (!octalKeyForCode(voxel->getOctalCode(), key) || key.sections > MAX_CHUNK_VOXEL_LEVEL) {
+        return false;
+    }
+    cell.x = cell.y = cell.z = 0;
+    cell.level = key.sections;
+    for (int i = 0; i < key.sections; i++) {
+        int value = octalKeySectionValue(key, i);
+        cell.x = (cell.x << 1) | ((value >> 2) & 1);
+        cell.y = (cell.y << 1) | ((value >> 1) & 1);
+        cell.z = (cell.z << 1) | (value & 1);
+    }
+    return true;
+}
+
+static quint64 chunkKeyForCell(const VoxelCell& cell) {
+    if (cell.level < VOXEL_CHUNK_LEVEL) {
+        return 0;
+    }
+    int shift = cell.level - VOXEL_CHUNK_LEVEL;
+    return CHUNK_KEY_AT_CHUNK_LEVEL | ((quint64)(cell.x >> shift) << (2 * CHUNK_KEY_BITS)) |
+        ((quint64)(cell.y >> shift) << CHUNK_KEY_BITS) | (quint64)(cell.z >> shift);
+}
+
+ProgramObject* VoxelChunkMesher::_instanceProgram = NULL;
+int VoxelChunkMesher::_instancePositionLocation;
+int VoxelChunkMesher::_instanceColorLevelLocation;
+GLuint VoxelChunkMesher::_unitCubeVBO = 0;
+int VoxelChunkMesher::_unitCubeVertexCount = 0;
+
+static AACube boundsForChunk(quint64 key) {
+    if (key == 0) {
+        return AACube(glm::vec3(0.0f, 0.0f, 0.0f), 1.0f);
+    }
+    float scale = 1.0f / (1 << VOXEL_CHUNK_LEVEL);
+    glm::vec3 corner((key >> (2 * CHUNK_KEY_BITS)) & CHUNK_KEY_MASK, (key >> CHUNK_KEY_BITS) & CHUNK_KEY_MASK,
+        key & CHUNK_KEY_MASK);
+    return AACube(corner * scale, scale);
+}
+
+VoxelChunkMesher::VoxelChunkMesher(bool instanced) :
+    _instanced(instanced),
+    _chunksMutex(QMutex::Recursive),
+    _elementCount(0),
+    _memoryUsageVBO(0),
+    _viewScale(TREE_SCALE) {
+}
+
+bool VoxelChunkMesher::isInstancingSupported() {
+    const char* extensions = (const char*)glGetString(GL_EXTENSIONS);
+    return extensions && strstr(extensions, "GL_ARB_instanced_arrays") && strstr(extensions, "GL_ARB_draw_instanced");
+}
+
+bool VoxelChunkMesher::addVoxel(const VoxelTreeElement* voxel) {
+    VoxelCell cell;
+    if (!cellForVoxel(voxel, cell)) {
+        return false;
+    }
+    const nodeColor& color = voxel->getColor();
+    quint32 packedColor = (color[RED_INDEX] << 16) | (color[GREEN_INDEX] << 8) | color[BLUE_INDEX];
+    quint64 key = chunkKeyForCell(cell);
+
+    QMutexLocker locker(&_chunksMutex);
+    ChunkVoxels& voxels = _chunks[key];
+    ChunkVoxels::iterator existing = voxels.find(cell);
+    if (existing != voxels.end()) {
+        if (existing.value() != packedColor) {
+            existing.value() = packedColor;
+            _dirtyChunks.insert(key);
+        }
+        return false;
+    }
+    voxels.insert(cell, packedColor);
+    _dirtyChunks.insert(key);
+    return true;
+}
+
+bool VoxelChunkMesher::removeVoxel(const VoxelTreeElement* voxel) {
+    VoxelCell cell;
+    if (!cellForVoxel(voxel, cell)) {
+        return false;
+    }
+    quint64 key = chunkKeyForCell(cell);
+
+    QMutexLocker locker(&_chunksMutex);
+    QHash<quint64, ChunkVoxels>::iterator chunk = _chunks.find(key);
+    if (chunk == _chunks.end() || chunk.value().remove(cell) == 0) {
+        return false;
+    }
+    if (chunk.value().isEmpty()) {
+        _chunks.erase(chunk);
+    }
+    _dirtyChunks.insert(key);
+    return true;
+}
+
+void VoxelChunkMesher::clear() {
+    QMutexLocker locker(&_chunksMutex);
+    foreach (quint64 key, _chunks.keys()) {
+        _dirtyChunks.insert(key);
+    }
+    _chunks.clear();
+}
+
+bool VoxelChunkMesher::process() {
+    QVector<quint64> keys;
+    QVector<ChunkVoxels> chunks;
+    {
+        QMutexLocker locker(&_chunksMutex);
+        QSet<quint64>::iterator dirty = _dirtyChunks.begin();
+        while (dirty != _dirtyChunks.end() && keys.size() < MAX_CHUNKS_PER_PASS) {
+            keys.append(*dirty);
+
+            // the copy is shared until the next update to the chunk, so taking it is cheap
+            chunks.append(_chunks.value(*dirty));
+            dirty = _dirtyChunks.erase(dirty);
+        }
+    }
+
+    if (keys.isEmpty()) {
+        if (isThreaded() && isStillRunning()) {
+            usleep(IDLE_USECS);
+        }
+        return isStillRunning();
+    }
+
+    for (int i = 0; i < keys.size(); i++) {
+        QByteArray finished;
+        if (_instanced) {
+            QVector<VoxelInstance> instances;
+            instanceChunk(chunks.at(i), instances);
+            finished = QByteArray((const char*)instances.constData(), instances.size() * sizeof(VoxelInstance));
+        } else {
+            QVector<ChunkVertex> vertices;
+            meshChunk(chunks.at(i), vertices);
+            finished = QByteArray((const char*)vertices.constData(), vertices.size() * sizeof(ChunkVertex));
+        }
+        QMutexLocker locker(&_finishedMutex);
+        _finishedChunks.insert(keys.at(i), finished);
+    }
+    return isStillRunning();
+}
+
+void VoxelChunkMesher::uploadFinishedChunks() {
+    // take no more than a frame's worth of uploads, but always at least one chunk so that a big one isn't stuck
+    QHash<quint64, QByteArray> finishedChunks;
+    {
+        QMutexLocker locker(&_finishedMutex);
+        int uploadBytes = 0;
+        QHash<quint64, QByteArray>::iterator chunk = _finishedChunks.begin();
+        while (chunk != _finishedChunks.end()) {
+            int chunkBytes = chunk.value().size();
+            if (chunkBytes > 0 && uploadBytes > 0 && uploadBytes + chunkBytes > MAX_VOXEL_UPLOAD_BYTES_PER_FRAME) {
+                chunk++;
+                continue;
+            }
+            uploadBytes += chunkBytes;
+            finishedChunks.insert(chunk.key(), chunk.value());
+            chunk = _finishedChunks.erase(chunk);
+        }
+    }
+
+    // a mesh's elements are its quads, an instanced chunk's are its voxels
+    int elementBytes = _instanced ? sizeof(VoxelInstance) : sizeof(ChunkVertex);
+    int countPerElement = _instanced ? 1 : VERTICES_PER_FACE;
+
+    for (QHash<quint64, QByteArray>::const_iterator chunk = finishedChunks.constBegin();
+            chunk != finishedChunks.constEnd(); chunk++) {
+        const QByteArray& data = chunk.value();
+        QHash<quint64, ChunkBuffer>::iterator buffer = _buffers.find(chunk.key());
+        if (buffer != _buffers.end()) {
+            _memoryUsageVBO -= buffer.value().count * elementBytes;
+            _elementCount -= buffer.value().count / countPerElement;
+            if (data.isEmpty()) {
+                glDeleteBuffers(1, &buffer.value().vbo);
+                _buffers.erase(buffer);
+                continue;
+            }
+        } else if (data.isEmpty()) {
+            continue;
+
+        } else {
+            ChunkBuffer newBuffer;
+            glGenBuffers(1, &newBuffer.vbo);
+            newBuffer.bounds = boundsForChunk(chunk.key());
+            buffer = _buffers.insert(chunk.key(), newBuffer);
+        }
+        glBindBuffer(GL_ARRAY_BUFFER, buffer.value().vbo);
+        glBufferData(GL_ARRAY_BUFFER, data.size(), data.constData(), GL_STATIC_DRAW);
+        buffer.value().count = data.size() / elementBytes;
+        _memoryUsageVBO += data.size();
+        _elementCount += buffer.value().count / countPerElement;
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void VoxelChunkMesher::render(const ViewFrustum& viewFrustum, const glm::vec3& origin, float scale) {
+    uploadFinishedChunks();
+    if (_buffers.isEmpty()) {
+        return;
+    }
+    _viewOrigin = origin;
+    _viewScale = scale;
+    if (_instanced) {
+        renderInstances(viewFrustum);
+    } else {
+        renderMeshes(viewFrustum);
+    }
+}
+
+bool VoxelChunkMesher::isInView(const ViewFrustum& viewFrustum, const ChunkBuffer& buffer) const {
+    AACube bounds(_viewOrigin + buffer.bounds.getCorner() * _viewScale, buffer.bounds.getScale() * _viewScale);
+    return viewFrustum.cubeInFrustum(bounds) != ViewFrustum::OUTSIDE;
+}
+
+void VoxelChunkMesher::renderMeshes(const ViewFrustum& viewFrustum) {
+    glEnableClientState(GL_VERTEX_ARRAY);
+    glEnableClientState(GL_NORMAL_ARRAY);
+    glEnableClientState(GL_COLOR_ARRAY);
+    glEnable(GL_CULL_FACE);
+
+    for (QHash<quint64, ChunkBuffer>::const_iterator buffer = _buffers.constBegin(); buffer != _buffers.constEnd(); buffer++) {
+        if (!isInView(viewFrustum, buffer.value())) {
+            continue;
+        }
+        glBindBuffer(GL_ARRAY_BUFFER, buffer.value().vbo);
+        glVertexPointer(3, GL_FLOAT, sizeof(ChunkVertex), (void*)offsetof(ChunkVertex, position));
+        glNormalPointer(GL_BYTE, sizeof(ChunkVertex), (void*)offsetof(ChunkVertex, normal));
+        glColorPointer(3, GL_UNSIGNED_BYTE, sizeof(ChunkVertex), (void*)offsetof(ChunkVertex, color));
+        glDrawArrays(GL_QUADS, 0, buffer.value().count);
+    }
+
+    glDisable(GL_CULL_FACE);
+    glDisableClientState(GL_VERTEX_ARRAY);
+    glDisableClientState(GL_NORMAL_ARRAY);
+    glDisableClientState(GL_COLOR_ARRAY);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void VoxelChunkMesher::renderInstances(const ViewFrustum& viewFrustum) {
+    if (!_instanceProgram) {
+        _instanceProgram = new ProgramObject();
+        _instanceProgram->addShaderFromSourceFile(QGLShader::Vertex,
+            Application::resourcesPath() + "shaders/instanced_voxel.vert");
+        _instanceProgram->link();
+        _instancePositionLocation = _instanceProgram->attributeLocation("instancePosition");
+        _instanceColorLevelLocation = _instanceProgram->attributeLocation("instanceColorLevel");
+
+        // the unit cube is the mesh of the root voxel
+        ChunkVoxels rootVoxel;
+        VoxelCell rootCell = { 0, 0, 0, 0 };
+        rootVoxel.insert(rootCell, 0);
+        QVector<ChunkVertex> vertices;
+        meshChunk(rootVoxel, vertices);
+        glGenBuffers(1, &_unitCubeVBO);
+        glBindBuffer(GL_ARRAY_BUFFER, _unitCubeVBO);
+        glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(ChunkVertex), vertices.constData(), GL_STATIC_DRAW);
+        _unitCubeVertexCount = vertices.size();
+    }
+    _instanceProgram->bind();
+
+    glBindBuffer(GL_ARRAY_BUFFER, _unitCubeVBO);
+    glEnableClientState(GL_VERTEX_ARRAY);
+    glEnableClientState(GL_NORMAL_ARRAY);
+    glVertexPointer(3, GL_FLOAT, sizeof(ChunkVertex), (void*)offsetof(ChunkVertex, position));
+    glNormalPointer(GL_BYTE, sizeof(ChunkVertex), (void*)offsetof(ChunkVertex, normal));
+
+    glEnableVertexAttribArray(_instancePositionLocation);
+    glEnableVertexAttribArray(_instanceColorLevelLocation);
+    glVertexAttribDivisorARB(_instancePositionLocation, 1);
+    glVertexAttribDivisorARB(_instanceColorLevelLocation, 1);
+    glEnable(GL_CULL_FACE);
+
+    for (QHash<quint64, ChunkBuffer>::const_iterator buffer = _buffers.constBegin(); buffer != _buffers.constEnd(); buffer++) {
+        if (!isInView(viewFrustum, buffer.value())) {
+            continue;
+        }
+        glBindBuffer(GL_ARRAY_BUFFER, buffer.value().vbo);
+        glVertexAttribPointer(_instancePositionLocation, 3, GL_FLOAT, GL_FALSE, sizeof(VoxelInstance),
+            (void*)offsetof(VoxelInstance, position));
+        glVertexAttribPointer(_instanceColorLevelLocation, 4, GL_UNSIGNED_BYTE, GL_FALSE, sizeof(VoxelInstance),
+            (void*)offsetof(VoxelInstance, color));
+        glDrawArraysInstancedARB(GL_QUADS, 0, _unitCubeVertexCount, buffer.value().count);
+    }
+
+    // the divisors stick to the attribute slots, so put them back for the other programs that use them
+    glDisable(GL_CULL_FACE);
+    glVertexAttribDivisorARB(_instancePositionLocation, 0);
+    glVertexAttribDivisorARB(_instanceColorLevelLocation, 0);
+    glDisableVertexAttribArray(_instancePositionLocation);
+    glDisableVertexAttribArray(_instanceColorLevelLocation);
+    glDisableClientState(GL_VERTEX_ARRAY);
+    glDisableClientState(GL_NORMAL_ARRAY);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    _instanceProgram->release();
+}
+
+void VoxelChunkMesher::releaseBuffers() {
+    foreach (const ChunkBuffer& buffer, _buffers) {
+        glDeleteBuffers(1, &buffer.vbo);
+    }
+    _buffers.clear();
+    _elementCount = 0;
+    _memoryUsageVBO = 0;
+
+    QMutexLocker locker(&_finishedMutex);
+    _finishedChunks.clear();
+}
+
+/// a plane of faces of one level that point the same way
+class FaceGroup {
+public:
+    int direction;
+    int level;
+    quint32 plane;
+
+    bool operator==(const FaceGroup& other) const {
+        return direction == other.direction && level == other.level && plane == other.plane;
+    }
+};
+
+inline uint qHash(const FaceGroup& group) {
+    return (group.plane * 2654435761u) ^ (uint)(group.level << 3) ^ (uint)group.direction;
+}
+
+// the faces of a group by their place on the plane, (v << 32) | u, so that they're in rows
+typedef QMap<quint64, quint32> GroupFaces;
+
+static quint64 faceKey(quint32 u, quint32 v) {
+    return ((quint64)v << 32) | u;
+}
+
+// true if a voxel of the chunk covers the cell, either the cell itself or one of its ancestors
+static bool isCellFilled(const ChunkVoxels& voxels, const VoxelCell& cell, int shallowestLevel) {
+    for (int level = cell.level; level >= shallowestLevel; level--) {
+        int shift = cell.level - level;
+        VoxelCell ancestor = { cell.x >> shift, cell.y >> shift, cell.z >> shift, level };
+        if (voxels.contains(ancestor)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static int shallowestLevelOf(const ChunkVoxels& voxels) {
+    int shallowestLevel = MAX_CHUNK_VOXEL_LEVEL;
+    for (ChunkVoxels::const_iterator voxel = voxels.constBegin(); voxel != voxels.constEnd(); voxel++) {
+        shallowestLevel = qMin(shallowestLevel, voxel.key().level);
+    }
+    return shallowestLevel;
+}
+
+// true if the cell's face in the direction doesn't touch another voxel of the chunk. a face that's covered by several
+// smaller voxels counts as showing, it's rare enough not to be worth finding
+static bool isFaceShowing(const ChunkVoxels& voxels, const VoxelCell& cell, int direction, int shallowestLevel) {
+    int axis = direction / 2;
+    bool positive = (direction % 2) != 0;
+    quint32 neighbor[3] = { cell.x, cell.y, cell.z };
+    neighbor[axis] += positive ? 1 : -1;
+
+    // past the edge of the tree the neighbor's coordinate wraps or reaches the size, and nothing covers it
+    if (neighbor[axis] >= (1u << cell.level)) {
+        return true;
+    }
+    VoxelCell neighborCell = { neighbor[0], neighbor[1], neighbor[2], cell.level };
+    return !isCellFilled(voxels, neighborCell, shallowestLevel);
+}
+
+static bool takeFace(GroupFaces& faces, quint32 u, quint32 v, quint32 color) {
+    GroupFaces::iterator face = faces.find(faceKey(u, v));
+    if (face == faces.end() || face.value() != color) {
+        return false;
+    }
+    faces.erase(face);
+    return true;
+}
+
+static void appendQuad(QVector<ChunkVertex>& vertices, const FaceGroup& group, quint32 u, quint32 v,
+                       quint32 width, quint32 height, quint32 color) {
+    int axis = group.direction / 2;
+    bool positive = (group.direction % 2) != 0;
+    int uAxis = (axis + 1) % 3;
+    int vAxis = (axis + 2) % 3;
+    double scale = ldexp(1.0, -group.level);
+
+    ChunkVertex vertex;
+    vertex.normal[0] = vertex.normal[1] = vertex.normal[2] = 0;
+    vertex.normal[axis] = positive ? NORMAL_LENGTH : -NORMAL_LENGTH;
+    vertex.color[0] = (color >> 16) & 0xff;
+    vertex.color[1] = (color >> 8) & 0xff;
+    vertex.color[2] = color & 0xff;
+    vertex.position[axis] = (GLfloat)(group.plane * scale);
+
+    // u cross v is the axis, so going around u then v winds counterclockwise seen from the positive side
+    const int CORNERS[VERTICES_PER_FACE][2] = { { 0, 0 }, { 1, 0 }, { 1, 1 }, { 0, 1 } };
+    for (int i = 0; i < VERTICES_PER_FACE; i++) {
+        const int* corner = CORNERS[positive ? i : (VERTICES_PER_FACE - i) % VERTICES_PER_FACE];
+        vertex.position[uAxis] = (GLfloat)((u + corner[0] * width) * scale);
+        vertex.position[vAxis] = (GLfloat)((v + corner[1] * height) * scale);
+        vertices.append(vertex);
+    }
+}
+
+void VoxelChunkMesher::meshChunk(const ChunkVoxels& voxels, QVector<ChunkVertex>& vertices) {
+    int shallowestLevel = shallowestLevelOf(voxels);
+
+    // find the faces that don't touch another voxel
+    QHash<FaceGroup, GroupFaces> groups;
+    for (ChunkVoxels::const_iterator voxel = voxels.constBegin(); voxel != voxels.constEnd(); voxel++) {
+        const VoxelCell& cell = voxel.key();
+        quint32 coordinates[3] = { cell.x, cell.y, cell.z };
+        for (int direction = 0; direction < FACE_DIRECTIONS; direction++) {
+            if (!isFaceShowing(voxels, cell, direction, shallowestLevel)) {
+                continue;
+            }
+            int axis = direction / 2;
+            bool positive = (direction % 2) != 0;
+            FaceGroup group = { direction, cell.level, positive ? coordinates[axis] + 1 : coordinates[axis] };
+            groups[group].insert(faceKey(coordinates[(axis + 1) % 3], coordinates[(axis + 2) % 3]), voxel.value());
+        }
+    }
+
+    // merge each group's faces greedily, taking the first face left, widening it along its row as far as the color
+    // holds, then growing it by whole rows
+    for (QHash<FaceGroup, GroupFaces>::iterator group = groups.begin(); group != groups.end(); group++) {
+        GroupFaces& faces = group.value();
+        while (!faces.isEmpty()) {
+            GroupFaces::iterator first = faces.begin();
+            quint32 u = (quint32)first.key();
+            quint32 v = (quint32)(first.key() >> 32);
+            quint32 color = first.value();
+            faces.erase(first);
+
+            quint32 width = 1;
+            while (takeFace(faces, u + width, v, color)) {
+                width++;
+            }
+            quint32 height = 1;
+            while (true) {
+                quint32 row = v + height;
+                bool rowMatches = true;
+                for (quint32 i = 0; i < width && rowMatches; i++) {
+                    GroupFaces::const_iterator face = faces.constFind(faceKey(u + i, row));
+                    rowMatches = (face != faces.constEnd() && face.value() == color);
+                }
+                if (!rowMatches) {
+                    break;
+                }
+                for (quint32 i = 0; i < width; i++) {
+                    faces.remove(faceKey(u + i, row));
+                }
+                height++;
+            }
+            appendQuad(vertices, group.key(), u, v, width, height, color);
+        }
+    }
+}
+
+void VoxelChunkMesher::instanceChunk(const ChunkVoxels& voxels, QVector<VoxelInstance>& instances) {
+    int shallowestLevel = shallowestLevelOf(voxels);
+    for (ChunkVoxels::const_iterator voxel = voxels.constBegin(); voxel != voxels.constEnd(); voxel++) {
+        const VoxelCell& cell = voxel.key();
+        bool showing = false;
+        for (int direction = 0; direction < FACE_DIRECTIONS && !showing; direction++) {
+            showing = isFaceShowing(voxels, cell, direction, shallowestLevel);
+        }
+        if (!showing) {
+            continue;
+        }
+        double scale = ldexp(1.0, -cell.level);
+        VoxelInstance instance;
+        instance.position[0] = (GLfloat)(cell.x * scale);
+        instance.position[1] = (GLfloat)(cell.y * scale);
+        instance.position[2] = (GLfloat)(cell.z * scale);
+        instance.color[0] = (voxel.value() >> 16) & 0xff;
+        instance.color[1] = (voxel.value() >> 8) & 0xff;
+        instance.color[2] = voxel.value() & 0xff;
+        instance.level = cell.level;
+        instances.append(instance);
+    }
+}
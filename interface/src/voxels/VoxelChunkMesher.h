@@ -0,0 +1,164 @@
+//
+//  VoxelChunkMesher.h
+//  interface/src/voxels
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#ifndef hifi_VoxelChunkMesher_h
+#define hifi_VoxelChunkMesher_h
+
+#include "InterfaceConfig.h"
+
+#include <QtCore/QByteArray>
+#include <QtCore/QHash>
+#include <QtCore/QMutex>
+#include <QtCore/QSet>
+#include <QtCore/QVector>
+
+#include <AACube.h>
+#include <GenericThread.h>
+#include <ViewFrustum.h>
+
+class ProgramObject;
+class VoxelTreeElement;
+
+/// the level of the subtrees that are meshed together, voxels shallower than this share the root's chunk
+const int VOXEL_CHUNK_LEVEL = 7;
+
+/// the deepest voxel that fits on the mesher's grid, about 8 microns across
+const int MAX_CHUNK_VOXEL_LEVEL = 31;
+
+/// the most voxel geometry uploaded to the GPU in a frame, the rest waits for the next frames
+const int MAX_VOXEL_UPLOAD_BYTES_PER_FRAME = 4 * 1024 * 1024;
+
+/// A voxel's cell on the grid of its level, where the tree is 2^level cells across.
+class VoxelCell {
+public:
+    quint32 x;
+    quint32 y;
+    quint32 z;
+    int level;
+
+    bool operator==(const VoxelCell& other) const {
+        return x == other.x && y == other.y && z == other.z && level == other.level;
+    }
+};
+
+inline uint qHash(const VoxelCell& cell) {
+    return (cell.x * 73856093u) ^ (cell.y * 19349663u) ^ (cell.z * 83492791u) ^ (uint)cell.level;
+}
+
+/// a chunk's voxels, with their colors packed as 0xRRGGBB
+typedef QHash<VoxelCell, quint32> ChunkVoxels;
+
+/// A vertex of a chunk mesh, in tree units.
+struct ChunkVertex {
+    GLfloat position[3];
+    GLbyte normal[3];
+    GLubyte color[3];
+};
+
+/// A voxel drawn as an instance of the unit cube, in 16 bytes. Voxels are always a power of two smaller than the tree, so
+/// the level gives the size.
+struct VoxelInstance {
+    GLfloat position[3];
+    GLubyte color[3];
+    GLubyte level;
+};
+
+/// Draws voxels by subtree, rather than a cube per voxel. The VoxelSystem adds and removes the voxels it wants drawn,
+/// which marks their subtree's chunk dirty. The mesher's thread rebuilds the dirty chunks, and render() uploads each
+/// rebuilt chunk into its own VBO. A chunk is built either as a mesh, leaving out the faces that touch another voxel of
+/// the chunk and merging the faces of the same size, color and plane into rectangles, or, when instanced, as a list of
+/// the voxels that have a face showing, which are drawn as instances of a unit cube.
+class VoxelChunkMesher : public GenericThread {
+    Q_OBJECT
+public:
+    VoxelChunkMesher(bool instanced = false);
+
+    bool isInstanced() const { return _instanced; }
+
+    /// whether the GL has the instanced arrays the instanced chunks are drawn with, called on the main thread
+    static bool isInstancingSupported();
+
+    /// adds a voxel to its chunk or updates its color, returns true if the voxel wasn't in a chunk
+    bool addVoxel(const VoxelTreeElement* voxel);
+
+    /// returns true if the voxel was in a chunk
+    bool removeVoxel(const VoxelTreeElement* voxel);
+
+    /// empties every chunk
+    void clear();
+
+    /// holds off the mesh thread while a batch of voxels is added and removed, so that it doesn't mesh a chunk part way
+    /// through the batch
+    void beginUpdates() { _chunksMutex.lock(); }
+    void endUpdates() { _chunksMutex.unlock(); }
+
+    /// uploads up to MAX_VOXEL_UPLOAD_BYTES_PER_FRAME of the chunks rebuilt since the last call, then draws the chunks
+    /// that are in view. called on the main thread with the tree's transform applied, which is also given so that the
+    /// chunks can be culled: the tree's corner is at the origin and it's scale meters across.
+    void render(const ViewFrustum& viewFrustum, const glm::vec3& origin = glm::vec3(0.0f, 0.0f, 0.0f),
+        float scale = TREE_SCALE);
+
+    /// deletes the chunks' VBOs, called on the main thread
+    void releaseBuffers();
+
+    int getChunkCount() const { return _buffers.size(); }
+    int getElementCount() const { return _elementCount; } /// the quads or instances in the chunks' VBOs
+    unsigned long getMemoryUsageVBO() const { return _memoryUsageVBO; }
+
+    /// meshes a chunk's voxels into quads
+    static void meshChunk(const ChunkVoxels& voxels, QVector<ChunkVertex>& vertices);
+
+    /// lists the voxels of a chunk that have a face that doesn't touch another voxel of the chunk
+    static void instanceChunk(const ChunkVoxels& voxels, QVector<VoxelInstance>& instances);
+
+protected:
+    /// remeshes the dirty chunks
+    virtual bool process();
+
+private:
+    class ChunkBuffer {
+    public:
+        GLuint vbo;
+        int count; /// vertices or instances
+        AACube bounds; /// in the tree's units, where it's one across
+    };
+
+    void uploadFinishedChunks();
+    void renderMeshes(const ViewFrustum& viewFrustum);
+    void renderInstances(const ViewFrustum& viewFrustum);
+    bool isInView(const ViewFrustum& viewFrustum, const ChunkBuffer& buffer) const;
+
+    bool _instanced;
+
+    // the chunks as they've been updated, guarded by _chunksMutex
+    QMutex _chunksMutex;
+    QHash<quint64, ChunkVoxels> _chunks;
+    QSet<quint64> _dirtyChunks;
+
+    // the vertices or instances made by the mesh thread and not yet uploaded, guarded by _finishedMutex
+    QMutex _finishedMutex;
+    QHash<quint64, QByteArray> _finishedChunks;
+
+    // main thread
+    QHash<quint64, ChunkBuffer> _buffers;
+    int _elementCount;
+    unsigned long _memoryUsageVBO;
+    glm::vec3 _viewOrigin;
+    float _viewScale;
+
+    // shared by the instanced meshers, made the first time one draws
+    static ProgramObject* _instanceProgram;
+    static int _instancePositionLocation;
+    static int _instanceColorLevelLocation;
+    static GLuint _unitCubeVBO;
+    static int _unitCubeVertexCount;
+};
+
+#endif // hifi_VoxelChunkMesher_h
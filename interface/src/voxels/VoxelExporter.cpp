@@ -0,0 +1,127 @@
+//
+//  VoxelExporter.cpp
+//  interface/src/voxels
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+// include this before QGLWidget, which includes an earlier version of OpenGL
+#include "InterfaceConfig.h"
+
+#include <QRunnable>
+#include <QThreadPool>
+#include <QtDebug>
+
+#include <OctalCode.h>
+#include <OctreePacketData.h>
+
+#include "voxels/VoxelExporter.h"
+
+class ExportTask : public QRunnable {
+public:
+    ExportTask(VoxelExporter* exporter, VoxelTree* tree, const QVector<QByteArray>& chunks, const QString& fileName);
+    void run();
+
+private:
+    VoxelExporter* _exporter;
+    VoxelTree* _tree;
+    QVector<QByteArray> _chunks;
+    QString _fileName;
+};
+
+VoxelExporter::VoxelExporter(QWidget* parent) :
+    QObject(parent),
+    _progressDialog(tr("Exporting voxels..."), tr("Cancel"), 0, 100, parent),
+    _task(NULL)
+{
+    _progressDialog.setWindowTitle(tr("Export Voxels"));
+    _progressDialog.setWindowModality(Qt::NonModal);
+    _progressDialog.reset();
+
+    connect(&_voxelTree, SIGNAL(exportProgress(int)), &_progressDialog, SLOT(setValue(int)));
+    connect(&_progressDialog, SIGNAL(canceled()), SLOT(cancel()));
+}
+
+VoxelExporter::~VoxelExporter() {
+    // the task writes from our tree, so it has to be done with it before we go
+    if (_task) {
+        _voxelTree.cancelExport();
+        QThreadPool::globalInstance()->waitForDone();
+    }
+}
+
+bool VoxelExporter::exportVoxels(VoxelTree* tree, const VoxelDetail& sourceVoxel, const QString& fileName) {
+    if (_task) {
+        qDebug() << "An export is already in progress.";
+        return false;
+    }
+
+    // the snapshot is only the encoding; reading it back and writing it out are left to the task
+    QVector<QByteArray> chunks;
+    tree->lockForRead();
+    VoxelTreeElement* selectedNode = tree->getVoxelAt(sourceVoxel.x, sourceVoxel.y, sourceVoxel.z, sourceVoxel.s);
+    if (selectedNode) {
+        int chopLevels = numberOfThreeBitSectionsInCode(selectedNode->getOctalCode());
+        if (!tree->encodeSubtreeToChunks(selectedNode, MAX_OCTREE_PACKET_DATA_SIZE, chunks, chopLevels)) {
+            chunks.clear();
+        }
+    }
+    tree->unlock();
+
+    if (chunks.isEmpty()) {
+        return false;
+    }
+
+    _voxelTree.setExportCanceled(false);
+    _progressDialog.setValue(0);
+    _progressDialog.show();
+
+    _task = new ExportTask(this, &_voxelTree, chunks, fileName);
+    QThreadPool::globalInstance()->start(_task);
+    return true;
+}
+
+void VoxelExporter::cancel() {
+    if (_task) {
+        _voxelTree.cancelExport();
+    }
+}
+
+void VoxelExporter::finish(bool succeeded) {
+    // the task is only finishing up, but it's done with the tree
+    _task = NULL;
+    _voxelTree.eraseAllOctreeElements();
+    _progressDialog.reset();
+
+    qDebug() << (succeeded ? "Export succeeded." : "Export failed or was canceled.");
+    emit exportDone(succeeded);
+}
+
+ExportTask::ExportTask(VoxelExporter* exporter, VoxelTree* tree, const QVector<QByteArray>& chunks,
+        const QString& fileName) :
+    _exporter(exporter),
+    _tree(tree),
+    _chunks(chunks),
+    _fileName(fileName)
+{
+    setAutoDelete(true);
+}
+
+void ExportTask::run() {
+    bool succeeded = false;
+    foreach (const QByteArray& chunk, _chunks) {
+        if (_tree->isExportCanceled()) {
+            break;
+        }
+        ReadBitstreamToTreeParams args(WANT_COLOR, NO_EXISTS_BITS, NULL, 0, SharedNodePointer(), false,
+            _tree->expectedVersion());
+        _tree->readBitstreamToTree(reinterpret_cast<const unsigned char*>(chunk.constData()), chunk.size(), args);
+    }
+    if (!_tree->isExportCanceled()) {
+        succeeded = _tree->writeToSVOFile(_fileName.toLocal8Bit().constData());
+    }
+    QMetaObject::invokeMethod(_exporter, "finish", Q_ARG(bool, succeeded));
+}
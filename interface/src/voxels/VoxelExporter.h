@@ -0,0 +1,53 @@
+//
+//  VoxelExporter.h
+//  interface/src/voxels
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#ifndef hifi_VoxelExporter_h
+#define hifi_VoxelExporter_h
+
+#include <QProgressDialog>
+#include <QVector>
+
+#include <VoxelDetail.h>
+#include <VoxelTree.h>
+
+class ExportTask;
+
+/// Saves voxels to SVO files without holding up the interface. The voxels are encoded under a read lock held only for
+/// as long as that takes, and the snapshot is read back into a tree of the exporter's own and written out on the thread
+/// pool, with a progress dialog that can cancel it. One export runs at a time.
+class VoxelExporter : public QObject {
+    Q_OBJECT
+public:
+    VoxelExporter(QWidget* parent = NULL);
+    ~VoxelExporter();
+
+    bool isExporting() const { return _task != NULL; }
+
+    /// starts exporting the voxel of the tree at the given position and size, rebased to the root; returns false if
+    /// there's no such voxel or an export is already in progress
+    bool exportVoxels(VoxelTree* tree, const VoxelDetail& sourceVoxel, const QString& fileName);
+
+signals:
+    void exportDone(bool succeeded);
+
+public slots:
+    void cancel();
+
+private slots:
+    void finish(bool succeeded);
+
+private:
+    VoxelTree _voxelTree;
+    QProgressDialog _progressDialog;
+
+    ExportTask* _task;
+};
+
+#endif // hifi_VoxelExporter_h
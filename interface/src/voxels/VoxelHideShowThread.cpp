@@ -19,6 +19,7 @@
 
 VoxelHideShowThread::VoxelHideShowThread(VoxelSystem* theSystem) :
     _theSystem(theSystem) {
+    _theSystem->_setupOnHideShowThread = true;
 }
 
 bool VoxelHideShowThread::process() {
@@ -27,9 +28,9 @@ bool VoxelHideShowThread::process() {
     const quint64 FRAME_RATE = 60;
     const quint64 USECS_PER_FRAME = SECS_TO_USECS / FRAME_RATE; // every 60fps
 
-    quint64 start = usecTimestampNow();
+    quint64 start = usecMonotonicNow();
     _theSystem->checkForCulling();
-    quint64 end = usecTimestampNow();
+    quint64 end = usecMonotonicNow();
     quint64 elapsed = end - start;
 
     bool showExtraDebugging = Application::getInstance()->getLogger()->extraDebugging();
@@ -38,10 +39,7 @@ bool VoxelHideShowThread::process() {
     }
 
     if (isStillRunning()) {
-        if (elapsed < USECS_PER_FRAME) {
-            quint64 sleepFor = USECS_PER_FRAME - elapsed;
-            usleep(sleepFor);
-        }
+        waitUntil(start + USECS_PER_FRAME);
     }
     return isStillRunning();  // keep running till they terminate us
 }
@@ -0,0 +1,105 @@
+//
+//  VoxelPaster.cpp
+//  interface/src/voxels
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#include <limits>
+
+#include <QDebug>
+
+#include <OctalCode.h>
+
+#include "VoxelPaster.h"
+
+VoxelPaster::VoxelPaster(VoxelEditPacketSender& sender) :
+    _sender(sender),
+    _tree(NULL),
+    _destinationOctalCode(NULL),
+    _voxelsSent(0)
+{
+}
+
+VoxelPaster::~VoxelPaster() {
+    stop();
+}
+
+void VoxelPaster::start(VoxelTree* tree, const unsigned char* destinationOctalCode) {
+    finish();
+
+    _tree = tree;
+    if (destinationOctalCode) {
+        int codeLength = bytesRequiredForCodeLength(numberOfThreeBitSectionsInCode(destinationOctalCode));
+        _destinationOctalCode = new unsigned char[codeLength];
+        memcpy(_destinationOctalCode, destinationOctalCode, codeLength);
+    }
+    _voxelsSent = 0;
+    _bag.insert(tree->getRoot());
+}
+
+void VoxelPaster::update() {
+    pasteVoxels(MAX_PASTE_VOXELS_PER_FRAME, true);
+}
+
+void VoxelPaster::finish() {
+    pasteVoxels(std::numeric_limits<int>::max(), false);
+}
+
+void VoxelPaster::pasteVoxels(int maxVoxels, bool paced) {
+    if (!_tree) {
+        return;
+    }
+    for (int i = 0; i < maxVoxels && !_bag.isEmpty(); i++) {
+        // the edits go out in packets as they fill, so holding off here keeps the sender's queue short
+        if (paced && _sender.packetsToSendCount() >= MAX_PASTE_PACKETS_WAITING) {
+            return;
+        }
+        VoxelTreeElement* voxel = static_cast<VoxelTreeElement*>(_bag.extract());
+        if (voxel->isLeaf()) {
+            if (voxel->isColored()) {
+                sendVoxel(voxel);
+            }
+            continue;
+        }
+        for (int j = 0; j < NUMBER_OF_CHILDREN; j++) {
+            OctreeElement* child = voxel->getChildAtIndex(j);
+            if (child) {
+                _bag.insert(child);
+            }
+        }
+    }
+    if (_bag.isEmpty()) {
+        _sender.releaseQueuedMessages();
+        qDebug() << "Pasted" << _voxelsSent << "voxels.";
+        stop();
+    }
+}
+
+void VoxelPaster::sendVoxel(VoxelTreeElement* voxel) {
+    const unsigned char* octalCode = voxel->getOctalCode();
+    unsigned char* codeColorBuffer;
+    int bytesInCode;
+    if (_destinationOctalCode) {
+        codeColorBuffer = rebaseOctalCode(octalCode, _destinationOctalCode, true);
+        bytesInCode = bytesRequiredForCodeLength(numberOfThreeBitSectionsInCode(codeColorBuffer));
+    } else {
+        bytesInCode = bytesRequiredForCodeLength(numberOfThreeBitSectionsInCode(octalCode));
+        codeColorBuffer = new unsigned char[bytesInCode + SIZE_OF_COLOR_DATA];
+        memcpy(codeColorBuffer, octalCode, bytesInCode);
+    }
+    memcpy(codeColorBuffer + bytesInCode, voxel->getColor(), SIZE_OF_COLOR_DATA);
+    _sender.queueVoxelEditMessage(PacketTypeVoxelSetDestructive, codeColorBuffer, bytesInCode + SIZE_OF_COLOR_DATA);
+    delete[] codeColorBuffer;
+    _voxelsSent++;
+}
+
+void VoxelPaster::stop() {
+    _bag.deleteAll();
+    delete[] _destinationOctalCode;
+    _destinationOctalCode = NULL;
+    _tree = NULL;
+}
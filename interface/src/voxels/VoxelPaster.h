@@ -0,0 +1,58 @@
+//
+//  VoxelPaster.h
+//  interface/src/voxels
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#ifndef hifi_VoxelPaster_h
+#define hifi_VoxelPaster_h
+
+#include <OctreeElementBag.h>
+#include <VoxelEditPacketSender.h>
+#include <VoxelTree.h>
+
+/// the most edit packets left waiting in the sender before the paster holds off queueing more
+const int MAX_PASTE_PACKETS_WAITING = 20;
+
+/// the most voxels the paster visits in a frame, so that walking a big clipboard doesn't stall the frame
+const int MAX_PASTE_VOXELS_PER_FRAME = 20000;
+
+/// Sends the voxels of a tree to the voxel servers a frame at a time, rebased to a destination. Only the colored leaves
+/// are sent, since the servers average the voxels above them, and the paster stops queueing edits for the frame once
+/// the sender has MAX_PASTE_PACKETS_WAITING packets it hasn't sent, so that a big paste neither freezes the interface
+/// nor floods the servers. The tree mustn't change while it's being pasted, but the voxels deleted from it are dropped.
+class VoxelPaster {
+public:
+    VoxelPaster(VoxelEditPacketSender& sender);
+    ~VoxelPaster();
+
+    /// starts pasting a tree, finishing the paste that's in progress first
+    void start(VoxelTree* tree, const unsigned char* destinationOctalCode);
+
+    /// queues the next voxels' edits, as many as the sender has room for
+    void update();
+
+    /// queues the edits of the voxels left, regardless of the sender
+    void finish();
+
+    bool isPasting() const { return _tree != NULL; }
+    VoxelTree* getTree() const { return _tree; }
+    int getVoxelsSent() const { return _voxelsSent; }
+
+private:
+    void pasteVoxels(int maxVoxels, bool paced);
+    void sendVoxel(VoxelTreeElement* voxel);
+    void stop();
+
+    VoxelEditPacketSender& _sender;
+    VoxelTree* _tree;
+    unsigned char* _destinationOctalCode;
+    OctreeElementBag _bag;
+    int _voxelsSent;
+};
+
+#endif // hifi_VoxelPaster_h
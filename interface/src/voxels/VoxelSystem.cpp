@@ -15,6 +15,8 @@
 #include <iostream> // to load voxels from file
 #include <fstream> // to load voxels from file
 
+#include <QMutexLocker>
+
 #include <OctalCode.h>
 #include <PacketHeaders.h>
 #include <PerfStat.h>
@@ -30,6 +32,9 @@
 
 const bool VoxelSystem::DONT_BAIL_EARLY = false;
 
+// the buffer index of a voxel that's in a chunk mesh, which only needs to say that the voxel is drawn
+const glBufferIndex CHUNKED_BUFFER_INDEX = 0;
+
 float identityVerticesGlobalNormals[] = { 0,0,0, 1,0,0, 1,1,0, 0,1,0, 0,0,1, 1,0,1, 1,1,1, 0,1,1 };
 
 float identityVertices[] = { 0,0,0, 1,0,0, 1,1,0, 0,1,0, 0,0,1, 1,0,1, 1,1,1, 0,1,1, //0-7
@@ -67,7 +72,10 @@ VoxelSystem::VoxelSystem(float treeScale, int maxVoxels, VoxelTree* tree)
     _inOcclusions(false),
     _showCulledSharedFaces(false),
     _usePrimitiveRenderer(false),
-    _renderer(0) 
+    _renderer(0),
+    _useChunkedMeshes(true),
+    _useInstancedVoxels(false),
+    _chunkMesher(NULL)
 {
 
     _voxelsInReadArrays = _voxelsInWriteArrays = _voxelsUpdated = 0;
@@ -76,6 +84,9 @@ VoxelSystem::VoxelSystem(float treeScale, int maxVoxels, VoxelTree* tree)
     _tree = (tree) ? tree : new VoxelTree();
 
     _tree->getRoot()->setVoxelSystem(this);
+    
+    // the picking and collision queries run every frame, while the tree mostly sits unchanged
+    _tree->setWantLinearizedReads(true);
 
     VoxelTreeElement::addDeleteHook(this);
     VoxelTreeElement::addUpdateHook(this);
@@ -104,16 +115,20 @@ VoxelSystem::VoxelSystem(float treeScale, int maxVoxels, VoxelTree* tree)
     _useFastVoxelPipeline = false;
 
     _culledOnce = false;
+    _lastCulledTime = 0;
     _inhideOutOfView = false;
 
     _lastKnownVoxelSizeScale = DEFAULT_OCTREE_SIZE_SCALE;
     _lastKnownBoundaryLevelAdjust = 0;
+
+    _setupOnHideShowThread = false;
+    _setupNewVoxelsForDrawingQueued = false;
 }
 
 void VoxelSystem::elementDeleted(OctreeElement* element) {
     VoxelTreeElement* voxel = (VoxelTreeElement*)element;
     if (voxel->getVoxelSystem() == this) {
-        if ((_voxelsInWriteArrays != 0) || _usePrimitiveRenderer) {
+        if ((_voxelsInWriteArrays != 0) || _usePrimitiveRenderer || _chunkMesher) {
             forceRemoveNodeFromArrays(voxel);
         } else {
             if (Menu::getInstance()->isOptionChecked(MenuOption::PipelineWarnings)) {
@@ -125,7 +140,7 @@ void VoxelSystem::elementDeleted(OctreeElement* element) {
 
 void VoxelSystem::setDisableFastVoxelPipeline(bool disableFastVoxelPipeline) {
     _useFastVoxelPipeline = !disableFastVoxelPipeline;
-    setupNewVoxelsForDrawing();
+    queueSetupNewVoxelsForDrawing();
 }
 
 void VoxelSystem::elementUpdated(OctreeElement* element) {
@@ -144,6 +159,9 @@ void VoxelSystem::elementUpdated(OctreeElement* element) {
         shouldRender = voxel->calculateShouldRender(_viewFrustum, voxelSizeScale, boundaryLevelAdjust);
 
         if (voxel->getShouldRender() != shouldRender) {
+            if (!shouldRender && voxel->isKnownBufferIndex()) {
+                fadeOutLevel(voxel);
+            }
             voxel->setShouldRender(shouldRender);
         }
 
@@ -288,6 +306,48 @@ void VoxelSystem::setUseVoxelShader(bool useVoxelShader) {
     }
 }
 
+// This is called by the main application thread on initialization and when the chunked voxel meshes menu item is chosen
+void VoxelSystem::setUseChunkedMeshes(bool useChunkedMeshes) {
+    if (_useChunkedMeshes == useChunkedMeshes) {
+        return;
+    }
+
+    bool wasInitialized = _initialized;
+    if (wasInitialized) {
+        clearAllNodesBufferIndex();
+        cleanupVoxelMemory();
+    }
+    _useChunkedMeshes = useChunkedMeshes;
+    if (wasInitialized) {
+        initVoxelMemory();
+    }
+
+    if (wasInitialized) {
+        forceRedrawEntireTree();
+    }
+}
+
+// This is called by the main application thread on initialization and when the instanced voxels menu item is chosen
+void VoxelSystem::setUseInstancedVoxels(bool useInstancedVoxels) {
+    if (_useInstancedVoxels == useInstancedVoxels) {
+        return;
+    }
+
+    bool wasInitialized = _initialized;
+    if (wasInitialized) {
+        clearAllNodesBufferIndex();
+        cleanupVoxelMemory();
+    }
+    _useInstancedVoxels = useInstancedVoxels;
+    if (wasInitialized) {
+        initVoxelMemory();
+    }
+
+    if (wasInitialized) {
+        forceRedrawEntireTree();
+    }
+}
+
 void VoxelSystem::setVoxelsAsPoints(bool voxelsAsPoints) {
     if (_voxelsAsPoints == voxelsAsPoints) {
         return;
@@ -343,6 +403,12 @@ void VoxelSystem::cleanupVoxelMemory() {
 
             _writeVoxelShaderData = _readVoxelShaderData = NULL;
 
+        } else if (_chunkMesher) {
+            _chunkMesher->terminate();
+            _chunkMesher->releaseBuffers();
+            delete _chunkMesher;
+            _chunkMesher = NULL;
+
         } else {
             // Destroy  glBuffers
             glDeleteBuffers(1, &_vboVerticesID);
@@ -454,6 +520,14 @@ void VoxelSystem::initVoxelMemory() {
 
         _readVoxelShaderData = new VoxelShaderVBOData[_maxVoxels];
         _memoryUsageRAM += (sizeof(VoxelShaderVBOData) * _maxVoxels);
+    } else if (_useChunkedMeshes || _useInstancedVoxels) {
+        // the chunks make their own VBOs as their meshes or instances are made
+        bool instanced = _useInstancedVoxels && VoxelChunkMesher::isInstancingSupported();
+        if (_useInstancedVoxels && !instanced) {
+            qDebug("Instanced arrays aren't supported, drawing voxels as chunked meshes instead.");
+        }
+        _chunkMesher = new VoxelChunkMesher(instanced);
+        _chunkMesher->initialize();
     } else {
 
         // Global Normals mode uses a technique of not including normals on any voxel vertices, and instead
@@ -497,30 +571,30 @@ void VoxelSystem::initVoxelMemory() {
         _memoryUsageRAM += (sizeof(GLubyte) * vertexPointsPerVoxel * _maxVoxels);
         _readColorsArray = new GLubyte[vertexPointsPerVoxel * _maxVoxels];
         _memoryUsageRAM += (sizeof(GLubyte) * vertexPointsPerVoxel * _maxVoxels);
+    }
 
-        // create our simple fragment shader if we're the first system to init
-        if (!_shadowMapProgram.isLinked()) {
-            _shadowMapProgram.addShaderFromSourceFile(QGLShader::Vertex,
-                Application::resourcesPath() + "shaders/shadow_map.vert");
-            _shadowMapProgram.addShaderFromSourceFile(QGLShader::Fragment,
-                Application::resourcesPath() + "shaders/shadow_map.frag");
-            _shadowMapProgram.link();
+    // create our simple fragment shader if we're the first system to init
+    if (!_useVoxelShader && !_shadowMapProgram.isLinked()) {
+        _shadowMapProgram.addShaderFromSourceFile(QGLShader::Vertex,
+            Application::resourcesPath() + "shaders/shadow_map.vert");
+        _shadowMapProgram.addShaderFromSourceFile(QGLShader::Fragment,
+            Application::resourcesPath() + "shaders/shadow_map.frag");
+        _shadowMapProgram.link();
 
-            _shadowMapProgram.bind();
-            _shadowMapProgram.setUniformValue("shadowMap", 0);
-            _shadowMapProgram.release();
-            
-            _cascadedShadowMapProgram.addShaderFromSourceFile(QGLShader::Vertex,
-                Application::resourcesPath() + "shaders/cascaded_shadow_map.vert");
-            _cascadedShadowMapProgram.addShaderFromSourceFile(QGLShader::Fragment,
-                Application::resourcesPath() + "shaders/cascaded_shadow_map.frag");
-            _cascadedShadowMapProgram.link();
+        _shadowMapProgram.bind();
+        _shadowMapProgram.setUniformValue("shadowMap", 0);
+        _shadowMapProgram.release();
+        
+        _cascadedShadowMapProgram.addShaderFromSourceFile(QGLShader::Vertex,
+            Application::resourcesPath() + "shaders/cascaded_shadow_map.vert");
+        _cascadedShadowMapProgram.addShaderFromSourceFile(QGLShader::Fragment,
+            Application::resourcesPath() + "shaders/cascaded_shadow_map.frag");
+        _cascadedShadowMapProgram.link();
 
-            _cascadedShadowMapProgram.bind();
-            _cascadedShadowMapProgram.setUniformValue("shadowMap", 0);
-            _shadowDistancesLocation = _cascadedShadowMapProgram.uniformLocation("shadowDistances");
-            _cascadedShadowMapProgram.release();
-        }
+        _cascadedShadowMapProgram.bind();
+        _cascadedShadowMapProgram.setUniformValue("shadowMap", 0);
+        _shadowDistancesLocation = _cascadedShadowMapProgram.uniformLocation("shadowDistances");
+        _cascadedShadowMapProgram.release();
     }
     _renderer = new PrimitiveRenderer(_maxVoxels);
 
@@ -639,15 +713,24 @@ void VoxelSystem::setupNewVoxelsForDrawing() {
         PerformanceWarning warn(Menu::getInstance()->isOptionChecked(MenuOption::PipelineWarnings), buffer);
         _callsToTreesToArrays++;
 
+        if (_chunkMesher) {
+            _chunkMesher->beginUpdates();
+        }
         if (_writeRenderFullVBO) {
             if (_usePrimitiveRenderer) {
                 _renderer->release();
                 clearAllNodesBufferIndex();
             }
+            if (_chunkMesher) {
+                _chunkMesher->clear();
+            }
             clearFreeBufferIndexes();
         }
         _voxelsUpdated = newTreeToArrays(_tree->getRoot());
         _tree->clearDirtyBit(); // after we pull the trees into the array, we can consider the tree clean
+        if (_chunkMesher) {
+            _chunkMesher->endUpdates();
+        }
 
         if (_writeRenderFullVBO) {
             _abandonedVBOSlots = 0; // reset the count of our abandoned slots, why is this here and not earlier????
@@ -658,7 +741,7 @@ void VoxelSystem::setupNewVoxelsForDrawing() {
         _voxelsUpdated = 0;
     }
 
-    if (_usePrimitiveRenderer) {
+    if (_usePrimitiveRenderer || _chunkMesher) {
         if (_voxelsUpdated) {
             _voxelsDirty=true;
         }
@@ -689,6 +772,14 @@ void VoxelSystem::setupNewVoxelsForDrawing() {
     }
 }
 
+void VoxelSystem::queueSetupNewVoxelsForDrawing() {
+    if (_setupOnHideShowThread) {
+        _setupNewVoxelsForDrawingQueued = true;
+    } else {
+        setupNewVoxelsForDrawing();
+    }
+}
+
 void VoxelSystem::setupNewVoxelsForDrawingSingleNode(bool allowBailEarly) {
     PerformanceWarning warn(Menu::getInstance()->isOptionChecked(MenuOption::PipelineWarnings),
                             "setupNewVoxelsForDrawingSingleNode() xxxxx");
@@ -702,7 +793,7 @@ void VoxelSystem::setupNewVoxelsForDrawingSingleNode(bool allowBailEarly) {
         return; // bail early, it hasn't been long enough since the last time we ran
     }
 
-    if (_usePrimitiveRenderer) {
+    if (_usePrimitiveRenderer || _chunkMesher) {
         _voxelsDirty = true; // if we got this far, then we can assume some voxels are dirty
         _voxelsUpdated = 0;
     } else {
@@ -763,6 +854,9 @@ bool VoxelSystem::recreateVoxelGeometryInViewOperation(OctreeElement* element, v
 
     bool shouldRender = voxel->calculateShouldRender(&args->thisViewFrustum, args->voxelSizeScale, args->boundaryLevelAdjust);
     bool inView = voxel->isInView(args->thisViewFrustum);
+    if (inView && !shouldRender && voxel->getShouldRender()) {
+        args->thisVoxelSystem->fadeOutLevel(voxel);
+    }
     voxel->setShouldRender(inView && shouldRender);
     if (shouldRender && inView) {
         // recreate the geometry
@@ -780,16 +874,26 @@ void VoxelSystem::recreateVoxelGeometryInView() {
     qDebug() << "recreateVoxelGeometryInView()...";
 
     recreateVoxelGeometryInViewArgs args(this);
+    _culledOnce = false; // the geometry is redone without the hide/show pass, so its records are out of date
     _writeArraysLock.lockForWrite(); // don't let anyone read or write our write arrays until we're done
     _tree->lockForRead(); // don't let anyone change our tree structure until we're run
     
     // reset our write arrays bookkeeping to think we've got no voxels in it
     clearFreeBufferIndexes();
 
-    // do we need to reset out _writeVoxelDirtyArray arrays??
-    memset(_writeVoxelDirtyArray, false, _maxVoxels * sizeof(bool));
+    if (_chunkMesher) {
+        _chunkMesher->beginUpdates();
+        _chunkMesher->clear();
+    } else {
+        // do we need to reset out _writeVoxelDirtyArray arrays??
+        memset(_writeVoxelDirtyArray, false, _maxVoxels * sizeof(bool));
+    }
     
-    _tree->recurseTreeWithOperation(recreateVoxelGeometryInViewOperation,(void*)&args);
+    OctreeOperationVisitor<recreateVoxelGeometryInViewOperation> visitor(&args);
+    _tree->visitTree<VoxelTreeElement>(visitor);
+    if (_chunkMesher) {
+        _chunkMesher->endUpdates();
+    }
     _tree->unlock();
     _writeArraysLock.unlock();
 }
@@ -798,6 +902,14 @@ void VoxelSystem::checkForCulling() {
     PerformanceWarning warn(Menu::getInstance()->isOptionChecked(MenuOption::PipelineWarnings), "checkForCulling()");
     quint64 start = usecTimestampNow();
 
+    if (_setupNewVoxelsForDrawingQueued) {
+        _setupNewVoxelsForDrawingQueued = false;
+
+        // it was asked for by the main thread, so it shouldn't bail early because the packet thread just ran it
+        _setupNewVoxelsForDrawingLastFinished = 0;
+        setupNewVoxelsForDrawing();
+    }
+
     // track how long its been since we were last moving. If we have recently moved then only use delta frustums, if
     // it's been a long time since we last moved, then go ahead and do a full frustum cull.
     if (isViewChanging()) {
@@ -863,7 +975,7 @@ void VoxelSystem::cleanupRemovedVoxels() {
     // we also might have VBO slots that have been abandoned, if too many of our VBO slots
     // are abandonded we want to rerender our full VBOs
     const float TOO_MANY_ABANDONED_RATIO = 0.5f;
-    if (!_usePrimitiveRenderer && !_writeRenderFullVBO && 
+    if (!_usePrimitiveRenderer && !_chunkMesher && !_writeRenderFullVBO && 
         (_abandonedVBOSlots > (_voxelsInWriteArrays * TOO_MANY_ABANDONED_RATIO))) {
         if (Menu::getInstance()->isOptionChecked(MenuOption::PipelineWarnings)) {
             qDebug() << "cleanupRemovedVoxels().. _abandonedVBOSlots ["
@@ -985,6 +1097,9 @@ int VoxelSystem::newTreeToArrays(VoxelTreeElement* voxel) {
     int boundaryLevelAdjust = Menu::getInstance()->getBoundaryLevelAdjust();
     shouldRender = voxel->calculateShouldRender(_viewFrustum, voxelSizeScale, boundaryLevelAdjust);
 
+    if (!shouldRender && voxel->getShouldRender() && voxel->isKnownBufferIndex()) {
+        fadeOutLevel(voxel);
+    }
     voxel->setShouldRender(shouldRender);
     // let children figure out their renderness
     if (!voxel->isLeaf()) {
@@ -1041,6 +1156,14 @@ int VoxelSystem::forceRemoveNodeFromArrays(VoxelTreeElement* node) {
             node->setBufferIndex(GLBUFFER_INDEX_UNKNOWN);
             return 1;
         }
+    } else if (_chunkMesher) {
+        if (node->isKnownBufferIndex()) {
+            node->setBufferIndex(GLBUFFER_INDEX_UNKNOWN);
+            if (_chunkMesher->removeVoxel(node)) {
+                _voxelsInWriteArrays--;
+            }
+            return 1;
+        }
     } else {
         // if the node is not in the VBOs then we have nothing to do!
         if (node->isKnownBufferIndex()) {
@@ -1105,6 +1228,13 @@ int VoxelSystem::updateNodeInArrays(VoxelTreeElement* node, bool reuseIndex, boo
                         node->setBufferIndex(primitiveIndex);
                     }
                 }
+            } else if (_chunkMesher) {
+                // the chunk is remeshed on the mesher's thread, so all we do here is hand it the voxel
+                if (_chunkMesher->addVoxel(node)) {
+                    _voxelsInWriteArrays++;
+                }
+                node->setBufferIndex(CHUNKED_BUFFER_INDEX);
+                node->setVoxelSystem(this);
             } else {
                 glBufferIndex nodeIndex = GLBUFFER_INDEX_UNKNOWN;
                 if (reuseIndex && node->isKnownBufferIndex()) {
@@ -1200,58 +1330,55 @@ void VoxelSystem::changeTree(VoxelTree* newTree) {
 
     _tree->setDirtyBit();
     _tree->getRoot()->setVoxelSystem(this);
+    _tree->setWantLinearizedReads(true);
 
-    setupNewVoxelsForDrawing();
+    queueSetupNewVoxelsForDrawing();
 }
 
 void VoxelSystem::updateFullVBOs() {
-    bool outputWarning = Menu::getInstance()->isOptionChecked(MenuOption::PipelineWarnings);
-    PerformanceWarning warn(outputWarning, "updateFullVBOs()");
+    PerformanceWarning warn(Menu::getInstance()->isOptionChecked(MenuOption::PipelineWarnings), "updateFullVBOs()");
 
-    {
-        static char buffer[128] = { 0 };
-        if (outputWarning) {
-            sprintf(buffer, "updateFullVBOs() : updateVBOSegment(0, _voxelsInReadArrays=%lu);", _voxelsInReadArrays);
-        };
-
-        PerformanceWarning warn(outputWarning,buffer);
-        updateVBOSegment(0, _voxelsInReadArrays);
-    }
-
-    {
-        PerformanceWarning warn(outputWarning,"updateFullVBOs() : memset(_readVoxelDirtyArray...)");
-        // consider the _readVoxelDirtyArray[] clean!
-        memset(_readVoxelDirtyArray, false, _voxelsInReadArrays * sizeof(bool));
-    }
+    // every voxel in the read arrays needs uploading, which updatePartialVBOs() spreads over as many frames as it takes
+    memset(_readVoxelDirtyArray, true, _voxelsInReadArrays * sizeof(bool));
 }
 
-void VoxelSystem::updatePartialVBOs() {
+bool VoxelSystem::updatePartialVBOs() {
+    int bytesPerVoxel = _useVoxelShader ? sizeof(VoxelShaderVBOData) :
+        GLOBAL_NORMALS_VERTEX_POINTS_PER_VOXEL * (sizeof(GLfloat) + sizeof(GLubyte));
+    glBufferIndex uploadBudget = std::max(1, MAX_VOXEL_UPLOAD_BYTES_PER_FRAME / bytesPerVoxel);
+    glBufferIndex uploaded = 0;
+
     glBufferIndex segmentStart = 0;
     bool inSegment = false;
     for (glBufferIndex i = 0; i < _voxelsInReadArrays; i++) {
-        bool thisVoxelDirty = _readVoxelDirtyArray[i];
-        if (!inSegment) {
-            if (thisVoxelDirty) {
+        if (_readVoxelDirtyArray[i]) {
+            if (uploaded == uploadBudget) {
+                // we've uploaded a frame's worth, the rest stay dirty for the next frame
+                if (inSegment) {
+                    updateVBOSegment(segmentStart, i - 1);
+                }
+                return false;
+            }
+            if (!inSegment) {
                 segmentStart = i;
                 inSegment = true;
-                _readVoxelDirtyArray[i] = false; // consider us clean!
-            }
-        } else {
-            if (!thisVoxelDirty) {
-                // If we got here because because this voxel is NOT dirty, so the last dirty voxel was the one before
-                // this one and so that's where the "segment" ends
-                updateVBOSegment(segmentStart, i - 1);
-                inSegment = false;
             }
             _readVoxelDirtyArray[i] = false; // consider us clean!
+            uploaded++;
+
+        } else if (inSegment) {
+            // If we got here because because this voxel is NOT dirty, so the last dirty voxel was the one before
+            // this one and so that's where the "segment" ends
+            updateVBOSegment(segmentStart, i - 1);
+            inSegment = false;
         }
     }
 
     // if we got to the end of the array, and we're in an active dirty segment...
     if (inSegment) {
         updateVBOSegment(segmentStart, _voxelsInReadArrays - 1);
-        inSegment = false;
     }
+    return true;
 }
 
 void VoxelSystem::updateVBOs() {
@@ -1261,23 +1388,18 @@ void VoxelSystem::updateVBOs() {
     };
     // would like to include _callsToTreesToArrays
     PerformanceWarning warn(Menu::getInstance()->isOptionChecked(MenuOption::PipelineWarnings), buffer);
-    if (! _usePrimitiveRenderer) {
+    if (!_usePrimitiveRenderer && !_chunkMesher) {
         if (_voxelsDirty) {
     
-            // attempt to lock the read arrays, to for copying from them to the actual GPU VBOs.
-            // if we fail to get the lock, that's ok, our VBOs will update on the next frame...
-            const int WAIT_FOR_LOCK_IN_MS = 5;
-            if (_readArraysLock.tryLockForRead(WAIT_FOR_LOCK_IN_MS)) {
+            // attempt to lock the read arrays, to for copying from them to the actual GPU VBOs. the render thread doesn't
+            // wait for the lock, if the packet thread is copying into the read arrays our VBOs will update on the next frame
+            if (_readArraysLock.tryLockForRead()) {
                 if (_readRenderFullVBO) {
                     updateFullVBOs();
-                } else {
-                    updatePartialVBOs();
+                    _readRenderFullVBO = false;
                 }
-                _voxelsDirty = false;
-                _readRenderFullVBO = false;
+                _voxelsDirty = !updatePartialVBOs();
                 _readArraysLock.unlock();
-            } else {
-                qDebug() << "updateVBOs().... couldn't get _readArraysLock.tryLockForRead()";
             }
         }
     }
@@ -1405,6 +1527,23 @@ void VoxelSystem::render() {
             glDisableVertexAttribArray(attributeLocation);
             glDisable(GL_VERTEX_PROGRAM_POINT_SIZE);
         }
+    } else if (_chunkMesher) {
+        PerformanceWarning warn(showWarnings, "render().. chunks...");
+
+        // instances are lit by their own program, which doesn't do shadows or textures
+        if (_chunkMesher->isInstanced()) {
+            glPushMatrix();
+            glScalef(_treeScale, _treeScale, _treeScale);
+            _chunkMesher->render(*_viewFrustum);
+            glPopMatrix();
+        } else {
+            applyScaleAndBindProgram(texture);
+            _chunkMesher->render(*_viewFrustum);
+            removeScaleAndReleaseProgram(texture);
+        }
+
+        _voxelsInReadArrays = _voxelsInWriteArrays;
+        _memoryUsageVBO = _chunkMesher->getMemoryUsageVBO();
     } else 
     if (!_usePrimitiveRenderer) {
         PerformanceWarning warn(showWarnings, "render().. TRIANGLES...");
@@ -1525,6 +1664,37 @@ void VoxelSystem::removeScaleAndReleaseProgram(bool texture) {
     }
 }
 
+// the most voxels fading out at once, past which a level change just pops
+const int MAX_LEVEL_FADES = 128;
+
+void VoxelSystem::fadeOutLevel(VoxelTreeElement* voxel) {
+    QMutexLocker locker(&_levelFadesLock);
+    if (_levelFades.size() >= MAX_LEVEL_FADES) {
+        return;
+    }
+    const nodeColor& color = voxel->getColor();
+    VoxelFade fade(VoxelFade::FADE_OUT, color[RED_INDEX] / 255.0f, color[GREEN_INDEX] / 255.0f,
+        color[BLUE_INDEX] / 255.0f);
+    const AACube& cube = voxel->getAACube();
+    fade.voxelDetails.x = cube.getCorner().x;
+    fade.voxelDetails.y = cube.getCorner().y;
+    fade.voxelDetails.z = cube.getCorner().z;
+    fade.voxelDetails.s = cube.getScale();
+    _levelFades.push_back(fade);
+}
+
+void VoxelSystem::renderLevelFades() {
+    QMutexLocker locker(&_levelFadesLock);
+    for (std::vector<VoxelFade>::iterator fade = _levelFades.begin(); fade != _levelFades.end();) {
+        fade->render();
+        if (fade->isDone()) {
+            fade = _levelFades.erase(fade);
+        } else {
+            ++fade;
+        }
+    }
+}
+
 int VoxelSystem::_nodeCount = 0;
 
 void VoxelSystem::killLocalVoxels() {
@@ -1542,8 +1712,11 @@ void VoxelSystem::killLocalVoxels() {
         }
         clearAllNodesBufferIndex();
     }
+    if (_chunkMesher) {
+        _chunkMesher->clear();
+    }
     _voxelsInReadArrays = 0; // do we need to do this?
-    setupNewVoxelsForDrawing();
+    queueSetupNewVoxelsForDrawing();
 }
 
 // only called on main thread
@@ -1561,8 +1734,10 @@ void VoxelSystem::clearAllNodesBufferIndex() {
                             "VoxelSystem::clearAllNodesBufferIndex()");
     _nodeCount = 0;
     _tree->lockForRead(); // we won't change the tree so it's ok to treat this as a read
-    _tree->recurseTreeWithOperation(clearAllNodesBufferIndexOperation);
+    OctreeOperationVisitor<clearAllNodesBufferIndexOperation> visitor;
+    _tree->visitTree<VoxelTreeElement>(visitor);
     clearFreeBufferIndexes(); // this should be called too
+    _culledOnce = false;
     _tree->unlock();
     if (Menu::getInstance()->isOptionChecked(MenuOption::PipelineWarnings)) {
         qDebug("clearing buffer index of %d nodes", _nodeCount);
@@ -1730,9 +1905,11 @@ void VoxelSystem::inspectForOcclusions() {
     PerformanceWarning warn(showDebugDetails, "inspectForOcclusions()");
 
     _tree->lockForRead();
-    _tree->recurseTreeWithPostOperation(inspectForExteriorOcclusionsOperation);
+    OctreeOperationVisitor<inspectForExteriorOcclusionsOperation> exteriorVisitor;
+    _tree->visitTreePostOrder<VoxelTreeElement>(exteriorVisitor);
     _nodeCount = 0;
-    _tree->recurseTreeWithOperation(inspectForInteriorOcclusionsOperation);
+    OctreeOperationVisitor<inspectForInteriorOcclusionsOperation> interiorVisitor;
+    _tree->visitTree<VoxelTreeElement>(interiorVisitor);
     _tree->unlock();
 
     if (showDebugDetails) {
@@ -1748,11 +1925,13 @@ bool VoxelSystem::forceRedrawEntireTreeOperation(OctreeElement* element, void* e
 }
 
 void VoxelSystem::forceRedrawEntireTree() {
+    _culledOnce = false; // everything's drawn again, so the hide/show pass needs to look at everything
     _nodeCount = 0;
-    _tree->recurseTreeWithOperation(forceRedrawEntireTreeOperation);
+    OctreeOperationVisitor<forceRedrawEntireTreeOperation> visitor;
+    _tree->visitTree<VoxelTreeElement>(visitor);
     qDebug("forcing redraw of %d nodes", _nodeCount);
     _tree->setDirtyBit();
-    setupNewVoxelsForDrawing();
+    queueSetupNewVoxelsForDrawing();
 }
 
 bool VoxelSystem::isViewChanging() {
@@ -1785,41 +1964,32 @@ bool VoxelSystem::hasViewChanged() {
 // combines the removeOutOfView args into a single class
 class hideOutOfViewArgs {
 public:
-    VoxelSystem* thisVoxelSystem;
-    VoxelTree* tree;
     ViewFrustum thisViewFrustum;
-    ViewFrustum lastViewFrustum;
-    bool culledOnce;
-    bool wantDeltaFrustums;
+    quint64 lastCulledTime;
+    bool recalculateLOD;
+    float voxelSizeScale;
+    int boundaryLevelAdjust;
     unsigned long nodesScanned;
     unsigned long nodesRemoved;
     unsigned long nodesInside;
     unsigned long nodesIntersect;
     unsigned long nodesOutside;
     unsigned long nodesInsideInside;
-    unsigned long nodesIntersectInside;
-    unsigned long nodesOutsideInside;
-    unsigned long nodesInsideOutside;
     unsigned long nodesOutsideOutside;
     unsigned long nodesShown;
 
-    hideOutOfViewArgs(VoxelSystem* voxelSystem, VoxelTree* tree,
-                        bool culledOnce, bool widenViewFrustum, bool wantDeltaFrustums) :
-        thisVoxelSystem(voxelSystem),
-        tree(tree),
+    hideOutOfViewArgs(VoxelSystem* voxelSystem, quint64 lastCulledTime, bool recalculateLOD, bool widenViewFrustum) :
         thisViewFrustum(*voxelSystem->getViewFrustum()),
-        lastViewFrustum(*voxelSystem->getLastCulledViewFrustum()),
-        culledOnce(culledOnce),
-        wantDeltaFrustums(wantDeltaFrustums),
+        lastCulledTime(lastCulledTime),
+        recalculateLOD(recalculateLOD),
+        voxelSizeScale(Menu::getInstance()->getVoxelSizeScale()),
+        boundaryLevelAdjust(Menu::getInstance()->getBoundaryLevelAdjust()),
         nodesScanned(0),
         nodesRemoved(0),
         nodesInside(0),
         nodesIntersect(0),
         nodesOutside(0),
         nodesInsideInside(0),
-        nodesIntersectInside(0),
-        nodesOutsideInside(0),
-        nodesInsideOutside(0),
         nodesOutsideOutside(0),
         nodesShown(0)
     {
@@ -1846,46 +2016,45 @@ void VoxelSystem::hideOutOfView(bool forceFullFrustum) {
     PerformanceWarning warn(showDebugDetails, "hideOutOfView()");
     bool widenFrustum = true;
 
-
-    // When using "delta" view frustums and only hide/show items that are in the difference
-    // between the two view frustums. There are some potential problems with this mode.
-    //
-    // 1) This work well for rotating, but what about moving forward?
-    //    In the move forward case, you'll get new voxel details, but those
-    //    new voxels will be in the last view.
-    //
-    // 2) Also, voxels will arrive from the network that are OUTSIDE of the view
-    //    frustum... these won't get hidden... and so we can't assume they are correctly
-    //    hidden...
-    //
-    // Both these problems are solved by intermittently calling this with forceFullFrustum set
-    // to true. This will essentially clean up the improperly hidden or shown voxels.
-    //
-    bool wantDeltaFrustums = !forceFullFrustum;
-    hideOutOfViewArgs args(this, this->_tree, _culledOnce, widenFrustum, wantDeltaFrustums);
+    // Each element remembers where it was in the view at the last pass, so a pass only visits the elements that have
+    // crossed the edge of the view since, the ones that straddle it, and the subtrees that have changed since, which
+    // covers the voxels that have arrived from the network outside the view. Level of detail only changes inside the
+    // view as we move, which the intermittent forceFullFrustum pass catches up with once we've stopped, when we've moved
+    // since the last one.
+    bool recalculateLOD = forceFullFrustum && (!_culledOnce || _viewFrustum->getPosition() != _lastLODCulledPosition);
+    hideOutOfViewArgs args(this, _lastCulledTime, recalculateLOD, widenFrustum);
 
     const bool wantViewFrustumDebugging = false; // change to true for additional debugging
     if (wantViewFrustumDebugging) {
         args.thisViewFrustum.printDebugDetails();
         if (_culledOnce) {
-            args.lastViewFrustum.printDebugDetails();
+            _lastCulledViewFrustum.printDebugDetails();
         }
     }
 
-    if (!forceFullFrustum && _culledOnce && args.lastViewFrustum.isVerySimilar(args.thisViewFrustum)) {
+    if (!forceFullFrustum && _culledOnce && _lastCulledViewFrustum.isVerySimilar(args.thisViewFrustum)) {
         _inhideOutOfView = false;
         return;
     }
 
     {
         PerformanceWarning warn(Menu::getInstance()->isOptionChecked(MenuOption::PipelineWarnings), 
-                            "VoxelSystem::... recurseTreeWithOperation(hideOutOfViewOperation)");
+                            "VoxelSystem::... hideOutOfViewElement()");
         _tree->lockForRead();
-        _tree->recurseTreeWithOperation(hideOutOfViewOperation,(void*)&args);
+
+        // until we've culled once, no element's record of where it was can be trusted
+        hideOutOfViewElement(_tree->getRoot(), _culledOnce ? ViewFrustum::INTERSECT : VoxelTreeElement::NOT_CULLED,
+            ViewFrustum::INTERSECT, args);
+
+        // the changes we made while showing voxels are already accounted for
+        _lastCulledTime = usecTimestampNow();
         _tree->unlock();
     }
     _lastCulledViewFrustum = args.thisViewFrustum; // save last stable
     _culledOnce = true;
+    if (recalculateLOD) {
+        _lastLODCulledPosition = _viewFrustum->getPosition();
+    }
 
     if (args.nodesRemoved) {
         _tree->setDirtyBit();
@@ -1898,9 +2067,7 @@ void VoxelSystem::hideOutOfView(bool forceFullFrustum) {
                 args.nodesScanned, args.nodesRemoved, args.nodesShown, args.nodesInside,
                 args.nodesIntersect, args.nodesOutside
             );
-        qDebug("inside/inside=%ld intersect/inside=%ld outside/outside=%ld",
-                args.nodesInsideInside, args.nodesIntersectInside, args.nodesOutsideOutside
-            );
+        qDebug("inside/inside=%ld outside/outside=%ld", args.nodesInsideInside, args.nodesOutsideOutside);
 
         qDebug() << "args.thisViewFrustum....";
         args.thisViewFrustum.printDebugDetails();
@@ -1908,162 +2075,70 @@ void VoxelSystem::hideOutOfView(bool forceFullFrustum) {
     _inhideOutOfView = false;
 }
 
-bool VoxelSystem::hideAllSubTreeOperation(OctreeElement* element, void* extraData) {
-    VoxelTreeElement* voxel = (VoxelTreeElement*)element;
-    hideOutOfViewArgs* args = (hideOutOfViewArgs*)extraData;
-    
-    // If we've culled at least once, then we will use the status of this voxel in the last culled frustum to determine
-    // how to proceed. If we've never culled, then we just consider all these voxels to be UNKNOWN so that we will not
-    // consider that case.
-    ViewFrustum::location inLastCulledFrustum;
-
-    if (args->culledOnce && args->wantDeltaFrustums) {
-        inLastCulledFrustum = voxel->inFrustum(args->lastViewFrustum);
-
-        // if this node is fully OUTSIDE our last culled view frustum, then we don't need to recurse further
-        if (inLastCulledFrustum == ViewFrustum::OUTSIDE) {
-            args->nodesOutsideOutside++;
-            return false;
+// "hide" voxels in the VBOs that are still in the tree that but not in view, and show the ones that have come into view.
+// We don't remove them from the tree, we don't delete them, we do remove them from the VBOs and mark them as such in the
+// tree. The parent's locations say where it is in this view and where it was at the last pass. An element of a subtree
+// that's wholly inside or outside a view is wherever its parent is, so only the elements under a parent that straddles
+// the edge need testing against the view, or looking up their own record of the last pass.
+void VoxelSystem::hideOutOfViewElement(VoxelTreeElement* voxel, int parentLastLocation, int parentLocation,
+                                       hideOutOfViewArgs& args) {
+    args.nodesScanned++;
+    int location = (parentLocation == ViewFrustum::INTERSECT) ? voxel->inFrustum(args.thisViewFrustum) : parentLocation;
+    int lastLocation = (parentLastLocation == ViewFrustum::INTERSECT) ? voxel->getCulledLocation() : parentLastLocation;
+
+    // a subtree that was wholly outside and still is has already been hidden, and one that was wholly inside and still
+    // is has already been shown, unless voxels have arrived in it since or it needs its level of detail redone
+    if (location == lastLocation && voxel->getLastChangedInSubtree() <= args.lastCulledTime) {
+        if (location == ViewFrustum::OUTSIDE) {
+            args.nodesOutsideOutside++;
+            return;
+        }
+        if (location == ViewFrustum::INSIDE && !args.recalculateLOD) {
+            args.nodesInsideInside++;
+            return;
         }
     }
+    voxel->setCulledLocation(location);
 
-    args->nodesOutside++;
-    if (voxel->isKnownBufferIndex()) {
-        args->nodesRemoved++;
-        VoxelSystem* thisVoxelSystem = args->thisVoxelSystem;
-        thisVoxelSystem->_voxelsUpdated += thisVoxelSystem->forceRemoveNodeFromArrays(voxel);
-        thisVoxelSystem->setupNewVoxelsForDrawingSingleNode();
-    }
+    if (location == ViewFrustum::OUTSIDE) {
+        args.nodesOutside++;
+        if (voxel->isKnownBufferIndex()) {
+            args.nodesRemoved++;
+            _voxelsUpdated += forceRemoveNodeFromArrays(voxel);
+            setupNewVoxelsForDrawingSingleNode();
+        }
+    } else {
+        if (location == ViewFrustum::INSIDE) {
+            args.nodesInside++;
+        } else {
+            args.nodesIntersect++;
+        }
+        bool shouldRender = voxel->calculateShouldRender(&args.thisViewFrustum, args.voxelSizeScale,
+            args.boundaryLevelAdjust);
+        if (!shouldRender && voxel->getShouldRender() && voxel->isKnownBufferIndex()) {
+            fadeOutLevel(voxel);
+        }
+        voxel->setShouldRender(shouldRender);
 
-    return true;
-}
+        if (shouldRender && !voxel->isKnownBufferIndex()) {
+            // These are both needed to force redraw...
+            voxel->setDirtyBit();
+            voxel->markWithChangedTime();
+            args.nodesShown++;
 
-bool VoxelSystem::showAllSubTreeOperation(OctreeElement* element, void* extraData) {
-    VoxelTreeElement* voxel = (VoxelTreeElement*)element;
-    hideOutOfViewArgs* args = (hideOutOfViewArgs*)extraData;
-    
-    // If we've culled at least once, then we will use the status of this voxel in the last culled frustum to determine
-    // how to proceed. If we've never culled, then we just consider all these voxels to be UNKNOWN so that we will not
-    // consider that case.
-    if (args->culledOnce && args->wantDeltaFrustums) {
-        ViewFrustum::location inLastCulledFrustum = voxel->inFrustum(args->lastViewFrustum);
-
-        // if this node is fully inside our last culled view frustum, then we don't need to recurse further
-        if (inLastCulledFrustum == ViewFrustum::INSIDE) {
-            args->nodesInsideInside++;
-            return false;
+            // an element straddling the edge that's now drawn will block any of its children anyway
+            if (location == ViewFrustum::INTERSECT) {
+                return;
+            }
         }
     }
 
-    args->nodesInside++;
-
-    float voxelSizeScale = Menu::getInstance()->getVoxelSizeScale();
-    int boundaryLevelAdjust = Menu::getInstance()->getBoundaryLevelAdjust();
-    bool shouldRender = voxel->calculateShouldRender(&args->thisViewFrustum, voxelSizeScale, boundaryLevelAdjust);
-    voxel->setShouldRender(shouldRender);
-
-    if (shouldRender && !voxel->isKnownBufferIndex()) {
-        // These are both needed to force redraw...
-        voxel->setDirtyBit();
-        voxel->markWithChangedTime();
-        args->nodesShown++;
+    for (int i = 0; i < NUMBER_OF_CHILDREN; i++) {
+        VoxelTreeElement* child = voxel->getChildAtIndex(i);
+        if (child) {
+            hideOutOfViewElement(child, lastLocation, location, args);
+        }
     }
-
-    return true; // keep recursing!
-}
-
-// "hide" voxels in the VBOs that are still in the tree that but not in view.
-// We don't remove them from the tree, we don't delete them, we do remove them
-// from the VBOs and mark them as such in the tree.
-bool VoxelSystem::hideOutOfViewOperation(OctreeElement* element, void* extraData) {
-    VoxelTreeElement* voxel = (VoxelTreeElement*)element;
-    hideOutOfViewArgs* args = (hideOutOfViewArgs*)extraData;
-    
-    // If we're still recursing the tree using this operator, then we don't know if we're inside or outside...
-    // so before we move forward we need to determine our frustum location
-    ViewFrustum::location inFrustum = voxel->inFrustum(args->thisViewFrustum);
-
-    // If we've culled at least once, then we will use the status of this voxel in the last culled frustum to determine
-    // how to proceed. If we've never culled, then we just consider all these voxels to be UNKNOWN so that we will not
-    // consider that case.
-    ViewFrustum::location inLastCulledFrustum = ViewFrustum::OUTSIDE; // assume outside, but should get reset to actual value
-
-    if (args->culledOnce && args->wantDeltaFrustums) {
-        inLastCulledFrustum = voxel->inFrustum(args->lastViewFrustum);
-    }
-
-    // ok, now do some processing for this node...
-    switch (inFrustum) {
-        case ViewFrustum::OUTSIDE: {
-            // If this node is outside the current view, then we might want to hide it... unless it was previously OUTSIDE,
-            // if it was previously outside, then we can safely assume it's already hidden, and we can also safely assume
-            // that all of it's children are outside both of our views, in which case we can just stop recursing...
-            if (args->culledOnce && args->wantDeltaFrustums && inLastCulledFrustum == ViewFrustum::OUTSIDE) {
-                args->nodesScanned++;
-                args->nodesOutsideOutside++;
-                return false; // stop recursing this branch!
-            }
-
-            // if this node is fully OUTSIDE the view, but previously intersected and/or was inside the last view, then
-            // we need to hide it. Additionally we know that ALL of it's children are also fully OUTSIDE so we can recurse
-            // the children and simply mark them as hidden
-            args->tree->recurseElementWithOperation(voxel, hideAllSubTreeOperation, args );
-            return false;
-
-        } break;
-        case ViewFrustum::INSIDE: {
-            // If this node is INSIDE the current view, then we might want to show it... unless it was previously INSIDE,
-            // if it was previously INSIDE, then we can safely assume it's already shown, and we can also safely assume
-            // that all of it's children are INSIDE both of our views, in which case we can just stop recursing...
-            if (args->culledOnce && args->wantDeltaFrustums && inLastCulledFrustum == ViewFrustum::INSIDE) {
-                args->nodesScanned++;
-                args->nodesInsideInside++;
-                return false; // stop recursing this branch!
-            }
-
-            // if this node is fully INSIDE the view, but previously INTERSECTED and/or was OUTSIDE the last view, then
-            // we need to show it. Additionally we know that ALL of it's children are also fully INSIDE so we can recurse
-            // the children and simply mark them as visible (as appropriate based on LOD)
-            args->tree->recurseElementWithOperation(voxel, showAllSubTreeOperation, args);
-            return false;
-        } break;
-        case ViewFrustum::INTERSECT: {
-            args->nodesScanned++;
-            // If this node INTERSECTS the current view, then we might want to show it... unless it was previously INSIDE
-            // the last known view, in which case it will already be visible, and we know that all it's children are also
-            // previously INSIDE and visible. So in this case stop recursing
-            if (args->culledOnce && args->wantDeltaFrustums && inLastCulledFrustum == ViewFrustum::INSIDE) {
-                args->nodesIntersectInside++;
-                return false; // stop recursing this branch!
-            }
-
-            args->nodesIntersect++;
-
-            // if the child node INTERSECTs the view, then we want to check to see if it thinks it should render
-            // if it should render but is missing it's VBO index, then we want to flip it on, and we can stop recursing from
-            // here because we know will block any children anyway
-            
-            float voxelSizeScale = Menu::getInstance()->getVoxelSizeScale();
-            int boundaryLevelAdjust = Menu::getInstance()->getBoundaryLevelAdjust();
-            bool shouldRender = voxel->calculateShouldRender(&args->thisViewFrustum, voxelSizeScale, boundaryLevelAdjust);
-            voxel->setShouldRender(shouldRender);
-            
-            if (voxel->getShouldRender() && !voxel->isKnownBufferIndex()) {
-                voxel->setDirtyBit(); // will this make it draw?
-                voxel->markWithChangedTime(); // both are needed to force redraw
-                args->nodesShown++;
-                return false;
-            }
-
-            // If it INTERSECTS but shouldn't be displayed, then it's probably a parent and it is at least partially in view.
-            // So we DO want to recurse the children because some of them may not be in view... nothing specifically to do,
-            // just keep iterating the children
-            return true;
-
-        } break;
-    } // switch
-
-    return true; // keep going!
 }
 
 
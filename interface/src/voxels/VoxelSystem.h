@@ -27,8 +27,11 @@
 #include "world.h"
 #include "renderer/VoxelShader.h"
 #include "PrimitiveRenderer.h"
+#include "VoxelChunkMesher.h"
+#include "VoxelFade.h"
 
 class ProgramObject;
+class hideOutOfViewArgs;
 
 const int NUM_CHILDREN = 8;
 
@@ -59,6 +62,9 @@ public:
     virtual void init();
     void render();
 
+    /// draws the voxels that have given way to their parents or children as they fade out, after the other geometry
+    void renderLevelFades();
+
     void changeTree(VoxelTree* newTree);
     VoxelTree* getTree() const { return _tree; }
     ViewFrustum* getViewFrustum() const { return _viewFrustum; }
@@ -98,6 +104,8 @@ public slots:
  
     void setDisableFastVoxelPipeline(bool disableFastVoxelPipeline);
     void setUseVoxelShader(bool useVoxelShader);
+    void setUseChunkedMeshes(bool useChunkedMeshes);
+    void setUseInstancedVoxels(bool useInstancedVoxels);
     void setVoxelsAsPoints(bool voxelsAsPoints);
 
 protected:
@@ -109,6 +117,9 @@ protected:
     static const bool DONT_BAIL_EARLY; // by default we will bail early, if you want to force not bailing, then use this
     void setupNewVoxelsForDrawingSingleNode(bool allowBailEarly = true);
 
+    /// runs setupNewVoxelsForDrawing() on the hide/show thread if we have one, so that the main thread doesn't walk the tree
+    void queueSetupNewVoxelsForDrawing();
+
     /// called on the hide/show thread to hide any out of view voxels and show any newly in view voxels. 
     void checkForCulling();
     
@@ -143,12 +154,11 @@ private:
     static bool clearAllNodesBufferIndexOperation(OctreeElement* element, void* extraData);
     static bool inspectForExteriorOcclusionsOperation(OctreeElement* element, void* extraData);
     static bool inspectForInteriorOcclusionsOperation(OctreeElement* element, void* extraData);
-    static bool hideOutOfViewOperation(OctreeElement* element, void* extraData);
-    static bool hideAllSubTreeOperation(OctreeElement* element, void* extraData);
-    static bool showAllSubTreeOperation(OctreeElement* element, void* extraData);
     static bool getVoxelEnclosingOperation(OctreeElement* element, void* extraData);
     static bool recreateVoxelGeometryInViewOperation(OctreeElement* element, void* extraData);
 
+    void hideOutOfViewElement(VoxelTreeElement* voxel, int parentLastLocation, int parentLocation, hideOutOfViewArgs& args);
+
     int updateNodeInArrays(VoxelTreeElement* node, bool reuseIndex, bool forceDraw);
     int forceRemoveNodeFromArrays(VoxelTreeElement* node);
 
@@ -218,6 +228,8 @@ private:
 
     ViewFrustum _lastCulledViewFrustum; // used for hide/show visible passes
     bool _culledOnce;
+    quint64 _lastCulledTime; // when the last hide/show pass finished, the subtrees changed since need looking at
+    glm::vec3 _lastLODCulledPosition; // where we were at the last pass that redid the level of detail in view
 
     void setupFaceIndices(GLuint& faceVBOID, GLubyte faceIdentityIndices[]);
 
@@ -227,7 +239,7 @@ private:
     void copyWrittenDataToReadArrays(bool fullVBOs);
 
     void updateFullVBOs(); // all voxels in the VBO
-    void updatePartialVBOs(); // multiple segments, only dirty voxels
+    bool updatePartialVBOs(); // multiple segments, only dirty voxels, returns false if some are left for the next frame
 
     bool _voxelsDirty;
 
@@ -242,6 +254,11 @@ private:
     std::vector<glBufferIndex> _freeIndexes;
     QMutex _freeIndexLock;
 
+    // softens the pop when the level of detail changes by fading out the voxels that are no longer drawn
+    void fadeOutLevel(VoxelTreeElement* voxel);
+    QMutex _levelFadesLock;
+    std::vector<VoxelFade> _levelFades;
+
     void freeBufferIndex(glBufferIndex index);
     void clearFreeBufferIndexes();
     glBufferIndex getNextBufferIndex();
@@ -260,6 +277,9 @@ private:
 
     bool _inhideOutOfView;
 
+    bool _setupOnHideShowThread;
+    bool _setupNewVoxelsForDrawingQueued;
+
     float _lastKnownVoxelSizeScale;
     int _lastKnownBoundaryLevelAdjust;
 
@@ -267,6 +287,9 @@ private:
     bool _showCulledSharedFaces;                ///< Flag visibility of culled faces
     bool _usePrimitiveRenderer;                 ///< Flag primitive renderer for use
     PrimitiveRenderer* _renderer;               ///< Voxel renderer
+    bool _useChunkedMeshes;
+    bool _useInstancedVoxels;
+    VoxelChunkMesher* _chunkMesher;             ///< meshes the voxels by subtree, when not using the voxel shader
 
     static const unsigned int _sNumOctantsPerHemiVoxel = 4;
     static int _sCorrectedChildIndex[8];
@@ -12,9 +12,12 @@
 #include <QRunnable>
 #include <QThreadPool>
 
+#include <SharedUtil.h>
+
 #include "AnimationCache.h"
 
 static int animationPointerMetaTypeId = qRegisterMetaType<AnimationPointer>();
+static int animationTrackVectorMetaTypeId = qRegisterMetaType<QVector<AnimationTrack> >();
 
 AnimationCache::AnimationCache(QObject* parent) :
     ResourceCache(parent) {
@@ -35,8 +38,102 @@ QSharedPointer<Resource> AnimationCache::createResource(const QUrl& url, const Q
     return QSharedPointer<Resource>(new Animation(url), &Resource::allReferencesCleared);
 }
 
+/// the largest angle, in radians, by which a rotation interpolated between keys may differ from the original
+const float MAX_INTERPOLATION_ERROR = 0.005f;
+
+/// the most frames from one key to the next, which bounds the work of testing the frames between them
+const int MAX_KEY_SPAN = 32;
+
+/// the components other than the largest lie within plus or minus the square root of one half
+const float QUANTIZED_COMPONENT_RANGE = 0.70710678f;
+const int QUANTIZED_COMPONENT_MAX = 0x7FFF;
+
+static void packRotation(const glm::quat& rotation, quint16* packed) {
+    glm::quat normalized = glm::normalize(rotation);
+    float components[] = { normalized.x, normalized.y, normalized.z, normalized.w };
+    int largest = 0;
+    for (int i = 1; i < 4; i++) {
+        if (fabsf(components[i]) > fabsf(components[largest])) {
+            largest = i;
+        }
+    }
+    // q and -q are the same rotation, so the largest component can be made positive and left out
+    float sign = (components[largest] < 0.0f) ? -1.0f : 1.0f;
+    for (int i = 0, j = 0; i < 4; i++) {
+        if (i != largest) {
+            float scaled = glm::clamp(sign * components[i] / QUANTIZED_COMPONENT_RANGE, -1.0f, 1.0f) * 0.5f + 0.5f;
+            packed[j++] = (quint16)glm::round(scaled * QUANTIZED_COMPONENT_MAX);
+        }
+    }
+    // the index of the largest goes in the top bits of the first two
+    packed[0] |= (largest & 1) << 15;
+    packed[1] |= (largest >> 1) << 15;
+}
+
+static glm::quat unpackRotation(const quint16* packed) {
+    int largest = (packed[0] >> 15) | ((packed[1] >> 15) << 1);
+    float components[4];
+    float sumOfSquares = 0.0f;
+    for (int i = 0, j = 0; i < 4; i++) {
+        if (i != largest) {
+            float scaled = (packed[j++] & QUANTIZED_COMPONENT_MAX) / (float)QUANTIZED_COMPONENT_MAX;
+            components[i] = (scaled * 2.0f - 1.0f) * QUANTIZED_COMPONENT_RANGE;
+            sumOfSquares += components[i] * components[i];
+        }
+    }
+    components[largest] = sqrtf(glm::max(0.0f, 1.0f - sumOfSquares));
+    return glm::quat(components[3], components[0], components[1], components[2]);
+}
+
+static bool canInterpolate(const QVector<glm::quat>& rotations, int first, int last) {
+    const float MIN_DOT = cosf(MAX_INTERPOLATION_ERROR * 0.5f);
+    for (int i = first + 1; i < last; i++) {
+        glm::quat interpolated = safeMix(rotations.at(first), rotations.at(last), (i - first) / (float)(last - first));
+        if (fabsf(glm::dot(interpolated, rotations.at(i))) < MIN_DOT) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void AnimationTrack::setRotations(const QVector<glm::quat>& rotations) {
+    keyFrames.clear();
+    keyRotations.clear();
+    if (rotations.isEmpty()) {
+        return;
+    }
+    int lastFrame = rotations.size() - 1;
+    for (int key = 0;; ) {
+        keyFrames.append(key);
+        keyRotations.resize(keyRotations.size() + 3);
+        packRotation(rotations.at(key), keyRotations.data() + keyRotations.size() - 3);
+        if (key == lastFrame) {
+            return;
+        }
+        // extend to the next key for as long as the frames in between can be interpolated
+        int next = key + 1;
+        while (next < lastFrame && next + 1 - key <= MAX_KEY_SPAN && canInterpolate(rotations, key, next + 1)) {
+            next++;
+        }
+        key = next;
+    }
+}
+
+glm::quat AnimationTrack::getRotation(int frame) const {
+    int index = qUpperBound(keyFrames.constBegin(), keyFrames.constEnd(), frame) - keyFrames.constBegin() - 1;
+    index = glm::clamp(index, 0, keyFrames.size() - 1);
+    glm::quat rotation = unpackRotation(keyRotations.constData() + index * 3);
+    if (keyFrames.at(index) == frame || index == keyFrames.size() - 1) {
+        return rotation;
+    }
+    int keyFrame = keyFrames.at(index);
+    return safeMix(rotation, unpackRotation(keyRotations.constData() + (index + 1) * 3),
+        (frame - keyFrame) / (float)(keyFrames.at(index + 1) - keyFrame));
+}
+
 Animation::Animation(const QUrl& url) :
     Resource(url),
+    _frameCount(0),
     _isValid(false) {
 }
 
@@ -61,8 +158,22 @@ AnimationReader::AnimationReader(const QWeakPointer<Resource>& animation, QNetwo
 void AnimationReader::run() {
     QSharedPointer<Resource> animation = _animation.toStrongRef();
     if (!animation.isNull()) {
-        QMetaObject::invokeMethod(animation.data(), "setGeometry",
-            Q_ARG(const FBXGeometry&, readFBX(_reply->readAll(), QVariantHash())));
+        FBXGeometry geometry = readFBX(_reply->readAll(), QVariantHash());
+        
+        // compress the frames here, in the worker thread, and keep only the compressed tracks
+        int frameCount = geometry.animationFrames.size();
+        QVector<AnimationTrack> tracks(frameCount == 0 ? 0 : geometry.animationFrames.first().rotations.size());
+        QVector<glm::quat> rotations(frameCount);
+        for (int i = 0; i < tracks.size(); i++) {
+            for (int j = 0; j < frameCount; j++) {
+                rotations[j] = geometry.animationFrames.at(j).rotations.value(i);
+            }
+            tracks[i].setRotations(rotations);
+        }
+        geometry.animationFrames.clear();
+        
+        QMetaObject::invokeMethod(animation.data(), "setGeometry", Q_ARG(const FBXGeometry&, geometry),
+            Q_ARG(const QVector<AnimationTrack>&, tracks), Q_ARG(int, frameCount));
     }
     _reply->deleteLater();
 }
@@ -88,11 +199,37 @@ QVector<FBXAnimationFrame> Animation::getFrames() const {
             Q_RETURN_ARG(QVector<FBXAnimationFrame>, result));
         return result;
     }
-    return _geometry.animationFrames;
+    QVector<FBXAnimationFrame> frames(_frameCount);
+    for (int i = 0; i < _frameCount; i++) {
+        frames[i] = getFrame(i);
+    }
+    return frames;
+}
+
+FBXAnimationFrame Animation::getFrame(int index) const {
+    if (QThread::currentThread() != thread()) {
+        FBXAnimationFrame result;
+        QMetaObject::invokeMethod(const_cast<Animation*>(this), "getFrame", Qt::BlockingQueuedConnection,
+            Q_RETURN_ARG(FBXAnimationFrame, result), Q_ARG(int, index));
+        return result;
+    }
+    FBXAnimationFrame frame;
+    frame.rotations.resize(_tracks.size());
+    for (int i = 0; i < _tracks.size(); i++) {
+        frame.rotations[i] = _tracks.at(i).getRotation(index);
+    }
+    return frame;
 }
 
-void Animation::setGeometry(const FBXGeometry& geometry) {
+void Animation::setGeometry(const FBXGeometry& geometry, const QVector<AnimationTrack>& tracks, int frameCount) {
     _geometry = geometry;
+    _tracks = tracks;
+    _frameCount = frameCount;
+    qint64 bytes = _geometry.getMemoryBytes();
+    foreach (const AnimationTrack& track, _tracks) {
+        bytes += track.getMemoryBytes();
+    }
+    setBytes(bytes, 0);
     finishedLoading(true);
     _isValid = true;
 }
@@ -43,6 +43,25 @@ protected:
 
 Q_DECLARE_METATYPE(AnimationPointer)
 
+/// A joint's rotations over an animation, reduced to the key frames between which the rest can be interpolated, with
+/// each rotation quantized to three 15 bit components.
+class AnimationTrack {
+public:
+    
+    QVector<int> keyFrames; /// the frames of the keys, ascending, from the first frame of the animation to the last
+    QVector<quint16> keyRotations; /// three per key
+    
+    /// reduces and quantizes the given rotations, one per frame
+    void setRotations(const QVector<glm::quat>& rotations);
+    
+    /// returns the rotation at the given frame, interpolating between the keys on either side
+    glm::quat getRotation(int frame) const;
+    
+    qint64 getMemoryBytes() const { return keyFrames.size() * sizeof(int) + keyRotations.size() * sizeof(quint16); }
+};
+
+Q_DECLARE_METATYPE(QVector<AnimationTrack>)
+
 /// An animation loaded from the network.
 class Animation : public Resource {
     Q_OBJECT
@@ -55,19 +74,30 @@ public:
     
     Q_INVOKABLE QStringList getJointNames() const;
     
+    /// decompresses all of the frames; slow, and meant only for scripts
     Q_INVOKABLE QVector<FBXAnimationFrame> getFrames() const;
 
+    Q_INVOKABLE FBXAnimationFrame getFrame(int index) const;
+    
+    int getFrameCount() const { return _frameCount; }
+    
+    /// returns the rotation of a joint at a frame; the tracks don't change once loaded, so this may be called from any
+    /// thread holding a reference to the loaded animation
+    glm::quat getRotation(int jointIndex, int frame) const { return _tracks.at(jointIndex).getRotation(frame); }
+
     bool isValid() const { return _isValid; }
     
 protected:
 
-    Q_INVOKABLE void setGeometry(const FBXGeometry& geometry);
+    Q_INVOKABLE void setGeometry(const FBXGeometry& geometry, const QVector<AnimationTrack>& tracks, int frameCount);
     
     virtual void downloadFinished(QNetworkReply* reply);
 
 private:
     
-    FBXGeometry _geometry;
+    FBXGeometry _geometry; /// without the animation frames, which are kept in the tracks
+    QVector<AnimationTrack> _tracks; /// by joint index
+    int _frameCount;
     bool _isValid;
 };
 
@@ -0,0 +1,199 @@
+//
+//  AudioCodec.cpp
+//  libraries/audio/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#include <limits>
+#include <string.h>
+
+#include "AudioCodec.h"
+
+const int ADPCM_NUM_STEPS = 89;
+
+const int ADPCM_STEPS[ADPCM_NUM_STEPS] = {
+    7, 8, 9, 10, 11, 12, 13, 14, 16, 17, 19, 21, 23, 25, 28, 31, 34, 37, 41, 45, 50, 55, 60, 66, 73, 80, 88, 97,
+    107, 118, 130, 143, 157, 173, 190, 209, 230, 253, 279, 307, 337, 371, 408, 449, 494, 544, 598, 658, 724, 796,
+    876, 963, 1060, 1166, 1282, 1411, 1552, 1707, 1878, 2066, 2272, 2499, 2749, 3024, 3327, 3660, 4026, 4428, 4871,
+    5358, 5894, 6484, 7132, 7845, 8630, 9493, 10442, 11487, 12635, 13899, 15289, 16818, 18500, 20350, 22385, 24623,
+    27086, 29794, 32767
+};
+
+const int ADPCM_STEP_INDEX_CHANGES[8] = { -1, -1, -1, -1, 2, 4, 6, 8 };
+
+// each channel starts with its first predicted sample and step index, padded to four bytes
+const int ADPCM_BYTES_PER_CHANNEL_HEADER = 4;
+
+// the encoder adapts its step size over this many frames before it writes the step index to the header
+const int ADPCM_WARM_UP_FRAMES = 16;
+
+const int MAX_ADPCM_CHANNELS = 2;
+
+const int ADPCM_MAX_SAMPLE = std::numeric_limits<int16_t>::max();
+const int ADPCM_MIN_SAMPLE = std::numeric_limits<int16_t>::min();
+
+class ADPCMChannelState {
+public:
+    int predictedSample;
+    int stepIndex;
+
+    /// moves the prediction by one four bit code, exactly the same way for the encoder and the decoder
+    int16_t applyCode(int code) {
+        int step = ADPCM_STEPS[stepIndex];
+        int delta = step >> 3;
+        if (code & 4) {
+            delta += step;
+        }
+        if (code & 2) {
+            delta += step >> 1;
+        }
+        if (code & 1) {
+            delta += step >> 2;
+        }
+
+        predictedSample += (code & 8) ? -delta : delta;
+        if (predictedSample > ADPCM_MAX_SAMPLE) {
+            predictedSample = ADPCM_MAX_SAMPLE;
+        } else if (predictedSample < ADPCM_MIN_SAMPLE) {
+            predictedSample = ADPCM_MIN_SAMPLE;
+        }
+
+        stepIndex += ADPCM_STEP_INDEX_CHANGES[code & 7];
+        if (stepIndex < 0) {
+            stepIndex = 0;
+        } else if (stepIndex >= ADPCM_NUM_STEPS) {
+            stepIndex = ADPCM_NUM_STEPS - 1;
+        }
+
+        return predictedSample;
+    }
+
+    /// returns the code that gets the prediction closest to the sample, and applies it
+    int encodeSample(int16_t sample) {
+        int step = ADPCM_STEPS[stepIndex];
+        int difference = sample - predictedSample;
+        int code = 0;
+
+        if (difference < 0) {
+            code = 8;
+            difference = -difference;
+        }
+        if (difference >= step) {
+            code |= 4;
+            difference -= step;
+        }
+        step >>= 1;
+        if (difference >= step) {
+            code |= 2;
+            difference -= step;
+        }
+        step >>= 1;
+        if (difference >= step) {
+            code |= 1;
+        }
+
+        applyCode(code);
+        return code;
+    }
+};
+
+const char* AudioCodec::getName(Type type) {
+    switch (type) {
+        case ADPCM:
+            return "ADPCM";
+        default:
+            return "PCM";
+    }
+}
+
+int AudioCodec::getMaxEncodedSize(Type type, int numSamples, int numChannels) {
+    if (type == ADPCM) {
+        return (numChannels * ADPCM_BYTES_PER_CHANNEL_HEADER) + ((numSamples + 1) / 2);
+    } else {
+        return numSamples * sizeof(int16_t);
+    }
+}
+
+int AudioCodec::encode(Type type, const int16_t* samples, int numSamples, int numChannels, char* destination) {
+    if (type != ADPCM || numChannels > MAX_ADPCM_CHANNELS) {
+        int numBytes = numSamples * sizeof(int16_t);
+        memcpy(destination, samples, numBytes);
+        return numBytes;
+    }
+
+    int numFrames = numSamples / numChannels;
+    ADPCMChannelState channels[MAX_ADPCM_CHANNELS];
+    char* headerAt = destination;
+
+    for (int c = 0; c < numChannels; c++) {
+        // let the step size settle on the start of the frame, then begin again from its first sample with that step
+        channels[c].predictedSample = numFrames > 0 ? samples[c] : 0;
+        channels[c].stepIndex = 0;
+
+        for (int f = 0; f < numFrames && f < ADPCM_WARM_UP_FRAMES; f++) {
+            channels[c].encodeSample(samples[(f * numChannels) + c]);
+        }
+
+        channels[c].predictedSample = numFrames > 0 ? samples[c] : 0;
+
+        int16_t firstSample = channels[c].predictedSample;
+        memcpy(headerAt, &firstSample, sizeof(int16_t));
+        headerAt[sizeof(int16_t)] = (char) channels[c].stepIndex;
+        headerAt[sizeof(int16_t) + 1] = 0;
+        headerAt += ADPCM_BYTES_PER_CHANNEL_HEADER;
+    }
+
+    // two codes per byte, the earlier sample in the low four bits
+    unsigned char* codesAt = reinterpret_cast<unsigned char*>(headerAt);
+    for (int i = 0; i < numSamples; i++) {
+        int code = channels[i % numChannels].encodeSample(samples[i]);
+        if (i % 2 == 0) {
+            codesAt[i / 2] = code;
+        } else {
+            codesAt[i / 2] |= code << 4;
+        }
+    }
+
+    return (headerAt - destination) + ((numSamples + 1) / 2);
+}
+
+int AudioCodec::decode(Type type, const char* data, int size, int numChannels, int16_t* samples, int maxSamples) {
+    if (type != ADPCM || numChannels > MAX_ADPCM_CHANNELS) {
+        int numSamples = qMin(size / (int) sizeof(int16_t), maxSamples);
+        memcpy(samples, data, numSamples * sizeof(int16_t));
+        return numSamples;
+    }
+
+    int numHeaderBytes = numChannels * ADPCM_BYTES_PER_CHANNEL_HEADER;
+    if (size < numHeaderBytes) {
+        return 0;
+    }
+
+    ADPCMChannelState channels[MAX_ADPCM_CHANNELS];
+    const char* headerAt = data;
+
+    for (int c = 0; c < numChannels; c++) {
+        int16_t firstSample;
+        memcpy(&firstSample, headerAt, sizeof(int16_t));
+        channels[c].predictedSample = firstSample;
+        channels[c].stepIndex = qMin((int) (unsigned char) headerAt[sizeof(int16_t)], ADPCM_NUM_STEPS - 1);
+        headerAt += ADPCM_BYTES_PER_CHANNEL_HEADER;
+    }
+
+    const unsigned char* codesAt = reinterpret_cast<const unsigned char*>(headerAt);
+    int numSamples = qMin((size - numHeaderBytes) * 2, maxSamples);
+
+    // keep whole frames only, so a truncated packet can't swap the channels of the following samples
+    numSamples -= numSamples % numChannels;
+
+    for (int i = 0; i < numSamples; i++) {
+        int code = (i % 2 == 0) ? (codesAt[i / 2] & 0x0F) : (codesAt[i / 2] >> 4);
+        samples[i] = channels[i % numChannels].applyCode(code);
+    }
+
+    return numSamples;
+}
@@ -0,0 +1,41 @@
+//
+//  AudioCodec.h
+//  libraries/audio/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#ifndef hifi_AudioCodec_h
+#define hifi_AudioCodec_h
+
+#include <stdint.h>
+
+#include <QtCore/QtGlobal>
+
+/// Encodes and decodes the samples of a network audio frame. A client names the codec it sends its microphone
+/// stream with, and the audio-mixer encodes that client's mix with the same codec. Every encoded frame carries
+/// everything needed to decode it, so a lost packet never affects the frames after it.
+class AudioCodec {
+public:
+    enum Type {
+        PCM = 0, /// raw int16 samples
+        ADPCM /// IMA ADPCM, four bits per sample
+    };
+
+    static bool isKnownType(quint8 type) { return type <= ADPCM; }
+    static const char* getName(Type type);
+
+    /// returns the largest number of bytes an encoded frame of numSamples interleaved samples can take
+    static int getMaxEncodedSize(Type type, int numSamples, int numChannels);
+
+    /// encodes numSamples interleaved samples into destination, returns the number of bytes written
+    static int encode(Type type, const int16_t* samples, int numSamples, int numChannels, char* destination);
+
+    /// decodes at most maxSamples interleaved samples from size bytes of data, returns the number of samples decoded
+    static int decode(Type type, const char* data, int size, int numChannels, int16_t* samples, int maxSamples);
+};
+
+#endif // hifi_AudioCodec_h
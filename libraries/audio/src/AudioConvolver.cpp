@@ -0,0 +1,189 @@
+//
+//  AudioConvolver.cpp
+//  libraries/audio/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#include <algorithm>
+#include <cstring>
+
+#include <QtCore/QtGlobal>
+
+#include <SharedUtil.h>
+
+#include "AudioConvolver.h"
+
+typedef std::complex<float> Complex;
+
+static void calculateTwiddles(QVector<Complex>& twiddles, int fftSize) {
+    twiddles.resize(fftSize / 2);
+    for (int i = 0; i < twiddles.size(); i++) {
+        twiddles[i] = std::polar(1.0f, -TWO_PI * i / fftSize);
+    }
+}
+
+/// an in place radix-2 FFT of a power of two size, the inverse is left unscaled
+static void fft(Complex* data, const Complex* twiddles, int size, bool isInverse) {
+    for (int i = 1, j = 0; i < size; i++) {
+        int bit = size >> 1;
+        for (; j & bit; bit >>= 1) {
+            j ^= bit;
+        }
+        j ^= bit;
+
+        if (i < j) {
+            std::swap(data[i], data[j]);
+        }
+    }
+
+    for (int length = 2; length <= size; length <<= 1) {
+        int halfLength = length / 2;
+        int twiddleStep = size / length;
+
+        for (int start = 0; start < size; start += length) {
+            for (int i = 0; i < halfLength; i++) {
+                Complex twiddle = isInverse ? std::conj(twiddles[i * twiddleStep]) : twiddles[i * twiddleStep];
+                Complex odd = data[start + i + halfLength] * twiddle;
+                data[start + i + halfLength] = data[start + i] - odd;
+                data[start + i] += odd;
+            }
+        }
+    }
+}
+
+AudioImpulseResponse::AudioImpulseResponse(const QVector<float>& response, int blockFrames) :
+    _blockFrames(blockFrames),
+    _numPartitions((response.size() + blockFrames - 1) / blockFrames),
+    _partitionIndices(),
+    _spectra()
+{
+    int fftSize = 2 * blockFrames;
+    int numBins = blockFrames + 1;
+
+    QVector<Complex> twiddles;
+    calculateTwiddles(twiddles, fftSize);
+    QVector<Complex> scratch(fftSize);
+
+    for (int p = 0; p < _numPartitions; p++) {
+        int firstFrame = p * blockFrames;
+        int numFrames = qMin(blockFrames, response.size() - firstFrame);
+
+        bool isUsed = false;
+        for (int i = 0; i < numFrames && !isUsed; i++) {
+            isUsed = (response[firstFrame + i] != 0.0f);
+        }
+        if (!isUsed) {
+            // the most of a sparse response is silence, and silent partitions cost nothing
+            continue;
+        }
+
+        // each partition is zero padded to twice its length, which overlap-save needs
+        for (int i = 0; i < fftSize; i++) {
+            scratch[i] = (i < numFrames) ? Complex(response[firstFrame + i], 0.0f) : Complex(0.0f, 0.0f);
+        }
+        fft(scratch.data(), twiddles.constData(), fftSize, false);
+
+        _partitionIndices.append(p);
+        _spectra.resize(_spectra.size() + numBins);
+        std::copy(scratch.constData(), scratch.constData() + numBins, _spectra.data() + _spectra.size() - numBins);
+    }
+}
+
+AudioConvolver::AudioConvolver(int maxResponseFrames, int blockFrames) :
+    _blockFrames(blockFrames),
+    _maxPartitions(qMax((maxResponseFrames + blockFrames - 1) / blockFrames, 1)),
+    _response(),
+    _twiddles(),
+    _scratch(2 * blockFrames),
+    _inputSpectra(),
+    _outputSpectrum(blockFrames + 1),
+    _nextInputSpectrum(0),
+    _inputBlocks(),
+    _outputBlock(),
+    _numBufferedFrames(0)
+{
+    calculateTwiddles(_twiddles, 2 * blockFrames);
+    reset();
+}
+
+void AudioConvolver::setImpulseResponse(const AudioImpulseResponsePointer& response) {
+    // a response made for another block size can't be used
+    _response = (response && response->getBlockFrames() == _blockFrames) ? response : AudioImpulseResponsePointer();
+}
+
+void AudioConvolver::reset() {
+    // the spectra of every input block that the longest response reaches back to
+    _inputSpectra.fill(Complex(0.0f, 0.0f), _maxPartitions * (_blockFrames + 1));
+    _nextInputSpectrum = 0;
+
+    _inputBlocks.fill(0.0f, 2 * _blockFrames);
+    _outputBlock.fill(0.0f, _blockFrames);
+    _numBufferedFrames = 0;
+}
+
+void AudioConvolver::process(const int16_t* input, int inputStride, float* output, int numFrames) {
+    for (int i = 0; i < numFrames; i++) {
+        _inputBlocks[_blockFrames + _numBufferedFrames] = input[i * inputStride];
+        output[i] = _outputBlock[_numBufferedFrames];
+
+        if (++_numBufferedFrames == _blockFrames) {
+            processBlock();
+            _numBufferedFrames = 0;
+        }
+    }
+}
+
+void AudioConvolver::processBlock() {
+    int fftSize = 2 * _blockFrames;
+    int numBins = _blockFrames + 1;
+
+    // the spectrum of the last two blocks of input goes into the delay line even without a response, so that a
+    // response set later has the history it needs
+    for (int i = 0; i < fftSize; i++) {
+        _scratch[i] = Complex(_inputBlocks[i], 0.0f);
+    }
+    fft(_scratch.data(), _twiddles.constData(), fftSize, false);
+    std::copy(_scratch.constData(), _scratch.constData() + numBins, _inputSpectra.data() + (_nextInputSpectrum * numBins));
+
+    if (_response) {
+        std::fill(_outputSpectrum.begin(), _outputSpectrum.end(), Complex(0.0f, 0.0f));
+
+        // every used partition of the response is multiplied with the spectrum of the input it is as many blocks behind
+        const Complex* responseSpectrum = _response->_spectra.constData();
+        for (int j = 0; j < _response->_partitionIndices.size(); j++, responseSpectrum += numBins) {
+            int partition = _response->_partitionIndices[j];
+            if (partition >= _maxPartitions) {
+                break;
+            }
+
+            int inputIndex = (_nextInputSpectrum - partition + _maxPartitions) % _maxPartitions;
+            const Complex* inputSpectrum = _inputSpectra.constData() + (inputIndex * numBins);
+            for (int k = 0; k < numBins; k++) {
+                _outputSpectrum[k] += inputSpectrum[k] * responseSpectrum[k];
+            }
+        }
+
+        // the output is real, so the upper half of its spectrum mirrors the lower half
+        for (int k = 0; k < numBins; k++) {
+            _scratch[k] = _outputSpectrum[k];
+        }
+        for (int k = 1; k < _blockFrames; k++) {
+            _scratch[fftSize - k] = std::conj(_outputSpectrum[k]);
+        }
+        fft(_scratch.data(), _twiddles.constData(), fftSize, true);
+
+        // overlap-save keeps the second half, the first is wrapped around
+        for (int i = 0; i < _blockFrames; i++) {
+            _outputBlock[i] = _scratch[_blockFrames + i].real() / fftSize;
+        }
+    } else {
+        _outputBlock.fill(0.0f);
+    }
+
+    _nextInputSpectrum = (_nextInputSpectrum + 1) % _maxPartitions;
+    memmove(_inputBlocks.data(), _inputBlocks.constData() + _blockFrames, _blockFrames * sizeof(float));
+}
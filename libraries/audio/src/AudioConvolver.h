@@ -0,0 +1,84 @@
+//
+//  AudioConvolver.h
+//  libraries/audio/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#ifndef hifi_AudioConvolver_h
+#define hifi_AudioConvolver_h
+
+#include <complex>
+#include <stdint.h>
+
+#include <QtCore/QSharedPointer>
+#include <QtCore/QVector>
+
+// a block of 256 frames makes for FFTs of 512, and a latency of about 10 msecs at 24KHz
+const int AUDIO_CONVOLVER_BLOCK_FRAMES = 256;
+
+/// The frequency domain partitions of an impulse response, made by whoever works out the response and then shared with
+/// the AudioConvolvers using it, so that none of the FFTs of the response have to happen on the audio thread.
+class AudioImpulseResponse {
+public:
+    AudioImpulseResponse(const QVector<float>& response, int blockFrames = AUDIO_CONVOLVER_BLOCK_FRAMES);
+
+    int getBlockFrames() const { return _blockFrames; }
+
+    /// the number of block long partitions the response covers, empty ones included
+    int getNumPartitions() const { return _numPartitions; }
+
+    /// the number of partitions that have anything in them, which is what the cost of convolving with it depends on
+    int getNumUsedPartitions() const { return _partitionIndices.size(); }
+
+private:
+    friend class AudioConvolver;
+
+    int _blockFrames;
+    int _numPartitions;
+    QVector<int> _partitionIndices;
+    QVector<std::complex<float> > _spectra;
+};
+
+typedef QSharedPointer<AudioImpulseResponse> AudioImpulseResponsePointer;
+
+/// Convolves a signal with an impulse response by uniformly partitioned overlap-save FFT convolution. The input is
+/// taken a block at a time, so the output lags it by one block, and the cost of each block only depends on how many
+/// partitions of the response are used. The response can be swapped at any time without losing the history of the
+/// input, as long as it is no longer than maxResponseFrames.
+class AudioConvolver {
+public:
+    AudioConvolver(int maxResponseFrames, int blockFrames = AUDIO_CONVOLVER_BLOCK_FRAMES);
+
+    const AudioImpulseResponsePointer& getImpulseResponse() const { return _response; }
+    void setImpulseResponse(const AudioImpulseResponsePointer& response);
+
+    /// convolves numFrames samples of input, each inputStride samples after the one before so that one channel of an
+    /// interleaved buffer can be read, into output
+    void process(const int16_t* input, int inputStride, float* output, int numFrames);
+
+    /// forgets all of the input so far
+    void reset();
+
+private:
+    void processBlock();
+
+    int _blockFrames;
+    int _maxPartitions;
+    AudioImpulseResponsePointer _response;
+
+    QVector<std::complex<float> > _twiddles;
+    QVector<std::complex<float> > _scratch;
+    QVector<std::complex<float> > _inputSpectra;
+    QVector<std::complex<float> > _outputSpectrum;
+    int _nextInputSpectrum;
+
+    QVector<float> _inputBlocks;
+    QVector<float> _outputBlock;
+    int _numBufferedFrames;
+};
+
+#endif // hifi_AudioConvolver_h
@@ -0,0 +1,105 @@
+//
+//  AudioHRTF.cpp
+//  libraries/audio/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#include <math.h>
+#include <string.h>
+
+#include <SharedUtil.h>
+
+#include "AudioRingBuffer.h"
+
+#include "AudioHRTF.h"
+
+// a filter every five degrees keeps the step between neighbouring interaural delays under a sample
+const int HRTF_NUM_BEARINGS = 72;
+
+// the head model of Brown and Duda - the radius of an average head and the speed of sound
+const float HEAD_RADIUS_METERS = 0.0875f;
+const float SPEED_OF_SOUND_METERS_PER_SECOND = 343.0f;
+
+// the far ear keeps this fraction of the high frequencies, at the angle with the least of them
+const float HEAD_SHADOW_MIN_ALPHA = 0.1f;
+const float HEAD_SHADOW_MIN_ALPHA_ANGLE = 150.0f * RADIANS_PER_DEGREE;
+
+const int LEFT_EAR = 0;
+const int RIGHT_EAR = 1;
+
+static float filterTable[HRTF_NUM_BEARINGS][2][HRTF_NUM_TAPS];
+
+// build the table once, when the library is loaded, before any mixer can run
+static bool hasBuiltFilters = AudioHRTF::buildFilters();
+
+/// fills one ear's filter for a source at angleToEar radians from the axis through that ear
+static void buildEarFilter(float angleToEar, float* filter) {
+    // the delay around the head, relative to a source right at this ear
+    float headDelay = HEAD_RADIUS_METERS / SPEED_OF_SOUND_METERS_PER_SECOND;
+    float delaySeconds = (angleToEar < PI_OVER_TWO)
+        ? headDelay * (1.0f - cosf(angleToEar))
+        : headDelay * (1.0f + angleToEar - PI_OVER_TWO);
+    float delaySamples = delaySeconds * SAMPLE_RATE;
+
+    // the head shadow is a single pole and zero filter, alpha above 1 at the near ear and below it at the far ear
+    float alpha = (1.0f + (HEAD_SHADOW_MIN_ALPHA / 2.0f))
+        + ((1.0f - (HEAD_SHADOW_MIN_ALPHA / 2.0f)) * cosf(angleToEar / HEAD_SHADOW_MIN_ALPHA_ANGLE * PI));
+
+    // bilinear transform of (1 + alpha * s / 2w0) / (1 + s / 2w0), with w0 = c / a
+    float bilinearScale = 2.0f * SAMPLE_RATE * HEAD_RADIUS_METERS / (2.0f * SPEED_OF_SOUND_METERS_PER_SECOND);
+    float b0 = (1.0f + (alpha * bilinearScale)) / (1.0f + bilinearScale);
+    float b1 = (1.0f - (alpha * bilinearScale)) / (1.0f + bilinearScale);
+    float a1 = (1.0f - bilinearScale) / (1.0f + bilinearScale);
+
+    // run a fractionally delayed impulse through the shadow filter
+    int delayFrames = (int) delaySamples;
+    float delayFraction = delaySamples - delayFrames;
+
+    float previousInput = 0.0f;
+    float previousOutput = 0.0f;
+    for (int t = 0; t < HRTF_NUM_TAPS; t++) {
+        float input = (t == delayFrames) ? (1.0f - delayFraction) : ((t == delayFrames + 1) ? delayFraction : 0.0f);
+        float output = (b0 * input) + (b1 * previousInput) - (a1 * previousOutput);
+        filter[t] = output;
+
+        previousInput = input;
+        previousOutput = output;
+    }
+}
+
+/// the angle between a direction on the horizontal plane and the axis through an ear, from 0 to pi
+static float angleBetween(float bearing, float earBearing) {
+    float angle = fabsf(bearing - earBearing);
+    return angle > PI ? TWO_PI - angle : angle;
+}
+
+bool AudioHRTF::buildFilters() {
+    for (int i = 0; i < HRTF_NUM_BEARINGS; i++) {
+        float bearing = (TWO_PI * i / HRTF_NUM_BEARINGS) - PI;
+        buildEarFilter(angleBetween(bearing, PI_OVER_TWO), filterTable[i][LEFT_EAR]);
+        buildEarFilter(angleBetween(bearing, -PI_OVER_TWO), filterTable[i][RIGHT_EAR]);
+    }
+    return true;
+}
+
+void AudioHRTF::getFilters(float bearing, float gain, float* leftFilter, float* rightFilter) {
+    // find the two tabulated bearings either side of this one, wrapping around behind the listener
+    float position = (bearing + PI) / TWO_PI * HRTF_NUM_BEARINGS;
+    position -= floorf(position / HRTF_NUM_BEARINGS) * HRTF_NUM_BEARINGS;
+
+    int first = (int) position % HRTF_NUM_BEARINGS;
+    int second = (first + 1) % HRTF_NUM_BEARINGS;
+    float secondRatio = position - floorf(position);
+
+    float firstGain = gain * (1.0f - secondRatio);
+    float secondGain = gain * secondRatio;
+
+    for (int t = 0; t < HRTF_NUM_TAPS; t++) {
+        leftFilter[t] = (filterTable[first][LEFT_EAR][t] * firstGain) + (filterTable[second][LEFT_EAR][t] * secondGain);
+        rightFilter[t] = (filterTable[first][RIGHT_EAR][t] * firstGain) + (filterTable[second][RIGHT_EAR][t] * secondGain);
+    }
+}
@@ -0,0 +1,30 @@
+//
+//  AudioHRTF.h
+//  libraries/audio/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#ifndef hifi_AudioHRTF_h
+#define hifi_AudioHRTF_h
+
+const int HRTF_NUM_TAPS = 32;
+
+/// Short FIR head related transfer filters for the left and right ears, for sources all around the listener on the
+/// horizontal plane. They come from a spherical head model - each ear hears the source delayed by the path around
+/// the head and through a head shadow filter that dulls the far ear and brightens the near one. The filters are
+/// tabulated every few degrees when the library loads and interpolated in between.
+class AudioHRTF {
+public:
+    /// fills HRTF_NUM_TAPS taps of filters for a source at bearing radians around the y-axis, positive to the left
+    /// like the bearings the mixer calculates, with gain folded into the taps
+    static void getFilters(float bearing, float gain, float* leftFilter, float* rightFilter);
+
+    /// builds the table, the library calls this once when it loads
+    static bool buildFilters();
+};
+
+#endif // hifi_AudioHRTF_h
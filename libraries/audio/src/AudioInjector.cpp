@@ -17,6 +17,7 @@
 #include <UUID.h>
 
 #include "AbstractAudioInterface.h"
+#include "AudioInjectorManager.h"
 #include "AudioRingBuffer.h"
 
 #include "AudioInjector.h"
@@ -25,7 +26,13 @@ AudioInjector::AudioInjector(QObject* parent) :
     QObject(parent),
     _sound(NULL),
     _options(),
-    _shouldStop(false)
+    _shouldStop(false),
+    _stream(),
+    _injectAudioPacket(),
+    _numPreSequenceNumberBytes(0),
+    _numPreAudioDataBytes(0),
+    _currentSendPosition(0),
+    _hasSentLoopbackAudio(false)
 {
     
 }
@@ -33,7 +40,13 @@ AudioInjector::AudioInjector(QObject* parent) :
 AudioInjector::AudioInjector(Sound* sound, const AudioInjectorOptions& injectorOptions) :
     _sound(sound),
     _options(injectorOptions),
-    _shouldStop(false)
+    _shouldStop(false),
+    _stream(),
+    _injectAudioPacket(),
+    _numPreSequenceNumberBytes(0),
+    _numPreAudioDataBytes(0),
+    _currentSendPosition(0),
+    _hasSentLoopbackAudio(false)
 {
     
 }
@@ -41,102 +54,92 @@ AudioInjector::AudioInjector(Sound* sound, const AudioInjectorOptions& injectorO
 const uchar MAX_INJECTOR_VOLUME = 0xFF;
 
 void AudioInjector::injectAudio() {
+    AudioInjectorManager::getInstance()->addInjector(this);
+}
+
+bool AudioInjector::startInjection(const AudioInjectorStream& stream) {
+    // make sure we actually have samples downloaded to inject
+    if (!_sound->hasDownloaded()) {
+        return false;
+    }
     
-    QByteArray soundByteArray = _sound->getByteArray();
+    _stream = stream;
     
-    // make sure we actually have samples downloaded to inject
-    if (soundByteArray.size()) {
-        // give our sample byte array to the local audio interface, if we have it, so it can be handled locally
-        if (_options.getLoopbackAudioInterface()) {
-            // assume that localAudioInterface could be on a separate thread, use Qt::AutoConnection to handle properly
-            QMetaObject::invokeMethod(_options.getLoopbackAudioInterface(), "handleAudioByteArray",
-                                      Qt::AutoConnection,
-                                      Q_ARG(QByteArray, soundByteArray));
-            
-        }
-        
-        NodeList* nodeList = NodeList::getInstance();
-        
-        // setup the packet for injected audio
-        QByteArray injectAudioPacket = byteArrayWithPopulatedHeader(PacketTypeInjectAudio);
-        QDataStream packetStream(&injectAudioPacket, QIODevice::Append);
-        
-        // pack some placeholder sequence number for now
-        int numPreSequenceNumberBytes = injectAudioPacket.size();
-        packetStream << (quint16)0;
-
-        // pack stream identifier (a generated UUID)
-        packetStream << QUuid::createUuid();
-        
-        // pack the flag for loopback
-        uchar loopbackFlag = (uchar) (!_options.getLoopbackAudioInterface());
-        packetStream << loopbackFlag;
-        
-        // pack the position for injected audio
-        packetStream.writeRawData(reinterpret_cast<const char*>(&_options.getPosition()), sizeof(_options.getPosition()));
-        
-        // pack our orientation for injected audio
-        packetStream.writeRawData(reinterpret_cast<const char*>(&_options.getOrientation()), sizeof(_options.getOrientation()));
-        
-        // pack zero for radius
-        float radius = 0;
-        packetStream << radius;
-        
-        // pack 255 for attenuation byte
-        quint8 volume = MAX_INJECTOR_VOLUME * _options.getVolume();
-        packetStream << volume;
-        
-        QElapsedTimer timer;
-        timer.start();
-        int nextFrame = 0;
-        
-        int currentSendPosition = 0;
-        
-        int numPreAudioDataBytes = injectAudioPacket.size();
-        bool shouldLoop = _options.getLoop();
-        
-        // loop to send off our audio in NETWORK_BUFFER_LENGTH_SAMPLES_PER_CHANNEL byte chunks
-        quint16 outgoingInjectedAudioSequenceNumber = 0;
-        while (currentSendPosition < soundByteArray.size() && !_shouldStop) {
-            
-            int bytesToCopy = std::min(NETWORK_BUFFER_LENGTH_BYTES_PER_CHANNEL,
-                                       soundByteArray.size() - currentSendPosition);
-            
-            // resize the QByteArray to the right size
-            injectAudioPacket.resize(numPreAudioDataBytes + bytesToCopy);
-
-            // pack the sequence number
-            memcpy(injectAudioPacket.data() + numPreSequenceNumberBytes, &outgoingInjectedAudioSequenceNumber, sizeof(quint16));
-            
-            // copy the next NETWORK_BUFFER_LENGTH_BYTES_PER_CHANNEL bytes to the packet
-            memcpy(injectAudioPacket.data() + numPreAudioDataBytes, soundByteArray.data() + currentSendPosition, bytesToCopy);
-            
-            // grab our audio mixer from the NodeList, if it exists
-            SharedNodePointer audioMixer = nodeList->soloNodeOfType(NodeType::AudioMixer);
-            
-            // send off this audio packet
-            nodeList->writeDatagram(injectAudioPacket, audioMixer);
-            outgoingInjectedAudioSequenceNumber++;
-            
-            currentSendPosition += bytesToCopy;
-            
-            // send two packets before the first sleep so the mixer can start playback right away
-            
-            if (currentSendPosition != bytesToCopy && currentSendPosition < soundByteArray.size()) {
-                // not the first packet and not done
-                // sleep for the appropriate time
-                int usecToSleep = (++nextFrame * BUFFER_SEND_INTERVAL_USECS) - timer.nsecsElapsed() / 1000;
-                
-                if (usecToSleep > 0) {
-                    usleep(usecToSleep);
-                }
-            }
+    // setup the packet for injected audio
+    _injectAudioPacket = byteArrayWithPopulatedHeader(PacketTypeInjectAudio);
+    QDataStream packetStream(&_injectAudioPacket, QIODevice::Append);
+    
+    // pack some placeholder sequence number for now
+    _numPreSequenceNumberBytes = _injectAudioPacket.size();
+    packetStream << (quint16)0;
+    
+    // pack stream identifier
+    packetStream << _stream.identifier;
+    
+    // pack the flag for loopback
+    uchar loopbackFlag = (uchar) (!_options.getLoopbackAudioInterface());
+    packetStream << loopbackFlag;
+    
+    // pack the position for injected audio
+    packetStream.writeRawData(reinterpret_cast<const char*>(&_options.getPosition()), sizeof(_options.getPosition()));
+    
+    // pack our orientation for injected audio
+    packetStream.writeRawData(reinterpret_cast<const char*>(&_options.getOrientation()), sizeof(_options.getOrientation()));
+    
+    // pack zero for radius
+    float radius = 0;
+    packetStream << radius;
+    
+    // pack 255 for attenuation byte
+    quint8 volume = MAX_INJECTOR_VOLUME * _options.getVolume();
+    packetStream << volume;
+    
+    _numPreAudioDataBytes = _injectAudioPacket.size();
+    _currentSendPosition = 0;
+    _hasSentLoopbackAudio = !_options.getLoopbackAudioInterface();
+    
+    return true;
+}
 
-            if (shouldLoop && currentSendPosition == soundByteArray.size()) {
-                currentSendPosition = 0;
-            }
-        }
+bool AudioInjector::injectNextFrame(const SharedNodePointer& audioMixer) {
+    if (_shouldStop) {
+        return false;
+    }
+    
+    if (!_hasSentLoopbackAudio && _sound->isFullyAvailable()) {
+        // give our sample byte array to the local audio interface, if we have it, so it can be handled locally
+        // assume that localAudioInterface could be on a separate thread, use Qt::AutoConnection to handle properly
+        QMetaObject::invokeMethod(_options.getLoopbackAudioInterface(), "handleAudioByteArray",
+                                  Qt::AutoConnection,
+                                  Q_ARG(QByteArray, _sound->getByteArray()));
+        _hasSentLoopbackAudio = true;
+    }
+    
+    // read the next NETWORK_BUFFER_LENGTH_SAMPLES_PER_CHANNEL samples straight into the packet
+    _injectAudioPacket.resize(_numPreAudioDataBytes + NETWORK_BUFFER_LENGTH_BYTES_PER_CHANNEL);
+    int16_t* packetSamples = reinterpret_cast<int16_t*>(_injectAudioPacket.data() + _numPreAudioDataBytes);
+    int samplesToCopy = _sound->readSamples(_currentSendPosition, packetSamples, NETWORK_BUFFER_LENGTH_SAMPLES_PER_CHANNEL);
+    
+    if (samplesToCopy == 0 && _currentSendPosition > 0 && _options.getLoop() && _sound->isComplete()) {
+        _currentSendPosition = 0;
+        samplesToCopy = _sound->readSamples(_currentSendPosition, packetSamples, NETWORK_BUFFER_LENGTH_SAMPLES_PER_CHANNEL);
+    }
+    
+    if (samplesToCopy == 0) {
+        // nothing to send this frame - either the sound is done, or the rest of it hasn't downloaded yet
+        return !_sound->isComplete();
     }
     
-    emit finished();
+    // resize the QByteArray to the right size
+    _injectAudioPacket.resize(_numPreAudioDataBytes + (samplesToCopy * sizeof(int16_t)));
+    
+    // pack the sequence number
+    memcpy(_injectAudioPacket.data() + _numPreSequenceNumberBytes, &_stream.nextSequenceNumber, sizeof(quint16));
+    
+    // send off this audio packet
+    NodeList::getInstance()->writeDatagram(_injectAudioPacket, audioMixer);
+    _stream.nextSequenceNumber++;
+    
+    _currentSendPosition += samplesToCopy;
+    return true;
 }
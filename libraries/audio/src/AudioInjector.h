@@ -14,27 +14,57 @@
 
 #include <QtCore/QObject>
 #include <QtCore/QThread>
+#include <QtCore/QUuid>
 
 #include <glm/glm.hpp>
 #include <glm/gtx/quaternion.hpp>
 
+#include <LimitedNodeList.h>
+
 #include "AudioInjectorOptions.h"
 #include "Sound.h"
 
+/// What the audio-mixer knows an injected stream by. The AudioInjectorManager hands the streams of finished injectors
+/// on to new ones, so that the mixer keeps mixing from the InjectedAudioRingBuffer it already has for the stream
+/// rather than making a new one for every short sound.
+struct AudioInjectorStream {
+    QUuid identifier;
+    quint16 nextSequenceNumber;
+};
+
 class AudioInjector : public QObject {
     Q_OBJECT
 public:
     AudioInjector(QObject* parent);
     AudioInjector(Sound* sound, const AudioInjectorOptions& injectorOptions);
 public slots:
+    /// hands the injector over to the AudioInjectorManager, which sends its frames along with those of every other
+    /// injector from a single thread
     void injectAudio();
     void stop() { _shouldStop = true; }
 signals:
     void finished();
 private:
+    friend class AudioInjectorManager;
+    
+    /// sets up the packets to send the sound in, returns false if there is nothing to inject
+    bool startInjection(const AudioInjectorStream& stream);
+    
+    /// sends the next frame of the sound to the audioMixer, returns false once there is nothing more to send
+    bool injectNextFrame(const SharedNodePointer& audioMixer);
+    
+    const AudioInjectorStream& getStream() const { return _stream; }
+    
     Sound* _sound;
     AudioInjectorOptions _options;
     bool _shouldStop;
+    
+    AudioInjectorStream _stream;
+    QByteArray _injectAudioPacket;
+    int _numPreSequenceNumberBytes;
+    int _numPreAudioDataBytes;
+    int _currentSendPosition;
+    bool _hasSentLoopbackAudio;
 };
 
 Q_DECLARE_METATYPE(AudioInjector*)
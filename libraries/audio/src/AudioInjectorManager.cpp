@@ -0,0 +1,142 @@
+//
+//  AudioInjectorManager.cpp
+//  libraries/audio/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#include <QtCore/QMutex>
+#include <QtCore/QMutexLocker>
+#include <QtCore/QThread>
+
+#include <NodeList.h>
+#include <SharedUtil.h>
+
+#include "AudioRingBuffer.h"
+
+#include "AudioInjectorManager.h"
+
+// the timer only checks whether a frame is due, the frames themselves are timed against the clock so that a late tick
+// delays a frame rather than losing it
+const int SEND_TIMER_INTERVAL_MSECS = BUFFER_SEND_INTERVAL_USECS / USECS_PER_MSEC / 4;
+
+// after a stall only this many of the missed frames are made up, the rest would just pile up in the mixer
+const int MAX_CATCH_UP_FRAMES = 2;
+
+// the mixer lets go of a stream about a second after it stops, which is about as many sounds as a busy script starts
+const int MAX_FINISHED_STREAMS = 64;
+
+// two frames go out as soon as an injector starts so the mixer can start playback right away
+const int NUM_INITIAL_FRAMES = 2;
+
+AudioInjectorManager* AudioInjectorManager::getInstance() {
+    static QMutex instanceMutex;
+    static AudioInjectorManager* instance = NULL;
+
+    QMutexLocker locker(&instanceMutex);
+    if (!instance) {
+        // the manager and its thread are never deleted, they last as long as the application does
+        instance = new AudioInjectorManager();
+
+        QThread* managerThread = new QThread();
+        managerThread->setObjectName("AudioInjectorManager");
+        instance->moveToThread(managerThread);
+        managerThread->start();
+    }
+    return instance;
+}
+
+AudioInjectorManager::AudioInjectorManager() :
+    _sendTimer(new QTimer(this)),
+    _frameTimer(),
+    _numFramesSent(0),
+    _injectors(),
+    _finishedStreams()
+{
+    qRegisterMetaType<AudioInjector*>("AudioInjector*");
+
+    _sendTimer->setTimerType(Qt::PreciseTimer);
+    _sendTimer->setInterval(SEND_TIMER_INTERVAL_MSECS);
+    connect(_sendTimer, &QTimer::timeout, this, &AudioInjectorManager::sendFrames);
+}
+
+void AudioInjectorManager::addInjector(AudioInjector* injector) {
+    // only the thread an object lives in can move it to another, so it is moved here before it is queued
+    injector->moveToThread(thread());
+    QMetaObject::invokeMethod(this, "startInjector", Qt::QueuedConnection, Q_ARG(AudioInjector*, injector));
+}
+
+void AudioInjectorManager::startInjector(AudioInjector* injector) {
+    AudioInjectorStream stream;
+    if (_finishedStreams.isEmpty()) {
+        stream.identifier = QUuid::createUuid();
+        stream.nextSequenceNumber = 0;
+    } else {
+        stream = _finishedStreams.takeLast();
+    }
+
+    if (!injector->startInjection(stream)) {
+        _finishedStreams.append(stream);
+        emit injector->finished();
+        return;
+    }
+
+    SharedNodePointer audioMixer = NodeList::getInstance()->soloNodeOfType(NodeType::AudioMixer);
+    for (int i = 0; i < NUM_INITIAL_FRAMES; i++) {
+        if (!injector->injectNextFrame(audioMixer)) {
+            finishInjector(injector);
+            return;
+        }
+    }
+
+    if (_injectors.isEmpty()) {
+        _frameTimer.start();
+        _numFramesSent = 0;
+        _sendTimer->start();
+    }
+    _injectors.append(injector);
+}
+
+void AudioInjectorManager::sendFrames() {
+    qint64 elapsedFrames = (_frameTimer.nsecsElapsed() / 1000) / BUFFER_SEND_INTERVAL_USECS;
+    int framesToSend = (int) qMin(elapsedFrames - _numFramesSent, (qint64) MAX_CATCH_UP_FRAMES);
+    _numFramesSent = elapsedFrames;
+
+    if (framesToSend <= 0) {
+        return;
+    }
+
+    // every injector sends to the same mixer, so it is looked up once for all of them
+    SharedNodePointer audioMixer = NodeList::getInstance()->soloNodeOfType(NodeType::AudioMixer);
+
+    int i = 0;
+    while (i < _injectors.size()) {
+        AudioInjector* injector = _injectors[i];
+
+        bool isInjecting = true;
+        for (int f = 0; f < framesToSend && isInjecting; f++) {
+            isInjecting = injector->injectNextFrame(audioMixer);
+        }
+
+        if (isInjecting) {
+            i++;
+        } else {
+            _injectors.removeAt(i);
+            finishInjector(injector);
+        }
+    }
+
+    if (_injectors.isEmpty()) {
+        _sendTimer->stop();
+    }
+}
+
+void AudioInjectorManager::finishInjector(AudioInjector* injector) {
+    if (_finishedStreams.size() < MAX_FINISHED_STREAMS) {
+        _finishedStreams.append(injector->getStream());
+    }
+    emit injector->finished();
+}
@@ -0,0 +1,49 @@
+//
+//  AudioInjectorManager.h
+//  libraries/audio/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#ifndef hifi_AudioInjectorManager_h
+#define hifi_AudioInjectorManager_h
+
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QList>
+#include <QtCore/QObject>
+#include <QtCore/QTimer>
+
+#include "AudioInjector.h"
+
+/// Sends the frames of every playing AudioInjector from one thread and one timer, instead of a thread that sleeps
+/// between frames for each injector. The audio-mixer is looked up once a frame for all of them, and the streams of
+/// finished injectors are handed on to the next ones to start.
+class AudioInjectorManager : public QObject {
+    Q_OBJECT
+public:
+    static AudioInjectorManager* getInstance();
+
+    /// starts sending the frames of the injector, which from then on belongs to the thread of the manager
+    void addInjector(AudioInjector* injector);
+
+private slots:
+    void startInjector(AudioInjector* injector);
+    void sendFrames();
+
+private:
+    AudioInjectorManager();
+
+    void finishInjector(AudioInjector* injector);
+
+    QTimer* _sendTimer;
+    QElapsedTimer _frameTimer;
+    qint64 _numFramesSent;
+
+    QList<AudioInjector*> _injectors;
+    QList<AudioInjectorStream> _finishedStreams;
+};
+
+#endif // hifi_AudioInjectorManager_h
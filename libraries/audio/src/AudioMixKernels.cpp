@@ -0,0 +1,403 @@
+//
+//  AudioMixKernels.cpp
+//  libraries/audio/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#include <limits>
+
+#include <QtCore/QtGlobal>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define HIFI_MIX_KERNELS_SSE2
+#include <emmintrin.h>
+#endif
+
+#if defined(__ARM_NEON__) || defined(__ARM_NEON)
+#define HIFI_MIX_KERNELS_NEON
+#include <arm_neon.h>
+#endif
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#endif
+
+#include "AudioMixKernels.h"
+
+const float MIX_KERNEL_MAX_SAMPLE = std::numeric_limits<int16_t>::max();
+const float MIX_KERNEL_MIN_SAMPLE = std::numeric_limits<int16_t>::min();
+
+static void addMonoToStereoFrames(float* mix, const int16_t* leftSamples, float leftGain,
+                                  const int16_t* rightSamples, float rightGain, int firstFrame, int numFrames) {
+    for (int i = firstFrame; i < numFrames; i++) {
+        mix[i * 2] += leftSamples[i] * leftGain;
+        mix[(i * 2) + 1] += rightSamples[i] * rightGain;
+    }
+}
+
+static void addInterleavedSamples(float* mix, const int16_t* samples, float gain, int firstSample, int numSamples) {
+    for (int i = firstSample; i < numSamples; i++) {
+        mix[i] += samples[i] * gain;
+    }
+}
+
+static void saturateMixSamples(int16_t* samples, const float* mix, int firstSample, int numSamples) {
+    for (int i = firstSample; i < numSamples; i++) {
+        // clamp before the conversion, like the min/max pair in the SIMD kernels, so nothing can overflow
+        float sample = (mix[i] > MIX_KERNEL_MAX_SAMPLE) ? MIX_KERNEL_MAX_SAMPLE
+            : ((mix[i] < MIX_KERNEL_MIN_SAMPLE) ? MIX_KERNEL_MIN_SAMPLE : mix[i]);
+        samples[i] = (int16_t) sample;
+    }
+}
+
+static void addConvolvedFrames(float* mix, const int16_t* samples, const float* leftFilter, const float* rightFilter,
+                               int numTaps, int firstFrame, int numFrames) {
+    for (int i = firstFrame; i < numFrames; i++) {
+        float left = 0.0f;
+        float right = 0.0f;
+        for (int t = 0; t < numTaps; t++) {
+            left += samples[i - t] * leftFilter[t];
+            right += samples[i - t] * rightFilter[t];
+        }
+        mix[i * 2] += left;
+        mix[(i * 2) + 1] += right;
+    }
+}
+
+// the SIMD convolutions convert a block of the source to float once and then run every tap over the block
+const int CONVOLUTION_BLOCK_FRAMES = 64;
+const int CONVOLUTION_BLOCK_SAMPLES = MAX_CONVOLUTION_TAPS - 1 + CONVOLUTION_BLOCK_FRAMES;
+
+/// converts numFrames samples and the numTaps - 1 samples in front of them, returns where the first frame landed
+static inline const float* fillConvolutionBlock(float* block, const int16_t* samples, int numTaps, int numFrames) {
+    for (int i = -(numTaps - 1); i < numFrames; i++) {
+        block[(numTaps - 1) + i] = samples[i];
+    }
+    return block + (numTaps - 1);
+}
+
+void AudioMixKernels::addMonoToStereoScalar(float* mix, const int16_t* leftSamples, float leftGain,
+                                            const int16_t* rightSamples, float rightGain, int numFrames) {
+    addMonoToStereoFrames(mix, leftSamples, leftGain, rightSamples, rightGain, 0, numFrames);
+}
+
+void AudioMixKernels::addInterleavedScalar(float* mix, const int16_t* samples, float gain, int numSamples) {
+    addInterleavedSamples(mix, samples, gain, 0, numSamples);
+}
+
+void AudioMixKernels::saturateMixScalar(int16_t* samples, const float* mix, int numSamples) {
+    saturateMixSamples(samples, mix, 0, numSamples);
+}
+
+void AudioMixKernels::addConvolvedMonoToStereoScalar(float* mix, const int16_t* samples, const float* leftFilter,
+                                                     const float* rightFilter, int numTaps, int numFrames) {
+    addConvolvedFrames(mix, samples, leftFilter, rightFilter, numTaps, 0, numFrames);
+}
+
+#ifdef HIFI_MIX_KERNELS_SSE2
+
+static inline __m128 lowSamplesToFloatSSE2(__m128i samples) {
+    // sign extend the four low int16 samples to int32 before the conversion
+    return _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(samples, samples), 16));
+}
+
+static inline __m128 highSamplesToFloatSSE2(__m128i samples) {
+    return _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(samples, samples), 16));
+}
+
+static void addMonoToStereoSSE2(float* mix, const int16_t* leftSamples, float leftGain,
+                                const int16_t* rightSamples, float rightGain, int numFrames) {
+    const int FRAMES_PER_ITERATION = 4;
+    __m128 leftGains = _mm_set1_ps(leftGain);
+    __m128 rightGains = _mm_set1_ps(rightGain);
+
+    int i = 0;
+    for (; i + FRAMES_PER_ITERATION <= numFrames; i += FRAMES_PER_ITERATION) {
+        __m128 left = _mm_mul_ps(lowSamplesToFloatSSE2(
+            _mm_loadl_epi64(reinterpret_cast<const __m128i*>(leftSamples + i))), leftGains);
+        __m128 right = _mm_mul_ps(lowSamplesToFloatSSE2(
+            _mm_loadl_epi64(reinterpret_cast<const __m128i*>(rightSamples + i))), rightGains);
+
+        // interleave the two channels into the four frames of the mix
+        float* mixAt = mix + (i * 2);
+        _mm_storeu_ps(mixAt, _mm_add_ps(_mm_loadu_ps(mixAt), _mm_unpacklo_ps(left, right)));
+        _mm_storeu_ps(mixAt + 4, _mm_add_ps(_mm_loadu_ps(mixAt + 4), _mm_unpackhi_ps(left, right)));
+    }
+
+    // handle the frames that don't fill a whole vector
+    addMonoToStereoFrames(mix, leftSamples, leftGain, rightSamples, rightGain, i, numFrames);
+}
+
+static void addInterleavedSSE2(float* mix, const int16_t* samples, float gain, int numSamples) {
+    const int SAMPLES_PER_ITERATION = 8;
+    __m128 gains = _mm_set1_ps(gain);
+
+    int i = 0;
+    for (; i + SAMPLES_PER_ITERATION <= numSamples; i += SAMPLES_PER_ITERATION) {
+        __m128i source = _mm_loadu_si128(reinterpret_cast<const __m128i*>(samples + i));
+
+        float* mixAt = mix + i;
+        _mm_storeu_ps(mixAt, _mm_add_ps(_mm_loadu_ps(mixAt), _mm_mul_ps(lowSamplesToFloatSSE2(source), gains)));
+        _mm_storeu_ps(mixAt + 4, _mm_add_ps(_mm_loadu_ps(mixAt + 4),
+                                            _mm_mul_ps(highSamplesToFloatSSE2(source), gains)));
+    }
+
+    addInterleavedSamples(mix, samples, gain, i, numSamples);
+}
+
+static void saturateMixSSE2(int16_t* samples, const float* mix, int numSamples) {
+    const int SAMPLES_PER_ITERATION = 8;
+    __m128 maxSamples = _mm_set1_ps(MIX_KERNEL_MAX_SAMPLE);
+    __m128 minSamples = _mm_set1_ps(MIX_KERNEL_MIN_SAMPLE);
+
+    int i = 0;
+    for (; i + SAMPLES_PER_ITERATION <= numSamples; i += SAMPLES_PER_ITERATION) {
+        __m128i low = _mm_cvttps_epi32(_mm_max_ps(_mm_min_ps(_mm_loadu_ps(mix + i), maxSamples), minSamples));
+        __m128i high = _mm_cvttps_epi32(_mm_max_ps(_mm_min_ps(_mm_loadu_ps(mix + i + 4), maxSamples), minSamples));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(samples + i), _mm_packs_epi32(low, high));
+    }
+
+    saturateMixSamples(samples, mix, i, numSamples);
+}
+
+static void addConvolvedMonoToStereoSSE2(float* mix, const int16_t* samples, const float* leftFilter,
+                                         const float* rightFilter, int numTaps, int numFrames) {
+    const int FRAMES_PER_ITERATION = 4;
+    float block[CONVOLUTION_BLOCK_SAMPLES];
+
+    for (int blockStart = 0; blockStart < numFrames; blockStart += CONVOLUTION_BLOCK_FRAMES) {
+        int blockFrames = qMin(CONVOLUTION_BLOCK_FRAMES, numFrames - blockStart);
+        const float* blockAt = fillConvolutionBlock(block, samples + blockStart, numTaps, blockFrames);
+        float* blockMix = mix + (blockStart * 2);
+
+        int i = 0;
+        for (; i + FRAMES_PER_ITERATION <= blockFrames; i += FRAMES_PER_ITERATION) {
+            // four output frames at a time, each tap scales the four samples it reaches back to
+            __m128 left = _mm_setzero_ps();
+            __m128 right = _mm_setzero_ps();
+            for (int t = 0; t < numTaps; t++) {
+                __m128 source = _mm_loadu_ps(blockAt + i - t);
+                left = _mm_add_ps(left, _mm_mul_ps(source, _mm_set1_ps(leftFilter[t])));
+                right = _mm_add_ps(right, _mm_mul_ps(source, _mm_set1_ps(rightFilter[t])));
+            }
+
+            float* mixAt = blockMix + (i * 2);
+            _mm_storeu_ps(mixAt, _mm_add_ps(_mm_loadu_ps(mixAt), _mm_unpacklo_ps(left, right)));
+            _mm_storeu_ps(mixAt + 4, _mm_add_ps(_mm_loadu_ps(mixAt + 4), _mm_unpackhi_ps(left, right)));
+        }
+
+        addConvolvedFrames(blockMix, samples + blockStart, leftFilter, rightFilter, numTaps, i, blockFrames);
+    }
+}
+
+#endif // HIFI_MIX_KERNELS_SSE2
+
+#ifdef HIFI_MIX_KERNELS_NEON
+
+static inline float32x4_t samplesToFloatNEON(int16x4_t samples) {
+    return vcvtq_f32_s32(vmovl_s16(samples));
+}
+
+static void addMonoToStereoNEON(float* mix, const int16_t* leftSamples, float leftGain,
+                                const int16_t* rightSamples, float rightGain, int numFrames) {
+    const int FRAMES_PER_ITERATION = 4;
+
+    int i = 0;
+    for (; i + FRAMES_PER_ITERATION <= numFrames; i += FRAMES_PER_ITERATION) {
+        // vld2/vst2 de-interleave and re-interleave the stereo mix for us
+        float32x4x2_t stereo = vld2q_f32(mix + (i * 2));
+        stereo.val[0] = vaddq_f32(stereo.val[0],
+                                  vmulq_n_f32(samplesToFloatNEON(vld1_s16(leftSamples + i)), leftGain));
+        stereo.val[1] = vaddq_f32(stereo.val[1],
+                                  vmulq_n_f32(samplesToFloatNEON(vld1_s16(rightSamples + i)), rightGain));
+        vst2q_f32(mix + (i * 2), stereo);
+    }
+
+    // handle the frames that don't fill a whole vector
+    addMonoToStereoFrames(mix, leftSamples, leftGain, rightSamples, rightGain, i, numFrames);
+}
+
+static void addInterleavedNEON(float* mix, const int16_t* samples, float gain, int numSamples) {
+    const int SAMPLES_PER_ITERATION = 8;
+
+    int i = 0;
+    for (; i + SAMPLES_PER_ITERATION <= numSamples; i += SAMPLES_PER_ITERATION) {
+        int16x8_t source = vld1q_s16(samples + i);
+        vst1q_f32(mix + i, vaddq_f32(vld1q_f32(mix + i), vmulq_n_f32(samplesToFloatNEON(vget_low_s16(source)), gain)));
+        vst1q_f32(mix + i + 4, vaddq_f32(vld1q_f32(mix + i + 4),
+                                         vmulq_n_f32(samplesToFloatNEON(vget_high_s16(source)), gain)));
+    }
+
+    addInterleavedSamples(mix, samples, gain, i, numSamples);
+}
+
+static void saturateMixNEON(int16_t* samples, const float* mix, int numSamples) {
+    const int SAMPLES_PER_ITERATION = 8;
+    float32x4_t maxSamples = vdupq_n_f32(MIX_KERNEL_MAX_SAMPLE);
+    float32x4_t minSamples = vdupq_n_f32(MIX_KERNEL_MIN_SAMPLE);
+
+    int i = 0;
+    for (; i + SAMPLES_PER_ITERATION <= numSamples; i += SAMPLES_PER_ITERATION) {
+        // vcvtq_s32_f32 truncates towards zero, matching the scalar kernel
+        int32x4_t low = vcvtq_s32_f32(vmaxq_f32(vminq_f32(vld1q_f32(mix + i), maxSamples), minSamples));
+        int32x4_t high = vcvtq_s32_f32(vmaxq_f32(vminq_f32(vld1q_f32(mix + i + 4), maxSamples), minSamples));
+        vst1q_s16(samples + i, vcombine_s16(vmovn_s32(low), vmovn_s32(high)));
+    }
+
+    saturateMixSamples(samples, mix, i, numSamples);
+}
+
+static void addConvolvedMonoToStereoNEON(float* mix, const int16_t* samples, const float* leftFilter,
+                                         const float* rightFilter, int numTaps, int numFrames) {
+    const int FRAMES_PER_ITERATION = 4;
+    float block[CONVOLUTION_BLOCK_SAMPLES];
+
+    for (int blockStart = 0; blockStart < numFrames; blockStart += CONVOLUTION_BLOCK_FRAMES) {
+        int blockFrames = qMin(CONVOLUTION_BLOCK_FRAMES, numFrames - blockStart);
+        const float* blockAt = fillConvolutionBlock(block, samples + blockStart, numTaps, blockFrames);
+        float* blockMix = mix + (blockStart * 2);
+
+        int i = 0;
+        for (; i + FRAMES_PER_ITERATION <= blockFrames; i += FRAMES_PER_ITERATION) {
+            float32x4x2_t stereo = vld2q_f32(blockMix + (i * 2));
+            for (int t = 0; t < numTaps; t++) {
+                float32x4_t source = vld1q_f32(blockAt + i - t);
+                stereo.val[0] = vaddq_f32(stereo.val[0], vmulq_n_f32(source, leftFilter[t]));
+                stereo.val[1] = vaddq_f32(stereo.val[1], vmulq_n_f32(source, rightFilter[t]));
+            }
+            vst2q_f32(blockMix + (i * 2), stereo);
+        }
+
+        addConvolvedFrames(blockMix, samples + blockStart, leftFilter, rightFilter, numTaps, i, blockFrames);
+    }
+}
+
+#endif // HIFI_MIX_KERNELS_NEON
+
+static bool cpuSupportsAVX2() {
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+    int cpuInfo[4];
+    __cpuid(cpuInfo, 0);
+    if (cpuInfo[0] < 7) {
+        return false;
+    }
+
+    // the OS has to be saving the YMM registers for us as well
+    __cpuid(cpuInfo, 1);
+    const int OSXSAVE_BIT = 1 << 27;
+    const int AVX_BIT = 1 << 28;
+    if ((cpuInfo[2] & OSXSAVE_BIT) == 0 || (cpuInfo[2] & AVX_BIT) == 0 || (_xgetbv(0) & 0x6) != 0x6) {
+        return false;
+    }
+
+    const int AVX2_BIT = 1 << 5;
+    __cpuidex(cpuInfo, 7, 0);
+    return (cpuInfo[1] & AVX2_BIT) != 0;
+#elif defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+#else
+    return false;
+#endif
+}
+
+AudioMixKernels::Implementation AudioMixKernels::_implementation = AudioMixKernels::Scalar;
+MonoToStereoMixKernel AudioMixKernels::_monoToStereo = AudioMixKernels::addMonoToStereoScalar;
+InterleavedMixKernel AudioMixKernels::_interleaved = AudioMixKernels::addInterleavedScalar;
+SaturateMixKernel AudioMixKernels::_saturate = AudioMixKernels::saturateMixScalar;
+ConvolvedMixKernel AudioMixKernels::_convolved = AudioMixKernels::addConvolvedMonoToStereoScalar;
+
+// pick the best kernels once, when the library is loaded, before any mixer can run
+static bool hasSelectedBestKernels = AudioMixKernels::setImplementation(AudioMixKernels::getBestImplementation());
+
+const char* AudioMixKernels::getImplementationName(Implementation implementation) {
+    switch (implementation) {
+        case SSE2:
+            return "sse2";
+        case AVX2:
+            return "avx2";
+        case NEON:
+            return "neon";
+        default:
+            return "scalar";
+    }
+}
+
+bool AudioMixKernels::isSupported(Implementation implementation) {
+    switch (implementation) {
+        case Scalar:
+            return true;
+        case SSE2:
+#ifdef HIFI_MIX_KERNELS_SSE2
+            return true;
+#else
+            return false;
+#endif
+        case AVX2:
+            return hasAVX2Kernels() && cpuSupportsAVX2();
+        case NEON:
+#ifdef HIFI_MIX_KERNELS_NEON
+            return true;
+#else
+            return false;
+#endif
+        default:
+            return false;
+    }
+}
+
+AudioMixKernels::Implementation AudioMixKernels::getBestImplementation() {
+    if (isSupported(AVX2)) {
+        return AVX2;
+    } else if (isSupported(SSE2)) {
+        return SSE2;
+    } else if (isSupported(NEON)) {
+        return NEON;
+    } else {
+        return Scalar;
+    }
+}
+
+bool AudioMixKernels::setImplementation(Implementation implementation) {
+    if (!isSupported(implementation)) {
+        return false;
+    }
+
+    switch (implementation) {
+#ifdef HIFI_MIX_KERNELS_SSE2
+        case SSE2:
+            _monoToStereo = addMonoToStereoSSE2;
+            _interleaved = addInterleavedSSE2;
+            _saturate = saturateMixSSE2;
+            _convolved = addConvolvedMonoToStereoSSE2;
+            break;
+#endif
+        case AVX2:
+            _monoToStereo = addMonoToStereoAVX2;
+            _interleaved = addInterleavedAVX2;
+            _saturate = saturateMixAVX2;
+            _convolved = addConvolvedMonoToStereoAVX2;
+            break;
+#ifdef HIFI_MIX_KERNELS_NEON
+        case NEON:
+            _monoToStereo = addMonoToStereoNEON;
+            _interleaved = addInterleavedNEON;
+            _saturate = saturateMixNEON;
+            _convolved = addConvolvedMonoToStereoNEON;
+            break;
+#endif
+        default:
+            _monoToStereo = addMonoToStereoScalar;
+            _interleaved = addInterleavedScalar;
+            _saturate = saturateMixScalar;
+            _convolved = addConvolvedMonoToStereoScalar;
+            break;
+    }
+
+    _implementation = implementation;
+    return true;
+}
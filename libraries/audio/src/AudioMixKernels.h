@@ -0,0 +1,94 @@
+//
+//  AudioMixKernels.h
+//  libraries/audio/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#ifndef hifi_AudioMixKernels_h
+#define hifi_AudioMixKernels_h
+
+#include <stdint.h>
+
+typedef void (*MonoToStereoMixKernel)(float* mix, const int16_t* leftSamples, float leftGain,
+                                      const int16_t* rightSamples, float rightGain, int numFrames);
+typedef void (*InterleavedMixKernel)(float* mix, const int16_t* samples, float gain, int numSamples);
+typedef void (*SaturateMixKernel)(int16_t* samples, const float* mix, int numSamples);
+typedef void (*ConvolvedMixKernel)(float* mix, const int16_t* samples, const float* leftFilter,
+                                   const float* rightFilter, int numTaps, int numFrames);
+
+// the convolution reads up to this many samples in front of the first frame it mixes, less one
+const int MAX_CONVOLUTION_TAPS = 64;
+
+/// Accumulates attenuated source samples into an interleaved float stereo mix, and converts a finished mix back to
+/// int16 with a single saturation stage. The best kernel for the running CPU (AVX2 or SSE2 on x86, NEON on ARM) is
+/// picked when the library loads.
+class AudioMixKernels {
+public:
+    enum Implementation {
+        Scalar,
+        SSE2,
+        AVX2,
+        NEON
+    };
+
+    /// adds numFrames of two mono sources to the left and right channels of an interleaved stereo mix
+    static void addMonoToStereo(float* mix, const int16_t* leftSamples, float leftGain,
+                                const int16_t* rightSamples, float rightGain, int numFrames) {
+        _monoToStereo(mix, leftSamples, leftGain, rightSamples, rightGain, numFrames);
+    }
+
+    /// adds numSamples of an interleaved source to an interleaved mix with the same channel layout
+    static void addInterleaved(float* mix, const int16_t* samples, float gain, int numSamples) {
+        _interleaved(mix, samples, gain, numSamples);
+    }
+
+    /// adds numFrames of a mono source to an interleaved stereo mix through a different FIR filter for each channel
+    /// the filters are in tap order and samples[-(numTaps - 1)] to samples[-1] must be readable
+    static void addConvolvedMonoToStereo(float* mix, const int16_t* samples, const float* leftFilter,
+                                         const float* rightFilter, int numTaps, int numFrames) {
+        _convolved(mix, samples, leftFilter, rightFilter, numTaps, numFrames);
+    }
+
+    /// truncates and saturates numSamples of a finished mix to int16 samples
+    static void saturateMix(int16_t* samples, const float* mix, int numSamples) {
+        _saturate(samples, mix, numSamples);
+    }
+
+    static Implementation getImplementation() { return _implementation; }
+    static const char* getImplementationName(Implementation implementation);
+
+    static bool isSupported(Implementation implementation);
+    static Implementation getBestImplementation();
+
+    /// switches the kernels used by every mixer in the process, returns false if the CPU does not support them
+    static bool setImplementation(Implementation implementation);
+
+private:
+    static void addMonoToStereoScalar(float* mix, const int16_t* leftSamples, float leftGain,
+                                      const int16_t* rightSamples, float rightGain, int numFrames);
+    static void addInterleavedScalar(float* mix, const int16_t* samples, float gain, int numSamples);
+    static void saturateMixScalar(int16_t* samples, const float* mix, int numSamples);
+    static void addConvolvedMonoToStereoScalar(float* mix, const int16_t* samples, const float* leftFilter,
+                                               const float* rightFilter, int numTaps, int numFrames);
+
+    // defined in AudioMixKernelsAVX2.cpp, the only translation unit built with AVX2 code generation
+    static bool hasAVX2Kernels();
+    static void addMonoToStereoAVX2(float* mix, const int16_t* leftSamples, float leftGain,
+                                    const int16_t* rightSamples, float rightGain, int numFrames);
+    static void addInterleavedAVX2(float* mix, const int16_t* samples, float gain, int numSamples);
+    static void saturateMixAVX2(int16_t* samples, const float* mix, int numSamples);
+    static void addConvolvedMonoToStereoAVX2(float* mix, const int16_t* samples, const float* leftFilter,
+                                             const float* rightFilter, int numTaps, int numFrames);
+
+    static Implementation _implementation;
+    static MonoToStereoMixKernel _monoToStereo;
+    static InterleavedMixKernel _interleaved;
+    static SaturateMixKernel _saturate;
+    static ConvolvedMixKernel _convolved;
+};
+
+#endif // hifi_AudioMixKernels_h
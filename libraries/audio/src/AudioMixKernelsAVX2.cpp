@@ -0,0 +1,162 @@
+//
+//  AudioMixKernelsAVX2.cpp
+//  libraries/audio/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+//  This file is built with AVX2 code generation enabled (see the audio CMakeLists.txt). Keep its includes to the
+//  intrinsics so that no shared inline code gets compiled with instructions older CPUs can't run.
+//
+
+#include "AudioMixKernels.h"
+
+#ifdef __AVX2__
+
+#include <immintrin.h>
+
+const float AVX2_MAX_SAMPLE = 32767.0f;
+const float AVX2_MIN_SAMPLE = -32768.0f;
+
+static inline __m256 samplesToFloatAVX2(const int16_t* samples) {
+    return _mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(samples))));
+}
+
+bool AudioMixKernels::hasAVX2Kernels() {
+    return true;
+}
+
+void AudioMixKernels::addMonoToStereoAVX2(float* mix, const int16_t* leftSamples, float leftGain,
+                                          const int16_t* rightSamples, float rightGain, int numFrames) {
+    const int FRAMES_PER_ITERATION = 8;
+    __m256 leftGains = _mm256_set1_ps(leftGain);
+    __m256 rightGains = _mm256_set1_ps(rightGain);
+
+    int i = 0;
+    for (; i + FRAMES_PER_ITERATION <= numFrames; i += FRAMES_PER_ITERATION) {
+        __m256 left = _mm256_mul_ps(samplesToFloatAVX2(leftSamples + i), leftGains);
+        __m256 right = _mm256_mul_ps(samplesToFloatAVX2(rightSamples + i), rightGains);
+
+        // the unpacks work within 128-bit lanes, so the low halves of both hold frames 0 - 3
+        // and the high halves hold frames 4 - 7
+        __m256 low = _mm256_unpacklo_ps(left, right);
+        __m256 high = _mm256_unpackhi_ps(left, right);
+
+        const int LOW_HALVES = 0x20;
+        const int HIGH_HALVES = 0x31;
+        float* mixAt = mix + (i * 2);
+        _mm256_storeu_ps(mixAt, _mm256_add_ps(_mm256_loadu_ps(mixAt), _mm256_permute2f128_ps(low, high, LOW_HALVES)));
+        _mm256_storeu_ps(mixAt + 8, _mm256_add_ps(_mm256_loadu_ps(mixAt + 8),
+                                                  _mm256_permute2f128_ps(low, high, HIGH_HALVES)));
+    }
+
+    // handle the frames that don't fill a whole vector
+    addMonoToStereoScalar(mix + (i * 2), leftSamples + i, leftGain, rightSamples + i, rightGain, numFrames - i);
+}
+
+void AudioMixKernels::addInterleavedAVX2(float* mix, const int16_t* samples, float gain, int numSamples) {
+    const int SAMPLES_PER_ITERATION = 8;
+    __m256 gains = _mm256_set1_ps(gain);
+
+    int i = 0;
+    for (; i + SAMPLES_PER_ITERATION <= numSamples; i += SAMPLES_PER_ITERATION) {
+        _mm256_storeu_ps(mix + i, _mm256_add_ps(_mm256_loadu_ps(mix + i),
+                                                _mm256_mul_ps(samplesToFloatAVX2(samples + i), gains)));
+    }
+
+    addInterleavedScalar(mix + i, samples + i, gain, numSamples - i);
+}
+
+void AudioMixKernels::saturateMixAVX2(int16_t* samples, const float* mix, int numSamples) {
+    const int SAMPLES_PER_ITERATION = 16;
+    __m256 maxSamples = _mm256_set1_ps(AVX2_MAX_SAMPLE);
+    __m256 minSamples = _mm256_set1_ps(AVX2_MIN_SAMPLE);
+
+    int i = 0;
+    for (; i + SAMPLES_PER_ITERATION <= numSamples; i += SAMPLES_PER_ITERATION) {
+        __m256i first = _mm256_cvttps_epi32(_mm256_max_ps(_mm256_min_ps(_mm256_loadu_ps(mix + i), maxSamples),
+                                                          minSamples));
+        __m256i second = _mm256_cvttps_epi32(_mm256_max_ps(_mm256_min_ps(_mm256_loadu_ps(mix + i + 8), maxSamples),
+                                                           minSamples));
+
+        // the in-lane pack leaves the 64-bit quarters ordered 0, 2, 1, 3 - put them back in sample order
+        const int IN_ORDER_QUARTERS = 0xD8;
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(samples + i),
+                            _mm256_permute4x64_epi64(_mm256_packs_epi32(first, second), IN_ORDER_QUARTERS));
+    }
+
+    saturateMixScalar(samples + i, mix + i, numSamples - i);
+}
+
+void AudioMixKernels::addConvolvedMonoToStereoAVX2(float* mix, const int16_t* samples, const float* leftFilter,
+                                                   const float* rightFilter, int numTaps, int numFrames) {
+    const int FRAMES_PER_ITERATION = 8;
+    const int BLOCK_FRAMES = 64;
+    float block[MAX_CONVOLUTION_TAPS - 1 + BLOCK_FRAMES];
+
+    for (int blockStart = 0; blockStart < numFrames; blockStart += BLOCK_FRAMES) {
+        int blockFrames = (numFrames - blockStart < BLOCK_FRAMES) ? numFrames - blockStart : BLOCK_FRAMES;
+
+        // convert the block and the samples the filters reach back to once, then run every tap over it
+        const int16_t* blockSamples = samples + blockStart;
+        for (int i = -(numTaps - 1); i < blockFrames; i++) {
+            block[(numTaps - 1) + i] = blockSamples[i];
+        }
+        const float* blockAt = block + (numTaps - 1);
+        float* blockMix = mix + (blockStart * 2);
+
+        int i = 0;
+        for (; i + FRAMES_PER_ITERATION <= blockFrames; i += FRAMES_PER_ITERATION) {
+            __m256 left = _mm256_setzero_ps();
+            __m256 right = _mm256_setzero_ps();
+            for (int t = 0; t < numTaps; t++) {
+                __m256 source = _mm256_loadu_ps(blockAt + i - t);
+                left = _mm256_add_ps(left, _mm256_mul_ps(source, _mm256_set1_ps(leftFilter[t])));
+                right = _mm256_add_ps(right, _mm256_mul_ps(source, _mm256_set1_ps(rightFilter[t])));
+            }
+
+            // same lane shuffle as addMonoToStereoAVX2
+            __m256 low = _mm256_unpacklo_ps(left, right);
+            __m256 high = _mm256_unpackhi_ps(left, right);
+
+            const int LOW_HALVES = 0x20;
+            const int HIGH_HALVES = 0x31;
+            float* mixAt = blockMix + (i * 2);
+            _mm256_storeu_ps(mixAt, _mm256_add_ps(_mm256_loadu_ps(mixAt),
+                                                  _mm256_permute2f128_ps(low, high, LOW_HALVES)));
+            _mm256_storeu_ps(mixAt + 8, _mm256_add_ps(_mm256_loadu_ps(mixAt + 8),
+                                                      _mm256_permute2f128_ps(low, high, HIGH_HALVES)));
+        }
+
+        addConvolvedMonoToStereoScalar(blockMix + (i * 2), blockSamples + i, leftFilter, rightFilter, numTaps,
+                                       blockFrames - i);
+    }
+}
+
+#else
+
+bool AudioMixKernels::hasAVX2Kernels() {
+    return false;
+}
+
+void AudioMixKernels::addMonoToStereoAVX2(float* mix, const int16_t* leftSamples, float leftGain,
+                                          const int16_t* rightSamples, float rightGain, int numFrames) {
+    addMonoToStereoScalar(mix, leftSamples, leftGain, rightSamples, rightGain, numFrames);
+}
+
+void AudioMixKernels::addInterleavedAVX2(float* mix, const int16_t* samples, float gain, int numSamples) {
+    addInterleavedScalar(mix, samples, gain, numSamples);
+}
+
+void AudioMixKernels::saturateMixAVX2(int16_t* samples, const float* mix, int numSamples) {
+    saturateMixScalar(samples, mix, numSamples);
+}
+
+void AudioMixKernels::addConvolvedMonoToStereoAVX2(float* mix, const int16_t* samples, const float* leftFilter,
+                                                   const float* rightFilter, int numTaps, int numFrames) {
+    addConvolvedMonoToStereoScalar(mix, samples, leftFilter, rightFilter, numTaps, numFrames);
+}
+
+#endif // __AVX2__
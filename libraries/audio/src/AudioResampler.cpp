@@ -0,0 +1,149 @@
+//
+//  AudioResampler.cpp
+//  libraries/audio/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#include <cstring>
+#include <math.h>
+
+#include <QtCore/QtGlobal>
+
+#include <SharedUtil.h>
+
+#include "AudioResampler.h"
+
+// taps of each phase when the rates are about the same, downsampling needs more the further it goes
+const int MIN_TAPS_PER_PHASE = 16;
+const int MAX_TAPS_PER_PHASE = 128;
+
+// the cutoff sits a little under the lower nyquist so that the transition band is stopped by the time it is reached
+const float CUTOFF_RATIO = 0.9f;
+
+// only the first two channels are filtered, any channels above them are put out silent
+const int MAX_FILTERED_CHANNELS = 2;
+
+static int greatestCommonDivisor(int a, int b) {
+    while (b != 0) {
+        int remainder = a % b;
+        a = b;
+        b = remainder;
+    }
+    return a;
+}
+
+AudioResampler::AudioResampler(int sourceSampleRate, int sourceChannels, int destinationSampleRate,
+                               int destinationChannels, int maxSourceFramesPerChunk) :
+    _sourceChannels(sourceChannels),
+    _destinationChannels(destinationChannels),
+    _upFactor(destinationSampleRate / greatestCommonDivisor(sourceSampleRate, destinationSampleRate)),
+    _downFactor(sourceSampleRate / greatestCommonDivisor(sourceSampleRate, destinationSampleRate)),
+    _numTaps(1),
+    _maxSourceFramesPerChunk(maxSourceFramesPerChunk),
+    _coefficients(),
+    _frames(),
+    _phase(0),
+    _nextFrame(0)
+{
+    if (_upFactor == _downFactor) {
+        // the same rate only needs its channels converted
+        _coefficients.fill(1.0f, 1);
+
+    } else {
+        int downsamplingRatio = (_downFactor + _upFactor - 1) / _upFactor;
+        _numTaps = qBound(MIN_TAPS_PER_PHASE, MIN_TAPS_PER_PHASE * downsamplingRatio, MAX_TAPS_PER_PHASE);
+
+        // the prototype low pass runs at the upsampled rate, the cutoff in cycles per sample of that rate
+        int filterLength = _numTaps * _upFactor;
+        float cutoff = 0.5f * CUTOFF_RATIO / qMax(_upFactor, _downFactor);
+        float center = (filterLength - 1) / 2.0f;
+
+        _coefficients.resize(filterLength);
+        for (int phase = 0; phase < _upFactor; phase++) {
+            for (int tap = 0; tap < _numTaps; tap++) {
+                // each phase is stored oldest frame first, so that it runs forward through the frames it filters
+                int j = ((_numTaps - 1 - tap) * _upFactor) + phase;
+                float x = j - center;
+                float sinc = (x == 0.0f) ? 1.0f : sinf(PI * 2.0f * cutoff * x) / (PI * 2.0f * cutoff * x);
+                float window = 0.42f - 0.5f * cosf(TWO_PI * j / (filterLength - 1))
+                    + 0.08f * cosf(2.0f * TWO_PI * j / (filterLength - 1));
+
+                // the upsampling puts zeros between the frames, which the gain of the up factor makes up for
+                _coefficients[(phase * _numTaps) + tap] = 2.0f * cutoff * sinc * window * _upFactor;
+            }
+        }
+    }
+
+    int filteredChannels = qMin(_destinationChannels, MAX_FILTERED_CHANNELS);
+    _frames.resize((_numTaps - 1 + _maxSourceFramesPerChunk) * filteredChannels);
+    reset();
+}
+
+int AudioResampler::getMaxDestinationFrames(int numSourceFrames) const {
+    return (int) ((((qint64) numSourceFrames * _upFactor) + _downFactor - 1) / _downFactor) + 1;
+}
+
+void AudioResampler::reset() {
+    _frames.fill(0.0f);
+    _phase = 0;
+    _nextFrame = 0;
+}
+
+int AudioResampler::resample(const int16_t* source, int numSourceFrames, int16_t* destination) {
+    int numDestinationFrames = 0;
+    while (numSourceFrames > 0) {
+        int numChunkFrames = qMin(numSourceFrames, _maxSourceFramesPerChunk);
+        numDestinationFrames += resampleChunk(source, numChunkFrames,
+                                              destination + (numDestinationFrames * _destinationChannels));
+        source += numChunkFrames * _sourceChannels;
+        numSourceFrames -= numChunkFrames;
+    }
+    return numDestinationFrames;
+}
+
+int AudioResampler::resampleChunk(const int16_t* source, int numSourceFrames, int16_t* destination) {
+    int filteredChannels = qMin(_destinationChannels, MAX_FILTERED_CHANNELS);
+    int historySamples = (_numTaps - 1) * filteredChannels;
+
+    // the channels are converted on the way in, so that there are no more of them to filter than will be put out
+    float* frames = _frames.data() + historySamples;
+    for (int i = 0; i < numSourceFrames; i++, source += _sourceChannels) {
+        if (filteredChannels == 1) {
+            frames[i] = (_sourceChannels == 1) ? source[0] : (source[0] + source[1]) / 2.0f;
+        } else {
+            frames[2 * i] = source[0];
+            frames[(2 * i) + 1] = (_sourceChannels == 1) ? source[0] : source[1];
+        }
+    }
+
+    int numDestinationFrames = 0;
+    while (_nextFrame < numSourceFrames) {
+        const float* coefficients = _coefficients.constData() + (_phase * _numTaps);
+        const float* filterFrames = _frames.constData() + (_nextFrame * filteredChannels);
+
+        for (int channel = 0; channel < _destinationChannels; channel++) {
+            float sample = 0.0f;
+            if (channel < filteredChannels) {
+                for (int tap = 0; tap < _numTaps; tap++) {
+                    sample += coefficients[tap] * filterFrames[(tap * filteredChannels) + channel];
+                }
+            }
+            *destination++ = (int16_t) qBound(-32768.0f, floorf(sample + 0.5f), 32767.0f);
+        }
+        numDestinationFrames++;
+
+        _phase += _downFactor;
+        _nextFrame += _phase / _upFactor;
+        _phase %= _upFactor;
+    }
+    _nextFrame -= numSourceFrames;
+
+    // the last frames of this chunk are the history of the next
+    memmove(_frames.data(), _frames.constData() + (numSourceFrames * filteredChannels), historySamples * sizeof(float));
+
+    return numDestinationFrames;
+}
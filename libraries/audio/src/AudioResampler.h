@@ -0,0 +1,59 @@
+//
+//  AudioResampler.h
+//  libraries/audio/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#ifndef hifi_AudioResampler_h
+#define hifi_AudioResampler_h
+
+#include <stdint.h>
+
+#include <QtCore/QVector>
+
+/// Converts interleaved 16 bit audio from one sample rate and channel count to another with a polyphase windowed sinc
+/// filter, for any ratio of the two rates rather than only the multiples of two a device usually has. The filter
+/// history is kept between calls so that a stream can come in any size of chunk, and every buffer is allocated up
+/// front, so resampling itself never allocates. Only the first two channels of a source with more are used.
+class AudioResampler {
+public:
+    AudioResampler(int sourceSampleRate, int sourceChannels, int destinationSampleRate, int destinationChannels,
+                   int maxSourceFramesPerChunk = 1024);
+
+    int getSourceChannels() const { return _sourceChannels; }
+    int getDestinationChannels() const { return _destinationChannels; }
+
+    /// the most frames resample can put out for numSourceFrames, which the destination needs to have room for
+    int getMaxDestinationFrames(int numSourceFrames) const;
+
+    /// the delay the filter adds, in source frames
+    int getLatencyFrames() const { return _numTaps / 2; }
+
+    /// resamples numSourceFrames frames of source into destination and returns the number of frames put out
+    int resample(const int16_t* source, int numSourceFrames, int16_t* destination);
+
+    /// forgets the history of the stream so far
+    void reset();
+
+private:
+    int resampleChunk(const int16_t* source, int numSourceFrames, int16_t* destination);
+
+    int _sourceChannels;
+    int _destinationChannels;
+    int _upFactor;
+    int _downFactor;
+    int _numTaps;
+    int _maxSourceFramesPerChunk;
+
+    QVector<float> _coefficients; /// _numTaps coefficients for each of the _upFactor phases
+    QVector<float> _frames; /// the last _numTaps - 1 frames and then the current chunk, in destination channels
+
+    int _phase;
+    int _nextFrame;
+};
+
+#endif // hifi_AudioResampler_h
@@ -16,6 +16,7 @@
 #include <QtCore/QDebug>
 
 #include "PacketHeaders.h"
+#include "AudioCodec.h"
 #include "AudioRingBuffer.h"
 
 
@@ -70,7 +71,24 @@ void AudioRingBuffer::resizeForFrameSize(int numFrameSamples) {
 int AudioRingBuffer::parseData(const QByteArray& packet) {
     // skip packet header and sequence number
     int numBytesBeforeAudioData = numBytesForPacketHeader(packet) + sizeof(quint16);
-    return writeData(packet.data() + numBytesBeforeAudioData, packet.size() - numBytesBeforeAudioData);
+    
+    if (packetTypeForPacket(packet) == PacketTypeSilentMixedAudio) {
+        // the audio-mixer had nothing for us to hear, it only tells us how many silent samples to play
+        int16_t numSilentSamples;
+        memcpy(&numSilentSamples, packet.data() + numBytesBeforeAudioData, sizeof(int16_t));
+        addSilentFrame(numSilentSamples);
+        
+        return numBytesBeforeAudioData + sizeof(int16_t);
+    }
+    
+    // the codec the audio-mixer encoded this mix with follows the sequence number
+    quint8 codec = packet.at(numBytesBeforeAudioData);
+    numBytesBeforeAudioData += sizeof(quint8);
+    
+    // mixed audio from the audio-mixer is always stereo
+    const int NUM_MIXED_AUDIO_CHANNELS = 2;
+    return numBytesBeforeAudioData + writeEncodedData(codec, packet.data() + numBytesBeforeAudioData,
+                                                      packet.size() - numBytesBeforeAudioData, NUM_MIXED_AUDIO_CHANNELS);
 }
 
 int AudioRingBuffer::readSamples(int16_t* destination, int maxSamples) {
@@ -155,6 +173,25 @@ int AudioRingBuffer::writeData(const char* data, int maxSize) {
     return samplesToCopy * sizeof(int16_t);
 }
 
+int AudioRingBuffer::writeEncodedData(quint8 codec, const char* data, int maxSize, int numChannels) {
+    if (codec == AudioCodec::PCM) {
+        return writeData(data, maxSize);
+    }
+    
+    if (!AudioCodec::isKnownType(codec)) {
+        qDebug() << "Dropping audio encoded with unknown codec" << codec;
+        return maxSize;
+    }
+    
+    // a network packet never carries more than one stereo frame
+    int16_t decodedSamples[NETWORK_BUFFER_LENGTH_SAMPLES_STEREO];
+    int numDecodedSamples = AudioCodec::decode((AudioCodec::Type) codec, data, maxSize, numChannels, decodedSamples,
+                                               std::min(_sampleCapacity, NETWORK_BUFFER_LENGTH_SAMPLES_STEREO));
+    writeSamples(decodedSamples, numDecodedSamples);
+    
+    return maxSize;
+}
+
 int16_t& AudioRingBuffer::operator[](const int index) {
     return *shiftedPositionAccomodatingWrap(_nextOutput, index);
 }
@@ -59,6 +59,10 @@ public:
     int readData(char* data, int maxSize);
     int writeData(const char* data, int maxSize);
     
+    /// decodes maxSize bytes of a frame encoded with the given AudioCodec type and writes the samples,
+    /// returns the number of encoded bytes that were read
+    int writeEncodedData(quint8 codec, const char* data, int maxSize, int numChannels);
+    
     int16_t& operator[](const int index);
     const int16_t& operator[] (const int index) const;
     
@@ -15,19 +15,11 @@ AudioInjector* AudioScriptingInterface::playSound(Sound* sound, const AudioInjec
     
     AudioInjector* injector = new AudioInjector(sound, *injectorOptions);
     
-    QThread* injectorThread = new QThread();
-    
-    injector->moveToThread(injectorThread);
-    
-    // start injecting when the injector thread starts
-    connect(injectorThread, SIGNAL(started()), injector, SLOT(injectAudio()));
-    
     // connect the right slots and signals so that the AudioInjector is killed once the injection is complete
     connect(injector, SIGNAL(finished()), injector, SLOT(deleteLater()));
-    connect(injector, SIGNAL(finished()), injectorThread, SLOT(quit()));
-    connect(injectorThread, SIGNAL(finished()), injectorThread, SLOT(deleteLater()));
     
-    injectorThread->start();
+    // the injector is sent from the AudioInjectorManager thread along with all the others, not a thread of its own
+    injector->injectAudio();
     
     return injector;
 }
@@ -49,17 +41,9 @@ void AudioScriptingInterface::startDrumSound(float volume, float frequency, floa
     AudioInjector* injector = new AudioInjector(sound, *injectorOptions);
     sound->setParent(injector);
     
-    QThread* injectorThread = new QThread();
-    
-    injector->moveToThread(injectorThread);
-    
-    // start injecting when the injector thread starts
-    connect(injectorThread, SIGNAL(started()), injector, SLOT(injectAudio()));
-    
     // connect the right slots and signals so that the AudioInjector is killed once the injection is complete
     connect(injector, SIGNAL(finished()), injector, SLOT(deleteLater()));
-    connect(injector, SIGNAL(finished()), injectorThread, SLOT(quit()));
-    connect(injectorThread, SIGNAL(finished()), injectorThread, SLOT(deleteLater()));
     
-    injectorThread->start();
+    // the injector is sent from the AudioInjectorManager thread along with all the others, not a thread of its own
+    injector->injectAudio();
 }
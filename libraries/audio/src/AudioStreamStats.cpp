@@ -0,0 +1,67 @@
+//
+//  AudioStreamStats.cpp
+//  libraries/audio/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#include <cstring>
+
+#include "AudioStreamStats.h"
+
+AudioStreamStatsWindow::AudioStreamStatsWindow() :
+    _totalsAtStart(),
+    _numJitterSamples(0),
+    _isClosed(false)
+{
+    memset(_jitterBufferFramesCounts, 0, sizeof(_jitterBufferFramesCounts));
+}
+
+void AudioStreamStatsWindow::sampleJitterBufferFrames(int frames) {
+    if (_isClosed) {
+        // the samples of the closed window were kept for its percentiles until now
+        memset(_jitterBufferFramesCounts, 0, sizeof(_jitterBufferFramesCounts));
+        _numJitterSamples = 0;
+        _isClosed = false;
+    }
+    _jitterBufferFramesCounts[qBound(0, frames, AUDIOMIXER_INBOUND_RING_BUFFER_FRAME_CAPACITY)]++;
+    _numJitterSamples++;
+}
+
+/// the growth of a running total, or all of it if it went down, as it does when a stream is replaced
+static quint32 countSince(quint32 total, quint32 totalAtStart) {
+    return total >= totalAtStart ? total - totalAtStart : total;
+}
+
+AudioStreamStats AudioStreamStatsWindow::close(const AudioStreamStats& totals) {
+    AudioStreamStats windowStats = totals;
+    windowStats._packetsReceived = countSince(totals._packetsReceived, _totalsAtStart._packetsReceived);
+    windowStats._packetsUnreasonable = countSince(totals._packetsUnreasonable, _totalsAtStart._packetsUnreasonable);
+    windowStats._packetsEarly = countSince(totals._packetsEarly, _totalsAtStart._packetsEarly);
+    windowStats._packetsLate = countSince(totals._packetsLate, _totalsAtStart._packetsLate);
+    windowStats._packetsLost = countSince(totals._packetsLost, _totalsAtStart._packetsLost);
+    windowStats._packetsRecovered = countSince(totals._packetsRecovered, _totalsAtStart._packetsRecovered);
+    windowStats._packetsDuplicate = countSince(totals._packetsDuplicate, _totalsAtStart._packetsDuplicate);
+
+    _totalsAtStart = totals;
+    _isClosed = true;
+    return windowStats;
+}
+
+int AudioStreamStatsWindow::getJitterBufferFramesAtPercentile(float percentile) const {
+    if (_numJitterSamples == 0) {
+        return 0;
+    }
+    int rank = qMin((int)(percentile * _numJitterSamples), _numJitterSamples - 1);
+    int samplesBelow = 0;
+    for (int frames = 0; frames <= AUDIOMIXER_INBOUND_RING_BUFFER_FRAME_CAPACITY; frames++) {
+        samplesBelow += _jitterBufferFramesCounts[frames];
+        if (samplesBelow > rank) {
+            return frames;
+        }
+    }
+    return AUDIOMIXER_INBOUND_RING_BUFFER_FRAME_CAPACITY;
+}
@@ -43,4 +43,29 @@ public:
     quint32 _packetsDuplicate;
 };
 
+/// What one inbound stream did over a stats window: how its sequence number counts grew, and how long its jitter
+/// buffer was each mix. Sampling is a counter increment, and the record is the same size however long the window, so
+/// the mixer can keep one per stream and only work out percentiles for the streams whose windows look bad.
+class AudioStreamStatsWindow {
+public:
+    AudioStreamStatsWindow();
+
+    /// called once a mix with the stream's current jitter buffer length
+    void sampleJitterBufferFrames(int frames);
+
+    /// ends the window, given the stream's running totals, and starts the next. Returns the counts over the window
+    AudioStreamStats close(const AudioStreamStats& totals);
+
+    /// the jitter buffer length at the percentile (0 to 1) of the mixes sampled in the window, which close leaves be
+    /// until the next sample, or 0 if there were none
+    int getJitterBufferFramesAtPercentile(float percentile) const;
+    int getNumJitterSamples() const { return _numJitterSamples; }
+
+private:
+    AudioStreamStats _totalsAtStart;
+    quint32 _jitterBufferFramesCounts[AUDIOMIXER_INBOUND_RING_BUFFER_FRAME_CAPACITY + 1];
+    int _numJitterSamples;
+    bool _isClosed;
+};
+
 #endif  // hifi_AudioStreamStats_h
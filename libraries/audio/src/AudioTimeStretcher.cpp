@@ -0,0 +1,131 @@
+//
+//  AudioTimeStretcher.cpp
+//  libraries/audio/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#include <cstdlib>
+#include <cstring>
+#include <math.h>
+
+#include <QtCore/QtGlobal>
+
+#include "AudioTimeStretcher.h"
+
+// spread the distance to the target over this many frames, so each frame is only changed a little
+const int ADJUSTMENT_CONVERGENCE_FRAMES = 8;
+
+// no frame is sped up or slowed down by more than an eighth, beyond that the change in pitch of voices is obvious
+const int MAX_ADJUSTMENT_FRACTION = 8;
+const int MIN_ADJUSTMENT_FRAMES = 8;
+
+// the splice crossfades over a quarter of the output frame
+const int CROSSFADE_FRACTION = 4;
+
+int AudioTimeStretcher::calculateAdjustment(int bufferedFrames, int targetFrames, int numOutputFrames) {
+    int excessFrames = bufferedFrames - targetFrames;
+
+    // within half a frame of the target is close enough, chasing it any closer would only keep the audio wobbling
+    if (abs(excessFrames) < numOutputFrames / 2) {
+        return 0;
+    }
+
+    int maxAdjustment = numOutputFrames / MAX_ADJUSTMENT_FRACTION;
+    int adjustment = qBound(MIN_ADJUSTMENT_FRAMES, abs(excessFrames) / ADJUSTMENT_CONVERGENCE_FRAMES, maxAdjustment);
+    return excessFrames > 0 ? adjustment : -adjustment;
+}
+
+int AudioTimeStretcher::getMaxInputFrames(int numOutputFrames, int adjustment) {
+    // the search for the best splice can skip up to twice the adjustment
+    return adjustment > 0 ? numOutputFrames + (2 * adjustment) : numOutputFrames;
+}
+
+/// how alike the span of frames at first is to the span at second, from -1 to 1, with all channels summed
+static float spliceSimilarity(const int16_t* first, const int16_t* second, int numFrames, int numChannels) {
+    float product = 0.0f;
+    float firstEnergy = 0.0f;
+    float secondEnergy = 0.0f;
+
+    for (int i = 0; i < numFrames * numChannels; i += numChannels) {
+        float firstSample = 0.0f;
+        float secondSample = 0.0f;
+        for (int c = 0; c < numChannels; c++) {
+            firstSample += first[i + c];
+            secondSample += second[i + c];
+        }
+        product += firstSample * secondSample;
+        firstEnergy += firstSample * firstSample;
+        secondEnergy += secondSample * secondSample;
+    }
+
+    if (firstEnergy == 0.0f || secondEnergy == 0.0f) {
+        // silence splices anywhere
+        return (firstEnergy == secondEnergy) ? 1.0f : 0.0f;
+    }
+    return product / sqrtf(firstEnergy * secondEnergy);
+}
+
+int AudioTimeStretcher::stretch(const int16_t* input, int numInputFrames, int16_t* output, int numOutputFrames,
+                                int adjustment, int numChannels) {
+    int crossfadeFrames = numOutputFrames / CROSSFADE_FRACTION;
+
+    // the splice begins halfway through what's left of the frame once the crossfade is taken off, which leaves room
+    // both to skip ahead and to repeat back by less than the whole crossfade
+    int spliceFrame = (numOutputFrames - crossfadeFrames) / 2;
+
+    int minShift = qMax(abs(adjustment) / 2, 1);
+    int maxShift = qMin(abs(adjustment) * 2, spliceFrame);
+    if (adjustment > 0) {
+        maxShift = qMin(maxShift, numInputFrames - numOutputFrames);
+    }
+
+    if (adjustment == 0 || maxShift < minShift || numInputFrames < numOutputFrames) {
+        // nothing to change, or not enough extra audio to change it with
+        int numFrames = qMin(numInputFrames, numOutputFrames);
+        memcpy(output, input, numFrames * numChannels * sizeof(int16_t));
+        memset(output + (numFrames * numChannels), 0, (numOutputFrames - numFrames) * numChannels * sizeof(int16_t));
+        return numFrames;
+    }
+
+    // find the offset where the audio we jump to looks most like the audio we jump from
+    const int16_t* spliceFrom = input + (spliceFrame * numChannels);
+    int bestShift = abs(adjustment);
+    float bestSimilarity = -2.0f;
+
+    for (int shift = minShift; shift <= maxShift; shift++) {
+        int signedShift = adjustment > 0 ? shift : -shift;
+        float similarity = spliceSimilarity(spliceFrom, spliceFrom + (signedShift * numChannels), crossfadeFrames,
+                                            numChannels);
+        if (similarity > bestSimilarity) {
+            bestSimilarity = similarity;
+            bestShift = shift;
+        }
+    }
+
+    int signedShift = adjustment > 0 ? bestShift : -bestShift;
+    const int16_t* spliceTo = spliceFrom + (signedShift * numChannels);
+
+    // everything up to the splice is played as is
+    memcpy(output, input, spliceFrame * numChannels * sizeof(int16_t));
+
+    // fade from the audio at the splice to the audio at the shifted splice
+    int16_t* crossfadeAt = output + (spliceFrame * numChannels);
+    for (int f = 0; f < crossfadeFrames; f++) {
+        float fadeIn = (f + 0.5f) / crossfadeFrames;
+        for (int c = 0; c < numChannels; c++) {
+            int i = (f * numChannels) + c;
+            crossfadeAt[i] = (int16_t) ((spliceFrom[i] * (1.0f - fadeIn)) + (spliceTo[i] * fadeIn));
+        }
+    }
+
+    // and carry on from after the shifted splice
+    int remainingFrames = numOutputFrames - spliceFrame - crossfadeFrames;
+    memcpy(crossfadeAt + (crossfadeFrames * numChannels), spliceTo + (crossfadeFrames * numChannels),
+           remainingFrames * numChannels * sizeof(int16_t));
+
+    return numOutputFrames + signedShift;
+}
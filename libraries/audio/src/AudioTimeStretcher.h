@@ -0,0 +1,35 @@
+//
+//  AudioTimeStretcher.h
+//  libraries/audio/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#ifndef hifi_AudioTimeStretcher_h
+#define hifi_AudioTimeStretcher_h
+
+#include <stdint.h>
+
+/// Moves a jitter buffer towards its target depth a little every frame instead of dropping frames or inserting
+/// silence. calculateAdjustment decides how many frames of audio to skip or repeat in the next output frame, and
+/// stretch does it WSOLA style - it looks for the splice where the audio around the skipped or repeated span matches
+/// best and crossfades across it. Input and output samples are interleaved, a frame holds one sample per channel.
+class AudioTimeStretcher {
+public:
+    /// returns how many input frames the next numOutputFrames frames of output should consume beyond numOutputFrames,
+    /// negative to repeat audio when the buffer is below its target - bufferedFrames excludes the frame being output
+    static int calculateAdjustment(int bufferedFrames, int targetFrames, int numOutputFrames);
+
+    /// returns the number of input frames a stretch of numOutputFrames by adjustment may need
+    static int getMaxInputFrames(int numOutputFrames, int adjustment);
+
+    /// fills numOutputFrames of output from input, skipping or repeating about adjustment frames
+    /// returns the number of input frames that were consumed
+    static int stretch(const int16_t* input, int numInputFrames, int16_t* output, int numOutputFrames, int adjustment,
+                       int numChannels);
+};
+
+#endif // hifi_AudioTimeStretcher_h
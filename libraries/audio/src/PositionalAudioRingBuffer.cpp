@@ -18,6 +18,8 @@
 #include <PacketHeaders.h>
 #include <UUID.h>
 
+#include "AudioCodec.h"
+#include "AudioTimeStretcher.h"
 #include "PositionalAudioRingBuffer.h"
 #include "SharedUtil.h"
 
@@ -96,12 +98,14 @@ PositionalAudioRingBuffer::PositionalAudioRingBuffer(PositionalAudioRingBuffer::
     _shouldLoopbackForNode(false),
     _shouldOutputStarveDebug(true),
     _isStereo(isStereo),
+    _codec(AudioCodec::PCM),
     _listenerUnattenuatedZone(NULL),
     _desiredJitterBufferFrames(1),
     _currentJitterBufferFrames(-1),
     _dynamicJitterBuffers(dynamicJitterBuffers),
     _consecutiveNotMixedCount(0)
 {
+    memset(_outputFrame, 0, sizeof(_outputFrame));
 }
 
 int PositionalAudioRingBuffer::parseData(const QByteArray& packet) {
@@ -116,6 +120,10 @@ int PositionalAudioRingBuffer::parseData(const QByteArray& packet) {
     readBytes += sizeof(quint8);
     // read the positional data
     readBytes += parsePositionalData(packet.mid(readBytes));
+    
+    // read the codec the audio in this packet is encoded with
+    _codec = packet.at(readBytes);
+    readBytes += sizeof(quint8);
    
     if (packetTypeForPacket(packet) == PacketTypeSilentAudioFrame) {
         // this source had no audio to send us, but this counts as a packet
@@ -153,7 +161,7 @@ int PositionalAudioRingBuffer::parseData(const QByteArray& packet) {
         }
     } else {
         // there is audio data to read
-        readBytes += writeData(packet.data() + readBytes, packet.size() - readBytes);
+        readBytes += writeEncodedData(_codec, packet.data() + readBytes, packet.size() - readBytes, _isStereo ? 2 : 1);
     }
     return readBytes;
 }
@@ -173,12 +181,49 @@ int PositionalAudioRingBuffer::parsePositionalData(const QByteArray& positionalB
     return packetStream.device()->pos();
 }
 
+void PositionalAudioRingBuffer::prepareOutputFrame() {
+    int samplesPerFrame = getSamplesPerFrame();
+    int numChannels = _isStereo ? 2 : 1;
+    int framesPerFrame = samplesPerFrame / numChannels;
+    
+    // keep the end of the last frame in front of this one
+    memmove(_outputFrame, _outputFrame + samplesPerFrame, OUTPUT_FRAME_HISTORY_SAMPLES * sizeof(int16_t));
+    int16_t* outputFrame = _outputFrame + OUTPUT_FRAME_HISTORY_SAMPLES;
+    
+    int adjustment = 0;
+    if (_dynamicJitterBuffers) {
+        // skip or repeat a little audio each frame to converge on the desired jitter buffer length, rather than drop
+        // or pad whole frames when the length changes
+        int bufferedFrames = (samplesAvailable() - samplesPerFrame) / numChannels;
+        adjustment = AudioTimeStretcher::calculateAdjustment(bufferedFrames, _desiredJitterBufferFrames * framesPerFrame,
+                                                             framesPerFrame);
+    }
+    
+    if (adjustment == 0) {
+        readSamples(outputFrame, samplesPerFrame);
+    } else {
+        // the stretch needs the input in one piece, so copy it out of the ring
+        int16_t input[NETWORK_BUFFER_LENGTH_SAMPLES_STEREO * 2];
+        int numInputFrames = qMin(AudioTimeStretcher::getMaxInputFrames(framesPerFrame, adjustment),
+                                  samplesAvailable() / numChannels);
+        for (int i = 0; i < numInputFrames * numChannels; i++) {
+            input[i] = (*this)[i];
+        }
+        
+        int numFramesConsumed = AudioTimeStretcher::stretch(input, numInputFrames, outputFrame, framesPerFrame,
+                                                            adjustment, numChannels);
+        shiftReadPosition(numFramesConsumed * numChannels);
+    }
+    
+    _currentJitterBufferFrames = samplesAvailable() / samplesPerFrame;
+}
+
 void PositionalAudioRingBuffer::updateNextOutputTrailingLoudness() {
-    // ForBoundarySamples means that we expect the number of samples not to roll of the end of the ring buffer
+    const int16_t* outputFrame = getOutputFrame();
     float nextLoudness = 0;
     
     for (int i = 0; i < _numFrameSamples; ++i) {
-        nextLoudness += fabsf(_nextOutput[i]);
+        nextLoudness += fabsf(outputFrame[i]);
     }
     
     nextLoudness /= _numFrameSamples;
@@ -221,6 +266,9 @@ bool PositionalAudioRingBuffer::shouldBeAddedToMix() {
         // set to -1 to indicate the jitter buffer is starved
         _currentJitterBufferFrames = -1;
         
+        // the audio in front of the next frame won't be the audio that was last played
+        memset(_outputFrame, 0, sizeof(_outputFrame));
+        
         // reset our _shouldOutputStarveDebug to true so the next is printed
         _shouldOutputStarveDebug = true;
 
@@ -45,6 +45,9 @@ private:
 
 const int AUDIOMIXER_INBOUND_RING_BUFFER_FRAME_CAPACITY = 100;
 
+// how many samples of the previous output frames stay in front of the current one, for phase delayed mixing
+const int OUTPUT_FRAME_HISTORY_SAMPLES = 64;
+
 class PositionalAudioRingBuffer : public AudioRingBuffer {
 public:
     enum Type {
@@ -58,6 +61,12 @@ public:
     int parsePositionalData(const QByteArray& positionalByteArray);
     int parseListenModeData(const QByteArray& listenModeByteArray);
     
+    /// takes the next frame out of the ring buffer, time stretching it towards the desired jitter buffer length
+    void prepareOutputFrame();
+    
+    /// the frame prepared for this mix, preceded by OUTPUT_FRAME_HISTORY_SAMPLES of the audio before it
+    const int16_t* getOutputFrame() const { return _outputFrame + OUTPUT_FRAME_HISTORY_SAMPLES; }
+    
     void updateNextOutputTrailingLoudness();
     float getNextOutputTrailingLoudness() const { return _nextOutputTrailingLoudness; }
     
@@ -70,6 +79,9 @@ public:
     
     bool isStereo() const { return _isStereo; }
     
+    /// the AudioCodec type this stream arrives in, which is also the type its sender wants its mix in
+    quint8 getCodec() const { return _codec; }
+    
     PositionalAudioRingBuffer::Type getType() const { return _type; }
     const glm::vec3& getPosition() const { return _position; }
     const glm::quat& getOrientation() const { return _orientation; }
@@ -99,6 +111,7 @@ protected:
     bool _shouldLoopbackForNode;
     bool _shouldOutputStarveDebug;
     bool _isStereo;
+    quint8 _codec;
     
     float _nextOutputTrailingLoudness;
     AABox* _listenerUnattenuatedZone;
@@ -110,6 +123,8 @@ protected:
 
     // extra stats
     int _consecutiveNotMixedCount;
+    
+    int16_t _outputFrame[OUTPUT_FRAME_HISTORY_SAMPLES + NETWORK_BUFFER_LENGTH_SAMPLES_STEREO];
 };
 
 #endif // hifi_PositionalAudioRingBuffer_h
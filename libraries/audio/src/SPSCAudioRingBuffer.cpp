@@ -0,0 +1,131 @@
+//
+//  SPSCAudioRingBuffer.cpp
+//  libraries/audio/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#include <cstring>
+
+#include <QtCore/QtGlobal>
+
+#include "SPSCAudioRingBuffer.h"
+
+SPSCAudioRingBuffer::SPSCAudioRingBuffer(int minSampleCapacity) :
+    _sampleCapacity(1),
+    _indexMask(0),
+    _buffer(NULL),
+    _readIndex(0),
+    _writeIndex(0)
+{
+    while (_sampleCapacity < minSampleCapacity) {
+        _sampleCapacity <<= 1;
+    }
+    _indexMask = _sampleCapacity - 1;
+    _buffer = new int16_t[_sampleCapacity];
+}
+
+SPSCAudioRingBuffer::~SPSCAudioRingBuffer() {
+    delete[] _buffer;
+}
+
+int SPSCAudioRingBuffer::samplesAvailable() const {
+    // the indices run freely, unsigned subtraction gives the right distance across their wrap
+    unsigned int writeIndex = _writeIndex.loadAcquire();
+    unsigned int readIndex = _readIndex.loadAcquire();
+    return writeIndex - readIndex;
+}
+
+int SPSCAudioRingBuffer::getContiguousWriteView(int16_t*& destination) {
+    unsigned int writeIndex = _writeIndex.load();
+    unsigned int readIndex = _readIndex.loadAcquire();
+
+    int samplesFree = _sampleCapacity - (int) (writeIndex - readIndex);
+    int offset = writeIndex & _indexMask;
+
+    destination = _buffer + offset;
+    return qMin(samplesFree, _sampleCapacity - offset);
+}
+
+void SPSCAudioRingBuffer::commitWrite(int numSamples) {
+    unsigned int writeIndex = _writeIndex.load();
+
+    // the release makes the samples visible to the reader before the index that covers them
+    _writeIndex.storeRelease(writeIndex + numSamples);
+}
+
+int SPSCAudioRingBuffer::writeSamples(const int16_t* source, int maxSamples) {
+    int samplesWritten = 0;
+
+    // at most two views - up to the end of the buffer, then from its start
+    for (int view = 0; view < 2 && samplesWritten < maxSamples; view++) {
+        int16_t* destination;
+        int samplesToCopy = qMin(getContiguousWriteView(destination), maxSamples - samplesWritten);
+        if (samplesToCopy == 0) {
+            break;
+        }
+
+        memcpy(destination, source + samplesWritten, samplesToCopy * sizeof(int16_t));
+        commitWrite(samplesToCopy);
+        samplesWritten += samplesToCopy;
+    }
+
+    return samplesWritten * sizeof(int16_t);
+}
+
+int SPSCAudioRingBuffer::addSilentFrame(int numSilentSamples) {
+    int samplesWritten = 0;
+
+    for (int view = 0; view < 2 && samplesWritten < numSilentSamples; view++) {
+        int16_t* destination;
+        int samplesToZero = qMin(getContiguousWriteView(destination), numSilentSamples - samplesWritten);
+        if (samplesToZero == 0) {
+            break;
+        }
+
+        memset(destination, 0, samplesToZero * sizeof(int16_t));
+        commitWrite(samplesToZero);
+        samplesWritten += samplesToZero;
+    }
+
+    return samplesWritten * sizeof(int16_t);
+}
+
+int SPSCAudioRingBuffer::getContiguousReadView(const int16_t*& source) const {
+    unsigned int readIndex = _readIndex.load();
+    unsigned int writeIndex = _writeIndex.loadAcquire();
+
+    int samplesToRead = writeIndex - readIndex;
+    int offset = readIndex & _indexMask;
+
+    source = _buffer + offset;
+    return qMin(samplesToRead, _sampleCapacity - offset);
+}
+
+void SPSCAudioRingBuffer::commitRead(int numSamples) {
+    unsigned int readIndex = _readIndex.load();
+
+    // the release keeps the writer from reusing the space before we are done reading it
+    _readIndex.storeRelease(readIndex + numSamples);
+}
+
+int SPSCAudioRingBuffer::readSamples(int16_t* destination, int maxSamples) {
+    int samplesRead = 0;
+
+    for (int view = 0; view < 2 && samplesRead < maxSamples; view++) {
+        const int16_t* source;
+        int samplesToCopy = qMin(getContiguousReadView(source), maxSamples - samplesRead);
+        if (samplesToCopy == 0) {
+            break;
+        }
+
+        memcpy(destination + samplesRead, source, samplesToCopy * sizeof(int16_t));
+        commitRead(samplesToCopy);
+        samplesRead += samplesToCopy;
+    }
+
+    return samplesRead * sizeof(int16_t);
+}
@@ -0,0 +1,75 @@
+//
+//  SPSCAudioRingBuffer.h
+//  libraries/audio/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#ifndef hifi_SPSCAudioRingBuffer_h
+#define hifi_SPSCAudioRingBuffer_h
+
+#include <stdint.h>
+
+#include <QtCore/QAtomicInt>
+
+/// A ring of samples that one thread writes while another thread reads, without locks. The read and write indices
+/// run freely and are masked into a power of two capacity, and each side only ever stores its own index.
+/// Unlike AudioRingBuffer, a write into a full buffer keeps the oldest samples and drops what does not fit, since the
+/// writer is not allowed to move the read index.
+class SPSCAudioRingBuffer {
+public:
+    /// the capacity is rounded up to the next power of two
+    SPSCAudioRingBuffer(int minSampleCapacity);
+    ~SPSCAudioRingBuffer();
+
+    int getSampleCapacity() const { return _sampleCapacity; }
+
+    /// the number of samples the reader can read, safe to call from either thread
+    int samplesAvailable() const;
+
+    /// the number of samples the writer can write, safe to call from either thread
+    int samplesRoomFor() const { return _sampleCapacity - samplesAvailable(); }
+
+    // writer side, returns bytes like AudioRingBuffer
+
+    int writeSamples(const int16_t* source, int maxSamples);
+    int addSilentFrame(int numSilentSamples);
+
+    /// points destination at the free space from the write index to the end of the buffer or to the read index,
+    /// returns the number of samples that can be written there
+    int getContiguousWriteView(int16_t*& destination);
+
+    /// publishes numSamples written through the write view to the reader
+    void commitWrite(int numSamples);
+
+    // reader side, returns bytes like AudioRingBuffer
+
+    int readSamples(int16_t* destination, int maxSamples);
+
+    /// points source at the samples from the read index to the end of the buffer or to the write index,
+    /// returns the number of samples that can be read there
+    int getContiguousReadView(const int16_t*& source) const;
+
+    /// releases numSamples read through the read view back to the writer
+    void commitRead(int numSamples);
+
+    /// drops everything the reader has not read yet
+    void discardAvailable() { commitRead(samplesAvailable()); }
+
+private:
+    // disallow copying of SPSCAudioRingBuffer objects
+    SPSCAudioRingBuffer(const SPSCAudioRingBuffer&);
+    SPSCAudioRingBuffer& operator= (const SPSCAudioRingBuffer&);
+
+    int _sampleCapacity;
+    unsigned int _indexMask;
+    int16_t* _buffer;
+
+    QAtomicInt _readIndex; /// only stored by the reader
+    QAtomicInt _writeIndex; /// only stored by the writer
+};
+
+#endif // hifi_SPSCAudioRingBuffer_h
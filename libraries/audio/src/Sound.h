@@ -13,7 +13,9 @@
 #define hifi_Sound_h
 
 #include <QtCore/QObject>
-#include <QtNetwork/QNetworkReply>
+#include <QtCore/QSharedPointer>
+
+#include "SoundBuffer.h"
 
 class Sound : public QObject {
     Q_OBJECT
@@ -23,20 +25,21 @@ public:
     Sound(const QUrl& sampleURL, QObject* parent = NULL);
     Sound(float volume, float frequency, float duration, float decay, QObject* parent = NULL);
     
-    bool hasDownloaded() const { return _hasDownloaded; }
+    /// true once the sound can start playing, which is well before the whole of it has downloaded
+    bool hasDownloaded() const { return _buffer->isReady(); }
+    bool isComplete() const { return _buffer->isComplete(); }
+    bool isFullyAvailable() const { return _buffer->isFullyAvailable(); }
     
-    const QByteArray& getByteArray() { return _byteArray; }
-
-private:
-    QByteArray _byteArray;
-    bool _hasDownloaded;
+    /// the whole sound as decoded so far, signed 16-bit 24KHz mono
+    QByteArray getByteArray() const { return _buffer->getSamples(); }
     
-    void downSample(const QByteArray& rawAudioByteArray);
-    void interpretAsWav(const QByteArray& inputAudioByteArray, QByteArray& outputAudioByteArray);
+    /// copies up to maxSamples samples from sampleOffset on, see SoundBuffer::readSamples
+    int readSamples(int sampleOffset, int16_t* destination, int maxSamples) const
+        { return _buffer->readSamples(sampleOffset, destination, maxSamples); }
 
-private slots:
-    void replyFinished();
-    void replyError(QNetworkReply::NetworkError code);
+private:
+    // every Sound of the same URL shares one buffer, so the sound is only downloaded and decoded once
+    QSharedPointer<SoundBuffer> _buffer;
 };
 
 #endif // hifi_Sound_h
@@ -0,0 +1,433 @@
+//
+//  SoundBuffer.cpp
+//  libraries/audio/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#include <cstring>
+
+#include <QtCore/QDataStream>
+#include <QtCore/QDebug>
+#include <QtCore/QFileInfo>
+#include <QtCore/QHash>
+#include <QtCore/QMutexLocker>
+#include <QtCore/QVector>
+#include <QtCore/QWeakPointer>
+#include <QtNetwork/QNetworkRequest>
+#include <qendian.h>
+
+#include <NetworkAccessManager.h>
+
+#include "SoundBuffer.h"
+
+// how much more of a mapped file is decoded whenever a read runs past what has been decoded, about a second of audio
+const qint64 MAPPED_DECODE_BLOCK_BYTES = 96 * 1024;
+
+// a WAV file that hasn't reached its "data" chunk by now isn't one we can play
+const int MAX_WAV_HEADER_BYTES = 64 * 1024;
+
+static QMutex sharedBuffersMutex;
+static QHash<QUrl, QWeakPointer<SoundBuffer> > sharedBuffers;
+
+QSharedPointer<SoundBuffer> SoundBuffer::getSharedBuffer(const QUrl& url) {
+    QMutexLocker locker(&sharedBuffersMutex);
+
+    QSharedPointer<SoundBuffer> buffer = sharedBuffers.value(url);
+    if (buffer.isNull()) {
+        // the download delivers its replies to the thread that asked for it, so let that thread do the delete too
+        buffer = QSharedPointer<SoundBuffer>(new SoundBuffer(url), &QObject::deleteLater);
+        sharedBuffers.insert(url, buffer);
+    }
+    return buffer;
+}
+
+SoundBuffer::SoundBuffer(const QByteArray& samples) :
+    _mutex(),
+    _samples(samples),
+    _isComplete(true),
+    _format(RawFormat),
+    _hasParsedHeader(true),
+    _remainingDataBytes(-1),
+    _pendingBytes(),
+    _numDownSampleHistorySamples(0),
+    _mappedFile(NULL),
+    _mappedData(NULL),
+    _mappedSize(0),
+    _mappedOffset(0)
+{
+
+}
+
+SoundBuffer::SoundBuffer(const QUrl& url) :
+    _mutex(),
+    _samples(),
+    _isComplete(false),
+    _format(UnknownFormat),
+    _hasParsedHeader(false),
+    _remainingDataBytes(-1),
+    _pendingBytes(),
+    _numDownSampleHistorySamples(0),
+    _mappedFile(NULL),
+    _mappedData(NULL),
+    _mappedSize(0),
+    _mappedOffset(0)
+{
+    if (url.isLocalFile()) {
+        // local files are mapped rather than read, and only decoded as far as they have been played
+        _mappedFile = new QFile(url.toLocalFile());
+
+        if (_mappedFile->open(QIODevice::ReadOnly)) {
+            _mappedSize = _mappedFile->size();
+            _mappedData = _mappedFile->map(0, _mappedSize);
+        }
+
+        if (!_mappedData) {
+            qDebug() << "Error mapping sound file at" << url.toDisplayString() << "-" << _mappedFile->errorString();
+            unmapFile();
+            _isComplete = true;
+            return;
+        }
+
+        _format = QFileInfo(_mappedFile->fileName()).suffix().compare("wav", Qt::CaseInsensitive) == 0
+            ? WAVFormat : RawFormat;
+        return;
+    }
+
+    // assume we have a QApplication or QCoreApplication instance and use the
+    // QNetworkAccess manager to grab the raw audio file at the given URL
+    NetworkAccessManager& networkAccessManager = NetworkAccessManager::getInstance();
+
+    qDebug() << "Requesting audio file" << url.toDisplayString();
+
+    QNetworkReply* soundDownload = networkAccessManager.get(QNetworkRequest(url));
+    connect(soundDownload, &QNetworkReply::readyRead, this, &SoundBuffer::replyReadyRead);
+    connect(soundDownload, &QNetworkReply::finished, this, &SoundBuffer::replyFinished);
+    connect(soundDownload, SIGNAL(error(QNetworkReply::NetworkError)), this, SLOT(replyError(QNetworkReply::NetworkError)));
+}
+
+SoundBuffer::~SoundBuffer() {
+    unmapFile();
+}
+
+bool SoundBuffer::isReady() const {
+    QMutexLocker locker(&_mutex);
+    return _isComplete || _mappedData || !_samples.isEmpty();
+}
+
+bool SoundBuffer::isComplete() const {
+    QMutexLocker locker(&_mutex);
+    return _isComplete;
+}
+
+bool SoundBuffer::isFullyAvailable() const {
+    QMutexLocker locker(&_mutex);
+    return _isComplete || _mappedData;
+}
+
+int SoundBuffer::readSamples(int sampleOffset, int16_t* destination, int maxSamples) {
+    QMutexLocker locker(&_mutex);
+
+    int numNeededBytes = (sampleOffset + maxSamples) * sizeof(int16_t);
+    while (_mappedData && _samples.size() < numNeededBytes) {
+        decodeMappedBytes(MAPPED_DECODE_BLOCK_BYTES);
+    }
+
+    int numSamples = qBound(0, (int) (_samples.size() / sizeof(int16_t)) - sampleOffset, maxSamples);
+    memcpy(destination, _samples.constData() + (sampleOffset * sizeof(int16_t)), numSamples * sizeof(int16_t));
+    return numSamples;
+}
+
+QByteArray SoundBuffer::getSamples() {
+    QMutexLocker locker(&_mutex);
+
+    if (_mappedData) {
+        decodeMappedBytes(_mappedSize - _mappedOffset);
+    }
+    return _samples;
+}
+
+void SoundBuffer::replyReadyRead() {
+    QNetworkReply* reply = reinterpret_cast<QNetworkReply*>(sender());
+    QMutexLocker locker(&_mutex);
+
+    if (!_hasParsedHeader && _format == UnknownFormat && _pendingBytes.isEmpty()) {
+        // the headers have all arrived by the time the first of the data does
+        if (reply->hasRawHeader("Content-Type")) {
+            QByteArray headerContentType = reply->rawHeader("Content-Type");
+
+            // WAV audio file encountered
+            if (headerContentType == "audio/x-wav"
+                || headerContentType == "audio/wav"
+                || headerContentType == "audio/wave") {
+                _format = WAVFormat;
+            } else {
+                //  Process as RAW file
+                _format = RawFormat;
+                _hasParsedHeader = true;
+            }
+        } else {
+            qDebug() << "Network reply without 'Content-Type'.";
+            _hasParsedHeader = true;
+        }
+    }
+
+    QByteArray data = reply->readAll();
+    decode(data.constData(), data.size());
+}
+
+void SoundBuffer::replyFinished() {
+    QNetworkReply* reply = reinterpret_cast<QNetworkReply*>(sender());
+
+    // whatever arrived since the last readyRead
+    replyReadyRead();
+
+    QMutexLocker locker(&_mutex);
+    finishDecode();
+
+    reply->deleteLater();
+}
+
+void SoundBuffer::replyError(QNetworkReply::NetworkError code) {
+    QNetworkReply* reply = reinterpret_cast<QNetworkReply*>(sender());
+    qDebug() << "Error downloading sound file at" << reply->url().toString() << "-" << reply->errorString();
+}
+
+//
+// Format description from https://ccrma.stanford.edu/courses/422/projects/WaveFormat/
+//
+// The header for a WAV file looks like this:
+// Positions     Sample Value     Description
+//   00-03         "RIFF"       Marks the file as a riff file. Characters are each 1 byte long.
+//   04-07         File size (int) Size of the overall file - 8 bytes, in bytes (32-bit integer).
+//   08-11         "WAVE"       File Type Header. For our purposes, it always equals "WAVE".
+//   12-15         "fmt "       Format chunk marker.
+//   16-19         16           Length of format data as listed above
+//   20-21         1            Type of format: (1=PCM, 257=Mu-Law, 258=A-Law, 259=ADPCM) - 2 byte integer
+//   22-23         2            Number of Channels - 2 byte integer
+//   24-27         44100        Sample Rate - 32 byte integer. Sample Rate = Number of Samples per second, or Hertz.
+//   28-31         176400       (Sample Rate * BitsPerSample * Channels) / 8.
+//   32-33         4            (BitsPerSample * Channels) / 8 - 8 bit mono2 - 8 bit stereo/16 bit mono4 - 16 bit stereo
+//   34-35         16           Bits per sample
+//   36-39         "data"       Chunk header. Marks the beginning of the data section.
+//   40-43         File size (int) Size of the data section.
+//   44-??                      Actual sound data
+// Sample values are given above for a 16-bit stereo source.
+//
+
+struct chunk {
+    char        id[4];
+    quint32     size;
+};
+
+struct RIFFHeader {
+    chunk       descriptor;     // "RIFF"
+    char        type[4];        // "WAVE"
+};
+
+struct WAVEHeader {
+    chunk       descriptor;
+    quint16     audioFormat;    // Format type: 1=PCM, 257=Mu-Law, 258=A-Law, 259=ADPCM
+    quint16     numChannels;    // Number of channels: 1=mono, 2=stereo
+    quint32     sampleRate;
+    quint32     byteRate;       // Sample rate * Number of Channels * Bits per sample / 8
+    quint16     blockAlign;     // (Number of Channels * Bits per sample) / 8.1
+    quint16     bitsPerSample;
+};
+
+struct DATAHeader {
+    chunk       descriptor;
+};
+
+struct CombinedHeader {
+    RIFFHeader  riff;
+    WAVEHeader  wave;
+};
+
+/// returns where the sample data begins in the start of a WAV file and sets dataSize to its length, or returns 0
+/// while more of the file is needed to tell and -1 if it isn't a WAV file we can play
+static int parseWAVHeader(const QByteArray& inputAudioByteArray, qint64& dataSize) {
+    CombinedHeader fileHeader;
+
+    // Create a data stream to analyze the data
+    QDataStream waveStream(inputAudioByteArray);
+    if (waveStream.readRawData(reinterpret_cast<char *>(&fileHeader), sizeof(CombinedHeader)) != sizeof(CombinedHeader)) {
+        return 0;
+    }
+
+    if (strncmp(fileHeader.riff.descriptor.id, "RIFF", 4) == 0) {
+        waveStream.setByteOrder(QDataStream::LittleEndian);
+    } else {
+        // descriptor.id == "RIFX" also signifies BigEndian file
+        // waveStream.setByteOrder(QDataStream::BigEndian);
+        qDebug() << "Currently not supporting big-endian audio files.";
+        return -1;
+    }
+
+    if (strncmp(fileHeader.riff.type, "WAVE", 4) != 0
+        || strncmp(fileHeader.wave.descriptor.id, "fmt", 3) != 0) {
+        qDebug() << "Not a WAVE Audio file.";
+        return -1;
+    }
+
+    // added the endianess check as an extra level of security
+
+    if (qFromLittleEndian<quint16>(fileHeader.wave.audioFormat) != 1) {
+        qDebug() << "Currently not supporting non PCM audio files.";
+        return -1;
+    }
+    if (qFromLittleEndian<quint16>(fileHeader.wave.numChannels) != 1) {
+        qDebug() << "Currently not supporting stereo audio files.";
+        return -1;
+    }
+    if (qFromLittleEndian<quint16>(fileHeader.wave.bitsPerSample) != 16) {
+        qDebug() << "Currently not supporting non 16bit audio files.";
+        return -1;
+    }
+    if (qFromLittleEndian<quint32>(fileHeader.wave.sampleRate) != 48000) {
+        qDebug() << "Currently not supporting non 48KHz audio files.";
+        return -1;
+    }
+
+    // Skip any extra data in the WAVE chunk
+    int offset = sizeof(CombinedHeader)
+        + qFromLittleEndian<quint32>(fileHeader.wave.descriptor.size) - (sizeof(WAVEHeader) - sizeof(chunk));
+
+    // Read chunks until the "data" chunk is found
+    DATAHeader dataHeader;
+    while (offset + (int) sizeof(DATAHeader) <= inputAudioByteArray.size()) {
+        memcpy(&dataHeader, inputAudioByteArray.constData() + offset, sizeof(DATAHeader));
+        offset += sizeof(DATAHeader);
+
+        if (strncmp(dataHeader.descriptor.id, "data", 4) == 0) {
+            dataSize = qFromLittleEndian<quint32>(dataHeader.descriptor.size);
+            return offset;
+        }
+        offset += qFromLittleEndian<quint32>(dataHeader.descriptor.size);
+    }
+
+    if (inputAudioByteArray.size() > MAX_WAV_HEADER_BYTES) {
+        qDebug() << "Could not read wav audio data header.";
+        return -1;
+    }
+    return 0;
+}
+
+void SoundBuffer::decode(const char* data, int size) {
+    if (!_hasParsedHeader) {
+        if (_format != WAVFormat) {
+            return;
+        }
+
+        // hold on to the start of the file until all of its header is here
+        _pendingBytes.append(data, size);
+        int dataOffset = parseWAVHeader(_pendingBytes, _remainingDataBytes);
+        if (dataOffset == 0) {
+            return;
+        }
+
+        _hasParsedHeader = true;
+        if (dataOffset < 0) {
+            _format = UnknownFormat;
+            _pendingBytes.clear();
+            return;
+        }
+
+        QByteArray afterHeader = _pendingBytes.mid(dataOffset);
+        _pendingBytes.clear();
+        decode(afterHeader.constData(), afterHeader.size());
+        return;
+    }
+
+    if (_format == UnknownFormat) {
+        return;
+    }
+
+    if (_remainingDataBytes >= 0) {
+        // anything after the data chunk of a WAV file isn't audio
+        size = (int) qMin((qint64) size, _remainingDataBytes);
+        _remainingDataBytes -= size;
+    }
+
+    // assume the samples are signed, 16-bit, 48Khz, mono - a sample can be split between two chunks of the file
+    QVector<int16_t> sourceSamples;
+    sourceSamples.reserve(_numDownSampleHistorySamples + ((_pendingBytes.size() + size) / sizeof(int16_t)));
+    for (int i = 0; i < _numDownSampleHistorySamples; i++) {
+        sourceSamples.append(_downSampleHistory[i]);
+    }
+
+    if (!_pendingBytes.isEmpty() && size > 0) {
+        char splitSample[sizeof(int16_t)] = { _pendingBytes.at(0), data[0] };
+        int16_t sample;
+        memcpy(&sample, splitSample, sizeof(int16_t));
+        sourceSamples.append(sample);
+        _pendingBytes.clear();
+        data++;
+        size--;
+    }
+
+    int numWholeSamples = size / sizeof(int16_t);
+    sourceSamples.resize(sourceSamples.size() + numWholeSamples);
+    memcpy(sourceSamples.data() + sourceSamples.size() - numWholeSamples, data, numWholeSamples * sizeof(int16_t));
+    if (size % sizeof(int16_t)) {
+        _pendingBytes.append(data[size - 1]);
+    }
+
+    // we want to convert it to the format that the audio-mixer wants
+    // which is signed, 16-bit, 24Khz, mono - every output sample needs the source sample after its pair
+    int numSourceSamples = sourceSamples.size();
+    int numDestinationSamples = qMax(numSourceSamples - 1, 0) / 2;
+    int previousSize = _samples.size();
+    _samples.resize(previousSize + (numDestinationSamples * sizeof(int16_t)));
+    int16_t* destinationSamples = reinterpret_cast<int16_t*>(_samples.data() + previousSize);
+
+    for (int i = 0; i < numDestinationSamples; i++) {
+        destinationSamples[i] = (sourceSamples[2 * i] / 4) + (sourceSamples[(2 * i) + 1] / 2)
+            + (sourceSamples[(2 * i) + 2] / 4);
+    }
+
+    _numDownSampleHistorySamples = numSourceSamples - (2 * numDestinationSamples);
+    for (int i = 0; i < _numDownSampleHistorySamples; i++) {
+        _downSampleHistory[i] = sourceSamples[(2 * numDestinationSamples) + i];
+    }
+}
+
+void SoundBuffer::decodeMappedBytes(qint64 numBytes) {
+    numBytes = qMin(numBytes, _mappedSize - _mappedOffset);
+    decode(reinterpret_cast<const char*>(_mappedData + _mappedOffset), (int) numBytes);
+    _mappedOffset += numBytes;
+
+    if (_mappedOffset == _mappedSize) {
+        finishDecode();
+        unmapFile();
+    }
+}
+
+void SoundBuffer::finishDecode() {
+    if (!_hasParsedHeader && _format == WAVFormat) {
+        qDebug() << "Could not read wav audio file header.";
+    }
+
+    // the last pair of samples has no sample after it to filter with
+    if (_numDownSampleHistorySamples == 2) {
+        int16_t lastSample = (_downSampleHistory[0] / 2) + (_downSampleHistory[1] / 2);
+        _samples.append(reinterpret_cast<const char*>(&lastSample), sizeof(int16_t));
+    }
+    _numDownSampleHistorySamples = 0;
+    _pendingBytes.clear();
+    _isComplete = true;
+}
+
+void SoundBuffer::unmapFile() {
+    if (_mappedFile) {
+        if (_mappedData) {
+            _mappedFile->unmap(const_cast<uchar*>(_mappedData));
+        }
+        delete _mappedFile;
+    }
+    _mappedFile = NULL;
+    _mappedData = NULL;
+}
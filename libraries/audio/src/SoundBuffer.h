@@ -0,0 +1,94 @@
+//
+//  SoundBuffer.h
+//  libraries/audio/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#ifndef hifi_SoundBuffer_h
+#define hifi_SoundBuffer_h
+
+#include <stdint.h>
+
+#include <QtCore/QFile>
+#include <QtCore/QMutex>
+#include <QtCore/QObject>
+#include <QtCore/QSharedPointer>
+#include <QtCore/QUrl>
+#include <QtNetwork/QNetworkReply>
+
+/// The decoded samples of a sound, signed 16-bit 24KHz mono, shared by every Sound and AudioInjector that plays it.
+/// A sound on the network is decoded a chunk at a time as its download arrives, a local file is memory mapped and
+/// decoded a block at a time as it is read, so playback can start long before the whole sound has been decoded.
+class SoundBuffer : public QObject {
+    Q_OBJECT
+public:
+    /// returns the buffer for the sound at url, which is only downloaded or mapped again once nothing holds it
+    static QSharedPointer<SoundBuffer> getSharedBuffer(const QUrl& url);
+
+    /// a buffer that already holds all of its samples
+    SoundBuffer(const QByteArray& samples);
+    ~SoundBuffer();
+
+    /// true once there are samples to play, or once it is known that there never will be
+    bool isReady() const;
+
+    /// true once every sample has been decoded, or decoding has failed
+    bool isComplete() const;
+
+    /// true when every sample can be read right away, which a memory mapped file can from the start
+    bool isFullyAvailable() const;
+
+    /// copies up to maxSamples samples from sampleOffset on into destination, decoding more of a mapped file if it
+    /// has to, and returns how many were copied - fewer than asked for once the end, or the end of the download so
+    /// far, is reached
+    int readSamples(int sampleOffset, int16_t* destination, int maxSamples);
+
+    /// returns all of the samples decoded so far, after decoding whatever is left of a mapped file
+    QByteArray getSamples();
+
+private slots:
+    void replyReadyRead();
+    void replyFinished();
+    void replyError(QNetworkReply::NetworkError code);
+
+private:
+    enum Format {
+        UnknownFormat,
+        RawFormat,
+        WAVFormat
+    };
+
+    SoundBuffer(const QUrl& url);
+
+    // the rest must only be called with _mutex held
+
+    /// decodes the next size bytes of the file, whichever part of it they are
+    void decode(const char* data, int size);
+    void decodeMappedBytes(qint64 numBytes);
+    void finishDecode();
+    void unmapFile();
+
+    mutable QMutex _mutex;
+    QByteArray _samples;
+    bool _isComplete;
+
+    Format _format;
+    bool _hasParsedHeader;
+    qint64 _remainingDataBytes;
+    QByteArray _pendingBytes;
+
+    // the 48KHz samples that the downsampler needs before it can put out the next one
+    int16_t _downSampleHistory[2];
+    int _numDownSampleHistorySamples;
+
+    QFile* _mappedFile;
+    const uchar* _mappedData;
+    qint64 _mappedSize;
+    qint64 _mappedOffset;
+};
+
+#endif // hifi_SoundBuffer_h
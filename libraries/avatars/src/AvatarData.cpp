@@ -13,6 +13,7 @@
 #include <cstring>
 #include <stdint.h>
 
+#include <QtCore/QCryptographicHash>
 #include <QtCore/QDataStream>
 #include <QtCore/QThread>
 #include <QtCore/QUuid>
@@ -53,7 +54,12 @@ AvatarData::AvatarData() :
     _billboard(),
     _errorLogExpiry(0),
     _owningAvatarMixer(),
-    _lastUpdateTimer()
+    _lastUpdateTimer(),
+    _lastKeyFrame(),
+    _keyFrameSequence(0),
+    _updatesSinceKeyFrame(0),
+    _receivedKeyFrameSequence(0),
+    _hasReceivedKeyFrame(false)
 {
     
 }
@@ -72,117 +78,200 @@ void AvatarData::setHandPosition(const glm::vec3& handPosition) {
     _handPosition = glm::inverse(getOrientation()) * (handPosition - _position);
 }
 
+// an update starts with its flags, the sequence of the key frame it is or is against and the mask of its sections
+const unsigned char AVATAR_KEY_FRAME_FLAG = 1;
+const int AVATAR_UPDATE_HEADER_SIZE = sizeof(unsigned char) + sizeof(quint16) + sizeof(unsigned char);
+const unsigned char ALL_AVATAR_DATA_SECTIONS = (1 << NUM_AVATAR_DATA_SECTIONS) - 1;
+
+// the sizes of the sections, a zero size section varies and is preceded by its size in two bytes
+const int AVATAR_DATA_SECTION_SIZES[NUM_AVATAR_DATA_SECTIONS] = {
+    12, // position
+    8,  // body rotation and scale
+    14, // head rotation and lean
+    12, // lookAt
+    4,  // audio loudness
+    0,  // chat message, bit items, face data and pupil dilation
+    0   // joint data
+};
+
+// the joint and blendshape counts of an update are a byte each
+const int MAX_JOINTS_PER_UPDATE = 255;
+const int MAX_BLENDSHAPE_COEFFICIENTS_PER_UPDATE = 255;
+
 QByteArray AvatarData::toByteArray() {
-    // TODO: DRY this up to a shared method
-    // that can pack any type given the number of bytes
-    // and return the number of bytes to push the pointer
-    
     // lazily allocate memory for HeadData in case we're not an Avatar instance
     if (!_headData) {
         _headData = new HeadData(this);
     }
     
+    bool isKeyFrame = _lastKeyFrame.isEmpty() || _updatesSinceKeyFrame + 1 >= AVATAR_KEY_FRAME_INTERVAL;
+    if (isKeyFrame) {
+        ++_keyFrameSequence;
+        _updatesSinceKeyFrame = 0;
+    } else {
+        ++_updatesSinceKeyFrame;
+    }
+    
     QByteArray avatarDataByteArray;
     avatarDataByteArray.resize(MAX_PACKET_SIZE);
     
     unsigned char* destinationBuffer = reinterpret_cast<unsigned char*>(avatarDataByteArray.data());
     unsigned char* startPosition = destinationBuffer;
     
-    memcpy(destinationBuffer, &_position, sizeof(_position));
-    destinationBuffer += sizeof(_position);
-    
-    // Body rotation (NOTE: This needs to become a quaternion to save two bytes)
-    destinationBuffer += packFloatAngleToTwoByte(destinationBuffer, _bodyYaw);
-    destinationBuffer += packFloatAngleToTwoByte(destinationBuffer, _bodyPitch);
-    destinationBuffer += packFloatAngleToTwoByte(destinationBuffer, _bodyRoll);
-
-    // Body scale
-    destinationBuffer += packFloatRatioToTwoByte(destinationBuffer, _targetScale);
-
-    // Head rotation (NOTE: This needs to become a quaternion to save two bytes)
-    destinationBuffer += packFloatAngleToTwoByte(destinationBuffer, _headData->getFinalYaw());
-    destinationBuffer += packFloatAngleToTwoByte(destinationBuffer, _headData->getFinalPitch());
-    destinationBuffer += packFloatAngleToTwoByte(destinationBuffer, _headData->getFinalRoll());
-    
-    // Head lean X,Z (head lateral and fwd/back motion relative to torso)
-    memcpy(destinationBuffer, &_headData->_leanSideways, sizeof(_headData->_leanSideways));
-    destinationBuffer += sizeof(_headData->_leanSideways);
-    memcpy(destinationBuffer, &_headData->_leanForward, sizeof(_headData->_leanForward));
-    destinationBuffer += sizeof(_headData->_leanForward);
-
-    // Lookat Position
-    memcpy(destinationBuffer, &_headData->_lookAtPosition, sizeof(_headData->_lookAtPosition));
-    destinationBuffer += sizeof(_headData->_lookAtPosition);
-     
-    // Instantaneous audio loudness (used to drive facial animation)
-    memcpy(destinationBuffer, &_headData->_audioLoudness, sizeof(float));
-    destinationBuffer += sizeof(float);
-
-    // chat message
-    *destinationBuffer++ = _chatMessage.size();
-    memcpy(destinationBuffer, _chatMessage.data(), _chatMessage.size() * sizeof(char));
-    destinationBuffer += _chatMessage.size() * sizeof(char);
-    
-    // bitMask of less than byte wide items
-    unsigned char bitItems = 0;
-
-    // key state
-    setSemiNibbleAt(bitItems,KEY_STATE_START_BIT,_keyState);
-    // hand state
-    setSemiNibbleAt(bitItems,HAND_STATE_START_BIT,_handState);
-    // faceshift state
-    if (_headData->_isFaceshiftConnected) { setAtBit(bitItems, IS_FACESHIFT_CONNECTED); }
-    if (_isChatCirclingEnabled) {
-        setAtBit(bitItems, IS_CHAT_CIRCLING_ENABLED);
-    }
-    *destinationBuffer++ = bitItems;
-
-    // If it is connected, pack up the data
-    if (_headData->_isFaceshiftConnected) {
-        memcpy(destinationBuffer, &_headData->_leftEyeBlink, sizeof(float));
-        destinationBuffer += sizeof(float);
-
-        memcpy(destinationBuffer, &_headData->_rightEyeBlink, sizeof(float));
-        destinationBuffer += sizeof(float);
-
-        memcpy(destinationBuffer, &_headData->_averageLoudness, sizeof(float));
-        destinationBuffer += sizeof(float);
-
-        memcpy(destinationBuffer, &_headData->_browAudioLift, sizeof(float));
-        destinationBuffer += sizeof(float);
+    *destinationBuffer++ = isKeyFrame ? AVATAR_KEY_FRAME_FLAG : 0;
+    memcpy(destinationBuffer, &_keyFrameSequence, sizeof(_keyFrameSequence));
+    destinationBuffer += sizeof(_keyFrameSequence);
+    
+    unsigned char* sectionMask = destinationBuffer++;
+    *sectionMask = 0;
+    
+    for (int section = 0; section < NUM_AVATAR_DATA_SECTIONS; section++) {
+        unsigned char* sectionStart = destinationBuffer;
+        bool isVariableSize = (AVATAR_DATA_SECTION_SIZES[section] == 0);
+        if (isVariableSize) {
+            destinationBuffer += sizeof(quint16);
+        }
+        
+        int sectionSize = writeSection(section, destinationBuffer);
         
-        *destinationBuffer++ = _headData->_blendshapeCoefficients.size();
-        memcpy(destinationBuffer, _headData->_blendshapeCoefficients.data(),
-            _headData->_blendshapeCoefficients.size() * sizeof(float));
-        destinationBuffer += _headData->_blendshapeCoefficients.size() * sizeof(float);
-    }
-    
-    // pupil dilation
-    destinationBuffer += packFloatToByte(destinationBuffer, _headData->_pupilDilation, 1.0f);
-
-    // joint data
-    *destinationBuffer++ = _jointData.size();
-    unsigned char validity = 0;
-    int validityBit = 0;
-    foreach (const JointData& data, _jointData) {
-        if (data.valid) {
-            validity |= (1 << validityBit);
+        if (isKeyFrame) {
+            _keyFrameSections[section] = QByteArray(reinterpret_cast<char*>(destinationBuffer), sectionSize);
+            
+        } else if (sectionSize == _keyFrameSections[section].size()
+                   && memcmp(destinationBuffer, _keyFrameSections[section].constData(), sectionSize) == 0) {
+            // the section hasn't changed since the key frame, so it is left out
+            destinationBuffer = sectionStart;
+            continue;
         }
-        if (++validityBit == BITS_IN_BYTE) {
-            *destinationBuffer++ = validity;
-            validityBit = validity = 0;
+        
+        if (isVariableSize) {
+            quint16 size = sectionSize;
+            memcpy(sectionStart, &size, sizeof(size));
         }
+        destinationBuffer += sectionSize;
+        *sectionMask |= (1 << section);
     }
-    if (validityBit != 0) {
-        *destinationBuffer++ = validity;
+    
+    avatarDataByteArray.resize(destinationBuffer - startPosition);
+    if (isKeyFrame) {
+        _lastKeyFrame = avatarDataByteArray;
     }
-    foreach (const JointData& data, _jointData) {
-        if (data.valid) {
-            destinationBuffer += packOrientationQuatToBytes(destinationBuffer, data.rotation);
+    return avatarDataByteArray;
+}
+
+int AvatarData::writeSection(int section, unsigned char* destinationBuffer) {
+    unsigned char* startPosition = destinationBuffer;
+    
+    switch (section) {
+        case AVATAR_POSITION_SECTION:
+            memcpy(destinationBuffer, &_position, sizeof(_position));
+            destinationBuffer += sizeof(_position);
+            break;
+            
+        case AVATAR_BODY_SECTION:
+            // Body rotation (NOTE: This needs to become a quaternion to save two bytes)
+            destinationBuffer += packFloatAngleToTwoByte(destinationBuffer, _bodyYaw);
+            destinationBuffer += packFloatAngleToTwoByte(destinationBuffer, _bodyPitch);
+            destinationBuffer += packFloatAngleToTwoByte(destinationBuffer, _bodyRoll);
+            
+            // Body scale
+            destinationBuffer += packFloatRatioToTwoByte(destinationBuffer, _targetScale);
+            break;
+            
+        case AVATAR_HEAD_SECTION:
+            // Head rotation (NOTE: This needs to become a quaternion to save two bytes)
+            destinationBuffer += packFloatAngleToTwoByte(destinationBuffer, _headData->getFinalYaw());
+            destinationBuffer += packFloatAngleToTwoByte(destinationBuffer, _headData->getFinalPitch());
+            destinationBuffer += packFloatAngleToTwoByte(destinationBuffer, _headData->getFinalRoll());
+            
+            // Head lean X,Z (head lateral and fwd/back motion relative to torso)
+            memcpy(destinationBuffer, &_headData->_leanSideways, sizeof(_headData->_leanSideways));
+            destinationBuffer += sizeof(_headData->_leanSideways);
+            memcpy(destinationBuffer, &_headData->_leanForward, sizeof(_headData->_leanForward));
+            destinationBuffer += sizeof(_headData->_leanForward);
+            break;
+            
+        case AVATAR_LOOK_AT_SECTION:
+            memcpy(destinationBuffer, &_headData->_lookAtPosition, sizeof(_headData->_lookAtPosition));
+            destinationBuffer += sizeof(_headData->_lookAtPosition);
+            break;
+            
+        case AVATAR_AUDIO_LOUDNESS_SECTION:
+            // Instantaneous audio loudness (used to drive facial animation)
+            memcpy(destinationBuffer, &_headData->_audioLoudness, sizeof(float));
+            destinationBuffer += sizeof(float);
+            break;
+            
+        case AVATAR_FACE_SECTION: {
+            // chat message
+            *destinationBuffer++ = _chatMessage.size();
+            memcpy(destinationBuffer, _chatMessage.data(), _chatMessage.size() * sizeof(char));
+            destinationBuffer += _chatMessage.size() * sizeof(char);
+            
+            // bitMask of less than byte wide items
+            unsigned char bitItems = 0;
+            
+            // key state
+            setSemiNibbleAt(bitItems,KEY_STATE_START_BIT,_keyState);
+            // hand state
+            setSemiNibbleAt(bitItems,HAND_STATE_START_BIT,_handState);
+            // faceshift state
+            if (_headData->_isFaceshiftConnected) { setAtBit(bitItems, IS_FACESHIFT_CONNECTED); }
+            if (_isChatCirclingEnabled) {
+                setAtBit(bitItems, IS_CHAT_CIRCLING_ENABLED);
+            }
+            *destinationBuffer++ = bitItems;
+            
+            // If it is connected, pack up the data
+            if (_headData->_isFaceshiftConnected) {
+                memcpy(destinationBuffer, &_headData->_leftEyeBlink, sizeof(float));
+                destinationBuffer += sizeof(float);
+                
+                memcpy(destinationBuffer, &_headData->_rightEyeBlink, sizeof(float));
+                destinationBuffer += sizeof(float);
+                
+                memcpy(destinationBuffer, &_headData->_averageLoudness, sizeof(float));
+                destinationBuffer += sizeof(float);
+                
+                memcpy(destinationBuffer, &_headData->_browAudioLift, sizeof(float));
+                destinationBuffer += sizeof(float);
+                
+                *destinationBuffer++ = _headData->_blendshapeCoefficients.size();
+                memcpy(destinationBuffer, _headData->_blendshapeCoefficients.data(),
+                    _headData->_blendshapeCoefficients.size() * sizeof(float));
+                destinationBuffer += _headData->_blendshapeCoefficients.size() * sizeof(float);
+            }
+            
+            // pupil dilation
+            destinationBuffer += packFloatToByte(destinationBuffer, _headData->_pupilDilation, 1.0f);
+            break;
+        }
+        case AVATAR_JOINTS_SECTION: {
+            *destinationBuffer++ = _jointData.size();
+            unsigned char validity = 0;
+            int validityBit = 0;
+            foreach (const JointData& data, _jointData) {
+                if (data.valid) {
+                    validity |= (1 << validityBit);
+                }
+                if (++validityBit == BITS_IN_BYTE) {
+                    *destinationBuffer++ = validity;
+                    validityBit = validity = 0;
+                }
+            }
+            if (validityBit != 0) {
+                *destinationBuffer++ = validity;
+            }
+            foreach (const JointData& data, _jointData) {
+                if (data.valid) {
+                    destinationBuffer += packOrientationQuatToSixBytes(destinationBuffer, data.rotation);
+                }
+            }
+            break;
         }
     }
-        
-    return avatarDataByteArray.left(destinationBuffer - startPosition);
+    
+    return destinationBuffer - startPosition;
 }
 
 bool AvatarData::shouldLogError(const quint64& now) {
@@ -212,291 +301,344 @@ int AvatarData::parseDataAtOffset(const QByteArray& packet, int offset) {
     const unsigned char* startPosition = reinterpret_cast<const unsigned char*>(packet.data()) + offset;
     const unsigned char* sourceBuffer = startPosition;
     quint64 now = usecTimestampNow();
-
-    // The absolute minimum size of the update data is as follows:
-    // 50 bytes of "plain old data" {
-    //     position      = 12 bytes
-    //     bodyYaw       =  2 (compressed float)
-    //     bodyPitch     =  2 (compressed float)
-    //     bodyRoll      =  2 (compressed float)
-    //     targetScale   =  2 (compressed float)
-    //     headYaw       =  2 (compressed float)
-    //     headPitch     =  2 (compressed float)
-    //     headRoll      =  2 (compressed float)
-    //     leanSideways  =  4
-    //     leanForward   =  4
-    //     lookAt        = 12
-    //     audioLoudness =  4
-    // }
-    // + 1 byte for messageSize (0)
-    // + 1 byte for pupilSize
-    // + 1 byte for numJoints (0)
-    // = 53 bytes
-    int minPossibleSize = 53; 
     
     int maxAvailableSize = packet.size() - offset;
-    if (minPossibleSize > maxAvailableSize) {
+    if (AVATAR_UPDATE_HEADER_SIZE > maxAvailableSize) {
         if (shouldLogError(now)) {
             qDebug() << "Malformed AvatarData packet at the start; "
                 << " displayName = '" << _displayName << "'"
-                << " minPossibleSize = " << minPossibleSize 
                 << " maxAvailableSize = " << maxAvailableSize;
         }
         // this packet is malformed so we report all bytes as consumed
         return maxAvailableSize;
     }
-
-    { // Body world position, rotation, and scale
-        // position
-        glm::vec3 position;
-        memcpy(&position, sourceBuffer, sizeof(position));
-        sourceBuffer += sizeof(position);
+    
+    bool isKeyFrame = (*sourceBuffer++ & AVATAR_KEY_FRAME_FLAG);
+    quint16 keyFrameSequence;
+    memcpy(&keyFrameSequence, sourceBuffer, sizeof(keyFrameSequence));
+    sourceBuffer += sizeof(keyFrameSequence);
+    unsigned char sectionMask = *sourceBuffer++;
+    
+    // find where each section the update carries is, a key frame carries all of them
+    const unsigned char* sections[NUM_AVATAR_DATA_SECTIONS];
+    int sectionSizes[NUM_AVATAR_DATA_SECTIONS];
+    
+    for (int section = 0; section < NUM_AVATAR_DATA_SECTIONS; section++) {
+        if (!(sectionMask & (1 << section))) {
+            sections[section] = NULL;
+            continue;
+        }
+        
+        int sectionSize = AVATAR_DATA_SECTION_SIZES[section];
+        if (sectionSize == 0 && sourceBuffer + sizeof(quint16) <= startPosition + maxAvailableSize) {
+            quint16 size;
+            memcpy(&size, sourceBuffer, sizeof(size));
+            sourceBuffer += sizeof(size);
+            sectionSize = size;
+        }
         
-        if (glm::isnan(position.x) || glm::isnan(position.y) || glm::isnan(position.z)) {
+        if (sectionSize == 0 || sourceBuffer + sectionSize > startPosition + maxAvailableSize) {
             if (shouldLogError(now)) {
-                qDebug() << "Discard nan AvatarData::position; displayName = '" << _displayName << "'";
+                qDebug() << "Malformed AvatarData packet in section" << section << ";"
+                    << " displayName = '" << _displayName << "'"
+                    << " maxAvailableSize = " << maxAvailableSize;
             }
             return maxAvailableSize;
         }
-        _position = position;
         
-        // rotation (NOTE: This needs to become a quaternion to save two bytes)
-        float yaw, pitch, roll;
-        sourceBuffer += unpackFloatAngleFromTwoByte((uint16_t*) sourceBuffer, &yaw);
-        sourceBuffer += unpackFloatAngleFromTwoByte((uint16_t*) sourceBuffer, &pitch);
-        sourceBuffer += unpackFloatAngleFromTwoByte((uint16_t*) sourceBuffer, &roll);
-        if (glm::isnan(yaw) || glm::isnan(pitch) || glm::isnan(roll)) {
+        sections[section] = sourceBuffer;
+        sectionSizes[section] = sectionSize;
+        sourceBuffer += sectionSize;
+    }
+    
+    int bytesRead = sourceBuffer - startPosition;
+    
+    if (isKeyFrame) {
+        if (sectionMask != ALL_AVATAR_DATA_SECTIONS) {
             if (shouldLogError(now)) {
-                qDebug() << "Discard nan AvatarData::yaw,pitch,roll; displayName = '" << _displayName << "'";
+                qDebug() << "Malformed AvatarData key frame without all of its sections;"
+                    << " displayName = '" << _displayName << "'";
             }
-            return maxAvailableSize;
+            return bytesRead;
         }
-        _bodyYaw = yaw;
-        _bodyPitch = pitch;
-        _bodyRoll = roll;
         
-        // scale
-        float scale;
-        sourceBuffer += unpackFloatRatioFromTwoByte(sourceBuffer, scale);
-        if (glm::isnan(scale)) {
-            if (shouldLogError(now)) {
-                qDebug() << "Discard nan AvatarData::scale; displayName = '" << _displayName << "'";
+        // keep the key frame for the deltas that are encoded against it
+        for (int section = 0; section < NUM_AVATAR_DATA_SECTIONS; section++) {
+            // resizing in place keeps the buffer of the last key frame when it is as big, which it nearly always is
+            QByteArray& keyFrameSection = _receivedKeyFrameSections[section];
+            keyFrameSection.resize(sectionSizes[section]);
+            memcpy(keyFrameSection.data(), sections[section], sectionSizes[section]);
+        }
+        _receivedKeyFrameSequence = keyFrameSequence;
+        _hasReceivedKeyFrame = true;
+        
+    } else if (!_hasReceivedKeyFrame || keyFrameSequence != _receivedKeyFrameSequence) {
+        // this delta is against a key frame that was lost or hasn't arrived, the next key frame will catch us up
+        return bytesRead;
+        
+    } else {
+        // the sections the delta leaves out are the same as they were in the key frame
+        for (int section = 0; section < NUM_AVATAR_DATA_SECTIONS; section++) {
+            if (!sections[section]) {
+                sections[section] = reinterpret_cast<const unsigned char*>(_receivedKeyFrameSections[section].constData());
+                sectionSizes[section] = _receivedKeyFrameSections[section].size();
             }
-            return maxAvailableSize;
         }
-        _targetScale = scale;
-    } // 20 bytes
-    
-    { // Head rotation 
-        //(NOTE: This needs to become a quaternion to save two bytes)
-        float headYaw, headPitch, headRoll;
-        sourceBuffer += unpackFloatAngleFromTwoByte((uint16_t*) sourceBuffer, &headYaw);
-        sourceBuffer += unpackFloatAngleFromTwoByte((uint16_t*) sourceBuffer, &headPitch);
-        sourceBuffer += unpackFloatAngleFromTwoByte((uint16_t*) sourceBuffer, &headRoll);
-        if (glm::isnan(headYaw) || glm::isnan(headPitch) || glm::isnan(headRoll)) {
-            if (shouldLogError(now)) {
-                qDebug() << "Discard nan AvatarData::headYaw,headPitch,headRoll; displayName = '" << _displayName << "'";
+    }
+    
+    for (int section = 0; section < NUM_AVATAR_DATA_SECTIONS; section++) {
+        if (!parseSection(section, sections[section], sectionSizes[section], now)) {
+            break;
+        }
+    }
+    
+    return bytesRead;
+}
+
+bool AvatarData::parseSection(int section, const unsigned char* sourceBuffer, int size, quint64 now) {
+    const unsigned char* endPosition = sourceBuffer + size;
+    
+    switch (section) {
+        case AVATAR_POSITION_SECTION: {
+            glm::vec3 position;
+            memcpy(&position, sourceBuffer, sizeof(position));
+            
+            if (glm::isnan(position.x) || glm::isnan(position.y) || glm::isnan(position.z)) {
+                if (shouldLogError(now)) {
+                    qDebug() << "Discard nan AvatarData::position; displayName = '" << _displayName << "'";
+                }
+                return false;
             }
-            return maxAvailableSize;
+            _position = position;
+            return true;
         }
-        _headData->setBaseYaw(headYaw);
-        _headData->setBasePitch(headPitch);
-        _headData->setBaseRoll(headRoll);
-    } // 6 bytes
-        
-    // Head lean (relative to pelvis)
-    {
-        float leanSideways, leanForward;
-        memcpy(&leanSideways, sourceBuffer, sizeof(float));
-        sourceBuffer += sizeof(float);
-        memcpy(&leanForward, sourceBuffer, sizeof(float));
-        sourceBuffer += sizeof(float);
-        if (glm::isnan(leanSideways) || glm::isnan(leanForward)) {
-            if (shouldLogError(now)) {
-                qDebug() << "Discard nan AvatarData::leanSideways,leanForward; displayName = '" << _displayName << "'";
+        case AVATAR_BODY_SECTION: {
+            // rotation (NOTE: This needs to become a quaternion to save two bytes)
+            float yaw, pitch, roll;
+            sourceBuffer += unpackFloatAngleFromTwoByte((uint16_t*) sourceBuffer, &yaw);
+            sourceBuffer += unpackFloatAngleFromTwoByte((uint16_t*) sourceBuffer, &pitch);
+            sourceBuffer += unpackFloatAngleFromTwoByte((uint16_t*) sourceBuffer, &roll);
+            if (glm::isnan(yaw) || glm::isnan(pitch) || glm::isnan(roll)) {
+                if (shouldLogError(now)) {
+                    qDebug() << "Discard nan AvatarData::yaw,pitch,roll; displayName = '" << _displayName << "'";
+                }
+                return false;
             }
-            return maxAvailableSize;
+            _bodyYaw = yaw;
+            _bodyPitch = pitch;
+            _bodyRoll = roll;
+            
+            // scale
+            float scale;
+            sourceBuffer += unpackFloatRatioFromTwoByte(sourceBuffer, scale);
+            if (glm::isnan(scale)) {
+                if (shouldLogError(now)) {
+                    qDebug() << "Discard nan AvatarData::scale; displayName = '" << _displayName << "'";
+                }
+                return false;
+            }
+            _targetScale = scale;
+            return true;
         }
-        _headData->_leanSideways = leanSideways;
-        _headData->_leanForward = leanForward;
-    } // 8 bytes
-    
-    { // Lookat Position
-        glm::vec3 lookAt;
-        memcpy(&lookAt, sourceBuffer, sizeof(lookAt));
-        sourceBuffer += sizeof(lookAt);
-        if (glm::isnan(lookAt.x) || glm::isnan(lookAt.y) || glm::isnan(lookAt.z)) {
-            if (shouldLogError(now)) {
-                qDebug() << "Discard nan AvatarData::lookAt; displayName = '" << _displayName << "'";
+        case AVATAR_HEAD_SECTION: {
+            //(NOTE: This needs to become a quaternion to save two bytes)
+            float headYaw, headPitch, headRoll;
+            sourceBuffer += unpackFloatAngleFromTwoByte((uint16_t*) sourceBuffer, &headYaw);
+            sourceBuffer += unpackFloatAngleFromTwoByte((uint16_t*) sourceBuffer, &headPitch);
+            sourceBuffer += unpackFloatAngleFromTwoByte((uint16_t*) sourceBuffer, &headRoll);
+            if (glm::isnan(headYaw) || glm::isnan(headPitch) || glm::isnan(headRoll)) {
+                if (shouldLogError(now)) {
+                    qDebug() << "Discard nan AvatarData::headYaw,headPitch,headRoll; displayName = '" << _displayName << "'";
+                }
+                return false;
             }
-            return maxAvailableSize;
+            _headData->setBaseYaw(headYaw);
+            _headData->setBasePitch(headPitch);
+            _headData->setBaseRoll(headRoll);
+            
+            // Head lean (relative to pelvis)
+            float leanSideways, leanForward;
+            memcpy(&leanSideways, sourceBuffer, sizeof(float));
+            sourceBuffer += sizeof(float);
+            memcpy(&leanForward, sourceBuffer, sizeof(float));
+            sourceBuffer += sizeof(float);
+            if (glm::isnan(leanSideways) || glm::isnan(leanForward)) {
+                if (shouldLogError(now)) {
+                    qDebug() << "Discard nan AvatarData::leanSideways,leanForward; displayName = '" << _displayName << "'";
+                }
+                return false;
+            }
+            _headData->_leanSideways = leanSideways;
+            _headData->_leanForward = leanForward;
+            return true;
         }
-        _headData->_lookAtPosition = lookAt;
-    } // 12 bytes
-    
-    { // AudioLoudness
-        // Instantaneous audio loudness (used to drive facial animation)
-        float audioLoudness;
-        memcpy(&audioLoudness, sourceBuffer, sizeof(float));
-        sourceBuffer += sizeof(float);
-        if (glm::isnan(audioLoudness)) {
-            if (shouldLogError(now)) {
-                qDebug() << "Discard nan AvatarData::audioLoudness; displayName = '" << _displayName << "'";
+        case AVATAR_LOOK_AT_SECTION: {
+            glm::vec3 lookAt;
+            memcpy(&lookAt, sourceBuffer, sizeof(lookAt));
+            if (glm::isnan(lookAt.x) || glm::isnan(lookAt.y) || glm::isnan(lookAt.z)) {
+                if (shouldLogError(now)) {
+                    qDebug() << "Discard nan AvatarData::lookAt; displayName = '" << _displayName << "'";
+                }
+                return false;
             }
-            return maxAvailableSize;
-         }
-        _headData->_audioLoudness = audioLoudness;
-    } // 4 bytes
-    
-    // chat
-    int chatMessageSize = *sourceBuffer++;
-    minPossibleSize += chatMessageSize;
-    if (minPossibleSize > maxAvailableSize) {
-        if (shouldLogError(now)) {
-            qDebug() << "Malformed AvatarData packet before ChatMessage;"
-                << " displayName = '" << _displayName << "'"
-                << " minPossibleSize = " << minPossibleSize 
-                << " maxAvailableSize = " << maxAvailableSize;
+            _headData->_lookAtPosition = lookAt;
+            return true;
         }
-        return maxAvailableSize;
-    }
-    { // chat payload
-        _chatMessage = string((char*)sourceBuffer, chatMessageSize);
-        sourceBuffer += chatMessageSize * sizeof(char);
-    } // 1 + chatMessageSize bytes
-    
-    { // bitFlags and face data
-        unsigned char bitItems = 0;
-        bitItems = (unsigned char)*sourceBuffer++;
-    
-        // key state, stored as a semi-nibble in the bitItems
-        _keyState = (KeyState)getSemiNibbleAt(bitItems,KEY_STATE_START_BIT);
-        
-        // hand state, stored as a semi-nibble in the bitItems
-        _handState = getSemiNibbleAt(bitItems,HAND_STATE_START_BIT);
-        
-        _headData->_isFaceshiftConnected = oneAtBit(bitItems, IS_FACESHIFT_CONNECTED);
-        _isChatCirclingEnabled = oneAtBit(bitItems, IS_CHAT_CIRCLING_ENABLED);
-        
-        if (_headData->_isFaceshiftConnected) {
-            float leftEyeBlink, rightEyeBlink, averageLoudness, browAudioLift;
-            minPossibleSize += sizeof(leftEyeBlink) + sizeof(rightEyeBlink) + sizeof(averageLoudness) + sizeof(browAudioLift);
-            minPossibleSize++; // one byte for blendDataSize
-            if (minPossibleSize > maxAvailableSize) {
+        case AVATAR_AUDIO_LOUDNESS_SECTION: {
+            // Instantaneous audio loudness (used to drive facial animation)
+            float audioLoudness;
+            memcpy(&audioLoudness, sourceBuffer, sizeof(float));
+            if (glm::isnan(audioLoudness)) {
                 if (shouldLogError(now)) {
-                    qDebug() << "Malformed AvatarData packet after BitItems;"
+                    qDebug() << "Discard nan AvatarData::audioLoudness; displayName = '" << _displayName << "'";
+                }
+                return false;
+            }
+            _headData->_audioLoudness = audioLoudness;
+            return true;
+        }
+        case AVATAR_FACE_SECTION: {
+            // chat size, chat payload, bit items and pupil dilation are the least there can be
+            int chatMessageSize = *sourceBuffer++;
+            int minPossibleSize = 1 + chatMessageSize + 1 + 1;
+            if (minPossibleSize > size) {
+                if (shouldLogError(now)) {
+                    qDebug() << "Malformed AvatarData packet before ChatMessage;"
                         << " displayName = '" << _displayName << "'"
-                        << " minPossibleSize = " << minPossibleSize 
-                        << " maxAvailableSize = " << maxAvailableSize;
+                        << " minPossibleSize = " << minPossibleSize
+                        << " maxAvailableSize = " << size;
                 }
-                return maxAvailableSize;
+                return false;
             }
-            // unpack face data
-            memcpy(&leftEyeBlink, sourceBuffer, sizeof(float));
-            sourceBuffer += sizeof(float);
+            _chatMessage.assign((const char*)sourceBuffer, chatMessageSize);
+            sourceBuffer += chatMessageSize * sizeof(char);
             
-            memcpy(&rightEyeBlink, sourceBuffer, sizeof(float));
-            sourceBuffer += sizeof(float);
+            unsigned char bitItems = (unsigned char)*sourceBuffer++;
             
-            memcpy(&averageLoudness, sourceBuffer, sizeof(float));
-            sourceBuffer += sizeof(float);
+            // key state, stored as a semi-nibble in the bitItems
+            _keyState = (KeyState)getSemiNibbleAt(bitItems,KEY_STATE_START_BIT);
             
-            memcpy(&browAudioLift, sourceBuffer, sizeof(float));
-            sourceBuffer += sizeof(float);
+            // hand state, stored as a semi-nibble in the bitItems
+            _handState = getSemiNibbleAt(bitItems,HAND_STATE_START_BIT);
+            
+            _headData->_isFaceshiftConnected = oneAtBit(bitItems, IS_FACESHIFT_CONNECTED);
+            _isChatCirclingEnabled = oneAtBit(bitItems, IS_CHAT_CIRCLING_ENABLED);
             
-            if (glm::isnan(leftEyeBlink) || glm::isnan(rightEyeBlink) 
-                    || glm::isnan(averageLoudness) || glm::isnan(browAudioLift)) {
+            if (_headData->_isFaceshiftConnected) {
+                float leftEyeBlink, rightEyeBlink, averageLoudness, browAudioLift;
+                minPossibleSize += sizeof(leftEyeBlink) + sizeof(rightEyeBlink) + sizeof(averageLoudness) + sizeof(browAudioLift);
+                minPossibleSize++; // one byte for blendDataSize
+                if (minPossibleSize > size) {
+                    if (shouldLogError(now)) {
+                        qDebug() << "Malformed AvatarData packet after BitItems;"
+                            << " displayName = '" << _displayName << "'"
+                            << " minPossibleSize = " << minPossibleSize
+                            << " maxAvailableSize = " << size;
+                    }
+                    return false;
+                }
+                // unpack face data
+                memcpy(&leftEyeBlink, sourceBuffer, sizeof(float));
+                sourceBuffer += sizeof(float);
+                
+                memcpy(&rightEyeBlink, sourceBuffer, sizeof(float));
+                sourceBuffer += sizeof(float);
+                
+                memcpy(&averageLoudness, sourceBuffer, sizeof(float));
+                sourceBuffer += sizeof(float);
+                
+                memcpy(&browAudioLift, sourceBuffer, sizeof(float));
+                sourceBuffer += sizeof(float);
+                
+                if (glm::isnan(leftEyeBlink) || glm::isnan(rightEyeBlink)
+                        || glm::isnan(averageLoudness) || glm::isnan(browAudioLift)) {
+                    if (shouldLogError(now)) {
+                        qDebug() << "Discard nan AvatarData::faceData; displayName = '" << _displayName << "'";
+                    }
+                    return false;
+                }
+                _headData->_leftEyeBlink = leftEyeBlink;
+                _headData->_rightEyeBlink = rightEyeBlink;
+                _headData->_averageLoudness = averageLoudness;
+                _headData->_browAudioLift = browAudioLift;
+                
+                int numCoefficients = (int)(*sourceBuffer++);
+                int blendDataSize = numCoefficients * sizeof(float);
+                minPossibleSize += blendDataSize;
+                if (minPossibleSize > size) {
+                    if (shouldLogError(now)) {
+                        qDebug() << "Malformed AvatarData packet after Blendshapes;"
+                            << " displayName = '" << _displayName << "'"
+                            << " minPossibleSize = " << minPossibleSize
+                            << " maxAvailableSize = " << size;
+                    }
+                    return false;
+                }
+                
+                if (_headData->_blendshapeCoefficients.capacity() < MAX_BLENDSHAPE_COEFFICIENTS_PER_UPDATE) {
+                    _headData->_blendshapeCoefficients.reserve(MAX_BLENDSHAPE_COEFFICIENTS_PER_UPDATE);
+                }
+                _headData->_blendshapeCoefficients.resize(numCoefficients);
+                memcpy(_headData->_blendshapeCoefficients.data(), sourceBuffer, blendDataSize);
+                sourceBuffer += numCoefficients * sizeof(float);
+            }
+            
+            // pupil dilation
+            sourceBuffer += unpackFloatFromByte(sourceBuffer, _headData->_pupilDilation, 1.0f);
+            return true;
+        }
+        case AVATAR_JOINTS_SECTION: {
+            int numJoints = *sourceBuffer++;
+            int bytesOfValidity = (int)ceil((float)numJoints / (float)BITS_IN_BYTE);
+            if (sourceBuffer + bytesOfValidity > endPosition) {
                 if (shouldLogError(now)) {
-                    qDebug() << "Discard nan AvatarData::faceData; displayName = '" << _displayName << "'";
+                    qDebug() << "Malformed AvatarData packet after JointValidityBits;"
+                        << " displayName = '" << _displayName << "'"
+                        << " maxAvailableSize = " << size;
                 }
-                return maxAvailableSize;
+                return false;
             }
-            _headData->_leftEyeBlink = leftEyeBlink;
-            _headData->_rightEyeBlink = rightEyeBlink;
-            _headData->_averageLoudness = averageLoudness;
-            _headData->_browAudioLift = browAudioLift;
             
-            int numCoefficients = (int)(*sourceBuffer++);
-            int blendDataSize = numCoefficients * sizeof(float);
-            minPossibleSize += blendDataSize;
-            if (minPossibleSize > maxAvailableSize) {
+            // count the valid joints first, so that the joints are only touched once all of the rotations are known
+            // to be there and without a copy of them to hold the validity in the meantime
+            const unsigned char* validityBuffer = sourceBuffer;
+            int numValidJoints = 0;
+            for (int i = 0; i < numJoints; i++) {
+                if (validityBuffer[i / BITS_IN_BYTE] & (1 << (i % BITS_IN_BYTE))) {
+                    ++numValidJoints;
+                }
+            }
+            sourceBuffer += bytesOfValidity;
+            
+            // each joint rotation is stored as its three smallest components in six bytes
+            const int BYTES_PER_JOINT_ROTATION = 6;
+            if (sourceBuffer + numValidJoints * BYTES_PER_JOINT_ROTATION > endPosition) {
                 if (shouldLogError(now)) {
-                    qDebug() << "Malformed AvatarData packet after Blendshapes;"
+                    qDebug() << "Malformed AvatarData packet after JointData;"
                         << " displayName = '" << _displayName << "'"
-                        << " minPossibleSize = " << minPossibleSize 
-                        << " maxAvailableSize = " << maxAvailableSize;
+                        << " maxAvailableSize = " << size;
                 }
-                return maxAvailableSize;
+                return false;
             }
-
-            _headData->_blendshapeCoefficients.resize(numCoefficients);
-            memcpy(_headData->_blendshapeCoefficients.data(), sourceBuffer, blendDataSize);
-            sourceBuffer += numCoefficients * sizeof(float);
-    
-            //bitItemsDataSize = 4 * sizeof(float) + 1 + blendDataSize;
-        }
-    } // 1 + bitItemsDataSize bytes
-    
-    { // pupil dilation
-        sourceBuffer += unpackFloatFromByte(sourceBuffer, _headData->_pupilDilation, 1.0f);
-    } // 1 byte
-    
-    // joint data
-    int numJoints = *sourceBuffer++;
-    int bytesOfValidity = (int)ceil((float)numJoints / (float)BITS_IN_BYTE);
-    minPossibleSize += bytesOfValidity;
-    if (minPossibleSize > maxAvailableSize) {
-        if (shouldLogError(now)) {
-            qDebug() << "Malformed AvatarData packet after JointValidityBits;"
-                << " displayName = '" << _displayName << "'"
-                << " minPossibleSize = " << minPossibleSize 
-                << " maxAvailableSize = " << maxAvailableSize;
-        }
-        return maxAvailableSize;
-    }
-    int numValidJoints = 0;
-    _jointData.resize(numJoints);
-    { // validity bits
-        unsigned char validity = 0;
-        int validityBit = 0;
-        for (int i = 0; i < numJoints; i++) {
-            if (validityBit == 0) {
-                validity = *sourceBuffer++;
+            
+            // with room for as many joints as a count of a byte can have, the joints never reallocate or shrink
+            if (_jointData.capacity() < MAX_JOINTS_PER_UPDATE) {
+                _jointData.reserve(MAX_JOINTS_PER_UPDATE);
             }
-            bool valid = (bool)(validity & (1 << validityBit));
-            if (valid) {
-                ++numValidJoints;
+            _jointData.resize(numJoints);
+            for (int i = 0; i < numJoints; i++) {
+                JointData& data = _jointData[i];
+                data.valid = (validityBuffer[i / BITS_IN_BYTE] & (1 << (i % BITS_IN_BYTE)));
+                if (data.valid) {
+                    sourceBuffer += unpackOrientationQuatFromSixBytes(sourceBuffer, data.rotation);
+                }
             }
-            _jointData[i].valid = valid;
-            validityBit = (validityBit + 1) % BITS_IN_BYTE; 
-        }
-    }
-    // 1 + bytesOfValidity bytes
-
-    // each joint rotation component is stored in two bytes (sizeof(uint16_t))
-    int COMPONENTS_PER_QUATERNION = 4;
-    minPossibleSize += numValidJoints * COMPONENTS_PER_QUATERNION * sizeof(uint16_t);
-    if (minPossibleSize > maxAvailableSize) {
-        if (shouldLogError(now)) {
-            qDebug() << "Malformed AvatarData packet after JointData;"
-                << " displayName = '" << _displayName << "'"
-                << " minPossibleSize = " << minPossibleSize 
-                << " maxAvailableSize = " << maxAvailableSize;
+            _hasNewJointRotations = true;
+            return true;
         }
-        return maxAvailableSize;
     }
-
-    { // joint data
-        for (int i = 0; i < numJoints; i++) {
-            JointData& data = _jointData[i];
-            if (data.valid) {
-                sourceBuffer += unpackOrientationQuatFromBytes(sourceBuffer, data.rotation);
-            }
-        }
-    } // numJoints * 8 bytes
-    _hasNewJointRotations = true;
     
-    return sourceBuffer - startPosition;
+    return true;
 }
 
 void AvatarData::setJointData(int index, const glm::quat& rotation) {
@@ -841,6 +983,10 @@ void AvatarData::updateJointMappings() {
     }
 }
 
+QByteArray hashForAvatarContent(const QByteArray& content) {
+    return content.isEmpty() ? QByteArray() : QCryptographicHash::hash(content, QCryptographicHash::Md5);
+}
+
 AttachmentData::AttachmentData() :
     scale(1.0f) {
 }
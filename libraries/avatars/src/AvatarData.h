@@ -87,9 +87,32 @@ static const float MIN_AVATAR_SCALE = .005f;
 
 const float MAX_AUDIO_LOUDNESS = 1000.0; // close enough for mouth animation
 
+// an update is split into sections, a delta only carries the sections that differ from the key frame it is against
+enum AvatarDataSection {
+    AVATAR_POSITION_SECTION = 0,
+    AVATAR_BODY_SECTION,
+    AVATAR_HEAD_SECTION,
+    AVATAR_LOOK_AT_SECTION,
+    AVATAR_AUDIO_LOUDNESS_SECTION,
+    AVATAR_FACE_SECTION,
+    AVATAR_JOINTS_SECTION,
+    NUM_AVATAR_DATA_SECTIONS
+};
+
+// every this many updates of an avatar is a key frame, which is what a receiver that lost one has to wait for
+const int AVATAR_KEY_FRAME_INTERVAL = 30;
+
 const int AVATAR_IDENTITY_PACKET_SEND_INTERVAL_MSECS = 1000;
 const int AVATAR_BILLBOARD_PACKET_SEND_INTERVAL_MSECS = 5000;
 
+// the contents of an avatar that the avatar-mixer refreshes by their hashes, which a client asks for when it finds that
+// what it has is out of date
+const unsigned char AVATAR_IDENTITY_CONTENT = 1;
+const unsigned char AVATAR_BILLBOARD_CONTENT = 2;
+
+/// returns the hash an identity or billboard payload is refreshed by, which is empty for a payload that is empty
+QByteArray hashForAvatarContent(const QByteArray& content);
+
 const QUrl DEFAULT_HEAD_MODEL_URL = QUrl("http://public.highfidelity.io/meshes/defaultAvatar_head.fst");
 const QUrl DEFAULT_BODY_MODEL_URL = QUrl("http://public.highfidelity.io/meshes/defaultAvatar_body.fst");
 
@@ -145,7 +168,16 @@ public:
     glm::vec3 getHandPosition() const;
     void setHandPosition(const glm::vec3& handPosition);
 
+    /// encodes the avatar for an update, as a key frame every AVATAR_KEY_FRAME_INTERVAL calls and otherwise as a delta
+    /// holding only the sections that differ from the last key frame
     QByteArray toByteArray();
+    
+    /// the last key frame toByteArray encoded, the deltas after it can only be parsed by a receiver that has it
+    const QByteArray& getLastKeyFrame() const { return _lastKeyFrame; }
+    quint16 getKeyFrameSequence() const { return _keyFrameSequence; }
+    
+    /// \return true if the last call to toByteArray encoded a key frame
+    bool wasLastUpdateKeyFrame() const { return _updatesSinceKeyFrame == 0; }
 
     /// \return true if an error should be logged
     bool shouldLogError(const quint64& now);
@@ -333,6 +365,23 @@ private:
     // privatize the copy constructor and assignment operator so they cannot be called
     AvatarData(const AvatarData&);
     AvatarData& operator= (const AvatarData&);
+    
+    /// writes one section of an update, returns its size
+    int writeSection(int section, unsigned char* destinationBuffer);
+    
+    /// reads one section of an update, returns false if it was bad and has to be discarded
+    bool parseSection(int section, const unsigned char* sourceBuffer, int size, quint64 now);
+    
+    // the key frame the deltas we send are encoded against
+    QByteArray _keyFrameSections[NUM_AVATAR_DATA_SECTIONS];
+    QByteArray _lastKeyFrame;
+    quint16 _keyFrameSequence;
+    int _updatesSinceKeyFrame;
+    
+    // the key frame the deltas we receive are applied to
+    QByteArray _receivedKeyFrameSections[NUM_AVATAR_DATA_SECTIONS];
+    quint16 _receivedKeyFrameSequence;
+    bool _hasReceivedKeyFrame;
 };
 
 class JointData {
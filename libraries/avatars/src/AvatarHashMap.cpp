@@ -9,12 +9,15 @@
 //  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
 //
 
+#include <NodeList.h>
 #include <PacketHeaders.h>
 
 #include "AvatarHashMap.h"
 
 AvatarHashMap::AvatarHashMap() :
-    _avatarHash()
+    _avatarHash(),
+    _identityHashes(),
+    _billboardHashes()
 {
     
 }
@@ -26,9 +29,28 @@ void AvatarHashMap::insert(const QUuid& id, AvatarSharedPointer avatar) {
 
 AvatarHash::iterator AvatarHashMap::erase(const AvatarHash::iterator& iterator) {
     qDebug() << "Removing Avatar with UUID" << iterator.key() << "from AvatarHashMap.";
+    _identityHashes.remove(iterator.key());
+    _billboardHashes.remove(iterator.key());
     return _avatarHash.erase(iterator);
 }
 
+void AvatarHashMap::queueAvatarMixerDatagram(const QByteArray& datagram, const QWeakPointer<Node>& mixerWeakPointer) {
+    QMutexLocker locker(&_queuedDatagramsMutex);
+    _queuedDatagrams.append(QueuedDatagram(datagram, mixerWeakPointer));
+}
+
+void AvatarHashMap::processQueuedDatagrams() {
+    {
+        QMutexLocker locker(&_queuedDatagramsMutex);
+        _queuedDatagrams.swap(_processingDatagrams);
+    }
+    for (int i = 0; i < _processingDatagrams.size(); i++) {
+        const QueuedDatagram& datagram = _processingDatagrams.at(i);
+        processAvatarMixerDatagram(datagram.first, datagram.second);
+    }
+    _processingDatagrams.clear();
+}
+
 const qint64 AVATAR_SILENCE_THRESHOLD_MSECS = 5 * 1000;
 
 bool AvatarHashMap::shouldKillAvatar(const AvatarSharedPointer& sharedAvatar) {
@@ -47,6 +69,9 @@ void AvatarHashMap::processAvatarMixerDatagram(const QByteArray& datagram, const
         case PacketTypeAvatarBillboard:
             processAvatarBillboardPacket(datagram, mixerWeakPointer);
             break;
+        case PacketTypeAvatarContentHashes:
+            processAvatarContentHashesPacket(datagram, mixerWeakPointer);
+            break;
         case PacketTypeKillAvatar:
             processKillAvatar(datagram);
             break;
@@ -104,17 +129,29 @@ AvatarSharedPointer AvatarHashMap::matchingOrNewAvatar(const QUuid& sessionUUID,
 void AvatarHashMap::processAvatarDataPacket(const QByteArray &datagram, const QWeakPointer<Node> &mixerWeakPointer) {
     int bytesRead = numBytesForPacketHeader(datagram);
     
+    // the identity and billboard of an avatar we haven't seen before are asked for right away
+    QByteArray contentRequest;
+    
     // enumerate over all of the avatars in this packet
     // only add them if mixerWeakPointer points to something (meaning that mixer is still around)
     while (bytesRead < datagram.size() && mixerWeakPointer.data()) {
         QUuid sessionUUID = QUuid::fromRfc4122(datagram.mid(bytesRead, NUM_BYTES_RFC4122_UUID));
         bytesRead += NUM_BYTES_RFC4122_UUID;
         
+        if (!_avatarHash.contains(sessionUUID)) {
+            contentRequest.append(sessionUUID.toRfc4122());
+            contentRequest.append((char) (AVATAR_IDENTITY_CONTENT | AVATAR_BILLBOARD_CONTENT));
+        }
+        
         AvatarSharedPointer matchingAvatarData = matchingOrNewAvatar(sessionUUID, mixerWeakPointer);
         
         // have the matching (or new) avatar parse the data from the packet
         bytesRead += matchingAvatarData->parseDataAtOffset(datagram, bytesRead);
     }
+    
+    if (!contentRequest.isEmpty()) {
+        sendAvatarContentRequest(contentRequest, mixerWeakPointer);
+    }
 }
 
 void AvatarHashMap::processAvatarIdentityPacket(const QByteArray &packet, const QWeakPointer<Node>& mixerWeakPointer) {
@@ -124,6 +161,9 @@ void AvatarHashMap::processAvatarIdentityPacket(const QByteArray &packet, const
     
     QUuid sessionUUID;
     
+    // the avatar-mixer sends one identity to a packet, and hashes all of it
+    QByteArray identityHash = hashForAvatarContent(packet.mid(numBytesForPacketHeader(packet)));
+    
     while (!identityStream.atEnd()) {
         
         QUrl faceMeshURL, skeletonURL;
@@ -150,6 +190,8 @@ void AvatarHashMap::processAvatarIdentityPacket(const QByteArray &packet, const
             if (matchingAvatar->getDisplayName() != displayName) {
                 matchingAvatar->setDisplayName(displayName);
             }
+            
+            _identityHashes.insert(sessionUUID, identityHash);
         }
     }
 }
@@ -164,6 +206,60 @@ void AvatarHashMap::processAvatarBillboardPacket(const QByteArray& packet, const
         if (matchingAvatar->getBillboard() != billboard) {
             matchingAvatar->setBillboard(billboard);
         }
+        _billboardHashes.insert(sessionUUID, hashForAvatarContent(billboard));
+    }
+}
+
+void AvatarHashMap::processAvatarContentHashesPacket(const QByteArray& packet, const QWeakPointer<Node>& mixerWeakPointer) {
+    QByteArray contentRequest;
+    
+    // each avatar is its UUID, the flags of the hashes that follow and then the hashes, identity first
+    int offset = numBytesForPacketHeader(packet);
+    while (offset + NUM_BYTES_RFC4122_UUID + (int) sizeof(unsigned char) <= packet.size()) {
+        QByteArray uuidByteArray = packet.mid(offset, NUM_BYTES_RFC4122_UUID);
+        offset += NUM_BYTES_RFC4122_UUID;
+        unsigned char contentFlags = packet.at(offset++);
+        
+        QUuid sessionUUID = QUuid::fromRfc4122(uuidByteArray);
+        unsigned char staleContent = 0;
+        
+        if (contentFlags & AVATAR_IDENTITY_CONTENT) {
+            if (offset + NUM_BYTES_MD5_HASH > packet.size()) {
+                break;
+            }
+            if (_identityHashes.value(sessionUUID) != packet.mid(offset, NUM_BYTES_MD5_HASH)) {
+                staleContent |= AVATAR_IDENTITY_CONTENT;
+            }
+            offset += NUM_BYTES_MD5_HASH;
+        }
+        if (contentFlags & AVATAR_BILLBOARD_CONTENT) {
+            if (offset + NUM_BYTES_MD5_HASH > packet.size()) {
+                break;
+            }
+            if (_billboardHashes.value(sessionUUID) != packet.mid(offset, NUM_BYTES_MD5_HASH)) {
+                staleContent |= AVATAR_BILLBOARD_CONTENT;
+            }
+            offset += NUM_BYTES_MD5_HASH;
+        }
+        
+        // only what has changed since we last heard it is asked for again
+        if (staleContent != 0) {
+            contentRequest.append(uuidByteArray);
+            contentRequest.append((char) staleContent);
+        }
+    }
+    
+    if (!contentRequest.isEmpty()) {
+        sendAvatarContentRequest(contentRequest, mixerWeakPointer);
+    }
+}
+
+void AvatarHashMap::sendAvatarContentRequest(const QByteArray& request, const QWeakPointer<Node>& mixerWeakPointer) {
+    SharedNodePointer avatarMixer = mixerWeakPointer.toStrongRef();
+    if (avatarMixer) {
+        QByteArray requestPacket = byteArrayWithPopulatedHeader(PacketTypeAvatarContentRequest);
+        requestPacket.append(request);
+        NodeList::getInstance()->writeDatagram(requestPacket, avatarMixer);
     }
 }
 
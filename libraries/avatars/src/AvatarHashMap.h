@@ -13,8 +13,11 @@
 #define hifi_AvatarHashMap_h
 
 #include <QtCore/QHash>
+#include <QtCore/QMutex>
+#include <QtCore/QPair>
 #include <QtCore/QSharedPointer>
 #include <QtCore/QUuid>
+#include <QtCore/QVector>
 
 #include <Node.h>
 
@@ -33,6 +36,13 @@ public:
 
     virtual void insert(const QUuid& id, AvatarSharedPointer avatar);
     
+    /// queues a datagram from the avatar-mixer, from the thread that receives it, to be processed along with the
+    /// others that arrive before the next call to processQueuedDatagrams
+    void queueAvatarMixerDatagram(const QByteArray& datagram, const QWeakPointer<Node>& mixerWeakPointer);
+    
+    /// processes the queued datagrams, on the thread that uses the avatars
+    void processQueuedDatagrams();
+    
 public slots:
     void processAvatarMixerDatagram(const QByteArray& datagram, const QWeakPointer<Node>& mixerWeakPointer);
     bool containsAvatarWithDisplayName(const QString& displayName);
@@ -48,9 +58,24 @@ protected:
     void processAvatarDataPacket(const QByteArray& packet, const QWeakPointer<Node>& mixerWeakPointer);
     void processAvatarIdentityPacket(const QByteArray& packet, const QWeakPointer<Node>& mixerWeakPointer);
     void processAvatarBillboardPacket(const QByteArray& packet, const QWeakPointer<Node>& mixerWeakPointer);
+    void processAvatarContentHashesPacket(const QByteArray& packet, const QWeakPointer<Node>& mixerWeakPointer);
     void processKillAvatar(const QByteArray& datagram);
+    
+    void sendAvatarContentRequest(const QByteArray& request, const QWeakPointer<Node>& mixerWeakPointer);
 
     AvatarHash _avatarHash;
+    
+    // the hashes of the identity and billboard last received for each avatar, which the avatar-mixer's are checked against
+    QHash<QUuid, QByteArray> _identityHashes;
+    QHash<QUuid, QByteArray> _billboardHashes;
+    
+    typedef QPair<QByteArray, QWeakPointer<Node> > QueuedDatagram;
+    
+    // the datagrams are queued in one buffer while those in the other are processed, the two being swapped under the
+    // lock so that the receiving thread never waits on the processing
+    QMutex _queuedDatagramsMutex;
+    QVector<QueuedDatagram> _queuedDatagrams;
+    QVector<QueuedDatagram> _processingDatagrams;
 };
 
 #endif // hifi_AvatarHashMap_h
@@ -24,16 +24,33 @@ const char* HTTPConnection::StatusCode400 = "400 Bad Request";
 const char* HTTPConnection::StatusCode404 = "404 Not Found";
 const char* HTTPConnection::DefaultContentType = "text/plain; charset=ISO-8859-1";
 
+// how long a kept alive connection waits for another request before it's closed
+const int KEEP_ALIVE_TIMEOUT_MSECS = 30 * 1000;
+
+// the most response content that's left for the socket to write before more is read from the content device
+const qint64 MAX_PENDING_RESPONSE_BYTES = 64 * 1024;
+
+// how much response content is read from the content device at a time, and the largest chunk sent
+const qint64 RESPONSE_READ_BYTES = 16 * 1024;
+
 HTTPConnection::HTTPConnection (QTcpSocket* socket, HTTPManager* parentManager) :
     QObject(parentManager),
     _parentManager(parentManager),
     _socket(socket),
     _stream(socket),
-    _address(socket->peerAddress())
+    _address(socket->peerAddress()),
+    _keepAlive(false),
+    _responseContent(NULL),
+    _chunkedResponse(false),
+    _responseContentEnded(false)
 {
     // take over ownership of the socket
     _socket->setParent(this);
 
+    _idleTimer.setSingleShot(true);
+    _idleTimer.setInterval(KEEP_ALIVE_TIMEOUT_MSECS);
+    connect(&_idleTimer, SIGNAL(timeout()), _socket, SLOT(disconnectFromHost()));
+
     // connect initial slots
     connect(socket, SIGNAL(readyRead()), SLOT(readRequest()));
     connect(socket, SIGNAL(error(QAbstractSocket::SocketError)), SLOT(deleteLater()));
@@ -104,12 +121,91 @@ QList<FormData> HTTPConnection::parseFormData() const {
 }
 
 void HTTPConnection::respond(const char* code, const QByteArray& content, const char* contentType, const Headers& headers) {
+    int csize = content.size();
+    writeResponseHeaders(code, csize, contentType, headers);
+
+    if (csize > 0) {
+        _socket->write(content);
+    }
+
+    finishResponse();
+}
+
+void HTTPConnection::respond(const char* code, QIODevice* content, const char* contentType, const Headers& headers) {
+    _responseContent = content;
+    _responseContent->setParent(this);
+    _responseContentEnded = false;
+
+    if (_responseContent->isSequential()) {
+        // we don't know how much there'll be, so it goes in chunks to clients that take them
+        _chunkedResponse = (_requestVersion == "HTTP/1.1");
+        writeResponseHeaders(code, -1, contentType, headers);
+
+        connect(_responseContent, SIGNAL(readyRead()), SLOT(writeResponseContent()));
+        connect(_responseContent, SIGNAL(readChannelFinished()), SLOT(endResponseContent()));
+        connect(_responseContent, SIGNAL(aboutToClose()), SLOT(endResponseContent()));
+
+    } else {
+        _chunkedResponse = false;
+        writeResponseHeaders(code, _responseContent->size() - _responseContent->pos(), contentType, headers);
+    }
+
+    // the rest is written as the socket drains
+    connect(_socket, SIGNAL(bytesWritten(qint64)), SLOT(writeResponseContent()));
+    writeResponseContent();
+}
+
+void HTTPConnection::writeResponseContent() {
+    if (!_responseContent) {
+        return;
+    }
+    while (_socket->bytesToWrite() < MAX_PENDING_RESPONSE_BYTES) {
+        QByteArray content = _responseContent->read(RESPONSE_READ_BYTES);
+        if (!content.isEmpty()) {
+            if (_chunkedResponse) {
+                _socket->write(QByteArray::number(content.size(), 16));
+                _socket->write("\r\n");
+                _socket->write(content);
+                _socket->write("\r\n");
+
+            } else {
+                _socket->write(content);
+            }
+            continue;
+        }
+        if (_responseContent->isSequential() && !_responseContentEnded && _responseContent->isOpen()) {
+            // wait for the device to provide more
+            return;
+        }
+        if (!_responseContent->isSequential() && !_responseContent->atEnd()) {
+            // we've promised more content than we can send, so the client can only be told by closing
+            qWarning() << "Failed to read response content." << _address << _responseContent->errorString();
+            _keepAlive = false;
+        }
+        if (_chunkedResponse) {
+            _socket->write("0\r\n\r\n");
+        }
+        _socket->disconnect(SIGNAL(bytesWritten(qint64)), this);
+        _responseContent->disconnect(this);
+        _responseContent->deleteLater();
+        _responseContent = NULL;
+
+        finishResponse();
+        return;
+    }
+}
+
+void HTTPConnection::endResponseContent() {
+    _responseContentEnded = true;
+    writeResponseContent();
+}
+
+void HTTPConnection::writeResponseHeaders(const char* code, qint64 contentLength, const char* contentType,
+        const Headers& headers) {
     _socket->write("HTTP/1.1 ");
     _socket->write(code);
     _socket->write("\r\n");
 
-    int csize = content.size();
-
     for (Headers::const_iterator it = headers.constBegin(), end = headers.constEnd();
             it != end; it++) {
         _socket->write(it.key());
@@ -117,31 +213,61 @@ void HTTPConnection::respond(const char* code, const QByteArray& content, const
         _socket->write(it.value());
         _socket->write("\r\n");
     }
-    if (csize > 0) {
+    if (contentLength >= 0) {
+        // the length is sent even when there's no content, so that a kept alive connection knows where it ends
         _socket->write("Content-Length: ");
-        _socket->write(QByteArray::number(csize));
+        _socket->write(QByteArray::number(contentLength));
         _socket->write("\r\n");
 
+    } else if (_chunkedResponse) {
+        _socket->write("Transfer-Encoding: chunked\r\n");
+
+    } else {
+        // the end of the content is marked by closing the connection
+        _keepAlive = false;
+    }
+    if (contentLength != 0) {
         _socket->write("Content-Type: ");
         _socket->write(contentType);
         _socket->write("\r\n");
     }
-    _socket->write("Connection: close\r\n\r\n");
+    _socket->write(_keepAlive ? "Connection: keep-alive\r\n\r\n" : "Connection: close\r\n\r\n");
+}
 
-    if (csize > 0) {
-        _socket->write(content);
+void HTTPConnection::finishResponse() {
+    if (!_keepAlive) {
+        // make sure we receive no further read notifications
+        _socket->disconnect(SIGNAL(readyRead()), this);
+
+        _socket->disconnectFromHost();
+        return;
     }
 
-    // make sure we receive no further read notifications
-    _socket->disconnect(SIGNAL(readyRead()), this);
+    // clear out the request and wait for the next one, once whoever responded is done with this one
+    _requestUrl.clear();
+    _requestHeaders.clear();
+    _lastRequestHeader.clear();
+    _requestContent.clear();
+    _idleTimer.start();
+    QMetaObject::invokeMethod(this, "readNextRequest", Qt::QueuedConnection);
+}
+
+void HTTPConnection::readNextRequest() {
+    connect(_socket, SIGNAL(readyRead()), SLOT(readRequest()));
 
-    _socket->disconnectFromHost();
+    // the client may not have waited for the response to send the request
+    readRequest();
 }
 
 void HTTPConnection::readRequest() {
     if (!_socket->canReadLine()) {
         return;
     }
+    _idleTimer.stop();
+
+    // the connection is only kept alive once we know that the request is good and that the client wants it
+    _keepAlive = false;
+
     // parse out the method and resource
     QByteArray line = _socket->readLine().trimmed();
     if (line.startsWith("HEAD")) {
@@ -165,7 +291,9 @@ void HTTPConnection::readRequest() {
         return;
     }
     int idx = line.indexOf(' ') + 1;
-    _requestUrl.setUrl(line.mid(idx, line.lastIndexOf(' ') - idx));
+    int versionIdx = line.lastIndexOf(' ');
+    _requestUrl.setUrl(line.mid(idx, versionIdx - idx));
+    _requestVersion = (versionIdx >= idx) ? line.mid(versionIdx + 1) : QByteArray();
 
     // switch to reading the header
     _socket->disconnect(this, SLOT(readRequest()));
@@ -182,6 +310,11 @@ void HTTPConnection::readHeaders() {
         if (trimmed.isEmpty()) {
             _socket->disconnect(this, SLOT(readHeaders()));
 
+            // HTTP/1.1 connections stay open unless the client says otherwise, and earlier ones only if it asks
+            QByteArray connection = _requestHeaders.value("Connection").toLower();
+            _keepAlive = (_requestVersion == "HTTP/1.1") ? !connection.contains("close") :
+                connection.contains("keep-alive");
+
             QByteArray clength = _requestHeaders.value("Content-Length");
             if (clength.isEmpty()) {
                 _parentManager->handleHTTPRequest(this, _requestUrl);
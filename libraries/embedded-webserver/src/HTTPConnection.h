@@ -24,6 +24,7 @@
 #include <QtNetwork/QNetworkAccessManager>
 #include <QObject>
 #include <QPair>
+#include <QTimer>
 #include <QUrl>
 
 class QTcpSocket;
@@ -37,7 +38,8 @@ typedef QHash<QByteArray, QByteArray> Headers;
 /// A form data element
 typedef QPair<Headers, QByteArray> FormData;
 
-/// Handles a single HTTP connection.
+/// Handles a single HTTP connection. Connections are kept alive between requests when the client asks for it, as
+/// HTTP/1.1 clients do by default, and closed after they've been idle for a while.
 class HTTPConnection : public QObject {
    Q_OBJECT
 
@@ -76,11 +78,19 @@ public:
     /// Parses the request content as form data, returning a list of header/content pairs.
     QList<FormData> parseFormData () const;
 
-    /// Sends a response and closes the connection.
+    /// Sends a response, then closes the connection unless it's being kept alive.
     void respond (const char* code, const QByteArray& content = QByteArray(),
         const char* contentType = DefaultContentType,
         const Headers& headers = Headers());
 
+    /// Sends a response whose content is read from the device a piece at a time as the socket drains, so that large
+    /// content doesn't have to be loaded or written out all at once. The connection takes ownership of the device.
+    /// Content of a known size, such as a file's, is sent with its length; the content of a sequential device is sent
+    /// chunked until the device finishes reading or is closed.
+    void respond (const char* code, QIODevice* content,
+        const char* contentType = DefaultContentType,
+        const Headers& headers = Headers());
+
 protected slots:
 
     /// Reads the request line.
@@ -92,8 +102,24 @@ protected slots:
     /// Reads the content.
     void readContent ();
 
+    /// Starts reading the next request on a kept alive connection.
+    void readNextRequest ();
+
+    /// Writes as much of the response content as the socket will take.
+    void writeResponseContent ();
+
+    /// Notes that the response content device won't provide any more.
+    void endResponseContent ();
+
 protected:
 
+    /// Writes the status line and headers of a response; a negative content length means the content is chunked, or
+    /// delimited by closing the connection if the client can't take chunks.
+    void writeResponseHeaders (const char* code, qint64 contentLength, const char* contentType, const Headers& headers);
+
+    /// Closes the connection once a response has been written, or readies it for the next request.
+    void finishResponse ();
+
     /// The parent HTTP manager
     HTTPManager* _parentManager;
 
@@ -118,6 +144,24 @@ protected:
     /// The last request header processed (used for continuations).
     QByteArray _lastRequestHeader;
 
+    /// The HTTP version of the request.
+    QByteArray _requestVersion;
+
+    /// Whether the connection is to be kept open for another request after the response.
+    bool _keepAlive;
+
+    /// Closes a kept alive connection that no request arrives on.
+    QTimer _idleTimer;
+
+    /// The device the content of the response being written is read from, if any.
+    QIODevice* _responseContent;
+
+    /// Whether the response content is being sent in chunks.
+    bool _chunkedResponse;
+
+    /// Whether the response content device has finished providing content.
+    bool _responseContentEnded;
+
     /// The content of the request.
     QByteArray _requestContent;
 };
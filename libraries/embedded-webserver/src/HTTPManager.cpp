@@ -91,12 +91,20 @@ bool HTTPManager::handleHTTPRequest(HTTPConnection* connection, const QUrl& url)
             // file exists, serve it
             static QMimeDatabase mimeDatabase;
             
-            QFile localFile(filePath);
-            localFile.open(QIODevice::ReadOnly);
-            QByteArray localFileData = localFile.readAll();
-            
+            QFile* localFile = new QFile(filePath);
             QFileInfo localFileInfo(filePath);
             
+            if (localFileInfo.completeSuffix() != "shtml" && localFile->open(QIODevice::ReadOnly)) {
+                // the file is read as it's sent, rather than all at once
+                connection->respond(HTTPConnection::StatusCode200, localFile,
+                                    qPrintable(mimeDatabase.mimeTypeForFile(filePath).name()));
+                return true;
+            }
+            
+            localFile->open(QIODevice::ReadOnly);
+            QByteArray localFileData = localFile->readAll();
+            delete localFile;
+            
             if (localFileInfo.completeSuffix() == "shtml") {
                 // this is a file that may have some SSI statements
                 // the only thing we support is the include directive, but check the contents for that
@@ -9,15 +9,24 @@
 //  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
 //
 
+#include <algorithm>
+#include <cstring>
 #include <iostream>
 #include <QBuffer>
 #include <QDataStream>
 #include <QIODevice>
+#include <QMutex>
+#include <QRunnable>
+#include <QSharedPointer>
 #include <QStringList>
 #include <QTextStream>
+#include <QThreadPool>
+#include <QWaitCondition>
 #include <QtDebug>
 #include <QtEndian>
 
+#include <zlib.h>
+
 #include <glm/gtc/quaternion.hpp>
 #include <glm/gtx/quaternion.hpp>
 #include <glm/gtx/transform.hpp>
@@ -63,6 +72,22 @@ bool FBXMesh::hasSpecularTexture() const {
     return false;
 }
 
+qint64 FBXMesh::getMemoryBytes() const {
+    qint64 bytes = vertices.size() * sizeof(glm::vec3) + normals.size() * sizeof(glm::vec3) +
+        tangents.size() * sizeof(glm::vec3) + colors.size() * sizeof(glm::vec3) + texCoords.size() * sizeof(glm::vec2) +
+        clusterIndices.size() * sizeof(glm::vec4) + clusterWeights.size() * sizeof(glm::vec4) +
+        clusters.size() * sizeof(FBXCluster);
+    foreach (const FBXMeshPart& part, parts) {
+        bytes += (part.quadIndices.size() + part.triangleIndices.size()) * sizeof(int) +
+            part.diffuseTexture.content.size() + part.normalTexture.content.size() + part.specularTexture.content.size();
+    }
+    foreach (const FBXBlendshape& blendshape, blendshapes) {
+        bytes += blendshape.indices.size() * sizeof(int) + blendshape.vertices.size() * sizeof(glm::vec3) +
+            blendshape.normals.size() * sizeof(glm::vec3);
+    }
+    return bytes;
+}
+
 QStringList FBXGeometry::getJointNames() const {
     QStringList names;
     foreach (const FBXJoint& joint, joints) {
@@ -80,10 +105,38 @@ bool FBXGeometry::hasBlendedMeshes() const {
     return false;
 }
 
+qint64 FBXGeometry::getMemoryBytes() const {
+    qint64 bytes = joints.size() * sizeof(FBXJoint);
+    foreach (const FBXMesh& mesh, meshes) {
+        bytes += mesh.getMemoryBytes();
+    }
+    foreach (const FBXAnimationFrame& frame, animationFrames) {
+        bytes += frame.rotations.size() * sizeof(glm::quat);
+    }
+    return bytes;
+}
+
 static int fbxGeometryMetaTypeId = qRegisterMetaType<FBXGeometry>();
 static int fbxAnimationFrameMetaTypeId = qRegisterMetaType<FBXAnimationFrame>();
 static int fbxAnimationFrameVectorMetaTypeId = qRegisterMetaType<QVector<FBXAnimationFrame> >();
 
+/// converts the little-endian values of a binary array read straight into memory to the host's order
+template<class T> void convertFromLittleEndian(QVector<T>& values) {
+#if Q_BYTE_ORDER == Q_BIG_ENDIAN
+    for (T* it = values.data(), *end = it + values.size(); it != end; it++) {
+        std::reverse((char*)it, (char*)(it + 1));
+    }
+#endif
+}
+
+void convertFromLittleEndian(QVector<bool>& values) {
+    // the bytes may hold any nonzero value for true
+    const char* bytes = (const char*)values.constData();
+    for (int i = 0; i < values.size(); i++) {
+        values[i] = (bytes[i] != 0);
+    }
+}
+
 template<class T> QVariant readBinaryArray(QDataStream& in) {
     quint32 arrayLength;
     quint32 encoding;
@@ -93,29 +146,19 @@ template<class T> QVariant readBinaryArray(QDataStream& in) {
     in >> encoding;
     in >> compressedLength;
 
-    QVector<T> values;
+    // the values are read or inflated straight into the vector, rather than one at a time through the stream
+    QVector<T> values(arrayLength);
+    uLongf bytes = arrayLength * sizeof(T);
     const unsigned int DEFLATE_ENCODING = 1;
     if (encoding == DEFLATE_ENCODING) {
-        // preface encoded data with uncompressed length
-        QByteArray compressed(sizeof(quint32) + compressedLength, 0);
-        *((quint32*)compressed.data()) = qToBigEndian<quint32>(arrayLength * sizeof(T));
-        in.readRawData(compressed.data() + sizeof(quint32), compressedLength);
-        QByteArray uncompressed = qUncompress(compressed);
-        QDataStream uncompressedIn(uncompressed);
-        uncompressedIn.setByteOrder(QDataStream::LittleEndian);
-        uncompressedIn.setVersion(QDataStream::Qt_4_5); // for single/double precision switch
-        for (quint32 i = 0; i < arrayLength; i++) {
-            T value;
-            uncompressedIn >> value;
-            values.append(value);
-        }
-    } else {
-        for (quint32 i = 0; i < arrayLength; i++) {
-            T value;
-            in >> value;
-            values.append(value);
+        QByteArray compressed = in.device()->read(compressedLength);
+        if (uncompress((Bytef*)values.data(), &bytes, (const Bytef*)compressed.constData(), compressed.size()) != Z_OK) {
+            throw QString("Failed to decompress binary array.");
         }
+    } else if (in.readRawData((char*)values.data(), bytes) != (int)bytes) {
+        throw QString("Unexpected end of binary array.");
     }
+    convertFromLittleEndian(values);
     return QVariant::fromValue(values);
 }
 
@@ -877,6 +920,81 @@ ExtractedMesh extractMesh(const FBXNode& object) {
     return data.extracted;
 }
 
+/// The extraction of a list of meshes, shared by the thread that needs them and the pool threads that help with it.
+class MeshExtraction {
+public:
+    
+    MeshExtraction(const QVector<const FBXNode*>& objects) :
+        _objects(objects), _meshes(objects.size()), _meshData(_meshes.data()), _nextObject(0),
+        _remainingObjects(objects.size()) { }
+    
+    const QVector<ExtractedMesh>& getMeshes() const { return _meshes; }
+    
+    /// extracts the next mesh nobody has started on
+    /// \return false if there were none left
+    bool extractNext();
+    
+    /// extracts meshes until none are left, then waits for those extracted by other threads
+    void finish();
+    
+private:
+    
+    QVector<const FBXNode*> _objects;
+    QVector<ExtractedMesh> _meshes;
+    ExtractedMesh* _meshData;
+    QAtomicInt _nextObject;
+    QAtomicInt _remainingObjects;
+    QMutex _mutex;
+    QWaitCondition _finished;
+};
+
+bool MeshExtraction::extractNext() {
+    int index = _nextObject.fetchAndAddOrdered(1);
+    if (index >= _objects.size()) {
+        return false;
+    }
+    // each thread writes only its own element, through the pointer taken before any of them started
+    _meshData[index] = extractMesh(*_objects.at(index));
+    if (!_remainingObjects.deref()) {
+        QMutexLocker locker(&_mutex);
+        _finished.wakeAll();
+    }
+    return true;
+}
+
+void MeshExtraction::finish() {
+    while (extractNext());
+    
+    // only the meshes other threads have started are left, so this can't wait on a pool thread that hasn't run yet
+    QMutexLocker locker(&_mutex);
+    while (_remainingObjects.load() > 0) {
+        _finished.wait(&_mutex);
+    }
+}
+
+class MeshExtractor : public QRunnable {
+public:
+    
+    MeshExtractor(const QSharedPointer<MeshExtraction>& extraction) : _extraction(extraction) { }
+    
+    virtual void run() { while (_extraction->extractNext()); }
+
+private:
+    
+    QSharedPointer<MeshExtraction> _extraction;
+};
+
+/// extracts the meshes in parallel, using the calling thread and whatever threads of the global pool are free
+QVector<ExtractedMesh> extractMeshes(const QVector<const FBXNode*>& objects) {
+    QSharedPointer<MeshExtraction> extraction(new MeshExtraction(objects));
+    int helpers = qMin(objects.size(), QThreadPool::globalInstance()->maxThreadCount()) - 1;
+    for (int i = 0; i < helpers; i++) {
+        QThreadPool::globalInstance()->start(new MeshExtractor(extraction));
+    }
+    extraction->finish();
+    return extraction->getMeshes();
+}
+
 FBXBlendshape extractBlendshape(const FBXNode& object) {
     FBXBlendshape blendshape;
     foreach (const FBXNode& data, object.children) {
@@ -1007,6 +1125,8 @@ bool checkMaterialsHaveTextures(const QHash<QString, Material>& materials,
 
 FBXGeometry extractFBXGeometry(const FBXNode& node, const QVariantHash& mapping) {
     QHash<QString, ExtractedMesh> meshes;
+    QVector<QString> meshIDs;
+    QVector<const FBXNode*> meshObjects;
     QVector<ExtractedBlendshape> blendshapes;
     QMultiHash<QString, QString> parentMap;
     QMultiHash<QString, QString> childMap;
@@ -1099,7 +1219,8 @@ FBXGeometry extractFBXGeometry(const FBXNode& node, const QVariantHash& mapping)
             foreach (const FBXNode& object, child.children) {
                 if (object.name == "Geometry") {
                     if (object.properties.at(2) == "Mesh") {
-                        meshes.insert(getID(object.properties), extractMesh(object));
+                        meshIDs.append(getID(object.properties));
+                        meshObjects.append(&object);
 
                     } else { // object.properties.at(2) == "Shape"
                         ExtractedBlendshape extracted = { getID(object.properties), extractBlendshape(object) };
@@ -1390,6 +1511,12 @@ FBXGeometry extractFBXGeometry(const FBXNode& node, const QVariantHash& mapping)
         }
     }
 
+    // the meshes don't depend on one another or on anything else in the file
+    QVector<ExtractedMesh> extractedMeshes = extractMeshes(meshObjects);
+    for (int i = 0; i < meshIDs.size(); i++) {
+        meshes.insert(meshIDs.at(i), extractedMeshes.at(i));
+    }
+
     // assign the blendshapes to their corresponding meshes
     foreach (const ExtractedBlendshape& extracted, blendshapes) {
         QString blendshapeChannelID = parentMap.value(extracted.id);
@@ -1953,6 +2080,253 @@ FBXGeometry readFBX(const QByteArray& model, const QVariantHash& mapping) {
     return extractFBXGeometry(parseFBX(&buffer), mapping);
 }
 
+const char PRECOMPILED_GEOMETRY_SIGNATURE[] = "HFGEOMETRY";
+const quint32 PRECOMPILED_GEOMETRY_VERSION = 1;
+
+/// writes values that hold no pointers, such as the glm types, as they are laid out in memory
+template<class T> void serializeRaw(QDataStream& out, const T& value) {
+    out.writeRawData((const char*)&value, sizeof(T));
+}
+
+template<class T> void deserializeRaw(QDataStream& in, T& value) {
+    in.readRawData((char*)&value, sizeof(T));
+}
+
+/// writes a vector of values that hold no pointers in one block, laid out as it will be in the vertex or index buffer
+template<class T> void serializeRaw(QDataStream& out, const QVector<T>& values) {
+    out << (quint32)values.size();
+    out.writeRawData((const char*)values.constData(), values.size() * sizeof(T));
+}
+
+template<class T> void deserializeRaw(QDataStream& in, QVector<T>& values) {
+    quint32 size;
+    in >> size;
+    if (size > in.device()->bytesAvailable() / sizeof(T)) {
+        throw QString("Truncated precompiled geometry.");
+    }
+    values.resize(size);
+    in.readRawData((char*)values.data(), size * sizeof(T));
+}
+
+template<class T> void serialize(QDataStream& out, const QVector<T>& values) {
+    out << (quint32)values.size();
+    foreach (const T& value, values) {
+        serialize(out, value);
+    }
+}
+
+template<class T> void deserialize(QDataStream& in, QVector<T>& values) {
+    quint32 size;
+    in >> size;
+    if (size > in.device()->bytesAvailable()) {
+        throw QString("Truncated precompiled geometry.");
+    }
+    values.resize(size);
+    for (T* it = values.data(), *end = it + size; it != end; it++) {
+        deserialize(in, *it);
+    }
+}
+
+void serialize(QDataStream& out, const FBXJoint& joint) {
+    out << joint.isFree << joint.parentIndex << joint.distanceToParent << joint.boneRadius << joint.name <<
+        (qint32)joint.shapeType;
+    serializeRaw(out, joint.freeLineage);
+    serializeRaw(out, joint.translation);
+    serializeRaw(out, joint.preTransform);
+    serializeRaw(out, joint.preRotation);
+    serializeRaw(out, joint.rotation);
+    serializeRaw(out, joint.postRotation);
+    serializeRaw(out, joint.postTransform);
+    serializeRaw(out, joint.transform);
+    serializeRaw(out, joint.rotationMin);
+    serializeRaw(out, joint.rotationMax);
+    serializeRaw(out, joint.inverseDefaultRotation);
+    serializeRaw(out, joint.inverseBindRotation);
+    serializeRaw(out, joint.bindTransform);
+    serializeRaw(out, joint.shapePosition);
+    serializeRaw(out, joint.shapeRotation);
+}
+
+void deserialize(QDataStream& in, FBXJoint& joint) {
+    qint32 shapeType;
+    in >> joint.isFree >> joint.parentIndex >> joint.distanceToParent >> joint.boneRadius >> joint.name >> shapeType;
+    joint.shapeType = (Shape::Type)shapeType;
+    deserializeRaw(in, joint.freeLineage);
+    deserializeRaw(in, joint.translation);
+    deserializeRaw(in, joint.preTransform);
+    deserializeRaw(in, joint.preRotation);
+    deserializeRaw(in, joint.rotation);
+    deserializeRaw(in, joint.postRotation);
+    deserializeRaw(in, joint.postTransform);
+    deserializeRaw(in, joint.transform);
+    deserializeRaw(in, joint.rotationMin);
+    deserializeRaw(in, joint.rotationMax);
+    deserializeRaw(in, joint.inverseDefaultRotation);
+    deserializeRaw(in, joint.inverseBindRotation);
+    deserializeRaw(in, joint.bindTransform);
+    deserializeRaw(in, joint.shapePosition);
+    deserializeRaw(in, joint.shapeRotation);
+}
+
+void serialize(QDataStream& out, const FBXMeshPart& part) {
+    serializeRaw(out, part.quadIndices);
+    serializeRaw(out, part.triangleIndices);
+    serializeRaw(out, part.diffuseColor);
+    serializeRaw(out, part.specularColor);
+    out << part.shininess << part.diffuseTexture.filename << part.diffuseTexture.content <<
+        part.normalTexture.filename << part.normalTexture.content <<
+        part.specularTexture.filename << part.specularTexture.content;
+}
+
+void deserialize(QDataStream& in, FBXMeshPart& part) {
+    deserializeRaw(in, part.quadIndices);
+    deserializeRaw(in, part.triangleIndices);
+    deserializeRaw(in, part.diffuseColor);
+    deserializeRaw(in, part.specularColor);
+    in >> part.shininess >> part.diffuseTexture.filename >> part.diffuseTexture.content >>
+        part.normalTexture.filename >> part.normalTexture.content >>
+        part.specularTexture.filename >> part.specularTexture.content;
+}
+
+void serialize(QDataStream& out, const FBXBlendshape& blendshape) {
+    serializeRaw(out, blendshape.indices);
+    serializeRaw(out, blendshape.vertices);
+    serializeRaw(out, blendshape.normals);
+}
+
+void deserialize(QDataStream& in, FBXBlendshape& blendshape) {
+    deserializeRaw(in, blendshape.indices);
+    deserializeRaw(in, blendshape.vertices);
+    deserializeRaw(in, blendshape.normals);
+}
+
+void serialize(QDataStream& out, const FBXMesh& mesh) {
+    serialize(out, mesh.parts);
+    serializeRaw(out, mesh.vertices);
+    serializeRaw(out, mesh.normals);
+    serializeRaw(out, mesh.tangents);
+    serializeRaw(out, mesh.colors);
+    serializeRaw(out, mesh.texCoords);
+    serializeRaw(out, mesh.clusterIndices);
+    serializeRaw(out, mesh.clusterWeights);
+    serializeRaw(out, mesh.clusters);
+    serializeRaw(out, mesh.meshExtents);
+    out << mesh.isEye;
+    serialize(out, mesh.blendshapes);
+}
+
+void deserialize(QDataStream& in, FBXMesh& mesh) {
+    deserialize(in, mesh.parts);
+    deserializeRaw(in, mesh.vertices);
+    deserializeRaw(in, mesh.normals);
+    deserializeRaw(in, mesh.tangents);
+    deserializeRaw(in, mesh.colors);
+    deserializeRaw(in, mesh.texCoords);
+    deserializeRaw(in, mesh.clusterIndices);
+    deserializeRaw(in, mesh.clusterWeights);
+    deserializeRaw(in, mesh.clusters);
+    deserializeRaw(in, mesh.meshExtents);
+    in >> mesh.isEye;
+    deserialize(in, mesh.blendshapes);
+}
+
+void serialize(QDataStream& out, const FBXAnimationFrame& frame) {
+    serializeRaw(out, frame.rotations);
+}
+
+void deserialize(QDataStream& in, FBXAnimationFrame& frame) {
+    deserializeRaw(in, frame.rotations);
+}
+
+void serialize(QDataStream& out, const FBXAttachment& attachment) {
+    out << attachment.jointIndex << attachment.url;
+    serializeRaw(out, attachment.translation);
+    serializeRaw(out, attachment.rotation);
+    serializeRaw(out, attachment.scale);
+}
+
+void deserialize(QDataStream& in, FBXAttachment& attachment) {
+    in >> attachment.jointIndex >> attachment.url;
+    deserializeRaw(in, attachment.translation);
+    deserializeRaw(in, attachment.rotation);
+    deserializeRaw(in, attachment.scale);
+}
+
+void serialize(QDataStream& out, const SittingPoint& sittingPoint) {
+    out << sittingPoint.name;
+    serializeRaw(out, sittingPoint.position);
+    serializeRaw(out, sittingPoint.rotation);
+}
+
+void deserialize(QDataStream& in, SittingPoint& sittingPoint) {
+    in >> sittingPoint.name;
+    deserializeRaw(in, sittingPoint.position);
+    deserializeRaw(in, sittingPoint.rotation);
+}
+
+QByteArray writePrecompiledGeometry(const FBXGeometry& geometry, const QVariantHash& mapping) {
+    QByteArray data;
+    QDataStream out(&data, QIODevice::WriteOnly);
+    out.writeRawData(PRECOMPILED_GEOMETRY_SIGNATURE, sizeof(PRECOMPILED_GEOMETRY_SIGNATURE));
+    out << PRECOMPILED_GEOMETRY_VERSION << (quint8)(Q_BYTE_ORDER == Q_LITTLE_ENDIAN) << mapping;
+    
+    out << geometry.author << geometry.applicationName << geometry.jointIndices << geometry.leftEyeJointIndex <<
+        geometry.rightEyeJointIndex << geometry.neckJointIndex << geometry.rootJointIndex << geometry.leanJointIndex <<
+        geometry.headJointIndex << geometry.leftHandJointIndex << geometry.rightHandJointIndex;
+    serialize(out, geometry.joints);
+    serialize(out, geometry.meshes);
+    serializeRaw(out, geometry.offset);
+    serializeRaw(out, geometry.humanIKJointIndices);
+    serializeRaw(out, geometry.palmDirection);
+    serialize(out, geometry.sittingPoints);
+    serializeRaw(out, geometry.neckPivot);
+    serializeRaw(out, geometry.bindExtents);
+    serializeRaw(out, geometry.meshExtents);
+    serialize(out, geometry.animationFrames);
+    serialize(out, geometry.attachments);
+    return data;
+}
+
+FBXGeometry readPrecompiledGeometry(const QByteArray& data, const QVariantHash& mapping) {
+    QDataStream in(data);
+    char signature[sizeof(PRECOMPILED_GEOMETRY_SIGNATURE)];
+    quint32 version;
+    quint8 byteOrder;
+    QVariantHash precompiledMapping;
+    if (in.readRawData(signature, sizeof(signature)) != (int)sizeof(signature) ||
+            memcmp(signature, PRECOMPILED_GEOMETRY_SIGNATURE, sizeof(signature)) != 0) {
+        throw QString("Not precompiled geometry.");
+    }
+    in >> version >> byteOrder >> precompiledMapping;
+    if (version != PRECOMPILED_GEOMETRY_VERSION || byteOrder != (quint8)(Q_BYTE_ORDER == Q_LITTLE_ENDIAN)) {
+        throw QString("Precompiled geometry is of a different version or byte order.");
+    }
+    // the geometry depends on the mapping it was read with, which may have been edited since
+    if (precompiledMapping != mapping) {
+        throw QString("Precompiled geometry is out of date with its mapping.");
+    }
+    
+    FBXGeometry geometry;
+    in >> geometry.author >> geometry.applicationName >> geometry.jointIndices >> geometry.leftEyeJointIndex >>
+        geometry.rightEyeJointIndex >> geometry.neckJointIndex >> geometry.rootJointIndex >> geometry.leanJointIndex >>
+        geometry.headJointIndex >> geometry.leftHandJointIndex >> geometry.rightHandJointIndex;
+    deserialize(in, geometry.joints);
+    deserialize(in, geometry.meshes);
+    deserializeRaw(in, geometry.offset);
+    deserializeRaw(in, geometry.humanIKJointIndices);
+    deserializeRaw(in, geometry.palmDirection);
+    deserialize(in, geometry.sittingPoints);
+    deserializeRaw(in, geometry.neckPivot);
+    deserializeRaw(in, geometry.bindExtents);
+    deserializeRaw(in, geometry.meshExtents);
+    deserialize(in, geometry.animationFrames);
+    deserialize(in, geometry.attachments);
+    if (in.status() != QDataStream::Ok) {
+        throw QString("Truncated precompiled geometry.");
+    }
+    return geometry;
+}
+
 bool addMeshVoxelsOperation(OctreeElement* element, void* extraData) {
     VoxelTreeElement* voxel = (VoxelTreeElement*)element;
     if (!voxel->isLeaf()) {
@@ -159,6 +159,9 @@ public:
     QVector<FBXBlendshape> blendshapes;
     
     bool hasSpecularTexture() const;
+    
+    /// Returns the approximate number of bytes the mesh's data takes up in memory.
+    qint64 getMemoryBytes() const;
 };
 
 /// A single animation frame extracted from an FBX document.
@@ -232,6 +235,9 @@ public:
     QStringList getJointNames() const;
     
     bool hasBlendedMeshes() const;
+    
+    /// Returns the approximate number of bytes the meshes, joints and animation frames take up in memory.
+    qint64 getMemoryBytes() const;
 };
 
 Q_DECLARE_METATYPE(FBXGeometry)
@@ -242,10 +248,20 @@ QVariantHash readMapping(const QByteArray& data);
 /// Writes an FST mapping to a byte array.
 QByteArray writeMapping(const QVariantHash& mapping);
 
+/// The extension of the files written by writePrecompiledGeometry.
+const QString PRECOMPILED_GEOMETRY_EXTENSION = ".fbg";
+
 /// Reads FBX geometry from the supplied model and mapping data.
 /// \exception QString if an error occurs in parsing
 FBXGeometry readFBX(const QByteArray& model, const QVariantHash& mapping);
 
+/// Writes geometry read with the supplied mapping in a form that can be read back without parsing the FBX again.
+QByteArray writePrecompiledGeometry(const FBXGeometry& geometry, const QVariantHash& mapping);
+
+/// Reads geometry written by writePrecompiledGeometry.
+/// \exception QString if the data is of another version or byte order, or was written with a different mapping
+FBXGeometry readPrecompiledGeometry(const QByteArray& data, const QVariantHash& mapping);
+
 /// Reads SVO geometry from the supplied model data.
 FBXGeometry readSVO(const QByteArray& model);
 
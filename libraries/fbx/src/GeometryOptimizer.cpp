@@ -0,0 +1,590 @@
+//
+//  GeometryOptimizer.cpp
+//  libraries/fbx/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#include <algorithm>
+#include <cmath>
+#include <queue>
+#include <vector>
+
+#include <QHash>
+#include <QVarLengthArray>
+
+#include "GeometryOptimizer.h"
+
+// the parameters of Tom Forsyth's linear-speed vertex cache optimization
+const int VERTEX_CACHE_SIZE = 32;
+const float CACHE_DECAY_POWER = 1.5f;
+const float LAST_TRIANGLE_SCORE = 0.75f;
+const float VALENCE_BOOST_SCALE = 2.0f;
+const float VALENCE_BOOST_POWER = 0.5f;
+
+static float getVertexScore(int cachePosition, int remainingTriangles) {
+    if (remainingTriangles == 0) {
+        return -1.0f;
+    }
+    float score = 0.0f;
+    if (cachePosition < 0) {
+        // not in the cache
+
+    } else if (cachePosition < 3) {
+        // the vertices of the triangle just drawn get a fixed score, so that the next doesn't just share its edge
+        score = LAST_TRIANGLE_SCORE;
+
+    } else {
+        score = powf(1.0f - (cachePosition - 3) / (float)(VERTEX_CACHE_SIZE - 3), CACHE_DECAY_POWER);
+    }
+    // vertices with few triangles left are boosted, so that they're finished off rather than left as lone triangles
+    return score + VALENCE_BOOST_SCALE * powf((float)remainingTriangles, -VALENCE_BOOST_POWER);
+}
+
+static void optimizeTriangleOrder(QVector<int>& indices) {
+    int triangleCount = indices.size() / 3;
+    if (triangleCount < 2) {
+        return;
+    }
+
+    // number the vertices the triangles use densely
+    QHash<int, int> localIndices;
+    QVector<int> triangleVertices(triangleCount * 3);
+    for (int i = 0; i < triangleVertices.size(); i++) {
+        QHash<int, int>::iterator it = localIndices.find(indices.at(i));
+        if (it == localIndices.end()) {
+            it = localIndices.insert(indices.at(i), localIndices.size());
+        }
+        triangleVertices[i] = it.value();
+    }
+    int vertexCount = localIndices.size();
+
+    // the triangles of each vertex, in one array, with the ones left to draw first
+    QVector<int> remainingTriangles(vertexCount, 0);
+    foreach (int vertex, triangleVertices) {
+        remainingTriangles[vertex]++;
+    }
+    QVector<int> firstTriangles(vertexCount);
+    for (int i = 0, offset = 0; i < vertexCount; i++) {
+        firstTriangles[i] = offset;
+        offset += remainingTriangles.at(i);
+    }
+    QVector<int> vertexTriangles(triangleVertices.size());
+    QVector<int> trianglesFilled(vertexCount, 0);
+    for (int i = 0; i < triangleVertices.size(); i++) {
+        int vertex = triangleVertices.at(i);
+        vertexTriangles[firstTriangles.at(vertex) + trianglesFilled[vertex]++] = i / 3;
+    }
+
+    QVector<int> cachePositions(vertexCount, -1);
+    QVector<float> vertexScores(vertexCount);
+    for (int i = 0; i < vertexCount; i++) {
+        vertexScores[i] = getVertexScore(-1, remainingTriangles.at(i));
+    }
+    QVector<float> triangleScores(triangleCount);
+    QVector<bool> drawn(triangleCount, false);
+    int bestTriangle = 0;
+    for (int i = 0; i < triangleCount; i++) {
+        triangleScores[i] = vertexScores.at(triangleVertices.at(i * 3)) +
+            vertexScores.at(triangleVertices.at(i * 3 + 1)) + vertexScores.at(triangleVertices.at(i * 3 + 2));
+        if (triangleScores.at(i) > triangleScores.at(bestTriangle)) {
+            bestTriangle = i;
+        }
+    }
+
+    QVector<int> ordered;
+    ordered.reserve(indices.size());
+    QVarLengthArray<int, VERTEX_CACHE_SIZE + 3> cache;
+    QVarLengthArray<int, VERTEX_CACHE_SIZE + 3> newCache;
+    int firstUndrawn = 0;
+    for (int drawnCount = 0; drawnCount < triangleCount; drawnCount++) {
+        if (bestTriangle == -1) {
+            // nothing in the cache has triangles left, so start again from the first that hasn't been drawn
+            while (drawn.at(firstUndrawn)) {
+                firstUndrawn++;
+            }
+            bestTriangle = firstUndrawn;
+        }
+        drawn[bestTriangle] = true;
+        newCache.clear();
+        for (int i = 0; i < 3; i++) {
+            int vertex = triangleVertices.at(bestTriangle * 3 + i);
+            ordered.append(indices.at(bestTriangle * 3 + i));
+
+            // swap the triangle past the end of the ones the vertex has left
+            int* triangles = vertexTriangles.data() + firstTriangles.at(vertex);
+            int last = --remainingTriangles[vertex];
+            for (int j = 0; j <= last; j++) {
+                if (triangles[j] == bestTriangle) {
+                    qSwap(triangles[j], triangles[last]);
+                    break;
+                }
+            }
+            newCache.append(vertex);
+        }
+        for (int i = 0; i < cache.size(); i++) {
+            int vertex = cache.at(i);
+            if (vertex != newCache.at(0) && vertex != newCache.at(1) && vertex != newCache.at(2)) {
+                newCache.append(vertex);
+            }
+        }
+
+        // rescore the vertices in the cache and those pushed out of it, then the triangles they have left
+        for (int i = 0; i < newCache.size(); i++) {
+            int vertex = newCache.at(i);
+            cachePositions[vertex] = (i < VERTEX_CACHE_SIZE) ? i : -1;
+            vertexScores[vertex] = getVertexScore(cachePositions.at(vertex), remainingTriangles.at(vertex));
+        }
+        bestTriangle = -1;
+        float bestScore = -1.0f;
+        for (int i = 0; i < newCache.size(); i++) {
+            int vertex = newCache.at(i);
+            const int* triangles = vertexTriangles.constData() + firstTriangles.at(vertex);
+            for (int j = 0; j < remainingTriangles.at(vertex); j++) {
+                int triangle = triangles[j];
+                float score = triangleScores[triangle] = vertexScores.at(triangleVertices.at(triangle * 3)) +
+                    vertexScores.at(triangleVertices.at(triangle * 3 + 1)) +
+                    vertexScores.at(triangleVertices.at(triangle * 3 + 2));
+                if (score > bestScore) {
+                    bestTriangle = triangle;
+                    bestScore = score;
+                }
+            }
+        }
+        if (newCache.size() > VERTEX_CACHE_SIZE) {
+            newCache.resize(VERTEX_CACHE_SIZE);
+        }
+        cache = newCache;
+    }
+    indices = ordered;
+}
+
+/// moves each value to its new index, leaving alone the arrays the mesh doesn't have
+template<class T> void reorderVertices(QVector<T>& values, const QVector<int>& newIndices) {
+    if (values.size() != newIndices.size()) {
+        return;
+    }
+    QVector<T> reordered(values.size());
+    for (int i = 0; i < values.size(); i++) {
+        reordered[newIndices.at(i)] = values.at(i);
+    }
+    values = reordered;
+}
+
+static void optimizeVertexOrder(FBXMesh& mesh) {
+    // number the vertices in the order they're first drawn, then the ones that aren't drawn at all
+    QVector<int> newIndices(mesh.vertices.size(), -1);
+    int vertexCount = 0;
+    foreach (const FBXMeshPart& part, mesh.parts) {
+        foreach (int index, part.quadIndices) {
+            if (newIndices.at(index) == -1) {
+                newIndices[index] = vertexCount++;
+            }
+        }
+        foreach (int index, part.triangleIndices) {
+            if (newIndices.at(index) == -1) {
+                newIndices[index] = vertexCount++;
+            }
+        }
+    }
+    for (int i = 0; i < newIndices.size(); i++) {
+        if (newIndices.at(i) == -1) {
+            newIndices[i] = vertexCount++;
+        }
+    }
+
+    for (int i = 0; i < mesh.parts.size(); i++) {
+        FBXMeshPart& part = mesh.parts[i];
+        for (int j = 0; j < part.quadIndices.size(); j++) {
+            part.quadIndices[j] = newIndices.at(part.quadIndices.at(j));
+        }
+        for (int j = 0; j < part.triangleIndices.size(); j++) {
+            part.triangleIndices[j] = newIndices.at(part.triangleIndices.at(j));
+        }
+    }
+    reorderVertices(mesh.vertices, newIndices);
+    reorderVertices(mesh.normals, newIndices);
+    reorderVertices(mesh.tangents, newIndices);
+    reorderVertices(mesh.colors, newIndices);
+    reorderVertices(mesh.texCoords, newIndices);
+    reorderVertices(mesh.clusterIndices, newIndices);
+    reorderVertices(mesh.clusterWeights, newIndices);
+    for (int i = 0; i < mesh.blendshapes.size(); i++) {
+        FBXBlendshape& blendshape = mesh.blendshapes[i];
+        for (int j = 0; j < blendshape.indices.size(); j++) {
+            blendshape.indices[j] = newIndices.at(blendshape.indices.at(j));
+        }
+    }
+}
+
+void optimizeGeometry(FBXGeometry& geometry) {
+    for (int i = 0; i < geometry.meshes.size(); i++) {
+        FBXMesh& mesh = geometry.meshes[i];
+        for (int j = 0; j < mesh.parts.size(); j++) {
+            optimizeTriangleOrder(mesh.parts[j].triangleIndices);
+        }
+        optimizeVertexOrder(mesh);
+    }
+}
+
+/// The sum of the squared distances of a point from a set of planes, as a symmetric matrix.
+class Quadric {
+public:
+
+    Quadric();
+
+    void addPlane(const glm::vec3& normal, float distance, float weight);
+
+    float evaluate(const glm::vec3& point) const;
+
+    Quadric& operator+=(const Quadric& other);
+    Quadric operator+(const Quadric& other) const { Quadric sum = *this; return sum += other; }
+
+private:
+
+    // aa ab ac ad bb bc bd cc cd dd, for the planes ax + by + cz + d = 0
+    double _values[10];
+};
+
+Quadric::Quadric() {
+    for (int i = 0; i < 10; i++) {
+        _values[i] = 0.0;
+    }
+}
+
+void Quadric::addPlane(const glm::vec3& normal, float distance, float weight) {
+    double a = normal.x, b = normal.y, c = normal.z, d = distance;
+    _values[0] += weight * a * a;
+    _values[1] += weight * a * b;
+    _values[2] += weight * a * c;
+    _values[3] += weight * a * d;
+    _values[4] += weight * b * b;
+    _values[5] += weight * b * c;
+    _values[6] += weight * b * d;
+    _values[7] += weight * c * c;
+    _values[8] += weight * c * d;
+    _values[9] += weight * d * d;
+}
+
+float Quadric::evaluate(const glm::vec3& point) const {
+    double x = point.x, y = point.y, z = point.z;
+    return (float)(_values[0] * x * x + 2.0 * _values[1] * x * y + 2.0 * _values[2] * x * z + 2.0 * _values[3] * x +
+        _values[4] * y * y + 2.0 * _values[5] * y * z + 2.0 * _values[6] * y +
+        _values[7] * z * z + 2.0 * _values[8] * z + _values[9]);
+}
+
+Quadric& Quadric::operator+=(const Quadric& other) {
+    for (int i = 0; i < 10; i++) {
+        _values[i] += other._values[i];
+    }
+    return *this;
+}
+
+/// The collapse of one vertex onto another, valid as long as neither has changed since it was queued.
+class EdgeCollapse {
+public:
+    float cost;
+    int from;
+    int to;
+    int fromVersion;
+    int toVersion;
+
+    // the queue is a max-heap, so the cheapest collapse compares greatest
+    bool operator<(const EdgeCollapse& other) const { return cost > other.cost; }
+};
+
+typedef std::priority_queue<EdgeCollapse, std::vector<EdgeCollapse> > EdgeCollapseQueue;
+
+// the most a collapse may turn the triangles around the vertex it removes, as the cosine of the angle
+const float MIN_COLLAPSED_NORMAL_DOT = 0.5f;
+
+/// Edge-collapse simplification of the triangles of one mesh.
+class MeshSimplifier {
+public:
+
+    MeshSimplifier(FBXMesh& mesh);
+
+    void simplify(float proportion);
+
+private:
+
+    void queueCollapse(int from, int to);
+    bool canCollapse(int from, int to) const;
+    int collapse(int from, int to);
+    void getNeighbors(int vertex, QVarLengthArray<int, 16>& neighbors) const;
+    void writeMesh();
+
+    FBXMesh& _mesh;
+    QVector<int> _triangles;
+    QVector<int> _triangleParts;
+    QVector<bool> _triangleRemoved;
+    int _triangleCount;
+    QVector<QVector<int> > _vertexTriangles;
+    QVector<Quadric> _quadrics;
+    QVector<bool> _locked;
+    QVector<bool> _vertexRemoved;
+    QVector<int> _versions;
+    EdgeCollapseQueue _queue;
+};
+
+MeshSimplifier::MeshSimplifier(FBXMesh& mesh) :
+    _mesh(mesh) {
+
+    for (int i = 0; i < mesh.parts.size(); i++) {
+        const FBXMeshPart& part = mesh.parts.at(i);
+        for (int j = 0; j + 3 < part.quadIndices.size(); j += 4) {
+            _triangles << part.quadIndices.at(j) << part.quadIndices.at(j + 1) << part.quadIndices.at(j + 2);
+            _triangles << part.quadIndices.at(j) << part.quadIndices.at(j + 2) << part.quadIndices.at(j + 3);
+            _triangleParts << i << i;
+        }
+        for (int j = 0; j + 2 < part.triangleIndices.size(); j += 3) {
+            _triangles << part.triangleIndices.at(j) << part.triangleIndices.at(j + 1) <<
+                part.triangleIndices.at(j + 2);
+            _triangleParts << i;
+        }
+    }
+    _triangleCount = _triangleParts.size();
+    _triangleRemoved.fill(false, _triangleCount);
+
+    int vertexCount = mesh.vertices.size();
+    _vertexTriangles.resize(vertexCount);
+    _quadrics.resize(vertexCount);
+    _locked.fill(false, vertexCount);
+    _vertexRemoved.fill(false, vertexCount);
+    _versions.fill(0, vertexCount);
+
+    // edges with only one triangle are on the mesh's borders or texture seams, and their vertices stay where they are
+    QHash<quint64, int> edgeTriangleCounts;
+    for (int i = 0; i < _triangleCount; i++) {
+        const int* triangle = _triangles.constData() + i * 3;
+        for (int j = 0; j < 3; j++) {
+            _vertexTriangles[triangle[j]].append(i);
+            int first = qMin(triangle[j], triangle[(j + 1) % 3]);
+            int second = qMax(triangle[j], triangle[(j + 1) % 3]);
+            edgeTriangleCounts[((quint64)first << 32) | (quint32)second]++;
+        }
+        const glm::vec3& a = mesh.vertices.at(triangle[0]);
+        glm::vec3 cross = glm::cross(mesh.vertices.at(triangle[1]) - a, mesh.vertices.at(triangle[2]) - a);
+        float length = glm::length(cross);
+        if (length > 0.0f) {
+            // weighted by area, so that slivers count for little
+            glm::vec3 normal = cross / length;
+            for (int j = 0; j < 3; j++) {
+                _quadrics[triangle[j]].addPlane(normal, -glm::dot(normal, a), length * 0.5f);
+            }
+        }
+    }
+    for (QHash<quint64, int>::const_iterator it = edgeTriangleCounts.constBegin();
+            it != edgeTriangleCounts.constEnd(); it++) {
+        if (it.value() != 2) {
+            _locked[(int)(it.key() >> 32)] = true;
+            _locked[(int)(it.key() & 0xFFFFFFFF)] = true;
+        }
+    }
+    for (int i = 0; i < _triangleCount; i++) {
+        const int* triangle = _triangles.constData() + i * 3;
+        for (int j = 0; j < 3; j++) {
+            queueCollapse(triangle[j], triangle[(j + 1) % 3]);
+            queueCollapse(triangle[(j + 1) % 3], triangle[j]);
+        }
+    }
+}
+
+void MeshSimplifier::simplify(float proportion) {
+    int targetCount = (int)(_triangleCount * proportion);
+    int liveCount = _triangleCount;
+    while (liveCount > targetCount && !_queue.empty()) {
+        EdgeCollapse edgeCollapse = _queue.top();
+        _queue.pop();
+        if (_vertexRemoved.at(edgeCollapse.from) || _vertexRemoved.at(edgeCollapse.to) ||
+                _versions.at(edgeCollapse.from) != edgeCollapse.fromVersion ||
+                _versions.at(edgeCollapse.to) != edgeCollapse.toVersion ||
+                !canCollapse(edgeCollapse.from, edgeCollapse.to)) {
+            continue;
+        }
+        liveCount -= collapse(edgeCollapse.from, edgeCollapse.to);
+    }
+    writeMesh();
+}
+
+void MeshSimplifier::queueCollapse(int from, int to) {
+    if (_locked.at(from)) {
+        return;
+    }
+    const glm::vec3& position = _mesh.vertices.at(to);
+    EdgeCollapse edgeCollapse = { (_quadrics.at(from) + _quadrics.at(to)).evaluate(position), from, to,
+        _versions.at(from), _versions.at(to) };
+    _queue.push(edgeCollapse);
+}
+
+void MeshSimplifier::getNeighbors(int vertex, QVarLengthArray<int, 16>& neighbors) const {
+    foreach (int triangle, _vertexTriangles.at(vertex)) {
+        for (int i = 0; i < 3; i++) {
+            int neighbor = _triangles.at(triangle * 3 + i);
+            if (neighbor != vertex && !std::count(neighbors.constBegin(), neighbors.constEnd(), neighbor)) {
+                neighbors.append(neighbor);
+            }
+        }
+    }
+}
+
+bool MeshSimplifier::canCollapse(int from, int to) const {
+    // the vertices may only share the neighbors across the triangles of their edge, lest the mesh fold onto itself
+    int sharedTriangles = 0;
+    foreach (int triangle, _vertexTriangles.at(from)) {
+        const int* vertices = _triangles.constData() + triangle * 3;
+        if (vertices[0] == to || vertices[1] == to || vertices[2] == to) {
+            sharedTriangles++;
+        }
+    }
+    if (sharedTriangles == 0) {
+        return false;
+    }
+    QVarLengthArray<int, 16> fromNeighbors, toNeighbors;
+    getNeighbors(from, fromNeighbors);
+    getNeighbors(to, toNeighbors);
+    int sharedNeighbors = 0;
+    for (int i = 0; i < fromNeighbors.size(); i++) {
+        if (std::count(toNeighbors.constBegin(), toNeighbors.constEnd(), fromNeighbors.at(i))) {
+            sharedNeighbors++;
+        }
+    }
+    if (sharedNeighbors != sharedTriangles) {
+        return false;
+    }
+
+    // nor may the triangles that remain flip over or turn too far
+    foreach (int triangle, _vertexTriangles.at(from)) {
+        const int* vertices = _triangles.constData() + triangle * 3;
+        if (vertices[0] == to || vertices[1] == to || vertices[2] == to) {
+            continue;
+        }
+        glm::vec3 before[3], after[3];
+        for (int i = 0; i < 3; i++) {
+            before[i] = _mesh.vertices.at(vertices[i]);
+            after[i] = (vertices[i] == from) ? _mesh.vertices.at(to) : before[i];
+        }
+        glm::vec3 normalBefore = glm::cross(before[1] - before[0], before[2] - before[0]);
+        glm::vec3 normalAfter = glm::cross(after[1] - after[0], after[2] - after[0]);
+        float lengths = glm::length(normalBefore) * glm::length(normalAfter);
+        if (lengths == 0.0f || glm::dot(normalBefore, normalAfter) < MIN_COLLAPSED_NORMAL_DOT * lengths) {
+            return false;
+        }
+    }
+    return true;
+}
+
+int MeshSimplifier::collapse(int from, int to) {
+    int trianglesRemoved = 0;
+    foreach (int triangle, _vertexTriangles.at(from)) {
+        int* vertices = _triangles.data() + triangle * 3;
+        if (vertices[0] == to || vertices[1] == to || vertices[2] == to) {
+            _triangleRemoved[triangle] = true;
+            trianglesRemoved++;
+            for (int i = 0; i < 3; i++) {
+                if (vertices[i] != from) {
+                    _vertexTriangles[vertices[i]].removeOne(triangle);
+                }
+            }
+        } else {
+            for (int i = 0; i < 3; i++) {
+                if (vertices[i] == from) {
+                    vertices[i] = to;
+                }
+            }
+            _vertexTriangles[to].append(triangle);
+        }
+    }
+    _vertexTriangles[from].clear();
+    _vertexRemoved[from] = true;
+    _quadrics[to] += _quadrics.at(from);
+
+    // the collapses onto and from the vertex kept now cost more, so they're queued again at their new costs
+    _versions[to]++;
+    QVarLengthArray<int, 16> neighbors;
+    getNeighbors(to, neighbors);
+    for (int i = 0; i < neighbors.size(); i++) {
+        queueCollapse(neighbors.at(i), to);
+        queueCollapse(to, neighbors.at(i));
+    }
+    return trianglesRemoved;
+}
+
+/// keeps the values of the vertices that remain, leaving alone the arrays the mesh doesn't have
+template<class T> void removeVertices(QVector<T>& values, const QVector<int>& newIndices, int vertexCount) {
+    if (values.size() != newIndices.size()) {
+        return;
+    }
+    QVector<T> remaining(vertexCount);
+    for (int i = 0; i < values.size(); i++) {
+        if (newIndices.at(i) != -1) {
+            remaining[newIndices.at(i)] = values.at(i);
+        }
+    }
+    values = remaining;
+}
+
+void MeshSimplifier::writeMesh() {
+    QVector<int> newIndices(_mesh.vertices.size(), -1);
+    int vertexCount = 0;
+    for (int i = 0; i < _mesh.vertices.size(); i++) {
+        if (!_vertexTriangles.at(i).isEmpty()) {
+            newIndices[i] = vertexCount++;
+        }
+    }
+    for (int i = 0; i < _mesh.parts.size(); i++) {
+        _mesh.parts[i].quadIndices.clear();
+        _mesh.parts[i].triangleIndices.clear();
+    }
+    for (int i = 0; i < _triangleCount; i++) {
+        if (!_triangleRemoved.at(i)) {
+            QVector<int>& indices = _mesh.parts[_triangleParts.at(i)].triangleIndices;
+            for (int j = 0; j < 3; j++) {
+                indices.append(newIndices.at(_triangles.at(i * 3 + j)));
+            }
+        }
+    }
+    removeVertices(_mesh.vertices, newIndices, vertexCount);
+    removeVertices(_mesh.normals, newIndices, vertexCount);
+    removeVertices(_mesh.tangents, newIndices, vertexCount);
+    removeVertices(_mesh.colors, newIndices, vertexCount);
+    removeVertices(_mesh.texCoords, newIndices, vertexCount);
+    removeVertices(_mesh.clusterIndices, newIndices, vertexCount);
+    removeVertices(_mesh.clusterWeights, newIndices, vertexCount);
+    for (int i = 0; i < _mesh.blendshapes.size(); i++) {
+        FBXBlendshape& blendshape = _mesh.blendshapes[i];
+        FBXBlendshape remaining;
+        for (int j = 0; j < blendshape.indices.size(); j++) {
+            int index = newIndices.at(blendshape.indices.at(j));
+            if (index != -1) {
+                remaining.indices.append(index);
+                remaining.vertices.append(blendshape.vertices.at(j));
+                if (j < blendshape.normals.size()) {
+                    remaining.normals.append(blendshape.normals.at(j));
+                }
+            }
+        }
+        blendshape = remaining;
+    }
+}
+
+FBXGeometry simplifyGeometry(const FBXGeometry& geometry, float proportion) {
+    FBXGeometry simplified = geometry;
+    for (int i = 0; i < simplified.meshes.size(); i++) {
+        MeshSimplifier(simplified.meshes[i]).simplify(proportion);
+    }
+    return simplified;
+}
+
+int getTriangleCount(const FBXGeometry& geometry) {
+    int triangleCount = 0;
+    foreach (const FBXMesh& mesh, geometry.meshes) {
+        foreach (const FBXMeshPart& part, mesh.parts) {
+            triangleCount += part.quadIndices.size() / 2 + part.triangleIndices.size() / 3;
+        }
+    }
+    return triangleCount;
+}
@@ -0,0 +1,29 @@
+//
+//  GeometryOptimizer.h
+//  libraries/fbx/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#ifndef hifi_GeometryOptimizer_h
+#define hifi_GeometryOptimizer_h
+
+#include "FBXReader.h"
+
+/// Reorders the triangles of each mesh part so that their vertices are reused while they're still in the post-transform
+/// cache, then the vertices of each mesh in the order they're first drawn, so that they're fetched in order as well.
+void optimizeGeometry(FBXGeometry& geometry);
+
+/// Returns a copy of the geometry with each mesh simplified to around the given proportion of its triangles, collapsing
+/// first the edges whose removal changes the surface least. Quads are split into triangles. Vertices are removed rather
+/// than moved, so that those that remain keep their normals, texture coordinates, skinning and blendshapes; those on
+/// borders and texture seams are kept in place, so that the mesh doesn't open up.
+FBXGeometry simplifyGeometry(const FBXGeometry& geometry, float proportion);
+
+/// Returns the number of triangles the geometry draws, counting each quad as two.
+int getTriangleCount(const FBXGeometry& geometry);
+
+#endif // hifi_GeometryOptimizer_h
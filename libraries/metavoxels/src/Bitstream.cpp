@@ -127,6 +127,7 @@ Bitstream::Bitstream(QDataStream& underlying, MetadataType metadataType, Generic
     _underlying(underlying),
     _byte(0),
     _position(0),
+    _recording(NULL),
     _metadataType(metadataType),
     _genericsMode(genericsMode),
     _objectStreamerStreamer(*this),
@@ -154,39 +155,115 @@ void Bitstream::addTypeSubstitution(const QByteArray& typeName, const char* repl
 
 const int LAST_BIT_POSITION = BITS_IN_BYTE - 1;
 
+// the bytes a write or read gathers before handing them to the underlying stream at once
+const int BITSTREAM_BUFFER_SIZE = 256;
+
 Bitstream& Bitstream::write(const void* data, int bits, int offset) {
     const quint8* source = (const quint8*)data;
+    if (_position == 0 && offset == 0 && bits >= BITS_IN_BYTE) {
+        // byte aligned on both sides, so the whole bytes are copied as they are
+        int bytes = bits / BITS_IN_BYTE;
+        _underlying.writeRawData((const char*)source, bytes);
+        source += bytes;
+        bits -= bytes * BITS_IN_BYTE;
+    }
+    
+    // the bits are gathered in a word holding fewer than a byte's between steps, and whole bytes go out together
+    quint64 accumulator = _byte;
+    int accumulated = _position;
+    quint8 buffer[BITSTREAM_BUFFER_SIZE];
+    int buffered = 0;
     while (bits > 0) {
-        int bitsToWrite = qMin(BITS_IN_BYTE - _position, qMin(BITS_IN_BYTE - offset, bits));
-        _byte |= ((*source >> offset) & ((1 << bitsToWrite) - 1)) << _position;
-        if ((_position += bitsToWrite) == BITS_IN_BYTE) {
-            flush();
+        if (offset == 0 && bits >= 32) {
+            accumulator |= (quint64)(source[0] | (source[1] << 8) | (source[2] << 16) | ((quint32)source[3] << 24)) <<
+                accumulated;
+            accumulated += 32;
+            source += 4;
+            bits -= 32;
+        } else {
+            int bitsToWrite = qMin(BITS_IN_BYTE - offset, bits);
+            accumulator |= (quint64)((*source >> offset) & ((1 << bitsToWrite) - 1)) << accumulated;
+            accumulated += bitsToWrite;
+            if ((offset += bitsToWrite) == BITS_IN_BYTE) {
+                source++;
+                offset = 0;
+            }
+            bits -= bitsToWrite;
         }
-        if ((offset += bitsToWrite) == BITS_IN_BYTE) {
-            source++;
-            offset = 0;
+        for (; accumulated >= BITS_IN_BYTE; accumulated -= BITS_IN_BYTE, accumulator >>= BITS_IN_BYTE) {
+            if (buffered == BITSTREAM_BUFFER_SIZE) {
+                _underlying.writeRawData((const char*)buffer, buffered);
+                buffered = 0;
+            }
+            buffer[buffered++] = (quint8)accumulator;
         }
-        bits -= bitsToWrite;
     }
+    if (buffered > 0) {
+        _underlying.writeRawData((const char*)buffer, buffered);
+    }
+    _byte = (quint8)accumulator;
+    _position = accumulated;
     return *this;
 }
 
 Bitstream& Bitstream::read(void* data, int bits, int offset) {
     quint8* dest = (quint8*)data;
-    while (bits > 0) {
-        if (_position == 0) {
-            _underlying >> _byte;
+    if (_position == 0 && offset == 0 && bits >= BITS_IN_BYTE) {
+        int bytes = bits / BITS_IN_BYTE;
+        int bytesRead = _underlying.readRawData((char*)dest, bytes);
+        if (bytesRead < bytes) {
+            // past the end, the stream reads as zeros
+            memset(dest + qMax(bytesRead, 0), 0, bytes - qMax(bytesRead, 0));
         }
-        int bitsToRead = qMin(BITS_IN_BYTE - _position, qMin(BITS_IN_BYTE - offset, bits));
-        int mask = ((1 << bitsToRead) - 1) << offset;
-        *dest = (*dest & ~mask) | (((_byte >> _position) << offset) & mask);
-        _position = (_position + bitsToRead) & LAST_BIT_POSITION;
-        if ((offset += bitsToRead) == BITS_IN_BYTE) {
-            dest++;
-            offset = 0;
+        dest += bytes;
+        bits -= bytes * BITS_IN_BYTE;
+    }
+    
+    // the bits left in the current byte, followed by the bytes the read needs, which are fetched together; no more are
+    // taken from the underlying stream than the bits call for, so that it can be read directly once this is reset
+    quint64 accumulator = (_position == 0) ? 0 : (_byte >> _position);
+    int accumulated = (_position == 0) ? 0 : BITS_IN_BYTE - _position;
+    int bytesNeeded = (bits > accumulated) ? (bits - accumulated + LAST_BIT_POSITION) / BITS_IN_BYTE : 0;
+    quint8 buffer[BITSTREAM_BUFFER_SIZE];
+    int buffered = 0;
+    int bufferPosition = 0;
+    while (bits > 0) {
+        int bitsToRead = (offset == 0 && bits >= 32) ? 32 : qMin(BITS_IN_BYTE - offset, bits);
+        while (accumulated < bitsToRead) {
+            if (bufferPosition == buffered) {
+                buffered = qMin(bytesNeeded, BITSTREAM_BUFFER_SIZE);
+                int bytesRead = _underlying.readRawData((char*)buffer, buffered);
+                if (bytesRead < buffered) {
+                    memset(buffer + qMax(bytesRead, 0), 0, buffered - qMax(bytesRead, 0));
+                }
+                bytesNeeded -= buffered;
+                bufferPosition = 0;
+            }
+            _byte = buffer[bufferPosition++];
+            accumulator |= (quint64)_byte << accumulated;
+            accumulated += BITS_IN_BYTE;
+        }
+        if (bitsToRead == 32) {
+            dest[0] = (quint8)accumulator;
+            dest[1] = (quint8)(accumulator >> 8);
+            dest[2] = (quint8)(accumulator >> 16);
+            dest[3] = (quint8)(accumulator >> 24);
+            dest += 4;
+        } else {
+            int mask = ((1 << bitsToRead) - 1) << offset;
+            *dest = (*dest & ~mask) | ((accumulator << offset) & mask);
+            if ((offset += bitsToRead) == BITS_IN_BYTE) {
+                dest++;
+                offset = 0;
+            }
         }
+        accumulator >>= bitsToRead;
+        accumulated -= bitsToRead;
         bits -= bitsToRead;
     }
+    
+    // whatever's left of the last byte fetched is read from it next time
+    _position = (BITS_IN_BYTE - accumulated) & LAST_BIT_POSITION;
     return *this;
 }
 
@@ -202,6 +279,49 @@ void Bitstream::reset() {
     _position = 0;
 }
 
+void Bitstream::startRecording(BitstreamRecording* recording) {
+    _recording = recording;
+    _recording->_bits = 0;
+    _recording->_mappedValues.clear();
+}
+
+void Bitstream::stopRecording() {
+    _recording->_bits = getBitsWritten();
+    flush();
+    _recording = NULL;
+}
+
+int Bitstream::getBitsWritten() const {
+    return _underlying.device()->pos() * BITS_IN_BYTE + _position;
+}
+
+void Bitstream::recordMappedValue(const ObjectStreamer* streamer) {
+    BitstreamRecording::MappedValue value = { BitstreamRecording::OBJECT_STREAMER, getBitsWritten(), streamer };
+    _recording->_mappedValues.append(value);
+}
+
+void Bitstream::recordMappedValue(const TypeStreamer* streamer) {
+    BitstreamRecording::MappedValue value = { BitstreamRecording::TYPE_STREAMER, getBitsWritten(), NULL, streamer };
+    _recording->_mappedValues.append(value);
+}
+
+void Bitstream::recordMappedValue(const AttributePointer& attribute) {
+    BitstreamRecording::MappedValue value = { BitstreamRecording::ATTRIBUTE, getBitsWritten(), NULL, NULL, attribute };
+    _recording->_mappedValues.append(value);
+}
+
+void Bitstream::recordMappedValue(const QScriptString& string) {
+    BitstreamRecording::MappedValue value = { BitstreamRecording::SCRIPT_STRING, getBitsWritten(), NULL, NULL,
+        AttributePointer(), string };
+    _recording->_mappedValues.append(value);
+}
+
+void Bitstream::recordMappedValue(const SharedObjectPointer& object) {
+    BitstreamRecording::MappedValue value = { BitstreamRecording::SHARED_OBJECT, getBitsWritten(), NULL, NULL,
+        AttributePointer(), QScriptString(), object };
+    _recording->_mappedValues.append(value);
+}
+
 Bitstream::WriteMappings Bitstream::getAndResetWriteMappings() {
     WriteMappings mappings = { _objectStreamerStreamer.getAndResetTransientOffsets(),
         _typeStreamerStreamer.getAndResetTransientOffsets(),
@@ -1111,6 +1231,37 @@ Bitstream& Bitstream::operator>>(SharedObjectPointer& object) {
     return *this;
 }
 
+Bitstream& Bitstream::operator<<(const BitstreamRecording& recording) {
+    const char* data = recording._data.constData();
+    int position = 0;
+    foreach (const BitstreamRecording::MappedValue& value, recording._mappedValues) {
+        write(data + position / BITS_IN_BYTE, value.position - position, position % BITS_IN_BYTE);
+        switch (value.type) {
+            case BitstreamRecording::OBJECT_STREAMER:
+                _objectStreamerStreamer << value.objectStreamer;
+                break;
+                
+            case BitstreamRecording::TYPE_STREAMER:
+                _typeStreamerStreamer << value.typeStreamer;
+                break;
+                
+            case BitstreamRecording::ATTRIBUTE:
+                _attributeStreamer << value.attribute;
+                break;
+                
+            case BitstreamRecording::SCRIPT_STRING:
+                _scriptStringStreamer << value.scriptString;
+                break;
+                
+            case BitstreamRecording::SHARED_OBJECT:
+                _sharedObjectStreamer << value.sharedObject;
+                break;
+        }
+        position = value.position;
+    }
+    return write(data + position / BITS_IN_BYTE, recording._bits - position, position % BITS_IN_BYTE);
+}
+
 Bitstream& Bitstream::operator<(const ObjectStreamer* streamer) {
     if (!streamer) {
         return *this << QByteArray();
@@ -1916,7 +2067,22 @@ QJsonDocument JSONWriter::getDocument() const {
     return QJsonDocument(top);
 }
 
-JSONReader::JSONReader(const QJsonDocument& document, Bitstream::GenericsMode genericsMode) {
+QJsonDocument JSONWriter::takeDocument() {
+    QJsonDocument document = getDocument();
+    _contents = QJsonArray();
+    _sharedObjects = QJsonArray();
+    _objectStreamers = QJsonArray();
+    _typeStreamers = QJsonArray();
+    return document;
+}
+
+JSONReader::JSONReader(const QJsonDocument& document, Bitstream::GenericsMode genericsMode) :
+    _genericsMode(genericsMode) {
+    
+    addDocument(document);
+}
+
+void JSONReader::addDocument(const QJsonDocument& document) {
     // create and map the type streamers in order
     QJsonObject top = document.object();
     foreach (const QJsonValue& element, top.value("types").toArray()) {
@@ -1927,11 +2093,11 @@ JSONReader::JSONReader(const QJsonDocument& document, Bitstream::GenericsMode ge
         if (!baseStreamer) {
             baseStreamer = Bitstream::getEnumStreamersByName().value(latinName);
         }
-        if (!baseStreamer && genericsMode == Bitstream::NO_GENERICS) {
+        if (!baseStreamer && _genericsMode == Bitstream::NO_GENERICS) {
             continue; // no built-in type and no generics allowed; we give up
         }
         QString category = type.value("category").toString();
-        if (!baseStreamer || genericsMode == Bitstream::ALL_GENERICS) {
+        if (!baseStreamer || _genericsMode == Bitstream::ALL_GENERICS) {
             // create a generic streamer
             TypeStreamerPointer streamer;
             if (category == "ENUM") {
@@ -2051,10 +2217,10 @@ JSONReader::JSONReader(const QJsonDocument& document, Bitstream::GenericsMode ge
         QByteArray latinName = name.toLatin1();
         const ObjectStreamer* baseStreamer = Bitstream::getObjectStreamers().value(
             Bitstream::getMetaObjects().value(latinName));
-        if (!baseStreamer && genericsMode == Bitstream::NO_GENERICS) {
+        if (!baseStreamer && _genericsMode == Bitstream::NO_GENERICS) {
             continue; // no built-in class and no generics allowed; we give up
         }
-        if (!baseStreamer || genericsMode == Bitstream::ALL_GENERICS) {
+        if (!baseStreamer || _genericsMode == Bitstream::ALL_GENERICS) {
             // create a generic streamer
             QVector<StreamerNamePair> properties;
             foreach (const QJsonValue& property, clazz.value("properties").toArray()) {
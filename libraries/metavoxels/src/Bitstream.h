@@ -163,24 +163,6 @@ template<class K, class P, class V> inline void RepeatedValueStreamer<K, P, V>::
     _idStreamer.setBitsFromValue(_lastPersistentID);
 }
 
-template<class K, class P, class V> inline RepeatedValueStreamer<K, P, V>&
-        RepeatedValueStreamer<K, P, V>::operator<<(K value) {
-    int id = _persistentIDs.value(value);
-    if (id == 0) {
-        int& offset = _transientOffsets[value];
-        if (offset == 0) {
-            _idStreamer << (_lastPersistentID + (offset = ++_lastTransientOffset));
-            _stream < value;
-            
-        } else {
-            _idStreamer << (_lastPersistentID + offset);
-        }
-    } else {
-        _idStreamer << id;
-    }
-    return *this;
-}
-
 template<class K, class P, class V> inline RepeatedValueStreamer<K, P, V>&
         RepeatedValueStreamer<K, P, V>::operator>>(V& value) {
     int id;
@@ -225,6 +207,42 @@ template<class K, class P, class V> inline void RepeatedValueStreamer<K, P, V>::
     _valueIDs.clear();
 }
 
+/// A stretch of writes recorded so that it can be copied into any number of other streams, each with its own mappings.  The
+/// bits are kept as they were written, except for the mapped values (streamers, attributes, script strings, and shared
+/// objects), which are noted along with where they fall among the bits and written through the mappings of each stream
+/// that the recording is copied into.
+class BitstreamRecording {
+public:
+    
+    BitstreamRecording() : _bits(0) { }
+    
+    /// Returns a reference to the buffer that the recording stream should write to.
+    QByteArray& getData() { return _data; }
+    
+    int getBits() const { return _bits; }
+    
+private:
+    
+    friend class Bitstream;
+    
+    enum MappedValueType { OBJECT_STREAMER, TYPE_STREAMER, ATTRIBUTE, SCRIPT_STRING, SHARED_OBJECT };
+    
+    class MappedValue {
+    public:
+        MappedValueType type;
+        int position; /// the number of bits written before the value
+        const ObjectStreamer* objectStreamer;
+        const TypeStreamer* typeStreamer;
+        AttributePointer attribute;
+        QScriptString scriptString;
+        SharedObjectPointer sharedObject;
+    };
+    
+    QByteArray _data;
+    int _bits;
+    QVector<MappedValue> _mappedValues;
+};
+
 /// A stream for bit-aligned data.  Through a combination of code generation, reflection, macros, and templates, provides a
 /// serialization mechanism that may be used for both networking and persistent storage.  For unreliable networking, the
 /// class provides a mapping system that resends mappings for ids until they are acknowledged (and thus persisted).  For
@@ -358,6 +376,21 @@ public:
     /// Resets to the initial state.
     void reset();
 
+    /// Starts recording: until the recording is stopped, mapped values are noted in the recording rather than written.  The
+    /// stream should be a fresh one writing to the recording's data.
+    void startRecording(BitstreamRecording* recording);
+    
+    /// Stops recording, noting the number of bits written and flushing them to the recording's data.
+    void stopRecording();
+    
+    bool isRecording() const { return _recording; }
+    
+    void recordMappedValue(const ObjectStreamer* streamer);
+    void recordMappedValue(const TypeStreamer* streamer);
+    void recordMappedValue(const AttributePointer& attribute);
+    void recordMappedValue(const QScriptString& string);
+    void recordMappedValue(const SharedObjectPointer& object);
+
     /// Returns the set of transient mappings gathered during writing and resets them.
     WriteMappings getAndResetWriteMappings();
 
@@ -393,6 +426,10 @@ public:
 
     void writeDelta(const QVariant& value, const QVariant& reference);
     
+    /// Writes a streamable value exactly as a QVariant containing it would be written, but using the streamer and field
+    /// writes generated by mtc rather than boxing the value and dispatching through the variant.
+    template<class T> void writeAsVariant(const T& value);
+    
     template<class T> void writeDelta(const T& value, const T& reference);
     template<class T> void readDelta(T& value, const T& reference); 
 
@@ -509,6 +546,9 @@ public:
     Bitstream& operator<<(const SharedObjectPointer& object);
     Bitstream& operator>>(SharedObjectPointer& object);
     
+    /// Copies a recording's bits, writing its mapped values through this stream's mappings.
+    Bitstream& operator<<(const BitstreamRecording& recording);
+    
     Bitstream& operator<(const ObjectStreamer* streamer);
     Bitstream& operator>(ObjectStreamerPointer& streamer);
     
@@ -540,9 +580,12 @@ private:
     ObjectStreamerPointer readGenericObjectStreamer(const QByteArray& name);
     TypeStreamerPointer readGenericTypeStreamer(const QByteArray& name, int category);
     
+    int getBitsWritten() const;
+    
     QDataStream& _underlying;
     quint8 _byte;
     int _position;
+    BitstreamRecording* _recording;
 
     MetadataType _metadataType;
     GenericsMode _genericsMode;
@@ -577,6 +620,34 @@ private:
     static const TypeStreamer* createInvalidTypeStreamer();
 };
 
+template<class K, class P, class V> inline RepeatedValueStreamer<K, P, V>&
+        RepeatedValueStreamer<K, P, V>::operator<<(K value) {
+    if (_stream.isRecording()) {
+        // the id depends on the mappings of the stream the recording ends up in, so it's written when it's copied there
+        _stream.recordMappedValue(value);
+        return *this;
+    }
+    int id = _persistentIDs.value(value);
+    if (id == 0) {
+        int& offset = _transientOffsets[value];
+        if (offset == 0) {
+            _idStreamer << (_lastPersistentID + (offset = ++_lastTransientOffset));
+            _stream < value;
+            
+        } else {
+            _idStreamer << (_lastPersistentID + offset);
+        }
+    } else {
+        _idStreamer << id;
+    }
+    return *this;
+}
+
+template<class T> inline void Bitstream::writeAsVariant(const T& value) {
+    _typeStreamerStreamer << T::getTypeStreamer();
+    *this << value;
+}
+
 template<class T> inline void Bitstream::writeDelta(const T& value, const T& reference) {
     if (value == reference) {
         *this << false;
@@ -913,6 +984,11 @@ public:
     
     QJsonDocument getDocument() const;
     
+    /// Returns the document of the contents and metadata added since the last call, and clears them. Metadata already
+    /// returned isn't added again, so a long run of values can be written out a piece at a time, each piece read after
+    /// those before it with JSONReader::addDocument.
+    QJsonDocument takeDocument();
+    
 private:
 
     QJsonArray _contents;
@@ -972,6 +1048,10 @@ public:
     /// read all types to generic containers
     JSONReader(const QJsonDocument& document, Bitstream::GenericsMode genericsMode = Bitstream::NO_GENERICS);
     
+    /// Maps the metadata of a further document, one taken from a JSONWriter after the documents already read, and
+    /// replaces the contents with its own.
+    void addDocument(const QJsonDocument& document);
+    
     void putData(const QJsonValue& data, bool& value);
     void putData(const QJsonValue& data, int& value);
     void putData(const QJsonValue& data, uint& value);
@@ -1007,6 +1087,8 @@ public:
 
 private:
     
+    Bitstream::GenericsMode _genericsMode;
+    
     QJsonArray _contents;
     QJsonArray::const_iterator _contentsIterator;
     
@@ -1724,6 +1806,7 @@ template<class T> int registerCollectionMetaType() {
 /// this macro in order to generate streaming (etc.) code for types.
 #define STREAMABLE public: \
     static const int Type; \
+    static const TypeStreamer* getTypeStreamer(); \
     static const QVector<MetaField>& getMetaFields(); \
     static int getFieldIndex(const QByteArray& name); \
     void setField(int index, const QVariant& value); \
@@ -129,6 +129,9 @@ void DatagramSequencer::endPacket() {
     int remaining = _maxPacketSize - _outgoingPacketStream.device()->pos();
     const int MINIMUM_RELIABLE_SIZE = sizeof(quint32) * 5; // count, channel number, segment count, offset, size
     QVector<ChannelSpan> spans;
+    if (!_spareSpans.isEmpty()) {
+        spans = _spareSpans.takeLast();
+    }
     if (remaining > MINIMUM_RELIABLE_SIZE) {
         appendReliableData(remaining, spans);
     } else {
@@ -218,6 +221,9 @@ void DatagramSequencer::receivedDatagram(const QByteArray& datagram) {
         }
         sendRecordAcknowledged(*it);
         emit sendAcknowledged(index);
+        for (QList<SendRecord>::iterator record = _sendRecords.begin(); record != it + 1; record++) {
+            recycleSpans(record->spans);
+        }
         _sendRecords.erase(_sendRecords.begin(), it + 1);
     }
     
@@ -378,26 +384,71 @@ void DatagramSequencer::sendPacket(const QByteArray& packet, const QVector<Chann
     
     emit sendRecorded();
     
+    // the packet data is followed (and perhaps interrupted) by the segments left in the reliable channels' buffers
+    int packetSize = packet.size();
+    foreach (const PacketSegment& segment, _outgoingPacketSegments) {
+        packetSize += segment.length;
+    }
+    
     // write the sequence number and size, which are the same between all fragments
     _outgoingDatagramBuffer.seek(_datagramHeaderSize);
     _outgoingDatagramStream << (quint32)_outgoingPacketNumber;
-    _outgoingDatagramStream << (quint32)packet.size();
+    _outgoingDatagramStream << (quint32)packetSize;
     int initialPosition = _outgoingDatagramBuffer.pos();
     
-    // break the packet into MTU-sized datagrams
+    // break the packet into MTU-sized datagrams, gathering the packet data and the segments straight into each
     int offset = 0;
+    int dataPosition = 0;
+    int segmentIndex = 0;
+    int segmentOffset = 0;
     do {
         _outgoingDatagramBuffer.seek(initialPosition);
         _outgoingDatagramStream << (quint32)offset;
         
-        int payloadSize = qMin((int)(_outgoingDatagram.size() - _outgoingDatagramBuffer.pos()), packet.size() - offset);
-        memcpy(_outgoingDatagram.data() + _outgoingDatagramBuffer.pos(), packet.constData() + offset, payloadSize);
+        char* payload = _outgoingDatagram.data() + _outgoingDatagramBuffer.pos();
+        int payloadSize = qMin((int)(_outgoingDatagram.size() - _outgoingDatagramBuffer.pos()), packetSize - offset);
+        for (int copied = 0; copied < payloadSize; ) {
+            int dataEnd = (segmentIndex < _outgoingPacketSegments.size()) ?
+                _outgoingPacketSegments.at(segmentIndex).position : packet.size();
+            if (dataPosition < dataEnd) {
+                int length = qMin(dataEnd - dataPosition, payloadSize - copied);
+                memcpy(payload + copied, packet.constData() + dataPosition, length);
+                dataPosition += length;
+                copied += length;
+                continue;
+            }
+            const PacketSegment& segment = _outgoingPacketSegments.at(segmentIndex);
+            int length = qMin(segment.length - segmentOffset, payloadSize - copied);
+            memcpy(payload + copied, segment.data + segmentOffset, length);
+            copied += length;
+            if ((segmentOffset += length) == segment.length) {
+                segmentIndex++;
+                segmentOffset = 0;
+            }
+        }
         
         emit readyToWrite(QByteArray::fromRawData(_outgoingDatagram.constData(), _outgoingDatagramBuffer.pos() + payloadSize));
         
         offset += payloadSize;
         
-    } while(offset < packet.size());
+    } while(offset < packetSize);
+    
+    _outgoingPacketSegments.resize(0);
+}
+
+void DatagramSequencer::appendPacketSegment(const char* data, int length) {
+    PacketSegment segment = { _outgoingPacketStream.device()->pos(), data, length };
+    _outgoingPacketSegments.append(segment);
+}
+
+const int MAX_SPARE_SPANS = 16;
+
+void DatagramSequencer::recycleSpans(QVector<ChannelSpan>& spans) {
+    if (spans.capacity() > 0 && _spareSpans.size() < MAX_SPARE_SPANS) {
+        spans.resize(0);
+        _spareSpans.append(spans);
+        spans = QVector<ChannelSpan>();
+    }
 }
 
 const int INITIAL_CIRCULAR_BUFFER_CAPACITY = 16;
@@ -470,6 +521,17 @@ void CircularBuffer::writeToStream(int offset, int length, QDataStream& out) con
     }
 }
 
+void CircularBuffer::appendToPacket(int offset, int length, DatagramSequencer& sequencer) const {
+    // append in up to two segments
+    int start = (_position + offset) % _data.size();
+    int firstSegment = qMin(length, _data.size() - start);
+    sequencer.appendPacketSegment(_data.constData() + start, firstSegment);
+    int secondSegment = length - firstSegment;
+    if (secondSegment > 0) {
+        sequencer.appendPacketSegment(_data.constData(), secondSegment);
+    }
+}
+
 void CircularBuffer::readFromStream(int offset, int length, QDataStream& in) {
     // resize to fit
     int requiredSize = offset + length;
@@ -796,7 +858,7 @@ int ReliableChannel::writeSpan(QDataStream& out, int position, int length, QVect
     spans.append(span);
     out << (quint32)length;
     out << (quint32)span.offset;
-    _buffer.writeToStream(position, length, out);
+    _buffer.appendToPacket(position, length, *static_cast<DatagramSequencer*>(parent()));
     _writePosition = position + length;
     
     return length;
@@ -160,6 +160,7 @@ private slots:
     
 private:
     
+    friend class CircularBuffer;
     friend class ReliableChannel;
     
     class ChannelSpan {
@@ -186,6 +187,15 @@ private:
         bool operator<(const ReceiveRecord& other) const { return packetNumber < other.packetNumber; }
     };
     
+    /// A run of bytes that belongs in the outgoing packet but is left where it lies (in a reliable channel's buffer)
+    /// until the packet is broken into datagrams, so that it's only copied once.
+    class PacketSegment {
+    public:
+        int position; ///< the position in the packet data that the segment follows
+        const char* data;
+        int length;
+    };
+    
     /// Notes that the described send was acknowledged by the other party.
     void sendRecordAcknowledged(const SendRecord& record);
     
@@ -199,11 +209,19 @@ private:
     /// readyToWrite) as necessary.
     void sendPacket(const QByteArray& packet, const QVector<ChannelSpan>& spans);
     
+    /// Adds a segment to follow the packet data written so far.  The data must stay put until the packet is sent.
+    void appendPacketSegment(const char* data, int length);
+    
+    /// Returns the spans of a send record to the spare list for reuse.
+    void recycleSpans(QVector<ChannelSpan>& spans);
+    
     QList<SendRecord> _sendRecords;
+    QList<QVector<ChannelSpan> > _spareSpans;
     QList<ReceiveRecord> _receiveRecords;
     
     QByteArray _outgoingPacketData;
     QDataStream _outgoingPacketStream;
+    QVector<PacketSegment> _outgoingPacketSegments;
     Bitstream _outputStream;
     
     QBuffer _incomingDatagramBuffer;
@@ -264,6 +282,10 @@ public:
     /// Writes part of the buffer to the supplied stream.
     void writeToStream(int offset, int length, QDataStream& out) const;
 
+    /// Adds part of the buffer to the sequencer's outgoing packet without copying it.  The buffer must not change until
+    /// the packet is sent.
+    void appendToPacket(int offset, int length, DatagramSequencer& sequencer) const;
+
     /// Reads part of the buffer from the supplied stream.
     void readFromStream(int offset, int length, QDataStream& in);
 
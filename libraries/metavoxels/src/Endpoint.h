@@ -32,7 +32,7 @@ public:
         PacketRecord* baselineReceiveRecord = NULL);
     virtual ~Endpoint();
     
-    virtual void update();
+    Q_INVOKABLE virtual void update();
     
     virtual int parseData(const QByteArray& packet);
 
@@ -9,14 +9,35 @@
 //  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
 //
 
+#include <QThread>
+
 #include "MetavoxelClientManager.h"
 #include "MetavoxelMessages.h"
 
+MetavoxelClientManager::MetavoxelClientManager() :
+    _clientThread(NULL) {
+}
+
+MetavoxelClientManager::~MetavoxelClientManager() {
+    if (_clientThread) {
+        _clientThread->quit();
+        _clientThread->wait();
+    }
+}
+
 void MetavoxelClientManager::init() {
     connect(NodeList::getInstance(), SIGNAL(nodeAdded(SharedNodePointer)), SLOT(maybeAttachClient(const SharedNodePointer&)));
+    
+    _clientThread = new QThread(this);
+    _clientThread->start();
 }
 
 void MetavoxelClientManager::update() {
+    MetavoxelLOD lod = getLOD();
+    {
+        QMutexLocker locker(&_updateLODMutex);
+        _updateLOD = lod;
+    }
     foreach (const SharedNodePointer& node, NodeList::getInstance()->getNodeHash()) {
         if (node->getType() == NodeType::MetavoxelServer) {
             QMutexLocker locker(&node->getMutex());
@@ -59,7 +80,8 @@ void MetavoxelClientManager::applyEdit(const MetavoxelEditMessage& edit, bool re
             QMutexLocker locker(&node->getMutex());
             MetavoxelClient* client = static_cast<MetavoxelClient*>(node->getLinkedData());
             if (client) {
-                client->applyEdit(edit, reliable);
+                QMetaObject::invokeMethod(client, "applyEdit", Q_ARG(const MetavoxelEditMessage&, edit),
+                    Q_ARG(bool, reliable));
             }
         }
     }
@@ -69,10 +91,17 @@ MetavoxelLOD MetavoxelClientManager::getLOD() const {
     return MetavoxelLOD();
 }
 
+MetavoxelLOD MetavoxelClientManager::getUpdateLOD() const {
+    QMutexLocker locker(&_updateLODMutex);
+    return _updateLOD;
+}
+
 void MetavoxelClientManager::maybeAttachClient(const SharedNodePointer& node) {
     if (node->getType() == NodeType::MetavoxelServer) {
         QMutexLocker locker(&node->getMutex());
-        node->setLinkedData(createClient(node));
+        MetavoxelClient* client = createClient(node);
+        client->moveToThread(_clientThread);
+        node->setLinkedData(client);
     }
 }
 
@@ -81,7 +110,9 @@ MetavoxelClient* MetavoxelClientManager::createClient(const SharedNodePointer& n
 }
 
 void MetavoxelClientManager::updateClient(MetavoxelClient* client) {
-    client->update();
+    // the client sends on its own thread; here we just take whatever it has finished decoding since the last update
+    QMetaObject::invokeMethod(client, "update");
+    client->updateData();
 }
 
 MetavoxelClient::MetavoxelClient(const SharedNodePointer& node, MetavoxelClientManager* manager) :
@@ -94,9 +125,9 @@ MetavoxelClient::MetavoxelClient(const SharedNodePointer& node, MetavoxelClientM
         SIGNAL(receivedMessage(const QVariant&, Bitstream&)), SLOT(handleMessage(const QVariant&, Bitstream&)));
 }
 
-void MetavoxelClient::guide(MetavoxelVisitor& visitor) {
+void MetavoxelClient::guide(MetavoxelVisitor& visitor, QThreadPool* pool) {
     visitor.setLOD(_manager->getLOD());
-    _data.guide(visitor);
+    getData().guide(visitor, pool);
 }
 
 void MetavoxelClient::applyEdit(const MetavoxelEditMessage& edit, bool reliable) {
@@ -106,6 +137,7 @@ void MetavoxelClient::applyEdit(const MetavoxelEditMessage& edit, bool reliable)
     } else {
         // apply immediately to local tree
         edit.apply(_data, _sequencer.getWeakSharedObjectHash());
+        _publishedData.publish(_data);
 
         // start sending it out
         _sequencer.sendHighPriorityMessage(QVariant::fromValue(edit));
@@ -113,23 +145,23 @@ void MetavoxelClient::applyEdit(const MetavoxelEditMessage& edit, bool reliable)
 }
 
 void MetavoxelClient::writeUpdateMessage(Bitstream& out) {
-    ClientStateMessage state = { _manager->getLOD() };
-    out << QVariant::fromValue(state);
+    ClientStateMessage state = { _manager->getUpdateLOD() };
+    out.writeAsVariant(state);
 }
 
 void MetavoxelClient::handleMessage(const QVariant& message, Bitstream& in) {
     int userType = message.userType(); 
     if (userType == MetavoxelDeltaMessage::Type) {
         PacketRecord* receiveRecord = getLastAcknowledgedReceiveRecord();
+        MetavoxelLOD lod = message.value<MetavoxelDeltaMessage>().lod;
         if (_reliableDeltaChannel) {    
-            _remoteData.readDelta(receiveRecord->getData(), receiveRecord->getLOD(), in, _remoteDataLOD = _reliableDeltaLOD);
+            _remoteData.readDelta(receiveRecord->getData(), receiveRecord->getLOD(), in, _remoteDataLOD = lod);
             _sequencer.getInputStream().persistReadMappings(in.getAndResetReadMappings());
             in.clearPersistentMappings();
             _reliableDeltaChannel = NULL;
         
         } else {
-            _remoteData.readDelta(receiveRecord->getData(), receiveRecord->getLOD(), in,
-                _remoteDataLOD = getLastAcknowledgedSendRecord()->getLOD());
+            _remoteData.readDelta(receiveRecord->getData(), receiveRecord->getLOD(), in, _remoteDataLOD = lod);
             in.reset();
         }
         // copy to local and reapply local edits
@@ -139,6 +171,8 @@ void MetavoxelClient::handleMessage(const QVariant& message, Bitstream& in) {
                 message.data.value<MetavoxelEditMessage>().apply(_data, _sequencer.getWeakSharedObjectHash());
             }
         }
+        // the copy shares all but the roots, so handing it over costs no more than the reference counting
+        _publishedData.publish(_data);
     } else if (userType == MetavoxelDeltaPendingMessage::Type) {
         // check the id to make sure this is not a delta we've already processed
         int id = message.value<MetavoxelDeltaPendingMessage>().id;
@@ -157,7 +191,7 @@ void MetavoxelClient::handleMessage(const QVariant& message, Bitstream& in) {
 }
 
 PacketRecord* MetavoxelClient::maybeCreateSendRecord() const {
-    return new PacketRecord(_reliableDeltaChannel ? _reliableDeltaLOD : _manager->getLOD());
+    return new PacketRecord(_reliableDeltaChannel ? _reliableDeltaLOD : _manager->getUpdateLOD());
 }
 
 PacketRecord* MetavoxelClient::maybeCreateReceiveRecord() const {
@@ -12,17 +12,25 @@
 #ifndef hifi_MetavoxelClientManager_h
 #define hifi_MetavoxelClientManager_h
 
+#include <QMutex>
+
+#include <TripleBuffer.h>
+
 #include "Endpoint.h"
 
 class MetavoxelClient;
 class MetavoxelEditMessage;
 
-/// Manages the set of connected metavoxel clients.
+/// Manages the set of connected metavoxel clients.  The clients receive, decode, and send on a thread of their own;
+/// each update picks up the data they last finished decoding, so that it can be visited without waiting on the network.
 class MetavoxelClientManager : public QObject {
     Q_OBJECT
 
 public:
 
+    MetavoxelClientManager();
+    virtual ~MetavoxelClientManager();
+
     virtual void init();
     void update();
 
@@ -33,6 +41,10 @@ public:
 
     virtual MetavoxelLOD getLOD() const;
     
+    /// Returns the LOD as of the last update, for the clients to request from their servers.
+    /// Safe to call from any thread.
+    MetavoxelLOD getUpdateLOD() const;
+    
 private slots:
 
     void maybeAttachClient(const SharedNodePointer& node);
@@ -41,6 +53,13 @@ protected:
     
     virtual MetavoxelClient* createClient(const SharedNodePointer& node);
     virtual void updateClient(MetavoxelClient* client);
+
+private:
+    
+    QThread* _clientThread;
+    
+    mutable QMutex _updateLODMutex;
+    MetavoxelLOD _updateLOD;
 };
 
 /// Base class for metavoxel clients.
@@ -51,11 +70,17 @@ public:
     
     MetavoxelClient(const SharedNodePointer& node, MetavoxelClientManager* manager);
 
-    MetavoxelData& getData() { return _data; }
+    /// Picks up the data last finished on the client thread, returning whether it's newer than what getData returned.
+    /// This and the functions that follow are only to be called from the thread that updates the manager.
+    bool updateData() { return _publishedData.update(); }
+    
+    /// Returns the data as of the last call to updateData.
+    MetavoxelData& getData() { return _publishedData.getReadBuffer(); }
 
-    void guide(MetavoxelVisitor& visitor);
+    void guide(MetavoxelVisitor& visitor, QThreadPool* pool = NULL);
     
-    void applyEdit(const MetavoxelEditMessage& edit, bool reliable = false);
+    /// Applies an edit on the client thread (an unreliable one shows in the data the next call to updateData takes).
+    Q_INVOKABLE void applyEdit(const MetavoxelEditMessage& edit, bool reliable = false);
 
 protected:
 
@@ -68,7 +93,8 @@ protected:
 private:
     
     MetavoxelClientManager* _manager;
-    MetavoxelData _data;
+    MetavoxelData _data; ///< only touched on the client thread
+    TripleBuffer<MetavoxelData> _publishedData; ///< copies of _data handed to the manager's thread
     MetavoxelData _remoteData;
     MetavoxelLOD _remoteDataLOD;
     
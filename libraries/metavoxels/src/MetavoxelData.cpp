@@ -10,14 +10,19 @@
 //
 
 #include <QDateTime>
+#include <QRunnable>
 #include <QScriptEngine>
+#include <QSemaphore>
+#include <QThreadPool>
 #include <QtDebug>
 
 #include <GeometryUtil.h>
+#include <SlabAllocator.h>
 
 #include "MetavoxelData.h"
 #include "MetavoxelUtil.h"
 #include "ScriptCache.h"
+#include "SpannerBoundsTree.h"
 
 REGISTER_META_OBJECT(MetavoxelGuide)
 REGISTER_META_OBJECT(DefaultMetavoxelGuide)
@@ -60,7 +65,8 @@ MetavoxelData::MetavoxelData() : _size(1.0f) {
 
 MetavoxelData::MetavoxelData(const MetavoxelData& other) :
     _size(other._size),
-    _roots(other._roots) {
+    _roots(other._roots),
+    _spannerBoundsTrees(other._spannerBoundsTrees) {
     
     incrementRootReferenceCounts();
 }
@@ -73,6 +79,7 @@ MetavoxelData& MetavoxelData::operator=(const MetavoxelData& other) {
     decrementRootReferenceCounts();
     _size = other._size;
     _roots = other._roots;
+    _spannerBoundsTrees = other._spannerBoundsTrees;
     incrementRootReferenceCounts();
     return *this;
 }
@@ -82,13 +89,117 @@ Box MetavoxelData::getBounds() const {
     return Box(glm::vec3(-halfSize, -halfSize, -halfSize), glm::vec3(halfSize, halfSize, halfSize));
 }
 
-void MetavoxelData::guide(MetavoxelVisitor& visitor) {
+/// The tour of an octant by a fork of a visitor on a thread of a pool.
+class MetavoxelFork : public QRunnable {
+public:
+    
+    MetavoxelFork(MetavoxelVisitor* visitor, const MetavoxelVisitation& visitation, QSemaphore& finished);
+    virtual ~MetavoxelFork();
+    
+    MetavoxelVisitor* getVisitor() const { return _visitor; }
+    
+    virtual void run();
+
+private:
+    
+    MetavoxelVisitor* _visitor;
+    QVector<MetavoxelNode*> _inputNodes;
+    glm::vec3 _minimum;
+    float _size;
+    QVector<AttributeValue> _inputValues;
+    QSemaphore& _finished;
+};
+
+MetavoxelFork::MetavoxelFork(MetavoxelVisitor* visitor, const MetavoxelVisitation& visitation, QSemaphore& finished) :
+    _visitor(visitor),
+    _inputNodes(visitation.inputNodes),
+    _minimum(visitation.info.minimum),
+    _size(visitation.info.size),
+    _inputValues(visitation.info.inputValues),
+    _finished(finished) {
+    
+    // the tours keep the forks, which are joined in order once they're all done
+    setAutoDelete(false);
+}
+
+MetavoxelFork::~MetavoxelFork() {
+    delete _visitor;
+}
+
+void MetavoxelFork::run() {
+    MetavoxelVisitation visitation = { NULL, *_visitor, _inputNodes, QVector<MetavoxelNode*>(),
+        { NULL, _minimum, _size, _inputValues, QVector<OwnedAttributeValue>() }, NULL };
+    static_cast<MetavoxelGuide*>(visitation.info.inputValues.last().getInlineValue<
+        SharedObjectPointer>().data())->guide(visitation);
+    _finished.release();
+}
+
+/// The octants of a tour handed off to the threads of a pool.
+class MetavoxelForks {
+public:
+    
+    MetavoxelForks(MetavoxelVisitor& visitor, QThreadPool* pool, float size);
+    
+    /// Hands the visitation off to the pool if it's at the fork depth and its octant can be toured on another thread.
+    /// \return true if the visitation was forked
+    bool maybeFork(const MetavoxelVisitation& visitation);
+    
+    /// Waits for the forks to finish and joins them to the visitor.
+    void joinAll();
+
+private:
+    
+    MetavoxelVisitor& _visitor;
+    QThreadPool* _pool;
+    float _size;
+    bool _forkable;
+    QList<MetavoxelFork*> _forks;
+    QSemaphore _finished;
+};
+
+MetavoxelForks::MetavoxelForks(MetavoxelVisitor& visitor, QThreadPool* pool, float size) :
+    _visitor(visitor),
+    _pool(pool),
+    _size(size),
+    _forkable(true) {
+}
+
+bool MetavoxelForks::maybeFork(const MetavoxelVisitation& visitation) {
+    // only the default guide is known to keep no state of its own
+    if (!_forkable || visitation.info.size > _size || visitation.info.inputValues.last().getInlineValue<
+            SharedObjectPointer>()->metaObject() != &DefaultMetavoxelGuide::staticMetaObject) {
+        return false;
+    }
+    MetavoxelVisitor* visitor = _visitor.fork();
+    if (!visitor) {
+        _forkable = false;
+        return false;
+    }
+    MetavoxelFork* fork = new MetavoxelFork(visitor, visitation, _finished);
+    _forks.append(fork);
+    _pool->start(fork);
+    return true;
+}
+
+void MetavoxelForks::joinAll() {
+    _finished.acquire(_forks.size());
+    foreach (MetavoxelFork* fork, _forks) {
+        _visitor.join(fork->getVisitor());
+        delete fork;
+    }
+    _forks.clear();
+}
+
+void MetavoxelData::guide(MetavoxelVisitor& visitor, QThreadPool* pool) {
     // let the visitor know we're about to begin a tour
     visitor.prepare();
 
     // start with the root values/defaults (plus the guide attribute)
     const QVector<AttributePointer>& inputs = visitor.getInputs();
     const QVector<AttributePointer>& outputs = visitor.getOutputs();
+    foreach (const AttributePointer& output, outputs) {
+        _spannerBoundsTrees.remove(output);
+    }
     MetavoxelVisitation firstVisitation = { NULL, visitor, QVector<MetavoxelNode*>(inputs.size() + 1),
         QVector<MetavoxelNode*>(outputs.size()), { NULL, getMinimum(), _size,
             QVector<AttributeValue>(inputs.size() + 1), QVector<OwnedAttributeValue>(outputs.size()) } };
@@ -105,8 +216,12 @@ void MetavoxelData::guide(MetavoxelVisitor& visitor) {
         MetavoxelNode* node = _roots.value(outputs.at(i));
         firstVisitation.outputNodes[i] = node;
     }
+    MetavoxelForks forks(visitor, pool, _size / (1 << METAVOXEL_FORK_DEPTH));
+    firstVisitation.forks = (pool && outputs.isEmpty()) ? &forks : NULL;
     static_cast<MetavoxelGuide*>(firstVisitation.info.inputValues.last().getInlineValue<
         SharedObjectPointer>().data())->guide(firstVisitation);
+    forks.joinAll();
+    
     for (int i = 0; i < outputs.size(); i++) {
         OwnedAttributeValue& value = firstVisitation.info.outputValues[i];
         if (!value.getAttribute()) {
@@ -279,6 +394,7 @@ void MetavoxelData::replace(const AttributePointer& attribute, const Box& bounds
 }
 
 void MetavoxelData::clear(const AttributePointer& attribute) {
+    _spannerBoundsTrees.remove(attribute);
     MetavoxelNode* node = _roots.take(attribute);
     if (node) {
         node->decrementReferenceCount(attribute);
@@ -315,9 +431,17 @@ bool FirstRaySpannerIntersectionVisitor::visitSpanner(Spanner* spanner, float di
     return false;
 }
 
+void MetavoxelData::getIntersectingSpanners(const AttributePointer& attribute, const Box& bounds,
+        QVector<SharedObjectPointer>& spanners) {
+    getSpannerBoundsTree(attribute).findIntersecting(bounds, spanners);
+}
+
 SharedObjectPointer MetavoxelData::findFirstRaySpannerIntersection(
         const glm::vec3& origin, const glm::vec3& direction, const AttributePointer& attribute,
             float& distance, const MetavoxelLOD& lod) {
+    if (!lod.isValid()) {
+        return SharedObjectPointer(getSpannerBoundsTree(attribute).findFirstRayIntersection(origin, direction, distance));
+    }
     FirstRaySpannerIntersectionVisitor visitor(origin, direction, attribute, lod);
     guide(visitor);
     if (!visitor.getSpanner()) {
@@ -417,6 +541,7 @@ void MetavoxelData::set(const glm::vec3& minimum, const MetavoxelData& data, boo
     // set/mix each attribute separately
     for (QHash<AttributePointer, MetavoxelNode*>::const_iterator it = data._roots.constBegin();
             it != data._roots.constEnd(); it++) {
+        _spannerBoundsTrees.remove(it.key());
         MetavoxelNode*& root = _roots[it.key()];
         setNode(it.key(), root, getMinimum(), getSize(), it.value(), minimum, data.getSize(), blend);
         if (root->isLeaf() && root->getAttributeValue(it.key()).isDefault()) {
@@ -461,6 +586,7 @@ void MetavoxelData::read(Bitstream& in, const MetavoxelLOD& lod) {
     // clear out any existing roots
     decrementRootReferenceCounts();
     _roots.clear();
+    _spannerBoundsTrees.clear();
 
     in >> _size;
     
@@ -496,6 +622,7 @@ void MetavoxelData::readDelta(const MetavoxelData& reference, const MetavoxelLOD
     if (!changed) {
         return;
     }
+    _spannerBoundsTrees.clear();
 
     bool sizeChanged;
     in >> sizeChanged;
@@ -603,6 +730,7 @@ void MetavoxelData::writeDelta(const MetavoxelData& reference, const MetavoxelLO
 }
 
 MetavoxelNode* MetavoxelData::createRoot(const AttributePointer& attribute) {
+    _spannerBoundsTrees.remove(attribute);
     MetavoxelNode*& root = _roots[attribute];
     if (root) {
         root->decrementReferenceCount(attribute);
@@ -647,6 +775,41 @@ void MetavoxelData::decrementRootReferenceCounts() {
     }
 }
 
+/// Gathers every spanner in a layer, masked or not.
+class GatherSpannersVisitor : public SpannerVisitor {
+public:
+    
+    GatherSpannersVisitor(const AttributePointer& attribute);
+    
+    const QVector<SharedObjectPointer>& getSpanners() const { return _spanners; }
+    
+    virtual bool visit(Spanner* spanner, const glm::vec3& clipMinimum, float clipSize);
+
+private:
+    
+    QVector<SharedObjectPointer> _spanners;
+};
+
+GatherSpannersVisitor::GatherSpannersVisitor(const AttributePointer& attribute) :
+    SpannerVisitor(QVector<AttributePointer>() << attribute) {
+}
+
+bool GatherSpannersVisitor::visit(Spanner* spanner, const glm::vec3& clipMinimum, float clipSize) {
+    _spanners.append(spanner);
+    return true;
+}
+
+const SpannerBoundsTree& MetavoxelData::getSpannerBoundsTree(const AttributePointer& attribute) {
+    QSharedPointer<SpannerBoundsTree> tree = _spannerBoundsTrees.value(attribute);
+    if (!tree) {
+        GatherSpannersVisitor visitor(attribute);
+        guide(visitor);
+        _spannerBoundsTrees.insert(attribute, tree = QSharedPointer<SpannerBoundsTree>(
+            new SpannerBoundsTree(visitor.getSpanners())));
+    }
+    return *tree;
+}
+
 Bitstream& operator<<(Bitstream& out, const MetavoxelData& data) {
     data.write(out);
     return out;
@@ -709,6 +872,20 @@ MetavoxelNode::MetavoxelNode(const AttributePointer& attribute, const MetavoxelN
     }
 }
 
+static SlabAllocator& getNodeAllocator() {
+    // never deleted, as nodes can outlive the static destructors
+    static SlabAllocator* allocator = new SlabAllocator(sizeof(MetavoxelNode));
+    return *allocator;
+}
+
+void* MetavoxelNode::operator new(size_t size) {
+    return getNodeAllocator().allocate();
+}
+
+void MetavoxelNode::operator delete(void* node) {
+    getNodeAllocator().deallocate(node);
+}
+
 void MetavoxelNode::setAttributeValue(const AttributeValue& attributeValue) {
     attributeValue.getAttribute()->destroy(_attributeValue);
     _attributeValue = attributeValue.copy();
@@ -999,7 +1176,7 @@ void MetavoxelNode::writeSpannerSubdivision(MetavoxelStreamState& state) const {
 }
 
 void MetavoxelNode::decrementReferenceCount(const AttributePointer& attribute) {
-    if (--_referenceCount == 0) {
+    if (!_referenceCount.deref()) {
         destroy(attribute);
         delete this;
     }
@@ -1135,6 +1312,14 @@ void MetavoxelVisitor::prepare() {
     // nothing by default
 }
 
+MetavoxelVisitor* MetavoxelVisitor::fork() const {
+    return NULL;
+}
+
+void MetavoxelVisitor::join(MetavoxelVisitor* fork) {
+    // nothing by default
+}
+
 SpannerVisitor::SpannerVisitor(const QVector<AttributePointer>& spannerInputs, const QVector<AttributePointer>& spannerMasks,
         const QVector<AttributePointer>& inputs, const QVector<AttributePointer>& outputs, const MetavoxelLOD& lod) :
     MetavoxelVisitor(inputs + spannerInputs + spannerMasks, outputs, lod),
@@ -1298,7 +1483,7 @@ bool DefaultMetavoxelGuide::guide(MetavoxelVisitation& visitation) {
     MetavoxelVisitation nextVisitation = { &visitation, visitation.visitor,
         QVector<MetavoxelNode*>(visitation.inputNodes.size()), QVector<MetavoxelNode*>(visitation.outputNodes.size()),
         { &visitation.info, glm::vec3(), visitation.info.size * 0.5f, QVector<AttributeValue>(visitation.inputNodes.size()),
-            QVector<OwnedAttributeValue>(visitation.outputNodes.size()) } };
+            QVector<OwnedAttributeValue>(visitation.outputNodes.size()) }, visitation.forks };
     for (int i = 0; i < MetavoxelNode::CHILD_COUNT; i++) {
         // the encoded order tells us the child indices for each iteration
         int index = encodedOrder & ORDER_ELEMENT_MASK;
@@ -1318,6 +1503,9 @@ bool DefaultMetavoxelGuide::guide(MetavoxelVisitation& visitation) {
             nextVisitation.outputNodes[j] = child;
         }
         nextVisitation.info.minimum = getNextMinimum(visitation.info.minimum, nextVisitation.info.size, index);
+        if (visitation.forks && visitation.forks->maybeFork(nextVisitation)) {
+            continue;
+        }
         if (!static_cast<MetavoxelGuide*>(nextVisitation.info.inputValues.last().getInlineValue<
                 SharedObjectPointer>().data())->guide(nextVisitation)) {
             return false;
@@ -1527,8 +1715,7 @@ Spanner::Spanner() :
     _renderer(NULL),
     _placementGranularity(DEFAULT_PLACEMENT_GRANULARITY),
     _voxelizationGranularity(DEFAULT_VOXELIZATION_GRANULARITY),
-    _masked(false),
-    _lastVisit(0) {
+    _masked(false) {
 }
 
 void Spanner::setBounds(const Box& bounds) {
@@ -1557,12 +1744,15 @@ bool Spanner::blendAttributeValues(MetavoxelInfo& info, bool force) const {
     return false;
 }
 
+void Spanner::incrementVisit() {
+    _visited.localData().clear();
+}
+
 bool Spanner::testAndSetVisited() {
-    if (_lastVisit == _visit) {
-        return false;
-    }
-    _lastVisit = _visit;
-    return true;
+    QSet<Spanner*>& visited = _visited.localData();
+    int size = visited.size();
+    visited.insert(this);
+    return visited.size() != size;
 }
 
 SpannerRenderer* Spanner::getRenderer() {
@@ -1589,7 +1779,7 @@ QByteArray Spanner::getRendererClassName() const {
     return "SpannerRendererer";
 }
 
-int Spanner::_visit = 0;
+QThreadStorage<QSet<Spanner*> > Spanner::_visited;
 
 SpannerRenderer::SpannerRenderer() {
 }
@@ -12,12 +12,15 @@
 #ifndef hifi_MetavoxelData_h
 #define hifi_MetavoxelData_h
 
+#include <QAtomicInt>
 #include <QBitArray>
 #include <QHash>
 #include <QSharedData>
+#include <QSet>
 #include <QSharedPointer>
 #include <QScriptString>
 #include <QScriptValue>
+#include <QThreadStorage>
 #include <QVector>
 
 #include <glm/glm.hpp>
@@ -26,12 +29,15 @@
 #include "MetavoxelUtil.h"
 
 class QScriptContext;
+class QThreadPool;
 
+class MetavoxelForks;
 class MetavoxelNode;
 class MetavoxelVisitation;
 class MetavoxelVisitor;
 class NetworkValue;
 class Spanner;
+class SpannerBoundsTree;
 class SpannerRenderer;
 
 /// Determines whether to subdivide each node when traversing.  Contains the position (presumed to be of the viewer) and a
@@ -56,6 +62,9 @@ public:
 
 DECLARE_STREAMABLE_METATYPE(MetavoxelLOD)
 
+/// the depth at which parallel tours hand octants off to the threads of a pool, up to 64 of them
+const int METAVOXEL_FORK_DEPTH = 2;
+
 /// The base metavoxel representation shared between server and client.  Contains a size (for all dimensions) and a set of
 /// octrees for different attributes.  
 class MetavoxelData {
@@ -78,7 +87,9 @@ public:
     Box getBounds() const;
 
     /// Applies the specified visitor to the contained voxels.
-    void guide(MetavoxelVisitor& visitor);
+    /// \param pool if not null and the visitor can be forked (see MetavoxelVisitor::fork), the pool on whose threads to tour
+    /// the octants METAVOXEL_FORK_DEPTH levels down
+    void guide(MetavoxelVisitor& visitor, QThreadPool* pool = NULL);
    
     /// Inserts a spanner into the specified attribute layer.
     void insert(const AttributePointer& attribute, const SharedObjectPointer& object);
@@ -101,7 +112,11 @@ public:
     /// Clears all data in the specified attribute layer.
     void clear(const AttributePointer& attribute);
 
-    /// Convenience function that finds the first spanner intersecting the provided ray.    
+    /// Appends the spanners in the specified attribute layer whose bounds intersect the given box.
+    void getIntersectingSpanners(const AttributePointer& attribute, const Box& bounds, QVector<SharedObjectPointer>& spanners);
+    
+    /// Convenience function that finds the first spanner intersecting the provided ray.  At full detail (that is, with an
+    /// invalid LOD), this is the spanner nearest the origin.
     SharedObjectPointer findFirstRaySpannerIntersection(const glm::vec3& origin, const glm::vec3& direction,
         const AttributePointer& attribute, float& distance, const MetavoxelLOD& lod = MetavoxelLOD());
 
@@ -135,8 +150,14 @@ private:
     void incrementRootReferenceCounts();
     void decrementRootReferenceCounts();
     
+    /// Returns the bounds tree over the spanners in the layer, building it if the layer has changed since it was last built.
+    const SpannerBoundsTree& getSpannerBoundsTree(const AttributePointer& attribute);
+    
     float _size;
     QHash<AttributePointer, MetavoxelNode*> _roots;
+    
+    /// the trees are shared between copies of the data, and dropped whenever their layers change
+    QHash<AttributePointer, QSharedPointer<SpannerBoundsTree> > _spannerBoundsTrees;
 };
 
 Bitstream& operator<<(Bitstream& out, const MetavoxelData& data);
@@ -175,6 +196,10 @@ public:
     MetavoxelNode(const AttributeValue& attributeValue, const MetavoxelNode* copyChildren = NULL);
     MetavoxelNode(const AttributePointer& attribute, const MetavoxelNode* copy);
     
+    /// nodes are carved out of slabs rather than allocated from the heap one at a time, as edits copy them by the thousand
+    static void* operator new(size_t size);
+    static void operator delete(void* node);
+    
     void setAttributeValue(const AttributeValue& attributeValue);
 
     void blendAttributeValues(const AttributeValue& source, const AttributeValue& dest);
@@ -202,8 +227,8 @@ public:
     void writeSpannerDelta(const MetavoxelNode& reference, MetavoxelStreamState& state) const;
     void writeSpannerSubdivision(MetavoxelStreamState& state) const;
 
-    /// Increments the node's reference count.
-    void incrementReferenceCount() { _referenceCount++; }
+    /// Increments the node's reference count, which is atomic so that copies of data may be made on any thread.
+    void incrementReferenceCount() { _referenceCount.ref(); }
 
     /// Decrements the node's reference count.  If the resulting reference count is zero, destroys the node
     /// and calls delete this.
@@ -226,7 +251,7 @@ private:
     
     friend class MetavoxelVisitation;
     
-    int _referenceCount;
+    QAtomicInt _referenceCount;
     void* _attributeValue;
     MetavoxelNode* _children[CHILD_COUNT];
 };
@@ -295,6 +320,15 @@ public:
     /// \return the encoded order in which to traverse the children, zero to stop recursion, or -1 to short-circuit the tour
     virtual int visit(MetavoxelInfo& info) = 0;
 
+    /// Creates a copy of this visitor to tour an octant on another thread, or returns null (as by default) if the visitor
+    /// can't be toured in parallel.  Only visitors without outputs are forked.  Forks see no parent info above the octant
+    /// they start at, run in no particular order, and short-circuit only their own tours.
+    virtual MetavoxelVisitor* fork() const;
+    
+    /// Merges the results of a fork into this visitor once its tour is done.  Forks are joined in the order in which the
+    /// tour reached their octants.
+    virtual void join(MetavoxelVisitor* fork);
+
 protected:
 
     QVector<AttributePointer> _inputs;
@@ -459,6 +493,7 @@ public:
     QVector<MetavoxelNode*> inputNodes;
     QVector<MetavoxelNode*> outputNodes;
     MetavoxelInfo info;
+    MetavoxelForks* forks; ///< if not null, where to hand off the octants at the fork depth
     
     bool allInputNodesLeaves() const;
     AttributeValue getInheritedOutputValue(int index) const;
@@ -474,8 +509,9 @@ class Spanner : public SharedObject {
     
 public:
     
-    /// Increments the value of the global visit counter.
-    static void incrementVisit() { _visit++; }
+    /// Starts a new traversal on the current thread.  Each thread keeps its own record of the spanners visited, so that
+    /// traversals of the same spanners may run on several threads at once.
+    static void incrementVisit();
     
     Spanner();
     
@@ -506,8 +542,8 @@ public:
     /// \return true to recurse, false to stop
     virtual bool blendAttributeValues(MetavoxelInfo& info, bool force = false) const;
     
-    /// Checks whether we've visited this object on the current traversal.  If we have, returns false.
-    /// If we haven't, sets the last visit identifier and returns true.
+    /// Checks whether we've visited this object on the current thread's traversal.  If we have, returns false.
+    /// If we haven't, records the visit and returns true.
     bool testAndSetVisited();
 
     /// Returns a pointer to the renderer, creating it if necessary.
@@ -536,9 +572,8 @@ private:
     float _placementGranularity;
     float _voxelizationGranularity;
     bool _masked;
-    int _lastVisit; ///< the identifier of the last visit
     
-    static int _visit; ///< the global visit counter
+    static QThreadStorage<QSet<Spanner*> > _visited; ///< the spanners visited on each thread's current traversal
 };
 
 /// Base class for objects that can render spanners.
@@ -64,41 +64,18 @@ int BoxSetEditVisitor::visit(MetavoxelInfo& info) {
     return DEFAULT_ORDER; // subdivide
 }
 
-class GatherUnmaskedSpannersVisitor : public SpannerVisitor {
-public:
-    
-    GatherUnmaskedSpannersVisitor(const Box& bounds);
-
-    const QList<SharedObjectPointer>& getUnmaskedSpanners() const { return _unmaskedSpanners; }
-
-    virtual bool visit(Spanner* spanner, const glm::vec3& clipMinimum, float clipSize);
-
-private:
-    
-    Box _bounds;
-    QList<SharedObjectPointer> _unmaskedSpanners;
-};
-
-GatherUnmaskedSpannersVisitor::GatherUnmaskedSpannersVisitor(const Box& bounds) :
-    SpannerVisitor(QVector<AttributePointer>() << AttributeRegistry::getInstance()->getSpannersAttribute()),
-    _bounds(bounds) {
-}
-
-bool GatherUnmaskedSpannersVisitor::visit(Spanner* spanner, const glm::vec3& clipMinimum, float clipSize) {
-    if (!spanner->isMasked() && spanner->getBounds().intersects(_bounds)) {
-        _unmaskedSpanners.append(spanner);
-    }
-    return true;
-}
-
 static void setIntersectingMasked(const Box& bounds, MetavoxelData& data) {
-    GatherUnmaskedSpannersVisitor visitor(bounds);
-    data.guide(visitor);
+    const AttributePointer& attribute = AttributeRegistry::getInstance()->getSpannersAttribute();
+    QVector<SharedObjectPointer> spanners;
+    data.getIntersectingSpanners(attribute, bounds, spanners);
     
-    foreach (const SharedObjectPointer& object, visitor.getUnmaskedSpanners()) {
+    foreach (const SharedObjectPointer& object, spanners) {
+        if (static_cast<Spanner*>(object.data())->isMasked()) {
+            continue;
+        }
         Spanner* newSpanner = static_cast<Spanner*>(object->clone(true));
         newSpanner->setMasked(true);
-        data.replace(AttributeRegistry::getInstance()->getSpannersAttribute(), object, newSpanner);
+        data.replace(attribute, object, newSpanner);
     }
 }
 
@@ -57,6 +57,11 @@ DECLARE_STREAMABLE_METATYPE(ClientStateMessage)
 /// A message preceding metavoxel delta information.  The actual delta will follow it in the stream.
 class MetavoxelDeltaMessage {
     STREAMABLE
+
+public:
+    
+    /// the LOD of the delta, which may be coarser than the client asked for when the full detail won't fit in a packet
+    STREAM MetavoxelLOD lod;
 };
 
 DECLARE_STREAMABLE_METATYPE(MetavoxelDeltaMessage)
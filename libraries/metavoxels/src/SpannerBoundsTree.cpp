@@ -0,0 +1,145 @@
+//
+//  SpannerBoundsTree.cpp
+//  libraries/metavoxels/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#include <algorithm>
+#include <cfloat>
+
+#include "MetavoxelData.h"
+#include "SpannerBoundsTree.h"
+
+// the median splits keep the tree's depth to the log of the spanners in a leaf
+const int MAX_BOUNDS_TREE_STACK = 64;
+
+class SpannerCenterLessThan {
+public:
+    SpannerCenterLessThan(int axis, const QVector<Box>& bounds) : _axis(axis), _bounds(bounds) { }
+    
+    bool operator()(int first, int second) const {
+        // twice the centers compare the same as the centers
+        return _bounds.at(first).minimum[_axis] + _bounds.at(first).maximum[_axis] <
+            _bounds.at(second).minimum[_axis] + _bounds.at(second).maximum[_axis];
+    }
+
+private:
+    int _axis;
+    const QVector<Box>& _bounds;
+};
+
+SpannerBoundsTree::SpannerBoundsTree(const QVector<SharedObjectPointer>& spanners) :
+    _spanners(spanners) {
+    
+    int count = spanners.size();
+    if (count == 0) {
+        return;
+    }
+    _indices.resize(count);
+    _bounds.resize(count);
+    for (int i = 0; i < count; i++) {
+        _indices[i] = i;
+        _bounds[i] = static_cast<Spanner*>(spanners.at(i).data())->getBounds();
+    }
+    _nodes.reserve(2 * (count / MAX_SPANNERS_PER_BOUNDS_LEAF) + 1);
+    _nodes.resize(1);
+    buildNode(0, 0, count);
+}
+
+void SpannerBoundsTree::findIntersecting(const Box& bounds, QVector<SharedObjectPointer>& spanners) const {
+    if (_nodes.isEmpty()) {
+        return;
+    }
+    int stack[MAX_BOUNDS_TREE_STACK];
+    int stackSize = 0;
+    stack[stackSize++] = 0;
+    while (stackSize > 0) {
+        const Node& node = _nodes.at(stack[--stackSize]);
+        if (!node.bounds.intersects(bounds)) {
+            continue;
+        }
+        if (node.count == 0) {
+            stack[stackSize++] = node.first;
+            stack[stackSize++] = node.first + 1;
+            continue;
+        }
+        for (int i = node.first; i < node.first + node.count; i++) {
+            int index = _indices.at(i);
+            if (_bounds.at(index).intersects(bounds)) {
+                spanners.append(_spanners.at(index));
+            }
+        }
+    }
+}
+
+Spanner* SpannerBoundsTree::findFirstRayIntersection(const glm::vec3& origin,
+        const glm::vec3& direction, float& distance) const {
+    Spanner* closestSpanner = NULL;
+    float closestDistance = FLT_MAX;
+    if (_nodes.isEmpty()) {
+        return NULL;
+    }
+    int stack[MAX_BOUNDS_TREE_STACK];
+    int stackSize = 0;
+    stack[stackSize++] = 0;
+    while (stackSize > 0) {
+        // skip any branch that the ray enters beyond the closest hit so far
+        const Node& node = _nodes.at(stack[--stackSize]);
+        float nodeDistance;
+        if (!node.bounds.findRayIntersection(origin, direction, nodeDistance) || nodeDistance >= closestDistance) {
+            continue;
+        }
+        if (node.count == 0) {
+            stack[stackSize++] = node.first;
+            stack[stackSize++] = node.first + 1;
+            continue;
+        }
+        for (int i = node.first; i < node.first + node.count; i++) {
+            Spanner* spanner = static_cast<Spanner*>(_spanners.at(_indices.at(i)).data());
+            float spannerDistance;
+            if (spanner->findRayIntersection(origin, direction, glm::vec3(), 0.0f, spannerDistance) &&
+                    spannerDistance < closestDistance) {
+                closestSpanner = spanner;
+                closestDistance = spannerDistance;
+            }
+        }
+    }
+    if (closestSpanner) {
+        distance = closestDistance;
+    }
+    return closestSpanner;
+}
+
+void SpannerBoundsTree::buildNode(int nodeIndex, int first, int count) {
+    Box bounds = _bounds.at(_indices.at(first));
+    for (int i = first + 1; i < first + count; i++) {
+        const Box& spannerBounds = _bounds.at(_indices.at(i));
+        bounds.minimum = glm::min(bounds.minimum, spannerBounds.minimum);
+        bounds.maximum = glm::max(bounds.maximum, spannerBounds.maximum);
+    }
+    _nodes[nodeIndex].bounds = bounds;
+    if (count <= MAX_SPANNERS_PER_BOUNDS_LEAF) {
+        _nodes[nodeIndex].first = first;
+        _nodes[nodeIndex].count = count;
+        return;
+    }
+    
+    // split the spanners in half by their centers along the longest side of the box around them
+    glm::vec3 dimensions = bounds.maximum - bounds.minimum;
+    int axis = (dimensions.x >= dimensions.y && dimensions.x >= dimensions.z) ? 0 : (dimensions.y >= dimensions.z ? 1 : 2);
+    int half = count / 2;
+    int* indices = _indices.data();
+    std::nth_element(indices + first, indices + first + half, indices + first + count,
+        SpannerCenterLessThan(axis, _bounds));
+    
+    int children = _nodes.size();
+    _nodes.resize(children + 2);
+    _nodes[nodeIndex].first = children;
+    _nodes[nodeIndex].count = 0;
+    buildNode(children, first, half);
+    buildNode(children + 1, first + half, count - half);
+}
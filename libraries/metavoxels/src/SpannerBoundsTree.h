@@ -0,0 +1,60 @@
+//
+//  SpannerBoundsTree.h
+//  libraries/metavoxels/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#ifndef hifi_SpannerBoundsTree_h
+#define hifi_SpannerBoundsTree_h
+
+#include <QVector>
+
+#include <glm/glm.hpp>
+
+#include "MetavoxelUtil.h"
+#include "SharedObject.h"
+
+class Spanner;
+
+/// the most spanners a leaf of a bounds tree holds
+const int MAX_SPANNERS_PER_BOUNDS_LEAF = 4;
+
+/// A bounding volume hierarchy over the bounds of a layer's spanners, split at the median along the longest axis, so that
+/// box and ray queries test only the spanners in the branches they touch rather than touring the octree.  The tree is
+/// immutable once built; MetavoxelData builds a new one on the first query after the layer changes.
+class SpannerBoundsTree {
+public:
+    
+    SpannerBoundsTree(const QVector<SharedObjectPointer>& spanners);
+    
+    bool isEmpty() const { return _nodes.isEmpty(); }
+    
+    /// Appends the spanners whose bounds intersect the given box.
+    void findIntersecting(const Box& bounds, QVector<SharedObjectPointer>& spanners) const;
+    
+    /// Finds the spanner nearest the ray origin that the ray hits.
+    /// \return the spanner, or NULL if the ray hits none
+    Spanner* findFirstRayIntersection(const glm::vec3& origin, const glm::vec3& direction, float& distance) const;
+
+private:
+    
+    class Node {
+    public:
+        Box bounds;
+        int first; ///< the first of a leaf's indices, or the first of the two children, which are next to each other
+        int count; ///< the indices in a leaf, 0 for a node with children
+    };
+    
+    void buildNode(int nodeIndex, int first, int count);
+    
+    QVector<Node> _nodes;
+    QVector<int> _indices; ///< the spanners' indices, ordered so that each leaf's are together
+    QVector<SharedObjectPointer> _spanners;
+    QVector<Box> _bounds; ///< by spanner index
+};
+
+#endif // hifi_SpannerBoundsTree_h
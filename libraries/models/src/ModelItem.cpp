@@ -95,6 +95,7 @@ ModelItem::ModelItem(const ModelItemID& modelItemID, const ModelItemProperties&
 
     _jointMappingCompleted = false;
     _lastAnimated = now;
+    _lastStored = 0;
     
     setProperties(properties);
 }
@@ -129,9 +130,26 @@ void ModelItem::init(glm::vec3 position, float radius, rgbColor color, uint32_t
     _glowLevel = 0.0f;
     _jointMappingCompleted = false;
     _lastAnimated = now;
+    _lastStored = 0;
 }
 
-bool ModelItem::appendModelData(OctreePacketData* packetData) const {
+ModelItemPropertyFlags ModelItem::getAllProperties() {
+    ModelItemPropertyFlags properties;
+    for (int i = 0; i <= MODEL_PROP_LAST_ITEM; i++) {
+        properties += (ModelItemProperty)i;
+    }
+    return properties;
+}
+
+ModelItemPropertyFlags ModelItem::getPropertiesChangedSince(quint64 time) const {
+    if (_lastStored > time || _lastEdited > time) {
+        return getAllProperties();
+    }
+    // otherwise nothing has changed, since a playing animation is worked out from its clock
+    return ModelItemPropertyFlags();
+}
+
+bool ModelItem::appendModelData(OctreePacketData* packetData, ModelItemPropertyFlags properties) const {
 
     bool success = packetData->appendValue(getID());
 
@@ -144,20 +162,31 @@ bool ModelItem::appendModelData(OctreePacketData* packetData) const {
         success = packetData->appendValue(getLastEdited());
     }
     if (success) {
+        QByteArray encodedProperties = properties.encode();
+        success = packetData->appendRawData((const unsigned char*)encodedProperties.constData(),
+                                            encodedProperties.size());
+    }
+    if (success && properties.getHasProperty(MODEL_PROP_ANIMATION_FRAME_INDEX)) {
+        success = packetData->appendValue(_animationFrameIndex);
+        if (success) {
+            success = packetData->appendValue(_lastAnimated);
+        }
+    }
+    if (success && properties.getHasProperty(MODEL_PROP_RADIUS)) {
         success = packetData->appendValue(getRadius());
     }
-    if (success) {
+    if (success && properties.getHasProperty(MODEL_PROP_POSITION)) {
         success = packetData->appendPosition(getPosition());
     }
-    if (success) {
+    if (success && properties.getHasProperty(MODEL_PROP_COLOR)) {
         success = packetData->appendColor(getColor());
     }
-    if (success) {
+    if (success && properties.getHasProperty(MODEL_PROP_SHOULD_DIE)) {
         success = packetData->appendValue(getShouldDie());
     }
 
     // modelURL
-    if (success) {
+    if (success && properties.getHasProperty(MODEL_PROP_MODEL_URL)) {
         uint16_t modelURLLength = _modelURL.size() + 1; // include NULL
         success = packetData->appendValue(modelURLLength);
         if (success) {
@@ -166,12 +195,12 @@ bool ModelItem::appendModelData(OctreePacketData* packetData) const {
     }
 
     // modelRotation
-    if (success) {
+    if (success && properties.getHasProperty(MODEL_PROP_MODEL_ROTATION)) {
         success = packetData->appendValue(getModelRotation());
     }
 
     // animationURL
-    if (success) {
+    if (success && properties.getHasProperty(MODEL_PROP_ANIMATION_URL)) {
         uint16_t animationURLLength = _animationURL.size() + 1; // include NULL
         success = packetData->appendValue(animationURLLength);
         if (success) {
@@ -180,17 +209,12 @@ bool ModelItem::appendModelData(OctreePacketData* packetData) const {
     }
 
     // animationIsPlaying
-    if (success) {
+    if (success && properties.getHasProperty(MODEL_PROP_ANIMATION_PLAYING)) {
         success = packetData->appendValue(getAnimationIsPlaying());
     }
 
-    // animationFrameIndex
-    if (success) {
-        success = packetData->appendValue(getAnimationFrameIndex());
-    }
-
     // animationFPS
-    if (success) {
+    if (success && properties.getHasProperty(MODEL_PROP_ANIMATION_FPS)) {
         success = packetData->appendValue(getAnimationFPS());
     }
 
@@ -209,7 +233,120 @@ int ModelItem::expectedBytes() {
     return expectedBytes;
 }
 
-int ModelItem::readModelDataFromBuffer(const unsigned char* data, int bytesLeftToRead, ReadBitstreamToTreeParams& args) {
+int ModelItem::expectedBytes(PacketVersion version) {
+    if (version < VERSION_MODELS_HAVE_PROPERTY_FLAGS) {
+        return expectedBytes();
+    }
+    return sizeof(uint32_t) // id
+        + sizeof(quint64) // last updated
+        + sizeof(quint64) // last edited
+        + 1; // property flags
+}
+
+/// copies a value from the buffer and moves past it, returns false if it runs past the end
+template<typename T> static bool readValue(const unsigned char*& dataAt, const unsigned char* end, T& value) {
+    if (end - dataAt < (int)sizeof(value)) {
+        return false;
+    }
+    memcpy(&value, dataAt, sizeof(value));
+    dataAt += sizeof(value);
+    return true;
+}
+
+/// reads a string written with its length, including the NULL, before it
+static bool readString(const unsigned char*& dataAt, const unsigned char* end, QString& value) {
+    uint16_t length;
+    if (!readValue(dataAt, end, length) || length == 0 || end - dataAt < length) {
+        return false;
+    }
+    value = QString::fromUtf8((const char*)dataAt, length - 1);
+    dataAt += length;
+    return true;
+}
+
+int ModelItem::readFlaggedModelDataFromBuffer(const unsigned char* data, int bytesLeftToRead,
+                                              ReadBitstreamToTreeParams& args, ModelItemPropertyFlags* propertiesRead) {
+    int clockSkew = args.sourceNode ? args.sourceNode->getClockSkewUsec() : 0;
+    const unsigned char* dataAt = data;
+    const unsigned char* end = data + bytesLeftToRead;
+    if (!(readValue(dataAt, end, _id) && readValue(dataAt, end, _lastUpdated) && readValue(dataAt, end, _lastEdited))) {
+        return 0;
+    }
+    _lastUpdated -= clockSkew;
+    _lastEdited -= clockSkew;
+
+    ModelItemPropertyFlags properties;
+    int bytes = properties.decode(dataAt, end - dataAt);
+    if (bytes == 0) {
+        return 0;
+    }
+    dataAt += bytes;
+
+    bool success = true;
+    if (properties.getHasProperty(MODEL_PROP_ANIMATION_FRAME_INDEX)) {
+        success = readValue(dataAt, end, _animationFrameIndex);
+        if (success) {
+            if (args.bitstreamVersion >= VERSION_MODELS_HAVE_ANIMATION_CLOCK) {
+                success = readValue(dataAt, end, _lastAnimated);
+                _lastAnimated -= clockSkew;
+            } else {
+                _lastAnimated = usecTimestampNow();
+            }
+        }
+    }
+    if (success && properties.getHasProperty(MODEL_PROP_RADIUS)) {
+        success = readValue(dataAt, end, _radius);
+    }
+    if (success && properties.getHasProperty(MODEL_PROP_POSITION)) {
+        success = readValue(dataAt, end, _position);
+    }
+    if (success && properties.getHasProperty(MODEL_PROP_COLOR)) {
+        success = readValue(dataAt, end, _color);
+    }
+    if (success && properties.getHasProperty(MODEL_PROP_SHOULD_DIE)) {
+        success = readValue(dataAt, end, _shouldDie);
+    }
+    if (success && properties.getHasProperty(MODEL_PROP_MODEL_URL)) {
+        QString modelURL;
+        success = readString(dataAt, end, modelURL);
+        setModelURL(modelURL);
+    }
+    if (success && properties.getHasProperty(MODEL_PROP_MODEL_ROTATION)) {
+        uint16_t packedRotation[4];
+        success = readValue(dataAt, end, packedRotation);
+        if (success) {
+            unpackOrientationQuatFromBytes((const unsigned char*)packedRotation, _modelRotation);
+        }
+    }
+    if (success && properties.getHasProperty(MODEL_PROP_ANIMATION_URL)) {
+        QString animationURL;
+        success = readString(dataAt, end, animationURL);
+        setAnimationURL(animationURL);
+    }
+    if (success && properties.getHasProperty(MODEL_PROP_ANIMATION_PLAYING)) {
+        success = readValue(dataAt, end, _animationIsPlaying);
+    }
+    if (success && properties.getHasProperty(MODEL_PROP_ANIMATION_FPS)) {
+        success = readValue(dataAt, end, _animationFPS);
+    }
+    if (!success) {
+        return 0;
+    }
+    if (propertiesRead) {
+        *propertiesRead = properties;
+    }
+    return dataAt - data;
+}
+
+int ModelItem::readModelDataFromBuffer(const unsigned char* data, int bytesLeftToRead, ReadBitstreamToTreeParams& args,
+                                       ModelItemPropertyFlags* propertiesRead) {
+    if (args.bitstreamVersion >= VERSION_MODELS_HAVE_PROPERTY_FLAGS) {
+        return readFlaggedModelDataFromBuffer(data, bytesLeftToRead, args, propertiesRead);
+    }
+    if (propertiesRead) {
+        *propertiesRead = getAllProperties();
+    }
+
 
     int bytesRead = 0;
     if (bytesLeftToRead >= expectedBytes()) {
@@ -289,6 +426,7 @@ int ModelItem::readModelDataFromBuffer(const unsigned char* data, int bytesLeftT
             memcpy(&_animationFrameIndex, dataAt, sizeof(_animationFrameIndex));
             dataAt += sizeof(_animationFrameIndex);
             bytesRead += sizeof(_animationFrameIndex);
+            _lastAnimated = usecTimestampNow();
 
             // animationFPS
             memcpy(&_animationFPS, dataAt, sizeof(_animationFPS));
@@ -428,6 +566,9 @@ ModelItem ModelItem::fromEditPacket(const unsigned char* data, int length, int&
         processedBytes += animationURLLength;
     }
 
+    // the animation is played from now, so that changing how it plays doesn't make it jump
+    newModelItem.rebaseAnimation();
+
     // animationIsPlaying
     if (isNewModelItem || ((packetContainsBits & 
                     MODEL_PACKET_CONTAINS_ANIMATION_PLAYING) == MODEL_PACKET_CONTAINS_ANIMATION_PLAYING)) {
@@ -731,12 +872,14 @@ QVector<glm::quat> ModelItem::getAnimationFrame() {
     QVector<glm::quat> frameData;
     if (hasAnimation() && _jointMappingCompleted) {
         Animation* myAnimation = getAnimation(_animationURL);
-        QVector<FBXAnimationFrame> frames = myAnimation->getFrames();
-        int frameCount = frames.size();
+        int frameCount = myAnimation->getFrameCount();
 
         if (frameCount > 0) {
-            int animationFrameIndex = (int)glm::floor(_animationFrameIndex) % frameCount;
-            QVector<glm::quat> rotations = frames[animationFrameIndex].rotations;
+            int animationFrameIndex = (int)fmod(glm::floor(getAnimationFrameAt(usecTimestampNow())), (double)frameCount);
+            if (animationFrameIndex < 0) {
+                animationFrameIndex += frameCount;
+            }
+            QVector<glm::quat> rotations = myAnimation->getFrame(animationFrameIndex).rotations;
             frameData.resize(_jointMapping.size());
             for (int j = 0; j < _jointMapping.size(); j++) {
                 int rotationIndex = _jointMapping[j];
@@ -749,34 +892,22 @@ QVector<glm::quat> ModelItem::getAnimationFrame() {
     return frameData;
 }
 
-void ModelItem::update(const quint64& updateTime) {
-    _lastUpdated = updateTime;
-    setShouldDie(getShouldDie());
+double ModelItem::getAnimationFrameAt(quint64 time) const {
+    if (!_animationIsPlaying || time <= _lastAnimated) {
+        return _animationFrameIndex;
+    }
+    return _animationFrameIndex + (double)(time - _lastAnimated) / USECS_PER_SECOND * _animationFPS;
+}
 
+void ModelItem::rebaseAnimation() {
     quint64 now = usecTimestampNow();
+    _animationFrameIndex = (float)getAnimationFrameAt(now);
+    _lastAnimated = now;
+}
 
-    // only advance the frame index if we're playing
-    if (getAnimationIsPlaying()) {
-
-        float deltaTime = (float)(now - _lastAnimated) / (float)USECS_PER_SECOND;
-        
-        const bool wantDebugging = false;
-        if (wantDebugging) {
-            qDebug() << "ModelItem::update() now=" << now;
-            qDebug() << "             updateTime=" << updateTime;
-            qDebug() << "          _lastAnimated=" << _lastAnimated;
-            qDebug() << "              deltaTime=" << deltaTime;
-        }
-        _lastAnimated = now;
-        _animationFrameIndex += deltaTime * _animationFPS;
-
-        if (wantDebugging) {
-            qDebug() << "   _animationFrameIndex=" << _animationFrameIndex;
-        }
-
-    } else {
-        _lastAnimated = now;
-    }
+void ModelItem::update(const quint64& updateTime) {
+    _lastUpdated = updateTime;
+    setShouldDie(getShouldDie());
 }
 
 void ModelItem::copyChangedProperties(const ModelItem& other) {
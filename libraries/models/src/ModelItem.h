@@ -24,6 +24,7 @@
 #include <SharedUtil.h>
 #include <OctreePacketData.h>
 #include <FBXReader.h>
+#include <PropertyFlags.h>
 
 
 class ModelItem;
@@ -60,6 +61,26 @@ const float MODEL_DEFAULT_ANIMATION_FPS = 30.0f;
 
 const PacketVersion VERSION_MODELS_HAVE_ANIMATION = 1;
 const PacketVersion VERSION_ROOT_ELEMENT_HAS_DATA = 2;
+const PacketVersion VERSION_MODELS_HAVE_PROPERTY_FLAGS = 4;
+const PacketVersion VERSION_MODELS_HAVE_ANIMATION_CLOCK = 5;
+
+/// The properties of a model in data packets, which carry the flags of the ones they hold. The frame index is sent with
+/// the time it was the frame, so that a playing model needn't be sent again as its animation advances.
+enum ModelItemProperty {
+    MODEL_PROP_ANIMATION_FRAME_INDEX,
+    MODEL_PROP_RADIUS,
+    MODEL_PROP_POSITION,
+    MODEL_PROP_COLOR,
+    MODEL_PROP_SHOULD_DIE,
+    MODEL_PROP_MODEL_URL,
+    MODEL_PROP_MODEL_ROTATION,
+    MODEL_PROP_ANIMATION_URL,
+    MODEL_PROP_ANIMATION_PLAYING,
+    MODEL_PROP_ANIMATION_FPS,
+    MODEL_PROP_LAST_ITEM = MODEL_PROP_ANIMATION_FPS
+};
+
+typedef PropertyFlags<ModelItemProperty> ModelItemPropertyFlags;
 
 /// A collection of properties of a model item used in the scripting API. Translates between the actual properties of a model
 /// and a JavaScript style hash/QScriptValue storing a set of properties. Used in scripting to set/get the complete set of
@@ -146,6 +167,7 @@ private:
     bool _defaultSettings;
 };
 Q_DECLARE_METATYPE(ModelItemProperties);
+Q_DECLARE_METATYPE(QVector<ModelItemProperties>);
 QScriptValue ModelItemPropertiesToScriptValue(QScriptEngine* engine, const ModelItemProperties& properties);
 void ModelItemPropertiesFromScriptValue(const QScriptValue &object, ModelItemProperties& properties);
 
@@ -255,18 +277,37 @@ public:
     void setModelURL(const QString& url) { _modelURL = url; }
     void setModelRotation(const glm::quat& rotation) { _modelRotation = rotation; }
     void setAnimationURL(const QString& url) { _animationURL = url; }
-    void setAnimationFrameIndex(float value) { _animationFrameIndex = value; }
-    void setAnimationIsPlaying(bool value) { _animationIsPlaying = value; }
-    void setAnimationFPS(float value) { _animationFPS = value; }
+    void setAnimationFrameIndex(float value) { _animationFrameIndex = value; _lastAnimated = usecTimestampNow(); }
+    void setAnimationIsPlaying(bool value) { rebaseAnimation(); _animationIsPlaying = value; }
+    void setAnimationFPS(float value) { rebaseAnimation(); _animationFPS = value; }
     void setGlowLevel(float glowLevel) { _glowLevel = glowLevel; }
     void setSittingPoints(QVector<SittingPoint> sittingPoints) { _sittingPoints = sittingPoints; }
     
     void setProperties(const ModelItemProperties& properties);
 
-    bool appendModelData(OctreePacketData* packetData) const;
-    int readModelDataFromBuffer(const unsigned char* data, int bytesLeftToRead, ReadBitstreamToTreeParams& args);
+    /// when this host last stored the model in an element or edited it there, in its own clock
+    quint64 getLastStored() const { return _lastStored; }
+    void setLastStored(quint64 lastStored) { _lastStored = lastStored; }
+
+    static ModelItemPropertyFlags getAllProperties();
+
+    /// the properties that may have changed since a time, all of them if the model has been stored or edited since
+    ModelItemPropertyFlags getPropertiesChangedSince(quint64 time) const;
+
+    bool appendModelData(OctreePacketData* packetData) const { return appendModelData(packetData, getAllProperties()); }
+
+    /// appends the model's ID and times, then the flags of the properties given and the properties themselves
+    bool appendModelData(OctreePacketData* packetData, ModelItemPropertyFlags properties) const;
+
+    /// reads a model, leaving the properties the data doesn't hold as they are, which properties it held are returned
+    /// in propertiesRead if it's given
+    int readModelDataFromBuffer(const unsigned char* data, int bytesLeftToRead, ReadBitstreamToTreeParams& args,
+                                ModelItemPropertyFlags* propertiesRead = NULL);
     static int expectedBytes();
 
+    /// the fewest bytes a model takes in data of a version
+    static int expectedBytes(PacketVersion version);
+
     static bool encodeModelEditMessageDetails(PacketType command, ModelItemID id, const ModelItemProperties& details,
                         unsigned char* bufferOut, int sizeIn, int& sizeOut);
 
@@ -289,12 +330,24 @@ public:
     bool jointsMapped() const { return _jointMappingCompleted; }
     
     bool getAnimationIsPlaying() const { return _animationIsPlaying; }
-    float getAnimationFrameIndex() const { return _animationFrameIndex; }
+
+    /// the frame the animation is at now, which a playing model works out from the frame it was at when it was last
+    /// set, so that every host agrees on it without the frame being sent as it advances
+    float getAnimationFrameIndex() const { return (float)getAnimationFrameAt(usecTimestampNow()); }
     float getAnimationFPS() const { return _animationFPS; }
     
     static void cleanupLoadedAnimations();
 
 protected:
+    /// the frame the animation is at at a time, in doubles since a long-playing animation counts up many frames
+    double getAnimationFrameAt(quint64 time) const;
+
+    /// takes the frame the animation is at now as the one it's played from, before the way it plays changes
+    void rebaseAnimation();
+
+    int readFlaggedModelDataFromBuffer(const unsigned char* data, int bytesLeftToRead, ReadBitstreamToTreeParams& args,
+                                       ModelItemPropertyFlags* propertiesRead);
+
     glm::vec3 _position;
     rgbColor _color;
     float _radius;
@@ -315,10 +368,11 @@ protected:
 
     quint64 _lastUpdated;
     quint64 _lastEdited;
-    quint64 _lastAnimated;
+    quint64 _lastAnimated; // when the animation was at _animationFrameIndex
+    quint64 _lastStored;
 
     QString _animationURL;
-    float _animationFrameIndex; // we keep this as a float and round to int only when we need the exact index
+    float _animationFrameIndex; // the frame at _lastAnimated, we round to int only when we need the exact index
     bool _animationIsPlaying;
     float _animationFPS;
     
@@ -0,0 +1,173 @@
+//
+//  ModelItemBoundsTree.cpp
+//  libraries/models/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#include <algorithm>
+#include <cfloat>
+
+#include "ModelItemBoundsTree.h"
+
+// the median splits keep the tree's depth to the log of the models in a leaf, which an element's 16 bit count bounds
+const int MAX_BOUNDS_TREE_STACK = 64;
+
+class CenterLessThan {
+public:
+    CenterLessThan(int axis, const QVector<glm::vec3>& minimums, const QVector<glm::vec3>& maximums) :
+        _axis(axis), _minimums(minimums), _maximums(maximums) { }
+
+    bool operator()(int first, int second) const {
+        // twice the centers compare the same as the centers
+        return _minimums.at(first)[_axis] + _maximums.at(first)[_axis] <
+            _minimums.at(second)[_axis] + _maximums.at(second)[_axis];
+    }
+
+private:
+    int _axis;
+    const QVector<glm::vec3>& _minimums;
+    const QVector<glm::vec3>& _maximums;
+};
+
+static bool boxesTouch(const glm::vec3& firstMinimum, const glm::vec3& firstMaximum,
+                       const glm::vec3& secondMinimum, const glm::vec3& secondMaximum) {
+    return firstMinimum.x <= secondMaximum.x && firstMaximum.x >= secondMinimum.x &&
+        firstMinimum.y <= secondMaximum.y && firstMaximum.y >= secondMinimum.y &&
+        firstMinimum.z <= secondMaximum.z && firstMaximum.z >= secondMinimum.z;
+}
+
+static bool rayHitsBox(const glm::vec3& origin, const glm::vec3& direction,
+                       const glm::vec3& minimum, const glm::vec3& maximum) {
+    float nearest = 0.0f;
+    float farthest = FLT_MAX;
+    for (int axis = 0; axis < 3; axis++) {
+        if (direction[axis] == 0.0f) {
+            if (origin[axis] < minimum[axis] || origin[axis] > maximum[axis]) {
+                return false;
+            }
+            continue;
+        }
+        float toMinimum = (minimum[axis] - origin[axis]) / direction[axis];
+        float toMaximum = (maximum[axis] - origin[axis]) / direction[axis];
+        nearest = glm::max(nearest, glm::min(toMinimum, toMaximum));
+        farthest = glm::min(farthest, glm::max(toMinimum, toMaximum));
+        if (nearest > farthest) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void ModelItemBoundsTree::build(const QList<ModelItem>& models) {
+    clear();
+    int count = models.size();
+    if (count == 0) {
+        return;
+    }
+    _indices.resize(count);
+    _minimums.resize(count);
+    _maximums.resize(count);
+    for (int i = 0; i < count; i++) {
+        _indices[i] = i;
+        _minimums[i] = models.at(i).getMinimumPoint();
+        _maximums[i] = models.at(i).getMaximumPoint();
+    }
+    _nodes.reserve(2 * (count / MAX_MODELS_PER_BOUNDS_LEAF) + 1);
+    _nodes.resize(1);
+    buildNode(0, 0, count);
+}
+
+void ModelItemBoundsTree::clear() {
+    _nodes.clear();
+    _indices.clear();
+    _minimums.clear();
+    _maximums.clear();
+}
+
+void ModelItemBoundsTree::buildNode(int nodeIndex, int first, int count) {
+    glm::vec3 minimum = _minimums.at(_indices.at(first));
+    glm::vec3 maximum = _maximums.at(_indices.at(first));
+    for (int i = first + 1; i < first + count; i++) {
+        minimum = glm::min(minimum, _minimums.at(_indices.at(i)));
+        maximum = glm::max(maximum, _maximums.at(_indices.at(i)));
+    }
+    _nodes[nodeIndex].minimum = minimum;
+    _nodes[nodeIndex].maximum = maximum;
+    if (count <= MAX_MODELS_PER_BOUNDS_LEAF) {
+        _nodes[nodeIndex].first = first;
+        _nodes[nodeIndex].count = count;
+        return;
+    }
+
+    // split the models in half by their centers along the longest side of the box around them
+    glm::vec3 dimensions = maximum - minimum;
+    int axis = (dimensions.x >= dimensions.y && dimensions.x >= dimensions.z) ? 0 : (dimensions.y >= dimensions.z ? 1 : 2);
+    int half = count / 2;
+    int* indices = _indices.data();
+    std::nth_element(indices + first, indices + first + half, indices + first + count,
+                     CenterLessThan(axis, _minimums, _maximums));
+
+    int children = _nodes.size();
+    _nodes.resize(children + 2);
+    _nodes[nodeIndex].first = children;
+    _nodes[nodeIndex].count = 0;
+    buildNode(children, first, half);
+    buildNode(children + 1, first + half, count - half);
+}
+
+void ModelItemBoundsTree::findTouching(const glm::vec3& minimum, const glm::vec3& maximum, QVector<int>& indices) const {
+    if (_nodes.isEmpty()) {
+        return;
+    }
+    int stack[MAX_BOUNDS_TREE_STACK];
+    int stackSize = 0;
+    stack[stackSize++] = 0;
+    while (stackSize > 0) {
+        const Node& node = _nodes.at(stack[--stackSize]);
+        if (!boxesTouch(node.minimum, node.maximum, minimum, maximum)) {
+            continue;
+        }
+        if (node.count == 0) {
+            stack[stackSize++] = node.first;
+            stack[stackSize++] = node.first + 1;
+            continue;
+        }
+        for (int i = node.first; i < node.first + node.count; i++) {
+            int index = _indices.at(i);
+            if (boxesTouch(_minimums.at(index), _maximums.at(index), minimum, maximum)) {
+                indices.append(index);
+            }
+        }
+    }
+}
+
+void ModelItemBoundsTree::findRayIntersections(const glm::vec3& origin, const glm::vec3& direction,
+                                               QVector<int>& indices) const {
+    if (_nodes.isEmpty()) {
+        return;
+    }
+    int stack[MAX_BOUNDS_TREE_STACK];
+    int stackSize = 0;
+    stack[stackSize++] = 0;
+    while (stackSize > 0) {
+        const Node& node = _nodes.at(stack[--stackSize]);
+        if (!rayHitsBox(origin, direction, node.minimum, node.maximum)) {
+            continue;
+        }
+        if (node.count == 0) {
+            stack[stackSize++] = node.first;
+            stack[stackSize++] = node.first + 1;
+            continue;
+        }
+        for (int i = node.first; i < node.first + node.count; i++) {
+            int index = _indices.at(i);
+            if (rayHitsBox(origin, direction, _minimums.at(index), _maximums.at(index))) {
+                indices.append(index);
+            }
+        }
+    }
+}
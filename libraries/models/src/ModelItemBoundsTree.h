@@ -0,0 +1,57 @@
+//
+//  ModelItemBoundsTree.h
+//  libraries/models/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#ifndef hifi_ModelItemBoundsTree_h
+#define hifi_ModelItemBoundsTree_h
+
+#include <QList>
+#include <QVector>
+
+#include <glm/glm.hpp>
+
+#include "ModelItem.h"
+
+/// the most models a leaf of a bounds tree holds
+const int MAX_MODELS_PER_BOUNDS_LEAF = 4;
+
+/// A bounding volume hierarchy over the bounding cubes of a list of models, split at the median along the longest axis,
+/// so that a query of many models only tests those in the branches it touches. The models are referred to by their
+/// indices in the list, so the tree has to be built again whenever the list or the bounds of its models change.
+class ModelItemBoundsTree {
+public:
+    void build(const QList<ModelItem>& models);
+    void clear();
+
+    bool isEmpty() const { return _nodes.isEmpty(); }
+
+    /// appends the indices of the models whose bounding cubes touch the box from minimum to maximum
+    void findTouching(const glm::vec3& minimum, const glm::vec3& maximum, QVector<int>& indices) const;
+
+    /// appends the indices of the models whose bounding cubes the ray hits, in no particular order
+    void findRayIntersections(const glm::vec3& origin, const glm::vec3& direction, QVector<int>& indices) const;
+
+private:
+    class Node {
+    public:
+        glm::vec3 minimum;
+        glm::vec3 maximum;
+        int first; /// the first of a leaf's indices, or the first of the two children, which are next to each other
+        int count; /// the indices in a leaf, 0 for a node with children
+    };
+
+    void buildNode(int nodeIndex, int first, int count);
+
+    QVector<Node> _nodes;
+    QVector<int> _indices; /// the models' indices, ordered so that each leaf's are together
+    QVector<glm::vec3> _minimums; /// by model index
+    QVector<glm::vec3> _maximums;
+};
+
+#endif // hifi_ModelItemBoundsTree_h
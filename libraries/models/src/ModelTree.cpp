@@ -15,6 +15,12 @@ ModelTree::ModelTree(bool shouldReaverage) : Octree(shouldReaverage) {
     _rootElement = createNewElement();
 }
 
+ModelTree::~ModelTree() {
+    // the elements take their models out of the map as they're deleted, so they have to go before the map does
+    delete _rootElement;
+    _rootElement = NULL;
+}
+
 ModelTreeElement* ModelTree::createNewElement(unsigned char * octalCode) {
     ModelTreeElement* newElement = new ModelTreeElement(octalCode);
     newElement->setTree(this);
@@ -373,49 +379,32 @@ void ModelTree::findModelsForUpdate(const AACube& cube, QVector<ModelItem*> foun
     foundModels.swap(args._foundModels);
 }
 
-class FindByIDArgs {
-public:
-    uint32_t id;
-    bool found;
-    const ModelItem* foundModel;
-};
-
-
-bool ModelTree::findByIDOperation(OctreeElement* element, void* extraData) {
-//qDebug() << "ModelTree::findByIDOperation()....";
-
-    FindByIDArgs* args = static_cast<FindByIDArgs*>(extraData);
-    ModelTreeElement* modelTreeElement = static_cast<ModelTreeElement*>(element);
-
-    // if already found, stop looking
-    if (args->found) {
-        return false;
-    }
-
-    // as the tree element if it has this model
-    const ModelItem* foundModel = modelTreeElement->getModelWithID(args->id);
-    if (foundModel) {
-        args->foundModel = foundModel;
-        args->found = true;
-        return false;
-    }
-
-    // keep looking
-    return true;
-}
-
-
 const ModelItem* ModelTree::findModelByID(uint32_t id, bool alreadyLocked) {
-    FindByIDArgs args = { id, false, NULL };
-
     if (!alreadyLocked) {
         lockForRead();
     }
-    recurseTreeWithOperation(findByIDOperation, &args);
+    const ModelItem* foundModel = NULL;
+    ModelTreeElement* element = _modelToElementMap.value(id);
+    if (element) {
+        foundModel = element->getModelWithID(id);
+    }
     if (!alreadyLocked) {
         unlock();
     }
-    return args.foundModel;
+    return foundModel;
+}
+
+void ModelTree::setContainingElement(uint32_t modelID, ModelTreeElement* element) {
+    if (modelID != UNKNOWN_MODEL_ID) {
+        _modelToElementMap.insert(modelID, element);
+    }
+}
+
+void ModelTree::resetContainingElement(uint32_t modelID, ModelTreeElement* element) {
+    QHash<uint32_t, ModelTreeElement*>::iterator containingElement = _modelToElementMap.find(modelID);
+    if (containingElement != _modelToElementMap.end() && containingElement.value() == element) {
+        _modelToElementMap.erase(containingElement);
+    }
 }
 
 
@@ -498,12 +487,33 @@ void ModelTree::update() {
     _isDirty = true;
 
     ModelTreeUpdateArgs args;
-    recurseTreeWithOperation(updateOperation, &args);
+    if (_updateThreads.maxThreadCount() > 1) {
+        // the subtrees under the root's children are updated at once, each taking its moving models out to its own args
+        getRoot()->update(args);
+        ModelTreeUpdateArgs subtreeArgs[NUMBER_OF_CHILDREN];
+        void* extraData[NUMBER_OF_CHILDREN];
+        for (int i = 0; i < NUMBER_OF_CHILDREN; i++) {
+            extraData[i] = &subtreeArgs[i];
+        }
+        recurseRootChildrenConcurrently(updateOperation, extraData, &_updateThreads);
+
+        for (int i = 0; i < NUMBER_OF_CHILDREN; i++) {
+            args._movingModels.append(subtreeArgs[i]._movingModels);
+            args._movedFromElements.append(subtreeArgs[i]._movedFromElements);
+            args._totalElements += subtreeArgs[i]._totalElements;
+            args._totalItems += subtreeArgs[i]._totalItems;
+            args._movingItems += subtreeArgs[i]._movingItems;
+        }
+    } else {
+        OctreeOperationVisitor<updateOperation> visitor(&args);
+        visitTree<ModelTreeElement>(visitor);
+    }
 
     // now add back any of the particles that moved elements....
     int movingModels = args._movingModels.size();
     
     for (int i = 0; i < movingModels; i++) {
+        resetContainingElement(args._movingModels[i].getID(), args._movedFromElements[i]);
         bool shouldDie = args._movingModels[i].getShouldDie();
 
         // if the particle is still inside our total bounds, then re-add it
@@ -513,43 +523,24 @@ void ModelTree::update() {
             storeModel(args._movingModels[i]);
         } else {
             uint32_t modelItemID = args._movingModels[i].getID();
-            quint64 deletedAt = usecTimestampNow();
-            _recentlyDeletedModelsLock.lockForWrite();
-            _recentlyDeletedModelItemIDs.insert(deletedAt, modelItemID);
-            _recentlyDeletedModelsLock.unlock();
+            _deletedModelItemIDs.append(modelItemID);
         }
     }
 
     // prune the tree...
-    recurseTreeWithOperation(pruneOperation, NULL);
+    OctreeOperationVisitor<pruneOperation> pruneVisitor;
+    visitTree<ModelTreeElement>(pruneVisitor);
     unlock();
 }
 
 
-bool ModelTree::hasModelsDeletedSince(quint64 sinceTime) {
-    // we can probably leverage the ordered nature of QMultiMap to do this quickly...
-    bool hasSomethingNewer = false;
-
-    _recentlyDeletedModelsLock.lockForRead();
-    QMultiMap<quint64, uint32_t>::const_iterator iterator = _recentlyDeletedModelItemIDs.constBegin();
-    while (iterator != _recentlyDeletedModelItemIDs.constEnd()) {
-        //qDebug() << "considering... time/key:" << iterator.key();
-        if (iterator.key() > sinceTime) {
-            //qDebug() << "YES newer... time/key:" << iterator.key();
-            hasSomethingNewer = true;
-        }
-        ++iterator;
-    }
-    _recentlyDeletedModelsLock.unlock();
-    return hasSomethingNewer;
+bool ModelTree::hasModelsDeletedSince(quint64 cursor) {
+    return _deletedModelItemIDs.hasDeletedSince(cursor);
 }
 
-// sinceTime is an in/out parameter - it will be side effected with the last time sent out
-bool ModelTree::encodeModelsDeletedSince(OCTREE_PACKET_SEQUENCE sequenceNumber, quint64& sinceTime, unsigned char* outputBuffer,
-                                            size_t maxLength, size_t& outputLength) {
-
-    bool hasMoreToSend = true;
-
+// cursor is an in/out parameter - it will be moved past the last model ID sent out
+bool ModelTree::encodeModelsDeletedSince(OCTREE_PACKET_SEQUENCE sequenceNumber, quint64& cursor,
+                                         unsigned char* outputBuffer, size_t maxLength, size_t& outputLength) {
     unsigned char* copyAt = outputBuffer;
     size_t numBytesPacketHeader = populatePacketHeader(reinterpret_cast<char*>(outputBuffer), PacketTypeModelErase);
     copyAt += numBytesPacketHeader;
@@ -575,80 +566,18 @@ bool ModelTree::encodeModelsDeletedSince(OCTREE_PACKET_SEQUENCE sequenceNumber,
     copyAt += sizeof(OCTREE_PACKET_SENT_TIME);
     outputLength += sizeof(OCTREE_PACKET_SENT_TIME);
 
-    uint16_t numberOfIds = 0; // placeholder for now
-    unsigned char* numberOfIDsAt = copyAt;
+    // the IDs deleted since we last sent to this node, as many as fit
+    int maxIDs = (int)((maxLength - outputLength - sizeof(uint16_t)) / sizeof(uint32_t));
+    uint16_t numberOfIds = _deletedModelItemIDs.copyDeletedSince(cursor, copyAt + sizeof(numberOfIds), maxIDs);
     memcpy(copyAt, &numberOfIds, sizeof(numberOfIds));
-    copyAt += sizeof(numberOfIds);
-    outputLength += sizeof(numberOfIds);
-    
-    // we keep a multi map of model IDs to timestamps, we only want to include the model IDs that have been
-    // deleted since we last sent to this node
-    _recentlyDeletedModelsLock.lockForRead();
-    QMultiMap<quint64, uint32_t>::const_iterator iterator = _recentlyDeletedModelItemIDs.constBegin();
-    while (iterator != _recentlyDeletedModelItemIDs.constEnd()) {
-        QList<uint32_t> values = _recentlyDeletedModelItemIDs.values(iterator.key());
-        for (int valueItem = 0; valueItem < values.size(); ++valueItem) {
-
-            // if the timestamp is more recent then out last sent time, include it
-            if (iterator.key() > sinceTime) {
-                uint32_t modelID = values.at(valueItem);
-                memcpy(copyAt, &modelID, sizeof(modelID));
-                copyAt += sizeof(modelID);
-                outputLength += sizeof(modelID);
-                numberOfIds++;
-
-                // check to make sure we have room for one more id...
-                if (outputLength + sizeof(uint32_t) > maxLength) {
-                    break;
-                }
-            }
-        }
-
-        // check to make sure we have room for one more id...
-        if (outputLength + sizeof(uint32_t) > maxLength) {
+    outputLength += sizeof(numberOfIds) + numberOfIds * sizeof(uint32_t);
 
-            // let our caller know how far we got
-            sinceTime = iterator.key();
-            break;
-        }
-        ++iterator;
-    }
-
-    // if we got to the end, then we're done sending
-    if (iterator == _recentlyDeletedModelItemIDs.constEnd()) {
-        hasMoreToSend = false;
-    }
-    _recentlyDeletedModelsLock.unlock();
-
-    // replace the correct count for ids included
-    memcpy(numberOfIDsAt, &numberOfIds, sizeof(numberOfIds));
-    return hasMoreToSend;
+    return _deletedModelItemIDs.hasDeletedSince(cursor);
 }
 
-// called by the server when it knows all nodes have been sent deleted packets
-
-void ModelTree::forgetModelsDeletedBefore(quint64 sinceTime) {
-    //qDebug() << "forgetModelsDeletedBefore()";
-    QSet<quint64> keysToRemove;
-
-    _recentlyDeletedModelsLock.lockForWrite();
-    QMultiMap<quint64, uint32_t>::iterator iterator = _recentlyDeletedModelItemIDs.begin();
-
-    // First find all the keys in the map that are older and need to be deleted
-    while (iterator != _recentlyDeletedModelItemIDs.end()) {
-        if (iterator.key() <= sinceTime) {
-            keysToRemove << iterator.key();
-        }
-        ++iterator;
-    }
-
-    // Now run through the keysToRemove and remove them
-    foreach (quint64 value, keysToRemove) {
-        //qDebug() << "removing the key, _recentlyDeletedModelItemIDs.remove(value); time/key:" << value;
-        _recentlyDeletedModelItemIDs.remove(value);
-    }
-    
-    _recentlyDeletedModelsLock.unlock();
+// called by the server when it knows all nodes have been sent the deletions before the cursor
+void ModelTree::forgetModelsDeletedBefore(quint64 cursor) {
+    _deletedModelItemIDs.forgetDeletedBefore(cursor);
 }
 
 
@@ -12,7 +12,11 @@
 #ifndef hifi_ModelTree_h
 #define hifi_ModelTree_h
 
+#include <QtCore/QHash>
+#include <QtCore/QThreadPool>
+
 #include <Octree.h>
+#include <OctreeDeletedIDLog.h>
 #include "ModelTreeElement.h"
 
 class NewlyCreatedModelHook {
@@ -29,6 +33,7 @@ class ModelTree : public Octree {
     Q_OBJECT
 public:
     ModelTree(bool shouldReaverage = false);
+    virtual ~ModelTree();
 
     /// Implements our type specific root element factory
     virtual ModelTreeElement* createNewElement(unsigned char * octalCode = NULL);
@@ -56,6 +61,13 @@ public:
     const ModelItem* findClosestModel(glm::vec3 position, float targetRadius);
     const ModelItem* findModelByID(uint32_t id, bool alreadyLocked = false);
 
+    /// Called by the elements as they store and remove models, so that models can be found by ID without searching
+    /// the tree. Models whose IDs aren't known yet aren't kept.
+    void setContainingElement(uint32_t modelID, ModelTreeElement* element);
+
+    /// forgets the element holding a model, if it's the one given
+    void resetContainingElement(uint32_t modelID, ModelTreeElement* element);
+
     /// finds all models that touch a sphere
     /// \param center the center of the sphere
     /// \param radius the radius of the sphere
@@ -72,10 +84,12 @@ public:
     void addNewlyCreatedHook(NewlyCreatedModelHook* hook);
     void removeNewlyCreatedHook(NewlyCreatedModelHook* hook);
 
-    bool hasAnyDeletedModels() const { return _recentlyDeletedModelItemIDs.size() > 0; }
-    bool hasModelsDeletedSince(quint64 sinceTime);
-    bool encodeModelsDeletedSince(OCTREE_PACKET_SEQUENCE sequenceNumber, quint64& sinceTime, unsigned char* packetData, size_t maxLength, size_t& outputLength);
-    void forgetModelsDeletedBefore(quint64 sinceTime);
+    /// the deletions are logged in order and a node is sent them from a cursor, which starts at 0 for a new node
+    bool hasAnyDeletedModels() const { return !_deletedModelItemIDs.isEmpty(); }
+    bool hasModelsDeletedSince(quint64 cursor);
+    bool encodeModelsDeletedSince(OCTREE_PACKET_SEQUENCE sequenceNumber, quint64& cursor,
+                                  unsigned char* packetData, size_t maxLength, size_t& outputLength);
+    void forgetModelsDeletedBefore(quint64 cursor);
 
     void processEraseMessage(const QByteArray& dataByteArray, const SharedNodePointer& sourceNode);
     void handleAddModelResponse(const QByteArray& packet);
@@ -93,7 +107,6 @@ private:
     static bool findNearPointOperation(OctreeElement* element, void* extraData);
     static bool findInSphereOperation(OctreeElement* element, void* extraData);
     static bool pruneOperation(OctreeElement* element, void* extraData);
-    static bool findByIDOperation(OctreeElement* element, void* extraData);
     static bool findAndDeleteOperation(OctreeElement* element, void* extraData);
     static bool findAndUpdateModelItemIDOperation(OctreeElement* element, void* extraData);
     static bool findInCubeForUpdateOperation(OctreeElement* element, void* extraData);
@@ -104,9 +117,12 @@ private:
     std::vector<NewlyCreatedModelHook*> _newlyCreatedHooks;
 
 
-    QReadWriteLock _recentlyDeletedModelsLock;
-    QMultiMap<quint64, uint32_t> _recentlyDeletedModelItemIDs;
+    OctreeDeletedIDLog _deletedModelItemIDs;
     ModelItemFBXService* _fbxService;
+
+    QHash<uint32_t, ModelTreeElement*> _modelToElementMap;
+
+    QThreadPool _updateThreads;
 };
 
 #endif // hifi_ModelTree_h
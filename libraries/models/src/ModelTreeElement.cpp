@@ -13,20 +13,50 @@
 
 #include <FBXReader.h>
 #include <GeometryUtil.h>
+#include <SlabAllocator.h>
 
 #include "ModelTree.h"
 #include "ModelTreeElement.h"
 
-ModelTreeElement::ModelTreeElement(unsigned char* octalCode) : OctreeElement(), _modelItems(NULL) {
+ModelTreeElement::ModelTreeElement(unsigned char* octalCode) :
+    OctreeElement(),
+    _myTree(NULL),
+    _modelItems(NULL),
+    _boundsTreeIsDirty(true)
+{
     init(octalCode);
 };
 
 ModelTreeElement::~ModelTreeElement() {
     _voxelMemoryUsage -= sizeof(ModelTreeElement);
+    if (_myTree) {
+        for (int i = 0; i < _modelItems->size(); i++) {
+            _myTree->resetContainingElement((*_modelItems)[i].getID(), this);
+        }
+    }
     delete _modelItems;
     _modelItems = NULL;
 }
 
+static SlabAllocator& getElementAllocator() {
+    // never deleted, as elements can outlive the static destructors
+    static SlabAllocator* allocator = new SlabAllocator(sizeof(ModelTreeElement));
+    return *allocator;
+}
+
+void* ModelTreeElement::operator new(size_t size) {
+    // a subclass of a different size comes from the heap
+    return (size == sizeof(ModelTreeElement)) ? getElementAllocator().allocate() : ::operator new(size);
+}
+
+void ModelTreeElement::operator delete(void* element, size_t size) {
+    if (size == sizeof(ModelTreeElement)) {
+        getElementAllocator().deallocate(element);
+    } else {
+        ::operator delete(element);
+    }
+}
+
 // This will be called primarily on addChildAt(), which means we're adding a child of our
 // own type to our own tree. This means we should initialize that child with any tree and type
 // specific settings that our children must have. One example is out VoxelSystem, which
@@ -85,8 +115,14 @@ bool ModelTreeElement::appendElementData(OctreePacketData* packetData, EncodeBit
             const ModelItem& model = (*_modelItems)[i];
             
             LevelDetails modelLevel = packetData->startLevel();
-    
-            success = model.appendModelData(packetData);
+
+            // a view that had this element has the models that were here then, so they need only send their changes
+            if (params.deltaViewFrustum && params.elementWasInView) {
+                success = model.appendModelData(packetData,
+                                                model.getPropertiesChangedSince(params.lastViewFrustumSent - CHANGE_FUDGE));
+            } else {
+                success = model.appendModelData(packetData);
+            }
 
             if (success) {
                 packetData->endLevel(modelLevel);
@@ -150,9 +186,11 @@ void ModelTreeElement::update(ModelTreeUpdateArgs& args) {
         // into the arguments moving models. These will be added back or deleted completely
         if (model.getShouldDie() || !bestFitModelBounds(model)) {
             args._movingModels.push_back(model);
+            args._movedFromElements.push_back(this);
 
-            // erase this model
+            // erase this model, the tree forgets it was here once the elements are all updated
             modelItr = _modelItems->erase(modelItr);
+            modelsMoved();
 
             args._movingItems++;
             
@@ -170,11 +208,16 @@ bool ModelTreeElement::findDetailedRayIntersection(const glm::vec3& origin, cons
 
     // only called if we do intersect our bounding cube, but find if we actually intersect with models...
     
-    QList<ModelItem>::iterator modelItr = _modelItems->begin();
-    QList<ModelItem>::const_iterator modelEnd = _modelItems->end();
+    // with many models, only those whose cubes the ray hits are looked at
+    const ModelItemBoundsTree* boundsTree = getBoundsTree();
+    QVector<int> hitModels;
+    if (boundsTree) {
+        boundsTree->findRayIntersections(origin, direction, hitModels);
+    }
+    int modelsToCheck = boundsTree ? hitModels.size() : _modelItems->size();
     bool somethingIntersected = false;
-    while(modelItr != modelEnd) {
-        ModelItem& model = (*modelItr);
+    for (int i = 0; i < modelsToCheck; i++) {
+        ModelItem& model = (*_modelItems)[boundsTree ? hitModels.at(i) : i];
         
         AACube modelCube = model.getAACube();
         float localDistance;
@@ -248,18 +291,20 @@ bool ModelTreeElement::findDetailedRayIntersection(const glm::vec3& origin, cons
                 somethingIntersected = true;
             }
         }
-        
-        ++modelItr;
     }
     return somethingIntersected;
 }
 
 bool ModelTreeElement::findSpherePenetration(const glm::vec3& center, float radius,
                                     glm::vec3& penetration, void** penetratedObject) const {
-    QList<ModelItem>::iterator modelItr = _modelItems->begin();
-    QList<ModelItem>::const_iterator modelEnd = _modelItems->end();
-    while(modelItr != modelEnd) {
-        ModelItem& model = (*modelItr);
+    const ModelItemBoundsTree* boundsTree = getBoundsTree();
+    QVector<int> nearModels;
+    if (boundsTree) {
+        boundsTree->findTouching(center - glm::vec3(radius), center + glm::vec3(radius), nearModels);
+    }
+    int modelsToCheck = boundsTree ? nearModels.size() : _modelItems->size();
+    for (int i = 0; i < modelsToCheck; i++) {
+        const ModelItem& model = _modelItems->at(boundsTree ? nearModels.at(i) : i);
         glm::vec3 modelCenter = model.getPosition();
         float modelRadius = model.getRadius();
 
@@ -273,7 +318,6 @@ bool ModelTreeElement::findSpherePenetration(const glm::vec3& center, float radi
             *penetratedObject = (void*)(&model);
             return true;
         }
-        ++modelItr;
     }
     return false;
 }
@@ -299,7 +343,9 @@ bool ModelTreeElement::updateModel(const ModelItem& model) {
                 }
                 
                 thisModel.copyChangedProperties(model);
+                modelsMoved();
                 markWithChangedTime();
+                thisModel.setLastStored(_lastChanged);
             } else {
                 if (wantDebug) {
                     qDebug(">>> IGNORING SERVER!!! Would've caused jutter! <<<  "
@@ -330,10 +376,12 @@ bool ModelTreeElement::updateModel(const ModelItemID& modelID, const ModelItemPr
         }
         if (found) {
             thisModel.setProperties(properties);
+            modelsMoved();
             if (_myTree->getGeometryForModel(thisModel)) {
                 thisModel.setSittingPoints(_myTree->getGeometryForModel(thisModel)->sittingPoints);
             }
             markWithChangedTime(); // mark our element as changed..
+            thisModel.setLastStored(_lastChanged);
             const bool wantDebug = false;
             if (wantDebug) {
                 uint64_t now = usecTimestampNow();
@@ -357,6 +405,7 @@ void ModelTreeElement::updateModelItemID(FindAndUpdateModelItemIDArgs* args) {
             // first, we're looking for matching creatorTokenIDs, if we find that, then we fix it to know the actual ID
             if (thisModel.getCreatorTokenID() == args->creatorTokenID) {
                 thisModel.setID(args->modelID);
+                _myTree->setContainingElement(args->modelID, this);
                 args->creatorTokenFound = true;
             }
         }
@@ -364,7 +413,9 @@ void ModelTreeElement::updateModelItemID(FindAndUpdateModelItemIDArgs* args) {
         // if we're in an isViewing tree, we also need to look for an kill any viewed models
         if (!args->viewedModelFound && args->isViewing) {
             if (thisModel.getCreatorTokenID() == UNKNOWN_MODEL_TOKEN && thisModel.getID() == args->modelID) {
+                _myTree->resetContainingElement(args->modelID, this);
                 _modelItems->removeAt(i); // remove the model at this index
+                modelsMoved();
                 numberOfModels--; // this means we have 1 fewer model in this list
                 i--; // and we actually want to back up i as well.
                 args->viewedModelFound = true;
@@ -389,9 +440,15 @@ const ModelItem* ModelTreeElement::getClosestModel(glm::vec3 position) const {
 }
 
 void ModelTreeElement::getModels(const glm::vec3& searchPosition, float searchRadius, QVector<const ModelItem*>& foundModels) const {
-    uint16_t numberOfModels = _modelItems->size();
-    for (uint16_t i = 0; i < numberOfModels; i++) {
-        const ModelItem* model = &(*_modelItems)[i];
+    const ModelItemBoundsTree* boundsTree = getBoundsTree();
+    QVector<int> nearModels;
+    if (boundsTree) {
+        boundsTree->findTouching(searchPosition - glm::vec3(searchRadius), searchPosition + glm::vec3(searchRadius),
+                                 nearModels);
+    }
+    int modelsToCheck = boundsTree ? nearModels.size() : _modelItems->size();
+    for (int i = 0; i < modelsToCheck; i++) {
+        const ModelItem* model = &_modelItems->at(boundsTree ? nearModels.at(i) : i);
         float distance = glm::length(model->getPosition() - searchPosition);
         if (distance < searchRadius + model->getRadius()) {
             foundModels.push_back(model);
@@ -400,23 +457,38 @@ void ModelTreeElement::getModels(const glm::vec3& searchPosition, float searchRa
 }
 
 void ModelTreeElement::getModelsForUpdate(const AACube& box, QVector<ModelItem*>& foundModels) {
-    QList<ModelItem>::iterator modelItr = _modelItems->begin();
-    QList<ModelItem>::iterator modelEnd = _modelItems->end();
+    const ModelItemBoundsTree* boundsTree = getBoundsTree();
+    QVector<int> nearModels;
+    if (boundsTree) {
+        boundsTree->findTouching(box.getCorner(), box.getCorner() + box.getDimensions(), nearModels);
+    }
+    int modelsToCheck = boundsTree ? nearModels.size() : _modelItems->size();
     AACube modelCube;
-    while(modelItr != modelEnd) {
-        ModelItem* model = &(*modelItr);
+    for (int i = 0; i < modelsToCheck; i++) {
+        ModelItem* model = &(*_modelItems)[boundsTree ? nearModels.at(i) : i];
         float radius = model->getRadius();
         // NOTE: we actually do cube-cube collision queries here, which is sloppy but good enough for now
         // TODO: decide whether to replace modelCube-cube query with sphere-cube (requires a square root
         // but will be slightly more accurate).
         modelCube.setBox(model->getPosition() - glm::vec3(radius), 2.f * radius);
-        if (modelCube.touches(_cube)) {
+        if (modelCube.touches(box)) {
             foundModels.push_back(model);
         }
-        ++modelItr;
     }
 }
 
+const ModelItemBoundsTree* ModelTreeElement::getBoundsTree() const {
+    if (_modelItems->size() < MIN_MODELS_FOR_BOUNDS_TREE) {
+        return NULL;
+    }
+    QMutexLocker locker(&_boundsTreeMutex);
+    if (_boundsTreeIsDirty) {
+        _boundsTree.build(*_modelItems);
+        _boundsTreeIsDirty = false;
+    }
+    return &_boundsTree;
+}
+
 const ModelItem* ModelTreeElement::getModelWithID(uint32_t id) const {
     // NOTE: this lookup is O(N) but maybe we don't care? (guaranteed that num models per elemen is small?)
     const ModelItem* foundModel = NULL;
@@ -437,6 +509,8 @@ bool ModelTreeElement::removeModelWithID(uint32_t id) {
         if ((*_modelItems)[i].getID() == id) {
             foundModel = true;
             _modelItems->removeAt(i);
+            modelsMoved();
+            _myTree->resetContainingElement(id, this);
             break;
         }
     }
@@ -457,7 +531,7 @@ int ModelTreeElement::readElementDataFromBuffer(const unsigned char* data, int b
     const unsigned char* dataAt = data;
     int bytesRead = 0;
     uint16_t numberOfModels = 0;
-    int expectedBytesPerModel = ModelItem::expectedBytes();
+    int expectedBytesPerModel = ModelItem::expectedBytes(args.bitstreamVersion);
 
     if (bytesLeftToRead >= (int)sizeof(numberOfModels)) {
         // read our models in....
@@ -469,9 +543,18 @@ int ModelTreeElement::readElementDataFromBuffer(const unsigned char* data, int b
         
         if (bytesLeftToRead >= (int)(numberOfModels * expectedBytesPerModel)) {
             for (uint16_t i = 0; i < numberOfModels; i++) {
-                ModelItem tempModel;
-                int bytesForThisModel = tempModel.readModelDataFromBuffer(dataAt, bytesLeftToRead, args);
-                _myTree->storeModel(tempModel);
+                // a model may send only what's changed, which is read over the model we have
+                uint32_t modelID = *(uint32_t*)dataAt;
+                const ModelItem* existingModel = _myTree->findModelByID(modelID, true);
+                ModelItem tempModel = existingModel ? *existingModel : ModelItem();
+                ModelItemPropertyFlags propertiesRead;
+                int bytesForThisModel = tempModel.readModelDataFromBuffer(dataAt, bytesLeftToRead, args, &propertiesRead);
+                if (bytesForThisModel == 0) {
+                    return bytesRead + bytesLeftToRead; // the rest can't be read
+                }
+                if (existingModel || propertiesRead == ModelItem::getAllProperties()) {
+                    _myTree->storeModel(tempModel);
+                }
                 dataAt += bytesForThisModel;
                 bytesLeftToRead -= bytesForThisModel;
                 bytesRead += bytesForThisModel;
@@ -499,6 +582,9 @@ bool ModelTreeElement::collapseChildren() {
 
 void ModelTreeElement::storeModel(const ModelItem& model) {
     _modelItems->push_back(model);
+    modelsMoved();
+    _myTree->setContainingElement(model.getID(), this);
     markWithChangedTime();
+    _modelItems->last().setLastStored(_lastChanged);
 }
 
@@ -14,13 +14,18 @@
 
 #include <OctreeElement.h>
 #include <QList>
+#include <QMutex>
 
 #include "ModelItem.h"
+#include "ModelItemBoundsTree.h"
 #include "ModelTree.h"
 
 class ModelTree;
 class ModelTreeElement;
 
+/// the fewest models an element holds for its queries to go through a bounds tree rather than test every model
+const int MIN_MODELS_FOR_BOUNDS_TREE = 16;
+
 class ModelTreeUpdateArgs {
 public:
     ModelTreeUpdateArgs() :
@@ -30,6 +35,7 @@ public:
     { }
     
     QList<ModelItem> _movingModels;
+    QList<ModelTreeElement*> _movedFromElements; /// the element each of the moving models was taken from
     int _totalElements;
     int _totalItems;
     int _movingItems;
@@ -56,6 +62,10 @@ class ModelTreeElement : public OctreeElement {
 public:
     virtual ~ModelTreeElement();
 
+    /// elements are carved out of slabs rather than allocated from the heap one at a time
+    static void* operator new(size_t size);
+    static void operator delete(void* element, size_t size);
+
     // type safe versions of OctreeElement methods
     ModelTreeElement* getChildAtIndex(int index) { return (ModelTreeElement*)OctreeElement::getChildAtIndex(index); }
 
@@ -109,7 +119,14 @@ public:
                         glm::vec3& penetration, void** penetratedObject) const;
 
     const QList<ModelItem>& getModels() const { return *_modelItems; }
+
+    /// callers that change where the models are or how big they are must call modelsMoved() after
     QList<ModelItem>& getModels() { return *_modelItems; }
+    void modelsMoved() { _boundsTreeIsDirty = true; }
+
+    /// the bounds tree of the models, built again if they've changed since it was asked for, or NULL if there are too
+    /// few models for one to be worth it. It's only valid until the models next change.
+    const ModelItemBoundsTree* getBoundsTree() const;
     bool hasModels() const { return _modelItems ? _modelItems->size() > 0 : false; }
 
     void update(ModelTreeUpdateArgs& args);
@@ -146,6 +163,11 @@ protected:
 
     ModelTree* _myTree;
     QList<ModelItem>* _modelItems;
+
+    // the readers of a tree can ask for the bounds tree at the same time
+    mutable QMutex _boundsTreeMutex;
+    mutable ModelItemBoundsTree _boundsTree;
+    mutable bool _boundsTreeIsDirty;
 };
 
 #endif // hifi_ModelTreeElement_h
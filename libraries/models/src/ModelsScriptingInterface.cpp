@@ -108,6 +108,48 @@ ModelItemID ModelsScriptingInterface::editModel(ModelItemID modelID, const Model
     return modelID;
 }
 
+QVector<ModelItemID> ModelsScriptingInterface::addModels(const QVector<ModelItemProperties>& properties) {
+    QVector<ModelItemID> ids;
+    ids.reserve(properties.size());
+    foreach (const ModelItemProperties& modelProperties, properties) {
+        ModelItemID id(NEW_MODEL, ModelItem::getNextCreatorTokenID(), false);
+        queueModelMessage(PacketTypeModelAddOrEdit, id, modelProperties);
+        ids.append(id);
+    }
+    
+    // the local tree is locked once for all of them
+    if (_modelTree) {
+        _modelTree->lockForWrite();
+        for (int i = 0; i < ids.size(); i++) {
+            _modelTree->addModel(ids.at(i), properties.at(i));
+        }
+        _modelTree->unlock();
+    }
+    return ids;
+}
+
+QVector<ModelItemID> ModelsScriptingInterface::editModels(const QVector<ModelItemID>& modelIDs,
+                                                          const QVector<ModelItemProperties>& properties) {
+    QVector<ModelItemID> ids = modelIDs.mid(0, properties.size());
+    for (int i = 0; i < ids.size(); i++) {
+        ModelItemID& modelID = ids[i];
+        uint32_t actualID = modelID.isKnownID ? modelID.id : ModelItem::getIDfromCreatorTokenID(modelID.creatorTokenID);
+        if (actualID != UNKNOWN_MODEL_ID) {
+            modelID.id = actualID;
+            modelID.isKnownID = true;
+            queueModelMessage(PacketTypeModelAddOrEdit, modelID, properties.at(i));
+        }
+    }
+    
+    if (_modelTree) {
+        _modelTree->lockForWrite();
+        for (int i = 0; i < ids.size(); i++) {
+            _modelTree->updateModel(ids.at(i), properties.at(i));
+        }
+        _modelTree->unlock();
+    }
+    return ids;
+}
 
 // TODO: This deleteModel() method uses the PacketType_MODEL_ADD_OR_EDIT message to send
 // a changed model with a shouldDie() property set to true. This works and is currently the only
@@ -70,6 +70,12 @@ public slots:
     /// deletes a model
     void deleteModel(ModelItemID modelID);
 
+    /// adds many models at once, which is much cheaper than calling addModel for each
+    QVector<ModelItemID> addModels(const QVector<ModelItemProperties>& properties);
+
+    /// edits many models at once, each with the properties at the same index; returns the identified ModelItemIDs
+    QVector<ModelItemID> editModels(const QVector<ModelItemID>& modelIDs, const QVector<ModelItemProperties>& properties);
+
     /// finds the closest model to the center point, within the radius
     /// will return a ModelItemID.isKnownID = false if no models are in the radius
     /// this function will not find any models in script engine contexts which don't have access to models
@@ -13,7 +13,9 @@
 #include <QtCore/QJsonDocument>
 #include <QtCore/QJsonObject>
 #include <QtCore/QMap>
+#include <QtCore/QRunnable>
 #include <QtCore/QStringList>
+#include <QtCore/QThreadPool>
 #include <QtCore/QUrlQuery>
 #include <QtNetwork/QNetworkRequest>
 #include <QHttpMultiPart>
@@ -37,6 +39,27 @@ Q_DECLARE_METATYPE(JSONCallbackParameters)
 
 const QString ACCOUNTS_GROUP = "accounts";
 
+/// replies at least this big are parsed on the thread pool rather than holding up the thread the manager is on
+const int MIN_THREADED_PARSE_BYTES = 16 * 1024;
+
+/// parses the body of a reply and hands the object back to the manager to pass on to the callback
+class ParseReplyTask : public QRunnable {
+public:
+    ParseReplyTask(AccountManager* manager, const QByteArray& body, const JSONCallbackParameters& callbackParams) :
+        _manager(manager), _body(body), _callbackParams(callbackParams) { }
+
+    virtual void run() {
+        QJsonObject object = QJsonDocument::fromJson(_body).object();
+        QMetaObject::invokeMethod(_manager, "invokeJSONCallback", Q_ARG(const QJsonObject&, object),
+                                  Q_ARG(const JSONCallbackParameters&, _callbackParams));
+    }
+
+private:
+    AccountManager* _manager;
+    QByteArray _body;
+    JSONCallbackParameters _callbackParams;
+};
+
 JSONCallbackParameters::JSONCallbackParameters(QObject* jsonCallbackReceiver, const QString& jsonCallbackMethod,
                                                QObject* errorCallbackReceiver, const QString& errorCallbackMethod,
                                                QObject* updateReceiver, const QString& updateSlot) :
@@ -49,6 +72,12 @@ JSONCallbackParameters::JSONCallbackParameters(QObject* jsonCallbackReceiver, co
 {
 }
 
+bool JSONCallbackParameters::operator==(const JSONCallbackParameters& other) const {
+    return jsonCallbackReceiver == other.jsonCallbackReceiver && jsonCallbackMethod == other.jsonCallbackMethod
+        && errorCallbackReceiver == other.errorCallbackReceiver && errorCallbackMethod == other.errorCallbackMethod
+        && updateReciever == other.updateReciever && updateSlot == other.updateSlot;
+}
+
 AccountManager::AccountManager() :
     _authURL(),
     _pendingCallbackMap(),
@@ -179,6 +208,21 @@ void AccountManager::invokedRequest(const QString& path, QNetworkAccessManager::
             }
         }
 
+        if (operation == QNetworkAccessManager::GetOperation && !callbackParams.isEmpty()) {
+            // the same request for the same callback is often made again before the first comes back, as when logging
+            // in and changing domains - the reply to the first will do for both
+            for (QMap<QNetworkReply*, JSONCallbackParameters>::const_iterator it = _pendingCallbackMap.constBegin();
+                    it != _pendingCallbackMap.constEnd(); it++) {
+                if (it.key()->operation() == operation && it.key()->url() == requestURL
+                        && it.value() == callbackParams) {
+                    if (VERBOSE_HTTP_REQUEST_DEBUGGING) {
+                        qDebug() << "Coalesced a request to" << qPrintable(requestURL.toString());
+                    }
+                    return;
+                }
+            }
+        }
+
         QNetworkReply* networkReply = NULL;
 
         switch (operation) {
@@ -241,37 +285,37 @@ void AccountManager::processReply() {
 }
 
 void AccountManager::passSuccessToCallback(QNetworkReply* requestReply) {
-    QJsonDocument jsonResponse = QJsonDocument::fromJson(requestReply->readAll());
-
-    JSONCallbackParameters callbackParams = _pendingCallbackMap.value(requestReply);
+    JSONCallbackParameters callbackParams = _pendingCallbackMap.take(requestReply);
 
     if (callbackParams.jsonCallbackReceiver) {
-        // invoke the right method on the callback receiver
-        QMetaObject::invokeMethod(callbackParams.jsonCallbackReceiver, qPrintable(callbackParams.jsonCallbackMethod),
-                                  Q_ARG(const QJsonObject&, jsonResponse.object()));
-
-        // remove the related reply-callback group from the map
-        _pendingCallbackMap.remove(requestReply);
-
+        QByteArray body = requestReply->readAll();
+        if (body.size() < MIN_THREADED_PARSE_BYTES) {
+            invokeJSONCallback(QJsonDocument::fromJson(body).object(), callbackParams);
+        } else {
+            QThreadPool::globalInstance()->start(new ParseReplyTask(this, body, callbackParams));
+        }
     } else {
         if (VERBOSE_HTTP_REQUEST_DEBUGGING) {
             qDebug() << "Received JSON response from data-server that has no matching callback.";
-            qDebug() << jsonResponse;
+            qDebug() << QJsonDocument::fromJson(requestReply->readAll());
         }
     }
 }
 
+void AccountManager::invokeJSONCallback(const QJsonObject& object, const JSONCallbackParameters& callbackParams) {
+    // invoke the right method on the callback receiver
+    QMetaObject::invokeMethod(callbackParams.jsonCallbackReceiver, qPrintable(callbackParams.jsonCallbackMethod),
+                              Q_ARG(const QJsonObject&, object));
+}
+
 void AccountManager::passErrorToCallback(QNetworkReply* requestReply) {
-    JSONCallbackParameters callbackParams = _pendingCallbackMap.value(requestReply);
+    JSONCallbackParameters callbackParams = _pendingCallbackMap.take(requestReply);
 
     if (callbackParams.errorCallbackReceiver) {
         // invoke the right method on the callback receiver
         QMetaObject::invokeMethod(callbackParams.errorCallbackReceiver, qPrintable(callbackParams.errorCallbackMethod),
                                   Q_ARG(QNetworkReply::NetworkError, requestReply->error()),
                                   Q_ARG(const QString&, requestReply->errorString()));
-
-        // remove the related reply-callback group from the map
-        _pendingCallbackMap.remove(requestReply);
     } else {
         if (VERBOSE_HTTP_REQUEST_DEBUGGING) {
             qDebug() << "Received error response from data-server that has no matching callback.";
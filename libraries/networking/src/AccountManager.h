@@ -13,6 +13,7 @@
 #define hifi_AccountManager_h
 
 #include <QtCore/QByteArray>
+#include <QtCore/QJsonObject>
 #include <QtCore/QObject>
 #include <QtCore/QUrl>
 #include <QtNetwork/QNetworkReply>
@@ -28,6 +29,7 @@ public:
                            QObject* updateReceiver = NULL, const QString& updateSlot = QString());
 
     bool isEmpty() const { return !jsonCallbackReceiver && !errorCallbackReceiver; }
+    bool operator==(const JSONCallbackParameters& other) const;
 
     QObject* jsonCallbackReceiver;
     QString jsonCallbackMethod;
@@ -80,6 +82,7 @@ signals:
     void balanceChanged(qint64 newBalance);
 private slots:
     void processReply();
+    void invokeJSONCallback(const QJsonObject& object, const JSONCallbackParameters& callbackParams);
 private:
     AccountManager();
     AccountManager(AccountManager const& other); // not implemented
@@ -0,0 +1,115 @@
+//
+//  CongestionControl.cpp
+//  libraries/networking/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#include <algorithm>
+#include <climits>
+
+#include <SharedUtil.h>
+
+#include "SequenceNumberStats.h"
+
+#include "CongestionControl.h"
+
+// the queuing delay the window settles at, as LEDBAT targets
+const quint64 TARGET_QUEUING_DELAY = 100 * USECS_PER_MSEC;
+const float WINDOW_GAIN = 1.0f;
+
+const float INITIAL_WINDOW = 10.0f;
+const float MIN_WINDOW = 2.0f;
+const float MAX_WINDOW = 10000.0f;
+
+// a round trip longer than this is a bad timestamp rather than a slow path
+const quint64 MAX_REASONABLE_ROUND_TRIP_TIME = 10 * USECS_PER_SECOND;
+
+// how long the smallest round trip is kept before it is measured over
+const quint64 BASE_ROUND_TRIP_TIME_LIFETIME = 120 * USECS_PER_SECOND;
+
+CongestionControl::CongestionControl() :
+    _smoothedRoundTripTime(0),
+    _roundTripTimeVariance(0),
+    _baseRoundTripTime(0),
+    _baseRoundTripTimeStarted(0),
+    _window(INITIAL_WINDOW),
+    _lastDecreaseTime(0),
+    _newestAckedSequenceNumber(0),
+    _hasAcks(false)
+{
+}
+
+void CongestionControl::reset() {
+    _smoothedRoundTripTime = 0;
+    _roundTripTimeVariance = 0;
+    _baseRoundTripTime = 0;
+    _baseRoundTripTimeStarted = 0;
+    _window = INITIAL_WINDOW;
+    _lastDecreaseTime = 0;
+    _newestAckedSequenceNumber = 0;
+    _hasAcks = false;
+}
+
+void CongestionControl::ackReceived(const SelectiveAck& ack, quint64 now) {
+    // the packets that have arrived since the last ack, an ack that is older than the last one has nothing new
+    int newlyAcked = 0;
+    bool hadAcks = _hasAcks;
+    uint16_t previousNewest = _newestAckedSequenceNumber;
+    uint16_t ackedSinceLast = (uint16_t) (ack.getNewestSequenceNumber() - _newestAckedSequenceNumber);
+    if (!_hasAcks) {
+        _newestAckedSequenceNumber = ack.getNewestSequenceNumber();
+        _hasAcks = true;
+    } else if (ackedSinceLast > 0 && ackedSinceLast <= MAX_REASONABLE_SEQUENCE_GAP) {
+        newlyAcked = ackedSinceLast;
+        _newestAckedSequenceNumber = ack.getNewestSequenceNumber();
+    }
+
+    quint64 echoedAt = ack.getEchoedSentTime() + ack.getHoldUsecs();
+    if (ack.getEchoedSentTime() == 0 || echoedAt > now || now - echoedAt > MAX_REASONABLE_ROUND_TRIP_TIME) {
+        return;
+    }
+    quint64 roundTripTime = now - echoedAt;
+
+    // smoothed as RFC 6298 does, with gains of an eighth and a quarter
+    if (_smoothedRoundTripTime == 0) {
+        _smoothedRoundTripTime = std::max(roundTripTime, (quint64) 1);
+        _roundTripTimeVariance = roundTripTime / 2;
+    } else {
+        quint64 error = (roundTripTime > _smoothedRoundTripTime) ? roundTripTime - _smoothedRoundTripTime
+            : _smoothedRoundTripTime - roundTripTime;
+        _roundTripTimeVariance = (3 * _roundTripTimeVariance + error) / 4;
+        _smoothedRoundTripTime = std::max((7 * _smoothedRoundTripTime + roundTripTime) / 8, (quint64) 1);
+    }
+
+    if (_baseRoundTripTime == 0 || roundTripTime < _baseRoundTripTime
+            || now - _baseRoundTripTimeStarted > BASE_ROUND_TRIP_TIME_LIFETIME) {
+        _baseRoundTripTime = roundTripTime;
+        _baseRoundTripTimeStarted = now;
+    }
+
+    // the receiver keeps reporting what it is missing until it arrives, so only what went missing since the last ack
+    // is a new loss, and the losses of one round trip only halve the window once
+    bool hasNewLoss = hadAcks ? (newlyAcked > 0 && ack.hasMissingAfter(previousNewest)) : ack.hasMissing();
+    if (hasNewLoss) {
+        if (now - _lastDecreaseTime > _smoothedRoundTripTime) {
+            _window = std::max(MIN_WINDOW, _window / 2.0f);
+            _lastDecreaseTime = now;
+        }
+    } else if (newlyAcked > 0) {
+        float queuingDelay = (float) (roundTripTime - _baseRoundTripTime);
+        float offTarget = ((float) TARGET_QUEUING_DELAY - queuingDelay) / (float) TARGET_QUEUING_DELAY;
+        offTarget = std::max(-1.0f, std::min(offTarget, 1.0f));
+        _window = std::max(MIN_WINDOW, std::min(_window + WINDOW_GAIN * offTarget * newlyAcked / _window, MAX_WINDOW));
+    }
+}
+
+int CongestionControl::getPacketsPerSecond() const {
+    if (_smoothedRoundTripTime == 0) {
+        return 0;
+    }
+    return std::max(1, (int) std::min(_window * USECS_PER_SECOND / _smoothedRoundTripTime, (float) INT_MAX));
+}
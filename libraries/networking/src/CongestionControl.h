@@ -0,0 +1,58 @@
+//
+//  CongestionControl.h
+//  libraries/networking/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#ifndef hifi_CongestionControl_h
+#define hifi_CongestionControl_h
+
+#include <QtCore/QtGlobal>
+
+#include "SelectiveAck.h"
+
+/// Works out how fast a sender can send a stream from the acks its receiver sends back. The round trip is smoothed the
+/// way TCP smooths it, and the smallest round trip seen lately is taken to be the path with no queue on it. The window
+/// of packets in flight grows while the round trip stays within a target delay of that, shrinks as a queue builds past
+/// the target, and halves, at most once a round trip, when the receiver reports packets missing, as LEDBAT does. The
+/// rate it allows is the window sent once a round trip.
+class CongestionControl {
+public:
+    CongestionControl();
+
+    /// feeds an ack from the receiver in, now being the time it arrived on the same clock the packets were stamped with
+    void ackReceived(const SelectiveAck& ack, quint64 now);
+
+    /// has an ack come in that the round trip could be timed from
+    bool hasRoundTripTime() const { return _smoothedRoundTripTime > 0; }
+
+    quint64 getSmoothedRoundTripTime() const { return _smoothedRoundTripTime; }
+    quint64 getRoundTripTimeVariance() const { return _roundTripTimeVariance; }
+    quint64 getBaseRoundTripTime() const { return _baseRoundTripTime; }
+
+    float getWindow() const { return _window; }
+
+    /// the packets per second the window allows, or 0 until the round trip has been timed
+    int getPacketsPerSecond() const;
+
+    void reset();
+
+private:
+    quint64 _smoothedRoundTripTime;
+    quint64 _roundTripTimeVariance;
+
+    quint64 _baseRoundTripTime;
+    quint64 _baseRoundTripTimeStarted; /// the base is started over now and then, in case the path changed
+
+    float _window;
+    quint64 _lastDecreaseTime;
+
+    uint16_t _newestAckedSequenceNumber;
+    bool _hasAcks;
+};
+
+#endif // hifi_CongestionControl_h
@@ -0,0 +1,194 @@
+//
+//  DatagramBatcher.cpp
+//  libraries/networking/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#include <cstring>
+
+#include <QtCore/QDebug>
+
+#ifdef Q_OS_LINUX
+#include <errno.h>
+#endif
+
+#include "DatagramBatcher.h"
+
+// each datagram of a batch is read into room for the largest that UDP can carry, as billboards are larger than a packet
+const int MAX_DATAGRAM_BYTES = 65536;
+
+DatagramBatcher::DatagramBatcher(QUdpSocket& socket) :
+    _socket(socket),
+    _receiveBuffers(),
+    _receivedSizes(),
+    _receivedSenders(),
+    _numReceived(0),
+    _nextReceived(0),
+    _queuedDatagrams(),
+    _queuedDestinations()
+{
+    // with their capacity reserved the queues keep it when they are emptied
+    _queuedDatagrams.reserve(DATAGRAM_BATCH_SIZE);
+    _queuedDestinations.reserve(DATAGRAM_BATCH_SIZE);
+}
+
+bool DatagramBatcher::readDatagram(QByteArray& datagram, HifiSockAddr& senderSockAddr) {
+    if (_nextReceived == _numReceived && !receiveBatch()) {
+        return false;
+    }
+    
+    int size = _receivedSizes.at(_nextReceived);
+    datagram.resize(size);
+    memcpy(datagram.data(), _receiveBuffers.constData() + (_nextReceived * MAX_DATAGRAM_BYTES), size);
+    senderSockAddr = _receivedSenders.at(_nextReceived);
+    ++_nextReceived;
+    
+    return true;
+}
+
+bool DatagramBatcher::receiveBatch() {
+    _numReceived = 0;
+    _nextReceived = 0;
+    
+    if (!_socket.hasPendingDatagrams()) {
+        return false;
+    }
+    
+    if (_receiveBuffers.isEmpty()) {
+        _receiveBuffers.resize(DATAGRAM_BATCH_SIZE * MAX_DATAGRAM_BYTES);
+        _receivedSizes.resize(DATAGRAM_BATCH_SIZE);
+        _receivedSenders.resize(DATAGRAM_BATCH_SIZE);
+    }
+    
+    // the first datagram is read through the socket, which is what has it tell us again when more arrive
+    qint64 size = _socket.readDatagram(_receiveBuffers.data(), MAX_DATAGRAM_BYTES,
+                                       _receivedSenders[0].getAddressPointer(), _receivedSenders[0].getPortPointer());
+    if (size < 0) {
+        return false;
+    }
+    _receivedSizes[0] = size;
+    _numReceived = 1;
+    
+#ifdef Q_OS_LINUX
+    // the rest of what is waiting comes in with one call, without waiting for any more
+    const int MAX_BATCHED_DATAGRAMS = DATAGRAM_BATCH_SIZE - 1;
+    for (int i = 0; i < MAX_BATCHED_DATAGRAMS; i++) {
+        _receiveVectors[i].iov_base = _receiveBuffers.data() + ((i + 1) * MAX_DATAGRAM_BYTES);
+        _receiveVectors[i].iov_len = MAX_DATAGRAM_BYTES;
+        
+        memset(&_receiveMessages[i], 0, sizeof(mmsghdr));
+        _receiveMessages[i].msg_hdr.msg_iov = &_receiveVectors[i];
+        _receiveMessages[i].msg_hdr.msg_iovlen = 1;
+        _receiveMessages[i].msg_hdr.msg_name = &_receiveSockAddrs[i];
+        _receiveMessages[i].msg_hdr.msg_namelen = sizeof(sockaddr_in);
+    }
+    
+    int numMessages = recvmmsg(_socket.socketDescriptor(), _receiveMessages, MAX_BATCHED_DATAGRAMS, MSG_DONTWAIT, NULL);
+    for (int i = 0; i < numMessages; i++) {
+        if (_receiveMessages[i].msg_hdr.msg_flags & MSG_TRUNC) {
+            qDebug() << "Dropping a datagram larger than" << MAX_DATAGRAM_BYTES << "bytes.";
+            continue;
+        }
+        
+        // the received datagrams are packed down over any that were dropped
+        if (_numReceived != i + 1) {
+            memmove(_receiveBuffers.data() + (_numReceived * MAX_DATAGRAM_BYTES),
+                    _receiveBuffers.constData() + ((i + 1) * MAX_DATAGRAM_BYTES), _receiveMessages[i].msg_len);
+        }
+        _receivedSizes[_numReceived] = _receiveMessages[i].msg_len;
+        _receivedSenders[_numReceived] = HifiSockAddr(reinterpret_cast<const sockaddr*>(&_receiveSockAddrs[i]));
+        ++_numReceived;
+    }
+#endif
+    
+    return true;
+}
+
+void DatagramBatcher::queueDatagram(const QByteArray& datagram, const HifiSockAddr& destinationSockAddr) {
+    _queuedDatagrams.append(datagram);
+    _queuedDestinations.append(destinationSockAddr);
+    
+    if (_queuedDatagrams.size() == DATAGRAM_BATCH_SIZE) {
+        flush();
+    }
+}
+
+int DatagramBatcher::flush() {
+    int numSent = 0;
+    int numQueued = _queuedDatagrams.size();
+    
+#ifdef Q_OS_LINUX
+    // the node socket is bound to IPv4, any other destination is left to the socket below
+    int numMessages = 0;
+    int messageIndices[DATAGRAM_BATCH_SIZE];
+    for (int i = 0; i < numQueued; i++) {
+        const HifiSockAddr& destination = _queuedDestinations.at(i);
+        if (destination.getAddress().protocol() != QAbstractSocket::IPv4Protocol) {
+            continue;
+        }
+        
+        memset(&_sendSockAddrs[numMessages], 0, sizeof(sockaddr_in));
+        _sendSockAddrs[numMessages].sin_family = AF_INET;
+        _sendSockAddrs[numMessages].sin_addr.s_addr = htonl(destination.getAddress().toIPv4Address());
+        _sendSockAddrs[numMessages].sin_port = htons(destination.getPort());
+        
+        _sendVectors[numMessages].iov_base = const_cast<char*>(_queuedDatagrams.at(i).constData());
+        _sendVectors[numMessages].iov_len = _queuedDatagrams.at(i).size();
+        
+        memset(&_sendMessages[numMessages], 0, sizeof(mmsghdr));
+        _sendMessages[numMessages].msg_hdr.msg_iov = &_sendVectors[numMessages];
+        _sendMessages[numMessages].msg_hdr.msg_iovlen = 1;
+        _sendMessages[numMessages].msg_hdr.msg_name = &_sendSockAddrs[numMessages];
+        _sendMessages[numMessages].msg_hdr.msg_namelen = sizeof(sockaddr_in);
+        
+        messageIndices[numMessages++] = i;
+    }
+    
+    int numBatchSent = 0;
+    while (numBatchSent < numMessages) {
+        int result = sendmmsg(_socket.socketDescriptor(), _sendMessages + numBatchSent, numMessages - numBatchSent, 0);
+        if (result <= 0) {
+            if (result < 0 && errno == EINTR) {
+                continue;
+            }
+            qDebug() << "ERROR in sendmmsg:" << strerror(errno);
+            break;
+        }
+        numBatchSent += result;
+    }
+    numSent += numBatchSent;
+    
+    // whatever didn't go out in the batch goes through the socket, which reports its own errors
+    int nextMessage = 0;
+    for (int i = 0; i < numQueued; i++) {
+        if (nextMessage < numMessages && messageIndices[nextMessage] == i) {
+            if (nextMessage++ < numBatchSent) {
+                continue;
+            }
+        }
+        const HifiSockAddr& destination = _queuedDestinations.at(i);
+        if (_socket.writeDatagram(_queuedDatagrams.at(i), destination.getAddress(), destination.getPort()) >= 0) {
+            ++numSent;
+        }
+    }
+#else
+    for (int i = 0; i < numQueued; i++) {
+        const HifiSockAddr& destination = _queuedDestinations.at(i);
+        qint64 bytesWritten = _socket.writeDatagram(_queuedDatagrams.at(i), destination.getAddress(), destination.getPort());
+        if (bytesWritten < 0) {
+            qDebug() << "ERROR in writeDatagram:" << _socket.error() << "-" << _socket.errorString();
+        } else {
+            ++numSent;
+        }
+    }
+#endif
+    
+    _queuedDatagrams.resize(0);
+    _queuedDestinations.resize(0);
+    
+    return numSent;
+}
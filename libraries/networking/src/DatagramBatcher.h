@@ -0,0 +1,72 @@
+//
+//  DatagramBatcher.h
+//  libraries/networking/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#ifndef hifi_DatagramBatcher_h
+#define hifi_DatagramBatcher_h
+
+#include <QtCore/QByteArray>
+#include <QtCore/QVector>
+#include <QtNetwork/QUdpSocket>
+
+#ifdef Q_OS_LINUX
+#include <sys/socket.h>
+#include <netinet/in.h>
+#endif
+
+#include "HifiSockAddr.h"
+
+// the most datagrams that are read or written with one call
+const int DATAGRAM_BATCH_SIZE = 16;
+
+/// Reads and writes the datagrams of a bound QUdpSocket in batches. On Linux a batch is received with recvmmsg and sent
+/// with sendmmsg, so that a busy server makes one syscall for all of the datagrams waiting for it or queued by it rather
+/// than one for each. Anywhere else the datagrams go through the QUdpSocket one at a time. Reading and sending can each
+/// happen on a thread of its own, but neither on more than one.
+class DatagramBatcher {
+public:
+    DatagramBatcher(QUdpSocket& socket);
+    
+    /// reads the next datagram that has arrived into datagram, returns false if none is waiting
+    bool readDatagram(QByteArray& datagram, HifiSockAddr& senderSockAddr);
+    
+    /// queues a copy of datagram, which shares the data of it, to be sent by flush
+    void queueDatagram(const QByteArray& datagram, const HifiSockAddr& destinationSockAddr);
+    
+    int getNumQueuedDatagrams() const { return _queuedDatagrams.size(); }
+    
+    /// sends all of the queued datagrams and returns how many of them were sent
+    int flush();
+    
+private:
+    bool receiveBatch();
+    
+    QUdpSocket& _socket;
+    
+    QVector<char> _receiveBuffers; ///< allocated on the first read, since plenty of sockets are never batched
+    QVector<int> _receivedSizes;
+    QVector<HifiSockAddr> _receivedSenders;
+    int _numReceived;
+    int _nextReceived;
+    
+    QVector<QByteArray> _queuedDatagrams;
+    QVector<HifiSockAddr> _queuedDestinations;
+    
+#ifdef Q_OS_LINUX
+    mmsghdr _receiveMessages[DATAGRAM_BATCH_SIZE];
+    iovec _receiveVectors[DATAGRAM_BATCH_SIZE];
+    sockaddr_in _receiveSockAddrs[DATAGRAM_BATCH_SIZE];
+    
+    mmsghdr _sendMessages[DATAGRAM_BATCH_SIZE];
+    iovec _sendVectors[DATAGRAM_BATCH_SIZE];
+    sockaddr_in _sendSockAddrs[DATAGRAM_BATCH_SIZE];
+#endif
+};
+
+#endif // hifi_DatagramBatcher_h
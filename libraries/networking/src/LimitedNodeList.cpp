@@ -15,7 +15,10 @@
 
 #include <QtCore/QDataStream>
 #include <QtCore/QDebug>
+#include <QtCore/QJsonArray>
 #include <QtCore/QJsonDocument>
+#include <QtCore/QStringList>
+#include <QtCore/QThreadStorage>
 #include <QtCore/QUrl>
 #include <QtNetwork/QHostInfo>
 
@@ -35,6 +38,9 @@ const char SOLO_NODE_TYPES[2] = {
 
 const QUrl DEFAULT_NODE_AUTH_URL = QUrl("https://data.highfidelity.io");
 
+// the largest packet that is held back to go out with the others for its destination
+const int MAX_COALESCABLE_PACKET_SIZE = 512;
+
 LimitedNodeList* LimitedNodeList::_sharedInstance = NULL;
 
 LimitedNodeList* LimitedNodeList::createInstance(unsigned short socketListenPort, unsigned short dtlsPort) {
@@ -65,11 +71,23 @@ LimitedNodeList::LimitedNodeList(unsigned short socketListenPort, unsigned short
     _sessionUUID(),
     _nodeHash(),
     _nodeHashMutex(QMutex::Recursive),
+    _nodeHashLock(),
+    _nodeLookupTable(new NodeLookupTable()),
+    _nodeHashGeneration(0),
     _nodeSocket(this),
+    _nodeSocketBatcher(_nodeSocket),
     _dtlsSocket(NULL),
     _numCollectedPackets(0),
     _numCollectedBytes(0),
-    _packetStatTimer()
+    _numHashedBytes(0),
+    _hashingNsecs(0),
+    _packetStatTimer(),
+    _isCoalescingControlPackets(true),
+    _coalescedPacketsMutex(),
+    _coalescedPackets(),
+    _hasCoalescedFlushQueued(false),
+    _uncoalescedPackets(),
+    _uncoalescedSenderSockAddr()
 {
     _nodeSocket.bind(QHostAddress::AnyIPv4, socketListenPort);
     qDebug() << "NodeList socket is listening on" << _nodeSocket.localPort();
@@ -177,7 +195,13 @@ bool LimitedNodeList::packetVersionAndHashMatch(const QByteArray& packet) {
         SharedNodePointer sendingNode = sendingNodeForPacket(packet);
         if (sendingNode) {
             // check if the md5 hash in the header matches the hash we would expect
-            if (hashFromPacketHeader(packet) == hashForPacketAndConnectionUUID(packet, sendingNode->getConnectionSecret())) {
+            qint64 hashStart = _packetStatTimer.nsecsElapsed();
+            bool hashMatches = packetHashMatchesConnectionUUID(packet, sendingNode->getConnectionSecret());
+            _hashingNsecs += _packetStatTimer.nsecsElapsed() - hashStart;
+            _numHashedBytes += packet.size();
+            
+            if (hashMatches) {
+                sendingNode->getTelemetry().recordPacketReceived(checkType, packet.size());
                 return true;
             } else {
                 qDebug() << "Packet hash mismatch on" << checkType << "- Sender"
@@ -188,6 +212,11 @@ bool LimitedNodeList::packetVersionAndHashMatch(const QByteArray& packet) {
                 << uuidFromPacketHeader(packet);
         }
     } else {
+        // an unverified packet can come from something that isn't a node yet, such as one connecting
+        SharedNodePointer sendingNode = sendingNodeForPacket(packet);
+        if (sendingNode) {
+            sendingNode->getTelemetry().recordPacketReceived(checkType, packet.size());
+        }
         return true;
     }
     
@@ -199,14 +228,30 @@ qint64 LimitedNodeList::writeDatagram(const QByteArray& datagram, const HifiSock
     QByteArray datagramCopy = datagram;
     
     if (!connectionSecret.isNull()) {
-        // setup the MD5 hash for source verification in the header
+        // setup the hash for source verification in the header
+        qint64 hashStart = _packetStatTimer.nsecsElapsed();
         replaceHashInPacketGivenConnectionUUID(datagramCopy, connectionSecret);
+        _hashingNsecs += _packetStatTimer.nsecsElapsed() - hashStart;
+        _numHashedBytes += datagramCopy.size();
     }
     
     // stat collection for packets
     ++_numCollectedPackets;
     _numCollectedBytes += datagram.size();
     
+    if (_isCoalescingControlPackets && datagramCopy.size() <= MAX_COALESCABLE_PACKET_SIZE
+        && COALESCABLE_PACKETS.contains(packetTypeForPacket(datagramCopy))) {
+        QMutexLocker locker(&_coalescedPacketsMutex);
+        _coalescedPackets[destinationSockAddr].append(datagramCopy);
+        
+        if (!_hasCoalescedFlushQueued) {
+            // whatever else is written to the destination in this turn of the event loop goes out with this
+            _hasCoalescedFlushQueued = true;
+            QMetaObject::invokeMethod(this, "flushCoalescedPackets", Qt::QueuedConnection);
+        }
+        return datagramCopy.size();
+    }
+    
     qint64 bytesWritten = _nodeSocket.writeDatagram(datagramCopy,
                                                     destinationSockAddr.getAddress(), destinationSockAddr.getPort());
     
@@ -217,6 +262,109 @@ qint64 LimitedNodeList::writeDatagram(const QByteArray& datagram, const HifiSock
     return bytesWritten;
 }
 
+void LimitedNodeList::setIsCoalescingControlPackets(bool isCoalescingControlPackets) {
+    _isCoalescingControlPackets = isCoalescingControlPackets;
+    
+    if (!isCoalescingControlPackets) {
+        flushCoalescedPackets();
+    }
+}
+
+void LimitedNodeList::flushCoalescedPackets() {
+    QHash<HifiSockAddr, QList<QByteArray> > coalescedPackets;
+    
+    _coalescedPacketsMutex.lock();
+    coalescedPackets.swap(_coalescedPackets);
+    _hasCoalescedFlushQueued = false;
+    _coalescedPacketsMutex.unlock();
+    
+    if (coalescedPackets.isEmpty()) {
+        return;
+    }
+    
+    QByteArray coalescedPacketHeader = byteArrayWithPopulatedHeader(PacketTypeCoalescedPackets);
+    
+    for (QHash<HifiSockAddr, QList<QByteArray> >::const_iterator destination = coalescedPackets.constBegin();
+         destination != coalescedPackets.constEnd(); ++destination) {
+        const HifiSockAddr& destinationSockAddr = destination.key();
+        const QList<QByteArray>& packets = destination.value();
+        
+        // there is nothing to save by wrapping a packet that is on its own
+        QList<QByteArray> datagrams;
+        if (packets.size() == 1) {
+            datagrams.append(packets.first());
+        } else {
+            QByteArray coalescedPacket = coalescedPacketHeader;
+            foreach (const QByteArray& packet, packets) {
+                if (!appendToCoalescedPacket(coalescedPacket, packet, MAX_PACKET_SIZE)) {
+                    datagrams.append(coalescedPacket);
+                    coalescedPacket = coalescedPacketHeader;
+                    appendToCoalescedPacket(coalescedPacket, packet, MAX_PACKET_SIZE);
+                }
+            }
+            datagrams.append(coalescedPacket);
+        }
+        
+        foreach (const QByteArray& datagram, datagrams) {
+            if (_nodeSocket.writeDatagram(datagram, destinationSockAddr.getAddress(), destinationSockAddr.getPort()) < 0) {
+                qDebug() << "ERROR in writeDatagram:" << _nodeSocket.error() << "-" << _nodeSocket.errorString();
+            }
+        }
+    }
+}
+
+qint64 LimitedNodeList::queueDatagram(const QByteArray& datagram, const SharedNodePointer& destinationNode) {
+    if (!destinationNode || !destinationNode->getActiveSocket()) {
+        // we don't have a socket to send to, return 0
+        return 0;
+    }
+    
+    QByteArray datagramCopy = datagram;
+    QUuid connectionSecret = destinationNode->getConnectionSecret();
+    
+    if (!connectionSecret.isNull()) {
+        // setup the hash for source verification in the header
+        qint64 hashStart = _packetStatTimer.nsecsElapsed();
+        replaceHashInPacketGivenConnectionUUID(datagramCopy, connectionSecret);
+        _hashingNsecs += _packetStatTimer.nsecsElapsed() - hashStart;
+        _numHashedBytes += datagramCopy.size();
+    }
+    
+    // stat collection for packets
+    ++_numCollectedPackets;
+    _numCollectedBytes += datagram.size();
+    destinationNode->getTelemetry().recordPacketSent(packetTypeForPacket(datagram), datagram.size());
+    
+    _nodeSocketBatcher.queueDatagram(datagramCopy, *destinationNode->getActiveSocket());
+    return datagram.size();
+}
+
+bool LimitedNodeList::readPendingDatagram(QByteArray& datagram, HifiSockAddr& senderSockAddr) {
+    forever {
+        if (!_uncoalescedPackets.isEmpty()) {
+            datagram = _uncoalescedPackets.takeFirst();
+            senderSockAddr = _uncoalescedSenderSockAddr;
+            return true;
+        }
+        
+        if (!_nodeSocketBatcher.readDatagram(datagram, senderSockAddr)) {
+            return false;
+        }
+        
+        if (packetTypeForPacket(datagram) != PacketTypeCoalescedPackets) {
+            return true;
+        }
+        
+        // the packets inside are checked against their own versions and hashes when they are handed out
+        if (datagram.size() >= numBytesForPacketHeaderGivenPacketType(PacketTypeCoalescedPackets)
+            && datagram[numBytesArithmeticCodingFromBuffer(datagram.constData())]
+                == versionForPacketType(PacketTypeCoalescedPackets)) {
+            _uncoalescedPackets = packetsFromCoalescedPacket(datagram);
+            _uncoalescedSenderSockAddr = senderSockAddr;
+        }
+    }
+}
+
 qint64 LimitedNodeList::writeDatagram(const QByteArray& datagram, const SharedNodePointer& destinationNode,
                                const HifiSockAddr& overridenSockAddr) {
     if (destinationNode) {
@@ -232,6 +380,7 @@ qint64 LimitedNodeList::writeDatagram(const QByteArray& datagram, const SharedNo
             }
         }
         
+        destinationNode->getTelemetry().recordPacketSent(packetTypeForPacket(datagram), datagram.size());
         return writeDatagram(datagram, *destinationSockAddr, destinationNode->getConnectionSecret());
     }
     
@@ -254,6 +403,8 @@ qint64 LimitedNodeList::writeUnverifiedDatagram(const QByteArray& datagram, cons
             }
         }
         
+        destinationNode->getTelemetry().recordPacketSent(packetTypeForPacket(datagram), datagram.size());
+        
         // don't use the node secret!
         return writeDatagram(datagram, *destinationSockAddr, QUuid());
     }
@@ -297,7 +448,13 @@ int LimitedNodeList::updateNodeWithDataFromPacket(const SharedNodePointer& match
     
     QMutexLocker linkedDataLocker(&matchingNode->getLinkedData()->getMutex());
     
-    return matchingNode->getLinkedData()->parseData(packet);
+    // the sequence numbers the data reads show what went missing before the packet
+    quint32 numPacketsLost = matchingNode->getLinkedData()->getNumPacketsLost();
+    int numBytesParsed = matchingNode->getLinkedData()->parseData(packet);
+    numPacketsLost = matchingNode->getLinkedData()->getNumPacketsLost() - numPacketsLost;
+    matchingNode->getTelemetry().recordPacketsLost((int) numPacketsLost);
+    
+    return numBytesParsed;
 }
 
 int LimitedNodeList::findNodeAndUpdateWithDataFromPacket(const QByteArray& packet) {
@@ -316,26 +473,81 @@ SharedNodePointer LimitedNodeList::nodeWithUUID(const QUuid& nodeUUID, bool bloc
     SharedNodePointer node;
     // if caller wants us to block and guarantee the correct answer, then honor that request
     if (blockingLock) {
-        // this will block till we can get access
-        QMutexLocker locker(&_nodeHashMutex);
+        // this will block only while a writer swaps in a new table
+        QReadLocker locker(&_nodeHashLock);
         node = _nodeHash.value(nodeUUID);
-    } else if (_nodeHashMutex.tryLock(WAIT_TIME)) { // some callers are willing to get wrong answers but not block
+    } else if (_nodeHashLock.tryLockForRead(WAIT_TIME)) { // some callers are willing to get wrong answers but not block
         node = _nodeHash.value(nodeUUID);
-        _nodeHashMutex.unlock();
+        _nodeHashLock.unlock();
     }
     return node;
  }
 
+/// The lookup table a thread last took and the node it last matched, so that a run of packets from one sender is found
+/// with a compare of the UUID bytes
+class NodeLookupCache {
+public:
+    NodeLookupCache() : generation(-1) { }
+
+    int generation;
+    QSharedPointer<const NodeLookupTable> table;
+    char lastUUIDBytes[NUM_BYTES_RFC4122_UUID];
+    SharedNodePointer lastNode;
+};
+
+static NodeLookupCache* getThreadNodeLookupCache() {
+    static QThreadStorage<NodeLookupCache*> caches;
+    if (!caches.hasLocalData()) {
+        caches.setLocalData(new NodeLookupCache());
+    }
+    return caches.localData();
+}
+
 SharedNodePointer LimitedNodeList::sendingNodeForPacket(const QByteArray& packet) {
-    QUuid nodeUUID = uuidFromPacketHeader(packet);
+    NodeLookupCache* cache = getThreadNodeLookupCache();
+    if (cache->generation != _nodeHashGeneration.loadAcquire()) {
+        // the nodes have changed, so the thread takes the new table (and lets go of the nodes killed in the old one)
+        QReadLocker locker(&_nodeHashLock);
+        cache->table = _nodeLookupTable;
+        cache->generation = _nodeHashGeneration.load();
+        cache->lastNode.clear();
+    }
+    const char* uuidBytes = uuidBytesFromPacketHeader(packet);
+    if (cache->lastNode && memcmp(uuidBytes, cache->lastUUIDBytes, NUM_BYTES_RFC4122_UUID) == 0) {
+        return cache->lastNode;
+    }
     
     // return the matching node, or NULL if there is no match
-    return nodeWithUUID(nodeUUID);
+    SharedNodePointer node = cache->table->find(uuidBytes);
+    if (node) {
+        memcpy(cache->lastUUIDBytes, uuidBytes, NUM_BYTES_RFC4122_UUID);
+        cache->lastNode = node;
+    }
+    return node;
 }
 
 NodeHash LimitedNodeList::getNodeHash() {
-    QMutexLocker locker(&_nodeHashMutex);
-    return NodeHash(_nodeHash);
+    // the published table is never changed in place, so the copy only takes a reference to it
+    QReadLocker locker(&_nodeHashLock);
+    return _nodeHash;
+}
+
+int LimitedNodeList::size() const {
+    QReadLocker locker(&_nodeHashLock);
+    return _nodeHash.size();
+}
+
+void LimitedNodeList::publishNodeHash(NodeHash& newNodeHash) {
+    // the lookup table is built before taking the lock, and the one it replaces is freed after letting go of it
+    QSharedPointer<const NodeLookupTable> lookupTable(new NodeLookupTable(newNodeHash));
+    
+    QWriteLocker locker(&_nodeHashLock);
+    
+    // the table that was published ends up in newNodeHash, and is freed by the caller (or the last reader that still
+    // has a snapshot of it) outside of the lock
+    _nodeHash.swap(newNodeHash);
+    _nodeLookupTable.swap(lookupTable);
+    _nodeHashGeneration.fetchAndAddOrdered(1);
 }
 
 void LimitedNodeList::eraseAllNodes() {
@@ -343,12 +555,15 @@ void LimitedNodeList::eraseAllNodes() {
     
     QMutexLocker locker(&_nodeHashMutex);
 
-    NodeHash::iterator nodeItem = _nodeHash.begin();
+    NodeHash nodeHash = _nodeHash;
+    NodeHash::iterator nodeItem = nodeHash.begin();
 
     // iterate the nodes in the list
-    while (nodeItem != _nodeHash.end()) {
-        nodeItem = killNodeAtHashIterator(nodeItem);
+    while (nodeItem != nodeHash.end()) {
+        nodeItem = killNodeAtHashIterator(nodeHash, nodeItem);
     }
+    
+    publishNodeHash(nodeHash);
 }
 
 void LimitedNodeList::reset() {
@@ -358,16 +573,19 @@ void LimitedNodeList::reset() {
 void LimitedNodeList::killNodeWithUUID(const QUuid& nodeUUID) {
     QMutexLocker locker(&_nodeHashMutex);
     
-    NodeHash::iterator nodeItemToKill = _nodeHash.find(nodeUUID);
-    if (nodeItemToKill != _nodeHash.end()) {
-        killNodeAtHashIterator(nodeItemToKill);
+    if (_nodeHash.contains(nodeUUID)) {
+        NodeHash nodeHash = _nodeHash;
+        NodeHash::iterator nodeItemToKill = nodeHash.find(nodeUUID);
+        killNodeAtHashIterator(nodeHash, nodeItemToKill);
+        
+        publishNodeHash(nodeHash);
     }
 }
 
-NodeHash::iterator LimitedNodeList::killNodeAtHashIterator(NodeHash::iterator& nodeItemToKill) {
+NodeHash::iterator LimitedNodeList::killNodeAtHashIterator(NodeHash& nodeHash, NodeHash::iterator& nodeItemToKill) {
     qDebug() << "Killed" << *nodeItemToKill.value();
     emit nodeKilled(nodeItemToKill.value());
-    return _nodeHash.erase(nodeItemToKill);
+    return nodeHash.erase(nodeItemToKill);
 }
 
 void LimitedNodeList::processKillNode(const QByteArray& dataByteArray) {
@@ -388,7 +606,10 @@ SharedNodePointer LimitedNodeList::addOrUpdateNode(const QUuid& uuid, NodeType_t
         Node* newNode = new Node(uuid, nodeType, publicSocket, localSocket);
         SharedNodePointer newNodeSharedPointer(newNode, &QObject::deleteLater);
         
-        _nodeHash.insert(newNode->getUUID(), newNodeSharedPointer);
+        // the new table is built beside the published one, so that readers don't wait on the copy
+        NodeHash nodeHash = _nodeHash;
+        nodeHash.insert(newNode->getUUID(), newNodeSharedPointer);
+        publishNodeHash(nodeHash);
         
         _nodeHashMutex.unlock();
         
@@ -459,32 +680,122 @@ void LimitedNodeList::getPacketStats(float& packetsPerSecond, float& bytesPerSec
     bytesPerSecond = (float) _numCollectedBytes / ((float) _packetStatTimer.elapsed() / 1000.0f);
 }
 
+void LimitedNodeList::getPacketHashStats(float& hashedBytesPerSecond, float& hashedBytesPerHashingSecond) {
+    hashedBytesPerSecond = (float) _numHashedBytes / ((float) _packetStatTimer.elapsed() / 1000.0f);
+    hashedBytesPerHashingSecond = (_hashingNsecs > 0) ? (float) _numHashedBytes / ((float) _hashingNsecs / 1.0e9f) : 0.0f;
+}
+
 void LimitedNodeList::resetPacketStats() {
     _numCollectedPackets = 0;
     _numCollectedBytes = 0;
+    _numHashedBytes = 0;
+    _hashingNsecs = 0;
     _packetStatTimer.restart();
 }
 
+QJsonObject LimitedNodeList::getTelemetryJSON() {
+    QJsonObject telemetryJSON;
+    QJsonArray nodesJSON;
+    
+    foreach (const SharedNodePointer& node, getNodeHash()) {
+        QJsonObject nodeJSON;
+        nodeJSON["uuid"] = uuidStringWithoutCurlyBraces(node->getUUID());
+        nodeJSON["type"] = NodeType::getNodeTypeName(node->getType());
+        nodeJSON["samples"] = node->getTelemetry().samplesToJSON();
+        nodesJSON.append(nodeJSON);
+    }
+    
+    telemetryJSON["sample_msecs"] = (double) (NODE_TELEMETRY_SAMPLE_USECS / USECS_PER_MSEC);
+    telemetryJSON["nodes"] = nodesJSON;
+    return telemetryJSON;
+}
+
+// the lines of a Prometheus family of one of the packet type counters, for each node and type
+static void appendPacketTypeFamily(QString& text, const char* name, const char* help,
+                                   quint64 PacketTypeTelemetry::* counter, const QStringList& nodeLabels,
+                                   const QList<NodeTelemetrySample>& nodeTotals) {
+    text += QString("# HELP %1 %2\n# TYPE %1 counter\n").arg(name, help);
+    for (int i = 0; i < nodeTotals.size(); i++) {
+        const QHash<PacketType, PacketTypeTelemetry>& packetTypes = nodeTotals.at(i).packetTypes;
+        for (QHash<PacketType, PacketTypeTelemetry>::const_iterator type = packetTypes.constBegin();
+             type != packetTypes.constEnd(); ++type) {
+            text += QString("%1{%2,packet_type=\"%3\"} %4\n").arg(name, nodeLabels.at(i)).arg(type.key())
+                .arg(type.value().*counter);
+        }
+    }
+}
+
+QByteArray LimitedNodeList::getTelemetryPrometheusText() {
+    // the totals are all taken up front, since the lines of a family have to be together
+    QStringList nodeLabels;
+    QList<NodeTelemetrySample> nodeTotals;
+    foreach (const SharedNodePointer& node, getNodeHash()) {
+        nodeLabels.append(QString("node=\"%1\",node_type=\"%2\"").arg(uuidStringWithoutCurlyBraces(node->getUUID()),
+                                                                       NodeType::getNodeTypeName(node->getType())));
+        nodeTotals.append(node->getTelemetry().getTotals());
+    }
+    
+    QString text;
+    appendPacketTypeFamily(text, "hifi_node_packets_sent_total", "Packets sent to the node.",
+                           &PacketTypeTelemetry::packetsSent, nodeLabels, nodeTotals);
+    appendPacketTypeFamily(text, "hifi_node_bytes_sent_total", "Bytes sent to the node.",
+                           &PacketTypeTelemetry::bytesSent, nodeLabels, nodeTotals);
+    appendPacketTypeFamily(text, "hifi_node_packets_received_total", "Packets received from the node.",
+                           &PacketTypeTelemetry::packetsReceived, nodeLabels, nodeTotals);
+    appendPacketTypeFamily(text, "hifi_node_bytes_received_total", "Bytes received from the node.",
+                           &PacketTypeTelemetry::bytesReceived, nodeLabels, nodeTotals);
+    
+    text += "# HELP hifi_node_packets_lost_total Packets from the node its sequence numbers show were lost.\n"
+        "# TYPE hifi_node_packets_lost_total counter\n";
+    for (int i = 0; i < nodeTotals.size(); i++) {
+        text += QString("hifi_node_packets_lost_total{%1} %2\n").arg(nodeLabels.at(i)).arg(nodeTotals.at(i).packetsLost);
+    }
+    
+    text += "# HELP hifi_node_ping_ms The last round trip time measured to the node.\n"
+        "# TYPE hifi_node_ping_ms gauge\n";
+    for (int i = 0; i < nodeTotals.size(); i++) {
+        text += QString("hifi_node_ping_ms{%1} %2\n").arg(nodeLabels.at(i)).arg(nodeTotals.at(i).pingMs);
+    }
+    
+    text += "# HELP hifi_node_queue_delay_usecs How long the packets from the node waited to be processed.\n"
+        "# TYPE hifi_node_queue_delay_usecs summary\n";
+    for (int i = 0; i < nodeTotals.size(); i++) {
+        text += QString("hifi_node_queue_delay_usecs_sum{%1} %2\n").arg(nodeLabels.at(i))
+            .arg(nodeTotals.at(i).totalQueueDelayUsecs);
+        text += QString("hifi_node_queue_delay_usecs_count{%1} %2\n").arg(nodeLabels.at(i))
+            .arg(nodeTotals.at(i).numQueueDelays);
+    }
+    
+    return text.toUtf8();
+}
+
 void LimitedNodeList::removeSilentNodes() {
 
     _nodeHashMutex.lock();
     
-    NodeHash::iterator nodeItem = _nodeHash.begin();
-
-    while (nodeItem != _nodeHash.end()) {
+    NodeHash nodeHash = _nodeHash;
+    
+    // the silent nodes are found without changing the snapshot, so that the table is only copied if one is killed
+    QList<QUuid> silentNodeUUIDs;
+    
+    for (NodeHash::const_iterator nodeItem = nodeHash.constBegin(); nodeItem != nodeHash.constEnd(); ++nodeItem) {
         SharedNodePointer node = nodeItem.value();
 
-        node->getMutex().lock();
+        QMutexLocker nodeLocker(&node->getMutex());
 
         if ((usecTimestampNow() - node->getLastHeardMicrostamp()) > (NODE_SILENCE_THRESHOLD_MSECS * 1000)) {
+            silentNodeUUIDs.append(nodeItem.key());
+        }
+    }
+    
+    if (!silentNodeUUIDs.isEmpty()) {
+        foreach (const QUuid& nodeUUID, silentNodeUUIDs) {
             // call our private method to kill this node (removes it and emits the right signal)
-            nodeItem = killNodeAtHashIterator(nodeItem);
-        } else {
-            // we didn't kill this node, push the iterator forwards
-            ++nodeItem;
+            NodeHash::iterator nodeItemToKill = nodeHash.find(nodeUUID);
+            killNodeAtHashIterator(nodeHash, nodeItemToKill);
         }
         
-        node->getMutex().unlock();
+        publishNodeHash(nodeHash);
     }
     
     _nodeHashMutex.unlock();
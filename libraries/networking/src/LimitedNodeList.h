@@ -19,16 +19,21 @@
 #include <unistd.h> // not on windows, not needed for mac or windows
 #endif
 
+#include <QtCore/QAtomicInt>
 #include <QtCore/QElapsedTimer>
+#include <QtCore/QJsonObject>
 #include <QtCore/QMutex>
+#include <QtCore/QReadWriteLock>
 #include <QtCore/QSet>
 #include <QtCore/QSettings>
 #include <QtCore/QSharedPointer>
 #include <QtNetwork/QHostAddress>
 #include <QtNetwork/QUdpSocket>
 
+#include "DatagramBatcher.h"
 #include "DomainHandler.h"
 #include "Node.h"
+#include "NodeLookupTable.h"
 
 const int MAX_PACKET_SIZE = 1500;
 
@@ -69,6 +74,23 @@ public:
                                const HifiSockAddr& overridenSockAddr = HifiSockAddr());
 
     qint64 writeUnverifiedDatagram(const QByteArray& datagram, const HifiSockAddr& destinationSockAddr);
+    
+    /// queues a datagram for destinationNode the way writeDatagram would send it, to go out with the others queued by
+    /// the next flushQueuedDatagrams in as few calls as the platform can, returns the number of bytes queued
+    qint64 queueDatagram(const QByteArray& datagram, const SharedNodePointer& destinationNode);
+    
+    /// sends the datagrams queued by queueDatagram
+    void flushQueuedDatagrams() { _nodeSocketBatcher.flush(); }
+    
+    /// reads the next datagram that has arrived on the node socket, which reads all of those waiting at once where the
+    /// platform can so that receiving a batch costs one call, and hands out the packets of a PacketTypeCoalescedPackets
+    /// one at a time as though each had come on its own
+    bool readPendingDatagram(QByteArray& datagram, HifiSockAddr& senderSockAddr);
+    
+    /// sets whether the small control packets written to a destination in one turn of the event loop go out to it
+    /// together in a PacketTypeCoalescedPackets, which they do unless this is turned off
+    void setIsCoalescingControlPackets(bool isCoalescingControlPackets);
+    bool isCoalescingControlPackets() const { return _isCoalescingControlPackets; }
     qint64 writeDatagram(const char* data, qint64 size, const SharedNodePointer& destinationNode,
                          const HifiSockAddr& overridenSockAddr = HifiSockAddr());
 
@@ -77,10 +99,15 @@ public:
 
     void(*linkedDataCreateCallback)(Node *);
 
+    /// returns a snapshot of the nodes, which is only a reference to the published table and so can be iterated
+    /// without copying it or holding any lock, while nodes are added and killed
     NodeHash getNodeHash();
-    int size() const { return _nodeHash.size(); }
+    int size() const;
 
     SharedNodePointer nodeWithUUID(const QUuid& nodeUUID, bool blockingLock = true);
+    
+    /// returns the node that sent the packet from the UUID bytes in its header, without taking a lock or building a
+    /// QUuid unless the nodes have changed since the calling thread last looked one up
     SharedNodePointer sendingNodeForPacket(const QByteArray& packet);
     
     SharedNodePointer addOrUpdateNode(const QUuid& uuid, NodeType_t nodeType,
@@ -98,7 +125,17 @@ public:
     SharedNodePointer soloNodeOfType(char nodeType);
 
     void getPacketStats(float &packetsPerSecond, float &bytesPerSecond);
+    
+    /// gets the bytes of packets hashed for verification each second, and how many of them hashing gets through in a
+    /// second of the time it takes
+    void getPacketHashStats(float& hashedBytesPerSecond, float& hashedBytesPerHashingSecond);
     void resetPacketStats();
+    
+    /// the telemetry of each node, with the time series of its last minute
+    QJsonObject getTelemetryJSON();
+    
+    /// the telemetry totals of each node in the Prometheus text format, for a scraper to take the rates of
+    QByteArray getTelemetryPrometheusText();
 public slots:
     void reset();
     void eraseAllNodes();
@@ -106,6 +143,9 @@ public slots:
     void removeSilentNodes();
     
     void killNodeWithUUID(const QUuid& nodeUUID);
+    
+    /// sends the control packets coalesced since the last flush, called at the start of the turn after they were written
+    void flushCoalescedPackets();
 signals:
     void uuidChanged(const QUuid& ownerUUID);
     void nodeAdded(SharedNodePointer);
@@ -120,19 +160,36 @@ protected:
     qint64 writeDatagram(const QByteArray& datagram, const HifiSockAddr& destinationSockAddr,
                          const QUuid& connectionSecret);
 
-    NodeHash::iterator killNodeAtHashIterator(NodeHash::iterator& nodeItemToKill);
+    NodeHash::iterator killNodeAtHashIterator(NodeHash& nodeHash, NodeHash::iterator& nodeItemToKill);
+    
+    /// swaps newNodeHash in as the published table, leaving the table that it replaces in newNodeHash
+    void publishNodeHash(NodeHash& newNodeHash);
 
     
     void changeSendSocketBufferSize(int numSendBytes);
 
     QUuid _sessionUUID;
-    NodeHash _nodeHash;
-    QMutex _nodeHashMutex;
+    NodeHash _nodeHash; /// the published table, which is replaced rather than changed once readers can see it
+    QMutex _nodeHashMutex; /// held by whoever is changing the nodes, readers never take it
+    mutable QReadWriteLock _nodeHashLock; /// only held for writing while a new table is swapped in
+    QSharedPointer<const NodeLookupTable> _nodeLookupTable; /// built with each table published, under _nodeHashLock
+    QAtomicInt _nodeHashGeneration; /// counts the tables published, so that threads know when to take the new one
     QUdpSocket _nodeSocket;
+    DatagramBatcher _nodeSocketBatcher;
     QUdpSocket* _dtlsSocket;
     int _numCollectedPackets;
     int _numCollectedBytes;
+    qint64 _numHashedBytes;
+    qint64 _hashingNsecs;
     QElapsedTimer _packetStatTimer;
+    
+    bool _isCoalescingControlPackets;
+    QMutex _coalescedPacketsMutex;
+    QHash<HifiSockAddr, QList<QByteArray> > _coalescedPackets; /// guarded by _coalescedPacketsMutex
+    bool _hasCoalescedFlushQueued; /// guarded by _coalescedPacketsMutex
+    
+    QList<QByteArray> _uncoalescedPackets; /// the packets left of the last PacketTypeCoalescedPackets read
+    HifiSockAddr _uncoalescedSenderSockAddr;
 };
 
 #endif // hifi_LimitedNodeList_h
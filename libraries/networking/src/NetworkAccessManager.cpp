@@ -9,6 +9,8 @@
 //  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
 //
 
+#include <QNetworkDiskCache>
+#include <QStandardPaths>
 #include <QThreadStorage>
 
 #include "NetworkAccessManager.h"
@@ -25,3 +27,12 @@ NetworkAccessManager& NetworkAccessManager::getInstance() {
 
 NetworkAccessManager::NetworkAccessManager() {
 }
+
+void NetworkAccessManager::setupDiskCache(const QString& fallbackDirectory) {
+    QString cachePath = QStandardPaths::writableLocation(QStandardPaths::DataLocation);
+    
+    QNetworkDiskCache* cache = new QNetworkDiskCache();
+    cache->setCacheDirectory(!cachePath.isEmpty() ? cachePath : fallbackDirectory);
+    cache->setMaximumCacheSize(MAXIMUM_DISK_CACHE_BYTES);
+    setCache(cache);
+}
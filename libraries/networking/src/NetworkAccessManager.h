@@ -14,12 +14,20 @@
 
 #include <QNetworkAccessManager>
 
+/// the most the disk cache keeps, which is well past the 50MB QNetworkDiskCache defaults to so that the models and
+/// textures of a domain are still there the next time it is entered
+const qint64 MAXIMUM_DISK_CACHE_BYTES = 1024 * 1024 * 1024;
+
 /// Wrapper around QNetworkAccessManager to restrict at one instance by thread
 class NetworkAccessManager : public QNetworkAccessManager {
     Q_OBJECT
 public:
     static NetworkAccessManager& getInstance();
     
+    /// gives the manager a disk cache in the data location, or in fallbackDirectory if there is none. What is cached
+    /// is revalidated with its ETag or Last-Modified once it expires, so an unchanged file isn't downloaded again.
+    void setupDiskCache(const QString& fallbackDirectory);
+    
 private:
     NetworkAccessManager();
 };
@@ -39,6 +39,7 @@ public:
 
     const SharedNodePointer& getNode() const { return _node; }
     const QByteArray& getByteArray() const { return _byteArray; }
+    QByteArray& getByteArray() { return _byteArray; }
 
 private:
     void copyContents(const SharedNodePointer& node, const QByteArray& byteArray);
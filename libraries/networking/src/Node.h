@@ -22,6 +22,7 @@
 
 #include "HifiSockAddr.h"
 #include "NodeData.h"
+#include "NodeTelemetry.h"
 #include "SimpleMovingAverage.h"
 #include "MovingPercentile.h"
 
@@ -92,12 +93,15 @@ public:
     float getAveragePacketsPerSecond();
 
     int getPingMs() const { return _pingMs; }
-    void setPingMs(int pingMs) { _pingMs = pingMs; }
+    void setPingMs(int pingMs) { _pingMs = pingMs; _telemetry.recordPingMs(pingMs); }
 
     int getClockSkewUsec() const { return _clockSkewUsec; }
     void updateClockSkewUsec(int clockSkewSample);
     QMutex& getMutex() { return _mutex; }
     
+    /// the counts of what the node sends and is sent, which don't need the node's mutex
+    NodeTelemetry& getTelemetry() { return _telemetry; }
+    
     friend QDataStream& operator<<(QDataStream& out, const Node& node);
     friend QDataStream& operator>>(QDataStream& in, Node& node);
 
@@ -122,6 +126,7 @@ private:
     int _clockSkewUsec;
     QMutex _mutex;
     MovingPercentile _clockSkewMovingPercentile;
+    NodeTelemetry _telemetry;
 };
 
 QDebug operator<<(QDebug debug, const Node &message);
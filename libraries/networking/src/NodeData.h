@@ -24,6 +24,9 @@ public:
     virtual ~NodeData() = 0;
     virtual int parseData(const QByteArray& packet) = 0;
     
+    /// the packets from the node that the sequence numbers of its streams show were lost, for its telemetry
+    virtual quint32 getNumPacketsLost() const { return 0; }
+    
     QMutex& getMutex() { return _mutex; }
 
 private:
@@ -59,13 +59,20 @@ NodeList::NodeList(char newOwnerType, unsigned short socketListenPort, unsigned
     _assignmentServerSocket(),
     _publicSockAddr(),
     _hasCompletedInitialSTUNFailure(false),
-    _stunRequestsSinceSuccess(0)
+    _stunRequestsSinceSuccess(0),
+    _domainListVersion(0),
+    _pendingDomainListVersion(0),
+    _numPendingDomainListEntries(0),
+    _isProcessingDomainList(false)
 {
     // clear our NodeList when the domain changes
     connect(&_domainHandler, &DomainHandler::hostnameChanged, this, &NodeList::reset);
     
     // clear our NodeList when logout is requested
     connect(&AccountManager::getInstance(), &AccountManager::logoutComplete , this, &NodeList::reset);
+    
+    // a node we drop on our own is one the domain-server thinks we still have, so we ask for the whole list again
+    connect(this, &LimitedNodeList::nodeKilled, this, &NodeList::nodeKilledOutsideDomainList);
 }
 
 qint64 NodeList::sendStatsToDomainServer(const QJsonObject& statsObject) {
@@ -173,6 +180,10 @@ void NodeList::reset() {
     LimitedNodeList::reset();
     
     _numNoReplyDomainCheckIns = 0;
+    
+    _domainListVersion = 0;
+    _pendingDomainListVersion = 0;
+    _numPendingDomainListEntries = 0;
 
     // refresh the owner UUID to the NULL UUID
     setSessionUUID(QUuid());
@@ -364,6 +375,9 @@ void NodeList::sendDomainServerCheckIn() {
             packetStream << nodeTypeOfInterest;
         }
         
+        // so that it only has to send us what changed since
+        packetStream << _domainListVersion;
+        
         if (!isUsingDTLS) {
             writeDatagram(domainServerPacket, _domainHandler.getSockAddr(), QUuid());
         }
@@ -410,10 +424,36 @@ int NodeList::processDomainServerList(const QByteArray& packet) {
     // pull our owner UUID from the packet, it's always the first thing
     QUuid newUUID;
     packetStream >> newUUID;
+    if (newUUID != getSessionUUID()) {
+        // a new session starts from nothing
+        _domainListVersion = 0;
+    }
     setSessionUUID(newUUID);
     
+    // then the version of the list the packets with this version bring us up to, and how many entries they hold
+    quint32 listVersion;
+    quint16 numEntries;
+    packetStream >> listVersion >> numEntries;
+    
+    if (listVersion != _pendingDomainListVersion) {
+        _pendingDomainListVersion = listVersion;
+        _numPendingDomainListEntries = 0;
+    }
+    
+    _isProcessingDomainList = true;
+    
     // pull each node in the packet
     while(packetStream.device()->pos() < packet.size()) {
+        quint8 isRemoval;
+        packetStream >> isRemoval;
+        _numPendingDomainListEntries++;
+        
+        if (isRemoval) {
+            packetStream >> nodeUUID;
+            killNodeWithUUID(nodeUUID);
+            continue;
+        }
+        
         packetStream >> nodeType >> nodeUUID >> nodePublicSocket >> nodeLocalSocket;
 
         // if the public socket address is 0 then it's reachable at the same IP
@@ -426,6 +466,15 @@ int NodeList::processDomainServerList(const QByteArray& packet) {
         
         packetStream >> connectionUUID;
         node->setConnectionSecret(connectionUUID);
+        readNodes++;
+    }
+    
+    _isProcessingDomainList = false;
+    
+    // we are only up to this version once every packet of it has come in, a lost one is sent again from the version
+    // we were at before
+    if (_numPendingDomainListEntries >= numEntries) {
+        _domainListVersion = listVersion;
     }
     
     // ping inactive nodes in conjunction with receipt of list from domain-server
@@ -435,6 +484,12 @@ int NodeList::processDomainServerList(const QByteArray& packet) {
     return readNodes;
 }
 
+void NodeList::nodeKilledOutsideDomainList() {
+    if (!_isProcessingDomainList) {
+        _domainListVersion = 0;
+    }
+}
+
 void NodeList::sendAssignment(Assignment& assignment) {
     
     PacketType assignmentPacketType = assignment.getCommand() == Assignment::CreateCommand
@@ -56,6 +56,10 @@ public:
     qint64 sendStatsToDomainServer(const QJsonObject& statsObject);
 
     int getNumNoReplyDomainCheckIns() const { return _numNoReplyDomainCheckIns; }
+
+    /// the version of the domain's node list that the nodes we have are up to date with, the domain-server only sends
+    /// what changed since it, or the whole list when it is 0
+    quint32 getDomainListVersion() const { return _domainListVersion; }
     DomainHandler& getDomainHandler() { return _domainHandler; }
     
     const NodeSet& getNodeInterestSet() const { return _nodeTypesOfInterest; }
@@ -81,6 +85,8 @@ public slots:
     void reset();
     void sendDomainServerCheckIn();
     void pingInactiveNodes();
+private slots:
+    void nodeKilledOutsideDomainList();
 signals:
     void limitOfSilentDomainCheckInsReached();
 private:
@@ -105,6 +111,11 @@ private:
     HifiSockAddr _publicSockAddr;
     bool _hasCompletedInitialSTUNFailure;
     unsigned int _stunRequestsSinceSuccess;
+
+    quint32 _domainListVersion;
+    quint32 _pendingDomainListVersion; /// the version the list packets being read bring us up to
+    int _numPendingDomainListEntries; /// how many of its entries have been read
+    bool _isProcessingDomainList;
 };
 
 #endif // hifi_NodeList_h
@@ -0,0 +1,72 @@
+//
+//  NodeLookupTable.cpp
+//  libraries/networking/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#include <cstring>
+
+#include "NodeLookupTable.h"
+
+const int MIN_NODE_LOOKUP_CAPACITY = 8;
+
+NodeLookupTable::NodeLookupTable() :
+    _entries(MIN_NODE_LOOKUP_CAPACITY),
+    _indexMask(MIN_NODE_LOOKUP_CAPACITY - 1),
+    _size(0) {
+}
+
+NodeLookupTable::NodeLookupTable(const QHash<QUuid, QSharedPointer<Node> >& nodeHash) :
+    _size(nodeHash.size()) {
+
+    int capacity = MIN_NODE_LOOKUP_CAPACITY;
+    while (capacity < _size * 2) {
+        capacity <<= 1;
+    }
+    _entries.resize(capacity);
+    _indexMask = capacity - 1;
+
+    for (QHash<QUuid, QSharedPointer<Node> >::const_iterator it = nodeHash.constBegin();
+            it != nodeHash.constEnd(); it++) {
+        // the key is the UUID laid out as it is in packet headers, read as two words in whatever order the CPU has
+        QByteArray uuidBytes = it.key().toRfc4122();
+        quint64 high, low;
+        memcpy(&high, uuidBytes.constData(), sizeof(quint64));
+        memcpy(&low, uuidBytes.constData() + sizeof(quint64), sizeof(quint64));
+
+        int index = getFirstIndex(high, low);
+        while (_entries.at(index).node) {
+            index = (index + 1) & _indexMask;
+        }
+        Entry& entry = _entries[index];
+        entry.high = high;
+        entry.low = low;
+        entry.node = it.value();
+    }
+}
+
+QSharedPointer<Node> NodeLookupTable::find(const char* uuidBytes) const {
+    quint64 high, low;
+    memcpy(&high, uuidBytes, sizeof(quint64));
+    memcpy(&low, uuidBytes + sizeof(quint64), sizeof(quint64));
+
+    for (int index = getFirstIndex(high, low);; index = (index + 1) & _indexMask) {
+        const Entry& entry = _entries.at(index);
+        if (!entry.node) {
+            return QSharedPointer<Node>();
+        }
+        if (entry.high == high && entry.low == low) {
+            return entry.node;
+        }
+    }
+}
+
+int NodeLookupTable::getFirstIndex(quint64 high, quint64 low) const {
+    // the UUIDs are mostly random already, so the words only need folding together and their bits spreading
+    const quint64 GOLDEN_RATIO_MULTIPLIER = Q_UINT64_C(0x9E3779B97F4A7C15);
+    return (int)(((high ^ low) * GOLDEN_RATIO_MULTIPLIER) >> 32) & _indexMask;
+}
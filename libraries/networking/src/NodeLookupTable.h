@@ -0,0 +1,50 @@
+//
+//  NodeLookupTable.h
+//  libraries/networking/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#ifndef hifi_NodeLookupTable_h
+#define hifi_NodeLookupTable_h
+
+#include <QtCore/QHash>
+#include <QtCore/QSharedPointer>
+#include <QtCore/QVector>
+
+#include "Node.h"
+
+/// A flat table of the nodes keyed on the bytes of their UUIDs as they are in packet headers, so that the sender of a
+/// packet is found without building a QUuid. Open addressed with linear probing and kept at most half full, so a
+/// lookup is usually a single probe. It's never changed once built; a new one is built whenever the nodes change.
+class NodeLookupTable {
+public:
+
+    NodeLookupTable();
+    NodeLookupTable(const QHash<QUuid, QSharedPointer<Node> >& nodeHash);
+
+    int size() const { return _size; }
+
+    /// returns the node whose UUID is in the NUM_BYTES_RFC4122_UUID bytes given, or a null pointer if there is none
+    QSharedPointer<Node> find(const char* uuidBytes) const;
+
+private:
+
+    class Entry {
+    public:
+        quint64 high;
+        quint64 low;
+        QSharedPointer<Node> node; /// null if the entry is empty
+    };
+
+    int getFirstIndex(quint64 high, quint64 low) const;
+
+    QVector<Entry> _entries;
+    int _indexMask;
+    int _size;
+};
+
+#endif // hifi_NodeLookupTable_h
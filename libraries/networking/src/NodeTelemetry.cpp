@@ -0,0 +1,151 @@
+//
+//  NodeTelemetry.cpp
+//  libraries/networking/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#include <algorithm>
+
+#include <QtCore/QJsonObject>
+
+#include "NodeTelemetry.h"
+
+NodeTelemetrySample::NodeTelemetrySample() :
+    startTime(0),
+    packetTypes(),
+    packetsLost(0),
+    totalQueueDelayUsecs(0),
+    numQueueDelays(0),
+    pingMs(0)
+{
+}
+
+NodeTelemetry::NodeTelemetry() :
+    _mutex(),
+    _samples(NODE_TELEMETRY_SAMPLE_CAPACITY),
+    _currentSample(0),
+    _numSamples(1),
+    _totals()
+{
+    _samples[0].startTime = _totals.startTime = usecTimestampNow();
+}
+
+NodeTelemetrySample& NodeTelemetry::currentSample(quint64 now) {
+    NodeTelemetrySample& current = _samples[_currentSample];
+    if (now < current.startTime + NODE_TELEMETRY_SAMPLE_USECS) {
+        return current;
+    }
+
+    // the intervals that nothing happened in get empty samples, up to a ring of them
+    quint64 numPassed = (now - current.startTime) / NODE_TELEMETRY_SAMPLE_USECS;
+    quint64 newestStartTime = current.startTime + numPassed * NODE_TELEMETRY_SAMPLE_USECS;
+    int lastPingMs = current.pingMs;
+
+    int numNewSamples = (int) std::min(numPassed, (quint64) NODE_TELEMETRY_SAMPLE_CAPACITY);
+    for (int i = numNewSamples - 1; i >= 0; i--) {
+        _currentSample = (_currentSample + 1) % NODE_TELEMETRY_SAMPLE_CAPACITY;
+        _samples[_currentSample] = NodeTelemetrySample();
+        _samples[_currentSample].startTime = newestStartTime - i * NODE_TELEMETRY_SAMPLE_USECS;
+        _samples[_currentSample].pingMs = lastPingMs;
+    }
+    _numSamples = std::min(_numSamples + numNewSamples, NODE_TELEMETRY_SAMPLE_CAPACITY);
+
+    return _samples[_currentSample];
+}
+
+void NodeTelemetry::recordPacketSent(PacketType type, int numBytes) {
+    QMutexLocker locker(&_mutex);
+    PacketTypeTelemetry& sampleTypeTelemetry = currentSample(usecTimestampNow()).packetTypes[type];
+    sampleTypeTelemetry.packetsSent++;
+    sampleTypeTelemetry.bytesSent += numBytes;
+
+    PacketTypeTelemetry& totalTypeTelemetry = _totals.packetTypes[type];
+    totalTypeTelemetry.packetsSent++;
+    totalTypeTelemetry.bytesSent += numBytes;
+}
+
+void NodeTelemetry::recordPacketReceived(PacketType type, int numBytes) {
+    QMutexLocker locker(&_mutex);
+    PacketTypeTelemetry& sampleTypeTelemetry = currentSample(usecTimestampNow()).packetTypes[type];
+    sampleTypeTelemetry.packetsReceived++;
+    sampleTypeTelemetry.bytesReceived += numBytes;
+
+    PacketTypeTelemetry& totalTypeTelemetry = _totals.packetTypes[type];
+    totalTypeTelemetry.packetsReceived++;
+    totalTypeTelemetry.bytesReceived += numBytes;
+}
+
+void NodeTelemetry::recordPacketsLost(int numLost) {
+    if (numLost <= 0) {
+        return;
+    }
+    QMutexLocker locker(&_mutex);
+    currentSample(usecTimestampNow()).packetsLost += numLost;
+    _totals.packetsLost += numLost;
+}
+
+void NodeTelemetry::recordQueueDelay(quint64 queueDelayUsecs) {
+    QMutexLocker locker(&_mutex);
+    NodeTelemetrySample& sample = currentSample(usecTimestampNow());
+    sample.totalQueueDelayUsecs += queueDelayUsecs;
+    sample.numQueueDelays++;
+
+    _totals.totalQueueDelayUsecs += queueDelayUsecs;
+    _totals.numQueueDelays++;
+}
+
+void NodeTelemetry::recordPingMs(int pingMs) {
+    QMutexLocker locker(&_mutex);
+    currentSample(usecTimestampNow()).pingMs = pingMs;
+    _totals.pingMs = pingMs;
+}
+
+QVector<NodeTelemetrySample> NodeTelemetry::getSamples() {
+    QMutexLocker locker(&_mutex);
+    currentSample(usecTimestampNow());
+
+    QVector<NodeTelemetrySample> samples;
+    samples.reserve(_numSamples);
+    for (int i = _numSamples - 1; i >= 0; i--) {
+        samples.append(_samples.at((_currentSample - i + NODE_TELEMETRY_SAMPLE_CAPACITY) % NODE_TELEMETRY_SAMPLE_CAPACITY));
+    }
+    return samples;
+}
+
+NodeTelemetrySample NodeTelemetry::getTotals() {
+    QMutexLocker locker(&_mutex);
+    return _totals;
+}
+
+QJsonArray NodeTelemetry::samplesToJSON() {
+    QJsonArray samplesJSON;
+
+    foreach (const NodeTelemetrySample& sample, getSamples()) {
+        QJsonObject sampleJSON;
+        sampleJSON["start_msecs"] = (double) (sample.startTime / USECS_PER_MSEC);
+        sampleJSON["ping_ms"] = sample.pingMs;
+        sampleJSON["packets_lost"] = (double) sample.packetsLost;
+        sampleJSON["queue_delay_usecs"] = (sample.numQueueDelays == 0) ? 0.0
+            : (double) (sample.totalQueueDelayUsecs / sample.numQueueDelays);
+
+        // keyed by the number of the type, since that is what the packets carry
+        QJsonObject packetTypesJSON;
+        for (QHash<PacketType, PacketTypeTelemetry>::const_iterator type = sample.packetTypes.constBegin();
+             type != sample.packetTypes.constEnd(); ++type) {
+            QJsonObject typeJSON;
+            typeJSON["packets_sent"] = (double) type.value().packetsSent;
+            typeJSON["bytes_sent"] = (double) type.value().bytesSent;
+            typeJSON["packets_received"] = (double) type.value().packetsReceived;
+            typeJSON["bytes_received"] = (double) type.value().bytesReceived;
+            packetTypesJSON[QString::number(type.key())] = typeJSON;
+        }
+        sampleJSON["packet_types"] = packetTypesJSON;
+
+        samplesJSON.append(sampleJSON);
+    }
+    return samplesJSON;
+}
@@ -0,0 +1,82 @@
+//
+//  NodeTelemetry.h
+//  libraries/networking/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#ifndef hifi_NodeTelemetry_h
+#define hifi_NodeTelemetry_h
+
+#include <QtCore/QHash>
+#include <QtCore/QJsonArray>
+#include <QtCore/QMutex>
+#include <QtCore/QVector>
+
+#include <SharedUtil.h>
+
+#include "PacketHeaders.h"
+
+/// the samples kept of each node, a minute of them
+const int NODE_TELEMETRY_SAMPLE_CAPACITY = 60;
+const quint64 NODE_TELEMETRY_SAMPLE_USECS = USECS_PER_SECOND;
+
+/// The packets and bytes of one type sent to and received from a node
+class PacketTypeTelemetry {
+public:
+    PacketTypeTelemetry() : packetsSent(0), bytesSent(0), packetsReceived(0), bytesReceived(0) { }
+
+    quint64 packetsSent;
+    quint64 bytesSent;
+    quint64 packetsReceived;
+    quint64 bytesReceived;
+};
+
+/// What happened with a node over one sample interval, or since it was added for the totals
+class NodeTelemetrySample {
+public:
+    NodeTelemetrySample();
+
+    quint64 startTime; /// usecs
+    QHash<PacketType, PacketTypeTelemetry> packetTypes;
+    quint64 packetsLost; /// by the sequence numbers of the node's streams
+    quint64 totalQueueDelayUsecs; /// that its packets waited to be processed once they were received
+    quint64 numQueueDelays;
+    int pingMs; /// the last measured in the interval
+};
+
+/// Counts of the packets of each type a node sends and is sent, with the loss, round trip and queue delay of its
+/// packets, kept as a ring of samples a second each and as totals since the node was added. Recording can happen on
+/// any thread.
+class NodeTelemetry {
+public:
+    NodeTelemetry();
+
+    void recordPacketSent(PacketType type, int numBytes);
+    void recordPacketReceived(PacketType type, int numBytes);
+    void recordPacketsLost(int numLost);
+    void recordQueueDelay(quint64 queueDelayUsecs);
+    void recordPingMs(int pingMs);
+
+    /// the samples kept, oldest first, the last of which is still being counted
+    QVector<NodeTelemetrySample> getSamples();
+    NodeTelemetrySample getTotals();
+
+    /// the samples as a JSON time series, oldest first
+    QJsonArray samplesToJSON();
+
+private:
+    /// starts the samples for the intervals that passed, the lock being held
+    NodeTelemetrySample& currentSample(quint64 now);
+
+    QMutex _mutex;
+    QVector<NodeTelemetrySample> _samples; /// a ring, the current sample being at _currentSample
+    int _currentSample;
+    int _numSamples;
+    NodeTelemetrySample _totals;
+};
+
+#endif // hifi_NodeTelemetry_h
@@ -9,9 +9,14 @@
 //  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
 //
 
+#include <cstring>
+#include <limits>
 #include <math.h>
 
 #include <QtCore/QDebug>
+#include <QtCore/QtEndian>
+
+#include <SipHash.h>
 
 #include "NodeList.h"
 
@@ -50,18 +55,20 @@ PacketVersion versionForPacketType(PacketType type) {
         case PacketTypeMicrophoneAudioNoEcho:
         case PacketTypeMicrophoneAudioWithEcho:
         case PacketTypeSilentAudioFrame:
-            return 2;
+            return 3;
         case PacketTypeMixedAudio:
-            return 1;
+            return 2;
         case PacketTypeAvatarData:
-            return 3;
+            return 4;
+        case PacketTypeBulkAvatarData:
+            return 1;
         case PacketTypeAvatarIdentity:
             return 1;
         case PacketTypeEnvironmentData:
             return 2;
         case PacketTypeDomainList:
         case PacketTypeDomainListRequest:
-            return 3;
+            return 5;
         case PacketTypeCreateAssignment:
         case PacketTypeRequestAssignment:
             return 2;
@@ -70,14 +77,25 @@ PacketVersion versionForPacketType(PacketType type) {
             return 1;
         case PacketTypeOctreeStats:
             return 1;
-        case PacketTypeParticleData:
+        case PacketTypeVoxelData:
+            return 1;
+        case PacketTypeVoxelQuery:
+        case PacketTypeParticleQuery:
+        case PacketTypeModelQuery:
             return 1;
+        case PacketTypeParticleData:
+            return 3;
         case PacketTypeParticleErase:
             return 1;
         case PacketTypeModelData:
-            return 2;
+            return 5;
         case PacketTypeModelErase:
             return 1;
+        case PacketTypeOctreeDataNack:
+        case PacketTypeVoxelEditNack:
+        case PacketTypeParticleEditNack:
+        case PacketTypeModelEditNack:
+            return 1;
         default:
             return 0;
     }
@@ -144,22 +162,86 @@ int numHashBytesInPacketHeaderGivenPacketType(PacketType type) {
 }
 
 QUuid uuidFromPacketHeader(const QByteArray& packet) {
-    return QUuid::fromRfc4122(packet.mid(numBytesArithmeticCodingFromBuffer(packet.data()) + sizeof(PacketVersion),
-                                         NUM_BYTES_RFC4122_UUID));
+    // read in place rather than through a copy of the bytes, since this happens for every packet received
+    const uchar* uuidBytes = reinterpret_cast<const uchar*>(uuidBytesFromPacketHeader(packet));
+    return QUuid(qFromBigEndian<quint32>(uuidBytes), qFromBigEndian<quint16>(uuidBytes + 4),
+                 qFromBigEndian<quint16>(uuidBytes + 6), uuidBytes[8], uuidBytes[9], uuidBytes[10], uuidBytes[11],
+                 uuidBytes[12], uuidBytes[13], uuidBytes[14], uuidBytes[15]);
+}
+
+const char* uuidBytesFromPacketHeader(const QByteArray& packet) {
+    return packet.constData() + numBytesArithmeticCodingFromBuffer(packet.constData()) + sizeof(PacketVersion);
 }
 
 QByteArray hashFromPacketHeader(const QByteArray& packet) {
     return packet.mid(numBytesForPacketHeader(packet) - NUM_BYTES_MD5_HASH, NUM_BYTES_MD5_HASH);
 }
 
+// the connection secret is the key of the packet hash, which is so that only the two ends of a connection can make it
+static void hashPacketGivenConnectionUUID(const QByteArray& packet, const QUuid& connectionUUID, unsigned char* hash) {
+    unsigned char key[SIP_HASH_KEY_BYTES];
+    qToBigEndian<quint32>(connectionUUID.data1, key);
+    qToBigEndian<quint16>(connectionUUID.data2, key + 4);
+    qToBigEndian<quint16>(connectionUUID.data3, key + 6);
+    memcpy(key + 8, connectionUUID.data4, sizeof(connectionUUID.data4));
+    
+    int numBytesPacketHeader = numBytesForPacketHeader(packet);
+    sipHash128(key, packet.constData() + numBytesPacketHeader, packet.size() - numBytesPacketHeader, hash);
+}
+
 QByteArray hashForPacketAndConnectionUUID(const QByteArray& packet, const QUuid& connectionUUID) {
-    return QCryptographicHash::hash(packet.mid(numBytesForPacketHeader(packet)) + connectionUUID.toRfc4122(),
-                                    QCryptographicHash::Md5);
+    QByteArray hash(NUM_BYTES_MD5_HASH, 0);
+    hashPacketGivenConnectionUUID(packet, connectionUUID, reinterpret_cast<unsigned char*>(hash.data()));
+    return hash;
+}
+
+bool packetHashMatchesConnectionUUID(const QByteArray& packet, const QUuid& connectionUUID) {
+    // the hash is compared where it is in the header, and the payload is hashed in place rather than copied
+    unsigned char expectedHash[NUM_BYTES_MD5_HASH];
+    hashPacketGivenConnectionUUID(packet, connectionUUID, expectedHash);
+    return memcmp(packet.constData() + numBytesForPacketHeader(packet) - NUM_BYTES_MD5_HASH, expectedHash,
+                  NUM_BYTES_MD5_HASH) == 0;
 }
 
 void replaceHashInPacketGivenConnectionUUID(QByteArray& packet, const QUuid& connectionUUID) {
-    packet.replace(numBytesForPacketHeader(packet) - NUM_BYTES_MD5_HASH, NUM_BYTES_MD5_HASH,
-                   hashForPacketAndConnectionUUID(packet, connectionUUID));
+    unsigned char hash[NUM_BYTES_MD5_HASH];
+    hashPacketGivenConnectionUUID(packet, connectionUUID, hash);
+    memcpy(packet.data() + numBytesForPacketHeader(packet) - NUM_BYTES_MD5_HASH, hash, NUM_BYTES_MD5_HASH);
+}
+
+// each packet in a coalesced packet is led by its size
+const int NUM_BYTES_COALESCED_PACKET_SIZE = sizeof(quint16);
+
+bool appendToCoalescedPacket(QByteArray& coalescedPacket, const QByteArray& packet, int maxCoalescedPacketSize) {
+    if (coalescedPacket.size() + NUM_BYTES_COALESCED_PACKET_SIZE + packet.size() > maxCoalescedPacketSize
+        || packet.size() > std::numeric_limits<quint16>::max()) {
+        return false;
+    }
+    
+    quint16 packetSize = packet.size();
+    coalescedPacket.append(reinterpret_cast<const char*>(&packetSize), sizeof(packetSize));
+    coalescedPacket.append(packet);
+    return true;
+}
+
+QList<QByteArray> packetsFromCoalescedPacket(const QByteArray& coalescedPacket) {
+    QList<QByteArray> packets;
+    
+    const char* dataAt = coalescedPacket.constData() + numBytesForPacketHeader(coalescedPacket);
+    const char* dataEnd = coalescedPacket.constData() + coalescedPacket.size();
+    
+    while (dataEnd - dataAt >= NUM_BYTES_COALESCED_PACKET_SIZE) {
+        quint16 packetSize;
+        memcpy(&packetSize, dataAt, sizeof(packetSize));
+        dataAt += sizeof(packetSize);
+        
+        if (packetSize == 0 || dataEnd - dataAt < packetSize) {
+            break;
+        }
+        packets.append(QByteArray(dataAt, packetSize));
+        dataAt += packetSize;
+    }
+    return packets;
 }
 
 PacketType packetTypeForPacket(const QByteArray& packet) {
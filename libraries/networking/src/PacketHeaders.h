@@ -13,6 +13,7 @@
 #define hifi_PacketHeaders_h
 
 #include <QtCore/QCryptographicHash>
+#include <QtCore/QList>
 #include <QtCore/QSet>
 #include <QtCore/QUuid>
 
@@ -70,6 +71,21 @@ enum PacketType {
     PacketTypeVoxelEditNack,
     PacketTypeParticleEditNack,
     PacketTypeModelEditNack,
+    PacketTypeSilentMixedAudio,
+    PacketTypeAvatarContentHashes,
+    PacketTypeAvatarContentRequest,
+    PacketTypeCoalescedPackets,
+    PacketTypeJurisdictionHandoffRequest,
+    PacketTypeJurisdictionHandoffData,
+    PacketTypeJurisdictionHandoffAck,
+    PacketTypeOctreeReplicaSubscribe,
+    PacketTypeOctreeReplicaState,
+    PacketTypeOctreeReplicaSnapshot,
+    PacketTypeOctreeReplicaEdit,
+    PacketTypeOctreeReplicaForwardedEdit,
+    PacketTypeVoxelCopySubtree,
+    PacketTypeVoxelAnimate,
+    PacketTypeOctreeQueryAck,
 };
 
 typedef char PacketVersion;
@@ -79,8 +95,17 @@ const QSet<PacketType> NON_VERIFIED_PACKETS = QSet<PacketType>()
     << PacketTypeDomainList << PacketTypeDomainListRequest << PacketTypeDomainOAuthRequest
     << PacketTypeCreateAssignment << PacketTypeRequestAssignment << PacketTypeStunResponse
     << PacketTypeNodeJsonStats << PacketTypeVoxelQuery << PacketTypeParticleQuery << PacketTypeModelQuery
-    << PacketTypeOctreeDataNack << PacketTypeVoxelEditNack << PacketTypeParticleEditNack << PacketTypeModelEditNack;
+    << PacketTypeOctreeDataNack << PacketTypeVoxelEditNack << PacketTypeParticleEditNack << PacketTypeModelEditNack
+    << PacketTypeCoalescedPackets << PacketTypeJurisdictionHandoffRequest;
 
+// the small control packets that are sent to a destination together in a PacketTypeCoalescedPackets, each of which keeps
+// its own header and hash
+const QSet<PacketType> COALESCABLE_PACKETS = QSet<PacketType>()
+    << PacketTypePing << PacketTypePingReply << PacketTypeDomainListRequest
+    << PacketTypeJurisdiction << PacketTypeJurisdictionRequest << PacketTypeNodeJsonStats;
+
+// the hash in the header of a verified packet is a 128 bit SipHash keyed by the connection secret, which is as long as the
+// MD5 of the payload and secret that it replaced
 const int NUM_BYTES_MD5_HASH = 16;
 const int NUM_STATIC_HEADER_BYTES = sizeof(PacketVersion) + NUM_BYTES_RFC4122_UUID;
 const int MAX_PACKET_HEADER_BYTES = sizeof(PacketType) + NUM_BYTES_MD5_HASH + NUM_STATIC_HEADER_BYTES;
@@ -101,13 +126,24 @@ int numBytesForPacketHeaderGivenPacketType(PacketType type);
 
 QUuid uuidFromPacketHeader(const QByteArray& packet);
 
+/// the NUM_BYTES_RFC4122_UUID bytes of the sender's UUID in the packet's header, in place
+const char* uuidBytesFromPacketHeader(const QByteArray& packet);
+
 QByteArray hashFromPacketHeader(const QByteArray& packet);
 QByteArray hashForPacketAndConnectionUUID(const QByteArray& packet, const QUuid& connectionUUID);
+bool packetHashMatchesConnectionUUID(const QByteArray& packet, const QUuid& connectionUUID);
 void replaceHashInPacketGivenConnectionUUID(QByteArray& packet, const QUuid& connectionUUID);
 
 PacketType packetTypeForPacket(const QByteArray& packet);
 PacketType packetTypeForPacket(const char* packet);
 
+/// appends packet to a PacketTypeCoalescedPackets, returns false without appending it if that would make the coalesced
+/// packet larger than maxCoalescedPacketSize
+bool appendToCoalescedPacket(QByteArray& coalescedPacket, const QByteArray& packet, int maxCoalescedPacketSize);
+
+/// the packets carried by a PacketTypeCoalescedPackets, up to the first that is cut short
+QList<QByteArray> packetsFromCoalescedPacket(const QByteArray& coalescedPacket);
+
 int arithmeticCodingValueFromBuffer(const char* checkValue);
 int numBytesArithmeticCodingFromBuffer(const char* checkValue);
 
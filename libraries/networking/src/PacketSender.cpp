@@ -28,12 +28,29 @@ const int PacketSender::MINIMAL_SLEEP_INTERVAL = (USECS_PER_SECOND / TARGET_FPS)
 
 const int AVERAGE_CALL_TIME_SAMPLES = 10;
 
+// the packets that can be on their way to the sending thread before queueing takes a lock
+const int QUEUED_PACKETS_CAPACITY = 4096;
+
+// how long the sending thread waits before looking for packets that were put beside the full queue, in msecs
+const unsigned long MAX_QUEUE_WAIT = 100;
+
 PacketSender::PacketSender(int packetsPerSecond) :
     _packetsPerSecond(packetsPerSecond),
     _usecsPerProcessCallHint(0),
     _lastProcessCallTime(0),
     _averageProcessCallTime(AVERAGE_CALL_TIME_SAMPLES),
+    _queuedPackets(QUEUED_PACKETS_CAPACITY),
+    _overflowPackets(),
+    _hasOverflowPackets(0),
+    _destinations(),
+    _destinationOrder(),
+    _nextDestination(0),
+    _numPacketsToSend(0),
+    _packetsPerSecondPerDestination(0),
+    _sendingDestinationRates(),
     _lastSendTime(0), // Note: we set this to 0 to indicate we haven't yet sent something
+    _destinationRates(),
+    _hasNewDestinationRates(0),
     _lastPPSCheck(0),
     _packetsOverCheckInterval(0),
     _started(usecTimestampNow()),
@@ -48,16 +65,75 @@ PacketSender::~PacketSender() {
 }
 
 
-void PacketSender::queuePacketForSending(const SharedNodePointer& destinationNode, const QByteArray& packet) {
-    NetworkPacket networkPacket(destinationNode, packet);
-    lock();
-    _packets.push_back(networkPacket);
-    unlock();
+bool PacketSender::PacketDestination::isEmpty() const {
+    for (int priority = 0; priority < NUM_PACKET_PRIORITIES; priority++) {
+        if (!packets[priority].isEmpty()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void PacketSender::queuePacketForSending(const SharedNodePointer& destinationNode, const QByteArray& packet,
+                                         PacketPriority priority) {
+    QueuedPacket queuedPacket(NetworkPacket(destinationNode, packet), priority);
+    _numPacketsToSend.fetchAndAddOrdered(1);
+    
+    // pushing wakes our actual processing thread if it's waiting for packets
+    if (!_queuedPackets.push(queuedPacket)) {
+        // rather than drop the packet, it waits beside the queue until the sending thread catches up
+        lock();
+        _overflowPackets.append(queuedPacket);
+        _hasOverflowPackets.store(1);
+        unlock();
+        _queuedPackets.wakeAll();
+    }
     _totalPacketsQueued++;
     _totalBytesQueued += packet.size();
+}
 
-    // Make sure to  wake our actual processing thread because we  now have packets for it to process.
-    _hasPackets.wakeAll();
+void PacketSender::drainQueuedPackets() {
+    QueuedPacket queuedPacket;
+    while (_queuedPackets.pop(queuedPacket)) {
+        addToDestination(queuedPacket);
+    }
+    
+    if (_hasOverflowPackets.load()) {
+        lock();
+        foreach (const QueuedPacket& overflowPacket, _overflowPackets) {
+            addToDestination(overflowPacket);
+        }
+        _overflowPackets.clear();
+        _hasOverflowPackets.store(0);
+        unlock();
+    }
+
+    if (_hasNewDestinationRates.load()) {
+        lock();
+        _sendingDestinationRates = _destinationRates;
+        _hasNewDestinationRates.store(0);
+        unlock();
+    }
+}
+
+void PacketSender::addToDestination(const QueuedPacket& queuedPacket) {
+    const SharedNodePointer& destinationNode = queuedPacket.packet.getNode();
+    QUuid destinationUUID = destinationNode ? destinationNode->getUUID() : QUuid();
+    if (!_destinations.contains(destinationUUID)) {
+        _destinationOrder.append(destinationUUID);
+    }
+    _destinations[destinationUUID].packets[queuedPacket.priority].enqueue(queuedPacket.packet);
+}
+
+void PacketSender::setPacketsPerSecondForDestination(const QUuid& destinationUUID, int packetsPerSecond) {
+    lock();
+    if (packetsPerSecond > 0) {
+        _destinationRates.insert(destinationUUID, packetsPerSecond);
+    } else {
+        _destinationRates.remove(destinationUUID);
+    }
+    _hasNewDestinationRates.store(1);
+    unlock();
 }
 
 void PacketSender::setPacketsPerSecond(int packetsPerSecond) {
@@ -73,7 +149,7 @@ bool PacketSender::process() {
 }
 
 void PacketSender::terminating() {
-    _hasPackets.wakeAll();
+    _queuedPackets.wakeAll();
 }
 
 bool PacketSender::threadedProcess() {
@@ -84,7 +160,7 @@ bool PacketSender::threadedProcess() {
     }
 
     // in threaded mode, we keep running and just empty our packet queue sleeping enough to keep our PPS on target
-    while (_packets.size() > 0) {
+    while (hasPacketsToSend()) {
         // Recalculate our SEND_INTERVAL_USECS each time, in case the caller has changed it on us..
         int packetsPerSecondTarget = (_packetsPerSecond > MINIMUM_PACKETS_PER_SECOND)
                                             ? _packetsPerSecond : MINIMUM_PACKETS_PER_SECOND;
@@ -104,7 +180,7 @@ bool PacketSender::threadedProcess() {
             if (usecToSleep > MAX_SLEEP_INTERVAL) {
                 usecToSleep = MAX_SLEEP_INTERVAL;
             }
-            usleep(usecToSleep);
+            waitFor(usecToSleep);
             hasSlept = true;
         }
 
@@ -118,10 +194,10 @@ bool PacketSender::threadedProcess() {
 
     // if threaded and we haven't slept? We want to wait for our consumer to signal us with new packets
     if (!hasSlept) {
-        // wait till we have packets        
-        _waitingOnPacketsMutex.lock();
-        _hasPackets.wait(&_waitingOnPacketsMutex);
-        _waitingOnPacketsMutex.unlock();
+        // wait till we have packets
+        quint64 waitStart = usecMonotonicNow();
+        _queuedPackets.waitForItems(MAX_QUEUE_WAIT);
+        addIdleUsecs(usecMonotonicNow() - waitStart);
     }
 
     return isStillRunning();
@@ -163,7 +239,7 @@ bool PacketSender::nonThreadedProcess() {
         averageCallTime = _usecsPerProcessCallHint;
     }
 
-    if (_packets.size() == 0) {
+    if (!hasPacketsToSend()) {
         // in non-threaded mode, if there's nothing to do, just return, keep running till they terminate us
         return isStillRunning();
     }
@@ -259,18 +335,18 @@ bool PacketSender::nonThreadedProcess() {
         }
     }
 
-    int packetsLeft = _packets.size();
+    drainQueuedPackets();
 
     // Now that we know how many packets to send this call to process, just send them.
-    while ((packetsSentThisCall < packetsToSendThisCall) && (packetsLeft > 0)) {
-        lock();
-        NetworkPacket& packet = _packets.front();
-        NetworkPacket temporary = packet; // make a copy
-        _packets.erase(_packets.begin());
-        packetsLeft = _packets.size();
-        unlock();
+    while (packetsSentThisCall < packetsToSendThisCall) {
+        NetworkPacket temporary;
+        if (!takeNextPacket(now, averageCallTime, temporary)) {
+            // whatever is left has to wait for its destinations to be owed more packets
+            break;
+        }
 
         // send the packet through the NodeList...
+        packetAboutToBeSent(temporary.getByteArray());
         NodeList::getInstance()->writeDatagram(temporary.getByteArray(), temporary.getNode());
         packetsSentThisCall++;
         _packetsOverCheckInterval++;
@@ -283,3 +359,44 @@ bool PacketSender::nonThreadedProcess() {
     }
     return isStillRunning();
 }
+
+bool PacketSender::takeNextPacket(quint64 now, float averageCallTime, NetworkPacket& packet) {
+    for (int priority = 0; priority < NUM_PACKET_PRIORITIES; priority++) {
+        for (int i = 0; i < _destinationOrder.size(); i++) {
+            int destinationIndex = (_nextDestination + i) % _destinationOrder.size();
+            PacketDestination& destination = _destinations[_destinationOrder.at(destinationIndex)];
+            if (destination.packets[priority].isEmpty()) {
+                continue;
+            }
+
+            int packetsPerSecond = _sendingDestinationRates.value(_destinationOrder.at(destinationIndex),
+                                                                  _packetsPerSecondPerDestination);
+            if (packetsPerSecond > 0) {
+                float tokensPerUsec = (float)packetsPerSecond / (float)USECS_PER_SECOND;
+                float maxTokens = std::max(1.0f, tokensPerUsec * averageCallTime);
+                destination.tokens = std::min(maxTokens,
+                    destination.tokens + tokensPerUsec * (float)(now - destination.lastRefillTime));
+                destination.lastRefillTime = now;
+                if (destination.tokens < 1.0f) {
+                    continue;
+                }
+                destination.tokens -= 1.0f;
+            }
+
+            packet = destination.packets[priority].dequeue();
+            _numPacketsToSend.fetchAndAddOrdered(-1);
+
+            // the destinations take turns, so the next packet comes from the one after this
+            _nextDestination = destinationIndex + 1;
+            if (destination.isEmpty()) {
+                _destinations.remove(_destinationOrder.at(destinationIndex));
+                _destinationOrder.removeAt(destinationIndex);
+                _nextDestination = destinationIndex;
+            }
+            _nextDestination = _destinationOrder.isEmpty() ? 0 : _nextDestination % _destinationOrder.size();
+
+            return true;
+        }
+    }
+    return false;
+}
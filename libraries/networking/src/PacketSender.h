@@ -14,18 +14,32 @@
 #ifndef hifi_PacketSender_h
 #define hifi_PacketSender_h
 
-#include <QWaitCondition>
+#include <QAtomicInt>
+#include <QHash>
+#include <QList>
+#include <QQueue>
+#include <QVector>
 
+#include "BoundedMPSCQueue.h"
 #include "GenericThread.h"
 #include "NetworkPacket.h"
 #include "NodeList.h"
 #include "SharedUtil.h"
 
-/// Generalized threaded processor for queueing and sending of outbound packets.
+/// Generalized threaded processor for queueing and sending of outbound packets. Packets go out highest priority first,
+/// with the destinations taking turns within a priority, and each destination can be held to a rate of its own.
+/// Queueing a packet doesn't take a lock unless the queue the sending thread drains is full.
 class PacketSender : public GenericThread {
     Q_OBJECT
 public:
 
+    enum PacketPriority {
+        CONTROL_PRIORITY, /// requests, replies and resends that someone is waiting on
+        EDIT_PRIORITY, /// edits, which are most of what is sent
+        BULK_PRIORITY, /// anything that can wait behind the rest
+        NUM_PACKET_PRIORITIES
+    };
+
     static const quint64 USECS_PER_SECOND;
     static const quint64 SENDING_INTERVAL_ADJUST;
     static const int TARGET_FPS;
@@ -42,20 +56,42 @@ public:
     /// \param HifiSockAddr& address the destination address
     /// \param packetData pointer to data
     /// \param ssize_t packetLength size of data
+    /// \param PacketPriority priority the priority class of the packet
     /// \thread any thread, typically the application thread
-    void queuePacketForSending(const SharedNodePointer& destinationNode, const QByteArray& packet);
+    void queuePacketForSending(const SharedNodePointer& destinationNode, const QByteArray& packet,
+                               PacketPriority priority = EDIT_PRIORITY);
 
     void setPacketsPerSecond(int packetsPerSecond);
     int getPacketsPerSecond() const { return _packetsPerSecond; }
 
+    /// Limits the packets per second sent to any one destination, on top of the overall rate. A destination only saves up
+    /// as many packets as it is owed over one call to process, so that its packets are spread over the calls rather than
+    /// bursting after a quiet spell. 0, the default, is no limit but the overall rate.
+    void setPacketsPerSecondPerDestination(int packetsPerSecond) { _packetsPerSecondPerDestination = packetsPerSecond; }
+    int getPacketsPerSecondPerDestination() const { return _packetsPerSecondPerDestination; }
+
+    /// Limits one destination to a rate of its own in place of the one above, such as the rate its acks allow. 0 puts
+    /// it back under the limit for every destination.
+    /// \thread any thread
+    void setPacketsPerSecondForDestination(const QUuid& destinationUUID, int packetsPerSecond);
+
     virtual bool process();
     virtual void terminating();
 
     /// are there packets waiting in the send queue to be sent
-    bool hasPacketsToSend() const { return _packets.size() > 0; }
+    bool hasPacketsToSend() const { return _numPacketsToSend.load() > 0; }
 
     /// how many packets are there in the send queue waiting to be sent
-    int packetsToSendCount() const { return _packets.size(); }
+    int packetsToSendCount() const { return _numPacketsToSend.load(); }
+
+    /// are more packets waiting than can be sent in a second at the current rate, whoever queues them should back off
+    bool isBackedUp() const { return _numPacketsToSend.load() > _packetsPerSecond; }
+
+    /// the most packets there have been in the queue the sending thread drains at once
+    int getMaxQueueDepth() const { return _queuedPackets.getMaxDepth(); }
+
+    /// the average time the packets taken off of the queue so far waited for the sending thread
+    quint64 getAverageQueueWaitUsecs() const { return _queuedPackets.getAverageWaitUsecs(); }
 
     /// If you're running in non-threaded mode, call this to give us a hint as to how frequently you will call process.
     /// This has no effect in threaded mode. This is only considered a hint in non-threaded mode.
@@ -98,15 +134,61 @@ public:
 signals:
     void packetSent(quint64);
 protected:
+    /// called on the sending thread just before each packet is written, such as to stamp the time it really went out
+    virtual void packetAboutToBeSent(QByteArray& packet) { }
+
     int _packetsPerSecond;
     int _usecsPerProcessCallHint;
     quint64 _lastProcessCallTime;
     SimpleMovingAverage _averageProcessCallTime;
 
 private:
-    std::vector<NetworkPacket> _packets;
+    /// a packet on its way from whoever queued it to the sending thread
+    class QueuedPacket {
+    public:
+        QueuedPacket() : priority(EDIT_PRIORITY) { }
+        QueuedPacket(const NetworkPacket& packet, PacketPriority priority) : packet(packet), priority(priority) { }
+
+        NetworkPacket packet;
+        PacketPriority priority;
+    };
+
+    /// the packets waiting for one destination, and the tokens it has for sending them
+    class PacketDestination {
+    public:
+        PacketDestination() : tokens(0.0f), lastRefillTime(0) { }
+
+        bool isEmpty() const;
+
+        QQueue<NetworkPacket> packets[NUM_PACKET_PRIORITIES];
+        float tokens;
+        quint64 lastRefillTime;
+    };
+
+    /// moves the packets that have been queued since the last call to their destinations
+    void drainQueuedPackets();
+    void addToDestination(const QueuedPacket& queuedPacket);
+
+    /// takes the packet to send next, or returns false if the packets left are all held back by their destinations
+    bool takeNextPacket(quint64 now, float averageCallTime, NetworkPacket& packet);
+
+    BoundedMPSCQueue<QueuedPacket> _queuedPackets;
+    QVector<QueuedPacket> _overflowPackets; /// the packets queued while _queuedPackets was full, guarded by lock()
+    QAtomicInt _hasOverflowPackets;
+
+    // the destinations are only touched by the sending thread
+
+    QHash<QUuid, PacketDestination> _destinations;
+    QList<QUuid> _destinationOrder;
+    int _nextDestination;
+    QAtomicInt _numPacketsToSend;
+    int _packetsPerSecondPerDestination;
+    QHash<QUuid, int> _sendingDestinationRates; /// the sending thread's copy of _destinationRates
     quint64 _lastSendTime;
 
+    QHash<QUuid, int> _destinationRates; /// guarded by lock()
+    QAtomicInt _hasNewDestinationRates;
+
     bool threadedProcess();
     bool nonThreadedProcess();
 
@@ -119,9 +201,6 @@ private:
 
     quint64 _totalPacketsQueued;
     quint64 _totalBytesQueued;
-
-    QWaitCondition _hasPackets;
-    QMutex _waitingOnPacketsMutex;
 };
 
 #endif // hifi_PacketSender_h
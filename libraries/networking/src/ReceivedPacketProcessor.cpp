@@ -13,40 +13,51 @@
 #include "ReceivedPacketProcessor.h"
 #include "SharedUtil.h"
 
+ReceivedPacketProcessor::ReceivedPacketProcessor() :
+    _packets(RECEIVED_PACKET_QUEUE_CAPACITY),
+    _nodePacketCounts()
+{
+}
+
 void ReceivedPacketProcessor::terminating() {
-    _hasPackets.wakeAll();
+    _packets.wakeAll();
 }
 
-void ReceivedPacketProcessor::queueReceivedPacket(const SharedNodePointer& sendingNode, const QByteArray& packet) {
+bool ReceivedPacketProcessor::queueReceivedPacket(const SharedNodePointer& sendingNode, const QByteArray& packet) {
     // Make sure our Node and NodeList knows we've heard from this node.
     sendingNode->setLastHeardMicrostamp(usecTimestampNow());
 
-    NetworkPacket networkPacket(sendingNode, packet);
+    // the count goes up first, so that it never goes below zero when the packet is processed right away
     lock();
-    _packets.push_back(networkPacket);
     _nodePacketCounts[sendingNode->getUUID()]++;
     unlock();
-    
-    // Make sure to  wake our actual processing thread because we  now have packets for it to process.
-    _hasPackets.wakeAll();
+
+    // pushing wakes our actual processing thread if it's waiting for packets
+    if (!_packets.push(NetworkPacket(sendingNode, packet))) {
+        lock();
+        _nodePacketCounts[sendingNode->getUUID()]--;
+        unlock();
+        return false;
+    }
+    return true;
 }
 
 bool ReceivedPacketProcessor::process() {
 
-    if (_packets.size() == 0) {
-        _waitingOnPacketsMutex.lock();
-        _hasPackets.wait(&_waitingOnPacketsMutex, getMaxWait());
-        _waitingOnPacketsMutex.unlock();
+    if (!hasPacketsToProcess()) {
+        quint64 waitStart = usecMonotonicNow();
+        _packets.waitForItems(getMaxWait());
+        addIdleUsecs(usecMonotonicNow() - waitStart);
     }
     preProcess();
-    while (_packets.size() > 0) {
-        lock(); // lock to make sure nothing changes on us
-        NetworkPacket& packet = _packets.front(); // get the oldest packet
-        NetworkPacket temporary = packet; // make a copy of the packet in case the vector is resized on us
-        _packets.erase(_packets.begin()); // remove the oldest packet
-        _nodePacketCounts[temporary.getNode()->getUUID()]--;
-        unlock(); // let others add to the packets
-        processPacket(temporary.getNode(), temporary.getByteArray()); // process our temporary copy
+    NetworkPacket packet;
+    quint64 waitUsecs;
+    while (_packets.pop(packet, waitUsecs)) {
+        packet.getNode()->getTelemetry().recordQueueDelay(waitUsecs);
+        lock();
+        _nodePacketCounts[packet.getNode()->getUUID()]--;
+        unlock();
+        processPacket(packet.getNode(), packet.getByteArray());
         midProcess();
     }
     postProcess();
@@ -12,26 +12,31 @@
 #ifndef hifi_ReceivedPacketProcessor_h
 #define hifi_ReceivedPacketProcessor_h
 
-#include <QWaitCondition>
+#include "BoundedMPSCQueue.h"
 
 #include "GenericThread.h"
 #include "NetworkPacket.h"
 
-/// Generalized threaded processor for handling received inbound packets. 
+/// the packets a ReceivedPacketProcessor can have waiting, past which the packets received are dropped
+const int RECEIVED_PACKET_QUEUE_CAPACITY = 4096;
+
+/// Generalized threaded processor for handling received inbound packets. The packets are queued without taking a lock,
+/// so that the thread receiving them doesn't wait on this one.
 class ReceivedPacketProcessor : public GenericThread {
     Q_OBJECT
 public:
-    ReceivedPacketProcessor() { }
+    ReceivedPacketProcessor();
 
     /// Add packet from network receive thread to the processing queue.
     /// \param sockaddr& senderAddress the address of the sender
     /// \param packetData pointer to received data
     /// \param ssize_t packetLength size of received data
     /// \thread network receive thread
-    void queueReceivedPacket(const SharedNodePointer& sendingNode, const QByteArray& packet);
+    /// \return false if the queue was full and the packet was dropped
+    bool queueReceivedPacket(const SharedNodePointer& sendingNode, const QByteArray& packet);
 
     /// Are there received packets waiting to be processed
-    bool hasPacketsToProcess() const { return _packets.size() > 0; }
+    bool hasPacketsToProcess() const { return !_packets.isEmpty(); }
 
     /// Is a specified node still alive?
     bool isAlive(const QUuid& nodeUUID) const {
@@ -49,7 +54,16 @@ public:
     }
 
     /// How many received packets waiting are to be processed
-    int packetsToProcessCount() const { return _packets.size(); }
+    int packetsToProcessCount() const { return _packets.getDepth(); }
+
+    /// The most received packets that have been waiting at once
+    int getMaxPacketsToProcessCount() const { return _packets.getMaxDepth(); }
+
+    /// How many received packets were dropped because the queue was full
+    int getDroppedPacketCount() const { return _packets.getNumFullPushes(); }
+
+    /// The average time the packets processed so far waited to be processed
+    quint64 getAverageQueueWaitUsecs() const { return _packets.getAverageWaitUsecs(); }
 
 public slots:
     void nodeKilled(SharedNodePointer node);
@@ -79,11 +93,8 @@ protected:
 
 protected:
 
-    QVector<NetworkPacket> _packets;
-    QHash<QUuid, int> _nodePacketCounts;
-
-    QWaitCondition _hasPackets;
-    QMutex _waitingOnPacketsMutex;
+    BoundedMPSCQueue<NetworkPacket> _packets;
+    QHash<QUuid, int> _nodePacketCounts; /// guarded by lock()
 };
 
 #endif // hifi_ReceivedPacketProcessor_h
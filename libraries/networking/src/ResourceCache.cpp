@@ -20,9 +20,19 @@
 
 #include "ResourceCache.h"
 
+// the most bytes a cache keeps loaded for resources that nothing refers to, unless it's told otherwise
+const qint64 DEFAULT_UNUSED_RESOURCES_MAX_BYTES = 128 * 1024 * 1024;
+
+// resources that hold on to little or nothing are still let go of, rather than piling up
+const int MAX_UNUSED_RESOURCE_COUNT = 1000;
+
 ResourceCache::ResourceCache(QObject* parent) :
     QObject(parent),
-    _lastLRUKey(0) {
+    _lastLRUKey(0),
+    _unusedResourcesMaxBytes(DEFAULT_UNUSED_RESOURCES_MAX_BYTES),
+    _unusedResourcesBytes(0),
+    _cpuBytes(0),
+    _gpuBytes(0) {
 }
 
 ResourceCache::~ResourceCache() {
@@ -39,6 +49,11 @@ void ResourceCache::refresh(const QUrl& url) {
     }
 }
 
+void ResourceCache::setUnusedResourcesMaxBytes(qint64 maxBytes) {
+    _unusedResourcesMaxBytes = maxBytes;
+    reserveUnusedResources(0);
+}
+
 QSharedPointer<Resource> ResourceCache::getResource(const QUrl& url, const QUrl& fallback, bool delayLoad, void* extra) {
     if (!url.isValid() && !url.isEmpty() && fallback.isValid()) {
         return getResource(fallback, QUrl(), delayLoad);
@@ -52,21 +67,51 @@ QSharedPointer<Resource> ResourceCache::getResource(const QUrl& url, const QUrl&
         _resources.insert(url, resource);
         
     } else {
-        _unusedResources.remove(resource->getLRUKey());
+        removeUnusedResource(resource);
     }
     return resource;
 }
 
 void ResourceCache::addUnusedResource(const QSharedPointer<Resource>& resource) {
-    const int RETAINED_RESOURCE_COUNT = 50;
-    if (_unusedResources.size() > RETAINED_RESOURCE_COUNT) {
+    // a resource too big to ever fit is unloaded straight away rather than flushing everything else
+    if (resource->getBytes() > _unusedResourcesMaxBytes) {
+        resource->setCache(NULL);
+        return;
+    }
+    reserveUnusedResources(resource->getBytes());
+    
+    resource->setLRUKey(++_lastLRUKey);
+    _unusedResources.insert(resource->getLRUKey(), resource);
+    _unusedResourcesBytes += resource->getBytes();
+}
+
+void ResourceCache::removeUnusedResource(const QSharedPointer<Resource>& resource) {
+    if (_unusedResources.value(resource->getLRUKey()) == resource) {
+        _unusedResources.remove(resource->getLRUKey());
+        _unusedResourcesBytes -= resource->getBytes();
+    }
+}
+
+void ResourceCache::reserveUnusedResources(qint64 bytes) {
+    while (!_unusedResources.isEmpty() && (_unusedResourcesBytes + bytes > _unusedResourcesMaxBytes ||
+            _unusedResources.size() >= MAX_UNUSED_RESOURCE_COUNT)) {
         // unload the oldest resource
         QMap<int, QSharedPointer<Resource> >::iterator it = _unusedResources.begin();
-        it.value()->setCache(NULL);
+        QSharedPointer<Resource> resource = it.value();
         _unusedResources.erase(it);
+        _unusedResourcesBytes -= resource->getBytes();
+        resource->setCache(NULL);
+    }
+}
+
+void ResourceCache::resourceBytesChanged(Resource* resource, qint64 cpuBytesDelta, qint64 gpuBytesDelta) {
+    _cpuBytes += cpuBytesDelta;
+    _gpuBytes += gpuBytesDelta;
+    
+    // a resource can finish loading after the last reference to it has been let go of
+    if (_unusedResources.value(resource->getLRUKey()).data() == resource) {
+        _unusedResourcesBytes += cpuBytesDelta + gpuBytesDelta;
     }
-    resource->setLRUKey(++_lastLRUKey);
-    _unusedResources.insert(resource->getLRUKey(), resource);
 }
 
 void ResourceCache::attemptRequest(Resource* resource) {
@@ -115,7 +160,9 @@ Resource::Resource(const QUrl& url, bool delayLoad) :
     _url(url),
     _request(url),
     _lruKey(0),
-    _reply(NULL) {
+    _reply(NULL),
+    _cpuBytes(0),
+    _gpuBytes(0) {
     
     init();
     
@@ -132,6 +179,19 @@ Resource::~Resource() {
         ResourceCache::requestCompleted(this);
         delete _reply;
     }
+    if (_cache) {
+        _cache->resourceBytesChanged(this, -_cpuBytes, -_gpuBytes);
+    }
+}
+
+void Resource::setCache(ResourceCache* cache) {
+    if (_cache) {
+        _cache->resourceBytesChanged(this, -_cpuBytes, -_gpuBytes);
+    }
+    _cache = cache;
+    if (_cache) {
+        _cache->resourceBytesChanged(this, _cpuBytes, _gpuBytes);
+    }
 }
 
 void Resource::ensureLoading() {
@@ -238,6 +298,14 @@ void Resource::finishedLoading(bool success) {
     _loadPriorities.clear();
 }
 
+void Resource::setBytes(qint64 cpuBytes, qint64 gpuBytes) {
+    if (_cache) {
+        _cache->resourceBytesChanged(this, cpuBytes - _cpuBytes, gpuBytes - _gpuBytes);
+    }
+    _cpuBytes = cpuBytes;
+    _gpuBytes = gpuBytes;
+}
+
 void Resource::reinsert() {
     _cache->_resources.insert(_url, _self);
 }
@@ -272,6 +340,11 @@ void Resource::handleReplyTimeout() {
 }
 
 void Resource::makeRequest() {
+#if QT_VERSION >= QT_VERSION_CHECK(5, 8, 0)
+    // a server that speaks HTTP/2 multiplexes the downloads over one connection rather than queueing them for a few
+    _request.setAttribute(QNetworkRequest::HTTP2AllowedAttribute, true);
+#endif
+    
     _reply = NetworkAccessManager::getInstance().get(_request);
     
     connect(_reply, SIGNAL(downloadProgress(qint64,qint64)), SLOT(handleDownloadProgress(qint64,qint64)));
@@ -316,7 +389,11 @@ void Resource::handleReplyError(QNetworkReply::NetworkError error, QDebug debug)
             // fall through to final failure
         }    
         default:
-            finishedLoading(false);
+            if (requestAlternative()) {
+                _attempts = 0;
+            } else {
+                finishedLoading(false);
+            }
             break;
     }
 }
@@ -44,6 +44,18 @@ public:
 
     void refresh(const QUrl& url);
 
+    /// Sets the most bytes the resources that nothing refers to may hold on to before the least recently used are
+    /// unloaded.
+    void setUnusedResourcesMaxBytes(qint64 maxBytes);
+    qint64 getUnusedResourcesMaxBytes() const { return _unusedResourcesMaxBytes; }
+    
+    /// Returns the bytes held by the resources that nothing refers to.
+    qint64 getUnusedResourcesBytes() const { return _unusedResourcesBytes; }
+    
+    /// Returns the CPU and GPU bytes held by all of the cache's resources, used or not.
+    qint64 getCPUBytes() const { return _cpuBytes; }
+    qint64 getGPUBytes() const { return _gpuBytes; }
+    
 protected:
 
     QMap<int, QSharedPointer<Resource> > _unusedResources;
@@ -60,6 +72,7 @@ protected:
         const QSharedPointer<Resource>& fallback, bool delayLoad, const void* extra) = 0;
 
     void addUnusedResource(const QSharedPointer<Resource>& resource);
+    void removeUnusedResource(const QSharedPointer<Resource>& resource);
     
     static void attemptRequest(Resource* resource);
     static void requestCompleted(Resource* resource);
@@ -68,9 +81,19 @@ private:
     
     friend class Resource;
 
+    /// Unloads the least recently used of the unused resources until they fit in the budget.
+    void reserveUnusedResources(qint64 bytes);
+    
+    void resourceBytesChanged(Resource* resource, qint64 cpuBytesDelta, qint64 gpuBytesDelta);
+    
     QHash<QUrl, QWeakPointer<Resource> > _resources;
     int _lastLRUKey;
     
+    qint64 _unusedResourcesMaxBytes;
+    qint64 _unusedResourcesBytes;
+    qint64 _cpuBytes;
+    qint64 _gpuBytes;
+    
     static int _requestLimit;
     static QList<QPointer<Resource> > _pendingRequests;
     static QList<Resource*> _loadingRequests;
@@ -115,12 +138,20 @@ public:
     /// For loading resources, returns the load progress.
     float getProgress() const { return (_bytesTotal == 0) ? 0.0f : (float)_bytesReceived / _bytesTotal; }
 
+    /// Returns the number of bytes the loaded resource takes up in main memory.
+    qint64 getCPUBytes() const { return _cpuBytes; }
+    
+    /// Returns the number of bytes the loaded resource takes up on the GPU.
+    qint64 getGPUBytes() const { return _gpuBytes; }
+    
+    qint64 getBytes() const { return _cpuBytes + _gpuBytes; }
+
     /// Refreshes the resource.
     void refresh();
 
     void setSelf(const QWeakPointer<Resource>& self) { _self = self; }
 
-    void setCache(ResourceCache* cache) { _cache = cache; }
+    void setCache(ResourceCache* cache);
 
     Q_INVOKABLE void allReferencesCleared();
 
@@ -135,9 +166,16 @@ protected:
     /// Called when the download has finished.  The recipient should delete the reply when done with it.
     virtual void downloadFinished(QNetworkReply* reply) = 0;
 
+    /// Called when a request has failed for good.  Subclasses may make another request in its place (say, for another
+    /// form of the resource), returning true if they did.
+    virtual bool requestAlternative() { return false; }
+
     /// Should be called by subclasses when all the loading that will be done has been done.
     Q_INVOKABLE void finishedLoading(bool success);
 
+    /// Should be called by subclasses when what they hold on to changes, so that the cache can budget for it.
+    void setBytes(qint64 cpuBytes, qint64 gpuBytes);
+
     /// Reinserts this resource into the cache.
     virtual void reinsert();
 
@@ -174,6 +212,8 @@ private:
     qint64 _bytesReceived;
     qint64 _bytesTotal;
     int _attempts;
+    qint64 _cpuBytes;
+    qint64 _gpuBytes;
 };
 
 uint qHash(const QPointer<QObject>& value, uint seed = 0);
@@ -0,0 +1,133 @@
+//
+//  SelectiveAck.cpp
+//  libraries/networking/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <limits>
+
+#include "SelectiveAck.h"
+
+// the newest sequence number, the echoed sent time, the hold time and the number of ranges
+const int FIXED_ACK_BYTES = sizeof(uint16_t) + sizeof(quint64) + sizeof(quint32) + sizeof(uint16_t);
+const int BYTES_PER_RANGE = 2 * sizeof(uint16_t);
+
+SelectiveAck::SelectiveAck() :
+    _newestSequenceNumber(0),
+    _echoedSentTime(0),
+    _holdUsecs(0),
+    _missingRanges()
+{
+}
+
+void SelectiveAck::setEcho(quint64 echoedSentTime, quint64 holdUsecs) {
+    _echoedSentTime = echoedSentTime;
+    _holdUsecs = (quint32) std::min(holdUsecs, (quint64) std::numeric_limits<quint32>::max());
+}
+
+void SelectiveAck::setMissingSequenceNumbers(const QSet<uint16_t>& missingSequenceNumbers) {
+    _missingRanges.clear();
+
+    // the sequence numbers roll over, so they are ordered by how far behind the newest they are
+    QVector<uint16_t> ages;
+    ages.reserve(missingSequenceNumbers.size());
+    foreach (uint16_t sequenceNumber, missingSequenceNumbers) {
+        ages.append((uint16_t) (_newestSequenceNumber - sequenceNumber));
+    }
+    std::sort(ages.begin(), ages.end(), std::greater<uint16_t>());
+
+    for (int i = 0; i < ages.size(); i++) {
+        uint16_t sequenceNumber = (uint16_t) (_newestSequenceNumber - ages.at(i));
+        if (!_missingRanges.isEmpty() && (uint16_t) (_missingRanges.last().first + _missingRanges.last().second)
+                == sequenceNumber) {
+            _missingRanges.last().second++;
+        } else {
+            _missingRanges.append(QPair<uint16_t, uint16_t>(sequenceNumber, 1));
+        }
+    }
+}
+
+QList<uint16_t> SelectiveAck::getMissingSequenceNumbers() const {
+    QList<uint16_t> missingSequenceNumbers;
+    for (int i = 0; i < _missingRanges.size(); i++) {
+        for (uint16_t j = 0; j < _missingRanges.at(i).second; j++) {
+            missingSequenceNumbers.append((uint16_t) (_missingRanges.at(i).first + j));
+        }
+    }
+    return missingSequenceNumbers;
+}
+
+bool SelectiveAck::hasMissingAfter(uint16_t sequenceNumber) const {
+    if (_missingRanges.isEmpty()) {
+        return false;
+    }
+    // the ranges are oldest first, so the end of the last is the newest missing
+    uint16_t newestMissing = (uint16_t) (_missingRanges.last().first + _missingRanges.last().second - 1);
+    return (uint16_t) (_newestSequenceNumber - newestMissing) < (uint16_t) (_newestSequenceNumber - sequenceNumber);
+}
+
+int SelectiveAck::packIntoPacket(char* packet, int maxPacketSize, PacketType type) const {
+    char* dataAt = packet + populatePacketHeader(packet, type);
+
+    memcpy(dataAt, &_newestSequenceNumber, sizeof(_newestSequenceNumber));
+    dataAt += sizeof(_newestSequenceNumber);
+    memcpy(dataAt, &_echoedSentTime, sizeof(_echoedSentTime));
+    dataAt += sizeof(_echoedSentTime);
+    memcpy(dataAt, &_holdUsecs, sizeof(_holdUsecs));
+    dataAt += sizeof(_holdUsecs);
+
+    // the ranges that don't fit are the newest, which are the likeliest to be on their way still
+    int rangesRoomFor = (maxPacketSize - (int) (dataAt - packet) - (int) sizeof(uint16_t)) / BYTES_PER_RANGE;
+    uint16_t numRanges = (uint16_t) std::max(0, std::min(_missingRanges.size(), rangesRoomFor));
+    memcpy(dataAt, &numRanges, sizeof(numRanges));
+    dataAt += sizeof(numRanges);
+
+    for (int i = 0; i < numRanges; i++) {
+        memcpy(dataAt, &_missingRanges.at(i).first, sizeof(uint16_t));
+        dataAt += sizeof(uint16_t);
+        memcpy(dataAt, &_missingRanges.at(i).second, sizeof(uint16_t));
+        dataAt += sizeof(uint16_t);
+    }
+    return dataAt - packet;
+}
+
+bool SelectiveAck::unpackFromPacket(const QByteArray& packet) {
+    _missingRanges.clear();
+
+    int numBytesPacketHeader = numBytesForPacketHeader(packet);
+    if (packet.size() < numBytesPacketHeader + FIXED_ACK_BYTES) {
+        return false;
+    }
+    const char* dataAt = packet.constData() + numBytesPacketHeader;
+
+    memcpy(&_newestSequenceNumber, dataAt, sizeof(_newestSequenceNumber));
+    dataAt += sizeof(_newestSequenceNumber);
+    memcpy(&_echoedSentTime, dataAt, sizeof(_echoedSentTime));
+    dataAt += sizeof(_echoedSentTime);
+    memcpy(&_holdUsecs, dataAt, sizeof(_holdUsecs));
+    dataAt += sizeof(_holdUsecs);
+
+    uint16_t numRanges;
+    memcpy(&numRanges, dataAt, sizeof(numRanges));
+    dataAt += sizeof(numRanges);
+
+    // a truncated packet gives up the ranges it doesn't hold
+    int rangesInPacket = (packet.constData() + packet.size() - dataAt) / BYTES_PER_RANGE;
+    numRanges = (uint16_t) std::min((int) numRanges, rangesInPacket);
+
+    _missingRanges.resize(numRanges);
+    for (int i = 0; i < numRanges; i++) {
+        memcpy(&_missingRanges[i].first, dataAt, sizeof(uint16_t));
+        dataAt += sizeof(uint16_t);
+        memcpy(&_missingRanges[i].second, dataAt, sizeof(uint16_t));
+        dataAt += sizeof(uint16_t);
+    }
+    return true;
+}
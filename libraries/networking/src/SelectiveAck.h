@@ -0,0 +1,62 @@
+//
+//  SelectiveAck.h
+//  libraries/networking/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#ifndef hifi_SelectiveAck_h
+#define hifi_SelectiveAck_h
+
+#include <stdint.h>
+
+#include <QtCore/QByteArray>
+#include <QtCore/QList>
+#include <QtCore/QPair>
+#include <QtCore/QSet>
+#include <QtCore/QVector>
+
+#include "PacketHeaders.h"
+
+/// What the receiver of a stream of sequence numbered packets sends back to its sender: the newest sequence number it
+/// has received, the time that packet was sent echoed back with how long the receiver held on to it, so that the sender
+/// can time the round trip on its own clock, and the sequence numbers it is missing, as ranges of consecutive numbers.
+class SelectiveAck {
+public:
+    SelectiveAck();
+
+    void setNewestSequenceNumber(uint16_t newestSequenceNumber) { _newestSequenceNumber = newestSequenceNumber; }
+    uint16_t getNewestSequenceNumber() const { return _newestSequenceNumber; }
+
+    /// the time, on the sender's clock, that the newest packet received was sent, and the usecs since it arrived
+    void setEcho(quint64 echoedSentTime, quint64 holdUsecs);
+    quint64 getEchoedSentTime() const { return _echoedSentTime; }
+    quint64 getHoldUsecs() const { return _holdUsecs; }
+
+    /// sorts the missing sequence numbers into ranges, oldest first counting back from the newest sequence number
+    void setMissingSequenceNumbers(const QSet<uint16_t>& missingSequenceNumbers);
+    QList<uint16_t> getMissingSequenceNumbers() const;
+    int getNumMissingRanges() const { return _missingRanges.size(); }
+    bool hasMissing() const { return !_missingRanges.isEmpty(); }
+
+    /// is a sequence number newer than this one among the missing
+    bool hasMissingAfter(uint16_t sequenceNumber) const;
+
+    /// writes the header and the ack into packet, with as many of the oldest missing ranges as fit in maxPacketSize,
+    /// and returns the size written
+    int packIntoPacket(char* packet, int maxPacketSize, PacketType type) const;
+
+    /// reads an ack written by packIntoPacket, returns false if the packet is too short to hold one
+    bool unpackFromPacket(const QByteArray& packet);
+
+private:
+    uint16_t _newestSequenceNumber;
+    quint64 _echoedSentTime;
+    quint32 _holdUsecs;
+    QVector<QPair<uint16_t, uint16_t> > _missingRanges; /// the first sequence number of each range and its length
+};
+
+#endif // hifi_SelectiveAck_h
@@ -8,19 +8,35 @@
 //  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
 //
 
+#include <cstring>
 #include <limits>
 #include "SentPacketHistory.h"
 #include <qdebug.h>
 
 SentPacketHistory::SentPacketHistory(int size)
-    : _sentPackets(size),
-    _newestPacketAt(0),
+    : _numSlots(1),
+    _slotMask(0),
+    _slab(),
+    _packetSizes(),
     _numExistingPackets(0),
     _newestSequenceNumber(std::numeric_limits<uint16_t>::max())
 {
+    // one more slot than the packets kept, for the packet that is being written, and a power of two of them so that
+    // the low bits of a sequence number are its slot, across the rollover as well
+    while (_numSlots < size + 1) {
+        _numSlots <<= 1;
+    }
+    _slotMask = _numSlots - 1;
+
+    _slab.resize(_numSlots * MAX_PACKET_SIZE);
+    _packetSizes.fill(0, _numSlots);
 }
 
-void SentPacketHistory::packetSent(uint16_t sequenceNumber, const QByteArray& packet) {
+unsigned char* SentPacketHistory::getSlot(uint16_t sequenceNumber) {
+    return reinterpret_cast<unsigned char*>(_slab.data()) + ((sequenceNumber & _slotMask) * MAX_PACKET_SIZE);
+}
+
+void SentPacketHistory::packetSent(uint16_t sequenceNumber, int packetSize) {
 
     // check if given seq number has the expected value.  if not, something's wrong with
     // the code calling this function
@@ -32,16 +48,20 @@ void SentPacketHistory::packetSent(uint16_t sequenceNumber, const QByteArray& pa
 
     _newestSequenceNumber = sequenceNumber;
 
-    // increment _newestPacketAt cyclically, insert new packet there.
-    // this will overwrite the oldest packet in the buffer
-    _newestPacketAt = (_newestPacketAt == _sentPackets.size() - 1) ? 0 : _newestPacketAt + 1;
-    _sentPackets[_newestPacketAt] = packet;
-    if (_numExistingPackets < _sentPackets.size()) {
+    // the slot of this packet was the slot of the oldest packet, which it overwrote
+    _packetSizes[sequenceNumber & _slotMask] = packetSize;
+    if (_numExistingPackets < _numSlots - 1) {
         _numExistingPackets++;
     }
 }
 
-const QByteArray* SentPacketHistory::getPacket(uint16_t sequenceNumber) const {
+void SentPacketHistory::packetSent(uint16_t sequenceNumber, const QByteArray& packet) {
+    int packetSize = qMin(packet.size(), MAX_PACKET_SIZE);
+    memcpy(getSlot(sequenceNumber), packet.constData(), packetSize);
+    packetSent(sequenceNumber, packetSize);
+}
+
+QByteArray SentPacketHistory::getPacket(uint16_t sequenceNumber) const {
 
     const int UINT16_RANGE = std::numeric_limits<uint16_t>::max() + 1;
 
@@ -53,11 +73,8 @@ const QByteArray* SentPacketHistory::getPacket(uint16_t sequenceNumber) const {
     }
     // if desired sequence number is too old to be found in the history, return null
     if (seqDiff >= _numExistingPackets) {
-        return NULL;
-    }
-    int packetAt = _newestPacketAt - seqDiff;
-    if (packetAt < 0) {
-        packetAt += _sentPackets.size();
+        return QByteArray();
     }
-    return &_sentPackets.at(packetAt);
+    int slot = sequenceNumber & _slotMask;
+    return QByteArray::fromRawData(_slab.constData() + (slot * MAX_PACKET_SIZE), _packetSizes.at(slot));
 }
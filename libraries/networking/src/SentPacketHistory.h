@@ -15,19 +15,36 @@
 #include <qbytearray.h>
 #include <qvector.h>
 
+#include "LimitedNodeList.h"
 #include "SequenceNumberStats.h"
 
+/// Keeps the last size packets sent in a slab of MAX_PACKET_SIZE slots, indexed by the low bits of their sequence
+/// numbers, so that they can be resent when they are nacked. A sender can write a packet straight into the slot it
+/// will be kept in, so that keeping it costs nothing.
 class SentPacketHistory {
 
 public:
     SentPacketHistory(int size = MAX_REASONABLE_SEQUENCE_GAP);
 
+    /// the MAX_PACKET_SIZE bytes the packet with this sequence number is kept in, which it can be written into before
+    /// it is sent. The packet that was there size packets ago can no longer be resent once this is called.
+    unsigned char* getSlot(uint16_t sequenceNumber);
+
+    /// records that the packet with this sequence number was sent from its slot
+    void packetSent(uint16_t sequenceNumber, int packetSize);
+
+    /// copies a packet that was sent from somewhere else into its slot
     void packetSent(uint16_t sequenceNumber, const QByteArray& packet);
-    const QByteArray* getPacket(uint16_t sequenceNumber) const;
+
+    /// returns the packet without copying it, so it is only good until its slot is written again, or a null
+    /// QByteArray if the packet isn't in the history
+    QByteArray getPacket(uint16_t sequenceNumber) const;
 
 private:
-    QVector<QByteArray> _sentPackets;    // circular buffer
-    int _newestPacketAt;
+    int _numSlots;
+    uint16_t _slotMask;
+    QByteArray _slab;
+    QVector<int> _packetSizes;
     int _numExistingPackets;
 
     uint16_t _newestSequenceNumber;
@@ -35,6 +35,9 @@ public:
     quint32 getNumDuplicate() const { return _numDuplicate; }
     const QSet<quint16>& getMissingSet() const { return _missingSet; }
 
+    /// the newest sequence number received, which later ones are counted missing back from
+    quint16 getLastReceived() const { return _lastReceived; }
+
 private:
     quint16 _lastReceived;
     QSet<quint16> _missingSet;
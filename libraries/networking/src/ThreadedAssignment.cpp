@@ -14,13 +14,34 @@
 #include <QtCore/QTimer>
 
 #include "Logging.h"
+#include "Metrics.h"
 #include "ThreadedAssignment.h"
 
+AssignmentPacketQueue::AssignmentPacketQueue(ThreadedAssignment& assignment) :
+    ReceivedPacketProcessor(),
+    _assignment(assignment)
+{
+}
+
+void AssignmentPacketQueue::processPacket(const SharedNodePointer& sendingNode, const QByteArray& packet) {
+    _assignment.processQueuedPacket(sendingNode, packet);
+}
+
 ThreadedAssignment::ThreadedAssignment(const QByteArray& packet) :
     Assignment(packet),
-    _isFinished(false)
+    _isFinished(false),
+    _datagramBuffer(),
+    _packetQueues(),
+    _packetQueuesByType()
 {
-    
+    _datagramBuffer.reserve(MAX_PACKET_SIZE);
+}
+
+ThreadedAssignment::~ThreadedAssignment() {
+    foreach (AssignmentPacketQueue* packetQueue, _packetQueues) {
+        packetQueue->terminate();
+        packetQueue->deleteLater();
+    }
 }
 
 void ThreadedAssignment::setFinished(bool isFinished) {
@@ -58,15 +79,59 @@ void ThreadedAssignment::commonInit(const QString& targetName, NodeType_t nodeTy
     }
 }
 
+int ThreadedAssignment::addPacketQueue(QThread::Priority priority) {
+    AssignmentPacketQueue* packetQueue = new AssignmentPacketQueue(*this);
+    
+    // the queue has to forget the nodes that are killed, or it keeps counting their packets
+    connect(NodeList::getInstance(), &LimitedNodeList::nodeKilled, packetQueue, &ReceivedPacketProcessor::nodeKilled);
+    
+    packetQueue->initialize(true, priority);
+    _packetQueues.append(packetQueue);
+    
+    return _packetQueues.size() - 1;
+}
+
+void ThreadedAssignment::dispatchPacketType(PacketType packetType, int packetQueue) {
+    _packetQueuesByType.insert(packetType, _packetQueues.at(packetQueue));
+}
+
+bool ThreadedAssignment::queuePacketIfDispatched(const QByteArray& packet) {
+    if (_packetQueuesByType.isEmpty()) {
+        return false;
+    }
+    
+    AssignmentPacketQueue* packetQueue = _packetQueuesByType.value(packetTypeForPacket(packet));
+    if (!packetQueue) {
+        return false;
+    }
+    
+    SharedNodePointer sendingNode = NodeList::getInstance()->sendingNodeForPacket(packet);
+    if (!sendingNode) {
+        return false;
+    }
+    
+    // the packet has been read into the datagram buffer, which the next datagram is about to be read into
+    packetQueue->queueReceivedPacket(sendingNode, QByteArray(packet.constData(), packet.size()));
+    return true;
+}
+
 void ThreadedAssignment::addPacketStatsAndSendStatsPacket(QJsonObject &statsObject) {
     NodeList* nodeList = NodeList::getInstance();
     
     float packetsPerSecond, bytesPerSecond;
     nodeList->getPacketStats(packetsPerSecond, bytesPerSecond);
+    
+    float hashedBytesPerSecond, hashedBytesPerHashingSecond;
+    nodeList->getPacketHashStats(hashedBytesPerSecond, hashedBytesPerHashingSecond);
     nodeList->resetPacketStats();
     
     statsObject["packets_per_second"] = packetsPerSecond;
     statsObject["bytes_per_second"] = bytesPerSecond;
+    statsObject["hashed_bytes_per_second"] = hashedBytesPerSecond;
+    statsObject["packet_hash_throughput_megabytes_per_second"] = hashedBytesPerHashingSecond / (1024.0f * 1024.0f);
+    
+    // and whatever the assignment put in the metrics registry, which goes to StatsD from here too
+    MetricsRegistry::getInstance().addToStatsObject(statsObject);
     
     nodeList->sendStatsToDomainServer(statsObject);
 }
@@ -85,14 +150,6 @@ void ThreadedAssignment::checkInWithDomainServerOrExit() {
 }
 
 bool ThreadedAssignment::readAvailableDatagram(QByteArray& destinationByteArray, HifiSockAddr& senderSockAddr) {
-    NodeList* nodeList = NodeList::getInstance();
-    
-    if (nodeList->getNodeSocket().hasPendingDatagrams()) {
-        destinationByteArray.resize(nodeList->getNodeSocket().pendingDatagramSize());
-        nodeList->getNodeSocket().readDatagram(destinationByteArray.data(), destinationByteArray.size(),
-                                               senderSockAddr.getAddressPointer(), senderSockAddr.getPortPointer());
-        return true;
-    } else {
-        return false;
-    }
+    // the node list reads whatever is waiting in one batch and hands the datagrams out one at a time
+    return NodeList::getInstance()->readPendingDatagram(destinationByteArray, senderSockAddr);
 }
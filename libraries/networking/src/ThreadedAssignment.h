@@ -12,14 +12,37 @@
 #ifndef hifi_ThreadedAssignment_h
 #define hifi_ThreadedAssignment_h
 
+#include <QtCore/QHash>
 #include <QtCore/QSharedPointer>
+#include <QtCore/QVector>
 
 #include "Assignment.h"
+#include "PacketHeaders.h"
+#include "ReceivedPacketProcessor.h"
+
+class ThreadedAssignment;
+
+/// A queue of received packets with a thread of its own, that hands each of them back to the assignment's
+/// processQueuedPacket on that thread.
+class AssignmentPacketQueue : public ReceivedPacketProcessor {
+public:
+    AssignmentPacketQueue(ThreadedAssignment& assignment);
+
+protected:
+    virtual void processPacket(const SharedNodePointer& sendingNode, const QByteArray& packet);
+
+private:
+    ThreadedAssignment& _assignment;
+};
 
 class ThreadedAssignment : public Assignment {
     Q_OBJECT
 public:
     ThreadedAssignment(const QByteArray& packet);
+    ~ThreadedAssignment();
+    
+    /// processes a packet of a type that was dispatched to a packet queue, on the thread of that queue
+    virtual void processQueuedPacket(const SharedNodePointer& sendingNode, const QByteArray& packet) { }
     void setFinished(bool isFinished);
     virtual void aboutToFinish() { };
     void addPacketStatsAndSendStatsPacket(QJsonObject& statsObject);
@@ -33,7 +56,26 @@ public slots:
 protected:
     bool readAvailableDatagram(QByteArray& destinationByteArray, HifiSockAddr& senderSockAddr);
     void commonInit(const QString& targetName, NodeType_t nodeType, bool shouldSendStats = true);
+    
+    /// starts a packet queue with a thread of the given priority and returns its index, for dispatchPacketType
+    int addPacketQueue(QThread::Priority priority = QThread::InheritPriority);
+    
+    /// has packets of the given type processed on the given packet queue instead of by readPendingDatagrams, so that
+    /// slow handlers don't hold up the packets that the event loop handles
+    void dispatchPacketType(PacketType packetType, int packetQueue);
+    
+    /// queues a copy of the packet if its type was dispatched and it comes from a node we know, or returns false so
+    /// that readPendingDatagrams handles it itself
+    bool queuePacketIfDispatched(const QByteArray& packet);
+    
     bool _isFinished;
+    
+    /// a buffer with room for the largest datagram, for readPendingDatagrams to read every datagram into so that
+    /// receiving doesn't allocate
+    QByteArray _datagramBuffer;
+    
+    QVector<AssignmentPacketQueue*> _packetQueues;
+    QHash<PacketType, AssignmentPacketQueue*> _packetQueuesByType;
 private slots:
     void checkInWithDomainServerOrExit();
 signals:
@@ -23,50 +23,106 @@ UserActivityLogger& UserActivityLogger::getInstance() {
     return sharedInstance;
 }
 
-UserActivityLogger::UserActivityLogger() {
+UserActivityLogger::UserActivityLogger() :
+    _pendingActions(),
+    _isSending(false)
+{
 }
 
 void UserActivityLogger::logAction(QString action, QJsonObject details, JSONCallbackParameters params) {
-    AccountManager& accountManager = AccountManager::getInstance();
-    QHttpMultiPart* multipart = new QHttpMultiPart(QHttpMultiPart::FormDataType);
-    
-    // Adding the action name
-    QHttpPart actionPart;
-    actionPart.setHeader(QNetworkRequest::ContentDispositionHeader, "form-data; name=\"action_name\"");
-    actionPart.setBody(QByteArray().append(action));
-    multipart->append(actionPart);
-    
-    // If there are action details, add them to the multipart
-    if (!details.isEmpty()) {
-        QHttpPart detailsPart;
-        detailsPart.setHeader(QNetworkRequest::ContentDispositionHeader, "form-data;"
-                              " name=\"action_details\"");
-        detailsPart.setBody(QJsonDocument(details).toJson(QJsonDocument::Compact));
-        multipart->append(detailsPart);
+    if (params.isEmpty()) {
+        // the one in flight has been posted, so only those behind it can stand in for this
+        for (int i = _isSending ? 1 : 0; i < _pendingActions.size(); i++) {
+            const PendingAction& pendingAction = _pendingActions.at(i);
+            if (pendingAction.params.isEmpty() && pendingAction.action == action && pendingAction.details == details) {
+                return;
+            }
+        }
     }
-    qDebug() << "Logging activity" << action;
+    PendingAction pendingAction;
+    pendingAction.action = action;
+    pendingAction.details = details;
+    pendingAction.params = params;
+    _pendingActions.enqueue(pendingAction);
     
-    // if no callbacks specified, call our owns
-    if (params.isEmpty()) {
+    sendNextAction();
+}
+
+void UserActivityLogger::sendNextAction() {
+    AccountManager& accountManager = AccountManager::getInstance();
+    while (!_isSending && !_pendingActions.isEmpty()) {
+        if (!accountManager.hasValidAccessToken()) {
+            // the account manager would drop the request without a word, which would leave the queue waiting on it
+            qDebug() << "Not logging activity" << _pendingActions.head().action << "without an access token";
+            _pendingActions.dequeue();
+            continue;
+        }
+        const PendingAction& pendingAction = _pendingActions.head();
+        QHttpMultiPart* multipart = new QHttpMultiPart(QHttpMultiPart::FormDataType);
+        
+        // Adding the action name
+        QHttpPart actionPart;
+        actionPart.setHeader(QNetworkRequest::ContentDispositionHeader, "form-data; name=\"action_name\"");
+        actionPart.setBody(QByteArray().append(pendingAction.action));
+        multipart->append(actionPart);
+        
+        // If there are action details, add them to the multipart
+        if (!pendingAction.details.isEmpty()) {
+            QHttpPart detailsPart;
+            detailsPart.setHeader(QNetworkRequest::ContentDispositionHeader, "form-data;"
+                                  " name=\"action_details\"");
+            detailsPart.setBody(QJsonDocument(pendingAction.details).toJson(QJsonDocument::Compact));
+            multipart->append(detailsPart);
+        }
+        qDebug() << "Logging activity" << pendingAction.action;
+        
+        // the replies come back to us whatever the callbacks, so that we know when to post the next action
+        JSONCallbackParameters params;
         params.jsonCallbackReceiver = this;
         params.jsonCallbackMethod = "requestFinished";
         params.errorCallbackReceiver = this;
         params.errorCallbackMethod = "requestError";
+        
+        _isSending = true;
+        accountManager.authenticatedRequest(USER_ACTIVITY_URL,
+                                            QNetworkAccessManager::PostOperation,
+                                            params,
+                                            NULL,
+                                            multipart);
     }
-    
-    accountManager.authenticatedRequest(USER_ACTIVITY_URL,
-                                        QNetworkAccessManager::PostOperation,
-                                        params,
-                                        NULL,
-                                        multipart);
+}
+
+void UserActivityLogger::finishAction() {
+    if (!_pendingActions.isEmpty()) {
+        _pendingActions.dequeue();
+    }
+    _isSending = false;
+    sendNextAction();
 }
 
 void UserActivityLogger::requestFinished(const QJsonObject& object) {
-    qDebug() << object;
+    // pass it on to the callback the action was logged with, if it had one
+    const JSONCallbackParameters& params = _pendingActions.isEmpty() ? JSONCallbackParameters() :
+        _pendingActions.head().params;
+    if (params.jsonCallbackReceiver) {
+        QMetaObject::invokeMethod(params.jsonCallbackReceiver, qPrintable(params.jsonCallbackMethod),
+                                  Q_ARG(const QJsonObject&, object));
+    } else {
+        qDebug() << object;
+    }
+    finishAction();
 }
 
 void UserActivityLogger::requestError(QNetworkReply::NetworkError error,const QString& string) {
-    qDebug() << error << ": " << string;
+    const JSONCallbackParameters& params = _pendingActions.isEmpty() ? JSONCallbackParameters() :
+        _pendingActions.head().params;
+    if (params.errorCallbackReceiver) {
+        QMetaObject::invokeMethod(params.errorCallbackReceiver, qPrintable(params.errorCallbackMethod),
+                                  Q_ARG(QNetworkReply::NetworkError, error), Q_ARG(const QString&, string));
+    } else {
+        qDebug() << error << ": " << string;
+    }
+    finishAction();
 }
 
 void UserActivityLogger::launch(QString applicationVersion) {
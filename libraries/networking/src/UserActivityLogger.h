@@ -15,10 +15,14 @@
 #include "AccountManager.h"
 
 #include <QObject>
+#include <QQueue>
 #include <QString>
 #include <QJsonObject>
 #include <QNetworkReply>
 
+/// Logs what the user does to the data-server. Actions are queued and posted one at a time, so a burst of them, as at
+/// login or on a domain change, doesn't race the account requests for connections, and an action that's the same as one
+/// still waiting in the queue is dropped.
 class UserActivityLogger : public QObject {
     Q_OBJECT
     
@@ -42,6 +46,22 @@ private slots:
     
 private:
     UserActivityLogger();
+    
+    class PendingAction {
+    public:
+        QString action;
+        QJsonObject details;
+        JSONCallbackParameters params;
+    };
+    
+    /// posts the action at the head of the queue, if none is in flight
+    void sendNextAction();
+    
+    /// the action in flight is done with, so take it off the queue and post the next one
+    void finishAction();
+    
+    QQueue<PendingAction> _pendingActions;
+    bool _isSending;
 };
 
 #endif // hifi_UserActivityLogger_h
\ No newline at end of file
@@ -42,7 +42,8 @@ bool JurisdictionListener::queueJurisdictionRequest() {
     
     foreach (const SharedNodePointer& node, nodeList->getNodeHash()) {
         if (node->getType() == getNodeType() && node->getActiveSocket()) {
-            _packetSender.queuePacketForSending(node, QByteArray(reinterpret_cast<char*>(bufferOut), sizeOut));
+            _packetSender.queuePacketForSending(node, QByteArray(reinterpret_cast<char*>(bufferOut), sizeOut),
+                                                PacketSender::CONTROL_PRIORITY);
             nodeCount++;
         }
     }
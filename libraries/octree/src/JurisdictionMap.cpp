@@ -207,6 +207,18 @@ JurisdictionMap::Area JurisdictionMap::isMyJurisdiction(const unsigned char* nod
     return isInJurisdiction ? WITHIN : BELOW;
 }
 
+bool JurisdictionMap::containsSubtree(const unsigned char* nodeOctalCode) const {
+    if (isMyJurisdiction(nodeOctalCode, CHECK_NODE_ONLY) != WITHIN) {
+        return false;
+    }
+    for (size_t i = 0; i < _endNodes.size(); i++) {
+        if (isAncestorOf(nodeOctalCode, _endNodes[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
 
 bool JurisdictionMap::readFromFile(const char* filename) {
     QString     settingsFile(filename);
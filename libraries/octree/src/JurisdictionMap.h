@@ -51,6 +51,9 @@ public:
 
     Area isMyJurisdiction(const unsigned char* nodeOctalCode, int childIndex) const;
 
+    /// whether the node and all of its descendants are within the jurisdiction, none of them under an end node
+    bool containsSubtree(const unsigned char* nodeOctalCode) const;
+
     bool writeToFile(const char* filename);
     bool readFromFile(const char* filename);
 
@@ -60,6 +63,9 @@ public:
 
     void copyContents(unsigned char* rootCodeIn, const std::vector<unsigned char*>& endNodesIn);
 
+    /// leaves the map without a root, so that nothing is within it
+    void clear();
+
     int unpackFromMessage(const unsigned char* sourceBuffer, int availableBytes);
     int packIntoMessage(unsigned char* destinationBuffer, int availableBytes);
     
@@ -73,7 +79,6 @@ public:
     
 private:
     void copyContents(const JurisdictionMap& other); // use assignment instead
-    void clear();
     void init(unsigned char* rootOctalCode, const std::vector<unsigned char*>& endNodes);
 
     unsigned char* _rootOctalCode;
@@ -39,6 +39,19 @@ void JurisdictionSender::processPacket(const SharedNodePointer& sendingNode, con
     }
 }
 
+void JurisdictionSender::broadcastJurisdiction() {
+    lockRequestingNodes();
+    foreach (const SharedNodePointer& node, NodeList::getInstance()->getNodeHash()) {
+        if (node->getType() == NodeType::Agent) {
+            _nodesRequestingJurisdictions.push(node->getUUID());
+        }
+    }
+    unlockRequestingNodes();
+
+    // we may be waiting for a request to come in, so wake up to send it
+    _packets.wakeAll();
+}
+
 bool JurisdictionSender::process() {
     bool continueProcessing = isStillRunning();
 
@@ -64,7 +77,8 @@ bool JurisdictionSender::process() {
             SharedNodePointer node = NodeList::getInstance()->nodeWithUUID(nodeUUID);
 
             if (node && node->getActiveSocket()) {
-                _packetSender.queuePacketForSending(node, QByteArray(reinterpret_cast<char *>(bufferOut), sizeOut));
+                _packetSender.queuePacketForSending(node, QByteArray(reinterpret_cast<char *>(bufferOut), sizeOut),
+                                                    PacketSender::CONTROL_PRIORITY);
                 nodeCount++;
             }
         }
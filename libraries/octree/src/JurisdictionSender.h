@@ -32,6 +32,9 @@ public:
 
     void setJurisdiction(JurisdictionMap* map) { _jurisdictionMap = map; }
 
+    /// sends our jurisdiction to all of the agents, rather than waiting for them to ask, used when it changes
+    void broadcastJurisdiction();
+
     virtual bool process();
 
     NodeType_t getNodeType() const { return _nodeType; }
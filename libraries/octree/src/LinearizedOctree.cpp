@@ -0,0 +1,77 @@
+//
+//  LinearizedOctree.cpp
+//  libraries/octree/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#include <SharedUtil.h>
+
+#include "OctreeElement.h"
+
+#include "LinearizedOctree.h"
+
+LinearizedOctree::LinearizedOctree() :
+    _nodes()
+{
+}
+
+void LinearizedOctree::build(OctreeElement* root) {
+    _nodes.clear();
+    if (!root) {
+        return;
+    }
+    Node rootNode = { root, 0, 0 };
+    _nodes.append(rootNode);
+
+    // each node's children are appended as it comes up, so they end up side by side and in breadth-first order
+    for (int i = 0; i < _nodes.size(); i++) {
+        OctreeElement* element = _nodes.at(i).element;
+        int firstChild = _nodes.size();
+        unsigned char childBitmask = 0;
+        for (int childIndex = 0; childIndex < NUMBER_OF_CHILDREN; childIndex++) {
+            OctreeElement* child = element->getChildAtIndex(childIndex);
+            if (child) {
+                setAtBit(childBitmask, childIndex);
+                Node childNode = { child, 0, 0 };
+                _nodes.append(childNode);
+            }
+        }
+        Node& node = _nodes[i];
+        node.firstChild = firstChild;
+        node.childBitmask = childBitmask;
+    }
+    _nodes.squeeze();
+}
+
+int LinearizedOctree::getChildNodeIndex(int nodeIndex, int childIndex) const {
+    const Node& node = _nodes.at(nodeIndex);
+    if (!oneAtBit(node.childBitmask, childIndex)) {
+        return -1;
+    }
+    // the children before this one are the set bits above its own
+    unsigned char lowerChildren = (unsigned char) (0xFF << (BITS_IN_BYTE - childIndex));
+    return node.firstChild + numberOfOnes(node.childBitmask & lowerChildren);
+}
+
+void LinearizedOctree::recurseWithOperation(RecurseOctreeOperation operation, void* extraData) const {
+    if (_nodes.isEmpty()) {
+        return;
+    }
+    // the nodes still to visit, with the children pushed last to first so that the first is visited first
+    QVector<int> stack;
+    stack.append(0);
+    while (!stack.isEmpty()) {
+        const Node& node = _nodes.at(stack.last());
+        stack.removeLast();
+        if (!operation(node.element, extraData)) {
+            continue;
+        }
+        for (int i = numberOfOnes(node.childBitmask) - 1; i >= 0; i--) {
+            stack.append(node.firstChild + i);
+        }
+    }
+}
@@ -0,0 +1,77 @@
+//
+//  LinearizedOctree.h
+//  libraries/octree/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#ifndef hifi_LinearizedOctree_h
+#define hifi_LinearizedOctree_h
+
+#include <QtCore/QVector>
+
+#include "Octree.h"
+
+/// A frozen copy of the shape of an octree: its elements in one array in breadth-first order, the children of each
+/// element side by side, so that a child is found at an offset from the first counted from the element's child bitmask.
+/// Read-only traversals walk the array rather than chasing each element's compressed children. The copy holds on to
+/// the elements themselves, so it must be built again once elements are added or deleted.
+class LinearizedOctree {
+public:
+    LinearizedOctree();
+
+    /// copies the shape of the tree under root, whose elements must not be added to or deleted while it's in use
+    void build(OctreeElement* root);
+    void clear() { _nodes.clear(); }
+
+    bool isEmpty() const { return _nodes.isEmpty(); }
+    int getNodeCount() const { return _nodes.size(); }
+
+    OctreeElement* getElement(int nodeIndex) const { return _nodes.at(nodeIndex).element; }
+
+    /// returns the node index of the child at childIndex of the node, or -1 if it has none there
+    int getChildNodeIndex(int nodeIndex, int childIndex) const;
+
+    /// calls operation on each element in the same order as Octree::recurseTreeWithOperation, not descending into the
+    /// children of the elements it returns false for
+    void recurseWithOperation(RecurseOctreeOperation operation, void* extraData) const;
+
+    /// visits each element in the same order, calling visitor(element) as Octree::visitTree does
+    template<typename ElementType, typename Visitor>
+    void visit(Visitor& visitor) const;
+
+private:
+    class Node {
+    public:
+        OctreeElement* element;
+        int firstChild; ///< the node index of the child with the lowest index
+        unsigned char childBitmask; ///< child index 0 is the high bit, as in OctreeElement
+    };
+
+    QVector<Node> _nodes;
+};
+
+template<typename ElementType, typename Visitor>
+void LinearizedOctree::visit(Visitor& visitor) const {
+    if (_nodes.isEmpty()) {
+        return;
+    }
+    // as in recurseWithOperation, the children are pushed last to first so that the first is visited first
+    QVector<int> stack;
+    stack.append(0);
+    while (!stack.isEmpty()) {
+        const Node& node = _nodes.at(stack.last());
+        stack.removeLast();
+        if (!visitor(static_cast<ElementType*>(node.element))) {
+            continue;
+        }
+        for (int i = numberOfOnes(node.childBitmask) - 1; i >= 0; i--) {
+            stack.append(node.firstChild + i);
+        }
+    }
+}
+
+#endif // hifi_LinearizedOctree_h
@@ -0,0 +1,188 @@
+//
+//  OcclusionBuffer.cpp
+//  libraries/octree/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+#include <glm/glm.hpp>
+
+#include "OcclusionBuffer.h"
+#include "ViewFrustum.h"
+
+OcclusionBuffer::OcclusionBuffer(int resolution) :
+    _resolution(1),
+    _levels(),
+    _numOccluders(0)
+{
+    while (_resolution < resolution) {
+        _resolution <<= 1;
+    }
+    for (int levelResolution = _resolution; levelResolution > 0; levelResolution >>= 1) {
+        _levels.append(QVector<float>(levelResolution * levelResolution, FLT_MAX));
+    }
+}
+
+void OcclusionBuffer::erase() {
+    if (_numOccluders == 0) {
+        return;
+    }
+    for (int i = 0; i < _levels.size(); i++) {
+        _levels[i].fill(FLT_MAX);
+    }
+    _numOccluders = 0;
+}
+
+void OcclusionBuffer::addOccluder(const ViewFrustum& viewFrustum, const AACube& cube) {
+    OctreeProjectedPolygon polygon = viewFrustum.getProjectedPolygon(cube);
+
+    // a cube that's partly behind the viewer doesn't project to a polygon that can be trusted
+    if (!polygon.getAllInView()) {
+        return;
+    }
+    glm::vec3 furthestPoint;
+    viewFrustum.getFurthestPointFromCamera(cube, furthestPoint);
+    addOccluder(polygon, glm::distance(viewFrustum.getPosition(), furthestPoint));
+}
+
+bool OcclusionBuffer::isOccluded(const ViewFrustum& viewFrustum, const AACube& cube) const {
+    if (_numOccluders == 0) {
+        return false;
+    }
+    OctreeProjectedPolygon polygon = viewFrustum.getProjectedPolygon(cube);
+    if (!polygon.getAllInView()) {
+        return false;
+    }
+    const glm::vec3& position = viewFrustum.getPosition();
+    glm::vec3 nearestPoint = glm::clamp(position, cube.getCorner(), cube.getCorner() + glm::vec3(cube.getScale()));
+    return isOccluded(polygon, glm::distance(position, nearestPoint));
+}
+
+int OcclusionBuffer::toPixel(float screenCoordinate) const {
+    return (int) floorf((screenCoordinate + 1.0f) * 0.5f * _resolution);
+}
+
+void OcclusionBuffer::addOccluder(const OctreeProjectedPolygon& polygon, float farDistance) {
+    int vertexCount = polygon.getVertexCount();
+    const int MIN_VERTEX_COUNT = 3;
+    if (vertexCount < MIN_VERTEX_COUNT) {
+        return;
+    }
+    glm::vec2 vertices[MAX_CLIPPED_PROJECTED_POLYGON_VERTEX_COUNT];
+    float area = 0.0f;
+    for (int i = 0; i < vertexCount; i++) {
+        vertices[i] = (polygon.getVertex(i) + glm::vec2(1.0f, 1.0f)) * (0.5f * _resolution);
+    }
+    for (int i = 0; i < vertexCount; i++) {
+        const glm::vec2& next = vertices[(i + 1) % vertexCount];
+        area += vertices[i].x * next.y - next.x * vertices[i].y;
+    }
+    if (area == 0.0f) {
+        return;
+    }
+    float winding = (area > 0.0f) ? 1.0f : -1.0f;
+
+    // only the pixels whose squares are entirely inside the polygon are covered, so the covering is never overstated
+    float minX = (polygon.getMinX() + 1.0f) * 0.5f * _resolution;
+    float minY = (polygon.getMinY() + 1.0f) * 0.5f * _resolution;
+    float maxX = (polygon.getMaxX() + 1.0f) * 0.5f * _resolution;
+    float maxY = (polygon.getMaxY() + 1.0f) * 0.5f * _resolution;
+    int firstX = std::max(0, (int) ceilf(minX));
+    int firstY = std::max(0, (int) ceilf(minY));
+    int lastX = std::min(_resolution - 1, (int) floorf(maxX) - 1);
+    int lastY = std::min(_resolution - 1, (int) floorf(maxY) - 1);
+    if (firstX > lastX || firstY > lastY) {
+        return;
+    }
+
+    QVector<float>& pixels = _levels[0];
+    int coveredMinX = _resolution, coveredMinY = _resolution, coveredMaxX = -1, coveredMaxY = -1;
+    for (int y = firstY; y <= lastY; y++) {
+        for (int x = firstX; x <= lastX; x++) {
+            bool covered = true;
+            for (int corner = 0; covered && corner < 4; corner++) {
+                glm::vec2 point(x + (corner & 1), y + (corner >> 1));
+                for (int i = 0; i < vertexCount; i++) {
+                    const glm::vec2& from = vertices[i];
+                    const glm::vec2& to = vertices[(i + 1) % vertexCount];
+                    float side = (to.x - from.x) * (point.y - from.y) - (to.y - from.y) * (point.x - from.x);
+                    if (winding * side < 0.0f) {
+                        covered = false;
+                        break;
+                    }
+                }
+            }
+            if (covered) {
+                float& depth = pixels[y * _resolution + x];
+                if (farDistance < depth) {
+                    depth = farDistance;
+                    coveredMinX = std::min(coveredMinX, x);
+                    coveredMinY = std::min(coveredMinY, y);
+                    coveredMaxX = std::max(coveredMaxX, x);
+                    coveredMaxY = std::max(coveredMaxY, y);
+                }
+            }
+        }
+    }
+    if (coveredMaxX >= 0) {
+        updatePyramid(coveredMinX, coveredMinY, coveredMaxX, coveredMaxY);
+        _numOccluders++;
+    }
+}
+
+bool OcclusionBuffer::isOccluded(const OctreeProjectedPolygon& polygon, float nearDistance) const {
+    if (_numOccluders == 0 || polygon.getVertexCount() == 0) {
+        return false;
+    }
+    // every pixel the polygon touches, as far as they're on the screen
+    int minX = std::max(0, toPixel(polygon.getMinX()));
+    int minY = std::max(0, toPixel(polygon.getMinY()));
+    int maxX = std::min(_resolution - 1, toPixel(polygon.getMaxX()));
+    int maxY = std::min(_resolution - 1, toPixel(polygon.getMaxY()));
+    if (minX > maxX || minY > maxY) {
+        return false;
+    }
+
+    // up the pyramid until the pixels are covered by two by two at most, which cover at least as much of the screen
+    int level = 0;
+    while ((maxX >> level) - (minX >> level) > 1 || (maxY >> level) - (minY >> level) > 1) {
+        level++;
+    }
+    const QVector<float>& depths = _levels.at(level);
+    int levelResolution = _resolution >> level;
+    for (int y = minY >> level; y <= (maxY >> level); y++) {
+        for (int x = minX >> level; x <= (maxX >> level); x++) {
+            if (depths.at(y * levelResolution + x) >= nearDistance) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+void OcclusionBuffer::updatePyramid(int minX, int minY, int maxX, int maxY) {
+    for (int level = 1; level < _levels.size(); level++) {
+        minX >>= 1;
+        minY >>= 1;
+        maxX >>= 1;
+        maxY >>= 1;
+        const QVector<float>& below = _levels.at(level - 1);
+        QVector<float>& depths = _levels[level];
+        int levelResolution = _resolution >> level;
+        int belowResolution = levelResolution << 1;
+        for (int y = minY; y <= maxY; y++) {
+            for (int x = minX; x <= maxX; x++) {
+                int belowIndex = (y << 1) * belowResolution + (x << 1);
+                depths[y * levelResolution + x] = std::max(std::max(below.at(belowIndex), below.at(belowIndex + 1)),
+                    std::max(below.at(belowIndex + belowResolution), below.at(belowIndex + belowResolution + 1)));
+            }
+        }
+    }
+}
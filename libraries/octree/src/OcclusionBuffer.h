@@ -0,0 +1,63 @@
+//
+//  OcclusionBuffer.h
+//  libraries/octree/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#ifndef hifi_OcclusionBuffer_h
+#define hifi_OcclusionBuffer_h
+
+#include <QtCore/QVector>
+
+#include "AACube.h"
+#include "OctreeProjectedPolygon.h"
+
+class ViewFrustum;
+
+const int DEFAULT_OCCLUSION_BUFFER_RESOLUTION = 64;
+
+/// A low resolution depth buffer of the screen, for culling cubes hidden behind nearer ones when a view is walked
+/// front to back. Each pixel holds the distance past which it's known to be covered. A cube added as an occluder
+/// marks the pixels its projection fully covers as covered past its furthest corner. A cube is occluded if its
+/// nearest point is further off than that in every pixel its projection touches. The pixels are kept in a pyramid,
+/// each level holding the furthest distance of the four below it, so that testing a cube reads four values at most.
+class OcclusionBuffer {
+public:
+    /// the resolution is rounded up to a power of two
+    OcclusionBuffer(int resolution = DEFAULT_OCCLUSION_BUFFER_RESOLUTION);
+
+    /// uncovers every pixel, to be called when the view changes
+    void erase();
+
+    /// adds a cube, in TREE_SCALE, that can't be seen through
+    void addOccluder(const ViewFrustum& viewFrustum, const AACube& cube);
+
+    /// is the cube, in TREE_SCALE, behind what's been added wherever it projects
+    bool isOccluded(const ViewFrustum& viewFrustum, const AACube& cube) const;
+
+    /// adds a projected polygon, in screen coordinates, that can't be seen through short of farDistance
+    void addOccluder(const OctreeProjectedPolygon& polygon, float farDistance);
+
+    /// is a projected polygon, none of whose points is nearer than nearDistance, behind what's been added
+    bool isOccluded(const OctreeProjectedPolygon& polygon, float nearDistance) const;
+
+    int getResolution() const { return _resolution; }
+    int getNumOccluders() const { return _numOccluders; }
+
+private:
+    /// the pixel a screen coordinate falls in, unclamped
+    int toPixel(float screenCoordinate) const;
+
+    /// brings the levels above the pixels in the rectangle up to date
+    void updatePyramid(int minX, int minY, int maxX, int maxY);
+
+    int _resolution;
+    QVector<QVector<float> > _levels; /// level 0 is the pixels, the last is one for the whole screen
+    int _numOccluders;
+};
+
+#endif // hifi_OcclusionBuffer_h
@@ -17,8 +17,12 @@
 #include <cstdio>
 #include <cmath>
 #include <fstream> // to load voxels from file
+#include <sstream>
 
 #include <QDebug>
+#include <QFile>
+#include <QRunnable>
+#include <QThreadPool>
 
 #include <GeometryUtil.h>
 #include <OctalCode.h>
@@ -26,35 +30,132 @@
 #include <SharedUtil.h>
 #include <Shape.h>
 #include <ShapeCollider.h>
+#include <SlabAllocator.h>
 
 //#include "Tags.h"
 
 #include "CoverageMap.h"
+#include "LinearizedOctree.h"
+#include "OcclusionBuffer.h"
 #include "OctreeConstants.h"
+#include "OctreeColorPalette.h"
 #include "OctreeElementBag.h"
+#include "OctreeEncodeCache.h"
 #include "Octree.h"
+#include "SVOFileReader.h"
 #include "ViewFrustum.h"
 
 float boundaryDistanceForRenderLevel(unsigned int renderLevel, float voxelSizeScale) {
     return voxelSizeScale / powf(2, renderLevel);
 }
 
+// subtrees that are sent fewer levels deep than this are quicker to encode than to look up
+const int MIN_CACHED_LOD_DEPTH = 2;
+
+/// how many levels below an element are in its view's level of detail, or -1 if that's not the same all over the element
+static int lodDepthInView(const OctreeElement* element, const EncodeBitstreamParams& params) {
+    const AACube& cube = element->getAACube();
+    glm::vec3 minimum = cube.getCorner() * (float)TREE_SCALE;
+    glm::vec3 maximum = minimum + glm::vec3(cube.getScale() * (float)TREE_SCALE);
+    const glm::vec3& position = params.viewFrustum->getPosition();
+    glm::vec3 furthest(position.x < (minimum.x + maximum.x) * 0.5f ? maximum.x : minimum.x,
+                       position.y < (minimum.y + maximum.y) * 0.5f ? maximum.y : minimum.y,
+                       position.z < (minimum.z + maximum.z) * 0.5f ? maximum.z : minimum.z);
+    float nearestDistance = glm::distance(position, glm::clamp(position, minimum, maximum));
+    float furthestDistance = glm::distance(position, furthest);
+
+    // every element below is sent down to the first level whose boundary is nearer than the element's furthest point,
+    // and none is sent from there on if that boundary is nearer than its nearest point too
+    int depth = 0;
+    float boundaryDistance;
+    do {
+        depth++;
+        boundaryDistance = boundaryDistanceForRenderLevel(element->getLevel() + depth + params.boundaryLevelAdjust,
+                                                          params.octreeElementSizeScale);
+    } while (furthestDistance < boundaryDistance);
+
+    return (nearestDistance >= boundaryDistance) ? depth - 1 : -1;
+}
+
 Octree::Octree(bool shouldReaverage) :
     _rootElement(NULL),
     _isDirty(true),
     _shouldReaverage(shouldReaverage),
     _stopImport(false),
+    _stopExport(false),
     _lock(),
-    _isViewing(false) 
+    _isViewing(false),
+    _wantLinearizedReads(false),
+    _wantColorPalette(false),
+    _linearized(NULL),
+    _linearizedMutex(),
+    _structureVersion(0),
+    _linearizedVersion(-1),
+    _lastStructureChange(0)
 {
 }
 
 Octree::~Octree() {
+    delete _linearized;
+
     // delete the children of the root element
     // this recursively deletes the tree
     delete _rootElement;
 }
 
+bool Octree::tryLockForWrite() {
+    if (_lock.tryLockForWrite()) {
+        structureMayHaveChanged();
+        return true;
+    }
+    return false;
+}
+
+void Octree::structureMayHaveChanged() {
+    _structureVersion.ref();
+    _lastStructureChange = usecTimestampNow();
+}
+
+// a tree written to more recently than this is likely to be written to again before a linearized copy pays for itself
+const quint64 LINEARIZE_AFTER_UNCHANGED_USECS = USECS_PER_SECOND;
+
+void Octree::recurseTreeWithReadOperation(RecurseOctreeOperation operation, void* extraData) {
+    const LinearizedOctree* linearized = getLinearizedForRead();
+    if (linearized) {
+        linearized->recurseWithOperation(operation, extraData);
+        return;
+    }
+    recurseTreeWithOperation(operation, extraData);
+}
+
+template<typename ElementType, typename Visitor>
+void Octree::visitTreeForRead(Visitor& visitor) {
+    const LinearizedOctree* linearized = getLinearizedForRead();
+    if (linearized) {
+        linearized->visit<ElementType>(visitor);
+        return;
+    }
+    visitTree<ElementType>(visitor);
+}
+
+const LinearizedOctree* Octree::getLinearizedForRead() {
+    if (!_wantLinearizedReads) {
+        return NULL;
+    }
+    // readers hold the read lock, so once the copy is up to date no one makes it again while it's walked
+    QMutexLocker locker(&_linearizedMutex);
+    int structureVersion = _structureVersion.load();
+    if (_linearizedVersion != structureVersion &&
+            usecTimestampNow() - _lastStructureChange > LINEARIZE_AFTER_UNCHANGED_USECS) {
+        if (!_linearized) {
+            _linearized = new LinearizedOctree();
+        }
+        _linearized->build(_rootElement);
+        _linearizedVersion = structureVersion;
+    }
+    return (_linearizedVersion == structureVersion) ? _linearized : NULL;
+}
+
 // Recurses voxel tree calling the RecurseOctreeOperation function for each element.
 // stops recursion if operation function returns false.
 void Octree::recurseTreeWithOperation(RecurseOctreeOperation operation, void* extraData) {
@@ -66,6 +167,40 @@ void Octree::recurseTreeWithPostOperation(RecurseOctreeOperation operation, void
     recurseElementWithPostOperation(_rootElement, operation, extraData);
 }
 
+/// Recurses the subtree under an element on a thread of a pool.
+class OctreeSubtreeRecurser : public QRunnable {
+public:
+    OctreeSubtreeRecurser(Octree* tree, OctreeElement* element, RecurseOctreeOperation operation, void* extraData) :
+        _tree(tree), _element(element), _operation(operation), _extraData(extraData) { }
+
+    virtual void run() { _tree->recurseElementWithOperation(_element, _operation, _extraData, 1); }
+
+private:
+    Octree* _tree;
+    OctreeElement* _element;
+    RecurseOctreeOperation _operation;
+    void* _extraData;
+};
+
+void Octree::recurseRootChildrenConcurrently(RecurseOctreeOperation operation, void* extraData[NUMBER_OF_CHILDREN],
+                                             QThreadPool* pool) {
+    for (int i = 0; i < NUMBER_OF_CHILDREN; i++) {
+        OctreeElement* child = _rootElement->getChildAtIndex(i);
+        if (child) {
+            pool->start(new OctreeSubtreeRecurser(this, child, operation, extraData[i]));
+        }
+    }
+    pool->waitForDone();
+
+    // the subtrees each noted their changes on the root too, so the last of them to get there might not be the latest
+    for (int i = 0; i < NUMBER_OF_CHILDREN; i++) {
+        OctreeElement* child = _rootElement->getChildAtIndex(i);
+        if (child) {
+            _rootElement->noteSubtreeChanged(child->getLastChangedInSubtree());
+        }
+    }
+}
+
 // Recurses voxel element with an operation function
 void Octree::recurseElementWithOperation(OctreeElement* element, RecurseOctreeOperation operation, void* extraData,
                         int recursionCount) {
@@ -313,6 +448,7 @@ int Octree::readElementData(OctreeElement* destinationElement, const unsigned ch
 
 void Octree::readBitstreamToTree(const unsigned char * bitstream, unsigned long int bufferSizeBytes,
                                     ReadBitstreamToTreeParams& args) {
+    structureMayHaveChanged();
     int bytesRead = 0;
     const unsigned char* bitstreamAt = bitstream;
 
@@ -374,6 +510,7 @@ public:
 // Note: uses the codeColorBuffer format, but the color's are ignored, because
 // this only finds and deletes the element from the tree.
 void Octree::deleteOctalCodeFromTree(const unsigned char* codeBuffer, bool collapseEmptyTrees) {
+    structureMayHaveChanged();
     // recurse the tree while decoding the codeBuffer, once you find the element in question, recurse
     // back and implement color reaveraging, and marking of lastChanged
     DeleteOctalCodeFromTreeArgs args;
@@ -476,12 +613,18 @@ void Octree::deleteOctalCodeFromTreeRecursion(OctreeElement* element, void* extr
 }
 
 void Octree::eraseAllOctreeElements() {
+    structureMayHaveChanged();
     delete _rootElement; // this will recurse and delete all children
+    
+    // the slabs the elements came from that are now empty go back to the heap in one go
+    SlabAllocator::releaseAllUnusedSlabs();
+    
     _rootElement = createNewElement();
     _isDirty = true;
 }
 
 void Octree::processRemoveOctreeElementsBitstream(const unsigned char* bitstream, int bufferSizeBytes) {
+    structureMayHaveChanged();
     //unsigned short int itemNumber = (*((unsigned short int*)&bitstream[sizeof(PACKET_HEADER)]));
 
     int numBytesPacketHeader = numBytesForPacketHeader(reinterpret_cast<const char*>(bitstream));
@@ -515,6 +658,7 @@ void Octree::processRemoveOctreeElementsBitstream(const unsigned char* bitstream
 
 // Note: this is an expensive call. Don't call it unless you really need to reaverage the entire tree (from startElement)
 void Octree::reaverageOctreeElements(OctreeElement* startElement) {
+    structureMayHaveChanged();
     if (!startElement) {
         startElement = getRoot();
     }
@@ -580,10 +724,12 @@ OctreeElement* Octree::getOctreeEnclosingElementAt(float x, float y, float z, fl
 
 
 OctreeElement* Octree::getOrCreateChildElementAt(float x, float y, float z, float s) {
+    structureMayHaveChanged();
     return getRoot()->getOrCreateChildElementAt(x, y, z, s);
 }
 
 OctreeElement* Octree::getOrCreateChildElementContaining(const AACube& box) {
+    structureMayHaveChanged();
     return getRoot()->getOrCreateChildElementContaining(box);
 }
 
@@ -610,10 +756,87 @@ bool findRayIntersectionOp(OctreeElement* element, void* extraData) {
     return keepSearching;
 }
 
+// allows for the difference between the child entries worked out here and the element's own cube tests
+const float RAY_ENTRY_EPSILON = 0.000001f;
+
+// Finds the distance along the ray, in tree units, at which it enters each child of the cube, or FLT_MAX for the
+// children it misses. The ray crosses each of the three planes that split the cube once, so the slabs of all eight
+// children come from nine plane crossings rather than eight cube tests.
+static void findChildRayEntries(const AACube& cube, const glm::vec3& origin, const glm::vec3& direction,
+                                float entries[NUMBER_OF_CHILDREN]) {
+    float halfScale = cube.getScale() * 0.5f;
+    float slabNear[3][2];
+    float slabFar[3][2];
+    for (int axis = 0; axis < 3; axis++) {
+        float planes[3] = { cube.getCorner()[axis], cube.getCorner()[axis] + halfScale,
+                            cube.getCorner()[axis] + cube.getScale() };
+        for (int half = 0; half < 2; half++) {
+            if (direction[axis] == 0.0f) {
+                // parallel to the slab, the ray is either always in it or never
+                bool inSlab = origin[axis] >= planes[half] && origin[axis] <= planes[half + 1];
+                slabNear[axis][half] = inSlab ? -FLT_MAX : FLT_MAX;
+                slabFar[axis][half] = inSlab ? FLT_MAX : -FLT_MAX;
+            } else {
+                float low = (planes[half] - origin[axis]) / direction[axis];
+                float high = (planes[half + 1] - origin[axis]) / direction[axis];
+                slabNear[axis][half] = glm::min(low, high);
+                slabFar[axis][half] = glm::max(low, high);
+            }
+        }
+    }
+    for (int i = 0; i < NUMBER_OF_CHILDREN; i++) {
+        // the child index has the x half in its high bit and the z half in its low bit, as in copyFirstVertexForCode
+        int x = (i >> 2) & 1;
+        int y = (i >> 1) & 1;
+        int z = i & 1;
+        float entry = glm::max(glm::max(slabNear[0][x], slabNear[1][y]), glm::max(slabNear[2][z], 0.0f));
+        float exit = glm::min(glm::min(slabFar[0][x], slabFar[1][y]), slabFar[2][z]);
+        entries[i] = (entry <= exit + RAY_ENTRY_EPSILON) ? entry : FLT_MAX;
+    }
+}
+
+// Visits the elements the ray passes through front to back, so that once something is hit the children the ray enters
+// beyond it are skipped: an element can only report a hit at or beyond where the ray enters its cube. Walks the
+// linearized copy of the tree, if there's one, in which case nodeIndex is the element's node.
+static void findRayIntersectionFrontToBack(OctreeElement* element, const LinearizedOctree* linearized, int nodeIndex,
+                                           RayArgs& args) {
+    if (!findRayIntersectionOp(element, &args) || element->isLeaf()) {
+        return;
+    }
+    float entries[NUMBER_OF_CHILDREN];
+    findChildRayEntries(element->getAACube(), args.origin, args.direction, entries);
+
+    // the children the ray enters, nearest first
+    int children[NUMBER_OF_CHILDREN];
+    int childCount = 0;
+    for (int i = 0; i < NUMBER_OF_CHILDREN; i++) {
+        if (entries[i] == FLT_MAX || !(linearized ? linearized->getChildNodeIndex(nodeIndex, i) >= 0 :
+                element->getChildAtIndex(i) != NULL)) {
+            continue;
+        }
+        int j = childCount++;
+        for (; j > 0 && entries[children[j - 1]] > entries[i]; j--) {
+            children[j] = children[j - 1];
+        }
+        children[j] = i;
+    }
+    for (int i = 0; i < childCount; i++) {
+        int childIndex = children[i];
+        if ((entries[childIndex] - RAY_ENTRY_EPSILON) * (float)TREE_SCALE >= args.distance) {
+            return; // the rest are entered beyond what's been hit
+        }
+        if (linearized) {
+            int childNodeIndex = linearized->getChildNodeIndex(nodeIndex, childIndex);
+            findRayIntersectionFrontToBack(linearized->getElement(childNodeIndex), linearized, childNodeIndex, args);
+        } else {
+            findRayIntersectionFrontToBack(element->getChildAtIndex(childIndex), NULL, -1, args);
+        }
+    }
+}
+
 bool Octree::findRayIntersection(const glm::vec3& origin, const glm::vec3& direction,
                                     OctreeElement*& element, float& distance, BoxFace& face, void** intersectedObject,
                                     Octree::lockType lockType, bool* accurateResult) {
-    RayArgs args = { origin / (float)(TREE_SCALE), direction, element, distance, face, intersectedObject, false};
     distance = FLT_MAX;
 
     bool gotLock = false;
@@ -626,11 +849,14 @@ bool Octree::findRayIntersection(const glm::vec3& origin, const glm::vec3& direc
             if (accurateResult) {
                 *accurateResult = false; // if user asked to accuracy or result, let them know this is inaccurate
             }
-            return args.found; // if we wanted to tryLock, and we couldn't then just bail...
+            return false; // if we wanted to tryLock, and we couldn't then just bail...
         }
     }
 
-    recurseTreeWithOperation(findRayIntersectionOp, &args);
+    // some elements hand back the object they hit whether or not it was asked for
+    void* localIntersectedObject = NULL;
+    bool found = findRayIntersectionUnlocked(origin, direction, element, distance, face,
+        intersectedObject ? intersectedObject : &localIntersectedObject);
 
     if (gotLock) {
         unlock();
@@ -639,6 +865,58 @@ bool Octree::findRayIntersection(const glm::vec3& origin, const glm::vec3& direc
     if (accurateResult) {
         *accurateResult = true; // if user asked to accuracy or result, let them know this is accurate
     }
+    return found;
+}
+
+int Octree::findRayIntersections(QVector<OctreeRayPick>& picks, Octree::lockType lockType, bool* accurateResult) {
+    for (int i = 0; i < picks.size(); i++) {
+        picks[i].intersects = false;
+        picks[i].distance = FLT_MAX;
+    }
+
+    bool gotLock = false;
+    if (lockType == Octree::Lock) {
+        lockForRead();
+        gotLock = true;
+    } else if (lockType == Octree::TryLock) {
+        gotLock = tryLockForRead();
+        if (!gotLock) {
+            if (accurateResult) {
+                *accurateResult = false; // if user asked to accuracy or result, let them know this is inaccurate
+            }
+            return 0; // if we wanted to tryLock, and we couldn't then just bail...
+        }
+    }
+
+    int intersections = 0;
+    for (int i = 0; i < picks.size(); i++) {
+        OctreeRayPick& pick = picks[i];
+        pick.intersects = findRayIntersectionUnlocked(pick.origin, pick.direction, pick.element, pick.distance,
+                                                      pick.face, &pick.intersectedObject);
+        if (pick.intersects) {
+            intersections++;
+        }
+    }
+
+    if (gotLock) {
+        unlock();
+    }
+
+    if (accurateResult) {
+        *accurateResult = true; // if user asked to accuracy or result, let them know this is accurate
+    }
+    return intersections;
+}
+
+bool Octree::findRayIntersectionUnlocked(const glm::vec3& origin, const glm::vec3& direction,
+                                         OctreeElement*& element, float& distance, BoxFace& face,
+                                         void** intersectedObject) {
+    RayArgs args = { origin / (float)(TREE_SCALE), direction, element, distance, face, intersectedObject, false };
+    distance = FLT_MAX;
+    if (_rootElement) {
+        const LinearizedOctree* linearized = getLinearizedForRead();
+        findRayIntersectionFrontToBack(_rootElement, linearized, 0, args);
+    }
     return args.found;
 }
 
@@ -699,7 +977,8 @@ bool Octree::findSpherePenetration(const glm::vec3& center, float radius, glm::v
         }
     }
 
-    recurseTreeWithOperation(findSpherePenetrationOp, &args);
+    OctreeOperationVisitor<findSpherePenetrationOp> visitor(&args);
+    visitTreeForRead<OctreeElement>(visitor);
     if (penetratedObject) {
         *penetratedObject = args.penetratedObject;
     }
@@ -797,7 +1076,8 @@ bool Octree::findCapsulePenetration(const glm::vec3& start, const glm::vec3& end
         }
     }
 
-    recurseTreeWithOperation(findCapsulePenetrationOp, &args);
+    OctreeOperationVisitor<findCapsulePenetrationOp> visitor(&args);
+    visitTreeForRead<OctreeElement>(visitor);
     
     if (gotLock) {
         unlock();
@@ -828,7 +1108,8 @@ bool Octree::findShapeCollisions(const Shape* shape, CollisionList& collisions,
         }
     }
 
-    recurseTreeWithOperation(findShapeCollisionsOp, &args);
+    OctreeOperationVisitor<findShapeCollisionsOp> visitor(&args);
+    visitTreeForRead<OctreeElement>(visitor);
     
     if (gotLock) {
         unlock();
@@ -882,7 +1163,8 @@ OctreeElement* Octree::getElementEnclosingPoint(const glm::vec3& point, Octree::
         }
     }
 
-    recurseTreeWithOperation(getElementEnclosingOperation, (void*)&args);
+    OctreeOperationVisitor<getElementEnclosingOperation> visitor(&args);
+    visitTreeForRead<OctreeElement>(visitor);
     
     if (gotLock) {
         unlock();
@@ -911,7 +1193,8 @@ int Octree::encodeTreeBitstream(OctreeElement* element,
     }
 
     // If we're at a element that is out of view, then we can return, because no nodes below us will be in view!
-    if (params.viewFrustum && !element->isInView(*params.viewFrustum)) {
+    if (params.viewFrustum ? !element->isInView(*params.viewFrustum)
+            : (params.bounds && !element->getAACube().touches(*params.bounds))) {
         params.stopReason = EncodeBitstreamParams::OUT_OF_VIEW;
         return bytesWritten;
     }
@@ -1084,9 +1367,10 @@ int Octree::encodeTreeBitstreamRecursion(OctreeElement* element,
         }
 
         // If we were previously in the view, then we normally will return out of here and stop recursing. But
-        // if we're in deltaViewFrustum mode, and this element has changed since it was last sent, then we do
-        // need to send it.
-        if (wasInView && !(params.deltaViewFrustum && element->hasChangedSince(params.lastViewFrustumSent - CHANGE_FUDGE))) {
+        // if we're in deltaViewFrustum mode, and this element or anything below it has changed since it was last sent,
+        // then we do need to send it. Otherwise the whole subtree is skipped without visiting it.
+        if (wasInView && !(params.deltaViewFrustum &&
+                           element->hasChangedInSubtreeSince(params.lastViewFrustumSent - CHANGE_FUDGE))) {
             if (params.stats) {
                 params.stats->skippedWasInView(element);
             }
@@ -1094,10 +1378,10 @@ int Octree::encodeTreeBitstreamRecursion(OctreeElement* element,
             return bytesAtThisLevel;
         }
 
-        // If we're not in delta sending mode, and we weren't asked to do a force send, and the voxel hasn't changed,
-        // then we can also bail early and save bits
+        // If we're not in delta sending mode, and we weren't asked to do a force send, and neither the voxel nor
+        // anything below it has changed, then we can also bail early and save bits
         if (!params.forceSendScene && !params.deltaViewFrustum &&
-            !element->hasChangedSince(params.lastViewFrustumSent - CHANGE_FUDGE)) {
+            !element->hasChangedInSubtreeSince(params.lastViewFrustumSent - CHANGE_FUDGE)) {
             if (params.stats) {
                 params.stats->skippedNoChange(element);
             }
@@ -1107,7 +1391,17 @@ int Octree::encodeTreeBitstreamRecursion(OctreeElement* element,
 
         // If the user also asked for occlusion culling, check if this element is occluded, but only if it's not a leaf.
         // leaf occlusion is handled down below when we check child nodes
-        if (params.wantOcclusionCulling && !element->isLeaf()) {
+        if (params.wantOcclusionCulling && params.occlusionBuffer && !element->isLeaf()) {
+            AACube voxelBox = element->getAACube();
+            voxelBox.scale(TREE_SCALE);
+            if (params.occlusionBuffer->isOccluded(*params.viewFrustum, voxelBox)) {
+                if (params.stats) {
+                    params.stats->skippedOccluded(element);
+                }
+                params.stopReason = EncodeBitstreamParams::OCCLUDED;
+                return bytesAtThisLevel;
+            }
+        } else if (params.wantOcclusionCulling && !element->isLeaf()) {
             AACube voxelBox = element->getAACube();
             voxelBox.scale(TREE_SCALE);
             OctreeProjectedPolygon* voxelPolygon = new OctreeProjectedPolygon(params.viewFrustum->getProjectedPolygon(voxelBox));
@@ -1130,6 +1424,39 @@ int Octree::encodeTreeBitstreamRecursion(OctreeElement* element,
                 delete voxelPolygon;
             }
         }
+    } else if (!params.forceSendScene && !element->hasChangedInSubtreeSince(params.lastViewFrustumSent - CHANGE_FUDGE)) {
+        // without a view, a scene that isn't forced only sends what's changed since the last one
+        if (params.stats) {
+            params.stats->skippedNoChange(element);
+        }
+        params.stopReason = EncodeBitstreamParams::NO_CHANGE;
+        return bytesAtThisLevel;
+    }
+
+    // A subtree that's entirely in view, at the same level of detail all over, encodes the same for any view that sees it
+    // so. If another encode has kept it, it's copied from there, otherwise it's kept once it's encoded in full.
+    int cacheDepth = -1;
+    unsigned char cacheFlags = (params.includeColor ? 1 : 0) | (params.includeExistsBits ? 2 : 0);
+    int didntFitBefore = params.didntFitCount;
+    if (params.encodeCache && params.viewFrustum && nodeLocationThisView == ViewFrustum::INSIDE &&
+            canCacheEncodedSubtrees() && params.forceSendScene && !params.deltaViewFrustum &&
+            !params.wantOcclusionCulling && params.maxEncodeLevel == INT_MAX) {
+        cacheDepth = lodDepthInView(element, params);
+    }
+    if (cacheDepth >= MIN_CACHED_LOD_DEPTH) {
+        QByteArray encoded;
+        if (params.encodeCache->find(element, cacheDepth, cacheFlags, encoded)) {
+            if (packetData->appendRawData(reinterpret_cast<const unsigned char*>(encoded.constData()), encoded.size())) {
+                return encoded.size();
+            }
+            bag.insert(element);
+            if (params.stats) {
+                params.stats->didntFit(element);
+            }
+            params.stopReason = EncodeBitstreamParams::DIDNT_FIT;
+            params.didntFitCount++;
+            return 0;
+        }
     }
 
     bool keepDiggingDeeper = true; // Assuming we're in view we have a great work ethic, we're always ready for more!
@@ -1142,14 +1469,27 @@ int Octree::encodeTreeBitstreamRecursion(OctreeElement* element,
     unsigned char childrenExistInTreeBits = 0;
     unsigned char childrenExistInPacketBits = 0;
     unsigned char childrenColoredBits = 0;
+    unsigned char childrenWereInViewBits = 0;
 
     // Make our local buffer large enough to handle writing at this level in case we need to.
     LevelDetails thisLevelKey = packetData->startLevel();
+    int thisLevelStart = packetData->getUncompressedSize();
 
     int inViewCount = 0;
     int inViewNotLeafCount = 0;
     int inViewWithColorCount = 0;
 
+    // the children of an element that straddles the frustum are all tested against it at once
+    unsigned char childrenInViewBits = 0;
+    if (params.viewFrustum && nodeLocationThisView == ViewFrustum::INTERSECT) {
+        AACube cube = element->getAACube();
+        cube.scale(TREE_SCALE);
+        unsigned char childrenInsideViewBits;
+        unsigned char childrenIntersectingViewBits;
+        params.viewFrustum->childCubesInFrustum(cube, childrenInsideViewBits, childrenIntersectingViewBits);
+        childrenInViewBits = childrenInsideViewBits | childrenIntersectingViewBits;
+    }
+
     OctreeElement* sortedChildren[NUMBER_OF_CHILDREN] = { NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL };
     float distancesToChildren[NUMBER_OF_CHILDREN] = { 0, 0, 0, 0, 0, 0, 0, 0 };
     int indexOfChildren[NUMBER_OF_CHILDREN] = { 0, 0, 0, 0, 0, 0, 0, 0 };
@@ -1201,10 +1541,11 @@ int Octree::encodeTreeBitstreamRecursion(OctreeElement* element,
         int originalIndex = indexOfChildren[i];
 
         bool childIsInView  = (childElement && 
-                ( !params.viewFrustum || // no view frustum was given, everything is assumed in view
+                ( (!params.viewFrustum && // no view frustum was given, everything in the bounds is assumed in view
+                        (!params.bounds || childElement->getAACube().touches(*params.bounds))) ||
                   (nodeLocationThisView == ViewFrustum::INSIDE) || // parent was fully in view, we can assume ALL children are
                   (nodeLocationThisView == ViewFrustum::INTERSECT && 
-                        childElement->isInView(*params.viewFrustum)) // the parent intersects and the child is in view
+                        oneAtBit(childrenInViewBits, originalIndex)) // the parent intersects and the child is in view
                 ));
 
         if (!childIsInView) {
@@ -1238,7 +1579,15 @@ int Octree::encodeTreeBitstreamRecursion(OctreeElement* element,
                 bool childIsOccluded = false; // assume it's not occluded
 
                 // If the user also asked for occlusion culling, check if this element is occluded
-                if (params.wantOcclusionCulling && childElement->isLeaf()) {
+                if (params.wantOcclusionCulling && params.occlusionBuffer && childElement->isLeaf()) {
+                    // the children are visited nearest first, so a leaf that isn't hidden hides what's behind it
+                    AACube voxelBox = childElement->getAACube();
+                    voxelBox.scale(TREE_SCALE);
+                    childIsOccluded = params.occlusionBuffer->isOccluded(*params.viewFrustum, voxelBox);
+                    if (!childIsOccluded) {
+                        params.occlusionBuffer->addOccluder(*params.viewFrustum, voxelBox);
+                    }
+                } else if (params.wantOcclusionCulling && childElement->isLeaf()) {
                     // Don't check occlusion here, just add them to our distance ordered array...
 
                     AACube voxelBox = childElement->getAACube();
@@ -1308,6 +1657,9 @@ int Octree::encodeTreeBitstreamRecursion(OctreeElement* element,
                          childElement->hasChangedSince(params.lastViewFrustumSent - CHANGE_FUDGE))){
 
                         childrenColoredBits += (1 << (7 - originalIndex));
+                        if (childWasInView) {
+                            childrenWereInViewBits += (1 << (7 - originalIndex));
+                        }
                         inViewWithColorCount++;
                     } else {
                         // otherwise just track stats of the items we discarded
@@ -1350,7 +1702,9 @@ int Octree::encodeTreeBitstreamRecursion(OctreeElement* element,
                     //       to allow the appendElementData() to respond that it produced partial data, which should be
                     //       written, but that the childElement needs to be reprocessed in an additional pass or passes
                     //       to be completed. In the case that an element was partially written, we need to 
+                    params.elementWasInView = oneAtBit(childrenWereInViewBits, i);
                     continueThisLevel = childElement->appendElementData(packetData, params);
+                    params.elementWasInView = false;
                     
                     int bytesAfterChild = packetData->getUncompressedSize();
 
@@ -1564,78 +1918,45 @@ int Octree::encodeTreeBitstreamRecursion(OctreeElement* element,
         }
 
         params.stopReason = EncodeBitstreamParams::DIDNT_FIT;
+        params.didntFitCount++;
         bytesAtThisLevel = 0; // didn't fit
+
+    } else if (cacheDepth >= MIN_CACHED_LOD_DEPTH && params.didntFitCount == didntFitBefore &&
+            packetData->getUncompressedSize() - thisLevelStart == bytesAtThisLevel) {
+        // nothing below was left out for want of room, so this is the whole of the subtree
+        params.encodeCache->insert(element, cacheDepth, cacheFlags,
+                                   packetData->getUncompressedData() + thisLevelStart, bytesAtThisLevel);
     }
 
     return bytesAtThisLevel;
 }
 
 bool Octree::readFromSVOFile(const char* fileName) {
-    bool fileOk = false;
-    PacketVersion gotVersion = 0;
-    std::ifstream file(fileName, std::ios::in|std::ios::binary|std::ios::ate);
-    if(file.is_open()) {
-        emit importSize(1.0f, 1.0f, 1.0f);
-        emit importProgress(0);
-
-        qDebug("Loading file %s...", fileName);
-
-        // get file length....
-        unsigned long fileLength = file.tellg();
-        file.seekg( 0, std::ios::beg );
-
-        // read the entire file into a buffer, WHAT!? Why not.
-        unsigned char* entireFile = new unsigned char[fileLength];
-        file.read((char*)entireFile, fileLength);
-        bool wantImportProgress = true;
-
-        unsigned char* dataAt = entireFile;
-        unsigned long  dataLength = fileLength;
+    SVOFileReader reader(this);
+    if (!reader.open(fileName)) {
+        return false;
+    }
+    emit importSize(1.0f, 1.0f, 1.0f);
+    emit importProgress(0);
 
-        // before reading the file, check to see if this version of the Octree supports file versions
-        if (getWantSVOfileVersions()) {
-            // if so, read the first byte of the file and see if it matches the expected version code
-            PacketType expectedType = expectedDataPacketType();
-            
-            PacketType gotType;
-            memcpy(&gotType, dataAt, sizeof(gotType));
-            
-            if (gotType == expectedType) {
-                dataAt += sizeof(expectedType);
-                dataLength -= sizeof(expectedType);
-                gotVersion = *dataAt;
-                if (canProcessVersion(gotVersion)) {
-                    dataAt += sizeof(gotVersion);
-                    dataLength -= sizeof(gotVersion);
-                    fileOk = true;
-                    qDebug("SVO file version match. Expected: %d Got: %d", 
-                                versionForPacketType(expectedDataPacketType()), gotVersion);
-                } else {
-                    qDebug("SVO file version mismatch. Expected: %d Got: %d", 
-                                versionForPacketType(expectedDataPacketType()), gotVersion);
-                }
-            } else {
-                qDebug("SVO file type mismatch. Expected: %c Got: %c", expectedType, gotType);
-            }
-        } else {
-            fileOk = true; // assume the file is ok
-        }
-        if (fileOk) {
-            ReadBitstreamToTreeParams args(WANT_COLOR, NO_EXISTS_BITS, NULL, 0, 
-                                                SharedNodePointer(), wantImportProgress, gotVersion);
-            readBitstreamToTree(dataAt, dataLength, args);
+    while (!reader.atEnd()) {
+        reader.readNextSlice();
+        if (reader.hasIndex()) {
+            emit importProgress(reader.getProgress());
         }
-        delete[] entireFile;
-
-        emit importProgress(100);
-
-        file.close();
     }
-    return fileOk;
+    emit importProgress(100);
+    return true;
 }
 
-void Octree::writeToSVOFile(const char* fileName, OctreeElement* element) {
+bool Octree::writeToSVOFile(const char* fileName, OctreeElement* element) {
+    // an index left from the last save would no longer match the file
+    QFile::remove(SVOFileReader::getIndexFileName(fileName));
+
     std::ofstream file(fileName, std::ios::out|std::ios::binary);
+    QVector<qint64> sliceStarts;
+    qint64 fileSize = 0;
+    bool canceled = false;
 
     if(file.is_open()) {
         qDebug("Saving to file %s...", fileName);
@@ -1647,31 +1968,66 @@ void Octree::writeToSVOFile(const char* fileName, OctreeElement* element) {
             PacketVersion expectedVersion = versionForPacketType(expectedType);
             file.write(reinterpret_cast<char*>(&expectedType), sizeof(expectedType));
             file.write(&expectedVersion, sizeof(expectedVersion));
+            fileSize += sizeof(expectedType) + sizeof(expectedVersion);
         }
 
+        // with a palette, the slices are encoded in memory first, since the palette ahead of them isn't known until
+        // they've all been encoded
+        OctreeColorPalette palette;
+        std::ostringstream paletteSlices(std::ios::out|std::ios::binary);
+        std::ostream& slices = _wantColorPalette ? static_cast<std::ostream&>(paletteSlices) : file;
+
         OctreeElementBag nodeBag;
         // If we were given a specific element, start from there, otherwise start from root
-        if (element) {
-            nodeBag.insert(element);
-        } else {
-            nodeBag.insert(_rootElement);
+        OctreeElement* startElement = element ? element : _rootElement;
+        nodeBag.insert(startElement);
+
+        // progress is the share of the elements traversed so far, which is only counted if someone's listening for it
+        unsigned long elementCount = 0;
+        if (receivers(SIGNAL(exportProgress(int))) > 0) {
+            lockForRead();
+            recurseElementWithOperation(startElement, countOctreeElementsOperation, &elementCount);
+            unlock();
+            emit exportProgress(0);
         }
+        OctreeSceneStats stats;
+        int lastProgress = 0;
 
         OctreePacketData packetData;
         int bytesWritten = 0;
         bool lastPacketWritten = false;
 
         while (!nodeBag.isEmpty()) {
+            if (_stopExport) {
+                canceled = true;
+                break;
+            }
             OctreeElement* subTree = nodeBag.extract();
             lockForRead(); // do tree locking down here so that we have shorter slices and less thread contention
             EncodeBitstreamParams params(INT_MAX, IGNORE_VIEW_FRUSTUM, WANT_COLOR, NO_EXISTS_BITS);
+            if (_wantColorPalette) {
+                params.colorPalette = &palette;
+            }
+            if (elementCount > 0) {
+                params.stats = &stats;
+            }
             bytesWritten = encodeTreeBitstream(subTree, &packetData, nodeBag, params);
             unlock();
 
+            // elements that didn't fit are traversed again, so the count can run a little ahead of the elements
+            if (elementCount > 0) {
+                int progress = (int)qMin<quint64>(99, (100 * stats.getTraversed()) / elementCount);
+                if (progress != lastProgress) {
+                    emit exportProgress(lastProgress = progress);
+                }
+            }
+
             // if the subTree couldn't fit, and so we should reset the packet and reinsert the element in our bag and try again
             if (bytesWritten == 0 && (params.stopReason == EncodeBitstreamParams::DIDNT_FIT)) {
                 if (packetData.hasContent()) {
-                    file.write((const char*)packetData.getFinalizedData(), packetData.getFinalizedSize());
+                    sliceStarts.append(fileSize);
+                    slices.write((const char*)packetData.getFinalizedData(), packetData.getFinalizedSize());
+                    fileSize += packetData.getFinalizedSize();
                     lastPacketWritten = true;
                 }
                 packetData.reset(); // is there a better way to do this? could we fit more?
@@ -1681,16 +2037,80 @@ void Octree::writeToSVOFile(const char* fileName, OctreeElement* element) {
             }
         }
 
-        if (!lastPacketWritten) {
-            file.write((const char*)packetData.getFinalizedData(), packetData.getFinalizedSize());
+        if (!canceled && !lastPacketWritten && packetData.getFinalizedSize() > 0) {
+            sliceStarts.append(fileSize);
+            slices.write((const char*)packetData.getFinalizedData(), packetData.getFinalizedSize());
+            fileSize += packetData.getFinalizedSize();
+        }
+
+        if (!canceled && _wantColorPalette) {
+            QByteArray paletteData = palette.toByteArray();
+            file.write(SVO_COLOR_PALETTE_MAGIC, SVO_COLOR_PALETTE_MAGIC_SIZE);
+            file.write(paletteData.constData(), paletteData.size());
+
+            std::string sliceData = paletteSlices.str();
+            file.write(sliceData.data(), sliceData.size());
+
+            // the slices start after the palette, rather than where they were encoded
+            qint64 paletteSize = SVO_COLOR_PALETTE_MAGIC_SIZE + paletteData.size();
+            for (int i = 0; i < sliceStarts.size(); i++) {
+                sliceStarts[i] += paletteSize;
+            }
+            fileSize += paletteSize;
+            qDebug("Saved %d colors in the palette.", palette.getCount());
         }
     }
+    bool wasOpen = file.is_open();
     file.close();
+
+    if (canceled) {
+        qDebug("Canceled saving to file %s.", fileName);
+        QFile::remove(fileName);
+        return false;
+    }
+
+    // the index lets the file be read back a packet at a time
+    if (!file.fail() && !sliceStarts.isEmpty()) {
+        SVOFileReader::writeIndex(fileName, fileSize, sliceStarts);
+    }
+    if (wasOpen && !file.fail()) {
+        emit exportProgress(100);
+        return true;
+    }
+    return false;
+}
+
+bool Octree::encodeSubtreeToChunks(OctreeElement* element, int maxChunkSize, QVector<QByteArray>& chunks,
+        int chopLevels) {
+    OctreeElementBag nodeBag;
+    nodeBag.insert(element);
+    OctreePacketData packetData(false, maxChunkSize);
+
+    while (!nodeBag.isEmpty()) {
+        OctreeElement* subTree = nodeBag.extract();
+        EncodeBitstreamParams params(INT_MAX, IGNORE_VIEW_FRUSTUM, WANT_COLOR, NO_EXISTS_BITS, chopLevels);
+        int bytesWritten = encodeTreeBitstream(subTree, &packetData, nodeBag, params);
+
+        // if the subTree couldn't fit, start a new chunk and try it again
+        if (bytesWritten == 0 && (params.stopReason == EncodeBitstreamParams::DIDNT_FIT)) {
+            if (!packetData.hasContent()) {
+                return false;
+            }
+            chunks.append(QByteArray((const char*)packetData.getFinalizedData(), packetData.getFinalizedSize()));
+            packetData.reset();
+            nodeBag.insert(subTree);
+        }
+    }
+    if (packetData.hasContent()) {
+        chunks.append(QByteArray((const char*)packetData.getFinalizedData(), packetData.getFinalizedSize()));
+    }
+    return true;
 }
 
 unsigned long Octree::getOctreeElementsCount() {
     unsigned long nodeCount = 0;
-    recurseTreeWithOperation(countOctreeElementsOperation, &nodeCount);
+    OctreeOperationVisitor<countOctreeElementsOperation> visitor(&nodeCount);
+    visitTreeForRead<OctreeElement>(visitor);
     return nodeCount;
 }
 
@@ -1715,13 +2135,14 @@ void Octree::copySubTreeIntoNewTree(OctreeElement* startElement, Octree* destina
         // ask our tree to write a bitsteam
         EncodeBitstreamParams params(INT_MAX, IGNORE_VIEW_FRUSTUM, WANT_COLOR, NO_EXISTS_BITS, chopLevels);
         encodeTreeBitstream(subTree, &packetData, nodeBag, params);
-        // ask destination tree to read the bitstream
-        ReadBitstreamToTreeParams args(WANT_COLOR, NO_EXISTS_BITS);
+        // ask destination tree to read the bitstream, which is in our version
+        ReadBitstreamToTreeParams args(WANT_COLOR, NO_EXISTS_BITS, NULL, 0, SharedNodePointer(), false, expectedVersion());
         destinationTree->readBitstreamToTree(packetData.getUncompressedData(), packetData.getUncompressedSize(), args);
     }
 }
 
 void Octree::copyFromTreeIntoSubTree(Octree* sourceTree, OctreeElement* destinationElement) {
+    structureMayHaveChanged();
     OctreeElementBag nodeBag;
     // If we were given a specific element, start from there, otherwise start from root
     nodeBag.insert(sourceTree->_rootElement);
@@ -1740,7 +2161,7 @@ void Octree::copyFromTreeIntoSubTree(Octree* sourceTree, OctreeElement* destinat
         // ask destination tree to read the bitstream
         bool wantImportProgress = true;
         ReadBitstreamToTreeParams args(WANT_COLOR, NO_EXISTS_BITS, destinationElement, 
-                                            0, SharedNodePointer(), wantImportProgress);
+                                            0, SharedNodePointer(), wantImportProgress, sourceTree->expectedVersion());
         readBitstreamToTree(packetData.getUncompressedData(), packetData.getUncompressedSize(), args);
     }
 }
@@ -1749,3 +2170,7 @@ void Octree::cancelImport() {
     _stopImport = true;
 }
 
+void Octree::cancelExport() {
+    _stopExport = true;
+}
+
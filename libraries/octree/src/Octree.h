@@ -12,10 +12,15 @@
 #ifndef hifi_Octree_h
 #define hifi_Octree_h
 
+#include <cfloat>
 #include <set>
 #include <SimpleMovingAverage.h>
 
 class CoverageMap;
+class OcclusionBuffer;
+class OctreeColorPalette;
+class OctreeEncodeCache;
+class LinearizedOctree;
 class ReadBitstreamToTreeParams;
 class Octree;
 class OctreeElement;
@@ -23,6 +28,8 @@ class OctreeElementBag;
 class OctreePacketData;
 class Shape;
 
+class QThreadPool;
+
 
 #include "JurisdictionMap.h"
 #include "ViewFrustum.h"
@@ -33,8 +40,11 @@ class Shape;
 
 #include <CollisionInfo.h>
 
+#include <QAtomicInt>
+#include <QMutex>
 #include <QObject>
 #include <QReadWriteLock>
+#include <QVector>
 
 /// derive from this class to use the Octree::recurseTreeWithOperator() method
 class RecurseOctreeOperator {
@@ -45,6 +55,19 @@ public:
 
 // Callback function, for recuseTreeWithOperation
 typedef bool (*RecurseOctreeOperation)(OctreeElement* element, void* extraData);
+
+/// Adapts a recursion operation known at compile time to a visitor for Octree::visitTree(), so that the operation is
+/// called directly (and can be inlined) rather than through a pointer.
+template<RecurseOctreeOperation Operation>
+class OctreeOperationVisitor {
+public:
+    OctreeOperationVisitor(void* extraData = NULL) : _extraData(extraData) { }
+
+    bool operator()(OctreeElement* element) { return Operation(element, _extraData); }
+
+private:
+    void* _extraData;
+};
 typedef enum {GRADIENT, RANDOM, NATURAL} creationMode;
 
 const bool NO_EXISTS_BITS         = false;
@@ -83,7 +106,15 @@ public:
     bool forceSendScene;
     OctreeSceneStats* stats;
     CoverageMap* map;
+    OcclusionBuffer* occlusionBuffer; /// used for occlusion culling in place of the map, if set
+    OctreeEncodeCache* encodeCache; /// shares the encodings of subtrees seen whole with other encodes, if set
+    OctreeColorPalette* colorPalette; /// colors are written as their indices in the palette, if set
     JurisdictionMap* jurisdictionMap;
+    const AACube* bounds; /// with no view frustum, only what touches these bounds is sent, in tree units, if set
+
+    /// set while an element appends its data if it was in the view it was last sent for, in which case its items need
+    /// only send what's changed since lastViewFrustumSent
+    bool elementWasInView;
 
     // output hints from the encode process
     typedef enum {
@@ -99,6 +130,7 @@ public:
         OCCLUDED
     } reason;
     reason stopReason;
+    int didntFitCount; /// how many elements were put back in the bag because they didn't fit
 
     EncodeBitstreamParams(
         int maxEncodeLevel = INT_MAX,
@@ -131,8 +163,14 @@ public:
             forceSendScene(forceSendScene),
             stats(stats),
             map(map),
+            occlusionBuffer(NULL),
+            encodeCache(NULL),
+            colorPalette(NULL),
             jurisdictionMap(jurisdictionMap),
-            stopReason(UNKNOWN)
+            bounds(NULL),
+            elementWasInView(false),
+            stopReason(UNKNOWN),
+            didntFitCount(0)
     {}
 
     void displayStopReason() {
@@ -171,6 +209,7 @@ public:
     SharedNodePointer sourceNode;
     bool wantImportProgress;
     PacketVersion bitstreamVersion;
+    const OctreeColorPalette* colorPalette; /// colors are read as indices in the palette, if set
 
     ReadBitstreamToTreeParams(
         bool includeColor = WANT_COLOR,
@@ -186,7 +225,31 @@ public:
             sourceUUID(sourceUUID),
             sourceNode(sourceNode),
             wantImportProgress(wantImportProgress),
-            bitstreamVersion(bitstreamVersion)
+            bitstreamVersion(bitstreamVersion),
+            colorPalette(NULL)
+    {}
+};
+
+/// A ray to be picked against a tree along with others, and what it hit.
+class OctreeRayPick {
+public:
+    glm::vec3 origin;
+    glm::vec3 direction;
+
+    bool intersects;
+    OctreeElement* element;
+    float distance;
+    BoxFace face;
+    void* intersectedObject; /// the type is defined by the type of Octree, the caller is assumed to know the type
+
+    OctreeRayPick(const glm::vec3& origin = glm::vec3(), const glm::vec3& direction = glm::vec3()) :
+        origin(origin),
+        direction(direction),
+        intersects(false),
+        element(NULL),
+        distance(FLT_MAX),
+        face(UNKNOWN_FACE),
+        intersectedObject(NULL)
     {}
 };
 
@@ -209,10 +272,21 @@ public:
     virtual bool handlesEditPacketType(PacketType packetType) const { return false; }
     virtual int processEditPacketData(PacketType packetType, const unsigned char* packetData, int packetLength,
                     const unsigned char* editData, int maxLength, const SharedNodePointer& sourceNode) { return 0; }
+
+    /// the edits processed between these two calls are made under one hold of the write lock, so a tree may hold them
+    /// back and make them all at once in endEditBatch(), as long as the result is the same as making them in order
+    virtual void beginEditBatch() { }
+    virtual void endEditBatch() { }
                     
     virtual bool recurseChildrenWithData() const { return true; }
     virtual bool rootElementHasData() const { return false; }
 
+    /// can bitstreams under different children of the root be read into the tree on different threads at once
+    virtual bool canReadBitstreamsConcurrently() const { return false; }
+
+    /// does a subtree seen whole encode the same for every view, so that its encoding can be shared
+    virtual bool canCacheEncodedSubtrees() const { return false; }
+
 
     virtual void update() { }; // nothing to do by default
 
@@ -246,6 +320,25 @@ public:
 
     void recurseTreeWithOperator(RecurseOctreeOperator* operatorObject);
 
+    /// Recurses the tree in the same order as recurseTreeWithOperation, calling visitor(element) with each element as
+    /// an ElementType* and going into its children only if that returns true. The traversal is instantiated for the
+    /// visitor and element type, so the calls are direct and can be inlined; the callbacks above remain for the walks
+    /// where that doesn't matter.
+    template<typename ElementType, typename Visitor>
+    void visitTree(Visitor& visitor) { visitElement(static_cast<ElementType*>(_rootElement), visitor); }
+
+    /// Recurses the tree as visitTree does, calling the visitor on each element after its children.
+    template<typename ElementType, typename Visitor>
+    void visitTreePostOrder(Visitor& visitor) {
+        visitElementPostOrder(static_cast<ElementType*>(_rootElement), visitor);
+    }
+
+    /// Recurses the subtrees under the children of the root at once on the pool's threads, the operation being given
+    /// the extra data at the index of the child it's under. The root itself isn't visited. The operation mustn't change
+    /// anything outside the subtree it's in, other than the root being noted as changed, which is made right afterward.
+    void recurseRootChildrenConcurrently(RecurseOctreeOperation operation, void* extraData[NUMBER_OF_CHILDREN],
+                                         QThreadPool* pool);
+
     int encodeTreeBitstream(OctreeElement* element, OctreePacketData* packetData, OctreeElementBag& bag,
                             EncodeBitstreamParams& params) ;
 
@@ -256,9 +349,23 @@ public:
     // Octree does not currently handle its own locking, caller must use these to lock/unlock
     void lockForRead() { _lock.lockForRead(); }
     bool tryLockForRead() { return _lock.tryLockForRead(); }
-    void lockForWrite() { _lock.lockForWrite(); }
-    bool tryLockForWrite() { return _lock.tryLockForWrite(); }
+    void lockForWrite() { _lock.lockForWrite(); structureMayHaveChanged(); }
+    bool tryLockForWrite();
     void unlock() { _lock.unlock(); }
+    
+    /// Has the read-only queries (the ray, penetration and collision tests and element counts) walk a linearized
+    /// copy of the tree, made once the tree has gone a while unwritten and made again after it has been written to.
+    void setWantLinearizedReads(bool wantLinearizedReads) { _wantLinearizedReads = wantLinearizedReads; }
+    bool getWantLinearizedReads() const { return _wantLinearizedReads; }
+
+    /// Has writeToSVOFile save the distinct colors once, ahead of the slices, and each element's color as its index
+    /// among them, which files with few colors shrink a good deal by. SVO files are read back either way.
+    void setWantColorPalette(bool wantColorPalette) { _wantColorPalette = wantColorPalette; }
+    bool getWantColorPalette() const { return _wantColorPalette; }
+    
+    /// Lets go of the linearized copy, which the tree's own edit methods and write locks do already. Subclasses that
+    /// add or delete elements some other way must call it.
+    void structureMayHaveChanged();
     // output hints from the encode process
     typedef enum {
         Lock,
@@ -271,6 +378,10 @@ public:
                              void** intersectedObject = NULL,
                              Octree::lockType lockType = Octree::TryLock, bool* accurateResult = NULL);
 
+    /// Picks each of the rays against the tree under a single lock, returns how many of them hit something.
+    int findRayIntersections(QVector<OctreeRayPick>& picks,
+                             Octree::lockType lockType = Octree::TryLock, bool* accurateResult = NULL);
+
     bool findSpherePenetration(const glm::vec3& center, float radius, glm::vec3& penetration, void** penetratedObject = NULL, 
                                     Octree::lockType lockType = Octree::TryLock, bool* accurateResult = NULL);
 
@@ -287,8 +398,15 @@ public:
     void loadOctreeFile(const char* fileName, bool wantColorRandomizer);
 
     // these will read/write files that match the wireformat, excluding the 'V' leading
-    void writeToSVOFile(const char* filename, OctreeElement* element = NULL);
+    /// writeToSVOFile returns false if the file couldn't be written or the export was canceled, which removes the file
+    bool writeToSVOFile(const char* filename, OctreeElement* element = NULL);
     bool readFromSVOFile(const char* filename);
+
+    /// encodes the subtree into chunks of at most maxChunkSize bytes in the wireformat, which readBitstreamToTree can
+    /// each read on their own. The caller should have the tree locked. Returns false if an element didn't fit in a chunk
+    /// by itself. With chopLevels, the subtree is rebased that many levels up, as copySubTreeIntoNewTree does.
+    bool encodeSubtreeToChunks(OctreeElement* element, int maxChunkSize, QVector<QByteArray>& chunks,
+                               int chopLevels = 0);
     
 
     unsigned long getOctreeElementsCount();
@@ -311,21 +429,50 @@ public:
 
     bool recurseElementWithOperator(OctreeElement* element, RecurseOctreeOperator* operatorObject, int recursionCount = 0);
 
+    template<typename ElementType, typename Visitor>
+    static void visitElement(ElementType* element, Visitor& visitor, int recursionCount = 0);
+
+    template<typename ElementType, typename Visitor>
+    static void visitElementPostOrder(ElementType* element, Visitor& visitor, int recursionCount = 0);
+
     bool getIsViewing() const { return _isViewing; }
     void setIsViewing(bool isViewing) { _isViewing = isViewing; }
     
+    /// Set by cancelExport and left set, so that a cancel made before an export gets as far as writeToSVOFile still
+    /// stops it. Whoever starts the export clears it.
+    bool isExportCanceled() const { return _stopExport; }
+    void setExportCanceled(bool exportCanceled) { _stopExport = exportCanceled; }
+
 
 signals:
     void importSize(float x, float y, float z);
     void importProgress(int progress);
+    void exportProgress(int progress);
 
 public slots:
     void cancelImport();
+    void cancelExport();
 
 
 protected:
     void deleteOctalCodeFromTreeRecursion(OctreeElement* element, void* extraData);
 
+    /// walks the linearized copy of the tree if it's wanted and up to date, otherwise the tree itself. The operation
+    /// must not add or delete elements.
+    void recurseTreeWithReadOperation(RecurseOctreeOperation operation, void* extraData);
+
+    /// visits the tree as recurseTreeWithReadOperation does, instantiated for the visitor as visitTree is. Only
+    /// instantiated in Octree.cpp, where the linearized copy is known.
+    template<typename ElementType, typename Visitor>
+    void visitTreeForRead(Visitor& visitor);
+
+    /// the linearized copy of the tree if it's wanted and up to date, which readers holding the read lock may walk
+    const LinearizedOctree* getLinearizedForRead();
+
+    /// picks a ray front to back, with the tree already locked for reading
+    bool findRayIntersectionUnlocked(const glm::vec3& origin, const glm::vec3& direction,
+                                     OctreeElement*& element, float& distance, BoxFace& face, void** intersectedObject);
+
     int encodeTreeBitstreamRecursion(OctreeElement* element,
                                      OctreePacketData* packetData, OctreeElementBag& bag,
                                      EncodeBitstreamParams& params, int& currentEncodeLevel,
@@ -343,13 +490,55 @@ protected:
     bool _isDirty;
     bool _shouldReaverage;
     bool _stopImport;
+    bool _stopExport;
 
     QReadWriteLock _lock;
     
     /// This tree is receiving inbound viewer datagrams.
     bool _isViewing;
+    
+    bool _wantLinearizedReads;
+    bool _wantColorPalette;
+    LinearizedOctree* _linearized;
+    QMutex _linearizedMutex;
+    QAtomicInt _structureVersion;
+    int _linearizedVersion; ///< the structure version the linearized copy was made at
+    quint64 _lastStructureChange;
 };
 
 float boundaryDistanceForRenderLevel(unsigned int renderLevel, float voxelSizeScale);
 
+template<typename ElementType, typename Visitor>
+void Octree::visitElement(ElementType* element, Visitor& visitor, int recursionCount) {
+    if (recursionCount > DANGEROUSLY_DEEP_RECURSION) {
+        qDebug() << "Octree::visitElement() reached DANGEROUSLY_DEEP_RECURSION, bailing!";
+        return;
+    }
+    if (visitor(element) && !element->isLeaf()) {
+        for (int i = 0; i < NUMBER_OF_CHILDREN; i++) {
+            OctreeElement* child = element->OctreeElement::getChildAtIndex(i);
+            if (child) {
+                visitElement(static_cast<ElementType*>(child), visitor, recursionCount + 1);
+            }
+        }
+    }
+}
+
+template<typename ElementType, typename Visitor>
+void Octree::visitElementPostOrder(ElementType* element, Visitor& visitor, int recursionCount) {
+    if (recursionCount > DANGEROUSLY_DEEP_RECURSION) {
+        qDebug() << "Octree::visitElementPostOrder() reached DANGEROUSLY_DEEP_RECURSION, bailing!";
+        return;
+    }
+    if (!element->isLeaf()) {
+        for (int i = 0; i < NUMBER_OF_CHILDREN; i++) {
+            OctreeElement* child = element->OctreeElement::getChildAtIndex(i);
+            if (child) {
+                visitElementPostOrder(static_cast<ElementType*>(child), visitor, recursionCount + 1);
+            }
+        }
+    }
+    visitor(element);
+}
+
 #endif // hifi_Octree_h
@@ -0,0 +1,99 @@
+//
+//  OctreeColorPalette.cpp
+//  libraries/octree/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#include "OctreeColorPalette.h"
+
+const int BYTES_PER_PALETTE_COLOR = 3;
+
+static quint32 packColor(const unsigned char* color) {
+    return (color[RED_INDEX] << 16) | (color[GREEN_INDEX] << 8) | color[BLUE_INDEX];
+}
+
+void OctreeColorPalette::clear() {
+    _colors.clear();
+    _indices.clear();
+}
+
+int OctreeColorPalette::indexOf(const nodeColor& color) {
+    quint32 packedColor = packColor(color);
+    QHash<quint32, int>::const_iterator index = _indices.constFind(packedColor);
+    if (index != _indices.constEnd()) {
+        return index.value();
+    }
+    _indices.insert(packedColor, _colors.size());
+    _colors.append(packedColor);
+    return _colors.size() - 1;
+}
+
+bool OctreeColorPalette::getColor(int index, nodeColor& color) const {
+    if (index < 0 || index >= _colors.size()) {
+        return false;
+    }
+    quint32 packedColor = _colors.at(index);
+    color[RED_INDEX] = (packedColor >> 16) & 0xFF;
+    color[GREEN_INDEX] = (packedColor >> 8) & 0xFF;
+    color[BLUE_INDEX] = packedColor & 0xFF;
+    color[3] = 1;
+    return true;
+}
+
+QByteArray OctreeColorPalette::toByteArray() const {
+    unsigned char count[MAX_VARINT_BYTES];
+    QByteArray result(reinterpret_cast<const char*>(count), writeVarint(_colors.size(), count));
+    result.reserve(result.size() + _colors.size() * BYTES_PER_PALETTE_COLOR);
+    foreach (quint32 packedColor, _colors) {
+        result.append((char)((packedColor >> 16) & 0xFF));
+        result.append((char)((packedColor >> 8) & 0xFF));
+        result.append((char)(packedColor & 0xFF));
+    }
+    return result;
+}
+
+int OctreeColorPalette::readFromBuffer(const unsigned char* data, int length) {
+    clear();
+    quint32 count;
+    int bytesRead = readVarint(data, length, count);
+    if (bytesRead == 0 || count > (quint32)((length - bytesRead) / BYTES_PER_PALETTE_COLOR)) {
+        return 0;
+    }
+    _colors.reserve(count);
+    for (quint32 i = 0; i < count; i++) {
+        quint32 packedColor = packColor(data + bytesRead);
+        bytesRead += BYTES_PER_PALETTE_COLOR;
+
+        // a color saved twice keeps both indices, but colors are looked up by the first
+        if (!_indices.contains(packedColor)) {
+            _indices.insert(packedColor, _colors.size());
+        }
+        _colors.append(packedColor);
+    }
+    return bytesRead;
+}
+
+int OctreeColorPalette::writeVarint(quint32 value, unsigned char* buffer) {
+    int bytesWritten = 0;
+    while (value >= 0x80) {
+        buffer[bytesWritten++] = (unsigned char)(value & 0x7F) | 0x80;
+        value >>= 7;
+    }
+    buffer[bytesWritten++] = (unsigned char)value;
+    return bytesWritten;
+}
+
+int OctreeColorPalette::readVarint(const unsigned char* data, int length, quint32& value) {
+    value = 0;
+    for (int i = 0; i < length && i < MAX_VARINT_BYTES; i++) {
+        value |= (quint32)(data[i] & 0x7F) << (7 * i);
+        if (!(data[i] & 0x80)) {
+            return i + 1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,60 @@
+//
+//  OctreeColorPalette.h
+//  libraries/octree/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#ifndef hifi_OctreeColorPalette_h
+#define hifi_OctreeColorPalette_h
+
+#include <QtCore/QByteArray>
+#include <QtCore/QHash>
+#include <QtCore/QVector>
+
+#include <OctalCode.h>
+#include <SharedUtil.h>
+
+/// the bytes an SVO file saved with a palette starts with, before the palette and the encoded slices
+const char SVO_COLOR_PALETTE_MAGIC[] = { 'S', 'V', 'O', 'P' };
+const int SVO_COLOR_PALETTE_MAGIC_SIZE = sizeof(SVO_COLOR_PALETTE_MAGIC);
+
+/// the most bytes a varint of 32 bits takes
+const int MAX_VARINT_BYTES = 5;
+
+/// The distinct colors of a tree, each indexed by when it was first seen. An element's color can then be written as its
+/// index in a varint, which is a byte for the first 128 colors and two for the first 16384, rather than three bytes.
+class OctreeColorPalette {
+public:
+    void clear();
+
+    int getCount() const { return _colors.size(); }
+
+    /// the index of the color, which is added if it's new
+    int indexOf(const nodeColor& color);
+
+    /// copies the color at an index, returns false if there's none
+    bool getColor(int index, nodeColor& color) const;
+
+    /// the palette as the count of colors in a varint followed by each color's red, green and blue
+    QByteArray toByteArray() const;
+
+    /// replaces the palette with the one at the start of the buffer, returns the bytes it took or 0 if it's malformed
+    int readFromBuffer(const unsigned char* data, int length);
+
+    /// writes a value seven bits to a byte, low bits first, with the high bit set in every byte but the last, returns
+    /// the bytes written to the buffer, which should have room for MAX_VARINT_BYTES
+    static int writeVarint(quint32 value, unsigned char* buffer);
+
+    /// reads a varint from the start of the buffer, returns the bytes it took or 0 if it runs past the buffer
+    static int readVarint(const unsigned char* data, int length, quint32& value);
+
+private:
+    QVector<quint32> _colors; /// packed as 0xRRGGBB
+    QHash<quint32, int> _indices;
+};
+
+#endif // hifi_OctreeColorPalette_h
@@ -0,0 +1,82 @@
+//
+//  OctreeDeletedIDLog.cpp
+//  libraries/octree/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#include <cstring>
+
+#include "OctreeDeletedIDLog.h"
+
+const int MIN_DELETED_IDS_CAPACITY = 64;
+
+OctreeDeletedIDLog::OctreeDeletedIDLog() :
+    _first(0),
+    _count(0),
+    _firstCursor(0)
+{
+}
+
+void OctreeDeletedIDLog::append(uint32_t id) {
+    QWriteLocker locker(&_lock);
+    if (_count == _ids.size()) {
+        if (_ids.size() < MAX_DELETED_IDS_LOGGED) {
+            // grow the ring, unwrapping it so that the oldest ID is first
+            QVector<uint32_t> ids(qMin(qMax(_ids.size() * 2, MIN_DELETED_IDS_CAPACITY), MAX_DELETED_IDS_LOGGED));
+            for (int i = 0; i < _count; i++) {
+                ids[i] = _ids.at((_first + i) % _ids.size());
+            }
+            _ids = ids;
+            _first = 0;
+        } else {
+            // the ring is as big as it gets, so the oldest deletion makes way
+            _first = (_first + 1) % _ids.size();
+            _count--;
+            _firstCursor++;
+        }
+    }
+    _ids[(_first + _count) % _ids.size()] = id;
+    _count++;
+}
+
+bool OctreeDeletedIDLog::isEmpty() const {
+    QReadLocker locker(&_lock);
+    return _count == 0;
+}
+
+bool OctreeDeletedIDLog::hasDeletedSince(quint64 cursor) const {
+    QReadLocker locker(&_lock);
+    return cursor < _firstCursor + _count;
+}
+
+int OctreeDeletedIDLog::copyDeletedSince(quint64& cursor, unsigned char* buffer, int maxIDs) const {
+    QReadLocker locker(&_lock);
+
+    // a client that fell further behind than the log keeps picks up from the oldest deletion there is
+    if (cursor < _firstCursor) {
+        cursor = _firstCursor;
+    }
+    int idsCopied = 0;
+    quint64 endCursor = _firstCursor + _count;
+    for (; cursor < endCursor && idsCopied < maxIDs; cursor++, idsCopied++) {
+        uint32_t id = _ids.at((_first + (int)(cursor - _firstCursor)) % _ids.size());
+        memcpy(buffer, &id, sizeof(id));
+        buffer += sizeof(id);
+    }
+    return idsCopied;
+}
+
+void OctreeDeletedIDLog::forgetDeletedBefore(quint64 cursor) {
+    QWriteLocker locker(&_lock);
+    if (cursor <= _firstCursor || _count == 0) {
+        return;
+    }
+    int idsForgotten = (int)qMin(cursor - _firstCursor, (quint64)_count);
+    _first = (_first + idsForgotten) % _ids.size();
+    _count -= idsForgotten;
+    _firstCursor += idsForgotten;
+}
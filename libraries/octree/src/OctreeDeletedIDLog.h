@@ -0,0 +1,52 @@
+//
+//  OctreeDeletedIDLog.h
+//  libraries/octree/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#ifndef hifi_OctreeDeletedIDLog_h
+#define hifi_OctreeDeletedIDLog_h
+
+#include <stdint.h>
+
+#include <QtCore/QReadWriteLock>
+#include <QtCore/QVector>
+
+/// the most deletions a log keeps, past which the oldest are dropped even if a client hasn't been sent them yet
+const int MAX_DELETED_IDS_LOGGED = 100000;
+
+/// The IDs deleted from a tree, in the order they were deleted, in a ring that grows up to MAX_DELETED_IDS_LOGGED. Each
+/// deletion has a cursor one past the one before it, so a client needs only the cursor of the next deletion it hasn't
+/// been sent, and sending it what's new takes as long as there are new deletions rather than as long as the log.
+class OctreeDeletedIDLog {
+public:
+    OctreeDeletedIDLog();
+
+    /// logs the deletion of an ID, safe to call from any thread
+    void append(uint32_t id);
+
+    bool isEmpty() const;
+
+    /// whether any IDs were deleted from a cursor on
+    bool hasDeletedSince(quint64 cursor) const;
+
+    /// copies up to maxIDs of the IDs deleted from a cursor on to the buffer and moves the cursor past them, returns the
+    /// number of IDs copied
+    int copyDeletedSince(quint64& cursor, unsigned char* buffer, int maxIDs) const;
+
+    /// drops the deletions before a cursor, once every client has been sent them
+    void forgetDeletedBefore(quint64 cursor);
+
+private:
+    mutable QReadWriteLock _lock;
+    QVector<uint32_t> _ids;
+    int _first; // the index of the oldest ID in the ring
+    int _count;
+    quint64 _firstCursor; // the cursor of the oldest ID
+};
+
+#endif // hifi_OctreeDeletedIDLog_h
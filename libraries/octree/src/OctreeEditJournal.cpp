@@ -0,0 +1,136 @@
+//
+//  OctreeEditJournal.cpp
+//  libraries/octree/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#include <QtCore/QDataStream>
+#include <QtCore/QDebug>
+
+#include <PacketHeaders.h>
+
+#include "OctreeEditJournal.h"
+
+OctreeEditJournal::OctreeEditJournal(const QString& svoFileName) :
+    _fileName(svoFileName + ".journal"),
+    _compactingFileName(svoFileName + ".journal.compacting"),
+    _file(),
+    _mutex(),
+    _bytes(0),
+    _numRecorded(0)
+{
+}
+
+bool OctreeEditJournal::open() {
+    QMutexLocker locker(&_mutex);
+    if (_file.isOpen()) {
+        return true;
+    }
+    _file.setFileName(_fileName);
+    if (!_file.open(QIODevice::WriteOnly | QIODevice::Append)) {
+        qDebug() << "Couldn't open the edit journal" << _fileName;
+        return false;
+    }
+    _bytes = _file.size();
+    return true;
+}
+
+void OctreeEditJournal::close() {
+    QMutexLocker locker(&_mutex);
+    _file.close();
+}
+
+void OctreeEditJournal::recordEditPacket(const QByteArray& packet) {
+    QMutexLocker locker(&_mutex);
+    if (!_file.isOpen()) {
+        return;
+    }
+    QDataStream out(&_file);
+    out << packet;
+
+    // handed to the system straight away, so that the edit outlives a crash of the server
+    _file.flush();
+    _bytes = _file.size();
+    _numRecorded++;
+}
+
+void OctreeEditJournal::startCompaction() {
+    QMutexLocker locker(&_mutex);
+    _file.close();
+
+    if (QFile::exists(_compactingFileName)) {
+        // the last save didn't finish, so what was set aside then still has to be replayed ahead of the journal
+        QFile compactingFile(_compactingFileName);
+        QFile journalFile(_fileName);
+        if (compactingFile.open(QIODevice::WriteOnly | QIODevice::Append) && journalFile.open(QIODevice::ReadOnly)) {
+            compactingFile.write(journalFile.readAll());
+        }
+        journalFile.close();
+        QFile::remove(_fileName);
+
+    } else if (QFile::exists(_fileName)) {
+        QFile::rename(_fileName, _compactingFileName);
+    }
+
+    _file.setFileName(_fileName);
+    if (!_file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        qDebug() << "Couldn't start a fresh edit journal" << _fileName;
+    }
+    _bytes = 0;
+    _numRecorded = 0;
+}
+
+void OctreeEditJournal::finishCompaction() {
+    QFile::remove(_compactingFileName);
+}
+
+int OctreeEditJournal::replay(Octree* tree) {
+    int numReplayed = replayFile(_compactingFileName, tree);
+    numReplayed += replayFile(_fileName, tree);
+    if (numReplayed > 0) {
+        qDebug() << "Replayed" << numReplayed << "edit packets from the journal" << _fileName;
+    }
+    return numReplayed;
+}
+
+int OctreeEditJournal::replayFile(const QString& fileName, Octree* tree) {
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return 0;
+    }
+    QDataStream in(&file);
+    int numReplayed = 0;
+    while (!in.atEnd()) {
+        QByteArray packet;
+        in >> packet;
+        if (in.status() != QDataStream::Ok) {
+            qDebug() << "Ignoring the end of the edit journal" << fileName << ", which was cut short";
+            break;
+        }
+        applyEditPacket(packet, tree);
+        numReplayed++;
+    }
+    return numReplayed;
+}
+
+void OctreeEditJournal::applyEditPacket(const QByteArray& packet, Octree* tree) {
+    PacketType packetType = packetTypeForPacket(packet);
+    if (!tree->handlesEditPacketType(packetType)) {
+        return;
+    }
+    // the edit records follow the header, the sequence number and the time the packet was sent
+    int atByte = numBytesForPacketHeader(packet) + sizeof(unsigned short int) + sizeof(quint64);
+    const unsigned char* packetData = reinterpret_cast<const unsigned char*>(packet.data());
+    while (atByte < packet.size()) {
+        int editDataBytesRead = tree->processEditPacketData(packetType, packetData, packet.size(), packetData + atByte,
+            packet.size() - atByte, SharedNodePointer());
+        if (editDataBytesRead <= 0) {
+            break;
+        }
+        atByte += editDataBytesRead;
+    }
+}
@@ -0,0 +1,70 @@
+//
+//  OctreeEditJournal.h
+//  libraries/octree/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#ifndef hifi_OctreeEditJournal_h
+#define hifi_OctreeEditJournal_h
+
+#include <QtCore/QByteArray>
+#include <QtCore/QFile>
+#include <QtCore/QMutex>
+#include <QtCore/QString>
+
+#include "Octree.h"
+
+/// The edit packets a server has applied to its tree since the tree was last saved, appended to a file beside the SVO
+/// as they come in, so that an edit is kept without saving the whole tree and a crash only loses what the system
+/// hadn't written out. When the tree is saved the journal is set aside to be removed once the save has finished, and
+/// a fresh one started. Loading the SVO and then replaying what's set aside followed by the journal brings the tree
+/// back to where it was.
+class OctreeEditJournal {
+public:
+    OctreeEditJournal(const QString& svoFileName);
+    ~OctreeEditJournal() { close(); }
+
+    /// opens the journal to append to, keeping what's already in it for replay
+    bool open();
+    void close();
+
+    /// appends an edit packet that has been applied to the tree, safe to call from any thread
+    void recordEditPacket(const QByteArray& packet);
+
+    qint64 getBytes() const { return _bytes; }
+    int getNumRecorded() const { return _numRecorded; }
+
+    /// sets the journal aside and starts a fresh one, to be called before the tree is saved
+    void startCompaction();
+
+    /// removes the journal set aside, to be called once the saved tree is in place
+    void finishCompaction();
+
+    /// applies the journal set aside and then the journal to the tree, which the caller should have locked for
+    /// writing, returns the number of packets applied
+    int replay(Octree* tree);
+
+    /// applies each of the edit records in an edit packet, with the tree locked by the caller
+    static void applyEditPacket(const QByteArray& packet, Octree* tree);
+
+private:
+    // disallow copying of OctreeEditJournal objects
+    OctreeEditJournal(const OctreeEditJournal&);
+    OctreeEditJournal& operator= (const OctreeEditJournal&);
+
+    /// applies the packets in one journal file, stopping at a record cut short by a crash
+    static int replayFile(const QString& fileName, Octree* tree);
+
+    QString _fileName;
+    QString _compactingFileName;
+    QFile _file;
+    QMutex _mutex;
+    qint64 _bytes;
+    int _numRecorded;
+};
+
+#endif // hifi_OctreeEditJournal_h
@@ -10,6 +10,7 @@
 //
 
 #include <assert.h>
+#include <cstring>
 
 #include <PerfStat.h>
 
@@ -34,7 +35,7 @@ OctreeEditPacketSender::OctreeEditPacketSender() :
     _maxPendingMessages(DEFAULT_MAX_PENDING_MESSAGES),
     _releaseQueuedMessagesPending(false),
     _serverJurisdictions(NULL),
-    _sequenceNumber(0),
+    _outgoingSequenceNumbers(),
     _maxPacketSize(MAX_PACKET_SIZE) {
 }
 
@@ -299,6 +300,19 @@ void OctreeEditPacketSender::releaseQueuedMessages() {
     }
 }
 
+bool OctreeEditPacketSender::hasQueuedMessages() const {
+    if (hasPacketsToSend()) {
+        return true;
+    }
+    for (QHash<QUuid, EditPacketBuffer>::const_iterator i = _pendingEditPackets.constBegin();
+            i != _pendingEditPackets.constEnd(); i++) {
+        if (i.value()._currentSize > 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
 void OctreeEditPacketSender::releaseQueuedPacket(EditPacketBuffer& packetBuffer) {
     _releaseQueuedPacketMutex.lock();
     if (packetBuffer._currentSize > 0 && packetBuffer._currentType != PacketTypeUnknown) {
@@ -313,10 +327,11 @@ void OctreeEditPacketSender::initializePacket(EditPacketBuffer& packetBuffer, Pa
     packetBuffer._currentSize = populatePacketHeader(reinterpret_cast<char*>(&packetBuffer._currentBuffer[0]), type);
 
     // pack in sequence numbers
+    unsigned short int& sequenceNumber = _outgoingSequenceNumbers[packetBuffer._nodeUUID];
     unsigned short int* sequenceAt = (unsigned short int*)&packetBuffer._currentBuffer[packetBuffer._currentSize];
-    *sequenceAt = _sequenceNumber;
+    *sequenceAt = sequenceNumber;
     packetBuffer._currentSize += sizeof(unsigned short int); // nudge past sequence
-    _sequenceNumber++;
+    sequenceNumber++;
 
     // pack in timestamp
     quint64 now = usecTimestampNow();
@@ -338,6 +353,14 @@ bool OctreeEditPacketSender::process() {
     return PacketSender::process();
 }
 
+void OctreeEditPacketSender::packetAboutToBeSent(QByteArray& packet) {
+    int timeOffset = numBytesForPacketHeader(packet) + sizeof(unsigned short int);
+    if (packet.size() >= timeOffset + (int) sizeof(quint64)) {
+        quint64 now = usecTimestampNow();
+        memcpy(packet.data() + timeOffset, &now, sizeof(now));
+    }
+}
+
 void OctreeEditPacketSender::processNackPacket(const QByteArray& packet) {
     // parse sending node from packet, retrieve packet history for that node
     QUuid sendingNodeUUID = uuidFromPacketHeader(packet);
@@ -348,23 +371,25 @@ void OctreeEditPacketSender::processNackPacket(const QByteArray& packet) {
     }
     const SentPacketHistory& sentPacketHistory = _sentPacketHistories.value(sendingNodeUUID);
 
-    int numBytesPacketHeader = numBytesForPacketHeader(packet);
-    const unsigned char* dataAt = reinterpret_cast<const unsigned char*>(packet.data()) + numBytesPacketHeader;
+    SelectiveAck ack;
+    if (!ack.unpackFromPacket(packet)) {
+        return;
+    }
 
-    // read number of sequence numbers
-    uint16_t numSequenceNumbers = (*(uint16_t*)dataAt);
-    dataAt += sizeof(uint16_t);
-    
-    // read sequence numbers and queue packets for resend
-    for (int i = 0; i < numSequenceNumbers; i++) {
-        unsigned short int sequenceNumber = (*(unsigned short int*)dataAt);
-        dataAt += sizeof(unsigned short int);
+    // the edits to this server go no faster than its acks say the path to it can take
+    CongestionControl& congestionControl = _congestionControls[sendingNodeUUID];
+    congestionControl.ackReceived(ack, usecTimestampNow());
+    setPacketsPerSecondForDestination(sendingNodeUUID, congestionControl.getPacketsPerSecond());
 
+    // queue the packets it is missing for resend
+    const SharedNodePointer& node = NodeList::getInstance()->getNodeHash().value(sendingNodeUUID);
+    foreach (uint16_t sequenceNumber, ack.getMissingSequenceNumbers()) {
         // retrieve packet from history
-        const QByteArray* packet = sentPacketHistory.getPacket(sequenceNumber);
-        if (packet) {
-            const SharedNodePointer& node = NodeList::getInstance()->getNodeHash().value(sendingNodeUUID);
-            queuePacketForSending(node, *packet);
+        QByteArray missingPacket = sentPacketHistory.getPacket(sequenceNumber);
+        if (!missingPacket.isNull()) {
+            // the server is waiting on resends, so they go out ahead of new edits, copied out of the history that
+            // newer edits will overwrite while they wait
+            queuePacketForSending(node, QByteArray(missingPacket.constData(), missingPacket.size()), CONTROL_PRIORITY);
         }
     }
 }
@@ -374,4 +399,7 @@ void OctreeEditPacketSender::nodeKilled(SharedNodePointer node) {
     QUuid nodeUUID = node->getUUID();
     _pendingEditPackets.remove(nodeUUID);
     _sentPacketHistories.remove(nodeUUID);
+    _congestionControls.remove(nodeUUID);
+    _outgoingSequenceNumbers.remove(nodeUUID);
+    setPacketsPerSecondForDestination(nodeUUID, 0);
 }
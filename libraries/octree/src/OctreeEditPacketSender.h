@@ -13,6 +13,7 @@
 #define hifi_OctreeEditPacketSender_h
 
 #include <qqueue.h>
+#include <CongestionControl.h>
 #include <PacketSender.h>
 #include <PacketHeaders.h>
 #include "JurisdictionMap.h"
@@ -49,6 +50,9 @@ public:
     /// servers are known.
     void releaseQueuedMessages();
 
+    /// are there edit messages waiting to be released, or released packets waiting to be sent
+    bool hasQueuedMessages() const;
+
     /// are we in sending mode. If we're not in sending mode then all packets and messages will be ignored and
     /// not queued and not sent
     bool getShouldSend() const { return _shouldSend; }
@@ -99,6 +103,9 @@ public:
     void processNackPacket(const QByteArray& packet);
 
 protected:
+    /// stamps the time the edit packet goes out, so that the round trip its ack times leaves out the time it waited here
+    virtual void packetAboutToBeSent(QByteArray& packet);
+
     bool _shouldSend;
     void queuePacketToNode(const QUuid& nodeID, const unsigned char* buffer, ssize_t length);
     void queuePendingPacketToNodes(PacketType type, unsigned char* buffer, ssize_t length);
@@ -120,12 +127,13 @@ protected:
 
     NodeToJurisdictionMap* _serverJurisdictions;
     
-    unsigned short int _sequenceNumber;
+    QHash<QUuid, unsigned short int> _outgoingSequenceNumbers; /// each server sees a sequence of its own
     int _maxPacketSize;
 
     QMutex _releaseQueuedPacketMutex;
 
     // TODO: add locks for this and _pendingEditPackets
     QHash<QUuid, SentPacketHistory> _sentPacketHistories;
+    QHash<QUuid, CongestionControl> _congestionControls;
 };
 #endif // hifi_OctreeEditPacketSender_h
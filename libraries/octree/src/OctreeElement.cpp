@@ -17,6 +17,7 @@
 
 #include <NodeList.h>
 #include <PerfStat.h>
+#include <SlabAllocator.h>
 #include <assert.h>
 
 #include "AACube.h"
@@ -26,6 +27,23 @@
 #include "Octree.h"
 #include "SharedUtil.h"
 
+// the octal codes too long to store in place are at most 97 bytes, so they come in four sizes of block
+static SlabAllocator& getOctalCodeAllocator(size_t length) {
+    // the allocators are never deleted, as elements can outlive the static destructors
+    static SlabAllocator* allocators[] = { new SlabAllocator(16), new SlabAllocator(32), new SlabAllocator(64),
+        new SlabAllocator(128) };
+    int index = 0;
+    while (allocators[index]->getBlockSize() < length && index < 3) {
+        index++;
+    }
+    return *allocators[index];
+}
+
+static SlabAllocator& getExternalChildrenAllocator() {
+    static SlabAllocator* allocator = new SlabAllocator(NUMBER_OF_CHILDREN * sizeof(OctreeElement*));
+    return *allocator;
+}
+
 quint64 OctreeElement::_voxelMemoryUsage = 0;
 quint64 OctreeElement::_octcodeMemoryUsage = 0;
 quint64 OctreeElement::_externalChildrenMemoryUsage = 0;
@@ -51,17 +69,21 @@ void OctreeElement::init(unsigned char * octalCode) {
     _voxelNodeCount++;
     _voxelNodeLeafCount++; // all nodes start as leaf nodes
 
+    _parent = NULL;
+    _lastChangedInSubtree = 0;
+
 
     size_t octalCodeLength = bytesRequiredForCodeLength(numberOfThreeBitSectionsInCode(octalCode));
     if (octalCodeLength > sizeof(_octalCode)) {
-        _octalCode.pointer = octalCode;
+        _octalCode.pointer = static_cast<unsigned char*>(getOctalCodeAllocator(octalCodeLength).allocate());
+        memcpy(_octalCode.pointer, octalCode, octalCodeLength);
         _octcodePointer = true;
         _octcodeMemoryUsage += octalCodeLength;
     } else {
         _octcodePointer = false;
         memcpy(_octalCode.buffer, octalCode, octalCodeLength);
-        delete[] octalCode;
     }
+    delete[] octalCode;
 
     // set up the _children union
     _childBitmask = 0;
@@ -105,8 +127,9 @@ OctreeElement::~OctreeElement() {
     }
 
     if (_octcodePointer) {
-        _octcodeMemoryUsage -= bytesRequiredForCodeLength(numberOfThreeBitSectionsInCode(getOctalCode()));
-        delete[] _octalCode.pointer;
+        size_t octalCodeLength = bytesRequiredForCodeLength(numberOfThreeBitSectionsInCode(getOctalCode()));
+        _octcodeMemoryUsage -= octalCodeLength;
+        getOctalCodeAllocator(octalCodeLength).deallocate(_octalCode.pointer);
     }
 
     // delete all of this node's children, this also takes care of all population tracking data
@@ -115,9 +138,17 @@ OctreeElement::~OctreeElement() {
 
 void OctreeElement::markWithChangedTime() {
     _lastChanged = usecTimestampNow();
+    noteSubtreeChanged(_lastChanged);
     notifyUpdateHooks(); // if the node has changed, notify our hooks
 }
 
+void OctreeElement::noteSubtreeChanged(quint64 time) {
+    // stop at the first ancestor that already knows of a change this recent, everything above it does too
+    for (OctreeElement* element = this; element && element->_lastChangedInSubtree < time; element = element->_parent) {
+        element->_lastChangedInSubtree = time;
+    }
+}
+
 // This method is called by Octree when the subtree below this node
 // is known to have changed. It's intended to be used as a place to do
 // bookkeeping that a node may need to do when the subtree below it has
@@ -224,6 +255,7 @@ void OctreeElement::deleteChildAtIndex(int childIndex) {
 OctreeElement* OctreeElement::removeChildAtIndex(int childIndex) {
     OctreeElement* returnedChild = getChildAtIndex(childIndex);
     if (returnedChild) {
+        returnedChild->_parent = NULL;
         setChildAtIndex(childIndex, NULL);
         _isDirty = true;
         markWithChangedTime();
@@ -647,6 +679,15 @@ void OctreeElement::deleteAllChildren() {
         }
     }
 
+#ifdef SIMPLE_EXTERNAL_CHILDREN
+    // two or more children are stored externally
+    if (getChildCount() > 1) {
+        getExternalChildrenAllocator().deallocate(_children.external);
+        _externalChildrenMemoryUsage -= NUMBER_OF_CHILDREN * sizeof(OctreeElement*);
+    }
+    _children.single = NULL;
+#endif // def SIMPLE_EXTERNAL_CHILDREN
+
 #ifdef BLENDED_UNION_CHILDREN
     // now, reset our internal state and ANY and all population data
     int childCount = getChildCount();
@@ -695,6 +736,11 @@ void OctreeElement::deleteAllChildren() {
 }
 
 void OctreeElement::setChildAtIndex(int childIndex, OctreeElement* child) {
+    if (child) {
+        child->_parent = this;
+        noteSubtreeChanged(child->_lastChangedInSubtree);
+    }
+
 #ifdef SIMPLE_CHILD_ARRAY
     int previousChildCount = getChildCount();
     if (child) {
@@ -739,7 +785,7 @@ void OctreeElement::setChildAtIndex(int childIndex, OctreeElement* child) {
         _children.single = child;
     } else if (previousChildCount == 1 && newChildCount == 2) {
         OctreeElement* previousChild = _children.single;
-        _children.external = new OctreeElement*[NUMBER_OF_CHILDREN];
+        _children.external = static_cast<OctreeElement**>(getExternalChildrenAllocator().allocate());
         memset(_children.external, 0, sizeof(OctreeElement*) * NUMBER_OF_CHILDREN);
         _children.external[firstIndex] = previousChild;
         _children.external[childIndex] = child;
@@ -750,7 +796,7 @@ void OctreeElement::setChildAtIndex(int childIndex, OctreeElement* child) {
         assert(!child); // we are removing a child, so this must be true!
         OctreeElement* previousFirstChild = _children.external[firstIndex];
         OctreeElement* previousSecondChild = _children.external[secondIndex];
-        delete[] _children.external;
+        getExternalChildrenAllocator().deallocate(_children.external);
         _externalChildrenMemoryUsage -= NUMBER_OF_CHILDREN * sizeof(OctreeElement*);
         if (childIndex == firstIndex) {
             _children.single = previousSecondChild;
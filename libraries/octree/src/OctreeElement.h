@@ -151,6 +151,15 @@ public:
     bool hasChangedSince(quint64 time) const { return (_lastChanged > time); }
     void markWithChangedTime();
     quint64 getLastChanged() const { return _lastChanged; }
+
+    /// has this element, or anything below it, changed since time. Kept up to date as elements change, so whole
+    /// unchanged subtrees can be skipped without visiting them.
+    bool hasChangedInSubtreeSince(quint64 time) const { return (_lastChangedInSubtree > time); }
+    quint64 getLastChangedInSubtree() const { return _lastChangedInSubtree; }
+
+    /// notes a change at a time on this element and its ancestors
+    void noteSubtreeChanged(quint64 time);
+    OctreeElement* getParent() const { return _parent; }
     void handleSubtreeChanged(Octree* myTree);
     
     // Used by VoxelSystem for rendering in/out of view and LOD
@@ -261,6 +270,8 @@ protected:
     } _octalCode;  
 
     quint64 _lastChanged; /// Client and server, timestamp this node was last changed, 8 bytes
+    quint64 _lastChangedInSubtree; /// Client and server, latest _lastChanged of this node and its descendants, 8 bytes
+    OctreeElement* _parent; /// Client and server, the node this is a child of, NULL for the root, 8 bytes
 
     /// Client and server, pointers to child nodes, various encodings
 #ifdef SIMPLE_CHILD_ARRAY
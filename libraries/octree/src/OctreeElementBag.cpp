@@ -9,11 +9,15 @@
 //  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
 //
 
-#include "OctreeElementBag.h"
 #include <OctalCode.h>
 
+#include "OctreeElementBag.h"
+#include "ViewFrustum.h"
+
 OctreeElementBag::OctreeElementBag() : 
-    _bagElements()
+    _heap(),
+    _heapIndices(),
+    _viewFrustum(NULL)
 {
     OctreeElement::addDeleteHook(this);
     _hooked = true;
@@ -37,29 +41,102 @@ void OctreeElementBag::elementDeleted(OctreeElement* element) {
 
 
 void OctreeElementBag::deleteAll() {
-    _bagElements.clear();
+    _heap.clear();
+    _heapIndices.clear();
 }
 
 
 void OctreeElementBag::insert(OctreeElement* element) {
-    _bagElements.insert(element);
+    if (_heapIndices.contains(element)) {
+        return;
+    }
+    Entry entry = { calculatePriority(element), element };
+    _heap.append(entry);
+    _heapIndices.insert(element, _heap.size() - 1);
+    siftUp(_heap.size() - 1);
 }
 
 OctreeElement* OctreeElementBag::extract() {
     OctreeElement* result = NULL;
 
-    if (_bagElements.size() > 0) {
-        QSet<OctreeElement*>::iterator front = _bagElements.begin();
-        result = *front;
-        _bagElements.erase(front);
+    if (_heap.size() > 0) {
+        result = _heap.at(0).element;
+        _heapIndices.remove(result);
+        Entry last = _heap.last();
+        _heap.removeLast();
+        if (_heap.size() > 0) {
+            place(last, 0);
+            siftDown(0);
+        }
     }
     return result;
 }
 
 bool OctreeElementBag::contains(OctreeElement* element) {
-    return _bagElements.contains(element);
+    return _heapIndices.contains(element);
 }
 
 void OctreeElementBag::remove(OctreeElement* element) {
-    _bagElements.remove(element);
+    QHash<OctreeElement*, int>::iterator it = _heapIndices.find(element);
+    if (it == _heapIndices.end()) {
+        return;
+    }
+    int heapIndex = it.value();
+    _heapIndices.erase(it);
+    Entry last = _heap.last();
+    _heap.removeLast();
+    if (heapIndex < _heap.size()) {
+        // the last entry fills the hole, and may belong either above or below it
+        place(last, heapIndex);
+        siftUp(heapIndex);
+        siftDown(_heapIndices.value(last.element));
+    }
+}
+
+float OctreeElementBag::calculatePriority(OctreeElement* element) const {
+    float scale = element->getScale();
+    if (!_viewFrustum) {
+        return scale;
+    }
+    // roughly the angle the element spans, which is highest for the elements the viewer is in
+    float distance = glm::distance(element->getAACube().calcCenter(), _viewFrustum->getPositionVoxelScale());
+    return scale / (distance + scale);
+}
+
+void OctreeElementBag::siftUp(int heapIndex) {
+    Entry entry = _heap.at(heapIndex);
+    while (heapIndex > 0) {
+        int parentIndex = (heapIndex - 1) / 2;
+        if (_heap.at(parentIndex).priority >= entry.priority) {
+            break;
+        }
+        place(_heap.at(parentIndex), heapIndex);
+        heapIndex = parentIndex;
+    }
+    place(entry, heapIndex);
+}
+
+void OctreeElementBag::siftDown(int heapIndex) {
+    Entry entry = _heap.at(heapIndex);
+    int size = _heap.size();
+    forever {
+        int childIndex = 2 * heapIndex + 1;
+        if (childIndex >= size) {
+            break;
+        }
+        if (childIndex + 1 < size && _heap.at(childIndex + 1).priority > _heap.at(childIndex).priority) {
+            childIndex++;
+        }
+        if (_heap.at(childIndex).priority <= entry.priority) {
+            break;
+        }
+        place(_heap.at(childIndex), heapIndex);
+        heapIndex = childIndex;
+    }
+    place(entry, heapIndex);
+}
+
+void OctreeElementBag::place(const Entry& entry, int heapIndex) {
+    _heap[heapIndex] = entry;
+    _heapIndices[entry.element] = heapIndex;
 }
@@ -9,6 +9,7 @@
 //  it's a generic bag style storage mechanism. But It has the property that you can't put the same node into the bag
 //  more than once (in other words, it de-dupes automatically), also, it supports collapsing it's several peer nodes
 //  into a parent node in cases where you add enough peers that it makes more sense to just add the parent.
+//  The elements come out biggest on the screen of the view it's given first, or biggest first without one.
 //
 //  Distributed under the Apache License, Version 2.0.
 //  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
@@ -17,21 +18,30 @@
 #ifndef hifi_OctreeElementBag_h
 #define hifi_OctreeElementBag_h
 
+#include <QtCore/QHash>
+#include <QtCore/QVector>
+
 #include "OctreeElement.h"
 
+class ViewFrustum;
+
 class OctreeElementBag : public OctreeElementDeleteHook {
 
 public:
     OctreeElementBag();
     ~OctreeElementBag();
     
+    /// the elements inserted from here on are ordered by how big they look from the frustum's position, which must
+    /// outlive the bag, or by their size if it's NULL
+    void setViewFrustum(const ViewFrustum* viewFrustum) { _viewFrustum = viewFrustum; }
+
     void insert(OctreeElement* element); // put a element into the bag
-    OctreeElement* extract(); // pull a element out of the bag (could come in any order)
+    OctreeElement* extract(); // pull the biggest looking element out of the bag
     bool contains(OctreeElement* element); // is this element in the bag?
     void remove(OctreeElement* element); // remove a specific element from the bag
     
-    bool isEmpty() const { return _bagElements.isEmpty(); }
-    int count() const { return _bagElements.size(); }
+    bool isEmpty() const { return _heap.isEmpty(); }
+    int count() const { return _heap.size(); }
 
     void deleteAll();
     virtual void elementDeleted(OctreeElement* element);
@@ -39,7 +49,21 @@ public:
     void unhookNotifications();
 
 private:
-    QSet<OctreeElement*> _bagElements;
+    class Entry {
+    public:
+        float priority;
+        OctreeElement* element;
+    };
+
+    float calculatePriority(OctreeElement* element) const;
+
+    void siftUp(int heapIndex);
+    void siftDown(int heapIndex);
+    void place(const Entry& entry, int heapIndex);
+
+    QVector<Entry> _heap; /// a binary heap with the highest priority on top
+    QHash<OctreeElement*, int> _heapIndices; /// where each element is in the heap
+    const ViewFrustum* _viewFrustum;
     bool _hooked;
 };
 
@@ -0,0 +1,92 @@
+//
+//  OctreeEncodeCache.cpp
+//  libraries/octree/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#include <QtCore/QMutexLocker>
+
+#include "OctreeEncodeCache.h"
+
+// an element seen at more levels of detail than this only keeps its latest encodings
+const int MAX_ENCODINGS_PER_ELEMENT = 4;
+
+OctreeEncodeCache::OctreeEncodeCache(int maxBytes) :
+    _mutex(),
+    _entries(maxBytes),
+    _numHits(0),
+    _numMisses(0)
+{
+    OctreeElement::addDeleteHook(this);
+}
+
+OctreeEncodeCache::~OctreeEncodeCache() {
+    OctreeElement::removeDeleteHook(this);
+}
+
+bool OctreeEncodeCache::find(const OctreeElement* element, int lodDepth, unsigned char flags, QByteArray& encoded) {
+    QMutexLocker locker(&_mutex);
+    Entry* entry = _entries.object(element);
+    if (entry && entry->lastChanged == element->getLastChangedInSubtree()) {
+        for (int i = 0; i < entry->encodings.size(); i++) {
+            const Encoding& encoding = entry->encodings.at(i);
+            if (encoding.lodDepth == lodDepth && encoding.flags == flags) {
+                encoded = encoding.data;
+                _numHits++;
+                return true;
+            }
+        }
+    }
+    _numMisses++;
+    return false;
+}
+
+void OctreeEncodeCache::insert(const OctreeElement* element, int lodDepth, unsigned char flags,
+                               const unsigned char* data, int length) {
+    QMutexLocker locker(&_mutex);
+    Entry* entry = _entries.take(element);
+    if (!entry) {
+        entry = new Entry();
+        entry->bytes = 0;
+    } else if (entry->lastChanged != element->getLastChangedInSubtree()) {
+        // the element has changed since, so what was kept for it is of no use
+        entry->encodings.clear();
+        entry->bytes = 0;
+    }
+    entry->lastChanged = element->getLastChangedInSubtree();
+
+    for (int i = 0; i < entry->encodings.size(); i++) {
+        if (entry->encodings.at(i).lodDepth == lodDepth && entry->encodings.at(i).flags == flags) {
+            entry->bytes -= entry->encodings.at(i).data.size();
+            entry->encodings.remove(i);
+            break;
+        }
+    }
+    if (entry->encodings.size() == MAX_ENCODINGS_PER_ELEMENT) {
+        entry->bytes -= entry->encodings.first().data.size();
+        entry->encodings.remove(0);
+    }
+    Encoding encoding;
+    encoding.lodDepth = lodDepth;
+    encoding.flags = flags;
+    encoding.data = QByteArray(reinterpret_cast<const char*>(data), length);
+    entry->encodings.append(encoding);
+    entry->bytes += length;
+
+    // an entry that costs more than the whole cache is deleted rather than kept
+    _entries.insert(element, entry, entry->bytes);
+}
+
+void OctreeEncodeCache::clear() {
+    QMutexLocker locker(&_mutex);
+    _entries.clear();
+}
+
+void OctreeEncodeCache::elementDeleted(OctreeElement* element) {
+    QMutexLocker locker(&_mutex);
+    _entries.remove(element);
+}
@@ -0,0 +1,71 @@
+//
+//  OctreeEncodeCache.h
+//  libraries/octree/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#ifndef hifi_OctreeEncodeCache_h
+#define hifi_OctreeEncodeCache_h
+
+#include <QtCore/QByteArray>
+#include <QtCore/QCache>
+#include <QtCore/QMutex>
+#include <QtCore/QVector>
+
+#include "OctreeElement.h"
+
+const int DEFAULT_MAX_ENCODE_CACHE_BYTES = 32 * 1024 * 1024;
+
+/// Shares the encoded bytes of subtrees between the clients of a server. A subtree that's entirely in a client's view,
+/// and that's cut off at the same depth all over by the client's level of detail, encodes the same for every client
+/// that sees it so, and only has to be encoded once. Encodings are kept by element, level of detail depth and the
+/// encoding flags, and are only found while the last changed time of the element's subtree is the one they were made
+/// at, so changing an element or anything below it drops them. Safe to use from several send threads at once.
+class OctreeEncodeCache : public OctreeElementDeleteHook {
+public:
+    OctreeEncodeCache(int maxBytes = DEFAULT_MAX_ENCODE_CACHE_BYTES);
+    ~OctreeEncodeCache();
+
+    /// finds the encoding of the element's subtree, returns false if there isn't one for the element as it is now
+    bool find(const OctreeElement* element, int lodDepth, unsigned char flags, QByteArray& encoded);
+
+    /// keeps the encoding of the element's subtree, as it is now
+    void insert(const OctreeElement* element, int lodDepth, unsigned char flags, const unsigned char* data, int length);
+
+    void clear();
+
+    int getNumHits() const { return _numHits; }
+    int getNumMisses() const { return _numMisses; }
+
+    virtual void elementDeleted(OctreeElement* element);
+
+private:
+    // disallow copying of OctreeEncodeCache objects
+    OctreeEncodeCache(const OctreeEncodeCache&);
+    OctreeEncodeCache& operator= (const OctreeEncodeCache&);
+
+    class Encoding {
+    public:
+        int lodDepth;
+        unsigned char flags;
+        QByteArray data;
+    };
+
+    class Entry {
+    public:
+        quint64 lastChanged;
+        QVector<Encoding> encodings;
+        int bytes;
+    };
+
+    QMutex _mutex;
+    QCache<const OctreeElement*, Entry> _entries; /// the cost of an entry is its bytes
+    int _numHits;
+    int _numMisses;
+};
+
+#endif // hifi_OctreeEncodeCache_h
@@ -17,7 +17,9 @@ OctreeHeadlessViewer::OctreeHeadlessViewer() :
     OctreeRenderer(),
     _voxelSizeScale(DEFAULT_OCTREE_SIZE_SCALE),
     _boundaryLevelAdjust(0),
-    _maxPacketsPerSecond(DEFAULT_MAX_OCTREE_PPS)
+    _maxPacketsPerSecond(DEFAULT_MAX_OCTREE_PPS),
+    _wantBulkSync(false),
+    _bulkSyncBounds(glm::vec3(0.0f, 0.0f, 0.0f), TREE_SCALE)
 {
     _viewFrustum.setFieldOfView(DEFAULT_FIELD_OF_VIEW_DEGREES);
     _viewFrustum.setAspectRatio(DEFAULT_ASPECT_RATIO);
@@ -69,6 +71,8 @@ void OctreeHeadlessViewer::queryOctree() {
     _octreeQuery.setCameraEyeOffsetPosition(_viewFrustum.getEyeOffsetPosition());
     _octreeQuery.setOctreeSizeScale(getVoxelSizeScale());
     _octreeQuery.setBoundaryLevelAdjust(getBoundaryLevelAdjust());
+    _octreeQuery.setWantBulkSync(_wantBulkSync);
+    _octreeQuery.setBulkSyncBounds(_bulkSyncBounds);
 
     unsigned char queryPacket[MAX_PACKET_SIZE];
 
@@ -103,9 +107,7 @@ void OctreeHeadlessViewer::queryOctree() {
                     AACube serverBounds(glm::vec3(rootDetails.x, rootDetails.y, rootDetails.z), rootDetails.s);
                     serverBounds.scale(TREE_SCALE);
 
-                    ViewFrustum::location serverFrustumLocation = _viewFrustum.cubeInFrustum(serverBounds);
-
-                    if (serverFrustumLocation != ViewFrustum::OUTSIDE) {
+                    if (isServerInView(serverBounds)) {
                         inViewServers++;
                     }
                 } else {
@@ -174,12 +176,7 @@ void OctreeHeadlessViewer::queryOctree() {
                     AACube serverBounds(glm::vec3(rootDetails.x, rootDetails.y, rootDetails.z), rootDetails.s);
                     serverBounds.scale(TREE_SCALE);
 
-                    ViewFrustum::location serverFrustumLocation = _viewFrustum.cubeInFrustum(serverBounds);
-                    if (serverFrustumLocation != ViewFrustum::OUTSIDE) {
-                        inView = true;
-                    } else {
-                        inView = false;
-                    }
+                    inView = isServerInView(serverBounds);
                 } else {
                     jurisdictions.unlock();
                     if (wantExtraDebugging) {
@@ -252,3 +249,10 @@ void OctreeHeadlessViewer::trackIncomingOctreePacket(const QByteArray& packet,
                                 const SharedNodePointer& sendingNode, bool wasStatsPacket) {
                                 
 }
+
+bool OctreeHeadlessViewer::isServerInView(const AACube& serverBounds) const {
+    if (_wantBulkSync) {
+        return serverBounds.touches(_bulkSyncBounds);
+    }
+    return _viewFrustum.cubeInFrustum(serverBounds) != ViewFrustum::OUTSIDE;
+}
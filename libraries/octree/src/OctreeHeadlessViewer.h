@@ -52,6 +52,11 @@ public slots:
     void setBoundaryLevelAdjust(int boundaryLevelAdjust) { _boundaryLevelAdjust = boundaryLevelAdjust; }
     void setMaxPacketsPerSecond(int maxPacketsPerSecond) { _maxPacketsPerSecond = maxPacketsPerSecond; }
 
+    /// in place of the view, asks the servers for everything in the bounds at full detail and as fast as they can send
+    /// it, then only for what changes in them, for a viewer that mirrors the content rather than looks at it
+    void setWantBulkSync(bool wantBulkSync) { _wantBulkSync = wantBulkSync; }
+    void setBulkSyncBounds(const glm::vec3& corner, float scale) { _bulkSyncBounds.setBox(corner, scale); }
+
     // getters for camera attributes
     const glm::vec3& getPosition() const { return _viewFrustum.getPosition(); }
     const glm::quat& getOrientation() const { return _viewFrustum.getOrientation(); }
@@ -61,15 +66,22 @@ public slots:
     int getBoundaryLevelAdjust() const { return _boundaryLevelAdjust; }
     int getMaxPacketsPerSecond() const { return _maxPacketsPerSecond; }
 
+    bool getWantBulkSync() const { return _wantBulkSync; }
+    const AACube& getBulkSyncBounds() const { return _bulkSyncBounds; }
+
     unsigned getOctreeElementsCount() const { return _tree->getOctreeElementsCount(); }
 
 private:
+    bool isServerInView(const AACube& serverBounds) const;
+
     ViewFrustum _viewFrustum;
     JurisdictionListener* _jurisdictionListener;
     OctreeQuery _octreeQuery;
     float _voxelSizeScale;
     int _boundaryLevelAdjust;
     int _maxPacketsPerSecond;
+    bool _wantBulkSync;
+    AACube _bulkSyncBounds;
 };
 
 #endif // hifi_OctreeHeadlessViewer_h
@@ -0,0 +1,96 @@
+//
+//  OctreeLODSelector.cpp
+//  libraries/octree/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#include <cmath>
+
+#include <glm/glm.hpp>
+
+#include <SharedUtil.h>
+
+#include "OctreeConstants.h"
+#include "OctreeLODSelector.h"
+
+// the frame times at startup are all over the place, so the average starts out at the budget until we have this many
+const int IGNORE_FRAME_TIME_SAMPLES = 100;
+const float FRAME_TIME_AVERAGE_WEIGHT = 0.05f;
+
+// over the budget by more than this and we raise the error, under it by this much for a while and we lower it
+const float OVER_BUDGET_MARGIN = 1.05f;
+const float UNDER_BUDGET_MARGIN = 0.8f;
+
+const quint64 RAISE_ERROR_INTERVAL = USECS_PER_SECOND / 2;
+const quint64 LOWER_ERROR_DELAY = 2 * USECS_PER_SECOND;
+const quint64 LOWER_ERROR_INTERVAL = USECS_PER_SECOND;
+
+// the most the error is raised by at once, in proportion to how far over the budget we are, and what it's lowered by
+const float MAX_RAISE_ERROR_BY = 1.5f;
+const float LOWER_ERROR_BY = 0.95f;
+
+// an element of level L is TREE_SCALE / 2^L meters across, and is swapped for its children at sizeScale / 2^(L + 1)
+// meters, where it covers 2 * TREE_SCALE / sizeScale radians whatever its level
+static float pixelsPerRadian(float fieldOfView, float viewportHeight) {
+    return viewportHeight * 0.5f / tanf(glm::radians(fieldOfView) * 0.5f);
+}
+
+OctreeLODSelector::OctreeLODSelector() :
+    _frameTimeBudget(DEFAULT_LOD_FRAME_TIME_BUDGET),
+    _pixelError(DEFAULT_LOD_PIXEL_ERROR) {
+
+    reset(usecTimestampNow());
+}
+
+void OctreeLODSelector::setPixelError(float pixelError) {
+    _pixelError = glm::clamp(pixelError, MIN_LOD_PIXEL_ERROR, MAX_LOD_PIXEL_ERROR);
+}
+
+float OctreeLODSelector::getSizeScale(float fieldOfView, float viewportHeight) const {
+    return 2.0f * TREE_SCALE * pixelsPerRadian(fieldOfView, viewportHeight) / _pixelError;
+}
+
+void OctreeLODSelector::setSizeScale(float sizeScale, float fieldOfView, float viewportHeight) {
+    setPixelError(2.0f * TREE_SCALE * pixelsPerRadian(fieldOfView, viewportHeight) / sizeScale);
+}
+
+bool OctreeLODSelector::update(float frameTime, quint64 now) {
+    if (++_sampleCount < IGNORE_FRAME_TIME_SAMPLES) {
+        return false;
+    }
+    _averageFrameTime += (frameTime - _averageFrameTime) * FRAME_TIME_AVERAGE_WEIGHT;
+
+    float oldPixelError = _pixelError;
+    if (_averageFrameTime > _frameTimeBudget * OVER_BUDGET_MARGIN) {
+        _underBudgetSince = 0;
+        if (now - _lastChange >= RAISE_ERROR_INTERVAL) {
+            setPixelError(_pixelError * glm::min(_averageFrameTime / _frameTimeBudget, MAX_RAISE_ERROR_BY));
+        }
+    } else if (_averageFrameTime < _frameTimeBudget * UNDER_BUDGET_MARGIN) {
+        if (_underBudgetSince == 0) {
+            _underBudgetSince = now;
+        }
+        if (now - _underBudgetSince >= LOWER_ERROR_DELAY && now - _lastChange >= LOWER_ERROR_INTERVAL) {
+            setPixelError(_pixelError * LOWER_ERROR_BY);
+        }
+    } else {
+        _underBudgetSince = 0;
+    }
+
+    if (_pixelError == oldPixelError) {
+        return false;
+    }
+    _lastChange = now;
+    return true;
+}
+
+void OctreeLODSelector::reset(quint64 now) {
+    _averageFrameTime = _frameTimeBudget;
+    _sampleCount = 0;
+    _lastChange = now;
+    _underBudgetSince = 0;
+}
@@ -0,0 +1,64 @@
+//
+//  OctreeLODSelector.h
+//  libraries/octree/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#ifndef hifi_OctreeLODSelector_h
+#define hifi_OctreeLODSelector_h
+
+#include <QtCore/QtGlobal>
+
+/// the largest a voxel can be on screen, in pixels, before its children are drawn in its place
+const float DEFAULT_LOD_PIXEL_ERROR = 3.0f;
+const float MIN_LOD_PIXEL_ERROR = 0.5f;
+const float MAX_LOD_PIXEL_ERROR = 64.0f;
+
+const float DEFAULT_LOD_FRAME_TIME_BUDGET = 1000000.0f / 60.0f;
+
+/// Picks the octree size scale, which sets how far away each level of detail is drawn, from the screen space error it
+/// will accept: the size in pixels that an element reaches just before its children are drawn in its place. The same
+/// error gives a different size scale for a different field of view or viewport, so that the detail follows what can
+/// be seen. The error is raised as soon as frames take longer than the budget, and lowered slowly once they have come in
+/// well under it for a while. In between is a band where it's left alone, so that the detail doesn't hunt back and
+/// forth around the budget.
+class OctreeLODSelector {
+public:
+    OctreeLODSelector();
+
+    /// the time we'd like frames to take, in microseconds
+    void setFrameTimeBudget(float frameTimeBudget) { _frameTimeBudget = frameTimeBudget; }
+    float getFrameTimeBudget() const { return _frameTimeBudget; }
+
+    void setPixelError(float pixelError);
+    float getPixelError() const { return _pixelError; }
+
+    /// the size scale that gives our pixel error in a view with a vertical field of view in degrees that's a number of
+    /// pixels high
+    float getSizeScale(float fieldOfView, float viewportHeight) const;
+
+    /// sets the pixel error to the one that a size scale gives in a view
+    void setSizeScale(float sizeScale, float fieldOfView, float viewportHeight);
+
+    /// takes the time the last frame took in microseconds, returns true if the pixel error changed
+    bool update(float frameTime, quint64 now);
+
+    /// forgets the frame times so far, as when frames weren't being drawn as usual
+    void reset(quint64 now);
+
+    float getAverageFrameTime() const { return _averageFrameTime; }
+
+private:
+    float _frameTimeBudget;
+    float _pixelError;
+    float _averageFrameTime;
+    int _sampleCount;
+    quint64 _lastChange;
+    quint64 _underBudgetSince;
+};
+
+#endif // hifi_OctreeLODSelector_h
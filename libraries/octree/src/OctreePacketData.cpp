@@ -10,7 +10,12 @@
 //
 
 #include <PerfStat.h>
+
 #include "OctreePacketData.h"
+#include "OctreePacketDictionary.h"
+
+const float COMPRESSION_RATIO_SMOOTHING = 0.25f;
+const int MINIMUM_CONTENT_FOR_COMPRESSION_RATIO = 256;
 
 bool OctreePacketData::_debug = false;
 quint64 OctreePacketData::_totalBytesOfOctalCodes = 0;
@@ -22,7 +27,9 @@ quint64 OctreePacketData::_totalBytesOfRawData = 0;
 
 
 
-OctreePacketData::OctreePacketData(bool enableCompression, int targetSize) {
+OctreePacketData::OctreePacketData(bool enableCompression, int targetSize) :
+    _compressionRatio(1.0f)
+{
     changeSettings(enableCompression, targetSize); // does reset...
 }
 
@@ -148,6 +155,10 @@ int OctreePacketData::getFinalizedSize() {
 }
 
 
+float OctreePacketData::getExpectedCompressionRatio() const {
+    return std::max(1.0f, _compressionRatio * COMPRESSION_RATIO_MARGIN);
+}
+
 void OctreePacketData::endSubTree() {
     _subTreeAt = _bytesInUse;
 }
@@ -364,21 +375,21 @@ bool OctreePacketData::compressContent() {
     _bytesInUseLastCheck = _bytesInUse;
 
     bool success = false;
-    const int MAX_COMPRESSION = 9;
 
     // we only want to compress the data payload, not the message header
-    const uchar* uncompressedData = &_uncompressed[0];
-    int uncompressedSize = _bytesInUse;
-
-    QByteArray compressedData = qCompress(uncompressedData, uncompressedSize, MAX_COMPRESSION);
-
-    if (compressedData.size() < (int)MAX_OCTREE_PACKET_DATA_SIZE) {
-        _compressedBytes = compressedData.size();
-        for (int i = 0; i < _compressedBytes; i++) {
-            _compressed[i] = compressedData[i];
-        }
+    int compressedBytes = OctreePacketDictionary::compress(&_uncompressed[0], _bytesInUse,
+                                                           &_compressed[0], MAX_OCTREE_PACKET_DATA_SIZE);
+    if (compressedBytes > 0) {
+        _compressedBytes = compressedBytes;
         _dirty = false;
         success = true;
+
+        // too little content compresses worse than a full section would, and would drag the ratio down
+        if (_bytesInUse >= MINIMUM_CONTENT_FOR_COMPRESSION_RATIO) {
+            float ratio = (float)_bytesInUse / (float)_compressedBytes;
+            _compressionRatio = _compressionRatio * (1.0f - COMPRESSION_RATIO_SMOOTHING)
+                    + ratio * COMPRESSION_RATIO_SMOOTHING;
+        }
     }
     return success;
 }
@@ -390,20 +401,12 @@ void OctreePacketData::loadFinalizedContent(const unsigned char* data, int lengt
     if (data && length > 0) {
 
         if (_enableCompression) {
-            QByteArray compressedData;
-            for (int i = 0; i < length; i++) {
-                compressedData[i] = data[i];
-                _compressed[i] = compressedData[i];
-            }
+            memcpy(&_compressed[0], data, length);
             _compressedBytes = length;
-            QByteArray uncompressedData = qUncompress(compressedData);
-            if (uncompressedData.size() <= _bytesAvailable) {
-                _bytesInUse = uncompressedData.size();
-                _bytesAvailable -= uncompressedData.size();
-
-                for (int i = 0; i < _bytesInUse; i++) {
-                    _uncompressed[i] = uncompressedData[i];
-                }
+            int uncompressedBytes = OctreePacketDictionary::decompress(data, length, &_uncompressed[0], _bytesAvailable);
+            if (uncompressedBytes > 0) {
+                _bytesInUse = uncompressedBytes;
+                _bytesAvailable -= uncompressedBytes;
             }
         } else {
             for (int i = 0; i < length; i++) {
@@ -42,9 +42,13 @@ const unsigned int MAX_OCTREE_PACKET_DATA_SIZE = MAX_PACKET_SIZE - (MAX_PACKET_H
 const unsigned int MAX_OCTREE_UNCOMRESSED_PACKET_SIZE = MAX_OCTREE_PACKET_DATA_SIZE;
 
 const unsigned int MINIMUM_ATTEMPT_MORE_PACKING = sizeof(OCTREE_PACKET_INTERNAL_SECTION_SIZE) + 40;
-const unsigned int COMPRESS_PADDING = 15;
+// a zstd frame around a section that doesn't compress adds its frame and block headers
+const unsigned int COMPRESS_PADDING = 10;
 const int REASONABLE_NUMBER_OF_PACKING_ATTEMPTS = 5;
 
+// how much of the recently seen compression ratio to count on when sizing a section to fill the rest of a packet
+const float COMPRESSION_RATIO_MARGIN = 0.8f;
+
 const int PACKET_IS_COLOR_BIT = 0;
 const int PACKET_IS_COMPRESSED_BIT = 1;
 
@@ -168,12 +172,16 @@ public:
     /// load finalized content to allow access to decoded content for parsing
     void loadFinalizedContent(const unsigned char* data, int length);
     
-    /// returns whether or not zlib compression enabled on finalization
+    /// returns whether or not dictionary compression enabled on finalization
     bool isCompressed() const { return _enableCompression; }
     
     /// returns the target uncompressed size
     unsigned int getTargetSize() const { return _targetSize; }
 
+    /// returns how many uncompressed bytes to expect per byte of finalized data, from the content recently finalized by
+    /// this packet data. Kept across resets, so a sender can size its next section to fill the space it has left.
+    float getExpectedCompressionRatio() const;
+
     /// displays contents for debugging
     void debugContent();
     
@@ -202,6 +210,7 @@ private:
     
     unsigned char _compressed[MAX_OCTREE_UNCOMRESSED_PACKET_SIZE];
     int _compressedBytes;
+    float _compressionRatio;
     int _bytesInUseLastCheck;
     bool _dirty;
 
@@ -0,0 +1,130 @@
+//
+//  OctreePacketDictionary.cpp
+//  libraries/octree/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#include <QtCore/QMutex>
+#include <QtCore/QMutexLocker>
+#include <QtCore/QThreadStorage>
+#include <QtCore/QVector>
+
+#include <zstd.h>
+
+#include <OctalCode.h>
+
+#include "OctreeConstants.h"
+
+#include "OctreePacketDictionary.h"
+
+// the deepest level whose octal codes are all in the dictionary, the codes for deeper levels are mostly unique
+const int MAX_DICTIONARY_CODE_LEVEL = 3;
+const int DICTIONARY_RUN_LENGTH = 64;
+
+QByteArray OctreePacketDictionary::getContent() {
+    QByteArray content;
+
+    // the bytes of empty and default properties, and of full and empty child masks. zstd finds the content at the end
+    // of the dictionary more cheaply than the content at the start, so the most common content goes last.
+    content.append(QByteArray(DICTIONARY_RUN_LENGTH, (char)0xff));
+    content.append(QByteArray(DICTIONARY_RUN_LENGTH, (char)0x00));
+
+    // every section starts with the octal code of its subtree's root, followed by child masks for its children
+    QVector<QVector<unsigned char*> > levels(MAX_DICTIONARY_CODE_LEVEL + 1);
+    levels[0].append(NULL);
+    for (int depth = 1; depth <= MAX_DICTIONARY_CODE_LEVEL; depth++) {
+        foreach (const unsigned char* parent, levels.at(depth - 1)) {
+            for (int i = 0; i < NUMBER_OF_CHILDREN; i++) {
+                levels[depth].append(childOctalCode(parent, i));
+            }
+        }
+    }
+
+    // deepest first, so that the codes nearest the root, which are in the most sections, are nearest the end
+    for (int depth = MAX_DICTIONARY_CODE_LEVEL; depth > 0; depth--) {
+        foreach (unsigned char* code, levels.at(depth)) {
+            content.append((const char*)code, (int)bytesRequiredForCodeLength(numberOfThreeBitSectionsInCode(code)));
+            content.append((char)0xff);
+            delete[] code;
+        }
+    }
+
+    // the root's own code is a single zero
+    content.append((char)0x00);
+    content.append((char)0xff);
+    return content;
+}
+
+class DictionaryHolder {
+public:
+    DictionaryHolder() :
+        _compressionDictionary(NULL),
+        _decompressionDictionary(NULL) {
+        QByteArray content = OctreePacketDictionary::getContent();
+        _compressionDictionary = ZSTD_createCDict(content.constData(), content.size(), OCTREE_PACKET_COMPRESSION_LEVEL);
+        _decompressionDictionary = ZSTD_createDDict(content.constData(), content.size());
+    }
+    ~DictionaryHolder() {
+        ZSTD_freeCDict(_compressionDictionary);
+        ZSTD_freeDDict(_decompressionDictionary);
+    }
+
+    ZSTD_CDict* _compressionDictionary;
+    ZSTD_DDict* _decompressionDictionary;
+};
+
+// the dictionaries are read only once made, so one pair is shared by all threads
+static DictionaryHolder* getDictionaries() {
+    static QMutex mutex;
+    static DictionaryHolder* dictionaries = NULL;
+    QMutexLocker locker(&mutex);
+    if (!dictionaries) {
+        dictionaries = new DictionaryHolder();
+    }
+    return dictionaries;
+}
+
+class ThreadContexts {
+public:
+    ThreadContexts() :
+        _dictionaries(getDictionaries()),
+        _compressionContext(ZSTD_createCCtx()),
+        _decompressionContext(ZSTD_createDCtx()) {
+    }
+    ~ThreadContexts() {
+        ZSTD_freeCCtx(_compressionContext);
+        ZSTD_freeDCtx(_decompressionContext);
+    }
+
+    DictionaryHolder* _dictionaries;
+    ZSTD_CCtx* _compressionContext;
+    ZSTD_DCtx* _decompressionContext;
+};
+
+static ThreadContexts* getThreadContexts() {
+    static QThreadStorage<ThreadContexts*> contexts;
+    if (!contexts.hasLocalData()) {
+        contexts.setLocalData(new ThreadContexts());
+    }
+    return contexts.localData();
+}
+
+int OctreePacketDictionary::compress(const unsigned char* source, int sourceSize,
+                                     unsigned char* destination, int destinationSize) {
+    ThreadContexts* contexts = getThreadContexts();
+    size_t result = ZSTD_compress_usingCDict(contexts->_compressionContext, destination, destinationSize,
+                                             source, sourceSize, contexts->_dictionaries->_compressionDictionary);
+    return ZSTD_isError(result) ? -1 : (int)result;
+}
+
+int OctreePacketDictionary::decompress(const unsigned char* source, int sourceSize,
+                                       unsigned char* destination, int destinationSize) {
+    ThreadContexts* contexts = getThreadContexts();
+    size_t result = ZSTD_decompress_usingDDict(contexts->_decompressionContext, destination, destinationSize,
+                                               source, sourceSize, contexts->_dictionaries->_decompressionDictionary);
+    return ZSTD_isError(result) ? -1 : (int)result;
+}
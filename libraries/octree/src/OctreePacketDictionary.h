@@ -0,0 +1,39 @@
+//
+//  OctreePacketDictionary.h
+//  libraries/octree/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#ifndef hifi_OctreePacketDictionary_h
+#define hifi_OctreePacketDictionary_h
+
+#include <QtCore/QByteArray>
+
+/// Changing the dictionary content changes what's on the wire, so bump this and the versions of the octree data
+/// packet types in PacketHeaders.cpp together.
+const int OCTREE_PACKET_DICTIONARY_VERSION = 1;
+
+const int OCTREE_PACKET_COMPRESSION_LEVEL = 3;
+
+/// Compresses and decompresses the sections of octree data packets with zstd, primed by a dictionary of the content
+/// those sections are made of. A section is at most a packet's worth of bytes, which is too little for a compressor
+/// to learn much from on its own, so the dictionary does most of the work. The server and client build the same
+/// dictionary, so nothing but the compressed section goes over the wire. Safe to use from several threads at once,
+/// each thread gets its own compression contexts.
+class OctreePacketDictionary {
+public:
+    /// compresses source into destination, returns the compressed size or -1 if it didn't fit in destinationSize
+    static int compress(const unsigned char* source, int sourceSize, unsigned char* destination, int destinationSize);
+
+    /// decompresses source into destination, returns the decompressed size or -1 if it was corrupt or didn't fit
+    static int decompress(const unsigned char* source, int sourceSize, unsigned char* destination, int destinationSize);
+
+    /// the raw content of the dictionary
+    static QByteArray getContent();
+};
+
+#endif // hifi_OctreePacketDictionary_h
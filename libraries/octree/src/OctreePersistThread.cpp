@@ -10,64 +10,61 @@
 //
 
 #include <QDebug>
+#include <QFile>
 #include <PerfStat.h>
 #include <SharedUtil.h>
 
 #include "OctreePersistThread.h"
 
+// how long the tree is kept locked while the file is read into it, before the senders get a turn
+const quint64 MAX_LOAD_SLICE_USECS = 50 * 1000;
+
+// the slices handed to the loading threads at once, enough for each to have a run of them under its child of the root
+const int LOAD_SLICES_PER_THREAD = 32;
+
+// with the edits kept in the journal the whole tree is only saved every so many persist intervals, or once the
+// journal has grown to the point that replaying it would slow the next start down
+const int PERSIST_INTERVALS_PER_SAVE = 10;
+const qint64 MAX_JOURNAL_BYTES = 16 * 1024 * 1024;
+
 OctreePersistThread::OctreePersistThread(Octree* tree, const QString& filename, int persistInterval) :
     _tree(tree),
     _filename(filename),
     _persistInterval(persistInterval),
     _initialLoadComplete(false),
+    _readyToServe(false),
+    _reader(tree),
+    _loadThreads(),
+    _loadStarted(0),
+    _journal(filename),
     _loadTimeUSecs(0) 
 {
+    // the edits that come in while the file loads are kept too
+    _journal.open();
 }
 
 bool OctreePersistThread::process() {
 
     if (!_initialLoadComplete) {
-        quint64 loadStarted = usecTimestampNow();
-        qDebug() << "loading Octrees from file: " << _filename << "...";
-
-        bool persistantFileRead;
-
-        _tree->lockForWrite();
-        {
-            PerformanceWarning warn(true, "Loading Octree File", true);
-            persistantFileRead = _tree->readFromSVOFile(_filename.toLocal8Bit().constData());
+        if (_loadStarted == 0) {
+            _loadStarted = usecTimestampNow();
+            qDebug() << "loading Octrees from file: " << _filename << "...";
+            if (!_reader.open(_filename)) {
+                finishLoad(false);
+            }
+        }
+        if (!_initialLoadComplete && loadSlices()) {
+            finishLoad(true);
+        }
+        if (!_initialLoadComplete) {
+            return isStillRunning(); // keep reading the file before doing anything else
         }
-        _tree->unlock();
-
-        quint64 loadDone = usecTimestampNow();
-        _loadTimeUSecs = loadDone - loadStarted;
-
-        _tree->clearDirtyBit(); // the tree is clean since we just loaded it
-        qDebug("DONE loading Octrees from file... fileRead=%s", debug::valueOf(persistantFileRead));
-
-        unsigned long nodeCount = OctreeElement::getNodeCount();
-        unsigned long internalNodeCount = OctreeElement::getInternalNodeCount();
-        unsigned long leafNodeCount = OctreeElement::getLeafNodeCount();
-        qDebug("Nodes after loading scene %lu nodes %lu internal %lu leaves", nodeCount, internalNodeCount, leafNodeCount);
-
-        double usecPerGet = (double)OctreeElement::getGetChildAtIndexTime() / (double)OctreeElement::getGetChildAtIndexCalls();
-        qDebug() << "getChildAtIndexCalls=" << OctreeElement::getGetChildAtIndexCalls()
-                << " getChildAtIndexTime=" << OctreeElement::getGetChildAtIndexTime() << " perGet=" << usecPerGet;
-
-        double usecPerSet = (double)OctreeElement::getSetChildAtIndexTime() / (double)OctreeElement::getSetChildAtIndexCalls();
-        qDebug() << "setChildAtIndexCalls=" << OctreeElement::getSetChildAtIndexCalls()
-                << " setChildAtIndexTime=" << OctreeElement::getSetChildAtIndexTime() << " perset=" << usecPerSet;
-
-        _initialLoadComplete = true;
-        _lastCheck = usecTimestampNow(); // we just loaded, no need to save again
-
-        emit loadCompleted();
     }
 
     if (isStillRunning()) {
         quint64 MSECS_TO_USECS = 1000;
         quint64 USECS_TO_SLEEP = 10 * MSECS_TO_USECS; // every 10ms
-        usleep(USECS_TO_SLEEP);
+        waitFor(USECS_TO_SLEEP);
 
         // do our updates then check to save...
         _tree->update();
@@ -76,16 +73,94 @@ bool OctreePersistThread::process() {
         quint64 sinceLastSave = now - _lastCheck;
         quint64 intervalToCheck = _persistInterval * MSECS_TO_USECS;
 
+        if (_journal.getBytes() > MAX_JOURNAL_BYTES) {
+            intervalToCheck = 0;
+        } else if (_journal.getNumRecorded() > 0) {
+            intervalToCheck *= PERSIST_INTERVALS_PER_SAVE;
+        }
+
         if (sinceLastSave > intervalToCheck) {
             // check the dirty bit and persist here...
             _lastCheck = usecTimestampNow();
             if (_tree->isDirty()) {
-                qDebug() << "saving Octrees to file " << _filename << "...";
-                _tree->writeToSVOFile(_filename.toLocal8Bit().constData());
-                _tree->clearDirtyBit(); // tree is clean after saving
-                qDebug("DONE saving Octrees to file...");
+                persist();
             }
         }
     }
     return isStillRunning();  // keep running till they terminate us
 }
+
+bool OctreePersistThread::loadSlices() {
+    quint64 sliceStarted = usecTimestampNow();
+    _tree->lockForWrite();
+    do {
+        _reader.readNextSlices(LOAD_SLICES_PER_THREAD * _loadThreads.maxThreadCount(), &_loadThreads);
+    } while (!_reader.atEnd() && usecTimestampNow() - sliceStarted < MAX_LOAD_SLICE_USECS);
+    _tree->unlock();
+
+    // with an index the rest of the file streams in while what's been read is sent, the elements read later being
+    // newer than what the clients have been sent
+    if (_reader.hasIndex() && !_readyToServe) {
+        _readyToServe = true;
+        qDebug() << "serving Octrees while loading the rest of" << _filename;
+    }
+    return _reader.atEnd();
+}
+
+void OctreePersistThread::finishLoad(bool persistantFileRead) {
+    _reader.close();
+
+    quint64 loadDone = usecTimestampNow();
+    _loadTimeUSecs = loadDone - _loadStarted;
+
+    _tree->clearDirtyBit(); // the tree is clean since we just loaded it
+    qDebug("DONE loading Octrees from file... fileRead=%s", debug::valueOf(persistantFileRead));
+
+    // then the edits made since it was saved
+    _tree->lockForWrite();
+    if (_journal.replay(_tree) > 0) {
+        _tree->setDirtyBit();
+    }
+    _tree->unlock();
+
+    unsigned long nodeCount = OctreeElement::getNodeCount();
+    unsigned long internalNodeCount = OctreeElement::getInternalNodeCount();
+    unsigned long leafNodeCount = OctreeElement::getLeafNodeCount();
+    qDebug("Nodes after loading scene %lu nodes %lu internal %lu leaves", nodeCount, internalNodeCount, leafNodeCount);
+
+    double usecPerGet = (double)OctreeElement::getGetChildAtIndexTime() / (double)OctreeElement::getGetChildAtIndexCalls();
+    qDebug() << "getChildAtIndexCalls=" << OctreeElement::getGetChildAtIndexCalls()
+            << " getChildAtIndexTime=" << OctreeElement::getGetChildAtIndexTime() << " perGet=" << usecPerGet;
+
+    double usecPerSet = (double)OctreeElement::getSetChildAtIndexTime() / (double)OctreeElement::getSetChildAtIndexCalls();
+    qDebug() << "setChildAtIndexCalls=" << OctreeElement::getSetChildAtIndexCalls()
+            << " setChildAtIndexTime=" << OctreeElement::getSetChildAtIndexTime() << " perset=" << usecPerSet;
+
+    _initialLoadComplete = true;
+    _lastCheck = usecTimestampNow(); // we just loaded, no need to save again
+
+    emit loadCompleted();
+}
+
+void OctreePersistThread::persist() {
+    qDebug() << "saving Octrees to file " << _filename << "...";
+
+    // the edits from here on go in a fresh journal, and whatever comes in while saving dirties the tree again
+    _journal.startCompaction();
+    _tree->clearDirtyBit();
+
+    // written beside the old file, so that a crash while saving leaves the old file and the journal whole
+    QString savingFilename = _filename + ".saving";
+    _tree->writeToSVOFile(savingFilename.toLocal8Bit().constData());
+
+    QFile::remove(SVOFileReader::getIndexFileName(_filename));
+    QFile::remove(_filename);
+    if (QFile::rename(savingFilename, _filename)) {
+        QFile::rename(SVOFileReader::getIndexFileName(savingFilename), SVOFileReader::getIndexFileName(_filename));
+        _journal.finishCompaction();
+        qDebug("DONE saving Octrees to file...");
+    } else {
+        qDebug() << "Couldn't move" << savingFilename << "to" << _filename;
+        _tree->setDirtyBit();
+    }
+}
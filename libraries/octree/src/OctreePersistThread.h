@@ -17,6 +17,8 @@
 #include <QString>
 #include <GenericThread.h>
 #include "Octree.h"
+#include "OctreeEditJournal.h"
+#include "SVOFileReader.h"
 
 /// Generalized threaded processor for handling received inbound packets.
 class OctreePersistThread : public GenericThread {
@@ -27,8 +29,14 @@ public:
     OctreePersistThread(Octree* tree, const QString& filename, int persistInterval = DEFAULT_PERSIST_INTERVAL);
 
     bool isInitialLoadComplete() const { return _initialLoadComplete; }
+
+    /// whether the tree can be served from, which for a file with an index is as soon as its first slice is read
+    bool isReadyToServe() const { return _initialLoadComplete || _readyToServe; }
     quint64 getLoadElapsedTime() const { return _loadTimeUSecs; }
 
+    /// appends an edit packet that has been applied to the tree to the journal, safe to call from any thread
+    void recordEditPacket(const QByteArray& packet) { _journal.recordEditPacket(packet); }
+
 signals:
     void loadCompleted();
 
@@ -36,10 +44,22 @@ protected:
     /// Implements generic processing behavior for this thread.
     virtual bool process();
 private:
+    /// reads slices of the file for a little while with the tree locked, returns true once it's all read
+    bool loadSlices();
+    void finishLoad(bool persistantFileRead);
+
+    /// saves the tree to a fresh file, which replaces the old one and the journal once it's written
+    void persist();
+
     Octree* _tree;
     QString _filename;
     int _persistInterval;
     bool _initialLoadComplete;
+    bool _readyToServe;
+    SVOFileReader _reader;
+    QThreadPool _loadThreads;
+    quint64 _loadStarted;
+    OctreeEditJournal _journal;
 
     quint64 _loadTimeUSecs;
     quint64 _lastCheck;
@@ -14,6 +14,14 @@
 #include "OctreeConstants.h"
 #include "OctreeQuery.h"
 
+// the resolution of the offsets from the keyframe's camera position sent in place of the position, in meters, and the
+// largest offset that can be sent
+const float CAMERA_POSITION_OFFSET_RESOLUTION = 1.0f / 256.0f;
+const int MAX_CAMERA_POSITION_OFFSET = 32767;
+
+// room for the largest group of fields
+const int MAX_FIELD_GROUP_BYTES = 64;
+
 OctreeQuery::OctreeQuery() :
     NodeData(),
     _cameraPosition(0,0,0),
@@ -28,7 +36,14 @@ OctreeQuery::OctreeQuery() :
     _wantOcclusionCulling(false), // disabled by default
     _wantCompression(false), // disabled by default
     _maxOctreePPS(DEFAULT_MAX_OCTREE_PPS),
-    _octreeElementSizeScale(DEFAULT_OCTREE_SIZE_SCALE)
+    _octreeElementSizeScale(DEFAULT_OCTREE_SIZE_SCALE),
+    _wantBulkSync(false),
+    _bulkSyncBounds(glm::vec3(0.0f, 0.0f, 0.0f), TREE_SCALE),
+    _outgoingSequenceNumber(0),
+    _hasIncomingSequenceNumber(false),
+    _incomingSequenceNumber(0),
+    _hasKeyframe(false),
+    _keyframeToAcknowledge(false)
 {
     
 }
@@ -37,45 +52,71 @@ OctreeQuery::~OctreeQuery() {
     // nothing to do
 }
 
-int OctreeQuery::getBroadcastData(unsigned char* destinationBuffer) {
+int OctreeQuery::getBroadcastData(unsigned char* destinationBuffer, OctreeQueryKeyframe* keyframe) {
     unsigned char* bufferStart = destinationBuffer;
     
-    // TODO: DRY this up to a shared method
-    // that can pack any type given the number of bytes
-    // and return the number of bytes to push the pointer
-    
-    // camera details
-    memcpy(destinationBuffer, &_cameraPosition, sizeof(_cameraPosition));
-    destinationBuffer += sizeof(_cameraPosition);
-    destinationBuffer += packOrientationQuatToBytes(destinationBuffer, _cameraOrientation);
-    destinationBuffer += packFloatAngleToTwoByte(destinationBuffer, _cameraFov);
-    destinationBuffer += packFloatRatioToTwoByte(destinationBuffer, _cameraAspectRatio);
-    destinationBuffer += packClipValueToTwoByte(destinationBuffer, _cameraNearClip);
-    destinationBuffer += packClipValueToTwoByte(destinationBuffer, _cameraFarClip);
-    memcpy(destinationBuffer, &_cameraEyeOffsetPosition, sizeof(_cameraEyeOffsetPosition));
-    destinationBuffer += sizeof(_cameraEyeOffsetPosition);
-
-    // bitMask of less than byte wide items
-    unsigned char bitItems = 0;
-    if (_wantLowResMoving)     { setAtBit(bitItems, WANT_LOW_RES_MOVING_BIT); }
-    if (_wantColor)            { setAtBit(bitItems, WANT_COLOR_AT_BIT); }
-    if (_wantDelta)            { setAtBit(bitItems, WANT_DELTA_AT_BIT); }
-    if (_wantOcclusionCulling) { setAtBit(bitItems, WANT_OCCLUSION_CULLING_BIT); }
-    if (_wantCompression)      { setAtBit(bitItems, WANT_COMPRESSION); }
-
-    *destinationBuffer++ = bitItems;
-
-    // desired Max Octree PPS
-    memcpy(destinationBuffer, &_maxOctreePPS, sizeof(_maxOctreePPS));
-    destinationBuffer += sizeof(_maxOctreePPS);
-
-    // desired voxelSizeScale
-    memcpy(destinationBuffer, &_octreeElementSizeScale, sizeof(_octreeElementSizeScale));
-    destinationBuffer += sizeof(_octreeElementSizeScale);
-
-    // desired boundaryLevelAdjust
-    memcpy(destinationBuffer, &_boundaryLevelAdjust, sizeof(_boundaryLevelAdjust));
-    destinationBuffer += sizeof(_boundaryLevelAdjust);
+    // a keyframe is its own keyframe
+    quint16 sequenceNumber = _outgoingSequenceNumber++;
+    memcpy(destinationBuffer, &sequenceNumber, sizeof(sequenceNumber));
+    destinationBuffer += sizeof(sequenceNumber);
+    memcpy(destinationBuffer, &sequenceNumber, sizeof(sequenceNumber));
+    destinationBuffer += sizeof(sequenceNumber);
+    
+    unsigned char* groupsAt = destinationBuffer++;
+    *groupsAt = 0;
+    for (int group = 0; group < QUERY_FIELD_GROUP_COUNT; group++) {
+        setAtBit(*groupsAt, group);
+        int bytes = packFieldGroup(group, destinationBuffer);
+        if (keyframe) {
+            keyframe->fieldGroups[group] = QByteArray(reinterpret_cast<const char*>(destinationBuffer), bytes);
+        }
+        destinationBuffer += bytes;
+    }
+    if (keyframe) {
+        keyframe->sequenceNumber = sequenceNumber;
+        keyframe->cameraPosition = _cameraPosition;
+    }
+    
+    return destinationBuffer - bufferStart;
+}
+
+int OctreeQuery::getBroadcastChanges(unsigned char* destinationBuffer, const OctreeQueryKeyframe& keyframe) {
+    unsigned char* bufferStart = destinationBuffer;
+    
+    qint16 positionOffset[3];
+    bool positionChanged = false;
+    for (int i = 0; i < 3; i++) {
+        int offset = qRound((_cameraPosition[i] - keyframe.cameraPosition[i]) / CAMERA_POSITION_OFFSET_RESOLUTION);
+        if (qAbs(offset) > MAX_CAMERA_POSITION_OFFSET) {
+            return 0;
+        }
+        positionOffset[i] = offset;
+        positionChanged |= (offset != 0);
+    }
+    
+    quint16 sequenceNumber = _outgoingSequenceNumber++;
+    memcpy(destinationBuffer, &sequenceNumber, sizeof(sequenceNumber));
+    destinationBuffer += sizeof(sequenceNumber);
+    memcpy(destinationBuffer, &keyframe.sequenceNumber, sizeof(keyframe.sequenceNumber));
+    destinationBuffer += sizeof(keyframe.sequenceNumber);
+    
+    unsigned char* groupsAt = destinationBuffer++;
+    *groupsAt = 0;
+    if (positionChanged) {
+        setAtBit(*groupsAt, QUERY_CAMERA_POSITION_FIELDS);
+        memcpy(destinationBuffer, positionOffset, sizeof(positionOffset));
+        destinationBuffer += sizeof(positionOffset);
+    }
+    unsigned char groupBuffer[MAX_FIELD_GROUP_BYTES];
+    for (int group = QUERY_CAMERA_POSITION_FIELDS + 1; group < QUERY_FIELD_GROUP_COUNT; group++) {
+        int bytes = packFieldGroup(group, groupBuffer);
+        const QByteArray& keyframeGroup = keyframe.fieldGroups[group];
+        if (bytes != keyframeGroup.size() || memcmp(groupBuffer, keyframeGroup.constData(), bytes) != 0) {
+            setAtBit(*groupsAt, group);
+            memcpy(destinationBuffer, groupBuffer, bytes);
+            destinationBuffer += bytes;
+        }
+    }
     
     return destinationBuffer - bufferStart;
 }
@@ -89,38 +130,194 @@ int OctreeQuery::parseData(const QByteArray& packet) {
     const unsigned char* startPosition = reinterpret_cast<const unsigned char*>(packet.data());
     const unsigned char* sourceBuffer = startPosition + numBytesPacketHeader;
     
-    // camera details
-    memcpy(&_cameraPosition, sourceBuffer, sizeof(_cameraPosition));
-    sourceBuffer += sizeof(_cameraPosition);
-    sourceBuffer += unpackOrientationQuatFromBytes(sourceBuffer, _cameraOrientation);
-    sourceBuffer += unpackFloatAngleFromTwoByte((uint16_t*) sourceBuffer, &_cameraFov);
-    sourceBuffer += unpackFloatRatioFromTwoByte(sourceBuffer,_cameraAspectRatio);
-    sourceBuffer += unpackClipValueFromTwoByte(sourceBuffer,_cameraNearClip);
-    sourceBuffer += unpackClipValueFromTwoByte(sourceBuffer,_cameraFarClip);
-    memcpy(&_cameraEyeOffsetPosition, sourceBuffer, sizeof(_cameraEyeOffsetPosition));
-    sourceBuffer += sizeof(_cameraEyeOffsetPosition);
-
-    // voxel sending features...
-    unsigned char bitItems = 0;
-    bitItems = (unsigned char)*sourceBuffer++;
-    _wantLowResMoving = oneAtBit(bitItems, WANT_LOW_RES_MOVING_BIT);
-    _wantColor = oneAtBit(bitItems, WANT_COLOR_AT_BIT);
-    _wantDelta = oneAtBit(bitItems, WANT_DELTA_AT_BIT);
-    _wantOcclusionCulling = oneAtBit(bitItems, WANT_OCCLUSION_CULLING_BIT);
-    _wantCompression = oneAtBit(bitItems, WANT_COMPRESSION);
-
-    // desired Max Octree PPS
-    memcpy(&_maxOctreePPS, sourceBuffer, sizeof(_maxOctreePPS));
-    sourceBuffer += sizeof(_maxOctreePPS);
-
-    // desired _octreeElementSizeScale
-    memcpy(&_octreeElementSizeScale, sourceBuffer, sizeof(_octreeElementSizeScale));
-    sourceBuffer += sizeof(_octreeElementSizeScale);
-
-    // desired boundaryLevelAdjust
-    memcpy(&_boundaryLevelAdjust, sourceBuffer, sizeof(_boundaryLevelAdjust));
-    sourceBuffer += sizeof(_boundaryLevelAdjust);
+    quint16 sequenceNumber;
+    memcpy(&sequenceNumber, sourceBuffer, sizeof(sequenceNumber));
+    sourceBuffer += sizeof(sequenceNumber);
+    quint16 keyframeSequenceNumber;
+    memcpy(&keyframeSequenceNumber, sourceBuffer, sizeof(keyframeSequenceNumber));
+    sourceBuffer += sizeof(keyframeSequenceNumber);
+    unsigned char groups = *sourceBuffer++;
+    
+    // a query that arrives after a newer one is out of date, and changes can only be applied to the keyframe we have;
+    // the client sends keyframes until we acknowledge one
+    bool isKeyframe = (sequenceNumber == keyframeSequenceNumber);
+    if ((_hasIncomingSequenceNumber && (qint16)(sequenceNumber - _incomingSequenceNumber) <= 0) ||
+            (!isKeyframe && !(_hasKeyframe && keyframeSequenceNumber == _keyframe.sequenceNumber))) {
+        return packet.size();
+    }
+    _hasIncomingSequenceNumber = true;
+    _incomingSequenceNumber = sequenceNumber;
+    
+    if (isKeyframe) {
+        for (int group = 0; group < QUERY_FIELD_GROUP_COUNT; group++) {
+            int bytes = unpackFieldGroup(group, sourceBuffer);
+            _keyframe.fieldGroups[group] = QByteArray(reinterpret_cast<const char*>(sourceBuffer), bytes);
+            sourceBuffer += bytes;
+        }
+        _keyframe.sequenceNumber = sequenceNumber;
+        _keyframe.cameraPosition = _cameraPosition;
+        _hasKeyframe = true;
+        _keyframeToAcknowledge = true;
+        
+        return sourceBuffer - startPosition;
+    }
+    
+    if (oneAtBit(groups, QUERY_CAMERA_POSITION_FIELDS)) {
+        qint16 positionOffset[3];
+        memcpy(positionOffset, sourceBuffer, sizeof(positionOffset));
+        sourceBuffer += sizeof(positionOffset);
+        glm::vec3 offset(positionOffset[0], positionOffset[1], positionOffset[2]);
+        _cameraPosition = _keyframe.cameraPosition + offset * CAMERA_POSITION_OFFSET_RESOLUTION;
+    } else {
+        _cameraPosition = _keyframe.cameraPosition;
+    }
+    for (int group = QUERY_CAMERA_POSITION_FIELDS + 1; group < QUERY_FIELD_GROUP_COUNT; group++) {
+        if (oneAtBit(groups, group)) {
+            sourceBuffer += unpackFieldGroup(group, sourceBuffer);
+        } else {
+            unpackFieldGroup(group, reinterpret_cast<const unsigned char*>(_keyframe.fieldGroups[group].constData()));
+        }
+    }
+
+    return sourceBuffer - startPosition;
+}
+
+bool OctreeQuery::takeKeyframeToAcknowledge(quint16& sequenceNumber) {
+    if (!_keyframeToAcknowledge) {
+        return false;
+    }
+    sequenceNumber = _keyframe.sequenceNumber;
+    _keyframeToAcknowledge = false;
+    return true;
+}
+
+int OctreeQuery::packFieldGroup(int group, unsigned char* destinationBuffer) const {
+    unsigned char* bufferStart = destinationBuffer;
+    
+    switch (group) {
+        case QUERY_CAMERA_POSITION_FIELDS:
+            memcpy(destinationBuffer, &_cameraPosition, sizeof(_cameraPosition));
+            destinationBuffer += sizeof(_cameraPosition);
+            break;
+            
+        case QUERY_CAMERA_ORIENTATION_FIELDS:
+            destinationBuffer += packOrientationQuatToBytes(destinationBuffer, _cameraOrientation);
+            break;
+            
+        case QUERY_CAMERA_LENS_FIELDS:
+            destinationBuffer += packFloatAngleToTwoByte(destinationBuffer, _cameraFov);
+            destinationBuffer += packFloatRatioToTwoByte(destinationBuffer, _cameraAspectRatio);
+            destinationBuffer += packClipValueToTwoByte(destinationBuffer, _cameraNearClip);
+            destinationBuffer += packClipValueToTwoByte(destinationBuffer, _cameraFarClip);
+            break;
+            
+        case QUERY_CAMERA_EYE_OFFSET_FIELDS:
+            memcpy(destinationBuffer, &_cameraEyeOffsetPosition, sizeof(_cameraEyeOffsetPosition));
+            destinationBuffer += sizeof(_cameraEyeOffsetPosition);
+            break;
+            
+        case QUERY_SENDING_FIELDS: {
+            // bitMask of less than byte wide items
+            unsigned char bitItems = 0;
+            if (_wantLowResMoving)     { setAtBit(bitItems, WANT_LOW_RES_MOVING_BIT); }
+            if (_wantColor)            { setAtBit(bitItems, WANT_COLOR_AT_BIT); }
+            if (_wantDelta)            { setAtBit(bitItems, WANT_DELTA_AT_BIT); }
+            if (_wantOcclusionCulling) { setAtBit(bitItems, WANT_OCCLUSION_CULLING_BIT); }
+            if (_wantCompression)      { setAtBit(bitItems, WANT_COMPRESSION); }
+            if (_wantBulkSync)         { setAtBit(bitItems, WANT_BULK_SYNC_BIT); }
+
+            *destinationBuffer++ = bitItems;
+
+            // desired Max Octree PPS
+            memcpy(destinationBuffer, &_maxOctreePPS, sizeof(_maxOctreePPS));
+            destinationBuffer += sizeof(_maxOctreePPS);
+
+            // desired voxelSizeScale
+            memcpy(destinationBuffer, &_octreeElementSizeScale, sizeof(_octreeElementSizeScale));
+            destinationBuffer += sizeof(_octreeElementSizeScale);
+
+            // desired boundaryLevelAdjust
+            memcpy(destinationBuffer, &_boundaryLevelAdjust, sizeof(_boundaryLevelAdjust));
+            destinationBuffer += sizeof(_boundaryLevelAdjust);
+
+            // the bulk sync bounds, only if a bulk sync is wanted
+            if (_wantBulkSync) {
+                glm::vec3 corner = _bulkSyncBounds.getCorner();
+                float scale = _bulkSyncBounds.getScale();
+                memcpy(destinationBuffer, &corner, sizeof(corner));
+                destinationBuffer += sizeof(corner);
+                memcpy(destinationBuffer, &scale, sizeof(scale));
+                destinationBuffer += sizeof(scale);
+            }
+            break;
+        }
+    }
+    
+    return destinationBuffer - bufferStart;
+}
+
+int OctreeQuery::unpackFieldGroup(int group, const unsigned char* sourceBuffer) {
+    const unsigned char* startPosition = sourceBuffer;
+    
+    switch (group) {
+        case QUERY_CAMERA_POSITION_FIELDS:
+            memcpy(&_cameraPosition, sourceBuffer, sizeof(_cameraPosition));
+            sourceBuffer += sizeof(_cameraPosition);
+            break;
+            
+        case QUERY_CAMERA_ORIENTATION_FIELDS:
+            sourceBuffer += unpackOrientationQuatFromBytes(sourceBuffer, _cameraOrientation);
+            break;
+            
+        case QUERY_CAMERA_LENS_FIELDS:
+            sourceBuffer += unpackFloatAngleFromTwoByte((uint16_t*) sourceBuffer, &_cameraFov);
+            sourceBuffer += unpackFloatRatioFromTwoByte(sourceBuffer,_cameraAspectRatio);
+            sourceBuffer += unpackClipValueFromTwoByte(sourceBuffer,_cameraNearClip);
+            sourceBuffer += unpackClipValueFromTwoByte(sourceBuffer,_cameraFarClip);
+            break;
+            
+        case QUERY_CAMERA_EYE_OFFSET_FIELDS:
+            memcpy(&_cameraEyeOffsetPosition, sourceBuffer, sizeof(_cameraEyeOffsetPosition));
+            sourceBuffer += sizeof(_cameraEyeOffsetPosition);
+            break;
+            
+        case QUERY_SENDING_FIELDS: {
+            // voxel sending features...
+            unsigned char bitItems = 0;
+            bitItems = (unsigned char)*sourceBuffer++;
+            _wantLowResMoving = oneAtBit(bitItems, WANT_LOW_RES_MOVING_BIT);
+            _wantColor = oneAtBit(bitItems, WANT_COLOR_AT_BIT);
+            _wantDelta = oneAtBit(bitItems, WANT_DELTA_AT_BIT);
+            _wantOcclusionCulling = oneAtBit(bitItems, WANT_OCCLUSION_CULLING_BIT);
+            _wantCompression = oneAtBit(bitItems, WANT_COMPRESSION);
+            _wantBulkSync = oneAtBit(bitItems, WANT_BULK_SYNC_BIT);
 
+            // desired Max Octree PPS
+            memcpy(&_maxOctreePPS, sourceBuffer, sizeof(_maxOctreePPS));
+            sourceBuffer += sizeof(_maxOctreePPS);
+
+            // desired _octreeElementSizeScale
+            memcpy(&_octreeElementSizeScale, sourceBuffer, sizeof(_octreeElementSizeScale));
+            sourceBuffer += sizeof(_octreeElementSizeScale);
+
+            // desired boundaryLevelAdjust
+            memcpy(&_boundaryLevelAdjust, sourceBuffer, sizeof(_boundaryLevelAdjust));
+            sourceBuffer += sizeof(_boundaryLevelAdjust);
+
+            // the bulk sync bounds, only if a bulk sync is wanted
+            if (_wantBulkSync) {
+                glm::vec3 corner;
+                float scale;
+                memcpy(&corner, sourceBuffer, sizeof(corner));
+                sourceBuffer += sizeof(corner);
+                memcpy(&scale, sourceBuffer, sizeof(scale));
+                sourceBuffer += sizeof(scale);
+                _bulkSyncBounds.setBox(corner, scale);
+            }
+            break;
+        }
+    }
+    
     return sourceBuffer - startPosition;
 }
 
@@ -129,3 +326,29 @@ glm::vec3 OctreeQuery::calculateCameraDirection() const {
     return direction;
 }
 
+
+OctreeQueryChannel::OctreeQueryChannel() :
+    _hasKeyframe(false),
+    _hasPendingKeyframe(false) {
+}
+
+int OctreeQueryChannel::writeQuery(OctreeQuery& query, unsigned char* destinationBuffer, bool forceKeyframe) {
+    // while a keyframe is waiting to be acknowledged, the server may have it in place of the one we have
+    if (_hasKeyframe && !_hasPendingKeyframe && !forceKeyframe) {
+        int bytes = query.getBroadcastChanges(destinationBuffer, _keyframe);
+        if (bytes != 0) {
+            return bytes;
+        }
+    }
+    _hasPendingKeyframe = true;
+    return query.getBroadcastData(destinationBuffer, &_pendingKeyframe);
+}
+
+void OctreeQueryChannel::keyframeAcknowledged(quint16 sequenceNumber) {
+    // the acknowledgements of older keyframes are ignored, since the server goes on to the newer one
+    if (_hasPendingKeyframe && sequenceNumber == _pendingKeyframe.sequenceNumber) {
+        _keyframe = _pendingKeyframe;
+        _hasKeyframe = true;
+        _hasPendingKeyframe = false;
+    }
+}
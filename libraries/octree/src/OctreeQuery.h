@@ -31,6 +31,9 @@ typedef unsigned long long quint64;
 #include <glm/glm.hpp>
 #include <glm/gtc/quaternion.hpp>
 
+#include <QByteArray>
+
+#include <AACube.h>
 #include <NodeData.h>
 
 // First bitset
@@ -39,6 +42,24 @@ const int WANT_COLOR_AT_BIT = 1;
 const int WANT_DELTA_AT_BIT = 2;
 const int WANT_OCCLUSION_CULLING_BIT = 3;
 const int WANT_COMPRESSION = 4; // 5th bit
+const int WANT_BULK_SYNC_BIT = 5; // 6th bit, the bulk sync bounds follow the boundaryLevelAdjust
+
+// the groups of fields a query is written in; one written as changes leaves out those the same as its keyframe's
+const int QUERY_CAMERA_POSITION_FIELDS = 0;
+const int QUERY_CAMERA_ORIENTATION_FIELDS = 1;
+const int QUERY_CAMERA_LENS_FIELDS = 2;
+const int QUERY_CAMERA_EYE_OFFSET_FIELDS = 3;
+const int QUERY_SENDING_FIELDS = 4;
+const int QUERY_FIELD_GROUP_COUNT = 5;
+
+/// A query as it was written complete in itself, which the queries after it can be written as changes to once the
+/// server has it.
+class OctreeQueryKeyframe {
+public:
+    quint16 sequenceNumber;
+    glm::vec3 cameraPosition;
+    QByteArray fieldGroups[QUERY_FIELD_GROUP_COUNT];
+};
 
 class OctreeQuery : public NodeData {
     Q_OBJECT
@@ -47,9 +68,20 @@ public:
     OctreeQuery();
     virtual ~OctreeQuery();
 
-    int getBroadcastData(unsigned char* destinationBuffer);
+    /// writes the query complete in itself, as a keyframe, and copies what was written to keyframe if one is given
+    int getBroadcastData(unsigned char* destinationBuffer, OctreeQueryKeyframe* keyframe = NULL);
+
+    /// writes only the groups of fields that have changed since the keyframe, the camera position as a quantized offset
+    /// from the keyframe's; returns zero without writing anything if the camera is too far from it for that
+    int getBroadcastChanges(unsigned char* destinationBuffer, const OctreeQueryKeyframe& keyframe);
+
+    /// reads a query, ignoring those older than the last read and changes to a keyframe other than the last read
     int parseData(const QByteArray& packet);
 
+    /// if a keyframe has been read since the last call, returns true with its sequence number, for the server to
+    /// acknowledge it
+    bool takeKeyframeToAcknowledge(quint16& sequenceNumber);
+
     // getters for camera details
     const glm::vec3& getCameraPosition() const { return _cameraPosition; }
     const glm::quat& getCameraOrientation() const { return _cameraOrientation; }
@@ -79,6 +111,8 @@ public:
     int getMaxOctreePacketsPerSecond() const { return _maxOctreePPS; }
     float getOctreeSizeScale() const { return _octreeElementSizeScale; }
     int getBoundaryLevelAdjust() const { return _boundaryLevelAdjust; }
+    bool getWantBulkSync() const { return _wantBulkSync; }
+    const AACube& getBulkSyncBounds() const { return _bulkSyncBounds; }
 
 public slots:
     void setWantLowResMoving(bool wantLowResMoving) { _wantLowResMoving = wantLowResMoving; }
@@ -89,6 +123,8 @@ public slots:
     void setMaxOctreePacketsPerSecond(int maxOctreePPS) { _maxOctreePPS = maxOctreePPS; }
     void setOctreeSizeScale(float octreeSizeScale) { _octreeElementSizeScale = octreeSizeScale; }
     void setBoundaryLevelAdjust(int boundaryLevelAdjust) { _boundaryLevelAdjust = boundaryLevelAdjust; }
+    void setWantBulkSync(bool wantBulkSync) { _wantBulkSync = wantBulkSync; }
+    void setBulkSyncBounds(const AACube& bulkSyncBounds) { _bulkSyncBounds = bulkSyncBounds; }
 
 protected:
     // camera details for the avatar
@@ -110,10 +146,47 @@ protected:
     float _octreeElementSizeScale; /// used for LOD calculations
     int _boundaryLevelAdjust; /// used for LOD calculations
 
+    /// in place of the view, everything in the bounds is sent at full detail and as fast as the server can, then only
+    /// what changes in them
+    bool _wantBulkSync;
+    AACube _bulkSyncBounds; /// in meters
+
 private:
     // privatize the copy constructor and assignment operator so they cannot be called
     OctreeQuery(const OctreeQuery&);
     OctreeQuery& operator= (const OctreeQuery&);
+
+    int packFieldGroup(int group, unsigned char* destinationBuffer) const;
+    int unpackFieldGroup(int group, const unsigned char* sourceBuffer);
+
+    quint16 _outgoingSequenceNumber;
+
+    // the state of the queries read, on the server
+    bool _hasIncomingSequenceNumber;
+    quint16 _incomingSequenceNumber;
+    bool _hasKeyframe;
+    OctreeQueryKeyframe _keyframe;
+    bool _keyframeToAcknowledge;
+};
+
+/// The queries sent to a single server. Until the server acknowledges a keyframe, each query is sent as a keyframe;
+/// after that they're sent as changes to the acknowledged one, until the camera moves too far from it or a new one is
+/// forced.
+class OctreeQueryChannel {
+public:
+    OctreeQueryChannel();
+
+    /// writes the query for the server; forcing a keyframe covers the server having lost the one acknowledged
+    int writeQuery(OctreeQuery& query, unsigned char* destinationBuffer, bool forceKeyframe = false);
+
+    /// called with the sequence number the server acknowledged a keyframe with
+    void keyframeAcknowledged(quint16 sequenceNumber);
+
+private:
+    bool _hasKeyframe;
+    OctreeQueryKeyframe _keyframe;
+    bool _hasPendingKeyframe;
+    OctreeQueryKeyframe _pendingKeyframe; /// the newest keyframe sent, which the server keeps in place of older ones
 };
 
 #endif // hifi_OctreeQuery_h
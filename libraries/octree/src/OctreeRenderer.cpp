@@ -159,7 +159,8 @@ void OctreeRenderer::render(RenderMode renderMode) {
     RenderArgs args = { this, _viewFrustum, getSizeScale(), getBoundaryLevelAdjust(), renderMode, 0, 0, 0 };
     if (_tree) {
         _tree->lockForRead();
-        _tree->recurseTreeWithOperation(renderOperation, &args);
+        OctreeOperationVisitor<renderOperation> visitor(&args);
+        _tree->visitTree<OctreeElement>(visitor);
         _tree->unlock();
     }
 }
@@ -13,6 +13,7 @@
 #include <QString>
 #include <QStringList>
 
+#include <CycleCounter.h>
 #include <PacketHeaders.h>
 #include <SharedUtil.h>
 
@@ -36,6 +37,9 @@ OctreeSceneStats::OctreeSceneStats() :
     _incomingBytes(0),
     _incomingWastedBytes(0),
     _incomingOctreeSequenceNumberStats(),
+    _lastIncomingSentTime(0),
+    _lastIncomingArrivalTime(0),
+    _incomingPacketsAtLastAck(0),
     _incomingFlightTimeAverage(samples),
     _jurisdictionRoot(NULL)
 {
@@ -56,6 +60,7 @@ OctreeSceneStats& OctreeSceneStats::operator=(const OctreeSceneStats& other) {
 
 void OctreeSceneStats::copyFromOther(const OctreeSceneStats& other) {
     _totalEncodeTime = other._totalEncodeTime;
+    _totalEncodeCycles = other._totalEncodeCycles;
     _elapsed = other._elapsed;
     _lastFullElapsed = other._lastFullElapsed;
     _lastFullTotalEncodeTime = other._lastFullTotalEncodeTime;
@@ -141,6 +146,9 @@ void OctreeSceneStats::copyFromOther(const OctreeSceneStats& other) {
     _incomingWastedBytes = other._incomingWastedBytes;
 
     _incomingOctreeSequenceNumberStats = other._incomingOctreeSequenceNumberStats;
+    _lastIncomingSentTime = other._lastIncomingSentTime;
+    _lastIncomingArrivalTime = other._lastIncomingArrivalTime;
+    _incomingPacketsAtLastAck = other._incomingPacketsAtLastAck;
 }
 
 
@@ -212,15 +220,18 @@ void OctreeSceneStats::sceneCompleted() {
 }
 
 void OctreeSceneStats::encodeStarted() {
-    _encodeStart = usecTimestampNow();
+    _encodeStart = cycleCounterNow();
 }
 
 void OctreeSceneStats::encodeStopped() {
-    _totalEncodeTime += (usecTimestampNow() - _encodeStart);
+    // the passes are summed in cycles, which are converted once, since a pass often takes less than a usec
+    _totalEncodeCycles += cycleCounterNow() - _encodeStart;
+    _totalEncodeTime = (quint64)cycleCountsToUsecs(_totalEncodeCycles);
 }
 
 void OctreeSceneStats::reset() {
     _totalEncodeTime = 0;
+    _totalEncodeCycles = 0;
     _encodeStart = 0;
 
     _packets = 0;
@@ -860,6 +871,12 @@ void OctreeSceneStats::trackIncomingOctreePacket(const QByteArray& packet,
     
     _incomingOctreeSequenceNumberStats.sequenceNumberReceived(sequence);
 
+    // a resend carries the time it was first sent, so only the newest packet is timed
+    if (sequence == _incomingOctreeSequenceNumberStats.getLastReceived()) {
+        _lastIncomingSentTime = sentAt;
+        _lastIncomingArrivalTime = arrivedAt;
+    }
+
     // track packets here...
     _incomingPacket++;
     _incomingBytes += packet.size();
@@ -867,3 +884,16 @@ void OctreeSceneStats::trackIncomingOctreePacket(const QByteArray& packet,
         _incomingWastedBytes += (MAX_PACKET_SIZE - packet.size());
     }
 }
+
+bool OctreeSceneStats::makeIncomingOctreeAck(SelectiveAck& ack) {
+    if (_incomingPacket == _incomingPacketsAtLastAck) {
+        return false;
+    }
+    _incomingPacketsAtLastAck = _incomingPacket;
+
+    _incomingOctreeSequenceNumberStats.pruneMissingSet();
+    ack.setNewestSequenceNumber(_incomingOctreeSequenceNumberStats.getLastReceived());
+    ack.setEcho(_lastIncomingSentTime, usecTimestampNow() - _lastIncomingArrivalTime);
+    ack.setMissingSequenceNumbers(_incomingOctreeSequenceNumberStats.getMissingSet());
+    return true;
+}
@@ -17,6 +17,7 @@
 #include <SharedUtil.h>
 #include "JurisdictionMap.h"
 #include "OctreePacketData.h"
+#include "SelectiveAck.h"
 #include "SequenceNumberStats.h"
 
 #define GREENISH  0x40ff40d0
@@ -152,6 +153,7 @@ public:
     quint64 getTotalInternal() const { return _totalInternal; }
     quint64 getTotalLeaves() const { return _totalLeaves; }
     quint64 getTotalEncodeTime() const { return _totalEncodeTime; }
+    quint64 getTraversed() const { return _traversed; }
     quint64 getElapsedTime() const { return _elapsed; }
 
     quint64 getLastFullElapsedTime() const { return _lastFullElapsed; }
@@ -170,6 +172,10 @@ public:
     const SequenceNumberStats& getIncomingOctreeSequenceNumberStats() const { return _incomingOctreeSequenceNumberStats; }
     SequenceNumberStats& getIncomingOctreeSequenceNumberStats() { return _incomingOctreeSequenceNumberStats; }
 
+    /// fills in the ack of the octree packets received from the server, pruning the missing set first, and returns
+    /// false if no packets have come in since the last ack was made
+    bool makeIncomingOctreeAck(SelectiveAck& ack);
+
 private:
 
     void copyFromOther(const OctreeSceneStats& other);
@@ -194,7 +200,8 @@ private:
     SimpleMovingAverage _bitsPerOctreeAverage;
 
     quint64 _totalEncodeTime;
-    quint64 _encodeStart;
+    quint64 _totalEncodeCycles;
+    quint64 _encodeStart; /// in cycleCounterNow() counts
     
     // scene octree related data
     quint64 _totalElements;
@@ -264,6 +271,9 @@ private:
     quint64 _incomingWastedBytes;
 
     SequenceNumberStats _incomingOctreeSequenceNumberStats;
+    OCTREE_PACKET_SENT_TIME _lastIncomingSentTime; /// on the server's clock, which acks echo back
+    quint64 _lastIncomingArrivalTime;
+    quint32 _incomingPacketsAtLastAck;
 
     SimpleMovingAverage _incomingFlightTimeAverage;
     
@@ -60,6 +60,9 @@ public slots:
     /// how many packets are there in the send queue waiting to be sent
     int packetsToSendCount() const { return _packetSender->packetsToSendCount(); }
 
+    /// are more packets waiting than can be sent in a second, scripts making edits should hold off until this is false
+    bool isBackedUp() const { return _packetSender->isBackedUp(); }
+
     /// returns the packets per second send rate of this object over its lifetime
     float getLifetimePPS() const { return _packetSender->getLifetimePPS(); }
 
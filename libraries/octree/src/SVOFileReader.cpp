@@ -0,0 +1,268 @@
+//
+//  SVOFileReader.cpp
+//  libraries/octree/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#include <cstring>
+
+#include <QtCore/QDataStream>
+#include <QtCore/QDebug>
+#include <QtCore/QPair>
+#include <QtCore/QRunnable>
+
+#include <OctalCode.h>
+
+#include "SVOFileReader.h"
+
+const quint32 SVO_INDEX_MAGIC = 0x53564f49; // "SVOI"
+const quint32 SVO_INDEX_VERSION = 1;
+
+// an index with more slices than this is taken to be corrupt
+const quint32 MAX_SVO_INDEX_SLICES = 64 * 1024 * 1024;
+
+/// Reads a run of slices that all fall under one child of the root.
+class SVOSliceReader : public QRunnable {
+public:
+    SVOSliceReader(Octree* tree, const unsigned char* data, PacketVersion version, const OctreeColorPalette* colorPalette) :
+        _tree(tree), _data(data), _version(version), _colorPalette(colorPalette), _slices() { }
+
+    void addSlice(qint64 start, qint64 end) { _slices.append(QPair<qint64, qint64>(start, end)); }
+
+    virtual void run();
+
+private:
+    Octree* _tree;
+    const unsigned char* _data;
+    PacketVersion _version;
+    const OctreeColorPalette* _colorPalette;
+    QVector<QPair<qint64, qint64> > _slices;
+};
+
+void SVOSliceReader::run() {
+    for (int i = 0; i < _slices.size(); i++) {
+        ReadBitstreamToTreeParams args(WANT_COLOR, NO_EXISTS_BITS, NULL, 0, SharedNodePointer(), false, _version);
+        args.colorPalette = _colorPalette;
+        _tree->readBitstreamToTree(_data + _slices.at(i).first, _slices.at(i).second - _slices.at(i).first, args);
+    }
+}
+
+SVOFileReader::SVOFileReader(Octree* tree) :
+    _tree(tree),
+    _file(),
+    _mappedData(NULL),
+    _fileData(),
+    _data(NULL),
+    _dataLength(0),
+    _version(0),
+    _colorPalette(),
+    _hasColorPalette(false),
+    _sliceStarts(),
+    _nextSlice(0)
+{
+}
+
+bool SVOFileReader::open(const QString& fileName) {
+    close();
+
+    _file.setFileName(fileName);
+    if (!_file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+    qDebug() << "Loading file" << fileName << "...";
+
+    _dataLength = _file.size();
+    _mappedData = _file.map(0, _dataLength);
+    if (_mappedData) {
+        _data = _mappedData;
+    } else {
+        // some files, such as resources, can't be mapped
+        _fileData = _file.readAll();
+        _data = (const unsigned char*) _fileData.constData();
+    }
+
+    qint64 headerSize = 0;
+    bool fileOk = false;
+
+    // before reading the file, check to see if this version of the Octree supports file versions
+    if (_tree->getWantSVOfileVersions()) {
+        // if so, read the first byte of the file and see if it matches the expected version code
+        PacketType expectedType = _tree->expectedDataPacketType();
+        PacketType gotType;
+        if (_dataLength >= (qint64) (sizeof(gotType) + sizeof(_version))) {
+            memcpy(&gotType, _data, sizeof(gotType));
+            if (gotType == expectedType) {
+                _version = _data[sizeof(gotType)];
+                if (_tree->canProcessVersion(_version)) {
+                    headerSize = sizeof(gotType) + sizeof(_version);
+                    fileOk = true;
+                    qDebug("SVO file version match. Expected: %d Got: %d",
+                                versionForPacketType(expectedType), _version);
+                } else {
+                    qDebug("SVO file version mismatch. Expected: %d Got: %d",
+                                versionForPacketType(expectedType), _version);
+                }
+            } else {
+                qDebug("SVO file type mismatch. Expected: %c Got: %c", expectedType, gotType);
+            }
+        }
+    } else {
+        fileOk = true; // assume the file is ok
+    }
+
+    if (fileOk && _dataLength >= headerSize + SVO_COLOR_PALETTE_MAGIC_SIZE &&
+            memcmp(_data + headerSize, SVO_COLOR_PALETTE_MAGIC, SVO_COLOR_PALETTE_MAGIC_SIZE) == 0) {
+        headerSize += SVO_COLOR_PALETTE_MAGIC_SIZE;
+        int paletteSize = _colorPalette.readFromBuffer(_data + headerSize, _dataLength - headerSize);
+        if (paletteSize > 0) {
+            headerSize += paletteSize;
+            _hasColorPalette = true;
+            qDebug("SVO file has a palette of %d colors.", _colorPalette.getCount());
+        } else {
+            qDebug("SVO file has a malformed color palette.");
+            fileOk = false;
+        }
+    }
+
+    if (!fileOk) {
+        close();
+        return false;
+    }
+
+    if (!readIndex(fileName, headerSize)) {
+        _sliceStarts.clear();
+        if (_dataLength > headerSize) {
+            _sliceStarts.append(headerSize);
+        }
+    }
+    return true;
+}
+
+void SVOFileReader::close() {
+    if (_mappedData) {
+        _file.unmap(_mappedData);
+        _mappedData = NULL;
+    }
+    _file.close();
+    _fileData.clear();
+    _data = NULL;
+    _dataLength = 0;
+    _version = 0;
+    _colorPalette.clear();
+    _hasColorPalette = false;
+    _sliceStarts.clear();
+    _nextSlice = 0;
+}
+
+int SVOFileReader::getProgress() const {
+    if (atEnd() || _dataLength == 0) {
+        return 100;
+    }
+    return (int) ((100 * _sliceStarts.at(_nextSlice)) / _dataLength);
+}
+
+void SVOFileReader::readNextSlice() {
+    if (!isOpen() || atEnd()) {
+        return;
+    }
+    qint64 sliceStart = _sliceStarts.at(_nextSlice);
+    qint64 sliceEnd = getSliceEnd(_nextSlice);
+    _nextSlice++;
+
+    ReadBitstreamToTreeParams args(WANT_COLOR, NO_EXISTS_BITS, NULL, 0, SharedNodePointer(), false, _version);
+    if (_hasColorPalette) {
+        args.colorPalette = &_colorPalette;
+    }
+    _tree->readBitstreamToTree(_data + sliceStart, sliceEnd - sliceStart, args);
+}
+
+void SVOFileReader::readNextSlices(int maxSlices, QThreadPool* pool) {
+    if (!pool || !_tree->canReadBitstreamsConcurrently()) {
+        for (int i = 0; i < maxSlices && !atEnd(); i++) {
+            readNextSlice();
+        }
+        return;
+    }
+    OctreeElement* root = _tree->getRoot();
+    int lastSlice = qMin(_nextSlice + maxSlices, _sliceStarts.size());
+    while (_nextSlice < lastSlice) {
+        // a slice that starts at the root can reach into any of its children, so it's read on its own
+        if (_data[_sliceStarts.at(_nextSlice)] == 0) {
+            readNextSlice();
+            continue;
+        }
+        SVOSliceReader* readers[NUMBER_OF_CHILDREN] = { NULL };
+        for (; _nextSlice < lastSlice && _data[_sliceStarts.at(_nextSlice)] != 0; _nextSlice++) {
+            int childIndex = branchIndexWithDescendant(root->getOctalCode(), _data + _sliceStarts.at(_nextSlice));
+            if (!readers[childIndex]) {
+                readers[childIndex] = new SVOSliceReader(_tree, _data, _version,
+                    _hasColorPalette ? &_colorPalette : NULL);
+
+                // the children of the root are added here, so that each reader only changes the tree below its own
+                if (!root->getChildAtIndex(childIndex)) {
+                    root->addChildAtIndex(childIndex);
+                }
+            }
+            readers[childIndex]->addSlice(_sliceStarts.at(_nextSlice), getSliceEnd(_nextSlice));
+        }
+        for (int i = 0; i < NUMBER_OF_CHILDREN; i++) {
+            if (readers[i]) {
+                pool->start(readers[i]);
+            }
+        }
+        pool->waitForDone();
+    }
+}
+
+QString SVOFileReader::getIndexFileName(const QString& fileName) {
+    return fileName + ".index";
+}
+
+bool SVOFileReader::writeIndex(const QString& fileName, qint64 fileSize, const QVector<qint64>& sliceStarts) {
+    QFile indexFile(getIndexFileName(fileName));
+    if (!indexFile.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        return false;
+    }
+    QDataStream out(&indexFile);
+    out << SVO_INDEX_MAGIC << SVO_INDEX_VERSION << fileSize << (quint32) sliceStarts.size();
+    foreach (qint64 sliceStart, sliceStarts) {
+        out << sliceStart;
+    }
+    return out.status() == QDataStream::Ok;
+}
+
+bool SVOFileReader::readIndex(const QString& fileName, qint64 headerSize) {
+    QFile indexFile(getIndexFileName(fileName));
+    if (!indexFile.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+    QDataStream in(&indexFile);
+    quint32 magic, version, numSlices;
+    qint64 fileSize;
+    in >> magic >> version >> fileSize >> numSlices;
+
+    // an index left over from an earlier save, or from a save that didn't finish, is of no use
+    if (in.status() != QDataStream::Ok || magic != SVO_INDEX_MAGIC || version != SVO_INDEX_VERSION ||
+            fileSize != _dataLength || numSlices == 0 || numSlices > MAX_SVO_INDEX_SLICES) {
+        return false;
+    }
+    _sliceStarts.clear();
+    _sliceStarts.reserve(numSlices);
+    qint64 previousStart = headerSize - 1;
+    for (quint32 i = 0; i < numSlices; i++) {
+        qint64 sliceStart;
+        in >> sliceStart;
+        if (in.status() != QDataStream::Ok || sliceStart <= previousStart || sliceStart >= _dataLength ||
+                (i == 0 && sliceStart != headerSize)) {
+            qDebug() << "Ignoring the bad index of" << fileName;
+            return false;
+        }
+        _sliceStarts.append(sliceStart);
+        previousStart = sliceStart;
+    }
+    return true;
+}
@@ -0,0 +1,85 @@
+//
+//  SVOFileReader.h
+//  libraries/octree/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#ifndef hifi_SVOFileReader_h
+#define hifi_SVOFileReader_h
+
+#include <QtCore/QByteArray>
+#include <QtCore/QFile>
+#include <QtCore/QString>
+#include <QtCore/QThreadPool>
+#include <QtCore/QVector>
+
+#include "Octree.h"
+#include "OctreeColorPalette.h"
+
+/// Reads an SVO file into a tree a slice at a time, so that the tree can be unlocked in between. The file is mapped into
+/// memory rather than read into a buffer of its own. A file saved by Octree::writeToSVOFile has an index beside it with
+/// the offset of each of the encoded packets it's made of, and each packet is a slice. A file without an index, or with
+/// one that doesn't match it, is read as one slice. A file saved with a color palette has it between the header and the
+/// slices, and the slices' colors are read from it.
+class SVOFileReader {
+public:
+    SVOFileReader(Octree* tree);
+    ~SVOFileReader() { close(); }
+
+    /// maps the file and checks its type and version, returns false if it can't be read into the tree
+    bool open(const QString& fileName);
+    void close();
+
+    bool isOpen() const { return _data != NULL; }
+    bool atEnd() const { return _nextSlice >= _sliceStarts.size(); }
+
+    int getNumSlices() const { return _sliceStarts.size(); }
+    bool hasIndex() const { return _sliceStarts.size() > 1; }
+    bool hasColorPalette() const { return _hasColorPalette; }
+
+    /// how far into the file the slices read so far reach, in percent
+    int getProgress() const;
+
+    /// reads the next slice into the tree, which the caller should have locked for writing
+    void readNextSlice();
+
+    /// reads up to maxSlices slices into the tree, which the caller should have locked for writing. If the tree can
+    /// read bitstreams concurrently, runs of slices under different children of the root are read on the pool's threads
+    void readNextSlices(int maxSlices, QThreadPool* pool);
+
+    /// the name of the index kept beside an SVO file
+    static QString getIndexFileName(const QString& fileName);
+
+    /// writes the index of an SVO file of fileSize bytes, given the offset in the file of each of its packets
+    static bool writeIndex(const QString& fileName, qint64 fileSize, const QVector<qint64>& sliceStarts);
+
+private:
+    // disallow copying of SVOFileReader objects
+    SVOFileReader(const SVOFileReader&);
+    SVOFileReader& operator= (const SVOFileReader&);
+
+    /// reads the slices from the index, returns false if there isn't one for a file of this size with this header
+    bool readIndex(const QString& fileName, qint64 headerSize);
+
+    qint64 getSliceEnd(int slice) const {
+        return (slice + 1 < _sliceStarts.size()) ? _sliceStarts.at(slice + 1) : _dataLength; }
+
+    Octree* _tree;
+    QFile _file;
+    uchar* _mappedData;
+    QByteArray _fileData; /// the whole file, if it couldn't be mapped
+    const unsigned char* _data;
+    qint64 _dataLength;
+    PacketVersion _version;
+    OctreeColorPalette _colorPalette;
+    bool _hasColorPalette;
+
+    QVector<qint64> _sliceStarts; /// the offset in the file of each slice, a slice ends where the next starts
+    int _nextSlice;
+};
+
+#endif // hifi_SVOFileReader_h
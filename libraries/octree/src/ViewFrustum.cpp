@@ -17,6 +17,11 @@
 
 #include <QtCore/QDebug>
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define HIFI_FRUSTUM_SSE2
+#include <emmintrin.h>
+#endif
+
 #include "GeometryUtil.h"
 #include "SharedUtil.h"
 #include "ViewFrustum.h"
@@ -392,6 +397,78 @@ ViewFrustum::location ViewFrustum::cubeInFrustum(const AACube& cube) const {
     return regularResult;
 }
 
+const int NUM_FRUSTUM_PLANES = 6;
+
+void ViewFrustum::childCubesInFrustum(const AACube& cube, unsigned char& insideMask,
+                                      unsigned char& intersectMask) const {
+    // the corner of child i is offset by half the scale along x for bit 2 of i, along y for bit 1 and along z for bit 0,
+    // so the distance from a plane to each child's corner is a sum of terms shared by the children. Bit i of outside
+    // and straddling is set for child i once one of its P vertices is outside a plane, or one of its N vertices
+    float halfScale = cube.getScale() * 0.5f;
+    const glm::vec3& corner = cube.getCorner();
+    int outside = 0;
+    int straddling = 0;
+
+    for (int i = 0; i < NUM_FRUSTUM_PLANES; i++) {
+        const glm::vec3& normal = _planes[i].getNormal();
+        float cornerDistance = _planes[i].distance(corner);
+        float xStep = normal.x * halfScale;
+        float yStep = normal.y * halfScale;
+        float zStep = normal.z * halfScale;
+
+        // how much further along the normal the P and N vertices of a child are than its corner
+        float toVertexP = std::max(xStep, 0.0f) + std::max(yStep, 0.0f) + std::max(zStep, 0.0f);
+        float toVertexN = std::min(xStep, 0.0f) + std::min(yStep, 0.0f) + std::min(zStep, 0.0f);
+
+#ifdef HIFI_FRUSTUM_SSE2
+        // the children without and with the x offset, four to a register
+        __m128 lowCorners = _mm_add_ps(_mm_set1_ps(cornerDistance),
+            _mm_set_ps(yStep + zStep, yStep, zStep, 0.0f));
+        __m128 highCorners = _mm_add_ps(lowCorners, _mm_set1_ps(xStep));
+        __m128 zero = _mm_setzero_ps();
+        __m128 vertexP = _mm_set1_ps(toVertexP);
+        __m128 vertexN = _mm_set1_ps(toVertexN);
+
+        outside |= _mm_movemask_ps(_mm_cmplt_ps(_mm_add_ps(lowCorners, vertexP), zero)) |
+            (_mm_movemask_ps(_mm_cmplt_ps(_mm_add_ps(highCorners, vertexP), zero)) << 4);
+        straddling |= _mm_movemask_ps(_mm_cmplt_ps(_mm_add_ps(lowCorners, vertexN), zero)) |
+            (_mm_movemask_ps(_mm_cmplt_ps(_mm_add_ps(highCorners, vertexN), zero)) << 4);
+#else
+        for (int child = 0; child < NUMBER_OF_CHILDREN; child++) {
+            float childCornerDistance = cornerDistance + ((child & 4) ? xStep : 0.0f) +
+                ((child & 2) ? yStep : 0.0f) + ((child & 1) ? zStep : 0.0f);
+            if (childCornerDistance + toVertexP < 0.0f) {
+                outside |= (1 << child);
+            }
+            if (childCornerDistance + toVertexN < 0.0f) {
+                straddling |= (1 << child);
+            }
+        }
+#endif
+    }
+
+    insideMask = 0;
+    intersectMask = 0;
+    for (int child = 0; child < NUMBER_OF_CHILDREN; child++) {
+        location result = (outside & (1 << child)) ? OUTSIDE : ((straddling & (1 << child)) ? INTERSECT : INSIDE);
+
+        // the keyhole is only tested for the children it could change the answer for, as cubeInFrustum does
+        if (_keyholeRadius >= 0.0f && result != INSIDE) {
+            glm::vec3 childCorner = corner + glm::vec3((child & 4) ? halfScale : 0.0f,
+                (child & 2) ? halfScale : 0.0f, (child & 1) ? halfScale : 0.0f);
+            location keyholeResult = cubeInKeyhole(AACube(childCorner, halfScale));
+            if (keyholeResult == INSIDE || result == OUTSIDE) {
+                result = keyholeResult;
+            }
+        }
+        if (result == INSIDE) {
+            setAtBit(insideMask, child);
+        } else if (result == INTERSECT) {
+            setAtBit(intersectMask, child);
+        }
+    }
+}
+
 bool testMatches(glm::quat lhs, glm::quat rhs, float epsilon = EPSILON) {
     return (fabs(lhs.x - rhs.x) <= epsilon && fabs(lhs.y - rhs.y) <= epsilon && fabs(lhs.z - rhs.z) <= epsilon
             && fabs(lhs.w - rhs.w) <= epsilon);
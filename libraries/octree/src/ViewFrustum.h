@@ -98,6 +98,11 @@ public:
     ViewFrustum::location cubeInFrustum(const AACube& cube) const;
     ViewFrustum::location boxInFrustum(const AABox& box) const;
 
+    /// tests the eight octants of cube against the frustum at once, giving the answer cubeInFrustum would for each,
+    /// up to rounding. Sets the bit of each child (the bit oneAtBit reads for its child index) in insideMask if it's
+    /// INSIDE and in intersectMask if it's INTERSECT, leaving both clear if it's OUTSIDE
+    void childCubesInFrustum(const AACube& cube, unsigned char& insideMask, unsigned char& intersectMask) const;
+
     // some frustum comparisons
     bool matches(const ViewFrustum& compareTo, bool debug = false) const;
     bool matches(const ViewFrustum* compareTo, bool debug = false) const { return matches(*compareTo, debug); }
@@ -81,6 +81,7 @@ Particle::Particle(const ParticleID& particleID, const ParticleProperties& prope
     _lastEdited = now;
     _lastUpdated = now;
     _created = now; // will get updated as appropriate in setAge()
+    _lastStored = 0;
 
     _position = glm::vec3(0,0,0);
     _radius = 0;
@@ -118,6 +119,7 @@ void Particle::init(glm::vec3 position, float radius, rgbColor color, glm::vec3
     _lastEdited = now;
     _lastUpdated = now;
     _created = now; // will get updated as appropriate in setAge()
+    _lastStored = 0;
 
     _position = position;
     _radius = radius;
@@ -142,7 +144,27 @@ void Particle::setMass(float value) {
     }
 }
 
-bool Particle::appendParticleData(OctreePacketData* packetData) const {
+ParticlePropertyFlags Particle::getAllProperties() {
+    ParticlePropertyFlags properties;
+    for (int i = 0; i <= PARTICLE_PROP_LAST_ITEM; i++) {
+        properties += (ParticleProperty)i;
+    }
+    return properties;
+}
+
+ParticlePropertyFlags Particle::getPropertiesChangedSince(quint64 time) const {
+    if (_lastStored > time || _lastEdited > time || !_script.isEmpty()) {
+        return getAllProperties();
+    }
+    // otherwise only update() has changed the particle
+    ParticlePropertyFlags properties;
+    properties += PARTICLE_PROP_POSITION;
+    properties += PARTICLE_PROP_VELOCITY;
+    properties += PARTICLE_PROP_SHOULD_DIE;
+    return properties;
+}
+
+bool Particle::appendParticleData(OctreePacketData* packetData, ParticlePropertyFlags properties) const {
 
     bool success = packetData->appendValue(getID());
 
@@ -158,33 +180,38 @@ bool Particle::appendParticleData(OctreePacketData* packetData) const {
         success = packetData->appendValue(getLastEdited());
     }
     if (success) {
-        success = packetData->appendValue(getRadius());
+        QByteArray encodedProperties = properties.encode();
+        success = packetData->appendRawData((const unsigned char*)encodedProperties.constData(),
+                                            encodedProperties.size());
     }
-    if (success) {
+    if (success && properties.getHasProperty(PARTICLE_PROP_POSITION)) {
         success = packetData->appendPosition(getPosition());
     }
-    if (success) {
-        success = packetData->appendColor(getColor());
-    }
-    if (success) {
+    if (success && properties.getHasProperty(PARTICLE_PROP_VELOCITY)) {
         success = packetData->appendValue(getVelocity());
     }
-    if (success) {
+    if (success && properties.getHasProperty(PARTICLE_PROP_SHOULD_DIE)) {
+        success = packetData->appendValue(getShouldDie());
+    }
+    if (success && properties.getHasProperty(PARTICLE_PROP_RADIUS)) {
+        success = packetData->appendValue(getRadius());
+    }
+    if (success && properties.getHasProperty(PARTICLE_PROP_COLOR)) {
+        success = packetData->appendColor(getColor());
+    }
+    if (success && properties.getHasProperty(PARTICLE_PROP_GRAVITY)) {
         success = packetData->appendValue(getGravity());
     }
-    if (success) {
+    if (success && properties.getHasProperty(PARTICLE_PROP_DAMPING)) {
         success = packetData->appendValue(getDamping());
     }
-    if (success) {
+    if (success && properties.getHasProperty(PARTICLE_PROP_LIFETIME)) {
         success = packetData->appendValue(getLifetime());
     }
-    if (success) {
+    if (success && properties.getHasProperty(PARTICLE_PROP_IN_HAND)) {
         success = packetData->appendValue(getInHand());
     }
-    if (success) {
-        success = packetData->appendValue(getShouldDie());
-    }
-    if (success) {
+    if (success && properties.getHasProperty(PARTICLE_PROP_SCRIPT)) {
         uint16_t scriptLength = _script.size() + 1; // include NULL
         success = packetData->appendValue(scriptLength);
         if (success) {
@@ -193,7 +220,7 @@ bool Particle::appendParticleData(OctreePacketData* packetData) const {
     }
 
     // modelURL
-    if (success) {
+    if (success && properties.getHasProperty(PARTICLE_PROP_MODEL_URL)) {
         uint16_t modelURLLength = _modelURL.size() + 1; // include NULL
         success = packetData->appendValue(modelURLLength);
         if (success) {
@@ -202,16 +229,16 @@ bool Particle::appendParticleData(OctreePacketData* packetData) const {
     }
 
     // modelScale
-    if (success) {
+    if (success && properties.getHasProperty(PARTICLE_PROP_MODEL_SCALE)) {
         success = packetData->appendValue(getModelScale());
     }
 
     // modelTranslation
-    if (success) {
+    if (success && properties.getHasProperty(PARTICLE_PROP_MODEL_TRANSLATION)) {
         success = packetData->appendValue(getModelTranslation());
     }
     // modelRotation
-    if (success) {
+    if (success && properties.getHasProperty(PARTICLE_PROP_MODEL_ROTATION)) {
         success = packetData->appendValue(getModelRotation());
     }
     return success;
@@ -234,7 +261,124 @@ int Particle::expectedBytes() {
     return expectedBytes;
 }
 
-int Particle::readParticleDataFromBuffer(const unsigned char* data, int bytesLeftToRead, ReadBitstreamToTreeParams& args) {
+int Particle::expectedBytes(PacketVersion version) {
+    if (version < VERSION_PARTICLES_HAVE_PROPERTY_FLAGS) {
+        return expectedBytes();
+    }
+    return sizeof(uint32_t) // id
+        + sizeof(float) // age
+        + sizeof(quint64) // last updated
+        + sizeof(quint64) // last edited
+        + 1; // property flags
+}
+
+/// copies a value from the buffer and moves past it, returns false if it runs past the end
+template<typename T> static bool readValue(const unsigned char*& dataAt, const unsigned char* end, T& value) {
+    if (end - dataAt < (int)sizeof(value)) {
+        return false;
+    }
+    memcpy(&value, dataAt, sizeof(value));
+    dataAt += sizeof(value);
+    return true;
+}
+
+/// reads a string written with its length, including the NULL, before it
+static bool readString(const unsigned char*& dataAt, const unsigned char* end, QString& value) {
+    uint16_t length;
+    if (!readValue(dataAt, end, length) || length == 0 || end - dataAt < length) {
+        return false;
+    }
+    value = QString::fromUtf8((const char*)dataAt, length - 1);
+    dataAt += length;
+    return true;
+}
+
+int Particle::readFlaggedParticleDataFromBuffer(const unsigned char* data, int bytesLeftToRead,
+                                                ReadBitstreamToTreeParams& args, ParticlePropertyFlags* propertiesRead) {
+    int clockSkew = args.sourceNode ? args.sourceNode->getClockSkewUsec() : 0;
+    const unsigned char* dataAt = data;
+    const unsigned char* end = data + bytesLeftToRead;
+    float age;
+    if (!(readValue(dataAt, end, _id) && readValue(dataAt, end, age) && readValue(dataAt, end, _lastUpdated) &&
+            readValue(dataAt, end, _lastEdited))) {
+        return 0;
+    }
+    setAge(age);
+    _lastUpdated -= clockSkew;
+    _lastEdited -= clockSkew;
+
+    ParticlePropertyFlags properties;
+    int bytes = properties.decode(dataAt, end - dataAt);
+    if (bytes == 0) {
+        return 0;
+    }
+    dataAt += bytes;
+
+    bool success = true;
+    if (properties.getHasProperty(PARTICLE_PROP_POSITION)) {
+        success = readValue(dataAt, end, _position);
+    }
+    if (success && properties.getHasProperty(PARTICLE_PROP_VELOCITY)) {
+        success = readValue(dataAt, end, _velocity);
+    }
+    if (success && properties.getHasProperty(PARTICLE_PROP_SHOULD_DIE)) {
+        success = readValue(dataAt, end, _shouldDie);
+    }
+    if (success && properties.getHasProperty(PARTICLE_PROP_RADIUS)) {
+        success = readValue(dataAt, end, _radius);
+    }
+    if (success && properties.getHasProperty(PARTICLE_PROP_COLOR)) {
+        success = readValue(dataAt, end, _color);
+    }
+    if (success && properties.getHasProperty(PARTICLE_PROP_GRAVITY)) {
+        success = readValue(dataAt, end, _gravity);
+    }
+    if (success && properties.getHasProperty(PARTICLE_PROP_DAMPING)) {
+        success = readValue(dataAt, end, _damping);
+    }
+    if (success && properties.getHasProperty(PARTICLE_PROP_LIFETIME)) {
+        success = readValue(dataAt, end, _lifetime);
+    }
+    if (success && properties.getHasProperty(PARTICLE_PROP_IN_HAND)) {
+        success = readValue(dataAt, end, _inHand);
+    }
+    if (success && properties.getHasProperty(PARTICLE_PROP_SCRIPT)) {
+        success = readString(dataAt, end, _script);
+    }
+    if (success && properties.getHasProperty(PARTICLE_PROP_MODEL_URL)) {
+        success = readString(dataAt, end, _modelURL);
+    }
+    if (success && properties.getHasProperty(PARTICLE_PROP_MODEL_SCALE)) {
+        success = readValue(dataAt, end, _modelScale);
+    }
+    if (success && properties.getHasProperty(PARTICLE_PROP_MODEL_TRANSLATION)) {
+        success = readValue(dataAt, end, _modelTranslation);
+    }
+    if (success && properties.getHasProperty(PARTICLE_PROP_MODEL_ROTATION)) {
+        uint16_t packedRotation[4];
+        success = readValue(dataAt, end, packedRotation);
+        if (success) {
+            unpackOrientationQuatFromBytes((const unsigned char*)packedRotation, _modelRotation);
+        }
+    }
+    if (!success) {
+        return 0;
+    }
+    if (propertiesRead) {
+        *propertiesRead = properties;
+    }
+    return dataAt - data;
+}
+
+int Particle::readParticleDataFromBuffer(const unsigned char* data, int bytesLeftToRead, ReadBitstreamToTreeParams& args,
+                                         ParticlePropertyFlags* propertiesRead) {
+    if (args.bitstreamVersion >= VERSION_PARTICLES_HAVE_PROPERTY_FLAGS) {
+        return readFlaggedParticleDataFromBuffer(data, bytesLeftToRead, args, propertiesRead);
+    }
+    if (propertiesRead) {
+        *propertiesRead = getAllProperties();
+    }
+
     int bytesRead = 0;
     if (bytesLeftToRead >= expectedBytes()) {
         int clockSkew = args.sourceNode ? args.sourceNode->getClockSkewUsec() : 0;
@@ -822,8 +966,10 @@ void Particle::update(const quint64& now) {
     _lastUpdated = now;
 
     // calculate our default shouldDie state... then allow script to change it if it wants...
+    // the age is taken from now rather than the clock, which would be read once per particle
     bool isInHand = getInHand();
-    bool shouldDie = (getAge() > getLifetime()) || getShouldDie();
+    float age = (float)(now - _created) / (float)(USECS_PER_SECOND);
+    bool shouldDie = (age > getLifetime()) || getShouldDie();
     setShouldDie(shouldDie);
 
     executeUpdateScripts(); // allow the javascript to alter our state
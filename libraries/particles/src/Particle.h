@@ -21,6 +21,7 @@
 #include <CollisionInfo.h>
 #include <SharedUtil.h>
 #include <OctreePacketData.h>
+#include <PropertyFlags.h>
 
 class Particle;
 class ParticleEditPacketSender;
@@ -65,6 +66,30 @@ const float DEFAULT_MODEL_SCALE = 1.0f;
 const bool IN_HAND = true; // it's in a hand
 const bool NOT_IN_HAND = !IN_HAND; // it's not in a hand
 
+const PacketVersion VERSION_PARTICLES_HAVE_PROPERTY_FLAGS = 3;
+
+/// The properties of a particle in data packets, which carry the flags of the ones they hold. The properties that change
+/// without edits come first, so that their flags fit in a byte.
+enum ParticleProperty {
+    PARTICLE_PROP_POSITION,
+    PARTICLE_PROP_VELOCITY,
+    PARTICLE_PROP_SHOULD_DIE,
+    PARTICLE_PROP_RADIUS,
+    PARTICLE_PROP_COLOR,
+    PARTICLE_PROP_GRAVITY,
+    PARTICLE_PROP_DAMPING,
+    PARTICLE_PROP_LIFETIME,
+    PARTICLE_PROP_IN_HAND,
+    PARTICLE_PROP_SCRIPT,
+    PARTICLE_PROP_MODEL_URL,
+    PARTICLE_PROP_MODEL_SCALE,
+    PARTICLE_PROP_MODEL_TRANSLATION,
+    PARTICLE_PROP_MODEL_ROTATION,
+    PARTICLE_PROP_LAST_ITEM = PARTICLE_PROP_MODEL_ROTATION
+};
+
+typedef PropertyFlags<ParticleProperty> ParticlePropertyFlags;
+
 /// A collection of properties of a particle used in the scripting API. Translates between the actual properties of a particle
 /// and a JavaScript style hash/QScriptValue storing a set of properties. Used in scripting to set/get the complete set of
 /// particle properties via JavaScript hashes/QScriptValues
@@ -160,6 +185,7 @@ private:
     bool _defaultSettings;
 };
 Q_DECLARE_METATYPE(ParticleProperties);
+Q_DECLARE_METATYPE(QVector<ParticleProperties>);
 QScriptValue ParticlePropertiesToScriptValue(QScriptEngine* engine, const ParticleProperties& properties);
 void ParticlePropertiesFromScriptValue(const QScriptValue &object, ParticleProperties& properties);
 
@@ -285,10 +311,31 @@ public:
     
     void setProperties(const ParticleProperties& properties);
 
-    bool appendParticleData(OctreePacketData* packetData) const;
-    int readParticleDataFromBuffer(const unsigned char* data, int bytesLeftToRead, ReadBitstreamToTreeParams& args);
+    /// when this host last stored the particle in an element or edited it there, in its own clock
+    quint64 getLastStored() const { return _lastStored; }
+    void setLastStored(quint64 lastStored) { _lastStored = lastStored; }
+
+    static ParticlePropertyFlags getAllProperties();
+
+    /// the properties that may have changed since a time, all of them if the particle has been stored or edited since or
+    /// has a script, which can change any of them
+    ParticlePropertyFlags getPropertiesChangedSince(quint64 time) const;
+
+    bool appendParticleData(OctreePacketData* packetData) const
+        { return appendParticleData(packetData, getAllProperties()); }
+
+    /// appends the particle's ID, age and times, then the flags of the properties given and the properties themselves
+    bool appendParticleData(OctreePacketData* packetData, ParticlePropertyFlags properties) const;
+
+    /// reads a particle, leaving the properties the data doesn't hold as they are, which properties it held are returned
+    /// in propertiesRead if it's given
+    int readParticleDataFromBuffer(const unsigned char* data, int bytesLeftToRead, ReadBitstreamToTreeParams& args,
+                                   ParticlePropertyFlags* propertiesRead = NULL);
     static int expectedBytes();
 
+    /// the fewest bytes a particle takes in data of a version
+    static int expectedBytes(PacketVersion version);
+
     static bool encodeParticleEditMessageDetails(PacketType command, ParticleID id, const ParticleProperties& details,
                         unsigned char* bufferOut, int sizeIn, int& sizeOut);
 
@@ -324,6 +371,9 @@ protected:
     static VoxelEditPacketSender* _voxelEditSender;
     static ParticleEditPacketSender* _particleEditSender;
 
+    int readFlaggedParticleDataFromBuffer(const unsigned char* data, int bytesLeftToRead, ReadBitstreamToTreeParams& args,
+                                          ParticlePropertyFlags* propertiesRead);
+
     void startParticleScriptContext(ScriptEngine& engine, ParticleScriptObject& particleScriptable);
     void endParticleScriptContext(ScriptEngine& engine, ParticleScriptObject& particleScriptable);
     void executeUpdateScripts();
@@ -355,6 +405,7 @@ protected:
 
     quint64 _lastUpdated;
     quint64 _lastEdited;
+    quint64 _lastStored;
 
     // this doesn't go on the wire, we send it as lifetime
     quint64 _created;
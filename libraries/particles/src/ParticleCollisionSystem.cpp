@@ -11,6 +11,7 @@
 
 #include <algorithm>
 #include <AbstractAudioInterface.h>
+#include <GeometryUtil.h>
 #include <VoxelTree.h>
 #include <AvatarData.h>
 #include <HeadData.h>
@@ -46,12 +47,11 @@ bool ParticleCollisionSystem::updateOperation(OctreeElement* element, void* extr
     ParticleCollisionSystem* system = static_cast<ParticleCollisionSystem*>(extraData);
     ParticleTreeElement* particleTreeElement = static_cast<ParticleTreeElement*>(element);
 
-    // iterate the particles...
+    // gather the particles...
     QList<Particle>& particles = particleTreeElement->getParticles();
     uint16_t numberOfParticles = particles.size();
     for (uint16_t i = 0; i < numberOfParticles; i++) {
-        Particle* particle = &particles[i];
-        system->checkParticle(particle);
+        system->_particleList.append(&particles[i]);
     }
 
     return true;
@@ -61,16 +61,60 @@ bool ParticleCollisionSystem::updateOperation(OctreeElement* element, void* extr
 void ParticleCollisionSystem::update() {
     // update all particles
     if (_particles->tryLockForRead()) {
+        _particleList.clear();
         _particles->recurseTreeWithOperation(updateOperation, this);
+
+        // the voxel tree is its own broadphase
+        foreach (Particle* particle, _particleList) {
+            updateCollisionWithVoxels(particle);
+        }
+        sweepForCollisions();
         _particles->unlock();
     }
 }
 
+static bool proxyStartsBefore(const ParticleCollisionProxy& first, const ParticleCollisionProxy& second) {
+    return first.getMinimumX() < second.getMinimumX();
+}
 
-void ParticleCollisionSystem::checkParticle(Particle* particle) {
-    updateCollisionWithVoxels(particle);
-    updateCollisionWithParticles(particle);
-    updateCollisionWithAvatars(particle);
+void ParticleCollisionSystem::sweepForCollisions() {
+    _proxies.clear();
+    foreach (Particle* particle, _particleList) {
+        ParticleCollisionProxy proxy = { particle->getPosition() * (float)TREE_SCALE,
+            particle->getRadius() * (float)TREE_SCALE, particle, NULL };
+        _proxies.append(proxy);
+    }
+    if (_avatars) {
+        foreach (const AvatarSharedPointer& avatarPointer, _avatars->getAvatarHash()) {
+            AvatarData* avatar = avatarPointer.data();
+            ParticleCollisionProxy proxy = { avatar->getPosition(), avatar->getBoundingRadius(), NULL, avatar };
+            _proxies.append(proxy);
+        }
+    }
+    std::sort(_proxies.begin(), _proxies.end(), proxyStartsBefore);
+
+    // each proxy is tested against those that start before it ends, which are the only ones it can overlap in x
+    for (int i = 0; i < _proxies.size(); i++) {
+        const ParticleCollisionProxy& first = _proxies.at(i);
+        for (int j = i + 1; j < _proxies.size() && _proxies.at(j).getMinimumX() <= first.getMaximumX(); j++) {
+            const ParticleCollisionProxy& second = _proxies.at(j);
+            if (first.avatar && second.avatar) {
+                continue;
+            }
+            float totalRadius = first.radius + second.radius;
+            glm::vec3 relativePosition = second.center - first.center;
+            if (glm::dot(relativePosition, relativePosition) > totalRadius * totalRadius) {
+                continue;
+            }
+            if (first.particle && second.particle) {
+                updateCollisionWithParticle(first.particle, second.particle);
+            } else if (first.particle) {
+                updateCollisionWithAvatar(first.particle, second.avatar);
+            } else {
+                updateCollisionWithAvatar(second.particle, first.avatar);
+            }
+        }
+    }
 }
 
 void ParticleCollisionSystem::emitGlobalParticleCollisionWithVoxel(Particle* particle, 
@@ -120,15 +164,16 @@ void ParticleCollisionSystem::updateCollisionWithVoxels(Particle* particle) {
     }
 }
 
-void ParticleCollisionSystem::updateCollisionWithParticles(Particle* particleA) {
-    glm::vec3 center = particleA->getPosition() * (float)(TREE_SCALE);
-    float radius = particleA->getRadius() * (float)(TREE_SCALE);
+void ParticleCollisionSystem::updateCollisionWithParticle(Particle* particleA, Particle* particleB) {
     //const float ELASTICITY = 0.4f;
     //const float DAMPING = 0.0f;
     const float COLLISION_FREQUENCY = 0.5f;
+    glm::vec3 centerA = particleA->getPosition() * (float)(TREE_SCALE);
+    float radiusA = particleA->getRadius() * (float)(TREE_SCALE);
+    glm::vec3 centerB = particleB->getPosition() * (float)(TREE_SCALE);
+    float radiusB = particleB->getRadius() * (float)(TREE_SCALE);
     glm::vec3 penetration;
-    Particle* particleB;
-    if (_particles->findSpherePenetration(center, radius, penetration, (void**)&particleB, Octree::NoLock)) {
+    if (findSphereSpherePenetration(centerA, radiusA, centerB, radiusB, penetration)) {
         // NOTE: 'penetration' is the depth that 'particleA' overlaps 'particleB'.  It points from A into B.
 
         // Even if the particles overlap... when the particles are already moving appart
@@ -184,9 +229,9 @@ void ParticleCollisionSystem::updateCollisionWithParticles(Particle* particleA)
 // MIN_VALID_SPEED is obtained by computing speed gained at one gravity after the shortest expected frame
 const float MIN_EXPECTED_FRAME_PERIOD = 0.0167f;  // 1/60th of a second
 
-void ParticleCollisionSystem::updateCollisionWithAvatars(Particle* particle) {
+void ParticleCollisionSystem::updateCollisionWithAvatar(Particle* particle, AvatarData* avatar) {
     // particles that are in hand, don't collide with avatars
-    if (!_avatars || particle->getInHand()) {
+    if (particle->getInHand()) {
         return;
     }
 
@@ -195,36 +240,25 @@ void ParticleCollisionSystem::updateCollisionWithAvatars(Particle* particle) {
     const float ELASTICITY = 0.9f;
     const float DAMPING = 0.1f;
     const float COLLISION_FREQUENCY = 0.5f;
-    glm::vec3 penetration;
 
     _collisions.clear();
-    foreach (const AvatarSharedPointer& avatarPointer, _avatars->getAvatarHash()) {
-        AvatarData* avatar = avatarPointer.data();
-
-        float totalRadius = avatar->getBoundingRadius() + radius;
-        glm::vec3 relativePosition = center - avatar->getPosition();
-        if (glm::dot(relativePosition, relativePosition) > (totalRadius * totalRadius)) {
-            continue;
-        }
-
-        if (avatar->findSphereCollisions(center, radius, _collisions)) {
-            int numCollisions = _collisions.size();
-            for (int i = 0; i < numCollisions; ++i) {
-                CollisionInfo* collision = _collisions.getCollision(i);
-                collision->_damping = DAMPING;
-                collision->_elasticity = ELASTICITY;
-    
-                collision->_addedVelocity /= (float)(TREE_SCALE);
-                glm::vec3 relativeVelocity = collision->_addedVelocity - particle->getVelocity();
-    
-                if (glm::dot(relativeVelocity, collision->_penetration) <= 0.f) {
-                    // only collide when particle and collision point are moving toward each other
-                    // (doing this prevents some "collision snagging" when particle penetrates the object)
-                    updateCollisionSound(particle, collision->_penetration, COLLISION_FREQUENCY);
-                    collision->_penetration /= (float)(TREE_SCALE);
-                    particle->applyHardCollision(*collision);
-                    queueParticlePropertiesUpdate(particle);
-                }
+    if (avatar->findSphereCollisions(center, radius, _collisions)) {
+        int numCollisions = _collisions.size();
+        for (int i = 0; i < numCollisions; ++i) {
+            CollisionInfo* collision = _collisions.getCollision(i);
+            collision->_damping = DAMPING;
+            collision->_elasticity = ELASTICITY;
+
+            collision->_addedVelocity /= (float)(TREE_SCALE);
+            glm::vec3 relativeVelocity = collision->_addedVelocity - particle->getVelocity();
+
+            if (glm::dot(relativeVelocity, collision->_penetration) <= 0.f) {
+                // only collide when particle and collision point are moving toward each other
+                // (doing this prevents some "collision snagging" when particle penetrates the object)
+                updateCollisionSound(particle, collision->_penetration, COLLISION_FREQUENCY);
+                collision->_penetration /= (float)(TREE_SCALE);
+                particle->applyHardCollision(*collision);
+                queueParticlePropertiesUpdate(particle);
             }
         }
     }
@@ -17,6 +17,7 @@
 
 #include <QtScript/QScriptEngine>
 #include <QtCore/QObject>
+#include <QtCore/QVector>
 
 #include <AvatarHashMap.h>
 #include <CollisionInfo.h>
@@ -33,6 +34,18 @@ class VoxelTree;
 
 const glm::vec3 NO_ADDED_VELOCITY = glm::vec3(0);
 
+/// A particle or an avatar in the sweep that finds which of them might touch, bounded by a sphere in world units.
+class ParticleCollisionProxy {
+public:
+    glm::vec3 center;
+    float radius;
+    Particle* particle; ///< NULL for an avatar
+    AvatarData* avatar; ///< NULL for a particle
+
+    float getMinimumX() const { return center.x - radius; }
+    float getMaximumX() const { return center.x + radius; }
+};
+
 class ParticleCollisionSystem : public QObject {
 Q_OBJECT
 public:
@@ -45,12 +58,13 @@ public:
                                 
     ~ParticleCollisionSystem();
 
+    /// Collides each particle with the voxels, then sweeps the particles and avatars along the x axis to find the pairs
+    /// whose bounding spheres touch, which are the only ones collided with each other.
     void update();
 
-    void checkParticle(Particle* particle);
     void updateCollisionWithVoxels(Particle* particle);
-    void updateCollisionWithParticles(Particle* particle);
-    void updateCollisionWithAvatars(Particle* particle);
+    void updateCollisionWithParticle(Particle* particleA, Particle* particleB);
+    void updateCollisionWithAvatar(Particle* particle, AvatarData* avatar);
     void queueParticlePropertiesUpdate(Particle* particle);
     void updateCollisionSound(Particle* particle, const glm::vec3 &penetration, float frequency);
 
@@ -60,6 +74,7 @@ signals:
 
 private:
     static bool updateOperation(OctreeElement* element, void* extraData);
+    void sweepForCollisions();
     void emitGlobalParticleCollisionWithVoxel(Particle* particle, VoxelDetail* voxelDetails, const CollisionInfo& penetration);
     void emitGlobalParticleCollisionWithParticle(Particle* particleA, Particle* particleB, const CollisionInfo& penetration);
 
@@ -69,6 +84,8 @@ private:
     AbstractAudioInterface* _audio;
     AvatarHashMap* _avatars;
     CollisionList _collisions;
+    QVector<Particle*> _particleList; ///< the particles this update, kept to save reallocating each time
+    QVector<ParticleCollisionProxy> _proxies; ///< the particles and avatars in the sweep, in order of their lowest x
 };
 
 #endif // hifi_ParticleCollisionSystem_h
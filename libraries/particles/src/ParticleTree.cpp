@@ -15,6 +15,12 @@ ParticleTree::ParticleTree(bool shouldReaverage) : Octree(shouldReaverage) {
     _rootElement = createNewElement();
 }
 
+ParticleTree::~ParticleTree() {
+    // the elements take their particles out of the map as they're deleted, so they have to go before the map does
+    delete _rootElement;
+    _rootElement = NULL;
+}
+
 ParticleTreeElement* ParticleTree::createNewElement(unsigned char * octalCode) {
     ParticleTreeElement* newElement = new ParticleTreeElement(octalCode);
     newElement->setTree(this);
@@ -93,9 +99,14 @@ bool ParticleTree::findAndUpdateOperation(OctreeElement* element, void* extraDat
 }
 
 void ParticleTree::storeParticle(const Particle& particle, const SharedNodePointer& senderNode) {
-    // First, look for the existing particle in the tree..
+    // First, look for the existing particle in the tree, where the map says it is if its ID is known
     FindAndUpdateParticleArgs args = { particle, false };
-    recurseTreeWithOperation(findAndUpdateOperation, &args);
+    if (particle.getID() != UNKNOWN_PARTICLE_ID) {
+        ParticleTreeElement* element = _particleToElementMap.value(particle.getID());
+        args.found = element && element->updateParticle(particle);
+    } else {
+        recurseTreeWithOperation(findAndUpdateOperation, &args);
+    }
 
     // if we didn't find it in the tree, then store it...
     if (!args.found) {
@@ -340,49 +351,32 @@ void ParticleTree::findParticlesForUpdate(const AACube& cube, QVector<Particle*>
     foundParticles.swap(args._foundParticles);
 }
 
-class FindByIDArgs {
-public:
-    uint32_t id;
-    bool found;
-    const Particle* foundParticle;
-};
-
-
-bool ParticleTree::findByIDOperation(OctreeElement* element, void* extraData) {
-//qDebug() << "ParticleTree::findByIDOperation()....";
-
-    FindByIDArgs* args = static_cast<FindByIDArgs*>(extraData);
-    ParticleTreeElement* particleTreeElement = static_cast<ParticleTreeElement*>(element);
-
-    // if already found, stop looking
-    if (args->found) {
-        return false;
-    }
-
-    // as the tree element if it has this particle
-    const Particle* foundParticle = particleTreeElement->getParticleWithID(args->id);
-    if (foundParticle) {
-        args->foundParticle = foundParticle;
-        args->found = true;
-        return false;
-    }
-
-    // keep looking
-    return true;
-}
-
-
 const Particle* ParticleTree::findParticleByID(uint32_t id, bool alreadyLocked) {
-    FindByIDArgs args = { id, false, NULL };
-
     if (!alreadyLocked) {
         lockForRead();
     }
-    recurseTreeWithOperation(findByIDOperation, &args);
+    const Particle* foundParticle = NULL;
+    ParticleTreeElement* element = _particleToElementMap.value(id);
+    if (element) {
+        foundParticle = element->getParticleWithID(id);
+    }
     if (!alreadyLocked) {
         unlock();
     }
-    return args.foundParticle;
+    return foundParticle;
+}
+
+void ParticleTree::setContainingElement(uint32_t particleID, ParticleTreeElement* element) {
+    if (particleID != UNKNOWN_PARTICLE_ID) {
+        _particleToElementMap.insert(particleID, element);
+    }
+}
+
+void ParticleTree::resetContainingElement(uint32_t particleID, ParticleTreeElement* element) {
+    QHash<uint32_t, ParticleTreeElement*>::iterator containingElement = _particleToElementMap.find(particleID);
+    if (containingElement != _particleToElementMap.end() && containingElement.value() == element) {
+        _particleToElementMap.erase(containingElement);
+    }
 }
 
 
@@ -464,58 +458,66 @@ void ParticleTree::update() {
     lockForWrite();
     _isDirty = true;
 
-    ParticleTreeUpdateArgs args = { };
-    recurseTreeWithOperation(updateOperation, &args);
+    ParticleTreeUpdateArgs args;
+    if (_updateThreads.maxThreadCount() > 1) {
+        // the subtrees under the root's children are updated at once, each taking its moving particles out to its own
+        // args, but the scripts send their edits through the senders all the particles share, so the particles with
+        // scripts are left for after
+        getRoot()->update(args);
+        ParticleTreeUpdateArgs subtreeArgs[NUMBER_OF_CHILDREN];
+        void* extraData[NUMBER_OF_CHILDREN];
+        for (int i = 0; i < NUMBER_OF_CHILDREN; i++) {
+            subtreeArgs[i]._deferScriptedParticles = true;
+            extraData[i] = &subtreeArgs[i];
+        }
+        recurseRootChildrenConcurrently(updateOperation, extraData, &_updateThreads);
+
+        ParticleTreeUpdateArgs scriptedArgs;
+        scriptedArgs._scriptedParticlesOnly = true;
+        for (int i = 0; i < NUMBER_OF_CHILDREN; i++) {
+            args._movingParticles.append(subtreeArgs[i]._movingParticles);
+            args._movedFromElements.append(subtreeArgs[i]._movedFromElements);
+            foreach (ParticleTreeElement* element, subtreeArgs[i]._elementsWithScripts) {
+                element->update(scriptedArgs);
+            }
+        }
+        args._movingParticles.append(scriptedArgs._movingParticles);
+        args._movedFromElements.append(scriptedArgs._movedFromElements);
+    } else {
+        OctreeOperationVisitor<updateOperation> visitor(&args);
+        visitTree<ParticleTreeElement>(visitor);
+    }
 
-    // now add back any of the particles that moved elements....
+    // now add back any of the particles that moved elements, each straight into the element it's now in
     int movingParticles = args._movingParticles.size();
+    AACube treeBounds = getRoot()->getAACube();
     for (int i = 0; i < movingParticles; i++) {
+        resetContainingElement(args._movingParticles[i].getID(), args._movedFromElements[i]);
         bool shouldDie = args._movingParticles[i].getShouldDie();
 
         // if the particle is still inside our total bounds, then re-add it
-        AACube treeBounds = getRoot()->getAACube();
-
         if (!shouldDie && treeBounds.contains(args._movingParticles[i].getPosition())) {
             storeParticle(args._movingParticles[i]);
         } else {
             uint32_t particleID = args._movingParticles[i].getID();
-            quint64 deletedAt = usecTimestampNow();
-            _recentlyDeletedParticlesLock.lockForWrite();
-            _recentlyDeletedParticleIDs.insert(deletedAt, particleID);
-            _recentlyDeletedParticlesLock.unlock();
+            _deletedParticleIDs.append(particleID);
         }
     }
 
     // prune the tree...
-    recurseTreeWithOperation(pruneOperation, NULL);
+    OctreeOperationVisitor<pruneOperation> pruneVisitor;
+    visitTree<ParticleTreeElement>(pruneVisitor);
     unlock();
 }
 
 
-bool ParticleTree::hasParticlesDeletedSince(quint64 sinceTime) {
-    // we can probably leverage the ordered nature of QMultiMap to do this quickly...
-    bool hasSomethingNewer = false;
-
-    _recentlyDeletedParticlesLock.lockForRead();
-    QMultiMap<quint64, uint32_t>::const_iterator iterator = _recentlyDeletedParticleIDs.constBegin();
-    while (iterator != _recentlyDeletedParticleIDs.constEnd()) {
-        //qDebug() << "considering... time/key:" << iterator.key();
-        if (iterator.key() > sinceTime) {
-            //qDebug() << "YES newer... time/key:" << iterator.key();
-            hasSomethingNewer = true;
-        }
-        ++iterator;
-    }
-    _recentlyDeletedParticlesLock.unlock();
-    return hasSomethingNewer;
+bool ParticleTree::hasParticlesDeletedSince(quint64 cursor) {
+    return _deletedParticleIDs.hasDeletedSince(cursor);
 }
 
-// sinceTime is an in/out parameter - it will be side effected with the last time sent out
-bool ParticleTree::encodeParticlesDeletedSince(OCTREE_PACKET_SEQUENCE sequenceNumber, quint64& sinceTime, unsigned char* outputBuffer,
-                                                size_t maxLength, size_t& outputLength) {
-
-    bool hasMoreToSend = true;
-
+// cursor is an in/out parameter - it will be moved past the last particle ID sent out
+bool ParticleTree::encodeParticlesDeletedSince(OCTREE_PACKET_SEQUENCE sequenceNumber, quint64& cursor,
+                                               unsigned char* outputBuffer, size_t maxLength, size_t& outputLength) {
     unsigned char* copyAt = outputBuffer;
     size_t numBytesPacketHeader = populatePacketHeader(reinterpret_cast<char*>(outputBuffer), PacketTypeParticleErase);
     copyAt += numBytesPacketHeader;
@@ -538,82 +540,18 @@ bool ParticleTree::encodeParticlesDeletedSince(OCTREE_PACKET_SEQUENCE sequenceNu
     copyAt += sizeof(OCTREE_PACKET_SENT_TIME);
     outputLength += sizeof(OCTREE_PACKET_SENT_TIME);
 
-
-    uint16_t numberOfIds = 0; // placeholder for now
-    unsigned char* numberOfIDsAt = copyAt;
+    // the IDs deleted since we last sent to this node, as many as fit
+    int maxIDs = (int)((maxLength - outputLength - sizeof(uint16_t)) / sizeof(uint32_t));
+    uint16_t numberOfIds = _deletedParticleIDs.copyDeletedSince(cursor, copyAt + sizeof(numberOfIds), maxIDs);
     memcpy(copyAt, &numberOfIds, sizeof(numberOfIds));
-    copyAt += sizeof(numberOfIds);
-    outputLength += sizeof(numberOfIds);
-
-    // we keep a multi map of particle IDs to timestamps, we only want to include the particle IDs that have been
-    // deleted since we last sent to this node
-    _recentlyDeletedParticlesLock.lockForRead();
-    QMultiMap<quint64, uint32_t>::const_iterator iterator = _recentlyDeletedParticleIDs.constBegin();
-    while (iterator != _recentlyDeletedParticleIDs.constEnd()) {
-        QList<uint32_t> values = _recentlyDeletedParticleIDs.values(iterator.key());
-        for (int valueItem = 0; valueItem < values.size(); ++valueItem) {
-
-            // if the timestamp is more recent then out last sent time, include it
-            if (iterator.key() > sinceTime) {
-                uint32_t particleID = values.at(valueItem);
-                memcpy(copyAt, &particleID, sizeof(particleID));
-                copyAt += sizeof(particleID);
-                outputLength += sizeof(particleID);
-                numberOfIds++;
-
-                // check to make sure we have room for one more id...
-                if (outputLength + sizeof(uint32_t) > maxLength) {
-                    break;
-                }
-            }
-        }
-
-        // check to make sure we have room for one more id...
-        if (outputLength + sizeof(uint32_t) > maxLength) {
+    outputLength += sizeof(numberOfIds) + numberOfIds * sizeof(uint32_t);
 
-            // let our caller know how far we got
-            sinceTime = iterator.key();
-            break;
-        }
-        ++iterator;
-    }
-
-    // if we got to the end, then we're done sending
-    if (iterator == _recentlyDeletedParticleIDs.constEnd()) {
-        hasMoreToSend = false;
-    }
-    _recentlyDeletedParticlesLock.unlock();
-
-    // replace the correct count for ids included
-    memcpy(numberOfIDsAt, &numberOfIds, sizeof(numberOfIds));
-
-    return hasMoreToSend;
+    return _deletedParticleIDs.hasDeletedSince(cursor);
 }
 
-// called by the server when it knows all nodes have been sent deleted packets
-
-void ParticleTree::forgetParticlesDeletedBefore(quint64 sinceTime) {
-    //qDebug() << "forgetParticlesDeletedBefore()";
-    QSet<quint64> keysToRemove;
-
-    _recentlyDeletedParticlesLock.lockForWrite();
-    QMultiMap<quint64, uint32_t>::iterator iterator = _recentlyDeletedParticleIDs.begin();
-
-    // First find all the keys in the map that are older and need to be deleted
-    while (iterator != _recentlyDeletedParticleIDs.end()) {
-        if (iterator.key() <= sinceTime) {
-            keysToRemove << iterator.key();
-        }
-        ++iterator;
-    }
-
-    // Now run through the keysToRemove and remove them
-    foreach (quint64 value, keysToRemove) {
-        //qDebug() << "removing the key, _recentlyDeletedParticleIDs.remove(value); time/key:" << value;
-        _recentlyDeletedParticleIDs.remove(value);
-    }
-    
-    _recentlyDeletedParticlesLock.unlock();
+// called by the server when it knows all nodes have been sent the deletions before the cursor
+void ParticleTree::forgetParticlesDeletedBefore(quint64 cursor) {
+    _deletedParticleIDs.forgetDeletedBefore(cursor);
 }
 
 
@@ -12,7 +12,11 @@
 #ifndef hifi_ParticleTree_h
 #define hifi_ParticleTree_h
 
+#include <QtCore/QHash>
+#include <QtCore/QThreadPool>
+
 #include <Octree.h>
+#include <OctreeDeletedIDLog.h>
 #include "ParticleTreeElement.h"
 
 class NewlyCreatedParticleHook {
@@ -24,6 +28,7 @@ class ParticleTree : public Octree {
     Q_OBJECT
 public:
     ParticleTree(bool shouldReaverage = false);
+    virtual ~ParticleTree();
 
     /// Implements our type specific root element factory
     virtual ParticleTreeElement* createNewElement(unsigned char * octalCode = NULL);
@@ -49,6 +54,13 @@ public:
     const Particle* findClosestParticle(glm::vec3 position, float targetRadius);
     const Particle* findParticleByID(uint32_t id, bool alreadyLocked = false);
 
+    /// Called by the elements as they store and remove particles, so that particles can be found by ID without
+    /// searching the tree. Particles whose IDs aren't known yet aren't kept.
+    void setContainingElement(uint32_t particleID, ParticleTreeElement* element);
+
+    /// forgets the element holding a particle, if it's the one given
+    void resetContainingElement(uint32_t particleID, ParticleTreeElement* element);
+
     /// finds all particles that touch a sphere
     /// \param center the center of the sphere
     /// \param radius the radius of the sphere
@@ -65,10 +77,12 @@ public:
     void addNewlyCreatedHook(NewlyCreatedParticleHook* hook);
     void removeNewlyCreatedHook(NewlyCreatedParticleHook* hook);
 
-    bool hasAnyDeletedParticles() const { return _recentlyDeletedParticleIDs.size() > 0; }
-    bool hasParticlesDeletedSince(quint64 sinceTime);
-    bool encodeParticlesDeletedSince(OCTREE_PACKET_SEQUENCE sequenceNumber, quint64& sinceTime, unsigned char* packetData, size_t maxLength, size_t& outputLength);
-    void forgetParticlesDeletedBefore(quint64 sinceTime);
+    /// the deletions are logged in order and a node is sent them from a cursor, which starts at 0 for a new node
+    bool hasAnyDeletedParticles() const { return !_deletedParticleIDs.isEmpty(); }
+    bool hasParticlesDeletedSince(quint64 cursor);
+    bool encodeParticlesDeletedSince(OCTREE_PACKET_SEQUENCE sequenceNumber, quint64& cursor,
+                                     unsigned char* packetData, size_t maxLength, size_t& outputLength);
+    void forgetParticlesDeletedBefore(quint64 cursor);
 
     void processEraseMessage(const QByteArray& dataByteArray, const SharedNodePointer& sourceNode);
     void handleAddParticleResponse(const QByteArray& packet);
@@ -81,7 +95,6 @@ private:
     static bool findNearPointOperation(OctreeElement* element, void* extraData);
     static bool findInSphereOperation(OctreeElement* element, void* extraData);
     static bool pruneOperation(OctreeElement* element, void* extraData);
-    static bool findByIDOperation(OctreeElement* element, void* extraData);
     static bool findAndDeleteOperation(OctreeElement* element, void* extraData);
     static bool findAndUpdateParticleIDOperation(OctreeElement* element, void* extraData);
     static bool findInCubeForUpdateOperation(OctreeElement* element, void* extraData);
@@ -92,8 +105,11 @@ private:
     std::vector<NewlyCreatedParticleHook*> _newlyCreatedHooks;
 
 
-    QReadWriteLock _recentlyDeletedParticlesLock;
-    QMultiMap<quint64, uint32_t> _recentlyDeletedParticleIDs;
+    OctreeDeletedIDLog _deletedParticleIDs;
+
+    QHash<uint32_t, ParticleTreeElement*> _particleToElementMap;
+
+    QThreadPool _updateThreads;
 };
 
 #endif // hifi_ParticleTree_h
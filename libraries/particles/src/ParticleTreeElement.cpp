@@ -10,21 +10,46 @@
 //
 
 #include <GeometryUtil.h>
+#include <SlabAllocator.h>
 
 #include "ParticleTree.h"
 #include "ParticleTreeElement.h"
 
-ParticleTreeElement::ParticleTreeElement(unsigned char* octalCode) : OctreeElement(), _particles(NULL) {
+ParticleTreeElement::ParticleTreeElement(unsigned char* octalCode) : OctreeElement(), _myTree(NULL), _particles(NULL) {
     init(octalCode);
 };
 
 ParticleTreeElement::~ParticleTreeElement() {
     _voxelMemoryUsage -= sizeof(ParticleTreeElement);
+    if (_myTree) {
+        for (int i = 0; i < _particles->size(); i++) {
+            _myTree->resetContainingElement((*_particles)[i].getID(), this);
+        }
+    }
     QList<Particle>* tmpParticles = _particles;
     _particles = NULL;
     delete tmpParticles;
 }
 
+static SlabAllocator& getElementAllocator() {
+    // never deleted, as elements can outlive the static destructors
+    static SlabAllocator* allocator = new SlabAllocator(sizeof(ParticleTreeElement));
+    return *allocator;
+}
+
+void* ParticleTreeElement::operator new(size_t size) {
+    // a subclass of a different size comes from the heap
+    return (size == sizeof(ParticleTreeElement)) ? getElementAllocator().allocate() : ::operator new(size);
+}
+
+void ParticleTreeElement::operator delete(void* element, size_t size) {
+    if (size == sizeof(ParticleTreeElement)) {
+        getElementAllocator().deallocate(element);
+    } else {
+        ::operator delete(element);
+    }
+}
+
 // This will be called primarily on addChildAt(), which means we're adding a child of our
 // own type to our own tree. This means we should initialize that child with any tree and type
 // specific settings that our children must have. One example is out VoxelSystem, which
@@ -58,7 +83,15 @@ bool ParticleTreeElement::appendElementData(OctreePacketData* packetData, Encode
     if (success) {
         for (uint16_t i = 0; i < numberOfParticles; i++) {
             const Particle& particle = (*_particles)[i];
-            success = particle.appendParticleData(packetData);
+
+            // a view that had this element has the particles that were here then, so they need only send their changes
+            if (params.deltaViewFrustum && params.elementWasInView) {
+                success = particle.appendParticleData(packetData,
+                                                      particle.getPropertiesChangedSince(params.lastViewFrustumSent -
+                                                                                         CHANGE_FUDGE));
+            } else {
+                success = particle.appendParticleData(packetData);
+            }
             if (!success) {
                 break;
             }
@@ -68,21 +101,35 @@ bool ParticleTreeElement::appendElementData(OctreePacketData* packetData, Encode
 }
 
 void ParticleTreeElement::update(ParticleTreeUpdateArgs& args) {
+    // an element without particles has nothing to change, and marking it would only have it sent again
+    if (_particles->isEmpty()) {
+        return;
+    }
     markWithChangedTime();
-    // TODO: early exit when _particles is empty
 
     // update our contained particles
+    bool hasDeferredScripts = false;
     QList<Particle>::iterator particleItr = _particles->begin();
     while(particleItr != _particles->end()) {
         Particle& particle = (*particleItr);
+        bool hasScript = !particle.getScript().isEmpty();
+        if (hasScript ? args._deferScriptedParticles : args._scriptedParticlesOnly) {
+            if (hasScript && !hasDeferredScripts) {
+                args._elementsWithScripts.push_back(this);
+                hasDeferredScripts = true;
+            }
+            ++particleItr;
+            continue;
+        }
         particle.update(_lastChanged);
 
         // If the particle wants to die, or if it's left our bounding box, then move it
         // into the arguments moving particles. These will be added back or deleted completely
         if (particle.getShouldDie() || !_cube.contains(particle.getPosition())) {
             args._movingParticles.push_back(particle);
+            args._movedFromElements.push_back(this);
 
-            // erase this particle
+            // erase this particle, the tree forgets it was here once the elements are all updated
             particleItr = _particles->erase(particleItr);
         } else {
             ++particleItr;
@@ -149,6 +196,7 @@ bool ParticleTreeElement::updateParticle(const Particle& particle) {
                             difference, debug::valueOf(particle.isNewlyCreated()) );
                 }
                 thisParticle.copyChangedProperties(particle);
+                thisParticle.setLastStored(usecTimestampNow());
             } else {
                 if (wantDebug) {
                     qDebug(">>> IGNORING SERVER!!! Would've caused jutter! <<<  "
@@ -179,6 +227,7 @@ bool ParticleTreeElement::updateParticle(const ParticleID& particleID, const Par
         }
         if (found) {
             thisParticle.setProperties(properties);
+            thisParticle.setLastStored(usecTimestampNow());
 
             const bool wantDebug = false;
             if (wantDebug) {
@@ -203,6 +252,7 @@ void ParticleTreeElement::updateParticleID(FindAndUpdateParticleIDArgs* args) {
             // first, we're looking for matching creatorTokenIDs, if we find that, then we fix it to know the actual ID
             if (thisParticle.getCreatorTokenID() == args->creatorTokenID) {
                 thisParticle.setID(args->particleID);
+                _myTree->setContainingElement(args->particleID, this);
                 args->creatorTokenFound = true;
             }
         }
@@ -210,6 +260,7 @@ void ParticleTreeElement::updateParticleID(FindAndUpdateParticleIDArgs* args) {
         // if we're in an isViewing tree, we also need to look for an kill any viewed particles
         if (!args->viewedParticleFound && args->isViewing) {
             if (thisParticle.getCreatorTokenID() == UNKNOWN_TOKEN && thisParticle.getID() == args->particleID) {
+                _myTree->resetContainingElement(args->particleID, this);
                 _particles->removeAt(i); // remove the particle at this index
                 numberOfParticles--; // this means we have 1 fewer particle in this list
                 i--; // and we actually want to back up i as well.
@@ -284,6 +335,7 @@ bool ParticleTreeElement::removeParticleWithID(uint32_t id) {
             if ((*_particles)[i].getID() == id) {
                 foundParticle = true;
                 _particles->removeAt(i);
+                _myTree->resetContainingElement(id, this);
                 break;
             }
         }
@@ -297,7 +349,7 @@ int ParticleTreeElement::readElementDataFromBuffer(const unsigned char* data, in
     const unsigned char* dataAt = data;
     int bytesRead = 0;
     uint16_t numberOfParticles = 0;
-    int expectedBytesPerParticle = Particle::expectedBytes();
+    int expectedBytesPerParticle = Particle::expectedBytes(args.bitstreamVersion);
 
     if (bytesLeftToRead >= (int)sizeof(numberOfParticles)) {
         // read our particles in....
@@ -308,9 +360,19 @@ int ParticleTreeElement::readElementDataFromBuffer(const unsigned char* data, in
 
         if (bytesLeftToRead >= (int)(numberOfParticles * expectedBytesPerParticle)) {
             for (uint16_t i = 0; i < numberOfParticles; i++) {
-                Particle tempParticle;
-                int bytesForThisParticle = tempParticle.readParticleDataFromBuffer(dataAt, bytesLeftToRead, args);
-                _myTree->storeParticle(tempParticle);
+                // a particle may send only what's changed, which is read over the particle we have
+                uint32_t particleID = *(uint32_t*)dataAt;
+                const Particle* existingParticle = _myTree->findParticleByID(particleID, true);
+                Particle tempParticle = existingParticle ? *existingParticle : Particle();
+                ParticlePropertyFlags propertiesRead;
+                int bytesForThisParticle = tempParticle.readParticleDataFromBuffer(dataAt, bytesLeftToRead, args,
+                                                                                   &propertiesRead);
+                if (bytesForThisParticle == 0) {
+                    return bytesRead + bytesLeftToRead; // the rest can't be read
+                }
+                if (existingParticle || propertiesRead == Particle::getAllProperties()) {
+                    _myTree->storeParticle(tempParticle);
+                }
                 dataAt += bytesForThisParticle;
                 bytesLeftToRead -= bytesForThisParticle;
                 bytesRead += bytesForThisParticle;
@@ -338,6 +400,8 @@ bool ParticleTreeElement::collapseChildren() {
 
 void ParticleTreeElement::storeParticle(const Particle& particle) {
     _particles->push_back(particle);
+    _myTree->setContainingElement(particle.getID(), this);
     markWithChangedTime();
+    _particles->last().setLastStored(_lastChanged);
 }
 
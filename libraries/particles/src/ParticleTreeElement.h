@@ -25,7 +25,18 @@ class ParticleTreeElement;
 
 class ParticleTreeUpdateArgs {
 public:
+    ParticleTreeUpdateArgs() :
+            _deferScriptedParticles(false),
+            _scriptedParticlesOnly(false)
+    { }
+
     QList<Particle> _movingParticles;
+    QList<ParticleTreeElement*> _movedFromElements; /// the element each of the moving particles was taken from
+
+    /// leave the particles with scripts alone, listing their elements in _elementsWithScripts instead
+    bool _deferScriptedParticles;
+    bool _scriptedParticlesOnly;
+    QList<ParticleTreeElement*> _elementsWithScripts;
 };
 
 class FindAndUpdateParticleIDArgs {
@@ -49,6 +60,10 @@ class ParticleTreeElement : public OctreeElement {
 public:
     virtual ~ParticleTreeElement();
 
+    /// elements are carved out of slabs rather than allocated from the heap one at a time
+    static void* operator new(size_t size);
+    static void operator delete(void* element, size_t size);
+
     // type safe versions of OctreeElement methods
     ParticleTreeElement* getChildAtIndex(int index) { return (ParticleTreeElement*)OctreeElement::getChildAtIndex(index); }
 
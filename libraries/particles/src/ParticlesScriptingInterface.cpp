@@ -109,6 +109,49 @@ ParticleID ParticlesScriptingInterface::editParticle(ParticleID particleID, cons
     return particleID;
 }
 
+QVector<ParticleID> ParticlesScriptingInterface::addParticles(const QVector<ParticleProperties>& properties) {
+    QVector<ParticleID> ids;
+    ids.reserve(properties.size());
+    foreach (const ParticleProperties& particleProperties, properties) {
+        ParticleID id(NEW_PARTICLE, Particle::getNextCreatorTokenID(), false);
+        queueParticleMessage(PacketTypeParticleAddOrEdit, id, particleProperties);
+        ids.append(id);
+    }
+    
+    // the local tree is locked once for all of them
+    if (_particleTree) {
+        _particleTree->lockForWrite();
+        for (int i = 0; i < ids.size(); i++) {
+            _particleTree->addParticle(ids.at(i), properties.at(i));
+        }
+        _particleTree->unlock();
+    }
+    return ids;
+}
+
+QVector<ParticleID> ParticlesScriptingInterface::editParticles(const QVector<ParticleID>& particleIDs,
+                                                               const QVector<ParticleProperties>& properties) {
+    QVector<ParticleID> ids = particleIDs.mid(0, properties.size());
+    for (int i = 0; i < ids.size(); i++) {
+        ParticleID& particleID = ids[i];
+        uint32_t actualID = particleID.isKnownID ? particleID.id :
+            Particle::getIDfromCreatorTokenID(particleID.creatorTokenID);
+        if (actualID != UNKNOWN_PARTICLE_ID) {
+            particleID.id = actualID;
+            particleID.isKnownID = true;
+            queueParticleMessage(PacketTypeParticleAddOrEdit, particleID, properties.at(i));
+        }
+    }
+    
+    if (_particleTree) {
+        _particleTree->lockForWrite();
+        for (int i = 0; i < ids.size(); i++) {
+            _particleTree->updateParticle(ids.at(i), properties.at(i));
+        }
+        _particleTree->unlock();
+    }
+    return ids;
+}
 
 // TODO: This deleteParticle() method uses the PacketType_PARTICLE_ADD_OR_EDIT message to send
 // a changed particle with a shouldDie() property set to true. This works and is currently the only
@@ -50,6 +50,12 @@ public slots:
     /// deletes a particle
     void deleteParticle(ParticleID particleID);
 
+    /// adds many particles at once, which is much cheaper than calling addParticle for each
+    QVector<ParticleID> addParticles(const QVector<ParticleProperties>& properties);
+
+    /// edits many particles at once, each with the properties at the same index; returns the identified ParticleIDs
+    QVector<ParticleID> editParticles(const QVector<ParticleID>& particleIDs, const QVector<ParticleProperties>& properties);
+
     /// finds the closest particle to the center point, within the radius
     /// will return a ParticleID.isKnownID = false if no particles are in the radius
     /// this function will not find any particles in script engine contexts which don't have access to particles
@@ -0,0 +1,95 @@
+//
+//  ScriptArrayBuffer.cpp
+//  libraries/script-engine/src/
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#include <cstring>
+
+#include <QScriptEngine>
+
+#include "ScriptArrayBuffer.h"
+
+ScriptArrayBuffer::ScriptArrayBuffer(const QByteArray& data, QObject* parent) :
+    QObject(parent),
+    _data(data) {
+}
+
+QScriptValue ScriptArrayBuffer::toScriptValue(QScriptEngine* engine, const QByteArray& data) {
+    return engine->newQObject(new ScriptArrayBuffer(data), QScriptEngine::ScriptOwnership);
+}
+
+int ScriptArrayBuffer::getInt8(int byteOffset) const {
+    quint64 value;
+    return read(byteOffset, sizeof(qint8), false, value) ? (qint8)value : 0;
+}
+
+int ScriptArrayBuffer::getUint8(int byteOffset) const {
+    quint64 value;
+    return read(byteOffset, sizeof(quint8), false, value) ? (quint8)value : 0;
+}
+
+int ScriptArrayBuffer::getInt16(int byteOffset, bool littleEndian) const {
+    quint64 value;
+    return read(byteOffset, sizeof(qint16), littleEndian, value) ? (qint16)value : 0;
+}
+
+int ScriptArrayBuffer::getUint16(int byteOffset, bool littleEndian) const {
+    quint64 value;
+    return read(byteOffset, sizeof(quint16), littleEndian, value) ? (quint16)value : 0;
+}
+
+int ScriptArrayBuffer::getInt32(int byteOffset, bool littleEndian) const {
+    quint64 value;
+    return read(byteOffset, sizeof(qint32), littleEndian, value) ? (qint32)value : 0;
+}
+
+double ScriptArrayBuffer::getUint32(int byteOffset, bool littleEndian) const {
+    // returned as a double, since an int can't hold the upper half of the range
+    quint64 value;
+    return read(byteOffset, sizeof(quint32), littleEndian, value) ? (double)(quint32)value : 0.0;
+}
+
+float ScriptArrayBuffer::getFloat32(int byteOffset, bool littleEndian) const {
+    quint64 value;
+    if (!read(byteOffset, sizeof(float), littleEndian, value)) {
+        return 0.0f;
+    }
+    quint32 bits = (quint32)value;
+    float result;
+    memcpy(&result, &bits, sizeof(float));
+    return result;
+}
+
+double ScriptArrayBuffer::getFloat64(int byteOffset, bool littleEndian) const {
+    quint64 value;
+    if (!read(byteOffset, sizeof(double), littleEndian, value)) {
+        return 0.0;
+    }
+    double result;
+    memcpy(&result, &value, sizeof(double));
+    return result;
+}
+
+QScriptValue ScriptArrayBuffer::slice(int begin, int end) const {
+    int size = _data.size();
+    begin = qBound(0, begin < 0 ? size + begin : begin, size);
+    end = qBound(begin, end < 0 ? size + end : end, size);
+    return toScriptValue(engine(), _data.mid(begin, end - begin));
+}
+
+bool ScriptArrayBuffer::read(int byteOffset, int byteCount, bool littleEndian, quint64& value) const {
+    if (byteOffset < 0 || byteOffset > _data.size() - byteCount) {
+        return false;
+    }
+    const unsigned char* bytes = reinterpret_cast<const unsigned char*>(_data.constData()) + byteOffset;
+    value = 0;
+    for (int i = 0; i < byteCount; i++) {
+        value = (value << 8) | bytes[littleEndian ? byteCount - 1 - i : i];
+    }
+    return true;
+}
@@ -0,0 +1,59 @@
+//
+//  ScriptArrayBuffer.h
+//  libraries/script-engine/src/
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#ifndef hifi_ScriptArrayBuffer_h
+#define hifi_ScriptArrayBuffer_h
+
+#include <QByteArray>
+#include <QObject>
+#include <QScriptable>
+#include <QScriptValue>
+
+/// Raw bytes handed to scripts without turning them into a string, such as the response of an XMLHttpRequest whose
+/// responseType is "arraybuffer". The engine has no typed arrays, so the buffer reads its own values the way a DataView
+/// over it would: big endian unless littleEndian is given, and zero for reads that run past the end.
+class ScriptArrayBuffer : public QObject, protected QScriptable {
+    Q_OBJECT
+    Q_PROPERTY(int byteLength READ getByteLength)
+
+public:
+    ScriptArrayBuffer(const QByteArray& data = QByteArray(), QObject* parent = NULL);
+
+    /// wraps the data for the engine, which takes ownership of the wrapper; the data itself is shared, not copied
+    static QScriptValue toScriptValue(QScriptEngine* engine, const QByteArray& data);
+
+    const QByteArray& getData() const { return _data; }
+    int getByteLength() const { return _data.size(); }
+
+public slots:
+    int getInt8(int byteOffset) const;
+    int getUint8(int byteOffset) const;
+    int getInt16(int byteOffset, bool littleEndian = false) const;
+    int getUint16(int byteOffset, bool littleEndian = false) const;
+    int getInt32(int byteOffset, bool littleEndian = false) const;
+    double getUint32(int byteOffset, bool littleEndian = false) const;
+    float getFloat32(int byteOffset, bool littleEndian = false) const;
+    double getFloat64(int byteOffset, bool littleEndian = false) const;
+
+    /// returns a new buffer with a copy of the bytes from begin up to end, which count back from the end if negative
+    QScriptValue slice(int begin, int end) const;
+    QScriptValue slice(int begin) const { return slice(begin, _data.size()); }
+
+    /// decodes the bytes as UTF-8
+    QString toString() const { return QString::fromUtf8(_data); }
+
+private:
+    /// reads byteCount bytes in the given order into an unsigned integer, or returns false if they aren't all there
+    bool read(int byteOffset, int byteCount, bool littleEndian, quint64& value) const;
+
+    QByteArray _data;
+};
+
+#endif // hifi_ScriptArrayBuffer_h
@@ -9,20 +9,20 @@
 //  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
 //
 
+#include <QtCore/QAbstractEventDispatcher>
 #include <QtCore/QCoreApplication>
 #include <QtCore/QEventLoop>
 #include <QtCore/QTimer>
 #include <QtCore/QThread>
-#include <QtNetwork/QNetworkRequest>
-#include <QtNetwork/QNetworkReply>
+#include <QtCore/QVector>
 #include <QScriptEngine>
 
+#include <AudioCodec.h>
 #include <AudioInjector.h>
 #include <AudioRingBuffer.h>
 #include <AvatarData.h>
 #include <CollisionInfo.h>
 #include <ModelsScriptingInterface.h>
-#include <NetworkAccessManager.h>
 #include <NodeList.h>
 #include <PacketHeaders.h>
 #include <ParticlesScriptingInterface.h>
@@ -36,6 +36,7 @@
 #include "MIDIEvent.h"
 #include "LocalVoxels.h"
 #include "ScriptEngine.h"
+#include "ScriptSourceCache.h"
 #include "XMLHttpRequestClass.h"
 
 VoxelsScriptingInterface ScriptEngine::_voxelsScriptingInterface;
@@ -68,6 +69,18 @@ void injectorFromScriptValue(const QScriptValue &object, AudioInjector* &out) {
     out = qobject_cast<AudioInjector*>(object.toQObject());
 }
 
+/// releases the edit messages the script has queued, if any, and sends them once there are servers to take them
+static void sendEditPackets(OctreeEditPacketSender* packetSender) {
+    if (packetSender->hasQueuedMessages() && packetSender->serversExist()) {
+        packetSender->releaseQueuedMessages();
+
+        // since we're in non-threaded mode, call process so that the packets are sent
+        if (!packetSender->isThreaded()) {
+            packetSender->process();
+        }
+    }
+}
+
 ScriptEngine::ScriptEngine(const QString& scriptContents, const QString& fileNameString,
                            AbstractControllerScriptingInterface* controllerScriptingInterface) :
 
@@ -90,7 +103,8 @@ ScriptEngine::ScriptEngine(const QString& scriptContents, const QString& fileNam
     _quatLibrary(),
     _vec3Library(),
     _uuidLibrary(),
-    _animationCache(this)
+    _animationCache(this),
+    _lastAvatarPacketTime(0)
 {
 }
 
@@ -115,7 +129,8 @@ ScriptEngine::ScriptEngine(const QUrl& scriptURL,
     _quatLibrary(),
     _vec3Library(),
     _uuidLibrary(),
-    _animationCache(this)
+    _animationCache(this),
+    _lastAvatarPacketTime(0)
 {
     QString scriptURLString = scriptURL.toString();
     _fileNameString = scriptURLString;
@@ -129,32 +144,9 @@ ScriptEngine::ScriptEngine(const QUrl& scriptURL,
     }
 
     // ok, let's see if it's valid... and if so, load it
-    if (url.isValid()) {
-        if (url.scheme() == "file") {
-            QString fileName = url.toLocalFile();
-            QFile scriptFile(fileName);
-            if (scriptFile.open(QFile::ReadOnly | QFile::Text)) {
-                qDebug() << "Loading file:" << fileName;
-                QTextStream in(&scriptFile);
-                _scriptContents = in.readAll();
-            } else {
-                qDebug() << "ERROR Loading file:" << fileName;
-                emit errorMessage("ERROR Loading file:" + fileName);
-            }
-        } else {
-            NetworkAccessManager& networkAccessManager = NetworkAccessManager::getInstance();
-            QNetworkReply* reply = networkAccessManager.get(QNetworkRequest(url));
-            qDebug() << "Downloading included script at" << url;
-            QEventLoop loop;
-            QObject::connect(reply, SIGNAL(finished()), &loop, SLOT(quit()));
-            loop.exec();
-            if (reply->error() == QNetworkReply::NoError && reply->attribute(QNetworkRequest::HttpStatusCodeAttribute) == 200) {
-                _scriptContents = reply->readAll();
-            } else {
-                qDebug() << "ERROR Loading file:" << url.toString();
-                emit errorMessage("ERROR Loading file:" + url.toString());
-            }
-        }
+    if (url.isValid() && !ScriptSourceCache::getInstance().getSource(url, _scriptContents)) {
+        qDebug() << "ERROR Loading file:" << url.toString();
+        emit errorMessage("ERROR Loading file:" + url.toString());
     }
 }
 
@@ -228,12 +220,15 @@ void ScriptEngine::init() {
     qScriptRegisterMetaType(&_engine, ParticlePropertiesToScriptValue, ParticlePropertiesFromScriptValue);
     qScriptRegisterMetaType(&_engine, ParticleIDtoScriptValue, ParticleIDfromScriptValue);
     qScriptRegisterSequenceMetaType<QVector<ParticleID> >(&_engine);
+    qScriptRegisterSequenceMetaType<QVector<ParticleProperties> >(&_engine);
 
     qScriptRegisterMetaType(&_engine, ModelItemPropertiesToScriptValue, ModelItemPropertiesFromScriptValue);
     qScriptRegisterMetaType(&_engine, ModelItemIDtoScriptValue, ModelItemIDfromScriptValue);
     qScriptRegisterMetaType(&_engine, RayToModelIntersectionResultToScriptValue, RayToModelIntersectionResultFromScriptValue);
     qScriptRegisterSequenceMetaType<QVector<ModelItemID> >(&_engine);
+    qScriptRegisterSequenceMetaType<QVector<ModelItemProperties> >(&_engine);
 
+    qScriptRegisterSequenceMetaType<QVector<float> >(&_engine);
     qScriptRegisterSequenceMetaType<QVector<glm::vec2> >(&_engine);
     qScriptRegisterSequenceMetaType<QVector<glm::quat> >(&_engine);
     qScriptRegisterSequenceMetaType<QVector<QString> >(&_engine);
@@ -374,60 +369,51 @@ void ScriptEngine::run() {
     qint64 lastUpdate = usecTimestampNow();
 
     while (!_isFinished) {
-        int usecToSleep = (thisFrame++ * SCRIPT_DATA_CALLBACK_USECS) - startTime.nsecsElapsed() / 1000; // nsec to usec
-        if (usecToSleep > 0) {
-            usleep(usecToSleep);
-        }
-
-        if (_isFinished) {
-            break;
-        }
-
-        QCoreApplication::processEvents();
-
-        if (_isFinished) {
-            break;
-        }
-
-        if (_voxelsScriptingInterface.getVoxelPacketSender()->serversExist()) {
-            // release the queue of edit voxel messages.
-            _voxelsScriptingInterface.getVoxelPacketSender()->releaseQueuedMessages();
+        // a script that has no avatar to send, isn't connected to the update signal and has no packets left to send
+        // has nothing to do between events, so it waits for the next one (a timer, a signal or a stop) instead
+        if (_isAvatar || receivers(SIGNAL(update(float))) > 0 || _voxelsScriptingInterface.getVoxelPacketSender()->
+                hasQueuedMessages() || _particlesScriptingInterface.getParticlePacketSender()->hasQueuedMessages() ||
+                _modelsScriptingInterface.getModelPacketSender()->hasQueuedMessages()) {
+            int usecToSleep = (thisFrame++ * SCRIPT_DATA_CALLBACK_USECS) - startTime.nsecsElapsed() / 1000; // nsec to usec
+            if (usecToSleep > 0) {
+                usleep(usecToSleep);
+            }
 
-            // since we're in non-threaded mode, call process so that the packets are sent
-            if (!_voxelsScriptingInterface.getVoxelPacketSender()->isThreaded()) {
-                _voxelsScriptingInterface.getVoxelPacketSender()->process();
+            if (_isFinished) {
+                break;
             }
-        }
 
-        if (_particlesScriptingInterface.getParticlePacketSender()->serversExist()) {
-            // release the queue of edit voxel messages.
-            _particlesScriptingInterface.getParticlePacketSender()->releaseQueuedMessages();
+            QCoreApplication::processEvents();
 
-            // since we're in non-threaded mode, call process so that the packets are sent
-            if (!_particlesScriptingInterface.getParticlePacketSender()->isThreaded()) {
-                _particlesScriptingInterface.getParticlePacketSender()->process();
-            }
+        } else {
+            QCoreApplication::processEvents(QEventLoop::WaitForMoreEvents);
+            
+            // pick the frames up from now rather than catching up on those that passed while waiting
+            thisFrame = startTime.nsecsElapsed() / 1000 / SCRIPT_DATA_CALLBACK_USECS + 1;
         }
 
-        if (_modelsScriptingInterface.getModelPacketSender()->serversExist()) {
-            // release the queue of edit voxel messages.
-            _modelsScriptingInterface.getModelPacketSender()->releaseQueuedMessages();
-
-            // since we're in non-threaded mode, call process so that the packets are sent
-            if (!_modelsScriptingInterface.getModelPacketSender()->isThreaded()) {
-                _modelsScriptingInterface.getModelPacketSender()->process();
-            }
+        if (_isFinished) {
+            break;
         }
 
+        sendEditPackets(_voxelsScriptingInterface.getVoxelPacketSender());
+        sendEditPackets(_particlesScriptingInterface.getParticlePacketSender());
+        sendEditPackets(_modelsScriptingInterface.getModelPacketSender());
+
         if (_isAvatar && _avatarData) {
 
             const int SCRIPT_AUDIO_BUFFER_SAMPLES = floor(((SCRIPT_DATA_CALLBACK_USECS * SAMPLE_RATE) / (1000 * 1000)) + 0.5);
-            const int SCRIPT_AUDIO_BUFFER_BYTES = SCRIPT_AUDIO_BUFFER_SAMPLES * sizeof(int16_t);
 
+            // the avatar is only sent when it changes, and often enough otherwise for the mixer to keep hearing from us
+            const quint64 AVATAR_PACKET_KEEP_ALIVE_USECS = USECS_PER_SECOND / 4;
             QByteArray avatarPacket = byteArrayWithPopulatedHeader(PacketTypeAvatarData);
             avatarPacket.append(_avatarData->toByteArray());
-
-            nodeList->broadcastToNodes(avatarPacket, NodeSet() << NodeType::AvatarMixer);
+            quint64 now = usecTimestampNow();
+            if (avatarPacket != _lastAvatarPacket || now - _lastAvatarPacketTime >= AVATAR_PACKET_KEEP_ALIVE_USECS) {
+                nodeList->broadcastToNodes(avatarPacket, NodeSet() << NodeType::AvatarMixer);
+                _lastAvatarPacket = avatarPacket;
+                _lastAvatarPacketTime = now;
+            }
 
             if (_isListeningToAudioStream || _avatarSound) {
                 // if we have an avatar audio stream then send it out to our audio-mixer
@@ -435,18 +421,14 @@ void ScriptEngine::run() {
 
                 int16_t numAvailableSamples = SCRIPT_AUDIO_BUFFER_SAMPLES;
                 const int16_t* nextSoundOutput = NULL;
+                QVector<int16_t> soundSamples;
 
                 if (_avatarSound) {
-
-                    const QByteArray& soundByteArray = _avatarSound->getByteArray();
-                    nextSoundOutput = reinterpret_cast<const int16_t*>(soundByteArray.data()
-                                                                       + _numAvatarSoundSentBytes);
-
-                    int numAvailableBytes = (soundByteArray.size() - _numAvatarSoundSentBytes) > SCRIPT_AUDIO_BUFFER_BYTES
-                        ? SCRIPT_AUDIO_BUFFER_BYTES
-                        : soundByteArray.size() - _numAvatarSoundSentBytes;
-                    numAvailableSamples = numAvailableBytes / sizeof(int16_t);
-
+                    // read the sound as it is decoded, rather than waiting for all of it to download
+                    soundSamples.resize(SCRIPT_AUDIO_BUFFER_SAMPLES);
+                    numAvailableSamples = _avatarSound->readSamples(_numAvatarSoundSentBytes / sizeof(int16_t),
+                                                                    soundSamples.data(), SCRIPT_AUDIO_BUFFER_SAMPLES);
+                    nextSoundOutput = soundSamples.constData();
 
                     // check if the all of the _numAvatarAudioBufferSamples to be sent are silence
                     for (int i = 0; i < numAvailableSamples; ++i) {
@@ -456,8 +438,8 @@ void ScriptEngine::run() {
                         }
                     }
 
-                    _numAvatarSoundSentBytes += numAvailableBytes;
-                    if (_numAvatarSoundSentBytes == soundByteArray.size()) {
+                    _numAvatarSoundSentBytes += numAvailableSamples * sizeof(int16_t);
+                    if (numAvailableSamples < SCRIPT_AUDIO_BUFFER_SAMPLES && _avatarSound->isComplete()) {
                         // we're done with this sound object - so set our pointer back to NULL
                         // and our sent bytes back to zero
                         _avatarSound = NULL;
@@ -482,6 +464,9 @@ void ScriptEngine::run() {
                 packetStream.writeRawData(reinterpret_cast<const char*>(&_avatarData->getPosition()), sizeof(glm::vec3));
                 glm::quat headOrientation = _avatarData->getHeadOrientation();
                 packetStream.writeRawData(reinterpret_cast<const char*>(&headOrientation), sizeof(glm::quat));
+                
+                // scripted avatar audio is sent, and mixed back, uncompressed
+                packetStream << (quint8) AudioCodec::PCM;
 
                 if (silentFrame) {
                     if (!_isListeningToAudioStream) {
@@ -531,35 +516,9 @@ void ScriptEngine::run() {
     // kill the avatar identity timer
     delete _avatarIdentityTimer;
 
-    if (_voxelsScriptingInterface.getVoxelPacketSender()->serversExist()) {
-        // release the queue of edit voxel messages.
-        _voxelsScriptingInterface.getVoxelPacketSender()->releaseQueuedMessages();
-
-        // since we're in non-threaded mode, call process so that the packets are sent
-        if (!_voxelsScriptingInterface.getVoxelPacketSender()->isThreaded()) {
-            _voxelsScriptingInterface.getVoxelPacketSender()->process();
-        }
-    }
-
-    if (_particlesScriptingInterface.getParticlePacketSender()->serversExist()) {
-        // release the queue of edit voxel messages.
-        _particlesScriptingInterface.getParticlePacketSender()->releaseQueuedMessages();
-
-        // since we're in non-threaded mode, call process so that the packets are sent
-        if (!_particlesScriptingInterface.getParticlePacketSender()->isThreaded()) {
-            _particlesScriptingInterface.getParticlePacketSender()->process();
-        }
-    }
-
-    if (_modelsScriptingInterface.getModelPacketSender()->serversExist()) {
-        // release the queue of edit voxel messages.
-        _modelsScriptingInterface.getModelPacketSender()->releaseQueuedMessages();
-
-        // since we're in non-threaded mode, call process so that the packets are sent
-        if (!_modelsScriptingInterface.getModelPacketSender()->isThreaded()) {
-            _modelsScriptingInterface.getModelPacketSender()->process();
-        }
-    }
+    sendEditPackets(_voxelsScriptingInterface.getVoxelPacketSender());
+    sendEditPackets(_particlesScriptingInterface.getParticlePacketSender());
+    sendEditPackets(_modelsScriptingInterface.getModelPacketSender());
 
     // If we were on a thread, then wait till it's done
     if (thread()) {
@@ -575,6 +534,14 @@ void ScriptEngine::run() {
 void ScriptEngine::stop() {
     _isFinished = true;
     emit runningStateChanged();
+    
+    // the engine may be waiting for events on its own thread
+    if (thread() != QThread::currentThread()) {
+        QAbstractEventDispatcher* eventDispatcher = QAbstractEventDispatcher::instance(thread());
+        if (eventDispatcher) {
+            eventDispatcher->wakeUp();
+        }
+    }
 }
 
 void ScriptEngine::timerFired() {
@@ -652,33 +619,21 @@ void ScriptEngine::print(const QString& message) {
 void ScriptEngine::include(const QString& includeFile) {
     QUrl url = resolveInclude(includeFile);
     QString includeContents;
+    if (!ScriptSourceCache::getInstance().getSource(url, includeContents)) {
+        qDebug() << "ERROR Loading file:" << url.toString();
+        emit errorMessage("ERROR Loading file:" + url.toString());
+        return;
+    }
 
-    if (url.scheme() == "http" || url.scheme() == "ftp") {
-        NetworkAccessManager& networkAccessManager = NetworkAccessManager::getInstance();
-        QNetworkReply* reply = networkAccessManager.get(QNetworkRequest(url));
-        qDebug() << "Downloading included script at" << includeFile;
-        QEventLoop loop;
-        QObject::connect(reply, SIGNAL(finished()), &loop, SLOT(quit()));
-        loop.exec();
-        includeContents = reply->readAll();
-    } else {
-#ifdef _WIN32
-        QString fileName = url.toString();
-#else
-        QString fileName = url.toLocalFile();
-#endif
-        QFile scriptFile(fileName);
-        if (scriptFile.open(QFile::ReadOnly | QFile::Text)) {
-            qDebug() << "Loading file:" << fileName;
-            QTextStream in(&scriptFile);
-            includeContents = in.readAll();
-        } else {
-            qDebug() << "ERROR Loading file:" << fileName;
-            emit errorMessage("ERROR Loading file:" + fileName);
-        }
+    // reuse the compiled program if the script has already included the same source
+    QString key = url.toString();
+    QScriptProgram program = _includePrograms.value(key);
+    if (program.isNull() || program.sourceCode() != includeContents) {
+        program = QScriptProgram(includeContents, key);
+        _includePrograms.insert(key, program);
     }
 
-    QScriptValue result = _engine.evaluate(includeContents);
+    QScriptValue result = _engine.evaluate(program);
     if (_engine.hasUncaughtException()) {
         int line = _engine.uncaughtExceptionLineNumber();
         qDebug() << "Uncaught exception at (" << includeFile << ") line" << line << ":" << result.toString();
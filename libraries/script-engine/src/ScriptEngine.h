@@ -17,6 +17,7 @@
 #include <QtCore/QObject>
 #include <QtCore/QUrl>
 #include <QtScript/QScriptEngine>
+#include <QtScript/QScriptProgram>
 
 #include <AnimationCache.h>
 #include <AudioScriptingInterface.h>
@@ -148,7 +149,12 @@ private:
     ScriptUUID _uuidLibrary;
     AnimationCache _animationCache;
 
+    QHash<QString, QScriptProgram> _includePrograms; /// the compiled includes, by URL
+
     QHash<QUuid, quint16> _outgoingScriptAudioSequenceNumbers;
+    
+    QByteArray _lastAvatarPacket; /// the avatar data last sent to the mixer
+    quint64 _lastAvatarPacketTime;
 };
 
 #endif // hifi_ScriptEngine_h
@@ -0,0 +1,119 @@
+//
+//  ScriptSourceCache.cpp
+//  libraries/script-engine/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#include <QtCore/QDateTime>
+#include <QtCore/QDebug>
+#include <QtCore/QEventLoop>
+#include <QtCore/QFile>
+#include <QtCore/QFileInfo>
+#include <QtCore/QMutexLocker>
+#include <QtCore/QTextStream>
+#include <QtNetwork/QNetworkReply>
+#include <QtNetwork/QNetworkRequest>
+
+#include <NetworkAccessManager.h>
+
+#include "ScriptSourceCache.h"
+
+const int HTTP_OK = 200;
+const int HTTP_NOT_MODIFIED = 304;
+
+ScriptSourceCache& ScriptSourceCache::getInstance() {
+    static ScriptSourceCache instance;
+    return instance;
+}
+
+bool ScriptSourceCache::getSource(const QUrl& url, QString& source) {
+    if (url.scheme() == "http" || url.scheme() == "https" || url.scheme() == "ftp") {
+        return getNetworkSource(url, source);
+    }
+    // a scheme of one letter is a windows drive letter rather than a scheme
+    const int WINDOWS_DRIVE_LETTER_SIZE = 1;
+    return getFileSource(url.scheme().size() <= WINDOWS_DRIVE_LETTER_SIZE ? url.toString() : url.toLocalFile(), source);
+}
+
+bool ScriptSourceCache::getNetworkSource(const QUrl& url, QString& source) {
+    QString key = url.toString();
+    QNetworkRequest request(url);
+    Entry entry;
+    bool cached = false;
+    {
+        QMutexLocker locker(&_mutex);
+        QHash<QString, Entry>::const_iterator it = _entries.constFind(key);
+        if (it != _entries.constEnd()) {
+            entry = it.value();
+            cached = true;
+        }
+    }
+    if (cached) {
+        if (!entry.entityTag.isEmpty()) {
+            request.setRawHeader("If-None-Match", entry.entityTag);
+        }
+        if (!entry.lastModified.isEmpty()) {
+            request.setRawHeader("If-Modified-Since", entry.lastModified);
+        }
+    }
+    
+    QNetworkReply* reply = NetworkAccessManager::getInstance().get(request);
+    qDebug() << "Downloading script at" << url;
+    QEventLoop loop;
+    QObject::connect(reply, SIGNAL(finished()), &loop, SLOT(quit()));
+    loop.exec();
+    reply->deleteLater();
+    
+    int status = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+    if (cached && status == HTTP_NOT_MODIFIED) {
+        source = entry.source;
+        return true;
+    }
+    if (reply->error() != QNetworkReply::NoError || (status != HTTP_OK && url.scheme() != "ftp")) {
+        return false;
+    }
+    entry.source = reply->readAll();
+    entry.entityTag = reply->rawHeader("ETag");
+    entry.lastModified = reply->rawHeader("Last-Modified");
+    source = entry.source;
+    
+    // without a validator, we couldn't tell whether it changed, so there's no point in keeping it
+    if (!(entry.entityTag.isEmpty() && entry.lastModified.isEmpty())) {
+        QMutexLocker locker(&_mutex);
+        _entries.insert(key, entry);
+    }
+    return true;
+}
+
+bool ScriptSourceCache::getFileSource(const QString& fileName, QString& source) {
+    QFileInfo info(fileName);
+    if (!info.exists()) {
+        return false;
+    }
+    QByteArray lastModified = QByteArray::number(info.lastModified().toMSecsSinceEpoch());
+    {
+        QMutexLocker locker(&_mutex);
+        QHash<QString, Entry>::const_iterator it = _entries.constFind(fileName);
+        if (it != _entries.constEnd() && it.value().lastModified == lastModified) {
+            source = it.value().source;
+            return true;
+        }
+    }
+    QFile scriptFile(fileName);
+    if (!scriptFile.open(QFile::ReadOnly | QFile::Text)) {
+        return false;
+    }
+    qDebug() << "Loading file:" << fileName;
+    QTextStream in(&scriptFile);
+    Entry entry;
+    entry.source = source = in.readAll();
+    entry.lastModified = lastModified;
+    
+    QMutexLocker locker(&_mutex);
+    _entries.insert(fileName, entry);
+    return true;
+}
@@ -0,0 +1,50 @@
+//
+//  ScriptSourceCache.h
+//  libraries/script-engine/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#ifndef hifi_ScriptSourceCache_h
+#define hifi_ScriptSourceCache_h
+
+#include <QtCore/QByteArray>
+#include <QtCore/QHash>
+#include <QtCore/QMutex>
+#include <QtCore/QString>
+#include <QtCore/QUrl>
+
+/// Holds the sources of the scripts and includes loaded in this process, shared by all script engines, so that a library
+/// included by several scripts is downloaded once and afterwards only revalidated against its ETag or modification time.
+class ScriptSourceCache {
+public:
+
+    static ScriptSourceCache& getInstance();
+
+    /// loads the source of the script at the given URL, from the network or the local file system, reusing the cached
+    /// copy if it hasn't changed; safe to call from any thread
+    /// \return true if the source was loaded
+    bool getSource(const QUrl& url, QString& source);
+
+private:
+
+    ScriptSourceCache() { }
+
+    bool getNetworkSource(const QUrl& url, QString& source);
+    bool getFileSource(const QString& fileName, QString& source);
+
+    class Entry {
+    public:
+        QString source;
+        QByteArray entityTag; /// the ETag of a download
+        QByteArray lastModified; /// the Last-Modified header of a download, or the modification time of a file
+    };
+
+    QMutex _mutex;
+    QHash<QString, Entry> _entries;
+};
+
+#endif // hifi_ScriptSourceCache_h
@@ -16,6 +16,7 @@
 
 #include <NetworkAccessManager.h>
 
+#include "ScriptArrayBuffer.h"
 #include "XMLHttpRequestClass.h"
 
 XMLHttpRequestClass::XMLHttpRequestClass(QScriptEngine* engine) :
@@ -31,6 +32,7 @@ XMLHttpRequestClass::XMLHttpRequestClass(QScriptEngine* engine) :
     _responseData(""),
     _onTimeout(QScriptValue::NullValue),
     _onReadyStateChange(QScriptValue::NullValue),
+    _onProgress(QScriptValue::NullValue),
     _readyState(XMLHttpRequestClass::UNSENT),
     _errorCode(QNetworkReply::NoError),
     _timeout(0),
@@ -81,15 +83,35 @@ void XMLHttpRequestClass::requestMetaDataChanged() {
 
         QUrl newUrl = _url.resolved(redirect.toUrl().toString());
         _request.setUrl(newUrl);
+        _rawResponseData.clear();
         doSend();
+        return;
+    }
+
+    // set aside room for the whole response up front, rather than growing the buffer a chunk at a time
+    qint64 contentLength = _reply->header(QNetworkRequest::ContentLengthHeader).toLongLong();
+    if (contentLength > _rawResponseData.capacity()) {
+        _rawResponseData.reserve((int)qMin(contentLength, (qint64)MAXIMUM_RESPONSE_RESERVE));
     }
 }
 
+void XMLHttpRequestClass::requestReadyRead() {
+    // the response is gathered as it arrives, so that it's there for responseText and onprogress while loading
+    _rawResponseData.append(_reply->readAll());
+}
+
 void XMLHttpRequestClass::requestDownloadProgress(qint64 bytesReceived, qint64 bytesTotal) {
     if (_readyState == OPENED && bytesReceived > 0) {
         setReadyState(HEADERS_RECEIVED);
         setReadyState(LOADING);
     }
+    if (_readyState == LOADING && _onProgress.isFunction()) {
+        QScriptValue event = _engine->newObject();
+        event.setProperty("loaded", QScriptValue((double)bytesReceived));
+        event.setProperty("total", QScriptValue((double)qMax(bytesTotal, (qint64)0)));
+        event.setProperty("lengthComputable", QScriptValue(bytesTotal >= 0));
+        _onProgress.call(QScriptValue::NullValue, QScriptValueList() << event);
+    }
 }
 
 QScriptValue XMLHttpRequestClass::getAllResponseHeaders() const {
@@ -193,15 +215,16 @@ void XMLHttpRequestClass::requestFinished() {
         _rawResponseData.append(_reply->readAll());
 
         if (_responseType == "json") {
-            _responseData = _engine->evaluate("(" + QString(_rawResponseData.data()) + ")");
+            _responseData = _engine->evaluate("(" + QString::fromUtf8(_rawResponseData) + ")");
             if (_responseData.isError()) {
                 _engine->clearExceptions();
                 _responseData = QScriptValue::NullValue;
             }
         } else if (_responseType == "arraybuffer") {
-            _responseData = QScriptValue(_rawResponseData.data());
+            // the bytes are shared with the buffer as they are, NULs and all
+            _responseData = ScriptArrayBuffer::toScriptValue(_engine, _rawResponseData);
         } else {
-            _responseData = QScriptValue(QString(_rawResponseData.data()));
+            _responseData = QScriptValue(QString::fromUtf8(_rawResponseData));
         }
     }
     setReadyState(DONE);
@@ -224,6 +247,7 @@ void XMLHttpRequestClass::connectToReply(QNetworkReply* reply) {
     connect(reply, SIGNAL(error(QNetworkReply::NetworkError)), this, SLOT(requestError(QNetworkReply::NetworkError)));
     connect(reply, SIGNAL(downloadProgress(qint64, qint64)), this, SLOT(requestDownloadProgress(qint64, qint64)));
     connect(reply, SIGNAL(metaDataChanged()), this, SLOT(requestMetaDataChanged()));
+    connect(reply, SIGNAL(readyRead()), this, SLOT(requestReadyRead()));
 }
 
 void XMLHttpRequestClass::disconnectFromReply(QNetworkReply* reply) {
@@ -231,4 +255,5 @@ void XMLHttpRequestClass::disconnectFromReply(QNetworkReply* reply) {
     disconnect(reply, SIGNAL(error(QNetworkReply::NetworkError)), this, SLOT(requestError(QNetworkReply::NetworkError)));
     disconnect(reply, SIGNAL(downloadProgress(qint64, qint64)), this, SLOT(requestDownloadProgress(qint64, qint64)));
     disconnect(reply, SIGNAL(metaDataChanged()), this, SLOT(requestMetaDataChanged()));
+    disconnect(reply, SIGNAL(readyRead()), this, SLOT(requestReadyRead()));
 }
@@ -41,11 +41,15 @@ class XMLHttpRequestClass : public QObject {
     // Callbacks
     Q_PROPERTY(QScriptValue ontimeout READ getOnTimeout WRITE setOnTimeout)
     Q_PROPERTY(QScriptValue onreadystatechange READ getOnReadyStateChange WRITE setOnReadyStateChange)
+    Q_PROPERTY(QScriptValue onprogress READ getOnProgress WRITE setOnProgress)
 public:
     XMLHttpRequestClass(QScriptEngine* engine);
     ~XMLHttpRequestClass();
 
     static const int MAXIMUM_REDIRECTS = 5;
+    
+    /// the most bytes set aside ahead of a response on the strength of its Content-Length
+    static const int MAXIMUM_RESPONSE_RESERVE = 64 * 1024 * 1024;
     enum ReadyState {
         UNSENT = 0,
         OPENED,
@@ -65,7 +69,7 @@ public:
     int getTimeout() const { return _timeout; }
     void setTimeout(int timeout) { _timeout = timeout; }
     QScriptValue getResponse() const { return _responseData; }
-    QScriptValue getResponseText() const { return QScriptValue(QString(_rawResponseData.data())); }
+    QScriptValue getResponseText() const { return QScriptValue(QString::fromUtf8(_rawResponseData)); }
     QString getResponseType() const { return _responseType; }
     void setResponseType(const QString& responseType) { _responseType = responseType; }
     QScriptValue getReadyState() const { return QScriptValue(_readyState); }
@@ -77,6 +81,8 @@ public:
     void setOnTimeout(QScriptValue function) { _onTimeout = function; }
     QScriptValue getOnReadyStateChange() const { return _onReadyStateChange; }
     void setOnReadyStateChange(QScriptValue function) { _onReadyStateChange = function; }
+    QScriptValue getOnProgress() const { return _onProgress; }
+    void setOnProgress(QScriptValue function) { _onProgress = function; }
 
 public slots:
     void abort();
@@ -110,6 +116,7 @@ private:
     QScriptValue _responseData;
     QScriptValue _onTimeout;
     QScriptValue _onReadyStateChange;
+    QScriptValue _onProgress;
     ReadyState _readyState;
     QNetworkReply::NetworkError _errorCode;
     int _timeout;
@@ -120,6 +127,7 @@ private slots:
     void requestFinished();
     void requestError(QNetworkReply::NetworkError code);
     void requestMetaDataChanged();
+    void requestReadyRead();
     void requestDownloadProgress(qint64 bytesReceived, qint64 bytesTotal);
     void requestTimeout();
 };
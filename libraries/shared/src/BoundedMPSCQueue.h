@@ -0,0 +1,218 @@
+//
+//  BoundedMPSCQueue.h
+//  libraries/shared/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#ifndef hifi_BoundedMPSCQueue_h
+#define hifi_BoundedMPSCQueue_h
+
+#include <climits>
+
+#include <QtCore/QAtomicInt>
+#include <QtCore/QMutex>
+#include <QtCore/QWaitCondition>
+
+#include "SharedUtil.h"
+
+/// A queue of a fixed capacity that any number of threads push onto while one thread pops off of it, without locks.
+/// Each cell carries a sequence number that tells a pusher whether the cell is free for the index it claimed and the
+/// popper whether the cell has been filled, so pushers only contend on claiming an index. The cells are reused, so
+/// once they are full of items that share their data (such as QByteArrays) nothing is allocated to queue one.
+/// The popper can sleep on waitForItems, which a push only wakes (taking the lock) if the popper is asleep.
+template<typename T>
+class BoundedMPSCQueue {
+public:
+    /// the capacity is rounded up to the next power of two
+    BoundedMPSCQueue(int minCapacity);
+    ~BoundedMPSCQueue() { delete[] _cells; }
+
+    int getCapacity() const { return _capacity; }
+
+    /// pushes a copy of item, returns false without pushing it if the queue is full. Safe to call from any thread.
+    bool push(const T& item);
+
+    /// pops the oldest item into item, returns false if there are none. Only to be called from the popping thread.
+    bool pop(T& item) { quint64 waitUsecs; return pop(item, waitUsecs); }
+    
+    /// pops the oldest item into item along with the usecs it waited in the queue
+    bool pop(T& item, quint64& waitUsecs);
+
+    /// sleeps the popping thread until an item is pushed, wakeAll is called or maxWait msecs pass, unless there are
+    /// items already
+    void waitForItems(unsigned long maxWait = ULONG_MAX);
+
+    /// wakes the popping thread from waitForItems, such as when it should stop
+    void wakeAll();
+
+    /// the number of items waiting, safe to call from either side
+    int getDepth() const { return (int) ((unsigned int) _pushIndex.load() - (unsigned int) _popIndex.load()); }
+    bool isEmpty() const { return getDepth() <= 0; }
+
+    /// the most items there have been waiting at once
+    int getMaxDepth() const { return _maxDepth.load(); }
+
+    /// the number of pushes turned away because the queue was full
+    int getNumFullPushes() const { return _numFullPushes.load(); }
+
+    quint64 getNumPopped() const { return _numPopped; }
+
+    /// the average time the items popped so far waited in the queue
+    quint64 getAverageWaitUsecs() const { return (_numPopped == 0) ? 0 : _totalWaitUsecs / _numPopped; }
+
+    /// starts the counters over, only to be called from the popping thread
+    void resetStats();
+
+private:
+    // disallow copying of BoundedMPSCQueue objects
+    BoundedMPSCQueue(const BoundedMPSCQueue&);
+    BoundedMPSCQueue& operator= (const BoundedMPSCQueue&);
+
+    class Cell {
+    public:
+        QAtomicInt sequence; /// the index the cell can be pushed at, after that the index plus one once it is filled
+        T item;
+        quint64 pushUsecs;
+    };
+
+    int _capacity;
+    unsigned int _indexMask;
+    Cell* _cells;
+
+    QAtomicInt _pushIndex; /// claimed by the pushers
+    QAtomicInt _popIndex; /// only stored by the popper
+
+    QAtomicInt _isPopperWaiting;
+    QMutex _waitMutex;
+    QWaitCondition _hasItems;
+
+    QAtomicInt _maxDepth;
+    QAtomicInt _numFullPushes;
+    quint64 _numPopped;
+    quint64 _totalWaitUsecs;
+};
+
+template<typename T>
+BoundedMPSCQueue<T>::BoundedMPSCQueue(int minCapacity) :
+    _capacity(1),
+    _indexMask(0),
+    _cells(NULL),
+    _pushIndex(0),
+    _popIndex(0),
+    _isPopperWaiting(0),
+    _waitMutex(),
+    _hasItems(),
+    _maxDepth(0),
+    _numFullPushes(0),
+    _numPopped(0),
+    _totalWaitUsecs(0)
+{
+    while (_capacity < minCapacity) {
+        _capacity <<= 1;
+    }
+    _indexMask = _capacity - 1;
+
+    _cells = new Cell[_capacity];
+    for (int i = 0; i < _capacity; i++) {
+        _cells[i].sequence.store(i);
+        _cells[i].pushUsecs = 0;
+    }
+}
+
+template<typename T>
+bool BoundedMPSCQueue<T>::push(const T& item) {
+    unsigned int index = _pushIndex.load();
+    Cell* cell;
+    forever {
+        cell = &_cells[index & _indexMask];
+
+        // the indices run freely, so they are compared by their difference
+        int difference = (int) ((unsigned int) cell->sequence.loadAcquire() - index);
+        if (difference == 0) {
+            if (_pushIndex.testAndSetOrdered(index, index + 1)) {
+                break;
+            }
+            index = _pushIndex.load();
+
+        } else if (difference < 0) {
+            // the cell still holds the item pushed a lap ago
+            _numFullPushes.fetchAndAddRelaxed(1);
+            return false;
+
+        } else {
+            // another pusher claimed this index first
+            index = _pushIndex.load();
+        }
+    }
+
+    cell->item = item;
+    cell->pushUsecs = usecTimestampNow();
+    cell->sequence.storeRelease(index + 1);
+
+    int depth = (int) (index + 1 - (unsigned int) _popIndex.load());
+    int maxDepth = _maxDepth.load();
+    while (depth > maxDepth && !_maxDepth.testAndSetRelaxed(maxDepth, depth)) {
+        maxDepth = _maxDepth.load();
+    }
+
+    // the ordered read keeps the item's store ahead of it, so a popper that didn't see the item is seen to be waiting
+    if (_isPopperWaiting.fetchAndAddOrdered(0)) {
+        QMutexLocker locker(&_waitMutex);
+        _hasItems.wakeAll();
+    }
+    return true;
+}
+
+template<typename T>
+bool BoundedMPSCQueue<T>::pop(T& item, quint64& waitUsecs) {
+    unsigned int index = _popIndex.load();
+    Cell& cell = _cells[index & _indexMask];
+
+    if ((int) ((unsigned int) cell.sequence.loadAcquire() - (index + 1)) < 0) {
+        // empty, or the pusher that claimed this index hasn't filled it yet
+        return false;
+    }
+
+    item = cell.item;
+    cell.item = T(); // let go of whatever the item shares
+
+    waitUsecs = usecTimestampNow() - cell.pushUsecs;
+    _totalWaitUsecs += waitUsecs;
+    _numPopped++;
+
+    // the cell is free for the pusher a lap from now
+    cell.sequence.storeRelease(index + _capacity);
+    _popIndex.storeRelease(index + 1);
+    return true;
+}
+
+template<typename T>
+void BoundedMPSCQueue<T>::waitForItems(unsigned long maxWait) {
+    QMutexLocker locker(&_waitMutex);
+
+    _isPopperWaiting.fetchAndStoreOrdered(1);
+    if (isEmpty()) {
+        _hasItems.wait(&_waitMutex, maxWait);
+    }
+    _isPopperWaiting.fetchAndStoreOrdered(0);
+}
+
+template<typename T>
+void BoundedMPSCQueue<T>::wakeAll() {
+    QMutexLocker locker(&_waitMutex);
+    _hasItems.wakeAll();
+}
+
+template<typename T>
+void BoundedMPSCQueue<T>::resetStats() {
+    _maxDepth.store(getDepth());
+    _numFullPushes.store(0);
+    _numPopped = 0;
+    _totalWaitUsecs = 0;
+}
+
+#endif // hifi_BoundedMPSCQueue_h
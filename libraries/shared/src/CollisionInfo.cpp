@@ -55,6 +55,11 @@ void CollisionInfo::apply() {
     shapeA->accumulateDelta(massB / totalMass, -_penetration);
 }
 
+void CollisionList::setMaxSize(int maxSize) {
+    _maxSize = glm::max(maxSize, _size);
+    _collisions.resize(_maxSize);
+}
+
 CollisionInfo* CollisionList::getNewCollision() {
     // return pointer to existing CollisionInfo, or NULL of list is full
     return (_size < _maxSize) ? &(_collisions[_size++]) : NULL;
@@ -79,6 +79,12 @@ public:
     /// \return true if list is full
     bool isFull() const { return _size == _maxSize; }
 
+    /// \return the most collisions the list can hold
+    int getMaxSize() const { return _maxSize; }
+
+    /// Lets the list hold more collisions, keeping those it has.  Pointers to the collisions are invalidated.
+    void setMaxSize(int maxSize);
+
     /// \return number of valid collisions
     int size() const { return _size; }
 
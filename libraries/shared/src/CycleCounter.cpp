@@ -0,0 +1,53 @@
+//
+//  CycleCounter.cpp
+//  libraries/shared/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#include <QtCore/QElapsedTimer>
+
+#include "CycleCounter.h"
+
+#ifdef HIFI_CYCLE_COUNTER_TSC
+
+// long enough for the rate to be within a fraction of a percent
+const qint64 CALIBRATION_NSECS = 10 * 1000 * 1000;
+
+static double calibrateUsecsPerCycle() {
+    QElapsedTimer calibrationTimer;
+    calibrationTimer.start();
+    quint64 startCycles = cycleCounterNow();
+    qint64 elapsedNsecs;
+    do {
+        elapsedNsecs = calibrationTimer.nsecsElapsed();
+    } while (elapsedNsecs < CALIBRATION_NSECS);
+    quint64 elapsedCycles = cycleCounterNow() - startCycles;
+    return elapsedNsecs / 1000.0 / qMax(elapsedCycles, (quint64)1);
+}
+
+float cycleCountsToUsecs(quint64 cycleCounts) {
+    static double usecsPerCycle = calibrateUsecsPerCycle();
+    return (float)(cycleCounts * usecsPerCycle);
+}
+
+#else
+
+quint64 cycleCounterFallbackNow() {
+    static QElapsedTimer referenceTimer;
+    static bool isStarted = false;
+    if (!isStarted) {
+        referenceTimer.start();
+        isStarted = true;
+    }
+    return referenceTimer.nsecsElapsed();
+}
+
+float cycleCountsToUsecs(quint64 cycleCounts) {
+    return cycleCounts / 1000.0f;
+}
+
+#endif
@@ -0,0 +1,42 @@
+//
+//  CycleCounter.h
+//  libraries/shared/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#ifndef hifi_CycleCounter_h
+#define hifi_CycleCounter_h
+
+#include <QtCore/QtGlobal>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#define HIFI_CYCLE_COUNTER_TSC
+#include <intrin.h>
+#elif defined(__x86_64__) || defined(__i386__)
+#define HIFI_CYCLE_COUNTER_TSC
+#include <x86intrin.h>
+#endif
+
+#ifndef HIFI_CYCLE_COUNTER_TSC
+quint64 cycleCounterFallbackNow();
+#endif
+
+/// A timestamp in the CPU's timestamp counter where it has one, which is far cheaper to read than usecTimestampNow(),
+/// or in nsecs otherwise. Only the difference of two of them means anything, and only on the same machine.
+inline quint64 cycleCounterNow() {
+#ifdef HIFI_CYCLE_COUNTER_TSC
+    return __rdtsc();
+#else
+    return cycleCounterFallbackNow();
+#endif
+}
+
+/// Converts a difference of cycleCounterNow() timestamps to usecs. The first call measures the counter's rate, which
+/// takes 10 msecs.
+float cycleCountsToUsecs(quint64 cycleCounts);
+
+#endif // hifi_CycleCounter_h
@@ -0,0 +1,31 @@
+//
+//  FixedTimestep.cpp
+//  libraries/shared/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#include "FixedTimestep.h"
+
+FixedTimestep::FixedTimestep(float stepTime, int maxStepsPerUpdate) :
+    _stepTime(stepTime),
+    _maxStepsPerUpdate(maxStepsPerUpdate),
+    _accumulatedTime(0.0f),
+    _numClampedUpdates(0) {
+}
+
+int FixedTimestep::update(float deltaTime) {
+    _accumulatedTime += deltaTime;
+    int steps = (int)(_accumulatedTime / _stepTime);
+    if (steps > _maxStepsPerUpdate) {
+        // drop what we can't catch up on, keeping the fraction of a step so that interpolation stays smooth
+        _accumulatedTime -= (steps - _maxStepsPerUpdate) * _stepTime;
+        steps = _maxStepsPerUpdate;
+        _numClampedUpdates++;
+    }
+    _accumulatedTime -= steps * _stepTime;
+    return steps;
+}
@@ -0,0 +1,39 @@
+//
+//  FixedTimestep.h
+//  libraries/shared/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#ifndef hifi_FixedTimestep_h
+#define hifi_FixedTimestep_h
+
+/// Turns the variable times between frames into whole steps of a fixed length, so that a simulation advances the same
+/// way whatever the frame rate. Time left over from one frame carries into the next, and after a long frame the steps
+/// are clamped rather than caught up, so a stall doesn't snowball into a longer one.
+class FixedTimestep {
+public:
+    FixedTimestep(float stepTime, int maxStepsPerUpdate);
+
+    /// adds the time since the last update, returns the number of steps to take now
+    int update(float deltaTime);
+
+    float getStepTime() const { return _stepTime; }
+
+    /// the fraction of a step between the last step taken and now, for blending the last two states when rendering
+    float getInterpolation() const { return _accumulatedTime / _stepTime; }
+
+    /// \return number of updates that dropped time because they would have taken more than the most steps
+    int getNumClampedUpdates() const { return _numClampedUpdates; }
+
+private:
+    float _stepTime;
+    int _maxStepsPerUpdate;
+    float _accumulatedTime;
+    int _numClampedUpdates;
+};
+
+#endif // hifi_FixedTimestep_h
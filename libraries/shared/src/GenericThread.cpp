@@ -12,11 +12,17 @@
 #include <QDebug>
 
 #include "GenericThread.h"
+#include "SharedUtil.h"
 
 
 GenericThread::GenericThread() :
     _stopThread(false),
-    _isThreaded(false) // assume non-threaded, must call initialize()
+    _isThreaded(false), // assume non-threaded, must call initialize()
+    _thread(NULL),
+    _isWaiting(0),
+    _wakeRequested(0),
+    _startTime(usecMonotonicNow()),
+    _idleUsecs(0)
 {
 }
 
@@ -27,8 +33,9 @@ GenericThread::~GenericThread() {
     }
 }
 
-void GenericThread::initialize(bool isThreaded) {
+void GenericThread::initialize(bool isThreaded, QThread::Priority priority) {
     _isThreaded = isThreaded;
+    _startTime = usecMonotonicNow();
     if (_isThreaded) {
         _thread = new QThread(this);
 
@@ -38,7 +45,7 @@ void GenericThread::initialize(bool isThreaded) {
         this->moveToThread(_thread);
 
         // Starts an event loop, and emits _thread->started()
-        _thread->start();
+        _thread->start(priority);
     }
 }
 
@@ -46,6 +53,9 @@ void GenericThread::terminate() {
     if (_isThreaded) {
         _stopThread = true;
         
+        // cut short any wait, rather than joining the thread once it's slept its fill
+        wakeUp();
+        
         terminating();
 
         if (_thread) {
@@ -77,3 +87,50 @@ void GenericThread::threadRoutine() {
     }
     emit finished();
 }
+
+void GenericThread::wakeUp() {
+    // ordered so that either we see the thread waiting, or it sees the request before it sleeps
+    _wakeRequested.fetchAndStoreOrdered(1);
+    if (_isWaiting.fetchAndAddOrdered(0)) {
+        _wakeMutex.lock();
+        _wakeCondition.wakeAll();
+        _wakeMutex.unlock();
+    }
+}
+
+quint64 GenericThread::getRunningUsecs() const {
+    return usecMonotonicNow() - _startTime;
+}
+
+bool GenericThread::waitUntil(quint64 deadline) {
+    if (!_isThreaded) {
+        return false;
+    }
+    quint64 waitStart = usecMonotonicNow();
+    _wakeMutex.lock();
+    _isWaiting.fetchAndStoreOrdered(1);
+    for (quint64 now = waitStart; now < deadline; now = usecMonotonicNow()) {
+        if (_wakeRequested.fetchAndAddOrdered(0) || _stopThread) {
+            break;
+        }
+        // the condition only waits whole msecs, so the last of the wait is slept off
+        quint64 remaining = deadline - now;
+        if (remaining < USECS_PER_MSEC) {
+            _wakeMutex.unlock();
+            usleep(remaining);
+            _wakeMutex.lock();
+            break;
+        }
+        _wakeCondition.wait(&_wakeMutex, remaining / USECS_PER_MSEC);
+    }
+    _isWaiting.fetchAndStoreOrdered(0);
+    _wakeMutex.unlock();
+    bool woken = _wakeRequested.fetchAndStoreOrdered(0);
+
+    _idleUsecs += usecMonotonicNow() - waitStart;
+    return woken || _stopThread;
+}
+
+bool GenericThread::waitFor(quint64 usecs) {
+    return waitUntil(usecMonotonicNow() + usecs);
+}
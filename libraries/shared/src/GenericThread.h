@@ -14,9 +14,11 @@
 #ifndef hifi_GenericThread_h
 #define hifi_GenericThread_h
 
+#include <QtCore/QAtomicInt>
 #include <QtCore/QObject>
 #include <QMutex>
 #include <QThread>
+#include <QWaitCondition>
 
 /// A basic generic "thread" class. Handles a single thread of control within the application. Can operate in non-threaded
 /// mode but caller must regularly call threadRoutine() method.
@@ -28,7 +30,8 @@ public:
 
     /// Call to start the thread.
     /// \param bool isThreaded true by default. false for non-threaded mode and caller must call threadRoutine() regularly.
-    void initialize(bool isThreaded = true);
+    /// \param QThread::Priority priority the priority of the thread, by default that of the thread starting it
+    void initialize(bool isThreaded = true, QThread::Priority priority = QThread::InheritPriority);
 
     /// Call to stop the thread
     void terminate();
@@ -40,6 +43,14 @@ public:
 
     bool isThreaded() const { return _isThreaded; }
 
+    /// Wakes the thread if it's waiting in waitUntil or waitFor, or has its next wait return right away. Only takes a
+    /// lock if the thread is actually asleep. Safe to call from any thread.
+    void wakeUp();
+
+    /// The usecs the thread has spent waiting for work since it was started, and the usecs since it was started.
+    quint64 getIdleUsecs() const { return _idleUsecs; }
+    quint64 getRunningUsecs() const;
+
 public slots:
     /// If you're running in non-threaded mode, you must call this regularly
     void threadRoutine();
@@ -57,12 +68,30 @@ protected:
 
     bool isStillRunning() const { return !_stopThread; }
 
+    /// Sleeps until the given time, by usecMonotonicNow, or until woken by wakeUp or terminate. Returns true if woken
+    /// early. In non-threaded mode it never sleeps, since the thread is the caller's.
+    bool waitUntil(quint64 deadline);
+
+    /// Sleeps for the given usecs, or until woken early, as waitUntil.
+    bool waitFor(quint64 usecs);
+
+    /// Counts time spent waiting some other way, such as on a queue, as idle.
+    void addIdleUsecs(quint64 usecs) { _idleUsecs += usecs; }
+
 protected:
     QMutex _mutex;
 
     bool _stopThread;
     bool _isThreaded;
     QThread* _thread;
+
+private:
+    QMutex _wakeMutex;
+    QWaitCondition _wakeCondition;
+    QAtomicInt _isWaiting;
+    QAtomicInt _wakeRequested;
+    quint64 _startTime;
+    quint64 _idleUsecs; /// only added to by the thread itself
 };
 
 #endif // hifi_GenericThread_h
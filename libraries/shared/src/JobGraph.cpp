@@ -0,0 +1,202 @@
+//
+//  JobGraph.cpp
+//  libraries/shared/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#include <QtCore/QRunnable>
+
+#include "PerfStat.h"
+#include "SharedUtil.h"
+
+#include "JobGraph.h"
+
+/// takes the ready jobs on one of the pool's threads
+class JobGraph::Worker : public QRunnable {
+public:
+    Worker(JobGraph* graph) : _graph(graph) { }
+    virtual void run() { _graph->runReadyJobs(false); }
+
+private:
+    JobGraph* _graph;
+};
+
+JobGraph::JobGraph(const QString& name, QThreadPool* threadPool) :
+    _name(name),
+    _threadPool(threadPool),
+    _unfinishedJobs(0),
+    _startedWorkers(0),
+    _criticalPathUsecs(0) {
+}
+
+JobGraph::~JobGraph() {
+    {
+        QMutexLocker locker(&_mutex);
+        while (_startedWorkers > 0) {
+            _jobsChanged.wait(&_mutex);
+        }
+    }
+    foreach (const Node& node, _nodes) {
+        delete node.job;
+    }
+}
+
+int JobGraph::addJob(const QString& name, Job* job) {
+    Node node;
+    node.job = job;
+    node.name = name;
+    node.timerID = PerformanceTimer::getTimerID(_name + "/" + name);
+    node.runsOnCallingThread = false;
+    node.waitingOn = 0;
+    node.start = 0;
+    node.end = 0;
+    _nodes.append(node);
+    return _nodes.size() - 1;
+}
+
+void JobGraph::addPrerequisite(int job, int prerequisite) {
+    // only the earlier jobs can be prerequisites, which keeps the graph free of cycles and in an order to be walked in
+    Q_ASSERT(prerequisite < job);
+    _nodes[job].prerequisites.append(prerequisite);
+    _nodes[prerequisite].dependents.append(job);
+}
+
+void JobGraph::setRunsOnCallingThread(int job) {
+    _nodes[job].runsOnCallingThread = true;
+}
+
+void JobGraph::run() {
+    {
+        QMutexLocker locker(&_mutex);
+        int workersNeeded = 0;
+        _unfinishedJobs = _nodes.size();
+        for (int i = 0; i < _nodes.size(); i++) {
+            Node& node = _nodes[i];
+            node.waitingOn = node.prerequisites.size();
+            if (node.waitingOn == 0) {
+                if (node.runsOnCallingThread) {
+                    _readyCallingThreadJobs.append(i);
+                } else {
+                    _readyJobs.append(i);
+                    workersNeeded++;
+                }
+            }
+        }
+        // this thread takes one of the jobs itself
+        startWorkers(workersNeeded - 1);
+    }
+    runReadyJobs(true);
+
+    recordCriticalPath();
+}
+
+void JobGraph::runReadyJobs(bool isCallingThread) {
+    QMutexLocker locker(&_mutex);
+    while (_unfinishedJobs > 0) {
+        int index = takeReadyJob(isCallingThread);
+        if (index == -1) {
+            if (!isCallingThread) {
+                // the pool's threads leave once there's nothing for them, and are started again for more
+                break;
+            }
+            // the calling thread waits for the jobs in progress elsewhere to finish or to make more ready
+            _jobsChanged.wait(&_mutex);
+            continue;
+        }
+        locker.unlock();
+        runJob(index);
+        locker.relock();
+
+        int workersNeeded = 0;
+        bool callingThreadJobsReady = false;
+        foreach (int dependent, _nodes.at(index).dependents) {
+            Node& node = _nodes[dependent];
+            if (--node.waitingOn == 0) {
+                if (node.runsOnCallingThread) {
+                    _readyCallingThreadJobs.append(dependent);
+                    callingThreadJobsReady = true;
+                } else {
+                    _readyJobs.append(dependent);
+                    workersNeeded++;
+                }
+            }
+        }
+        // this thread goes on to one of the jobs that became ready
+        startWorkers(workersNeeded - 1);
+        if (--_unfinishedJobs == 0 || callingThreadJobsReady || workersNeeded > 0) {
+            _jobsChanged.wakeAll();
+        }
+    }
+    if (!isCallingThread) {
+        _startedWorkers--;
+        _jobsChanged.wakeAll();
+    }
+}
+
+void JobGraph::startWorkers(int count) {
+    for (int i = 0; i < count; i++) {
+        _startedWorkers++;
+        _threadPool->start(new Worker(this));
+    }
+}
+
+int JobGraph::takeReadyJob(bool isCallingThread) {
+    if (isCallingThread && !_readyCallingThreadJobs.isEmpty()) {
+        int index = _readyCallingThreadJobs.last();
+        _readyCallingThreadJobs.pop_back();
+        return index;
+    }
+    if (!_readyJobs.isEmpty()) {
+        int index = _readyJobs.last();
+        _readyJobs.pop_back();
+        return index;
+    }
+    return -1;
+}
+
+void JobGraph::runJob(int index) {
+    Node& node = _nodes[index];
+    node.start = usecMonotonicNow();
+    {
+        PerformanceTimer perfTimer(node.timerID);
+        node.job->run();
+    }
+    node.end = usecMonotonicNow();
+}
+
+void JobGraph::recordCriticalPath() {
+    // the longest chain of jobs, each ending where the last of its prerequisites did, by how long they took
+    QVector<quint64> pathUsecs(_nodes.size());
+    QVector<int> pathPrevious(_nodes.size());
+    int pathEnd = -1;
+    for (int i = 0; i < _nodes.size(); i++) {
+        const Node& node = _nodes.at(i);
+        pathUsecs[i] = 0;
+        pathPrevious[i] = -1;
+        foreach (int prerequisite, node.prerequisites) {
+            if (pathPrevious[i] == -1 || pathUsecs.at(prerequisite) > pathUsecs.at(i)) {
+                pathUsecs[i] = pathUsecs.at(prerequisite);
+                pathPrevious[i] = prerequisite;
+            }
+        }
+        pathUsecs[i] += node.end - node.start;
+        if (pathEnd == -1 || pathUsecs.at(i) > pathUsecs.at(pathEnd)) {
+            pathEnd = i;
+        }
+    }
+    _criticalPath.clear();
+    _criticalPathUsecs = (pathEnd == -1) ? 0 : pathUsecs.at(pathEnd);
+    for (int i = pathEnd; i != -1; i = pathPrevious.at(i)) {
+        const Node& node = _nodes.at(i);
+        _criticalPath.prepend(node.name);
+        PerformanceTimer::addTimerRecord(_name + "/critical path/" + node.name, node.start, node.end - node.start);
+    }
+    if (pathEnd != -1) {
+        PerformanceTimer::addTimerRecord(_name + "/critical path", _nodes.at(pathEnd).end - _criticalPathUsecs,
+            _criticalPathUsecs);
+    }
+}
@@ -0,0 +1,111 @@
+//
+//  JobGraph.h
+//  libraries/shared/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#ifndef hifi_JobGraph_h
+#define hifi_JobGraph_h
+
+#include <QtCore/QMutex>
+#include <QtCore/QStringList>
+#include <QtCore/QThreadPool>
+#include <QtCore/QVector>
+#include <QtCore/QWaitCondition>
+
+/// A set of jobs, such as the stages of a frame's update, some of which have to wait for others, that's run as a whole
+/// as many times as needed. Each run hands the jobs whose prerequisites are done to the threads of a pool, while the
+/// thread that started the run takes them too rather than waiting idle, so that independent jobs go at once on the
+/// cores there are. The jobs are timed under their names, and the chain of them that held up the run the longest, its
+/// critical path, is recorded under the name of the graph.
+class JobGraph {
+public:
+    class Job {
+    public:
+        virtual ~Job() { }
+        virtual void run() = 0;
+    };
+
+    /// a job that calls a method of an object
+    template<class T> class MethodJob : public Job {
+    public:
+        MethodJob(T* object, void (T::*method)()) : _object(object), _method(method) { }
+        virtual void run() { (_object->*_method)(); }
+
+    private:
+        T* _object;
+        void (T::*_method)();
+    };
+
+    JobGraph(const QString& name, QThreadPool* threadPool = QThreadPool::globalInstance());
+    ~JobGraph();
+
+    /// adds a job, which the graph takes ownership of, and returns its index
+    int addJob(const QString& name, Job* job);
+
+    template<class T> int addJob(const QString& name, T* object, void (T::*method)()) {
+        return addJob(name, new MethodJob<T>(object, method));
+    }
+
+    /// makes a job wait for one added before it
+    void addPrerequisite(int job, int prerequisite);
+
+    /// keeps a job on the thread that calls run, for those that use objects that belong to it
+    void setRunsOnCallingThread(int job);
+
+    /// runs each of the jobs once its prerequisites are done, returning when they all are
+    void run();
+
+    /// the names of the jobs on the critical path of the last run, the first first
+    const QStringList& getCriticalPath() const { return _criticalPath; }
+    quint64 getCriticalPathUsecs() const { return _criticalPathUsecs; }
+
+private:
+    class Node {
+    public:
+        Job* job;
+        QString name;
+        int timerID;
+        bool runsOnCallingThread;
+        QVector<int> prerequisites;
+        QVector<int> dependents;
+        int waitingOn; /// the prerequisites not done yet in this run
+        quint64 start;
+        quint64 end;
+    };
+
+    class Worker;
+
+    /// runs the jobs that are ready until there are none; the calling thread also takes those kept for it
+    void runReadyJobs(bool isCallingThread);
+
+    /// starts workers on the pool, the lock being held
+    void startWorkers(int count);
+
+    /// takes a ready job, the lock being held, returning -1 if there isn't one
+    int takeReadyJob(bool isCallingThread);
+
+    void runJob(int index);
+
+    void recordCriticalPath();
+
+    QString _name;
+    QThreadPool* _threadPool;
+    QVector<Node> _nodes;
+
+    QMutex _mutex; /// guards what follows, while a run is in progress
+    QWaitCondition _jobsChanged;
+    QVector<int> _readyJobs;
+    QVector<int> _readyCallingThreadJobs;
+    int _unfinishedJobs;
+    int _startedWorkers; /// the workers started on the pool that haven't left yet, which may outlast a run
+
+    QStringList _criticalPath;
+    quint64 _criticalPathUsecs;
+};
+
+#endif // hifi_JobGraph_h
@@ -0,0 +1,277 @@
+//
+//  Metrics.cpp
+//  libraries/shared/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#include <cstring>
+
+#include <QtCore/QStringList>
+#include <QtNetwork/QUdpSocket>
+
+#include "Metrics.h"
+
+// the pending counts are added to the totals well before they can overflow
+const int MAX_PENDING_COUNT = 1 << 30;
+
+// the most bytes of stats put in one StatsD datagram, to stay within an MTU
+const int MAX_STATSD_DATAGRAM_BYTES = 1200;
+
+MetricCounter::MetricCounter(const QString& name, const QString& help) :
+    _name(name),
+    _help(help),
+    _pending(0),
+    _total(0) {
+}
+
+void MetricCounter::increment(int amount) {
+    if (_pending.fetchAndAddRelaxed(amount) + amount >= MAX_PENDING_COUNT) {
+        getTotal();
+    }
+}
+
+qint64 MetricCounter::getTotal() {
+    QMutexLocker locker(&_totalMutex);
+    _total += _pending.fetchAndStoreRelaxed(0);
+    return _total;
+}
+
+MetricGauge::MetricGauge(const QString& name, const QString& help) :
+    _name(name),
+    _help(help),
+    _value(0) {
+}
+
+void MetricGauge::set(float value) {
+    int bits;
+    memcpy(&bits, &value, sizeof(bits));
+    _value.store(bits);
+}
+
+float MetricGauge::get() const {
+    int bits = _value.load();
+    float value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+MetricHistogram::MetricHistogram(const QString& name, const QString& help) :
+    _name(name),
+    _help(help),
+    _pendingSum(0) {
+}
+
+void MetricHistogram::record(quint64 value) {
+    int bucket = 0;
+    while (bucket < METRIC_HISTOGRAM_BUCKETS - 1 && value > getBucketLimit(bucket)) {
+        bucket++;
+    }
+    bool mustAddPending = (_pendingBuckets[bucket].fetchAndAddRelaxed(1) + 1 >= MAX_PENDING_COUNT);
+    if (value >= (quint64)MAX_PENDING_COUNT) {
+        QMutexLocker locker(&_totalsMutex);
+        _totals.sum += value;
+
+    } else if (_pendingSum.fetchAndAddRelaxed((int)value) + (int)value >= MAX_PENDING_COUNT) {
+        mustAddPending = true;
+    }
+    if (mustAddPending) {
+        QMutexLocker locker(&_totalsMutex);
+        addPendingToTotals();
+    }
+}
+
+MetricHistogram::Totals MetricHistogram::getTotals() {
+    QMutexLocker locker(&_totalsMutex);
+    addPendingToTotals();
+    return _totals;
+}
+
+quint64 MetricHistogram::getBucketLimit(int bucket) {
+    return ((quint64)1 << bucket) - 1;
+}
+
+void MetricHistogram::addPendingToTotals() {
+    for (int i = 0; i < METRIC_HISTOGRAM_BUCKETS; i++) {
+        int count = _pendingBuckets[i].fetchAndStoreRelaxed(0);
+        _totals.buckets[i] += count;
+        _totals.count += count;
+    }
+    _totals.sum += _pendingSum.fetchAndStoreRelaxed(0);
+}
+
+MetricHistogram::Totals::Totals() :
+    count(0),
+    sum(0) {
+
+    memset(buckets, 0, sizeof(buckets));
+}
+
+float MetricHistogram::Totals::getValueAtPercentile(float percentile) const {
+    if (count == 0) {
+        return 0.0f;
+    }
+    float target = percentile * count;
+    qint64 countBelow = 0;
+    for (int i = 0; i < METRIC_HISTOGRAM_BUCKETS; i++) {
+        if (buckets[i] == 0 || countBelow + buckets[i] < target) {
+            countBelow += buckets[i];
+            continue;
+        }
+        float lower = (i == 0) ? 0.0f : (float)(getBucketLimit(i - 1) + 1);
+        if (i == METRIC_HISTOGRAM_BUCKETS - 1) {
+            return lower;
+        }
+        float upper = (float)(getBucketLimit(i) + 1);
+        return lower + (upper - lower) * (target - countBelow) / buckets[i];
+    }
+    return (float)(getBucketLimit(METRIC_HISTOGRAM_BUCKETS - 1) + 1);
+}
+
+MetricHistogram::Totals MetricHistogram::Totals::operator-(const Totals& earlier) const {
+    Totals difference;
+    for (int i = 0; i < METRIC_HISTOGRAM_BUCKETS; i++) {
+        difference.buckets[i] = buckets[i] - earlier.buckets[i];
+    }
+    difference.count = count - earlier.count;
+    difference.sum = sum - earlier.sum;
+    return difference;
+}
+
+MetricsRegistry& MetricsRegistry::getInstance() {
+    static MetricsRegistry instance;
+    return instance;
+}
+
+MetricsRegistry::MetricsRegistry() :
+    _statsDPort(0) {
+}
+
+MetricCounter& MetricsRegistry::getCounter(const QString& name, const QString& help) {
+    QMutexLocker locker(&_mutex);
+    MetricCounter*& counter = _counters[name];
+    if (!counter) {
+        counter = new MetricCounter(name, help);
+    }
+    return *counter;
+}
+
+MetricGauge& MetricsRegistry::getGauge(const QString& name, const QString& help) {
+    QMutexLocker locker(&_mutex);
+    MetricGauge*& gauge = _gauges[name];
+    if (!gauge) {
+        gauge = new MetricGauge(name, help);
+    }
+    return *gauge;
+}
+
+MetricHistogram& MetricsRegistry::getHistogram(const QString& name, const QString& help) {
+    QMutexLocker locker(&_mutex);
+    MetricHistogram*& histogram = _histograms[name];
+    if (!histogram) {
+        histogram = new MetricHistogram(name, help);
+    }
+    return *histogram;
+}
+
+void MetricsRegistry::addToStatsObject(QJsonObject& statsObject) {
+    QMutexLocker locker(&_mutex);
+    QStringList statsDLines;
+
+    foreach (MetricCounter* counter, _counters) {
+        qint64 total = counter->getTotal();
+        qint64& lastTotal = _lastCounterTotals[counter->getName()];
+        qint64 increase = total - lastTotal;
+        lastTotal = total;
+
+        statsObject[counter->getName()] = (double)increase;
+        statsDLines.append(QString("%1:%2|c").arg(counter->getName()).arg(increase));
+    }
+
+    foreach (MetricGauge* gauge, _gauges) {
+        float value = gauge->get();
+        statsObject[gauge->getName()] = value;
+        statsDLines.append(QString("%1:%2|g").arg(gauge->getName()).arg(value));
+    }
+
+    foreach (MetricHistogram* histogram, _histograms) {
+        MetricHistogram::Totals totals = histogram->getTotals();
+        MetricHistogram::Totals& lastTotals = _lastHistogramTotals[histogram->getName()];
+        MetricHistogram::Totals window = totals - lastTotals;
+        lastTotals = totals;
+
+        float median = window.getValueAtPercentile(0.5f);
+        float ninetyNinth = window.getValueAtPercentile(0.99f);
+        statsObject[histogram->getName() + "_count"] = (double)window.count;
+        statsObject[histogram->getName() + "_p50"] = median;
+        statsObject[histogram->getName() + "_p99"] = ninetyNinth;
+        statsDLines.append(QString("%1.count:%2|c").arg(histogram->getName()).arg(window.count));
+        statsDLines.append(QString("%1.p50:%2|g").arg(histogram->getName()).arg(median));
+        statsDLines.append(QString("%1.p99:%2|g").arg(histogram->getName()).arg(ninetyNinth));
+    }
+
+    if (_statsDAddress.isNull() || statsDLines.isEmpty()) {
+        return;
+    }
+    // StatsD takes a number of stats to a datagram, a line each
+    QUdpSocket statsDSocket;
+    QByteArray datagram;
+    foreach (const QString& line, statsDLines) {
+        QByteArray lineBytes = line.toUtf8();
+        if (!datagram.isEmpty() && datagram.size() + 1 + lineBytes.size() > MAX_STATSD_DATAGRAM_BYTES) {
+            statsDSocket.writeDatagram(datagram, _statsDAddress, _statsDPort);
+            datagram.clear();
+        }
+        if (!datagram.isEmpty()) {
+            datagram.append('\n');
+        }
+        datagram.append(lineBytes);
+    }
+    statsDSocket.writeDatagram(datagram, _statsDAddress, _statsDPort);
+}
+
+QByteArray MetricsRegistry::getPrometheusText() {
+    QMutexLocker locker(&_mutex);
+    QString text;
+
+    foreach (MetricCounter* counter, _counters) {
+        text += QString("# HELP %1 %2\n# TYPE %1 counter\n%1 %3\n").arg(counter->getName(), counter->getHelp())
+            .arg(counter->getTotal());
+    }
+
+    foreach (MetricGauge* gauge, _gauges) {
+        text += QString("# HELP %1 %2\n# TYPE %1 gauge\n%1 %3\n").arg(gauge->getName(), gauge->getHelp())
+            .arg(gauge->get());
+    }
+
+    foreach (MetricHistogram* histogram, _histograms) {
+        const QString& name = histogram->getName();
+        MetricHistogram::Totals totals = histogram->getTotals();
+        text += QString("# HELP %1 %2\n# TYPE %1 histogram\n").arg(name, histogram->getHelp());
+
+        // the buckets are cumulative, and the empty ones past the last value are left out
+        int lastBucket = METRIC_HISTOGRAM_BUCKETS - 2;
+        while (lastBucket >= 0 && totals.buckets[lastBucket] == 0) {
+            lastBucket--;
+        }
+        qint64 cumulativeCount = 0;
+        for (int i = 0; i <= lastBucket; i++) {
+            cumulativeCount += totals.buckets[i];
+            text += QString("%1_bucket{le=\"%2\"} %3\n").arg(name).arg(MetricHistogram::getBucketLimit(i))
+                .arg(cumulativeCount);
+        }
+        text += QString("%1_bucket{le=\"+Inf\"} %2\n%1_sum %3\n%1_count %2\n").arg(name).arg(totals.count)
+            .arg(totals.sum);
+    }
+
+    return text.toUtf8();
+}
+
+void MetricsRegistry::setStatsDServer(const QHostAddress& address, quint16 port) {
+    QMutexLocker locker(&_mutex);
+    _statsDAddress = address;
+    _statsDPort = port;
+}
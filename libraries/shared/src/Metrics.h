@@ -0,0 +1,145 @@
+//
+//  Metrics.h
+//  libraries/shared/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#ifndef hifi_Metrics_h
+#define hifi_Metrics_h
+
+#include <QtCore/QAtomicInt>
+#include <QtCore/QJsonObject>
+#include <QtCore/QMap>
+#include <QtCore/QMutex>
+#include <QtCore/QString>
+#include <QtNetwork/QHostAddress>
+
+/// the buckets of a histogram: the first holds the values below one, and each after that the values up to twice those
+/// of the one before
+const int METRIC_HISTOGRAM_BUCKETS = 32;
+
+/// A count that only goes up, such as of the packets sent. Incrementing it is lock free, from any thread.
+class MetricCounter {
+public:
+    MetricCounter(const QString& name, const QString& help);
+
+    void increment(int amount = 1);
+
+    const QString& getName() const { return _name; }
+    const QString& getHelp() const { return _help; }
+
+    /// returns the count since the counter was made
+    qint64 getTotal();
+
+private:
+    QString _name;
+    QString _help;
+    QAtomicInt _pending; /// the increments since they were last added to the total
+    QMutex _totalMutex;
+    qint64 _total;
+};
+
+/// A value that goes up and down, such as the number of listeners. Setting it is lock free, from any thread.
+class MetricGauge {
+public:
+    MetricGauge(const QString& name, const QString& help);
+
+    void set(float value);
+    float get() const;
+
+    const QString& getName() const { return _name; }
+    const QString& getHelp() const { return _help; }
+
+private:
+    QString _name;
+    QString _help;
+    QAtomicInt _value; /// the bits of the float
+};
+
+/// The counts of values, such as frame times in usecs, that fall into buckets doubling in size, from which the
+/// percentiles are estimated. Recording a value is lock free, from any thread; the total of the values is kept for the
+/// average.
+class MetricHistogram {
+public:
+    MetricHistogram(const QString& name, const QString& help);
+
+    void record(quint64 value);
+
+    const QString& getName() const { return _name; }
+    const QString& getHelp() const { return _help; }
+
+    /// the counts of each bucket and the total of the values since the histogram was made
+    class Totals {
+    public:
+        Totals();
+
+        /// estimates the value below which the given fraction of the values fall, by interpolating within the bucket
+        float getValueAtPercentile(float percentile) const;
+
+        /// the totals recorded since the earlier totals were taken
+        Totals operator-(const Totals& earlier) const;
+
+        qint64 buckets[METRIC_HISTOGRAM_BUCKETS];
+        qint64 count;
+        qint64 sum;
+    };
+
+    Totals getTotals();
+
+    /// the largest value of a bucket
+    static quint64 getBucketLimit(int bucket);
+
+private:
+    /// adds the pending counts to the totals, the lock being held
+    void addPendingToTotals();
+
+    QString _name;
+    QString _help;
+    QAtomicInt _pendingBuckets[METRIC_HISTOGRAM_BUCKETS];
+    QAtomicInt _pendingSum;
+    QMutex _totalsMutex;
+    Totals _totals;
+};
+
+/// The counters, gauges and histograms of the process, by name, for the assignments to update from their hot paths and
+/// to export: to the stats they send the domain-server, to StatsD along with those, and as text for Prometheus to
+/// scrape. The metrics are made the first time they're asked for and live as long as the process, so callers can hold
+/// on to them. Names should follow Prometheus's, such as hifi_audio_mixer_frame_usecs.
+class MetricsRegistry {
+public:
+    static MetricsRegistry& getInstance();
+
+    MetricCounter& getCounter(const QString& name, const QString& help);
+    MetricGauge& getGauge(const QString& name, const QString& help);
+    MetricHistogram& getHistogram(const QString& name, const QString& help);
+
+    /// adds, since the last call, the increases of the counters, the values of the gauges and the count, median and
+    /// 99th percentile of the histograms to the stats object, and sends them to the StatsD server if one is set
+    void addToStatsObject(QJsonObject& statsObject);
+
+    /// the totals of the metrics in the Prometheus text format
+    QByteArray getPrometheusText();
+
+    /// sets the StatsD server the stats are sent to along with the stats object, or clears it with a null address
+    void setStatsDServer(const QHostAddress& address, quint16 port);
+
+private:
+    MetricsRegistry();
+
+    QMutex _mutex;
+    QMap<QString, MetricCounter*> _counters;
+    QMap<QString, MetricGauge*> _gauges;
+    QMap<QString, MetricHistogram*> _histograms;
+
+    QMap<QString, qint64> _lastCounterTotals; /// as of the last stats object
+    QMap<QString, MetricHistogram::Totals> _lastHistogramTotals;
+
+    QHostAddress _statsDAddress;
+    quint16 _statsDPort;
+};
+
+#endif // hifi_Metrics_h
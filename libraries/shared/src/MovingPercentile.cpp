@@ -13,49 +13,146 @@
 MovingPercentile::MovingPercentile(int numSamples, float percentile)
     : _numSamples(numSamples),
     _percentile(percentile),
-    _samplesSorted(),
-    _sampleIds(),
+    _nodes(numSamples),
+    _root(-1),
+    _sampleCount(0),
     _newSampleId(0),
-    _indexOfPercentile(0),
+    _randomState(0x9e3779b9),
     _valueAtPercentile(0.0f)
 {
 }
 
 void MovingPercentile::updatePercentile(float sample) {
-
-    // insert the new sample into _samplesSorted
-    int newSampleIndex;
-    if (_samplesSorted.size() < _numSamples) {
-        // if not all samples have been filled yet, simply append it
-        newSampleIndex = _samplesSorted.size();
-        _samplesSorted.append(sample);
-        _sampleIds.append(_newSampleId);
-
-        // update _indexOfPercentile
-        float index = _percentile * (float)(_samplesSorted.size() - 1);
-        _indexOfPercentile = (int)(index + 0.5f);   // round to int
+    if (_sampleCount == _numSamples) {
+        // the new sample takes the place of the oldest
+        _root = erase(_root, _newSampleId);
     } else {
-        // find index of sample with id = _newSampleId and replace it with new sample
-        newSampleIndex = _sampleIds.indexOf(_newSampleId);
-        _samplesSorted[newSampleIndex] = sample;
+        _sampleCount++;
     }
 
+    // xorshift, which is plenty random for the priorities and leaves rand() alone
+    _randomState ^= _randomState << 13;
+    _randomState ^= _randomState >> 17;
+    _randomState ^= _randomState << 5;
+
+    Node& node = _nodes[_newSampleId];
+    node.value = sample;
+    node.priority = _randomState;
+    node.left = -1;
+    node.right = -1;
+    node.size = 1;
+    _root = insert(_root, _newSampleId);
+
     // increment _newSampleId.  cycles from 0 thru N-1
     _newSampleId = (_newSampleId == _numSamples - 1) ? 0 : _newSampleId + 1;
 
-    // swap new sample with neighbors in _samplesSorted until it's in sorted order
-    // try swapping up first, then down.  element will only be swapped one direction.
-    while (newSampleIndex < _samplesSorted.size() - 1 && sample > _samplesSorted[newSampleIndex + 1]) {
-        _samplesSorted.swap(newSampleIndex, newSampleIndex + 1);
-        _sampleIds.swap(newSampleIndex, newSampleIndex + 1);
-        newSampleIndex++;
+    // find new value at percentile
+    _valueAtPercentile = getValueAtPercentile(_percentile);
+}
+
+float MovingPercentile::getValueAtPercentile(float percentile) const {
+    if (_sampleCount == 0) {
+        return 0.0f;
     }
-    while (newSampleIndex > 0 && sample < _samplesSorted[newSampleIndex - 1]) {
-        _samplesSorted.swap(newSampleIndex, newSampleIndex - 1);
-        _sampleIds.swap(newSampleIndex, newSampleIndex - 1);
-        newSampleIndex--;
+    int index = (int)(percentile * (float)(_sampleCount - 1) + 0.5f);   // round to int
+
+    // walk down to the node with that many before it
+    int node = _root;
+    while (true) {
+        const Node& current = _nodes.at(node);
+        int leftSize = getSize(current.left);
+        if (index < leftSize) {
+            node = current.left;
+
+        } else if (index == leftSize) {
+            return current.value;
+
+        } else {
+            index -= leftSize + 1;
+            node = current.right;
+        }
     }
+}
 
-    // find new value at percentile
-    _valueAtPercentile = _samplesSorted[_indexOfPercentile];
+bool MovingPercentile::isBefore(int first, int second) const {
+    float firstValue = _nodes.at(first).value;
+    float secondValue = _nodes.at(second).value;
+    return firstValue < secondValue || (firstValue == secondValue && first < second);
+}
+
+void MovingPercentile::updateSize(int node) {
+    Node& current = _nodes[node];
+    current.size = getSize(current.left) + getSize(current.right) + 1;
+}
+
+int MovingPercentile::insert(int root, int node) {
+    if (root == -1) {
+        return node;
+    }
+    Node& current = _nodes[root];
+    if (_nodes.at(node).priority > current.priority) {
+        // the new node goes here, with the subtree split beneath it
+        Node& newNode = _nodes[node];
+        split(root, node, newNode.left, newNode.right);
+        updateSize(node);
+        return node;
+    }
+    if (isBefore(node, root)) {
+        current.left = insert(current.left, node);
+    } else {
+        current.right = insert(current.right, node);
+    }
+    updateSize(root);
+    return root;
+}
+
+int MovingPercentile::erase(int root, int node) {
+    Node& current = _nodes[root];
+    if (root == node) {
+        return merge(current.left, current.right);
+    }
+    if (isBefore(node, root)) {
+        current.left = erase(current.left, node);
+    } else {
+        current.right = erase(current.right, node);
+    }
+    updateSize(root);
+    return root;
+}
+
+int MovingPercentile::merge(int left, int right) {
+    if (left == -1) {
+        return right;
+    }
+    if (right == -1) {
+        return left;
+    }
+    // everything in the left subtree comes before the right, so the one with the higher priority root goes on top
+    if (_nodes.at(left).priority > _nodes.at(right).priority) {
+        Node& leftNode = _nodes[left];
+        leftNode.right = merge(leftNode.right, right);
+        updateSize(left);
+        return left;
+    }
+    Node& rightNode = _nodes[right];
+    rightNode.left = merge(left, rightNode.left);
+    updateSize(right);
+    return right;
+}
+
+void MovingPercentile::split(int root, int node, int& left, int& right) {
+    if (root == -1) {
+        left = -1;
+        right = -1;
+        return;
+    }
+    Node& current = _nodes[root];
+    if (isBefore(root, node)) {
+        left = root;
+        split(current.right, node, current.right, right);
+    } else {
+        right = root;
+        split(current.left, node, left, current.left);
+    }
+    updateSize(root);
 }
@@ -11,8 +11,12 @@
 #ifndef hifi_MovingPercentile_h
 #define hifi_MovingPercentile_h
 
-#include <qlist.h>
+#include <qvector.h>
 
+/// The value at a percentile of the last numSamples samples. The samples are kept in a treap ordered by value, in which
+/// each node knows the size of its subtree, so that a new sample replaces the oldest and any percentile is found in
+/// O(log n) time. The nodes are allocated up front, one for each place in the window, and are reused in the order the
+/// samples arrive.
 class MovingPercentile {
 
 public:
@@ -21,15 +25,44 @@ public:
     void updatePercentile(float sample);
     float getValueAtPercentile() const { return _valueAtPercentile; }
 
+    /// returns the value at another percentile of the same window, so that one window can give several
+    float getValueAtPercentile(float percentile) const;
+
+    int getSampleCount() const { return _sampleCount; }
+
 private:
+    class Node {
+    public:
+        float value;
+        quint32 priority; /// random, the treap keeping each node's priority above those of its children
+        int left;
+        int right;
+        int size; /// of the subtree rooted here
+    };
+
+    /// returns true if the first node comes before the second, by value and then by place in the window
+    bool isBefore(int first, int second) const;
+
+    int getSize(int node) const { return (node == -1) ? 0 : _nodes.at(node).size; }
+    void updateSize(int node);
+
+    /// these return the new root of the subtree they're given
+    int insert(int root, int node);
+    int erase(int root, int node);
+    int merge(int left, int right);
+
+    /// splits a subtree into the nodes that come before the given node and the rest
+    void split(int root, int node, int& left, int& right);
+
     const int _numSamples;
     const float _percentile;
 
-    QList<float> _samplesSorted;
-    QList<int> _sampleIds;      // incrementally assigned, is cyclic
-    int _newSampleId;
+    QVector<Node> _nodes;       // by place in the window
+    int _root;
+    int _sampleCount;
+    int _newSampleId;           // the place of the next sample, cycling from 0 through N-1
+    quint32 _randomState;
 
-    int _indexOfPercentile;
     float _valueAtPercentile;
 };
 
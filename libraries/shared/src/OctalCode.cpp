@@ -16,6 +16,11 @@
 
 #include <QtCore/QDebug>
 
+#if defined(__BMI2__)
+#define HIFI_OCTAL_KEY_BMI2
+#include <immintrin.h>
+#endif
+
 #include "SharedUtil.h"
 #include "OctalCode.h"
 
@@ -127,6 +132,19 @@ unsigned char* childOctalCode(const unsigned char* parentOctalCode, char childNu
 }
 
 void voxelDetailsForCode(const unsigned char* octalCode, VoxelPositionSize& voxelPositionSize) {
+    OctalKey key;
+    if (!octalCode) {
+        key.high = key.low = 0;
+        key.sections = 0;
+        voxelDetailsForKey(key, voxelPositionSize);
+        return;
+    }
+    if (octalKeyForCode(octalCode, key)) {
+        voxelDetailsForKey(key, voxelPositionSize);
+        return;
+    }
+
+    // deeper than a key, a section at a time
     float output[3];
     memset(&output[0], 0, 3 * sizeof(float));
     float currentScale = 1.0;
@@ -150,6 +168,16 @@ void voxelDetailsForCode(const unsigned char* octalCode, VoxelPositionSize& voxe
 }
 
 void copyFirstVertexForCode(const unsigned char* octalCode, float* output) {
+    OctalKey key;
+    if (octalKeyForCode(octalCode, key)) {
+        VoxelPositionSize details;
+        voxelDetailsForKey(key, details);
+        output[0] = details.x;
+        output[1] = details.y;
+        output[2] = details.z;
+        return;
+    }
+
     memset(output, 0, 3 * sizeof(float));
     
     float currentScale = 0.5;
@@ -303,6 +331,16 @@ bool isAncestorOf(const unsigned char* possibleAncestor, const unsigned char* po
         return true; // this is the root, it's the anscestor of all
     }
 
+    // compared a word at a time if both fit in keys, and a section at a time otherwise
+    OctalKey ancestorKey, descendentKey;
+    if (octalKeyForCode(possibleAncestor, ancestorKey) && octalKeyForCode(possibleDescendent, descendentKey)
+            && (descendentsChild == CHECK_NODE_ONLY || descendentKey.sections < MAX_OCTAL_KEY_SECTIONS)) {
+        if (descendentsChild != CHECK_NODE_ONLY) {
+            descendentKey = childOctalKey(descendentKey, descendentsChild);
+        }
+        return isAncestorOfKey(ancestorKey, descendentKey);
+    }
+
     int descendentCodeLength = numberOfThreeBitSectionsInCode(possibleDescendent);
     
     // if the caller also include a child, then our descendent length is actually one extra!
@@ -315,10 +353,11 @@ bool isAncestorOf(const unsigned char* possibleAncestor, const unsigned char* po
     }
 
     // compare the sections for the ancestor to the descendent
+    int descendentOwnLength = numberOfThreeBitSectionsInCode(possibleDescendent);
     for (int section = 0; section < ancestorCodeLength; section++) {
         char sectionValueAncestor = getOctalCodeSectionValue(possibleAncestor, section);
         char sectionValueDescendent;
-        if (ancestorCodeLength <= descendentCodeLength) {
+        if (section < descendentOwnLength) {
             sectionValueDescendent = getOctalCodeSectionValue(possibleDescendent, section);
         } else {
             assert(descendentsChild != CHECK_NODE_ONLY);
@@ -377,3 +416,122 @@ QString octalCodeToHexString(const unsigned char* octalCode) {
     return output;
 }
 
+
+// the bit of each three bit section that is z, and the section values of the x, y and z bits
+const quint64 OCTAL_KEY_Z_BITS = 0x1249249249249249ULL;
+const int OCTAL_KEY_WORD_BITS = OCTAL_KEY_SECTIONS_PER_WORD * BITS_IN_OCTAL;
+const int BYTES_IN_OCTAL_KEY_WORD = sizeof(quint64);
+
+// gathers the z bits of the sections of a word into its low 21 bits
+static inline quint64 compactOctalKeyBits(quint64 word) {
+#ifdef HIFI_OCTAL_KEY_BMI2
+    return _pext_u64(word, OCTAL_KEY_Z_BITS);
+#else
+    word &= OCTAL_KEY_Z_BITS;
+    word = (word ^ (word >> 2)) & 0x10c30c30c30c30c3ULL;
+    word = (word ^ (word >> 4)) & 0x100f00f00f00f00fULL;
+    word = (word ^ (word >> 8)) & 0x001f0000ff0000ffULL;
+    word = (word ^ (word >> 16)) & 0x001f00000000ffffULL;
+    word = (word ^ (word >> 32)) & 0x00000000001fffffULL;
+    return word;
+#endif
+}
+
+// the mask of the first sections of a word
+static inline quint64 octalKeyPrefixMask(int sections) {
+    if (sections <= 0) {
+        return 0;
+    }
+    int bits = sections * BITS_IN_OCTAL;
+    return ((1ULL << bits) - 1) << (OCTAL_KEY_WORD_BITS - bits);
+}
+
+bool octalKeyForCode(const unsigned char* octalCode, OctalKey& key) {
+    if (!octalCode || *octalCode > MAX_OCTAL_KEY_SECTIONS) {
+        return false;
+    }
+    int sections = *octalCode;
+    int codeBytes = bytesRequiredForCodeLength(sections) - 1;
+
+    // the sections of a byte code are a string of bits from the top of its bytes, which are read as 128 bits
+    quint64 top = 0;
+    quint64 bottom = 0;
+    for (int i = 0; i < codeBytes; i++) {
+        if (i < BYTES_IN_OCTAL_KEY_WORD) {
+            top |= (quint64)octalCode[1 + i] << ((BYTES_IN_OCTAL_KEY_WORD - 1 - i) * BITS_IN_BYTE);
+        } else {
+            bottom |= (quint64)octalCode[1 + i] << ((2 * BYTES_IN_OCTAL_KEY_WORD - 1 - i) * BITS_IN_BYTE);
+        }
+    }
+
+    // and then split 63 to a word, without what's past the code in its last byte
+    key.sections = sections;
+    key.high = (top >> 1) & octalKeyPrefixMask(std::min(sections, OCTAL_KEY_SECTIONS_PER_WORD));
+    key.low = (((top & 1) << (OCTAL_KEY_WORD_BITS - 1)) | (bottom >> 2))
+        & octalKeyPrefixMask(sections - OCTAL_KEY_SECTIONS_PER_WORD);
+    return true;
+}
+
+size_t copyOctalCodeForKey(const OctalKey& key, unsigned char* output) {
+    quint64 top = (key.high << 1) | (key.low >> (OCTAL_KEY_WORD_BITS - 1));
+    quint64 bottom = key.low << 2;
+
+    int codeBytes = bytesRequiredForCodeLength(key.sections);
+    output[0] = key.sections;
+    for (int i = 0; i < codeBytes - 1; i++) {
+        if (i < BYTES_IN_OCTAL_KEY_WORD) {
+            output[1 + i] = (unsigned char)(top >> ((BYTES_IN_OCTAL_KEY_WORD - 1 - i) * BITS_IN_BYTE));
+        } else {
+            output[1 + i] = (unsigned char)(bottom >> ((2 * BYTES_IN_OCTAL_KEY_WORD - 1 - i) * BITS_IN_BYTE));
+        }
+    }
+    return codeBytes;
+}
+
+int octalKeySectionValue(const OctalKey& key, int section) {
+    quint64 word = (section < OCTAL_KEY_SECTIONS_PER_WORD) ? key.high : key.low;
+    int shift = (OCTAL_KEY_SECTIONS_PER_WORD - 1 - section % OCTAL_KEY_SECTIONS_PER_WORD) * BITS_IN_OCTAL;
+    return (int)((word >> shift) & 7);
+}
+
+OctalKey childOctalKey(const OctalKey& parentKey, int childNumber) {
+    assert(parentKey.sections < MAX_OCTAL_KEY_SECTIONS);
+    OctalKey childKey = parentKey;
+    int section = parentKey.sections;
+    int shift = (OCTAL_KEY_SECTIONS_PER_WORD - 1 - section % OCTAL_KEY_SECTIONS_PER_WORD) * BITS_IN_OCTAL;
+    if (section < OCTAL_KEY_SECTIONS_PER_WORD) {
+        childKey.high |= (quint64)(childNumber & 7) << shift;
+    } else {
+        childKey.low |= (quint64)(childNumber & 7) << shift;
+    }
+    childKey.sections++;
+    return childKey;
+}
+
+OctalKey ancestorOctalKey(const OctalKey& key, int sections) {
+    OctalKey ancestorKey;
+    ancestorKey.high = key.high & octalKeyPrefixMask(std::min(sections, OCTAL_KEY_SECTIONS_PER_WORD));
+    ancestorKey.low = key.low & octalKeyPrefixMask(sections - OCTAL_KEY_SECTIONS_PER_WORD);
+    ancestorKey.sections = sections;
+    return ancestorKey;
+}
+
+bool isAncestorOfKey(const OctalKey& possibleAncestor, const OctalKey& possibleDescendent) {
+    if (possibleAncestor.sections > possibleDescendent.sections) {
+        return false;
+    }
+    OctalKey descendentsAncestor = ancestorOctalKey(possibleDescendent, possibleAncestor.sections);
+    return descendentsAncestor.high == possibleAncestor.high && descendentsAncestor.low == possibleAncestor.low;
+}
+
+void voxelDetailsForKey(const OctalKey& key, VoxelPositionSize& voxelPositionSize) {
+    // each section halves the scale, so a coordinate is its bits of the sections over 2 to the sections a key holds
+    const double KEY_SCALE = 1.0 / (double)(1ULL << MAX_OCTAL_KEY_SECTIONS);
+    voxelPositionSize.x = (float)(((compactOctalKeyBits(key.high >> 2) << OCTAL_KEY_SECTIONS_PER_WORD)
+        | compactOctalKeyBits(key.low >> 2)) * KEY_SCALE);
+    voxelPositionSize.y = (float)(((compactOctalKeyBits(key.high >> 1) << OCTAL_KEY_SECTIONS_PER_WORD)
+        | compactOctalKeyBits(key.low >> 1)) * KEY_SCALE);
+    voxelPositionSize.z = (float)(((compactOctalKeyBits(key.high) << OCTAL_KEY_SECTIONS_PER_WORD)
+        | compactOctalKeyBits(key.low)) * KEY_SCALE);
+    voxelPositionSize.s = (float)ldexp(1.0, -key.sections);
+}
@@ -65,4 +65,34 @@ OctalCodeComparison compareOctalCodes(const unsigned char* code1, const unsigned
 QString octalCodeToHexString(const unsigned char* octalCode);
 unsigned char* hexStringToOctalCode(const QString& input);
 
+const int OCTAL_KEY_SECTIONS_PER_WORD = 21;
+const int MAX_OCTAL_KEY_SECTIONS = 2 * OCTAL_KEY_SECTIONS_PER_WORD;
+
+/// An octal code in a fixed width, for the operations on codes that are done too often to walk them three bits at a
+/// time or allocate new codes. The sections are packed 21 to a word from the top of the high word down, the sections
+/// past the code's length are zero, and so a code's sections are a prefix of its descendants'. The byte codes are still
+/// what's stored and sent, a key is made from one when it's needed.
+struct OctalKey {
+    quint64 high;
+    quint64 low;
+    int sections;
+};
+
+/// reads a byte code into a key, returns false if it's NULL or deeper than a key can hold
+bool octalKeyForCode(const unsigned char* octalCode, OctalKey& key);
+
+/// writes the key as a byte code to a buffer of at least bytesRequiredForCodeLength(key.sections), returns its size
+size_t copyOctalCodeForKey(const OctalKey& key, unsigned char* output);
+
+int octalKeySectionValue(const OctalKey& key, int section);
+
+/// the key of a child, the parent must be shallower than MAX_OCTAL_KEY_SECTIONS
+OctalKey childOctalKey(const OctalKey& parentKey, int childNumber);
+
+/// the key of the ancestor at a level, which must be no deeper than the key
+OctalKey ancestorOctalKey(const OctalKey& key, int sections);
+
+bool isAncestorOfKey(const OctalKey& possibleAncestor, const OctalKey& possibleDescendent);
+void voxelDetailsForKey(const OctalKey& key, VoxelPositionSize& voxelPositionSize);
+
 #endif // hifi_OctalCode_h
@@ -14,6 +14,10 @@
 #include <string>
 
 #include <QtCore/QDebug>
+#include <QtCore/QFile>
+#include <QtCore/QJsonArray>
+#include <QtCore/QJsonDocument>
+#include <QtCore/QJsonObject>
 
 #include "PerfStat.h"
 
@@ -22,7 +26,7 @@ bool PerformanceWarning::_suppressShortTimings = false;
 
 // Destructor handles recording all of our stats
 PerformanceWarning::~PerformanceWarning() {
-    quint64 end = usecTimestampNow();
+    quint64 end = usecMonotonicNow();
     quint64 elapsedusec = (end - _start);
     double elapsedmsec = elapsedusec / 1000.0;
     if ((_alwaysDisplay || _renderWarningsOn) && elapsedmsec > 1) {
@@ -52,18 +56,182 @@ PerformanceWarning::~PerformanceWarning() {
     }
 };
 
+void PerformanceTimerRecord::recordResults(quint64 elapsed, quint64 calls, quint64 childElapsed) {
+    _runningTotal += elapsed;
+    _totalCalls += calls;
+    _childTotal += childElapsed;
+    _movingAverage.updateAverage((float)elapsed / calls);
+}
+
+QMutex PerformanceTimer::_recordsMutex;
+QVector<QString> PerformanceTimer::_timerNames;
+QHash<QString, int> PerformanceTimer::_timerIDs;
 QMap<QString, PerformanceTimerRecord> PerformanceTimer::_records;
+bool PerformanceTimer::_capturingTrace = false;
+QVector<PerformanceTraceEvent> PerformanceTimer::_traceEvents;
+QMutex PerformanceTimer::_traceMutex;
+
+const quint64 TIMER_AGGREGATION_INTERVAL_USECS = 100 * 1000;
+
+/// a thread's results, accumulated by timer ID since they were last added to the shared records
+class PerformanceTimerSlot {
+public:
+    PerformanceTimerSlot() : elapsed(0), calls(0), childElapsed(0) { }
+    
+    quint64 elapsed;
+    quint64 calls;
+    quint64 childElapsed;
+};
+
+class PerformanceTimer::ThreadRecords {
+public:
+    ThreadRecords() : current(NULL), lastAggregated(usecMonotonicNow()) { }
+    ~ThreadRecords() { aggregate(); }
+    
+    void aggregate();
+    
+    QVector<PerformanceTimerSlot> timerSlots;
+    PerformanceTimer* current;
+    quint64 lastAggregated;
+};
+
+void PerformanceTimer::ThreadRecords::aggregate() {
+    QMutexLocker locker(&_recordsMutex);
+    for (int i = 0; i < timerSlots.size(); i++) {
+        PerformanceTimerSlot& slot = timerSlots[i];
+        if (slot.calls != 0) {
+            _records[_timerNames.at(i)].recordResults(slot.elapsed, slot.calls, slot.childElapsed);
+            slot.elapsed = slot.calls = slot.childElapsed = 0;
+        }
+    }
+    lastAggregated = usecMonotonicNow();
+}
 
+QThreadStorage<PerformanceTimer::ThreadRecords*> PerformanceTimer::_threadRecordsStorage;
+
+PerformanceTimer::PerformanceTimer(const QString& name) {
+    start(getTimerID(name));
+}
+
+PerformanceTimer::PerformanceTimer(int timerID) {
+    start(timerID);
+}
 
 PerformanceTimer::~PerformanceTimer() {
-    quint64 end = usecTimestampNow();
+    quint64 end = usecMonotonicNow();
     quint64 elapsedusec = (end - _start);
-    PerformanceTimerRecord& namedRecord = _records[_name];
-    namedRecord.recordResult(elapsedusec);
+    
+    PerformanceTimerSlot& slot = _threadRecords->timerSlots[_timerID];
+    slot.elapsed += elapsedusec;
+    slot.calls++;
+    _threadRecords->current = _parent;
+    if (_parent) {
+        _threadRecords->timerSlots[_parent->_timerID].childElapsed += elapsedusec;
+        
+    } else if (end - _threadRecords->lastAggregated >= TIMER_AGGREGATION_INTERVAL_USECS) {
+        _threadRecords->aggregate();
+    }
+    if (_capturingTrace) {
+        QString name;
+        {
+            QMutexLocker locker(&_recordsMutex);
+            name = _timerNames.at(_timerID);
+        }
+        captureTraceEvent(name, _start, elapsedusec, CPU_TRACK);
+    }
+}
+
+int PerformanceTimer::getTimerID(const QString& name) {
+    QMutexLocker locker(&_recordsMutex);
+    QHash<QString, int>::const_iterator it = _timerIDs.constFind(name);
+    if (it != _timerIDs.constEnd()) {
+        return it.value();
+    }
+    int timerID = _timerNames.size();
+    _timerNames.append(name);
+    _timerIDs.insert(name, timerID);
+    return timerID;
+}
+
+PerformanceTimerRecord PerformanceTimer::getTimerRecord(const QString& name) {
+    QMutexLocker locker(&_recordsMutex);
+    return _records.value(name);
+}
+
+QMap<QString, PerformanceTimerRecord> PerformanceTimer::getAllTimerRecords() {
+    QMutexLocker locker(&_recordsMutex);
+    return _records;
+}
+
+void PerformanceTimer::start(int timerID) {
+    _timerID = timerID;
+    if (!_threadRecordsStorage.hasLocalData()) {
+        _threadRecordsStorage.setLocalData(new ThreadRecords());
+    }
+    _threadRecords = _threadRecordsStorage.localData();
+    if (_threadRecords->timerSlots.size() <= timerID) {
+        _threadRecords->timerSlots.resize(timerID + 1);
+    }
+    _parent = _threadRecords->current;
+    _threadRecords->current = this;
+    
+    // start timing last, so as not to count the above
+    _start = usecMonotonicNow();
+}
+
+void PerformanceTimer::addTimerRecord(const QString& name, quint64 start, quint64 elapsed, Track track) {
+    {
+        QMutexLocker locker(&_recordsMutex);
+        _records[name].recordResult(elapsed);
+    }
+    if (_capturingTrace) {
+        captureTraceEvent(name, start, elapsed, track);
+    }
+}
+
+void PerformanceTimer::setCapturingTrace(bool capturingTrace) {
+    QMutexLocker locker(&_traceMutex);
+    _capturingTrace = capturingTrace;
+    if (capturingTrace) {
+        _traceEvents.clear();
+    }
+}
+
+bool PerformanceTimer::writeTrace(const QString& filename) {
+    QMutexLocker locker(&_traceMutex);
+    QJsonArray events;
+    foreach (const PerformanceTraceEvent& traceEvent, _traceEvents) {
+        QJsonObject event;
+        event.insert("name", traceEvent.name);
+        event.insert("ph", QString("X")); // a complete event, with its duration
+        event.insert("ts", (double)traceEvent.start);
+        event.insert("dur", (double)traceEvent.duration);
+        event.insert("pid", 0);
+        event.insert("tid", traceEvent.track);
+        events.append(event);
+    }
+    _traceEvents.clear();
+
+    QFile file(filename);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qDebug() << "Couldn't write trace to" << filename;
+        return false;
+    }
+    QJsonObject trace;
+    trace.insert("traceEvents", events);
+    file.write(QJsonDocument(trace).toJson(QJsonDocument::Compact));
+    return true;
+}
+
+void PerformanceTimer::captureTraceEvent(const QString& name, quint64 start, quint64 duration, Track track) {
+    // the timers may be destroyed on other threads than the one that's capturing
+    QMutexLocker locker(&_traceMutex);
+    PerformanceTraceEvent traceEvent = { name, start, duration, track };
+    _traceEvents.append(traceEvent);
 }
 
 void PerformanceTimer::dumpAllTimerRecords() {
-    QMapIterator<QString, PerformanceTimerRecord> i(_records);
+    QMapIterator<QString, PerformanceTimerRecord> i(getAllTimerRecords());
     while (i.hasNext()) {
         i.next();
         qDebug() << i.key() << ": average " << i.value().getAverage() 
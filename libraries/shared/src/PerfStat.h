@@ -16,6 +16,14 @@
 #define hifi_PerfStat_h
 
 #include <stdint.h>
+
+#include <QtCore/QHash>
+#include <QtCore/QMap>
+#include <QtCore/QMutex>
+#include <QtCore/QString>
+#include <QtCore/QThreadStorage>
+#include <QtCore/QVector>
+
 #include "SharedUtil.h"
 #include "SimpleMovingAverage.h"
 
@@ -36,14 +44,14 @@ public:
 
     PerformanceWarning(bool renderWarnings, const char* message, bool alwaysDisplay = false,
                         quint64* runningTotal = NULL, quint64* totalCalls = NULL) :
-        _start(usecTimestampNow()),
+        _start(usecMonotonicNow()),
         _message(message),
         _renderWarningsOn(renderWarnings),
         _alwaysDisplay(alwaysDisplay),
         _runningTotal(runningTotal),
         _totalCalls(totalCalls) { }
         
-    quint64 elapsed() const { return (usecTimestampNow() - _start); };
+    quint64 elapsed() const { return (usecMonotonicNow() - _start); };
 
     ~PerformanceWarning();
 
@@ -52,39 +60,107 @@ public:
 
 class PerformanceTimerRecord {
 public:
-    PerformanceTimerRecord() : _runningTotal(0), _totalCalls(0) {}
+    PerformanceTimerRecord() : _runningTotal(0), _totalCalls(0), _childTotal(0) {}
+    
+    void recordResult(quint64 elapsed) { recordResults(elapsed, 1, 0); }
+    
+    /// records a batch of calls timed together, along with the part of their time spent in the timers nested within them
+    void recordResults(quint64 elapsed, quint64 calls, quint64 childElapsed);
     
-    void recordResult(quint64 elapsed) { _runningTotal += elapsed; _totalCalls++; _movingAverage.updateAverage(elapsed); }
     quint64 getAverage() const { return (_totalCalls == 0) ? 0 : _runningTotal / _totalCalls; }
     quint64 getMovingAverage() const { return (_totalCalls == 0) ? 0 : _movingAverage.getAverage(); }
     quint64 getCount() const { return _totalCalls; }
     
+    /// returns the average time of a call spent outside of the timers nested within it
+    quint64 getSelfAverage() const { return (_totalCalls == 0) ? 0 : (_runningTotal - _childTotal) / _totalCalls; }
+    
 private:
 	quint64 _runningTotal;
 	quint64 _totalCalls;
+	quint64 _childTotal;
 	SimpleMovingAverage _movingAverage;
 };
 
+/// a timed span captured for a trace
+class PerformanceTraceEvent {
+public:
+    QString name;
+    quint64 start; /// usecs
+    quint64 duration;
+    int track;
+};
+
+#define PERFORMANCE_TIMER_CONCATENATE(first, second) first##second
+#define PERFORMANCE_TIMER_NAME(prefix, line) PERFORMANCE_TIMER_CONCATENATE(prefix, line)
+
+/// Times the rest of the enclosing scope under the given name, which is interned only the first time the line is reached,
+/// in a static slot, so that afterwards the timer costs no string building or lookup: PERFORMANCE_TIMER("idle/update");
+#define PERFORMANCE_TIMER(name) \
+    static const int PERFORMANCE_TIMER_NAME(perfTimerID, __LINE__) = PerformanceTimer::getTimerID(name); \
+    PerformanceTimer PERFORMANCE_TIMER_NAME(perfTimer, __LINE__)(PERFORMANCE_TIMER_NAME(perfTimerID, __LINE__))
+
+/// Times a scope. The timers may be used on any thread: each thread accumulates its results without locking, and adds
+/// them to the shared records at most every tenth of a second, as the outermost of its timers end, and when it finishes. A timer started within the scope of another on the same thread is that timer's child, and the time spent
+/// in children is recorded apart so that a parent's own time can be told from theirs.
 class PerformanceTimer {
 public:
 
-    PerformanceTimer(const QString& name) :
-        _start(usecTimestampNow()),
-        _name(name) { }
+    /// the tracks of a trace, on which the spans timed on the CPU and those measured on the GPU are shown apart
+    enum Track { CPU_TRACK, GPU_TRACK };
+
+    /// times a scope under a name that is looked up each time; prefer the PERFORMANCE_TIMER macro for constant names
+    PerformanceTimer(const QString& name);
+    
+    /// times a scope under a name interned with getTimerID
+    PerformanceTimer(int timerID);
         
-    quint64 elapsed() const { return (usecTimestampNow() - _start); };
+    quint64 elapsed() const { return (usecMonotonicNow() - _start); };
 
     ~PerformanceTimer();
     
-    static const PerformanceTimerRecord& getTimerRecord(const QString& name) { return _records[name]; };
-    static const QMap<QString, PerformanceTimerRecord>& getAllTimerRecords() { return _records; };
+    /// returns the ID under which the named timers accumulate their results, assigning one if it has none yet
+    static int getTimerID(const QString& name);
+    
+    static PerformanceTimerRecord getTimerRecord(const QString& name);
+    static QMap<QString, PerformanceTimerRecord> getAllTimerRecords();
     static void dumpAllTimerRecords();
 
+    /// records a span that was measured elsewhere, such as on the GPU, under a name; start is by usecMonotonicNow
+    static void addTimerRecord(const QString& name, quint64 start, quint64 elapsed, Track track = CPU_TRACK);
+
+    /// starts or stops keeping each timed span for a trace, rather than just its running averages
+    static void setCapturingTrace(bool capturingTrace);
+    static bool isCapturingTrace() { return _capturingTrace; }
+
+    /// writes the spans captured since capturing started in the trace event format read by chrome://tracing, then
+    /// forgets them; returns false if the file can't be written
+    static bool writeTrace(const QString& filename);
+
 private:
+    
+    // disallow copying of PerformanceTimer objects
+    PerformanceTimer(const PerformanceTimer&);
+    PerformanceTimer& operator= (const PerformanceTimer&);
+    
+    class ThreadRecords;
+    
+    void start(int timerID);
+    
+    static void captureTraceEvent(const QString& name, quint64 start, quint64 duration, Track track);
+
 	quint64 _start;
-	QString _name;
+	int _timerID;
+	PerformanceTimer* _parent; /// the timer in whose scope this one started, if any
+	ThreadRecords* _threadRecords;
+	
+	static QMutex _recordsMutex; /// guards the names and the records
+	static QVector<QString> _timerNames; /// by ID
+	static QHash<QString, int> _timerIDs;
 	static QMap<QString, PerformanceTimerRecord> _records;
+	static bool _capturingTrace;
+	static QVector<PerformanceTraceEvent> _traceEvents;
+	static QMutex _traceMutex;
+	static QThreadStorage<ThreadRecords*> _threadRecordsStorage;
 };
 
-
 #endif // hifi_PerfStat_h
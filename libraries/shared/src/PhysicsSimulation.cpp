@@ -9,11 +9,16 @@
 //  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
 //
 
+#include <cfloat>
 #include <glm/glm.hpp>
 #include <iostream>
 
+#include <QRunnable>
+#include <QThreadPool>
+
 #include "PhysicsSimulation.h"
 
+#include "CapsuleShape.h"
 #include "PhysicsEntity.h"
 #include "Ragdoll.h"
 #include "SharedUtil.h"
@@ -23,9 +28,11 @@ int MAX_DOLLS_PER_SIMULATION = 16;
 int MAX_ENTITIES_PER_SIMULATION = 64;
 int MAX_COLLISIONS_PER_SIMULATION = 256;
 
+// the collision list doubles whenever it fills up, to no more than this
+int MAX_GROWN_COLLISIONS_PER_SIMULATION = 256 * 32;
 
-PhysicsSimulation::PhysicsSimulation() : _collisionList(MAX_COLLISIONS_PER_SIMULATION), 
-        _numIterations(0), _numCollisions(0), _constraintError(0.0f), _stepTime(0) {
+PhysicsSimulation::PhysicsSimulation() : _collisionList(MAX_COLLISIONS_PER_SIMULATION), _threadPool(NULL),
+        _numIterations(0), _numCollisions(0), _numCollisionListOverflows(0), _constraintError(0.0f), _stepTime(0) {
 }
 
 PhysicsSimulation::~PhysicsSimulation() {
@@ -149,7 +156,6 @@ void PhysicsSimulation::stepForward(float deltaTime, float minError, int maxIter
 
     moveRagdolls(deltaTime);
 
-    int numDolls = _dolls.size();
     _numCollisions = 0;
     int iterations = 0;
     float error = 0.0f;
@@ -157,11 +163,7 @@ void PhysicsSimulation::stepForward(float deltaTime, float minError, int maxIter
         computeCollisions();
         processCollisions();
 
-        // enforce constraints
-        error = 0.0f;
-        for (int i = 0; i < numDolls; ++i) {
-            error = glm::max(error, _dolls[i]->enforceRagdollConstraints());
-        }
+        error = enforceRagdollConstraints();
         ++iterations;
 
         now = usecTimestampNow();
@@ -175,11 +177,47 @@ void PhysicsSimulation::stepForward(float deltaTime, float minError, int maxIter
     // temporary debug info for watching simulation performance
     static int adebug = 0; ++adebug;
     if (0 == (adebug % 100)) {
-        std::cout << "adebug Ni = " << _numIterations << "  E = " << error  << "  t = " << _stepTime << std::endl;  // adebug
+        std::cout << "adebug Ni = " << _numIterations << "  E = " << error  << "  t = " << _stepTime
+            << "  overflows = " << _numCollisionListOverflows << std::endl;  // adebug
     }
 #endif // ANDREW_DEBUG
 }
 
+/// Enforces the constraints of a ragdoll on a thread of a pool.  The constraints of a doll only move its own points, so
+/// the dolls can be enforced at once.
+class RagdollConstraintEnforcer : public QRunnable {
+public:
+    RagdollConstraintEnforcer(Ragdoll* doll, float* error) : _doll(doll), _error(error) { }
+
+    virtual void run() { *_error = _doll->enforceRagdollConstraints(); }
+
+private:
+    Ragdoll* _doll;
+    float* _error;
+};
+
+float PhysicsSimulation::enforceRagdollConstraints() {
+    float error = 0.0f;
+    int numDolls = _dolls.size();
+    if (!_threadPool || numDolls < 2) {
+        for (int i = 0; i < numDolls; ++i) {
+            error = glm::max(error, _dolls[i]->enforceRagdollConstraints());
+        }
+        return error;
+    }
+    _dollErrors.resize(numDolls);
+    float* dollErrors = _dollErrors.data();
+    for (int i = 0; i < numDolls; ++i) {
+        _threadPool->start(new RagdollConstraintEnforcer(_dolls[i], dollErrors + i));
+    }
+    // the time budget is checked between iterations, so waiting here keeps it to the wall time of all the threads
+    _threadPool->waitForDone();
+    for (int i = 0; i < numDolls; ++i) {
+        error = glm::max(error, dollErrors[i]);
+    }
+    return error;
+}
+
 void PhysicsSimulation::moveRagdolls(float deltaTime) {
     int numDolls = _dolls.size();
     for (int i = 0; i < numDolls; ++i) {
@@ -188,19 +226,56 @@ void PhysicsSimulation::moveRagdolls(float deltaTime) {
 }
 
 void PhysicsSimulation::computeCollisions() {
+    collideEntities();
+
+    // a full list may have dropped some contacts, so grow it and find them again
+    while (_collisionList.isFull() && _collisionList.getMaxSize() < MAX_GROWN_COLLISIONS_PER_SIMULATION) {
+        ++_numCollisionListOverflows;
+        _collisionList.setMaxSize(glm::min(2 * _collisionList.getMaxSize(), MAX_GROWN_COLLISIONS_PER_SIMULATION));
+        collideEntities();
+    }
+    _numCollisions = _collisionList.size();
+}
+
+static void expandBounds(const Shape* shape, glm::vec3& minimum, glm::vec3& maximum) {
+    if (shape->getType() == Shape::PLANE_SHAPE) {
+        // planes go on forever
+        minimum = glm::vec3(-FLT_MAX);
+        maximum = glm::vec3(FLT_MAX);
+
+    } else if (shape->getType() == Shape::CAPSULE_SHAPE) {
+        // the ends of verlet capsules move with their points, so their bounding radii can be out of date
+        const CapsuleShape* capsule = static_cast<const CapsuleShape*>(shape);
+        glm::vec3 startPoint, endPoint;
+        capsule->getStartPoint(startPoint);
+        capsule->getEndPoint(endPoint);
+        glm::vec3 radius(capsule->getRadius());
+        minimum = glm::min(minimum, glm::min(startPoint, endPoint) - radius);
+        maximum = glm::max(maximum, glm::max(startPoint, endPoint) + radius);
+
+    } else {
+        glm::vec3 radius(shape->getBoundingRadius());
+        minimum = glm::min(minimum, shape->getTranslation() - radius);
+        maximum = glm::max(maximum, shape->getTranslation() + radius);
+    }
+}
+
+void PhysicsSimulation::collideEntities() {
     _collisionList.clear();
-    // TODO: keep track of QSet<PhysicsEntity*> collidedEntities;
     int numEntities = _entities.size();
+    _entityBounds.resize(0);
     for (int i = 0; i < numEntities; ++i) {
         PhysicsEntity* entity = _entities.at(i);
         const QVector<Shape*> shapes = entity->getShapes();
         int numShapes = shapes.size();
+        EntityBounds bounds = { glm::vec3(FLT_MAX), glm::vec3(-FLT_MAX), i };
         // collide with self
         for (int j = 0; j < numShapes; ++j) {
             const Shape* shape = shapes.at(j);
             if (!shape) {
                 continue;
             }
+            expandBounds(shape, bounds.minimum, bounds.maximum);
             for (int k = j+1; k < numShapes; ++k) {
                 const Shape* otherShape = shapes.at(k);
                 if (otherShape && entity->collisionsAreEnabled(j, k)) {
@@ -208,14 +283,29 @@ void PhysicsSimulation::computeCollisions() {
                 }
             }
         }
+        if (bounds.minimum.x <= bounds.maximum.x) {
+            _entityBounds.append(bounds);
+        }
+    }
 
-        // collide with others
-        for (int j = i+1; j < numEntities; ++j) {
-            const QVector<Shape*> otherShapes = _entities.at(j)->getShapes();
-            ShapeCollider::collideShapesWithShapes(shapes, otherShapes, _collisionList);
+    // collide with others: sweep along x, testing only the pairs whose boxes overlap
+    qSort(_entityBounds);
+    int numBounds = _entityBounds.size();
+    for (int i = 0; i < numBounds; ++i) {
+        const EntityBounds& bounds = _entityBounds.at(i);
+        for (int j = i+1; j < numBounds && _entityBounds.at(j).minimum.x <= bounds.maximum.x; ++j) {
+            const EntityBounds& otherBounds = _entityBounds.at(j);
+            if (otherBounds.minimum.y > bounds.maximum.y || otherBounds.maximum.y < bounds.minimum.y ||
+                    otherBounds.minimum.z > bounds.maximum.z || otherBounds.maximum.z < bounds.minimum.z) {
+                continue;
+            }
+            // collide in the order the entities were added, which decides which shape of each pair is A
+            int indexA = glm::min(bounds.index, otherBounds.index);
+            int indexB = glm::max(bounds.index, otherBounds.index);
+            ShapeCollider::collideShapesWithShapes(_entities.at(indexA)->getShapes(),
+                _entities.at(indexB)->getShapes(), _collisionList);
         }
     }
-    _numCollisions = _collisionList.size();
 }
 
 void PhysicsSimulation::processCollisions() {
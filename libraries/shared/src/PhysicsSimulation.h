@@ -14,8 +14,12 @@
 
 #include <QVector>
 
+#include <glm/glm.hpp>
+
 #include "CollisionInfo.h"
 
+class QThreadPool;
+
 class PhysicsEntity;
 class Ragdoll;
 
@@ -35,6 +39,12 @@ public:
 
     void removeRagdoll(Ragdoll* doll);
 
+    /// Sets the pool on which the ragdolls' constraints are enforced, each doll on its own thread, or NULL (the default)
+    /// to enforce them in turn on the calling thread.  The simulation waits for the pool to finish every iteration, so
+    /// the pool shouldn't be shared with long running work.
+    void setThreadPool(QThreadPool* pool) { _threadPool = pool; }
+    QThreadPool* getThreadPool() const { return _threadPool; }
+
     /// \param minError constraint motion below this value is considered "close enough"
     /// \param maxIterations max number of iterations before giving up
     /// \param maxUsec max number of usec to spend enforcing constraints
@@ -45,14 +55,37 @@ public:
     void computeCollisions();
     void processCollisions();
 
+    /// \return number of times the collision list filled up and had to grow
+    int getNumCollisionListOverflows() const { return _numCollisionListOverflows; }
+
 private:
+    /// the box around an entity's shapes, for the broadphase
+    class EntityBounds {
+    public:
+        glm::vec3 minimum;
+        glm::vec3 maximum;
+        int index;
+
+        bool operator<(const EntityBounds& other) const { return minimum.x < other.minimum.x; }
+    };
+
+    /// finds the collisions of each entity's shapes with one another and with those of the entities whose boxes they touch
+    void collideEntities();
+
+    /// \return max distance of point movement over all the dolls
+    float enforceRagdollConstraints();
+
     CollisionList _collisionList;
     QVector<PhysicsEntity*> _entities;
     QVector<Ragdoll*> _dolls;
+    QVector<EntityBounds> _entityBounds;
+    QThreadPool* _threadPool;
+    QVector<float> _dollErrors; /// by doll, when they're enforced on the pool
 
     // some stats
     int _numIterations;
     int _numCollisions;
+    int _numCollisionListOverflows;
     float _constraintError;
     quint64 _stepTime;
 };
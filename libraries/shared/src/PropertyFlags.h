@@ -44,6 +44,9 @@ public:
     QByteArray encode();
     void decode(const QByteArray& fromEncoded);
 
+    /// decodes the flags at the start of a buffer, returns the bytes they took or 0 if they run past the buffer
+    int decode(const unsigned char* data, int length);
+
 
     bool operator==(const PropertyFlags& other) const { return _flags == other._flags; }
     bool operator!=(const PropertyFlags& other) const { return _flags != other._flags; }
@@ -219,6 +222,23 @@ template<typename Enum> inline void PropertyFlags<Enum>::decode(const QByteArray
     }
 }
 
+template<typename Enum> inline int PropertyFlags<Enum>::decode(const unsigned char* data, int length) {
+    // the leading set bits count the bytes after the first, as in decode() above
+    int encodedByteCount = 1;
+    for (int bit = 0; bit < length * BITS_PER_BYTE; bit++) {
+        if (!(data[bit / BITS_PER_BYTE] & (1 << (BITS_PER_BYTE - (bit % BITS_PER_BYTE) - 1)))) {
+            break;
+        }
+        encodedByteCount++;
+    }
+    if (encodedByteCount > length) {
+        clear();
+        return 0;
+    }
+    decode(QByteArray(reinterpret_cast<const char*>(data), encodedByteCount));
+    return encodedByteCount;
+}
+
 template<typename Enum> inline void PropertyFlags<Enum>::debugDumpBits() {
     qDebug() << "_minFlag=" << _minFlag;
     qDebug() << "_maxFlag=" << _maxFlag;
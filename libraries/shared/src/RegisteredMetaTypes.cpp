@@ -9,6 +9,8 @@
 //  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
 //
 
+#include <QThreadStorage>
+
 #include "RegisteredMetaTypes.h"
 
 static int vec4MetaTypeId = qRegisterMetaType<glm::vec4>();
@@ -29,62 +31,116 @@ void registerMetaTypes(QScriptEngine* engine) {
     qScriptRegisterMetaType(engine, collisionToScriptValue, collisionFromScriptValue);
 }
 
+/// The handles of the names of the vector components in an engine, which are looked up much faster than the names.
+class ComponentNames {
+public:
+    ComponentNames() : engine(NULL) { }
+    
+    QScriptEngine* engine;
+    QScriptString x, y, z, w;
+};
+
+/// returns the handles of the component names for the engine; an engine is only used on its thread, and a thread
+/// rarely runs more than one, so the handles of the engine last seen on each thread are kept
+static const ComponentNames& getComponentNames(QScriptEngine* engine) {
+    static QThreadStorage<ComponentNames> threadComponentNames;
+    ComponentNames& names = threadComponentNames.localData();
+    // the handles are invalidated if their engine is deleted, in case another is made in its place
+    if (names.engine != engine || !names.x.isValid()) {
+        names.engine = engine;
+        names.x = engine->toStringHandle("x");
+        names.y = engine->toStringHandle("y");
+        names.z = engine->toStringHandle("z");
+        names.w = engine->toStringHandle("w");
+    }
+    return names;
+}
+
+/// numbers are read directly; anything else converts as it always has, with what's missing coming out as zero
+static float toFloat(const QScriptValue& value) {
+    return value.isNumber() ? (float)value.toNumber() : value.toVariant().toFloat();
+}
+
 QScriptValue vec4toScriptValue(QScriptEngine* engine, const glm::vec4& vec4) {
+    const ComponentNames& names = getComponentNames(engine);
     QScriptValue obj = engine->newObject();
-    obj.setProperty("x", vec4.x);
-    obj.setProperty("y", vec4.y);
-    obj.setProperty("z", vec4.z);
-    obj.setProperty("w", vec4.w);
+    obj.setProperty(names.x, vec4.x);
+    obj.setProperty(names.y, vec4.y);
+    obj.setProperty(names.z, vec4.z);
+    obj.setProperty(names.w, vec4.w);
     return obj;
 }
 
 void vec4FromScriptValue(const QScriptValue& object, glm::vec4& vec4) {
-    vec4.x = object.property("x").toVariant().toFloat();
-    vec4.y = object.property("y").toVariant().toFloat();
-    vec4.z = object.property("z").toVariant().toFloat();
-    vec4.w = object.property("w").toVariant().toFloat();
+    if (!object.isObject()) {
+        vec4 = glm::vec4();
+        return;
+    }
+    const ComponentNames& names = getComponentNames(object.engine());
+    vec4.x = toFloat(object.property(names.x));
+    vec4.y = toFloat(object.property(names.y));
+    vec4.z = toFloat(object.property(names.z));
+    vec4.w = toFloat(object.property(names.w));
 }
 
 QScriptValue vec3toScriptValue(QScriptEngine* engine, const glm::vec3 &vec3) {
+    const ComponentNames& names = getComponentNames(engine);
     QScriptValue obj = engine->newObject();
-    obj.setProperty("x", vec3.x);
-    obj.setProperty("y", vec3.y);
-    obj.setProperty("z", vec3.z);
+    obj.setProperty(names.x, vec3.x);
+    obj.setProperty(names.y, vec3.y);
+    obj.setProperty(names.z, vec3.z);
     return obj;
 }
 
 void vec3FromScriptValue(const QScriptValue &object, glm::vec3 &vec3) {
-    vec3.x = object.property("x").toVariant().toFloat();
-    vec3.y = object.property("y").toVariant().toFloat();
-    vec3.z = object.property("z").toVariant().toFloat();
+    if (!object.isObject()) {
+        vec3 = glm::vec3();
+        return;
+    }
+    const ComponentNames& names = getComponentNames(object.engine());
+    vec3.x = toFloat(object.property(names.x));
+    vec3.y = toFloat(object.property(names.y));
+    vec3.z = toFloat(object.property(names.z));
 }
 
 QScriptValue vec2toScriptValue(QScriptEngine* engine, const glm::vec2 &vec2) {
+    const ComponentNames& names = getComponentNames(engine);
     QScriptValue obj = engine->newObject();
-    obj.setProperty("x", vec2.x);
-    obj.setProperty("y", vec2.y);
+    obj.setProperty(names.x, vec2.x);
+    obj.setProperty(names.y, vec2.y);
     return obj;
 }
 
 void vec2FromScriptValue(const QScriptValue &object, glm::vec2 &vec2) {
-    vec2.x = object.property("x").toVariant().toFloat();
-    vec2.y = object.property("y").toVariant().toFloat();
+    if (!object.isObject()) {
+        vec2 = glm::vec2();
+        return;
+    }
+    const ComponentNames& names = getComponentNames(object.engine());
+    vec2.x = toFloat(object.property(names.x));
+    vec2.y = toFloat(object.property(names.y));
 }
 
 QScriptValue quatToScriptValue(QScriptEngine* engine, const glm::quat& quat) {
+    const ComponentNames& names = getComponentNames(engine);
     QScriptValue obj = engine->newObject();
-    obj.setProperty("x", quat.x);
-    obj.setProperty("y", quat.y);
-    obj.setProperty("z", quat.z);
-    obj.setProperty("w", quat.w);
+    obj.setProperty(names.x, quat.x);
+    obj.setProperty(names.y, quat.y);
+    obj.setProperty(names.z, quat.z);
+    obj.setProperty(names.w, quat.w);
     return obj;
 }
 
 void quatFromScriptValue(const QScriptValue &object, glm::quat& quat) {
-    quat.x = object.property("x").toVariant().toFloat();
-    quat.y = object.property("y").toVariant().toFloat();
-    quat.z = object.property("z").toVariant().toFloat();
-    quat.w = object.property("w").toVariant().toFloat();
+    if (!object.isObject()) {
+        quat = glm::quat(0.0f, 0.0f, 0.0f, 0.0f);
+        return;
+    }
+    const ComponentNames& names = getComponentNames(object.engine());
+    quat.x = toFloat(object.property(names.x));
+    quat.y = toFloat(object.property(names.y));
+    quat.z = toFloat(object.property(names.z));
+    quat.w = toFloat(object.property(names.w));
 }
 
 QScriptValue xColorToScriptValue(QScriptEngine *engine, const xColor& color) {
@@ -113,15 +169,11 @@ QScriptValue pickRayToScriptValue(QScriptEngine* engine, const PickRay& pickRay)
 void pickRayFromScriptValue(const QScriptValue& object, PickRay& pickRay) {
     QScriptValue originValue = object.property("origin");
     if (originValue.isValid()) {
-        pickRay.origin.x = originValue.property("x").toVariant().toFloat();
-        pickRay.origin.y = originValue.property("y").toVariant().toFloat();
-        pickRay.origin.z = originValue.property("z").toVariant().toFloat();
+        vec3FromScriptValue(originValue, pickRay.origin);
     }
     QScriptValue directionValue = object.property("direction");
     if (directionValue.isValid()) {
-        pickRay.direction.x = directionValue.property("x").toVariant().toFloat();
-        pickRay.direction.y = directionValue.property("y").toVariant().toFloat();
-        pickRay.direction.z = directionValue.property("z").toVariant().toFloat();
+        vec3FromScriptValue(directionValue, pickRay.direction);
     }
 }
 
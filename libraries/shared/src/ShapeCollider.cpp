@@ -23,50 +23,54 @@
 
 namespace ShapeCollider {
 
-bool collideShapes(const Shape* shapeA, const Shape* shapeB, CollisionList& collisions) {
-    // TODO: make a fast lookup for correct method
-    int typeA = shapeA->getType();
-    int typeB = shapeB->getType();
-    if (typeA == Shape::SPHERE_SHAPE) {
-        const SphereShape* sphereA = static_cast<const SphereShape*>(shapeA);
-        if (typeB == Shape::SPHERE_SHAPE) {
-            return sphereSphere(sphereA, static_cast<const SphereShape*>(shapeB), collisions);
-        } else if (typeB == Shape::CAPSULE_SHAPE) {
-            return sphereCapsule(sphereA, static_cast<const CapsuleShape*>(shapeB), collisions);
-        } else if (typeB == Shape::PLANE_SHAPE) {
-            return spherePlane(sphereA, static_cast<const PlaneShape*>(shapeB), collisions);
-        }
-    } else if (typeA == Shape::CAPSULE_SHAPE) {
-        const CapsuleShape* capsuleA = static_cast<const CapsuleShape*>(shapeA);
-        if (typeB == Shape::SPHERE_SHAPE) {
-            return capsuleSphere(capsuleA, static_cast<const SphereShape*>(shapeB), collisions);
-        } else if (typeB == Shape::CAPSULE_SHAPE) {
-            return capsuleCapsule(capsuleA, static_cast<const CapsuleShape*>(shapeB), collisions);
-        } else if (typeB == Shape::PLANE_SHAPE) {
-            return capsulePlane(capsuleA, static_cast<const PlaneShape*>(shapeB), collisions);
-        }
-    } else if (typeA == Shape::PLANE_SHAPE) {
-        const PlaneShape* planeA = static_cast<const PlaneShape*>(shapeA);
-        if (typeB == Shape::SPHERE_SHAPE) {
-            return planeSphere(planeA, static_cast<const SphereShape*>(shapeB), collisions);
-        } else if (typeB == Shape::CAPSULE_SHAPE) {
-            return planeCapsule(planeA, static_cast<const CapsuleShape*>(shapeB), collisions);
-        } else if (typeB == Shape::PLANE_SHAPE) {
-            return planePlane(planeA, static_cast<const PlaneShape*>(shapeB), collisions);
-        }
-    } else if (typeA == Shape::LIST_SHAPE) {
-        const ListShape* listA = static_cast<const ListShape*>(shapeA);
-        if (typeB == Shape::SPHERE_SHAPE) {
-            return listSphere(listA, static_cast<const SphereShape*>(shapeB), collisions);
-        } else if (typeB == Shape::CAPSULE_SHAPE) {
-            return listCapsule(listA, static_cast<const CapsuleShape*>(shapeB), collisions);
-        } else if (typeB == Shape::PLANE_SHAPE) {
-            return listPlane(listA, static_cast<const PlaneShape*>(shapeB), collisions);
-        }
-    }
+// the entries of the dispatch table take any two shapes and cast them to the types of their cell
+
+typedef bool (*CollisionFunction)(const Shape* shapeA, const Shape* shapeB, CollisionList& collisions);
+
+const int NUM_SHAPE_TYPES = Shape::LIST_SHAPE + 1;
+
+static bool notImplemented(const Shape* shapeA, const Shape* shapeB, CollisionList& collisions) {
     return false;
 }
 
+template<class A, class B, bool (*collide)(const A*, const B*, CollisionList&)> bool castAndCollide(
+        const Shape* shapeA, const Shape* shapeB, CollisionList& collisions) {
+    return collide(static_cast<const A*>(shapeA), static_cast<const B*>(shapeB), collisions);
+}
+
+static const CollisionFunction collisionFunctions[NUM_SHAPE_TYPES][NUM_SHAPE_TYPES] = {
+    // UNKNOWN_SHAPE
+    { notImplemented, notImplemented, notImplemented, notImplemented, notImplemented },
+    // SPHERE_SHAPE
+    { notImplemented,
+        castAndCollide<SphereShape, SphereShape, sphereSphere>,
+        castAndCollide<SphereShape, CapsuleShape, sphereCapsule>,
+        castAndCollide<SphereShape, PlaneShape, spherePlane>,
+        castAndCollide<SphereShape, ListShape, sphereList> },
+    // CAPSULE_SHAPE
+    { notImplemented,
+        castAndCollide<CapsuleShape, SphereShape, capsuleSphere>,
+        castAndCollide<CapsuleShape, CapsuleShape, capsuleCapsule>,
+        castAndCollide<CapsuleShape, PlaneShape, capsulePlane>,
+        castAndCollide<CapsuleShape, ListShape, capsuleList> },
+    // PLANE_SHAPE
+    { notImplemented,
+        castAndCollide<PlaneShape, SphereShape, planeSphere>,
+        castAndCollide<PlaneShape, CapsuleShape, planeCapsule>,
+        castAndCollide<PlaneShape, PlaneShape, planePlane>,
+        castAndCollide<PlaneShape, ListShape, planeList> },
+    // LIST_SHAPE
+    { notImplemented,
+        castAndCollide<ListShape, SphereShape, listSphere>,
+        castAndCollide<ListShape, CapsuleShape, listCapsule>,
+        castAndCollide<ListShape, PlaneShape, listPlane>,
+        castAndCollide<ListShape, ListShape, listList> }
+};
+
+bool collideShapes(const Shape* shapeA, const Shape* shapeB, CollisionList& collisions) {
+    return collisionFunctions[shapeA->getType()][shapeB->getType()](shapeA, shapeB, collisions);
+}
+
 static CollisionList tempCollisions(32);
 
 bool collideShapesCoarse(const QVector<const Shape*>& shapesA, const QVector<const Shape*>& shapesB, CollisionInfo& collision) {
@@ -548,15 +552,7 @@ bool planePlane(const PlaneShape* planeA, const PlaneShape* planeB, CollisionLis
 bool sphereList(const SphereShape* sphereA, const ListShape* listB, CollisionList& collisions) {
     bool touching = false;
     for (int i = 0; i < listB->size() && !collisions.isFull(); ++i) {
-        const Shape* subShape = listB->getSubShape(i);
-        int subType = subShape->getType();
-        if (subType == Shape::SPHERE_SHAPE) {
-            touching = sphereSphere(sphereA, static_cast<const SphereShape*>(subShape), collisions) || touching;
-        } else if (subType == Shape::CAPSULE_SHAPE) {
-            touching = sphereCapsule(sphereA, static_cast<const CapsuleShape*>(subShape), collisions) || touching;
-        } else if (subType == Shape::PLANE_SHAPE) {
-            touching = spherePlane(sphereA, static_cast<const PlaneShape*>(subShape), collisions) || touching;
-        }
+        touching = collideShapes(sphereA, listB->getSubShape(i), collisions) || touching;
     }
     return touching;
 }
@@ -564,15 +560,7 @@ bool sphereList(const SphereShape* sphereA, const ListShape* listB, CollisionLis
 bool capsuleList(const CapsuleShape* capsuleA, const ListShape* listB, CollisionList& collisions) {
     bool touching = false;
     for (int i = 0; i < listB->size() && !collisions.isFull(); ++i) {
-        const Shape* subShape = listB->getSubShape(i);
-        int subType = subShape->getType();
-        if (subType == Shape::SPHERE_SHAPE) {
-            touching = capsuleSphere(capsuleA, static_cast<const SphereShape*>(subShape), collisions) || touching;
-        } else if (subType == Shape::CAPSULE_SHAPE) {
-            touching = capsuleCapsule(capsuleA, static_cast<const CapsuleShape*>(subShape), collisions) || touching;
-        } else if (subType == Shape::PLANE_SHAPE) {
-            touching = capsulePlane(capsuleA, static_cast<const PlaneShape*>(subShape), collisions) || touching;
-        }
+        touching = collideShapes(capsuleA, listB->getSubShape(i), collisions) || touching;
     }
     return touching;
 }
@@ -580,15 +568,7 @@ bool capsuleList(const CapsuleShape* capsuleA, const ListShape* listB, Collision
 bool planeList(const PlaneShape* planeA, const ListShape* listB, CollisionList& collisions) {
     bool touching = false;
     for (int i = 0; i < listB->size() && !collisions.isFull(); ++i) {
-        const Shape* subShape = listB->getSubShape(i);
-        int subType = subShape->getType();
-        if (subType == Shape::SPHERE_SHAPE) {
-            touching = planeSphere(planeA, static_cast<const SphereShape*>(subShape), collisions) || touching;
-        } else if (subType == Shape::CAPSULE_SHAPE) {
-            touching = planeCapsule(planeA, static_cast<const CapsuleShape*>(subShape), collisions) || touching;
-        } else if (subType == Shape::PLANE_SHAPE) {
-            touching = planePlane(planeA, static_cast<const PlaneShape*>(subShape), collisions) || touching;
-        }
+        touching = collideShapes(planeA, listB->getSubShape(i), collisions) || touching;
     }
     return touching;
 }
@@ -596,15 +576,7 @@ bool planeList(const PlaneShape* planeA, const ListShape* listB, CollisionList&
 bool listSphere(const ListShape* listA, const SphereShape* sphereB, CollisionList& collisions) {
     bool touching = false;
     for (int i = 0; i < listA->size() && !collisions.isFull(); ++i) {
-        const Shape* subShape = listA->getSubShape(i);
-        int subType = subShape->getType();
-        if (subType == Shape::SPHERE_SHAPE) {
-            touching = sphereSphere(static_cast<const SphereShape*>(subShape), sphereB, collisions) || touching;
-        } else if (subType == Shape::CAPSULE_SHAPE) {
-            touching = capsuleSphere(static_cast<const CapsuleShape*>(subShape), sphereB, collisions) || touching;
-        } else if (subType == Shape::PLANE_SHAPE) {
-            touching = planeSphere(static_cast<const PlaneShape*>(subShape), sphereB, collisions) || touching;
-        }
+        touching = collideShapes(listA->getSubShape(i), sphereB, collisions) || touching;
     }
     return touching;
 }
@@ -612,15 +584,7 @@ bool listSphere(const ListShape* listA, const SphereShape* sphereB, CollisionLis
 bool listCapsule(const ListShape* listA, const CapsuleShape* capsuleB, CollisionList& collisions) {
     bool touching = false;
     for (int i = 0; i < listA->size() && !collisions.isFull(); ++i) {
-        const Shape* subShape = listA->getSubShape(i);
-        int subType = subShape->getType();
-        if (subType == Shape::SPHERE_SHAPE) {
-            touching = sphereCapsule(static_cast<const SphereShape*>(subShape), capsuleB, collisions) || touching;
-        } else if (subType == Shape::CAPSULE_SHAPE) {
-            touching = capsuleCapsule(static_cast<const CapsuleShape*>(subShape), capsuleB, collisions) || touching;
-        } else if (subType == Shape::PLANE_SHAPE) {
-            touching = planeCapsule(static_cast<const PlaneShape*>(subShape), capsuleB, collisions) || touching;
-        }
+        touching = collideShapes(listA->getSubShape(i), capsuleB, collisions) || touching;
     }
     return touching;
 }
@@ -628,15 +592,7 @@ bool listCapsule(const ListShape* listA, const CapsuleShape* capsuleB, Collision
 bool listPlane(const ListShape* listA, const PlaneShape* planeB, CollisionList& collisions) {
     bool touching = false;
     for (int i = 0; i < listA->size() && !collisions.isFull(); ++i) {
-        const Shape* subShape = listA->getSubShape(i);
-        int subType = subShape->getType();
-        if (subType == Shape::SPHERE_SHAPE) {
-            touching = spherePlane(static_cast<const SphereShape*>(subShape), planeB, collisions) || touching;
-        } else if (subType == Shape::CAPSULE_SHAPE) {
-            touching = capsulePlane(static_cast<const CapsuleShape*>(subShape), planeB, collisions) || touching;
-        } else if (subType == Shape::PLANE_SHAPE) {
-            touching = planePlane(static_cast<const PlaneShape*>(subShape), planeB, collisions) || touching;
-        }
+        touching = collideShapes(listA->getSubShape(i), planeB, collisions) || touching;
     }
     return touching;
 }
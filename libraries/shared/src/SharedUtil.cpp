@@ -21,6 +21,7 @@
 
 #ifdef __APPLE__
 #include <CoreFoundation/CoreFoundation.h>
+#include <mach/mach_time.h>
 #endif
 
 #include <QtCore/QDebug>
@@ -36,19 +37,66 @@ void usecTimestampNowForceClockSkew(int clockSkew) {
     ::usecTimestampNowAdjust = clockSkew;
 }
 
-quint64 usecTimestampNow() {
-    static bool usecTimestampNowIsInitialized = false;
-    static qint64 TIME_REFERENCE = 0; // in usec
-    static QElapsedTimer timestampTimer;
-    
-    if (!usecTimestampNowIsInitialized) {
-        TIME_REFERENCE = QDateTime::currentMSecsSinceEpoch() * 1000; // ms to usec
-        timestampTimer.start();
-        usecTimestampNowIsInitialized = true;
+#if defined(__APPLE__)
+static double getNsecsPerMachTick() {
+    mach_timebase_info_data_t timebase;
+    mach_timebase_info(&timebase);
+    return (double)timebase.numer / timebase.denom;
+}
+#elif defined(_WIN32)
+static double getUsecsPerPerformanceTick() {
+    LARGE_INTEGER frequency;
+    QueryPerformanceFrequency(&frequency);
+    return (double)USECS_PER_SECOND / frequency.QuadPart;
+}
+#elif !defined(__linux__)
+static QElapsedTimer& getMonotonicTimer() {
+    static QElapsedTimer timer;
+    if (!timer.isValid()) {
+        timer.start();
     }
-    
-    //          usec                       nsec to usec                   usec
-    return TIME_REFERENCE + timestampTimer.nsecsElapsed() / 1000 + ::usecTimestampNowAdjust;
+    return timer;
+}
+#endif
+
+quint64 usecMonotonicNow() {
+#if defined(__linux__)
+    // served from the vDSO, without entering the kernel
+    timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (quint64)now.tv_sec * USECS_PER_SECOND + now.tv_nsec / 1000;
+#elif defined(__APPLE__)
+    static const double NSECS_PER_MACH_TICK = getNsecsPerMachTick();
+    return (quint64)(mach_absolute_time() * NSECS_PER_MACH_TICK) / 1000;
+#elif defined(_WIN32)
+    static const double USECS_PER_PERFORMANCE_TICK = getUsecsPerPerformanceTick();
+    LARGE_INTEGER now;
+    QueryPerformanceCounter(&now);
+    return (quint64)(now.QuadPart * USECS_PER_PERFORMANCE_TICK);
+#else
+    return getMonotonicTimer().nsecsElapsed() / 1000;
+#endif
+}
+
+quint64 usecCoarseMonotonicNow() {
+#if defined(__linux__) && defined(CLOCK_MONOTONIC_COARSE)
+    timespec now;
+    clock_gettime(CLOCK_MONOTONIC_COARSE, &now);
+    return (quint64)now.tv_sec * USECS_PER_SECOND + now.tv_nsec / 1000;
+#else
+    return usecMonotonicNow();
+#endif
+}
+
+static qint64 getTimeReference() {
+    // the offset from the monotonic clock to the epoch, read once so that the timestamps can't go backwards when the
+    // system clock is set
+    return QDateTime::currentMSecsSinceEpoch() * USECS_PER_MSEC - (qint64)usecMonotonicNow();
+}
+
+quint64 usecTimestampNow() {
+    static const qint64 TIME_REFERENCE = getTimeReference(); // in usec
+    return TIME_REFERENCE + usecMonotonicNow() + ::usecTimestampNowAdjust;
 }
 
 float randFloat() {
@@ -417,13 +465,13 @@ void printVoxelCode(unsigned char* voxelCode) {
 #ifdef _WIN32
     void usleep(int waitTime) {
         const quint64 BUSY_LOOP_USECS = 2000;
-        quint64 compTime = waitTime + usecTimestampNow();
+        quint64 compTime = waitTime + usecMonotonicNow();
         quint64 compTimeSleep = compTime - BUSY_LOOP_USECS;
         while (true) {
-            if (usecTimestampNow() < compTimeSleep) {
+            if (usecMonotonicNow() < compTimeSleep) {
                 QThread::msleep(1);
             }
-            if (usecTimestampNow() >= compTime) {
+            if (usecMonotonicNow() >= compTime) {
                 break;
             }
         }
@@ -556,6 +604,64 @@ int unpackOrientationQuatFromBytes(const unsigned char* buffer, glm::quat& quatO
     return sizeof(quatParts);
 }
 
+// each of the three smallest components is stored in the low 15 bits of its part, the top bits of the first two parts
+// hold which component was the largest
+const int SMALLEST_THREE_COMPONENT_BITS = 15;
+const uint16_t SMALLEST_THREE_COMPONENT_MASK = (1 << SMALLEST_THREE_COMPONENT_BITS) - 1;
+const float SMALLEST_THREE_COMPONENT_RANGE = 1.0f / sqrtf(2.0f);
+
+int packOrientationQuatToSixBytes(unsigned char* buffer, const glm::quat& quatInput) {
+    glm::quat quat = glm::normalize(quatInput);
+    float components[4] = { quat.x, quat.y, quat.z, quat.w };
+    
+    int largestIndex = 0;
+    for (int i = 1; i < 4; i++) {
+        if (fabsf(components[i]) > fabsf(components[largestIndex])) {
+            largestIndex = i;
+        }
+    }
+    
+    // q and -q are the same rotation, so the largest component can always be made positive and left out
+    float sign = (components[largestIndex] < 0.0f) ? -1.0f : 1.0f;
+    
+    uint16_t quatParts[3];
+    for (int i = 0, part = 0; i < 4; i++) {
+        if (i != largestIndex) {
+            float component = glm::clamp(sign * components[i], -SMALLEST_THREE_COMPONENT_RANGE,
+                                         SMALLEST_THREE_COMPONENT_RANGE);
+            quatParts[part++] = floorf(((component / SMALLEST_THREE_COMPONENT_RANGE + 1.0f) / 2.0f)
+                                       * SMALLEST_THREE_COMPONENT_MASK + 0.5f);
+        }
+    }
+    quatParts[0] |= (largestIndex >> 1) << SMALLEST_THREE_COMPONENT_BITS;
+    quatParts[1] |= (largestIndex & 1) << SMALLEST_THREE_COMPONENT_BITS;
+    
+    memcpy(buffer, &quatParts, sizeof(quatParts));
+    return sizeof(quatParts);
+}
+
+int unpackOrientationQuatFromSixBytes(const unsigned char* buffer, glm::quat& quatOutput) {
+    uint16_t quatParts[3];
+    memcpy(&quatParts, buffer, sizeof(quatParts));
+    
+    int largestIndex = ((quatParts[0] >> SMALLEST_THREE_COMPONENT_BITS) << 1) | (quatParts[1] >> SMALLEST_THREE_COMPONENT_BITS);
+    
+    float components[4];
+    float sumOfSquares = 0.0f;
+    for (int i = 0, part = 0; i < 4; i++) {
+        if (i != largestIndex) {
+            float component = (((quatParts[part++] & SMALLEST_THREE_COMPONENT_MASK)
+                                / (float) SMALLEST_THREE_COMPONENT_MASK) * 2.0f - 1.0f) * SMALLEST_THREE_COMPONENT_RANGE;
+            components[i] = component;
+            sumOfSquares += component * component;
+        }
+    }
+    components[largestIndex] = sqrtf(glm::max(1.0f - sumOfSquares, 0.0f));
+    
+    quatOutput = glm::quat(components[3], components[0], components[1], components[2]);
+    return sizeof(quatParts);
+}
+
 float SMALL_LIMIT = 10.f;
 float LARGE_LIMIT = 1000.f;
 
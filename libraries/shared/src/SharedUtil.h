@@ -61,9 +61,19 @@ static const quint64 USECS_PER_SECOND = USECS_PER_MSEC * MSECS_PER_SECOND;
 
 const int BITS_IN_BYTE  = 8;
 
+/// the time since the epoch in usecs, adjusted by the skew set with usecTimestampNowForceClockSkew; for the timestamps
+/// sent to, or compared with those of, other machines
 quint64 usecTimestampNow();
 void usecTimestampNowForceClockSkew(int clockSkew);
 
+/// the time in usecs since an arbitrary point, never adjusted; cheaper than usecTimestampNow, for measuring intervals
+/// on this machine only
+quint64 usecMonotonicNow();
+
+/// as usecMonotonicNow, but from a clock that may only tick every few msecs, where that is cheaper still; for timeouts
+/// and rates that don't need the resolution
+quint64 usecCoarseMonotonicNow();
+
 float randFloat();
 int randIntInRange (int min, int max);
 float randFloatInRange (float min,float max);
@@ -136,6 +146,12 @@ int unpackFloatAngleFromTwoByte(const uint16_t* byteAnglePointer, float* destina
 int packOrientationQuatToBytes(unsigned char* buffer, const glm::quat& quatInput);
 int unpackOrientationQuatFromBytes(const unsigned char* buffer, glm::quat& quatOutput);
 
+// Of a normalized quat only the three smallest components need to be sent, the largest follows from them and none of
+// the three can be outside of -1/sqrt(2) to 1/sqrt(2), this allows us to encode the quat in 6 bytes with the
+// accuracy of packOrientationQuatToBytes
+int packOrientationQuatToSixBytes(unsigned char* buffer, const glm::quat& quatInput);
+int unpackOrientationQuatFromSixBytes(const unsigned char* buffer, glm::quat& quatOutput);
+
 // Ratios need the be highly accurate when less than 10, but not very accurate above 10, and they
 // are never greater than 1000 to 1, this allows us to encode each component in 16bits
 int packFloatRatioToTwoByte(unsigned char* buffer, float ratio);
@@ -0,0 +1,96 @@
+//
+//  SipHash.cpp
+//  libraries/shared/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#include <stdint.h>
+
+#include "SipHash.h"
+
+static inline uint64_t rotateLeft(uint64_t value, int bits) {
+    return (value << bits) | (value >> (64 - bits));
+}
+
+// the words of the key and the message are little endian whatever the machine is
+static inline uint64_t readLittleEndian64(const unsigned char* bytes) {
+    uint64_t value = 0;
+    for (int i = 7; i >= 0; i--) {
+        value = (value << 8) | bytes[i];
+    }
+    return value;
+}
+
+static inline void writeLittleEndian64(uint64_t value, unsigned char* bytes) {
+    for (int i = 0; i < 8; i++) {
+        bytes[i] = (unsigned char) (value >> (8 * i));
+    }
+}
+
+static inline void sipRound(uint64_t& v0, uint64_t& v1, uint64_t& v2, uint64_t& v3) {
+    v0 += v1;
+    v1 = rotateLeft(v1, 13);
+    v1 ^= v0;
+    v0 = rotateLeft(v0, 32);
+    v2 += v3;
+    v3 = rotateLeft(v3, 16);
+    v3 ^= v2;
+    v0 += v3;
+    v3 = rotateLeft(v3, 21);
+    v3 ^= v0;
+    v2 += v1;
+    v1 = rotateLeft(v1, 17);
+    v1 ^= v2;
+    v2 = rotateLeft(v2, 32);
+}
+
+void sipHash128(const unsigned char* key, const void* data, int size, unsigned char* hash) {
+    const int COMPRESSION_ROUNDS = 2;
+    const int FINALIZATION_ROUNDS = 4;
+    
+    uint64_t k0 = readLittleEndian64(key);
+    uint64_t k1 = readLittleEndian64(key + sizeof(uint64_t));
+    
+    uint64_t v0 = k0 ^ 0x736f6d6570736575ULL;
+    uint64_t v1 = k1 ^ 0x646f72616e646f6dULL ^ 0xee;
+    uint64_t v2 = k0 ^ 0x6c7967656e657261ULL;
+    uint64_t v3 = k1 ^ 0x7465646279746573ULL;
+    
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    const unsigned char* end = bytes + (size - (size % sizeof(uint64_t)));
+    for (; bytes != end; bytes += sizeof(uint64_t)) {
+        uint64_t word = readLittleEndian64(bytes);
+        v3 ^= word;
+        for (int i = 0; i < COMPRESSION_ROUNDS; i++) {
+            sipRound(v0, v1, v2, v3);
+        }
+        v0 ^= word;
+    }
+    
+    // the last word has what is left of the message and its length in the top byte
+    uint64_t lastWord = ((uint64_t) size) << 56;
+    for (int i = size % sizeof(uint64_t) - 1; i >= 0; i--) {
+        lastWord |= ((uint64_t) bytes[i]) << (8 * i);
+    }
+    v3 ^= lastWord;
+    for (int i = 0; i < COMPRESSION_ROUNDS; i++) {
+        sipRound(v0, v1, v2, v3);
+    }
+    v0 ^= lastWord;
+    
+    v2 ^= 0xee;
+    for (int i = 0; i < FINALIZATION_ROUNDS; i++) {
+        sipRound(v0, v1, v2, v3);
+    }
+    writeLittleEndian64(v0 ^ v1 ^ v2 ^ v3, hash);
+    
+    v1 ^= 0xdd;
+    for (int i = 0; i < FINALIZATION_ROUNDS; i++) {
+        sipRound(v0, v1, v2, v3);
+    }
+    writeLittleEndian64(v0 ^ v1 ^ v2 ^ v3, hash + sizeof(uint64_t));
+}
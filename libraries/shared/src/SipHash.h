@@ -0,0 +1,22 @@
+//
+//  SipHash.h
+//  libraries/shared/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#ifndef hifi_SipHash_h
+#define hifi_SipHash_h
+
+const int SIP_HASH_KEY_BYTES = 16;
+const int SIP_HASH_128_BYTES = 16;
+
+/// Computes the 128 bit SipHash-2-4 of size bytes of data keyed by the 16 bytes of key into the 16 bytes of hash. It is a
+/// keyed hash made for short messages such as packets, that can't be forged without the key and is many times faster
+/// than MD5, and it works in place without allocating.
+void sipHash128(const unsigned char* key, const void* data, int size, unsigned char* hash);
+
+#endif // hifi_SipHash_h
@@ -0,0 +1,119 @@
+//
+//  SlabAllocator.cpp
+//  libraries/shared/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#include <algorithm>
+
+#include "SlabAllocator.h"
+
+// new char[] gives back memory aligned for any type, so blocks that are multiples of this stay aligned
+const size_t BLOCK_ALIGNMENT = 16;
+
+static QMutex allocatorsMutex;
+static std::vector<SlabAllocator*> allocators;
+
+SlabAllocator::SlabAllocator(size_t blockSize, int blocksPerSlab) :
+    _mutex(),
+    _blockSize(std::max(((blockSize + BLOCK_ALIGNMENT - 1) / BLOCK_ALIGNMENT) * BLOCK_ALIGNMENT, BLOCK_ALIGNMENT)),
+    _blocksPerSlab(std::max(blocksPerSlab, 1)),
+    _slabs(),
+    _freeBlocks(NULL),
+    _numBlocksInUse(0)
+{
+    QMutexLocker locker(&allocatorsMutex);
+    allocators.push_back(this);
+}
+
+SlabAllocator::~SlabAllocator() {
+    {
+        QMutexLocker locker(&allocatorsMutex);
+        allocators.erase(std::remove(allocators.begin(), allocators.end(), this), allocators.end());
+    }
+    for (size_t i = 0; i < _slabs.size(); i++) {
+        delete[] _slabs[i];
+    }
+}
+
+void* SlabAllocator::allocate() {
+    QMutexLocker locker(&_mutex);
+    if (!_freeBlocks) {
+        // carve a new slab up, linking its blocks so that the first is handed out first
+        char* slab = new char[_blocksPerSlab * _blockSize];
+        _slabs.push_back(slab);
+        for (int i = _blocksPerSlab - 1; i >= 0; i--) {
+            FreeBlock* block = reinterpret_cast<FreeBlock*>(slab + i * _blockSize);
+            block->next = _freeBlocks;
+            _freeBlocks = block;
+        }
+    }
+    FreeBlock* block = _freeBlocks;
+    _freeBlocks = block->next;
+    _numBlocksInUse++;
+    return block;
+}
+
+void SlabAllocator::deallocate(void* block) {
+    if (!block) {
+        return;
+    }
+    QMutexLocker locker(&_mutex);
+    FreeBlock* freeBlock = static_cast<FreeBlock*>(block);
+    freeBlock->next = _freeBlocks;
+    _freeBlocks = freeBlock;
+    _numBlocksInUse--;
+}
+
+void SlabAllocator::releaseUnusedSlabs() {
+    QMutexLocker locker(&_mutex);
+    if (_slabs.empty()) {
+        return;
+    }
+    
+    // with the free blocks and the slabs in address order, the free blocks of each slab are found in one pass
+    std::vector<char*> freeBlocks;
+    for (FreeBlock* block = _freeBlocks; block; block = block->next) {
+        freeBlocks.push_back(reinterpret_cast<char*>(block));
+    }
+    std::sort(freeBlocks.begin(), freeBlocks.end());
+    std::sort(_slabs.begin(), _slabs.end());
+    
+    const std::vector<char*>& sortedFreeBlocks = freeBlocks;
+    std::vector<char*> keptSlabs;
+    std::vector<char*>::const_iterator blockIt = sortedFreeBlocks.begin();
+    _freeBlocks = NULL;
+    size_t slabBytes = _blocksPerSlab * _blockSize;
+    for (size_t i = 0; i < _slabs.size(); i++) {
+        char* slab = _slabs[i];
+        std::vector<char*>::const_iterator slabBlocksStart = std::lower_bound(blockIt, sortedFreeBlocks.end(), slab);
+        std::vector<char*>::const_iterator slabBlocksEnd = std::lower_bound(slabBlocksStart, sortedFreeBlocks.end(),
+            slab + slabBytes);
+        blockIt = slabBlocksEnd;
+        
+        if (slabBlocksEnd - slabBlocksStart == _blocksPerSlab) {
+            delete[] slab;
+            continue;
+        }
+        keptSlabs.push_back(slab);
+        
+        // relink the free blocks of the slabs that are kept
+        for (std::vector<char*>::const_iterator it = slabBlocksEnd; it != slabBlocksStart; ) {
+            FreeBlock* block = reinterpret_cast<FreeBlock*>(*--it);
+            block->next = _freeBlocks;
+            _freeBlocks = block;
+        }
+    }
+    _slabs.swap(keptSlabs);
+}
+
+void SlabAllocator::releaseAllUnusedSlabs() {
+    QMutexLocker locker(&allocatorsMutex);
+    for (size_t i = 0; i < allocators.size(); i++) {
+        allocators[i]->releaseUnusedSlabs();
+    }
+}
@@ -0,0 +1,68 @@
+//
+//  SlabAllocator.h
+//  libraries/shared/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#ifndef hifi_SlabAllocator_h
+#define hifi_SlabAllocator_h
+
+#include <cstddef>
+#include <vector>
+
+#include <QtCore/QMutex>
+
+/// Hands out blocks of one size carved from large slabs, so that millions of small objects of the same kind cost a
+/// few thousand allocations rather than millions and don't fragment the heap. Freed blocks go on a list to be handed
+/// out again. The slabs are only given back by releaseUnusedSlabs, and only once none of their blocks are in use.
+/// Safe to use from any thread.
+class SlabAllocator {
+public:
+    
+    /// the block size is rounded up to keep the blocks aligned for any type
+    SlabAllocator(size_t blockSize, int blocksPerSlab = DEFAULT_BLOCKS_PER_SLAB);
+    
+    /// frees all the slabs, whether their blocks are still in use or not
+    ~SlabAllocator();
+    
+    size_t getBlockSize() const { return _blockSize; }
+    
+    void* allocate();
+    void deallocate(void* block);
+    
+    /// gives the slabs none of whose blocks are in use back to the heap, such as once a tree has been emptied
+    void releaseUnusedSlabs();
+    
+    /// calls releaseUnusedSlabs on every allocator there is
+    static void releaseAllUnusedSlabs();
+    
+    int getNumBlocksInUse() const { return _numBlocksInUse; }
+    int getNumSlabs() const { return _slabs.size(); }
+    size_t getSlabBytes() const { return _slabs.size() * _blocksPerSlab * _blockSize; }
+    
+    static const int DEFAULT_BLOCKS_PER_SLAB = 1024;
+    
+private:
+    // disallow copying of SlabAllocator objects
+    SlabAllocator(const SlabAllocator&);
+    SlabAllocator& operator= (const SlabAllocator&);
+    
+    /// the free blocks are linked through their first bytes
+    class FreeBlock {
+    public:
+        FreeBlock* next;
+    };
+    
+    QMutex _mutex;
+    size_t _blockSize;
+    int _blocksPerSlab;
+    std::vector<char*> _slabs;
+    FreeBlock* _freeBlocks;
+    int _numBlocksInUse;
+};
+
+#endif // hifi_SlabAllocator_h
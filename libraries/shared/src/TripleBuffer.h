@@ -0,0 +1,86 @@
+//
+//  TripleBuffer.h
+//  libraries/shared/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#ifndef hifi_TripleBuffer_h
+#define hifi_TripleBuffer_h
+
+#include <QtCore/QAtomicInt>
+
+/// Hands the latest of the values one thread produces to another thread, without locks and without either waiting.
+/// The producer fills its own buffer and swaps it with the middle one; the consumer swaps the middle one with its own
+/// when the middle one holds a value it hasn't seen. Values the consumer was too slow to take are simply replaced, so
+/// this suits state that's sampled, such as the pose a tracker last reported, rather than a stream of events.
+template<typename T>
+class TripleBuffer {
+public:
+
+    TripleBuffer();
+
+    /// the buffer to fill before publishing it. Only to be called from the producing thread
+    T& getWriteBuffer() { return _buffers[_writeIndex]; }
+
+    /// makes the write buffer the latest value, taking the buffer it replaces to write into next
+    void publish();
+
+    /// copies the value into the write buffer and publishes it
+    void publish(const T& value) { getWriteBuffer() = value; publish(); }
+
+    /// whether a value has been published since the consumer last took one. Safe to call from either side
+    bool hasNewValue() const { return _middle.load() & FRESH_BIT; }
+
+    /// takes the latest value into the read buffer if there's one it hasn't seen, returning whether there was.
+    /// Only to be called from the consuming thread
+    bool update();
+
+    /// the latest value taken, or the default one if none has been yet. Only to be called from the consuming thread
+    const T& getReadBuffer() const { return _buffers[_readIndex]; }
+
+    /// the read buffer is the consumer's alone until it next updates, so it may change it (to cache derived state, say)
+    T& getReadBuffer() { return _buffers[_readIndex]; }
+
+private:
+
+    // disallow copying of TripleBuffer objects
+    TripleBuffer(const TripleBuffer&);
+    TripleBuffer& operator= (const TripleBuffer&);
+
+    static const int INDEX_MASK = 0x3;
+    static const int FRESH_BIT = 0x4;
+
+    T _buffers[3];
+    int _writeIndex; /// only touched by the producer
+    int _readIndex; /// only touched by the consumer
+    QAtomicInt _middle; /// the index of the middle buffer, with the fresh bit set if the consumer hasn't taken it
+};
+
+template<typename T>
+TripleBuffer<T>::TripleBuffer() :
+    _writeIndex(0),
+    _readIndex(1),
+    _middle(2) {
+}
+
+template<typename T>
+void TripleBuffer<T>::publish() {
+    // the ordered swap releases what was written to the buffer before the consumer can take it
+    _writeIndex = _middle.fetchAndStoreOrdered(_writeIndex | FRESH_BIT) & INDEX_MASK;
+}
+
+template<typename T>
+bool TripleBuffer<T>::update() {
+    if (!hasNewValue()) {
+        return false;
+    }
+    // only the producer sets the fresh bit, so the middle buffer is still fresh by the time it's swapped
+    _readIndex = _middle.fetchAndStoreOrdered(_readIndex) & INDEX_MASK;
+    return true;
+}
+
+#endif // hifi_TripleBuffer_h
@@ -0,0 +1,257 @@
+//
+//  VoxelAnimation.cpp
+//  libraries/voxels/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#include <cmath>
+#include <cstring>
+
+#include <OctalCode.h>
+#include <UUID.h>
+
+#include "VoxelConstants.h"
+#include "VoxelAnimation.h"
+
+const int PART_BYTES = 3 * sizeof(qint16) + 2 * sizeof(rgbColor) + sizeof(quint16);
+const int RECORD_DATA_BYTES = sizeof(unsigned char) + sizeof(float) + 3 * sizeof(float) + 2 * sizeof(quint32) +
+    sizeof(float) + 3 * sizeof(quint16);
+const float PHASES_PER_PERIOD = 65536.0f;
+
+VoxelAnimation::VoxelAnimation() :
+    voxelSize(0.0f),
+    origin(0.0f, 0.0f, 0.0f),
+    colorPeriodMsecs(0),
+    orbitPeriodMsecs(0),
+    orbitRadius(0.0f),
+    chase(false) {
+}
+
+unsigned char* VoxelAnimation::getEnclosingOctalCode() const {
+    glm::vec3 minimum = origin;
+    glm::vec3 maximum = origin;
+    if (!parts.isEmpty()) {
+        glm::vec3 minimumPart(parts.at(0).x, parts.at(0).y, parts.at(0).z);
+        glm::vec3 maximumPart = minimumPart;
+        foreach (const VoxelAnimationPart& part, parts) {
+            minimumPart = glm::min(minimumPart, glm::vec3(part.x, part.y, part.z));
+            maximumPart = glm::max(maximumPart, glm::vec3(part.x, part.y, part.z));
+        }
+        maximumPart += glm::vec3(1.0f, 1.0f, 1.0f);
+        minimum = origin + minimumPart * voxelSize;
+        maximum = origin + maximumPart * voxelSize;
+
+        if (orbitPeriodMsecs != 0) {
+            // the parts turn as they go round, so they reach as far as their farthest corner in any direction
+            float reach = glm::max(glm::max(glm::abs(minimumPart.x), glm::abs(maximumPart.x)),
+                glm::max(glm::abs(minimumPart.z), glm::abs(maximumPart.z))) * voxelSize * sqrtf(2.0f) + orbitRadius;
+            minimum.x = origin.x - reach;
+            minimum.z = origin.z - reach;
+            maximum.x = origin.x + reach;
+            maximum.z = origin.z + reach;
+        }
+    }
+    minimum = glm::clamp(minimum, 0.0f, 1.0f);
+    maximum = glm::clamp(maximum, 0.0f, 1.0f);
+
+    OctalKey key = { 0, 0, 0 };
+    for (bool descended = true; descended && key.sections < OCTAL_KEY_SECTIONS_PER_WORD; ) {
+        descended = false;
+        for (int i = 0; i < NUMBER_OF_CHILDREN; i++) {
+            OctalKey childKey = childOctalKey(key, i);
+            VoxelPositionSize cube;
+            voxelDetailsForKey(childKey, cube);
+            if (minimum.x >= cube.x && minimum.y >= cube.y && minimum.z >= cube.z &&
+                    maximum.x <= cube.x + cube.s && maximum.y <= cube.y + cube.s && maximum.z <= cube.z + cube.s) {
+                key = childKey;
+                descended = true;
+                break;
+            }
+        }
+    }
+    unsigned char* octalCode = new unsigned char[bytesRequiredForCodeLength(key.sections)];
+    copyOctalCodeForKey(key, octalCode);
+    return octalCode;
+}
+
+void VoxelAnimation::evaluate(quint64 msecs, QHash<QByteArray, QByteArray>& voxels) const {
+    glm::vec3 center = origin;
+    float angle = 0.0f;
+    if (orbitPeriodMsecs != 0) {
+        angle = TWO_PI * (msecs % orbitPeriodMsecs) / orbitPeriodMsecs;
+        center += glm::vec3(orbitRadius * cosf(angle), 0.0f, orbitRadius * sinf(angle));
+    }
+    // turned the other way about the y axis, so that the parts' +z faces along the orbit
+    float cosAngle = cosf(angle);
+    float sinAngle = sinf(angle);
+
+    float cycle = (colorPeriodMsecs == 0) ? 0.0f : (float)(msecs % colorPeriodMsecs) / colorPeriodMsecs;
+    float chasePosition = 1.0f - fabsf(2.0f * cycle - 1.0f);
+    float chaseSpacing = 1.0f / qMax(parts.size() - 1, 1);
+
+    foreach (const VoxelAnimationPart& part, parts) {
+        glm::vec3 offset = glm::vec3(part.x, part.y, part.z) * voxelSize;
+        glm::vec3 position = center + glm::vec3(offset.x * cosAngle - offset.z * sinAngle, offset.y,
+            offset.x * sinAngle + offset.z * cosAngle);
+
+        // to the nearest voxel, rather than whichever one the rounding of the turn happens to leave it in
+        position = glm::floor(position / voxelSize + 0.5f) * voxelSize;
+        if (glm::any(glm::lessThan(position, glm::vec3(0.0f))) ||
+                glm::any(glm::greaterThan(position + voxelSize, glm::vec3(1.0f)))) {
+            continue;
+        }
+
+        float gradient = 0.0f;
+        if (colorPeriodMsecs != 0) {
+            float phase = part.phase / PHASES_PER_PERIOD;
+            if (chase) {
+                gradient = (fabsf(chasePosition - phase) < chaseSpacing * 0.5f) ? 1.0f : 0.0f;
+            } else {
+                float partCycle = cycle + phase;
+                partCycle -= floorf(partCycle);
+                gradient = 1.0f - fabsf(2.0f * partCycle - 1.0f);
+            }
+        }
+        unsigned char color[BYTES_PER_COLOR];
+        for (int i = 0; i < BYTES_PER_COLOR; i++) {
+            color[i] = (unsigned char)(part.colorA[i] + (part.colorB[i] - part.colorA[i]) * gradient + 0.5f);
+        }
+
+        unsigned char* codeColorBuffer = pointToVoxel(position.x, position.y, position.z, voxelSize,
+            color[RED_INDEX], color[GREEN_INDEX], color[BLUE_INDEX]);
+        int codeBytes = bytesRequiredForCodeLength(numberOfThreeBitSectionsInCode(codeColorBuffer));
+        voxels.insert(QByteArray(reinterpret_cast<const char*>(codeColorBuffer), codeBytes),
+            QByteArray(reinterpret_cast<const char*>(codeColorBuffer), codeBytes + BYTES_PER_COLOR));
+        delete[] codeColorBuffer;
+    }
+}
+
+int VoxelAnimation::encodeEditRecord(const QUuid& id, unsigned char flags, int firstPart, unsigned char* buffer,
+                                     int maxSize, int& partsWritten) const {
+    unsigned char* enclosingOctalCode = getEnclosingOctalCode();
+    int codeBytes = bytesRequiredForCodeLength(numberOfThreeBitSectionsInCode(enclosingOctalCode));
+    partsWritten = qBound(0, (maxSize - codeBytes - NUM_BYTES_RFC4122_UUID - RECORD_DATA_BYTES) / PART_BYTES,
+        parts.size() - firstPart);
+    if (codeBytes + NUM_BYTES_RFC4122_UUID + RECORD_DATA_BYTES > maxSize) {
+        delete[] enclosingOctalCode;
+        return 0;
+    }
+    unsigned char* copyAt = buffer;
+    memcpy(copyAt, enclosingOctalCode, codeBytes);
+    copyAt += codeBytes;
+    delete[] enclosingOctalCode;
+
+    memcpy(copyAt, id.toRfc4122().constData(), NUM_BYTES_RFC4122_UUID);
+    copyAt += NUM_BYTES_RFC4122_UUID;
+
+    *copyAt++ = flags | (chase ? VOXEL_ANIMATION_CHASE : 0);
+    memcpy(copyAt, &voxelSize, sizeof(float));
+    copyAt += sizeof(float);
+    memcpy(copyAt, &origin.x, sizeof(float));
+    copyAt += sizeof(float);
+    memcpy(copyAt, &origin.y, sizeof(float));
+    copyAt += sizeof(float);
+    memcpy(copyAt, &origin.z, sizeof(float));
+    copyAt += sizeof(float);
+    memcpy(copyAt, &colorPeriodMsecs, sizeof(quint32));
+    copyAt += sizeof(quint32);
+    memcpy(copyAt, &orbitPeriodMsecs, sizeof(quint32));
+    copyAt += sizeof(quint32);
+    memcpy(copyAt, &orbitRadius, sizeof(float));
+    copyAt += sizeof(float);
+
+    quint16 totalParts = parts.size();
+    quint16 recordFirstPart = firstPart;
+    quint16 recordParts = partsWritten;
+    memcpy(copyAt, &totalParts, sizeof(quint16));
+    copyAt += sizeof(quint16);
+    memcpy(copyAt, &recordFirstPart, sizeof(quint16));
+    copyAt += sizeof(quint16);
+    memcpy(copyAt, &recordParts, sizeof(quint16));
+    copyAt += sizeof(quint16);
+
+    for (int i = firstPart; i < firstPart + partsWritten; i++) {
+        const VoxelAnimationPart& part = parts.at(i);
+        memcpy(copyAt, &part.x, sizeof(qint16));
+        copyAt += sizeof(qint16);
+        memcpy(copyAt, &part.y, sizeof(qint16));
+        copyAt += sizeof(qint16);
+        memcpy(copyAt, &part.z, sizeof(qint16));
+        copyAt += sizeof(qint16);
+        memcpy(copyAt, part.colorA, sizeof(rgbColor));
+        copyAt += sizeof(rgbColor);
+        memcpy(copyAt, part.colorB, sizeof(rgbColor));
+        copyAt += sizeof(rgbColor);
+        memcpy(copyAt, &part.phase, sizeof(quint16));
+        copyAt += sizeof(quint16);
+    }
+    return copyAt - buffer;
+}
+
+int VoxelAnimation::readEditRecordData(const unsigned char* data, int maxLength, unsigned char& flags) {
+    if (maxLength < RECORD_DATA_BYTES) {
+        return -1;
+    }
+    const unsigned char* dataAt = data;
+    flags = *dataAt++;
+    chase = (flags & VOXEL_ANIMATION_CHASE);
+    memcpy(&voxelSize, dataAt, sizeof(float));
+    dataAt += sizeof(float);
+    memcpy(&origin.x, dataAt, sizeof(float));
+    dataAt += sizeof(float);
+    memcpy(&origin.y, dataAt, sizeof(float));
+    dataAt += sizeof(float);
+    memcpy(&origin.z, dataAt, sizeof(float));
+    dataAt += sizeof(float);
+    memcpy(&colorPeriodMsecs, dataAt, sizeof(quint32));
+    dataAt += sizeof(quint32);
+    memcpy(&orbitPeriodMsecs, dataAt, sizeof(quint32));
+    dataAt += sizeof(quint32);
+    memcpy(&orbitRadius, dataAt, sizeof(float));
+    dataAt += sizeof(float);
+
+    quint16 totalParts;
+    quint16 firstPart;
+    quint16 recordParts;
+    memcpy(&totalParts, dataAt, sizeof(quint16));
+    dataAt += sizeof(quint16);
+    memcpy(&firstPart, dataAt, sizeof(quint16));
+    dataAt += sizeof(quint16);
+    memcpy(&recordParts, dataAt, sizeof(quint16));
+    dataAt += sizeof(quint16);
+    if (RECORD_DATA_BYTES + recordParts * PART_BYTES > maxLength) {
+        return -1;
+    }
+    int recordBytes = RECORD_DATA_BYTES + recordParts * PART_BYTES;
+
+    // the parts are kept up to the first one missing, the rest coming again when the animation is next sent
+    if (parts.size() > totalParts) {
+        parts.resize(totalParts);
+    }
+    if (firstPart > parts.size() || firstPart + recordParts > totalParts) {
+        return recordBytes;
+    }
+    if (firstPart + recordParts > parts.size()) {
+        parts.resize(firstPart + recordParts);
+    }
+    for (int i = firstPart; i < firstPart + recordParts; i++) {
+        VoxelAnimationPart& part = parts[i];
+        memcpy(&part.x, dataAt, sizeof(qint16));
+        dataAt += sizeof(qint16);
+        memcpy(&part.y, dataAt, sizeof(qint16));
+        dataAt += sizeof(qint16);
+        memcpy(&part.z, dataAt, sizeof(qint16));
+        dataAt += sizeof(qint16);
+        memcpy(part.colorA, dataAt, sizeof(rgbColor));
+        dataAt += sizeof(rgbColor);
+        memcpy(part.colorB, dataAt, sizeof(rgbColor));
+        dataAt += sizeof(rgbColor);
+        memcpy(&part.phase, dataAt, sizeof(quint16));
+        dataAt += sizeof(quint16);
+    }
+    return recordBytes;
+}
@@ -0,0 +1,65 @@
+//
+//  VoxelAnimation.h
+//  libraries/voxels/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#ifndef hifi_VoxelAnimation_h
+#define hifi_VoxelAnimation_h
+
+#include <QtCore/QByteArray>
+#include <QtCore/QHash>
+#include <QtCore/QUuid>
+#include <QtCore/QVector>
+
+#include <glm/glm.hpp>
+
+#include <SharedUtil.h>
+
+/// A voxel of an animated volume, placed in voxels from the volume's origin and colored between its two colors.
+class VoxelAnimationPart {
+public:
+    qint16 x;
+    qint16 y;
+    qint16 z;
+    rgbColor colorA;
+    rgbColor colorB;
+    quint16 phase; /// in 65536ths of the color period: how far into it the part starts, or where it's lit in a chase
+};
+
+/// A volume of voxels of one size that the voxel server animates itself, so that it's described once rather than
+/// edited a frame at a time. Its parts can orbit a circle around the origin, turning to face along it, and fade from
+/// their first color to their second and back, or light up one at a time as a chase goes back and forth over them.
+class VoxelAnimation {
+public:
+    VoxelAnimation();
+
+    float voxelSize;
+    glm::vec3 origin;
+    quint32 colorPeriodMsecs; /// 0 for parts that keep their first color
+    quint32 orbitPeriodMsecs; /// 0 for parts that stay around the origin
+    float orbitRadius;
+    bool chase; /// whether the parts are lit in turn rather than fading
+    QVector<VoxelAnimationPart> parts;
+
+    /// the octal code of the smallest voxel that holds the animation wherever it goes, which the caller deletes[]
+    unsigned char* getEnclosingOctalCode() const;
+
+    /// the animation's voxels after it's run for a time, as code color buffers by their octal codes
+    void evaluate(quint64 msecs, QHash<QByteArray, QByteArray>& voxels) const;
+
+    /// Writes a PacketTypeVoxelAnimate record of the animation, with the parts from the first that fit in the buffer.
+    /// Returns its size, or 0 if not even the header fits.
+    int encodeEditRecord(const QUuid& id, unsigned char flags, int firstPart, unsigned char* buffer, int maxSize,
+                         int& partsWritten) const;
+
+    /// Reads what follows the enclosing code and id of a PacketTypeVoxelAnimate record into the animation, keeping the
+    /// parts it doesn't have. Returns the bytes read, or -1 if the record runs past the end of the data.
+    int readEditRecordData(const unsigned char* data, int maxLength, unsigned char& flags);
+};
+
+#endif // hifi_VoxelAnimation_h
@@ -45,6 +45,14 @@ const float VIEW_CULLING_RATE_IN_MILLISECONDS = 1000.0f; // once a second is fin
 const quint64 CLIENT_TO_SERVER_VOXEL_SEND_INTERVAL_USECS = 1000 * 5; // 1 packet every 50 milliseconds
 
 
+// a PacketTypeVoxelCopySubtree record is the source octal code, the destination octal code and a byte of these flags
+const unsigned char VOXEL_COPY_SUBTREE_MOVE = 1; // deletes the subtree at the source once it's copied
+
+// a PacketTypeVoxelAnimate record is the octal code of the voxel the animation stays in, its id, a byte of these flags and
+// the rest of a VoxelAnimation with some of its parts
+const unsigned char VOXEL_ANIMATION_REMOVE = 1; // stops the animation and erases its voxels
+const unsigned char VOXEL_ANIMATION_CHASE = 2; // the parts are lit in turn rather than fading
+
 const int DEFAULT_MAX_VOXEL_PPS = 600; // the default maximum PPS we think a voxel server should send to a client
 
 #endif // hifi_VoxelConstants_h
@@ -13,6 +13,7 @@
 #include <PerfStat.h>
 #include <OctalCode.h>
 #include <PacketHeaders.h>
+#include "VoxelConstants.h"
 #include "VoxelEditPacketSender.h"
 
 #define GUESS_OF_VOXELCODE_SIZE 10
@@ -142,3 +143,83 @@ void VoxelEditPacketSender::queueVoxelEditMessages(PacketType type, int numberOf
         }
     }    
 }
+
+bool VoxelEditPacketSender::queueSubtreeCopyMessage(const unsigned char* sourceOctalCode,
+                                                    const unsigned char* destinationOctalCode, bool move) {
+    // the server only has its own jurisdiction's voxels, so one server has to hold everything the copy touches
+    if (!oneServerHasSubtrees(sourceOctalCode, destinationOctalCode)) {
+        return false;
+    }
+
+    int sourceBytes = bytesRequiredForCodeLength(numberOfThreeBitSectionsInCode(sourceOctalCode));
+    int destinationBytes = bytesRequiredForCodeLength(numberOfThreeBitSectionsInCode(destinationOctalCode));
+    unsigned char bufferOut[MAX_PACKET_SIZE];
+    int sizeOut = sourceBytes + destinationBytes + sizeof(unsigned char);
+    if (sizeOut > _maxPacketSize) {
+        return false;
+    }
+    memcpy(bufferOut, sourceOctalCode, sourceBytes);
+    memcpy(bufferOut + sourceBytes, destinationOctalCode, destinationBytes);
+    bufferOut[sourceBytes + destinationBytes] = move ? VOXEL_COPY_SUBTREE_MOVE : 0;
+
+    // the message goes to the servers whose jurisdiction has its first code, the source
+    queueOctreeEditMessage(PacketTypeVoxelCopySubtree, bufferOut, sizeOut);
+    return true;
+}
+
+bool VoxelEditPacketSender::queueVoxelAnimationMessages(const QUuid& id, const VoxelAnimation& animation) {
+    return queueVoxelAnimationRecords(id, animation, 0);
+}
+
+bool VoxelEditPacketSender::queueVoxelAnimationRemovalMessage(const QUuid& id, const VoxelAnimation& animation) {
+    return queueVoxelAnimationRecords(id, animation, VOXEL_ANIMATION_REMOVE);
+}
+
+bool VoxelEditPacketSender::oneServerHasSubtrees(const unsigned char* firstOctalCode,
+                                                 const unsigned char* secondOctalCode) {
+    if (!_shouldSend || !_serverJurisdictions || !voxelServersExist()) {
+        return false;
+    }
+    bool oneServerHasBoth = false;
+    _serverJurisdictions->lockForRead();
+    foreach (const SharedNodePointer& node, NodeList::getInstance()->getNodeHash()) {
+        if (node->getActiveSocket() && node->getType() == getMyNodeType()) {
+            NodeToJurisdictionMap::const_iterator map = _serverJurisdictions->constFind(node->getUUID());
+            if (map != _serverJurisdictions->constEnd() && map->containsSubtree(firstOctalCode)
+                    && map->containsSubtree(secondOctalCode)) {
+                oneServerHasBoth = true;
+                break;
+            }
+        }
+    }
+    _serverJurisdictions->unlock();
+    return oneServerHasBoth;
+}
+
+bool VoxelEditPacketSender::queueVoxelAnimationRecords(const QUuid& id, const VoxelAnimation& animation,
+                                                       unsigned char flags) {
+    // the server animates only its own jurisdiction's voxels, so one server has to hold everywhere the animation goes
+    unsigned char* enclosingOctalCode = animation.getEnclosingOctalCode();
+    bool oneServerHasAll = oneServerHasSubtrees(enclosingOctalCode, enclosingOctalCode);
+    delete[] enclosingOctalCode;
+    if (!oneServerHasAll) {
+        return false;
+    }
+
+    // each record is sent whole in a packet after its header, sequence number and timestamp
+    int maxRecordSize = _maxPacketSize - MAX_PACKET_HEADER_BYTES - sizeof(unsigned short) - sizeof(quint64);
+    unsigned char bufferOut[MAX_PACKET_SIZE];
+    int firstPart = 0;
+
+    // as many records as the parts need, or the one for a removal
+    do {
+        int partsWritten;
+        int sizeOut = animation.encodeEditRecord(id, flags, firstPart, bufferOut, maxRecordSize, partsWritten);
+        if (sizeOut == 0 || (partsWritten == 0 && firstPart < animation.parts.size())) {
+            return false;
+        }
+        queueOctreeEditMessage(PacketTypeVoxelAnimate, bufferOut, sizeOut);
+        firstPart += partsWritten;
+    } while (!(flags & VOXEL_ANIMATION_REMOVE) && firstPart < animation.parts.size());
+    return true;
+}
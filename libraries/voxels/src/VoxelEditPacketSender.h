@@ -15,6 +15,7 @@
 #define hifi_VoxelEditPacketSender_h
 
 #include <OctreeEditPacketSender.h>
+#include "VoxelAnimation.h"
 #include "VoxelDetail.h"
 
 /// Utility for processing, packing, queueing and sending of outbound edit voxel messages.
@@ -36,6 +37,19 @@ public:
     /// which case up to MaxPendingMessages will be buffered and processed when voxel servers are known.
     void queueVoxelEditMessages(PacketType type, int numberOfDetails, VoxelDetail* details);
 
+    /// Queues a message that has the voxel server copy the subtree at the source octal code to the destination, rebased,
+    /// deleting the source if it's a move. Returns false without queueing anything unless a single known voxel server has
+    /// both subtrees whole, in which case the caller should send the voxels themselves.
+    bool queueSubtreeCopyMessage(const unsigned char* sourceOctalCode, const unsigned char* destinationOctalCode, bool move);
+
+    /// Queues the messages that describe an animation to the voxel server, which animates it from then on and sends the
+    /// voxels it changes as it would any others. Queueing it again updates it without restarting it. Returns false
+    /// without queueing anything unless a single known voxel server has the whole of the voxel the animation stays in.
+    bool queueVoxelAnimationMessages(const QUuid& id, const VoxelAnimation& animation);
+
+    /// Queues a message that stops an animation and erases its voxels. Returns false like queueVoxelAnimationMessages.
+    bool queueVoxelAnimationRemovalMessage(const QUuid& id, const VoxelAnimation& animation);
+
     /// call this to inform the VoxelEditPacketSender of the voxel server jurisdictions. This is required for normal operation.
     /// The internal contents of the jurisdiction map may change throughout the lifetime of the VoxelEditPacketSender. This map
     /// can be set prior to voxel servers being present, so long as the contents of the map accurately reflect the current
@@ -49,5 +63,9 @@ public:
 
     // My server type is the voxel server
     virtual char getMyNodeType() const { return NodeType::VoxelServer; }
+
+private:
+    bool oneServerHasSubtrees(const unsigned char* firstOctalCode, const unsigned char* secondOctalCode);
+    bool queueVoxelAnimationRecords(const QUuid& id, const VoxelAnimation& animation, unsigned char flags);
 };
 #endif // hifi_VoxelEditPacketSender_h
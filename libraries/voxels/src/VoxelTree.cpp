@@ -12,16 +12,20 @@
 #include <algorithm>
 
 #include <QtCore/QDebug>
+#include <QtCore/QSet>
 #include <QImage>
 #include <QRgb>
 
+#include <UUID.h>
 
 #include "VoxelTree.h"
 #include "Tags.h"
 
 // Voxel Specific operations....
 
-VoxelTree::VoxelTree(bool shouldReaverage) : Octree(shouldReaverage) 
+VoxelTree::VoxelTree(bool shouldReaverage) :
+    Octree(shouldReaverage),
+    _isBatchingEdits(false)
 {
     _rootElement = createNewElement();
 }
@@ -421,18 +425,71 @@ public:
     int lengthOfCode;
     bool destructive;
     bool pathChanged;
+    bool deferSubtreeChanged;
 };
 
 void VoxelTree::readCodeColorBufferToTree(const unsigned char* codeColorBuffer, bool destructive) {
+    structureMayHaveChanged();
     ReadCodeColorBufferToTreeArgs args;
     args.codeColorBuffer = codeColorBuffer;
     args.lengthOfCode = numberOfThreeBitSectionsInCode(codeColorBuffer);
     args.destructive = destructive;
     args.pathChanged = false;
+    args.deferSubtreeChanged = false;
     VoxelTreeElement* node = getRoot();
     readCodeColorBufferToTreeRecursion(node, args);
 }
 
+void VoxelTree::copySubtree(const unsigned char* sourceOctalCode, const unsigned char* destinationOctalCode, bool move) {
+    // the sets batched before the copy are made first, so that it copies what they set
+    readBatchedCodeColorBuffers();
+    structureMayHaveChanged();
+
+    int sourceLength = numberOfThreeBitSectionsInCode(sourceOctalCode);
+    VoxelTreeElement* source = static_cast<VoxelTreeElement*>(nodeForOctalCode(getRoot(), sourceOctalCode, NULL));
+    VoxelTree copy;
+    bool sourceIsInsideVoxel = false;
+    nodeColor sourceColor;
+    if (numberOfThreeBitSectionsInCode(source->getOctalCode()) == sourceLength) {
+        copySubTreeIntoNewTree(source, &copy, true);
+    } else if (source->isLeaf() && source->isColored()) {
+        sourceIsInsideVoxel = true;
+        memcpy(sourceColor, source->getColor(), sizeof(nodeColor));
+    } else {
+        return; // there's nothing there to copy
+    }
+
+    if (move) {
+        deleteOctalCodeFromTree(sourceOctalCode, COLLAPSE_EMPTY_TREE);
+    }
+
+    int destinationBytes = bytesRequiredForCodeLength(numberOfThreeBitSectionsInCode(destinationOctalCode));
+    if (sourceIsInsideVoxel) {
+        QByteArray codeColorBuffer(reinterpret_cast<const char*>(destinationOctalCode), destinationBytes);
+        codeColorBuffer.append(reinterpret_cast<const char*>(sourceColor), SIZE_OF_COLOR_DATA);
+        readCodeColorBufferToTree(reinterpret_cast<const unsigned char*>(codeColorBuffer.constData()), true);
+        return;
+    }
+
+    OctreeElement* destination = nodeForOctalCode(getRoot(), destinationOctalCode, NULL);
+    if (*destination->getOctalCode() != *destinationOctalCode) {
+        destination = createMissingElement(destination, destinationOctalCode);
+    }
+    copyFromTreeIntoSubTree(&copy, destination);
+    reaverageOctreeElements(destination);
+
+    // then the voxels above the destination average what was copied in, deepest first
+    QVector<OctreeElement*> ancestors;
+    for (OctreeElement* ancestor = getRoot(); ancestor != destination;
+            ancestor = ancestor->getChildAtIndex(branchIndexWithDescendant(ancestor->getOctalCode(), destinationOctalCode))) {
+        ancestors.append(ancestor);
+    }
+    for (int i = ancestors.size() - 1; i >= 0; i--) {
+        ancestors.at(i)->handleSubtreeChanged(this);
+    }
+    _isDirty = true;
+}
+
 void VoxelTree::readCodeColorBufferToTreeRecursion(VoxelTreeElement* node, ReadCodeColorBufferToTreeArgs& args) {
     int lengthOfNodeCode = numberOfThreeBitSectionsInCode(node->getOctalCode());
 
@@ -493,17 +550,132 @@ void VoxelTree::readCodeColorBufferToTreeRecursion(VoxelTreeElement* node, ReadC
 
     // If the lower level did some work, then we need to let this node know, so it can
     // do any bookkeeping it wants to, like color re-averaging, time stamp marking, etc
-    if (args.pathChanged) {
+    if (args.pathChanged && !args.deferSubtreeChanged) {
         node->handleSubtreeChanged(this);
     }
 }
 
+void VoxelTree::beginEditBatch() {
+    _isBatchingEdits = true;
+}
+
+void VoxelTree::endEditBatch() {
+    readBatchedCodeColorBuffers();
+    _isBatchingEdits = false;
+}
+
+void VoxelTree::batchCodeColorBuffer(const unsigned char* codeColorBuffer, int codeLength, int length,
+                                     bool destructive) {
+    QByteArray code(reinterpret_cast<const char*>(codeColorBuffer), codeLength);
+    QHash<QByteArray, int>::iterator earlier = _batchedSetIndexes.find(code);
+    if (earlier != _batchedSetIndexes.end()) {
+        // a later set to the same voxel leaves nothing of the earlier one, unless the earlier one deleted children
+        // that the later one would have left alone
+        BatchedSet& earlierSet = _batchedSets[earlier.value()];
+        if (destructive || !earlierSet.destructive) {
+            earlierSet.codeColorBuffer.clear();
+        }
+    }
+    BatchedSet set;
+    set.codeColorBuffer = QByteArray(reinterpret_cast<const char*>(codeColorBuffer), length);
+    set.destructive = destructive;
+    _batchedSetIndexes.insert(code, _batchedSets.size());
+    _batchedSets.append(set);
+}
+
+static bool isDeeperElement(const OctreeElement* first, const OctreeElement* second) {
+    return first->getLevel() > second->getLevel();
+}
+
+void VoxelTree::readBatchedCodeColorBuffers() {
+    if (_batchedSets.isEmpty()) {
+        return;
+    }
+    structureMayHaveChanged();
+
+    QVector<QByteArray> changedCodes;
+    foreach (const BatchedSet& set, _batchedSets) {
+        if (set.codeColorBuffer.isEmpty()) {
+            continue;
+        }
+        ReadCodeColorBufferToTreeArgs args;
+        args.codeColorBuffer = reinterpret_cast<const unsigned char*>(set.codeColorBuffer.constData());
+        args.lengthOfCode = numberOfThreeBitSectionsInCode(args.codeColorBuffer);
+        args.destructive = set.destructive;
+        args.pathChanged = false;
+        args.deferSubtreeChanged = true;
+        readCodeColorBufferToTreeRecursion(getRoot(), args);
+        if (args.pathChanged) {
+            changedCodes.append(set.codeColorBuffer);
+        }
+    }
+    _batchedSets.clear();
+    _batchedSetIndexes.clear();
+
+    // the voxels above the ones that changed are found by code, since later sets may have deleted what earlier ones
+    // made, and then each is told of the change once, deepest first, so they average children already averaged
+    QSet<OctreeElement*> changedAncestors;
+    foreach (const QByteArray& codeColorBuffer, changedCodes) {
+        const unsigned char* code = reinterpret_cast<const unsigned char*>(codeColorBuffer.constData());
+        int lengthOfCode = numberOfThreeBitSectionsInCode(code);
+        OctreeElement* element = getRoot();
+        while (element && numberOfThreeBitSectionsInCode(element->getOctalCode()) < lengthOfCode) {
+            changedAncestors.insert(element);
+            element = element->getChildAtIndex(branchIndexWithDescendant(element->getOctalCode(), code));
+        }
+    }
+    QList<OctreeElement*> ancestors = changedAncestors.toList();
+    std::sort(ancestors.begin(), ancestors.end(), isDeeperElement);
+    foreach (OctreeElement* ancestor, ancestors) {
+        ancestor->handleSubtreeChanged(this);
+    }
+}
+
+void VoxelTree::update() {
+    lockForWrite();
+    if (_animations.isEmpty()) {
+        unlock();
+        return;
+    }
+    const quint64 USECS_PER_MSEC = 1000;
+    quint64 now = usecTimestampNow();
+
+    // the voxels an animation has left are erased first, then those it's changed are set in a batch, so that the
+    // voxels above them are reaveraged once
+    beginEditBatch();
+    for (QHash<QUuid, AnimatedVolume>::iterator it = _animations.begin(); it != _animations.end(); it++) {
+        QHash<QByteArray, QByteArray> voxels;
+        it->animation.evaluate((now - it->startedAt) / USECS_PER_MSEC, voxels);
+        for (QHash<QByteArray, QByteArray>::const_iterator voxel = it->voxels.constBegin();
+                voxel != it->voxels.constEnd(); voxel++) {
+            if (!voxels.contains(voxel.key())) {
+                deleteOctalCodeFromTree(reinterpret_cast<const unsigned char*>(voxel.key().constData()),
+                    COLLAPSE_EMPTY_TREE);
+                _isDirty = true;
+            }
+        }
+        for (QHash<QByteArray, QByteArray>::const_iterator voxel = voxels.constBegin(); voxel != voxels.constEnd();
+                voxel++) {
+            if (it->voxels.value(voxel.key()) != voxel.value()) {
+                batchCodeColorBuffer(reinterpret_cast<const unsigned char*>(voxel.value().constData()),
+                    voxel.key().size(), voxel.value().size(), true);
+                _isDirty = true;
+            }
+        }
+        it->voxels = voxels;
+    }
+    endEditBatch();
+    unlock();
+}
+
 bool VoxelTree::handlesEditPacketType(PacketType packetType) const {
     // we handle these types of "edit" packets
     switch (packetType) {
         case PacketTypeVoxelSet:
         case PacketTypeVoxelSetDestructive:
         case PacketTypeVoxelErase:
+        case PacketTypeVoxelCopySubtree:
+        case PacketTypeVoxelAnimate:
             return true;
         default:
             return false;
@@ -555,15 +727,100 @@ int VoxelTree::processEditPacketData(PacketType packetType, const unsigned char*
                 return maxLength;
             }
 
-            readCodeColorBufferToTree(editData, destructive);
+            if (_isBatchingEdits) {
+                batchCodeColorBuffer(editData, voxelCodeSize, voxelDataSize, destructive);
+            } else {
+                readCodeColorBufferToTree(editData, destructive);
+            }
 
             return voxelDataSize;
         } break;
 
         case PacketTypeVoxelErase:
+            // the sets before an erase are made before it, so that the erase removes what they set
+            readBatchedCodeColorBuffers();
             processRemoveOctreeElementsBitstream((unsigned char*)packetData, packetLength);
             return maxLength;
+
+        case PacketTypeVoxelCopySubtree: {
+            // the source code, the destination code and the flags, each checked against what's left of the packet
+            int sourceBytes = 0;
+            int destinationBytes = 0;
+            int sourceLength = maxLength > 0 ? numberOfThreeBitSectionsInCode(editData, maxLength) : OVERFLOWED_OCTCODE_BUFFER;
+            if (sourceLength != OVERFLOWED_OCTCODE_BUFFER) {
+                sourceBytes = bytesRequiredForCodeLength(sourceLength);
+            }
+            if (sourceLength != OVERFLOWED_OCTCODE_BUFFER && sourceBytes < maxLength) {
+                int destinationLength = numberOfThreeBitSectionsInCode(editData + sourceBytes, maxLength - sourceBytes);
+                if (destinationLength != OVERFLOWED_OCTCODE_BUFFER) {
+                    destinationBytes = bytesRequiredForCodeLength(destinationLength);
+                }
+            }
+            int copyDataSize = sourceBytes + destinationBytes + sizeof(unsigned char);
+            if (sourceBytes == 0 || destinationBytes == 0 || copyDataSize > maxLength) {
+                overflowWarnings++;
+                if (overflowWarnings % REPORT_OVERFLOW_WARNING_INTERVAL == 1) {
+                    qDebug() << "WARNING! Got voxel subtree copy record that would overflow buffer."
+                                " [NOTE: this is warning number" << overflowWarnings << ", the next" <<
+                                (REPORT_OVERFLOW_WARNING_INTERVAL-1) << "will be suppressed.]";
+                }
+                return maxLength;
+            }
+            bool move = (editData[sourceBytes + destinationBytes] & VOXEL_COPY_SUBTREE_MOVE);
+            copySubtree(editData, editData + sourceBytes, move);
+            return copyDataSize;
+        }
+        case PacketTypeVoxelAnimate:
+            return processAnimateEditData(editData, maxLength);
         default:
             return 0;
     }
 }
+
+int VoxelTree::processAnimateEditData(const unsigned char* editData, int maxLength) {
+    // the enclosing code only routed the record here, then come the id and the rest of the animation
+    int codeLength = maxLength > 0 ? numberOfThreeBitSectionsInCode(editData, maxLength) : OVERFLOWED_OCTCODE_BUFFER;
+    int codeBytes = (codeLength == OVERFLOWED_OCTCODE_BUFFER) ? maxLength : bytesRequiredForCodeLength(codeLength);
+    int dataBytes = -1;
+    QUuid id;
+    AnimatedVolume volume;
+    QHash<QUuid, AnimatedVolume>::iterator existing = _animations.end();
+    unsigned char flags = 0;
+    if (codeBytes + NUM_BYTES_RFC4122_UUID <= maxLength) {
+        id = QUuid::fromRfc4122(QByteArray::fromRawData(reinterpret_cast<const char*>(editData + codeBytes),
+            NUM_BYTES_RFC4122_UUID));
+        existing = _animations.find(id);
+        if (existing != _animations.end()) {
+            volume.animation = existing->animation;
+        }
+        dataBytes = volume.animation.readEditRecordData(editData + codeBytes + NUM_BYTES_RFC4122_UUID,
+            maxLength - codeBytes - NUM_BYTES_RFC4122_UUID, flags);
+    }
+    if (dataBytes < 0) {
+        overflowWarnings++;
+        if (overflowWarnings % REPORT_OVERFLOW_WARNING_INTERVAL == 1) {
+            qDebug() << "WARNING! Got voxel animation record that would overflow buffer."
+                        " [NOTE: this is warning number" << overflowWarnings << ", the next" <<
+                        (REPORT_OVERFLOW_WARNING_INTERVAL-1) << "will be suppressed.]";
+        }
+        return maxLength;
+    }
+
+    if (flags & VOXEL_ANIMATION_REMOVE) {
+        if (existing != _animations.end()) {
+            readBatchedCodeColorBuffers();
+            foreach (const QByteArray& octalCode, existing->voxels.keys()) {
+                deleteOctalCodeFromTree(reinterpret_cast<const unsigned char*>(octalCode.constData()), COLLAPSE_EMPTY_TREE);
+            }
+            _animations.erase(existing);
+            _isDirty = true;
+        }
+    } else if (existing != _animations.end()) {
+        // sent again, it goes on from where it was rather than starting over
+        existing->animation = volume.animation;
+    } else {
+        volume.startedAt = usecTimestampNow();
+        _animations.insert(id, volume);
+    }
+    return codeBytes + NUM_BYTES_RFC4122_UUID + dataBytes;
+}
@@ -12,8 +12,13 @@
 #ifndef hifi_VoxelTree_h
 #define hifi_VoxelTree_h
 
+#include <QtCore/QHash>
+#include <QtCore/QUuid>
+#include <QtCore/QVector>
+
 #include <Octree.h>
 
+#include "VoxelAnimation.h"
 #include "VoxelTreeElement.h"
 #include "VoxelEditPacketSender.h"
 
@@ -51,12 +56,30 @@ public:
 
     void readCodeColorBufferToTree(const unsigned char* codeColorBuffer, bool destructive = false);
 
+    /// copies the subtree at the source octal code to the destination, rebased, keeping the voxels at the destination
+    /// that the copy doesn't cover, and deletes the source if it's a move. A source inside a larger voxel copies as a
+    /// voxel of its color. The caller should have the tree locked.
+    void copySubtree(const unsigned char* sourceOctalCode, const unsigned char* destinationOctalCode, bool move);
+
     virtual PacketType expectedDataPacketType() const { return PacketTypeVoxelData; }
     virtual bool handlesEditPacketType(PacketType packetType) const;
     virtual int processEditPacketData(PacketType packetType, const unsigned char* packetData, int packetLength,
                     const unsigned char* editData, int maxLength, const SharedNodePointer& node);
     virtual bool recurseChildrenWithData() const { return false; }
 
+    /// moves the animations the tree has been sent on to now, setting the voxels that changed and erasing those left
+    virtual void update();
+
+    // sets to the same voxel in a batch are coalesced, and the voxels above the set ones are reaveraged once at the end
+    virtual void beginEditBatch();
+    virtual void endEditBatch();
+
+    // voxels only hold their color, so reading one subtree doesn't touch another
+    virtual bool canReadBitstreamsConcurrently() const { return true; }
+
+    // and encode nothing that depends on the view but the level of detail
+    virtual bool canCacheEncodedSubtrees() const { return true; }
+
 private:
     // helper functions for nudgeSubTree
     void recurseNodeForNudge(VoxelTreeElement* element, RecurseOctreeOperation operation, void* extraData);
@@ -64,6 +87,30 @@ private:
     void nudgeLeaf(VoxelTreeElement* element, void* extraData);
     void chunkifyLeaf(VoxelTreeElement* element);
     void readCodeColorBufferToTreeRecursion(VoxelTreeElement* node, ReadCodeColorBufferToTreeArgs& args);
+
+    void batchCodeColorBuffer(const unsigned char* codeColorBuffer, int codeLength, int length, bool destructive);
+    void readBatchedCodeColorBuffers();
+
+    int processAnimateEditData(const unsigned char* editData, int maxLength);
+
+    class BatchedSet {
+    public:
+        QByteArray codeColorBuffer; /// empty once a later set to the same voxel has replaced it
+        bool destructive;
+    };
+
+    bool _isBatchingEdits;
+    QVector<BatchedSet> _batchedSets;
+    QHash<QByteArray, int> _batchedSetIndexes; /// the latest set in _batchedSets of each octal code
+
+    class AnimatedVolume {
+    public:
+        VoxelAnimation animation;
+        quint64 startedAt;
+        QHash<QByteArray, QByteArray> voxels; /// the code color buffers the animation last set, by their octal codes
+    };
+
+    QHash<QUuid, AnimatedVolume> _animations;
 };
 
 #endif // hifi_VoxelTree_h
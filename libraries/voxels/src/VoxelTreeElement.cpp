@@ -10,7 +10,9 @@
 //
 
 #include <NodeList.h>
+#include <OctreeColorPalette.h>
 #include <PerfStat.h>
+#include <SlabAllocator.h>
 
 #include "VoxelConstants.h"
 #include "VoxelTreeElement.h"
@@ -28,6 +30,25 @@ VoxelTreeElement::~VoxelTreeElement() {
     _voxelMemoryUsage -= sizeof(VoxelTreeElement);
 }
 
+static SlabAllocator& getElementAllocator() {
+    // never deleted, as elements can outlive the static destructors
+    static SlabAllocator* allocator = new SlabAllocator(sizeof(VoxelTreeElement));
+    return *allocator;
+}
+
+void* VoxelTreeElement::operator new(size_t size) {
+    // a subclass of a different size comes from the heap
+    return (size == sizeof(VoxelTreeElement)) ? getElementAllocator().allocate() : ::operator new(size);
+}
+
+void VoxelTreeElement::operator delete(void* element, size_t size) {
+    if (size == sizeof(VoxelTreeElement)) {
+        getElementAllocator().deallocate(element);
+    } else {
+        ::operator delete(element);
+    }
+}
+
 // This will be called primarily on addChildAt(), which means we're adding a child of our
 // own type to our own tree. This means we should initialize that child with any tree and type
 // specific settings that our children must have. One example is out VoxelSystem, which
@@ -44,6 +65,7 @@ void VoxelTreeElement::init(unsigned char* octalCode) {
     _falseColored = false; // assume true color
     _color[0] = _color[1] = _color[2] = _color[3] = 0;
     _density = 0.0f;
+    _culledLocation = NOT_CULLED;
     OctreeElement::init(octalCode);
     _voxelMemoryUsage += sizeof(VoxelTreeElement);
 }
@@ -66,6 +88,11 @@ void VoxelTreeElement::splitChildren() {
 }
 
 bool VoxelTreeElement::appendElementData(OctreePacketData* packetData, EncodeBitstreamParams& params) const {
+    if (params.colorPalette) {
+        unsigned char index[MAX_VARINT_BYTES];
+        int indexBytes = OctreeColorPalette::writeVarint(params.colorPalette->indexOf(getColor()), index);
+        return packetData->appendRawData(index, indexBytes);
+    }
     return packetData->appendColor(getColor());
 }
 
@@ -76,6 +103,17 @@ int VoxelTreeElement::readElementDataFromBuffer(const unsigned char* data, int b
 
     // pull the color for this child
     nodeColor newColor = { 128, 128, 128, 1};
+    if (args.colorPalette) {
+        quint32 index;
+        int bytesRead = OctreeColorPalette::readVarint(data, bytesLeftToRead, index);
+        if (bytesRead == 0 || !args.colorPalette->getColor(index, newColor)) {
+            // the rest of the buffer can't be trusted past a bad index
+            qDebug() << "VoxelTreeElement::readElementDataFromBuffer() color index out of the palette, skipping the rest";
+            return bytesLeftToRead;
+        }
+        setColor(newColor);
+        return bytesRead;
+    }
     if (args.includeColor) {
         memcpy(newColor, data, BYTES_PER_COLOR);
     }
@@ -38,6 +38,10 @@ class VoxelTreeElement : public OctreeElement {
     
 public:
     virtual ~VoxelTreeElement();
+
+    /// elements are carved out of slabs rather than allocated from the heap one at a time
+    static void* operator new(size_t size);
+    static void operator delete(void* element, size_t size);
     virtual void init(unsigned char * octalCode);
 
     virtual bool hasContent() const { return isColored(); }
@@ -73,6 +77,11 @@ public:
     unsigned char getExteriorOcclusions() const;
     unsigned char getInteriorOcclusions() const;
 
+    /// where the element was in the view frustum when the last hide/show pass reached it, client only
+    static const int NOT_CULLED = -1;
+    int getCulledLocation() const { return _culledLocation; }
+    void setCulledLocation(int culledLocation) { _culledLocation = culledLocation; }
+
     // type safe versions of OctreeElement methods
     VoxelTreeElement* getChildAtIndex(int childIndex) { return (VoxelTreeElement*)OctreeElement::getChildAtIndex(childIndex); }
     VoxelTreeElement* addChildAtIndex(int childIndex) { return (VoxelTreeElement*)OctreeElement::addChildAtIndex(childIndex); }
@@ -96,6 +105,7 @@ protected:
 private:
     unsigned char _exteriorOcclusions;          ///< Exterior shared partition boundaries that are completely occupied
     unsigned char _interiorOcclusions;          ///< Interior shared partition boundaries with siblings
+    signed char _culledLocation;                ///< ViewFrustum::location as of the last hide/show pass, or NOT_CULLED
 };
 
 inline void VoxelTreeElement::setExteriorOcclusions(unsigned char exteriorOcclusions) { 
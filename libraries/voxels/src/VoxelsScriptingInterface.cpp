@@ -122,6 +122,82 @@ void VoxelsScriptingInterface::eraseVoxel(float x, float y, float z, float scale
     }
 }
 
+const int FLOATS_PER_SET_VOXEL = 7;
+
+void VoxelsScriptingInterface::setVoxels(const QVector<float>& voxels) {
+    QVector<VoxelDetail> addVoxelDetails(voxels.size() / FLOATS_PER_SET_VOXEL);
+    const float* voxel = voxels.constData();
+    for (int i = 0; i < addVoxelDetails.size(); i++, voxel += FLOATS_PER_SET_VOXEL) {
+        VoxelDetail addVoxelDetail = { voxel[0] / (float)TREE_SCALE, voxel[1] / (float)TREE_SCALE,
+            voxel[2] / (float)TREE_SCALE, voxel[3] / (float)TREE_SCALE, (uchar)voxel[4], (uchar)voxel[5], (uchar)voxel[6] };
+        addVoxelDetails[i] = addVoxelDetail;
+    }
+    
+    // handle the local tree also...
+    if (_tree) {
+        if (_undoStack) {
+            // the voxels are undone together
+            _undoStack->beginMacro("Set Voxels");
+            foreach (const VoxelDetail& addVoxelDetail, addVoxelDetails) {
+                // As QUndoStack automatically executes redo() on push, we don't need to execute the command ourselves.
+                _undoStack->push(new DeleteVoxelCommand(_tree, addVoxelDetail, getVoxelPacketSender()));
+                _undoStack->push(new AddVoxelCommand(_tree, addVoxelDetail, getVoxelPacketSender()));
+            }
+            _undoStack->endMacro();
+        } else {
+            // queue the destructive adds together
+            getVoxelPacketSender()->queueVoxelEditMessages(PacketTypeVoxelSetDestructive, addVoxelDetails.size(),
+                addVoxelDetails.data());
+            foreach (const VoxelDetail& addVoxelDetail, addVoxelDetails) {
+                _tree->createVoxel(addVoxelDetail.x, addVoxelDetail.y, addVoxelDetail.z, addVoxelDetail.s,
+                    addVoxelDetail.red, addVoxelDetail.green, addVoxelDetail.blue, true);
+            }
+        }
+    }
+}
+
+const int FLOATS_PER_ERASE_VOXEL = 4;
+
+void VoxelsScriptingInterface::eraseVoxels(const QVector<float>& voxels) {
+    QVector<VoxelDetail> deleteVoxelDetails(voxels.size() / FLOATS_PER_ERASE_VOXEL);
+    const float* voxel = voxels.constData();
+    for (int i = 0; i < deleteVoxelDetails.size(); i++, voxel += FLOATS_PER_ERASE_VOXEL) {
+        VoxelDetail deleteVoxelDetail = { voxel[0] / (float)TREE_SCALE, voxel[1] / (float)TREE_SCALE,
+            voxel[2] / (float)TREE_SCALE, voxel[3] / (float)TREE_SCALE };
+        deleteVoxelDetails[i] = deleteVoxelDetail;
+    }
+    
+    // handle the local tree also...
+    if (_tree) {
+        // the colors of the voxels are kept so that the deletions can be undone
+        for (int i = 0; i < deleteVoxelDetails.size(); i++) {
+            VoxelDetail& deleteVoxelDetail = deleteVoxelDetails[i];
+            VoxelTreeElement* deleteVoxelElement = _tree->getVoxelAt(deleteVoxelDetail.x, deleteVoxelDetail.y,
+                deleteVoxelDetail.z, deleteVoxelDetail.s);
+            if (deleteVoxelElement) {
+                deleteVoxelDetail.red = deleteVoxelElement->getColor()[0];
+                deleteVoxelDetail.green = deleteVoxelElement->getColor()[1];
+                deleteVoxelDetail.blue = deleteVoxelElement->getColor()[2];
+            }
+        }
+        
+        if (_undoStack) {
+            _undoStack->beginMacro("Erase Voxels");
+            foreach (const VoxelDetail& deleteVoxelDetail, deleteVoxelDetails) {
+                // As QUndoStack automatically executes redo() on push, we don't need to execute the command ourselves.
+                _undoStack->push(new DeleteVoxelCommand(_tree, deleteVoxelDetail, getVoxelPacketSender()));
+            }
+            _undoStack->endMacro();
+        } else {
+            getVoxelPacketSender()->queueVoxelEditMessages(PacketTypeVoxelErase, deleteVoxelDetails.size(),
+                deleteVoxelDetails.data());
+            foreach (const VoxelDetail& deleteVoxelDetail, deleteVoxelDetails) {
+                _tree->deleteVoxelAt(deleteVoxelDetail.x, deleteVoxelDetail.y, deleteVoxelDetail.z, deleteVoxelDetail.s);
+            }
+        }
+    }
+}
+
 RayToVoxelIntersectionResult VoxelsScriptingInterface::findRayIntersection(const PickRay& ray) {
     return findRayIntersectionWorker(ray, Octree::TryLock);
 }
@@ -73,6 +73,14 @@ public:
     /// \param scale the scale of the voxel (in meter units)
     Q_INVOKABLE void eraseVoxel(float x, float y, float z, float scale);
 
+    /// queues the destructive creation of many voxels at once, which is much cheaper than calling setVoxel for each
+    /// \param voxels the x, y, z and scale (in meter units) and the red, green and blue of each voxel, one after another
+    Q_INVOKABLE void setVoxels(const QVector<float>& voxels);
+
+    /// queues the deletion of many voxels at once
+    /// \param voxels the x, y, z and scale (in meter units) of each voxel, one after another
+    Q_INVOKABLE void eraseVoxels(const QVector<float>& voxels);
+
     /// If the scripting context has visible voxels, this will determine a ray intersection, the results
     /// may be inaccurate if the engine is unable to access the visible voxels, in which case result.accurate
     /// will be false.
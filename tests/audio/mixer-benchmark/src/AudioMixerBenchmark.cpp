@@ -0,0 +1,280 @@
+//
+//  AudioMixerBenchmark.cpp
+//  tests/audio/mixer-benchmark/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#include <math.h>
+#include <new>
+#include <stdlib.h>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include <QtCore/QAtomicInt>
+#include <QtCore/QDataStream>
+#include <QtCore/QDebug>
+#include <QtCore/QElapsedTimer>
+#include <QtNetwork/QHostAddress>
+
+#include <AudioCodec.h>
+#include <Node.h>
+#include <PacketHeaders.h>
+#include <SharedUtil.h>
+
+#include "AudioMixerClientData.h"
+
+#include "AudioMixerBenchmark.h"
+
+static QAtomicInt allocationCount;
+static volatile bool isCountingAllocations = false;
+
+static void countAllocation() {
+    if (isCountingAllocations) {
+        allocationCount.fetchAndAddRelaxed(1);
+    }
+}
+
+#ifdef __GLIBC__
+
+// Qt's containers allocate with malloc rather than new, so on glibc every allocation is counted where it is made
+extern "C" {
+    void* __libc_malloc(size_t size);
+    void* __libc_calloc(size_t numElements, size_t elementSize);
+    void* __libc_realloc(void* pointer, size_t size);
+
+    void* malloc(size_t size) {
+        countAllocation();
+        return __libc_malloc(size);
+    }
+
+    void* calloc(size_t numElements, size_t elementSize) {
+        countAllocation();
+        return __libc_calloc(numElements, elementSize);
+    }
+
+    void* realloc(void* pointer, size_t size) {
+        countAllocation();
+        return __libc_realloc(pointer, size);
+    }
+}
+
+#else
+
+// elsewhere only what is allocated with new is counted
+void* operator new(size_t size) {
+    countAllocation();
+    void* pointer = malloc(size);
+    if (!pointer) {
+        throw std::bad_alloc();
+    }
+    return pointer;
+}
+
+void operator delete(void* pointer) throw() {
+    free(pointer);
+}
+
+#endif // __GLIBC__
+
+const float AVATAR_SPACING = 3.0f;
+const float AVATAR_WALK_RADIUS = 0.5f;
+const float AVATAR_WALK_RADIANS_PER_FRAME = 0.05f;
+const float AVATAR_WALK_PHASE_STEP = 0.7f;
+const float AVATAR_TURN_RATIO = 2.0f;
+const float INJECTOR_RING_MARGIN = 5.0f;
+
+const float TONE_AMPLITUDE = 3000.0f;
+const float TONE_BASE_FREQUENCY = 200.0f;
+const float TONE_FREQUENCY_STEP = 37.0f;
+
+// enough frames in every jitter buffer before the first mix that none of them starves while the scene runs
+const int NUM_WARM_UP_FRAMES = 3;
+
+static QUuid uuidForIndex(uint index) {
+    // the scene has to come out the same every run, so nothing in it can be random
+    return QUuid(index, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1);
+}
+
+static SharedNodePointer createAgentNode(uint index, bool isListener) {
+    HifiSockAddr socket(QHostAddress::LocalHost, index);
+    SharedNodePointer node(new Node(uuidForIndex(index), NodeType::Agent, socket, socket));
+    node->setLinkedData(new AudioMixerClientData());
+
+    if (isListener) {
+        // only nodes with an active socket are sent a mix
+        node->activatePublicSocket();
+    }
+    return node;
+}
+
+static int sideOfAvatarSquare(int numAvatars) {
+    return (int) ceilf(sqrtf((float) numAvatars));
+}
+
+AudioMixerBenchmark::AudioMixerBenchmark(int numAvatars, int numInjectors, const QJsonObject& settingsObject) :
+    _mixer(NULL),
+    _nodeHash(),
+    _avatarNodes(),
+    _injectorNodes(),
+    _injectorStreamIdentifiers()
+{
+    Assignment assignment(Assignment::CreateCommand, Assignment::AudioMixerType);
+    QByteArray assignmentPacket = byteArrayWithPopulatedHeader(PacketTypeCreateAssignment, uuidForIndex(0));
+    QDataStream assignmentStream(&assignmentPacket, QIODevice::Append);
+    assignmentStream << assignment;
+
+    _mixer = new AudioMixer(assignmentPacket);
+    _mixer->parseSettingsObject(settingsObject);
+
+    uint nextIndex = 1;
+    for (int i = 0; i < numAvatars; i++) {
+        SharedNodePointer node = createAgentNode(nextIndex++, true);
+        _avatarNodes.append(node);
+        _nodeHash.insert(node->getUUID(), node);
+    }
+
+    // every injector comes from a node of its own, the way scripted agents send them
+    for (int i = 0; i < numInjectors; i++) {
+        SharedNodePointer node = createAgentNode(nextIndex++, false);
+        _injectorNodes.append(node);
+        _injectorStreamIdentifiers.append(uuidForIndex(nextIndex++));
+        _nodeHash.insert(node->getUUID(), node);
+    }
+}
+
+AudioMixerBenchmark::~AudioMixerBenchmark() {
+    _nodeHash.clear();
+    _avatarNodes.clear();
+    _injectorNodes.clear();
+    delete _mixer;
+}
+
+void AudioMixerBenchmark::writeTone(int sourceIndex, int frame, int16_t* samples) const {
+    float radiansPerSample = TWO_PI * (TONE_BASE_FREQUENCY + (sourceIndex * TONE_FREQUENCY_STEP)) / SAMPLE_RATE;
+    int firstSample = frame * NETWORK_BUFFER_LENGTH_SAMPLES_PER_CHANNEL;
+
+    for (int i = 0; i < NETWORK_BUFFER_LENGTH_SAMPLES_PER_CHANNEL; i++) {
+        samples[i] = (int16_t) (TONE_AMPLITUDE * sinf(fmodf((firstSample + i) * radiansPerSample, TWO_PI)));
+    }
+}
+
+void AudioMixerBenchmark::parseSourcePackets(int frame) {
+    int16_t samples[NETWORK_BUFFER_LENGTH_SAMPLES_PER_CHANNEL];
+    quint16 sequence = frame;
+    int side = sideOfAvatarSquare(_avatarNodes.size());
+
+    for (int i = 0; i < _avatarNodes.size(); i++) {
+        // each avatar walks a circle around its own spot on the square, turning twice as fast as it walks
+        float walkAngle = (i * AVATAR_WALK_PHASE_STEP) + (frame * AVATAR_WALK_RADIANS_PER_FRAME);
+        glm::vec3 position((i % side) * AVATAR_SPACING + (AVATAR_WALK_RADIUS * cosf(walkAngle)), 0.0f,
+                           (i / side) * AVATAR_SPACING + (AVATAR_WALK_RADIUS * sinf(walkAngle)));
+        glm::quat orientation(glm::vec3(0.0f, walkAngle * AVATAR_TURN_RATIO, 0.0f));
+
+        QByteArray packet = byteArrayWithPopulatedHeader(PacketTypeMicrophoneAudioNoEcho,
+                                                         _avatarNodes[i]->getUUID());
+        quint8 channelFlag = 0;
+        quint8 codec = AudioCodec::PCM;
+        packet.append(reinterpret_cast<const char*>(&sequence), sizeof(quint16));
+        packet.append(reinterpret_cast<const char*>(&channelFlag), sizeof(quint8));
+        packet.append(reinterpret_cast<const char*>(&position), sizeof(position));
+        packet.append(reinterpret_cast<const char*>(&orientation), sizeof(orientation));
+        packet.append(reinterpret_cast<const char*>(&codec), sizeof(quint8));
+
+        writeTone(i, frame, samples);
+        packet.append(reinterpret_cast<const char*>(samples), sizeof(samples));
+
+        _avatarNodes[i]->getLinkedData()->parseData(packet);
+    }
+
+    // the injectors stand on a ring around the avatars
+    glm::vec3 sceneCenter(side * AVATAR_SPACING / 2.0f, 0.0f, side * AVATAR_SPACING / 2.0f);
+    float ringRadius = (side * AVATAR_SPACING / 2.0f) + INJECTOR_RING_MARGIN;
+
+    for (int i = 0; i < _injectorNodes.size(); i++) {
+        float ringAngle = TWO_PI * i / _injectorNodes.size();
+        glm::vec3 position = sceneCenter + glm::vec3(ringRadius * cosf(ringAngle), 0.0f, ringRadius * sinf(ringAngle));
+        glm::quat orientation;
+
+        // same layout as the packets of an AudioInjector
+        QByteArray packet = byteArrayWithPopulatedHeader(PacketTypeInjectAudio, _injectorNodes[i]->getUUID());
+        QDataStream packetStream(&packet, QIODevice::Append);
+
+        packetStream.writeRawData(reinterpret_cast<const char*>(&sequence), sizeof(quint16));
+        packetStream << _injectorStreamIdentifiers[i];
+        packetStream << (uchar) 0;
+        packetStream.writeRawData(reinterpret_cast<const char*>(&position), sizeof(position));
+        packetStream.writeRawData(reinterpret_cast<const char*>(&orientation), sizeof(orientation));
+        packetStream << 0.0f;
+        packetStream << (quint8) 255;
+
+        writeTone(_avatarNodes.size() + i, frame, samples);
+        packetStream.writeRawData(reinterpret_cast<const char*>(samples), sizeof(samples));
+
+        _injectorNodes[i]->getLinkedData()->parseData(packet);
+    }
+}
+
+void AudioMixerBenchmark::run(int numFrames) {
+    for (int f = 0; f < NUM_WARM_UP_FRAMES; f++) {
+        parseSourcePackets(f);
+    }
+
+    qint64 mixNsecs = 0;
+    int numListenerMixes = 0;
+    int numAllocations = 0;
+    quint32 checksum = 0;
+    QElapsedTimer timer;
+
+    for (int f = 0; f < numFrames; f++) {
+        parseSourcePackets(NUM_WARM_UP_FRAMES + f);
+
+        foreach (const SharedNodePointer& node, _nodeHash) {
+            ((AudioMixerClientData*) node->getLinkedData())->checkBuffersBeforeFrameSend();
+        }
+
+        // only the mix itself is timed and has its allocations counted
+        allocationCount.store(0);
+        isCountingAllocations = true;
+        timer.start();
+
+        QList<SharedNodePointer> listeners = _mixer->mixFrame(_nodeHash);
+
+        mixNsecs += timer.nsecsElapsed();
+        isCountingAllocations = false;
+        numAllocations += allocationCount.load();
+
+        for (int i = 0; i < listeners.size(); i++) {
+            if (_mixer->isListenerMixSilent(i)) {
+                continue;
+            }
+
+            // the listeners come in node hash order, so sum the checksums of the mixes to not depend on it
+            quint32 mixChecksum = 2166136261u;
+            const int16_t* mix = _mixer->getListenerMix(i);
+            for (int s = 0; s < NETWORK_BUFFER_LENGTH_SAMPLES_STEREO; s++) {
+                mixChecksum = (mixChecksum ^ (quint16) mix[s]) * 16777619u;
+            }
+            checksum += mixChecksum;
+        }
+        numListenerMixes += listeners.size();
+
+        foreach (const SharedNodePointer& node, _nodeHash) {
+            ((AudioMixerClientData*) node->getLinkedData())->pushBuffersAfterFrameSend();
+        }
+    }
+
+    // every listener could hear every source other than itself
+    qint64 numPairs = (qint64) numListenerMixes * (_avatarNodes.size() - 1 + _injectorNodes.size());
+    double mixSeconds = mixNsecs / 1e9;
+
+    qDebug("%d avatars, %d injectors, %d frames: %.0f listeners/s, %.1f ns per source-listener pair, "
+           "%.1f allocations per frame, checksum %08x", _avatarNodes.size(), _injectorNodes.size(), numFrames,
+           mixSeconds > 0.0 ? numListenerMixes / mixSeconds : 0.0,
+           numPairs > 0 ? (double) mixNsecs / numPairs : 0.0,
+           numFrames > 0 ? (double) numAllocations / numFrames : 0.0, checksum);
+}
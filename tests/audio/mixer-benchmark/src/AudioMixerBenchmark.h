@@ -0,0 +1,47 @@
+//
+//  AudioMixerBenchmark.h
+//  tests/audio/mixer-benchmark/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#ifndef hifi_AudioMixerBenchmark_h
+#define hifi_AudioMixerBenchmark_h
+
+#include <QtCore/QJsonObject>
+#include <QtCore/QList>
+#include <QtCore/QUuid>
+
+#include <LimitedNodeList.h>
+
+#include "AudioMixer.h"
+
+/// A scripted scene of avatars and injectors that is mixed frame by frame without any networking. The avatars walk
+/// in small circles while they turn and the injectors stand still, every source plays its own tone, so that the
+/// same options always produce the same frames and the same mixes.
+class AudioMixerBenchmark {
+public:
+    AudioMixerBenchmark(int numAvatars, int numInjectors, const QJsonObject& settingsObject);
+    ~AudioMixerBenchmark();
+
+    /// mixes numFrames frames and prints listeners per second, nanoseconds per source-listener pair,
+    /// heap allocations per frame and a checksum of the mixes
+    void run(int numFrames);
+
+private:
+    /// hands every source its packet for this frame, the same way the mixer would after reading them
+    void parseSourcePackets(int frame);
+
+    void writeTone(int sourceIndex, int frame, int16_t* samples) const;
+
+    AudioMixer* _mixer;
+    NodeHash _nodeHash;
+    QList<SharedNodePointer> _avatarNodes;
+    QList<SharedNodePointer> _injectorNodes;
+    QList<QUuid> _injectorStreamIdentifiers;
+};
+
+#endif // hifi_AudioMixerBenchmark_h
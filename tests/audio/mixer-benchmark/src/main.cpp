@@ -0,0 +1,57 @@
+//
+//  main.cpp
+//  tests/audio/mixer-benchmark/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <QtCore/QJsonObject>
+
+#include "AudioMixerBenchmark.h"
+
+const int DEFAULT_NUM_FRAMES = 500;
+
+// avatars and injectors in each of the default scenes
+const int DEFAULT_SCENES[][2] = { { 10, 0 }, { 50, 10 }, { 100, 20 }, { 200, 50 } };
+const int NUM_DEFAULT_SCENES = sizeof(DEFAULT_SCENES) / sizeof(DEFAULT_SCENES[0]);
+
+int main(int argc, char** argv) {
+    if (argc > 1 && (argc < 3 || atoi(argv[1]) <= 0)) {
+        printf("usage: %s [avatars injectors [frames [mix-threads [zone-submix-distance]]]]\n", argv[0]);
+        return 1;
+    }
+
+    // the hashes of the mixer have to iterate the same way every run for the checksums to repeat
+    qputenv("QT_HASH_SEED", "0");
+
+    int numFrames = argc > 3 ? atoi(argv[3]) : DEFAULT_NUM_FRAMES;
+
+    // the same audio group settings the domain-server would hand the mixer
+    QJsonObject audioGroupObject;
+    if (argc > 4) {
+        audioGroupObject["mix-threads"] = argv[4];
+    }
+    if (argc > 5) {
+        audioGroupObject["zone-submix-distance"] = argv[5];
+    }
+    QJsonObject settingsObject;
+    settingsObject["audio"] = audioGroupObject;
+
+    if (argc > 2) {
+        AudioMixerBenchmark benchmark(atoi(argv[1]), atoi(argv[2]), settingsObject);
+        benchmark.run(numFrames);
+    } else {
+        for (int i = 0; i < NUM_DEFAULT_SCENES; i++) {
+            AudioMixerBenchmark benchmark(DEFAULT_SCENES[i][0], DEFAULT_SCENES[i][1], settingsObject);
+            benchmark.run(numFrames);
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,201 @@
+//
+//  AudioMixKernelsTests.cpp
+//  tests/audio/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#if defined(__MMX__) || defined(_M_IX86)
+#define HAVE_MMX_REFERENCE
+#include <mmintrin.h>
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <QtCore/QDebug>
+#include <QtCore/QVector>
+
+#include "AudioHRTF.h"
+#include "AudioRingBuffer.h"
+#include "SharedUtil.h"
+
+#include "AudioMixKernelsTests.h"
+
+const AudioMixKernels::Implementation ALL_IMPLEMENTATIONS[] = {
+    AudioMixKernels::Scalar, AudioMixKernels::SSE2, AudioMixKernels::AVX2, AudioMixKernels::NEON
+};
+const int NUM_IMPLEMENTATIONS = sizeof(ALL_IMPLEMENTATIONS) / sizeof(AudioMixKernels::Implementation);
+
+static void fillRandomSamples(int16_t* samples, int numSamples) {
+    for (int i = 0; i < numSamples; i++) {
+        samples[i] = (rand() % (MAX_SAMPLE_VALUE - MIN_SAMPLE_VALUE)) + MIN_SAMPLE_VALUE;
+    }
+}
+
+void AudioMixKernelsTests::runAllTests() {
+    kernelsMatchScalarTest();
+    mixBenchmark();
+}
+
+void AudioMixKernelsTests::kernelsMatchScalarTest() {
+    AudioMixKernels::Implementation bestImplementation = AudioMixKernels::getImplementation();
+
+    // odd lengths make every kernel run its scalar tail as well
+    const int NUM_TEST_FRAMES = NETWORK_BUFFER_LENGTH_SAMPLES_PER_CHANNEL - 3;
+    const int NUM_TEST_SAMPLES = NETWORK_BUFFER_LENGTH_SAMPLES_STEREO - 5;
+    const float LEFT_GAIN = 0.73f;
+    const float RIGHT_GAIN = 1.7f;
+    const int NUM_MIXED_SOURCES = 4;
+
+    int16_t left[NUM_TEST_FRAMES], right[NUM_TEST_FRAMES], stereo[NETWORK_BUFFER_LENGTH_SAMPLES_STEREO];
+    fillRandomSamples(left, NUM_TEST_FRAMES);
+    fillRandomSamples(right, NUM_TEST_FRAMES);
+    fillRandomSamples(stereo, NETWORK_BUFFER_LENGTH_SAMPLES_STEREO);
+
+    // a convolved source needs the samples its filters reach back to in front of it
+    int16_t convolvedSource[MAX_CONVOLUTION_TAPS + NUM_TEST_FRAMES];
+    fillRandomSamples(convolvedSource, MAX_CONVOLUTION_TAPS + NUM_TEST_FRAMES);
+    float leftFilter[HRTF_NUM_TAPS], rightFilter[HRTF_NUM_TAPS];
+    AudioHRTF::getFilters(LEFT_GAIN, RIGHT_GAIN, leftFilter, rightFilter);
+
+    int16_t expectedMix[NETWORK_BUFFER_LENGTH_SAMPLES_STEREO];
+
+    for (int i = 0; i < NUM_IMPLEMENTATIONS; i++) {
+        if (!AudioMixKernels::setImplementation(ALL_IMPLEMENTATIONS[i])) {
+            continue;
+        }
+        const char* name = AudioMixKernels::getImplementationName(ALL_IMPLEMENTATIONS[i]);
+
+        // enough loud sources that the sum has to saturate at the end
+        float mix[NETWORK_BUFFER_LENGTH_SAMPLES_STEREO];
+        memset(mix, 0, sizeof(mix));
+        for (int j = 0; j < NUM_MIXED_SOURCES; j++) {
+            AudioMixKernels::addMonoToStereo(mix, left, LEFT_GAIN, right, RIGHT_GAIN, NUM_TEST_FRAMES);
+            AudioMixKernels::addInterleaved(mix, stereo, -LEFT_GAIN, NUM_TEST_SAMPLES);
+            AudioMixKernels::addConvolvedMonoToStereo(mix, convolvedSource + MAX_CONVOLUTION_TAPS, leftFilter,
+                                                      rightFilter, HRTF_NUM_TAPS, NUM_TEST_FRAMES);
+        }
+
+        int16_t saturatedMix[NETWORK_BUFFER_LENGTH_SAMPLES_STEREO];
+        AudioMixKernels::saturateMix(saturatedMix, mix, NETWORK_BUFFER_LENGTH_SAMPLES_STEREO);
+
+        if (ALL_IMPLEMENTATIONS[i] == AudioMixKernels::Scalar) {
+            memcpy(expectedMix, saturatedMix, sizeof(saturatedMix));
+            continue;
+        }
+
+        for (int s = 0; s < NETWORK_BUFFER_LENGTH_SAMPLES_STEREO; s++) {
+            // a fused multiply-add in the compiled scalar code is allowed to move a sample by one step
+            if (abs(saturatedMix[s] - expectedMix[s]) > 1) {
+                qDebug("%s mix differs from scalar at %d! Expected: %d  Actual: %d",
+                       name, s, expectedMix[s], saturatedMix[s]);
+                break;
+            }
+        }
+    }
+
+    AudioMixKernels::setImplementation(bestImplementation);
+    qDebug() << "passed AudioMixKernelsTests::kernelsMatchScalarTest()";
+}
+
+#ifdef HAVE_MMX_REFERENCE
+
+// the main loop of the mono spatialization in AudioMixer before the mix kernels, kept as the baseline
+static void addMonoToStereoMMX(int16_t* clientSamples, const int16_t* nextOutputStart, float attenuationCoefficient,
+                               float weakChannelAmplitudeRatio, int numSamplesDelay) {
+    const int SINGLE_STEREO_OFFSET = 2;
+    const int delayedChannelOffset = 1;
+    const int goodChannelOffset = 0;
+    int16_t correctBufferSample[2], delayBufferSample[2];
+
+    for (int s = 0; s < NETWORK_BUFFER_LENGTH_SAMPLES_STEREO; s += 4) {
+        correctBufferSample[0] = nextOutputStart[s / 2] * attenuationCoefficient;
+        correctBufferSample[1] = nextOutputStart[(s / 2) + 1] * attenuationCoefficient;
+
+        int delayedChannelIndex = s + (numSamplesDelay * 2) + delayedChannelOffset;
+
+        delayBufferSample[0] = correctBufferSample[0] * weakChannelAmplitudeRatio;
+        delayBufferSample[1] = correctBufferSample[1] * weakChannelAmplitudeRatio;
+
+        __m64 bufferSamples = _mm_set_pi16(clientSamples[s + goodChannelOffset],
+                                           clientSamples[s + goodChannelOffset + SINGLE_STEREO_OFFSET],
+                                           clientSamples[delayedChannelIndex],
+                                           clientSamples[delayedChannelIndex + SINGLE_STEREO_OFFSET]);
+        __m64 addedSamples = _mm_set_pi16(correctBufferSample[0], correctBufferSample[1],
+                                          delayBufferSample[0], delayBufferSample[1]);
+
+        __m64 mmxResult = _mm_adds_pi16(bufferSamples, addedSamples);
+        int16_t* shortResults = reinterpret_cast<int16_t*>(&mmxResult);
+
+        clientSamples[s + goodChannelOffset] = shortResults[3];
+        clientSamples[s + goodChannelOffset + SINGLE_STEREO_OFFSET] = shortResults[2];
+        clientSamples[delayedChannelIndex] = shortResults[1];
+        clientSamples[delayedChannelIndex + SINGLE_STEREO_OFFSET] = shortResults[0];
+    }
+    _mm_empty();
+}
+
+#endif // HAVE_MMX_REFERENCE
+
+void AudioMixKernelsTests::mixBenchmark() {
+    const int NUM_BENCHMARK_SOURCES = 100;
+    const int NUM_BENCHMARK_FRAMES = 200;
+    const int BENCHMARK_SAMPLES_DELAY = 13;
+    const float ATTENUATION = 0.6f;
+    const float WEAK_CHANNEL_RATIO = 0.7f;
+
+    // the MMX baseline writes the delayed channel past the end of the frame, so leave it room
+    int16_t clientSamples[NETWORK_BUFFER_LENGTH_SAMPLES_STEREO + (BENCHMARK_SAMPLES_DELAY * 2) + 4];
+    float mix[NETWORK_BUFFER_LENGTH_SAMPLES_STEREO];
+    QVector<int16_t> sources(NUM_BENCHMARK_SOURCES * (NETWORK_BUFFER_LENGTH_SAMPLES_PER_CHANNEL + BENCHMARK_SAMPLES_DELAY));
+    fillRandomSamples(sources.data(), sources.size());
+    int sourceStride = NETWORK_BUFFER_LENGTH_SAMPLES_PER_CHANNEL + BENCHMARK_SAMPLES_DELAY;
+
+#ifdef HAVE_MMX_REFERENCE
+    quint64 start = usecTimestampNow();
+    for (int f = 0; f < NUM_BENCHMARK_FRAMES; f++) {
+        memset(clientSamples, 0, sizeof(clientSamples));
+        for (int i = 0; i < NUM_BENCHMARK_SOURCES; i++) {
+            addMonoToStereoMMX(clientSamples, sources.constData() + (i * sourceStride) + BENCHMARK_SAMPLES_DELAY,
+                               ATTENUATION, WEAK_CHANNEL_RATIO, BENCHMARK_SAMPLES_DELAY);
+        }
+    }
+    qDebug("mmx baseline: %llu usecs for %d sources x %d frames", usecTimestampNow() - start,
+           NUM_BENCHMARK_SOURCES, NUM_BENCHMARK_FRAMES);
+#endif
+
+    AudioMixKernels::Implementation bestImplementation = AudioMixKernels::getImplementation();
+
+    for (int k = 0; k < NUM_IMPLEMENTATIONS; k++) {
+        if (!AudioMixKernels::setImplementation(ALL_IMPLEMENTATIONS[k])) {
+            continue;
+        }
+
+        quint64 start = usecTimestampNow();
+        for (int f = 0; f < NUM_BENCHMARK_FRAMES; f++) {
+            memset(mix, 0, sizeof(mix));
+            for (int i = 0; i < NUM_BENCHMARK_SOURCES; i++) {
+                const int16_t* source = sources.constData() + (i * sourceStride) + BENCHMARK_SAMPLES_DELAY;
+
+                // same split the mixer uses: the delayed head from the previous samples, then the rest of the frame
+                AudioMixKernels::addMonoToStereo(mix, source, ATTENUATION,
+                                                 source - BENCHMARK_SAMPLES_DELAY, ATTENUATION * WEAK_CHANNEL_RATIO,
+                                                 BENCHMARK_SAMPLES_DELAY);
+                AudioMixKernels::addMonoToStereo(mix + (BENCHMARK_SAMPLES_DELAY * 2),
+                                                 source + BENCHMARK_SAMPLES_DELAY, ATTENUATION,
+                                                 source, ATTENUATION * WEAK_CHANNEL_RATIO,
+                                                 NETWORK_BUFFER_LENGTH_SAMPLES_PER_CHANNEL - BENCHMARK_SAMPLES_DELAY);
+            }
+            AudioMixKernels::saturateMix(clientSamples, mix, NETWORK_BUFFER_LENGTH_SAMPLES_STEREO);
+        }
+        qDebug("%s kernels: %llu usecs for %d sources x %d frames",
+               AudioMixKernels::getImplementationName(ALL_IMPLEMENTATIONS[k]), usecTimestampNow() - start,
+               NUM_BENCHMARK_SOURCES, NUM_BENCHMARK_FRAMES);
+    }
+
+    AudioMixKernels::setImplementation(bestImplementation);
+}
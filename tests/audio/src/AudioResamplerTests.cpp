@@ -0,0 +1,148 @@
+//
+//  AudioResamplerTests.cpp
+//  tests/audio/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#include <math.h>
+
+#include <QtCore/QDebug>
+#include <QtCore/QVector>
+
+#include "SharedUtil.h"
+
+#include "AudioResamplerTests.h"
+
+const int NETWORK_SAMPLE_RATE = 24000;
+const float TONE_AMPLITUDE = 10000.0f;
+
+static void fillTone(QVector<int16_t>& samples, int numFrames, int numChannels, float frequency, int sampleRate) {
+    samples.resize(numFrames * numChannels);
+    for (int i = 0; i < numFrames; i++) {
+        for (int j = 0; j < numChannels; j++) {
+            samples[(i * numChannels) + j] = TONE_AMPLITUDE * sinf(TWO_PI * frequency * i / sampleRate);
+        }
+    }
+}
+
+// the amplitude of the frequency in the first channel, past the start where the filter is still filling up
+static float measureAmplitude(const int16_t* samples, int numFrames, int numChannels, float frequency,
+                              int sampleRate) {
+    const int SETTLING_FRAMES = 1000;
+    double sine = 0.0;
+    double cosine = 0.0;
+    for (int i = SETTLING_FRAMES; i < numFrames; i++) {
+        double phase = TWO_PI * frequency * i / sampleRate;
+        sine += samples[i * numChannels] * sin(phase);
+        cosine += samples[i * numChannels] * cos(phase);
+    }
+    return 2.0 * sqrt((sine * sine) + (cosine * cosine)) / (numFrames - SETTLING_FRAMES);
+}
+
+bool AudioResamplerTests::passbandTest() {
+    const int DEVICE_SAMPLE_RATES[] = { 48000, 44100, 24000, 22050, 96000 };
+    const int NUM_DEVICE_SAMPLE_RATES = sizeof(DEVICE_SAMPLE_RATES) / sizeof(int);
+    const float TONE_FREQUENCY = 1000.0f;
+    const float MAX_AMPLITUDE_ERROR = TONE_AMPLITUDE * 0.01f;
+
+    for (int i = 0; i < NUM_DEVICE_SAMPLE_RATES; i++) {
+        for (int sourceChannels = 1; sourceChannels <= 2; sourceChannels++) {
+            for (int destinationChannels = 1; destinationChannels <= 2; destinationChannels++) {
+                int sampleRate = DEVICE_SAMPLE_RATES[i];
+                AudioResampler resampler(sampleRate, sourceChannels, NETWORK_SAMPLE_RATE, destinationChannels);
+
+                // a second of input
+                QVector<int16_t> source;
+                fillTone(source, sampleRate, sourceChannels, TONE_FREQUENCY, sampleRate);
+                QVector<int16_t> destination(resampler.getMaxDestinationFrames(sampleRate) * destinationChannels);
+                int numFrames = resampler.resample(source.constData(), sampleRate, destination.data());
+
+                if (numFrames != NETWORK_SAMPLE_RATE) {
+                    qDebug("%d to %d: expected %d frames, got %d", sampleRate, NETWORK_SAMPLE_RATE,
+                           NETWORK_SAMPLE_RATE, numFrames);
+                    return false;
+                }
+                float amplitude = measureAmplitude(destination.constData(), numFrames, destinationChannels,
+                                                   TONE_FREQUENCY, NETWORK_SAMPLE_RATE);
+                if (fabsf(amplitude - TONE_AMPLITUDE) > MAX_AMPLITUDE_ERROR) {
+                    qDebug("%d to %d: expected an amplitude of %f, got %f", sampleRate, NETWORK_SAMPLE_RATE,
+                           TONE_AMPLITUDE, amplitude);
+                    return false;
+                }
+            }
+        }
+    }
+    return true;
+}
+
+bool AudioResamplerTests::stopbandTest() {
+    const int DEVICE_SAMPLE_RATE = 48000;
+    const float TONE_FREQUENCY = 16000.0f;
+    const float ALIASED_FREQUENCY = NETWORK_SAMPLE_RATE - TONE_FREQUENCY;
+    const float MAX_ALIASED_AMPLITUDE = TONE_AMPLITUDE * 0.01f;
+
+    AudioResampler resampler(DEVICE_SAMPLE_RATE, 1, NETWORK_SAMPLE_RATE, 1);
+    QVector<int16_t> source;
+    fillTone(source, DEVICE_SAMPLE_RATE, 1, TONE_FREQUENCY, DEVICE_SAMPLE_RATE);
+    QVector<int16_t> destination(resampler.getMaxDestinationFrames(DEVICE_SAMPLE_RATE));
+    int numFrames = resampler.resample(source.constData(), DEVICE_SAMPLE_RATE, destination.data());
+
+    float amplitude = measureAmplitude(destination.constData(), numFrames, 1, ALIASED_FREQUENCY, NETWORK_SAMPLE_RATE);
+    if (amplitude > MAX_ALIASED_AMPLITUDE) {
+        qDebug("expected the tone to be filtered out, it aliased with an amplitude of %f", amplitude);
+        return false;
+    }
+    return true;
+}
+
+bool AudioResamplerTests::chunkingTest() {
+    const int DEVICE_SAMPLE_RATE = 44100;
+    const int NUM_SOURCE_FRAMES = 10000;
+    const int MAX_CHUNK_FRAMES = 3000;
+
+    QVector<int16_t> source(NUM_SOURCE_FRAMES * 2);
+    for (int i = 0; i < source.size(); i++) {
+        source[i] = randIntInRange(-TONE_AMPLITUDE, TONE_AMPLITUDE);
+    }
+
+    // all at once, with chunks smaller than what goes in so the resampler has to split them itself
+    AudioResampler wholeResampler(DEVICE_SAMPLE_RATE, 2, NETWORK_SAMPLE_RATE, 2, MAX_CHUNK_FRAMES / 7);
+    QVector<int16_t> wholeDestination(wholeResampler.getMaxDestinationFrames(NUM_SOURCE_FRAMES) * 2);
+    int numWholeFrames = wholeResampler.resample(source.constData(), NUM_SOURCE_FRAMES, wholeDestination.data());
+
+    // and in chunks of every size up to larger than the resampler takes at once
+    AudioResampler chunkedResampler(DEVICE_SAMPLE_RATE, 2, NETWORK_SAMPLE_RATE, 2, MAX_CHUNK_FRAMES / 7);
+    QVector<int16_t> chunkedDestination(chunkedResampler.getMaxDestinationFrames(NUM_SOURCE_FRAMES) * 2);
+    int numChunkedFrames = 0;
+    for (int sourceFrame = 0; sourceFrame < NUM_SOURCE_FRAMES; ) {
+        int numFrames = qMin(randIntInRange(1, MAX_CHUNK_FRAMES), NUM_SOURCE_FRAMES - sourceFrame);
+        numChunkedFrames += chunkedResampler.resample(source.constData() + (sourceFrame * 2), numFrames,
+                                                      chunkedDestination.data() + (numChunkedFrames * 2));
+        sourceFrame += numFrames;
+    }
+
+    if (numWholeFrames != numChunkedFrames) {
+        qDebug("expected %d frames in chunks, got %d", numWholeFrames, numChunkedFrames);
+        return false;
+    }
+    for (int i = 0; i < numWholeFrames * 2; i++) {
+        if (wholeDestination[i] != chunkedDestination[i]) {
+            qDebug("chunkedDestination[%d] incorrect! Expected: %d  Actual: %d", i, wholeDestination[i],
+                   chunkedDestination[i]);
+            return false;
+        }
+    }
+    return true;
+}
+
+void AudioResamplerTests::runAllTests() {
+    if (passbandTest() && stopbandTest() && chunkingTest()) {
+        qDebug() << "PASSED";
+    } else {
+        qDebug() << "FAILED";
+    }
+}
@@ -0,0 +1,30 @@
+//
+//  AudioResamplerTests.h
+//  tests/audio/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#ifndef hifi_AudioResamplerTests_h
+#define hifi_AudioResamplerTests_h
+
+#include "AudioResampler.h"
+
+namespace AudioResamplerTests {
+
+    void runAllTests();
+
+    /// a tone under the new nyquist comes out at the same level and the right number of frames for every device rate
+    bool passbandTest();
+
+    /// a tone over the new nyquist is filtered out rather than folded back down
+    bool stopbandTest();
+
+    /// the output doesn't depend on the size of the chunks the input comes in
+    bool chunkingTest();
+};
+
+#endif // hifi_AudioResamplerTests_h
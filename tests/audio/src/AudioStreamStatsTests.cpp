@@ -0,0 +1,89 @@
+//
+//  AudioStreamStatsTests.cpp
+//  tests/audio/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#include <QtCore/QDebug>
+
+#include "AudioStreamStatsTests.h"
+
+static AudioStreamStats makeTotals(quint32 received, quint32 late, quint32 lost) {
+    AudioStreamStats totals;
+    totals._packetsReceived = received;
+    totals._packetsLate = late;
+    totals._packetsLost = lost;
+    return totals;
+}
+
+bool AudioStreamStatsTests::windowCountsTest() {
+    AudioStreamStatsWindow window;
+
+    AudioStreamStats stats = window.close(makeTotals(100, 2, 5));
+    if (stats._packetsReceived != 100 || stats._packetsLate != 2 || stats._packetsLost != 5) {
+        qDebug() << "FAIL: the first window gave" << stats._packetsReceived << stats._packetsLate
+            << stats._packetsLost << "rather than the totals";
+        return false;
+    }
+
+    stats = window.close(makeTotals(250, 2, 8));
+    if (stats._packetsReceived != 150 || stats._packetsLate != 0 || stats._packetsLost != 3) {
+        qDebug() << "FAIL: the second window gave" << stats._packetsReceived << stats._packetsLate
+            << stats._packetsLost << "rather than what the totals grew by";
+        return false;
+    }
+
+    // the stats of a replaced stream start again from nothing
+    stats = window.close(makeTotals(40, 1, 0));
+    if (stats._packetsReceived != 40 || stats._packetsLate != 1 || stats._packetsLost != 0) {
+        qDebug() << "FAIL: the window after a reset gave" << stats._packetsReceived << stats._packetsLate
+            << stats._packetsLost << "rather than the new totals";
+        return false;
+    }
+    return true;
+}
+
+bool AudioStreamStatsTests::jitterPercentilesTest() {
+    AudioStreamStatsWindow window;
+    if (window.getJitterBufferFramesAtPercentile(0.5f) != 0) {
+        qDebug() << "FAIL: a window with no samples had a median of" << window.getJitterBufferFramesAtPercentile(0.5f);
+        return false;
+    }
+
+    // ninety-nine mixes at 2 frames and one at 30, and one past the capacity that's counted as full
+    for (int i = 0; i < 98; i++) {
+        window.sampleJitterBufferFrames(2);
+    }
+    window.sampleJitterBufferFrames(30);
+    window.sampleJitterBufferFrames(AUDIOMIXER_INBOUND_RING_BUFFER_FRAME_CAPACITY * 2);
+    window.close(AudioStreamStats());
+
+    if (window.getNumJitterSamples() != 100 || window.getJitterBufferFramesAtPercentile(0.5f) != 2
+            || window.getJitterBufferFramesAtPercentile(0.99f) != AUDIOMIXER_INBOUND_RING_BUFFER_FRAME_CAPACITY
+            || window.getJitterBufferFramesAtPercentile(0.98f) != 30) {
+        qDebug() << "FAIL: the closed window had" << window.getNumJitterSamples() << "samples, a median of"
+            << window.getJitterBufferFramesAtPercentile(0.5f) << "and a 98th and 99th percentile of"
+            << window.getJitterBufferFramesAtPercentile(0.98f) << window.getJitterBufferFramesAtPercentile(0.99f);
+        return false;
+    }
+
+    // the next window's samples don't mix with the last's
+    window.sampleJitterBufferFrames(5);
+    if (window.getNumJitterSamples() != 1 || window.getJitterBufferFramesAtPercentile(0.99f) != 5) {
+        qDebug() << "FAIL: the next window started with" << window.getNumJitterSamples() << "samples";
+        return false;
+    }
+    return true;
+}
+
+void AudioStreamStatsTests::runAllTests() {
+    if (windowCountsTest() && jitterPercentilesTest()) {
+        qDebug() << "PASSED";
+    } else {
+        qDebug() << "FAILED";
+    }
+}
@@ -0,0 +1,27 @@
+//
+//  AudioStreamStatsTests.h
+//  tests/audio/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#ifndef hifi_AudioStreamStatsTests_h
+#define hifi_AudioStreamStatsTests_h
+
+#include "AudioStreamStats.h"
+
+namespace AudioStreamStatsTests {
+
+    void runAllTests();
+
+    /// closing a window gives the growth of the totals since the last close, or all of them if they went down
+    bool windowCountsTest();
+
+    /// the percentiles of the jitter buffer lengths are those of the samples of the window just closed
+    bool jitterPercentilesTest();
+};
+
+#endif // hifi_AudioStreamStatsTests_h
@@ -0,0 +1,208 @@
+//
+//  SPSCAudioRingBufferTests.cpp
+//  tests/audio/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#include <QtCore/QDebug>
+#include <QtCore/QThread>
+
+#include "SPSCAudioRingBufferTests.h"
+
+#include "SharedUtil.h"
+
+bool SPSCAudioRingBufferTests::assertBufferSize(const SPSCAudioRingBuffer& buffer, int samples) {
+    if (buffer.samplesAvailable() != samples) {
+        qDebug("Unexpected num samples available! Exptected: %d  Actual: %d\n", samples, buffer.samplesAvailable());
+        return false;
+    }
+    return true;
+}
+
+bool SPSCAudioRingBufferTests::sequenceTest() {
+    int16_t writeData[10000];
+    for (int i = 0; i < 10000; i++) { writeData[i] = i; }
+    int writeIndexAt;
+
+    int16_t readData[10000];
+    int readIndexAt;
+
+    // 100 samples are asked for and the buffer holds 128, so the indices keep landing in new places as they wrap
+    SPSCAudioRingBuffer ringBuffer(100);
+    for (int T = 0; T < 300; T++) {
+        writeIndexAt = 0;
+        readIndexAt = 0;
+
+        // write 73 samples, 73 samples in buffer
+        writeIndexAt += ringBuffer.writeSamples(&writeData[writeIndexAt], 73) / sizeof(int16_t);
+        if (!assertBufferSize(ringBuffer, 73)) {
+            return false;
+        }
+
+        // read 43 samples, 30 samples in buffer
+        readIndexAt += ringBuffer.readSamples(&readData[readIndexAt], 43) / sizeof(int16_t);
+        if (!assertBufferSize(ringBuffer, 30)) {
+            return false;
+        }
+
+        // write 70 samples, 100 samples in buffer
+        writeIndexAt += ringBuffer.writeSamples(&writeData[writeIndexAt], 70) / sizeof(int16_t);
+        if (!assertBufferSize(ringBuffer, 100)) {
+            return false;
+        }
+
+        // write 3 silent samples, 103 samples in buffer
+        ringBuffer.addSilentFrame(3);
+
+        // read 103 samples, 0 samples in buffer (empty)
+        readIndexAt += ringBuffer.readSamples(&readData[readIndexAt], 103) / sizeof(int16_t);
+        if (!assertBufferSize(ringBuffer, 0)) {
+            return false;
+        }
+
+        // verify 143 samples of read data and the 3 silent samples after them
+        for (int i = 0; i < 146; i++) {
+            int expected = i < 143 ? i : 0;
+            if (readData[i] != expected) {
+                qDebug("readData[%d] incorrect!  Expcted: %d  Actual: %d", i, expected, readData[i]);
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+bool SPSCAudioRingBufferTests::overflowTest() {
+    int16_t writeData[200];
+    for (int i = 0; i < 200; i++) { writeData[i] = i; }
+
+    int16_t readData[200];
+
+    SPSCAudioRingBuffer ringBuffer(128);
+
+    // write 100 samples, then try 50 more - only 28 fit
+    ringBuffer.writeSamples(writeData, 100);
+    int samplesWritten = ringBuffer.writeSamples(&writeData[100], 50) / sizeof(int16_t);
+    if (samplesWritten != 28) {
+        qDebug("Overflowing write incorrect!  Expected: 28  Actual: %d", samplesWritten);
+        return false;
+    }
+    if (!assertBufferSize(ringBuffer, 128)) {
+        return false;
+    }
+
+    // a full buffer takes no silence either
+    if ((samplesWritten = ringBuffer.addSilentFrame(10)) != 0) {
+        qDebug("addSilentFrame(10) incorrect!  Expected: 0  Actual: %d", samplesWritten);
+        return false;
+    }
+
+    // the oldest samples are still all there
+    ringBuffer.readSamples(readData, 200);
+    for (int i = 0; i < 128; i++) {
+        if (readData[i] != i) {
+            qDebug("readData[%d] incorrect!  Expcted: %d  Actual: %d", i, i, readData[i]);
+            return false;
+        }
+    }
+
+    return assertBufferSize(ringBuffer, 0);
+}
+
+const int STRESS_TEST_NUM_SAMPLES = 1 << 22;
+const int STRESS_TEST_MAX_CHUNK_SAMPLES = 300;
+
+class StressTestWriter : public QThread {
+public:
+    StressTestWriter(SPSCAudioRingBuffer& ringBuffer) : _ringBuffer(ringBuffer) { }
+
+protected:
+    virtual void run() {
+        int16_t chunk[STRESS_TEST_MAX_CHUNK_SAMPLES];
+        int nextSample = 0;
+
+        while (nextSample < STRESS_TEST_NUM_SAMPLES) {
+            // alternate between copying writes and in place writes through the write view
+            if (nextSample % 2 == 0) {
+                int chunkSamples = qMin(randIntInRange(1, STRESS_TEST_MAX_CHUNK_SAMPLES),
+                                        STRESS_TEST_NUM_SAMPLES - nextSample);
+                for (int i = 0; i < chunkSamples; i++) {
+                    chunk[i] = (int16_t) (nextSample + i);
+                }
+                nextSample += _ringBuffer.writeSamples(chunk, chunkSamples) / sizeof(int16_t);
+            } else {
+                int16_t* destination;
+                int viewSamples = qMin(_ringBuffer.getContiguousWriteView(destination),
+                                       STRESS_TEST_NUM_SAMPLES - nextSample);
+                for (int i = 0; i < viewSamples; i++) {
+                    destination[i] = (int16_t) (nextSample + i);
+                }
+                _ringBuffer.commitWrite(viewSamples);
+                nextSample += viewSamples;
+            }
+        }
+    }
+
+private:
+    SPSCAudioRingBuffer& _ringBuffer;
+};
+
+bool SPSCAudioRingBufferTests::threadedStressTest() {
+    // a small buffer so that the writer keeps running into the reader and back
+    SPSCAudioRingBuffer ringBuffer(512);
+    StressTestWriter writer(ringBuffer);
+    writer.start();
+
+    int16_t chunk[STRESS_TEST_MAX_CHUNK_SAMPLES];
+    int nextSample = 0;
+    bool passed = true;
+
+    while (nextSample < STRESS_TEST_NUM_SAMPLES) {
+        int chunkSamples = 0;
+        const int16_t* source = chunk;
+
+        if (nextSample % 2 == 0) {
+            chunkSamples = ringBuffer.readSamples(chunk, randIntInRange(1, STRESS_TEST_MAX_CHUNK_SAMPLES))
+                / sizeof(int16_t);
+        } else {
+            chunkSamples = ringBuffer.getContiguousReadView(source);
+        }
+
+        for (int i = 0; i < chunkSamples && passed; i++) {
+            if (source[i] != (int16_t) (nextSample + i)) {
+                qDebug("Stress test sample %d incorrect!  Expected: %d  Actual: %d", nextSample + i,
+                       (int16_t) (nextSample + i), source[i]);
+                passed = false;
+            }
+        }
+
+        if (source != chunk) {
+            ringBuffer.commitRead(chunkSamples);
+        }
+        nextSample += chunkSamples;
+
+        if (!passed) {
+            // let the writer finish so the thread can be joined
+            while (writer.isRunning()) {
+                ringBuffer.discardAvailable();
+            }
+            break;
+        }
+    }
+
+    writer.wait();
+    return passed && assertBufferSize(ringBuffer, 0);
+}
+
+void SPSCAudioRingBufferTests::runAllTests() {
+    if (sequenceTest() && overflowTest() && threadedStressTest()) {
+        qDebug() << "PASSED";
+    } else {
+        qDebug() << "FAILED";
+    }
+}
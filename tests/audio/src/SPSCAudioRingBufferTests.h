@@ -0,0 +1,32 @@
+//
+//  SPSCAudioRingBufferTests.h
+//  tests/audio/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#ifndef hifi_SPSCAudioRingBufferTests_h
+#define hifi_SPSCAudioRingBufferTests_h
+
+#include "SPSCAudioRingBuffer.h"
+
+namespace SPSCAudioRingBufferTests {
+
+    void runAllTests();
+
+    /// the single threaded read and write sequence of AudioRingBufferTests, up to where the two buffers differ on overflow
+    bool sequenceTest();
+
+    /// a full buffer drops the newest samples rather than overwriting the oldest
+    bool overflowTest();
+
+    /// a writer thread and a reader thread exchange a numbered stream in uneven chunks
+    bool threadedStressTest();
+
+    bool assertBufferSize(const SPSCAudioRingBuffer& buffer, int samples);
+};
+
+#endif // hifi_SPSCAudioRingBufferTests_h
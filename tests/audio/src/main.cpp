@@ -8,11 +8,19 @@
 //  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
 //
 
+#include "AudioMixKernelsTests.h"
+#include "AudioResamplerTests.h"
 #include "AudioRingBufferTests.h"
+#include "AudioStreamStatsTests.h"
+#include "SPSCAudioRingBufferTests.h"
 #include <stdio.h>
 
 int main(int argc, char** argv) {
     AudioRingBufferTests::runAllTests();
+    SPSCAudioRingBufferTests::runAllTests();
+    AudioMixKernelsTests::runAllTests();
+    AudioResamplerTests::runAllTests();
+    AudioStreamStatsTests::runAllTests();
     printf("all tests passed.  press enter to exit\n");
     getchar();
     return 0;
@@ -9,9 +9,12 @@
 //  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
 //
 
+#include <float.h>
 #include <stdlib.h>
 
+#include <QElapsedTimer>
 #include <QScriptValueIterator>
+#include <QThreadPool>
 
 #include <SharedUtil.h>
 
@@ -435,7 +438,236 @@ static bool testSerialization(Bitstream::MetadataType metadataType) {
         qDebug() << "Mismatch between written/JSON streams (mapped).";
         return true;
     }
+
+    // and a piece at a time, each piece with only the metadata the ones before it didn't have
+    JSONWriter pieceWriter;
+    QList<QByteArray> encodedPieces;
+    pieceWriter << testObjectReadA;
+    encodedPieces.append(pieceWriter.takeDocument().toJson(QJsonDocument::Compact));
+    pieceWriter << testObjectReadB;
+    encodedPieces.append(pieceWriter.takeDocument().toJson(QJsonDocument::Compact));
+    pieceWriter << messageRead << endRead;
+    encodedPieces.append(pieceWriter.takeDocument().toJson(QJsonDocument::Compact));
+
+    JSONReader pieceReader(QJsonDocument::fromJson(encodedPieces.at(0)), Bitstream::ALL_GENERICS);
+    pieceReader >> testObjectReadA;
+    pieceReader.addDocument(QJsonDocument::fromJson(encodedPieces.at(1)));
+    pieceReader >> testObjectReadB;
+    pieceReader.addDocument(QJsonDocument::fromJson(encodedPieces.at(2)));
+    pieceReader >> messageRead;
+    pieceReader >> endRead;
+
+    testObjectReadA->setID(testObjectWrittenA->getID());
+    testObjectReadA->setOriginID(testObjectWrittenA->getOriginID());
+    testObjectReadB->setID(testObjectWrittenB->getID());
+    testObjectReadB->setOriginID(testObjectWrittenB->getOriginID());
+
+    QByteArray pieceCompareArray;
+    QDataStream pieceCompareOutStream(&pieceCompareArray, QIODevice::WriteOnly);
+    Bitstream pieceCompareOut(pieceCompareOutStream, Bitstream::FULL_METADATA);
+    pieceCompareOut << testObjectReadA;
+    pieceCompareOut << testObjectReadB;
+    pieceCompareOut << messageRead;
+    pieceCompareOut << endRead;
+    pieceCompareOut.flush();
+
+    if (compareArray != pieceCompareArray) {
+        qDebug() << "Mismatch between written/JSON streams (pieces).";
+        return true;
+    }
+
+    return false;
+}
+
+static bool testBitstream() {
+    // chunks of random bits at random offsets, with some long byte aligned runs among them
+    const int CHUNK_COUNT = 100000;
+    const int MAX_CHUNK_BYTES = 64;
+    QVector<QByteArray> chunks;
+    QVector<int> bitCounts;
+    QVector<int> offsets;
+    for (int i = 0; i < CHUNK_COUNT; i++) {
+        int offset = randomBoolean() ? 0 : randIntInRange(0, BITS_IN_BYTE - 1);
+        int bits = randomBoolean() ? randIntInRange(1, 32) : randIntInRange(0, (MAX_CHUNK_BYTES - 1) * BITS_IN_BYTE);
+        QByteArray chunk(MAX_CHUNK_BYTES, 0);
+        for (int j = 0; j < chunk.size(); j++) {
+            chunk[j] = (char)randIntInRange(0, 255);
+        }
+        chunks.append(chunk);
+        bitCounts.append(bits);
+        offsets.append(offset);
+    }
+    
+    QByteArray array;
+    QDataStream outStream(&array, QIODevice::WriteOnly);
+    Bitstream out(outStream);
+    QElapsedTimer timer;
+    timer.start();
+    for (int i = 0; i < CHUNK_COUNT; i++) {
+        out.write(chunks.at(i).constData(), bitCounts.at(i), offsets.at(i));
+    }
+    out.flush();
+    qint64 writeElapsed = timer.nsecsElapsed();
+    
+    QDataStream inStream(array);
+    Bitstream in(inStream);
+    QByteArray chunkRead(MAX_CHUNK_BYTES, 0);
+    timer.restart();
+    for (int i = 0; i < CHUNK_COUNT; i++) {
+        int bits = bitCounts.at(i);
+        int offset = offsets.at(i);
+        in.read(chunkRead.data(), bits, offset);
+        
+        // compare bit by bit, as the bits around those read are left as they were
+        for (int j = offset; j < offset + bits; j++) {
+            int mask = 1 << (j % BITS_IN_BYTE);
+            if ((chunkRead.at(j / BITS_IN_BYTE) & mask) != (chunks.at(i).at(j / BITS_IN_BYTE) & mask)) {
+                qDebug() << "Bitstream mismatch at chunk" << i << "bit" << j;
+                return true;
+            }
+        }
+    }
+    qint64 readElapsed = timer.nsecsElapsed();
     
+    const float NSECS_PER_SEC = 1000000000.0f;
+    const float BYTES_PER_MEGABYTE = 1024.0f * 1024.0f;
+    float megabytes = array.size() / BYTES_PER_MEGABYTE;
+    qDebug() << "Wrote" << array.size() << "bytes at" << (megabytes * NSECS_PER_SEC / writeElapsed) << "MB/s, read at" <<
+        (megabytes * NSECS_PER_SEC / readElapsed) << "MB/s";
+    qDebug();
+    return false;
+}
+
+static bool testParallelGuide();
+
+static void writeRecordingTestValues(Bitstream& out, const QVector<SharedObjectPointer>& objects) {
+    for (int i = 0; i < objects.size(); i++) {
+        out << i;
+        out << QVariant::fromValue(objects.at(i));
+        out << AttributeRegistry::getInstance()->getColorAttribute();
+        out << objects.at(objects.size() - i - 1);
+    }
+}
+
+static bool testBitstreamRecording() {
+    const int OBJECT_COUNT = 20;
+    QVector<SharedObjectPointer> objects;
+    for (int i = 0; i < OBJECT_COUNT; i++) {
+        objects.append(new TestSharedObjectA(randFloat(), getRandomTestEnum(), getRandomTestFlags()));
+    }
+    BitstreamRecording recording;
+    QDataStream recordingStream(&recording.getData(), QIODevice::WriteOnly);
+    Bitstream recorder(recordingStream);
+    recorder.startRecording(&recording);
+    writeRecordingTestValues(recorder, objects);
+    recorder.stopRecording();
+    
+    // the copies should come out as if written directly, whatever the streams had persisted beforehand
+    const int MAX_PERSISTED_OBJECTS = 5;
+    for (int persisted = 0; persisted <= MAX_PERSISTED_OBJECTS; persisted++) {
+        QByteArray directArray;
+        QDataStream directStream(&directArray, QIODevice::WriteOnly);
+        Bitstream direct(directStream);
+        QByteArray copiedArray;
+        QDataStream copiedStream(&copiedArray, QIODevice::WriteOnly);
+        Bitstream copied(copiedStream);
+        for (int i = 0; i < persisted; i++) {
+            direct << objects.at(i);
+            copied << objects.at(i);
+        }
+        direct.persistAndResetWriteMappings();
+        copied.persistAndResetWriteMappings();
+        
+        writeRecordingTestValues(direct, objects);
+        copied << recording;
+        direct.flush();
+        copied.flush();
+        if (directArray != copiedArray) {
+            qDebug() << "Recording mismatch with" << persisted << "persisted objects";
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool testWriteAsVariant() {
+    const int MESSAGE_COUNT = 20;
+    QByteArray variantArray;
+    QDataStream variantStream(&variantArray, QIODevice::WriteOnly);
+    Bitstream variantOut(variantStream);
+    QByteArray directArray;
+    QDataStream directStream(&directArray, QIODevice::WriteOnly);
+    Bitstream directOut(directStream);
+    for (int i = 0; i < MESSAGE_COUNT; i++) {
+        TestMessageC message = createRandomMessageC(true);
+        variantOut << QVariant::fromValue(message);
+        directOut.writeAsVariant(message);
+    }
+    variantOut.flush();
+    directOut.flush();
+    if (variantArray != directArray) {
+        qDebug() << "Direct variant write mismatch";
+        return true;
+    }
+    return false;
+}
+
+static glm::vec3 createRandomVector(float range) {
+    return glm::vec3(randFloatInRange(-range, range), randFloatInRange(-range, range), randFloatInRange(-range, range));
+}
+
+static bool testSpannerBoundsTree() {
+    const int SPANNER_COUNT = 200;
+    const float SPANNER_RANGE = 10.0f;
+    const AttributePointer& attribute = AttributeRegistry::getInstance()->getSpannersAttribute();
+    MetavoxelData data;
+    QVector<SharedObjectPointer> spanners;
+    for (int i = 0; i < SPANNER_COUNT; i++) {
+        Sphere* sphere = new Sphere();
+        sphere->setTranslation(createRandomVector(SPANNER_RANGE));
+        sphere->setScale(randFloatInRange(0.1f, 1.0f));
+        spanners.append(sphere);
+        data.insert(attribute, sphere);
+    }
+    
+    // the trees should agree with a test of every spanner
+    const int QUERY_COUNT = 100;
+    for (int i = 0; i < QUERY_COUNT; i++) {
+        glm::vec3 center = createRandomVector(SPANNER_RANGE);
+        glm::vec3 extent = glm::abs(createRandomVector(SPANNER_RANGE * 0.25f));
+        Box bounds(center - extent, center + extent);
+        QVector<SharedObjectPointer> intersecting;
+        data.getIntersectingSpanners(attribute, bounds, intersecting);
+        SharedObjectSet expected;
+        foreach (const SharedObjectPointer& spanner, spanners) {
+            if (static_cast<Spanner*>(spanner.data())->getBounds().intersects(bounds)) {
+                expected.insert(spanner);
+            }
+        }
+        if (intersecting.size() != expected.size() || intersecting.toList().toSet() != expected) {
+            qDebug() << "Intersecting spanner mismatch" << intersecting.size() << expected.size();
+            return true;
+        }
+        
+        glm::vec3 origin = createRandomVector(SPANNER_RANGE * 2.0f);
+        glm::vec3 direction = glm::normalize(center - origin);
+        SharedObjectPointer expectedSpanner;
+        float expectedDistance = FLT_MAX;
+        foreach (const SharedObjectPointer& spanner, spanners) {
+            float distance;
+            if (static_cast<Spanner*>(spanner.data())->findRayIntersection(origin, direction,
+                    glm::vec3(), 0.0f, distance) && distance < expectedDistance) {
+                expectedSpanner = spanner;
+                expectedDistance = distance;
+            }
+        }
+        float distance;
+        if (data.findFirstRaySpannerIntersection(origin, direction, attribute, distance) != expectedSpanner ||
+                (expectedSpanner && distance != expectedDistance)) {
+            qDebug() << "First ray spanner intersection mismatch";
+            return true;
+        }
+    }
     return false;
 }
 
@@ -558,6 +790,51 @@ bool MetavoxelTests::run() {
             "spanner mutations";
     }
     
+    if (test == 0 || test == 6) {
+        qDebug() << "Running bitstream test...";
+        qDebug();
+        
+        if (testBitstream()) {
+            return true;
+        }
+    }
+    
+    if (test == 0 || test == 7) {
+        qDebug() << "Running bitstream recording test...";
+        qDebug();
+        
+        if (testBitstreamRecording()) {
+            return true;
+        }
+    }
+    
+    if (test == 0 || test == 8) {
+        qDebug() << "Running parallel guide test...";
+        qDebug();
+        
+        if (testParallelGuide()) {
+            return true;
+        }
+    }
+    
+    if (test == 0 || test == 9) {
+        qDebug() << "Running direct variant write test...";
+        qDebug();
+        
+        if (testWriteAsVariant()) {
+            return true;
+        }
+    }
+    
+    if (test == 0 || test == 10) {
+        qDebug() << "Running spanner bounds tree test...";
+        qDebug();
+        
+        if (testSpannerBoundsTree()) {
+            return true;
+        }
+    }
+    
     qDebug() << "All tests passed!";
     
     return false;
@@ -600,6 +877,64 @@ int RandomVisitor::visit(MetavoxelInfo& info) {
     return STOP_RECURSION;
 }
 
+/// Gathers the leaves it visits, in the order it visits them.
+class LeafVisitor : public MetavoxelVisitor {
+public:
+    
+    QVector<glm::vec4> leaves;
+    QVector<QRgb> colors;
+    
+    LeafVisitor();
+    virtual int visit(MetavoxelInfo& info);
+    virtual MetavoxelVisitor* fork() const;
+    virtual void join(MetavoxelVisitor* fork);
+};
+
+LeafVisitor::LeafVisitor() :
+    MetavoxelVisitor(QVector<AttributePointer>() << AttributeRegistry::getInstance()->getColorAttribute()) {
+}
+
+int LeafVisitor::visit(MetavoxelInfo& info) {
+    if (!info.isLeaf) {
+        return DEFAULT_ORDER;
+    }
+    leaves.append(glm::vec4(info.minimum, info.size));
+    colors.append(info.inputValues.at(0).getInlineValue<QRgb>());
+    return STOP_RECURSION;
+}
+
+MetavoxelVisitor* LeafVisitor::fork() const {
+    return new LeafVisitor();
+}
+
+void LeafVisitor::join(MetavoxelVisitor* fork) {
+    leaves += static_cast<LeafVisitor*>(fork)->leaves;
+    colors += static_cast<LeafVisitor*>(fork)->colors;
+}
+
+static bool testParallelGuide() {
+    MetavoxelData data;
+    data.expand();
+    data.expand();
+    RandomVisitor randomVisitor;
+    data.guide(randomVisitor);
+    
+    // the forks should find the same leaves as a serial tour, and be joined in the same order
+    LeafVisitor serialVisitor;
+    data.guide(serialVisitor);
+    LeafVisitor parallelVisitor;
+    QThreadPool pool;
+    data.guide(parallelVisitor, &pool);
+    if (parallelVisitor.leaves != serialVisitor.leaves || parallelVisitor.colors != serialVisitor.colors) {
+        qDebug() << "Parallel tour found" << parallelVisitor.leaves.size() << "leaves, serial tour" <<
+            serialVisitor.leaves.size();
+        return true;
+    }
+    qDebug() << "Toured" << serialVisitor.leaves.size() << "leaves";
+    qDebug();
+    return false;
+}
+
 class TestSendRecord : public PacketRecord {
 public:
     
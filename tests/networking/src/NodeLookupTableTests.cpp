@@ -0,0 +1,60 @@
+//
+//  NodeLookupTableTests.cpp
+//  tests/networking/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#include <assert.h>
+
+#include "NodeLookupTable.h"
+#include "PacketHeaders.h"
+
+#include "NodeLookupTableTests.h"
+
+void NodeLookupTableTests::runAllTests() {
+    lookupTest();
+    packetHeaderTest();
+}
+
+static QSharedPointer<Node> createNode() {
+    return QSharedPointer<Node>(new Node(QUuid::createUuid(), NodeType::Agent, HifiSockAddr(), HifiSockAddr()));
+}
+
+void NodeLookupTableTests::lookupTest() {
+    QByteArray unknownUUID = QUuid::createUuid().toRfc4122();
+
+    NodeLookupTable emptyTable;
+    assert(emptyTable.size() == 0);
+    assert(!emptyTable.find(unknownUUID.constData()));
+
+    // enough nodes that the table has to grow past its smallest capacity, and that some of them collide
+    const int NUM_NODES = 100;
+    QHash<QUuid, QSharedPointer<Node> > nodeHash;
+    for (int i = 0; i < NUM_NODES; i++) {
+        QSharedPointer<Node> node = createNode();
+        nodeHash.insert(node->getUUID(), node);
+    }
+
+    NodeLookupTable table(nodeHash);
+    assert(table.size() == NUM_NODES);
+    foreach (const QSharedPointer<Node>& node, nodeHash) {
+        assert(table.find(node->getUUID().toRfc4122().constData()) == node);
+    }
+    assert(!table.find(unknownUUID.constData()));
+}
+
+void NodeLookupTableTests::packetHeaderTest() {
+    QSharedPointer<Node> node = createNode();
+    QHash<QUuid, QSharedPointer<Node> > nodeHash;
+    nodeHash.insert(node->getUUID(), node);
+    NodeLookupTable table(nodeHash);
+
+    // the bytes in the header are those the sender wrote its UUID as
+    QByteArray packet = byteArrayWithPopulatedHeader(PacketTypeMixedAudio, node->getUUID());
+    assert(table.find(uuidBytesFromPacketHeader(packet)) == node);
+    assert(uuidFromPacketHeader(packet) == node->getUUID());
+}
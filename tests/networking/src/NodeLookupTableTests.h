@@ -0,0 +1,22 @@
+//
+//  NodeLookupTableTests.h
+//  tests/networking/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#ifndef hifi_NodeLookupTableTests_h
+#define hifi_NodeLookupTableTests_h
+
+namespace NodeLookupTableTests {
+
+    void runAllTests();
+
+    void lookupTest();
+    void packetHeaderTest();
+};
+
+#endif // hifi_NodeLookupTableTests_h
@@ -0,0 +1,134 @@
+//
+//  SelectiveAckTests.cpp
+//  tests/networking/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#include <assert.h>
+
+#include "CongestionControl.h"
+#include "SelectiveAck.h"
+#include "SharedUtil.h"
+
+#include "SelectiveAckTests.h"
+
+void SelectiveAckTests::runAllTests() {
+    rangesTest();
+    roundTripTimeTest();
+    windowTest();
+}
+
+void SelectiveAckTests::rangesTest() {
+    SelectiveAck ack;
+    ack.setNewestSequenceNumber(3);
+
+    // the missing numbers run across the rollover, so the oldest of them are the largest
+    QSet<uint16_t> missing;
+    missing << 65533 << 65534 << 65535 << 0 << 2 << 60000;
+    ack.setMissingSequenceNumbers(missing);
+
+    assert(ack.getNumMissingRanges() == 3);
+
+    QList<uint16_t> sequenceNumbers = ack.getMissingSequenceNumbers();
+    assert(sequenceNumbers.size() == 6);
+    assert(sequenceNumbers.at(0) == 60000);
+    assert(sequenceNumbers.at(1) == 65533);
+    assert(sequenceNumbers.at(4) == 0);
+    assert(sequenceNumbers.at(5) == 2);
+
+    assert(ack.hasMissingAfter(1));
+    assert(!ack.hasMissingAfter(2));
+    assert(ack.hasMissingAfter(65534));
+
+    ack.setMissingSequenceNumbers(QSet<uint16_t>());
+    assert(!ack.hasMissing());
+    assert(!ack.hasMissingAfter(0));
+}
+
+void SelectiveAckTests::roundTripTimeTest() {
+    const quint64 START = 1000 * USECS_PER_SECOND;
+    const quint64 ROUND_TRIP = 40 * USECS_PER_MSEC;
+    const quint64 HOLD = 5 * USECS_PER_MSEC;
+
+    CongestionControl congestionControl;
+    assert(!congestionControl.hasRoundTripTime());
+    assert(congestionControl.getPacketsPerSecond() == 0);
+
+    // the receiver holding on to the packet doesn't count toward the round trip
+    SelectiveAck ack;
+    for (int i = 0; i < 20; i++) {
+        quint64 sentAt = START + i * USECS_PER_SECOND;
+        ack.setNewestSequenceNumber((uint16_t) (i * 10));
+        ack.setEcho(sentAt, HOLD);
+        congestionControl.ackReceived(ack, sentAt + ROUND_TRIP + HOLD);
+    }
+    assert(congestionControl.getSmoothedRoundTripTime() == ROUND_TRIP);
+    assert(congestionControl.getBaseRoundTripTime() == ROUND_TRIP);
+    assert(congestionControl.getRoundTripTimeVariance() < ROUND_TRIP / 10);
+    assert(congestionControl.getPacketsPerSecond() > 0);
+
+    // an echo from the future is a bad timestamp, and is ignored
+    quint64 smoothed = congestionControl.getSmoothedRoundTripTime();
+    ack.setEcho(START + 100 * USECS_PER_SECOND, 0);
+    congestionControl.ackReceived(ack, START + 50 * USECS_PER_SECOND);
+    assert(congestionControl.getSmoothedRoundTripTime() == smoothed);
+}
+
+void SelectiveAckTests::windowTest() {
+    const quint64 START = 1000 * USECS_PER_SECOND;
+    const quint64 BASE_ROUND_TRIP = 20 * USECS_PER_MSEC;
+    const quint64 ACK_INTERVAL = 250 * USECS_PER_MSEC;
+
+    CongestionControl congestionControl;
+    SelectiveAck ack;
+    uint16_t newest = 65000;
+    quint64 now = START;
+
+    // with no queue on the path the window opens up
+    for (int i = 0; i < 20; i++) {
+        newest += 50;
+        now += ACK_INTERVAL;
+        ack.setNewestSequenceNumber(newest);
+        ack.setEcho(now - BASE_ROUND_TRIP, 0);
+        congestionControl.ackReceived(ack, now);
+    }
+    float openWindow = congestionControl.getWindow();
+    assert(openWindow > 10.0f);
+
+    // a loss halves it
+    QSet<uint16_t> missing;
+    missing << (uint16_t) (newest + 10);
+    newest += 50;
+    now += ACK_INTERVAL;
+    ack.setNewestSequenceNumber(newest);
+    ack.setEcho(now - BASE_ROUND_TRIP, 0);
+    ack.setMissingSequenceNumbers(missing);
+    congestionControl.ackReceived(ack, now);
+    float lossWindow = congestionControl.getWindow();
+    assert(lossWindow < openWindow * 0.6f);
+
+    // the same loss reported again isn't another loss
+    newest += 50;
+    now += ACK_INTERVAL;
+    ack.setNewestSequenceNumber(newest);
+    ack.setEcho(now - BASE_ROUND_TRIP, 0);
+    ack.setMissingSequenceNumbers(missing);
+    congestionControl.ackReceived(ack, now);
+    assert(congestionControl.getWindow() >= lossWindow);
+
+    // a queue building up past the target delay closes it
+    ack.setMissingSequenceNumbers(QSet<uint16_t>());
+    float window = congestionControl.getWindow();
+    for (int i = 0; i < 20; i++) {
+        newest += 50;
+        now += ACK_INTERVAL;
+        ack.setNewestSequenceNumber(newest);
+        ack.setEcho(now - BASE_ROUND_TRIP - 300 * USECS_PER_MSEC, 0);
+        congestionControl.ackReceived(ack, now);
+    }
+    assert(congestionControl.getWindow() < window);
+}
@@ -0,0 +1,23 @@
+//
+//  SelectiveAckTests.h
+//  tests/networking/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#ifndef hifi_SelectiveAckTests_h
+#define hifi_SelectiveAckTests_h
+
+namespace SelectiveAckTests {
+
+    void runAllTests();
+
+    void rangesTest();
+    void roundTripTimeTest();
+    void windowTest();
+};
+
+#endif // hifi_SelectiveAckTests_h
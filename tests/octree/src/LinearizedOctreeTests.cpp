@@ -0,0 +1,96 @@
+//
+//  LinearizedOctreeTests.cpp
+//  tests/octree/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#include <QDebug>
+#include <QList>
+
+#include <LinearizedOctree.h>
+#include <ModelTree.h>
+#include <OctreeConstants.h>
+
+#include "LinearizedOctreeTests.h"
+
+void LinearizedOctreeTests::runAllTests() {
+    traversalOrderTest();
+    childIndexTest();
+}
+
+/// fills a tree with elements at a scattering of points and sizes
+static void populateTree(ModelTree& tree) {
+    const int NUM_ELEMENTS = 40;
+    for (int i = 0; i < NUM_ELEMENTS; i++) {
+        float x = (i * 7 % 16) / 16.0f;
+        float y = (i * 5 % 16) / 16.0f;
+        float z = (i * 3 % 16) / 16.0f;
+        float s = (i % 2 == 0) ? 1.0f / 16.0f : 1.0f / 64.0f;
+        tree.getOrCreateChildElementAt(x, y, z, s);
+    }
+}
+
+class VisitArgs {
+public:
+    QList<OctreeElement*> visited;
+    int maxLevel;
+};
+
+/// records the elements, descending only as far as maxLevel
+static bool recordVisit(OctreeElement* element, void* extraData) {
+    VisitArgs* args = static_cast<VisitArgs*>(extraData);
+    args->visited.append(element);
+    return element->getLevel() < args->maxLevel;
+}
+
+void LinearizedOctreeTests::traversalOrderTest() {
+    ModelTree tree;
+    populateTree(tree);
+    
+    LinearizedOctree linearized;
+    linearized.build(tree.getRoot());
+    
+    const int MAX_LEVELS[] = { 1, 3, 100 };
+    for (int i = 0; i < 3; i++) {
+        VisitArgs treeArgs = { QList<OctreeElement*>(), MAX_LEVELS[i] };
+        tree.recurseTreeWithOperation(recordVisit, &treeArgs);
+        
+        VisitArgs linearizedArgs = { QList<OctreeElement*>(), MAX_LEVELS[i] };
+        linearized.recurseWithOperation(recordVisit, &linearizedArgs);
+        
+        if (linearizedArgs.visited != treeArgs.visited) {
+            qDebug() << "FAIL: down to level" << MAX_LEVELS[i] << "the linearized tree visited"
+                << linearizedArgs.visited.size() << "elements where the tree visited" << treeArgs.visited.size()
+                << "or visited them in another order";
+        }
+        if (MAX_LEVELS[i] == 100 && linearized.getNodeCount() != treeArgs.visited.size()) {
+            qDebug() << "FAIL: the linearized tree has" << linearized.getNodeCount() << "nodes for"
+                << treeArgs.visited.size() << "elements";
+        }
+    }
+}
+
+void LinearizedOctreeTests::childIndexTest() {
+    ModelTree tree;
+    populateTree(tree);
+    
+    LinearizedOctree linearized;
+    linearized.build(tree.getRoot());
+    
+    for (int nodeIndex = 0; nodeIndex < linearized.getNodeCount(); nodeIndex++) {
+        OctreeElement* element = linearized.getElement(nodeIndex);
+        for (int childIndex = 0; childIndex < NUMBER_OF_CHILDREN; childIndex++) {
+            int childNodeIndex = linearized.getChildNodeIndex(nodeIndex, childIndex);
+            OctreeElement* child = element->getChildAtIndex(childIndex);
+            OctreeElement* linearizedChild = (childNodeIndex == -1) ? NULL : linearized.getElement(childNodeIndex);
+            if (linearizedChild != child) {
+                qDebug() << "FAIL: child" << childIndex << "of node" << nodeIndex << "is at the wrong offset";
+                return;
+            }
+        }
+    }
+}
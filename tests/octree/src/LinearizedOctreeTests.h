@@ -0,0 +1,22 @@
+//
+//  LinearizedOctreeTests.h
+//  tests/octree/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#ifndef hifi_LinearizedOctreeTests_h
+#define hifi_LinearizedOctreeTests_h
+
+namespace LinearizedOctreeTests {
+
+    void runAllTests();
+    
+    void traversalOrderTest();
+    void childIndexTest();
+}
+
+#endif // hifi_LinearizedOctreeTests_h
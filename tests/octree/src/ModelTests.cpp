@@ -16,6 +16,7 @@
 
 #include <Octree.h>
 #include <ModelItem.h>
+#include <ModelItemBoundsTree.h>
 #include <ModelTree.h>
 #include <ModelTreeElement.h>
 #include <OctreeConstants.h>
@@ -251,14 +252,171 @@ void ModelTests::modelTreeTests(bool verbose) {
         qDebug() << "TIME - Test" << testsTaken <<":" << qPrintable(testName) << "elapsed=" << elapsedInMSecs << "msecs";
     }
 
+    {
+        testsTaken++;
+        QString testName = "delete model from tree and search by ID";
+        if (verbose) {
+            qDebug() << "Test" << testsTaken <<":" << qPrintable(testName);
+        }
+
+        tree.deleteModel(modelID);
+        const ModelItem* foundDeletedModel = tree.findModelByID(id);
+        const ModelItem* foundOtherModel = tree.findModelByID(id + 1);
+
+        if (verbose) {
+            qDebug() << "foundDeletedModel=" << foundDeletedModel;
+            qDebug() << "foundOtherModel=" << foundOtherModel;
+        }
+
+        bool passed = !foundDeletedModel && foundOtherModel && foundOtherModel->getID() == id + 1;
+        if (passed) {
+            testsPassed++;
+        } else {
+            testsFailed++;
+            qDebug() << "FAILED - Test" << testsTaken <<":" << qPrintable(testName);
+        }
+    }
+
+    {
+        testsTaken++;
+        QString testName = "read model data holding only the changed properties";
+        if (verbose) {
+            qDebug() << "Test" << testsTaken <<":" << qPrintable(testName);
+        }
+
+        const ModelItem* foundModel = tree.findModelByID(id + 1);
+        ModelItem playingModel = *foundModel;
+        playingModel.setAnimationIsPlaying(true);
+        playingModel.setAnimationFrameIndex(12.0f);
+
+        // a playing model that hasn't been edited has no changes, since its frame is worked out from its clock
+        ModelItemPropertyFlags changedProperties = playingModel.getPropertiesChangedSince(usecTimestampNow());
+        ModelItemPropertyFlags animationProperties;
+        animationProperties += MODEL_PROP_ANIMATION_FRAME_INDEX;
+        animationProperties += MODEL_PROP_ANIMATION_PLAYING;
+
+        OctreePacketData packetData;
+        playingModel.appendModelData(&packetData, animationProperties);
+        ModelItem readModel = *foundModel;
+        ModelItemPropertyFlags propertiesRead;
+        ReadBitstreamToTreeParams args(WANT_COLOR, NO_EXISTS_BITS, NULL, 0, SharedNodePointer(), false,
+                                       tree.expectedVersion());
+        int bytesRead = readModel.readModelDataFromBuffer(packetData.getUncompressedData(),
+                                                          packetData.getUncompressedSize(), args, &propertiesRead);
+
+        if (verbose) {
+            qDebug() << "bytesRead=" << bytesRead << "of" << packetData.getUncompressedSize();
+            qDebug() << "readModel.getAnimationFrameIndex()=" << readModel.getAnimationFrameIndex();
+        }
+
+        // the read model plays on from the frame the sent one was at, so it's a little past it by now
+        const float MAX_FRAMES_PLAYED = 1.0f;
+        bool passed = changedProperties == ModelItemPropertyFlags() && bytesRead == packetData.getUncompressedSize() &&
+                      propertiesRead == animationProperties && readModel.getAnimationIsPlaying() &&
+                      readModel.getAnimationFrameIndex() >= 12.0f &&
+                      readModel.getAnimationFrameIndex() < 12.0f + MAX_FRAMES_PLAYED &&
+                      readModel.getModelURL() == foundModel->getModelURL() &&
+                      readModel.getPosition() == foundModel->getPosition();
+        if (passed) {
+            testsPassed++;
+        } else {
+            testsFailed++;
+            qDebug() << "FAILED - Test" << testsTaken <<":" << qPrintable(testName);
+        }
+    }
+
     qDebug() << "   tests passed:" << testsPassed << "out of" << testsTaken;
     if (verbose) {
         qDebug() << "******************************************************************************************";
     }
 }
 
+void ModelTests::boundsTreeTests(bool verbose) {
+    int testsTaken = 0;
+    int testsPassed = 0;
+    int testsFailed = 0;
+
+    qDebug() << "ModelTests::boundsTreeTests()";
+
+    // models of all sizes scattered through the unit cube
+    QList<ModelItem> models;
+    const int MODEL_COUNT = 1000;
+    srand(1);
+    for (int i = 0; i < MODEL_COUNT; i++) {
+        ModelItem model;
+        model.setPosition(glm::vec3(randFloat(), randFloat(), randFloat()));
+        model.setRadius(randFloat() * randFloat() * 0.1f);
+        models.append(model);
+    }
+    ModelItemBoundsTree boundsTree;
+    boundsTree.build(models);
+
+    {
+        testsTaken++;
+        QString testName = "bounds tree finds the models touching a box";
+        if (verbose) {
+            qDebug() << "Test" << testsTaken <<":" << qPrintable(testName);
+        }
+        bool passed = true;
+        for (int query = 0; query < 100 && passed; query++) {
+            glm::vec3 minimum(randFloat(), randFloat(), randFloat());
+            glm::vec3 maximum = minimum + glm::vec3(randFloat() * 0.2f);
+            QVector<int> found;
+            boundsTree.findTouching(minimum, maximum, found);
+            int expected = 0;
+            for (int i = 0; i < MODEL_COUNT; i++) {
+                glm::vec3 modelMinimum = models.at(i).getMinimumPoint();
+                glm::vec3 modelMaximum = models.at(i).getMaximumPoint();
+                if (modelMinimum.x <= maximum.x && modelMaximum.x >= minimum.x &&
+                        modelMinimum.y <= maximum.y && modelMaximum.y >= minimum.y &&
+                        modelMinimum.z <= maximum.z && modelMaximum.z >= minimum.z) {
+                    expected++;
+                    passed = passed && found.contains(i);
+                }
+            }
+            passed = passed && found.size() == expected;
+        }
+        if (passed) {
+            testsPassed++;
+        } else {
+            testsFailed++;
+            qDebug() << "FAILED - Test" << testsTaken <<":" << qPrintable(testName);
+        }
+    }
+
+    {
+        testsTaken++;
+        QString testName = "bounds tree finds the models a ray hits";
+        if (verbose) {
+            qDebug() << "Test" << testsTaken <<":" << qPrintable(testName);
+        }
+        bool passed = true;
+        for (int query = 0; query < 100 && passed; query++) {
+            glm::vec3 origin(randFloat(), randFloat(), -0.5f);
+            glm::vec3 direction = glm::normalize(glm::vec3(randFloat() - 0.5f, randFloat() - 0.5f, 1.0f));
+            QVector<int> found;
+            boundsTree.findRayIntersections(origin, direction, found);
+            for (int i = 0; i < MODEL_COUNT; i++) {
+                float distance;
+                BoxFace face;
+                if (models.at(i).getAACube().findRayIntersection(origin, direction, distance, face)) {
+                    passed = passed && found.contains(i);
+                }
+            }
+        }
+        if (passed) {
+            testsPassed++;
+        } else {
+            testsFailed++;
+            qDebug() << "FAILED - Test" << testsTaken <<":" << qPrintable(testName);
+        }
+    }
+
+    qDebug() << "   tests passed:" << testsPassed << "out of" << testsTaken;
+}
 
 void ModelTests::runAllTests(bool verbose) {
     modelTreeTests(verbose);
+    boundsTreeTests(verbose);
 }
 
@@ -14,6 +14,7 @@
 
 namespace ModelTests {
     void modelTreeTests(bool verbose = false);
+    void boundsTreeTests(bool verbose = false);
     void runAllTests(bool verbose = false);
 }
 
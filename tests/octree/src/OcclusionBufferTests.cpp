@@ -0,0 +1,68 @@
+//
+//  OcclusionBufferTests.cpp
+//  tests/octree/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#include <QDebug>
+
+#include <OcclusionBuffer.h>
+#include <ViewFrustum.h>
+
+#include "OcclusionBufferTests.h"
+
+void OcclusionBufferTests::runAllTests() {
+    occludedTest();
+    eraseTest();
+}
+
+/// a view from z = 10 down the negative z axis
+static void setUpViewFrustum(ViewFrustum& viewFrustum) {
+    viewFrustum.setPosition(glm::vec3(0.0f, 0.0f, 10.0f));
+    viewFrustum.setFieldOfView(90.0f);
+    viewFrustum.setAspectRatio(1.0f);
+    viewFrustum.setNearClip(0.1f);
+    viewFrustum.setFarClip(100.0f);
+    viewFrustum.calculate();
+}
+
+void OcclusionBufferTests::occludedTest() {
+    ViewFrustum viewFrustum;
+    setUpViewFrustum(viewFrustum);
+
+    OcclusionBuffer buffer;
+    AACube farCube(glm::vec3(-0.5f, -0.5f, -5.0f), 1.0f);
+    if (buffer.isOccluded(viewFrustum, farCube)) {
+        qDebug() << "FAIL: occludedTest an empty buffer occluded a cube";
+    }
+
+    // a big cube just in front of the viewer hides the whole screen
+    buffer.addOccluder(viewFrustum, AACube(glm::vec3(-2.0f, -2.0f, 4.0f), 4.0f));
+    if (buffer.getNumOccluders() != 1) {
+        qDebug() << "FAIL: occludedTest expected one occluder, got" << buffer.getNumOccluders();
+    }
+    if (!buffer.isOccluded(viewFrustum, farCube)) {
+        qDebug() << "FAIL: occludedTest a cube behind the occluder wasn't occluded";
+    }
+    AACube nearCube(glm::vec3(-0.1f, -0.1f, 9.0f), 0.2f);
+    if (buffer.isOccluded(viewFrustum, nearCube)) {
+        qDebug() << "FAIL: occludedTest a cube in front of the occluder was occluded";
+    }
+}
+
+void OcclusionBufferTests::eraseTest() {
+    ViewFrustum viewFrustum;
+    setUpViewFrustum(viewFrustum);
+
+    OcclusionBuffer buffer;
+    AACube farCube(glm::vec3(-0.5f, -0.5f, -5.0f), 1.0f);
+    buffer.addOccluder(viewFrustum, AACube(glm::vec3(-2.0f, -2.0f, 4.0f), 4.0f));
+    buffer.erase();
+    if (buffer.getNumOccluders() != 0 || buffer.isOccluded(viewFrustum, farCube)) {
+        qDebug() << "FAIL: eraseTest an erased buffer still occluded a cube";
+    }
+}
@@ -0,0 +1,351 @@
+//
+//  OctreeBenchmarks.cpp
+//  tests/octree/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#include <cmath>
+
+#include <QtCore/QDateTime>
+#include <QtCore/QDebug>
+#include <QtCore/QFile>
+#include <QtCore/QFileInfo>
+#include <QtCore/QJsonDocument>
+#include <QtCore/QJsonObject>
+#include <QtCore/QTemporaryDir>
+#include <QtCore/QVector>
+
+#include <glm/glm.hpp>
+
+#include <OctreeElementBag.h>
+#include <OctreePacketData.h>
+#include <SharedUtil.h>
+#include <ViewFrustum.h>
+#include <VoxelTree.h>
+
+#include "OctreeBenchmarks.h"
+
+// the worlds are the same from run to run, and from platform to platform, unlike with rand()
+const quint32 BENCHMARK_SEED = 0x6f637472;
+
+// the size of the voxels of the worlds, in tree units
+const float WORLD_VOXEL_SIZE = 1.0f / 1024.0f;
+
+const int TERRAIN_COLUMNS = 256;
+const int TERRAIN_DEPTH = 3;
+
+const int CITY_BLOCKS = 12;
+const int BUILDING_WIDTH = 8;
+const int STREET_WIDTH = 4;
+const int MIN_BUILDING_HEIGHT = 8;
+const int MAX_BUILDING_HEIGHT = 64;
+
+const int SPARSE_VOXELS = 100000;
+
+const int CAMERA_PATH_FRAMES = 60;
+const int RAY_PICKS = 10000;
+const int SPHERE_PICKS = 10000;
+
+/// A xorshift generator, so the worlds don't depend on the platform's rand().
+class BenchmarkRandom {
+public:
+    BenchmarkRandom(quint32 seed) : _state(seed ? seed : 1) { }
+
+    quint32 next() {
+        _state ^= _state << 13;
+        _state ^= _state >> 17;
+        _state ^= _state << 5;
+        return _state;
+    }
+
+    /// returns a value from zero up to but not including one
+    float nextFloat() { return (next() >> 8) / (float)(1 << 24); }
+
+    /// returns a value from zero up to but not including the given limit
+    int nextInt(int limit) { return (int)(next() % (quint32)limit); }
+
+private:
+    quint32 _state;
+};
+
+class BenchmarkVoxel {
+public:
+    glm::vec3 corner;
+    float size;
+    unsigned char red;
+    unsigned char green;
+    unsigned char blue;
+};
+
+static void addVoxel(QVector<BenchmarkVoxel>& voxels, int x, int y, int z,
+                     unsigned char red, unsigned char green, unsigned char blue) {
+    BenchmarkVoxel voxel;
+    voxel.corner = glm::vec3(x, y, z) * WORLD_VOXEL_SIZE;
+    voxel.size = WORLD_VOXEL_SIZE;
+    voxel.red = red;
+    voxel.green = green;
+    voxel.blue = blue;
+    voxels.append(voxel);
+}
+
+/// rolling hills, a few voxels deep, like an imported heightmap
+static void generateTerrain(BenchmarkRandom& random, QVector<BenchmarkVoxel>& voxels) {
+    for (int x = 0; x < TERRAIN_COLUMNS; x++) {
+        for (int z = 0; z < TERRAIN_COLUMNS; z++) {
+            float hills = 8.0f * sinf(x * 0.05f) * cosf(z * 0.07f) + 4.0f * sinf((x + z) * 0.13f);
+            int height = 16 + (int)hills + random.nextInt(2);
+            for (int y = qMax(height - TERRAIN_DEPTH, 0); y < height; y++) {
+                addVoxel(voxels, x, y, z, 40 + height * 2, 120 + random.nextInt(40), 40);
+            }
+        }
+    }
+}
+
+/// a grid of hollow buildings of random heights on a ground plane, like something built by hand
+static void generateCity(BenchmarkRandom& random, QVector<BenchmarkVoxel>& voxels) {
+    const int BLOCK_WIDTH = BUILDING_WIDTH + STREET_WIDTH;
+    int cityWidth = CITY_BLOCKS * BLOCK_WIDTH;
+    for (int x = 0; x < cityWidth; x++) {
+        for (int z = 0; z < cityWidth; z++) {
+            addVoxel(voxels, x, 0, z, 80, 80, 80);
+        }
+    }
+    for (int blockX = 0; blockX < CITY_BLOCKS; blockX++) {
+        for (int blockZ = 0; blockZ < CITY_BLOCKS; blockZ++) {
+            int height = MIN_BUILDING_HEIGHT + random.nextInt(MAX_BUILDING_HEIGHT - MIN_BUILDING_HEIGHT);
+            unsigned char shade = 100 + random.nextInt(100);
+            int left = blockX * BLOCK_WIDTH + STREET_WIDTH;
+            int front = blockZ * BLOCK_WIDTH + STREET_WIDTH;
+            for (int y = 1; y <= height; y++) {
+                for (int x = left; x < left + BUILDING_WIDTH; x++) {
+                    for (int z = front; z < front + BUILDING_WIDTH; z++) {
+                        bool wall = (x == left || x == left + BUILDING_WIDTH - 1 ||
+                            z == front || z == front + BUILDING_WIDTH - 1);
+                        if (wall || y == height) {
+                            addVoxel(voxels, x, y, z, shade, shade, shade + 20);
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+/// voxels scattered through the whole tree, the worst case for the octal codes and the pointers between elements
+static void generateSparse(BenchmarkRandom& random, QVector<BenchmarkVoxel>& voxels) {
+    const int VOXELS_PER_SIDE = (int)(1.0f / WORLD_VOXEL_SIZE);
+    for (int i = 0; i < SPARSE_VOXELS; i++) {
+        addVoxel(voxels, random.nextInt(VOXELS_PER_SIDE), random.nextInt(VOXELS_PER_SIDE),
+            random.nextInt(VOXELS_PER_SIDE), random.nextInt(256), random.nextInt(256), random.nextInt(256));
+    }
+}
+
+static double perSecond(int count, quint64 usecs) {
+    return count * (double)USECS_PER_SECOND / qMax(usecs, (quint64)1);
+}
+
+/// sets the frustum to look at the center of the world from the given angle around it
+static void setCameraOnPath(ViewFrustum& viewFrustum, const glm::vec3& center, float radius, float angle) {
+    glm::vec3 position = center + glm::vec3(radius * cosf(angle), radius * 0.5f, radius * sinf(angle));
+    viewFrustum.setPosition(position);
+    viewFrustum.setOrientation(rotationBetween(glm::vec3(0.0f, 0.0f, -1.0f), glm::normalize(center - position)));
+    viewFrustum.setFieldOfView(DEFAULT_FIELD_OF_VIEW_DEGREES);
+    viewFrustum.setAspectRatio(16.0f / 9.0f);
+    viewFrustum.setNearClip(DEFAULT_NEAR_CLIP / TREE_SCALE);
+    viewFrustum.setFarClip(DEFAULT_FAR_CLIP / TREE_SCALE);
+    viewFrustum.calculate();
+}
+
+/// encodes the scene as the octree server would for a new client at each point of the path
+static void benchmarkEncode(VoxelTree& tree, const glm::vec3& center, float radius, QJsonObject& results) {
+    OctreePacketData packetData;
+    quint64 totalUsecs = 0;
+    int totalPackets = 0;
+    qint64 totalBytes = 0;
+    for (int frame = 0; frame < CAMERA_PATH_FRAMES; frame++) {
+        ViewFrustum viewFrustum;
+        setCameraOnPath(viewFrustum, center, radius, frame * TWO_PI / CAMERA_PATH_FRAMES);
+
+        quint64 start = usecMonotonicNow();
+        OctreeElementBag bag;
+        bag.setViewFrustum(&viewFrustum);
+        bag.insert(tree.getRoot());
+        packetData.reset();
+        while (!bag.isEmpty()) {
+            OctreeElement* subTree = bag.extract();
+            EncodeBitstreamParams params(INT_MAX, &viewFrustum);
+            int bytesWritten = tree.encodeTreeBitstream(subTree, &packetData, bag, params);
+            if (bytesWritten == 0 && params.stopReason == EncodeBitstreamParams::DIDNT_FIT) {
+                if (!packetData.hasContent()) {
+                    break;
+                }
+                totalPackets++;
+                totalBytes += packetData.getFinalizedSize();
+                packetData.reset();
+                bag.insert(subTree);
+            }
+        }
+        if (packetData.hasContent()) {
+            totalPackets++;
+            totalBytes += packetData.getFinalizedSize();
+        }
+        totalUsecs += usecMonotonicNow() - start;
+    }
+    results["encodeUsecsPerFrame"] = (double)totalUsecs / CAMERA_PATH_FRAMES;
+    results["encodePacketsPerFrame"] = (double)totalPackets / CAMERA_PATH_FRAMES;
+    results["encodeBytesPerFrame"] = (double)totalBytes / CAMERA_PATH_FRAMES;
+}
+
+static void benchmarkPicks(VoxelTree& tree, const QVector<BenchmarkVoxel>& voxels, const glm::vec3& center,
+                           float radius, QJsonObject& results) {
+    BenchmarkRandom random(BENCHMARK_SEED);
+    int rayHits = 0;
+    quint64 start = usecMonotonicNow();
+    for (int i = 0; i < RAY_PICKS; i++) {
+        // from around the camera path toward one of the voxels, so that most of them hit something
+        float angle = random.nextFloat() * TWO_PI;
+        glm::vec3 origin = center + glm::vec3(radius * cosf(angle), radius * 0.5f, radius * sinf(angle));
+        const BenchmarkVoxel& target = voxels.at(random.nextInt(voxels.size()));
+        glm::vec3 direction = glm::normalize(target.corner + glm::vec3(target.size * 0.5f) - origin);
+
+        OctreeElement* element;
+        float distance;
+        BoxFace face;
+        if (tree.findRayIntersection(origin, direction, element, distance, face, NULL, Octree::Lock)) {
+            rayHits++;
+        }
+    }
+    quint64 rayUsecs = usecMonotonicNow() - start;
+    results["rayUsecsPerPick"] = (double)rayUsecs / RAY_PICKS;
+    results["rayHits"] = rayHits;
+
+    int spherePenetrations = 0;
+    start = usecMonotonicNow();
+    for (int i = 0; i < SPHERE_PICKS; i++) {
+        // near one of the voxels, so that about half of them touch it
+        const BenchmarkVoxel& target = voxels.at(random.nextInt(voxels.size()));
+        glm::vec3 offset = glm::vec3(random.nextFloat(), random.nextFloat(), random.nextFloat()) * 4.0f - 2.0f;
+        glm::vec3 sphereCenter = target.corner + target.size * (glm::vec3(0.5f) + offset);
+
+        glm::vec3 penetration;
+        if (tree.findSpherePenetration(sphereCenter, target.size * 2.0f, penetration, NULL, Octree::Lock)) {
+            spherePenetrations++;
+        }
+    }
+    quint64 sphereUsecs = usecMonotonicNow() - start;
+    results["sphereUsecsPerPick"] = (double)sphereUsecs / SPHERE_PICKS;
+    results["spherePenetrations"] = spherePenetrations;
+}
+
+static QJsonObject benchmarkWorld(const QString& name, const QVector<BenchmarkVoxel>& voxels,
+                                  const QString& workingPath) {
+    QJsonObject results;
+    results["voxels"] = voxels.size();
+
+    glm::vec3 minimum = voxels.at(0).corner;
+    glm::vec3 maximum = voxels.at(0).corner;
+    foreach (const BenchmarkVoxel& voxel, voxels) {
+        minimum = glm::min(minimum, voxel.corner);
+        maximum = glm::max(maximum, voxel.corner + glm::vec3(voxel.size));
+    }
+    glm::vec3 center = (minimum + maximum) * 0.5f;
+    float radius = glm::length(maximum - minimum);
+
+    unsigned long elementsBefore = OctreeElement::getNodeCount();
+    quint64 memoryBefore = OctreeElement::getTotalMemoryUsage();
+    QString fileName = workingPath + "/" + name + ".svo";
+    {
+        VoxelTree tree;
+        quint64 start = usecMonotonicNow();
+        foreach (const BenchmarkVoxel& voxel, voxels) {
+            tree.createVoxel(voxel.corner.x, voxel.corner.y, voxel.corner.z, voxel.size,
+                voxel.red, voxel.green, voxel.blue);
+        }
+        quint64 insertUsecs = usecMonotonicNow() - start;
+        results["insertUsecs"] = (double)insertUsecs;
+        results["insertsPerSecond"] = perSecond(voxels.size(), insertUsecs);
+
+        int elements = (int)(OctreeElement::getNodeCount() - elementsBefore);
+        qint64 memory = (qint64)(OctreeElement::getTotalMemoryUsage() - memoryBefore);
+        results["elements"] = elements;
+        results["memoryBytes"] = (double)memory;
+        results["bytesPerElement"] = (double)memory / qMax(elements, 1);
+
+        start = usecMonotonicNow();
+        tree.writeToSVOFile(fileName.toLocal8Bit().constData());
+        results["writeSVOUsecs"] = (double)(usecMonotonicNow() - start);
+        results["svoFileBytes"] = (double)QFileInfo(fileName).size();
+
+        benchmarkEncode(tree, center, radius, results);
+        benchmarkPicks(tree, voxels, center, radius, results);
+
+        start = usecMonotonicNow();
+        foreach (const BenchmarkVoxel& voxel, voxels) {
+            tree.deleteVoxelAt(voxel.corner.x, voxel.corner.y, voxel.corner.z, voxel.size);
+        }
+        quint64 deleteUsecs = usecMonotonicNow() - start;
+        results["deleteUsecs"] = (double)deleteUsecs;
+        results["deletesPerSecond"] = perSecond(voxels.size(), deleteUsecs);
+        results["elementsAfterDelete"] = (int)(OctreeElement::getNodeCount() - elementsBefore);
+    }
+    {
+        VoxelTree tree;
+        unsigned long elementsBeforeRead = OctreeElement::getNodeCount();
+        quint64 start = usecMonotonicNow();
+        tree.readFromSVOFile(fileName.toLocal8Bit().constData());
+        results["readSVOUsecs"] = (double)(usecMonotonicNow() - start);
+        results["readElements"] = (int)(OctreeElement::getNodeCount() - elementsBeforeRead);
+    }
+    QFile::remove(fileName);
+
+    qDebug() << qPrintable(name) << voxels.size() << "voxels:"
+        << results["insertsPerSecond"].toDouble() << "inserts/sec,"
+        << results["bytesPerElement"].toDouble() << "bytes/element,"
+        << results["encodeUsecsPerFrame"].toDouble() << "usecs/encoded frame,"
+        << results["rayUsecsPerPick"].toDouble() << "usecs/ray,"
+        << results["sphereUsecsPerPick"].toDouble() << "usecs/sphere";
+    return results;
+}
+
+bool OctreeBenchmarks::runAllBenchmarks(const QString& resultsFileName) {
+    QTemporaryDir workingDirectory;
+    if (!workingDirectory.isValid()) {
+        qDebug() << "FAIL: couldn't make a directory for the SVO files";
+        return false;
+    }
+    BenchmarkRandom random(BENCHMARK_SEED);
+    QJsonObject worlds;
+    {
+        QVector<BenchmarkVoxel> voxels;
+        generateTerrain(random, voxels);
+        worlds["terrain"] = benchmarkWorld("terrain", voxels, workingDirectory.path());
+    }
+    {
+        QVector<BenchmarkVoxel> voxels;
+        generateCity(random, voxels);
+        worlds["city"] = benchmarkWorld("city", voxels, workingDirectory.path());
+    }
+    {
+        QVector<BenchmarkVoxel> voxels;
+        generateSparse(random, voxels);
+        worlds["sparse"] = benchmarkWorld("sparse", voxels, workingDirectory.path());
+    }
+
+    QJsonObject results;
+    results["timestamp"] = QDateTime::currentDateTimeUtc().toString(Qt::ISODate);
+    results["seed"] = (double)BENCHMARK_SEED;
+    results["worlds"] = worlds;
+
+    QFile resultsFile(resultsFileName);
+    if (!resultsFile.open(QIODevice::WriteOnly)) {
+        qDebug() << "FAIL: couldn't write the benchmark results to" << resultsFileName;
+        return false;
+    }
+    resultsFile.write(QJsonDocument(results).toJson());
+    qDebug() << "Wrote the benchmark results to" << resultsFileName;
+    return true;
+}
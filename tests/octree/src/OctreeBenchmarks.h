@@ -0,0 +1,27 @@
+//
+//  OctreeBenchmarks.h
+//  tests/octree/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#ifndef hifi_OctreeBenchmarks_h
+#define hifi_OctreeBenchmarks_h
+
+#include <QtCore/QString>
+
+/// Times the voxel tree on synthetic worlds - a terrain, a city and random sparse voxels - generated from a fixed seed,
+/// so that runs of different builds can be compared: inserting and deleting voxels, writing and reading them as SVO
+/// files, encoding them for a camera moving along a path, picking rays and spheres against them, and the memory they
+/// take per element.
+namespace OctreeBenchmarks {
+
+    /// runs the benchmarks on each of the worlds and writes the results to the given file as JSON; returns false if the
+    /// file couldn't be written
+    bool runAllBenchmarks(const QString& resultsFileName);
+}
+
+#endif // hifi_OctreeBenchmarks_h
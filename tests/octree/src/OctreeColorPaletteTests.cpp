@@ -0,0 +1,90 @@
+//
+//  OctreeColorPaletteTests.cpp
+//  tests/octree/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#include <cstring>
+
+#include <QDebug>
+
+#include <OctreeColorPalette.h>
+
+#include "OctreeColorPaletteTests.h"
+
+void OctreeColorPaletteTests::runAllTests() {
+    varintTest();
+    paletteTest();
+}
+
+void OctreeColorPaletteTests::varintTest() {
+    const quint32 VALUES[] = { 0, 1, 127, 128, 300, 16383, 16384, 0xFFFFFFFF };
+    const int BYTES[] = { 1, 1, 1, 2, 2, 2, 3, 5 };
+    const int NUM_VALUES = sizeof(VALUES) / sizeof(VALUES[0]);
+
+    for (int i = 0; i < NUM_VALUES; i++) {
+        unsigned char buffer[MAX_VARINT_BYTES];
+        int bytesWritten = OctreeColorPalette::writeVarint(VALUES[i], buffer);
+        if (bytesWritten != BYTES[i]) {
+            qDebug() << "FAIL: varintTest" << VALUES[i] << "took" << bytesWritten << "bytes, expected" << BYTES[i];
+        }
+        quint32 value;
+        int bytesRead = OctreeColorPalette::readVarint(buffer, bytesWritten, value);
+        if (bytesRead != bytesWritten || value != VALUES[i]) {
+            qDebug() << "FAIL: varintTest" << VALUES[i] << "read back as" << value;
+        }
+
+        // a varint cut short can't be read
+        if (bytesWritten > 1 && OctreeColorPalette::readVarint(buffer, bytesWritten - 1, value) != 0) {
+            qDebug() << "FAIL: varintTest" << VALUES[i] << "was read from a short buffer";
+        }
+    }
+}
+
+void OctreeColorPaletteTests::paletteTest() {
+    OctreeColorPalette palette;
+    nodeColor red = { 255, 0, 0, 1 };
+    nodeColor green = { 0, 255, 0, 1 };
+    nodeColor blue = { 0, 0, 255, 1 };
+
+    if (palette.indexOf(red) != 0 || palette.indexOf(green) != 1 || palette.indexOf(red) != 0 ||
+            palette.indexOf(blue) != 2 || palette.getCount() != 3) {
+        qDebug() << "FAIL: paletteTest colors weren't indexed in the order they were first seen";
+    }
+
+    // enough colors that the count takes two bytes
+    for (int i = 0; i < 200; i++) {
+        nodeColor gray = { (unsigned char)i, (unsigned char)i, (unsigned char)i, 1 };
+        palette.indexOf(gray);
+    }
+
+    QByteArray data = palette.toByteArray();
+    OctreeColorPalette readPalette;
+    int bytesRead = readPalette.readFromBuffer((const unsigned char*)data.constData(), data.size());
+    if (bytesRead != data.size() || readPalette.getCount() != palette.getCount()) {
+        qDebug() << "FAIL: paletteTest read" << bytesRead << "of" << data.size() << "bytes and"
+            << readPalette.getCount() << "of" << palette.getCount() << "colors";
+    }
+    for (int i = 0; i < palette.getCount(); i++) {
+        nodeColor color, readColor;
+        if (!palette.getColor(i, color) || !readPalette.getColor(i, readColor) || memcmp(color, readColor, 3) != 0) {
+            qDebug() << "FAIL: paletteTest color" << i << "didn't survive the round trip";
+        }
+    }
+    nodeColor color;
+    if (readPalette.getColor(palette.getCount(), color) || readPalette.getColor(-1, color)) {
+        qDebug() << "FAIL: paletteTest found a color past the palette";
+    }
+    if (readPalette.indexOf(blue) != 2) {
+        qDebug() << "FAIL: paletteTest read palette didn't index its colors";
+    }
+
+    // a palette that claims more colors than it holds is rejected
+    if (readPalette.readFromBuffer((const unsigned char*)data.constData(), data.size() - 1) != 0) {
+        qDebug() << "FAIL: paletteTest read a palette that was cut short";
+    }
+}
@@ -0,0 +1,22 @@
+//
+//  OctreeColorPaletteTests.h
+//  tests/octree/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#ifndef hifi_OctreeColorPaletteTests_h
+#define hifi_OctreeColorPaletteTests_h
+
+namespace OctreeColorPaletteTests {
+
+    void runAllTests();
+    
+    void varintTest();
+    void paletteTest();
+}
+
+#endif // hifi_OctreeColorPaletteTests_h
@@ -0,0 +1,87 @@
+//
+//  OctreeDeletedIDLogTests.cpp
+//  tests/octree/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#include <cstring>
+
+#include <QDebug>
+
+#include <OctreeDeletedIDLog.h>
+
+#include "OctreeDeletedIDLogTests.h"
+
+void OctreeDeletedIDLogTests::runAllTests() {
+    cursorTest();
+    boundedTest();
+}
+
+void OctreeDeletedIDLogTests::cursorTest() {
+    OctreeDeletedIDLog log;
+    quint64 cursor = 0;
+    if (!log.isEmpty() || log.hasDeletedSince(cursor)) {
+        qDebug() << "FAIL: cursorTest a new log had deletions";
+    }
+
+    const int NUM_IDS = 200;
+    for (uint32_t id = 0; id < NUM_IDS; id++) {
+        log.append(id);
+    }
+
+    // the IDs come out in the order they were deleted, a packet's worth at a time
+    const int IDS_PER_COPY = 64;
+    unsigned char buffer[IDS_PER_COPY * sizeof(uint32_t)];
+    uint32_t expectedID = 0;
+    while (log.hasDeletedSince(cursor)) {
+        int idsCopied = log.copyDeletedSince(cursor, buffer, IDS_PER_COPY);
+        for (int i = 0; i < idsCopied; i++) {
+            uint32_t id;
+            memcpy(&id, buffer + i * sizeof(id), sizeof(id));
+            if (id != expectedID) {
+                qDebug() << "FAIL: cursorTest copied ID" << id << "expected" << expectedID;
+            }
+            expectedID++;
+        }
+        if (idsCopied == 0) {
+            qDebug() << "FAIL: cursorTest copied nothing with deletions left";
+            break;
+        }
+    }
+    if (expectedID != NUM_IDS || cursor != NUM_IDS) {
+        qDebug() << "FAIL: cursorTest copied" << expectedID << "IDs up to cursor" << cursor << "expected" << NUM_IDS;
+    }
+
+    // a client that has only been sent some keeps the rest once the others are forgotten
+    quint64 laggingCursor = NUM_IDS - 1;
+    log.forgetDeletedBefore(laggingCursor);
+    log.append(NUM_IDS);
+    uint32_t ids[2];
+    if (log.copyDeletedSince(laggingCursor, (unsigned char*)ids, 2) != 2 || ids[0] != NUM_IDS - 1 || ids[1] != NUM_IDS) {
+        qDebug() << "FAIL: cursorTest forgot deletions a client hadn't been sent";
+    }
+
+    log.forgetDeletedBefore(laggingCursor);
+    if (!log.isEmpty() || log.hasDeletedSince(laggingCursor)) {
+        qDebug() << "FAIL: cursorTest kept deletions every client had been sent";
+    }
+}
+
+void OctreeDeletedIDLogTests::boundedTest() {
+    OctreeDeletedIDLog log;
+    const int IDS_DROPPED = 10;
+    for (uint32_t id = 0; id < MAX_DELETED_IDS_LOGGED + IDS_DROPPED; id++) {
+        log.append(id);
+    }
+
+    // a client that fell behind the log starts from the oldest deletion it kept
+    quint64 cursor = 0;
+    uint32_t id;
+    if (log.copyDeletedSince(cursor, (unsigned char*)&id, 1) != 1 || id != IDS_DROPPED || cursor != IDS_DROPPED + 1) {
+        qDebug() << "FAIL: boundedTest didn't drop the oldest deletions past the most it keeps";
+    }
+}
@@ -0,0 +1,22 @@
+//
+//  OctreeDeletedIDLogTests.h
+//  tests/octree/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#ifndef hifi_OctreeDeletedIDLogTests_h
+#define hifi_OctreeDeletedIDLogTests_h
+
+namespace OctreeDeletedIDLogTests {
+
+    void runAllTests();
+    
+    void cursorTest();
+    void boundedTest();
+}
+
+#endif // hifi_OctreeDeletedIDLogTests_h
@@ -0,0 +1,125 @@
+//
+//  OctreeElementBagTests.cpp
+//  tests/octree/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#include <QDebug>
+#include <QList>
+
+#include <ModelTree.h>
+#include <OctreeElementBag.h>
+#include <ViewFrustum.h>
+
+#include "OctreeElementBagTests.h"
+
+void OctreeElementBagTests::runAllTests() {
+    sizeOrderTest();
+    viewOrderTest();
+    removeTest();
+}
+
+/// makes elements of a scattering of sizes, returning them in the order they were made
+static QList<OctreeElement*> populateTree(ModelTree& tree) {
+    QList<OctreeElement*> elements;
+    const int NUM_ELEMENTS = 40;
+    const float SIZES[] = { 1.0f / 4.0f, 1.0f / 16.0f, 1.0f / 64.0f };
+    for (int i = 0; i < NUM_ELEMENTS; i++) {
+        float s = SIZES[i % 3];
+        float x = (i * 7 % 4) / 4.0f;
+        float y = (i * 5 % 4) / 4.0f;
+        float z = (i * 3 % 4) / 4.0f;
+        OctreeElement* element = tree.getOrCreateChildElementAt(x, y, z, s);
+        if (!elements.contains(element)) {
+            elements.append(element);
+        }
+    }
+    return elements;
+}
+
+void OctreeElementBagTests::sizeOrderTest() {
+    ModelTree tree;
+    QList<OctreeElement*> elements = populateTree(tree);
+
+    OctreeElementBag bag;
+    foreach (OctreeElement* element, elements) {
+        bag.insert(element);
+        bag.insert(element);
+    }
+    if (bag.count() != elements.size()) {
+        qDebug() << "FAIL: sizeOrderTest bag holds" << bag.count() << "elements, expected" << elements.size();
+    }
+
+    float lastScale = 2.0f;
+    int extracted = 0;
+    while (!bag.isEmpty()) {
+        OctreeElement* element = bag.extract();
+        if (element->getScale() > lastScale) {
+            qDebug() << "FAIL: sizeOrderTest extracted scale" << element->getScale() << "after" << lastScale;
+        }
+        lastScale = element->getScale();
+        extracted++;
+    }
+    if (extracted != elements.size()) {
+        qDebug() << "FAIL: sizeOrderTest extracted" << extracted << "elements, expected" << elements.size();
+    }
+}
+
+void OctreeElementBagTests::viewOrderTest() {
+    ModelTree tree;
+    OctreeElement* near = tree.getOrCreateChildElementAt(0.0f, 0.0f, 0.0f, 1.0f / 16.0f);
+    OctreeElement* far = tree.getOrCreateChildElementAt(0.75f, 0.75f, 0.75f, 1.0f / 16.0f);
+    OctreeElement* bigFar = tree.getOrCreateChildElementAt(0.5f, 0.5f, 0.5f, 1.0f / 2.0f);
+
+    ViewFrustum viewFrustum;
+    viewFrustum.setPosition(glm::vec3(0.0f, 0.0f, 0.0f));
+
+    OctreeElementBag bag;
+    bag.setViewFrustum(&viewFrustum);
+    bag.insert(far);
+    bag.insert(near);
+    bag.insert(bigFar);
+
+    OctreeElement* first = bag.extract();
+    OctreeElement* second = bag.extract();
+    OctreeElement* third = bag.extract();
+    // the near element spans a wider angle than the big one further off
+    if (first != near || second != bigFar || third != far) {
+        qDebug() << "FAIL: viewOrderTest extracted the elements out of order";
+    }
+}
+
+void OctreeElementBagTests::removeTest() {
+    ModelTree tree;
+    QList<OctreeElement*> elements = populateTree(tree);
+
+    OctreeElementBag bag;
+    foreach (OctreeElement* element, elements) {
+        bag.insert(element);
+    }
+    QList<OctreeElement*> removed;
+    for (int i = 0; i < elements.size(); i += 3) {
+        bag.remove(elements.at(i));
+        removed.append(elements.at(i));
+    }
+    if (bag.count() != elements.size() - removed.size()) {
+        qDebug() << "FAIL: removeTest bag holds" << bag.count() << "elements, expected"
+            << elements.size() - removed.size();
+    }
+
+    float lastScale = 2.0f;
+    while (!bag.isEmpty()) {
+        OctreeElement* element = bag.extract();
+        if (removed.contains(element)) {
+            qDebug() << "FAIL: removeTest extracted an element that was removed";
+        }
+        if (element->getScale() > lastScale) {
+            qDebug() << "FAIL: removeTest extracted scale" << element->getScale() << "after" << lastScale;
+        }
+        lastScale = element->getScale();
+    }
+}
@@ -0,0 +1,93 @@
+//
+//  OctreeEncodeCacheTests.cpp
+//  tests/octree/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#include <QDebug>
+
+#include <ModelTree.h>
+#include <OctreeEncodeCache.h>
+
+#include "OctreeEncodeCacheTests.h"
+
+void OctreeEncodeCacheTests::runAllTests() {
+    findTest();
+    changeTest();
+    descendantChangeTest();
+}
+
+const unsigned char ENCODED[] = { 0x80, 1, 2, 3, 0x00 };
+const unsigned char COLOR_AND_EXISTS_FLAGS = 3;
+
+void OctreeEncodeCacheTests::findTest() {
+    ModelTree tree;
+    OctreeElement* element = tree.getOrCreateChildElementAt(0.0f, 0.0f, 0.0f, 1.0f / 4.0f);
+
+    OctreeEncodeCache cache;
+    QByteArray encoded;
+    if (cache.find(element, 2, COLOR_AND_EXISTS_FLAGS, encoded)) {
+        qDebug() << "FAIL: findTest an empty cache found an encoding";
+    }
+    cache.insert(element, 2, COLOR_AND_EXISTS_FLAGS, ENCODED, sizeof(ENCODED));
+    if (!cache.find(element, 2, COLOR_AND_EXISTS_FLAGS, encoded) ||
+            encoded != QByteArray(reinterpret_cast<const char*>(ENCODED), sizeof(ENCODED))) {
+        qDebug() << "FAIL: findTest didn't find the encoding that was kept";
+    }
+    if (cache.find(element, 3, COLOR_AND_EXISTS_FLAGS, encoded)) {
+        qDebug() << "FAIL: findTest found an encoding for another level of detail";
+    }
+    if (cache.find(element, 2, 0, encoded)) {
+        qDebug() << "FAIL: findTest found an encoding made with other flags";
+    }
+    if (cache.getNumHits() != 1 || cache.getNumMisses() != 3) {
+        qDebug() << "FAIL: findTest counted" << cache.getNumHits() << "hits and" << cache.getNumMisses() << "misses";
+    }
+}
+
+void OctreeEncodeCacheTests::changeTest() {
+    ModelTree tree;
+    OctreeElement* element = tree.getOrCreateChildElementAt(0.0f, 0.0f, 0.0f, 1.0f / 4.0f);
+
+    OctreeEncodeCache cache;
+    cache.insert(element, 2, COLOR_AND_EXISTS_FLAGS, ENCODED, sizeof(ENCODED));
+
+    quint64 lastChanged = element->getLastChanged();
+    while (element->getLastChanged() == lastChanged) {
+        element->markWithChangedTime();
+    }
+    QByteArray encoded;
+    if (cache.find(element, 2, COLOR_AND_EXISTS_FLAGS, encoded)) {
+        qDebug() << "FAIL: changeTest found an encoding of the element from before it changed";
+    }
+}
+
+void OctreeEncodeCacheTests::descendantChangeTest() {
+    ModelTree tree;
+    OctreeElement* element = tree.getOrCreateChildElementAt(0.0f, 0.0f, 0.0f, 1.0f / 4.0f);
+    OctreeElement* descendant = tree.getOrCreateChildElementAt(0.0f, 0.0f, 0.0f, 1.0f / 16.0f);
+
+    OctreeEncodeCache cache;
+    cache.insert(element, 2, COLOR_AND_EXISTS_FLAGS, ENCODED, sizeof(ENCODED));
+
+    quint64 lastChanged = element->getLastChanged();
+    quint64 lastChangedInSubtree = element->getLastChangedInSubtree();
+    while (descendant->getLastChanged() <= lastChangedInSubtree) {
+        descendant->markWithChangedTime();
+    }
+    if (element->getLastChanged() != lastChanged) {
+        qDebug() << "FAIL: descendantChangeTest changing a descendant changed the element itself";
+    }
+    if (!element->hasChangedInSubtreeSince(lastChangedInSubtree) ||
+            !tree.getRoot()->hasChangedInSubtreeSince(lastChangedInSubtree)) {
+        qDebug() << "FAIL: descendantChangeTest the change of a descendant didn't reach its ancestors";
+    }
+    QByteArray encoded;
+    if (cache.find(element, 2, COLOR_AND_EXISTS_FLAGS, encoded)) {
+        qDebug() << "FAIL: descendantChangeTest found an encoding of the element from before a descendant changed";
+    }
+}
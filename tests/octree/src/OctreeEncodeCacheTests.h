@@ -0,0 +1,23 @@
+//
+//  OctreeEncodeCacheTests.h
+//  tests/octree/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#ifndef hifi_OctreeEncodeCacheTests_h
+#define hifi_OctreeEncodeCacheTests_h
+
+namespace OctreeEncodeCacheTests {
+
+    void runAllTests();
+    
+    void findTest();
+    void changeTest();
+    void descendantChangeTest();
+}
+
+#endif // hifi_OctreeEncodeCacheTests_h
@@ -0,0 +1,113 @@
+//
+//  OctreeExportTests.cpp
+//  tests/octree/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#include <QDebug>
+#include <QFile>
+#include <QTemporaryDir>
+
+#include <OctalCode.h>
+#include <OctreePacketData.h>
+#include <VoxelTree.h>
+
+#include "OctreeExportTests.h"
+
+const float EXPORT_TEST_VOXEL_SIZE = 1.0f / 64.0f;
+const int EXPORT_TEST_VOXELS_PER_SIDE = 8;
+
+/// fills the octant of the tree nearest the origin with a cube of small voxels of varying colors
+static void fillTestTree(VoxelTree& tree) {
+    for (int x = 0; x < EXPORT_TEST_VOXELS_PER_SIDE; x++) {
+        for (int y = 0; y < EXPORT_TEST_VOXELS_PER_SIDE; y++) {
+            for (int z = 0; z < EXPORT_TEST_VOXELS_PER_SIDE; z++) {
+                tree.createVoxel(x * EXPORT_TEST_VOXEL_SIZE, y * EXPORT_TEST_VOXEL_SIZE, z * EXPORT_TEST_VOXEL_SIZE,
+                    EXPORT_TEST_VOXEL_SIZE, x * 30, y * 30, z * 30);
+            }
+        }
+    }
+}
+
+void OctreeExportTests::runAllTests() {
+    rebasedChunksTest();
+    cancelExportTest();
+}
+
+void OctreeExportTests::rebasedChunksTest() {
+    VoxelTree tree;
+    fillTestTree(tree);
+
+    // the voxel enclosing the cube, rebased to the root as an export does
+    const float ENCLOSING_SIZE = EXPORT_TEST_VOXEL_SIZE * EXPORT_TEST_VOXELS_PER_SIDE;
+    VoxelTreeElement* selected = tree.getVoxelAt(0.0f, 0.0f, 0.0f, ENCLOSING_SIZE);
+    if (!selected) {
+        qDebug() << "FAIL: rebasedChunksTest couldn't find the enclosing voxel";
+        return;
+    }
+    int chopLevels = numberOfThreeBitSectionsInCode(selected->getOctalCode());
+
+    VoxelTree copiedTree;
+    tree.copySubTreeIntoNewTree(selected, &copiedTree, true);
+
+    QVector<QByteArray> chunks;
+    if (!tree.encodeSubtreeToChunks(selected, MAX_OCTREE_PACKET_DATA_SIZE, chunks, chopLevels) || chunks.isEmpty()) {
+        qDebug() << "FAIL: rebasedChunksTest couldn't encode the subtree";
+        return;
+    }
+    VoxelTree chunkTree;
+    foreach (const QByteArray& chunk, chunks) {
+        ReadBitstreamToTreeParams args(WANT_COLOR, NO_EXISTS_BITS, NULL, 0, SharedNodePointer(), false,
+            chunkTree.expectedVersion());
+        chunkTree.readBitstreamToTree(reinterpret_cast<const unsigned char*>(chunk.constData()), chunk.size(), args);
+    }
+    if (chunkTree.getOctreeElementsCount() != copiedTree.getOctreeElementsCount()) {
+        qDebug() << "FAIL: rebasedChunksTest chunks read back as" << chunkTree.getOctreeElementsCount()
+            << "elements, the copy has" << copiedTree.getOctreeElementsCount();
+    }
+
+    // scaled up by the levels chopped, the far corner of the cube is the far corner of the tree
+    const float REBASED_SIZE = EXPORT_TEST_VOXEL_SIZE / ENCLOSING_SIZE;
+    VoxelTreeElement* corner = chunkTree.getVoxelAt(1.0f - REBASED_SIZE, 1.0f - REBASED_SIZE, 1.0f - REBASED_SIZE,
+        REBASED_SIZE);
+    const unsigned char LAST_COLOR = (EXPORT_TEST_VOXELS_PER_SIDE - 1) * 30;
+    if (!corner || corner->getColor()[0] != LAST_COLOR || corner->getColor()[2] != LAST_COLOR) {
+        qDebug() << "FAIL: rebasedChunksTest the far corner voxel wasn't rebased";
+    }
+}
+
+void OctreeExportTests::cancelExportTest() {
+    QTemporaryDir directory;
+    if (!directory.isValid()) {
+        qDebug() << "FAIL: cancelExportTest couldn't make a directory for the SVO files";
+        return;
+    }
+    QString fileName = directory.path() + "/export.svo";
+
+    VoxelTree tree;
+    fillTestTree(tree);
+
+    // a cancel made before the export gets going still stops it, and leaves no file behind
+    tree.cancelExport();
+    if (tree.writeToSVOFile(fileName.toLocal8Bit().constData()) || QFile::exists(fileName)) {
+        qDebug() << "FAIL: cancelExportTest a canceled export was written";
+    }
+    if (!tree.isExportCanceled()) {
+        qDebug() << "FAIL: cancelExportTest the cancel was cleared by the export it stopped";
+    }
+
+    tree.setExportCanceled(false);
+    if (!tree.writeToSVOFile(fileName.toLocal8Bit().constData())) {
+        qDebug() << "FAIL: cancelExportTest the export failed once the cancel was cleared";
+    }
+    VoxelTree readTree;
+    if (!readTree.readFromSVOFile(fileName.toLocal8Bit().constData()) ||
+            readTree.getOctreeElementsCount() != tree.getOctreeElementsCount()) {
+        qDebug() << "FAIL: cancelExportTest the export read back as" << readTree.getOctreeElementsCount()
+            << "elements, not" << tree.getOctreeElementsCount();
+    }
+}
@@ -0,0 +1,22 @@
+//
+//  OctreeExportTests.h
+//  tests/octree/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#ifndef hifi_OctreeExportTests_h
+#define hifi_OctreeExportTests_h
+
+namespace OctreeExportTests {
+
+    void runAllTests();
+    
+    void rebasedChunksTest();
+    void cancelExportTest();
+}
+
+#endif // hifi_OctreeExportTests_h
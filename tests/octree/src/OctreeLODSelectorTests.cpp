@@ -0,0 +1,101 @@
+//
+//  OctreeLODSelectorTests.cpp
+//  tests/octree/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#include <cmath>
+
+#include <QDebug>
+
+#include <OctreeConstants.h>
+#include <OctreeLODSelector.h>
+#include <SharedUtil.h>
+
+#include "OctreeLODSelectorTests.h"
+
+void OctreeLODSelectorTests::runAllTests() {
+    sizeScaleTest();
+    budgetTest();
+}
+
+void OctreeLODSelectorTests::sizeScaleTest() {
+    OctreeLODSelector selector;
+
+    // a 90 degree view 1000 pixels high has 500 pixels to the radian
+    float sizeScale = selector.getSizeScale(90.0f, 1000.0f);
+    float expected = 2.0f * TREE_SCALE * 500.0f / DEFAULT_LOD_PIXEL_ERROR;
+    if (fabsf(sizeScale - expected) > expected * 0.001f) {
+        qDebug() << "FAIL: sizeScaleTest size scale" << sizeScale << "expected" << expected;
+    }
+
+    // twice the pixels to the radian needs twice the distance for the same error
+    if (fabsf(selector.getSizeScale(90.0f, 2000.0f) - 2.0f * sizeScale) > sizeScale * 0.001f) {
+        qDebug() << "FAIL: sizeScaleTest size scale didn't follow the viewport height";
+    }
+
+    selector.setSizeScale(DEFAULT_OCTREE_SIZE_SCALE, 60.0f, 800.0f);
+    float roundTrip = selector.getSizeScale(60.0f, 800.0f);
+    if (fabsf(roundTrip - DEFAULT_OCTREE_SIZE_SCALE) > DEFAULT_OCTREE_SIZE_SCALE * 0.001f) {
+        qDebug() << "FAIL: sizeScaleTest size scale" << roundTrip << "didn't survive the round trip";
+    }
+
+    selector.setPixelError(MAX_LOD_PIXEL_ERROR * 10.0f);
+    if (selector.getPixelError() != MAX_LOD_PIXEL_ERROR) {
+        qDebug() << "FAIL: sizeScaleTest pixel error" << selector.getPixelError() << "wasn't clamped";
+    }
+}
+
+// feeds the selector a second's worth of frames that each take a frame time, returns how many times it changed
+static int runFrames(OctreeLODSelector& selector, float frameTime, quint64& now) {
+    int changes = 0;
+    const int FRAMES = 60;
+    for (int i = 0; i < FRAMES; i++) {
+        now += USECS_PER_SECOND / FRAMES;
+        if (selector.update(frameTime, now)) {
+            changes++;
+        }
+    }
+    return changes;
+}
+
+void OctreeLODSelectorTests::budgetTest() {
+    const float BUDGET = 10000.0f;
+    quint64 now = 0;
+    OctreeLODSelector selector;
+    selector.setFrameTimeBudget(BUDGET);
+    selector.reset(now);
+
+    // inside the band the error is left alone
+    for (int i = 0; i < 10; i++) {
+        if (runFrames(selector, BUDGET * 0.95f, now) != 0) {
+            qDebug() << "FAIL: budgetTest changed the error while inside the band";
+            break;
+        }
+    }
+
+    // over the budget it rises promptly
+    float pixelError = selector.getPixelError();
+    runFrames(selector, BUDGET * 1.5f, now);
+    runFrames(selector, BUDGET * 1.5f, now);
+    if (selector.getPixelError() <= pixelError) {
+        qDebug() << "FAIL: budgetTest didn't raise the error when over budget";
+    }
+
+    // well under, it waits before falling
+    pixelError = selector.getPixelError();
+    runFrames(selector, BUDGET * 0.5f, now);
+    if (selector.getPixelError() < pixelError) {
+        qDebug() << "FAIL: budgetTest lowered the error without waiting";
+    }
+    for (int i = 0; i < 10; i++) {
+        runFrames(selector, BUDGET * 0.5f, now);
+    }
+    if (selector.getPixelError() >= pixelError) {
+        qDebug() << "FAIL: budgetTest didn't lower the error when under budget";
+    }
+}
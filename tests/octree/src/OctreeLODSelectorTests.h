@@ -0,0 +1,22 @@
+//
+//  OctreeLODSelectorTests.h
+//  tests/octree/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#ifndef hifi_OctreeLODSelectorTests_h
+#define hifi_OctreeLODSelectorTests_h
+
+namespace OctreeLODSelectorTests {
+
+    void runAllTests();
+    
+    void sizeScaleTest();
+    void budgetTest();
+}
+
+#endif // hifi_OctreeLODSelectorTests_h
@@ -0,0 +1,69 @@
+//
+//  OctreePacketDataTests.cpp
+//  tests/octree/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#include <QDebug>
+
+#include <OctalCode.h>
+#include <OctreePacketData.h>
+
+#include "OctreePacketDataTests.h"
+
+void OctreePacketDataTests::runAllTests() {
+    roundTripTest();
+    corruptContentTest();
+}
+
+// fills a packet the way a voxel server does, subtrees of colored children under octal codes
+static void fillPacket(OctreePacketData& packetData) {
+    unsigned char* parent = childOctalCode(NULL, 3);
+    for (int child = 0; child < NUMBER_OF_CHILDREN; child++) {
+        unsigned char* code = childOctalCode(parent, child);
+        packetData.startSubTree(code);
+        packetData.appendBitMask(0xff);
+        for (int i = 0; i < NUMBER_OF_CHILDREN; i++) {
+            packetData.appendColor(128, 64 + child, 32);
+        }
+        packetData.appendBitMask(0x00);
+        packetData.endSubTree();
+        delete[] code;
+    }
+    delete[] parent;
+}
+
+void OctreePacketDataTests::roundTripTest() {
+    OctreePacketData packetData(true);
+    fillPacket(packetData);
+
+    int finalizedSize = packetData.getFinalizedSize();
+    if (finalizedSize <= 0 || finalizedSize >= packetData.getUncompressedSize()) {
+        qDebug() << "FAIL: roundTripTest compressed" << packetData.getUncompressedSize() << "bytes to" << finalizedSize;
+    }
+
+    OctreePacketData received(true);
+    received.loadFinalizedContent(packetData.getFinalizedData(), finalizedSize);
+    if (received.getUncompressedSize() != packetData.getUncompressedSize() ||
+            memcmp(received.getUncompressedData(), packetData.getUncompressedData(), packetData.getUncompressedSize())) {
+        qDebug() << "FAIL: roundTripTest decompressed content doesn't match what was packed";
+    }
+}
+
+void OctreePacketDataTests::corruptContentTest() {
+    OctreePacketData packetData(true);
+    fillPacket(packetData);
+
+    QByteArray corrupt(reinterpret_cast<const char*>(packetData.getFinalizedData()), packetData.getFinalizedSize());
+    corrupt[0] = ~corrupt[0];
+
+    OctreePacketData received(true);
+    received.loadFinalizedContent(reinterpret_cast<const unsigned char*>(corrupt.constData()), corrupt.size());
+    if (received.hasContent()) {
+        qDebug() << "FAIL: corruptContentTest loaded" << received.getUncompressedSize() << "bytes from a corrupt section";
+    }
+}
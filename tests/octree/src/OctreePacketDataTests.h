@@ -0,0 +1,22 @@
+//
+//  OctreePacketDataTests.h
+//  tests/octree/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#ifndef hifi_OctreePacketDataTests_h
+#define hifi_OctreePacketDataTests_h
+
+namespace OctreePacketDataTests {
+
+    void runAllTests();
+    
+    void roundTripTest();
+    void corruptContentTest();
+}
+
+#endif // hifi_OctreePacketDataTests_h
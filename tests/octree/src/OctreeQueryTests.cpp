@@ -0,0 +1,133 @@
+//
+//  OctreeQueryTests.cpp
+//  tests/octree/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#include <QDebug>
+#include <QUuid>
+
+#include <OctreeQuery.h>
+#include <PacketHeaders.h>
+
+#include "OctreeQueryTests.h"
+
+static const QUuid CLIENT_UUID = QUuid::createUuid();
+
+// room for any query after the header
+const int MAX_QUERY_BYTES = 256;
+
+// has the server read the query, returning the bytes written
+static int sendQuery(OctreeQueryChannel& channel, OctreeQuery& client, OctreeQuery& server,
+        bool forceKeyframe = false) {
+    QByteArray packet = byteArrayWithPopulatedHeader(PacketTypeVoxelQuery, CLIENT_UUID);
+    int headerBytes = packet.size();
+    packet.resize(headerBytes + MAX_QUERY_BYTES);
+    int bytes = channel.writeQuery(client, reinterpret_cast<unsigned char*>(packet.data()) + headerBytes,
+        forceKeyframe);
+    packet.resize(headerBytes + bytes);
+    server.parseData(packet);
+    return bytes;
+}
+
+static void acknowledge(OctreeQueryChannel& channel, OctreeQuery& server) {
+    quint16 sequenceNumber;
+    if (server.takeKeyframeToAcknowledge(sequenceNumber)) {
+        channel.keyframeAcknowledged(sequenceNumber);
+    }
+}
+
+void OctreeQueryTests::runAllTests() {
+    changesTest();
+    keyframeTest();
+}
+
+void OctreeQueryTests::changesTest() {
+    OctreeQueryChannel channel;
+    OctreeQuery client, server;
+    client.setCameraPosition(glm::vec3(100.0f, 20.0f, 300.0f));
+    client.setCameraFov(45.0f);
+    client.setMaxOctreePacketsPerSecond(200);
+
+    int keyframeBytes = sendQuery(channel, client, server);
+    if (server.getCameraPosition() != client.getCameraPosition() || server.getMaxOctreePacketsPerSecond() != 200) {
+        qDebug() << "FAIL: changesTest the server didn't read the keyframe";
+    }
+    acknowledge(channel, server);
+
+    // only the position is sent, to within the resolution of the offsets
+    const glm::vec3 MOVED_POSITION(101.5f, 20.25f, 290.0f);
+    client.setCameraPosition(MOVED_POSITION);
+    int changeBytes = sendQuery(channel, client, server);
+    if (changeBytes >= keyframeBytes / 2) {
+        qDebug() << "FAIL: changesTest wrote" << changeBytes << "bytes of changes against a" << keyframeBytes
+            << "byte keyframe";
+    }
+    if (glm::distance(server.getCameraPosition(), MOVED_POSITION) > 0.01f ||
+            server.getMaxOctreePacketsPerSecond() != 200 || server.getCameraFov() != client.getCameraFov()) {
+        qDebug() << "FAIL: changesTest the server didn't apply the changes to its keyframe";
+    }
+
+    client.setMaxOctreePacketsPerSecond(0);
+    sendQuery(channel, client, server);
+    if (server.getMaxOctreePacketsPerSecond() != 0) {
+        qDebug() << "FAIL: changesTest the server didn't read the changed budget";
+    }
+}
+
+void OctreeQueryTests::keyframeTest() {
+    OctreeQueryChannel channel;
+    OctreeQuery client, server;
+    client.setCameraPosition(glm::vec3(10.0f, 10.0f, 10.0f));
+
+    // without an acknowledgement, every query is a keyframe
+    int firstBytes = sendQuery(channel, client, server);
+    int secondBytes = sendQuery(channel, client, server);
+    if (firstBytes != secondBytes) {
+        qDebug() << "FAIL: keyframeTest sent changes to a keyframe that wasn't acknowledged";
+    }
+    acknowledge(channel, server);
+    if (sendQuery(channel, client, server) >= secondBytes) {
+        qDebug() << "FAIL: keyframeTest sent a keyframe after one was acknowledged";
+    }
+
+    // too far to send as an offset
+    const glm::vec3 FAR_POSITION(5000.0f, 10.0f, 10.0f);
+    client.setCameraPosition(FAR_POSITION);
+    if (sendQuery(channel, client, server) != firstBytes || server.getCameraPosition() != FAR_POSITION) {
+        qDebug() << "FAIL: keyframeTest didn't send a keyframe for a distant position";
+    }
+
+    // changes to a keyframe the server doesn't have are ignored
+    OctreeQuery restartedServer;
+    acknowledge(channel, server);
+    client.setCameraPosition(FAR_POSITION + glm::vec3(1.0f, 0.0f, 0.0f));
+    sendQuery(channel, client, restartedServer);
+    if (restartedServer.getCameraPosition() == client.getCameraPosition()) {
+        qDebug() << "FAIL: keyframeTest a server applied changes to a keyframe it didn't have";
+    }
+    sendQuery(channel, client, restartedServer, true);
+    if (restartedServer.getCameraPosition() != client.getCameraPosition()) {
+        qDebug() << "FAIL: keyframeTest a forced keyframe wasn't read";
+    }
+
+    // a query older than one already read is ignored
+    OctreeQuery staleServer;
+    QByteArray olderPacket = byteArrayWithPopulatedHeader(PacketTypeVoxelQuery, CLIENT_UUID);
+    int headerBytes = olderPacket.size();
+    olderPacket.resize(headerBytes + MAX_QUERY_BYTES);
+    client.setCameraPosition(glm::vec3(1.0f, 2.0f, 3.0f));
+    olderPacket.resize(headerBytes + client.getBroadcastData(
+        reinterpret_cast<unsigned char*>(olderPacket.data()) + headerBytes));
+    client.setCameraPosition(glm::vec3(4.0f, 5.0f, 6.0f));
+    OctreeQueryChannel newerChannel;
+    sendQuery(newerChannel, client, staleServer);
+    staleServer.parseData(olderPacket);
+    if (staleServer.getCameraPosition() != client.getCameraPosition()) {
+        qDebug() << "FAIL: keyframeTest a server read a query older than one it had";
+    }
+}
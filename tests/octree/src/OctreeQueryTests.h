@@ -0,0 +1,22 @@
+//
+//  OctreeQueryTests.h
+//  tests/octree/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#ifndef hifi_OctreeQueryTests_h
+#define hifi_OctreeQueryTests_h
+
+namespace OctreeQueryTests {
+
+    void runAllTests();
+    
+    void changesTest();
+    void keyframeTest();
+}
+
+#endif // hifi_OctreeQueryTests_h
@@ -0,0 +1,69 @@
+//
+//  ViewFrustumTests.cpp
+//  tests/octree/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#include <QDebug>
+
+#include <glm/gtc/quaternion.hpp>
+
+#include <OctreeConstants.h>
+#include <SharedUtil.h>
+#include <ViewFrustum.h>
+
+#include "ViewFrustumTests.h"
+
+void ViewFrustumTests::runAllTests() {
+    childCubesTest();
+}
+
+/// checks the batched test of a cube's children against testing each of them on its own
+static void checkChildCubes(const ViewFrustum& viewFrustum, const AACube& cube, int& mismatches) {
+    unsigned char insideMask;
+    unsigned char intersectMask;
+    viewFrustum.childCubesInFrustum(cube, insideMask, intersectMask);
+
+    float halfScale = cube.getScale() * 0.5f;
+    for (int i = 0; i < NUMBER_OF_CHILDREN; i++) {
+        glm::vec3 childCorner = cube.getCorner() + glm::vec3((i & 4) ? halfScale : 0.0f,
+            (i & 2) ? halfScale : 0.0f, (i & 1) ? halfScale : 0.0f);
+        ViewFrustum::location expected = viewFrustum.cubeInFrustum(AACube(childCorner, halfScale));
+        ViewFrustum::location batched = oneAtBit(insideMask, i) ? ViewFrustum::INSIDE :
+            (oneAtBit(intersectMask, i) ? ViewFrustum::INTERSECT : ViewFrustum::OUTSIDE);
+        if (batched != expected) {
+            mismatches++;
+        }
+    }
+}
+
+void ViewFrustumTests::childCubesTest() {
+    const float KEYHOLE_RADIUSES[] = { -1.0f, 2.0f };
+    for (int k = 0; k < 2; k++) {
+        ViewFrustum viewFrustum;
+        viewFrustum.setPosition(glm::vec3(5.0f, 5.0f, 5.0f));
+        viewFrustum.setOrientation(glm::quat(glm::vec3(0.3f, 0.7f, 0.0f)));
+        viewFrustum.setFieldOfView(60.0f);
+        viewFrustum.setAspectRatio(1.5f);
+        viewFrustum.setNearClip(0.1f);
+        viewFrustum.setFarClip(50.0f);
+        viewFrustum.setKeyholeRadius(KEYHOLE_RADIUSES[k]);
+        viewFrustum.calculate();
+
+        const int NUM_CUBES = 2000;
+        int mismatches = 0;
+        for (int i = 0; i < NUM_CUBES; i++) {
+            glm::vec3 corner(randFloatInRange(-20.0f, 30.0f), randFloatInRange(-20.0f, 30.0f),
+                randFloatInRange(-20.0f, 30.0f));
+            checkChildCubes(viewFrustum, AACube(corner, randFloatInRange(0.1f, 20.0f)), mismatches);
+        }
+        if (mismatches > 0) {
+            qDebug() << "FAIL: childCubesTest keyhole" << KEYHOLE_RADIUSES[k] << "had" << mismatches
+                << "children batched differently from cubeInFrustum";
+        }
+    }
+}
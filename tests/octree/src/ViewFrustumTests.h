@@ -0,0 +1,21 @@
+//
+//  ViewFrustumTests.h
+//  tests/octree/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#ifndef hifi_ViewFrustumTests_h
+#define hifi_ViewFrustumTests_h
+
+namespace ViewFrustumTests {
+
+    void runAllTests();
+    
+    void childCubesTest();
+}
+
+#endif // hifi_ViewFrustumTests_h
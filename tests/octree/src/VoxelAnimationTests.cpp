@@ -0,0 +1,186 @@
+//
+//  VoxelAnimationTests.cpp
+//  tests/octree/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#include <cstring>
+
+#include <QDebug>
+
+#include <UUID.h>
+#include <VoxelAnimation.h>
+#include <VoxelConstants.h>
+#include <VoxelTree.h>
+
+#include "VoxelAnimationTests.h"
+
+const float TEST_VOXEL_SIZE = 1.0f / 256.0f;
+const quint32 TEST_PERIOD_MSECS = 1000;
+
+static VoxelAnimation makeTestAnimation(int partCount) {
+    const unsigned char BLACK[3] = { 0, 0, 0 };
+    const unsigned char WHITE[3] = { 255, 255, 255 };
+    VoxelAnimation animation;
+    animation.voxelSize = TEST_VOXEL_SIZE;
+    animation.origin = glm::vec3(0.25f, 0.25f, 0.25f);
+    animation.colorPeriodMsecs = TEST_PERIOD_MSECS;
+    for (int i = 0; i < partCount; i++) {
+        VoxelAnimationPart part;
+        part.x = i;
+        part.y = 0;
+        part.z = -i;
+        memcpy(part.colorA, BLACK, sizeof(rgbColor));
+        memcpy(part.colorB, WHITE, sizeof(rgbColor));
+        part.phase = 0;
+        animation.parts.append(part);
+    }
+    return animation;
+}
+
+static bool hasColor(const QHash<QByteArray, QByteArray>& voxels, const glm::vec3& position, unsigned char gray) {
+    unsigned char* code = pointToOctalCode(position.x, position.y, position.z, TEST_VOXEL_SIZE);
+    QByteArray key(reinterpret_cast<const char*>(code), bytesRequiredForCodeLength(numberOfThreeBitSectionsInCode(code)));
+    delete[] code;
+    QByteArray codeColorBuffer = voxels.value(key);
+    if (codeColorBuffer.size() != key.size() + BYTES_PER_COLOR) {
+        return false;
+    }
+    for (int i = 0; i < BYTES_PER_COLOR; i++) {
+        if ((unsigned char)codeColorBuffer.at(key.size() + i) != gray) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void VoxelAnimationTests::runAllTests() {
+    recordTest();
+    evaluateTest();
+    treeTest();
+}
+
+void VoxelAnimationTests::recordTest() {
+    VoxelAnimation animation = makeTestAnimation(200);
+    animation.orbitPeriodMsecs = 2 * TEST_PERIOD_MSECS;
+    animation.orbitRadius = 0.125f;
+    QUuid id = QUuid::createUuid();
+
+    // the parts take more than one record, which are read in one after another
+    const int MAX_RECORD_SIZE = 1000;
+    unsigned char buffer[MAX_RECORD_SIZE];
+    VoxelAnimation readAnimation;
+    int records = 0;
+    for (int firstPart = 0; firstPart < animation.parts.size(); records++) {
+        int partsWritten;
+        int size = animation.encodeEditRecord(id, 0, firstPart, buffer, MAX_RECORD_SIZE, partsWritten);
+        if (size == 0 || size > MAX_RECORD_SIZE || partsWritten == 0) {
+            qDebug() << "FAIL: recordTest wrote a record of" << size << "bytes with" << partsWritten << "parts";
+            return;
+        }
+        int codeBytes = bytesRequiredForCodeLength(numberOfThreeBitSectionsInCode(buffer));
+        if (QUuid::fromRfc4122(QByteArray((const char*)buffer + codeBytes, NUM_BYTES_RFC4122_UUID)) != id) {
+            qDebug() << "FAIL: recordTest id didn't follow the enclosing code";
+        }
+        unsigned char flags;
+        int dataBytes = readAnimation.readEditRecordData(buffer + codeBytes + NUM_BYTES_RFC4122_UUID,
+            size - codeBytes - NUM_BYTES_RFC4122_UUID, flags);
+        if (codeBytes + NUM_BYTES_RFC4122_UUID + dataBytes != size) {
+            qDebug() << "FAIL: recordTest read" << dataBytes << "bytes of a record of" << size;
+        }
+
+        // cut short, it isn't read
+        VoxelAnimation shortAnimation;
+        if (shortAnimation.readEditRecordData(buffer + codeBytes + NUM_BYTES_RFC4122_UUID,
+                size - codeBytes - NUM_BYTES_RFC4122_UUID - 1, flags) != -1) {
+            qDebug() << "FAIL: recordTest read a record that was cut short";
+        }
+        firstPart += partsWritten;
+    }
+    if (records < 2) {
+        qDebug() << "FAIL: recordTest expected the parts to take more than one record, took" << records;
+    }
+    if (readAnimation.parts.size() != animation.parts.size() || readAnimation.origin != animation.origin ||
+            readAnimation.orbitPeriodMsecs != animation.orbitPeriodMsecs ||
+            readAnimation.orbitRadius != animation.orbitRadius || readAnimation.chase != animation.chase) {
+        qDebug() << "FAIL: recordTest read back a different animation";
+        return;
+    }
+    for (int i = 0; i < animation.parts.size(); i++) {
+        if (readAnimation.parts.at(i).x != animation.parts.at(i).x ||
+                readAnimation.parts.at(i).z != animation.parts.at(i).z) {
+            qDebug() << "FAIL: recordTest part" << i << "was read back differently";
+        }
+    }
+}
+
+void VoxelAnimationTests::evaluateTest() {
+    VoxelAnimation animation = makeTestAnimation(3);
+    glm::vec3 firstPart = animation.origin;
+    glm::vec3 lastPart = animation.origin + glm::vec3(2.0f, 0.0f, -2.0f) * TEST_VOXEL_SIZE;
+
+    // fading, the parts go from their first color to their second over half the period and back
+    QHash<QByteArray, QByteArray> voxels;
+    animation.evaluate(0, voxels);
+    if (voxels.size() != 3 || !hasColor(voxels, firstPart, 0) || !hasColor(voxels, lastPart, 0)) {
+        qDebug() << "FAIL: evaluateTest expected the parts to start at their first color";
+    }
+    voxels.clear();
+    animation.evaluate(TEST_PERIOD_MSECS / 2, voxels);
+    if (!hasColor(voxels, firstPart, 255) || !hasColor(voxels, lastPart, 255)) {
+        qDebug() << "FAIL: evaluateTest expected the parts at their second color half a period in";
+    }
+
+    // chasing, the last part is lit halfway through, and the others aren't
+    animation.chase = true;
+    animation.parts[1].phase = 32768;
+    animation.parts[2].phase = 65535;
+    voxels.clear();
+    animation.evaluate(TEST_PERIOD_MSECS / 2, voxels);
+    if (!hasColor(voxels, lastPart, 255) || !hasColor(voxels, firstPart, 0)) {
+        qDebug() << "FAIL: evaluateTest expected only the last part lit halfway through a chase";
+    }
+
+    // orbiting, a quarter of the way round the parts are on the +z side of the origin, turned to face -x
+    animation.chase = false;
+    animation.colorPeriodMsecs = 0;
+    animation.orbitPeriodMsecs = 4 * TEST_PERIOD_MSECS;
+    animation.orbitRadius = 64.0f * TEST_VOXEL_SIZE;
+    voxels.clear();
+    animation.evaluate(TEST_PERIOD_MSECS, voxels);
+    glm::vec3 center = animation.origin + glm::vec3(0.0f, 0.0f, animation.orbitRadius);
+    glm::vec3 half(0.5f * TEST_VOXEL_SIZE, 0.5f * TEST_VOXEL_SIZE, 0.5f * TEST_VOXEL_SIZE);
+    if (!hasColor(voxels, center + half, 0) ||
+            !hasColor(voxels, center + glm::vec3(2.0f, 0.0f, 2.0f) * TEST_VOXEL_SIZE + half, 0)) {
+        qDebug() << "FAIL: evaluateTest expected the parts a quarter of the way round the orbit";
+    }
+}
+
+void VoxelAnimationTests::treeTest() {
+    VoxelAnimation animation = makeTestAnimation(3);
+    QUuid id = QUuid::createUuid();
+    unsigned char buffer[MAX_PACKET_SIZE];
+    int partsWritten;
+    int size = animation.encodeEditRecord(id, 0, 0, buffer, MAX_PACKET_SIZE, partsWritten);
+
+    VoxelTree tree;
+    if (tree.processEditPacketData(PacketTypeVoxelAnimate, NULL, 0, buffer, size, SharedNodePointer()) != size) {
+        qDebug() << "FAIL: treeTest didn't read the whole animation record";
+    }
+    tree.update();
+    if (!tree.getVoxelAt(animation.origin.x, animation.origin.y, animation.origin.z, TEST_VOXEL_SIZE)) {
+        qDebug() << "FAIL: treeTest expected the animation's voxels in the tree once it was updated";
+    }
+
+    // removed, its voxels go with it
+    size = animation.encodeEditRecord(id, VOXEL_ANIMATION_REMOVE, 0, buffer, MAX_PACKET_SIZE, partsWritten);
+    tree.processEditPacketData(PacketTypeVoxelAnimate, NULL, 0, buffer, size, SharedNodePointer());
+    tree.update();
+    if (tree.getVoxelAt(animation.origin.x, animation.origin.y, animation.origin.z, TEST_VOXEL_SIZE)) {
+        qDebug() << "FAIL: treeTest expected the animation's voxels erased once it was removed";
+    }
+}
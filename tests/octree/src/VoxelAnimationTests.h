@@ -0,0 +1,23 @@
+//
+//  VoxelAnimationTests.h
+//  tests/octree/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#ifndef hifi_VoxelAnimationTests_h
+#define hifi_VoxelAnimationTests_h
+
+namespace VoxelAnimationTests {
+
+    void runAllTests();
+
+    void recordTest();
+    void evaluateTest();
+    void treeTest();
+}
+
+#endif // hifi_VoxelAnimationTests_h
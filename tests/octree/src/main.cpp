@@ -8,13 +8,44 @@
 //  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
 //
 
+#include <QtCore/QString>
+
+#include "LinearizedOctreeTests.h"
+#include "OctreeBenchmarks.h"
+#include "OcclusionBufferTests.h"
+#include "OctreeColorPaletteTests.h"
+#include "OctreeDeletedIDLogTests.h"
+#include "OctreeElementBagTests.h"
+#include "OctreeEncodeCacheTests.h"
+#include "OctreeExportTests.h"
+#include "OctreeLODSelectorTests.h"
+#include "OctreePacketDataTests.h"
+#include "OctreeQueryTests.h"
 #include "ModelTests.h"
 #include "OctreeTests.h"
+#include "ViewFrustumTests.h"
+#include "VoxelAnimationTests.h"
 #include "AABoxCubeTests.h"
 
 int main(int argc, char** argv) {
+    // with --benchmark the worlds are timed instead, and the results written to the given file
+    if (argc > 1 && QString(argv[1]) == "--benchmark") {
+        return OctreeBenchmarks::runAllBenchmarks(argc > 2 ? argv[2] : "octree-benchmarks.json") ? 0 : 1;
+    }
     OctreeTests::runAllTests();
     AABoxCubeTests::runAllTests();
+    LinearizedOctreeTests::runAllTests();
+    OctreeElementBagTests::runAllTests();
+    ViewFrustumTests::runAllTests();
+    OcclusionBufferTests::runAllTests();
+    OctreeEncodeCacheTests::runAllTests();
+    OctreeColorPaletteTests::runAllTests();
+    OctreeExportTests::runAllTests();
+    OctreeDeletedIDLogTests::runAllTests();
+    OctreeLODSelectorTests::runAllTests();
+    OctreePacketDataTests::runAllTests();
+    OctreeQueryTests::runAllTests();
+    VoxelAnimationTests::runAllTests();
     ModelTests::runAllTests(true);
     return 0;
 }
@@ -17,6 +17,7 @@
 #include <glm/gtx/quaternion.hpp>
 
 #include <CollisionInfo.h>
+#include <ListShape.h>
 #include <ShapeCollider.h>
 #include <SharedUtil.h>
 #include <SphereShape.h>
@@ -682,6 +683,43 @@ void ShapeColliderTests::capsuleTouchesCapsule() {
     }
 }
 
+void ShapeColliderTests::sphereTouchesListShape() {
+    // a list of two unit spheres on either side of its origin
+    ListShape listA;
+    listA.addShape(new SphereShape(1.0f, origin), xAxis, glm::quat());
+    listA.addShape(new SphereShape(1.0f, origin), -xAxis, glm::quat());
+    listA.setTranslation(origin);
+    listA.updateSubTransforms();
+
+    // the sphere only reaches the list's first sphere
+    SphereShape sphereB(1.0f, 2.5f * xAxis);
+    CollisionList collisions(16);
+
+    bool touching = ShapeCollider::collideShapes(&sphereB, &listA, collisions);
+    if (!touching || collisions.size() != 1) {
+        std::cout << __FILE__ << ":" << __LINE__
+            << " ERROR: sphereB should touch one shape of listA, but collisions size is " << collisions.size() << std::endl;
+    }
+    touching = ShapeCollider::collideShapes(&listA, &sphereB, collisions);
+    if (!touching || collisions.size() != 2) {
+        std::cout << __FILE__ << ":" << __LINE__
+            << " ERROR: listA should touch sphereB once, but collisions size is " << collisions.size() << std::endl;
+    }
+
+    // the same list moved along x only overlaps listA where their inner spheres meet
+    ListShape listC;
+    listC.addShape(new SphereShape(1.0f, origin), xAxis, glm::quat());
+    listC.addShape(new SphereShape(1.0f, origin), -xAxis, glm::quat());
+    listC.setTranslation(3.0f * xAxis);
+    listC.updateSubTransforms();
+
+    touching = ShapeCollider::collideShapes(&listA, &listC, collisions);
+    if (!touching || collisions.size() != 3) {
+        std::cout << __FILE__ << ":" << __LINE__
+            << " ERROR: listA should touch listC once, but collisions size is " << collisions.size() << std::endl;
+    }
+}
+
 void ShapeColliderTests::sphereTouchesAACubeFaces() {
     CollisionList collisions(16);
     
@@ -1308,6 +1346,8 @@ void ShapeColliderTests::runAllTests() {
     capsuleMissesCapsule();
     capsuleTouchesCapsule();
 
+    sphereTouchesListShape();
+
     sphereTouchesAACubeFaces();
     sphereTouchesAACubeEdges();
     sphereMissesAACube();
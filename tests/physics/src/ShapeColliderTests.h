@@ -23,6 +23,8 @@ namespace ShapeColliderTests {
     void capsuleMissesCapsule();
     void capsuleTouchesCapsule();
 
+    void sphereTouchesListShape();
+
     void sphereTouchesAACubeFaces();
     void sphereTouchesAACubeEdges();
     void sphereMissesAACube();
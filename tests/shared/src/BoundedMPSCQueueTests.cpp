@@ -0,0 +1,129 @@
+//
+//  BoundedMPSCQueueTests.cpp
+//  tests/shared/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#include <QtCore/QDebug>
+#include <QtCore/QThread>
+#include <QtCore/QVector>
+
+#include "BoundedMPSCQueue.h"
+
+#include "BoundedMPSCQueueTests.h"
+
+void BoundedMPSCQueueTests::runAllTests() {
+    orderAndCapacityTest();
+    multipleProducerTest();
+}
+
+void BoundedMPSCQueueTests::orderAndCapacityTest() {
+    BoundedMPSCQueue<int> queue(5);
+    if (queue.getCapacity() != 8) {
+        qDebug() << "FAIL: a queue for 5 items has a capacity of" << queue.getCapacity() << "rather than 8";
+    }
+    
+    // a few laps around the cells, filling them each lap
+    const int NUM_LAPS = 3;
+    for (int lap = 0; lap < NUM_LAPS; lap++) {
+        for (int i = 0; i < queue.getCapacity(); i++) {
+            if (!queue.push(lap * 100 + i)) {
+                qDebug() << "FAIL: push" << i << "of lap" << lap << "was turned away before the queue was full";
+            }
+        }
+        if (queue.push(-1)) {
+            qDebug() << "FAIL: a push onto a full queue wasn't turned away";
+        }
+        if (queue.getDepth() != queue.getCapacity()) {
+            qDebug() << "FAIL: a full queue has a depth of" << queue.getDepth();
+        }
+        
+        int item;
+        for (int i = 0; i < queue.getCapacity(); i++) {
+            if (!queue.pop(item) || item != lap * 100 + i) {
+                qDebug() << "FAIL: pop" << i << "of lap" << lap << "didn't give the items back in the order pushed";
+            }
+        }
+        if (queue.pop(item)) {
+            qDebug() << "FAIL: a pop off of an empty queue gave back" << item;
+        }
+    }
+    
+    if (queue.getNumFullPushes() != NUM_LAPS) {
+        qDebug() << "FAIL: the queue counted" << queue.getNumFullPushes() << "full pushes rather than" << NUM_LAPS;
+    }
+    if (queue.getMaxDepth() != queue.getCapacity()) {
+        qDebug() << "FAIL: the queue's max depth is" << queue.getMaxDepth() << "rather than its capacity";
+    }
+}
+
+/// pushes its numbers, each tagged with which producer it is, retrying whenever the queue is full
+class QueueProducer : public QThread {
+public:
+    QueueProducer(BoundedMPSCQueue<int>& queue, int producer, int numItems) :
+        _queue(queue), _producer(producer), _numItems(numItems) { }
+
+protected:
+    virtual void run() {
+        for (int i = 0; i < _numItems; i++) {
+            while (!_queue.push((_producer << 24) | i)) {
+                yieldCurrentThread();
+            }
+        }
+    }
+
+private:
+    BoundedMPSCQueue<int>& _queue;
+    int _producer;
+    int _numItems;
+};
+
+void BoundedMPSCQueueTests::multipleProducerTest() {
+    const int NUM_PRODUCERS = 4;
+    const int ITEMS_PER_PRODUCER = 100000;
+    
+    // small enough that the producers keep running into a full queue
+    BoundedMPSCQueue<int> queue(64);
+    
+    QVector<QueueProducer*> producers;
+    for (int i = 0; i < NUM_PRODUCERS; i++) {
+        producers.append(new QueueProducer(queue, i, ITEMS_PER_PRODUCER));
+        producers.last()->start();
+    }
+    
+    // each producer's items have to come out in the order it pushed them, and none of them can be lost
+    QVector<int> nextItems(NUM_PRODUCERS, 0);
+    int numPopped = 0;
+    bool isOutOfOrder = false;
+    while (numPopped < NUM_PRODUCERS * ITEMS_PER_PRODUCER) {
+        int item;
+        if (!queue.pop(item)) {
+            queue.waitForItems(10);
+            continue;
+        }
+        int producer = item >> 24;
+        if (producer < 0 || producer >= NUM_PRODUCERS || (item & 0xffffff) != nextItems[producer]) {
+            isOutOfOrder = true;
+        } else {
+            nextItems[producer]++;
+        }
+        numPopped++;
+    }
+    if (isOutOfOrder) {
+        qDebug() << "FAIL: items of the producers were lost, repeated or came out of order";
+    }
+    
+    foreach (QueueProducer* producer, producers) {
+        producer->wait();
+        delete producer;
+    }
+    
+    int item;
+    if (queue.pop(item)) {
+        qDebug() << "FAIL: there was an item left after every item pushed was popped";
+    }
+}
@@ -0,0 +1,22 @@
+//
+//  BoundedMPSCQueueTests.h
+//  tests/shared/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#ifndef hifi_BoundedMPSCQueueTests_h
+#define hifi_BoundedMPSCQueueTests_h
+
+namespace BoundedMPSCQueueTests {
+
+    void runAllTests();
+    
+    void orderAndCapacityTest();
+    void multipleProducerTest();
+}
+
+#endif // hifi_BoundedMPSCQueueTests_h
@@ -0,0 +1,46 @@
+//
+//  CycleCounterTests.cpp
+//  tests/shared/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#include <QtCore/QDebug>
+#include <QtCore/QElapsedTimer>
+
+#include "CycleCounter.h"
+
+#include "CycleCounterTests.h"
+
+void CycleCounterTests::runAllTests() {
+    conversionTest();
+}
+
+void CycleCounterTests::conversionTest() {
+    // measure the rate first, so that it isn't part of the span below
+    cycleCountsToUsecs(0);
+    
+    const qint64 SPAN_NSECS = 20 * 1000 * 1000;
+    QElapsedTimer timer;
+    timer.start();
+    quint64 start = cycleCounterNow();
+    while (timer.nsecsElapsed() < SPAN_NSECS) {
+    }
+    quint64 end = cycleCounterNow();
+    float expectedUsecs = timer.nsecsElapsed() / 1000.0f;
+    
+    if (end <= start) {
+        qDebug() << "FAIL: the cycle counter didn't advance over" << expectedUsecs << "usecs";
+        return;
+    }
+    
+    // the counter and the timer are read at slightly different times, and the thread can be preempted between them
+    const float TOLERANCE = 0.1f;
+    float usecs = cycleCountsToUsecs(end - start);
+    if (qAbs(usecs - expectedUsecs) > expectedUsecs * TOLERANCE) {
+        qDebug() << "FAIL: cycle counts converted to" << usecs << "usecs over a span of" << expectedUsecs << "usecs";
+    }
+}
@@ -0,0 +1,21 @@
+//
+//  CycleCounterTests.h
+//  tests/shared/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#ifndef hifi_CycleCounterTests_h
+#define hifi_CycleCounterTests_h
+
+namespace CycleCounterTests {
+
+    void runAllTests();
+    
+    void conversionTest();
+}
+
+#endif // hifi_CycleCounterTests_h
@@ -0,0 +1,106 @@
+//
+//  JobGraphTests.cpp
+//  tests/shared/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#include <QtCore/QAtomicInt>
+#include <QtCore/QDebug>
+#include <QtCore/QThread>
+#include <QtCore/QVector>
+
+#include "JobGraph.h"
+#include "SharedUtil.h"
+
+#include "JobGraphTests.h"
+
+void JobGraphTests::runAllTests() {
+    prerequisiteOrderTest();
+    criticalPathTest();
+}
+
+/// notes the order it finished in and the thread it ran on, after spinning for a while
+class RecordingJob : public JobGraph::Job {
+public:
+    RecordingJob(QAtomicInt& finishCounter, int usecs) :
+        _finishCounter(finishCounter), _usecs(usecs), finishOrder(-1), runs(0), thread(NULL) { }
+
+    virtual void run() {
+        thread = QThread::currentThread();
+        runs++;
+        quint64 end = usecMonotonicNow() + _usecs;
+        while (usecMonotonicNow() < end);
+        finishOrder = _finishCounter.fetchAndAddOrdered(1);
+    }
+
+private:
+    QAtomicInt& _finishCounter;
+    int _usecs;
+
+public:
+    int finishOrder;
+    int runs;
+    QThread* thread;
+};
+
+void JobGraphTests::prerequisiteOrderTest() {
+    // a diamond: two jobs wait for the first, and the last waits for them both
+    const int NUM_RUNS = 20;
+    QAtomicInt finishCounter;
+    JobGraph graph("tests/jobs");
+    RecordingJob* first = new RecordingJob(finishCounter, 1000);
+    RecordingJob* left = new RecordingJob(finishCounter, 2000);
+    RecordingJob* right = new RecordingJob(finishCounter, 2000);
+    RecordingJob* last = new RecordingJob(finishCounter, 1000);
+    int firstJob = graph.addJob("first", first);
+    int leftJob = graph.addJob("left", left);
+    int rightJob = graph.addJob("right", right);
+    int lastJob = graph.addJob("last", last);
+    graph.addPrerequisite(leftJob, firstJob);
+    graph.addPrerequisite(rightJob, firstJob);
+    graph.addPrerequisite(lastJob, leftJob);
+    graph.addPrerequisite(lastJob, rightJob);
+    graph.setRunsOnCallingThread(lastJob);
+
+    for (int i = 0; i < NUM_RUNS; i++) {
+        finishCounter.store(0);
+        graph.run();
+
+        if (finishCounter.load() != 4) {
+            qDebug() << "FAIL: run" << i << "finished" << finishCounter.load() << "jobs rather than 4";
+        }
+        if (first->finishOrder != 0 || last->finishOrder != 3) {
+            qDebug() << "FAIL: run" << i << "finished a job before its prerequisites";
+        }
+        if (last->thread != QThread::currentThread()) {
+            qDebug() << "FAIL: run" << i << "ran the job kept for the calling thread on another";
+        }
+    }
+    if (first->runs != NUM_RUNS || left->runs != NUM_RUNS || right->runs != NUM_RUNS || last->runs != NUM_RUNS) {
+        qDebug() << "FAIL: the jobs didn't each run once a run";
+    }
+}
+
+void JobGraphTests::criticalPathTest() {
+    // the short job and the long one go at once, and the one after waits for both, so the long one is on the path
+    QAtomicInt finishCounter;
+    JobGraph graph("tests/jobs");
+    int shortJob = graph.addJob("short", new RecordingJob(finishCounter, 1000));
+    int longJob = graph.addJob("long", new RecordingJob(finishCounter, 20000));
+    int afterJob = graph.addJob("after", new RecordingJob(finishCounter, 1000));
+    graph.addPrerequisite(afterJob, shortJob);
+    graph.addPrerequisite(afterJob, longJob);
+    graph.run();
+
+    QStringList expectedPath = QStringList() << "long" << "after";
+    if (graph.getCriticalPath() != expectedPath) {
+        qDebug() << "FAIL: the critical path is" << graph.getCriticalPath() << "rather than" << expectedPath;
+    }
+    if (graph.getCriticalPathUsecs() < 21000) {
+        qDebug() << "FAIL: the critical path took" << graph.getCriticalPathUsecs() << "usecs, less than its jobs spun";
+    }
+}
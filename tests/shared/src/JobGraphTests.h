@@ -0,0 +1,22 @@
+//
+//  JobGraphTests.h
+//  tests/shared/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#ifndef hifi_JobGraphTests_h
+#define hifi_JobGraphTests_h
+
+namespace JobGraphTests {
+
+    void runAllTests();
+    
+    void prerequisiteOrderTest();
+    void criticalPathTest();
+}
+
+#endif // hifi_JobGraphTests_h
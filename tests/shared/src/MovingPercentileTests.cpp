@@ -14,6 +14,7 @@
 #include "SharedUtil.h"
 #include "MovingPercentile.h"
 
+#include <qelapsedtimer.h>
 #include <qqueue.h>
 
 float MovingPercentileTests::random() {
@@ -165,5 +166,56 @@ void MovingPercentileTests::runAllTests() {
             }
         }
     }
+
+    severalPercentilesTest();
+    updateBenchmark();
 }
 
+void MovingPercentileTests::severalPercentilesTest() {
+    const int N = 50;
+    const int NUM_PERCENTILES = 4;
+    const float PERCENTILES[NUM_PERCENTILES] = { 0.25f, 0.5f, 0.95f, 0.99f };
+
+    qDebug() << "testing several percentiles of one window...";
+
+    // coarse samples, so that there are plenty of equal ones
+    QQueue<float> lastNSamples;
+    MovingPercentile movingPercentile(N);
+    for (int s = 0; s < 10000; s++) {
+        float sample = (float)(rand() % 20);
+        lastNSamples.push_back(sample);
+        if (lastNSamples.size() > N) {
+            lastNSamples.pop_front();
+        }
+        movingPercentile.updatePercentile(sample);
+
+        QList<float> sortedSamples = lastNSamples;
+        qSort(sortedSamples);
+        for (int i = 0; i < NUM_PERCENTILES; i++) {
+            int index = (int)(PERCENTILES[i] * (float)(sortedSamples.size() - 1) + 0.5f);
+            if (movingPercentile.getValueAtPercentile(PERCENTILES[i]) != sortedSamples.at(index)) {
+                qDebug() << "\t FAIL at sample" << s << "for percentile" << PERCENTILES[i];
+                return;
+            }
+        }
+    }
+    qDebug() << "\t PASS";
+}
+
+void MovingPercentileTests::updateBenchmark() {
+    const int NUM_UPDATES = 1000000;
+    const int WINDOW_SIZES[] = { 100, 10000, 100000 };
+
+    // updates take time logarithmic in the size of the window, so a thousandfold larger window should cost only a few
+    // times as much
+    for (int i = 0; i < (int)(sizeof(WINDOW_SIZES) / sizeof(WINDOW_SIZES[0])); i++) {
+        MovingPercentile movingPercentile(WINDOW_SIZES[i], 0.99f);
+        QElapsedTimer timer;
+        timer.start();
+        for (int s = 0; s < NUM_UPDATES; s++) {
+            movingPercentile.updatePercentile(random());
+        }
+        qDebug() << "moving percentile of" << WINDOW_SIZES[i] << "samples:" << (float)timer.nsecsElapsed() / NUM_UPDATES
+            << "nsecs an update";
+    }
+}
@@ -17,6 +17,9 @@ namespace MovingPercentileTests {
     float random();
 
     void runAllTests(); 
+    
+    void severalPercentilesTest();
+    void updateBenchmark();
 }
 
 #endif // hifi_MovingPercentileTests_h
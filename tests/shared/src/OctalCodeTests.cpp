@@ -0,0 +1,142 @@
+//
+//  OctalCodeTests.cpp
+//  tests/shared/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#include <cmath>
+#include <cstring>
+
+#include <QtCore/QDebug>
+
+#include "OctalCode.h"
+
+#include "OctalCodeTests.h"
+
+// a code as deep as a key holds, with sections that cross the bytes and the words of the key at every offset
+static unsigned char* makeDeepCode(int sections, int* values) {
+    unsigned char* code = new unsigned char[1];
+    *code = 0;
+    for (int i = 0; i < sections; i++) {
+        values[i] = (i * 5 + 3) % 8;
+        unsigned char* childCode = childOctalCode(code, values[i]);
+        delete[] code;
+        code = childCode;
+    }
+    return code;
+}
+
+void OctalCodeTests::runAllTests() {
+    keyRoundTripTest();
+    keyAncestorTest();
+    keyVoxelDetailsTest();
+}
+
+void OctalCodeTests::keyRoundTripTest() {
+    for (int sections = 0; sections <= MAX_OCTAL_KEY_SECTIONS; sections++) {
+        int values[MAX_OCTAL_KEY_SECTIONS];
+        unsigned char* code = makeDeepCode(sections, values);
+        
+        OctalKey key;
+        if (!octalKeyForCode(code, key) || key.sections != sections) {
+            qDebug() << "FAIL: a code of" << sections << "sections didn't make a key";
+            delete[] code;
+            continue;
+        }
+        for (int i = 0; i < sections; i++) {
+            if (octalKeySectionValue(key, i) != values[i]) {
+                qDebug() << "FAIL: section" << i << "of a key of" << sections << "sections is"
+                    << octalKeySectionValue(key, i) << "rather than" << values[i];
+            }
+        }
+        
+        unsigned char keyCode[MAX_OCTAL_KEY_SECTIONS];
+        size_t keyCodeBytes = copyOctalCodeForKey(key, keyCode);
+        if (keyCodeBytes != bytesRequiredForCodeLength(sections) || memcmp(keyCode, code, keyCodeBytes) != 0) {
+            qDebug() << "FAIL: the code of a key of" << sections << "sections isn't the code it was made from";
+        }
+        
+        if (sections < MAX_OCTAL_KEY_SECTIONS) {
+            unsigned char* childCode = childOctalCode(code, 6);
+            copyOctalCodeForKey(childOctalKey(key, 6), keyCode);
+            if (memcmp(keyCode, childCode, bytesRequiredForCodeLength(sections + 1)) != 0) {
+                qDebug() << "FAIL: the child key of a key of" << sections << "sections isn't the child code";
+            }
+            delete[] childCode;
+        }
+        delete[] code;
+    }
+    
+    int values[MAX_OCTAL_KEY_SECTIONS + 1];
+    unsigned char* tooDeepCode = makeDeepCode(MAX_OCTAL_KEY_SECTIONS + 1, values);
+    OctalKey key;
+    if (octalKeyForCode(tooDeepCode, key)) {
+        qDebug() << "FAIL: a code deeper than a key holds made a key";
+    }
+    delete[] tooDeepCode;
+}
+
+void OctalCodeTests::keyAncestorTest() {
+    int values[MAX_OCTAL_KEY_SECTIONS];
+    unsigned char* code = makeDeepCode(MAX_OCTAL_KEY_SECTIONS - 1, values);
+    OctalKey key;
+    octalKeyForCode(code, key);
+    
+    for (int sections = 0; sections < key.sections; sections++) {
+        OctalKey ancestorKey = ancestorOctalKey(key, sections);
+        unsigned char ancestorCode[MAX_OCTAL_KEY_SECTIONS];
+        copyOctalCodeForKey(ancestorKey, ancestorCode);
+        if (!isAncestorOfKey(ancestorKey, key) || !isAncestorOf(ancestorCode, code)) {
+            qDebug() << "FAIL: the ancestor of" << sections << "sections isn't an ancestor";
+        }
+        if (isAncestorOfKey(key, ancestorKey) || isAncestorOf(code, ancestorCode)) {
+            qDebug() << "FAIL: the ancestor of" << sections << "sections is a descendant";
+        }
+        if (sections > 0) {
+            // a cousin differs in its last section
+            OctalKey cousinKey = childOctalKey(ancestorOctalKey(key, sections - 1), (values[sections - 1] + 1) % 8);
+            unsigned char cousinCode[MAX_OCTAL_KEY_SECTIONS];
+            copyOctalCodeForKey(cousinKey, cousinCode);
+            if (isAncestorOfKey(cousinKey, key) || isAncestorOf(cousinCode, code)) {
+                qDebug() << "FAIL: the cousin of" << sections << "sections is an ancestor";
+            }
+        }
+    }
+    
+    // the child that's asked about is the descendant's last section
+    unsigned char* childCode = childOctalCode(code, 2);
+    if (!isAncestorOf(childCode, code, 2) || isAncestorOf(childCode, code, 3)) {
+        qDebug() << "FAIL: the child given to isAncestorOf() isn't the one compared";
+    }
+    delete[] childCode;
+    delete[] code;
+}
+
+void OctalCodeTests::keyVoxelDetailsTest() {
+    for (int sections = 0; sections <= MAX_OCTAL_KEY_SECTIONS; sections++) {
+        int values[MAX_OCTAL_KEY_SECTIONS];
+        unsigned char* code = makeDeepCode(sections, values);
+        
+        double x = 0.0, y = 0.0, z = 0.0, scale = 1.0;
+        for (int i = 0; i < sections; i++) {
+            scale *= 0.5;
+            x += scale * ((values[i] >> 2) & 1);
+            y += scale * ((values[i] >> 1) & 1);
+            z += scale * (values[i] & 1);
+        }
+        
+        VoxelPositionSize details;
+        voxelDetailsForCode(code, details);
+        const float TOLERANCE = 0.000001f;
+        if (fabs(details.x - x) > TOLERANCE || fabs(details.y - y) > TOLERANCE || fabs(details.z - z) > TOLERANCE
+                || details.s != (float)scale) {
+            qDebug() << "FAIL: the voxel of a code of" << sections << "sections is" << details.x << details.y
+                << details.z << details.s << "rather than" << x << y << z << scale;
+        }
+        delete[] code;
+    }
+}
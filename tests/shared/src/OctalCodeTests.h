@@ -0,0 +1,23 @@
+//
+//  OctalCodeTests.h
+//  tests/shared/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#ifndef hifi_OctalCodeTests_h
+#define hifi_OctalCodeTests_h
+
+namespace OctalCodeTests {
+
+    void runAllTests();
+    
+    void keyRoundTripTest();
+    void keyAncestorTest();
+    void keyVoxelDetailsTest();
+}
+
+#endif // hifi_OctalCodeTests_h
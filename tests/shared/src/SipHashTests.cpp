@@ -0,0 +1,98 @@
+//
+//  SipHashTests.cpp
+//  tests/shared/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#include <cstring>
+
+#include <QtCore/QDebug>
+
+#include "SipHash.h"
+
+#include "SipHashTests.h"
+
+void SipHashTests::runAllTests() {
+    referenceVectorTest();
+    keyAndMessageTest();
+}
+
+void SipHashTests::referenceVectorTest() {
+    // the first vectors of the reference implementation, keyed by 00 01 .. 0f over the messages 00 01 .. of each length
+    const unsigned char EXPECTED_HASHES[][SIP_HASH_128_BYTES] = {
+        { 0xa3, 0x81, 0x7f, 0x04, 0xba, 0x25, 0xa8, 0xe6, 0x6d, 0xf6, 0x72, 0x14, 0xc7, 0x55, 0x02, 0x93 },
+        { 0xda, 0x87, 0xc1, 0xd8, 0x6b, 0x99, 0xaf, 0x44, 0x34, 0x76, 0x59, 0x11, 0x9b, 0x22, 0xfc, 0x45 }
+    };
+    const int NUM_EXPECTED_HASHES = sizeof(EXPECTED_HASHES) / sizeof(EXPECTED_HASHES[0]);
+    
+    unsigned char key[SIP_HASH_KEY_BYTES];
+    unsigned char message[NUM_EXPECTED_HASHES];
+    for (int i = 0; i < SIP_HASH_KEY_BYTES; i++) {
+        key[i] = i;
+    }
+    for (int i = 0; i < NUM_EXPECTED_HASHES; i++) {
+        message[i] = i;
+    }
+    
+    for (int length = 0; length < NUM_EXPECTED_HASHES; length++) {
+        unsigned char hash[SIP_HASH_128_BYTES];
+        sipHash128(key, message, length, hash);
+        if (memcmp(hash, EXPECTED_HASHES[length], SIP_HASH_128_BYTES) != 0) {
+            qDebug() << "FAIL: SipHash of the" << length << "byte reference message doesn't match the reference";
+        }
+    }
+}
+
+void SipHashTests::keyAndMessageTest() {
+    unsigned char key[SIP_HASH_KEY_BYTES];
+    memset(key, 0x5a, SIP_HASH_KEY_BYTES);
+    
+    // a packet long enough to have full words and a partial one
+    const int MESSAGE_BYTES = 61;
+    unsigned char message[MESSAGE_BYTES];
+    for (int i = 0; i < MESSAGE_BYTES; i++) {
+        message[i] = (unsigned char) (i * 7);
+    }
+    
+    unsigned char hash[SIP_HASH_128_BYTES];
+    sipHash128(key, message, MESSAGE_BYTES, hash);
+    
+    unsigned char sameHash[SIP_HASH_128_BYTES];
+    sipHash128(key, message, MESSAGE_BYTES, sameHash);
+    if (memcmp(hash, sameHash, SIP_HASH_128_BYTES) != 0) {
+        qDebug() << "FAIL: SipHash of the same message and key differs";
+    }
+    
+    // any one bit of the message or the key changes the hash
+    for (int i = 0; i < MESSAGE_BYTES; i++) {
+        message[i] ^= 1;
+        unsigned char otherHash[SIP_HASH_128_BYTES];
+        sipHash128(key, message, MESSAGE_BYTES, otherHash);
+        if (memcmp(hash, otherHash, SIP_HASH_128_BYTES) == 0) {
+            qDebug() << "FAIL: SipHash doesn't change with byte" << i << "of the message";
+        }
+        message[i] ^= 1;
+    }
+    for (int i = 0; i < SIP_HASH_KEY_BYTES; i++) {
+        key[i] ^= 1;
+        unsigned char otherHash[SIP_HASH_128_BYTES];
+        sipHash128(key, message, MESSAGE_BYTES, otherHash);
+        if (memcmp(hash, otherHash, SIP_HASH_128_BYTES) == 0) {
+            qDebug() << "FAIL: SipHash doesn't change with byte" << i << "of the key";
+        }
+        key[i] ^= 1;
+    }
+    
+    // a shorter message isn't the same as a longer one padded with zeros
+    unsigned char paddedMessage[8] = { 1, 2, 3, 0, 0, 0, 0, 0 };
+    unsigned char shortHash[SIP_HASH_128_BYTES], paddedHash[SIP_HASH_128_BYTES];
+    sipHash128(key, paddedMessage, 3, shortHash);
+    sipHash128(key, paddedMessage, 8, paddedHash);
+    if (memcmp(shortHash, paddedHash, SIP_HASH_128_BYTES) == 0) {
+        qDebug() << "FAIL: SipHash of a message is the same as of it padded with zeros";
+    }
+}
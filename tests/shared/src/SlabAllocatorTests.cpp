@@ -0,0 +1,97 @@
+//
+//  SlabAllocatorTests.cpp
+//  tests/shared/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#include <cstring>
+
+#include <QtCore/QDebug>
+#include <QtCore/QSet>
+#include <QtCore/QVector>
+
+#include "SlabAllocator.h"
+
+#include "SlabAllocatorTests.h"
+
+void SlabAllocatorTests::runAllTests() {
+    reuseTest();
+    releaseTest();
+}
+
+void SlabAllocatorTests::reuseTest() {
+    SlabAllocator allocator(20, 4);
+    if (allocator.getBlockSize() != 32) {
+        qDebug() << "FAIL: blocks of 20 bytes were rounded to" << allocator.getBlockSize() << "rather than 32";
+    }
+    
+    // more blocks than a slab holds, each written over in full
+    const int NUM_BLOCKS = 10;
+    QVector<void*> blocks;
+    QSet<void*> distinctBlocks;
+    for (int i = 0; i < NUM_BLOCKS; i++) {
+        void* block = allocator.allocate();
+        memset(block, i, allocator.getBlockSize());
+        blocks.append(block);
+        distinctBlocks.insert(block);
+    }
+    if (distinctBlocks.size() != NUM_BLOCKS) {
+        qDebug() << "FAIL: the same block was handed out twice";
+    }
+    for (int i = 0; i < NUM_BLOCKS; i++) {
+        if (static_cast<unsigned char*>(blocks.at(i))[allocator.getBlockSize() - 1] != i) {
+            qDebug() << "FAIL: block" << i << "was written over by another";
+        }
+    }
+    if (allocator.getNumSlabs() != 3 || allocator.getNumBlocksInUse() != NUM_BLOCKS) {
+        qDebug() << "FAIL:" << allocator.getNumSlabs() << "slabs for" << allocator.getNumBlocksInUse() << "blocks";
+    }
+    
+    // a freed block is the next handed out
+    allocator.deallocate(blocks.at(3));
+    if (allocator.allocate() != blocks.at(3)) {
+        qDebug() << "FAIL: a freed block wasn't reused";
+    }
+}
+
+void SlabAllocatorTests::releaseTest() {
+    SlabAllocator allocator(16, 4);
+    QVector<void*> blocks;
+    for (int i = 0; i < 8; i++) {
+        blocks.append(allocator.allocate());
+    }
+    
+    // free all but one block, so that one slab is left in use
+    void* keptBlock = blocks.at(5);
+    foreach (void* block, blocks) {
+        if (block != keptBlock) {
+            allocator.deallocate(block);
+        }
+    }
+    allocator.releaseUnusedSlabs();
+    if (allocator.getNumSlabs() != 1) {
+        qDebug() << "FAIL:" << allocator.getNumSlabs() << "slabs are left rather than the one in use";
+    }
+    
+    // the kept slab's other three blocks are still free to hand out before another slab is needed
+    QSet<void*> reused;
+    for (int i = 0; i < 3; i++) {
+        reused.insert(allocator.allocate());
+    }
+    if (reused.contains(keptBlock) || allocator.getNumSlabs() != 1) {
+        qDebug() << "FAIL: the blocks left in the kept slab weren't handed out again";
+    }
+    
+    allocator.deallocate(keptBlock);
+    foreach (void* block, reused) {
+        allocator.deallocate(block);
+    }
+    allocator.releaseUnusedSlabs();
+    if (allocator.getNumSlabs() != 0 || allocator.getNumBlocksInUse() != 0) {
+        qDebug() << "FAIL: an empty allocator kept" << allocator.getNumSlabs() << "slabs";
+    }
+}
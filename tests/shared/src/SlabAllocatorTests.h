@@ -0,0 +1,22 @@
+//
+//  SlabAllocatorTests.h
+//  tests/shared/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#ifndef hifi_SlabAllocatorTests_h
+#define hifi_SlabAllocatorTests_h
+
+namespace SlabAllocatorTests {
+
+    void runAllTests();
+    
+    void reuseTest();
+    void releaseTest();
+}
+
+#endif // hifi_SlabAllocatorTests_h
@@ -0,0 +1,113 @@
+//
+//  TripleBufferTests.cpp
+//  tests/shared/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#include <QtCore/QDebug>
+#include <QtCore/QThread>
+
+#include "TripleBuffer.h"
+
+#include "TripleBufferTests.h"
+
+void TripleBufferTests::runAllTests() {
+    latestValueTest();
+    threadedTest();
+}
+
+void TripleBufferTests::latestValueTest() {
+    TripleBuffer<int> buffer;
+    if (buffer.update() || buffer.getReadBuffer() != 0) {
+        qDebug() << "FAIL: a buffer nothing was published to gave back" << buffer.getReadBuffer();
+    }
+
+    // a few rounds, some publishing more than once before the value's taken
+    const int NUM_ROUNDS = 5;
+    for (int round = 1; round <= NUM_ROUNDS; round++) {
+        for (int i = 1; i <= round; i++) {
+            buffer.publish(round * 100 + i);
+        }
+        if (!buffer.hasNewValue()) {
+            qDebug() << "FAIL: the buffer had no new value after round" << round << "was published";
+        }
+        if (!buffer.update() || buffer.getReadBuffer() != round * 100 + round) {
+            qDebug() << "FAIL: round" << round << "gave back" << buffer.getReadBuffer() << "rather than its last value";
+        }
+        if (buffer.update() || buffer.hasNewValue()) {
+            qDebug() << "FAIL: the value of round" << round << "was taken twice";
+        }
+        if (buffer.getReadBuffer() != round * 100 + round) {
+            qDebug() << "FAIL: the value of round" << round << "changed without a publish";
+        }
+    }
+}
+
+class Sample {
+public:
+    int number;
+    int doubled;
+
+    Sample() : number(0), doubled(0) { }
+};
+
+/// publishes numbered samples as fast as it can, filling in each a field at a time so that a torn one would show
+class SampleProducer : public QThread {
+public:
+    SampleProducer(TripleBuffer<Sample>& buffer, int numSamples) : _buffer(buffer), _numSamples(numSamples) { }
+
+protected:
+    virtual void run() {
+        for (int i = 1; i <= _numSamples; i++) {
+            Sample& sample = _buffer.getWriteBuffer();
+            sample.number = i;
+            sample.doubled = i * 2;
+            _buffer.publish();
+        }
+    }
+
+private:
+    TripleBuffer<Sample>& _buffer;
+    int _numSamples;
+};
+
+void TripleBufferTests::threadedTest() {
+    const int NUM_SAMPLES = 1000000;
+    TripleBuffer<Sample> buffer;
+    SampleProducer producer(buffer, NUM_SAMPLES);
+    producer.start();
+
+    // the samples taken have to be whole, and never older than the one taken before
+    int lastNumber = 0;
+    bool isTorn = false;
+    bool isOutOfOrder = false;
+    while (lastNumber < NUM_SAMPLES) {
+        if (!buffer.update()) {
+            QThread::yieldCurrentThread();
+            continue;
+        }
+        const Sample& sample = buffer.getReadBuffer();
+        if (sample.doubled != sample.number * 2) {
+            isTorn = true;
+        }
+        if (sample.number <= lastNumber) {
+            isOutOfOrder = true;
+        }
+        lastNumber = sample.number;
+    }
+    producer.wait();
+
+    if (isTorn) {
+        qDebug() << "FAIL: a sample was taken while it was still being written";
+    }
+    if (isOutOfOrder) {
+        qDebug() << "FAIL: a sample was taken twice or after a newer one";
+    }
+    if (buffer.update()) {
+        qDebug() << "FAIL: there was a new sample after the last one was taken";
+    }
+}
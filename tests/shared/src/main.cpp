@@ -9,10 +9,24 @@
 //
 
 #include "AngularConstraintTests.h"
+#include "BoundedMPSCQueueTests.h"
+#include "CycleCounterTests.h"
+#include "JobGraphTests.h"
 #include "MovingPercentileTests.h"
+#include "OctalCodeTests.h"
+#include "SipHashTests.h"
+#include "SlabAllocatorTests.h"
+#include "TripleBufferTests.h"
 
 int main(int argc, char** argv) {
     MovingPercentileTests::runAllTests();
     AngularConstraintTests::runAllTests();
+    SipHashTests::runAllTests();
+    BoundedMPSCQueueTests::runAllTests();
+    SlabAllocatorTests::runAllTests();
+    CycleCounterTests::runAllTests();
+    OctalCodeTests::runAllTests();
+    JobGraphTests::runAllTests();
+    TripleBufferTests::runAllTests();
     return 0;
 }
@@ -13,58 +13,184 @@
 #include <QCoreApplication>
 #include <QDataStream>
 #include <QFile>
+#include <QRunnable>
+#include <QSet>
+#include <QStringList>
+#include <QThreadPool>
 
 #include <AttributeRegistry.h>
 
 using namespace std;
 
+// enough records in a batch that a thread that finishes early has another to go on with
+const int RECORDS_PER_THREAD_PER_BATCH = 64;
+
+/// Writes out the JSON of a record on a thread of a pool.
+class RecordSerializer : public QRunnable {
+public:
+    RecordSerializer(const QJsonDocument& document, QByteArray& json) : _document(document), _json(json) { }
+
+    virtual void run() {
+        _json = _document.toJson(QJsonDocument::Compact);
+        _json.append('\n');
+    }
+
+private:
+    QJsonDocument _document;
+    QByteArray& _json;
+};
+
+static QByteArray getTypeName(const QVariant& value) {
+    if (value.userType() == qMetaTypeId<GenericValue>()) {
+        return value.value<GenericValue>().getStreamer()->getName();
+    }
+    return value.typeName();
+}
+
+static bool readTypeStreamers(const QStringList& typeNames, QList<const TypeStreamer*>& streamers) {
+    foreach (const QString& typeName, typeNames) {
+        int type = QMetaType::type(typeName.toLatin1());
+        if (type == QMetaType::UnknownType) {
+            cerr << "Unknown type: " << typeName.toLatin1().constData() << endl;
+            return false;
+        }
+        const TypeStreamer* streamer = Bitstream::getTypeStreamer(type);
+        if (!streamer) {
+            cerr << "Non-streamable type: " << typeName.toLatin1().constData() << endl;
+            return false;
+        }
+        streamers.append(streamer);
+    }
+    return true;
+}
+
+/// Reads the input a record at a time, each record a single QVariant, or the given types, starting on a byte, and writes
+/// each as a line of its own: a document with its contents and whatever metadata the lines before it didn't have. The
+/// records are decoded in order, since each one's metadata is mapped by those before it, but their JSON is written out
+/// on the pool's threads.
+static int streamRecords(QFile& inputFile, QFile& outputFile, const QList<const TypeStreamer*>& streamers,
+                         const QSet<QByteArray>& filter, QThreadPool& pool) {
+    QDataStream inputData(&inputFile);
+    Bitstream input(inputData, Bitstream::FULL_METADATA, Bitstream::ALL_GENERICS);
+    JSONWriter output;
+
+    int batchSize = pool.maxThreadCount() * RECORDS_PER_THREAD_PER_BATCH;
+    QVector<QJsonDocument> documents;
+    QVector<QByteArray> lines;
+    int recordsRead = 0;
+    int recordsWritten = 0;
+
+    while (!inputFile.atEnd()) {
+        documents.clear();
+        while (documents.size() < batchSize && !inputFile.atEnd()) {
+            if (streamers.isEmpty()) {
+                QVariant value;
+                input >> value;
+                // the records passed over still have to be read, for the metadata the later ones might refer back to
+                if (filter.isEmpty() || filter.contains(getTypeName(value))) {
+                    output << value;
+                    documents.append(output.takeDocument());
+                }
+            } else {
+                foreach (const TypeStreamer* streamer, streamers) {
+                    QVariant value = streamer->read(input);
+                    output.appendToContents(streamer->getJSONData(output, value));
+                }
+                documents.append(output.takeDocument());
+            }
+            input.reset();
+
+            if (inputData.status() != QDataStream::Ok) {
+                cerr << "Record " << recordsRead << " runs past the end of the input file." << endl;
+                return 1;
+            }
+            recordsRead++;
+        }
+
+        lines.clear();
+        lines.resize(documents.size());
+        for (int i = 0; i < documents.size(); i++) {
+            pool.start(new RecordSerializer(documents.at(i), lines[i]));
+        }
+        pool.waitForDone();
+
+        foreach (const QByteArray& line, lines) {
+            if (outputFile.write(line) != line.size()) {
+                cerr << "Failed to write output file: " << outputFile.errorString().toLatin1().constData() << endl;
+                return 1;
+            }
+        }
+        recordsWritten += lines.size();
+    }
+    cerr << "Read " << recordsRead << " records, wrote " << recordsWritten << "." << endl;
+    return 0;
+}
+
 int main (int argc, char** argv) {
     // need the core application for the script engine
     QCoreApplication app(argc, argv);
-    
-    if (argc < 3) {
-        cerr << "Usage: bitstream2json inputfile outputfile [types...]" << endl;
+
+    QStringList arguments = app.arguments().mid(1);
+    bool stream = false;
+    QSet<QByteArray> filter;
+    QThreadPool pool;
+    while (!arguments.isEmpty() && arguments.first().startsWith("--")) {
+        QString option = arguments.takeFirst();
+        if (option == "--stream") {
+            stream = true;
+
+        } else if (option == "--filter" && !arguments.isEmpty()) {
+            foreach (const QString& typeName, arguments.takeFirst().split(',', QString::SkipEmptyParts)) {
+                filter.insert(typeName.toLatin1());
+            }
+        } else if (option == "--threads" && !arguments.isEmpty()) {
+            pool.setMaxThreadCount(qMax(arguments.takeFirst().toInt(), 1));
+
+        } else {
+            arguments.clear();
+        }
+    }
+    if (arguments.size() < 2) {
+        cerr << "Usage: bitstream2json [--stream [--filter type,...] [--threads count]] inputfile outputfile [types...]"
+            << endl;
         return 0;
     }
-    QFile inputFile(argv[1]);
+    QList<const TypeStreamer*> streamers;
+    if (!readTypeStreamers(arguments.mid(2), streamers)) {
+        return 1;
+    }
+    QFile inputFile(arguments.at(0));
     if (!inputFile.open(QIODevice::ReadOnly)) {
         cerr << "Failed to open input file: " << inputFile.errorString().toLatin1().constData() << endl;
         return 1;
     }
-    QDataStream inputData(&inputFile);
-    Bitstream input(inputData, Bitstream::FULL_METADATA, Bitstream::ALL_GENERICS);
-    
-    QFile outputFile(argv[2]);
+    QFile outputFile(arguments.at(1));
     if (!outputFile.open(QIODevice::WriteOnly)) {
         cerr << "Failed to open output file: " << outputFile.errorString().toLatin1().constData() << endl;
         return 1;
     }
+    if (stream) {
+        return streamRecords(inputFile, outputFile, streamers, filter, pool);
+    }
+
+    QDataStream inputData(&inputFile);
+    Bitstream input(inputData, Bitstream::FULL_METADATA, Bitstream::ALL_GENERICS);
     JSONWriter output;
-    
-    if (argc < 4) {
+
+    if (streamers.isEmpty()) {
         // default type is a single QVariant
         QVariant value;
         input >> value;
         output << value;
-    
+
     } else {
-        for (int i = 3; i < argc; i++) {
-            int type = QMetaType::type(argv[i]);
-            if (type == QMetaType::UnknownType) {
-                cerr << "Unknown type: " << argv[i] << endl;
-                return 1;
-            }
-            const TypeStreamer* streamer = Bitstream::getTypeStreamer(type);
-            if (!streamer) {
-                cerr << "Non-streamable type: " << argv[i] << endl;
-                return 1;
-            }
+        foreach (const TypeStreamer* streamer, streamers) {
             QVariant value = streamer->read(input);
             output.appendToContents(streamer->getJSONData(output, value));
         }
     }
-    
+
     outputFile.write(output.getDocument().toJson());
-    
+
     return 0;
 }
@@ -13,24 +13,178 @@
 #include <QCoreApplication>
 #include <QDataStream>
 #include <QFile>
+#include <QRunnable>
+#include <QScopedPointer>
+#include <QSet>
+#include <QStringList>
+#include <QThreadPool>
 
 #include <AttributeRegistry.h>
 
 using namespace std;
 
+// enough records in a batch that a thread that finishes early has another to go on with
+const int RECORDS_PER_THREAD_PER_BATCH = 64;
+
+/// Parses the JSON of a record on a thread of a pool.
+class RecordParser : public QRunnable {
+public:
+    RecordParser(const QByteArray& json, QJsonDocument& document, QJsonParseError& error) :
+        _json(json), _document(document), _error(error) { }
+
+    virtual void run() { _document = QJsonDocument::fromJson(_json, &_error); }
+
+private:
+    QByteArray _json;
+    QJsonDocument& _document;
+    QJsonParseError& _error;
+};
+
+static QByteArray getTypeName(const QVariant& value) {
+    if (value.userType() == qMetaTypeId<GenericValue>()) {
+        return value.value<GenericValue>().getStreamer()->getName();
+    }
+    return value.typeName();
+}
+
+static bool readTypeStreamers(const QStringList& typeNames, QList<const TypeStreamer*>& streamers) {
+    foreach (const QString& typeName, typeNames) {
+        int type = QMetaType::type(typeName.toLatin1());
+        if (type == QMetaType::UnknownType) {
+            cerr << "Unknown type: " << typeName.toLatin1().constData() << endl;
+            return false;
+        }
+        const TypeStreamer* streamer = Bitstream::getTypeStreamer(type);
+        if (!streamer) {
+            cerr << "Non-streamable type: " << typeName.toLatin1().constData() << endl;
+            return false;
+        }
+        streamers.append(streamer);
+    }
+    return true;
+}
+
+/// Reads the input a line at a time, as bitstream2json --stream writes it, and writes each line's record starting on a
+/// byte. The lines of a batch are parsed on the pool's threads, then read in order, since each one's metadata is mapped
+/// by the lines before it.
+static int streamRecords(QFile& inputFile, QFile& outputFile, const QList<const TypeStreamer*>& streamers,
+                         const QSet<QByteArray>& filter, QThreadPool& pool) {
+    QDataStream outputData(&outputFile);
+    Bitstream output(outputData, Bitstream::FULL_METADATA);
+    QScopedPointer<JSONReader> input;
+
+    int batchSize = pool.maxThreadCount() * RECORDS_PER_THREAD_PER_BATCH;
+    QVector<QByteArray> lines;
+    QVector<QJsonDocument> documents;
+    QVector<QJsonParseError> errors;
+    int recordsRead = 0;
+    int recordsWritten = 0;
+
+    while (!inputFile.atEnd()) {
+        lines.clear();
+        while (lines.size() < batchSize && !inputFile.atEnd()) {
+            QByteArray line = inputFile.readLine().trimmed();
+            if (!line.isEmpty()) {
+                lines.append(line);
+            }
+        }
+
+        documents.clear();
+        documents.resize(lines.size());
+        errors.clear();
+        errors.resize(lines.size());
+        for (int i = 0; i < lines.size(); i++) {
+            pool.start(new RecordParser(lines.at(i), documents[i], errors[i]));
+        }
+        pool.waitForDone();
+
+        for (int i = 0; i < documents.size(); i++) {
+            if (errors.at(i).error != QJsonParseError::NoError) {
+                cerr << "Failed to read record " << recordsRead << ": " <<
+                    errors.at(i).errorString().toLatin1().constData() << endl;
+                return 1;
+            }
+            if (input) {
+                input->addDocument(documents.at(i));
+            } else {
+                input.reset(new JSONReader(documents.at(i), Bitstream::ALL_GENERICS));
+            }
+            recordsRead++;
+
+            if (streamers.isEmpty()) {
+                QVariant value;
+                *input >> value;
+                if (!filter.isEmpty() && !filter.contains(getTypeName(value))) {
+                    continue;
+                }
+                output << value;
+
+            } else {
+                foreach (const TypeStreamer* streamer, streamers) {
+                    QVariant value;
+                    streamer->putJSONData(*input, input->retrieveNextFromContents(), value);
+                    streamer->write(output, value);
+                }
+            }
+            output.flush();
+            recordsWritten++;
+        }
+        if (outputData.status() != QDataStream::Ok) {
+            cerr << "Failed to write output file: " << outputFile.errorString().toLatin1().constData() << endl;
+            return 1;
+        }
+    }
+    cerr << "Read " << recordsRead << " records, wrote " << recordsWritten << "." << endl;
+    return 0;
+}
+
 int main (int argc, char** argv) {
     // need the core application for the script engine
     QCoreApplication app(argc, argv);
-    
-    if (argc < 3) {
-        cerr << "Usage: bitstream2json inputfile outputfile [types...]" << endl;
+
+    QStringList arguments = app.arguments().mid(1);
+    bool stream = false;
+    QSet<QByteArray> filter;
+    QThreadPool pool;
+    while (!arguments.isEmpty() && arguments.first().startsWith("--")) {
+        QString option = arguments.takeFirst();
+        if (option == "--stream") {
+            stream = true;
+
+        } else if (option == "--filter" && !arguments.isEmpty()) {
+            foreach (const QString& typeName, arguments.takeFirst().split(',', QString::SkipEmptyParts)) {
+                filter.insert(typeName.toLatin1());
+            }
+        } else if (option == "--threads" && !arguments.isEmpty()) {
+            pool.setMaxThreadCount(qMax(arguments.takeFirst().toInt(), 1));
+
+        } else {
+            arguments.clear();
+        }
+    }
+    if (arguments.size() < 2) {
+        cerr << "Usage: json2bitstream [--stream [--filter type,...] [--threads count]] inputfile outputfile [types...]"
+            << endl;
         return 0;
     }
-    QFile inputFile(argv[1]);
+    QList<const TypeStreamer*> streamers;
+    if (!readTypeStreamers(arguments.mid(2), streamers)) {
+        return 1;
+    }
+    QFile inputFile(arguments.at(0));
     if (!inputFile.open(QIODevice::ReadOnly)) {
         cerr << "Failed to open input file: " << inputFile.errorString().toLatin1().constData() << endl;
         return 1;
     }
+    QFile outputFile(arguments.at(1));
+    if (!outputFile.open(QIODevice::WriteOnly)) {
+        cerr << "Failed to open output file: " << outputFile.errorString().toLatin1().constData() << endl;
+        return 1;
+    }
+    if (stream) {
+        return streamRecords(inputFile, outputFile, streamers, filter, pool);
+    }
+
     QJsonParseError error;
     QJsonDocument document = QJsonDocument::fromJson(inputFile.readAll(), &error);
     if (error.error != QJsonParseError::NoError) {
@@ -38,39 +192,24 @@ int main (int argc, char** argv) {
         return 1;
     }
     JSONReader input(document, Bitstream::ALL_GENERICS);
-    
-    QFile outputFile(argv[2]);
-    if (!outputFile.open(QIODevice::WriteOnly)) {
-        cerr << "Failed to open output file: " << outputFile.errorString().toLatin1().constData() << endl;
-        return 1;
-    }
+
     QDataStream outputData(&outputFile);
     Bitstream output(outputData, Bitstream::FULL_METADATA);
-    
-    if (argc < 4) {
+
+    if (streamers.isEmpty()) {
         // default type is a single QVariant
         QVariant value;
         input >> value;
         output << value;
-    
+
     } else {
-        for (int i = 3; i < argc; i++) {
-            int type = QMetaType::type(argv[i]);
-            if (type == QMetaType::UnknownType) {
-                cerr << "Unknown type: " << argv[i] << endl;
-                return 1;
-            }
-            const TypeStreamer* streamer = Bitstream::getTypeStreamer(type);
-            if (!streamer) {
-                cerr << "Non-streamable type: " << argv[i] << endl;
-                return 1;
-            }
+        foreach (const TypeStreamer* streamer, streamers) {
             QVariant value;
             streamer->putJSONData(input, input.retrieveNextFromContents(), value);
             streamer->write(output, value);
         }
     }
     output.flush();
-    
+
     return 0;
 }
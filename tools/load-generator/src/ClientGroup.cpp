@@ -0,0 +1,93 @@
+//
+//  ClientGroup.cpp
+//  tools/load-generator/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#include <QtCore/QDebug>
+
+#include <AudioRingBuffer.h>
+#include <SharedUtil.h>
+
+#include "ClientGroup.h"
+
+// the timer ticks more often than anything is sent, so that the sends are close to when they're due
+const int TICK_INTERVAL_MSECS = 2;
+
+// a group that falls further behind than this skips ahead rather than sending a burst, which no real client would
+const quint64 MAX_CATCH_UP_USECS = 100 * USECS_PER_MSEC;
+
+ClientGroup::ClientGroup(const HifiSockAddr& domainServerSockAddr, const BehaviorModel& behavior,
+                         const ServerLoadStatsHash& stats, float avatarSendsPerSecond, quint32 seed) :
+    _domainServerSockAddr(domainServerSockAddr),
+    _behavior(behavior),
+    _stats(stats),
+    _avatarSendIntervalUsecs(USECS_PER_SECOND / avatarSendsPerSecond),
+    _seed(seed),
+    _tickTimer(NULL),
+    _startUsecs(0),
+    _audioFramesSent(0),
+    _avatarSendsDone(0),
+    _checkInsDone(0) {
+}
+
+ClientGroup::~ClientGroup() {
+    qDeleteAll(_clients);
+}
+
+void ClientGroup::start() {
+    _startUsecs = usecMonotonicNow();
+    _tickTimer = new QTimer(this);
+    _tickTimer->setTimerType(Qt::PreciseTimer);
+    connect(_tickTimer, SIGNAL(timeout()), SLOT(tick()));
+    _tickTimer->start(TICK_INTERVAL_MSECS);
+}
+
+void ClientGroup::addClients(int numClients) {
+    for (int i = 0; i < numClients; i++) {
+        // each client wanders and talks differently, but the same from run to run
+        SimulatedClient* client = new SimulatedClient(_domainServerSockAddr, _behavior, _stats,
+                                                      _seed + _clients.size() * 2654435761U);
+        _clients.append(client);
+        client->checkIn();
+    }
+}
+
+void ClientGroup::tick() {
+    quint64 elapsed = usecMonotonicNow() - _startUsecs;
+
+    quint64 audioFramesDue = elapsed / BUFFER_SEND_INTERVAL_USECS;
+    if ((audioFramesDue - _audioFramesSent) * BUFFER_SEND_INTERVAL_USECS > MAX_CATCH_UP_USECS) {
+        qDebug() << "A client group fell" << (audioFramesDue - _audioFramesSent) << "audio frames behind, skipping ahead."
+            << "The load generator needs more threads or fewer clients.";
+        _audioFramesSent = audioFramesDue - 1;
+    }
+    for (; _audioFramesSent < audioFramesDue; _audioFramesSent++) {
+        foreach (SimulatedClient* client, _clients) {
+            client->sendAudioFrame();
+        }
+    }
+
+    quint64 avatarSendsDue = elapsed / _avatarSendIntervalUsecs;
+    if ((avatarSendsDue - _avatarSendsDone) * _avatarSendIntervalUsecs > MAX_CATCH_UP_USECS) {
+        _avatarSendsDone = avatarSendsDue - 1;
+    }
+    float deltaTime = _avatarSendIntervalUsecs / (float)USECS_PER_SECOND;
+    for (; _avatarSendsDone < avatarSendsDue; _avatarSendsDone++) {
+        foreach (SimulatedClient* client, _clients) {
+            client->update(deltaTime);
+        }
+    }
+
+    quint64 checkInsDue = elapsed / USECS_PER_SECOND;
+    if (_checkInsDone < checkInsDue) {
+        _checkInsDone = checkInsDue;
+        foreach (SimulatedClient* client, _clients) {
+            client->checkIn();
+        }
+    }
+}
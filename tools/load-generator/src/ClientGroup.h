@@ -0,0 +1,53 @@
+//
+//  ClientGroup.h
+//  tools/load-generator/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#ifndef hifi_ClientGroup_h
+#define hifi_ClientGroup_h
+
+#include <QtCore/QList>
+#include <QtCore/QObject>
+#include <QtCore/QTimer>
+
+#include "SimulatedClient.h"
+
+/// The simulated clients driven by one thread. A single timer sends all of their audio frames at the network audio
+/// rate, their avatars and views at the avatar rate and their check-ins once a second, catching up on whatever a late
+/// tick missed so that the servers see the rates a real client would send at.
+class ClientGroup : public QObject {
+    Q_OBJECT
+public:
+    ClientGroup(const HifiSockAddr& domainServerSockAddr, const BehaviorModel& behavior,
+                const ServerLoadStatsHash& stats, float avatarSendsPerSecond, quint32 seed);
+    ~ClientGroup();
+
+public slots:
+    void start();
+    void addClients(int numClients);
+
+private slots:
+    void tick();
+
+private:
+    HifiSockAddr _domainServerSockAddr;
+    BehaviorModel _behavior;
+    const ServerLoadStatsHash& _stats;
+    quint64 _avatarSendIntervalUsecs;
+    quint32 _seed;
+
+    QList<SimulatedClient*> _clients;
+    QTimer* _tickTimer;
+
+    quint64 _startUsecs;
+    quint64 _audioFramesSent;
+    quint64 _avatarSendsDone;
+    quint64 _checkInsDone;
+};
+
+#endif // hifi_ClientGroup_h
@@ -0,0 +1,171 @@
+//
+//  LoadGenerator.cpp
+//  tools/load-generator/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#include <QtCore/QDebug>
+#include <QtCore/QFile>
+#include <QtCore/QJsonDocument>
+
+#include <DomainHandler.h>
+#include <SharedUtil.h>
+
+#include "LoadGenerator.h"
+
+const char DOMAIN_OPTION[] = "--domain";
+const char PORT_OPTION[] = "--port";
+const char CLIENTS_OPTION[] = "--clients";
+const char CLIENTS_PER_SECOND_OPTION[] = "--clients-per-second";
+const char BEHAVIOR_OPTION[] = "--behavior";
+const char AVATAR_RATE_OPTION[] = "--avatar-rate";
+const char THREADS_OPTION[] = "--threads";
+const char DURATION_OPTION[] = "--duration";
+const char RESULTS_OPTION[] = "--results";
+const char SEED_OPTION[] = "--seed";
+
+const int DEFAULT_NUM_CLIENTS = 100;
+const int DEFAULT_CLIENTS_PER_SECOND = 50;
+const float DEFAULT_AVATAR_SENDS_PER_SECOND = 60.0f;
+const quint32 DEFAULT_SEED = 1;
+
+const int REPORT_INTERVAL_MSECS = 5000;
+
+LoadGenerator::LoadGenerator(int argc, char* argv[]) :
+    QCoreApplication(argc, argv),
+    _numClients(DEFAULT_NUM_CLIENTS),
+    _clientsPerSecond(DEFAULT_CLIENTS_PER_SECOND),
+    _numClientsAdded(0) {
+
+    NodeType::init();
+    const char** constArgv = const_cast<const char**>(argv);
+
+    const char* domainHostname = getCmdOption(argc, constArgv, DOMAIN_OPTION);
+    const char* domainPort = getCmdOption(argc, constArgv, PORT_OPTION);
+    HifiSockAddr domainServerSockAddr(domainHostname ? domainHostname : "localhost",
+                                      domainPort ? atoi(domainPort) : DEFAULT_DOMAIN_SERVER_PORT);
+
+    if (const char* numClients = getCmdOption(argc, constArgv, CLIENTS_OPTION)) {
+        _numClients = atoi(numClients);
+    }
+    if (const char* clientsPerSecond = getCmdOption(argc, constArgv, CLIENTS_PER_SECOND_OPTION)) {
+        _clientsPerSecond = qMax(atoi(clientsPerSecond), 1);
+    }
+    const char* behaviorName = getCmdOption(argc, constArgv, BEHAVIOR_OPTION);
+    BehaviorModel behavior = BehaviorModel::fromName(behaviorName ? behaviorName : "wander");
+
+    const char* avatarRate = getCmdOption(argc, constArgv, AVATAR_RATE_OPTION);
+    float avatarSendsPerSecond = avatarRate ? qMax((float)atof(avatarRate), 1.0f) : DEFAULT_AVATAR_SENDS_PER_SECOND;
+
+    const char* numThreadsOption = getCmdOption(argc, constArgv, THREADS_OPTION);
+    int numThreads = qMax(numThreadsOption ? atoi(numThreadsOption) : QThread::idealThreadCount(), 1);
+
+    const char* seedOption = getCmdOption(argc, constArgv, SEED_OPTION);
+    quint32 seed = seedOption ? (quint32)strtoul(seedOption, NULL, 10) : DEFAULT_SEED;
+
+    if (const char* resultsFileName = getCmdOption(argc, constArgv, RESULTS_OPTION)) {
+        _resultsFileName = resultsFileName;
+    }
+
+    qDebug() << "Connecting" << _numClients << "clients to the domain at" << domainServerSockAddr << "-"
+        << _clientsPerSecond << "a second on" << numThreads << "threads.";
+
+    _stats.insert(NodeType::AudioMixer, new ServerLoadStats(NodeType::AudioMixer));
+    _stats.insert(NodeType::AvatarMixer, new ServerLoadStats(NodeType::AvatarMixer));
+    _stats.insert(NodeType::VoxelServer, new ServerLoadStats(NodeType::VoxelServer));
+    _stats.insert(NodeType::ParticleServer, new ServerLoadStats(NodeType::ParticleServer));
+    _stats.insert(NodeType::ModelServer, new ServerLoadStats(NodeType::ModelServer));
+
+    for (int i = 0; i < numThreads; i++) {
+        ClientGroup* group = new ClientGroup(domainServerSockAddr, behavior, _stats, avatarSendsPerSecond,
+                                             seed + i * 7919);
+        QThread* thread = new QThread();
+        group->moveToThread(thread);
+        connect(thread, SIGNAL(started()), group, SLOT(start()));
+        connect(thread, SIGNAL(finished()), group, SLOT(deleteLater()));
+        thread->start();
+
+        _groups.append(group);
+        _groupThreads.append(thread);
+    }
+
+    connect(&_addClientsTimer, SIGNAL(timeout()), SLOT(addClients()));
+    _addClientsTimer.start(MSECS_PER_SECOND);
+    addClients();
+
+    connect(&_reportTimer, SIGNAL(timeout()), SLOT(report()));
+    _reportTimer.start(REPORT_INTERVAL_MSECS);
+
+    if (const char* duration = getCmdOption(argc, constArgv, DURATION_OPTION)) {
+        QTimer::singleShot(atoi(duration) * MSECS_PER_SECOND, this, SLOT(finish()));
+    }
+}
+
+LoadGenerator::~LoadGenerator() {
+    // the groups go with their threads, and their clients with them
+    foreach (QThread* thread, _groupThreads) {
+        thread->quit();
+        thread->wait();
+        delete thread;
+    }
+    qDeleteAll(_stats);
+}
+
+void LoadGenerator::addClients() {
+    int numToAdd = qMin(_clientsPerSecond, _numClients - _numClientsAdded);
+    if (numToAdd <= 0) {
+        _addClientsTimer.stop();
+        return;
+    }
+    for (int i = 0; i < _groups.size(); i++) {
+        int numForGroup = numToAdd / _groups.size() + (i < numToAdd % _groups.size() ? 1 : 0);
+        if (numForGroup > 0) {
+            QMetaObject::invokeMethod(_groups.at(i), "addClients", Q_ARG(int, numForGroup));
+        }
+    }
+    _numClientsAdded += numToAdd;
+}
+
+void LoadGenerator::report() {
+    qDebug() << _numClientsAdded << "clients:";
+    foreach (ServerLoadStats* stats, _stats) {
+        QJsonObject interval = stats->takeIntervalReport();
+        if (interval["connected_clients"].toDouble() == 0.0) {
+            continue;
+        }
+        qDebug("    %s: %d connected, ping p50 %.1f ms p99 %.1f ms, %.1f%% of pings lost, %.0f packets/s, "
+               "%.2f%% of sequenced packets lost",
+               qPrintable(NodeType::getNodeTypeName(stats->getServerType())),
+               (int)interval["connected_clients"].toDouble(),
+               interval["ping_p50_usecs"].toDouble() / USECS_PER_MSEC,
+               interval["ping_p99_usecs"].toDouble() / USECS_PER_MSEC,
+               interval["ping_loss"].toDouble() * 100.0,
+               interval["packets_received"].toDouble() * MSECS_PER_SECOND / REPORT_INTERVAL_MSECS,
+               interval["packet_loss"].toDouble() * 100.0);
+    }
+}
+
+void LoadGenerator::finish() {
+    if (!_resultsFileName.isEmpty()) {
+        QJsonObject servers;
+        foreach (ServerLoadStats* stats, _stats) {
+            servers[NodeType::getNodeTypeName(stats->getServerType())] = stats->getTotalReport();
+        }
+        QJsonObject results;
+        results["clients"] = _numClientsAdded;
+        results["servers"] = servers;
+
+        QFile resultsFile(_resultsFileName);
+        if (resultsFile.open(QIODevice::WriteOnly)) {
+            resultsFile.write(QJsonDocument(results).toJson());
+            qDebug() << "Wrote the results to" << _resultsFileName;
+        } else {
+            qDebug() << "Couldn't write the results to" << _resultsFileName;
+        }
+    }
+    quit();
+}
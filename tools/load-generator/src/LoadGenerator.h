@@ -0,0 +1,51 @@
+//
+//  LoadGenerator.h
+//  tools/load-generator/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#ifndef hifi_LoadGenerator_h
+#define hifi_LoadGenerator_h
+
+#include <QtCore/QCoreApplication>
+#include <QtCore/QList>
+#include <QtCore/QThread>
+#include <QtCore/QTimer>
+
+#include "ClientGroup.h"
+#include "ServerLoadStats.h"
+
+/// Connects thousands of simulated clients to a domain, to find how many its servers can take. The clients are added a
+/// batch a second, spread over a group per thread, and what they see of each type of server - ping round trips and
+/// loss, the packets the servers send them and the sequenced ones lost - is reported every few seconds and, at the end
+/// of a timed run, written out as JSON.
+class LoadGenerator : public QCoreApplication {
+    Q_OBJECT
+public:
+    LoadGenerator(int argc, char* argv[]);
+    ~LoadGenerator();
+
+private slots:
+    void addClients();
+    void report();
+    void finish();
+
+private:
+    QString _resultsFileName;
+    int _numClients;
+    int _clientsPerSecond;
+    int _numClientsAdded;
+
+    ServerLoadStatsHash _stats;
+    QList<ClientGroup*> _groups;
+    QList<QThread*> _groupThreads;
+
+    QTimer _addClientsTimer;
+    QTimer _reportTimer;
+};
+
+#endif // hifi_LoadGenerator_h
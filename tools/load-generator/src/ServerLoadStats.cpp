@@ -0,0 +1,104 @@
+//
+//  ServerLoadStats.cpp
+//  tools/load-generator/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#include "ServerLoadStats.h"
+
+ServerLoadStats::ServerLoadStats(NodeType_t serverType) :
+    _serverType(serverType),
+    _connectedClients(0),
+    _pingsSent("pings_sent", "the pings sent to the servers once they were reachable"),
+    _pingRoundTripUsecs("ping_round_trip_usecs", "the round trips of the pings the servers replied to"),
+    _packetsReceived("packets_received", "the packets received from the servers"),
+    _bytesReceived("bytes_received", "the bytes received from the servers"),
+    _packetsLost("packets_lost", "the sequenced packets from the servers that never arrived"),
+    _flightUsecs("flight_usecs", "how long the packets stamped with their send time took to arrive") {
+}
+
+void ServerLoadStats::pingReplied(quint64 roundTripUsecs) {
+    _pingRoundTripUsecs.record(roundTripUsecs);
+}
+
+void ServerLoadStats::packetReceived(int bytes, int packetsLostChange) {
+    _packetsReceived.increment();
+    _bytesReceived.increment(bytes);
+    if (packetsLostChange != 0) {
+        _packetsLost.increment(packetsLostChange);
+    }
+}
+
+void ServerLoadStats::packetFlightTime(qint64 flightUsecs) {
+    // the clocks of a server on another host can put the arrival before the send
+    _flightUsecs.record(qMax(flightUsecs, (qint64)0));
+}
+
+QJsonObject ServerLoadStats::takeIntervalReport() {
+    Snapshot snapshot = takeSnapshot();
+    QJsonObject report = makeReport(snapshot - _lastSnapshot);
+    _lastSnapshot = snapshot;
+    return report;
+}
+
+QJsonObject ServerLoadStats::getTotalReport() {
+    return makeReport(takeSnapshot());
+}
+
+ServerLoadStats::Snapshot::Snapshot() :
+    pingsSent(0),
+    packetsReceived(0),
+    bytesReceived(0),
+    packetsLost(0) {
+}
+
+ServerLoadStats::Snapshot ServerLoadStats::Snapshot::operator-(const Snapshot& earlier) const {
+    Snapshot difference;
+    difference.pingsSent = pingsSent - earlier.pingsSent;
+    difference.pingRoundTrips = pingRoundTrips - earlier.pingRoundTrips;
+    difference.packetsReceived = packetsReceived - earlier.packetsReceived;
+    difference.bytesReceived = bytesReceived - earlier.bytesReceived;
+    difference.packetsLost = packetsLost - earlier.packetsLost;
+    difference.flightTimes = flightTimes - earlier.flightTimes;
+    return difference;
+}
+
+ServerLoadStats::Snapshot ServerLoadStats::takeSnapshot() {
+    Snapshot snapshot;
+    snapshot.pingsSent = _pingsSent.getTotal();
+    snapshot.pingRoundTrips = _pingRoundTripUsecs.getTotals();
+    snapshot.packetsReceived = _packetsReceived.getTotal();
+    snapshot.bytesReceived = _bytesReceived.getTotal();
+    snapshot.packetsLost = _packetsLost.getTotal();
+    snapshot.flightTimes = _flightUsecs.getTotals();
+    return snapshot;
+}
+
+QJsonObject ServerLoadStats::makeReport(const Snapshot& snapshot) const {
+    QJsonObject report;
+    report["connected_clients"] = getConnectedClients();
+
+    // a reply still on its way when the snapshot was taken counts as lost until the next
+    qint64 pingsReplied = snapshot.pingRoundTrips.count;
+    report["pings_sent"] = (double)snapshot.pingsSent;
+    report["ping_loss"] = snapshot.pingsSent > 0 ? qMax(snapshot.pingsSent - pingsReplied, (qint64)0) /
+        (double)snapshot.pingsSent : 0.0;
+    report["ping_p50_usecs"] = snapshot.pingRoundTrips.getValueAtPercentile(0.5f);
+    report["ping_p99_usecs"] = snapshot.pingRoundTrips.getValueAtPercentile(0.99f);
+
+    report["packets_received"] = (double)snapshot.packetsReceived;
+    report["bytes_received"] = (double)snapshot.bytesReceived;
+    report["packets_lost"] = (double)snapshot.packetsLost;
+    qint64 packetsExpected = snapshot.packetsReceived + snapshot.packetsLost;
+    report["packet_loss"] = packetsExpected > 0 ? snapshot.packetsLost / (double)packetsExpected : 0.0;
+
+    if (snapshot.flightTimes.count > 0) {
+        report["flight_p50_usecs"] = snapshot.flightTimes.getValueAtPercentile(0.5f);
+        report["flight_p99_usecs"] = snapshot.flightTimes.getValueAtPercentile(0.99f);
+    }
+    return report;
+}
@@ -0,0 +1,84 @@
+//
+//  ServerLoadStats.h
+//  tools/load-generator/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#ifndef hifi_ServerLoadStats_h
+#define hifi_ServerLoadStats_h
+
+#include <QtCore/QAtomicInt>
+#include <QtCore/QHash>
+#include <QtCore/QJsonObject>
+
+#include <Metrics.h>
+#include <Node.h>
+
+/// What the simulated clients have seen of the servers of one type, summed over all of them: the round trips of their
+/// pings and the pings that went unanswered, and the packets the servers sent them, with the ones lost out of those that
+/// carry sequence numbers and, for the octree servers, how long they took to arrive. The clients record from their group
+/// threads, which the metrics take without locking.
+class ServerLoadStats {
+public:
+    ServerLoadStats(NodeType_t serverType);
+
+    NodeType_t getServerType() const { return _serverType; }
+
+    void clientConnected() { _connectedClients.ref(); }
+    void clientDisconnected() { _connectedClients.deref(); }
+    int getConnectedClients() const { return _connectedClients.load(); }
+
+    void pingSent() { _pingsSent.increment(); }
+    void pingReplied(quint64 roundTripUsecs);
+
+    /// records a packet from the server, with the change it made to the count of those lost if it carries a sequence
+    /// number: up for the ones missing before it, or down if it was one of them
+    void packetReceived(int bytes, int packetsLostChange = 0);
+
+    /// records how long a packet stamped with the time it was sent took to arrive
+    void packetFlightTime(qint64 flightUsecs);
+
+    /// the stats since the last call, for the periodic reports
+    QJsonObject takeIntervalReport();
+
+    /// the stats since the clients started
+    QJsonObject getTotalReport();
+
+private:
+    NodeType_t _serverType;
+    QAtomicInt _connectedClients;
+
+    MetricCounter _pingsSent;
+    MetricHistogram _pingRoundTripUsecs;
+    MetricCounter _packetsReceived;
+    MetricCounter _bytesReceived;
+    MetricCounter _packetsLost;
+    MetricHistogram _flightUsecs;
+
+    class Snapshot {
+    public:
+        Snapshot();
+
+        Snapshot operator-(const Snapshot& earlier) const;
+
+        qint64 pingsSent;
+        MetricHistogram::Totals pingRoundTrips;
+        qint64 packetsReceived;
+        qint64 bytesReceived;
+        qint64 packetsLost;
+        MetricHistogram::Totals flightTimes;
+    };
+
+    Snapshot takeSnapshot();
+    QJsonObject makeReport(const Snapshot& snapshot) const;
+
+    Snapshot _lastSnapshot; /// as of the last interval report
+};
+
+typedef QHash<NodeType_t, ServerLoadStats*> ServerLoadStatsHash;
+
+#endif // hifi_ServerLoadStats_h
@@ -0,0 +1,523 @@
+//
+//  SimulatedClient.cpp
+//  tools/load-generator/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#include <cmath>
+
+#include <QtCore/QDataStream>
+
+#include <glm/gtc/quaternion.hpp>
+
+#include <AudioCodec.h>
+#include <AudioRingBuffer.h>
+#include <NodeList.h>
+#include <OctalCode.h>
+#include <OctreeConstants.h>
+#include <OctreePacketData.h>
+#include <PacketHeaders.h>
+#include <SharedUtil.h>
+#include <ViewFrustum.h>
+
+#include "SimulatedClient.h"
+
+// the clients wander within a square of this size around the origin, in meters
+const float SPAWN_AREA_METERS = 100.0f;
+
+const float HEAD_HEIGHT = 1.6f;
+
+// how far the heading can turn in a second as the avatar wanders, in radians
+const float MAX_TURN_PER_SECOND = 1.0f;
+
+// the view is sent again when it has moved or turned this far, or when it hasn't been sent for a while, as interface does
+const float QUERY_MOVEMENT_METERS = 0.5f;
+const float QUERY_TURN_RADIANS = 0.1f;
+const quint64 QUERY_INTERVAL_USECS = 3 * USECS_PER_SECOND;
+
+// the voxels the builders set, in meters
+const float EDIT_DISTANCE = 2.0f;
+const float EDIT_VOXEL_SIZE = 0.25f;
+
+// the tones the talkers hum, in hertz
+const float MIN_TONE_FREQUENCY = 120.0f;
+const float MAX_TONE_FREQUENCY = 400.0f;
+const float TONE_AMPLITUDE = 4000.0f;
+
+BehaviorModel::BehaviorModel() :
+    walkSpeed(1.5f),
+    talkFraction(0.3f),
+    editsPerSecond(0.0f) {
+}
+
+BehaviorModel BehaviorModel::fromName(const QString& name) {
+    BehaviorModel behavior;
+    if (name == "idle") {
+        behavior.walkSpeed = 0.0f;
+        behavior.talkFraction = 0.0f;
+
+    } else if (name == "builder") {
+        behavior.walkSpeed = 0.5f;
+        behavior.talkFraction = 0.1f;
+        behavior.editsPerSecond = 2.0f;
+    }
+    return behavior;
+}
+
+SimulatedClient::ServerConnection::ServerConnection() :
+    type(NodeType::Unassigned) {
+}
+
+SimulatedClient::SimulatedClient(const HifiSockAddr& domainServerSockAddr, const BehaviorModel& behavior,
+                                 const ServerLoadStatsHash& stats, quint32 seed) :
+    _domainServerSockAddr(domainServerSockAddr),
+    _behavior(behavior),
+    _stats(stats),
+    _randomState(seed ? seed : 1),
+    _connectUUID(QUuid::createUuid()),
+    _domainListVersion(0),
+    _pendingDomainListVersion(0),
+    _numPendingDomainListEntries(0),
+    _isTalking(false),
+    _tonePhase(0.0f),
+    _audioSequenceNumber(0),
+    _lastQueriedHeading(0.0f),
+    _lastQueriedUsecs(0),
+    _editsOwed(0.0f),
+    _editSequenceNumber(0) {
+
+    _socket.bind();
+    connect(&_socket, SIGNAL(readyRead()), SLOT(readPendingDatagrams()));
+
+    _spawnPosition = glm::vec3(nextRandom() * SPAWN_AREA_METERS, 0.0f, nextRandom() * SPAWN_AREA_METERS);
+    _heading = nextRandom() * TWO_PI;
+    _avatar.setPosition(_spawnPosition);
+    _avatar.setOrientation(glm::angleAxis(_heading, glm::vec3(0.0f, 1.0f, 0.0f)));
+
+    float frequency = MIN_TONE_FREQUENCY + nextRandom() * (MAX_TONE_FREQUENCY - MIN_TONE_FREQUENCY);
+    _toneStep = TWO_PI * frequency / SAMPLE_RATE;
+
+    _octreeQuery.setWantLowResMoving(true);
+    _octreeQuery.setWantColor(true);
+    _octreeQuery.setWantDelta(true);
+    _octreeQuery.setWantOcclusionCulling(false);
+    _octreeQuery.setWantCompression(true);
+    _octreeQuery.setCameraFov(DEFAULT_FIELD_OF_VIEW_DEGREES);
+    _octreeQuery.setCameraAspectRatio(DEFAULT_ASPECT_RATIO);
+    _octreeQuery.setCameraNearClip(DEFAULT_NEAR_CLIP);
+    _octreeQuery.setCameraFarClip(DEFAULT_FAR_CLIP);
+    _octreeQuery.setCameraEyeOffsetPosition(glm::vec3());
+    _octreeQuery.setOctreeSizeScale(DEFAULT_OCTREE_SIZE_SCALE);
+    _octreeQuery.setBoundaryLevelAdjust(0);
+    _octreeQuery.setMaxOctreePacketsPerSecond(DEFAULT_MAX_OCTREE_PPS);
+}
+
+SimulatedClient::~SimulatedClient() {
+    foreach (const ServerConnection& server, _servers) {
+        if (!server.activeSocket.isNull()) {
+            _stats.value(server.type)->clientDisconnected();
+        }
+    }
+}
+
+void SimulatedClient::checkIn() {
+    PacketType packetType = _sessionUUID.isNull() ? PacketTypeDomainConnectRequest : PacketTypeDomainListRequest;
+    QByteArray packet = byteArrayWithPopulatedHeader(packetType, _sessionUUID.isNull() ? _connectUUID : _sessionUUID);
+    QDataStream packetStream(&packet, QIODevice::Append);
+
+    // with no public address the domain-server acts as our STUN server
+    packetStream << NodeType::Agent << HifiSockAddr(QHostAddress(), _socket.localPort())
+        << HifiSockAddr(QHostAddress(getHostOrderLocalAddress()), _socket.localPort());
+
+    packetStream << (quint8)_stats.size();
+    foreach (NodeType_t serverType, _stats.keys()) {
+        packetStream << serverType;
+    }
+    packetStream << _domainListVersion;
+
+    _socket.writeDatagram(packet, _domainServerSockAddr.getAddress(), _domainServerSockAddr.getPort());
+
+    sendPings();
+
+    _isTalking = nextRandom() < _behavior.talkFraction;
+}
+
+void SimulatedClient::sendAudioFrame() {
+    ServerConnection* audioMixer = getActiveServerOfType(NodeType::AudioMixer);
+    if (!audioMixer) {
+        return;
+    }
+    PacketType packetType = _isTalking ? PacketTypeMicrophoneAudioNoEcho : PacketTypeSilentAudioFrame;
+    QByteArray packet = byteArrayWithPopulatedHeader(packetType, _sessionUUID);
+    packet.append(reinterpret_cast<const char*>(&_audioSequenceNumber), sizeof(quint16));
+    _audioSequenceNumber++;
+
+    quint8 isStereo = 0;
+    packet.append(isStereo);
+
+    glm::vec3 headPosition = _avatar.getPosition() + glm::vec3(0.0f, HEAD_HEIGHT, 0.0f);
+    glm::quat headOrientation = _avatar.getOrientation();
+    packet.append(reinterpret_cast<const char*>(&headPosition), sizeof(headPosition));
+    packet.append(reinterpret_cast<const char*>(&headOrientation), sizeof(headOrientation));
+    quint8 codec = AudioCodec::PCM;
+    packet.append(codec);
+
+    if (_isTalking) {
+        int16_t samples[NETWORK_BUFFER_LENGTH_SAMPLES_PER_CHANNEL];
+        for (int i = 0; i < NETWORK_BUFFER_LENGTH_SAMPLES_PER_CHANNEL; i++) {
+            samples[i] = (int16_t)(TONE_AMPLITUDE * sinf(_tonePhase));
+            _tonePhase = fmodf(_tonePhase + _toneStep, TWO_PI);
+        }
+        packet.append(reinterpret_cast<const char*>(samples), sizeof(samples));
+    } else {
+        int16_t numSilentSamples = NETWORK_BUFFER_LENGTH_SAMPLES_PER_CHANNEL;
+        packet.append(reinterpret_cast<const char*>(&numSilentSamples), sizeof(numSilentSamples));
+    }
+    writeToServer(packet, *audioMixer);
+}
+
+void SimulatedClient::update(float deltaTime) {
+    if (_behavior.walkSpeed > 0.0f) {
+        // wander, turning back toward the spawn point when too far from it
+        _heading += (nextRandom() * 2.0f - 1.0f) * MAX_TURN_PER_SECOND * deltaTime;
+        glm::vec3 position = _avatar.getPosition();
+        glm::vec3 fromSpawn = position - _spawnPosition;
+        if (glm::length(fromSpawn) > SPAWN_AREA_METERS * 0.5f) {
+            _heading = atan2f(fromSpawn.x, fromSpawn.z);
+        }
+        glm::quat orientation = glm::angleAxis(_heading, glm::vec3(0.0f, 1.0f, 0.0f));
+        _avatar.setOrientation(orientation);
+        _avatar.setPosition(position + orientation * glm::vec3(0.0f, 0.0f, -_behavior.walkSpeed * deltaTime));
+    }
+
+    ServerConnection* avatarMixer = getActiveServerOfType(NodeType::AvatarMixer);
+    if (avatarMixer) {
+        QByteArray packet = byteArrayWithPopulatedHeader(PacketTypeAvatarData, _sessionUUID);
+        packet.append(_avatar.toByteArray());
+        writeToServer(packet, *avatarMixer);
+    }
+
+    sendOctreeQueries();
+
+    _editsOwed += _behavior.editsPerSecond * deltaTime;
+    while (_editsOwed >= 1.0f) {
+        sendVoxelEdit();
+        _editsOwed -= 1.0f;
+    }
+}
+
+void SimulatedClient::readPendingDatagrams() {
+    HifiSockAddr senderSockAddr;
+    QByteArray packet;
+    while (_socket.hasPendingDatagrams()) {
+        packet.resize(_socket.pendingDatagramSize());
+        _socket.readDatagram(packet.data(), packet.size(),
+                             senderSockAddr.getAddressPointer(), senderSockAddr.getPortPointer());
+        processDatagram(packet, senderSockAddr);
+    }
+}
+
+void SimulatedClient::processDatagram(const QByteArray& packet, const HifiSockAddr& senderSockAddr) {
+    if (packet.isEmpty()) {
+        return;
+    }
+    switch (packetTypeForPacket(packet)) {
+        case PacketTypeCoalescedPackets:
+            foreach (const QByteArray& coalescedPacket, packetsFromCoalescedPacket(packet)) {
+                processDatagram(coalescedPacket, senderSockAddr);
+            }
+            break;
+
+        case PacketTypeDomainList:
+            processDomainList(packet);
+            break;
+
+        case PacketTypePing:
+            processPing(packet, senderSockAddr);
+            break;
+
+        case PacketTypePingReply:
+            processPingReply(packet, senderSockAddr);
+            break;
+
+        default: {
+            QHash<QUuid, ServerConnection>::iterator server = _servers.find(uuidFromPacketHeader(packet));
+            if (server != _servers.end()) {
+                processServerData(server.value(), packet);
+            }
+            break;
+        }
+    }
+}
+
+void SimulatedClient::processDomainList(const QByteArray& packet) {
+    QDataStream packetStream(packet);
+    packetStream.skipRawData(numBytesForPacketHeader(packet));
+
+    QUuid newUUID;
+    packetStream >> newUUID;
+    if (newUUID != _sessionUUID) {
+        // a new session starts from nothing
+        foreach (const QUuid& serverUUID, _servers.keys()) {
+            removeServer(serverUUID);
+        }
+        _domainListVersion = 0;
+        _sessionUUID = newUUID;
+    }
+
+    quint32 listVersion;
+    quint16 numEntries;
+    packetStream >> listVersion >> numEntries;
+    if (listVersion != _pendingDomainListVersion) {
+        _pendingDomainListVersion = listVersion;
+        _numPendingDomainListEntries = 0;
+    }
+
+    while (packetStream.device()->pos() < packet.size()) {
+        quint8 isRemoval;
+        QUuid nodeUUID;
+        packetStream >> isRemoval;
+        _numPendingDomainListEntries++;
+
+        if (isRemoval) {
+            packetStream >> nodeUUID;
+            removeServer(nodeUUID);
+            continue;
+        }
+        qint8 nodeType;
+        HifiSockAddr publicSocket, localSocket;
+        QUuid connectionSecret;
+        packetStream >> nodeType >> nodeUUID >> publicSocket >> localSocket >> connectionSecret;
+
+        if (!_stats.contains(nodeType)) {
+            continue;
+        }
+        // a server without a public address is reachable at the domain-server's
+        if (publicSocket.getAddress().isNull()) {
+            publicSocket.setAddress(_domainServerSockAddr.getAddress());
+        }
+        ServerConnection& server = _servers[nodeUUID];
+        if (server.publicSocket != publicSocket || server.localSocket != localSocket) {
+            if (!server.activeSocket.isNull()) {
+                _stats.value(nodeType)->clientDisconnected();
+                server.activeSocket = HifiSockAddr();
+            }
+        }
+        server.type = nodeType;
+        server.uuid = nodeUUID;
+        server.publicSocket = publicSocket;
+        server.localSocket = localSocket;
+        server.connectionSecret = connectionSecret;
+    }
+
+    if (_numPendingDomainListEntries >= numEntries) {
+        _domainListVersion = listVersion;
+    }
+}
+
+void SimulatedClient::processPing(const QByteArray& packet, const HifiSockAddr& senderSockAddr) {
+    QHash<QUuid, ServerConnection>::iterator server = _servers.find(uuidFromPacketHeader(packet));
+    if (server == _servers.end()) {
+        return;
+    }
+    QDataStream pingStream(packet);
+    pingStream.skipRawData(numBytesForPacketHeader(packet));
+    PingType_t pingType;
+    quint64 timeFromPing;
+    pingStream >> pingType >> timeFromPing;
+
+    // the reply is what lets the server pick which of our sockets to send to
+    QByteArray replyPacket = byteArrayWithPopulatedHeader(PacketTypePingReply, _sessionUUID);
+    QDataStream replyStream(&replyPacket, QIODevice::Append);
+    replyStream << pingType << timeFromPing << usecTimestampNow();
+    writeToServer(replyPacket, server.value(), senderSockAddr);
+}
+
+void SimulatedClient::processPingReply(const QByteArray& packet, const HifiSockAddr& senderSockAddr) {
+    QHash<QUuid, ServerConnection>::iterator server = _servers.find(uuidFromPacketHeader(packet));
+    if (server == _servers.end()) {
+        return;
+    }
+    QDataStream replyStream(packet);
+    replyStream.skipRawData(numBytesForPacketHeader(packet));
+    PingType_t pingType;
+    quint64 timeFromPing;
+    replyStream >> pingType >> timeFromPing;
+
+    ServerLoadStats* stats = _stats.value(server->type);
+    if (server->activeSocket.isNull()) {
+        if (pingType == PingType::Local) {
+            server->activeSocket = server->localSocket;
+        } else if (pingType == PingType::Public) {
+            server->activeSocket = server->publicSocket;
+        } else {
+            server->activeSocket = senderSockAddr;
+        }
+        stats->clientConnected();
+
+    } else if (pingType == PingType::Agnostic) {
+        // only the pings to the active socket are counted, since the ones to the other socket may well go unanswered
+        stats->pingReplied(usecTimestampNow() - timeFromPing);
+    }
+}
+
+void SimulatedClient::processServerData(ServerConnection& server, const QByteArray& packet) {
+    ServerLoadStats* stats = _stats.value(server.type);
+    quint32 numLostBefore = server.sequenceStats.getNumLost();
+    int numBytesPacketHeader = numBytesForPacketHeader(packet);
+    const char* dataAt = packet.constData() + numBytesPacketHeader;
+
+    switch (packetTypeForPacket(packet)) {
+        case PacketTypeMixedAudio:
+        case PacketTypeSilentMixedAudio:
+            if (packet.size() >= numBytesPacketHeader + (int)sizeof(quint16)) {
+                server.sequenceStats.sequenceNumberReceived(*reinterpret_cast<const quint16*>(dataAt));
+            }
+            break;
+
+        case PacketTypeVoxelData:
+        case PacketTypeParticleData:
+        case PacketTypeModelData:
+            if (packet.size() >= numBytesPacketHeader + (int)OCTREE_PACKET_EXTRA_HEADERS_SIZE) {
+                dataAt += sizeof(OCTREE_PACKET_FLAGS);
+                server.sequenceStats.sequenceNumberReceived(*reinterpret_cast<const OCTREE_PACKET_SEQUENCE*>(dataAt));
+                dataAt += sizeof(OCTREE_PACKET_SEQUENCE);
+                OCTREE_PACKET_SENT_TIME sentAt = *reinterpret_cast<const OCTREE_PACKET_SENT_TIME*>(dataAt);
+                stats->packetFlightTime((qint64)(usecTimestampNow() - sentAt));
+            }
+            break;
+
+        default:
+            break;
+    }
+    // a late packet that was counted lost takes it back
+    stats->packetReceived(packet.size(), (int)server.sequenceStats.getNumLost() - (int)numLostBefore);
+}
+
+void SimulatedClient::removeServer(const QUuid& uuid) {
+    QHash<QUuid, ServerConnection>::iterator server = _servers.find(uuid);
+    if (server == _servers.end()) {
+        return;
+    }
+    if (!server->activeSocket.isNull()) {
+        _stats.value(server->type)->clientDisconnected();
+    }
+    _servers.erase(server);
+}
+
+SimulatedClient::ServerConnection* SimulatedClient::getActiveServerOfType(NodeType_t type) {
+    for (QHash<QUuid, ServerConnection>::iterator it = _servers.begin(); it != _servers.end(); it++) {
+        if (it->type == type && !it->activeSocket.isNull()) {
+            return &it.value();
+        }
+    }
+    return NULL;
+}
+
+void SimulatedClient::writeToServer(QByteArray& packet, const ServerConnection& server, const HifiSockAddr& sockAddr) {
+    if (!NON_VERIFIED_PACKETS.contains(packetTypeForPacket(packet))) {
+        replaceHashInPacketGivenConnectionUUID(packet, server.connectionSecret);
+    }
+    const HifiSockAddr& destination = sockAddr.isNull() ? server.activeSocket : sockAddr;
+    _socket.writeDatagram(packet, destination.getAddress(), destination.getPort());
+}
+
+void SimulatedClient::sendPings() {
+    for (QHash<QUuid, ServerConnection>::iterator it = _servers.begin(); it != _servers.end(); it++) {
+        ServerConnection& server = it.value();
+        if (server.activeSocket.isNull()) {
+            // punch through to whichever of the server's sockets answers, as NodeList does
+            QByteArray localPing = byteArrayWithPopulatedHeader(PacketTypePing, _sessionUUID);
+            QDataStream localStream(&localPing, QIODevice::Append);
+            localStream << PingType::Local << usecTimestampNow();
+            writeToServer(localPing, server, server.localSocket);
+
+            QByteArray publicPing = byteArrayWithPopulatedHeader(PacketTypePing, _sessionUUID);
+            QDataStream publicStream(&publicPing, QIODevice::Append);
+            publicStream << PingType::Public << usecTimestampNow();
+            writeToServer(publicPing, server, server.publicSocket);
+
+        } else {
+            QByteArray ping = byteArrayWithPopulatedHeader(PacketTypePing, _sessionUUID);
+            QDataStream pingStream(&ping, QIODevice::Append);
+            pingStream << PingType::Agnostic << usecTimestampNow();
+            writeToServer(ping, server);
+            _stats.value(server.type)->pingSent();
+        }
+    }
+}
+
+void SimulatedClient::sendOctreeQueries() {
+    glm::vec3 eyePosition = _avatar.getPosition() + glm::vec3(0.0f, HEAD_HEIGHT, 0.0f);
+    quint64 now = usecTimestampNow();
+    if (glm::distance(eyePosition, _lastQueriedPosition) < QUERY_MOVEMENT_METERS &&
+            fabsf(_heading - _lastQueriedHeading) < QUERY_TURN_RADIANS && now - _lastQueriedUsecs < QUERY_INTERVAL_USECS) {
+        return;
+    }
+    _octreeQuery.setCameraPosition(eyePosition);
+    _octreeQuery.setCameraOrientation(_avatar.getOrientation());
+
+    unsigned char queryPacket[MAX_PACKET_SIZE];
+    bool wasSent = false;
+    for (QHash<QUuid, ServerConnection>::iterator it = _servers.begin(); it != _servers.end(); it++) {
+        const ServerConnection& server = it.value();
+        PacketType packetType;
+        if (server.type == NodeType::VoxelServer) {
+            packetType = PacketTypeVoxelQuery;
+        } else if (server.type == NodeType::ParticleServer) {
+            packetType = PacketTypeParticleQuery;
+        } else if (server.type == NodeType::ModelServer) {
+            packetType = PacketTypeModelQuery;
+        } else {
+            continue;
+        }
+        if (server.activeSocket.isNull()) {
+            continue;
+        }
+        int numBytesPacketHeader = populatePacketHeader(reinterpret_cast<char*>(queryPacket), packetType, _sessionUUID);
+        int packetLength = numBytesPacketHeader + _octreeQuery.getBroadcastData(queryPacket + numBytesPacketHeader);
+        _socket.writeDatagram(reinterpret_cast<const char*>(queryPacket), packetLength,
+                              server.activeSocket.getAddress(), server.activeSocket.getPort());
+        wasSent = true;
+    }
+    if (wasSent) {
+        _lastQueriedPosition = eyePosition;
+        _lastQueriedHeading = _heading;
+        _lastQueriedUsecs = now;
+    }
+}
+
+void SimulatedClient::sendVoxelEdit() {
+    ServerConnection* voxelServer = getActiveServerOfType(NodeType::VoxelServer);
+    if (!voxelServer) {
+        return;
+    }
+    QByteArray packet = byteArrayWithPopulatedHeader(PacketTypeVoxelSet, _sessionUUID);
+    packet.append(reinterpret_cast<const char*>(&_editSequenceNumber), sizeof(_editSequenceNumber));
+    _editSequenceNumber++;
+    quint64 now = usecTimestampNow();
+    packet.append(reinterpret_cast<const char*>(&now), sizeof(now));
+
+    // a voxel in front of the avatar, in tree units
+    float size = EDIT_VOXEL_SIZE / TREE_SCALE;
+    glm::vec3 corner = (_avatar.getPosition() + _avatar.getOrientation() * glm::vec3(0.0f, 0.0f, -EDIT_DISTANCE)) /
+        (float)TREE_SCALE;
+    corner = glm::clamp(corner, glm::vec3(0.0f), glm::vec3(1.0f - size));
+    unsigned char* voxelData = pointToVoxel(corner.x, corner.y, corner.z, size,
+                                            nextRandom() * 255, nextRandom() * 255, nextRandom() * 255);
+    packet.append(reinterpret_cast<const char*>(voxelData), bytesRequiredForCodeLength(*voxelData) + BYTES_PER_COLOR);
+    delete[] voxelData;
+
+    writeToServer(packet, *voxelServer);
+}
+
+float SimulatedClient::nextRandom() {
+    _randomState ^= _randomState << 13;
+    _randomState ^= _randomState >> 17;
+    _randomState ^= _randomState << 5;
+    return (_randomState >> 8) / (float)(1 << 24);
+}
@@ -0,0 +1,128 @@
+//
+//  SimulatedClient.h
+//  tools/load-generator/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#ifndef hifi_SimulatedClient_h
+#define hifi_SimulatedClient_h
+
+#include <QtCore/QHash>
+#include <QtCore/QObject>
+#include <QtCore/QUuid>
+#include <QtNetwork/QUdpSocket>
+
+#include <glm/glm.hpp>
+
+#include <AvatarData.h>
+#include <HifiSockAddr.h>
+#include <OctreeQuery.h>
+#include <SequenceNumberStats.h>
+
+#include "ServerLoadStats.h"
+
+/// How a simulated client behaves: how fast it wanders, how much of the time it talks, and how many voxels it edits.
+class BehaviorModel {
+public:
+    BehaviorModel();
+
+    /// returns the model with the given name - idle, wander or builder - or the wandering one for an unknown name
+    static BehaviorModel fromName(const QString& name);
+
+    float walkSpeed; /// meters per second
+    float talkFraction; /// the chance, each second, of talking for that second
+    float editsPerSecond; /// voxels set in front of the avatar
+};
+
+/// A client of the domain that is all protocol and no rendering: it checks in with the domain-server as an agent, makes
+/// itself reachable to the mixers and octree servers, and sends them what an interface would - its avatar, its
+/// microphone, the view it wants voxels for and its edits - as its behavior model moves it around. It has a socket of
+/// its own, since the servers tell their clients apart by address, and lives on the thread of the group that drives it.
+class SimulatedClient : public QObject {
+    Q_OBJECT
+public:
+    SimulatedClient(const HifiSockAddr& domainServerSockAddr, const BehaviorModel& behavior,
+                    const ServerLoadStatsHash& stats, quint32 seed);
+    ~SimulatedClient();
+
+    /// checks in with the domain-server and pings the servers, once a second
+    void checkIn();
+
+    /// sends a frame of the microphone to the audio-mixer, at the network audio rate
+    void sendAudioFrame();
+
+    /// moves the avatar and sends it, the view and any edits to the servers
+    void update(float deltaTime);
+
+private slots:
+    void readPendingDatagrams();
+
+private:
+    class ServerConnection {
+    public:
+        ServerConnection();
+
+        NodeType_t type;
+        QUuid uuid;
+        HifiSockAddr publicSocket;
+        HifiSockAddr localSocket;
+        HifiSockAddr activeSocket; /// the one a ping reply came back from
+        QUuid connectionSecret;
+        SequenceNumberStats sequenceStats;
+    };
+
+    void processDatagram(const QByteArray& packet, const HifiSockAddr& senderSockAddr);
+    void processDomainList(const QByteArray& packet);
+    void processPing(const QByteArray& packet, const HifiSockAddr& senderSockAddr);
+    void processPingReply(const QByteArray& packet, const HifiSockAddr& senderSockAddr);
+    void processServerData(ServerConnection& server, const QByteArray& packet);
+
+    void removeServer(const QUuid& uuid);
+    ServerConnection* getActiveServerOfType(NodeType_t type);
+
+    /// hashes the packet with the server's secret and sends it to the given socket, or to the server's active one
+    void writeToServer(QByteArray& packet, const ServerConnection& server,
+                       const HifiSockAddr& sockAddr = HifiSockAddr());
+    void sendPings();
+    void sendOctreeQueries();
+    void sendVoxelEdit();
+
+    /// returns a value from zero up to but not including one
+    float nextRandom();
+
+    HifiSockAddr _domainServerSockAddr;
+    BehaviorModel _behavior;
+    const ServerLoadStatsHash& _stats;
+    QUdpSocket _socket;
+    quint32 _randomState;
+
+    QUuid _sessionUUID; /// null until the domain-server has let us in
+    QUuid _connectUUID; /// sent in the connect requests until then, so our packets have a header of our own
+    quint32 _domainListVersion;
+    quint32 _pendingDomainListVersion;
+    int _numPendingDomainListEntries;
+    QHash<QUuid, ServerConnection> _servers;
+
+    AvatarData _avatar;
+    glm::vec3 _spawnPosition;
+    float _heading; /// radians about the y axis
+
+    bool _isTalking;
+    float _tonePhase;
+    float _toneStep;
+    quint16 _audioSequenceNumber;
+
+    OctreeQuery _octreeQuery;
+    glm::vec3 _lastQueriedPosition;
+    float _lastQueriedHeading;
+    quint64 _lastQueriedUsecs;
+
+    float _editsOwed;
+    quint16 _editSequenceNumber;
+};
+
+#endif // hifi_SimulatedClient_h
@@ -0,0 +1,22 @@
+//
+//  main.cpp
+//  tools/load-generator/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#include <cstdio>
+
+#include "LoadGenerator.h"
+
+int main(int argc, char* argv[]) {
+#ifndef WIN32
+    setvbuf(stdout, NULL, _IOLBF, 0);
+#endif
+
+    LoadGenerator loadGenerator(argc, argv);
+    return loadGenerator.exec();
+}
@@ -102,6 +102,11 @@ void generateOutput (QTextStream& out, const QList<Streamable>& streamables) {
 
         out << "const int " << name << "::Type = registerStreamableMetaType<" << name << ">();\n";
 
+        out << "const TypeStreamer* " << name << "::getTypeStreamer() {\n";
+        out << "    static const TypeStreamer* streamer = Bitstream::getTypeStreamer(Type);\n";
+        out << "    return streamer;\n";
+        out << "}\n";
+
         out << "const QVector<MetaField>& " << name << "::getMetaFields() {\n";
         out << "    static QVector<MetaField> metaFields = QVector<MetaField>()";
         foreach (const QString& base, str.clazz.bases) {
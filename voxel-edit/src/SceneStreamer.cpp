@@ -0,0 +1,223 @@
+//
+//  SceneStreamer.cpp
+//  voxel-edit/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#include <cstring>
+
+#include <QtCore/QDebug>
+#include <QtCore/QFile>
+#include <QtCore/QRunnable>
+#include <QtCore/QThreadPool>
+
+#include <PacketHeaders.h>
+#include <Radix2InplaceSort.h>
+#include <Radix2IntegerScanner.h>
+#include <SVOFileReader.h>
+#include <VoxelTree.h>
+
+#include "SceneStreamer.h"
+
+// enough subtrees in a batch that a thread that finishes early has another to go on with
+const int SUBTREES_PER_THREAD_PER_BATCH = 4;
+
+// the longest code a streamed voxel can have, with its length
+const int MAX_STREAMED_CODE_BYTES = 1 + (OCTAL_KEY_SECTIONS_PER_WORD * BITS_IN_OCTAL + 7) / 8;
+
+StreamedVoxel makeStreamedVoxel(int sections, quint32 x, quint32 y, quint32 z,
+                                unsigned char red, unsigned char green, unsigned char blue) {
+    StreamedVoxel voxel;
+    voxel.code = 0;
+    voxel.sections = sections;
+    for (int i = 0; i < sections; i++) {
+        int bit = sections - 1 - i;
+        quint64 childIndex = (((x >> bit) & 1) << 2) | (((y >> bit) & 1) << 1) | ((z >> bit) & 1);
+        voxel.code |= childIndex << ((OCTAL_KEY_SECTIONS_PER_WORD - 1 - i) * BITS_IN_OCTAL);
+    }
+    voxel.color[RED_INDEX] = red;
+    voxel.color[GREEN_INDEX] = green;
+    voxel.color[BLUE_INDEX] = blue;
+    return voxel;
+}
+
+int sectionsForVoxelSize(float voxelSize) {
+    int sections = 0;
+    for (float size = 1.0f; size > voxelSize && sections < OCTAL_KEY_SECTIONS_PER_WORD; size /= 2.0f) {
+        sections++;
+    }
+    return sections;
+}
+
+/// Sorts streamed voxels by their codes, the sections in the high word of their keys.
+class StreamedVoxelScanner : public Radix2IntegerScanner<quint64> {
+public:
+    StreamedVoxelScanner() : Radix2IntegerScanner<quint64>(OCTAL_KEY_SECTIONS_PER_WORD * BITS_IN_OCTAL) { }
+
+    bool bit(const StreamedVoxel& voxel, state_type s) const { return Radix2IntegerScanner<quint64>::bit(voxel.code, s); }
+};
+
+/// Builds and encodes one of the subtrees of a streamed scene on a thread of a pool.
+class SubtreeStreamer : public QRunnable {
+public:
+    SubtreeStreamer(const QList<const StreamedScene*>& scenes, const OctalKey& key, QVector<QByteArray>& slices) :
+        _scenes(scenes), _key(key), _slices(slices) { }
+
+    virtual void run();
+
+private:
+    const QList<const StreamedScene*>& _scenes;
+    OctalKey _key;
+    QVector<QByteArray>& _slices;
+};
+
+void SubtreeStreamer::run() {
+    VoxelPositionSize cube;
+    voxelDetailsForKey(_key, cube);
+
+    QVector<StreamedVoxel> voxels;
+    foreach (const StreamedScene* scene, _scenes) {
+        if (scene->touches(cube)) {
+            scene->addVoxels(cube, voxels);
+        }
+    }
+    if (voxels.isEmpty()) {
+        return;
+    }
+    int shallowestSections = OCTAL_KEY_SECTIONS_PER_WORD;
+    int deepestSections = 0;
+    foreach (const StreamedVoxel& voxel, voxels) {
+        shallowestSections = qMin(shallowestSections, (int)voxel.sections);
+        deepestSections = qMax(deepestSections, (int)voxel.sections);
+    }
+
+    // in Morton order, each voxel is read in beside the one before it rather than somewhere else in the tree
+    radix2InplaceSort<StreamedVoxelScanner>(voxels.begin(), voxels.end());
+
+    // where the scenes overlap, the smaller voxels are read in last and so split the larger ones
+    VoxelTree tree;
+    unsigned char codeColorBuffer[MAX_STREAMED_CODE_BYTES + BYTES_PER_COLOR];
+    for (int sections = shallowestSections; sections <= deepestSections; sections++) {
+        foreach (const StreamedVoxel& voxel, voxels) {
+            if (voxel.sections != sections) {
+                continue;
+            }
+            OctalKey key = { voxel.code, 0, voxel.sections };
+            size_t codeLength = copyOctalCodeForKey(key, codeColorBuffer);
+            memcpy(codeColorBuffer + codeLength, voxel.color, BYTES_PER_COLOR);
+            tree.readCodeColorBufferToTree(codeColorBuffer, true);
+        }
+    }
+
+    OctreeElement* subtree = tree.getOctreeElementAt(cube.x, cube.y, cube.z, cube.s);
+    if (subtree && !tree.encodeSubtreeToChunks(subtree, MAX_OCTREE_PACKET_DATA_SIZE, _slices)) {
+        qDebug("A voxel in the subtree at %f, %f, %f didn't fit in a slice by itself.", cube.x, cube.y, cube.z);
+    }
+}
+
+SceneStreamer::SceneStreamer(int subtreeSections) :
+    _subtreeSections(qBound(0, subtreeSections, OCTAL_KEY_SECTIONS_PER_WORD)) {
+}
+
+bool SceneStreamer::writeToSVOFile(const QString& fileName) {
+    // an index left from the last save would no longer match the file
+    QFile::remove(SVOFileReader::getIndexFileName(fileName));
+
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        qDebug() << "Couldn't open" << fileName << "to stream the scene to.";
+        return false;
+    }
+    qDebug() << "Streaming the scene to" << fileName << "...";
+
+    // no subtree can be smaller than the scenes' voxels, which have to fit in one
+    int subtreeSections = _subtreeSections;
+    foreach (const StreamedScene* scene, _scenes) {
+        subtreeSections = qMin(subtreeSections, scene->getShallowestSections());
+    }
+
+    qint64 fileSize = 0;
+    VoxelTree versionTree;
+    if (versionTree.getWantSVOfileVersions()) {
+        PacketType expectedType = versionTree.expectedDataPacketType();
+        PacketVersion expectedVersion = versionForPacketType(expectedType);
+        fileSize += file.write(reinterpret_cast<const char*>(&expectedType), sizeof(expectedType));
+        fileSize += file.write(reinterpret_cast<const char*>(&expectedVersion), sizeof(expectedVersion));
+    }
+
+    QThreadPool pool;
+    int batchSize = pool.maxThreadCount() * SUBTREES_PER_THREAD_PER_BATCH;
+
+    QVector<qint64> sliceStarts;
+    QVector<OctalKey> pending;
+    OctalKey rootKey = { 0, 0, 0 };
+    pending.append(rootKey);
+    QVector<OctalKey> batch;
+    QVector<QVector<QByteArray> > batchSlices;
+    int subtreesWritten = 0;
+
+    while (!pending.isEmpty()) {
+        // the next subtrees the scenes touch, in the order they're encoded in. The untouched parts of the universe
+        // are passed over whole, rather than a subtree at a time
+        batch.clear();
+        while (!pending.isEmpty() && batch.size() < batchSize) {
+            OctalKey key = pending.last();
+            pending.removeLast();
+
+            VoxelPositionSize cube;
+            voxelDetailsForKey(key, cube);
+            if (!touches(cube)) {
+                continue;
+            }
+            if (key.sections == subtreeSections) {
+                batch.append(key);
+            } else {
+                for (int i = NUMBER_OF_CHILDREN - 1; i >= 0; i--) {
+                    pending.append(childOctalKey(key, i));
+                }
+            }
+        }
+
+        batchSlices.clear();
+        batchSlices.resize(batch.size());
+        for (int i = 0; i < batch.size(); i++) {
+            pool.start(new SubtreeStreamer(_scenes, batch.at(i), batchSlices[i]));
+        }
+        pool.waitForDone();
+
+        foreach (const QVector<QByteArray>& slices, batchSlices) {
+            foreach (const QByteArray& slice, slices) {
+                sliceStarts.append(fileSize);
+                fileSize += file.write(slice);
+            }
+        }
+        subtreesWritten += batch.size();
+        qDebug("Streamed %d subtrees, %d slices, %lld bytes...", subtreesWritten, sliceStarts.size(), fileSize);
+    }
+
+    file.close();
+    if (file.error() != QFile::NoError) {
+        qDebug() << "Couldn't write the scene to" << fileName << "-" << file.errorString();
+        return false;
+    }
+
+    // the index lets the file be read back a packet at a time
+    if (!sliceStarts.isEmpty()) {
+        SVOFileReader::writeIndex(fileName, fileSize, sliceStarts);
+    }
+    qDebug() << "DONE streaming the scene to" << fileName;
+    return true;
+}
+
+bool SceneStreamer::touches(const VoxelPositionSize& cube) const {
+    foreach (const StreamedScene* scene, _scenes) {
+        if (scene->touches(cube)) {
+            return true;
+        }
+    }
+    return false;
+}
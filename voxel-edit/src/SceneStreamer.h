@@ -0,0 +1,71 @@
+//
+//  SceneStreamer.h
+//  voxel-edit/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#ifndef hifi_SceneStreamer_h
+#define hifi_SceneStreamer_h
+
+#include <QtCore/QList>
+#include <QtCore/QVector>
+
+#include <OctalCode.h>
+#include <SharedUtil.h>
+
+/// A voxel of a streamed scene. Its code is the high word of its OctalKey, which is the Morton code of its corner at its
+/// depth, so that sorting the voxels by it puts those of each subtree together and in the order they're encoded in.
+struct StreamedVoxel {
+    quint64 code;
+    quint8 sections;
+    rgbColor color;
+};
+
+/// the streamed voxel of a color at a depth, whose corner is at x, y, z in voxels of that depth
+StreamedVoxel makeStreamedVoxel(int sections, quint32 x, quint32 y, quint32 z,
+                                unsigned char red, unsigned char green, unsigned char blue);
+
+/// the depth of the voxels of a size, which is a power of two
+int sectionsForVoxelSize(float voxelSize);
+
+/// A scene that can give its voxels a part of the universe at a time, rather than all of them to a tree at once.
+class StreamedScene {
+public:
+    virtual ~StreamedScene() { }
+
+    /// the depth of the scene's largest voxels, none of the parts asked for are bigger than them
+    virtual int getShallowestSections() const = 0;
+
+    /// whether any of the scene's voxels are in the cube, so that the empty parts of the universe can be passed over
+    virtual bool touches(const VoxelPositionSize& cube) const = 0;
+
+    /// adds the scene's voxels in the cube to the list, in any order. Called on several threads at once.
+    virtual void addVoxels(const VoxelPositionSize& cube, QVector<StreamedVoxel>& voxels) const = 0;
+};
+
+/// Writes scenes to an SVO file a subtree at a time, without ever having the whole of them in a tree. The universe is
+/// cut into subtrees at a depth, and those that the scenes touch are visited in the order they're encoded in. A batch
+/// of them at a time is built on the threads of a pool - each subtree's voxels are gathered, sorted by their Morton
+/// codes, read into a tree of their own and encoded into slices - and then written out in order, so that the file and
+/// its index come out as Octree::writeToSVOFile would write them.
+class SceneStreamer {
+public:
+    SceneStreamer(int subtreeSections);
+
+    void addScene(const StreamedScene* scene) { _scenes.append(scene); }
+
+    /// returns false if the file couldn't be written
+    bool writeToSVOFile(const QString& fileName);
+
+private:
+    bool touches(const VoxelPositionSize& cube) const;
+
+    int _subtreeSections;
+    QList<const StreamedScene*> _scenes;
+};
+
+#endif // hifi_SceneStreamer_h
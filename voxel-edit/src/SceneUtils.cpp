@@ -15,47 +15,118 @@
 
 #include "SceneUtils.h"
 
+/// A corner point, at the near (0) or far (1) end of each axis.
+struct CornerPoint {
+    int x, y, z;
+    unsigned char red, green, blue;
+};
+
+const CornerPoint CORNER_POINTS[] = {
+    { 0, 0, 0, 255, 255, 255 },
+    { 1, 0, 0, 255, 0,   0   },
+    { 0, 1, 0, 0,   255, 0   },
+    { 0, 0, 1, 0,   0,   255 },
+    { 1, 0, 1, 255, 0,   255 },
+    { 0, 1, 1, 0,   255, 255 },
+    { 1, 1, 0, 255, 255, 0   },
+    { 1, 1, 1, 255, 255, 255 }
+};
+const int NUM_CORNER_POINTS = sizeof(CORNER_POINTS) / sizeof(CORNER_POINTS[0]);
+
 void addCornersAndAxisLines(VoxelTree* tree) {
-    // We want our corner voxels to be about 1/2 meter high, and our TREE_SCALE is in meters, so...    
-    float voxelSize = 0.5f / TREE_SCALE;
-    
     // Now some more examples... a little more complex
     qDebug("creating corner points...");
-    tree->createVoxel(0              , 0              , 0              , voxelSize, 255, 255 ,255);
-    tree->createVoxel(1.0 - voxelSize, 0              , 0              , voxelSize, 255, 0   ,0  );
-    tree->createVoxel(0              , 1.0 - voxelSize, 0              , voxelSize, 0  , 255 ,0  );
-    tree->createVoxel(0              , 0              , 1.0 - voxelSize, voxelSize, 0  , 0   ,255);
-    tree->createVoxel(1.0 - voxelSize, 0              , 1.0 - voxelSize, voxelSize, 255, 0   ,255);
-    tree->createVoxel(0              , 1.0 - voxelSize, 1.0 - voxelSize, voxelSize, 0  , 255 ,255);
-    tree->createVoxel(1.0 - voxelSize, 1.0 - voxelSize, 0              , voxelSize, 255, 255 ,0  );
-    tree->createVoxel(1.0 - voxelSize, 1.0 - voxelSize, 1.0 - voxelSize, voxelSize, 255, 255 ,255);
+    for (int i = 0; i < NUM_CORNER_POINTS; i++) {
+        const CornerPoint& corner = CORNER_POINTS[i];
+        tree->createVoxel(corner.x * (1.0f - CORNER_VOXEL_SIZE), corner.y * (1.0f - CORNER_VOXEL_SIZE),
+                          corner.z * (1.0f - CORNER_VOXEL_SIZE), CORNER_VOXEL_SIZE, corner.red, corner.green, corner.blue);
+    }
     qDebug("DONE creating corner points...");
 }
 
-void addSurfaceScene(VoxelTree * tree) {
-    qDebug("adding surface scene...");
-    float voxelSize = 1.f / (8 * TREE_SCALE);
-   
+int getSurfaceColumn(float x, float z, rgbColor color) {
     // color 1= blue, color 2=green
-    unsigned char r1, g1, b1, r2, g2, b2, red, green, blue;
+    unsigned char r1, g1, b1, r2, g2, b2;
     r1 = r2 = b2 = g1 = 0;
     b1 = g2 = 255;
-    
-    for (float x = 0.0; x < 1.0; x += voxelSize) {
-        for (float z = 0.0; z < 1.0; z += voxelSize) {
 
-            glm::vec2 position = glm::vec2(x, z);
-            float perlin = glm::perlin(position) + .25f * glm::perlin(position * 4.f) + .125f * glm::perlin(position * 16.f);
-            float gradient = (1.0f + perlin)/ 2.0f;
-            red   = (unsigned char)std::min(255, std::max(0, (int)(r1 + ((r2 - r1) * gradient))));
-            green = (unsigned char)std::min(255, std::max(0, (int)(g1 + ((g2 - g1) * gradient))));
-            blue  = (unsigned char)std::min(255, std::max(0, (int)(b1 + ((b2 - b1) * gradient))));
+    glm::vec2 position = glm::vec2(x, z);
+    float perlin = glm::perlin(position) + .25f * glm::perlin(position * 4.f) + .125f * glm::perlin(position * 16.f);
+    float gradient = (1.0f + perlin)/ 2.0f;
+    color[RED_INDEX]   = (unsigned char)std::min(255, std::max(0, (int)(r1 + ((r2 - r1) * gradient))));
+    color[GREEN_INDEX] = (unsigned char)std::min(255, std::max(0, (int)(g1 + ((g2 - g1) * gradient))));
+    color[BLUE_INDEX]  = (unsigned char)std::min(255, std::max(0, (int)(b1 + ((b2 - b1) * gradient))));
 
-            int height = (4 * gradient)+1; // make it at least 4 thick, so we get some averaging
+    return (4 * gradient)+1; // make it at least 4 thick, so we get some averaging
+}
+
+void addSurfaceScene(VoxelTree * tree) {
+    qDebug("adding surface scene...");
+    float voxelSize = SURFACE_VOXEL_SIZE;
+   
+    for (float x = 0.0; x < 1.0; x += voxelSize) {
+        for (float z = 0.0; z < 1.0; z += voxelSize) {
+            rgbColor color;
+            int height = getSurfaceColumn(x, z, color);
             for (int i = 0; i < height; i++) {
-                tree->createVoxel(x, ((i+1) * voxelSize) , z, voxelSize, red, green, blue);
+                tree->createVoxel(x, ((i+1) * voxelSize) , z, voxelSize,
+                                  color[RED_INDEX], color[GREEN_INDEX], color[BLUE_INDEX]);
             }
         }
     }
     qDebug("DONE adding surface scene...");
 }
+
+static bool cubeContainsPoint(const VoxelPositionSize& cube, float x, float y, float z) {
+    return x >= cube.x && x < cube.x + cube.s && y >= cube.y && y < cube.y + cube.s && z >= cube.z && z < cube.z + cube.s;
+}
+
+bool StreamedCornersScene::touches(const VoxelPositionSize& cube) const {
+    for (int i = 0; i < NUM_CORNER_POINTS; i++) {
+        const CornerPoint& corner = CORNER_POINTS[i];
+        if (cubeContainsPoint(cube, corner.x * (1.0f - CORNER_VOXEL_SIZE), corner.y * (1.0f - CORNER_VOXEL_SIZE),
+                              corner.z * (1.0f - CORNER_VOXEL_SIZE))) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void StreamedCornersScene::addVoxels(const VoxelPositionSize& cube, QVector<StreamedVoxel>& voxels) const {
+    int sections = getShallowestSections();
+    quint32 farCorner = (1U << sections) - 1;
+    for (int i = 0; i < NUM_CORNER_POINTS; i++) {
+        const CornerPoint& corner = CORNER_POINTS[i];
+        if (cubeContainsPoint(cube, corner.x * (1.0f - CORNER_VOXEL_SIZE), corner.y * (1.0f - CORNER_VOXEL_SIZE),
+                              corner.z * (1.0f - CORNER_VOXEL_SIZE))) {
+            voxels.append(makeStreamedVoxel(sections, corner.x * farCorner, corner.y * farCorner, corner.z * farCorner,
+                                            corner.red, corner.green, corner.blue));
+        }
+    }
+}
+
+bool StreamedSurfaceScene::touches(const VoxelPositionSize& cube) const {
+    // the columns start a voxel up from the ground
+    float minY = cube.y / SURFACE_VOXEL_SIZE;
+    return minY <= MAX_SURFACE_HEIGHT && minY + cube.s / SURFACE_VOXEL_SIZE > 1.0f;
+}
+
+void StreamedSurfaceScene::addVoxels(const VoxelPositionSize& cube, QVector<StreamedVoxel>& voxels) const {
+    int sections = getShallowestSections();
+    quint32 minX = cube.x / SURFACE_VOXEL_SIZE;
+    quint32 minY = cube.y / SURFACE_VOXEL_SIZE;
+    quint32 minZ = cube.z / SURFACE_VOXEL_SIZE;
+    quint32 size = cube.s / SURFACE_VOXEL_SIZE;
+
+    for (quint32 x = minX; x < minX + size; x++) {
+        for (quint32 z = minZ; z < minZ + size; z++) {
+            rgbColor color;
+            int height = std::min(getSurfaceColumn(x * SURFACE_VOXEL_SIZE, z * SURFACE_VOXEL_SIZE, color),
+                                  MAX_SURFACE_HEIGHT);
+            for (quint32 y = std::max(minY, 1U); y <= (quint32)height && y < minY + size; y++) {
+                voxels.append(makeStreamedVoxel(sections, x, y, z, color[RED_INDEX], color[GREEN_INDEX],
+                                                color[BLUE_INDEX]));
+            }
+        }
+    }
+}
@@ -15,8 +15,37 @@
 #include "VoxelTree.h"
 #include <SharedUtil.h>
 
+#include "SceneStreamer.h"
+
+// the corner voxels are about 1/2 meter high, and the surface's 1/8 meter
+const float CORNER_VOXEL_SIZE = 0.5f / TREE_SCALE;
+const float SURFACE_VOXEL_SIZE = 1.0f / (8 * TREE_SCALE);
+
+// the surface is at most this many voxels thick
+const int MAX_SURFACE_HEIGHT = 6;
+
 void addCornersAndAxisLines(VoxelTree* tree);
 void addSurfaceScene(VoxelTree * tree);
 
+/// the color of the surface at x, z and how many voxels thick it is there
+int getSurfaceColumn(float x, float z, rgbColor color);
+
+/// The corner points, given a part at a time to a SceneStreamer.
+class StreamedCornersScene : public StreamedScene {
+public:
+    virtual int getShallowestSections() const { return sectionsForVoxelSize(CORNER_VOXEL_SIZE); }
+    virtual bool touches(const VoxelPositionSize& cube) const;
+    virtual void addVoxels(const VoxelPositionSize& cube, QVector<StreamedVoxel>& voxels) const;
+};
+
+/// The surface, given a part at a time to a SceneStreamer. Each part works out the columns under it on its own, so that
+/// the surface can be made far larger than would fit in a tree.
+class StreamedSurfaceScene : public StreamedScene {
+public:
+    virtual int getShallowestSections() const { return sectionsForVoxelSize(SURFACE_VOXEL_SIZE); }
+    virtual bool touches(const VoxelPositionSize& cube) const;
+    virtual void addVoxels(const VoxelPositionSize& cube, QVector<StreamedVoxel>& voxels) const;
+};
+
 
 #endif // hifi_SceneUtils_h
@@ -327,6 +327,29 @@ int main(int argc, const char * argv[])
         return 0;
     }
 
+    const char* ADD_CORNERS_AND_AXIS_LINES = "--addCornersAndAxisLines";
+    const char* ADD_SURFACE_SCENE = "--addSurfaceScene";
+
+    // Handles writing the scenes a subtree at a time, for scenes too large to build in a tree
+    const char* STREAM_SCENE = "--streamScene";
+    const char* STREAM_SUBTREE_SECTIONS = "--streamSubtreeSections";
+    const int DEFAULT_STREAM_SUBTREE_SECTIONS = 9;
+    const char* streamSceneFile = getCmdOption(argc, argv, STREAM_SCENE);
+    if (streamSceneFile) {
+        const char* subtreeSections = getCmdOption(argc, argv, STREAM_SUBTREE_SECTIONS);
+        SceneStreamer streamer(subtreeSections ? atoi(subtreeSections) : DEFAULT_STREAM_SUBTREE_SECTIONS);
+
+        StreamedCornersScene cornersScene;
+        if (cmdOptionExists(argc, argv, ADD_CORNERS_AND_AXIS_LINES)) {
+            streamer.addScene(&cornersScene);
+        }
+        StreamedSurfaceScene surfaceScene;
+        if (cmdOptionExists(argc, argv, ADD_SURFACE_SCENE)) {
+            streamer.addScene(&surfaceScene);
+        }
+        return streamer.writeToSVOFile(streamSceneFile) ? 0 : 1;
+    }
+
     const char* DONT_CREATE_FILE = "--dontCreateSceneFile";
     bool dontCreateFile = cmdOptionExists(argc, argv, DONT_CREATE_FILE);
 
@@ -340,12 +363,10 @@ int main(int argc, const char * argv[])
             voxelTutorial(&myTree);
         }
 
-        const char* ADD_CORNERS_AND_AXIS_LINES = "--addCornersAndAxisLines";
         if (cmdOptionExists(argc, argv, ADD_CORNERS_AND_AXIS_LINES)) {
             addCornersAndAxisLines(&myTree);
         }
 
-        const char* ADD_SURFACE_SCENE = "--addSurfaceScene";
         if (cmdOptionExists(argc, argv, ADD_SURFACE_SCENE)) {
             addSurfaceScene(&myTree);
         }